@@ -0,0 +1,447 @@
+/**
+ * birds_of_play_storage_bench: end-to-end cost of saving frames through each persistence
+ * backend, the C++ counterpart of src/mongodb/performance_test.py
+ *
+ * Usage:
+ *   birds_of_play_storage_bench [backend ...] [options]
+ *     legacy    save_frames_to_mongodb() per frame: a fresh session (module imports, connect,
+ *               index creation), numpy conversion, encoding and insert_one every time
+ *     session   One long-lived MongoFrameSession: numpy conversion, encoding in Python, insert_one
+ *     queue     FramePersistenceQueue (C++ encoding, batched inserts) into the "python" backend
+ *     native    FramePersistenceQueue into FrameStore (mongocxx)
+ *     segment   FramePersistenceQueue appending images to segment files, "local" documents
+ *   Without backends every one this build has runs (legacy, session and queue need
+ *   ENABLE_PYTHON, native ENABLE_MONGO; segment needs no database).
+ *     --frames N         Saves per backend (default 200)
+ *     --size WxH         Synthetic frame size (default 1280x720)
+ *     --rate FPS         Submit at most FPS frames per second (default 0 = as fast as possible)
+ *     --storage DIR      Scratch image directory, emptied before and removed after each backend
+ *                        (default /tmp/birds_of_play_storage_bench)
+ *     --database NAME    Database the documents go to (default birds_of_play_bench; never the
+ *                        live birds_of_play, drop it afterwards)
+ *     --mongodb-uri URI  Server of the native backend (default mongodb://localhost:27017)
+ *
+ * Every backend gets the same workload: frames cycled from a small set of noisy synthetic
+ * scenes, an annotated copy of each and one consolidated region, so the encoders see
+ * realistic entropy. Each backend runs in a child process of its own, so an embedded
+ * interpreter and its threads never outlive their run and the CPU time is the backend's
+ * alone.
+ *
+ * Reported per backend: saves/s over the timed run, p50/p99 latency (for the synchronous
+ * backends the call, for the queued ones submit() to document inserted), CPU ms per save
+ * (user + system time of every thread of the process over the timed run) and setup ms
+ * (interpreter start, connect; not part of the other columns). Saves that returned no
+ * UUID count as failed.
+ *
+ * Exit status: 0 when every backend saved every frame, 1 otherwise, 2 on usage.
+ */
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <opencv2/opencv.hpp>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame_persistence_queue.hpp"  // FramePersistenceQueue, PersistJob
+#include "motion_detection/include/logger.hpp"
+#include "motion_detection/include/persistence_backend.hpp"  // makePersistenceBackend ("local")
+#if BIRDS_HAVE_MONGO
+#include "motion_detection/include/frame_store.hpp"  // FrameStore ("native")
+#endif
+#if BIRDS_HAVE_PYTHON
+#include "mongodb_functions.hpp"  // MongoFrameSession, PythonPersistenceBackend, save_frames_to_mongodb
+#endif
+
+#ifndef BIRDS_HAVE_MONGO
+#define BIRDS_HAVE_MONGO 0
+#endif
+#ifndef BIRDS_HAVE_PYTHON
+#define BIRDS_HAVE_PYTHON 0
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions {
+    std::vector<std::string> backends;
+    int frames = 200;
+    cv::Size size{1280, 720};
+    double rate = 0.0;
+    std::string storagePath = "/tmp/birds_of_play_storage_bench";
+    std::string databaseName = "birds_of_play_bench";
+    std::string mongodbUri = "mongodb://localhost:27017";
+};
+
+// What a backend's child process reports back through its pipe
+struct BenchResult {
+    int saved = 0;
+    int failed = 0;
+    double seconds = 0.0;
+    double p50Ms = 0.0;
+    double p99Ms = 0.0;
+    double cpuMsPerSave = 0.0;
+    double setupMs = 0.0;
+};
+
+bool available(const std::string& backend) {
+    if (backend == "legacy" || backend == "session" || backend == "queue") return BIRDS_HAVE_PYTHON;
+    if (backend == "native") return BIRDS_HAVE_MONGO;
+    return backend == "segment";
+}
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [legacy] [session] [queue] [native] [segment] [--frames N]\n"
+              << "       [--size WxH] [--rate FPS] [--storage DIR] [--database NAME] [--mongodb-uri URI]"
+              << std::endl;
+}
+
+BenchOptions parseOptions(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            if (arg != "legacy" && arg != "session" && arg != "queue" && arg != "native" && arg != "segment") {
+                throw std::invalid_argument("unknown backend " + arg);
+            }
+            if (!available(arg)) throw std::invalid_argument("backend " + arg + " is not built in");
+            options.backends.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc) throw std::invalid_argument(arg + " needs a value");
+        const std::string value = argv[++i];
+        if (arg == "--frames") {
+            options.frames = std::max(1, std::stoi(value));
+        } else if (arg == "--size") {
+            int width = 0, height = 0;
+            if (std::sscanf(value.c_str(), "%dx%d", &width, &height) != 2 || width < 64 || height < 64) {
+                throw std::invalid_argument("--size expects WxH of at least 64x64");
+            }
+            options.size = cv::Size(width, height);
+        } else if (arg == "--rate") {
+            options.rate = std::max(0.0, std::stod(value));
+        } else if (arg == "--storage") {
+            options.storagePath = value;
+        } else if (arg == "--database") {
+            if (value == "birds_of_play") throw std::invalid_argument("--database must not be the live database");
+            options.databaseName = value;
+        } else if (arg == "--mongodb-uri") {
+            options.mongodbUri = value;
+        } else {
+            throw std::invalid_argument("unknown option " + arg);
+        }
+    }
+    if (options.backends.empty()) {
+        for (const char* backend : {"legacy", "session", "queue", "native", "segment"}) {
+            if (available(backend)) options.backends.push_back(backend);
+        }
+    }
+    return options;
+}
+
+// Frames the backends save, cycled: a gradient under sensor noise with a dark "bird"
+// moving across it, and the annotated copy the live pipeline would store
+struct Workload {
+    static constexpr int kScenes = 8;
+
+    explicit Workload(cv::Size size) {
+        std::mt19937 random(42);
+        for (int scene = 0; scene < kScenes; ++scene) {
+            cv::Mat original(size, CV_8UC3);
+            for (int y = 0; y < size.height; ++y) {
+                const auto shade = static_cast<uchar>(90 + 100 * y / size.height);
+                original.row(y).setTo(cv::Scalar(shade + 20, shade + 10, shade));
+            }
+            cv::Mat noise(size, CV_8UC3);
+            cv::randu(noise, cv::Scalar::all(0), cv::Scalar::all(12));
+            cv::add(original, noise, original);
+            const cv::Rect bird(size.width * scene / kScenes, static_cast<int>(random() % (size.height / 2)),
+                                size.width / 20, size.height / 20);
+            cv::rectangle(original, bird, cv::Scalar(30, 25, 20), cv::FILLED);
+            cv::Mat annotated = original.clone();
+            cv::rectangle(annotated, bird, cv::Scalar(0, 255, 0), 2);
+            originals.push_back(original);
+            annotatedFrames.push_back(annotated);
+            regions.push_back(bird);
+        }
+    }
+
+    FrameMetadata metadata(int index) const {
+        FrameMetadata metadata;
+        metadata.source = "storage_bench";
+        metadata.frameCount = index;
+        metadata.timestamp = static_cast<int64_t>(std::time(nullptr));
+        metadata.motionDetected = true;
+        metadata.motionRegions = 1;
+        metadata.confidence = 0.8;
+        RegionMetadata region;
+        region.box = regions[index % kScenes];
+        region.objectCount = 1;
+        metadata.consolidatedRegions.push_back(region);
+        return metadata;
+    }
+
+    // Same fields as metadata(), as the JSON text the Python entry points parse
+    std::string metadataJson(int index) const {
+        const cv::Rect& box = regions[index % kScenes];
+        char buffer[320];
+        std::snprintf(buffer, sizeof(buffer),
+                      "{\"source\":\"storage_bench\",\"frame_count\":%d,\"timestamp\":%lld,\"auto_saved\":true,"
+                      "\"motion_detected\":true,\"motion_regions\":1,\"confidence\":0.8,"
+                      "\"consolidated_regions\":[{\"x\":%d,\"y\":%d,\"width\":%d,\"height\":%d,\"object_count\":1}]}",
+                      index, static_cast<long long>(std::time(nullptr)), box.x, box.y, box.width, box.height);
+        return buffer;
+    }
+
+    const cv::Mat& original(int index) const { return originals[index % kScenes]; }
+    const cv::Mat& annotated(int index) const { return annotatedFrames[index % kScenes]; }
+
+    std::vector<cv::Mat> originals;
+    std::vector<cv::Mat> annotatedFrames;
+    std::vector<cv::Rect> regions;
+};
+
+double cpuSeconds() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+           static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+double percentile(std::vector<double> values, double fraction) {
+    if (values.empty()) return 0.0;
+    const size_t index = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(index), values.end());
+    return values[index];
+}
+
+// Paces submissions to options.rate (no-op at 0)
+class Pacer {
+   public:
+    explicit Pacer(double rate) : start_(Clock::now()), rate_(rate) {}
+
+    void wait(int index) const {
+        if (rate_ <= 0.0) return;
+        std::this_thread::sleep_until(start_ + std::chrono::duration_cast<Clock::duration>(
+                                                   std::chrono::duration<double>(index / rate_)));
+    }
+
+   private:
+    Clock::time_point start_;
+    double rate_;
+};
+
+// Timing of the timed run shared by every backend; latencies in ms
+struct Measurement {
+    Clock::time_point start;
+    double cpuStart = 0.0;
+    std::vector<double> latencies;
+
+    void begin() {
+        start = Clock::now();
+        cpuStart = cpuSeconds();
+    }
+
+    void finish(BenchResult& result) {
+        result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        result.cpuMsPerSave = result.saved > 0 ? (cpuSeconds() - cpuStart) * 1000.0 / result.saved : 0.0;
+        result.p50Ms = percentile(latencies, 0.50);
+        result.p99Ms = percentile(latencies, 0.99);
+    }
+};
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+#if BIRDS_HAVE_PYTHON
+// legacy and session: one synchronous call per frame on this thread, which holds the GIL
+BenchResult runPythonCalls(const BenchOptions& options, const Workload& workload, bool legacy) {
+    BenchResult result;
+    const Clock::time_point setupStart = Clock::now();
+    py::scoped_interpreter interpreter(false);
+    std::unique_ptr<MongoFrameSession> session;
+    if (!legacy) session = std::make_unique<MongoFrameSession>(options.storagePath, options.databaseName);
+    result.setupMs = millisecondsSince(setupStart);
+
+    Measurement measurement;
+    measurement.begin();
+    const Pacer pacer(options.rate);
+    for (int i = 0; i < options.frames; ++i) {
+        pacer.wait(i);
+        const Clock::time_point callStart = Clock::now();
+        const std::string uuid =
+            legacy ? save_frames_to_mongodb(workload.original(i), workload.annotated(i), workload.metadataJson(i),
+                                            options.storagePath, options.databaseName)
+                   : session->saveFrames(workload.original(i), workload.annotated(i), workload.metadataJson(i));
+        measurement.latencies.push_back(millisecondsSince(callStart));
+        ++(uuid.empty() ? result.failed : result.saved);
+    }
+    measurement.finish(result);
+    session.reset();  // Before the interpreter is finalized
+    return result;
+}
+#endif
+
+// queue, native and segment: the live pipeline's persistence worker in front of a backend
+BenchResult runQueue(const BenchOptions& options, const Workload& workload, const std::string& backendName) {
+    BenchResult result;
+    PersistenceConfig config;
+    config.storagePath = options.storagePath;
+    config.backpressure = BackpressurePolicy::Block;  // Every frame is saved; a full queue slows the producer
+    std::unique_ptr<PersistenceBackend> backend;
+    if (backendName == "segment") {
+        config.segmentPath = (fs::path(options.storagePath) / "segments").string();
+        PersistenceBackendConfig backendConfig;
+        backendConfig.name = "local";
+        backendConfig.localPath = (fs::path(options.storagePath) / "documents").string();
+        backend = makePersistenceBackend(backendConfig);
+    }
+#if BIRDS_HAVE_MONGO
+    if (backendName == "native") {
+        FrameStoreConfig storeConfig;
+        storeConfig.uri = options.mongodbUri;
+        storeConfig.databaseName = options.databaseName;
+        storeConfig.storagePath = options.storagePath;
+        backend = std::make_unique<FrameStore>(storeConfig);
+    }
+#endif
+#if BIRDS_HAVE_PYTHON
+    if (backendName == "queue") {
+        backend = std::make_unique<PythonPersistenceBackend>(options.storagePath, options.databaseName);
+    }
+#endif
+    if (!backend) throw std::invalid_argument("backend " + backendName + " is not built in");
+
+    const Clock::time_point setupStart = Clock::now();
+    if (!backend->connect()) {
+        std::cerr << backendName << ": could not connect the " << backend->name() << " backend" << std::endl;
+    }
+    // The Python backend starts its interpreter in the background: one empty batch waits for it
+    backend->insertRecords({});
+    result.setupMs = millisecondsSince(setupStart);
+
+    // Submission times by frame index (metadata.frameCount); the worker records completions
+    std::vector<Clock::time_point> submitted(static_cast<size_t>(options.frames));
+    Measurement measurement;
+    FramePersistenceQueue queue(
+        [&](const std::vector<StoredFrameRecord>& records) {
+            std::vector<std::string> inserted = backend->insertRecords(records);
+            const Clock::time_point now = Clock::now();
+            for (const StoredFrameRecord& record : records) {
+                if (std::find(inserted.begin(), inserted.end(), record.uuid) == inserted.end()) continue;
+                measurement.latencies.push_back(
+                    std::chrono::duration<double, std::milli>(now - submitted[record.metadata.frameCount]).count());
+            }
+            return inserted;
+        },
+        config);
+    queue.start();
+
+    measurement.begin();
+    const Pacer pacer(options.rate);
+    for (int i = 0; i < options.frames; ++i) {
+        pacer.wait(i);
+        PersistJob job;
+        job.frameIndex = i;
+        job.original = workload.original(i);
+        job.annotated = workload.annotated(i);
+        job.metadata = workload.metadata(i);
+        job.enqueueTime = Clock::now();
+        submitted[static_cast<size_t>(i)] = job.enqueueTime;
+        queue.submit(std::move(job));
+    }
+    queue.drain();
+    const PersistenceStats stats = queue.getStats();
+    result.saved = static_cast<int>(stats.saved);
+    result.failed = options.frames - result.saved;
+    measurement.finish(result);
+    return result;
+}
+
+BenchResult runBackend(const BenchOptions& options, const std::string& backend) {
+    const Workload workload(options.size);
+#if BIRDS_HAVE_PYTHON
+    if (backend == "legacy" || backend == "session") return runPythonCalls(options, workload, backend == "legacy");
+#endif
+    return runQueue(options, workload, backend);
+}
+
+// Runs @p backend in a child process; false if the child failed before reporting
+bool runIsolated(const BenchOptions& options, const std::string& backend, BenchResult& result) {
+    std::error_code ec;
+    fs::remove_all(options.storagePath, ec);
+    fs::create_directories(options.storagePath, ec);
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+    std::cout.flush();  // Or the child repeats whatever is still buffered
+    const pid_t child = fork();
+    if (child < 0) return false;
+    if (child == 0) {
+        close(fds[0]);
+        int status = 1;
+        try {
+            Logger::init("warn", "birds_of_play_storage_bench_log.txt", false);
+            const BenchResult childResult = runBackend(options, backend);
+            status = write(fds[1], &childResult, sizeof(childResult)) == sizeof(childResult) ? 0 : 1;
+        } catch (const std::exception& e) {
+            std::cerr << backend << ": " << e.what() << std::endl;
+        }
+        _exit(status);
+    }
+    close(fds[1]);
+    const bool reported = read(fds[0], &result, sizeof(result)) == sizeof(result);
+    close(fds[0]);
+    int status = 0;
+    waitpid(child, &status, 0);
+    fs::remove_all(options.storagePath, ec);
+    return reported && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    std::printf("%d saves per backend of %dx%d frames%s, documents in %s\n\n", options.frames, options.size.width,
+                options.size.height, options.rate > 0.0 ? (" at " + std::to_string(options.rate) + " fps").c_str() : "",
+                options.databaseName.c_str());
+    std::printf("%-8s %7s %7s %9s %9s %9s %12s %9s\n", "backend", "saved", "failed", "saves/s", "p50 ms", "p99 ms",
+                "cpu ms/save", "setup ms");
+    bool complete = true;
+    for (const std::string& backend : options.backends) {
+        BenchResult result;
+        if (!runIsolated(options, backend, result)) {
+            std::printf("%-8s failed to run\n", backend.c_str());
+            complete = false;
+            continue;
+        }
+        std::printf("%-8s %7d %7d %9.1f %9.2f %9.2f %12.2f %9.0f\n", backend.c_str(), result.saved, result.failed,
+                    result.seconds > 0.0 ? result.saved / result.seconds : 0.0, result.p50Ms, result.p99Ms,
+                    result.cpuMsPerSave, result.setupMs);
+        std::fflush(stdout);
+        complete = complete && result.failed == 0;
+    }
+    return complete ? 0 : 1;
+}
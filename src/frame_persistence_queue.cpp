@@ -0,0 +1,243 @@
+#include "frame_persistence_queue.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <utility>
+
+#include "motion_detection/include/logger.hpp"
+#include "motion_detection/include/thread_placement.hpp"
+
+namespace {
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+}  // namespace
+
+FramePersistenceQueue::FramePersistenceQueue(InsertFunction insertBatch,
+                                             const PersistenceConfig& config)
+    : insertBatch_(std::move(insertBatch)),
+      config_(config),
+      fileStorage_(config.storagePath, config.encoding.full.quality, config.encoding.thumbnail.quality,
+                   config.thumbnailSize, config.regionPath),
+      queue_(config.queueCapacity, config.backpressure) {
+    if (!config.segmentPath.empty()) {
+        SegmentStoreConfig segmentConfig;
+        segmentConfig.directory = config.segmentPath;
+        segmentConfig.segmentBytes = config.segmentBytes;
+        segmentConfig.cachePolicy = config.segmentCache;
+        fileStorage_.useSegments(std::make_shared<FrameSegmentStore>(segmentConfig));
+    }
+    fileStorage_.useEncoding(config.encoding);
+    if (config.asyncWrites) {
+        fileWriter_ = std::make_shared<AsyncFileWriter>(config.fileWriter);
+        fileStorage_.useWriter(fileWriter_);
+    }
+    if (config.atlas.enabled) {
+        // Sheets use the thumbnail codec useEncoding() settled on
+        atlas_ = std::make_shared<ThumbnailAtlas>(config.storagePath + "/atlases", config.atlas,
+                                                  fileStorage_.encoding().thumbnail);
+        fileStorage_.useAtlas(atlas_);
+    }
+}
+
+FramePersistenceQueue::~FramePersistenceQueue() {
+    drain();
+}
+
+void FramePersistenceQueue::start() {
+    if (worker_.joinable()) return;
+
+    fileStorage_.ensureDirectories();
+    worker_ = std::thread(&FramePersistenceQueue::run, this);
+}
+
+bool FramePersistenceQueue::submit(PersistJob job) {
+    job.enqueueTime = std::chrono::steady_clock::now();
+    if (!queue_.push(std::move(job))) return false;
+    submitted_++;
+    return true;
+}
+
+void FramePersistenceQueue::submitSummary(MotionMinuteSummary summary) {
+    if (!writeSummaries_) return;
+    std::lock_guard<std::mutex> lock(summaryMutex_);
+    pendingSummaries_.push_back(std::move(summary));
+}
+
+void FramePersistenceQueue::drain() {
+    queue_.close();
+    if (worker_.joinable()) worker_.join();
+}
+
+PersistenceStats FramePersistenceQueue::getStats() const {
+    PersistenceStats stats;
+    stats.queueDepth = queue_.size();
+    stats.queueCapacity = queue_.capacity();
+    stats.queueHighWatermark = queue_.highWatermark();
+    stats.submitted = submitted_.load();
+    stats.dropped = queue_.droppedCount();
+    stats.saved = saved_.load();
+    stats.failed = failed_.load();
+    stats.batches = batches_.load();
+    stats.summariesWritten = summariesWritten_.load();
+    stats.platesWritten = platesWritten_.load();
+    stats.atlasSheets = atlas_ ? atlas_->sheetsWritten() : 0;
+    return stats;
+}
+
+void FramePersistenceQueue::run() {
+    nameCurrentThread("persist");
+    if (config_.onWorkerStart) config_.onWorkerStart();
+    std::vector<PendingFrame> batch;
+    batch.reserve(config_.maxBatchSize);
+
+    for (;;) {
+        // Wake up now and then without frames, so summaries are not held back
+        auto job = queue_.popFor(config_.idleWake);
+        if (!job) {
+            flushSummaries();
+            if (queue_.isDrained()) {
+                flushDetectionLog(true);
+                if (atlas_) atlas_->seal();
+                break;
+            }
+            flushDetectionLog(false);
+            if (atlas_) atlas_->sealDue();
+            continue;
+        }
+
+        // Step 1: Encode the first job, then keep collecting until the window closes
+        auto deadline = std::chrono::steady_clock::now() + config_.batchWindow;
+        PendingFrame pending;
+        if (encodeJob(*job, pending)) batch.push_back(std::move(pending));
+
+        while (batch.size() < config_.maxBatchSize) {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline) break;
+            auto next = queue_.popFor(deadline - now);
+            if (!next) break;  // Window elapsed, or queue closed and drained
+            PendingFrame more;
+            if (encodeJob(*next, more)) batch.push_back(std::move(more));
+        }
+
+        // Step 2: One GIL acquisition and one insert_many for the whole batch
+        flush(batch);
+        flushSummaries();
+        flushDetectionLog(false);
+        if (atlas_) atlas_->sealDue();
+    }
+}
+
+bool FramePersistenceQueue::encodeJob(const PersistJob& job, PendingFrame& pending) {
+    auto start = std::chrono::steady_clock::now();
+    pending.frameIndex = job.frameIndex;
+    pending.enqueueTime = job.enqueueTime;
+    bool ok;
+    if (!job.regionImages.empty()) {
+        ok = fileStorage_.writeCrops(job.frameSize, job.original, job.regionImages, job.regions,
+                                     job.regionImageAreas, pending.record);
+    } else if (config_.mode != PersistenceMode::FullFrames) {
+        ok = fileStorage_.writeRegions(job.original, job.regions, config_.regionCropMinSide, pending.record);
+        if (ok && config_.mode == PersistenceMode::PlatePatches) attachPlate(job, pending.record);
+    } else {
+        ok = fileStorage_.write(job.original, job.annotated, pending.record);
+    }
+    pending.record.metadata = job.metadata;
+    encodeLatency_.record(millisecondsSince(start));
+
+    if (!ok) {
+        LOG_ERROR("Failed to write images for frame {}", job.frameIndex);
+        failed_++;
+    }
+    return ok;
+}
+
+void FramePersistenceQueue::attachPlate(const PersistJob& job, StoredFrameRecord& record) {
+    // Until the producer sends a background, the first frame (bird included) serves as plate
+    if (!job.background.empty() || plate_.id.empty()) {
+        StoredPlate plate;
+        if (fileStorage_.writePlate(job.background.empty() ? job.original : job.background, plate)) {
+            plate_ = std::move(plate);
+            platesWritten_++;
+            LOG_INFO("Background plate {} ({}x{}) for the following region crops", plate_.path,
+                     plate_.size.width, plate_.size.height);
+        }
+    }
+    // A failed write keeps the previous plate: an older background beats none
+    record.plate = plate_;
+}
+
+void FramePersistenceQueue::flush(std::vector<PendingFrame>& batch) {
+    if (batch.empty()) return;
+
+    std::vector<StoredFrameRecord> records;
+    records.reserve(batch.size());
+    for (auto& pending : batch) records.push_back(std::move(pending.record));
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::string> inserted;
+    try {
+        inserted = insertBatch_(records);
+    } catch (const std::exception& e) {
+        LOG_ERROR("Frame batch insert failed: {}", e.what());
+    }
+    insertLatency_.record(millisecondsSince(start));
+    batches_++;
+
+    for (const auto& pending : batch) {
+        endToEndLatency_.record(millisecondsSince(pending.enqueueTime));
+    }
+    saved_ += inserted.size();
+    failed_ += records.size() - inserted.size();
+
+    if (!inserted.empty()) {
+        std::cout << "💾 " << inserted.size() << " frame(s) saved to MongoDB (last UUID: "
+                  << inserted.back() << ")" << std::endl;
+        LOG_INFO("Saved {} of {} frames to MongoDB in one batch (frames {}-{})", inserted.size(),
+                 records.size(), batch.front().frameIndex, batch.back().frameIndex);
+    }
+    if (inserted.size() < records.size()) {
+        // Don't leave orphaned images behind for frames that never got a document
+        for (const auto& record : records) {
+            if (std::find(inserted.begin(), inserted.end(), record.uuid) == inserted.end()) {
+                fileStorage_.remove(record);
+            }
+        }
+        std::cout << "❌ Failed to save " << records.size() - inserted.size()
+                  << " frame(s) to MongoDB" << std::endl;
+        LOG_ERROR("Failed to save {} of {} frames to MongoDB", records.size() - inserted.size(),
+                  records.size());
+    }
+    batch.clear();
+}
+
+void FramePersistenceQueue::flushSummaries() {
+    std::vector<MotionMinuteSummary> summaries;
+    {
+        std::lock_guard<std::mutex> lock(summaryMutex_);
+        summaries.swap(pendingSummaries_);
+    }
+    if (summaries.empty()) return;
+
+    bool ok = false;
+    try {
+        ok = writeSummaries_(summaries);
+    } catch (const std::exception& e) {
+        LOG_ERROR("Motion summary upsert failed: {}", e.what());
+    }
+    if (ok) {
+        summariesWritten_ += summaries.size();
+    } else {
+        LOG_WARN("Dropped {} per-minute motion summaries", summaries.size());
+    }
+}
+
+void FramePersistenceQueue::flushDetectionLog(bool force) {
+    if (!detectionLog_ || (!force && !detectionLog_->flushDue())) return;
+    // DetectionLog logs its own I/O errors and counts the lost row groups
+    detectionLog_->flush();
+}
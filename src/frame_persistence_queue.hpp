@@ -0,0 +1,233 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "motion_detection/include/async_file_writer.hpp"
+#include "motion_detection/include/bounded_queue.hpp"
+#include "motion_detection/include/detection_log.hpp"
+#include "motion_detection/include/frame_file_storage.hpp"
+#include "motion_detection/include/frame_metadata.hpp"
+#include "motion_detection/include/latency_histogram.hpp"
+#include "motion_detection/include/lockfree_queue.hpp"
+#include "motion_detection/include/motion_stats_aggregator.hpp"
+#include "motion_detection/include/thumbnail_atlas.hpp"
+
+/**
+ * @brief What the persistence worker writes for a saved frame
+ *
+ * - FullFrames: original and annotated frames plus a thumbnail of each (the original layout)
+ * - RegionCrops: one JPEG per consolidated region and a context thumbnail; annotations only
+ *   live in the metadata document
+ * - PlatePatches: RegionCrops plus a reference to a background plate written every
+ *   plateInterval, so the full scene can be rebuilt by pasting the crops onto the plate
+ *   (FileStorageManager.load_plate_frame(), the viewer) at a fraction of a full frame's bytes
+ */
+enum class PersistenceMode { FullFrames, RegionCrops, PlatePatches };
+
+/**
+ * @brief Parse a persistence mode name ("full_frames", "region_crops", "plate_patches")
+ * @throws std::invalid_argument for unknown names
+ */
+inline PersistenceMode parsePersistenceMode(std::string name) {
+    std::transform(name.begin(), name.end(), name.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (name == "full_frames") return PersistenceMode::FullFrames;
+    if (name == "region_crops") return PersistenceMode::RegionCrops;
+    if (name == "plate_patches") return PersistenceMode::PlatePatches;
+    throw std::invalid_argument("Unknown persistence mode: " + name);
+}
+
+inline const char* persistenceModeName(PersistenceMode mode) {
+    switch (mode) {
+        case PersistenceMode::FullFrames:
+            return "full_frames";
+        case PersistenceMode::RegionCrops:
+            return "region_crops";
+        case PersistenceMode::PlatePatches:
+            return "plate_patches";
+    }
+    return "unknown";
+}
+
+// Frame handed from the render stage to the persistence worker
+struct PersistJob {
+    int frameIndex = 0;
+    cv::Mat original;
+    cv::Mat annotated;              // FullFrames only
+    std::vector<cv::Rect> regions;  // RegionCrops/PlatePatches: consolidated region boxes
+    // PlatePatches: a fresh background plate (the model's background image) to store and
+    // refer to from now on; empty keeps the current plate
+    cv::Mat background;
+    // Visit documents (any mode): crops already cut from several frames, stored with the
+    // region boxes above; original is then only the context for the thumbnail
+    std::vector<cv::Mat> regionImages;
+    std::vector<cv::Rect> regionImageAreas;  // Frame area each crop shows
+    cv::Size frameSize;                      // Of the frames the crops come from
+    FrameMetadata metadata;
+    std::chrono::steady_clock::time_point enqueueTime;
+};
+
+struct PersistenceConfig {
+    size_t queueCapacity = 8;
+    BackpressurePolicy backpressure = BackpressurePolicy::DropOldest;
+    std::chrono::milliseconds batchWindow{250};  // How long to wait for more jobs to batch
+    size_t maxBatchSize = 8;                     // Insert as soon as this many jobs are ready
+    std::chrono::milliseconds idleWake{1000};    // Longest a summary waits while no frame is saved
+    std::string storagePath = "data/frames";     // Same layout as FileStorageManager
+    StorageEncoding encoding;  // Codec, quality and effort of full frames, crops and thumbnails
+    cv::Size thumbnailSize{320, 240};
+    PersistenceMode mode = PersistenceMode::FullFrames;
+    std::string regionPath = "data/regions";  // Where batch_detect_regions.py reads crops
+    int regionCropMinSide = 0;                // Pad region crops to this size (0 = exact boxes)
+    std::chrono::seconds plateInterval{60};   // PlatePatches: how often the producer sends a new plate
+    // Non-empty: append full frames and thumbnails to rolling segment files in this directory
+    // instead of writing one file per image (FrameSegmentStore)
+    std::string segmentPath;
+    uint64_t segmentBytes = 256ull << 20;
+    SegmentCachePolicy segmentCache = SegmentCachePolicy::PageCache;  // Keep segment writes out of the cache
+    // Hand image files to an AsyncFileWriter (io_uring, or threads) instead of writing each
+    // on the encoding thread that produced it
+    bool asyncWrites = false;
+    FileWriterConfig fileWriter;
+    // Also pack gallery thumbnails into per-hour sprite sheets under <storagePath>/atlases
+    ThumbnailAtlasConfig atlas;
+    std::function<void()> onWorkerStart;  // Runs first on the worker thread (e.g. its ThreadPolicy)
+};
+
+struct PersistenceStats {
+    size_t queueDepth = 0;
+    size_t queueCapacity = 0;
+    size_t queueHighWatermark = 0;  // Deepest the queue has been
+    uint64_t submitted = 0;         // Jobs accepted by submit()
+    uint64_t dropped = 0;           // Jobs shed by backpressure
+    uint64_t saved = 0;             // Frames whose documents were inserted
+    uint64_t failed = 0;            // Frames that failed to encode or insert
+    uint64_t batches = 0;           // insert_many round trips
+    uint64_t summariesWritten = 0;  // Per-minute motion summaries upserted
+    uint64_t platesWritten = 0;     // Background plates (PlatePatches)
+    uint64_t atlasSheets = 0;       // Thumbnail atlas sheets sealed
+};
+
+/**
+ * @brief Asynchronous, batched frame persistence worker
+ *
+ * Jobs are queued by the producer and handled on a dedicated thread. The worker JPEG-encodes
+ * the original/annotated images and thumbnails with FrameFileStorage (or, in RegionCrops
+ * mode, only the region crops and a context thumbnail; PlatePatches adds the background
+ * plate a job brings, or the first job's frame when none has come yet), then collects every
+ * job that arrives within batchWindow (up to maxBatchSize) and hands the whole batch of
+ * records to the insert function in one call (insert_many). Producers never touch the
+ * database, so a slow save cannot stall the live loop.
+ *
+ * Per-minute motion summaries handed to submitSummary() are upserted by the same worker
+ * after each batch, or within idleWake when no frames are being saved. They bypass the
+ * frame queue, so backpressure never sheds them. The detection log's row groups are
+ * written at the same points, whenever DetectionLog::flushDue() says one is ready.
+ *
+ * With a thumbnail atlas each record's gallery thumbnail also goes into the sheet of its
+ * hour (ThumbnailAtlas); sheets due for sealing are written at those points too, and the
+ * open one when the queue is drained.
+ *
+ * The insert and summary functions are the only parts that may enter Python: the embedded
+ * backend acquires the GIL inside them, the native FrameStore backend needs no GIL at all.
+ *
+ * Thread safety: submit(), submitSummary(), getStats() and the latency accessors are
+ * thread-safe. When the insert function takes the GIL, drain() must be called while the
+ * caller does NOT hold it.
+ */
+class FramePersistenceQueue {
+   public:
+    // Inserts a batch of metadata documents; returns the UUIDs that were stored
+    using InsertFunction =
+        std::function<std::vector<std::string>(const std::vector<StoredFrameRecord>&)>;
+    // Upserts per-minute motion summaries; returns false if they could not be written
+    using SummaryFunction = std::function<bool(const std::vector<MotionMinuteSummary>&)>;
+
+    FramePersistenceQueue(InsertFunction insertBatch, const PersistenceConfig& config);
+    ~FramePersistenceQueue();
+
+    FramePersistenceQueue(const FramePersistenceQueue&) = delete;
+    FramePersistenceQueue& operator=(const FramePersistenceQueue&) = delete;
+
+    // Where submitSummary() output goes; call before start()
+    void setSummaryWriter(SummaryFunction writeSummaries) {
+        writeSummaries_ = std::move(writeSummaries);
+    }
+
+    // Detection log whose row groups this worker writes (not owned); call before start()
+    void setDetectionLog(DetectionLog* detectionLog) { detectionLog_ = detectionLog; }
+
+    void start();
+
+    /**
+     * @brief Queue a frame for saving (subject to the backpressure policy)
+     * @return false if the job was rejected (queue closed or dropped)
+     */
+    bool submit(PersistJob job);
+
+    // Queue a finished minute for the summary writer (ignored without one)
+    void submitSummary(MotionMinuteSummary summary);
+
+    // Stop accepting jobs and block until every queued job has been saved
+    void drain();
+
+    PersistenceStats getStats() const;
+
+    // Null unless asyncWrites is set
+    const AsyncFileWriter* fileWriter() const { return fileWriter_.get(); }
+
+    const LatencyHistogram& encodeLatency() const { return encodeLatency_; }
+    const LatencyHistogram& insertLatency() const { return insertLatency_; }
+    const LatencyHistogram& endToEndLatency() const { return endToEndLatency_; }
+
+   private:
+    struct PendingFrame {
+        int frameIndex = 0;
+        std::chrono::steady_clock::time_point enqueueTime;
+        StoredFrameRecord record;
+    };
+
+    void run();
+    bool encodeJob(const PersistJob& job, PendingFrame& pending);
+    void attachPlate(const PersistJob& job, StoredFrameRecord& record);
+    void flush(std::vector<PendingFrame>& batch);
+    void flushSummaries();
+    void flushDetectionLog(bool force);
+
+    InsertFunction insertBatch_;
+    const PersistenceConfig config_;
+    FrameFileStorage fileStorage_;
+    std::shared_ptr<AsyncFileWriter> fileWriter_;
+    std::shared_ptr<ThumbnailAtlas> atlas_;
+    HandoffQueue<PersistJob> queue_;  // Shared: any thread may submit()
+    std::thread worker_;
+
+    SummaryFunction writeSummaries_;
+    std::mutex summaryMutex_;
+    std::vector<MotionMinuteSummary> pendingSummaries_;  // Guarded by summaryMutex_
+    DetectionLog* detectionLog_ = nullptr;
+    StoredPlate plate_;  // Worker only: the plate new PlatePatches records refer to
+
+    std::atomic<uint64_t> submitted_{0};
+    std::atomic<uint64_t> saved_{0};
+    std::atomic<uint64_t> failed_{0};
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> summariesWritten_{0};
+    std::atomic<uint64_t> platesWritten_{0};
+
+    LatencyHistogram encodeLatency_;    // Per frame: both images + thumbnails to disk
+    LatencyHistogram insertLatency_;    // Per batch: insert function (incl. any GIL wait)
+    LatencyHistogram endToEndLatency_;  // Per frame: submit() to document inserted
+};
@@ -16,6 +16,11 @@ import yaml
 from pathlib import Path
 from pymongo import MongoClient
 
+try:
+    from birds_of_play_python import decode_jpeg_regions
+except ImportError:  # Native module not built: regions are cut from full decodes
+    decode_jpeg_regions = None
+
 def load_config(config_path: str = None) -> dict:
     """Load detection configuration from YAML file"""
     if config_path is None:
@@ -39,6 +44,36 @@ def load_config(config_path: str = None) -> dict:
             }
         }
 
+def decode_frame_regions(project_root: Path, frame: dict, regions: list, target_side: int) -> list:
+    """
+    Decode the consolidated regions of a frame from its original JPEG
+    
+    The native decoder only decodes the JPEG blocks covering the regions, scaled down by up
+    to 1/8 as long as a region's longer side stays >= target_side (the model input size).
+    
+    Returns:
+        One BGR image per region, None where it could not be decoded
+    """
+    image_path = frame.get('original_image_path')
+    if not image_path or not (project_root / image_path).exists():
+        return [None] * len(regions)
+    image_path = project_root / image_path
+    boxes = np.array([[r.get('x', 0), r.get('y', 0), r.get('width', 0), r.get('height', 0)] for r in regions],
+                     dtype=np.int32).reshape(-1, 4)
+    if decode_jpeg_regions is not None:
+        crops = decode_jpeg_regions(str(image_path), boxes, target_side)
+        if crops is not None:
+            return crops
+    
+    frame_image = cv2.imread(str(image_path))
+    if frame_image is None:
+        return [None] * len(regions)
+    crops = []
+    for x, y, w, h in boxes:
+        crop = frame_image[max(y, 0):y + h, max(x, 0):x + w]
+        crops.append(crop if crop.size else None)
+    return crops
+
 def batch_detect_all_regions(config: dict = None) -> bool:
     """
     Run YOLO11 detection on all region cutouts
@@ -59,6 +94,8 @@ def batch_detect_all_regions(config: dict = None) -> bool:
         display_classes = set(config['display_classes'])
         model_path = config['model']['path']
         class_aliases = config.get('class_aliases', {})
+        # Regions decoded from full frames need no more pixels than the model input
+        model_image_size = config['model'].get('image_size', 640)
         
         print(f"🔍 Starting batch detection:")
         print(f"   Confidence threshold: {confidence_threshold*100}%")
@@ -104,22 +141,35 @@ def batch_detect_all_regions(config: dict = None) -> bool:
                 
             print(f"📊 Frame {frame_idx + 1}/{len(frames)}: {frame_id} ({len(consolidated_regions)} regions)")
             
+            # Frames saved with persistence_mode: region_crops store the crops directly; regions
+            # with no stored cutout are decoded from the original frame (once per frame)
+            region_crops = frame.get('region_crops', [])
+            decoded_regions = None
+            
             for region_idx, region_metadata in enumerate(consolidated_regions):
                 region_id = f"{frame_id}_{region_idx}"
                 total_regions += 1
                 
                 # Load region image
-                region_image_path = project_root / "data" / "regions" / f"{region_id}.jpg"
-                
-                if not region_image_path.exists():
-                    print(f"  ⚠️ Region image not found: {region_id}")
-                    continue
+                if region_idx < len(region_crops):
+                    region_image_path = project_root / region_crops[region_idx]['path']
+                else:
+                    region_image_path = project_root / "data" / "regions" / f"{region_id}.jpg"
                 
-                region_image = cv2.imread(str(region_image_path))
+                if region_image_path.exists():
+                    region_image = cv2.imread(str(region_image_path))
+                else:
+                    if decoded_regions is None:
+                        decoded_regions = decode_frame_regions(project_root, frame, consolidated_regions,
+                                                               model_image_size)
+                    region_image = decoded_regions[region_idx]
                 if region_image is None:
                     print(f"  ⚠️ Could not load region image: {region_id}")
                     continue
                 
+                # Boxes are stored in full-resolution region pixels, also for scaled-down decodes
+                bbox_scale = max(region_metadata.get('width', 0) / region_image.shape[1], 1.0)
+                
                 # Run detection
                 results = model(region_image, verbose=False)
                 
@@ -147,7 +197,8 @@ def batch_detect_all_regions(config: dict = None) -> bool:
                                     'class_name': class_name,
                                     'display_name': display_name,
                                     'confidence': confidence,
-                                    'bbox': [int(x1), int(y1), int(x2), int(y2)]
+                                    'bbox': [int(x1 * bbox_scale), int(y1 * bbox_scale),
+                                             int(x2 * bbox_scale), int(y2 * bbox_scale)]
                                 }
                                 detections.append(detection_info)
                                 
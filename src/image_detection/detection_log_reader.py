@@ -0,0 +1,223 @@
+#!/usr/bin/env python3
+"""
+Detection Log Reader
+====================
+
+Zero-copy access to the columnar detection log the C++ pipeline writes
+(`detection_log` in config.yaml, DetectionLog in detection_log.hpp).
+
+Every processed frame gets a row: frame index, timestamp, stream, its motion boxes and its
+consolidated regions, each region listing the boxes it was built from. The file is a
+sequence of row groups whose columns are stored back to back and 8-byte aligned, so the
+reader maps the file and hands out numpy views of the columns without copying or parsing
+anything. Lists are stored the way Arrow stores them (offsets into a child column), so
+to_arrow() wraps the same buffers in a pyarrow RecordBatch when pyarrow is installed.
+
+    for group in read_directory("data/detections", start_us=t0, end_us=t1):
+        moving = group.box_count() > 0
+        print(group.frame_index[moving], group.box_width[:10])
+"""
+
+import mmap
+import os
+import struct
+import sys
+from dataclasses import dataclass
+from typing import Iterator, List, Optional
+
+import numpy as np
+
+# Layout constants; keep in sync with detection_log_layout in detection_log.hpp
+MAGIC = 0x4C444F42  # "BODL"
+ROW_GROUP_MAGIC = 0x47524F42  # "BORG"
+VERSION = 1
+
+# FileHeader: magic, version, createdUs, reserved[2]
+FILE_HEADER = struct.Struct("<IIqQQ")
+# RowGroupHeader: magic, columnCount, frames, boxes, regions, members, bodyBytes,
+# firstTimestampUs, lastTimestampUs
+ROW_GROUP_HEADER = struct.Struct("<IIQQQQQqq")
+
+# (name, dtype, length) in file order; length names the row group count it is sized by
+COLUMNS = [
+    ("frame_index", np.int64, "frames"),
+    ("timestamp_us", np.int64, "frames"),
+    ("stream", np.uint16, "frames"),
+    ("box_offsets", np.int32, "frames+1"),
+    ("region_offsets", np.int32, "frames+1"),
+    ("box_x", np.int16, "boxes"),
+    ("box_y", np.int16, "boxes"),
+    ("box_width", np.int16, "boxes"),
+    ("box_height", np.int16, "boxes"),
+    ("box_object_id", np.int32, "boxes"),
+    ("region_x", np.int16, "regions"),
+    ("region_y", np.int16, "regions"),
+    ("region_width", np.int16, "regions"),
+    ("region_height", np.int16, "regions"),
+    ("member_offsets", np.int32, "regions+1"),
+    ("member_box", np.int32, "members"),
+]
+
+
+def _padded(nbytes: int) -> int:
+    return (nbytes + 7) & ~7
+
+
+@dataclass
+class RowGroup:
+    """One row group. Every column is a read-only view into the mapped file."""
+
+    frames: int
+    first_timestamp_us: int
+    last_timestamp_us: int
+    columns: dict
+
+    def __getattr__(self, name):
+        try:
+            return self.__dict__["columns"][name]
+        except KeyError:
+            raise AttributeError(name) from None
+
+    def box_count(self) -> np.ndarray:
+        """Boxes per frame."""
+        return np.diff(self.columns["box_offsets"])
+
+    def region_count(self) -> np.ndarray:
+        """Regions per frame."""
+        return np.diff(self.columns["region_offsets"])
+
+    def region_boxes(self, region: int) -> np.ndarray:
+        """Row-group box indices of the boxes that make up a region."""
+        offsets = self.columns["member_offsets"]
+        return self.columns["member_box"][offsets[region]:offsets[region + 1]]
+
+    def to_arrow(self):
+        """A pyarrow RecordBatch over the same buffers: one row per frame, with boxes and
+        regions as list<struct> columns and region members as list<int32> box indices."""
+        import pyarrow as pa
+
+        c = self.columns
+        boxes = pa.StructArray.from_arrays(
+            [pa.array(c[name]) for name in ("box_x", "box_y", "box_width", "box_height",
+                                            "box_object_id")],
+            names=["x", "y", "width", "height", "object_id"])
+        members = pa.ListArray.from_arrays(pa.array(c["member_offsets"]),
+                                           pa.array(c["member_box"]))
+        regions = pa.StructArray.from_arrays(
+            [pa.array(c[name]) for name in ("region_x", "region_y", "region_width",
+                                            "region_height")] + [members],
+            names=["x", "y", "width", "height", "boxes"])
+        return pa.RecordBatch.from_arrays(
+            [pa.array(c["frame_index"]),
+             pa.array(c["timestamp_us"]).cast(pa.timestamp("us", tz="UTC")),
+             pa.array(c["stream"]),
+             pa.ListArray.from_arrays(pa.array(c["box_offsets"]), boxes),
+             pa.ListArray.from_arrays(pa.array(c["region_offsets"]), regions)],
+            names=["frame_index", "timestamp", "stream", "boxes", "regions"])
+
+
+class DetectionLogReader:
+    """Maps one .bodl file read-only."""
+
+    def __init__(self, path: str):
+        self.path = path
+        self._file = open(path, "rb")
+        try:
+            self._map = mmap.mmap(self._file.fileno(), 0, access=mmap.ACCESS_READ)
+        except ValueError:  # Empty file
+            self._file.close()
+            raise ValueError(f"{path} is empty")
+        if len(self._map) < FILE_HEADER.size:
+            self.close()
+            raise ValueError(f"{path} is not a detection log")
+        magic, version, self.created_us, _, _ = FILE_HEADER.unpack_from(self._map, 0)
+        if magic != MAGIC or version != VERSION:
+            self.close()
+            raise ValueError(f"{path} is not a version {VERSION} detection log")
+
+    def close(self):
+        if self._map is not None:
+            self._map.close()
+            self._map = None
+        self._file.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def row_groups(self, start_us: Optional[int] = None,
+                   end_us: Optional[int] = None) -> Iterator[RowGroup]:
+        """
+        The complete row groups in file order.
+
+        Args:
+            start_us, end_us: Only row groups overlapping this time range (Unix microseconds);
+                the others are skipped from their header alone
+
+        The views stay valid until the reader is closed.
+        """
+        offset = FILE_HEADER.size
+        size = len(self._map)
+        while offset + ROW_GROUP_HEADER.size <= size:
+            magic, column_count, frames, boxes, regions, members, body_bytes, first_us, \
+                last_us = ROW_GROUP_HEADER.unpack_from(self._map, offset)
+            body = offset + ROW_GROUP_HEADER.size
+            if magic != ROW_GROUP_MAGIC or column_count != len(COLUMNS) or \
+                    body + body_bytes > size:
+                return  # Truncated by a crash
+            offset = body + body_bytes
+            if (start_us is not None and last_us < start_us) or \
+                    (end_us is not None and first_us > end_us):
+                continue
+
+            lengths = {"frames": frames, "frames+1": frames + 1, "boxes": boxes,
+                       "regions": regions, "regions+1": regions + 1, "members": members}
+            columns = {}
+            position = body
+            for name, dtype, length in COLUMNS:
+                count = lengths[length]
+                columns[name] = np.frombuffer(self._map, dtype=np.dtype(dtype).newbyteorder("<"),
+                                              count=count, offset=position)
+                position += _padded(count * np.dtype(dtype).itemsize)
+            yield RowGroup(frames, first_us, last_us, columns)
+
+
+def log_files(directory: str) -> List[str]:
+    """The .bodl files of a directory, oldest first (the names sort by time)."""
+    return sorted(os.path.join(directory, name) for name in os.listdir(directory)
+                  if name.endswith(".bodl"))
+
+
+def read_directory(directory: str, start_us: Optional[int] = None,
+                   end_us: Optional[int] = None) -> Iterator[RowGroup]:
+    """Row groups of every log file in a directory, oldest first."""
+    for path in log_files(directory):
+        try:
+            reader = DetectionLogReader(path)
+        except ValueError as e:
+            print(f"⚠️  Skipping {path}: {e}", file=sys.stderr)
+            continue
+        with reader:
+            yield from reader.row_groups(start_us, end_us)
+
+
+def main():
+    """Summarize a log file or directory."""
+    path = sys.argv[1] if len(sys.argv) > 1 else "data/detections"
+    paths = log_files(path) if os.path.isdir(path) else [path]
+    for file_path in paths:
+        frames = boxes = regions = groups = 0
+        with DetectionLogReader(file_path) as reader:
+            for group in reader.row_groups():
+                groups += 1
+                frames += group.frames
+                boxes += len(group.box_x)
+                regions += len(group.region_x)
+        print(f"📊 {os.path.basename(file_path)}: {groups} row groups, {frames} frames, "
+              f"{boxes} boxes, {regions} regions")
+
+
+if __name__ == "__main__":
+    main()
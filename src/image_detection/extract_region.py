@@ -43,6 +43,12 @@ def extract_region(frame_id: str, region_index: int) -> bool:
         
         region = regions[region_index]
         
+        # Frames saved with persistence_mode: region_crops have no full frame to crop from
+        region_crops = frame.get('region_crops', [])
+        if region_index < len(region_crops):
+            print(f"✅ Region already stored: {region_crops[region_index]['path']}")
+            return True
+        
         # Load original frame image
         image_path = frame.get('original_image_path')
         if not image_path:
@@ -0,0 +1,242 @@
+#!/usr/bin/env python3
+"""
+Shared Frame Reader
+===================
+
+Read-only access to the frames the C++ pipeline publishes into shared memory
+(`shared_frames` in config.yaml, SharedFrameRing in shared_frame_ring.hpp).
+
+The capture process copies its most recent frames and their consolidated region boxes into
+a ring of slots in a POSIX shared-memory segment. A YOLO worker or a live-preview endpoint
+maps that segment read-only and looks at the frames in place: no JPEGs on disk, no numpy
+copies through an embedded interpreter, and nothing shared with the capture process but
+the pages themselves.
+
+Each slot carries a sequence number that the writer makes odd while it copies a frame in.
+Views returned with copy=False point straight into the segment and are overwritten once
+the writer comes around the ring again; check is_current() after using one (or pass
+copy=True) before trusting the result.
+
+    with SharedFrameReader() as reader:
+        frame = reader.latest()
+        if frame is not None:
+            crops = frame.crops()
+            ...
+            if not reader.is_current(frame):
+                pass  # Overwritten while in use: discard the result
+"""
+
+import mmap
+import os
+import struct
+import sys
+import time
+from dataclasses import dataclass, field
+from datetime import datetime, timezone
+from typing import Iterator, List, Optional, Tuple
+
+import numpy as np
+
+# Layout constants; keep in sync with shared_frame_layout in shared_frame_ring.hpp
+MAGIC = 0x52504F42  # "BOPR"
+VERSION = 1
+MAX_REGIONS = 24
+HEADER_BYTES = 128
+SLOT_HEADER_BYTES = 512
+
+# RingHeader: magic, version, slotCount, reserved, slotBytes, maxPixelBytes, published, writerPid
+RING_HEADER = struct.Struct("<IIIIQQQq")
+PUBLISHED_OFFSET = 32
+# SlotHeader: sequence, frameNumber, frameIndex, timestampUs, width, height, channels,
+# regionCount, motionBoxCount, reserved; then MAX_REGIONS x (x, y, width, height)
+SLOT_HEADER = struct.Struct("<QQqqIIIIII")
+SEQUENCE = struct.Struct("<Q")
+REGIONS = struct.Struct(f"<{MAX_REGIONS * 4}i")
+
+DEFAULT_NAME = "/birds_of_play_frames"
+
+Box = Tuple[int, int, int, int]
+
+
+@dataclass
+class SharedFrame:
+    """One published frame. image is a view into shared memory unless copied."""
+
+    frame_number: int  # Position in the publish order
+    frame_index: int   # Pipeline frame index
+    timestamp: datetime
+    image: np.ndarray  # height x width x 3 (BGR) or height x width (gray), uint8
+    regions: List[Box] = field(default_factory=list)  # Consolidated regions (x, y, w, h)
+    motion_box_count: int = 0
+
+    def crops(self) -> List[np.ndarray]:
+        """Region crops as views of image (clamped to the frame)."""
+        height, width = self.image.shape[:2]
+        crops = []
+        for x, y, w, h in self.regions:
+            x0, y0 = max(0, x), max(0, y)
+            x1, y1 = min(width, x + w), min(height, y + h)
+            if x1 > x0 and y1 > y0:
+                crops.append(self.image[y0:y1, x0:x1])
+        return crops
+
+
+class SharedFrameReader:
+    """Maps a SharedFrameRing segment read-only."""
+
+    def __init__(self, name: str = DEFAULT_NAME):
+        self.name = name
+        self._map = None
+        self._shm = None
+        self._open()
+
+        magic, version, self.slot_count, _, self.slot_bytes, self.max_pixel_bytes, _, \
+            self.writer_pid = RING_HEADER.unpack_from(self._map, 0)
+        if magic != MAGIC or version != VERSION:
+            self.close()
+            raise ValueError(f"{name} is not a version {VERSION} shared frame ring")
+        if HEADER_BYTES + self.slot_bytes * self.slot_count > len(self._map):
+            self.close()
+            raise ValueError(f"{name} is smaller than its header says")
+
+    def _open(self):
+        shm_path = os.path.join("/dev/shm", self.name.lstrip("/"))
+        if os.path.exists(shm_path):
+            with open(shm_path, "rb") as f:
+                self._map = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+            return
+
+        # No /dev/shm (macOS): attach through multiprocessing, without letting its resource
+        # tracker unlink the writer's segment when this process exits
+        from multiprocessing import resource_tracker, shared_memory
+        self._shm = shared_memory.SharedMemory(name=self.name.lstrip("/"))
+        resource_tracker.unregister(self._shm._name, "shared_memory")
+        self._map = self._shm.buf
+
+    def close(self):
+        if self._shm is not None:
+            self._shm.close()
+            self._shm = None
+        elif self._map is not None:
+            self._map.close()
+        self._map = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    @property
+    def published(self) -> int:
+        """Frames published so far; the newest has frame_number published - 1."""
+        return SEQUENCE.unpack_from(self._map, PUBLISHED_OFFSET)[0]
+
+    def writer_alive(self) -> bool:
+        """False once the capture process that owns this segment is gone (reopen to follow
+        its successor)."""
+        try:
+            os.kill(self.writer_pid, 0)
+        except ProcessLookupError:
+            return False
+        except PermissionError:
+            pass
+        return True
+
+    def _slot_offset(self, frame_number: int) -> int:
+        return HEADER_BYTES + (frame_number % self.slot_count) * self.slot_bytes
+
+    def _sequence(self, frame_number: int) -> int:
+        return SEQUENCE.unpack_from(self._map, self._slot_offset(frame_number))[0]
+
+    def read(self, frame_number: int, copy: bool = False) -> Optional[SharedFrame]:
+        """
+        The frame with the given publish number.
+
+        Args:
+            frame_number: Position in the publish order
+            copy: Copy the pixels out of shared memory (safe to keep)
+
+        Returns:
+            The frame, or None if it was never published, was overwritten, or changed
+            while it was read
+        """
+        expected = 2 * (frame_number + 1)
+        offset = self._slot_offset(frame_number)
+        if self._sequence(frame_number) != expected:
+            return None
+
+        _, _, frame_index, timestamp_us, width, height, channels, region_count, \
+            motion_box_count, _ = SLOT_HEADER.unpack_from(self._map, offset)
+        if channels not in (1, 3, 4) or width * height * channels > self.max_pixel_bytes:
+            return None
+        boxes = REGIONS.unpack_from(self._map, offset + SLOT_HEADER.size)
+        regions = [tuple(boxes[4 * i:4 * i + 4]) for i in range(min(region_count, MAX_REGIONS))]
+
+        image = np.frombuffer(self._map, dtype=np.uint8, count=width * height * channels,
+                              offset=offset + SLOT_HEADER_BYTES)
+        image = image.reshape((height, width, channels) if channels > 1 else (height, width))
+        if copy:
+            image = image.copy()
+
+        frame = SharedFrame(
+            frame_number=frame_number,
+            frame_index=frame_index,
+            timestamp=datetime.fromtimestamp(timestamp_us / 1e6, timezone.utc),
+            image=image,
+            regions=regions,
+            motion_box_count=motion_box_count,
+        )
+        return frame if self._sequence(frame_number) == expected else None
+
+    def latest(self, copy: bool = False) -> Optional[SharedFrame]:
+        """The newest frame, or None before the first one (or if it is being replaced)."""
+        published = self.published
+        return self.read(published - 1, copy) if published else None
+
+    def is_current(self, frame: SharedFrame) -> bool:
+        """True while the slot still holds frame (a view of it has not been overwritten)."""
+        return self._sequence(frame.frame_number) == 2 * (frame.frame_number + 1)
+
+    def frames_since(self, last_frame_number: int, copy: bool = False) -> Iterator[SharedFrame]:
+        """Frames published after last_frame_number that are still in the ring, oldest first.
+        Pass -1 to start with the oldest frame held."""
+        published = self.published
+        for number in range(max(last_frame_number + 1, published - self.slot_count), published):
+            frame = self.read(number, copy)
+            if frame is not None:
+                yield frame
+
+    def wait_for_frame(self, last_frame_number: int, timeout: float = 1.0,
+                       poll_interval: float = 0.005) -> Optional[SharedFrame]:
+        """The newest frame once one newer than last_frame_number is published, polling until
+        the timeout."""
+        deadline = time.monotonic() + timeout
+        while True:
+            published = self.published
+            if published - 1 > last_frame_number:
+                frame = self.read(published - 1)
+                if frame is not None:
+                    return frame
+            if time.monotonic() >= deadline:
+                return None
+            time.sleep(poll_interval)
+
+
+def main():
+    """Print the frames as they are published (a quick check that the ring is alive)."""
+    name = sys.argv[1] if len(sys.argv) > 1 else DEFAULT_NAME
+    with SharedFrameReader(name) as reader:
+        print(f"📡 {name}: {reader.slot_count} slots, writer pid {reader.writer_pid}")
+        last = reader.published - 1
+        while reader.writer_alive():
+            frame = reader.wait_for_frame(last)
+            if frame is None:
+                continue
+            last = frame.frame_number
+            print(f"Frame {frame.frame_index} ({frame.image.shape[1]}x{frame.image.shape[0]}): "
+                  f"{len(frame.regions)} regions, {frame.motion_box_count} motion boxes")
+
+
+if __name__ == "__main__":
+    main()
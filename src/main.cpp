@@ -1,26 +1,71 @@
-#include <pybind11/embed.h>  // Python embedding
-#include <pybind11/numpy.h>  // NumPy array support
-#include <yaml-cpp/yaml.h>   // YAML::Node, YAML::LoadFile
+#include <yaml-cpp/yaml.h>  // YAML::Node (config sections)
 
+#include <algorithm>           // std::max
+#include <atomic>              // std::atomic for cross-thread stop flags
 #include <chrono>              // std::chrono for timing
+#include <csignal>             // std::signal, SIGINT/SIGTERM for service shutdown
 #include <ctime>               // std::time for timestamp
+#include <deque>               // std::deque (wake pre-roll)
 #include <filesystem>          // std::filesystem (fs::path, fs::create_directories)
 #include <iostream>            // std::cout, std::cerr, std::endl
+#include <memory>              // std::unique_ptr
 #include <opencv2/opencv.hpp>  // cv::Mat, cv::VideoCapture, cv::imshow, etc.
 #include <string>              // std::string
+#include <thread>              // std::thread for the capture stage
+#include <vector>              // std::vector for positional arguments
 
+#include "motion_detection/include/adaptive_detection_scale.hpp"  // AdaptiveDetectionScale (per-camera detection_scale)
+#include "motion_detection/include/box_capture.hpp"       // BoxCaptureWriter (recorded motion boxes)
+#include "motion_detection/include/capture_source.hpp"    // CaptureSource, CaptureConfig
+#include "motion_detection/include/latest_value_mailbox.hpp"  // Latest-frame-only capture handoff
+#include "motion_detection/include/config_watcher.hpp"    // ConfigWatcher (live config reload)
+#include "motion_detection/include/detection_event_publisher.hpp"  // DetectionEventPublisher (MQTT/ZeroMQ)
+#include "motion_detection/include/detection_log.hpp"     // DetectionLog (columnar per-frame log)
+#include "motion_detection/include/event_clip_recorder.hpp"  // EventClipRecorder (event clips)
+#include "motion_detection/include/flight_recorder.hpp"      // FlightRecorder (stages dumped on a trigger)
+#include "motion_detection/include/frame_arena.hpp"          // FrameArena (per-frame scratch)
+#include "motion_detection/include/frame_buffer_pool.hpp"    // FrameBufferPool (overlay canvases)
+#include "motion_detection/include/frame_metadata.hpp"       // FrameMetadata (saved-frame documents)
+#include "motion_detection/include/frame_trace.hpp"          // FrameTrace (per-frame stage timestamps)
+#include "motion_detection/include/gl_preview_window.hpp"    // GlPreviewWindow (OpenGL local window)
+#include "motion_detection/include/load_shedder.hpp"         // LoadShedder (frame skipping under overload)
 #include "motion_detection/include/logger.hpp"            // LOG_INFO, LOG_ERROR, LOG_DEBUG macros
+#include "motion_detection/include/io_reactor.hpp"        // IoReactor (coroutines for the network endpoints)
+#include "motion_detection/include/metrics_server.hpp"    // MetricsServer (/metrics endpoint)
 #include "motion_detection/include/motion_pipeline.hpp"   // Unified processing pipeline
 #include "motion_detection/include/motion_processor.hpp"  // MotionProcessor class
 #include "motion_detection/include/motion_region_consolidator.hpp"  // MotionRegionConsolidator class
-namespace py = pybind11;
+#include "motion_detection/include/motion_stats_aggregator.hpp"  // MotionStatsAggregator (per-minute stats)
+#include "motion_detection/include/passthrough_recorder.hpp"  // PassthroughRecorder (remuxed clips)
+#include "motion_detection/include/pipeline_config.hpp"   // PipelineConfig (parsed config snapshot)
+#include "motion_detection/include/pipeline_metrics.hpp"  // PipelineMetrics, PrometheusTextWriter
+#include "motion_detection/include/preview_server.hpp"    // PreviewServer (live MJPEG preview)
+#include "motion_detection/include/profile_scheduler.hpp"  // ProfileScheduler (processing_profiles: section)
+#include "motion_detection/include/profiler_zones.hpp"    // PROFILE_FRAME_MARK (profiling builds)
+#include "motion_detection/include/region_classifier.hpp"  // RegionClassifier (in-process YOLO)
+#include "motion_detection/include/save_deduplicator.hpp"  // SaveDeduplicator (skip unchanged saves)
+#include "motion_detection/include/shared_frame_ring.hpp"  // SharedFrameRing (frames for other processes)
+#include "motion_detection/include/simd_dispatch.hpp"      // simdLevel (motion mask kernel variant)
+#include "motion_detection/include/stage_timings.hpp"    // StageTimings, STAGE_TIMER
+#include "motion_detection/include/staged_pipeline.hpp"  // StagedPipeline, BackpressurePolicy
+#include "motion_detection/include/state_handoff.hpp"    // HandoffListener, HandoffClient (restart handoff)
+#include "motion_detection/include/stream_state.hpp"     // StreamState (what a restart hands over)
+#include "motion_detection/include/trace_recorder.hpp"   // TraceRecorder (Chrome trace of a time window)
+#include "motion_detection/include/visit_aggregator.hpp"  // VisitAggregator (one document per visit)
+#include "motion_detection/include/wake_trigger.hpp"      // WakeController (wake_trigger: section)
+#include "motion_detection/include/thread_placement.hpp"  // ThreadSettings, setupCurrentThread (threads: section)
+#include "motion_detection/include/thread_budget.hpp"     // ThreadBudget (thread_budget: section)
+#include "motion_detection/include/memory_placement.hpp"  // pinCurrentThread
+#include "frame_persistence_queue.hpp"  // FramePersistenceQueue, PersistJob
+#include "motion_detection/include/persistence_backend.hpp"  // PersistenceBackend (none, local, sqlite)
+#if BIRDS_HAVE_MONGO
+#include "motion_detection/include/frame_store.hpp"  // FrameStore ("native" backend)
+#endif
+#if BIRDS_HAVE_PYTHON
+#include "mongodb_functions.hpp"  // PythonPersistenceBackend ("python" backend)
+#endif
 namespace fs = std::filesystem;  // Shorthand for std::filesystem
 
-// Function declarations for Python bindings
-std::string save_frame_to_mongodb(const cv::Mat& frame, const std::string& metadata_json);
-std::string save_frames_to_mongodb(const cv::Mat& original_frame, const cv::Mat& processed_frame,
-                                   const std::string& metadata_json);
-
 // Colors for different tracked objects (cycled through based on object ID)
 const std::vector<cv::Scalar> COLORS = {
     cv::Scalar(0, 255, 0),    // Green
@@ -33,20 +78,339 @@ const std::vector<cv::Scalar> COLORS = {
 
 cv::Scalar getColor(int objectId) { return COLORS[objectId % COLORS.size()]; }
 
-// Function to save frame to MongoDB (declaration)
-std::string save_frame_to_mongodb(const cv::Mat& frame, const std::string& metadata_json);
+// Set by SIGINT/SIGTERM; the main loop polls it and shuts the pipeline down cleanly
+volatile std::sig_atomic_t shutdownRequested = 0;
+
+extern "C" void requestShutdown(int) { shutdownRequested = 1; }
+
+// Set by SIGHUP; the main loop hands it to the ConfigWatcher, which re-reads the config file
+volatile std::sig_atomic_t configReloadRequested = 0;
+
+extern "C" void requestConfigReload(int) { configReloadRequested = 1; }
+
+// Set by SIGUSR1; the main loop asks the consolidator to write its clustering trace
+volatile std::sig_atomic_t clusteringTraceDumpRequested = 0;
+
+extern "C" void requestClusteringTraceDump(int) { clusteringTraceDumpRequested = 1; }
+
+// Set by SIGUSR2; the main loop asks the flight recorder to write its ring
+volatile std::sig_atomic_t flightRecorderDumpRequested = 0;
+
+extern "C" void requestFlightRecorderDump(int) { flightRecorderDumpRequested = 1; }
+
+// Per-frame work item flowing through capture -> detect -> consolidate -> render
+struct FramePacket {
+    int frameIndex = 0;
+    FrameTrace trace;  // Capture time and the enter/exit stamps of every stage
+    cv::Mat frame;
+    MotionProcessor::ProcessingResult processingResult;
+    std::vector<ConsolidatedRegion> consolidatedRegions;
+    std::vector<int> objectIds;  // TrackedObjectStore ID of each detected box (detection log)
+    bool propagated = false;          // Boxes moved by optical flow instead of detected (flow_propagation:)
+    std::vector<cv::Point> flowShifts;  // Per box, when propagated: moves the last regions along
+    cv::Mat backgroundPlate;  // plate_patches: the background model's image, once per plate interval
+    bool wakeReset = false;   // wake_trigger: first frame after sleep, restart detection from the background
+    bool sleepAfter = false;  // wake_trigger: last frame before sleep, save the background model
+    cv::Mat displayFrame;
+};
+
+const char* const kWindowTitle = "🐦 Birds of Play - Motion Detection";
+const char* const kWindowLegend = "Gray: Individual Motion | Red: Consolidated Regions";
+
+std::string regionLabel(const ConsolidatedRegion& region, size_t index) {
+    std::string label = "Region:" + std::to_string(index) + " (" +
+                        std::to_string(region.trackedObjectIds.size()) + " objs)";
+    if (region.classId >= 0) {
+        label += " " + region.classLabel + " " +
+                 std::to_string(static_cast<int>(region.classConfidence * 100.0f)) + "%";
+    }
+    return label;
+}
+
+// Status line of the local window (the recording indicator goes above it)
+std::string windowStatus(const FramePacket& packet) {
+    return "Frame: " + std::to_string(packet.frameIndex) +
+           " | Motions: " + std::to_string(packet.processingResult.detectedBounds.size()) +
+           " | Regions: " + std::to_string(packet.consolidatedRegions.size());
+}
+
+// Draw individual motion detections (gray) and consolidated regions (red) onto an image;
+// @p scale maps frame coordinates onto a resized image (the live preview)
+void drawDetections(cv::Mat& image, const FramePacket& packet, double scale = 1.0) {
+    const auto toImage = [scale](const cv::Rect& rect) {
+        if (scale == 1.0) return rect;
+        return cv::Rect(cvRound(rect.x * scale), cvRound(rect.y * scale), std::max(1, cvRound(rect.width * scale)),
+                        std::max(1, cvRound(rect.height * scale)));
+    };
+    // Labels shrink with the image, but stay legible
+    const double textScale = std::max(scale, 0.6);
+
+    // Draw individual motion detections in gray (lower priority)
+    for (size_t i = 0; i < packet.processingResult.detectedBounds.size(); ++i) {
+        const cv::Rect bounds = toImage(packet.processingResult.detectedBounds[i]);
+        cv::Scalar color =
+            cv::Scalar(200, 200, 200);  // Light gray for individual motion detections (BGR format)
+        cv::rectangle(image, bounds, color, 1);
+
+        // Add motion detection label
+        std::string info = "M:" + std::to_string(i);
+        cv::putText(image, info, cv::Point(bounds.x, bounds.y - 5), cv::FONT_HERSHEY_SIMPLEX, 0.4 * textScale,
+                    color, 1);
+    }
+
+    // Draw consolidated regions in red (higher priority - drawn on top)
+    for (size_t i = 0; i < packet.consolidatedRegions.size(); ++i) {
+        const auto& region = packet.consolidatedRegions[i];
+        const cv::Rect box = toImage(region.boundingBox);
+        cv::Scalar regionColor = cv::Scalar(0, 0, 255);  // Red for consolidated regions
+        cv::rectangle(image, box, regionColor, scale < 1.0 ? 2 : 3);
+
+        cv::putText(image, regionLabel(region, i), cv::Point(box.x, box.y - static_cast<int>(30 * textScale)),
+                    cv::FONT_HERSHEY_SIMPLEX, 0.7 * textScale, regionColor, scale < 1.0 ? 1 : 2);
+    }
+}
+
+// Status line and legend of the local window, drawn on the CPU
+void drawWindowStatus(cv::Mat& image, const FramePacket& packet) {
+    cv::putText(image, windowStatus(packet), cv::Point(10, 60), cv::FONT_HERSHEY_SIMPLEX, 0.7,
+                cv::Scalar(255, 255, 255), 2);
+    cv::putText(image, kWindowLegend, cv::Point(10, image.rows - 20), cv::FONT_HERSHEY_SIMPLEX, 0.6,
+                cv::Scalar(255, 255, 255), 2);
+}
+
+// The local window's image composited on the CPU, for the OpenGL window's saves and demo
+// recording (the render stage skips it when the window draws with OpenGL)
+cv::Mat composeWindowFrame(const FramePacket& packet) {
+    cv::Mat image;
+    if (packet.frame.channels() == 1) {
+        cv::cvtColor(packet.frame, image, cv::COLOR_GRAY2BGR);
+    } else {
+        packet.frame.copyTo(image);
+    }
+    drawDetections(image, packet);
+    drawWindowStatus(image, packet);
+    return image;
+}
+
+// The same boxes and labels as drawDetections and drawWindowStatus, for GlPreviewWindow
+void buildWindowOverlay(const FramePacket& packet, PreviewOverlay& overlay) {
+    overlay.clear();
+    const cv::Scalar motionColor(200, 200, 200);
+    const cv::Scalar regionColor(0, 0, 255);
+    const cv::Scalar white(255, 255, 255);
+    const auto& detectedBounds = packet.processingResult.detectedBounds;
+    for (size_t i = 0; i < detectedBounds.size(); ++i) {
+        const cv::Rect& bounds = detectedBounds[i];
+        overlay.boxes.push_back({bounds, motionColor, 1});
+        overlay.texts.push_back({"M:" + std::to_string(i), cv::Point(bounds.x, bounds.y - 5), motionColor, 0.4, 1});
+    }
+    for (size_t i = 0; i < packet.consolidatedRegions.size(); ++i) {
+        const cv::Rect& box = packet.consolidatedRegions[i].boundingBox;
+        overlay.boxes.push_back({box, regionColor, 3});
+        overlay.texts.push_back(
+            {regionLabel(packet.consolidatedRegions[i], i), cv::Point(box.x, box.y - 30), regionColor, 0.7, 2});
+    }
+    overlay.texts.push_back({windowStatus(packet), cv::Point(10, 60), white, 0.7, 2});
+    overlay.texts.push_back({kWindowLegend, cv::Point(10, packet.frame.rows - 20), white, 0.6, 2});
+}
+
+// Metadata document with motion detection info and consolidated regions. With
+// includeAnnotations the individual motion boxes are listed too, for saves that do not
+// store an annotated frame.
+FrameMetadata buildFrameMetadata(const FramePacket& packet, bool includeAnnotations) {
+    const auto& detectedBounds = packet.processingResult.detectedBounds;
+    FrameMetadata metadata;
+    metadata.frameCount = packet.frameIndex;
+    metadata.timestamp = static_cast<int64_t>(std::time(nullptr));
+    metadata.motionDetected = !detectedBounds.empty();
+    metadata.motionRegions = static_cast<int>(detectedBounds.size());
+    metadata.confidence = detectedBounds.empty() ? 0.0 : 0.8;
+
+    // Called from the render stage: detect and consolidate are done, render is running
+    const FrameTrace& trace = packet.trace;
+    metadata.captureTimeUs = trace.captureUnixUs;
+    metadata.sourceTimestampMs = trace.sourceTimestampMs;
+    metadata.latency.detectQueuedMs = trace.waitMs(TraceStage::DETECT);
+    metadata.latency.detectMs = trace.runMs(TraceStage::DETECT);
+    metadata.latency.consolidateQueuedMs = trace.waitMs(TraceStage::CONSOLIDATE);
+    metadata.latency.consolidateMs = trace.runMs(TraceStage::CONSOLIDATE);
+    metadata.latency.renderQueuedMs = trace.waitMs(TraceStage::RENDER);
+    metadata.latency.totalMs = trace.sinceCaptureMs(std::chrono::steady_clock::now());
+
+    // Consolidated regions coordinates for YOLO11 processing
+    metadata.consolidatedRegions.reserve(packet.consolidatedRegions.size());
+    for (const auto& region : packet.consolidatedRegions) {
+        metadata.consolidatedRegions.push_back({region.boundingBox,
+                                                static_cast<int>(region.trackedObjectIds.size()),
+                                                region.classLabel, region.classConfidence,
+                                                region.classId, region.motion.speed(),
+                                                region.motion.direction()});
+    }
+
+    metadata.includeMotionBoxes = includeAnnotations;
+    if (includeAnnotations) metadata.motionBoxes = detectedBounds;
+
+    // motion_mask_rle: statistics always, the runs unless a noisy mask made them too long
+    // for a metadata document (a few birds take a few hundred characters)
+    const RleMask& mask = packet.processingResult.motionMask;
+    if (!mask.empty()) {
+        const RleMask::Stats stats = mask.stats();
+        MotionMaskMetadata& motionMask = metadata.motionMask;
+        motionMask.size = mask.size();
+        motionMask.frameArea = mask.frameArea();
+        motionMask.pixels = stats.area;
+        motionMask.bounds = mask.toFrame(stats.bounds);
+        motionMask.centroid = mask.toFrame(stats.centroid);
+        motionMask.counts = mask.encode();
+        constexpr size_t maxMaskCharacters = 4096;
+        if (motionMask.counts.size() > maxMaskCharacters) motionMask.counts.clear();
+    }
+    return metadata;
+}
+
+// Queue a region-crop save: the raw frame is shared with the worker, which crops and
+// encodes each consolidated region. A pending background plate (plate_patches) goes along
+void submitRegionCrops(FramePersistenceQueue& persistQueue, const FramePacket& packet, cv::Mat& pendingPlate) {
+    PersistJob job;
+    job.frameIndex = packet.frameIndex;
+    job.original = packet.frame;
+    job.background = std::move(pendingPlate);
+    pendingPlate = cv::Mat();
+    job.regions.reserve(packet.consolidatedRegions.size());
+    for (const auto& region : packet.consolidatedRegions) job.regions.push_back(region.boundingBox);
+    job.metadata = buildFrameMetadata(packet, true);
+    if (!persistQueue.submit(std::move(job))) {
+        LOG_WARN("Frame {} save dropped - persistence queue full", packet.frameIndex);
+    }
+}
+
+// Queue a visit document: the visit's best crops, with its times and path in the metadata
+bool submitVisit(FramePersistenceQueue& persistQueue, Visit visit) {
+    if (visit.crops.empty()) return false;
+    PersistJob job;
+    job.frameIndex = visit.crops.front().frameIndex;
+    job.original = visit.context;
+    job.frameSize = visit.frameSize;
+    FrameMetadata& metadata = job.metadata;
+    metadata.frameCount = job.frameIndex;
+    metadata.timestamp = visit.summary.startUs / 1000000;
+    metadata.motionDetected = true;
+    metadata.motionRegions = static_cast<int>(visit.crops.size());
+    metadata.confidence = 0.8;
+    for (VisitCrop& crop : visit.crops) {
+        job.regions.push_back(crop.region);
+        job.regionImageAreas.push_back(crop.region);
+        job.regionImages.push_back(std::move(crop.image));
+        metadata.consolidatedRegions.push_back(
+            {crop.region, 1, visit.classLabel, visit.classConfidence, visit.classId, 0.0f, 0.0f});
+    }
+    metadata.isVisit = true;
+    metadata.visit = std::move(visit.summary);
+    if (!persistQueue.submit(std::move(job))) {
+        LOG_WARN("Visit of frame {} dropped - persistence queue full", metadata.frameCount);
+        return false;
+    }
+    return true;
+}
+
+// Log queue depth, throughput and drop counters for every stage of a pipeline
+template <typename Packet>
+void logPipelineStats(const std::string& pipelineName, const StagedPipeline<Packet>& pipeline) {
+    for (const auto& stage : pipeline.getStats()) {
+        LOG_INFO("{} stage '{}': queue {}/{} (peak {}) | processed {} | filtered {} | dropped {}",
+                 pipelineName, stage.name, stage.queueDepth, stage.queueCapacity,
+                 stage.queueHighWatermark, stage.processed, stage.filtered, stage.dropped);
+    }
+}
+
+// Latency percentiles of every stage that recorded samples (ENABLE_STAGE_TIMING builds)
+void logStageTimings(const std::string& componentName, const StageTimings& timings) {
+    for (size_t i = 0; i < StageTimings::kStageCount; ++i) {
+        const auto stage = static_cast<PipelineStage>(i);
+        const StageTimings::Summary summary = timings.summary(stage);
+        if (summary.count == 0) continue;
+        LOG_INFO("{} stage '{}': {} samples | mean {:.1f}us | p50 {:.1f}us | p95 {:.1f}us | "
+                 "p99 {:.1f}us | max {:.1f}us",
+                 componentName, pipelineStageName(stage), summary.count, summary.meanMicros,
+                 summary.p50Micros, summary.p95Micros, summary.p99Micros, summary.maxMicros);
+    }
+}
+
+// Per-stage latency histograms of one component as a "birds_stage_latency_seconds" family
+void writeStageTimings(PrometheusTextWriter& writer, const std::string& componentName,
+                       const StageTimings& timings) {
+    for (size_t i = 0; i < StageTimings::kStageCount; ++i) {
+        const auto stage = static_cast<PipelineStage>(i);
+        const StageLatencyHistogram& histogram = timings.histogram(stage);
+        if (histogram.count() == 0) continue;
+        writer.histogramSamples("birds_stage_latency_seconds", histogram,
+                                {{"component", componentName}, {"stage", pipelineStageName(stage)}});
+    }
+}
+
+void logPersistenceStats(const FramePersistenceQueue& queue) {
+    PersistenceStats stats = queue.getStats();
+    LOG_INFO("Persistence: queue {}/{} | submitted {} | saved {} | failed {} | dropped {} | "
+             "batches {} | minute summaries {} | background plates {} | atlas sheets {}",
+             stats.queueDepth, stats.queueCapacity, stats.submitted, stats.saved, stats.failed,
+             stats.dropped, stats.batches, stats.summariesWritten, stats.platesWritten, stats.atlasSheets);
+    LOG_INFO("Persistence latency: encode {} | insert {} | end-to-end {}",
+             queue.encodeLatency().summary(), queue.insertLatency().summary(),
+             queue.endToEndLatency().summary());
+}
+
+// Unix microseconds, the capture timestamps of the shared frame ring and the detection logs
+int64_t unixMicrosNow() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+// <directory>/boxes_<yyyymmdd_hhmmss>.bobx; null (logged) if it cannot be created
+std::unique_ptr<BoxCaptureWriter> openBoxCapture(const std::string& directory,
+                                                 const cv::Size& frameSize) {
+    const std::time_t now = std::time(nullptr);
+    char name[48];
+    std::strftime(name, sizeof(name), "boxes_%Y%m%d_%H%M%S.bobx", std::localtime(&now));
+    try {
+        fs::create_directories(directory);
+        auto writer = std::make_unique<BoxCaptureWriter>((fs::path(directory) / name).string(), frameSize);
+        LOG_INFO("Recording motion boxes to {}", writer->path());
+        return writer;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Box capture disabled: {}", e.what());
+        return nullptr;
+    }
+}
 
 int main(int argc, char** argv) {
-    // Initialize Python interpreter for MongoDB integration
-    py::scoped_interpreter guard{};
+    // Both signals stop the pipeline gracefully
+    std::signal(SIGINT, requestShutdown);
+    std::signal(SIGTERM, requestShutdown);
+    std::signal(SIGHUP, requestConfigReload);
+    std::signal(SIGUSR1, requestClusteringTraceDump);
+    std::signal(SIGUSR2, requestFlightRecorderDump);
 
     // Parse command line arguments
-    fs::path config_path = (argc > 1) ? argv[1] : "motion_detection/config.yaml";
-    std::string video_source = (argc > 2) ? argv[2] : "";  // Video file path (empty = use webcam)
+    bool headlessFlag = false;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--headless") {
+            headlessFlag = true;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    fs::path config_path = !positional.empty() ? positional[0] : "motion_detection/config.yaml";
+    // Video file path (empty = use webcam)
+    std::string video_source = positional.size() > 1 ? positional[1] : "";
 
     if (!fs::exists(config_path)) {
         std::cerr << "Error: Configuration file not found: " << config_path << std::endl;
-        std::cerr << "Usage: " << argv[0] << " [config_path] [video_path]" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " [--headless] [config_path] [video_path]"
+                  << std::endl;
+        std::cerr << "  --headless:  Run as a service: no window, no demo recording" << std::endl;
         std::cerr << "  config_path: Path to YAML configuration file (default: "
                      "motion_detection/config.yaml)"
                   << std::endl;
@@ -63,95 +427,200 @@ int main(int argc, char** argv) {
         std::cout << "📹 Using webcam" << std::endl;
     }
 
-    YAML::Node config = YAML::LoadFile(config_path.string());
+    // Parsed and validated once; every consumer below reads this snapshot
+    std::shared_ptr<const PipelineConfig> pipelineConfig;
+    try {
+        pipelineConfig = PipelineConfig::load(config_path.string());
+    } catch (const std::invalid_argument& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return -1;
+    }
+    const YAML::Node& config = pipelineConfig->document();
+    // Live settings: a reload publishes a new snapshot here, and the detect and consolidate
+    // stages adopt it between two frames
+    SharedPipelineConfig sharedConfig(pipelineConfig);
 
     // Initialize logger first
-    std::string logLevel =
-        config["logging"]["log_level"] ? config["logging"]["log_level"].as<std::string>() : "info";
-    bool logToFile =
-        config["logging"]["log_to_file"] ? config["logging"]["log_to_file"].as<bool>() : false;
-    std::string logFilePath = config["logging"]["log_file_path"]
-                                  ? config["logging"]["log_file_path"].as<std::string>()
-                                  : "birdsofplay.log";
+    const LoggingSettings& logging = pipelineConfig->logging;
+    const std::string& logFilePath = logging.filePath;
 
     // Ensure log directory exists (e.g., "logs/")
     fs::path logDir = fs::path(logFilePath).parent_path();
     if (!logDir.empty()) {
         fs::create_directories(logDir);
     }
-    Logger::init(logLevel, logFilePath, logToFile);
+    // Thread budget (thread_budget: section): cores for the detect, consolidate and render
+    // stages, the persistence worker and classification (which runs in the consolidate
+    // stage), and OpenCV's own pool sized so the two layers do not oversubscribe the cores
+    const YAML::Node classifierSection = config["region_classifier"];
+    const bool classifying =
+        classifierSection && classifierSection["enabled"] && classifierSection["enabled"].as<bool>();
+    const ThreadBudget threadBudget = ThreadBudget::plan(pipelineConfig->threadBudget, 3 /* stages */, allowedCpus());
+    // OpenCV's pool threads take the affinity of the thread that creates them
+    if (threadBudget.pin) pinCurrentThread(threadBudget.computeCpus);
+    applyOpenCvThreads(threadBudget);
+    // Thread placement (threads: section): roles name the thread and carry its policy; with
+    // thread_budget.pin, roles left unpinned there are pinned to their budget partition
+    const ThreadSettings threadSettings = threadBudget.placement(
+        pipelineConfig->threads,
+        {{"capture", ThreadPartition::Compute},
+         {"detect", ThreadPartition::Compute},
+         {"consolidate", classifying ? ThreadPartition::Classification : ThreadPartition::Compute},
+         {"render", ThreadPartition::Compute},
+         {"persist", ThreadPartition::Persistence},
+         {"log", ThreadPartition::Persistence}});
+    Logger::AsyncOptions logAsync = logging.async;
+    logAsync.onThreadStart = [&threadSettings] { setupCurrentThread(threadSettings, "log"); };
+    Logger::init(logging.level, logFilePath, logging.toFile, logAsync);
+    if (logging.diagnosticLinesPerSecond >= 0.0) Logger::setDiagnosticRate(logging.diagnosticLinesPerSecond);
     LOG_INFO("Birds of Play Motion Detection Demo - Logger initialized at {}", logFilePath);
+    LOG_INFO("Thread budget: {}", threadBudget.describe());
 
     // Read MongoDB configuration
-    bool saveOnlyConsolidatedRegions = config["save_only_consolidated_regions"]
-                                           ? config["save_only_consolidated_regions"].as<bool>()
-                                           : false;
+    const bool saveOnlyConsolidatedRegions = pipelineConfig->saveOnlyConsolidatedRegions;
     LOG_INFO("MongoDB save mode: {} frames",
              saveOnlyConsolidatedRegions ? "consolidated regions only" : "all motion frames");
 
+    // Headless service mode: no window, no demo recording, overlays only on saved frames
+    const bool headless = headlessFlag || pipelineConfig->headless;
+    LOG_INFO("Run mode: {}", headless ? "headless service" : "interactive display");
+
+    // Local window drawn with OpenGL (frame uploaded as a texture, overlay drawn by the GPU)
+    // when this build and OpenCV support it; opened here, on the GUI thread
+    GlPreviewWindow glWindow(kWindowTitle);
+    const std::string windowRenderer =
+        config["window_renderer"] ? config["window_renderer"].as<std::string>() : "opengl";
+    if (windowRenderer != "opengl" && windowRenderer != "cpu") {
+        LOG_WARN("Unknown window_renderer '{}', drawing the window on the CPU", windowRenderer);
+    }
+    const bool glWindowOpen = !headless && windowRenderer == "opengl" && glWindow.open();
+    PreviewOverlay windowOverlay;  // Rebuilt for every displayed frame
+    LOG_INFO("Motion mask kernels: {}", simdLevelName(simdLevel()));
+
     // Initialize motion processor and motion region consolidator
-    MotionProcessor motionProcessor(config_path.string());
+    MotionProcessor motionProcessor(pipelineConfig);
     motionProcessor.setVisualizationPath("");  // Disable visualization file saving
+    // The live loop only consumes detections; skip retaining intermediate stage images
+    motionProcessor.setRetainedStages(MotionProcessor::STAGE_NONE);
 
     // Configure DBSCAN region consolidation
-    ConsolidationConfig consolidationConfig;
-    consolidationConfig.eps = config["eps"] ? config["eps"].as<double>() : 50.0;
-    consolidationConfig.minPts = config["min_pts"] ? config["min_pts"].as<int>() : 2;
-    consolidationConfig.overlapWeight =
-        config["overlap_weight"] ? config["overlap_weight"].as<double>() : 0.7;
-    consolidationConfig.edgeWeight =
-        config["edge_weight"] ? config["edge_weight"].as<double>() : 0.3;
-    consolidationConfig.maxEdgeDistance =
-        config["max_edge_distance"] ? config["max_edge_distance"].as<double>() : 100.0;
-    consolidationConfig.maxFramesWithoutUpdate =
-        config["max_frames_without_update"] ? config["max_frames_without_update"].as<int>() : 10;
-    consolidationConfig.regionExpansionFactor =
-        config["region_expansion_factor"] ? config["region_expansion_factor"].as<double>() : 1.1;
+    ConsolidationConfig consolidationConfig = pipelineConfig->consolidation;
 
     // Set frame size (will be updated when we know the actual video dimensions)
     consolidationConfig.frameSize = cv::Size(1920, 1080);  // Default, will be updated from video
 
     MotionRegionConsolidator regionConsolidator(consolidationConfig);
+
+    // Track boxes across frames so regions see persistent object IDs
+    const bool trackerEnabled = pipelineConfig->trackerEnabled;
+    ObjectTracker objectTracker(pipelineConfig->tracker);
     LOG_INFO(
         "DBSCAN region consolidation configured: eps={}, minPts={}, overlapWeight={}, "
         "edgeWeight={}",
-        consolidationConfig.eps, consolidationConfig.minPts, consolidationConfig.overlapWeight,
+        regionConsolidator.getConfig().eps, consolidationConfig.minPts, consolidationConfig.overlapWeight,
         consolidationConfig.edgeWeight);
 
-    // Initialize video source (camera or video file)
-    cv::VideoCapture cap;
-    if (!video_source.empty()) {
-        // Use video file
-        cap.open(video_source);
-        if (!cap.isOpened()) {
-            LOG_CRITICAL("Error: Could not open video file: " + video_source);
-            std::cerr << "Error: Could not open video file: " << video_source << std::endl;
-            return -1;
+    // Zero-downtime restart (handoff:): a new instance asks the running one for its stream
+    // before opening the capture device. That one stops between two frames, releases the
+    // device and sends the background model, adaptive thresholds, regions and tracks, then
+    // saves what it had queued while this one already detects; this persistence worker waits
+    // for that before its first write, so the storage only ever has one writer.
+    const HandoffConfig& handoffConfig = pipelineConfig->handoff;
+    HandoffClient handoffClient;
+    if (handoffConfig.enabled && handoffClient.connect(handoffConfig.socketPath, motionProcessor.getCameraId())) {
+        LOG_INFO("Handoff: taking over from the instance running on {}", handoffConfig.socketPath);
+        std::vector<unsigned char> handedOver;
+        StreamState handoffState;
+        if (handoffClient.receiveState(handedOver, handoffConfig.stateTimeout) &&
+            decodeStreamState(handedOver, handoffState)) {
+            restoreStreamState(handoffState, motionProcessor, &regionConsolidator,
+                               trackerEnabled ? &objectTracker : nullptr);
+        } else {
+            LOG_WARN("Handoff: no usable state from the running instance; starting cold");
         }
-        LOG_INFO("📹 Opened video file: " + video_source);
+    }
+    HandoffListener handoffListener(handoffConfig.socketPath, motionProcessor.getCameraId());
+
+    // Initialize video source (camera, video file or RTSP stream)
+    CaptureConfig captureConfig;
+    const YAML::Node captureNode = config["capture"];
+    if (captureNode) {
+        if (captureNode["backend"])
+            captureConfig.backend = parseCaptureBackend(captureNode["backend"].as<std::string>());
+        if (captureNode["source"]) captureConfig.source = captureNode["source"].as<std::string>();
+        if (captureNode["width"]) captureConfig.width = captureNode["width"].as<int>();
+        if (captureNode["height"]) captureConfig.height = captureNode["height"].as<int>();
+        if (captureNode["fps"]) captureConfig.fps = captureNode["fps"].as<double>();
+        if (captureNode["hardware_decode"])
+            captureConfig.hardwareDecode =
+                parseHardwareDecode(captureNode["hardware_decode"].as<std::string>());
+        if (captureNode["codec"]) captureConfig.codec = captureNode["codec"].as<std::string>();
+        if (captureNode["rtsp_latency_ms"])
+            captureConfig.rtspLatencyMs = captureNode["rtsp_latency_ms"].as<int>();
+        if (captureNode["gstreamer_pipeline"])
+            captureConfig.gstreamerPipeline = captureNode["gstreamer_pipeline"].as<std::string>();
+        if (captureNode["device_buffers"])
+            captureConfig.deviceBuffers = captureNode["device_buffers"].as<int>();
+        if (captureNode["luma_only"]) captureConfig.lumaOnly = captureNode["luma_only"].as<bool>();
+        if (captureNode["buffer_pool_size"])
+            captureConfig.poolSize = captureNode["buffer_pool_size"].as<size_t>();
+        if (captureNode["huge_pages"]) captureConfig.memory.hugePages = captureNode["huge_pages"].as<bool>();
+        if (captureNode["numa_node"]) captureConfig.memory.numaNode = captureNode["numa_node"].as<int>();
+        if (captureNode["vector_min_motion"])
+            captureConfig.vectorMinMotion = captureNode["vector_min_motion"].as<double>();
+        if (captureNode["vector_min_blocks"])
+            captureConfig.vectorMinBlocks = captureNode["vector_min_blocks"].as<int>();
+        if (captureNode["vector_intra_as_motion"])
+            captureConfig.vectorIntraAsMotion = captureNode["vector_intra_as_motion"].as<bool>();
+        if (captureNode["vector_refresh_frames"])
+            captureConfig.vectorRefreshFrames = captureNode["vector_refresh_frames"].as<int>();
+        if (captureNode["decode_threads"])
+            captureConfig.decodeThreads = captureNode["decode_threads"].as<int>();
+        if (captureNode["decode_lookahead"])
+            captureConfig.decodeLookahead = captureNode["decode_lookahead"].as<size_t>();
+    }
+    // The processor's working buffers follow the capture buffers
+    motionProcessor.setBufferAllocator(PlacedMatAllocator::forPlacement(captureConfig.memory));
+    if (!video_source.empty()) captureConfig.source = video_source;  // Command line wins
+    // Luma frames are only consumed as is by the single-channel modes on BGR-layout input
+    const auto processingMode = motionProcessor.getProcessingMode();
+    if (captureConfig.lumaOnly &&
+        ((processingMode != MotionProcessor::ProcessingMode::GRAYSCALE &&
+          processingMode != MotionProcessor::ProcessingMode::YCRCB) ||
+         motionProcessor.getInputFormat() != MotionProcessor::InputFormat::BGR)) {
+        LOG_WARN("capture.luma_only needs grayscale/ycrcb processing of bgr input; capturing BGR");
+        captureConfig.lumaOnly = false;
+    }
+
+    CaptureSource cap(captureConfig);
+    if (!cap.open()) {
+        LOG_CRITICAL("Error: Could not open video source: " + captureConfig.source);
+        std::cerr << "Error: Could not open video source"
+                  << (captureConfig.source.empty() ? " (webcam)" : ": " + captureConfig.source)
+                  << std::endl;
+        return -1;
+    }
+    // A file configured under capture.source is replayed like a video argument
+    if (!cap.isLive()) video_source = captureConfig.source;
+    if (!captureConfig.source.empty()) {
+        LOG_INFO("📹 Opened video source: " + captureConfig.source);
     } else {
-        // Use webcam
-        cap.open(0);
-        if (!cap.isOpened()) {
-            LOG_CRITICAL("Error: Could not open camera.");
-            std::cerr << "Error: Could not open camera. Please check if your webcam is connected."
-                      << std::endl;
-            return -1;
-        }
         LOG_INFO("📹 Opened webcam");
     }
 
-    // Update frame size in consolidation config based on actual video dimensions
-    cv::Mat testFrame;
-    cap >> testFrame;
-    if (!testFrame.empty()) {
-        consolidationConfig.frameSize = testFrame.size();
+    // Learn the stream geometry without seeking: from the stream metadata when the backend
+    // reports it, otherwise from the first frame, which stays queued for the capture stage
+    const CaptureSource::StreamInfo streamInfo = cap.probe();
+    if (streamInfo.frameSize.area() > 0) {
+        consolidationConfig.frameSize = streamInfo.frameSize;
         regionConsolidator.updateConfig(consolidationConfig);
-        LOG_INFO("Updated consolidation frame size to: {}x{}", consolidationConfig.frameSize.width,
-                 consolidationConfig.frameSize.height);
+        LOG_INFO("Updated consolidation frame size to: {}x{} (from {})",
+                 consolidationConfig.frameSize.width, consolidationConfig.frameSize.height,
+                 streamInfo.fromMetadata ? "stream metadata" : "first frame");
     }
-    // Reset video position to beginning
-    cap.set(cv::CAP_PROP_POS_FRAMES, 0);
+    // Seed the background model, reference frame and working buffers with the first frame
+    // (still delivered to the pipeline), so the first processed frame already detects motion
+    motionProcessor.warmUp(cap.peek());
 
     LOG_INFO("🐦 Birds of Play Motion Detection System initialized successfully!");
     if (!video_source.empty()) {
@@ -159,295 +628,1544 @@ int main(int argc, char** argv) {
     } else {
         LOG_INFO("📹 Using webcam for live motion detection and region consolidation");
     }
-    LOG_INFO("⌨️  Press 'q' or ESC to quit, 's' to save current frame");
+    if (headless) {
+        LOG_INFO("Send SIGINT or SIGTERM to stop");
+    } else {
+        LOG_INFO("⌨️  Press 'q' or ESC to quit, 's' to save current frame");
 
-    std::cout << "\n🐦 Birds of Play - Live Motion Detection Demo" << std::endl;
-    std::cout << "📹 Camera initialized successfully!" << std::endl;
-    std::cout << "⌨️  Controls:" << std::endl;
-    std::cout << "   'q' or ESC - Quit application" << std::endl;
-    std::cout << "   's' - Save current frame with detections" << std::endl;
-    std::cout << "\n🔍 Watch for:" << std::endl;
-    std::cout << "   🟢 Green/Blue/Red boxes - Individual motion detections" << std::endl;
-    std::cout << "   ⬜ White boxes - Consolidated motion regions" << std::endl;
-    std::cout << "\nStarting live detection..." << std::endl;
+        std::cout << "\n🐦 Birds of Play - Live Motion Detection Demo" << std::endl;
+        std::cout << "📹 Camera initialized successfully!" << std::endl;
+        std::cout << "⌨️  Controls:" << std::endl;
+        std::cout << "   'q' or ESC - Quit application" << std::endl;
+        std::cout << "   's' - Save current frame with detections" << std::endl;
+        std::cout << "\n🔍 Watch for:" << std::endl;
+        std::cout << "   🟢 Green/Blue/Red boxes - Individual motion detections" << std::endl;
+        std::cout << "   ⬜ White boxes - Consolidated motion regions" << std::endl;
+        std::cout << "\nStarting live detection..." << std::endl;
+    }
+
+    // ===============================
+    // STAGED PIPELINE CONFIGURATION
+    // ===============================
+    // Capture, detection, consolidation and rendering each run on their own thread,
+    // connected by bounded queues; persistence runs on a separate worker so a slow
+    // MongoDB save never stalls capture. Live cameras shed the oldest frames by default,
+    // video files block so that no frame is skipped.
+    const YAML::Node pipelineNode = config["pipeline"];
+    size_t queueCapacity = pipelineNode && pipelineNode["queue_capacity"]
+                               ? pipelineNode["queue_capacity"].as<size_t>()
+                               : 4;
+    BackpressurePolicy backpressure =
+        cap.isLive() ? BackpressurePolicy::DropOldest : BackpressurePolicy::Block;
+    if (pipelineNode && pipelineNode["backpressure"]) {
+        backpressure = parseBackpressurePolicy(pipelineNode["backpressure"].as<std::string>());
+    }
+    int statsIntervalFrames = pipelineNode && pipelineNode["stats_interval_frames"]
+                                  ? pipelineNode["stats_interval_frames"].as<int>()
+                                  : 300;
+    LOG_INFO("Staged pipeline: queue capacity {}, backpressure {}", queueCapacity,
+             backpressurePolicyName(backpressure));
+
+    // Latest-frame-only capture (capture.latest_frame_only): the capture thread keeps reading
+    // so the driver and decoder buffers never fill up, and the detect stage takes the newest
+    // frame whenever it is free; what it never got to is counted, not queued
+    bool latestFrameOnly = captureNode && captureNode["latest_frame_only"] &&
+                           captureNode["latest_frame_only"].as<bool>();
+    if (latestFrameOnly && !cap.isLive()) {
+        LOG_WARN("capture.latest_frame_only only applies to live sources; every frame of the file is processed");
+        latestFrameOnly = false;
+    }
+    LatestValueMailbox<FramePacket> latestFrame;
+    if (latestFrameOnly) LOG_INFO("Latest-frame-only capture: stale frames are skipped, not queued");
+
+    // Adaptive load shedding: when the slowest stage needs more than the frame interval, a
+    // quiet stream is processed at every k-th frame (and finally at a lower detection_scale)
+    // instead of falling further behind; frames with consolidated regions restore full rate
+    LoadSheddingConfig sheddingConfig = pipelineConfig->loadShedding;
+    sheddingConfig.frameIntervalMs = 1000.0 / (streamInfo.fps > 0 ? streamInfo.fps : 30.0);
+    // One stream; its stages run in parallel, so the budget is one frame interval
+    LoadShedder loadShedder(sheddingConfig);
+    const size_t shedStream = loadShedder.addStream();
+    if (sheddingConfig.enabled) {
+        LOG_INFO("Load shedding: frame budget {:.1f} ms, up to every {} frame(s) at {:.2f}x detection "
+                 "scale for quiet streams",
+                 sheddingConfig.frameIntervalMs, sheddingConfig.maxStride, sheddingConfig.minScaleFactor);
+    }
+
+    // Adaptive detection scale (adaptive_scale:): the coarsest detection_scale at which the
+    // small birds this camera sees stay large enough to detect, instead of the configured one
+    const AdaptiveScaleConfig& adaptiveScaleConfig = pipelineConfig->adaptiveScale;
+    // Only the detect stage touches it; the metrics page reads detectionScaleInUse
+    AdaptiveDetectionScale adaptiveScale(adaptiveScaleConfig, motionProcessor.getDetectionScale());
+    std::atomic<double> detectionScaleInUse{motionProcessor.getDetectionScale()};
+    if (adaptiveScaleConfig.enabled) {
+        LOG_INFO("Adaptive detection scale: {:.0f}th percentile bird kept at {:.0f}+ px, scale within [{:.2f}, {:.2f}]",
+                 adaptiveScaleConfig.percentile * 100.0, adaptiveScaleConfig.minObjectPixels,
+                 adaptiveScale.config().minScale, adaptiveScale.config().maxScale);
+    }
+
+    // Processing profiles (processing_profiles:): the time of day (clock or sunrise/sunset) and
+    // recent activity pick a profile; its overrides go live through sharedConfig like a config
+    // reload, its max_fps caps the frames capture hands on, and it can switch inference off
+    std::unique_ptr<ProfileScheduler> profileScheduler;
+    try {
+        ProfileScheduleConfig scheduleConfig = ProfileScheduleConfig::parse(config["processing_profiles"]);
+        if (scheduleConfig.enabled) profileScheduler = std::make_unique<ProfileScheduler>(std::move(scheduleConfig));
+    } catch (const std::invalid_argument& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return -1;
+    }
+    std::atomic<bool> inferenceEnabled{true};
+    const auto applyProfile = [&sharedConfig, &inferenceEnabled](const ProcessingProfile* profile) {
+        if (!sharedConfig.setOverrides(profile ? profile->overrides : YAML::Node())) return;
+        inferenceEnabled.store(!profile || profile->inference, std::memory_order_relaxed);
+        LOG_INFO("Processing profile: {} (max {} fps, inference {})", profile ? profile->name : "config file",
+                 profile && profile->maxFps > 0 ? std::to_string(profile->maxFps) : "unlimited",
+                 !profile || profile->inference ? "on" : "off");
+    };
+    if (profileScheduler && profileScheduler->update(std::time(nullptr))) applyProfile(profileScheduler->current());
+
+    // Wake trigger (wake_trigger:): battery units capture at sleep_fps and process nothing until
+    // a PIR line or the block gate fires, then run at full rate, pre-roll first, until
+    // awake_hold_s pass without a trigger or a region
+    const WakeTriggerConfig& wakeConfig = pipelineConfig->wakeTrigger;
+    std::unique_ptr<WakeController> wakeController;
+    if (wakeConfig.enabled) {
+        wakeController = std::make_unique<WakeController>(wakeConfig);
+        LOG_INFO("Wake trigger: {} at {:.2f} fps asleep, awake for {:.0f} s after activity, {} pre-roll frame(s)",
+                 wakeSourceName(wakeConfig.source), wakeConfig.sleepFps, wakeConfig.awakeHoldSeconds,
+                 wakeConfig.preRollFrames);
+    }
 
-    cv::Mat frame;
-    char key = 0;
-    int frameCount = 0;
-    auto lastSaveTime = std::chrono::steady_clock::now();
     const auto saveInterval = std::chrono::seconds(1);  // Save every 1 second
-    
-    // Video recording setup for demo visualization
-    cv::VideoWriter videoWriter;
-    bool recordingStarted = false;  // Track if we've ever started recording
-    bool recordingActive = false;    // Track if currently writing frames
-    bool recordingComplete = false;
-    int maxRecordingFrames = 450;  // 15 seconds at 30fps (shorter for quick demo)
-    int recordedFrames = 0;
-    std::string outputVideoPath = "public/videos/demo.mp4";
-    
-    // Ensure output directory exists
-    fs::path outputDir = fs::path(outputVideoPath).parent_path();
-    if (!outputDir.empty()) {
-        fs::create_directories(outputDir);
+    auto lastSaveTime = std::chrono::steady_clock::now();  // Only touched by the render stage
+
+    // Persistence backend: "python" goes through the embedded FrameDatabaseV2 (a single
+    // session reused for every save); "native" writes the same documents with mongocxx and
+    // never touches the GIL; "sqlite" and "local" (JSON lines in segment files) need no
+    // server; "uplink" streams documents and region crops to a central aggregator; "none"
+    // keeps only the images. Builds without Python or Mongo (ENABLE_PYTHON, ENABLE_MONGO)
+    // lack those backends and default to "local".
+#if BIRDS_HAVE_PYTHON
+    const std::string defaultBackend = "python";
+#else
+    const std::string defaultBackend = "local";
+#endif
+    std::string persistenceBackend =
+        config["persistence_backend"] ? config["persistence_backend"].as<std::string>() : defaultBackend;
+    std::unique_ptr<PersistenceBackend> persistenceStore;
+    if (persistenceBackend == "python") {
+#if BIRDS_HAVE_PYTHON
+        // The embedded interpreter only serves this backend, and starts on its own thread
+        // in connect(): with any other backend the capture process runs no Python at all,
+        // and Python consumers read frames from the shared frame ring instead
+        persistenceStore = std::make_unique<PythonPersistenceBackend>();
+#else
+        LOG_ERROR("persistence_backend \"python\" needs a build with ENABLE_PYTHON");
+        return -1;
+#endif
+    } else if (persistenceBackend == "native") {
+#if BIRDS_HAVE_MONGO
+        FrameStoreConfig storeConfig;
+        if (config["mongodb_uri"]) storeConfig.uri = config["mongodb_uri"].as<std::string>();
+        if (config["database_name"]) {
+            storeConfig.databaseName = config["database_name"].as<std::string>();
+        }
+        if (config["frame_time_series"]) storeConfig.timeSeries = config["frame_time_series"].as<bool>();
+        if (config["frame_retention_days"]) storeConfig.retentionDays = config["frame_retention_days"].as<int>();
+        persistenceStore = std::make_unique<FrameStore>(storeConfig);
+#else
+        LOG_ERROR("persistence_backend \"native\" needs a build with ENABLE_MONGO");
+        return -1;
+#endif
+    } else {
+        PersistenceBackendConfig backendConfig;
+        backendConfig.name = persistenceBackend;
+        if (const YAML::Node storeNode = config["persistence_store"]) {
+            if (storeNode["local_path"]) backendConfig.localPath = storeNode["local_path"].as<std::string>();
+            if (storeNode["local_segment_mb"]) {
+                backendConfig.localSegmentBytes = storeNode["local_segment_mb"].as<uint64_t>() << 20;
+            }
+            if (storeNode["sqlite_path"]) backendConfig.sqlitePath = storeNode["sqlite_path"].as<std::string>();
+            if (storeNode["uplink_endpoint"]) {
+                backendConfig.uplinkEndpoint = storeNode["uplink_endpoint"].as<std::string>();
+            }
+            if (storeNode["uplink_site"]) backendConfig.uplinkSite = storeNode["uplink_site"].as<std::string>();
+            if (storeNode["uplink_spool_path"]) {
+                backendConfig.uplinkSpoolPath = storeNode["uplink_spool_path"].as<std::string>();
+            }
+            if (storeNode["uplink_window_kb"]) {
+                backendConfig.uplinkWindowBytes = storeNode["uplink_window_kb"].as<size_t>() << 10;
+            }
+        }
+        try {
+            persistenceStore = makePersistenceBackend(backendConfig);
+        } catch (const std::invalid_argument& e) {
+            LOG_ERROR("{}", e.what());
+            return -1;
+        }
     }
+    if (!persistenceStore->connect()) {
+        LOG_WARN("Persistence backend {} unavailable at startup; saves will retry the connection",
+                 persistenceStore->name());
+    }
+    FramePersistenceQueue::InsertFunction insertBatch =
+        [&persistenceStore](const std::vector<StoredFrameRecord>& records) {
+            return persistenceStore->insertRecords(records);
+        };
+    LOG_INFO("Frame persistence backend: {}", persistenceBackend);
 
-    while (key != 'q' && key != 27) {  // Loop until 'q' or ESC is pressed
-        cap >> frame;
-        if (frame.empty()) {
-            std::cerr << "Error: Could not read frame from camera." << std::endl;
-            break;
+    // Persistence worker: images are encoded off the GIL and documents arriving within the
+    // batch window share one insert.
+    PersistenceConfig persistenceConfig;
+    persistenceConfig.onWorkerStart = [&threadSettings, &handoffClient, &handoffConfig] {
+        setupCurrentThread(threadSettings, "persist");
+        // Taking over: the previous instance is still saving its queue; ours fills meanwhile
+        if (handoffClient.isConnected()) handoffClient.waitReleased(handoffConfig.releaseTimeout);
+    };
+    persistenceConfig.queueCapacity = queueCapacity;
+    persistenceConfig.backpressure = backpressure;
+    if (pipelineNode && pipelineNode["persist_batch_window_ms"]) {
+        persistenceConfig.batchWindow =
+            std::chrono::milliseconds(pipelineNode["persist_batch_window_ms"].as<int>());
+    }
+    if (pipelineNode && pipelineNode["persist_max_batch"]) {
+        persistenceConfig.maxBatchSize = pipelineNode["persist_max_batch"].as<size_t>();
+    }
+    // "region_crops" stores only the consolidated regions (what the YOLO step reads) and a
+    // context thumbnail; annotations go into the metadata instead of a second full frame
+    if (config["persistence_mode"]) {
+        persistenceConfig.mode = parsePersistenceMode(config["persistence_mode"].as<std::string>());
+    }
+    if (config["region_crop_dir"]) {
+        persistenceConfig.regionPath = config["region_crop_dir"].as<std::string>();
+    }
+    if (config["region_crop_pad_to_push"] && config["region_crop_pad_to_push"].as<bool>()) {
+        persistenceConfig.regionCropMinSide = config["push"] ? config["push"].as<int>() : 640;
+    }
+    // "plate_patches": region crops plus a background plate every interval to rebuild frames on
+    if (config["background_plate_interval_s"]) {
+        persistenceConfig.plateInterval = std::chrono::seconds(config["background_plate_interval_s"].as<int>());
+    }
+    // Full frames and thumbnails appended to rolling segment files instead of one file each
+    if (const YAML::Node segmentNode = config["segment_storage"]) {
+        if (segmentNode["enabled"] && segmentNode["enabled"].as<bool>()) {
+            persistenceConfig.segmentPath = segmentNode["path"]
+                                                ? segmentNode["path"].as<std::string>()
+                                                : persistenceConfig.storagePath + "/segments";
+            if (segmentNode["segment_mb"]) {
+                persistenceConfig.segmentBytes = segmentNode["segment_mb"].as<uint64_t>() << 20;
+            }
+            // On 1 GB devices cached segment pages evict the pipeline's and the database's memory
+            if (segmentNode["cache"]) {
+                persistenceConfig.segmentCache = parseSegmentCachePolicy(segmentNode["cache"].as<std::string>());
+            }
+            LOG_INFO("Frame images go to {} MB segments in {} (cache policy {})",
+                     persistenceConfig.segmentBytes >> 20, persistenceConfig.segmentPath,
+                     segmentCachePolicyName(persistenceConfig.segmentCache));
+        }
+    }
+    // Image files handed to an io_uring (or thread) writer that batches the open/write/close calls
+    if (const YAML::Node writerNode = config["file_writer"]) {
+        if (writerNode["enabled"] && writerNode["enabled"].as<bool>()) {
+            FileWriterConfig& writerConfig = persistenceConfig.fileWriter;
+            persistenceConfig.asyncWrites = true;
+            if (writerNode["backend"]) {
+                writerConfig.backend = parseFileWriterBackend(writerNode["backend"].as<std::string>());
+            }
+            if (writerNode["queue_depth"]) writerConfig.queueDepth = writerNode["queue_depth"].as<unsigned>();
+            if (writerNode["threads"]) writerConfig.threads = writerNode["threads"].as<size_t>();
+            if (writerNode["registered_buffers"]) {
+                writerConfig.registeredBuffers = writerNode["registered_buffers"].as<size_t>();
+            }
+            if (writerNode["buffer_kb"]) writerConfig.bufferBytes = writerNode["buffer_kb"].as<size_t>() << 10;
+            if (writerNode["fsync_every"]) writerConfig.fsyncEvery = writerNode["fsync_every"].as<unsigned>();
+        }
+    }
+    // Gallery thumbnails packed into per-hour sprite sheets, so a page loads in a few requests
+    if (const YAML::Node atlasNode = config["thumbnail_atlas"]) {
+        ThumbnailAtlasConfig& atlas = persistenceConfig.atlas;
+        if (atlasNode["enabled"]) atlas.enabled = atlasNode["enabled"].as<bool>();
+        if (atlasNode["cell_width"]) atlas.cellSize.width = atlasNode["cell_width"].as<int>();
+        if (atlasNode["cell_height"]) atlas.cellSize.height = atlasNode["cell_height"].as<int>();
+        if (atlasNode["columns"]) atlas.columns = atlasNode["columns"].as<int>();
+        if (atlasNode["rows"]) atlas.rows = atlasNode["rows"].as<int>();
+        if (atlasNode["seal_after_s"]) atlas.sealAfter = std::chrono::seconds(atlasNode["seal_after_s"].as<int>());
+        if (atlas.enabled && (atlas.cellSize.width <= 0 || atlas.cellSize.height <= 0 || atlas.columns <= 0 ||
+                              atlas.rows <= 0)) {
+            std::cerr << "Error: thumbnail_atlas: cell size, columns and rows must be positive" << std::endl;
+            return -1;
         }
+    }
+    // Codec per kind of stored image: fast JPEG by default, WebP/AVIF/JPEG XL for smaller files
+    if (const YAML::Node encodingNode = config["storage_encoding"]) {
+        const auto parseEncoding = [](const YAML::Node& node, ImageEncodeSettings& settings) {
+            if (!node) return;
+            if (node["codec"]) settings.codec = parseImageCodec(node["codec"].as<std::string>());
+            if (node["quality"]) settings.quality = node["quality"].as<int>();
+            if (node["effort"]) settings.effort = node["effort"].as<int>();
+        };
+        parseEncoding(encodingNode["full"], persistenceConfig.encoding.full);
+        parseEncoding(encodingNode["crop"], persistenceConfig.encoding.crop);
+        parseEncoding(encodingNode["thumbnail"], persistenceConfig.encoding.thumbnail);
+    }
+    const bool saveRegionCrops = persistenceConfig.mode != PersistenceMode::FullFrames;
+    const bool sendPlates = persistenceConfig.mode == PersistenceMode::PlatePatches;
+    LOG_INFO("Frame persistence mode: {} (region crops padded to {} px, 0 = exact boxes)",
+             persistenceModeName(persistenceConfig.mode), persistenceConfig.regionCropMinSide);
 
-        frameCount++;
-        auto currentTime = std::chrono::steady_clock::now();
+    // Every frame's boxes and regions in columnar row groups for analytics; the render stage
+    // appends, the persistence worker writes (src/image_detection/detection_log_reader.py).
+    // Declared before the queue so it outlives the worker
+    std::unique_ptr<DetectionLog> detectionLog;
+    if (const YAML::Node logNode = config["detection_log"]) {
+        if (logNode["enabled"] && logNode["enabled"].as<bool>()) {
+            DetectionLogConfig logConfig;
+            logConfig.enabled = true;
+            if (logNode["directory"]) logConfig.directory = logNode["directory"].as<std::string>();
+            if (logNode["row_group_frames"]) {
+                logConfig.rowGroupFrames = std::max<size_t>(1, logNode["row_group_frames"].as<size_t>());
+            }
+            if (logNode["flush_interval_ms"]) {
+                logConfig.flushInterval = std::chrono::milliseconds(logNode["flush_interval_ms"].as<int>());
+            }
+            if (logNode["file_mb"]) logConfig.fileBytes = logNode["file_mb"].as<uint64_t>() << 20;
+            detectionLog = std::make_unique<DetectionLog>(logConfig);
+            LOG_INFO("Detection log: row groups of {} frames in {}", logConfig.rowGroupFrames,
+                     logConfig.directory);
+        }
+    }
+    FramePersistenceQueue persistQueue(insertBatch, persistenceConfig);
+    if (detectionLog) persistQueue.setDetectionLog(detectionLog.get());
 
-        // Use unified function to process frame and consolidate regions
-        // Disable visualization file saving to avoid disk spam
-        std::string visualizationPath = "";
+    // Detections for other systems as they happen: the render stage queues them, a worker
+    // publishes them in MessagePack batches over ZeroMQ or MQTT
+    std::unique_ptr<DetectionEventPublisher> eventPublisher;
+    if (const YAML::Node eventNode = config["event_publisher"]) {
+        if (eventNode["enabled"] && eventNode["enabled"].as<bool>()) {
+            EventPublisherConfig eventConfig;
+            eventConfig.enabled = true;
+            if (eventNode["transport"]) eventConfig.transport = eventNode["transport"].as<std::string>();
+            if (eventNode["endpoint"]) eventConfig.endpoint = eventNode["endpoint"].as<std::string>();
+            if (eventNode["topic"]) eventConfig.topic = eventNode["topic"].as<std::string>();
+            if (eventNode["stream"]) eventConfig.stream = eventNode["stream"].as<std::string>();
+            if (eventNode["granularity"]) {
+                const std::string granularity = eventNode["granularity"].as<std::string>();
+                if (granularity == "track") {
+                    eventConfig.granularity = EventGranularity::Track;
+                } else if (granularity != "frame") {
+                    LOG_WARN("Unknown event_publisher granularity '{}', using frame", granularity);
+                }
+            }
+            if (eventNode["motion_only"]) eventConfig.motionOnly = eventNode["motion_only"].as<bool>();
+            if (eventNode["batch_window_ms"]) {
+                eventConfig.batchWindow = std::chrono::milliseconds(eventNode["batch_window_ms"].as<int>());
+            }
+            if (eventNode["max_batch_events"]) {
+                eventConfig.maxBatchEvents = std::max<size_t>(1, eventNode["max_batch_events"].as<size_t>());
+            }
+            if (eventNode["queue_capacity"]) eventConfig.queueCapacity = eventNode["queue_capacity"].as<size_t>();
+            if (eventNode["mqtt_qos"]) eventConfig.mqttQos = eventNode["mqtt_qos"].as<int>();
+            // Detection keeps running without it (the reason is logged)
+            eventPublisher = DetectionEventPublisher::open(eventConfig);
+        }
+    }
 
-        auto [processingResult, consolidatedRegions] = processFrameAndConsolidate(
-            motionProcessor, regionConsolidator, frame, visualizationPath);
+    // Per-minute motion summaries for the dashboards, upserted by the persistence worker so
+    // they read one document per minute instead of scanning the frames
+    const YAML::Node motionStatsNode = config["motion_stats"];
+    const bool motionStatsEnabled = motionStatsNode && motionStatsNode["enabled"] &&
+                                    motionStatsNode["enabled"].as<bool>();
+    if (motionStatsEnabled) {
+        persistQueue.setSummaryWriter(
+            [&persistenceStore](const std::vector<MotionMinuteSummary>& summaries) {
+                return persistenceStore->upsertMotionSummaries(summaries);
+            });
+    }
+    MotionStatsAggregator motionStats(FrameMetadata().source);  // Only touched by the render stage
 
-        // Log consolidated regions for debugging
-        if (!consolidatedRegions.empty()) {
-            LOG_DEBUG("Frame {}: {} motion detections -> {} consolidated regions", frameCount,
-                      processingResult.detectedBounds.size(), consolidatedRegions.size());
-            for (size_t i = 0; i < consolidatedRegions.size(); ++i) {
-                const auto& region = consolidatedRegions[i];
-                LOG_DEBUG("  Region {}: {}x{} at ({},{}) with {} objects", i,
-                          region.boundingBox.width, region.boundingBox.height, region.boundingBox.x,
-                          region.boundingBox.y, region.trackedObjectIds.size());
-            }
-        }
-
-        // Initialize video writer on first frame with motion (only once per session)
-        if (!recordingStarted && !consolidatedRegions.empty()) {
-            // Get video properties
-            double fps = cap.get(cv::CAP_PROP_FPS);
-            if (fps <= 0) fps = 30.0;  // Default to 30fps if not available
-            
-            cv::Size frameSize = frame.size();
-            
-            // Initialize video writer (H.264 codec for web compatibility)
-            int fourcc = cv::VideoWriter::fourcc('a', 'v', 'c', '1');  // H.264 codec
-            videoWriter.open(outputVideoPath, fourcc, fps, frameSize, true);
-            
-            if (videoWriter.isOpened()) {
-                recordingStarted = true;
-                recordingActive = true;
-                LOG_INFO("📹 Started recording demo video: {} ({}x{} @ {} fps)", 
-                         outputVideoPath, frameSize.width, frameSize.height, fps);
-                std::cout << "\n🔴 Recording demo video: " << outputVideoPath << std::endl;
-                std::cout << "   Will capture up to " << (maxRecordingFrames / fps) << " seconds" << std::endl;
-            } else {
-                LOG_ERROR("Failed to open video writer for {}", outputVideoPath);
-            }
-        }
-        
-        // Create live display frame
-        cv::Mat displayFrame = frame.clone();
-
-        // Draw individual motion detections in gray (lower priority)
-        for (size_t i = 0; i < processingResult.detectedBounds.size(); ++i) {
-            const auto& bounds = processingResult.detectedBounds[i];
-            cv::Scalar color =
-                cv::Scalar(200, 200, 200);  // Light gray for individual motion detections
-            cv::rectangle(displayFrame, bounds, color, 1);
-
-            // Add motion detection label
-            std::string info = "M:" + std::to_string(i);
-            cv::putText(displayFrame, info, cv::Point(bounds.x, bounds.y - 5),
-                        cv::FONT_HERSHEY_SIMPLEX, 0.4, color, 1);
-        }
-
-        // Draw consolidated regions in red (higher priority - drawn on top)
-        for (size_t i = 0; i < consolidatedRegions.size(); ++i) {
-            const auto& region = consolidatedRegions[i];
-            cv::Scalar regionColor = cv::Scalar(0, 0, 255);  // Red for consolidated regions
-            cv::rectangle(displayFrame, region.boundingBox, regionColor, 3);
-
-            std::string regionInfo = "Region:" + std::to_string(i) + " (" +
-                                     std::to_string(region.trackedObjectIds.size()) + " objs)";
-            cv::putText(displayFrame, regionInfo,
-                        cv::Point(region.boundingBox.x, region.boundingBox.y - 30),
-                        cv::FONT_HERSHEY_SIMPLEX, 0.7, regionColor, 2);
-        }
-        
-        // Add recording indicator and write frames if actively recording
-        if (recordingActive) {
-            std::string recordingText = "REC [" + std::to_string(recordedFrames) + "/" + 
-                                       std::to_string(maxRecordingFrames) + "]";
-            cv::putText(displayFrame, recordingText, cv::Point(10, 30),
-                       cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0, 0, 255), 2);
-            
-            // Write frame to video
-            videoWriter.write(displayFrame);
-            recordedFrames++;
-            
-            // Stop recording after max frames
-            if (recordedFrames >= maxRecordingFrames) {
-                videoWriter.release();
-                recordingActive = false;
-                recordingComplete = true;
-                LOG_INFO("✅ Demo video recording completed: {} ({} frames)", 
-                         outputVideoPath, recordedFrames);
-                std::cout << "\n✅ Demo video saved: " << outputVideoPath << std::endl;
-                std::cout << "   " << recordedFrames << " frames recorded" << std::endl;
-                std::cout << "   🎬 Recording complete! Press 'q' to exit or continue watching..." << std::endl;
-                
-                // Auto-exit after recording is complete
-                key = 'q';
+    // Recent frames and their regions in POSIX shared memory, for a YOLO worker or a live
+    // preview running in another process (src/image_detection/shared_frame_reader.py)
+    std::unique_ptr<SharedFrameRing> sharedFrames;
+    int sharedFramesEvery = 1;
+    if (const YAML::Node sharedNode = config["shared_frames"]) {
+        if (sharedNode["enabled"] && sharedNode["enabled"].as<bool>()) {
+            SharedFrameRingConfig ringConfig;
+            if (sharedNode["name"]) ringConfig.name = sharedNode["name"].as<std::string>();
+            if (sharedNode["slots"]) ringConfig.slotCount = sharedNode["slots"].as<uint32_t>();
+            if (sharedNode["max_width"]) ringConfig.maxWidth = sharedNode["max_width"].as<uint32_t>();
+            if (sharedNode["max_height"]) {
+                ringConfig.maxHeight = sharedNode["max_height"].as<uint32_t>();
             }
+            if (sharedNode["publish_every"]) {
+                sharedFramesEvery = std::max(1, sharedNode["publish_every"].as<int>());
+            }
+            sharedFrames = std::make_unique<SharedFrameRing>(ringConfig);
+            if (!sharedFrames->isOpen()) sharedFrames.reset();
         }
+    }
+
+    // Every frame's motion boxes as a box capture, replayed by the tracker and consolidator
+    // benchmarks (BoxCapture); the render stage opens it with the first frame's size
+    std::string boxCaptureDir;  // Empty: not recording
+    if (const YAML::Node captureNode = config["box_capture"]) {
+        if (captureNode["enabled"] && captureNode["enabled"].as<bool>()) {
+            boxCaptureDir = captureNode["directory"] ? captureNode["directory"].as<std::string>()
+                                                     : "data/captures";
+        }
+    }
+    std::unique_ptr<BoxCaptureWriter> boxCapture;  // Only touched by the render stage
 
-        // Create MongoDB frame (clean frame with individual motion detections and consolidated
-        // regions)
-        cv::Mat mongoFrame;
-        if (saveOnlyConsolidatedRegions && !consolidatedRegions.empty()) {
-            // For MongoDB: clean frame with both individual motion detections and consolidated
-            // regions
-            mongoFrame = frame.clone();
+    // Chrome trace (chrome://tracing, ui.perfetto.dev) of every frame's stages over a time
+    // window, recorded by the main thread as frames leave the pipeline
+    TraceRecorderConfig traceConfig;
+    if (const YAML::Node tracingNode = config["tracing"]) {
+        if (tracingNode["enabled"]) traceConfig.enabled = tracingNode["enabled"].as<bool>();
+        if (tracingNode["path"]) traceConfig.path = tracingNode["path"].as<std::string>();
+        if (tracingNode["start_after_s"]) traceConfig.startAfterSeconds = tracingNode["start_after_s"].as<double>();
+        if (tracingNode["duration_s"]) traceConfig.durationSeconds = tracingNode["duration_s"].as<double>();
+        if (tracingNode["max_frames"]) traceConfig.maxFrames = tracingNode["max_frames"].as<size_t>();
+    }
+    TraceRecorder traceRecorder(traceConfig);
 
-            // Draw individual motion detections in gray (lower priority)
-            for (size_t i = 0; i < processingResult.detectedBounds.size(); ++i) {
-                const auto& bounds = processingResult.detectedBounds[i];
-                cv::Scalar color = cv::Scalar(
-                    200, 200, 200);  // Light gray for individual motion detections (BGR format)
-                cv::rectangle(mongoFrame, bounds, color, 1);
+    // Low-resolution stages of the last frames, written only on SIGUSR2, a flood frame or a
+    // frame over the latency SLO; the detect stage records every frame it processes
+    FlightRecorderConfig flightConfig;
+    if (const YAML::Node flightNode = config["flight_recorder"]) {
+        if (flightNode["enabled"]) flightConfig.enabled = flightNode["enabled"].as<bool>();
+        if (flightNode["directory"]) flightConfig.directory = flightNode["directory"].as<std::string>();
+        if (flightNode["frames"]) flightConfig.frames = flightNode["frames"].as<size_t>();
+        if (flightNode["max_mb"]) {
+            flightConfig.maxBytes = static_cast<size_t>(flightNode["max_mb"].as<double>() * (1 << 20));
+        }
+        if (flightNode["thumbnail_side"]) flightConfig.thumbnailSide = flightNode["thumbnail_side"].as<int>();
+        if (flightNode["max_boxes"]) flightConfig.maxBoxes = flightNode["max_boxes"].as<size_t>();
+        if (flightNode["dump_on_flood"]) flightConfig.dumpOnFlood = flightNode["dump_on_flood"].as<bool>();
+        if (flightNode["latency_slo_ms"]) flightConfig.latencySloMs = flightNode["latency_slo_ms"].as<double>();
+        if (flightNode["min_dump_interval_s"]) {
+            flightConfig.minDumpIntervalSeconds = flightNode["min_dump_interval_s"].as<double>();
+        }
+    }
+    FlightRecorder flightRecorder(flightConfig);
+    if (flightRecorder.isEnabled()) {
+        // The recorder needs the stage images the live loop otherwise skips
+        motionProcessor.setRetainedStages(MotionProcessor::STAGE_PROCESSED | MotionProcessor::STAGE_FRAME_DIFF |
+                                          MotionProcessor::STAGE_THRESH | MotionProcessor::STAGE_MORPHOLOGICAL);
+        LOG_INFO("Flight recorder: last {} frames kept in {:.0f} MiB at most; SIGUSR2 writes them to {}",
+                 flightConfig.frames, flightConfig.maxBytes / double(1 << 20), flightConfig.directory);
+    }
 
-                // Add motion detection label
-                std::string info = "M:" + std::to_string(i);
-                cv::putText(mongoFrame, info, cv::Point(bounds.x, bounds.y - 5),
-                            cv::FONT_HERSHEY_SIMPLEX, 0.4, color, 1);
-            }
+    // Skip saves whose regions look the same as in the last saved frame
+    SaveDedupConfig dedupConfig;
+    if (const YAML::Node dedupNode = config["save_dedup"]) {
+        if (dedupNode["enabled"]) dedupConfig.enabled = dedupNode["enabled"].as<bool>();
+        if (dedupNode["max_hash_distance"]) {
+            dedupConfig.maxHashDistance = dedupNode["max_hash_distance"].as<int>();
+        }
+        if (dedupNode["min_iou"]) dedupConfig.minIou = dedupNode["min_iou"].as<double>();
+        if (dedupNode["max_interval_s"]) {
+            dedupConfig.maxInterval = std::chrono::seconds(dedupNode["max_interval_s"].as<int>());
+        }
+    }
+    SaveDeduplicator saveDeduplicator(dedupConfig);
+    if (dedupConfig.enabled) {
+        LOG_INFO("Save deduplication: hash distance <= {}, IoU >= {:.2f}, forced save every {}s",
+                 dedupConfig.maxHashDistance, dedupConfig.minIou, dedupConfig.maxInterval.count());
+    }
+    // One document per bird visit (best crops, times, path) instead of a save every interval
+    VisitConfig visitConfig;
+    if (const YAML::Node visitNode = config["visit_aggregation"]) {
+        if (visitNode["enabled"]) visitConfig.enabled = visitNode["enabled"].as<bool>();
+        if (visitNode["best_crops"]) visitConfig.bestCrops = visitNode["best_crops"].as<size_t>();
+        if (visitNode["end_after_s"]) {
+            visitConfig.endAfter = std::chrono::milliseconds(
+                static_cast<int64_t>(visitNode["end_after_s"].as<double>() * 1000.0));
+        }
+        if (visitNode["max_duration_s"]) {
+            visitConfig.maxDuration = std::chrono::milliseconds(
+                static_cast<int64_t>(visitNode["max_duration_s"].as<double>() * 1000.0));
+        }
+        if (visitNode["sample_interval_ms"]) {
+            visitConfig.sampleInterval = std::chrono::milliseconds(visitNode["sample_interval_ms"].as<int>());
+        }
+        if (visitNode["min_iou"]) visitConfig.minIou = visitNode["min_iou"].as<double>();
+        if (visitNode["max_path_points"]) visitConfig.maxPathPoints = visitNode["max_path_points"].as<size_t>();
+    }
+    // Without the tracker the object IDs are per frame, so only overlap can follow a bird
+    visitConfig.matchTrackIds = trackerEnabled;
+    VisitAggregator visitAggregator(visitConfig);
+    std::atomic<uint64_t> visitsSubmitted{0};
+    if (visitConfig.enabled) {
+        LOG_INFO("Visit aggregation: one document per visit with its {} best crops, ending {:.1f}s after the "
+                 "last sighting (split after {}s); periodic saves are off",
+                 visitConfig.bestCrops, visitConfig.endAfter.count() / 1000.0,
+                 std::chrono::duration_cast<std::chrono::seconds>(visitConfig.maxDuration).count());
+    }
+    // Motion history: saves whose regions only hold motion swaying in place can be passed over
+    const MotionHistoryConfig& motionHistoryConfig = pipelineConfig->motionHistory;
+    const bool skipJitterSaves = motionHistoryConfig.enabled && motionHistoryConfig.skipJitterSaves;
+    std::atomic<uint64_t> jitterSavesSkipped{0};
+    if (motionHistoryConfig.enabled) {
+        LOG_INFO("Motion history: {} frames, jitter below {:.2f} px/frame after {} frames{}",
+                 motionHistoryConfig.durationFrames, motionHistoryConfig.jitterMaxSpeed,
+                 motionHistoryConfig.jitterMinAgeFrames, skipJitterSaves ? ", jitter-only saves skipped" : "");
+    }
+
+    // Event clips: a clip per burst of consolidated regions, with a JPEG pre-roll of the
+    // seconds before it, encoded on the recorder's own thread
+    ClipRecorderConfig clipConfig;
+    if (const YAML::Node clipNode = config["event_clips"]) {
+        if (clipNode["enabled"]) clipConfig.enabled = clipNode["enabled"].as<bool>();
+        if (clipNode["output_dir"]) clipConfig.outputDir = clipNode["output_dir"].as<std::string>();
+        if (clipNode["pre_roll_s"]) clipConfig.preRollSeconds = clipNode["pre_roll_s"].as<double>();
+        if (clipNode["post_roll_s"]) clipConfig.postRollSeconds = clipNode["post_roll_s"].as<double>();
+        if (clipNode["max_clip_s"]) clipConfig.maxClipSeconds = clipNode["max_clip_s"].as<double>();
+        if (clipNode["pre_roll_quality"]) {
+            clipConfig.preRollQuality = clipNode["pre_roll_quality"].as<int>();
+        }
+        if (clipNode["codec"]) clipConfig.codec = clipNode["codec"].as<std::string>();
+        if (clipNode["extension"]) clipConfig.extension = clipNode["extension"].as<std::string>();
+        if (clipNode["hardware_encode"]) {
+            clipConfig.hardwareEncode = clipNode["hardware_encode"].as<bool>();
+        }
+        if (clipNode["queue_capacity"]) {
+            clipConfig.queueCapacity = clipNode["queue_capacity"].as<size_t>();
+        }
+    }
+    EventClipRecorder clipRecorder(clipConfig);
+
+    // Pass-through recording: the camera's own H.264/H.265 packets remuxed around events,
+    // with the overlays in a WebVTT sidecar instead of burned in
+    PassthroughConfig passthroughConfig;
+    if (const YAML::Node passthroughNode = config["passthrough_recording"]) {
+        if (passthroughNode["enabled"]) {
+            passthroughConfig.enabled = passthroughNode["enabled"].as<bool>();
+        }
+        // Defaults to the analyzed stream; a camera's main stream can be recorded while a
+        // substream is analyzed
+        passthroughConfig.source = passthroughNode["source"]
+                                       ? passthroughNode["source"].as<std::string>()
+                                       : captureConfig.source;
+        if (passthroughNode["output_dir"]) {
+            passthroughConfig.outputDir = passthroughNode["output_dir"].as<std::string>();
+        }
+        if (passthroughNode["pre_roll_s"]) {
+            passthroughConfig.preRollSeconds = passthroughNode["pre_roll_s"].as<double>();
+        }
+        if (passthroughNode["post_roll_s"]) {
+            passthroughConfig.postRollSeconds = passthroughNode["post_roll_s"].as<double>();
+        }
+        if (passthroughNode["max_segment_s"]) {
+            passthroughConfig.maxSegmentSeconds = passthroughNode["max_segment_s"].as<double>();
+        }
+    }
+    if (passthroughConfig.enabled && passthroughConfig.source.rfind("rtsp://", 0) != 0 &&
+        passthroughConfig.source.rfind("rtsps://", 0) != 0) {
+        LOG_WARN("Pass-through recording needs an RTSP camera, not '{}'; disabled",
+                 passthroughConfig.source);
+        passthroughConfig.enabled = false;
+    }
+    PassthroughRecorder passthroughRecorder(passthroughConfig);
+
+    // In-process species classification of the consolidated regions (YOLO11 ONNX export)
+    RegionClassifierConfig classifierConfig;
+    // `push` is the ideal YOLO input; the mosaic keeps regions within the tolerance on their own
+    if (config["push"]) classifierConfig.inputSize = config["push"].as<int>();
+    if (config["size_tolerance_percent"]) {
+        classifierConfig.mosaic.sizeTolerancePercent = config["size_tolerance_percent"].as<double>();
+    }
+    if (const YAML::Node classifierNode = config["region_classifier"]) {
+        if (classifierNode["enabled"]) classifierConfig.enabled = classifierNode["enabled"].as<bool>();
+        if (classifierNode["model_path"]) {
+            classifierConfig.modelPath = classifierNode["model_path"].as<std::string>();
+        }
+        if (classifierNode["backend"]) classifierConfig.backend = classifierNode["backend"].as<std::string>();
+        if (classifierNode["input_size"]) classifierConfig.inputSize = classifierNode["input_size"].as<int>();
+        if (classifierNode["confidence_threshold"]) {
+            classifierConfig.confidenceThreshold = classifierNode["confidence_threshold"].as<float>();
+        }
+        if (classifierNode["max_batch"]) classifierConfig.maxBatch = classifierNode["max_batch"].as<int>();
+        if (classifierNode["region_padding"]) {
+            classifierConfig.regionPadding = classifierNode["region_padding"].as<double>();
+        }
+        if (classifierNode["class_names"]) {
+            classifierConfig.classNames = classifierNode["class_names"].as<std::vector<std::string>>();
+        }
+        if (classifierNode["mosaic"]) classifierConfig.mosaic.enabled = classifierNode["mosaic"].as<bool>();
+        if (classifierNode["device_preprocessing"]) {
+            classifierConfig.devicePreprocessing = classifierNode["device_preprocessing"].as<bool>();
+        }
+        ClassificationCacheConfig& cacheConfig = classifierConfig.cache;
+        if (classifierNode["refresh_interval_frames"]) {
+            cacheConfig.refreshIntervalFrames = classifierNode["refresh_interval_frames"].as<int>();
+        }
+        if (classifierNode["uncertain_retry_frames"]) {
+            cacheConfig.uncertainRetryFrames = classifierNode["uncertain_retry_frames"].as<int>();
+        }
+        if (classifierNode["size_change_threshold"]) {
+            cacheConfig.sizeChangeThreshold = classifierNode["size_change_threshold"].as<double>();
+        }
+        if (classifierNode["appearance_change_threshold"]) {
+            cacheConfig.appearanceChangeThreshold = classifierNode["appearance_change_threshold"].as<double>();
+        }
+        if (classifierNode["max_regions_per_frame"]) {
+            classifierConfig.maxRegionsPerFrame = classifierNode["max_regions_per_frame"].as<int>();
+        }
+    }
+    RegionClassifier regionClassifier(classifierConfig);
 
-            // Draw consolidated regions in red (higher priority - drawn on top)
-            for (size_t i = 0; i < consolidatedRegions.size(); ++i) {
-                const auto& region = consolidatedRegions[i];
-                cv::Scalar regionColor =
-                    cv::Scalar(0, 0, 255);  // Red for consolidated regions (BGR format)
-                cv::rectangle(mongoFrame, region.boundingBox, regionColor, 3);
+    StagedPipeline<FramePacket> processingPipeline(queueCapacity, backpressure);
+    processingPipeline.setThreadStartHook(
+        [&threadSettings](const std::string& stage) { setupCurrentThread(threadSettings, stage); });
+    if (latestFrameOnly) processingPipeline.setInputSource([&latestFrame] { return latestFrame.wait(); });
+
+    // Stage 1: motion detection
+    // A reloaded config is applied between two frames: thresholds, blur and kernel sizes
+    // change while the background model and the reference frame are kept
+    // Load shedding lowers detection_scale by a factor of the configured one (or of the one
+    // adaptive_scale picked)
+    // Detect-every-k (flow_propagation:): between detection frames the detect stage moves the
+    // boxes of the last one with optical flow inside their ROIs, and the consolidate stage
+    // moves its regions along instead of re-clustering
+    RegionFlowPropagator flowPropagator(pipelineConfig->flowPropagation);
+    std::atomic<uint64_t> flowPropagatedFrames{0};
+    std::atomic<uint64_t> flowConfidenceDrops{0};
+    if (pipelineConfig->flowPropagation.enabled) {
+        LOG_INFO("Flow propagation: full detection every {} frames, optical flow in between",
+                 flowPropagator.getConfig().detectEveryFrames);
+    }
+    // roi_prediction: the tracker's boxes for the next frame go back from the consolidate
+    // stage to the detect stage, which adds windows around them to its own last boxes. The
+    // detect stage runs a few frames ahead, so only the newest set matters
+    LatestValueMailbox<std::vector<cv::Rect>> predictedRegions;
+    const bool publishPredictions = trackerEnabled && motionProcessor.isRoiPredictionEnabled();
+    processingPipeline.addStage("detect", [&motionProcessor, &sharedConfig, &loadShedder, shedStream, &adaptiveScale,
+                                           &detectionScaleInUse, &flowPropagator,
+                                           &flowPropagatedFrames, &flowConfidenceDrops, &predictedRegions, &flightRecorder,
+                                           flowEnabled = pipelineConfig->flowPropagation.enabled,
+                                           appliedVersion = sharedConfig.version(),
+                                           baseScale = motionProcessor.getDetectionScale(),
+                                           appliedScale = motionProcessor.getDetectionScale(), sendPlates,
+                                           plateInterval = persistenceConfig.plateInterval,
+                                           nextPlate = FrameTrace::Clock::time_point()](FramePacket& packet) mutable {
+        FrameTrace::Scope traced(packet.trace, TraceStage::DETECT);
+        if (sharedConfig.version() != appliedVersion) {
+            appliedVersion = sharedConfig.version();
+            motionProcessor.reloadConfig(sharedConfig.current());
+            baseScale = motionProcessor.getDetectionScale();
+            appliedScale = baseScale;  // The reload set it; the adaptive one is re-applied below
+            flowEnabled = sharedConfig.current()->flowPropagation.enabled;
+            flowPropagator.updateConfig(sharedConfig.current()->flowPropagation);
+        }
+        if (packet.wakeReset) {
+            // Woke from sleep: the reference frames are stale by now, the learned background is not
+            const cv::Mat background = motionProcessor.getBackgroundImage();
+            motionProcessor.resetState();
+            if (!background.empty()) motionProcessor.seedBackground(background);
+        }
+        // Asleep next: keep the model on disk (a battery unit may lose power before it wakes)
+        if (packet.sleepAfter && motionProcessor.saveBackgroundSnapshot()) {
+            LOG_DEBUG("Background snapshot saved before sleep");
+        }
+        const double scale = (adaptiveScale.config().enabled ? adaptiveScale.scale() : baseScale) *
+                             loadShedder.scaleFactor(shedStream);
+        if (scale != appliedScale) {
+            motionProcessor.setDetectionScale(scale);
+            appliedScale = scale;
+            detectionScaleInUse.store(scale, std::memory_order_relaxed);
+        }
+        if (flowEnabled && !packet.wakeReset && !flowPropagator.detectionDue()) {
+            packet.propagated = flowPropagator.propagate(packet.frame, packet.processingResult.detectedBounds);
+            (packet.propagated ? flowPropagatedFrames : flowConfidenceDrops).fetch_add(1, std::memory_order_relaxed);
+        }
+        if (packet.propagated) {
+            packet.processingResult.hasMotion = !packet.processingResult.detectedBounds.empty();
+            packet.flowShifts = flowPropagator.shifts();
+            return true;
+        }
+        if (auto regions = predictedRegions.take()) motionProcessor.setPredictedRegions(std::move(*regions));
+        packet.processingResult = motionProcessor.processFrame(packet.frame);
+        adaptiveScale.observe(packet.processingResult.detectedBounds);  // Applied from the next frame
+        flightRecorder.record(packet.frameIndex, packet.trace.captureUnixUs, packet.frame.size(),
+                              packet.processingResult);
+        if (flowEnabled) flowPropagator.seed(packet.frame, packet.processingResult.detectedBounds);
+        // plate_patches: the learned background (the frame itself while no model exists)
+        if (sendPlates && packet.trace.captured >= nextPlate) {
+            packet.backgroundPlate = motionProcessor.getBackgroundImage();
+            if (packet.backgroundPlate.empty()) packet.backgroundPlate = packet.frame;
+            nextPlate = packet.trace.captured + plateInterval;
+        }
+        return true;
+    });
 
-                std::string regionInfo = "Region:" + std::to_string(i) + " (" +
-                                         std::to_string(region.trackedObjectIds.size()) + " objs)";
-                cv::putText(mongoFrame, regionInfo,
-                            cv::Point(region.boundingBox.x, region.boundingBox.y - 30),
-                            cv::FONT_HERSHEY_SIMPLEX, 0.7, regionColor, 2);
+    // Stage 2: region consolidation
+    // Reused every frame by the consolidate stage thread (hot columns only, no strings)
+    TrackedObjectStore trackedObjects;
+    FrameArena consolidationArena;  // DBSCAN temporaries, reset after every frame
+    std::vector<ConsolidatedRegion> flowRegions;  // Regions of the last frame, moved along on propagated frames
+    std::vector<cv::Rect> nextRegions;            // roi_prediction: the tracker's boxes for the next frame
+    processingPipeline.addStage("consolidate", [&, appliedVersion = sharedConfig.version(),
+                                                flowEnabled = pipelineConfig->flowPropagation.enabled](
+                                                   FramePacket& packet) mutable {
+        FrameTrace::Scope traced(packet.trace, TraceStage::CONSOLIDATE);
+        // Reloaded DBSCAN and tracker settings; regions and tracks carry over
+        if (sharedConfig.version() != appliedVersion) {
+            appliedVersion = sharedConfig.version();
+            const std::shared_ptr<const PipelineConfig> liveConfig = sharedConfig.current();
+            ConsolidationConfig liveConsolidation = liveConfig->consolidation;
+            liveConsolidation.frameSize = regionConsolidator.getConfig().frameSize;
+            regionConsolidator.updateConfig(liveConsolidation);
+            objectTracker.updateConfig(liveConfig->tracker);
+            flowEnabled = liveConfig->flowPropagation.enabled;
+        }
+        const auto& detectedBounds = packet.processingResult.detectedBounds;
+        // Statistics of the extracted boxes (none for boxes moved by flow propagation)
+        const Detections& detections = packet.processingResult.detections;
+        const bool measured = detections.size() == detectedBounds.size();
+        // The tracker sees every frame, including empty ones, so missed tracks age out
+        if (trackerEnabled) {
+            if (measured) {
+                objectTracker.update(detections, trackedObjects);  // Tracks follow the mask centroids
+            } else {
+                objectTracker.update(detectedBounds, trackedObjects);
+            }
+            if (publishPredictions) {
+                objectTracker.predictNext(nextRegions);
+                predictedRegions.publish(nextRegions);
             }
         } else {
-            // Use the display frame (with both types of regions)
-            mongoFrame = displayFrame;
+            makeTrackedObjects(detectedBounds, trackedObjects);
+        }
+        if (detectionLog || (eventPublisher && eventPublisher->wantsTrackIds())) {
+            packet.objectIds = trackedObjects.ids();  // One per box, in box order
+        }
+        regionConsolidator.setFrameSize(packet.frame.size());  // Follows resolution changes
+        if (packet.propagated) {
+            RegionFlowPropagator::moveRegions(trackedObjects, packet.flowShifts, flowRegions);
+            packet.consolidatedRegions = flowRegions;
+        } else if (!trackedObjects.empty()) {
+            regionConsolidator.consolidateRegionsInto(trackedObjects, packet.consolidatedRegions,
+                                                      &consolidationArena);
+            consolidationArena.reset();
+            MotionHistory::summarizeRegions(trackedObjects, packet.processingResult.detectedMotion,
+                                            packet.consolidatedRegions);
+            if (measured) {
+                MotionRegionConsolidator::summarizeDetections(trackedObjects, detections,
+                                                              packet.consolidatedRegions);
+            }
+            LOG_DEBUG_LIMITED("Motion detection: {} -> {} regions", detectedBounds.size(),
+                              packet.consolidatedRegions.size());
+        }
+        if (flowEnabled && !packet.propagated) flowRegions = packet.consolidatedRegions;
+        // Labels land in the objects' cold data, which only this stage touches; tracks the
+        // classifier's cache can answer are not classified again
+        if (regionClassifier.isEnabled() && inferenceEnabled.load(std::memory_order_relaxed) &&
+            !packet.consolidatedRegions.empty()) {
+            regionClassifier.classifyRegions(packet.frame, packet.consolidatedRegions, trackedObjects);
+        }
+
+        // Log consolidated regions for debugging
+        if (!packet.consolidatedRegions.empty()) {
+            LOG_DEBUG("Frame {}: {} motion detections -> {} consolidated regions",
+                      packet.frameIndex, detectedBounds.size(), packet.consolidatedRegions.size());
+            for (size_t i = 0; i < packet.consolidatedRegions.size(); ++i) {
+                const auto& region = packet.consolidatedRegions[i];
+                LOG_DEBUG("  Region {}: {}x{} at ({},{}) with {} objects, {:.1f} px/frame at {:.0f} deg", i,
+                          region.boundingBox.width, region.boundingBox.height, region.boundingBox.x,
+                          region.boundingBox.y, region.trackedObjectIds.size(), region.motion.speed(),
+                          region.motion.direction());
+            }
+        }
+        return true;
+    });
+
+    // Stage 3: overlay rendering and save scheduling
+    // RENDER and PERSIST (save scheduling only) latencies of the render stage thread
+    StageTimings renderTimings;
+    PipelineMetrics pipelineMetrics;  // Every frame reaching this stage, for /metrics
+    // Overlay canvases: the display and persistence consumers hold them for a few frames,
+    // after which the render stage draws into them again instead of allocating
+    FrameBufferPool overlayPool;
+    cv::Mat pendingPlate;  // plate_patches: newest background plate not yet sent with a save
+    // Live MJPEG preview (preview:), rendered and encoded only while a viewer is connected
+    const YAML::Node previewNode = config["preview"];
+    const bool previewEnabled = previewNode && previewNode["enabled"] && previewNode["enabled"].as<bool>();
+    PreviewConfig previewConfig;
+    if (previewNode) {
+        if (previewNode["port"]) previewConfig.port = previewNode["port"].as<int>();
+        if (previewNode["bind_address"]) previewConfig.bindAddress = previewNode["bind_address"].as<std::string>();
+        if (previewNode["width"]) previewConfig.width = previewNode["width"].as<int>();
+        if (previewNode["fps"]) previewConfig.fps = previewNode["fps"].as<double>();
+        if (previewNode["quality"]) previewConfig.quality = previewNode["quality"].as<int>();
+    }
+    PreviewServer previewServer(previewConfig);
+    processingPipeline.addStage("render", [&](FramePacket& packet) {
+        FrameTrace::Scope traced(packet.trace, TraceStage::RENDER);
+        PROFILE_FRAME_MARK("camera");
+        if (!packet.backgroundPlate.empty()) pendingPlate = std::move(packet.backgroundPlate);
+        pipelineMetrics.recordFrame(packet.processingResult, packet.consolidatedRegions.size());
+        // The slower of the two processing stages limits the rate
+        loadShedder.recordProcessed(shedStream,
+                                    std::max(packet.trace.runMs(TraceStage::DETECT),
+                                             packet.trace.runMs(TraceStage::CONSOLIDATE)),
+                                    !packet.consolidatedRegions.empty());
+        if (profileScheduler) profileScheduler->recordActivity(!packet.consolidatedRegions.empty());
+        if (wakeController && !packet.consolidatedRegions.empty()) wakeController->recordActivity();
+        if (sharedFrames && packet.frameIndex % sharedFramesEvery == 0) {
+            std::vector<cv::Rect> regionBoxes;
+            regionBoxes.reserve(packet.consolidatedRegions.size());
+            for (const auto& region : packet.consolidatedRegions) {
+                regionBoxes.push_back(region.boundingBox);
+            }
+            sharedFrames->publish(packet.frame, packet.frameIndex, packet.trace.captureUnixUs, regionBoxes,
+                                  packet.processingResult.detectedBounds.size());
+        }
+        if (detectionLog) {
+            detectionLog->append(packet.frameIndex, packet.trace.captureUnixUs, 0,
+                                 packet.processingResult.detectedBounds, packet.objectIds,
+                                 packet.consolidatedRegions);
+        }
+        if (eventPublisher) {
+            eventPublisher->publish(packet.frameIndex, packet.trace.captureUnixUs,
+                                    packet.processingResult.detectedBounds, packet.objectIds,
+                                    packet.consolidatedRegions);
+        }
+        if (!boxCaptureDir.empty()) {
+            if (!boxCapture) boxCapture = openBoxCapture(boxCaptureDir, packet.frame.size());
+            // Stops recording for good after a failed open or write (already logged)
+            if (!boxCapture ||
+                !boxCapture->append(packet.frameIndex, packet.trace.captureUnixUs,
+                                    packet.processingResult.detectedBounds)) {
+                boxCaptureDir.clear();
+            }
+        }
+        if (motionStatsEnabled) {
+            const double latencyMs = packet.trace.sinceCaptureMs(std::chrono::steady_clock::now());
+            if (auto summary = motionStats.record(static_cast<int64_t>(std::time(nullptr)),
+                                                  packet.processingResult.detectedBounds.size(),
+                                                  packet.consolidatedRegions.size(), latencyMs)) {
+                persistQueue.submitSummary(std::move(*summary));
+            }
+        }
+        // Shares the frame buffer; the recorder compresses or writes it on its own thread
+        if (clipRecorder.isEnabled()) {
+            clipRecorder.push(packet.frame, !packet.consolidatedRegions.empty());
+        }
+        // One atomic load while nobody watches; the preview thread scales, draws and encodes
+        if (previewServer.wantsFrame()) {
+            FramePacket boxes;
+            boxes.processingResult.detectedBounds = packet.processingResult.detectedBounds;
+            boxes.consolidatedRegions = packet.consolidatedRegions;
+            previewServer.offer(packet.frame, [boxes = std::move(boxes)](cv::Mat& preview, double scale) {
+                drawDetections(preview, boxes, scale);
+            });
+        }
+        if (passthroughRecorder.isEnabled() && !packet.consolidatedRegions.empty()) {
+            std::vector<cv::Rect> regionBoxes;
+            regionBoxes.reserve(packet.consolidatedRegions.size());
+            for (const auto& region : packet.consolidatedRegions) {
+                regionBoxes.push_back(region.boundingBox);
+            }
+            passthroughRecorder.addOverlay(packet.trace.captured, packet.frame.size(), regionBoxes);
+        }
+
+        // With visit aggregation a visit is stored once, when it ends, instead of every interval
+        if (visitConfig.enabled) {
+            STAGE_TIMER(renderTimings, PipelineStage::PERSIST);
+            const bool jitterOnly =
+                skipJitterSaves && !packet.consolidatedRegions.empty() &&
+                std::all_of(packet.consolidatedRegions.begin(), packet.consolidatedRegions.end(),
+                            [](const ConsolidatedRegion& region) { return region.motion.jitter; });
+            if (!jitterOnly) {
+                visitAggregator.observe(packet.frame, packet.consolidatedRegions, packet.frameIndex,
+                                        packet.trace.captured, packet.trace.captureUnixUs);
+            }
+            for (Visit& visit : visitAggregator.takeEnded(packet.trace.captured)) {
+                if (submitVisit(persistQueue, std::move(visit))) {
+                    visitsSubmitted.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
         }
 
         // Auto-save frame every 1 second
-        if (currentTime - lastSaveTime >= saveInterval) {
-            // Check if we should save this frame based on configuration
-            bool shouldSaveFrame = !saveOnlyConsolidatedRegions || !consolidatedRegions.empty();
+        bool saveDue = !visitConfig.enabled && packet.trace.captured - lastSaveTime >= saveInterval;
+        // Check if we should save this frame based on configuration (a region-crop save
+        // with no regions would store nothing)
+        bool shouldSaveFrame =
+            saveDue && (!(saveOnlyConsolidatedRegions || saveRegionCrops) ||
+                        !packet.consolidatedRegions.empty());
+        // Leaves swaying in place are not worth a save; the next due frame may hold a bird
+        const bool jitterSave =
+            shouldSaveFrame && skipJitterSaves && !packet.consolidatedRegions.empty() &&
+            std::all_of(packet.consolidatedRegions.begin(), packet.consolidatedRegions.end(),
+                        [](const ConsolidatedRegion& region) { return region.motion.jitter; });
+        if (jitterSave) {
+            shouldSaveFrame = false;
+            jitterSavesSkipped.fetch_add(1, std::memory_order_relaxed);
+        }
+        // A bird sitting still would otherwise be stored again every interval
+        const bool duplicateSave =
+            shouldSaveFrame && !saveDeduplicator.shouldSave(packet.frame, packet.consolidatedRegions,
+                                                            packet.trace.captured);
+        if (duplicateSave) shouldSaveFrame = false;
+        const char* skipReason = jitterSave      ? "only motion swaying in place"
+                                 : duplicateSave ? "unchanged since the last save"
+                                                 : "no consolidated regions";
+
+        if (headless && shouldSaveFrame && saveRegionCrops) {
+            // Nothing to display and nothing annotated to store
+            STAGE_TIMER(renderTimings, PipelineStage::PERSIST);
+            submitRegionCrops(persistQueue, packet, pendingPlate);
+            lastSaveTime = packet.trace.captured;
+            return true;
+        }
+
+        // Headless runs have no display, so only frames about to be persisted are drawn
+        if (headless && !shouldSaveFrame) {
+            if (saveDue) {
+                LOG_DEBUG("Frame {} skipped - {}", packet.frameIndex, skipReason);
+                lastSaveTime = packet.trace.captured;
+            }
+            return true;
+        }
 
+        // With the OpenGL window the GUI thread draws the overlay itself; only an annotated
+        // save still needs the CPU drawing
+        if (glWindowOpen && !(saveDue && shouldSaveFrame && !saveRegionCrops)) {
+            if (saveDue) {
+                STAGE_TIMER(renderTimings, PipelineStage::PERSIST);
+                if (shouldSaveFrame) {
+                    submitRegionCrops(persistQueue, packet, pendingPlate);
+                } else {
+                    LOG_DEBUG("Frame {} skipped - {}", packet.frameIndex, skipReason);
+                    std::cout << "⏭️  Frame skipped - " << skipReason << std::endl;
+                }
+                lastSaveTime = packet.trace.captured;
+            }
+            return true;
+        }
+
+        // Frame with individual motion detections and consolidated regions, rendered once
+        // for both the saved image and the display
+        cv::Mat annotated;
+        {
+            STAGE_TIMER(renderTimings, PipelineStage::RENDER);
+            annotated = overlayPool.acquire(packet.frame.size(), CV_8UC3);
+            if (packet.frame.channels() == 1) {
+                cv::cvtColor(packet.frame, annotated, cv::COLOR_GRAY2BGR);  // Luma capture
+            } else {
+                packet.frame.copyTo(annotated);
+            }
+            drawDetections(annotated, packet);
+        }
+
+        if (saveDue) {
+            STAGE_TIMER(renderTimings, PipelineStage::PERSIST);
             // Debug output
             LOG_DEBUG(
                 "Frame {}: saveOnlyConsolidatedRegions={}, consolidatedRegions.size()={}, "
                 "shouldSaveFrame={}",
-                frameCount, saveOnlyConsolidatedRegions, consolidatedRegions.size(),
+                packet.frameIndex, saveOnlyConsolidatedRegions, packet.consolidatedRegions.size(),
                 shouldSaveFrame);
 
-            if (shouldSaveFrame) {
-                try {
-                    // Create metadata JSON with motion detection info and consolidated regions
-                    std::string metadata =
-                        "{\"source\":\"motion_detection_cpp\",\"frame_count\":" +
-                        std::to_string(frameCount) + ",\"timestamp\":\"" +
-                        std::to_string(std::time(nullptr)) + "\",\"auto_saved\":true," +
-                        "\"motion_detected\":" +
-                        (processingResult.detectedBounds.empty() ? "false" : "true") + "," +
-                        "\"motion_regions\":" +
-                        std::to_string(processingResult.detectedBounds.size()) + "," +
-                        "\"consolidated_regions_count\":" +
-                        std::to_string(consolidatedRegions.size()) + "," + "\"confidence\":" +
-                        std::to_string(processingResult.detectedBounds.empty() ? 0.0 : 0.8);
-
-                    // Add consolidated regions coordinates for YOLO11 processing
-                    if (!consolidatedRegions.empty()) {
-                        metadata += ",\"consolidated_regions\":[";
-                        for (size_t i = 0; i < consolidatedRegions.size(); ++i) {
-                            const auto& region = consolidatedRegions[i];
-                            metadata += "{\"x\":" + std::to_string(region.boundingBox.x) +
-                                        ",\"y\":" + std::to_string(region.boundingBox.y) +
-                                        ",\"width\":" + std::to_string(region.boundingBox.width) +
-                                        ",\"height\":" + std::to_string(region.boundingBox.height) +
-                                        ",\"object_count\":" +
-                                        std::to_string(region.trackedObjectIds.size()) + "}";
-                            if (i < consolidatedRegions.size() - 1) metadata += ",";
+            if (shouldSaveFrame && saveRegionCrops) {
+                submitRegionCrops(persistQueue, packet, pendingPlate);
+            } else if (shouldSaveFrame) {
+                PersistJob job;
+                job.frameIndex = packet.frameIndex;
+                job.original = packet.frame;
+                // Shared in headless mode and with the OpenGL window; the display copy gets
+                // its own buffer for the status overlays added below
+                if (headless || glWindowOpen) {
+                    job.annotated = annotated;
+                } else {
+                    job.annotated = overlayPool.acquire(annotated.size(), annotated.type());
+                    annotated.copyTo(job.annotated);
+                }
+                job.metadata = buildFrameMetadata(packet, false);
+                if (!persistQueue.submit(std::move(job))) {
+                    LOG_WARN("Frame {} save dropped - persistence queue full", packet.frameIndex);
+                }
+            } else {
+                // Frame skipped because it has no consolidated regions (with
+                // save_only_consolidated_regions) or repeats the last save
+                LOG_DEBUG("Frame {} skipped - {}", packet.frameIndex, skipReason);
+                std::cout << "⏭️  Frame skipped - " << skipReason << std::endl;
+            }
+
+            lastSaveTime = packet.trace.captured;
+        }
+        if (headless || glWindowOpen) return true;
+
+        // Add status overlay and legend (the GUI thread adds the recording indicator above it)
+        drawWindowStatus(annotated, packet);
+
+        packet.displayFrame = annotated;
+        return true;
+    });
+
+    // Video recording setup for demo visualization (never in headless mode)
+    const YAML::Node recordingConfig = config["demo_recording"];
+    const bool recordingEnabled =
+        !headless && (!recordingConfig || !recordingConfig["enabled"] ||
+                      recordingConfig["enabled"].as<bool>());
+    cv::VideoWriter videoWriter;
+    bool recordingStarted = false;  // Track if we've ever started recording
+    bool recordingActive = false;    // Track if currently writing frames
+    // 15 seconds at 30fps (shorter for quick demo)
+    int maxRecordingFrames = recordingConfig && recordingConfig["max_frames"]
+                                 ? recordingConfig["max_frames"].as<int>()
+                                 : 450;
+    int recordedFrames = 0;
+    std::string outputVideoPath = recordingConfig && recordingConfig["path"]
+                                      ? recordingConfig["path"].as<std::string>()
+                                      : "public/videos/demo.mp4";
+    double sourceFps = streamInfo.fps;
+    if (sourceFps <= 0) sourceFps = 30.0;  // Default to 30fps if not available
+    
+    // Ensure output directory exists
+    fs::path outputDir = fs::path(outputVideoPath).parent_path();
+    if (recordingEnabled && !outputDir.empty()) {
+        fs::create_directories(outputDir);
+    }
+
+    std::atomic<bool> stopCapture{false};
+    std::atomic<int> framesCaptured{0};
+    int frameCount = 0;  // Frames drained from the pipeline by the main thread
+    char key = 0;
+
+    // Prometheus /metrics endpoint; the page is built on the server thread from atomic
+    // counters and lock-free queue depths, so scrapes never stall a processing stage
+    const YAML::Node metricsConfig = config["metrics"];
+    const bool metricsEnabled = metricsConfig && metricsConfig["enabled"] && metricsConfig["enabled"].as<bool>();
+    const int metricsPort = metricsConfig && metricsConfig["port"] ? metricsConfig["port"].as<int>() : 9464;
+    const std::string metricsBindAddress = metricsConfig && metricsConfig["bind_address"]
+                                               ? metricsConfig["bind_address"].as<std::string>()
+                                               : "127.0.0.1";
+    // The network endpoints run as coroutines on a few shared threads instead of a thread each
+    const YAML::Node ioReactorConfig = config["io_reactor"];
+    const bool ioReactorEnabled = !ioReactorConfig || !ioReactorConfig["enabled"] || ioReactorConfig["enabled"].as<bool>();
+    IoReactor ioReactor(ioReactorConfig && ioReactorConfig["threads"] ? ioReactorConfig["threads"].as<size_t>() : 1);
+    if (ioReactorEnabled && metricsEnabled && !ioReactor.start()) {
+        LOG_WARN("Network endpoints keep a thread each");
+    }
+    MetricsServer metricsServer(
+        [&]() {
+            PrometheusTextWriter writer;
+            writer.counter("birds_frames_captured_total", "Frames read from the video source",
+                           static_cast<uint64_t>(framesCaptured.load()));
+            if (wakeController) {
+                writer.counter("birds_wake_total", "Times the wake trigger woke the pipeline from sleep",
+                               wakeController->wakeCount());
+                writer.counter("birds_sleep_frames_total", "Frames captured asleep, seen only by the wake trigger",
+                               wakeController->sleepFrames());
+                writer.gauge("birds_awake", "1 while the pipeline is awake (wake_trigger:)",
+                             wakeController->isAwake() ? 1.0 : 0.0);
+            }
+            writer.counter("birds_flow_propagated_frames_total",
+                           "Frames whose boxes were moved by optical flow instead of detected",
+                           flowPropagatedFrames.load());
+            writer.counter("birds_flow_confidence_drops_total",
+                           "Propagated frames that lost a box and ran full detection instead",
+                           flowConfidenceDrops.load());
+            writer.counter("birds_capture_stale_frames_skipped_total",
+                           "Frames replaced by a newer one before detection took them (latest-frame-only capture)",
+                           latestFrame.overwrittenCount());
+            pipelineMetrics.write(writer);
+
+            writer.header("birds_thread_budget_cores", "gauge",
+                          "Cores the thread budget sets aside for a partition (0 = shares the compute cores)");
+            const std::pair<ThreadPartition, const std::vector<int>*> partitions[] = {
+                {ThreadPartition::Compute, &threadBudget.computeCpus},
+                {ThreadPartition::Persistence, &threadBudget.persistenceCpus},
+                {ThreadPartition::Classification, &threadBudget.classificationCpus}};
+            for (const auto& [partition, cpus] : partitions) {
+                writer.sample("birds_thread_budget_cores", static_cast<double>(cpus->size()),
+                              {{"partition", threadPartitionName(partition)}});
+            }
+            writer.gauge("birds_thread_budget_workers", "Threads the budget expects to run OpenCV work at once",
+                         static_cast<double>(threadBudget.workers));
+            writer.gauge("birds_opencv_threads", "Threads of OpenCV's internal pool (cv::getNumThreads)",
+                         cv::getNumThreads());
+
+            const auto stages = processingPipeline.getStats();
+            writer.header("birds_pipeline_queue_depth", "gauge", "Packets waiting in a stage's input queue");
+            for (const auto& stage : stages) {
+                writer.sample("birds_pipeline_queue_depth", static_cast<double>(stage.queueDepth),
+                              {{"stage", stage.name}});
+            }
+            writer.header("birds_pipeline_queue_capacity", "gauge", "Capacity of a stage's input queue");
+            for (const auto& stage : stages) {
+                writer.sample("birds_pipeline_queue_capacity", static_cast<double>(stage.queueCapacity),
+                              {{"stage", stage.name}});
+            }
+            writer.header("birds_pipeline_queue_high_watermark", "gauge",
+                          "Deepest a stage's input queue has been since startup");
+            for (const auto& stage : stages) {
+                writer.sample("birds_pipeline_queue_high_watermark",
+                              static_cast<double>(stage.queueHighWatermark), {{"stage", stage.name}});
+            }
+            writer.header("birds_frames_dropped_total", "counter",
+                          "Frames shed by backpressure, by the queue they were dropped from");
+            for (const auto& stage : stages) {
+                writer.sample("birds_frames_dropped_total", static_cast<double>(stage.dropped),
+                              {{"stage", stage.name}});
+            }
+
+            const LoadShedder::StreamRate rate = loadShedder.rate(shedStream);
+            const std::string streamName = FrameMetadata().source;
+            writer.header("birds_stream_processing_fps", "gauge",
+                          "Frames processed per second over the last second");
+            writer.sample("birds_stream_processing_fps", rate.processingFps, {{"stream", streamName}});
+            writer.header("birds_stream_frame_stride", "gauge",
+                          "Load shedding: every Nth captured frame is processed (1 = all)");
+            writer.sample("birds_stream_frame_stride", static_cast<double>(rate.stride),
+                          {{"stream", streamName}});
+            writer.header("birds_stream_detection_scale_factor", "gauge",
+                          "Load shedding: multiplier on the configured detection_scale");
+            writer.sample("birds_stream_detection_scale_factor", rate.scaleFactor, {{"stream", streamName}});
+            writer.header("birds_stream_detection_scale", "gauge",
+                          "detection_scale the stream runs at (adaptive_scale times load shedding)");
+            writer.sample("birds_stream_detection_scale", detectionScaleInUse.load(std::memory_order_relaxed),
+                          {{"stream", streamName}});
+            writer.header("birds_stream_frames_skipped_total", "counter", "Captured frames shed by load shedding");
+            writer.sample("birds_stream_frames_skipped_total", static_cast<double>(rate.skipped),
+                          {{"stream", streamName}});
+            writer.gauge("birds_load_shedding_utilization",
+                         "Share of the frame interval the slowest stage needs at the current strides",
+                         loadShedder.utilization());
+
+            const PersistenceStats persistence = persistQueue.getStats();
+            writer.gauge("birds_persistence_queue_depth", "Saves waiting for the persistence worker",
+                         static_cast<double>(persistence.queueDepth));
+            writer.gauge("birds_persistence_queue_high_watermark",
+                         "Deepest the persistence queue has been since startup",
+                         static_cast<double>(persistence.queueHighWatermark));
+            writer.counter("birds_persistence_saved_total", "Frames stored", persistence.saved);
+            writer.counter("birds_persistence_failed_total", "Frames that failed to encode or insert",
+                           persistence.failed);
+            writer.counter("birds_persistence_dropped_total", "Saves shed by the persistence queue",
+                           persistence.dropped);
+            writer.counter("birds_persistence_deduplicated_total",
+                           "Saves skipped because the regions matched the last save",
+                           saveDeduplicator.skipped());
+            writer.counter("birds_persistence_jitter_skipped_total",
+                           "Saves skipped because every region was motion swaying in place (motion_history)",
+                           jitterSavesSkipped.load(std::memory_order_relaxed));
+            writer.counter("birds_persistence_visits_total", "Visit documents queued (visit_aggregation)",
+                           visitsSubmitted.load(std::memory_order_relaxed));
+            writer.counter("birds_persistence_plates_total", "Background plates written (plate_patches)",
+                           persistence.platesWritten);
+            writer.counter("birds_persistence_atlas_sheets_total", "Thumbnail atlas sheets written (thumbnail_atlas)",
+                           persistence.atlasSheets);
+            if (const AsyncFileWriter* fileWriter = persistQueue.fileWriter()) {
+                const FileWriterStats files = fileWriter->getStats();
+                writer.counter("birds_file_writer_files_total", "Image files written by the file writer",
+                               files.filesWritten);
+                writer.counter("birds_file_writer_failed_total", "Image files the file writer failed to write",
+                               files.filesFailed);
+                writer.counter("birds_file_writer_bytes_total", "Bytes written by the file writer",
+                               files.bytesWritten);
+                writer.counter("birds_file_writer_syncs_total", "fdatasync calls (fsync_every)", files.syncs);
+                writer.gauge("birds_file_writer_in_flight", "Files submitted and not yet closed",
+                             static_cast<double>(files.inFlight));
+                writer.gauge("birds_file_writer_in_flight_high_watermark", "Most files in flight since startup",
+                             static_cast<double>(files.inFlightHighWatermark));
+                writer.counter("birds_file_writer_submit_calls_total", "io_uring_enter calls", files.submitCalls);
+                writer.counter("birds_file_writer_sqes_total", "io_uring operations submitted",
+                               files.sqesSubmitted);
+                writer.counter("birds_file_writer_cqes_total", "io_uring completions reaped", files.cqesReaped);
+                writer.gauge("birds_file_writer_sq_high_watermark", "Most io_uring operations in one submit call",
+                             static_cast<double>(files.sqHighWatermark));
+                writer.gauge("birds_file_writer_sq_waiting", "io_uring operations waiting for a submission entry",
+                             static_cast<double>(files.sqWaiting));
+                writer.counter("birds_file_writer_cq_overflows_total", "io_uring completions dropped (CQ full)",
+                               files.cqOverflows);
+                writer.counter("birds_file_writer_fixed_buffer_writes_total",
+                               "io_uring writes from registered buffers", files.fixedBufferWrites);
+            }
+            writer.header("birds_persistence_save_latency_seconds", "histogram",
+                          "Time from save scheduling to stored document");
+            writer.histogramSamples("birds_persistence_save_latency_seconds", persistQueue.endToEndLatency());
+
+            writer.header("birds_stage_latency_seconds", "histogram",
+                          "Per-stage processing latency (ENABLE_STAGE_TIMING builds only)");
+            writeStageTimings(writer, "detect", motionProcessor.getStageTimings());
+            writeStageTimings(writer, "consolidate", regionConsolidator.getStageTimings());
+            writeStageTimings(writer, "render", renderTimings);
+
+            const ClipRecorderStats clipStats = clipRecorder.getStats();
+            writer.counter("birds_event_clips_total", "Event clips written", clipStats.clipsWritten);
+            writer.counter("birds_event_clip_frames_dropped_total",
+                           "Frames shed by the clip recorder queue", clipStats.framesDropped);
+            writer.gauge("birds_event_clip_preroll_bytes", "JPEG bytes held for the clip pre-roll",
+                         static_cast<double>(clipStats.preRollBytes));
+            const PassthroughStats passthroughStats = passthroughRecorder.getStats();
+            writer.counter("birds_passthrough_segments_total", "Remuxed event segments written",
+                           passthroughStats.segmentsWritten);
+            writer.gauge("birds_passthrough_preroll_bytes",
+                         "Compressed camera packets held for the pass-through pre-roll",
+                         static_cast<double>(passthroughStats.bufferedBytes));
+
+            writer.counter("birds_capture_buffer_allocations_total",
+                           "Frame buffers allocated by the capture pool (0 growth = fully recycled)",
+                           cap.bufferPool().allocations());
+            writer.counter("birds_capture_vector_skipped_frames_total",
+                           "Decoded frames dropped at capture because their motion vectors showed no motion",
+                           cap.vectorSkippedFrames());
+            writer.counter("birds_overlay_buffer_allocations_total",
+                           "Overlay canvases allocated by the render stage pool",
+                           overlayPool.allocations());
+            writer.counter("birds_background_model_resets_total",
+                           "MOG2 background models rebuilt after the first",
+                           motionProcessor.getBackgroundModelResets());
+            writer.counter("birds_flood_frames_total",
+                           "Frames the flood guard suppressed as an illumination change or camera shake",
+                           motionProcessor.getFloodFrameCount());
+            writer.counter("birds_roi_predicted_frames_total",
+                           "Frames detected only in the windows around the last boxes (roi_prediction)",
+                           motionProcessor.getPredictedFrameCount());
+            writer.counter("birds_shift_compensated_frames_total",
+                           "Frames whose camera shift the flood guard compensated",
+                           motionProcessor.getShiftCompensatedFrameCount());
+            writer.gauge("process_resident_memory_bytes", "Resident memory size in bytes",
+                         static_cast<double>(PipelineMetrics::residentMemoryBytes()));
+            return writer.text();
+        },
+        metricsPort, metricsBindAddress, &ioReactor);
+    if (metricsEnabled && !metricsServer.start()) {
+        LOG_WARN("Continuing without the /metrics endpoint");
+    }
+    if (previewEnabled && !previewServer.start()) {
+        LOG_WARN("Continuing without the live preview");
+    }
+
+    // Live reload: file changes (config_reload.watch_file) and SIGHUP publish a new snapshot
+    // to sharedConfig. Only the detection and consolidation settings take effect live;
+    // capture, pipeline and persistence sections are read once at startup.
+    ConfigWatchOptions watchOptions;
+    if (const YAML::Node reloadNode = config["config_reload"]) {
+        if (reloadNode["watch_file"]) watchOptions.watchFile = reloadNode["watch_file"].as<bool>();
+        if (reloadNode["poll_interval_ms"]) {
+            watchOptions.pollInterval = std::chrono::milliseconds(reloadNode["poll_interval_ms"].as<int>());
+        }
+    }
+    ConfigWatcher configWatcher(sharedConfig, watchOptions);
+
+    if (handoffConfig.enabled && !handoffListener.start()) {
+        LOG_WARN("Continuing without restart handoff");
+    }
+
+    {
+        persistQueue.start();
+        clipRecorder.start(sourceFps);
+        passthroughRecorder.start();
+        processingPipeline.start();
+
+        // Stage 0: capture (own thread so a slow consumer never stalls the camera read)
+        std::thread captureThread([&] {
+            setupCurrentThread(threadSettings, "capture");
+            const auto handOn = [&](FramePacket&& packet) {
+                if (latestFrameOnly) {
+                    latestFrame.publish(std::move(packet));
+                } else {
+                    processingPipeline.submit(std::move(packet));
+                }
+            };
+            // Frames captured asleep, processed first on wake
+            std::deque<FramePacket> preRoll;
+            const bool wakeGate = wakeConfig.source != WakeSource::Gpio;
+            while (!stopCapture) {
+                FramePacket packet;
+                if (!cap.read(packet.frame) || packet.frame.empty()) {
+                    if (cap.isLive()) {
+                        std::cerr << "Error: Could not read frame from camera." << std::endl;
+                    }
+                    LOG_INFO("Capture finished after {} frames", framesCaptured.load());
+                    break;
+                }
+                packet.frameIndex = ++framesCaptured;
+                packet.trace.captured = std::chrono::steady_clock::now();
+                packet.trace.captureUnixUs = unixMicrosNow();
+                packet.trace.sourceTimestampMs = cap.lastTimestampMs();
+                if (wakeController) {
+                    cv::Mat gateView;  // The gate only looks at frames captured asleep
+                    if (wakeGate && !wakeController->isAwake()) {
+                        if (packet.frame.channels() == 1) {
+                            gateView = packet.frame;
+                        } else {
+                            cv::cvtColor(packet.frame, gateView, cv::COLOR_BGR2GRAY);
                         }
-                        metadata += "]";
-                    } else {
-                        metadata += ",\"consolidated_regions\":[]";
                     }
-
-                    metadata += "}";
-
-                    // Try to save both original and processed frames to MongoDB using Python
-                    // bindings
-                    std::string result = save_frames_to_mongodb(frame, mongoFrame, metadata);
-                    if (!result.empty()) {
-                        std::cout << "💾 Frame saved to MongoDB with UUID: " << result << std::endl;
-                        LOG_INFO("Frame saved to MongoDB: {}", result);
-                    } else {
-                        std::cout << "❌ Failed to save frame to MongoDB" << std::endl;
-                        LOG_ERROR("Failed to save frame to MongoDB");
+                    const WakeController::Transition transition = wakeController->onFrame(gateView, packet.trace.captured);
+                    if (transition == WakeController::Transition::Woke) {
+                        preRoll.push_back(std::move(packet));
+                        // The mailbox keeps only the newest frame, so a pre-roll would be dropped anyway
+                        if (latestFrameOnly) preRoll.erase(preRoll.begin(), preRoll.end() - 1);
+                        preRoll.front().wakeReset = true;
+                        LOG_INFO("Wake trigger: awake, processing {} pre-roll frame(s)", preRoll.size());
+                        for (FramePacket& held : preRoll) handOn(std::move(held));
+                        preRoll.clear();
+                        continue;
+                    }
+                    if (transition == WakeController::Transition::Slept) {
+                        LOG_INFO("Wake trigger: asleep after {:.0f} s without activity", wakeConfig.awakeHoldSeconds);
+                        packet.sleepAfter = true;
+                        handOn(std::move(packet));
+                        wakeController->waitForNextFrame();
+                        continue;
+                    }
+                    if (!wakeController->isAwake()) {
+                        preRoll.push_back(std::move(packet));
+                        if (preRoll.size() > wakeConfig.preRollFrames) preRoll.pop_front();
+                        wakeController->waitForNextFrame();
+                        continue;
+                    }
+                }
+                if (profileScheduler) {
+                    if (profileScheduler->update(std::time(nullptr), packet.trace.captured)) {
+                        applyProfile(profileScheduler->current());
                     }
+                    if (!profileScheduler->admit(packet.trace.captured)) continue;  // Profile's max_fps
+                }
+                // Shed while overloaded; the decode_ahead backend sheds in the decoder already,
+                // and the frames it left out count towards the stride
+                cap.setDecodeStride(loadShedder.rate(shedStream).stride);
+                if (!loadShedder.shouldProcess(shedStream, 1 + cap.lastSkippedFrames())) continue;
+                handOn(std::move(packet));
+            }
+            if (latestFrameOnly) latestFrame.close();
+            processingPipeline.closeInput();
+        });
 
-                } catch (const std::exception& e) {
-                    std::cerr << "Error saving frame: " << e.what() << std::endl;
-                    LOG_ERROR("Error saving frame to MongoDB: {}", e.what());
+        // Loop until 'q' or ESC is pressed, or a shutdown signal arrives
+        while (key != 'q' && key != 27 && !shutdownRequested) {
+            if (configReloadRequested) {
+                configReloadRequested = 0;
+                configWatcher.requestReload();
+            }
+            if (clusteringTraceDumpRequested) {
+                clusteringTraceDumpRequested = 0;
+                if (consolidationConfig.clusteringTraceCapacity > 0) {
+                    // Written by the consolidate stage before its next frame
+                    regionConsolidator.clusteringTrace().requestDump(consolidationConfig.clusteringTracePath);
+                } else {
+                    LOG_WARN("SIGUSR1: clustering_trace_capacity is 0, no clustering trace to write");
                 }
-            } else {
-                // Frame skipped because no consolidated regions and save_only_consolidated_regions
-                // is enabled
-                LOG_DEBUG(
-                    "Frame {} skipped - no consolidated regions "
-                    "(save_only_consolidated_regions=true)",
-                    frameCount);
-                std::cout << "⏭️  Frame skipped - no consolidated regions" << std::endl;
+            }
+            if (handoffListener.requested() && !stopCapture) {
+                // Frames in flight still go through every stage, then the loop ends below
+                LOG_INFO("Handoff: stopping capture for the new instance");
+                stopCapture = true;
+            }
+            if (flightRecorderDumpRequested) {
+                flightRecorderDumpRequested = 0;
+                if (!flightRecorder.requestDump("signal")) {
+                    LOG_WARN("SIGUSR2: flight recorder disabled, empty or already dumping");
+                }
+            }
+            auto packet = processingPipeline.popOutputFor(std::chrono::milliseconds(50));
+            if (!packet) {
+                if (processingPipeline.isFinished()) break;  // End of stream
+                if (!headless) key = static_cast<char>(cv::waitKey(1));
+                continue;
             }
 
-            lastSaveTime = currentTime;
-        }
+            frameCount++;
+            packet->trace.delivered = std::chrono::steady_clock::now();
+            pipelineMetrics.recordLatency(packet->trace);
+            traceRecorder.record(packet->frameIndex, packet->trace);
+            flightRecorder.recordLatency(packet->frameIndex, packet->trace.sinceCaptureMs(packet->trace.delivered));
+
+            // Periodic per-stage queue depth report
+            if (statsIntervalFrames > 0 && frameCount % statsIntervalFrames == 0) {
+                logPipelineStats("Processing", processingPipeline);
+                logPersistenceStats(persistQueue);
+                const LoadShedder::StreamRate rate = loadShedder.rate(shedStream);
+                LOG_INFO("Processing rate: {:.1f} fps, {:.1f} ms/frame | every {} frame(s) at {:.2f}x "
+                         "detection scale | {} frames shed",
+                         rate.processingFps, rate.processingMs, rate.stride, rate.scaleFactor, rate.skipped);
+                if (latestFrameOnly) {
+                    LOG_INFO("Latest-frame capture: {} frames taken, {} skipped as stale", latestFrame.takenCount(),
+                             latestFrame.overwrittenCount());
+                }
+            }
+            if (headless) continue;  // Saves were queued by the render stage
+
+            cv::Mat& displayFrame = packet->displayFrame;
+            // The OpenGL window draws from the packet; the demo video still needs the pixels
+            if (glWindowOpen && (recordingActive || (recordingEnabled && !recordingStarted &&
+                                                     !packet->consolidatedRegions.empty()))) {
+                displayFrame = composeWindowFrame(*packet);
+            }
+
+            // Initialize video writer on first frame with motion (only once per session)
+            if (recordingEnabled && !recordingStarted && !packet->consolidatedRegions.empty()) {
+                cv::Size frameSize = displayFrame.size();
+                
+                // Initialize video writer (H.264 codec for web compatibility)
+                int fourcc = cv::VideoWriter::fourcc('a', 'v', 'c', '1');  // H.264 codec
+                videoWriter.open(outputVideoPath, fourcc, sourceFps, frameSize, true);
+                
+                if (videoWriter.isOpened()) {
+                    recordingStarted = true;
+                    recordingActive = true;
+                    LOG_INFO("📹 Started recording demo video: {} ({}x{} @ {} fps)", 
+                             outputVideoPath, frameSize.width, frameSize.height, sourceFps);
+                    std::cout << "\n🔴 Recording demo video: " << outputVideoPath << std::endl;
+                    std::cout << "   Will capture up to " << (maxRecordingFrames / sourceFps)
+                              << " seconds" << std::endl;
+                } else {
+                    LOG_ERROR("Failed to open video writer for {}", outputVideoPath);
+                }
+            }
 
-        // Add status overlay (position depends on recording status)
-        int statusY = recordingActive ? 60 : 30;  // Move down if recording indicator is present
-        std::string status =
-            "Frame: " + std::to_string(frameCount) +
-            " | Motions: " + std::to_string(processingResult.detectedBounds.size()) +
-            " | Regions: " + std::to_string(consolidatedRegions.size());
-        cv::putText(displayFrame, status, cv::Point(10, statusY), cv::FONT_HERSHEY_SIMPLEX, 0.7,
-                    cv::Scalar(255, 255, 255), 2);
+            // Add recording indicator and write frames if actively recording
+            std::string recordingText;
+            if (recordingActive) {
+                recordingText = "REC [" + std::to_string(recordedFrames) + "/" + 
+                                           std::to_string(maxRecordingFrames) + "]";
+                cv::putText(displayFrame, recordingText, cv::Point(10, 30),
+                           cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0, 0, 255), 2);
+                
+                // Write frame to video
+                videoWriter.write(displayFrame);
+                recordedFrames++;
+                
+                // Stop recording after max frames
+                if (recordedFrames >= maxRecordingFrames) {
+                    videoWriter.release();
+                    recordingActive = false;
+                    LOG_INFO("✅ Demo video recording completed: {} ({} frames)", 
+                             outputVideoPath, recordedFrames);
+                    std::cout << "\n✅ Demo video saved: " << outputVideoPath << std::endl;
+                    std::cout << "   " << recordedFrames << " frames recorded" << std::endl;
+                    std::cout << "   🎬 Recording complete! Press 'q' to exit or continue watching..." << std::endl;
+                    
+                    // Auto-exit after recording is complete
+                    key = 'q';
+                }
+            }
 
-        // Add legend
-        cv::putText(displayFrame, "Gray: Individual Motion | Red: Consolidated Regions",
-                    cv::Point(10, displayFrame.rows - 20), cv::FONT_HERSHEY_SIMPLEX, 0.6,
-                    cv::Scalar(255, 255, 255), 2);
+            // Show the live feed
+            if (glWindowOpen) {
+                buildWindowOverlay(*packet, windowOverlay);
+                if (!recordingText.empty()) {
+                    windowOverlay.texts.push_back({recordingText, cv::Point(10, 30), cv::Scalar(0, 0, 255), 0.8, 2});
+                }
+                glWindow.show(packet->frame, windowOverlay);
+            } else {
+                cv::imshow(kWindowTitle, displayFrame);
+            }
+            char pressed = static_cast<char>(cv::waitKey(1));
+            if (key != 'q') key = pressed;
 
-        // Show the live feed
-        cv::imshow("🐦 Birds of Play - Motion Detection", displayFrame);
-        key = cv::waitKey(1);
+            // Handle 's' key to save current frame
+            if (key == 's' || key == 'S') {
+                // Create frames directory if it doesn't exist
+                fs::create_directories("frames");
+                std::string saveFileName =
+                    "frames/saved_detection_frame_" + std::to_string(packet->frameIndex) + ".jpg";
+                if (displayFrame.empty()) displayFrame = composeWindowFrame(*packet);  // OpenGL window
+                cv::imwrite(saveFileName, displayFrame);
+                std::cout << "💾 Saved current frame to: " << saveFileName << std::endl;
+                LOG_INFO("User saved frame: {}", saveFileName);
+            }
+        }
+        if (shutdownRequested) LOG_INFO("Shutdown signal received, stopping pipeline");
 
-        // Handle 's' key to save current frame
-        if (key == 's' || key == 'S') {
-            // Create frames directory if it doesn't exist
-            fs::create_directories("frames");
-            std::string saveFileName =
-                "frames/saved_detection_frame_" + std::to_string(frameCount) + ".jpg";
-            cv::imwrite(saveFileName, displayFrame);
-            std::cout << "💾 Saved current frame to: " << saveFileName << std::endl;
-            LOG_INFO("User saved frame: {}", saveFileName);
+        // Shut down: stop capture, abandon in-flight frames, finish pending saves
+        stopCapture = true;
+        latestFrame.close();  // Wakes the detect stage if it waits for a frame
+        processingPipeline.stop();
+        captureThread.join();
+        metricsServer.stop();
+        ioReactor.stop();
+        previewServer.stop();
+        // Handoff: the stages stopped between two frames. The device is released first, so
+        // the successor can open it as soon as it has the state
+        const bool handingOver = handoffListener.requested();
+        if (handingOver) {
+            const StreamState state = captureStreamState(motionProcessor, &regionConsolidator,
+                                                         trackerEnabled ? &objectTracker : nullptr);
+            cap.release();
+            if (handoffListener.sendState(encodeStreamState(state))) {
+                LOG_INFO("Handoff: state of {} region(s) and {} track(s) sent; saving the queued frames",
+                         state.regions.size(), state.tracks.size());
+            }
+        }
+        // The detect stage has stopped, so the model can be read; the next start warms up from it
+        if (motionProcessor.saveBackgroundSnapshot()) {
+            LOG_INFO("Background snapshot saved to {}", motionProcessor.getBackgroundSnapshotPath());
+        }
+        logPipelineStats("Processing", processingPipeline);
+        LOG_INFO("Frame latency, capture to output: {}", pipelineMetrics.endToEndLatency().summary());
+        traceRecorder.finish();  // A window still open at shutdown
+        if (boxCapture) boxCapture->close();  // Writes the final counts into its header
+        eventPublisher.reset();  // Publishes the last batch and logs the totals
+        // The render stage has stopped; the minute in progress goes out with the last saves
+        if (auto summary = motionStats.flush()) persistQueue.submitSummary(std::move(*summary));
+        if (visitConfig.enabled) {
+            // Visits still open are stored as they are: they end with the run
+            for (Visit& visit : visitAggregator.takeAll()) {
+                if (submitVisit(persistQueue, std::move(visit))) {
+                    visitsSubmitted.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            LOG_INFO("Visit aggregation: {} frames with regions stored as {} visit documents",
+                     visitAggregator.framesWithRegions(), visitsSubmitted.load(std::memory_order_relaxed));
+        }
+        persistQueue.drain();  // Also writes the detection log's last row group
+        if (handingOver) handoffListener.sendReleased();  // The storage is the successor's now
+        handoffListener.stop();
+        logPersistenceStats(persistQueue);
+        if (const AsyncFileWriter* fileWriter = persistQueue.fileWriter()) {
+            const FileWriterStats files = fileWriter->getStats();
+            LOG_INFO("File writer ({}): {} files | {} failed | {} bytes | {} syncs | {} submit calls for {} "
+                     "operations (most {} at once) | {} fixed-buffer writes | {} CQ overflows",
+                     fileWriterBackendName(files.backend), files.filesWritten, files.filesFailed,
+                     files.bytesWritten, files.syncs, files.submitCalls, files.sqesSubmitted,
+                     files.sqHighWatermark, files.fixedBufferWrites, files.cqOverflows);
+        }
+        if (detectionLog) {
+            const DetectionLogStats logStats = detectionLog->getStats();
+            LOG_INFO("Detection log: {} frames in {} row groups | {} bytes | {} write failures",
+                     logStats.framesWritten, logStats.rowGroupsWritten, logStats.bytesWritten,
+                     logStats.writeFailures);
+        }
+        if (passthroughRecorder.isEnabled()) {
+            passthroughRecorder.stop();  // Closes a segment still in progress, with its sidecar
+            const PassthroughStats passthroughStats = passthroughRecorder.getStats();
+            LOG_INFO("Pass-through recording: {} segments | {} packets",
+                     passthroughStats.segmentsWritten, passthroughStats.packetsWritten);
+        }
+        if (regionClassifier.isEnabled()) {
+            // Read after the pipeline stopped: the consolidate stage owns the classifier
+            const RegionClassifierStats& classifierStats = regionClassifier.getStats();
+            LOG_INFO("Region classifier: {} regions in {} inputs, {} batches | {} labelled | {} skipped | "
+                     "{} deferred | {} failures",
+                     classifierStats.classified, classifierStats.tiles, classifierStats.batches,
+                     classifierStats.labelled, classifierStats.skipped, classifierStats.deferred,
+                     classifierStats.failures);
+            const ClassificationCacheStats& cacheStats = regionClassifier.getCacheStats();
+            LOG_INFO("Classification cache: {} hits | {} new tracks | {} retries | {} refreshes",
+                     cacheStats.hits, cacheStats.newTracks, cacheStats.retries, cacheStats.refreshes);
+        }
+        if (clipRecorder.isEnabled()) {
+            clipRecorder.stop();  // Finishes the clip of an event still in progress
+            const ClipRecorderStats clipStats = clipRecorder.getStats();
+            LOG_INFO("Event clips: {} written | {} frames | {} dropped", clipStats.clipsWritten,
+                     clipStats.framesWritten, clipStats.framesDropped);
         }
+        logStageTimings("Detect", motionProcessor.getStageTimings());
+        logStageTimings("Consolidate", regionConsolidator.getStageTimings());
+        logStageTimings("Render", renderTimings);
     }
 
     // Cleanup
     cap.release();
-    cv::destroyAllWindows();
+    glWindow.close();
+    if (!headless) cv::destroyAllWindows();
     
     // Finalize video recording if still open
     if (videoWriter.isOpened()) {
@@ -459,11 +2177,14 @@ int main(int argc, char** argv) {
     }
 
     std::cout << "\n👋 Birds of Play Motion Detection Demo ended." << std::endl;
-    std::cout << "📊 Processed " << frameCount << " frames total." << std::endl;
+    std::cout << "📊 Processed " << frameCount << " of " << framesCaptured.load()
+              << " captured frames." << std::endl;
     if (recordedFrames > 0) {
         std::cout << "🎥 Recorded " << recordedFrames << " frames to demo video" << std::endl;
     }
-    LOG_INFO("Application ended after processing {} frames", frameCount);
+    LOG_INFO("Application ended after processing {} of {} captured frames", frameCount,
+             framesCaptured.load());
 
+    spdlog::shutdown();  // Drains the async logger queue, if any
     return 0;
 }
@@ -108,54 +108,44 @@ def run_with_python_bindings(video_source=None):
     try:
         import birds_of_play_python
         import cv2
-        import numpy as np
-        
-        # Create motion processor
-        processor = birds_of_play_python.MotionProcessor()
         
         if video_source is None:
-            # Use webcam
-            cap = cv2.VideoCapture(0)
             print("📹 Using webcam")
         else:
-            # Use video file
-            cap = cv2.VideoCapture(video_source)
             print(f"🎬 Processing video: {video_source}")
-        
-        if not cap.isOpened():
-            print("❌ Could not open video source")
+
+        # Capture, detection and consolidation run on native threads; Python only sees
+        # the frames that have consolidated regions
+        config_path = os.path.join("src", "motion_detection", "config.yaml")
+        try:
+            pipeline = birds_of_play_python.Pipeline(config_path, video_source or "",
+                                                     drop_when_full=video_source is None)
+        except RuntimeError as e:
+            print(f"❌ Could not open video source: {e}")
             return False
-        
-        print("⌨️  Press 'q' to quit, 's' to save frame")
-        
+
+        print("⌨️  Press 'q' to quit")
+
         frame_count = 0
-        while True:
-            ret, frame = cap.read()
-            if not ret:
-                break
-            
-            # Process frame with motion detection
-            processed_frame = processor.process_frame(frame)
-            
-            # Convert back to BGR for display
-            if len(processed_frame.shape) == 3 and processed_frame.shape[2] == 1:
-                processed_frame = cv2.cvtColor(processed_frame, cv2.COLOR_GRAY2BGR)
-            
-            # Display both original and processed frames
-            combined = np.hstack([frame, processed_frame])
-            cv2.imshow('Birds of Play - Python Bindings (Original | Processed)', combined)
-            
-            frame_count += 1
-            if frame_count % 30 == 0:
-                print(f"📊 Processed {frame_count} frames...")
-            
-            # Check for quit key
-            if cv2.waitKey(1) & 0xFF == ord('q'):
-                break
-        
-        cap.release()
+        with pipeline:
+            for event in pipeline:
+                frame = event["frame"].copy()  # The event's frame is the capture buffer itself
+                for region in event["regions"]:
+                    x, y, w, h = int(region["x"]), int(region["y"]), int(region["width"]), int(region["height"])
+                    cv2.rectangle(frame, (x, y), (x + w, y + h), (0, 255, 0), 2)
+                cv2.imshow('Birds of Play - Python Bindings (Motion Regions)', frame)
+
+                frame_count += 1
+                if frame_count % 30 == 0:
+                    stats = event["stats"]
+                    print(f"📊 {stats['frames_processed']} frames processed, {frame_count} with motion "
+                          f"({stats['processed_fps']:.1f} fps)")
+
+                if cv2.waitKey(1) & 0xFF == ord('q'):
+                    break
+
         cv2.destroyAllWindows()
-        print(f"✅ Python bindings processing complete. Processed {frame_count} frames.")
+        print(f"✅ Python bindings processing complete. {frame_count} frames with motion.")
         return True
         
     except ImportError as e:
@@ -3,17 +3,59 @@ File Storage Manager for Birds of Play
 
 Handles efficient local file storage of images with UUID-based organization.
 This replaces the inefficient base64 storage in MongoDB documents.
+
+Layout: <base>/<type>/YYYY/MM/DD/HH/<uuid>.jpg, partitioned by the UTC hour the image was
+written, so no directory grows past one hour of frames and retention deletes whole hour
+directories. An SQLite index (<base>/index.sqlite3) maps each UUID to its partition and
+keeps per-type file counts and sizes. Frames from the old flat layout (<type>/<uuid>.jpg)
+are still found.
+
+The C++ writer can instead append images to rolling segment files (<base>/segments/
+segment_<n>.seg, see FrameSegmentStore); their documents carry {file, offset, length}
+extents, read with read_segment().
+
+load_frame_regions() decodes just the regions of a stored frame; with the native module
+(birds_of_play_python) only the JPEG blocks covering them are decoded, at a reduced DCT
+scale when the caller needs less than full resolution.
 """
 
 import os
+import mmap
 import uuid
 import shutil
+import sqlite3
 import logging
+import threading
 from pathlib import Path
-from typing import Optional, Dict, Any, Tuple
+from typing import Optional, Dict, Any, Tuple, List
 import cv2
 import numpy as np
-from datetime import datetime
+from datetime import datetime, timedelta, timezone
+
+try:
+    from birds_of_play_python import decode_jpeg_regions
+except ImportError:  # Native module not built: regions are cut from full decodes
+    decode_jpeg_regions = None
+
+# Image types and their directory under the base path
+IMAGE_TYPE_DIRS = {
+    "original": "original",
+    "processed": "processed",
+    "original_thumbnail": "original_thumbnails",
+    "processed_thumbnail": "processed_thumbnails",
+}
+
+# strftime pattern of a partition directory (relative to the type directory)
+PARTITION_FORMAT = "%Y/%m/%d/%H"
+
+
+def partition_for(timestamp: Optional[datetime] = None) -> str:
+    """Partition (YYYY/MM/DD/HH, UTC) an image written at timestamp (default: now) belongs to."""
+    timestamp = timestamp or datetime.now(timezone.utc)
+    if timestamp.tzinfo is not None:
+        timestamp = timestamp.astimezone(timezone.utc)
+    return timestamp.strftime(PARTITION_FORMAT)
+
 
 class FileStorageManager:
     """Manages local file storage for frame images with UUID-based organization."""
@@ -30,11 +72,18 @@ class FileStorageManager:
         self.processed_path = self.base_path / "processed"
         self.original_thumbnails_path = self.base_path / "original_thumbnails"
         self.processed_thumbnails_path = self.base_path / "processed_thumbnails"
+        self.segments_path = self.base_path / "segments"
+        self.plates_path = self.base_path / "plates"
         self.logger = logging.getLogger(__name__)
         
         # Create directory structure
         self._ensure_directories()
         
+        # UUID -> partition index with maintained counters; one connection shared by the
+        # threads of a bulk save, serialized by the lock
+        self._index_lock = threading.Lock()
+        self._open_index()
+        
     def _ensure_directories(self):
         """Ensure all required directories exist."""
         try:
@@ -47,6 +96,178 @@ class FileStorageManager:
             self.logger.error(f"Failed to create storage directories: {e}")
             raise
     
+    def _open_index(self):
+        """Open (or create) the partition index; a new index is filled from the files on disk."""
+        index_path = self.base_path / "index.sqlite3"
+        is_new = not index_path.exists()
+        self._index = sqlite3.connect(str(index_path), check_same_thread=False, isolation_level=None)
+        self._index.execute("PRAGMA journal_mode=WAL")
+        self._index.execute("PRAGMA synchronous=NORMAL")
+        self._index.execute(
+            "CREATE TABLE IF NOT EXISTS files ("
+            " uuid TEXT NOT NULL, image_type TEXT NOT NULL, partition TEXT NOT NULL,"
+            " size_bytes INTEGER NOT NULL, PRIMARY KEY (uuid, image_type))"
+        )
+        self._index.execute("CREATE INDEX IF NOT EXISTS files_partition ON files (partition)")
+        self._index.execute(
+            "CREATE TABLE IF NOT EXISTS counters ("
+            " image_type TEXT PRIMARY KEY, file_count INTEGER NOT NULL, size_bytes INTEGER NOT NULL)"
+        )
+        if is_new:
+            self.rebuild_index()
+    
+    def _type_dir(self, image_type: str) -> Path:
+        if image_type not in IMAGE_TYPE_DIRS:
+            raise ValueError(f"Invalid image_type: {image_type}")
+        return self.base_path / IMAGE_TYPE_DIRS[image_type]
+    
+    def _file_path(self, frame_uuid: str, image_type: str) -> Path:
+        """Where an image lives: its indexed partition, else the flat legacy path."""
+        with self._index_lock:
+            row = self._index.execute(
+                "SELECT partition FROM files WHERE uuid = ? AND image_type = ?", (frame_uuid, image_type)
+            ).fetchone()
+        type_dir = self._type_dir(image_type)
+        if row:
+            return type_dir / row[0] / f"{frame_uuid}.jpg" if row[0] else type_dir / f"{frame_uuid}.jpg"
+        flat_path = type_dir / f"{frame_uuid}.jpg"
+        if flat_path.exists():
+            return flat_path
+        # Written by a writer that does not update the index (the native C++ FrameStore):
+        # search the partitions once and index what is found
+        for found in type_dir.glob(f"*/*/*/*/{frame_uuid}.jpg"):
+            self.register_files([(frame_uuid, image_type, str(found))])
+            return found
+        return flat_path
+    
+    def _new_file_path(self, frame_uuid: str, image_type: str) -> Tuple[Path, str]:
+        """Path in the current hour's partition for a new image (the directory is created)."""
+        partition = partition_for()
+        directory = self._type_dir(image_type) / partition
+        directory.mkdir(parents=True, exist_ok=True)
+        return directory / f"{frame_uuid}.jpg", partition
+    
+    def _record_file(self, frame_uuid: str, image_type: str, partition: str, size_bytes: int):
+        self._record_files([(frame_uuid, image_type, partition, size_bytes)])
+    
+    def _record_files(self, entries: List[Tuple[str, str, str, int]]):
+        """Add (or replace) index entries and update the counters in one transaction."""
+        with self._index_lock:
+            self._index.execute("BEGIN")
+            try:
+                for frame_uuid, image_type, partition, size_bytes in entries:
+                    previous = self._index.execute(
+                        "SELECT size_bytes FROM files WHERE uuid = ? AND image_type = ?", (frame_uuid, image_type)
+                    ).fetchone()
+                    self._index.execute(
+                        "INSERT OR REPLACE INTO files (uuid, image_type, partition, size_bytes) VALUES (?, ?, ?, ?)",
+                        (frame_uuid, image_type, partition, size_bytes),
+                    )
+                    self._add_to_counters(image_type, 0 if previous else 1,
+                                          size_bytes - (previous[0] if previous else 0))
+                self._index.execute("COMMIT")
+            except Exception:
+                self._index.execute("ROLLBACK")
+                raise
+    
+    def _forget_file(self, frame_uuid: str, image_type: str):
+        """Remove an index entry and update the counters (no-op for unindexed files)."""
+        with self._index_lock:
+            self._index.execute("BEGIN")
+            try:
+                row = self._index.execute(
+                    "SELECT size_bytes FROM files WHERE uuid = ? AND image_type = ?", (frame_uuid, image_type)
+                ).fetchone()
+                if row:
+                    self._index.execute(
+                        "DELETE FROM files WHERE uuid = ? AND image_type = ?", (frame_uuid, image_type)
+                    )
+                    self._add_to_counters(image_type, -1, -row[0])
+                self._index.execute("COMMIT")
+            except Exception:
+                self._index.execute("ROLLBACK")
+                raise
+    
+    def _add_to_counters(self, image_type: str, file_delta: int, size_delta: int):
+        self._index.execute(
+            "INSERT INTO counters (image_type, file_count, size_bytes) VALUES (?, ?, ?) "
+            "ON CONFLICT(image_type) DO UPDATE SET file_count = file_count + excluded.file_count, "
+            "size_bytes = size_bytes + excluded.size_bytes",
+            (image_type, file_delta, size_delta),
+        )
+    
+    def _delete_file(self, frame_uuid: str, image_type: str, label: str) -> bool:
+        """Delete one image and its index entry; False if it was not on disk."""
+        file_path = self._file_path(frame_uuid, image_type)
+        self._forget_file(frame_uuid, image_type)
+        if file_path.exists():
+            file_path.unlink()
+            self.logger.debug(f"Deleted {label}: {file_path}")
+            return True
+        self.logger.warning(f"{label.capitalize()} not found: {file_path}")
+        return False
+    
+    def register_files(self, files: List[Tuple[str, str, str]]) -> int:
+        """
+        Index images written by another writer (the C++ FrameFileStorage) with this layout.
+        
+        Args:
+            files: (frame_uuid, image_type, file_path) tuples; image_type is "original",
+                   "processed", "original_thumbnail" or "processed_thumbnail"
+            
+        Returns:
+            Number of files indexed (files outside the storage tree are skipped)
+        """
+        entries = []
+        for frame_uuid, image_type, file_path in files:
+            try:
+                path = Path(file_path)
+                relative = path.parent.relative_to(self._type_dir(image_type))
+                partition = relative.as_posix() if relative.parts else ""
+                entries.append((frame_uuid, image_type, partition, path.stat().st_size))
+            except (ValueError, OSError) as e:
+                self.logger.warning(f"Could not index {image_type} image {file_path}: {e}")
+        if entries:
+            self._record_files(entries)
+        return len(entries)
+    
+    def rebuild_index(self) -> int:
+        """
+        Rebuild the index and counters by walking the storage tree (new or damaged index).
+        
+        Returns:
+            Number of images indexed
+        """
+        entries = []
+        for image_type in IMAGE_TYPE_DIRS:
+            type_dir = self._type_dir(image_type)
+            if not type_dir.exists():
+                continue
+            for file_path in type_dir.rglob("*.jpg"):
+                partition = file_path.parent.relative_to(type_dir).as_posix()
+                entries.append((file_path.stem, image_type, "" if partition == "." else partition,
+                                file_path.stat().st_size))
+        with self._index_lock:
+            self._index.execute("BEGIN")
+            try:
+                self._index.execute("DELETE FROM files")
+                self._index.execute("DELETE FROM counters")
+                self._index.executemany(
+                    "INSERT OR REPLACE INTO files (uuid, image_type, partition, size_bytes) VALUES (?, ?, ?, ?)",
+                    entries,
+                )
+                self._index.execute(
+                    "INSERT INTO counters (image_type, file_count, size_bytes) "
+                    "SELECT image_type, COUNT(*), SUM(size_bytes) FROM files GROUP BY image_type"
+                )
+                self._index.execute("COMMIT")
+            except Exception:
+                self._index.execute("ROLLBACK")
+                raise
+        if entries:
+            self.logger.info(f"Indexed {len(entries)} stored images")
+        return len(entries)
+    
     def save_frame(self, frame: np.ndarray, frame_uuid: str, 
                    image_type: str = "processed", quality: int = 95) -> Optional[str]:
         """
@@ -62,23 +283,18 @@ class FileStorageManager:
             Path to saved image file or None if failed
         """
         try:
-            # Determine storage path
-            if image_type == "original":
-                storage_path = self.original_path
-            elif image_type == "processed":
-                storage_path = self.processed_path
-            else:
+            if image_type not in ("original", "processed"):
                 raise ValueError(f"Invalid image_type: {image_type}")
             
-            # Create filename with UUID
-            filename = f"{frame_uuid}.jpg"
-            file_path = storage_path / filename
+            # Current hour's partition
+            file_path, partition = self._new_file_path(frame_uuid, image_type)
             
             # Save image with specified quality
             success = cv2.imwrite(str(file_path), frame, 
                                 [cv2.IMWRITE_JPEG_QUALITY, quality])
             
             if success:
+                self._record_file(frame_uuid, image_type, partition, file_path.stat().st_size)
                 self.logger.debug(f"Saved {image_type} frame: {file_path}")
                 return str(file_path)
             else:
@@ -104,17 +320,11 @@ class FileStorageManager:
             Path to saved thumbnail file or None if failed
         """
         try:
-            # Determine storage path
-            if image_type == "original":
-                storage_path = self.original_thumbnails_path
-            elif image_type == "processed":
-                storage_path = self.processed_thumbnails_path
-            else:
+            if image_type not in ("original", "processed"):
                 raise ValueError(f"Invalid image_type: {image_type}")
             
-            # Create filename with UUID
-            filename = f"{frame_uuid}.jpg"
-            file_path = storage_path / filename
+            # Current hour's partition
+            file_path, partition = self._new_file_path(frame_uuid, f"{image_type}_thumbnail")
             
             # Resize frame to thumbnail size
             thumbnail = cv2.resize(frame, thumbnail_size, interpolation=cv2.INTER_AREA)
@@ -124,6 +334,7 @@ class FileStorageManager:
                                 [cv2.IMWRITE_JPEG_QUALITY, 75])
             
             if success:
+                self._record_file(frame_uuid, f"{image_type}_thumbnail", partition, file_path.stat().st_size)
                 self.logger.debug(f"Saved {image_type} thumbnail: {file_path}")
                 return str(file_path)
             else:
@@ -134,6 +345,126 @@ class FileStorageManager:
             self.logger.error(f"Error saving {image_type} thumbnail {frame_uuid}: {e}")
             return None
     
+    def read_segment(self, extent: Dict[str, Any]) -> Optional[bytes]:
+        """
+        Read the bytes of one image appended to a segment file.
+        
+        Args:
+            extent: {file, offset, length} as stored in the frame document
+            
+        Returns:
+            The encoded image or None if the segment is missing or too short
+        """
+        try:
+            offset, length = int(extent["offset"]), int(extent["length"])
+            with open(extent["file"], "rb") as segment:
+                # Map only the pages holding the image (mmap offsets must be page aligned)
+                start = offset - offset % mmap.ALLOCATIONGRANULARITY
+                with mmap.mmap(segment.fileno(), offset + length - start, offset=start,
+                               access=mmap.ACCESS_READ) as mapped:
+                    return mapped[offset - start:offset - start + length]
+        except (OSError, ValueError, KeyError) as e:
+            self.logger.error(f"Error reading segment extent {extent}: {e}")
+            return None
+    
+    def load_segment_image(self, extent: Dict[str, Any]) -> Optional[np.ndarray]:
+        """Decode an image stored in a segment file (None if it cannot be read)."""
+        data = self.read_segment(extent)
+        if data is None:
+            return None
+        return cv2.imdecode(np.frombuffer(data, np.uint8), cv2.IMREAD_COLOR)
+    
+    def load_plate_frame(self, frame_doc: Dict[str, Any]) -> Optional[np.ndarray]:
+        """
+        Rebuild the full frame of a plate-and-patch document (persistence_mode plate_patches).
+        
+        The background plate is stored at the size the background model learns at, possibly
+        gray: it is scaled to original_frame_shape, then every region crop is pasted at its
+        crop rectangle.
+        
+        Args:
+            frame_doc: Frame document with background_plate and region_crops
+            
+        Returns:
+            BGR frame or None if the plate cannot be read
+        """
+        plate_info = frame_doc.get("background_plate") or {}
+        frame = cv2.imread(str(plate_info.get("path", "")), cv2.IMREAD_COLOR)
+        if frame is None:
+            self.logger.warning(f"Background plate not found: {plate_info.get('path')}")
+            return None
+        shape = frame_doc.get("original_frame_shape") or frame.shape
+        height, width = int(shape[0]), int(shape[1])
+        if frame.shape[:2] != (height, width):
+            frame = cv2.resize(frame, (width, height), interpolation=cv2.INTER_LINEAR)
+        for crop in frame_doc.get("region_crops", []):
+            x, y, w, h = (int(value) for value in crop["crop"])
+            patch = cv2.imread(str(crop["path"]), cv2.IMREAD_COLOR)
+            if patch is None or patch.shape[:2] != (h, w):
+                self.logger.warning(f"Region crop missing or of the wrong size: {crop['path']}")
+                continue
+            frame[y:y + h, x:x + w] = patch
+        return frame
+    
+    def load_frame_regions(self, frame_doc: Dict[str, Any], regions: List[Tuple[int, int, int, int]],
+                           image_type: str = "original",
+                           target_side: int = 0) -> Optional[List[Optional[np.ndarray]]]:
+        """
+        Decode only some regions of a stored frame.
+        
+        Each region comes back at the coarsest 1/2, 1/4 or 1/8 scale that keeps its longer
+        side at least target_side. The native decoder (JpegRegionDecoder) decodes only the
+        JPEG blocks covering the regions, directly at that scale; without it, for other
+        codecs and for plate-and-patch documents the frame is decoded whole and sliced.
+        
+        Args:
+            frame_doc: Frame document (segment extent, indexed file or background plate)
+            regions: (x, y, width, height) rectangles in frame coordinates
+            image_type: Type of image ("original" or "processed")
+            target_side: Smallest longer side needed per region, 0 for full resolution
+            
+        Returns:
+            One BGR image per region (None for a region outside the frame), or None if the
+            frame cannot be read
+        """
+        boxes = np.asarray(regions, dtype=np.int32).reshape(-1, 4)
+        extent = frame_doc.get(f"{image_type}_image_segment")
+        if frame_doc.get("background_plate"):
+            source = None
+        elif extent:
+            source = self.read_segment(extent)
+            if source is None:
+                return None
+        else:
+            source = self._file_path(frame_doc["_id"], image_type)
+        
+        if source is not None and decode_jpeg_regions is not None:
+            crops = decode_jpeg_regions(source, boxes, target_side)
+            if crops is not None:
+                return crops
+        
+        if source is None:
+            frame = self.load_plate_frame(frame_doc)
+        elif isinstance(source, Path):
+            frame = cv2.imread(str(source), cv2.IMREAD_COLOR)
+        else:
+            frame = cv2.imdecode(np.frombuffer(source, np.uint8), cv2.IMREAD_COLOR)
+        if frame is None:
+            return None
+        crops = []
+        for x, y, w, h in boxes:
+            x0, y0 = max(int(x), 0), max(int(y), 0)
+            crop = frame[y0:y + h, x0:x + w]
+            if crop.size == 0:
+                crops.append(None)
+                continue
+            denominator = next((d for d in (8, 4, 2) if target_side > 0 and max(w, h) // d >= target_side), 1)
+            if denominator > 1:
+                crop = cv2.resize(crop, (-(-crop.shape[1] // denominator), -(-crop.shape[0] // denominator)),
+                                  interpolation=cv2.INTER_AREA)
+            crops.append(crop)
+        return crops
+    
     def load_thumbnail(self, frame_uuid: str, image_type: str = "processed") -> Optional[np.ndarray]:
         """
         Load a thumbnail image from local storage.
@@ -146,17 +477,10 @@ class FileStorageManager:
             OpenCV frame (numpy array) or None if not found
         """
         try:
-            # Determine storage path
-            if image_type == "original":
-                storage_path = self.original_thumbnails_path
-            elif image_type == "processed":
-                storage_path = self.processed_thumbnails_path
-            else:
+            if image_type not in ("original", "processed"):
                 raise ValueError(f"Invalid image_type: {image_type}")
             
-            # Create filename with UUID
-            filename = f"{frame_uuid}.jpg"
-            file_path = storage_path / filename
+            file_path = self._file_path(frame_uuid, f"{image_type}_thumbnail")
             
             if not file_path.exists():
                 self.logger.warning(f"Thumbnail not found: {file_path}")
@@ -190,20 +514,10 @@ class FileStorageManager:
             success = True
             
             if image_type in ["original", "both"]:
-                original_path = self.original_thumbnails_path / f"{frame_uuid}.jpg"
-                if original_path.exists():
-                    original_path.unlink()
-                    self.logger.debug(f"Deleted original thumbnail: {original_path}")
-                else:
-                    self.logger.warning(f"Original thumbnail not found: {original_path}")
+                self._delete_file(frame_uuid, "original_thumbnail", "original thumbnail")
             
             if image_type in ["processed", "both"]:
-                processed_path = self.processed_thumbnails_path / f"{frame_uuid}.jpg"
-                if processed_path.exists():
-                    processed_path.unlink()
-                    self.logger.debug(f"Deleted processed thumbnail: {processed_path}")
-                else:
-                    self.logger.warning(f"Processed thumbnail not found: {processed_path}")
+                self._delete_file(frame_uuid, "processed_thumbnail", "processed thumbnail")
             
             return success
             
@@ -268,17 +582,10 @@ class FileStorageManager:
             OpenCV frame (numpy array) or None if not found
         """
         try:
-            # Determine storage path
-            if image_type == "original":
-                storage_path = self.original_path
-            elif image_type == "processed":
-                storage_path = self.processed_path
-            else:
+            if image_type not in ("original", "processed"):
                 raise ValueError(f"Invalid image_type: {image_type}")
             
-            # Create filename with UUID
-            filename = f"{frame_uuid}.jpg"
-            file_path = storage_path / filename
+            file_path = self._file_path(frame_uuid, image_type)
             
             if not file_path.exists():
                 self.logger.warning(f"Frame not found: {file_path}")
@@ -312,20 +619,10 @@ class FileStorageManager:
             success = True
             
             if image_type in ["original", "both"]:
-                original_path = self.original_path / f"{frame_uuid}.jpg"
-                if original_path.exists():
-                    original_path.unlink()
-                    self.logger.debug(f"Deleted original frame: {original_path}")
-                else:
-                    self.logger.warning(f"Original frame not found: {original_path}")
+                self._delete_file(frame_uuid, "original", "original frame")
             
             if image_type in ["processed", "both"]:
-                processed_path = self.processed_path / f"{frame_uuid}.jpg"
-                if processed_path.exists():
-                    processed_path.unlink()
-                    self.logger.debug(f"Deleted processed frame: {processed_path}")
-                else:
-                    self.logger.warning(f"Processed frame not found: {processed_path}")
+                self._delete_file(frame_uuid, "processed", "processed frame")
             
             return success
             
@@ -349,20 +646,8 @@ class FileStorageManager:
             success = True
             
             # Delete full-resolution images
-            original_path = self.original_path / f"{frame_uuid}.jpg"
-            processed_path = self.processed_path / f"{frame_uuid}.jpg"
-            
-            if original_path.exists():
-                original_path.unlink()
-                self.logger.debug(f"Deleted full-resolution original image: {original_path}")
-            else:
-                self.logger.warning(f"Full-resolution original image not found: {original_path}")
-            
-            if processed_path.exists():
-                processed_path.unlink()
-                self.logger.debug(f"Deleted full-resolution processed image: {processed_path}")
-            else:
-                self.logger.warning(f"Full-resolution processed image not found: {processed_path}")
+            self._delete_file(frame_uuid, "original", "full-resolution original image")
+            self._delete_file(frame_uuid, "processed", "full-resolution processed image")
             
             # Optionally delete thumbnails too
             if not keep_thumbnails:
@@ -389,13 +674,11 @@ class FileStorageManager:
         """
         try:
             if image_type == "both":
-                original_exists = (self.original_path / f"{frame_uuid}.jpg").exists()
-                processed_exists = (self.processed_path / f"{frame_uuid}.jpg").exists()
+                original_exists = self._file_path(frame_uuid, "original").exists()
+                processed_exists = self._file_path(frame_uuid, "processed").exists()
                 return original_exists and processed_exists
-            elif image_type == "original":
-                return (self.original_path / f"{frame_uuid}.jpg").exists()
-            elif image_type == "processed":
-                return (self.processed_path / f"{frame_uuid}.jpg").exists()
+            elif image_type in ("original", "processed"):
+                return self._file_path(frame_uuid, image_type).exists()
             else:
                 raise ValueError(f"Invalid image_type: {image_type}")
                 
@@ -407,6 +690,9 @@ class FileStorageManager:
         """
         Get storage statistics.
         
+        Read from the index counters, so the cost does not grow with the number of frames.
+        total_size_bytes covers the full-size images, as before thumbnails were counted.
+        
         Returns:
             Dictionary with storage statistics
         """
@@ -419,33 +705,65 @@ class FileStorageManager:
                 "processed_count": 0,
                 "total_size_bytes": 0,
                 "original_size_bytes": 0,
-                "processed_size_bytes": 0
+                "processed_size_bytes": 0,
+                "original_thumbnail_count": 0,
+                "processed_thumbnail_count": 0,
+                "thumbnail_size_bytes": 0,
+                "segment_count": 0,
+                "segment_size_bytes": 0
             }
             
-            # Count original frames
-            if self.original_path.exists():
-                original_files = list(self.original_path.glob("*.jpg"))
-                stats["original_count"] = len(original_files)
-                stats["original_size_bytes"] = sum(f.stat().st_size for f in original_files)
-            
-            # Count processed frames
-            if self.processed_path.exists():
-                processed_files = list(self.processed_path.glob("*.jpg"))
-                stats["processed_count"] = len(processed_files)
-                stats["processed_size_bytes"] = sum(f.stat().st_size for f in processed_files)
+            with self._index_lock:
+                counters = self._index.execute("SELECT image_type, file_count, size_bytes FROM counters").fetchall()
+            for image_type, file_count, size_bytes in counters:
+                if image_type in ("original", "processed"):
+                    stats[f"{image_type}_count"] = file_count
+                    stats[f"{image_type}_size_bytes"] = size_bytes
+                else:
+                    stats[f"{image_type}_count"] = file_count
+                    stats["thumbnail_size_bytes"] += size_bytes
             
             stats["total_size_bytes"] = stats["original_size_bytes"] + stats["processed_size_bytes"]
             
+            # A handful of large files: cheap to list
+            if self.segments_path.exists():
+                for entry in os.scandir(self.segments_path):
+                    if entry.name.endswith(".seg"):
+                        stats["segment_count"] += 1
+                        stats["segment_size_bytes"] += entry.stat().st_size
+            
             return stats
             
         except Exception as e:
             self.logger.error(f"Error getting storage stats: {e}")
             return {}
     
+    def _expired_partitions(self, type_dir: Path, cutoff_partition: str) -> List[str]:
+        """Hour partitions under type_dir that end before the cutoff hour (directories only)."""
+        expired = []
+        for year in sorted(p for p in type_dir.iterdir() if p.is_dir() and p.name.isdigit()):
+            for month in sorted(p for p in year.iterdir() if p.is_dir()):
+                for day in sorted(p for p in month.iterdir() if p.is_dir()):
+                    for hour in sorted(p for p in day.iterdir() if p.is_dir()):
+                        partition = f"{year.name}/{month.name}/{day.name}/{hour.name}"
+                        if partition < cutoff_partition:
+                            expired.append(partition)
+        return expired
+    
+    def _remove_empty_parents(self, directory: Path, type_dir: Path):
+        """Remove day/month/year directories left empty by a partition deletion."""
+        while directory != type_dir and directory.is_dir() and not any(directory.iterdir()):
+            directory.rmdir()
+            directory = directory.parent
+    
     def cleanup_old_frames(self, max_age_days: int = 30) -> int:
         """
         Clean up old frame files.
         
+        Deletes whole hour partitions older than the cutoff (no per-file stat) together with
+        their index entries; full-size images and thumbnails expire alike. Files left in the
+        old flat layout are still aged by modification time.
+        
         Args:
             max_age_days: Maximum age in days for frames to keep
             
@@ -454,23 +772,47 @@ class FileStorageManager:
         """
         try:
             deleted_count = 0
-            cutoff_time = datetime.now().timestamp() - (max_age_days * 24 * 60 * 60)
+            cutoff = datetime.now(timezone.utc) - timedelta(days=max_age_days)
+            cutoff_partition = partition_for(cutoff)
             
-            # Clean up original frames
-            if self.original_path.exists():
-                for file_path in self.original_path.glob("*.jpg"):
-                    if file_path.stat().st_mtime < cutoff_time:
+            for image_type in IMAGE_TYPE_DIRS:
+                type_dir = self._type_dir(image_type)
+                if not type_dir.exists():
+                    continue
+                
+                for partition in self._expired_partitions(type_dir, cutoff_partition):
+                    partition_dir = type_dir / partition
+                    deleted_count += sum(1 for entry in os.scandir(partition_dir) if entry.is_file())
+                    shutil.rmtree(partition_dir)
+                    self._remove_empty_parents(partition_dir.parent, type_dir)
+                    self._forget_partition(image_type, partition)
+                    self.logger.debug(f"Deleted old {image_type} partition: {partition_dir}")
+                
+                # Legacy flat layout
+                for file_path in type_dir.glob("*.jpg"):
+                    if file_path.stat().st_mtime < cutoff.timestamp():
                         file_path.unlink()
+                        self._forget_file(file_path.stem, image_type)
                         deleted_count += 1
-                        self.logger.debug(f"Deleted old original frame: {file_path}")
-            
-            # Clean up processed frames
-            if self.processed_path.exists():
-                for file_path in self.processed_path.glob("*.jpg"):
-                    if file_path.stat().st_mtime < cutoff_time:
+                        self.logger.debug(f"Deleted old {image_type} image: {file_path}")
+            
+            # Background plates (persistence_mode plate_patches) are not indexed; their hour
+            # partitions expire like the others
+            if self.plates_path.exists():
+                for partition in self._expired_partitions(self.plates_path, cutoff_partition):
+                    partition_dir = self.plates_path / partition
+                    deleted_count += sum(1 for entry in os.scandir(partition_dir) if entry.is_file())
+                    shutil.rmtree(partition_dir)
+                    self._remove_empty_parents(partition_dir.parent, self.plates_path)
+            
+            # Segments are append-only: one whose last append is past the cutoff holds
+            # only expired images
+            if self.segments_path.exists():
+                for file_path in self.segments_path.glob("segment_*.seg"):
+                    if file_path.stat().st_mtime < cutoff.timestamp():
                         file_path.unlink()
                         deleted_count += 1
-                        self.logger.debug(f"Deleted old processed frame: {file_path}")
+                        self.logger.debug(f"Deleted old segment: {file_path}")
             
             if deleted_count > 0:
                 self.logger.info(f"Cleaned up {deleted_count} old frame files")
@@ -480,3 +822,21 @@ class FileStorageManager:
         except Exception as e:
             self.logger.error(f"Error cleaning up old frames: {e}")
             return 0
+    
+    def _forget_partition(self, image_type: str, partition: str):
+        """Drop the index entries of a deleted partition and update the counters."""
+        with self._index_lock:
+            self._index.execute("BEGIN")
+            try:
+                file_count, size_bytes = self._index.execute(
+                    "SELECT COUNT(*), COALESCE(SUM(size_bytes), 0) FROM files WHERE image_type = ? AND partition = ?",
+                    (image_type, partition),
+                ).fetchone()
+                self._index.execute(
+                    "DELETE FROM files WHERE image_type = ? AND partition = ?", (image_type, partition)
+                )
+                self._add_to_counters(image_type, -file_count, -size_bytes)
+                self._index.execute("COMMIT")
+            except Exception:
+                self._index.execute("ROLLBACK")
+                raise
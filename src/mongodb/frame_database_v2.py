@@ -7,11 +7,15 @@ This replaces the inefficient base64 storage approach.
 
 import uuid
 import logging
-from typing import Optional, Dict, Any, List
+from concurrent.futures import ThreadPoolExecutor
+from typing import Optional, Dict, Any, List, Iterable, Tuple
 from datetime import datetime
+from pathlib import Path
 import cv2
 import numpy as np
 from pymongo.collection import Collection
+from pymongo import UpdateOne
+from pymongo.errors import BulkWriteError, CollectionInvalid
 
 from .database_manager import DatabaseManager
 from .file_storage_manager import FileStorageManager
@@ -20,30 +24,55 @@ from .file_storage_manager import FileStorageManager
 class FrameDatabaseV2:
     """Manages frame storage using local files with MongoDB metadata."""
     
-    def __init__(self, db_manager: DatabaseManager, storage_path: str = "data/frames"):
+    def __init__(self, db_manager: DatabaseManager, storage_path: str = "data/frames",
+                 time_series: bool = True):
         """
         Initialize the frame database.
         
         Args:
             db_manager: Database manager instance
             storage_path: Base path for local file storage
+            time_series: Create a missing frame collection as a time-series collection
+                         (timestamp as timeField, "stream" as metaField), as FrameStore does
         """
         self.db_manager = db_manager
         self.collection_name = "captured_frames"
+        self.stats_collection_name = "motion_stats"
         self.logger = logging.getLogger(__name__)
+        self.time_series = False  # Whether the frame collection is one, set by _create_indexes
         
         # Initialize file storage manager
         self.file_storage = FileStorageManager(storage_path)
         
         # Create indexes
-        self._create_indexes()
+        self._create_indexes(time_series)
         
-    def _create_indexes(self):
-        """Create database indexes for efficient queries."""
+    def _ensure_frame_collection(self, create_time_series: bool) -> bool:
+        """
+        Create the frame collection as a time-series collection if it does not exist yet.
+        An existing collection keeps its type. Returns whether it is a time-series collection.
+        """
+        database = self.db_manager.database
+        for info in database.list_collections(filter={"name": self.collection_name}):
+            return info.get("type") == "timeseries"
+        if not create_time_series:
+            return False
+        try:
+            database.create_collection(self.collection_name, timeseries={
+                "timeField": "timestamp", "metaField": "stream", "granularity": "seconds"})
+            self.logger.info(f"Created time-series collection {self.collection_name}")
+            return True
+        except CollectionInvalid:
+            # FrameStore (or another process) created it first
+            return self._ensure_frame_collection(False)
+
+    def _create_indexes(self, time_series: bool = True):
+        """Create the frame collection if missing and the database indexes for efficient queries."""
         try:
             collection = self.db_manager.get_collection(self.collection_name)
             if collection is None:
                 return
+            self.time_series = self._ensure_frame_collection(time_series)
             
             # Create indexes
             collection.create_index("timestamp")
@@ -51,11 +80,59 @@ class FrameDatabaseV2:
             collection.create_index("metadata.source")
             collection.create_index("metadata.motion_detected")
             collection.create_index("metadata.motion_regions")
+            # Viewer order and keyset pagination: (metadata.timestamp, _id) descending
+            collection.create_index([("metadata.timestamp", -1), ("_id", -1)])
+            if self.time_series:
+                # No _id index of its own; insert_frame_records looks ids up
+                collection.create_index("_id")
+
+            stats_collection = self.db_manager.get_collection(self.stats_collection_name)
+            if stats_collection is not None:
+                stats_collection.create_index([("minute", -1), ("source", 1)])
             
             self.logger.info("Database indexes created successfully")
             
         except Exception as e:
             self.logger.warning(f"Could not create indexes: {e}")
+
+        self._convert_metadata_timestamps()
+
+    def _convert_metadata_timestamps(self):
+        """
+        Rewrite metadata.timestamp values that are not dates (Unix seconds stored as a string
+        or a number by older writers, or missing) as BSON dates, so every frame sorts and
+        pages through the (metadata.timestamp, _id) index. Frames without a usable value get
+        their document timestamp. Only non-date values are touched, so this is a no-op once a
+        collection has been converted.
+        """
+        try:
+            collection = self.db_manager.get_collection(self.collection_name)
+            if collection is None:
+                return
+            seconds = {"$convert": {"input": "$metadata.timestamp", "to": "double",
+                                    "onError": None, "onNull": None}}
+            result = collection.update_many(
+                {"metadata.timestamp": {"$not": {"$type": "date"}}},
+                [{"$set": {"metadata.timestamp": {"$convert": {
+                    "input": {"$multiply": [seconds, 1000]},
+                    "to": "date", "onError": "$timestamp", "onNull": "$timestamp"}}}}]
+            )
+            if result.modified_count:
+                self.logger.info(f"Converted metadata.timestamp to a date on {result.modified_count} frames")
+        except Exception as e:
+            self.logger.warning(f"Could not convert metadata timestamps: {e}")
+
+    @staticmethod
+    def _frame_metadata(metadata: Optional[Dict[str, Any]], now: datetime) -> Dict[str, Any]:
+        """Copy of metadata whose timestamp is a UTC datetime (Unix seconds are converted)."""
+        metadata = dict(metadata or {})
+        value = metadata.get("timestamp")
+        if not isinstance(value, datetime):
+            try:
+                metadata["timestamp"] = datetime.utcfromtimestamp(float(value))
+            except (TypeError, ValueError, OverflowError, OSError):
+                metadata["timestamp"] = now
+        return metadata
     
     def save_frame(self, frame: np.ndarray, metadata: Optional[Dict[str, Any]] = None) -> Optional[str]:
         """
@@ -85,15 +162,17 @@ class FrameDatabaseV2:
             thumbnail_path = self.file_storage.save_thumbnail(frame, frame_uuid, "processed")
             
             # Prepare document (no image data, just metadata and file paths)
+            now = datetime.utcnow()
             document = {
                 "_id": frame_uuid,
                 "processed_image_path": file_path,
                 "processed_thumbnail_path": thumbnail_path,
                 "frame_shape": frame.shape,
                 "frame_dtype": str(frame.dtype),
-                "timestamp": datetime.utcnow(),
-                "created_at": datetime.utcnow(),
-                "metadata": metadata or {}
+                "timestamp": now,
+                "stream": (metadata or {}).get("source"),
+                "created_at": now,
+                "metadata": self._frame_metadata(metadata, now)
             }
             
             # Insert into database
@@ -143,6 +222,7 @@ class FrameDatabaseV2:
                 return None
             
             # Prepare document (no image data, just metadata and file paths)
+            now = datetime.utcnow()
             document = {
                 "_id": frame_uuid,
                 "original_image_path": original_path,
@@ -153,9 +233,10 @@ class FrameDatabaseV2:
                 "original_frame_shape": original_frame.shape,
                 "frame_dtype": str(processed_frame.dtype),
                 "original_frame_dtype": str(original_frame.dtype),
-                "timestamp": datetime.utcnow(),
-                "created_at": datetime.utcnow(),
-                "metadata": metadata or {}
+                "timestamp": now,
+                "stream": (metadata or {}).get("source"),
+                "created_at": now,
+                "metadata": self._frame_metadata(metadata, now)
             }
             
             # Insert into database
@@ -173,6 +254,252 @@ class FrameDatabaseV2:
             self.logger.error(f"Failed to save frame with original: {e}")
             return None
     
+    def save_frames_with_original(self, frames: Iterable[Tuple[np.ndarray, np.ndarray, Optional[Dict[str, Any]]]],
+                                  max_workers: int = 4) -> List[Optional[str]]:
+        """
+        Save many original/processed frame pairs at once (bulk ingest).
+
+        The image and thumbnail files are written by a thread pool (OpenCV releases the GIL
+        while encoding), then all documents go to MongoDB in one unordered insert_many, so a
+        batch costs one round trip instead of one per frame. Documents match those written
+        by save_frame_with_original.
+
+        Args:
+            frames: (original_frame, processed_frame, metadata) tuples
+            max_workers: Threads writing image files
+
+        Returns:
+            UUID per input frame, in input order; None for frames that could not be saved
+        """
+        frames = list(frames)
+        if not frames:
+            return []
+        if self.db_manager.get_collection(self.collection_name) is None:
+            return [None] * len(frames)
+
+        frame_uuids = [str(uuid.uuid4()) for _ in frames]
+
+        def write_files(index: int):
+            original_frame, processed_frame, _ = frames[index]
+            return self.file_storage.save_both_frames(
+                original_frame, processed_frame, frame_uuids[index], create_thumbnails=True
+            )
+
+        with ThreadPoolExecutor(max_workers=max(1, max_workers)) as pool:
+            saved_paths = list(pool.map(write_files, range(len(frames))))
+
+        records = []
+        for frame_uuid, (original_frame, processed_frame, metadata), paths in zip(frame_uuids, frames, saved_paths):
+            original_path, processed_path, original_thumbnail_path, processed_thumbnail_path = paths
+            if not original_path or not processed_path:
+                continue
+            records.append({
+                "uuid": frame_uuid,
+                "original_image_path": original_path,
+                "processed_image_path": processed_path,
+                "original_thumbnail_path": original_thumbnail_path,
+                "processed_thumbnail_path": processed_thumbnail_path,
+                "frame_shape": processed_frame.shape,
+                "original_frame_shape": original_frame.shape,
+                "frame_dtype": str(processed_frame.dtype),
+                "original_frame_dtype": str(original_frame.dtype),
+                "metadata": metadata
+            })
+
+        inserted = set(self.insert_frame_records(records))
+        return [frame_uuid if frame_uuid in inserted else None for frame_uuid in frame_uuids]
+
+    def insert_frame_records(self, records: List[Dict[str, Any]]) -> List[str]:
+        """
+        Insert metadata documents for frames whose images were already written to local storage.
+
+        Used by the C++ persistence queue, which encodes images outside the GIL and batches
+        the inserts, and by save_frames_with_original. Documents match those written by
+        save_frame_with_original.
+
+        Args:
+            records: Dicts with uuid, the four image/thumbnail paths, frame_shape,
+                     original_frame_shape and metadata (frame_dtype and original_frame_dtype
+                     default to uint8); records from a segment store have None paths and
+                     {file, offset, length} *_segment extents instead; region-crop records
+                     have None for the full-size paths and a region_crops list of
+                     {path, region, crop, url, bytes}, plate-and-patch records also a
+                     background_plate {id, path, size}; images maps each stored image
+                     kind to its {url, bytes}, all the viewer's frame list reads;
+                     thumbnail_atlas {sheet, sheet_size, rect} places the gallery thumbnail
+                     in a per-hour sprite sheet
+
+        Returns:
+            UUIDs of the inserted documents (empty list if the insert failed)
+        """
+        if not records:
+            return []
+        try:
+            collection = self.db_manager.get_collection(self.collection_name)
+            if collection is None:
+                return []
+
+            now = datetime.utcnow()
+            documents = [
+                {
+                    "_id": record["uuid"],
+                    "original_image_path": record["original_image_path"],
+                    "processed_image_path": record["processed_image_path"],
+                    "original_thumbnail_path": record.get("original_thumbnail_path"),
+                    "processed_thumbnail_path": record.get("processed_thumbnail_path"),
+                    "frame_shape": tuple(record["frame_shape"]),
+                    "original_frame_shape": tuple(record["original_frame_shape"]),
+                    "frame_dtype": record.get("frame_dtype", "uint8"),
+                    "original_frame_dtype": record.get("original_frame_dtype", "uint8"),
+                    "timestamp": now,
+                    "stream": (record.get("metadata") or {}).get("source"),
+                    "created_at": now,
+                    "metadata": self._frame_metadata(record.get("metadata"), now)
+                }
+                for record in records
+            ]
+            # Stable image URLs and sizes (the C++ writer's), so the viewer never reads paths
+            for document, record in zip(documents, records):
+                if "images" in record:
+                    document["images"] = {kind: dict(image) for kind, image in record["images"].items()}
+
+            # Images appended to segment files: {file, offset, length} instead of a path
+            for document, record in zip(documents, records):
+                for field in ("original_image_segment", "processed_image_segment",
+                              "original_thumbnail_segment", "processed_thumbnail_segment"):
+                    if record.get(field):
+                        document[field] = dict(record[field])
+
+            # Region-crop records: one stored image per consolidated region, [x, y, w, h] boxes
+            for document, record in zip(documents, records):
+                if record.get("region_crops"):
+                    document["region_crops"] = [
+                        {"path": crop["path"], "region": list(crop["region"]), "crop": list(crop["crop"]),
+                         **{key: crop[key] for key in ("url", "bytes") if key in crop}}
+                        for crop in record["region_crops"]
+                    ]
+                if record.get("background_plate"):
+                    plate = record["background_plate"]
+                    document["background_plate"] = {
+                        "id": plate["id"], "path": plate["path"], "size": list(plate["size"])
+                    }
+                # Gallery thumbnail in a per-hour sprite sheet (thumbnail_atlas)
+                if record.get("thumbnail_atlas"):
+                    atlas = record["thumbnail_atlas"]
+                    document["thumbnail_atlas"] = {
+                        "sheet": atlas["sheet"], "sheet_size": list(atlas["sheet_size"]), "rect": list(atlas["rect"])
+                    }
+
+            # Images written by the C++ FrameFileStorage join the partition index (a no-op
+            # refresh for those written by save_frames_with_original)
+            self.file_storage.register_files([
+                (record["uuid"], image_type, record[field])
+                for record in records
+                for image_type, field in (("original", "original_image_path"),
+                                          ("processed", "processed_image_path"),
+                                          ("original_thumbnail", "original_thumbnail_path"),
+                                          ("processed_thumbnail", "processed_thumbnail_path"))
+                if record.get(field)
+            ])
+
+            # A time-series collection accepts a second document with the same _id, so frames
+            # a resend already stored are skipped instead of stored twice
+            positions = list(range(len(documents)))  # Index in records of each inserted document
+            if self.time_series:
+                stored = {document["_id"] for document in collection.find(
+                    {"_id": {"$in": [document["_id"] for document in documents]}}, {"_id": 1})}
+                positions = [i for i in positions if documents[i]["_id"] not in stored]
+
+            # One round trip for the whole batch; unordered so one bad document doesn't block the rest
+            if positions:
+                collection.insert_many([documents[i] for i in positions], ordered=False)
+            inserted = [record["uuid"] for record in records]
+            self.logger.info(f"Saved {len(positions)} frames in one batch")
+            return inserted
+
+        except BulkWriteError as e:
+            # Some documents went in; clean up files only for the ones that failed
+            failed = {positions[error["index"]] for error in e.details.get("writeErrors", [])}
+            self.logger.error(f"Failed to insert {len(failed)} of {len(records)} frames: {e}")
+            for index in failed:
+                self._delete_frame_files(records[index]["uuid"], records[index].get("region_crops"))
+            return [record["uuid"] for i, record in enumerate(records) if i not in failed]
+
+        except Exception as e:
+            self.logger.error(f"Failed to insert frame batch: {e}")
+            # Clean up files for frames that never made it into the database
+            for record in records:
+                self._delete_frame_files(record["uuid"], record.get("region_crops"))
+            return []
+
+    def _delete_frame_files(self, frame_uuid: str, region_crops: Optional[List[Dict[str, Any]]] = None):
+        """Remove both images, both thumbnails and any region crops of a frame from local storage."""
+        self.file_storage.delete_frame(frame_uuid, "both")
+        self.file_storage.delete_thumbnail(frame_uuid, "both")
+        for crop in region_crops or []:
+            Path(crop["path"]).unlink(missing_ok=True)
+
+    def upsert_motion_stats(self, summaries: List[Dict[str, Any]]) -> bool:
+        """
+        Upsert per-minute motion summaries written by the C++ pipeline.
+
+        One document per stream and minute (_id "<source>:<minute_start>"). Counters are
+        added to an existing document for the same minute (a restart within the minute),
+        maxima are kept, and percentiles and the mean describe the latest write. Same
+        fields as FrameStore::upsertMotionSummaries.
+
+        Args:
+            summaries: Dicts with source, minute_start (Unix seconds), frames, motion_frames,
+                       motion_boxes, regions, max_regions and latency_p50/p95/p99/max_ms
+
+        Returns:
+            True if every summary was written
+        """
+        if not summaries:
+            return True
+        try:
+            collection = self.db_manager.get_collection(self.stats_collection_name)
+            if collection is None:
+                return False
+
+            now = datetime.utcnow()
+            operations = []
+            for summary in summaries:
+                frames = int(summary["frames"])
+                operations.append(UpdateOne(
+                    {"_id": f"{summary['source']}:{int(summary['minute_start'])}"},
+                    {
+                        "$setOnInsert": {
+                            "source": summary["source"],
+                            "minute": datetime.utcfromtimestamp(int(summary["minute_start"])),
+                        },
+                        "$inc": {
+                            "frames": frames,
+                            "motion_frames": int(summary["motion_frames"]),
+                            "motion_boxes": int(summary["motion_boxes"]),
+                            "regions": int(summary["regions"]),
+                        },
+                        "$max": {
+                            "max_regions": int(summary["max_regions"]),
+                            "latency_max_ms": float(summary["latency_max_ms"]),
+                        },
+                        "$set": {
+                            "mean_boxes_per_frame": int(summary["motion_boxes"]) / frames if frames else 0.0,
+                            "latency_p50_ms": float(summary["latency_p50_ms"]),
+                            "latency_p95_ms": float(summary["latency_p95_ms"]),
+                            "latency_p99_ms": float(summary["latency_p99_ms"]),
+                            "updated_at": now,
+                        },
+                    },
+                    upsert=True,
+                ))
+            collection.bulk_write(operations, ordered=False)
+            return True
+
+        except Exception as e:
+            self.logger.error(f"Failed to upsert motion stats: {e}")
+            return False
+
     def get_frame(self, frame_uuid: str, image_type: str = "processed") -> Optional[np.ndarray]:
         """
         Retrieve a frame from local storage.
@@ -195,8 +522,15 @@ class FrameDatabaseV2:
                 self.logger.warning(f"Frame not found in database: {frame_uuid}")
                 return None
             
-            # Load frame from local storage
-            frame = self.file_storage.load_frame(frame_uuid, image_type)
+            # Load frame from its segment extent or its file in local storage; plate-and-patch
+            # documents have neither and are rebuilt (the same for both image types)
+            extent = frame_doc.get(f"{image_type}_image_segment")
+            if frame_doc.get("background_plate"):
+                frame = self.file_storage.load_plate_frame(frame_doc)
+            elif extent:
+                frame = self.file_storage.load_segment_image(extent)
+            else:
+                frame = self.file_storage.load_frame(frame_uuid, image_type)
             if frame is not None:
                 self.logger.debug(f"Retrieved {image_type} frame: {frame_uuid}")
             else:
@@ -208,6 +542,43 @@ class FrameDatabaseV2:
             self.logger.error(f"Failed to retrieve frame {frame_uuid}: {e}")
             return None
     
+    def get_frame_regions(self, frame_uuid: str, image_type: str = "original",
+                          target_side: int = 0) -> Optional[List[Optional[np.ndarray]]]:
+        """
+        Retrieve the consolidated regions of a frame without decoding the whole frame.
+        
+        Args:
+            frame_uuid: UUID of the frame
+            image_type: Type of image ("original" or "processed")
+            target_side: Smallest longer side needed per region (e.g. the classifier input);
+                regions are decoded at up to 1/8 scale while staying above it, 0 keeps full
+                resolution
+            
+        Returns:
+            One BGR image per entry of metadata.consolidated_regions (None for a region
+            outside the frame), or None if the frame is not found
+        """
+        try:
+            collection = self.db_manager.get_collection(self.collection_name)
+            if collection is None:
+                return None
+            
+            frame_doc = collection.find_one({"_id": frame_uuid})
+            if not frame_doc:
+                self.logger.warning(f"Frame not found in database: {frame_uuid}")
+                return None
+            
+            regions = [(region.get("x", 0), region.get("y", 0), region.get("width", 0), region.get("height", 0))
+                       for region in frame_doc.get("metadata", {}).get("consolidated_regions", [])]
+            crops = self.file_storage.load_frame_regions(frame_doc, regions, image_type, target_side)
+            if crops is None:
+                self.logger.warning(f"Frame image not readable: {frame_uuid} ({image_type})")
+            return crops
+            
+        except Exception as e:
+            self.logger.error(f"Failed to retrieve regions of frame {frame_uuid}: {e}")
+            return None
+    
     def get_frame_metadata(self, frame_uuid: str) -> Optional[Dict[str, Any]]:
         """
         Get frame metadata without loading the image data.
@@ -376,44 +747,38 @@ class FrameDatabaseV2:
     
     def cleanup_old_frames(self, max_age_days: int = 30) -> int:
         """
-        Clean up old frames from both database and file system.
+        Expire frames older than max_age_days without scanning documents.
+
+        Documents go through the server's TTL: the time-series collection's
+        expireAfterSeconds, or a TTL timestamp index on a regular collection (set here, and a
+        no-op once set). Files go with their hour partitions, one directory unlink each
+        (FileStorageManager.cleanup_old_frames); FrameStore does the same on its own with
+        frame_retention_days.
         
         Args:
             max_age_days: Maximum age in days for frames to keep
             
         Returns:
-            Number of frames deleted
+            Number of files deleted
         """
         try:
-            collection = self.db_manager.get_collection(self.collection_name)
-            if collection is None:
-                return 0
-            
-            # Calculate cutoff date
-            cutoff_date = datetime.utcnow().replace(hour=0, minute=0, second=0, microsecond=0)
-            cutoff_date = cutoff_date.replace(day=cutoff_date.day - max_age_days)
-            
-            # Find old frames
-            old_frames = collection.find(
-                {"timestamp": {"$lt": cutoff_date}},
-                {"_id": 1}
-            )
-            
-            deleted_count = 0
-            for frame_doc in old_frames:
-                frame_uuid = frame_doc["_id"]
-                if self.delete_frame(frame_uuid):
-                    deleted_count += 1
-            
-            if deleted_count > 0:
-                self.logger.info(f"Cleaned up {deleted_count} old frames")
-            
-            return deleted_count
-            
+            self.set_retention(max_age_days)
         except Exception as e:
-            self.logger.error(f"Failed to cleanup old frames: {e}")
-            return 0
-    
+            self.logger.error(f"Failed to set frame retention: {e}")
+        return self.file_storage.cleanup_old_frames(max_age_days)
+
+    def set_retention(self, max_age_days: int):
+        """Have the server expire frame documents max_age_days after their timestamp."""
+        seconds = int(max_age_days * 86400)
+        if self.time_series:
+            self.db_manager.database.command({"collMod": self.collection_name, "expireAfterSeconds": seconds})
+        else:
+            self.db_manager.database.command({
+                "collMod": self.collection_name,
+                "index": {"keyPattern": {"timestamp": 1}, "expireAfterSeconds": seconds}
+            })
+        self.logger.info(f"Frame documents expire after {max_age_days} days")
+
     def cleanup_after_processing(self, frame_uuid: str, keep_thumbnails: bool = True) -> bool:
         """
         Clean up full-resolution images after they've been processed by the image detector.
@@ -10,7 +10,7 @@ import sys
 import base64
 import logging
 from pathlib import Path
-from typing import Dict, Any, Optional
+from typing import Dict, Any, Optional, Tuple
 import argparse
 from datetime import datetime
 
@@ -46,6 +46,24 @@ class MigrationManager:
         self.new_frame_db = FrameDatabaseV2(self.db_manager, storage_path)
         self.file_storage = FileStorageManager(storage_path)
         
+    def _decode_frames(self, frame_doc: Dict[str, Any]) -> Tuple[Optional[Any], Optional[Any]]:
+        """
+        Decode the base64 images of an old-format document.
+
+        Returns:
+            (original_frame, processed_frame); None for an image the document does not have
+        """
+        import cv2
+        import numpy as np
+
+        def decode(field: str):
+            if not frame_doc.get(field):
+                return None
+            nparr = np.frombuffer(base64.b64decode(frame_doc[field]), np.uint8)
+            return cv2.imdecode(nparr, cv2.IMREAD_COLOR)
+
+        return decode("original_frame_data"), decode("frame_data")
+
     def migrate_frame(self, frame_doc: Dict[str, Any]) -> bool:
         """
         Migrate a single frame from base64 to file storage.
@@ -60,31 +78,8 @@ class MigrationManager:
             frame_uuid = frame_doc["_id"]
             self.logger.info(f"Migrating frame: {frame_uuid}")
             
-            # Decode base64 frame data
-            frame_data = None
-            original_frame_data = None
-            
-            if "frame_data" in frame_doc and frame_doc["frame_data"]:
-                frame_data = base64.b64decode(frame_doc["frame_data"])
-            
-            if "original_frame_data" in frame_doc and frame_doc["original_frame_data"]:
-                original_frame_data = base64.b64decode(frame_doc["original_frame_data"])
-            
-            # Convert to OpenCV frames
-            processed_frame = None
-            original_frame = None
-            
-            if frame_data:
-                import cv2
-                import numpy as np
-                nparr = np.frombuffer(frame_data, np.uint8)
-                processed_frame = cv2.imdecode(nparr, cv2.IMREAD_COLOR)
-            
-            if original_frame_data:
-                import cv2
-                import numpy as np
-                nparr = np.frombuffer(original_frame_data, np.uint8)
-                original_frame = cv2.imdecode(nparr, cv2.IMREAD_COLOR)
+            # Decode base64 frame data to OpenCV frames
+            original_frame, processed_frame = self._decode_frames(frame_doc)
             
             # Save to new file-based system
             if original_frame is not None and processed_frame is not None:
@@ -156,6 +151,8 @@ class MigrationManager:
                 # Get batch of frames
                 cursor = collection.find({}).skip(skip).limit(batch_size)
                 
+                # Frames with both images are saved together below (one insert_many per batch)
+                pairs = []
                 for frame_doc in cursor:
                     try:
                         # Check if frame already migrated (has file paths)
@@ -164,6 +161,11 @@ class MigrationManager:
                             stats["skipped"] += 1
                             continue
                         
+                        original_frame, processed_frame = self._decode_frames(frame_doc)
+                        if original_frame is not None and processed_frame is not None:
+                            pairs.append((original_frame, processed_frame, frame_doc.get("metadata", {})))
+                            continue
+                        
                         # Migrate frame
                         if self.migrate_frame(frame_doc):
                             stats["migrated"] += 1
@@ -174,6 +176,12 @@ class MigrationManager:
                         self.logger.error(f"Error processing frame {frame_doc.get('_id', 'unknown')}: {e}")
                         stats["failed"] += 1
                 
+                if pairs:
+                    saved = self.new_frame_db.save_frames_with_original(pairs)
+                    migrated = sum(1 for frame_uuid in saved if frame_uuid)
+                    stats["migrated"] += migrated
+                    stats["failed"] += len(saved) - migrated
+                
                 skip += batch_size
                 
                 # Log progress
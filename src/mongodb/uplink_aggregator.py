@@ -0,0 +1,199 @@
+#!/usr/bin/env python3
+"""
+Uplink Aggregator
+=================
+
+Central receiver for edge pipelines running the "uplink" persistence backend
+(`persistence_backend: "uplink"` in config.yaml, UplinkPersistenceBackend in uplink_backend.hpp).
+
+Each edge streams frame documents with their region crop JPEGs, and per-minute motion
+summaries, over one TCP connection; full frames never leave the edge. The aggregator writes
+the crops under <crop_dir>/<site>/, stores the documents in the same captured_frames and
+motion_stats collections FrameDatabaseV2 uses (tagged with the edge's site), and acknowledges
+what it stored. The edge keeps unacknowledged messages in its spool and resends them after a
+reconnect, so every write here is an idempotent upsert.
+
+    python -m mongodb.uplink_aggregator --port 7450 --mongodb-uri mongodb://localhost:27017/
+
+One thread per edge suits a handful of sites; for thousands, run the C++ birds_of_play_ingest
+(UplinkIngestServer in uplink_ingest.hpp), which speaks the same protocol.
+"""
+
+import argparse
+import logging
+import select
+import socket
+import socketserver
+import struct
+from pathlib import Path
+from typing import List, Optional, Tuple
+
+from bson import json_util
+from pymongo import ReplaceOne, UpdateOne
+
+from .database_manager import DatabaseManager
+
+# Keep in sync with uplink_wire in uplink_backend.hpp
+HELLO_MAGIC = 0x55504F42  # "BOPU"
+MESSAGE_MAGIC = 0x4D504F42  # "BOPM"
+VERSION = 1
+HELLO = struct.Struct("<IHH")  # magic, version, site length
+MESSAGE_HEADER = struct.Struct("<IBBHI")  # magic, kind, reserved, image count, document length
+IMAGE_LENGTH = struct.Struct("<I")
+ACK = struct.Struct("<Q")  # Messages of this connection stored so far
+FRAME_MESSAGE = 1
+SUMMARY_MESSAGE = 2
+
+MAX_BATCH = 64  # Messages stored in one bulk write (and acknowledged together)
+
+logger = logging.getLogger(__name__)
+
+
+def read_exact(connection: socket.socket, size: int) -> Optional[bytes]:
+    """Read exactly size bytes; None if the edge closed the connection first."""
+    chunks = []
+    while size > 0:
+        chunk = connection.recv(min(size, 1 << 20))
+        if not chunk:
+            return None
+        chunks.append(chunk)
+        size -= len(chunk)
+    return b"".join(chunks)
+
+
+def read_message(connection: socket.socket) -> Optional[Tuple[int, dict, List[bytes]]]:
+    """One message as (kind, document, images); None at the end of the stream."""
+    header = read_exact(connection, MESSAGE_HEADER.size)
+    if header is None:
+        return None
+    magic, kind, _, image_count, document_length = MESSAGE_HEADER.unpack(header)
+    if magic != MESSAGE_MAGIC:
+        raise ValueError(f"bad message magic {magic:#x}")
+    document = read_exact(connection, document_length)
+    images = []
+    for _ in range(image_count):
+        length = read_exact(connection, IMAGE_LENGTH.size)
+        image = read_exact(connection, IMAGE_LENGTH.unpack(length)[0]) if length else None
+        if image is None:
+            return None
+        images.append(image)
+    if document is None:
+        return None
+    return kind, json_util.loads(document), images
+
+
+class UplinkAggregator(socketserver.ThreadingTCPServer):
+    """Accepts edge connections; one thread per edge."""
+
+    daemon_threads = True
+    allow_reuse_address = True
+
+    def __init__(self, address: Tuple[str, int], db_manager: DatabaseManager, crop_dir: str):
+        super().__init__(address, UplinkHandler)
+        self.db_manager = db_manager
+        self.crop_dir = Path(crop_dir)
+
+    def store(self, site: str, messages: List[Tuple[int, dict, List[bytes]]]):
+        """Write crops and upsert documents; raises if the database refused the batch."""
+        frames, summaries = [], []
+        for kind, document, images in messages:
+            document["site"] = site
+            if kind == FRAME_MESSAGE:
+                site_dir = self.crop_dir / site
+                site_dir.mkdir(parents=True, exist_ok=True)
+                crops = document.get("region_crops", [])
+                for index, (crop, image) in enumerate(zip(crops, images)):
+                    path = site_dir / f"{document['_id']}_{index}.jpg"
+                    path.write_bytes(image)
+                    crop["path"] = str(path)
+                # plate_patches: the edge sends each background plate once, after the crops
+                # of the first document that refers to it
+                plate = document.get("background_plate")
+                if plate:
+                    plate_path = site_dir / "plates" / f"{plate['id']}{Path(plate['path']).suffix}"
+                    if len(images) > len(crops):
+                        plate_path.parent.mkdir(exist_ok=True)
+                        plate_path.write_bytes(images[len(crops)])
+                    plate["path"] = str(plate_path)
+                frames.append(ReplaceOne({"_id": document["_id"]}, document, upsert=True))
+            elif kind == SUMMARY_MESSAGE:
+                # Merged like FrameDatabaseV2.upsert_motion_stats, per site
+                summaries.append(UpdateOne(
+                    {"_id": f"{site}/{document['_id']}"},
+                    {
+                        "$setOnInsert": {"site": site, "source": document["source"], "minute": document["minute"]},
+                        "$inc": {key: document[key] for key in ("frames", "motion_frames", "motion_boxes", "regions")},
+                        "$max": {key: document[key] for key in ("max_regions", "latency_max_ms")},
+                        "$set": {key: document[key] for key in ("mean_boxes_per_frame", "latency_p50_ms",
+                                                                 "latency_p95_ms", "latency_p99_ms", "updated_at")},
+                    },
+                    upsert=True,
+                ))
+        if frames:
+            self.db_manager.get_collection("captured_frames").bulk_write(frames, ordered=False)
+        if summaries:
+            self.db_manager.get_collection("motion_stats").bulk_write(summaries, ordered=False)
+
+
+class UplinkHandler(socketserver.BaseRequestHandler):
+    """One edge: hello, then messages, acknowledged after each stored batch."""
+
+    def handle(self):
+        hello = read_exact(self.request, HELLO.size)
+        if hello is None:
+            return
+        magic, version, site_length = HELLO.unpack(hello)
+        if magic != HELLO_MAGIC or version != VERSION:
+            logger.warning(f"{self.client_address}: not an uplink hello, closing")
+            return
+        site = (read_exact(self.request, site_length) or b"").decode("utf-8", "replace")
+        logger.info(f"Edge {site} connected from {self.client_address[0]}")
+
+        stored = 0
+        try:
+            while True:
+                message = read_message(self.request)
+                if message is None:
+                    break
+                batch = [message]
+                # Whatever else has already arrived goes into the same bulk write
+                while len(batch) < MAX_BATCH and select.select([self.request], [], [], 0)[0]:
+                    message = read_message(self.request)
+                    if message is None:
+                        break
+                    batch.append(message)
+                self.server.store(site, batch)
+                stored += len(batch)
+                self.request.sendall(ACK.pack(stored))
+                if message is None:
+                    break
+        except Exception as e:
+            # Unacknowledged messages stay in the edge's spool and come back on reconnect
+            logger.error(f"Edge {site}: {e}")
+        logger.info(f"Edge {site} disconnected after {stored} messages")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Receive detections and region crops from uplink edges")
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=7450)
+    parser.add_argument("--mongodb-uri", default="mongodb://localhost:27017/")
+    parser.add_argument("--database", default="birds_of_play")
+    parser.add_argument("--crop-dir", default="data/uplink_regions", help="Region crops, one directory per site")
+    args = parser.parse_args()
+    logging.basicConfig(level=logging.INFO, format="%(asctime)s %(levelname)s %(message)s")
+
+    db_manager = DatabaseManager(args.mongodb_uri, args.database)
+    if not db_manager.connect():
+        raise SystemExit(1)
+    with UplinkAggregator((args.host, args.port), db_manager, args.crop_dir) as server:
+        logger.info(f"Uplink aggregator listening on {args.host}:{args.port}")
+        try:
+            server.serve_forever()
+        except KeyboardInterrupt:
+            pass
+    db_manager.disconnect()
+
+
+if __name__ == "__main__":
+    main()
@@ -1,75 +1,105 @@
-#include <opencv2/opencv.hpp>
-#include <pybind11/embed.h>
-#include <pybind11/numpy.h>
-#include <string>
+#include "mongodb_functions.hpp"
+
 #include <iostream>
+#include <optional>
+#include <system_error>
+
+#include "motion_detection/include/logger.hpp"
+#include "motion_detection/include/numpy_conversion.hpp"  // cv_mat_to_numpy (zero-copy)
+
+// ============================================================================
+// MongoFrameSession
+// ============================================================================
+
+MongoFrameSession::MongoFrameSession(const std::string& storagePath, const std::string& databaseName)
+    : storagePath_(storagePath), databaseName_(databaseName) {
+    connect();
+}
+
+MongoFrameSession::~MongoFrameSession() {
+    disconnect();
+}
 
-namespace py = pybind11;
-
-// Helper function to convert cv::Mat to numpy array
-py::array_t<unsigned char> cv_mat_to_numpy(const cv::Mat& mat) {
-    // Ensure the matrix is continuous
-    cv::Mat continuous_mat;
-    if (!mat.isContinuous()) {
-        continuous_mat = mat.clone();
-    } else {
-        continuous_mat = mat;
-    }
-    
-    // Get the shape and data type
-    std::vector<size_t> shape = {static_cast<size_t>(continuous_mat.rows), 
-                                 static_cast<size_t>(continuous_mat.cols), 
-                                 static_cast<size_t>(continuous_mat.channels())};
-    
-    // Create numpy array
-    py::array_t<unsigned char> numpy_array(shape, continuous_mat.data);
-    return numpy_array;
-}
-
-std::string save_frame_to_mongodb(const cv::Mat& frame, const std::string& metadata_json) {
+bool MongoFrameSession::importModules() {
+    if (modulesImported_) return true;
     try {
         // Import Python modules
         py::module sys = py::module::import("sys");
         py::module os = py::module::import("os");
-        
+
         // Add the src directory to Python path
         std::string current_dir = os.attr("getcwd")().cast<std::string>();
         sys.attr("path").attr("insert")(0, current_dir + "/src");
-        
+
         // Add virtual environment site-packages to Python path
         std::string venv_site_packages = current_dir + "/venv/lib/python3.13/site-packages";
         sys.attr("path").attr("insert")(0, venv_site_packages);
-        
-        // Import our MongoDB modules
-        py::module db_manager_module = py::module::import("mongodb.database_manager");
-        py::module frame_db_v2_module = py::module::import("mongodb.frame_database_v2");
-        
-        // Get the classes
-        py::object DatabaseManager = db_manager_module.attr("DatabaseManager");
-        py::object FrameDatabaseV2 = frame_db_v2_module.attr("FrameDatabaseV2");
-        
+
+        // Import our MongoDB modules and cache the classes
+        databaseManagerClass_ =
+            py::module::import("mongodb.database_manager").attr("DatabaseManager");
+        frameDatabaseClass_ =
+            py::module::import("mongodb.frame_database_v2").attr("FrameDatabaseV2");
+        jsonLoads_ = py::module::import("json").attr("loads");
+
+        modulesImported_ = true;
+    } catch (const py::error_already_set& e) {
+        std::cerr << "Python error: " << e.what() << std::endl;
+    }
+    return modulesImported_;
+}
+
+bool MongoFrameSession::connect() {
+    lastConnectAttempt_ = std::chrono::steady_clock::now();
+    if (!importModules()) return false;
+
+    disconnect();
+    try {
         // Create database manager and connect
-        py::object db_manager = DatabaseManager();
-        db_manager.attr("connect")();
-        
-        // Create frame database V2 with file storage (default path: data/frames)
-        py::object frame_db = FrameDatabaseV2(db_manager, py::str("data/frames"));
-        
-        // Convert metadata JSON to Python dict
-        py::module json = py::module::import("json");
-        py::object metadata = json.attr("loads")(metadata_json);
-        
-        // Convert cv::Mat to numpy array for Python
+        py::object db_manager = databaseManagerClass_(py::arg("database_name") = databaseName_);
+        if (!db_manager.attr("connect")().cast<bool>()) {
+            std::cerr << "MongoDB connection failed" << std::endl;
+            return false;
+        }
+
+        // Create frame database V2 with file storage (indexes are created here, once)
+        frameDb_ = frameDatabaseClass_(db_manager, py::str(storagePath_));
+        dbManager_ = std::move(db_manager);
+        connected_ = true;
+    } catch (const py::error_already_set& e) {
+        std::cerr << "Python error: " << e.what() << std::endl;
+        frameDb_ = py::object();
+    }
+    return connected_;
+}
+
+void MongoFrameSession::disconnect() {
+    if (dbManager_) {
+        try {
+            dbManager_.attr("disconnect")();
+        } catch (const py::error_already_set& e) {
+            std::cerr << "Python error: " << e.what() << std::endl;
+        }
+    }
+    frameDb_ = py::object();
+    dbManager_ = py::object();
+    connected_ = false;
+}
+
+bool MongoFrameSession::ensureConnected() {
+    if (connected_) return true;
+    // Throttle reconnects so an offline database doesn't cost a timeout on every frame
+    if (std::chrono::steady_clock::now() - lastConnectAttempt_ < reconnectInterval_) return false;
+    return connect();
+}
+
+std::string MongoFrameSession::saveFrame(const cv::Mat& frame, const std::string& metadata_json) {
+    if (!ensureConnected()) return std::string("");
+    try {
+        py::object metadata = jsonLoads_(metadata_json);
         py::array_t<unsigned char> numpy_frame = cv_mat_to_numpy(frame);
-        
-        // Save frame
-        py::object result = frame_db.attr("save_frame")(numpy_frame, metadata);
-        
-        // Disconnect
-        db_manager.attr("disconnect")();
-        
+        py::object result = frameDb_.attr("save_frame")(numpy_frame, metadata);
         return result.cast<std::string>();
-        
     } catch (const py::error_already_set& e) {
         std::cerr << "Python error: " << e.what() << std::endl;
         return std::string("");
@@ -79,51 +109,17 @@ std::string save_frame_to_mongodb(const cv::Mat& frame, const std::string& metad
     }
 }
 
-std::string save_frames_to_mongodb(const cv::Mat& original_frame, const cv::Mat& processed_frame, const std::string& metadata_json) {
+std::string MongoFrameSession::saveFrames(const cv::Mat& original_frame,
+                                          const cv::Mat& processed_frame,
+                                          const std::string& metadata_json) {
+    if (!ensureConnected()) return std::string("");
     try {
-        // Import Python modules
-        py::module sys = py::module::import("sys");
-        py::module os = py::module::import("os");
-        
-        // Add the src directory to Python path
-        std::string current_dir = os.attr("getcwd")().cast<std::string>();
-        sys.attr("path").attr("insert")(0, current_dir + "/src");
-        
-        // Add virtual environment site-packages to Python path
-        std::string venv_site_packages = current_dir + "/venv/lib/python3.13/site-packages";
-        sys.attr("path").attr("insert")(0, venv_site_packages);
-        
-        // Import our MongoDB modules
-        py::module db_manager_module = py::module::import("mongodb.database_manager");
-        py::module frame_db_v2_module = py::module::import("mongodb.frame_database_v2");
-        
-        // Get the classes
-        py::object DatabaseManager = db_manager_module.attr("DatabaseManager");
-        py::object FrameDatabaseV2 = frame_db_v2_module.attr("FrameDatabaseV2");
-        
-        // Create database manager and connect
-        py::object db_manager = DatabaseManager();
-        db_manager.attr("connect")();
-        
-        // Create frame database V2 with file storage (default path: data/frames)
-        py::object frame_db = FrameDatabaseV2(db_manager, py::str("data/frames"));
-        
-        // Convert metadata JSON to Python dict
-        py::module json = py::module::import("json");
-        py::object metadata = json.attr("loads")(metadata_json);
-        
-        // Convert cv::Mat to numpy arrays for Python
+        py::object metadata = jsonLoads_(metadata_json);
         py::array_t<unsigned char> numpy_original = cv_mat_to_numpy(original_frame);
         py::array_t<unsigned char> numpy_processed = cv_mat_to_numpy(processed_frame);
-        
-        // Save both frames
-        py::object result = frame_db.attr("save_frame_with_original")(numpy_original, numpy_processed, metadata);
-        
-        // Disconnect
-        db_manager.attr("disconnect")();
-        
+        py::object result = frameDb_.attr("save_frame_with_original")(numpy_original,
+                                                                       numpy_processed, metadata);
         return result.cast<std::string>();
-        
     } catch (const py::error_already_set& e) {
         std::cerr << "Python error: " << e.what() << std::endl;
         return std::string("");
@@ -132,3 +128,336 @@ std::string save_frames_to_mongodb(const cv::Mat& original_frame, const cv::Mat&
         return std::string("");
     }
 }
+
+std::vector<std::string> MongoFrameSession::insertFrameRecords(
+    const std::vector<StoredFrameRecord>& records) {
+    std::vector<std::string> inserted;
+    if (records.empty() || !ensureConnected()) return inserted;
+    try {
+        py::list pyRecords;
+        for (const auto& record : records) {
+            py::dict entry;
+            entry["uuid"] = record.uuid;
+            // None for images that were not written, as save_frame_with_original stores them
+            const auto pathOrNone = [](const std::string& path) -> py::object {
+                return path.empty() ? py::object(py::none()) : py::object(py::str(path));
+            };
+            entry["original_image_path"] = pathOrNone(record.originalPath);
+            entry["processed_image_path"] = pathOrNone(record.processedPath);
+            entry["original_thumbnail_path"] = pathOrNone(record.originalThumbnailPath);
+            entry["processed_thumbnail_path"] = pathOrNone(record.processedThumbnailPath);
+            // Images appended to a FrameSegmentStore
+            for (const auto& image :
+                 {std::make_pair("original_image_segment", &record.originalSegment),
+                  std::make_pair("processed_image_segment", &record.processedSegment),
+                  std::make_pair("original_thumbnail_segment", &record.originalThumbnailSegment),
+                  std::make_pair("processed_thumbnail_segment",
+                                 &record.processedThumbnailSegment)}) {
+                if (image.second->empty()) continue;
+                py::dict extent;
+                extent["file"] = image.second->file;
+                extent["offset"] = image.second->offset;
+                extent["length"] = image.second->length;
+                if (!image.second->contentType.empty()) extent["content_type"] = image.second->contentType;
+                entry[image.first] = extent;
+            }
+            py::dict images;
+            for (const StoredImageLink& link : storedImageLinks(record)) {
+                py::dict image;
+                image["url"] = link.url;
+                image["bytes"] = link.bytes;
+                images[link.kind] = image;
+            }
+            entry["images"] = images;
+            if (!record.regionCrops.empty()) {
+                py::list crops;
+                for (size_t i = 0; i < record.regionCrops.size(); ++i) {
+                    const StoredRegionCrop& crop = record.regionCrops[i];
+                    py::dict cropEntry;
+                    cropEntry["path"] = crop.path;
+                    cropEntry["region"] = py::make_tuple(crop.region.x, crop.region.y,
+                                                         crop.region.width, crop.region.height);
+                    cropEntry["crop"] = py::make_tuple(crop.crop.x, crop.crop.y, crop.crop.width,
+                                                       crop.crop.height);
+                    cropEntry["url"] = regionCropUrl(record.uuid, i);
+                    cropEntry["bytes"] = crop.bytes;
+                    crops.append(cropEntry);
+                }
+                entry["region_crops"] = crops;
+            }
+            if (!record.plate.id.empty()) {
+                py::dict plate;
+                plate["id"] = record.plate.id;
+                plate["path"] = record.plate.path;
+                plate["size"] = py::make_tuple(record.plate.size.width, record.plate.size.height);
+                entry["background_plate"] = plate;
+            }
+            if (!record.atlasCell.sheet.empty()) {
+                const AtlasCell& cell = record.atlasCell;
+                py::dict atlas;
+                atlas["sheet"] = cell.sheet;
+                atlas["sheet_size"] = py::make_tuple(cell.sheetSize.width, cell.sheetSize.height);
+                atlas["rect"] = py::make_tuple(cell.rect.x, cell.rect.y, cell.rect.width, cell.rect.height);
+                entry["thumbnail_atlas"] = atlas;
+            }
+            entry["original_frame_shape"] = py::make_tuple(
+                record.originalSize.height, record.originalSize.width, record.originalChannels);
+            entry["frame_shape"] = py::make_tuple(record.processedSize.height,
+                                                  record.processedSize.width,
+                                                  record.processedChannels);
+            entry["metadata"] = frame_metadata_to_python(record.metadata);
+            pyRecords.append(entry);
+        }
+        py::list result = frameDb_.attr("insert_frame_records")(pyRecords);
+        inserted.reserve(result.size());
+        for (const auto& id : result) inserted.push_back(id.cast<std::string>());
+    } catch (const py::error_already_set& e) {
+        std::cerr << "Python error: " << e.what() << std::endl;
+        inserted.clear();
+    } catch (const std::exception& e) {
+        std::cerr << "C++ error: " << e.what() << std::endl;
+        inserted.clear();
+    }
+    return inserted;
+}
+
+bool MongoFrameSession::upsertMotionSummaries(const std::vector<MotionMinuteSummary>& summaries) {
+    if (summaries.empty()) return true;
+    if (!ensureConnected()) return false;
+    try {
+        py::list pySummaries;
+        for (const auto& summary : summaries) {
+            py::dict entry;
+            entry["source"] = summary.source;
+            entry["minute_start"] = summary.minuteStart;
+            entry["frames"] = summary.frames;
+            entry["motion_frames"] = summary.motionFrames;
+            entry["motion_boxes"] = summary.motionBoxes;
+            entry["regions"] = summary.regions;
+            entry["max_regions"] = summary.maxRegions;
+            entry["latency_p50_ms"] = summary.latencyP50Ms;
+            entry["latency_p95_ms"] = summary.latencyP95Ms;
+            entry["latency_p99_ms"] = summary.latencyP99Ms;
+            entry["latency_max_ms"] = summary.latencyMaxMs;
+            pySummaries.append(entry);
+        }
+        return frameDb_.attr("upsert_motion_stats")(pySummaries).cast<bool>();
+    } catch (const py::error_already_set& e) {
+        std::cerr << "Python error: " << e.what() << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "C++ error: " << e.what() << std::endl;
+    }
+    return false;
+}
+
+// ============================================================================
+// PythonPersistenceBackend
+// ============================================================================
+
+PythonPersistenceBackend::PythonPersistenceBackend(const std::string& storagePath, const std::string& databaseName)
+    : storagePath_(storagePath), databaseName_(databaseName) {}
+
+PythonPersistenceBackend::~PythonPersistenceBackend() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    if (interpreterThread_.joinable()) interpreterThread_.join();
+}
+
+bool PythonPersistenceBackend::connect() {
+    if (interpreterThread_.joinable()) return true;
+    try {
+        interpreterThread_ = std::thread(&PythonPersistenceBackend::run, this);
+    } catch (const std::system_error& e) {
+        LOG_ERROR("Could not start the Python persistence thread: {}", e.what());
+        return false;
+    }
+    return true;
+}
+
+void PythonPersistenceBackend::run() {
+    const auto start = std::chrono::steady_clock::now();
+    std::optional<py::scoped_interpreter> interpreter;
+    try {
+        interpreter.emplace(false);  // No Python signal handlers
+    } catch (const std::exception& e) {
+        LOG_ERROR("Embedded Python failed to start: {}", e.what());
+        finishStartup(false);
+        return;
+    }
+    try {
+        py::module::import("numpy");
+    } catch (const py::error_already_set& e) {
+        LOG_WARN("numpy not importable in the embedded interpreter: {}", e.what());
+    }
+    session_ = std::make_unique<MongoFrameSession>(storagePath_, databaseName_);  // Imports the modules, connects
+    LOG_INFO("Python persistence ready after {} ms{}",
+             std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count(),
+             session_->isConnected() ? "" : " (MongoDB unavailable; saves will retry the connection)");
+    {
+        py::gil_scoped_release releaseGil;
+        finishStartup(true);
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [this] { return stopping_; });
+    }
+    session_.reset();  // Before the interpreter is finalized
+}
+
+void PythonPersistenceBackend::finishStartup(bool ok) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        started_ = true;
+        ready_ = ok;
+    }
+    changed_.notify_all();
+}
+
+bool PythonPersistenceBackend::waitReady() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this] { return started_ || stopping_ || !interpreterThread_.joinable(); });
+    return ready_ && !stopping_;
+}
+
+std::vector<std::string> PythonPersistenceBackend::insertRecords(
+    const std::vector<StoredFrameRecord>& records) {
+    if (!waitReady()) return {};
+    py::gil_scoped_acquire acquireGil;
+    return session_->insertFrameRecords(records);
+}
+
+bool PythonPersistenceBackend::upsertMotionSummaries(
+    const std::vector<MotionMinuteSummary>& summaries) {
+    if (!waitReady()) return false;
+    py::gil_scoped_acquire acquireGil;
+    return session_->upsertMotionSummaries(summaries);
+}
+
+// ============================================================================
+// Metadata conversion
+// ============================================================================
+
+py::dict frame_metadata_to_python(const FrameMetadata& metadata) {
+    py::list regions;
+    for (const auto& region : metadata.consolidatedRegions) {
+        py::dict entry;
+        entry["x"] = region.box.x;
+        entry["y"] = region.box.y;
+        entry["width"] = region.box.width;
+        entry["height"] = region.box.height;
+        entry["object_count"] = region.objectCount;
+        entry["class_label"] = region.classLabel;
+        entry["class_confidence"] = region.classConfidence;
+        entry["class_id"] = region.classId;
+        entry["speed"] = region.speed;
+        entry["direction"] = region.direction;
+        regions.append(entry);
+    }
+
+    py::dict document;
+    document["source"] = metadata.source;
+    document["frame_count"] = metadata.frameCount;
+    // A datetime, which pymongo stores as a BSON date
+    py::module datetime = py::module::import("datetime");
+    document["timestamp"] = datetime.attr("datetime").attr("fromtimestamp")(
+        metadata.timestamp, datetime.attr("timezone").attr("utc"));
+    document["auto_saved"] = metadata.autoSaved;
+    document["motion_detected"] = metadata.motionDetected;
+    document["motion_regions"] = metadata.motionRegions;
+    document["consolidated_regions_count"] = metadata.consolidatedRegions.size();
+    document["confidence"] = metadata.confidence;
+    document["consolidated_regions"] = regions;
+    if (metadata.includeMotionBoxes) {
+        py::list boxes;
+        for (const auto& box : metadata.motionBoxes) {
+            py::dict entry;
+            entry["x"] = box.x;
+            entry["y"] = box.y;
+            entry["width"] = box.width;
+            entry["height"] = box.height;
+            boxes.append(entry);
+        }
+        document["motion_boxes"] = boxes;
+    }
+    if (metadata.captureTimeUs != 0) {
+        document["capture_time"] = datetime.attr("datetime").attr("fromtimestamp")(
+            static_cast<double>(metadata.captureTimeUs) / 1e6, datetime.attr("timezone").attr("utc"));
+        document["source_timestamp_ms"] = metadata.sourceTimestampMs;
+        py::dict latency;
+        latency["detect_queued"] = metadata.latency.detectQueuedMs;
+        latency["detect"] = metadata.latency.detectMs;
+        latency["consolidate_queued"] = metadata.latency.consolidateQueuedMs;
+        latency["consolidate"] = metadata.latency.consolidateMs;
+        latency["render_queued"] = metadata.latency.renderQueuedMs;
+        latency["total"] = metadata.latency.totalMs;
+        document["latency_ms"] = latency;
+    }
+    if (!metadata.motionMask.size.empty()) {
+        const MotionMaskMetadata& mask = metadata.motionMask;
+        const auto box = [](const cv::Rect& rect) {
+            py::dict entry;
+            entry["x"] = rect.x;
+            entry["y"] = rect.y;
+            entry["width"] = rect.width;
+            entry["height"] = rect.height;
+            return entry;
+        };
+        py::dict centroid;
+        centroid["x"] = mask.centroid.x;
+        centroid["y"] = mask.centroid.y;
+        py::dict entry;
+        entry["width"] = mask.size.width;
+        entry["height"] = mask.size.height;
+        entry["roi"] = box(mask.frameArea);
+        entry["pixels"] = mask.pixels;
+        entry["bounds"] = box(mask.bounds);
+        entry["centroid"] = centroid;
+        entry["counts"] = mask.counts;
+        document["motion_mask"] = entry;
+    }
+    if (metadata.isVisit) {
+        const VisitMetadata& visit = metadata.visit;
+        py::list trackIds;
+        for (const int id : visit.trackIds) trackIds.append(id);
+        py::list scores;
+        for (const double score : visit.cropScores) scores.append(score);
+        py::list path;
+        for (const auto& point : visit.path) {
+            py::dict entry;
+            entry["x"] = point.center.x;
+            entry["y"] = point.center.y;
+            entry["t_ms"] = point.offsetMs;
+            path.append(entry);
+        }
+        py::dict entry;
+        entry["start_time"] = datetime.attr("datetime").attr("fromtimestamp")(
+            static_cast<double>(visit.startUs) / 1e6, datetime.attr("timezone").attr("utc"));
+        entry["end_time"] = datetime.attr("datetime").attr("fromtimestamp")(
+            static_cast<double>(visit.endUs) / 1e6, datetime.attr("timezone").attr("utc"));
+        entry["duration_s"] = static_cast<double>(visit.endUs - visit.startUs) / 1e6;
+        entry["frames"] = visit.frames;
+        entry["track_ids"] = trackIds;
+        entry["path"] = path;
+        entry["crop_scores"] = scores;
+        document["visit"] = entry;
+    }
+    return document;
+}
+
+// ============================================================================
+// One-shot helpers
+// ============================================================================
+
+std::string save_frame_to_mongodb(const cv::Mat& frame, const std::string& metadata_json,
+                                  const std::string& storagePath, const std::string& databaseName) {
+    MongoFrameSession session(storagePath, databaseName);
+    return session.saveFrame(frame, metadata_json);
+}
+
+std::string save_frames_to_mongodb(const cv::Mat& original_frame, const cv::Mat& processed_frame,
+                                   const std::string& metadata_json, const std::string& storagePath,
+                                   const std::string& databaseName) {
+    MongoFrameSession session(storagePath, databaseName);
+    return session.saveFrames(original_frame, processed_frame, metadata_json);
+}
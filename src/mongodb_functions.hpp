@@ -0,0 +1,150 @@
+#pragma once
+
+#include <pybind11/embed.h>
+#include <pybind11/numpy.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "motion_detection/include/frame_file_storage.hpp"       // StoredFrameRecord
+#include "motion_detection/include/frame_metadata.hpp"           // FrameMetadata
+#include "motion_detection/include/motion_stats_aggregator.hpp"  // MotionMinuteSummary
+#include "motion_detection/include/persistence_backend.hpp"      // PersistenceBackend
+
+namespace py = pybind11;
+
+/**
+ * @brief Long-lived embedded-Python MongoDB session
+ *
+ * Performs the sys.path setup, imports mongodb.database_manager / mongodb.frame_database_v2,
+ * connects a DatabaseManager (to @p databaseName) and builds one FrameDatabaseV2 (index creation included) once,
+ * then reuses those handles for every save. If the connection is unavailable, a reconnect is
+ * attempted on the next save, no more often than every reconnectInterval.
+ *
+ * Thread safety: every method, including construction and destruction, requires the GIL.
+ * The session must be destroyed before the interpreter is finalized.
+ */
+class MongoFrameSession {
+   public:
+    explicit MongoFrameSession(const std::string& storagePath = "data/frames",
+                               const std::string& databaseName = "birds_of_play");
+    ~MongoFrameSession();
+
+    MongoFrameSession(const MongoFrameSession&) = delete;
+    MongoFrameSession& operator=(const MongoFrameSession&) = delete;
+
+    /**
+     * @brief Connect (or reconnect) to MongoDB and build the frame database
+     * @return true if the session is ready to save frames
+     */
+    bool connect();
+
+    // Close the MongoDB connection; the imported modules stay cached
+    void disconnect();
+
+    bool isConnected() const { return connected_; }
+
+    /**
+     * @brief Save a single frame with metadata
+     * @return Frame UUID, or an empty string on failure
+     */
+    std::string saveFrame(const cv::Mat& frame, const std::string& metadata_json);
+
+    /**
+     * @brief Save an original/processed frame pair with metadata
+     * @return Frame UUID, or an empty string on failure
+     */
+    std::string saveFrames(const cv::Mat& original_frame, const cv::Mat& processed_frame,
+                           const std::string& metadata_json);
+
+    /**
+     * @brief Insert metadata documents for frames already written to disk (one insert_many)
+     * @return UUIDs of the inserted documents; empty on failure
+     */
+    std::vector<std::string> insertFrameRecords(const std::vector<StoredFrameRecord>& records);
+
+    /**
+     * @brief Upsert per-minute motion summaries (FrameDatabaseV2.upsert_motion_stats)
+     * @return false on failure
+     */
+    bool upsertMotionSummaries(const std::vector<MotionMinuteSummary>& summaries);
+
+   private:
+    bool importModules();
+    bool ensureConnected();
+
+    std::string storagePath_;
+    std::string databaseName_;
+    bool modulesImported_ = false;
+    bool connected_ = false;
+    std::chrono::steady_clock::time_point lastConnectAttempt_{};
+    std::chrono::seconds reconnectInterval_{5};
+
+    py::object databaseManagerClass_;
+    py::object frameDatabaseClass_;
+    py::object jsonLoads_;
+    py::object dbManager_;
+    py::object frameDb_;
+};
+
+/**
+ * @brief The "python" PersistenceBackend: an embedded interpreter and MongoFrameSession of its own
+ *
+ * connect() returns at once: the interpreter is initialized on a background thread, which
+ * also pre-imports numpy, pymongo (through the mongodb modules) and connects the session, so
+ * neither process start nor the first save waits for Python to load. That thread owns the
+ * interpreter: it releases the GIL while idle and finalizes the interpreter when the backend
+ * is destroyed. Python installs no signal handlers, so the process keeps its own SIGINT
+ * handling. Saves take the GIL themselves; the first ones wait on the persistence worker until
+ * the startup has finished.
+ *
+ * Thread safety: as PersistenceBackend. The process must not embed another interpreter.
+ */
+class PythonPersistenceBackend : public PersistenceBackend {
+   public:
+    explicit PythonPersistenceBackend(const std::string& storagePath = "data/frames",
+                                      const std::string& databaseName = "birds_of_play");
+    ~PythonPersistenceBackend() override;  // Finalizes the interpreter
+
+    PythonPersistenceBackend(const PythonPersistenceBackend&) = delete;
+    PythonPersistenceBackend& operator=(const PythonPersistenceBackend&) = delete;
+
+    const char* name() const override { return "python"; }
+    // Starts the interpreter thread; true unless it could not be started
+    bool connect() override;
+    std::vector<std::string> insertRecords(const std::vector<StoredFrameRecord>& records) override;
+    bool upsertMotionSummaries(const std::vector<MotionMinuteSummary>& summaries) override;
+
+   private:
+    void run();
+    void finishStartup(bool ok);
+    // Blocks until the interpreter thread is up; false if it failed to start
+    bool waitReady();
+
+    std::string storagePath_;
+    std::string databaseName_;
+    std::thread interpreterThread_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    bool started_ = false;   // Guarded by mutex_: startup finished (successfully or not)
+    bool ready_ = false;     // Guarded by mutex_: interpreter up and the modules imported
+    bool stopping_ = false;  // Guarded by mutex_
+    std::unique_ptr<MongoFrameSession> session_;  // Only touched under the GIL
+};
+
+// Metadata document as the dict FrameDatabaseV2 stores (same fields as the JSON it parses)
+py::dict frame_metadata_to_python(const FrameMetadata& metadata);
+
+// One-shot helpers: open a session, save, disconnect. Prefer a long-lived MongoFrameSession.
+std::string save_frame_to_mongodb(const cv::Mat& frame, const std::string& metadata_json,
+                                  const std::string& storagePath = "data/frames",
+                                  const std::string& databaseName = "birds_of_play");
+std::string save_frames_to_mongodb(const cv::Mat& original_frame, const cv::Mat& processed_frame,
+                                   const std::string& metadata_json, const std::string& storagePath = "data/frames",
+                                   const std::string& databaseName = "birds_of_play");
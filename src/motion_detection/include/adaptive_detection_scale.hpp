@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <vector>
+
+#include "streaming_quantile.hpp"
+
+struct AdaptiveScaleConfig {
+    bool enabled = false;
+    double percentile = 0.05;       // Bird size quantile that must stay resolvable
+    double minObjectPixels = 12.0;  // Its smaller side, in processing pixels, must stay above this
+    double minScale = 0.25;         // Coarsest detection_scale it may pick
+    double maxScale = 1.0;          // Finest
+    double scaleStep = 0.125;       // Scales are multiples of this (fewer, larger changes)
+    int evaluateIntervalFrames = 300;  // Processed frames between two evaluations
+    int minSamples = 50;            // Boxes an evaluation needs; fewer keep accumulating
+    double hysteresis = 0.25;       // Coarser only with this much margin over minObjectPixels
+};
+
+/**
+ * @brief Picks a stream's detection_scale from the sizes of the birds it actually sees
+ *
+ * The right scale depends on the camera: birds fill a close feeder camera, so it can detect
+ * on a quarter of the pixels, while a wide yard camera needs every pixel. This learns the
+ * percentile-th quantile of the smaller side of the accepted motion boxes (full-frame
+ * pixels, a StreamingQuantile) and every evaluateIntervalFrames processed frames picks the
+ * coarsest scale (a multiple of scaleStep in [minScale, maxScale]) at which that bird is
+ * still minObjectPixels across.
+ *
+ * Hysteresis keeps it from flapping: a finer scale is taken as soon as the quantile needs
+ * it, a coarser one only if the bird stays (1 + hysteresis) times minObjectPixels across at
+ * that scale. Each evaluation starts a new sample window. Birds too small to be detected at
+ * the current scale are never sampled, so minObjectPixels should sit well above the smallest
+ * box detection keeps (min_contour_area at that scale); the margin then lets a drop in size
+ * show up before birds are lost.
+ *
+ * The load shedder's scale factor multiplies the scale this picks.
+ *
+ * Thread safety: not thread-safe; one instance per stream, fed by the thread processing it.
+ */
+class AdaptiveDetectionScale {
+   public:
+    // @p initialScale: the configured detection_scale, used until the first evaluation
+    AdaptiveDetectionScale(const AdaptiveScaleConfig& config, double initialScale);
+
+    /**
+     * @brief Add the accepted boxes of one processed frame (frames without boxes count too)
+     * @return true when scale() changed
+     */
+    bool observe(const std::vector<cv::Rect>& boxes);
+
+    double scale() const { return scale_; }
+    // Size quantile of the last evaluation (0 before it)
+    double sizeQuantile() const { return lastQuantile_; }
+    uint64_t changes() const { return changes_; }
+    const AdaptiveScaleConfig& config() const { return config_; }
+
+    // Start over at @p scale (config reload, stream restart)
+    void reset(double scale);
+
+   private:
+    bool evaluate();
+    // Smallest scale on the ladder at which @p size is at least @p pixels across
+    double coarsestScaleFor(double size, double pixels) const;
+    double snap(double scale) const;
+
+    AdaptiveScaleConfig config_;
+    StreamingQuantile sizes_;
+    double scale_;
+    double lastQuantile_ = 0.0;
+    int framesSinceEvaluation_ = 0;
+    uint64_t changes_ = 0;
+};
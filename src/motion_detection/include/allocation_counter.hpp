@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "stage_timings.hpp"
+
+// Scope attribution of counted allocations is compiled in only with
+// -DENABLE_ALLOCATION_COUNTING=ON (CMake, the default for Debug builds), which defines
+// BIRDS_ALLOCATION_COUNTING=1 and links allocation_counter.cpp into the tests and benchmarks
+#ifndef BIRDS_ALLOCATION_COUNTING
+#define BIRDS_ALLOCATION_COUNTING 0
+#endif
+
+// Process-wide heap activity as of one snapshot
+struct AllocationCounts {
+    uint64_t allocations = 0;  // operator new calls (every form) plus counted cv::Mat buffers
+    uint64_t frees = 0;        // The matching deletes and Mat buffer releases
+    uint64_t bytes = 0;        // Requested by those allocations
+
+    // Allocations not freed yet; growing without bound while the frame rate is steady is a leak
+    int64_t live() const { return static_cast<int64_t>(allocations) - static_cast<int64_t>(frees); }
+
+    AllocationCounts operator-(const AllocationCounts& earlier) const {
+        return AllocationCounts{allocations - earlier.allocations, frees - earlier.frees, bytes - earlier.bytes};
+    }
+};
+
+// Allocations by the stage of the innermost STAGE_TIMER scope on the allocating thread;
+// the last entry (PipelineStage::COUNT) holds those made outside every scope
+using StageAllocations = std::array<AllocationCounts, StageTimings::kStageCount + 1>;
+
+/**
+ * @brief Counting allocator hook for allocation budgets, soak tests and zero-allocation tests
+ *
+ * allocation_counter.cpp replaces the global operator new and delete (all forms) with
+ * malloc-backed versions that bump relaxed atomic counters, so it must only be linked into
+ * programs that want the counting (birds_of_play_soak always; the tests and benchmarks in
+ * ENABLE_ALLOCATION_COUNTING builds), never into the library or the application.
+ * cv::Mat data goes through cv::fastMalloc rather than operator new; countMatAllocations()
+ * wraps OpenCV's default cv::MatAllocator so those buffers are counted too (their
+ * UMatData header already is, as an operator new).
+ *
+ * With BIRDS_ALLOCATION_COUNTING the STAGE_TIMER scopes also mark their thread's current
+ * stage, and each allocation is charged to it as well (exclusively: an allocation inside
+ * CLAHE counts for CLAHE, not for the enclosing PREPROCESS). Frees are charged to the stage
+ * that frees, so per-stage live() is not meaningful; compare allocations.
+ *
+ * The counts cover every thread of the process, allocations made before main() included.
+ * Thread safety: thread-safe.
+ */
+class AllocationCounter {
+   public:
+    static constexpr bool kStageAttribution = BIRDS_ALLOCATION_COUNTING != 0;
+
+    static AllocationCounts snapshot();
+    static StageAllocations stages();
+
+    // Route new cv::Mat buffers through a counting wrapper of the current default allocator (idempotent)
+    static void countMatAllocations();
+
+    // "stage: N allocations (B bytes)" for every stage that allocated between the two snapshots
+    static std::string describe(const StageAllocations& before, const StageAllocations& after);
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <opencv2/video/background_segm.hpp>
+
+/**
+ * @brief Integer-math background models, far cheaper than MOG2 or KNN
+ *
+ * - RUNNING_AVERAGE: exponential moving average in 8.8 fixed point; each update moves
+ *   the background by 1/2^k of the difference, with 2^k the nearest power of two to the
+ *   history (or to 1/learningRate when one is passed to apply())
+ * - MEDIAN: approximate median (McFarlane & Schofield): every max(1, history / 256)-th
+ *   update steps the background one gray level towards the frame, so it converges on the
+ *   per-pixel median without storing samples (crossing the gray range takes about history
+ *   updates)
+ *
+ * A pixel is foreground (255) when any channel differs from the background by more than
+ * the foreground threshold. Works on CV_8U frames with any channel count. apply() with a
+ * learning rate of 1 (or the first frame) resets the background to the frame, 0 only
+ * classifies; getBackgroundImage() returns the background as a CV_8U image.
+ */
+class ApproximateBackgroundSubtractor : public cv::BackgroundSubtractor {
+   public:
+    enum class Method { RUNNING_AVERAGE, MEDIAN };
+
+    ApproximateBackgroundSubtractor(Method method, int history, int foregroundThreshold);
+
+    void apply(cv::InputArray image, cv::OutputArray fgmask, double learningRate = -1) override;
+    void getBackgroundImage(cv::OutputArray backgroundImage) const override;
+
+    Method method() const { return method_; }
+
+   private:
+    void reset(const cv::Mat& frame);
+
+    const Method method_;
+    const int defaultShift_;        // log2 of the history (running average)
+    const int medianStepInterval_;  // Updates per one-level step (median)
+    const int foregroundThreshold_;
+    cv::Mat background_;            // CV_16U 8.8 fixed point (running average) or CV_8U (median)
+    int channels_ = 0;
+    uint64_t updates_ = 0;
+};
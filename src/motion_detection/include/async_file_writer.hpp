@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * @brief How AsyncFileWriter gets files to disk
+ *
+ * - IoUring: one submission per batch of open/write/fsync/close operations (Linux 5.6+)
+ * - Threads: a few threads doing the same system calls one by one
+ * - Auto:    IoUring where the kernel allows it (containers may not), Threads otherwise
+ */
+enum class FileWriterBackend { Auto, IoUring, Threads };
+
+/**
+ * @brief Parse a writer backend name ("auto", "io_uring", "threads")
+ * @throws std::invalid_argument for unknown names
+ */
+inline FileWriterBackend parseFileWriterBackend(std::string name) {
+    std::transform(name.begin(), name.end(), name.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (name == "auto") return FileWriterBackend::Auto;
+    if (name == "io_uring") return FileWriterBackend::IoUring;
+    if (name == "threads") return FileWriterBackend::Threads;
+    throw std::invalid_argument("Unknown file writer backend: " + name);
+}
+
+inline const char* fileWriterBackendName(FileWriterBackend backend) {
+    switch (backend) {
+        case FileWriterBackend::Auto:
+            return "auto";
+        case FileWriterBackend::IoUring:
+            return "io_uring";
+        case FileWriterBackend::Threads:
+            return "threads";
+    }
+    return "unknown";
+}
+
+struct FileWriterConfig {
+    FileWriterBackend backend = FileWriterBackend::Auto;
+    unsigned queueDepth = 64;        // io_uring submission queue entries
+    size_t threads = 2;              // Threads backend: files written at once
+    size_t registeredBuffers = 8;    // io_uring: staging buffers registered with the ring (0 = none)
+    size_t bufferBytes = 1u << 20;   // Size of each; larger files are written from their own memory
+    unsigned fsyncEvery = 0;         // fdatasync every Nth file before closing it (0 = leave it to writeback)
+};
+
+struct FileWriterStats {
+    FileWriterBackend backend = FileWriterBackend::Threads;  // The one in use
+    uint64_t filesSubmitted = 0;
+    uint64_t filesWritten = 0;
+    uint64_t filesFailed = 0;
+    uint64_t bytesWritten = 0;
+    uint64_t syncs = 0;
+    size_t inFlight = 0;               // Files submitted and not completed yet
+    size_t inFlightHighWatermark = 0;
+    // io_uring only
+    uint64_t submitCalls = 0;          // io_uring_enter() calls
+    uint64_t sqesSubmitted = 0;        // Operations: about four per file
+    uint64_t cqesReaped = 0;
+    size_t sqHighWatermark = 0;        // Most operations handed over in one call
+    size_t sqWaiting = 0;              // Operations waiting for a free submission queue entry
+    uint64_t cqOverflows = 0;          // Completions the kernel could not post (CQ ring full)
+    uint64_t fixedBufferWrites = 0;    // Writes from a registered buffer
+};
+
+/**
+ * @brief Writes whole files off the calling thread, batching the system calls
+ *
+ * write() hands over a file's bytes and returns at once; the done callback runs when the
+ * file is on its way to disk (written and closed, and fdatasync'ed every fsyncEvery files)
+ * or failed. A partly written file is left behind on failure: callers delete their files.
+ *
+ * With io_uring a single thread owns the ring. It takes everything queued since its last
+ * turn, prepares the open, write, fsync and close operations of all of them and hands them
+ * to the kernel in one io_uring_enter(), which also collects the completions of earlier
+ * ones; a stalling SD card holds the ring thread instead of the persistence worker, which
+ * only waits for a whole record. Files up to bufferBytes are copied into a buffer that is
+ * registered with the ring (IORING_OP_WRITE_FIXED), so the kernel does not pin and map the
+ * pages of every write, and the caller's buffer goes back to the pool acquireBuffer() hands
+ * out as soon as it is copied. The Threads backend does the same calls on a few threads.
+ *
+ * Thread safety: every method may be called from any thread; callbacks run on the writer's
+ * threads and must not block.
+ */
+class AsyncFileWriter {
+   public:
+    using Buffer = std::vector<unsigned char>;
+    using Completion = std::function<void(bool written)>;
+
+    explicit AsyncFileWriter(const FileWriterConfig& config = FileWriterConfig());
+    // Finishes every queued write
+    ~AsyncFileWriter();
+
+    AsyncFileWriter(const AsyncFileWriter&) = delete;
+    AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+    // A buffer to encode into, with the capacity of an earlier file when one is free
+    Buffer acquireBuffer();
+
+    // Create or truncate @p path with @p bytes; @p done may be empty
+    void write(std::string path, Buffer bytes, Completion done);
+
+    // Block until every write queued so far has completed
+    void flush();
+
+    FileWriterBackend backend() const { return backend_; }
+    FileWriterStats getStats() const;
+
+    struct Request;
+    class Engine;
+
+   private:
+    void complete(std::unique_ptr<Request> request, bool written);
+    void recycle(Buffer buffer);
+
+    const FileWriterConfig config_;
+    FileWriterBackend backend_ = FileWriterBackend::Threads;
+    std::unique_ptr<Engine> engine_;
+
+    std::mutex bufferMutex_;
+    std::vector<Buffer> freeBuffers_;  // Guarded by bufferMutex_
+
+    mutable std::mutex flushMutex_;
+    std::condition_variable flushed_;
+    size_t inFlight_ = 0;  // Guarded by flushMutex_
+    size_t inFlightHighWatermark_ = 0;
+
+    std::atomic<uint64_t> filesSubmitted_{0};
+    std::atomic<uint64_t> filesWritten_{0};
+    std::atomic<uint64_t> filesFailed_{0};
+    std::atomic<uint64_t> bytesWritten_{0};
+    std::atomic<uint64_t> syncs_{0};
+};
+
+/**
+ * @brief Writes waited for together, e.g. the images of one frame record
+ *
+ * Thread safety: write() may be called from several threads; wait() from one.
+ */
+class FileWriteBatch {
+   public:
+    explicit FileWriteBatch(AsyncFileWriter& writer);
+    ~FileWriteBatch() { wait(); }
+
+    FileWriteBatch(const FileWriteBatch&) = delete;
+    FileWriteBatch& operator=(const FileWriteBatch&) = delete;
+
+    // Like AsyncFileWriter::write(); @p written is set before wait() returns
+    void write(std::string path, AsyncFileWriter::Buffer bytes, bool* written);
+
+    // Block until every write of this batch has completed
+    void wait();
+
+   private:
+    struct State {
+        std::mutex mutex;
+        std::condition_variable done;
+        size_t pending = 0;
+    };
+
+    AsyncFileWriter& writer_;
+    std::shared_ptr<State> state_;
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+// One benchmark of a Google Benchmark JSON file
+struct BenchmarkSamples {
+    std::vector<double> times;              // Real time per iteration of each repetition, nanoseconds
+    std::map<std::string, double> counters;  // User counters, averaged over the repetitions
+};
+
+/**
+ * @brief Benchmarks of a --benchmark_out JSON file, by run name
+ *
+ * Every repetition is a sample; files written with --benchmark_report_aggregates_only only
+ * have the mean left, one sample per benchmark, which is reported but never significant.
+ * Parsed with yaml-cpp (JSON is YAML).
+ * @throws std::runtime_error if the file cannot be read or has no "benchmarks" list
+ */
+std::map<std::string, BenchmarkSamples> loadBenchmarkJson(const std::string& path);
+
+/**
+ * @brief Two-sided p-value of the Mann-Whitney U test that @p a and @p b come from one distribution
+ *
+ * Exact (the distribution of U by counting) for samples without ties and up to 400 pairs,
+ * the usual repetition counts; otherwise the normal approximation with tie and continuity
+ * correction. 1 when either sample is empty.
+ */
+double mannWhitneyPValue(const std::vector<double>& a, const std::vector<double>& b);
+
+struct BenchComparisonOptions {
+    double alpha = 0.05;       // Significance level of the U test
+    double minChange = 0.05;   // Smaller median changes are never flagged, however significant
+    double confidence = 0.95;  // Of the bootstrap interval
+    int resamples = 2000;      // Bootstrap resamples (fixed seed, so reports are reproducible)
+    double qualityTolerance = 0.005;  // Accuracy counter changes that are flagged
+};
+
+// Accuracy counter of a benchmark (DetectionEvaluator scores and the like) in both runs
+struct QualityDelta {
+    std::string name;
+    double baseline = 0.0;
+    double current = 0.0;
+    bool higherIsBetter = true;
+    bool worse = false;  // Moved the wrong way by more than qualityTolerance
+};
+
+struct BenchmarkDelta {
+    enum class Verdict { Unchanged, Improvement, Regression, Insufficient };
+
+    std::string name;
+    size_t baselineSamples = 0;
+    size_t currentSamples = 0;
+    double baselineMedian = 0.0;  // Nanoseconds
+    double currentMedian = 0.0;
+    double change = 0.0;          // currentMedian / baselineMedian - 1
+    double changeLow = 0.0;       // Bootstrap confidence interval of change
+    double changeHigh = 0.0;
+    double pValue = 1.0;
+    Verdict verdict = Verdict::Insufficient;
+    std::vector<QualityDelta> quality;
+};
+
+struct BenchComparison {
+    std::vector<BenchmarkDelta> deltas;     // Benchmarks in both runs, by name
+    std::vector<std::string> onlyBaseline;  // Dropped since the baseline
+    std::vector<std::string> onlyCurrent;   // New since the baseline
+
+    size_t regressions() const;
+    size_t qualityRegressions() const;  // Accuracy counters that got worse
+};
+
+/**
+ * @brief Compare two runs benchmark by benchmark
+ *
+ * A benchmark regressed (or improved) when the U test rejects equal distributions at
+ * alpha, the bootstrap interval of the median change excludes 0 and the median moved by
+ * more than minChange; with fewer than 3 samples on either side it is Insufficient. The
+ * accuracy counters (box_recall, box_precision, box_iou, region_recall, region_precision,
+ * recall, false_boxes/frame, psnr_vs_reference) are set side by side, so a speed-up
+ * bought with missed birds shows in the same report.
+ */
+BenchComparison compareBenchmarks(const std::map<std::string, BenchmarkSamples>& baseline,
+                                  const std::map<std::string, BenchmarkSamples>& current,
+                                  const BenchComparisonOptions& options = BenchComparisonOptions());
+
+// Text report: one line per benchmark with its accuracy counters underneath, then a summary
+void printBenchComparison(std::ostream& out, const BenchComparison& comparison);
+
+const char* verdictName(BenchmarkDelta::Verdict verdict);
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <vector>
+
+/**
+ * @brief Per-block motion energy of a gray frame against a running-average background
+ *
+ * apply() makes one pass over the frame. For every square block it writes the mean
+ * absolute difference between the frame and the background (the block's SAD divided by
+ * its pixel count). In the same pass it moves the background 1/2^shift of the way
+ * towards the frame.
+ *
+ * The SAD uses OpenCV's universal intrinsics (v_reduce_sad: psadbw on x86, vabd plus
+ * pairwise adds on NEON), with a scalar tail for rows that do not fill a vector. The
+ * background is kept in 8.8 fixed point, like the RUNNING_AVERAGE model of
+ * ApproximateBackgroundSubtractor, so slow lighting changes are not lost to rounding.
+ *
+ * The map has ceil(cols / blockSize) x ceil(rows / blockSize) cells. Blocks on the right
+ * and bottom edges may be partial; their mean is taken over the pixels they hold. The
+ * whole background learns, blocks with motion included; a history of a few dozen frames
+ * keeps a bird that stays put from being absorbed within a second.
+ *
+ * Not thread-safe; the buffers keep their size between frames.
+ */
+class BlockMotionMap {
+   public:
+    /**
+     * @param blockSize Block side in pixels (16 matches a video macroblock)
+     * @param history Frames the background averages over, rounded to a power of two
+     */
+    BlockMotionMap(int blockSize, int history);
+
+    int blockSize() const { return blockSize_; }
+    int shift() const { return shift_; }
+
+    /**
+     * @brief Measure @p gray (CV_8UC1) against the background, then let the background learn
+     * @return false when the background was (re)started from this frame (first frame or new
+     *         size); the map is all zero then
+     */
+    bool apply(const cv::Mat& gray);
+
+    // CV_8UC1 mean absolute difference per block from the last apply()
+    const cv::Mat& map() const { return map_; }
+
+    // Map cells of a frame of @p frameSize
+    cv::Size gridSize(const cv::Size& frameSize) const;
+
+    // The background as a CV_8UC1 image
+    void backgroundImage(cv::Mat& image) const;
+
+    // Start over from the next frame
+    void reset() { background_.release(); }
+
+   private:
+    int blockSize_;
+    int shift_;
+    cv::Mat background_;          // CV_16UC1, 8.8 fixed point
+    cv::Mat map_;                 // CV_8UC1 grid
+    std::vector<uint32_t> sums_;  // SAD of the block row being accumulated, per block column
+};
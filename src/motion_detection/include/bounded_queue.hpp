@@ -0,0 +1,181 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+#include "profiler_zones.hpp"
+
+/**
+ * @brief What a full BoundedQueue does with an incoming item
+ */
+enum class BackpressurePolicy {
+    Block,       // Producer waits until a consumer makes room
+    DropOldest,  // The oldest queued item is discarded to make room
+    DropNewest   // The incoming item is discarded
+};
+
+/**
+ * @brief Parse a backpressure policy name from config ("block", "drop_oldest", "drop_newest")
+ * @throws std::invalid_argument for unknown names
+ */
+inline BackpressurePolicy parseBackpressurePolicy(std::string name) {
+    std::transform(name.begin(), name.end(), name.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (name == "block") return BackpressurePolicy::Block;
+    if (name == "drop_oldest") return BackpressurePolicy::DropOldest;
+    if (name == "drop_newest") return BackpressurePolicy::DropNewest;
+    throw std::invalid_argument("Unknown backpressure policy: " + name);
+}
+
+inline const char* backpressurePolicyName(BackpressurePolicy policy) {
+    switch (policy) {
+        case BackpressurePolicy::Block:
+            return "block";
+        case BackpressurePolicy::DropOldest:
+            return "drop_oldest";
+        case BackpressurePolicy::DropNewest:
+            return "drop_newest";
+    }
+    return "unknown";
+}
+
+/**
+ * @brief Fixed-capacity multi-producer/multi-consumer queue with a backpressure policy
+ *
+ * Thread safety: all methods may be called concurrently. close() wakes every blocked
+ * producer and consumer; after close() pushes are rejected and pops drain what is left.
+ */
+template <typename T>
+class BoundedQueue {
+   public:
+    explicit BoundedQueue(size_t capacity, BackpressurePolicy policy = BackpressurePolicy::Block)
+        : capacity_(std::max<size_t>(1, capacity)), policy_(policy) {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    /**
+     * @brief Enqueue an item, applying the backpressure policy when full
+     * @return false if the item was rejected (queue closed or DropNewest on a full queue)
+     */
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (closed_) return false;
+
+        if (items_.size() >= capacity_) {
+            switch (policy_) {
+                case BackpressurePolicy::Block: {
+                    PROFILE_ZONE("wait:queue_full");
+                    notFull_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+                    if (closed_) return false;
+                    break;
+                }
+                case BackpressurePolicy::DropOldest:
+                    items_.pop_front();
+                    dropped_++;
+                    break;
+                case BackpressurePolicy::DropNewest:
+                    dropped_++;
+                    return false;
+            }
+        }
+
+        items_.push_back(std::move(item));
+        depth_.store(items_.size(), std::memory_order_relaxed);
+        if (items_.size() > highWatermark_.load(std::memory_order_relaxed)) {
+            highWatermark_.store(items_.size(), std::memory_order_relaxed);
+        }
+        lock.unlock();
+        notEmpty_.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Dequeue the next item, blocking until one is available
+     * @return std::nullopt once the queue is closed and drained
+     */
+    std::optional<T> pop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (items_.empty() && !closed_) {
+            PROFILE_ZONE("wait:queue_empty");
+            notEmpty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+        }
+        return takeFront(lock);
+    }
+
+    /**
+     * @brief Dequeue the next item, waiting at most @p timeout
+     * @return std::nullopt on timeout or once the queue is closed and drained
+     */
+    template <typename Rep, typename Period>
+    std::optional<T> popFor(const std::chrono::duration<Rep, Period>& timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (items_.empty() && !closed_) {
+            PROFILE_ZONE("wait:queue_empty");
+            notEmpty_.wait_for(lock, timeout, [this] { return closed_ || !items_.empty(); });
+        }
+        return takeFront(lock);
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        notEmpty_.notify_all();
+        notFull_.notify_all();
+    }
+
+    bool isClosed() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return closed_;
+    }
+
+    // True once the queue is closed and every remaining item has been consumed
+    bool isDrained() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return closed_ && items_.empty();
+    }
+
+    // Lock-free snapshot, so monitoring (stats logs, metrics scrapes) never contends with
+    // producers and consumers
+    size_t size() const { return depth_.load(std::memory_order_relaxed); }
+
+    size_t capacity() const { return capacity_; }
+    BackpressurePolicy policy() const { return policy_; }
+    uint64_t droppedCount() const { return dropped_.load(); }
+    // Deepest the queue has been; a link that keeps reaching capacity is the bottleneck
+    size_t highWatermark() const { return highWatermark_.load(std::memory_order_relaxed); }
+
+   private:
+    std::optional<T> takeFront(std::unique_lock<std::mutex>& lock) {
+        if (items_.empty()) return std::nullopt;
+        std::optional<T> item(std::move(items_.front()));
+        items_.pop_front();
+        depth_.store(items_.size(), std::memory_order_relaxed);
+        lock.unlock();
+        notFull_.notify_one();
+        return item;
+    }
+
+    const size_t capacity_;
+    const BackpressurePolicy policy_;
+    mutable std::mutex mutex_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+    std::deque<T> items_;
+    bool closed_ = false;
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<size_t> depth_{0};  // items_.size(), published under mutex_
+    std::atomic<size_t> highWatermark_{0};
+};
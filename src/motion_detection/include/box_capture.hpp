@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * @brief On-disk layout of a box capture (.bobx)
+ *
+ * A FileHeader followed by one FrameRecord per frame, each directly followed by its
+ * boxCount BoxRecords. All values are little-endian. The header's frame and box counts
+ * are written when the capture is closed; a capture that was never closed has zero there
+ * and is read up to its last complete frame. Bump kVersion whenever this changes.
+ */
+namespace box_capture_layout {
+
+constexpr uint32_t kMagic = 0x58424F42;  // "BOBX"
+constexpr uint32_t kVersion = 1;
+
+struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    int32_t frameWidth;  // Frame the boxes were detected in
+    int32_t frameHeight;
+    uint64_t frameCount;  // 0 until the writer closes the file
+    uint64_t boxCount;
+    int64_t createdUs;  // Unix microseconds
+    uint64_t reserved;
+};
+
+struct FrameRecord {
+    int64_t frameIndex;
+    int64_t timestampUs;  // Unix microseconds
+    uint32_t boxCount;
+    uint32_t reserved;
+};
+
+struct BoxRecord {
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+};
+
+static_assert(sizeof(FileHeader) == 48, "FileHeader layout changed");
+static_assert(sizeof(FrameRecord) == 24, "FrameRecord layout changed");
+static_assert(sizeof(BoxRecord) == 16, "BoxRecord layout changed");
+
+}  // namespace box_capture_layout
+
+/**
+ * @brief Records the motion boxes of every frame to a box capture file
+ *
+ * Captures taken from busy feeders feed MotionRegionConsolidator and ObjectTracker in
+ * regression tests and benchmarks without decoding or detecting anything (see BoxCapture).
+ * Records are collected in a buffer and written in large chunks, so append() is cheap
+ * enough for the render stage.
+ *
+ * Not thread-safe: one thread appends.
+ */
+class BoxCaptureWriter {
+   public:
+    /**
+     * @param frameSize Frame the boxes are detected in (stored for the consolidator)
+     * @throws std::runtime_error if the file cannot be created
+     */
+    BoxCaptureWriter(const std::string& path, const cv::Size& frameSize);
+    // Closes the capture
+    ~BoxCaptureWriter();
+
+    BoxCaptureWriter(const BoxCaptureWriter&) = delete;
+    BoxCaptureWriter& operator=(const BoxCaptureWriter&) = delete;
+
+    // false once the capture is closed or failed to write (logged once)
+    bool append(int64_t frameIndex, int64_t timestampUs, const std::vector<cv::Rect>& boxes);
+
+    // Writes what is buffered and the final counts into the header; false on an I/O error
+    bool close();
+
+    bool isOpen() const { return fd_ >= 0; }
+    const std::string& path() const { return path_; }
+    uint64_t frames() const { return frames_; }
+    uint64_t boxes() const { return boxes_; }
+
+   private:
+    bool writeBuffer();
+    void fail(const char* what);
+
+    static constexpr size_t kBufferBytes = 64 * 1024;
+
+    std::string path_;
+    int fd_ = -1;
+    box_capture_layout::FileHeader header_{};
+    std::vector<unsigned char> buffer_;
+    uint64_t fileSize_ = 0;
+    uint64_t frames_ = 0;
+    uint64_t boxes_ = 0;
+};
+
+/**
+ * @brief One frame of a box capture; boxes point into the mapped file
+ */
+struct BoxCaptureFrame {
+    int64_t frameIndex = 0;
+    int64_t timestampUs = 0;
+    const box_capture_layout::BoxRecord* boxes = nullptr;
+    size_t boxCount = 0;
+
+    // Replaces @p out with this frame's boxes (reuses its capacity)
+    void copyTo(std::vector<cv::Rect>& out) const;
+};
+
+/**
+ * @brief A box capture mapped read-only into memory
+ *
+ * Opening scans the frame records once to index them; frame() is then a lookup and the
+ * boxes are read in place, so a benchmark loop over a capture touches nothing but the
+ * page cache.
+ */
+class BoxCapture {
+   public:
+    /**
+     * @throws std::runtime_error if the file cannot be mapped or is not a version
+     *         kVersion box capture
+     */
+    static BoxCapture open(const std::string& path);
+
+    BoxCapture(BoxCapture&& other) noexcept;
+    BoxCapture& operator=(BoxCapture&& other) noexcept;
+    BoxCapture(const BoxCapture&) = delete;
+    BoxCapture& operator=(const BoxCapture&) = delete;
+    ~BoxCapture();
+
+    size_t size() const { return frameOffsets_.size(); }
+    bool empty() const { return frameOffsets_.empty(); }
+    cv::Size frameSize() const { return frameSize_; }
+    uint64_t totalBoxes() const { return totalBoxes_; }
+    // false if the writer never closed the file (a tail may be missing)
+    bool isComplete() const { return complete_; }
+
+    BoxCaptureFrame frame(size_t index) const;
+
+   private:
+    BoxCapture() = default;
+    void unmap();
+
+    const unsigned char* mapping_ = nullptr;
+    size_t mappingBytes_ = 0;
+    std::vector<size_t> frameOffsets_;  // Of each FrameRecord
+    cv::Size frameSize_;
+    uint64_t totalBoxes_ = 0;
+    bool complete_ = false;
+};
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Weights of the consolidator's overlap-aware box distance
+ *
+ * distance = overlapWeight * overlap + edgeWeight * edge, where overlap is
+ * maxEdgeDistance * (1 - intersection / smaller area) (maxEdgeDistance when disjoint) and
+ * edge is the smallest gap along a separating axis (0 when the boxes touch or overlap),
+ * capped at maxEdgeDistance.
+ */
+struct BoxDistanceParams {
+    double overlapWeight = 0.7;
+    double edgeWeight = 0.3;
+    double maxEdgeDistance = 100.0;
+};
+
+/**
+ * @brief Structure-of-arrays copy of a set of boxes for batched distance evaluation
+ *
+ * Coordinates are stored as doubles so the SIMD lanes operate on the same values the scalar
+ * cv::Rect code sees (every int32 pixel coordinate and area is exact in a double).
+ */
+struct BoxArrays {
+    std::vector<double> left;
+    std::vector<double> top;
+    std::vector<double> right;
+    std::vector<double> bottom;
+    std::vector<double> area;
+
+    BoxArrays() = default;
+    explicit BoxArrays(const std::vector<cv::Rect>& boxes) { assign(boxes); }
+
+    void assign(const std::vector<cv::Rect>& boxes) {
+        const size_t n = boxes.size();
+        for (auto* column : {&left, &top, &right, &bottom, &area}) column->resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            const cv::Rect& box = boxes[i];
+            left[i] = box.x;
+            top[i] = box.y;
+            right[i] = box.x + box.width;
+            bottom[i] = box.y + box.height;
+            area[i] = static_cast<double>(box.width) * box.height;
+        }
+    }
+
+    size_t size() const { return left.size(); }
+};
+
+// Edge component of boxDistance(): the smaller positive gap along a separating axis (0 when
+// the boxes touch or overlap), capped at maxEdgeDistance
+inline double boxEdgeGap(const BoxArrays& boxes, size_t i, size_t j, double maxEdge) {
+    const double gapX = std::max(boxes.left[j] - boxes.right[i], boxes.left[i] - boxes.right[j]);
+    const double gapY = std::max(boxes.top[j] - boxes.bottom[i], boxes.top[i] - boxes.bottom[j]);
+    if (gapX <= 0 && gapY <= 0) return 0.0;
+    constexpr double kNone = std::numeric_limits<double>::max();
+    return std::min({gapX > 0 ? gapX : kNone, gapY > 0 ? gapY : kNone, maxEdge});
+}
+
+/**
+ * @brief Distance between boxes @p i and @p j (scalar reference for boxDistanceBatch)
+ */
+inline double boxDistance(const BoxArrays& boxes, size_t i, size_t j,
+                          const BoxDistanceParams& params) {
+    const double maxEdge = params.maxEdgeDistance;
+
+    // Overlap component
+    const double interWidth =
+        std::min(boxes.right[i], boxes.right[j]) - std::max(boxes.left[i], boxes.left[j]);
+    const double interHeight =
+        std::min(boxes.bottom[i], boxes.bottom[j]) - std::max(boxes.top[i], boxes.top[j]);
+    double overlap = maxEdge;
+    if (interWidth > 0 && interHeight > 0) {
+        overlap = maxEdge * (1.0 - (interWidth * interHeight) /
+                                       std::min(boxes.area[i], boxes.area[j]));
+    }
+
+    return params.overlapWeight * overlap + params.edgeWeight * boxEdgeGap(boxes, i, j, maxEdge);
+}
+
+/**
+ * @brief Distances from box @p i to boxes [@p begin, @p end), written to @p out[0 ..)
+ *
+ * Branch-free over OpenCV's 128-bit universal intrinsics (SSE2/NEON/VSX, whichever the
+ * OpenCV build targets) with a scalar tail. Performs the same operations as boxDistance(),
+ * so results match it to the last bit unless the compiler contracts the final multiply-add.
+ */
+void boxDistanceBatch(const BoxArrays& boxes, size_t i, size_t begin, size_t end,
+                      const BoxDistanceParams& params, double* out);
+
+/**
+ * @brief Box distances DBSCAN can cluster with (ConsolidationConfig::distanceMetric)
+ *
+ * - OverlapEdge: boxDistance(), the weighted overlap and edge terms (the default)
+ * - EdgeGap: the edge term alone, boxEdgeGap(); no overlap ratio, no division
+ * - CenterChebyshev: the larger per-axis distance between the box centers (L-infinity)
+ * - Iou: maxEdgeDistance * (1 - intersection over union); disjoint boxes are
+ *   maxEdgeDistance apart, so eps keeps the pixel scale of the other metrics
+ */
+enum class DistanceMetric { OverlapEdge, EdgeGap, CenterChebyshev, Iou };
+
+/**
+ * @brief Parse a metric name ("overlap_edge", "edge_gap", "center_linf", "iou")
+ * @throws std::invalid_argument for unknown names
+ */
+DistanceMetric parseDistanceMetric(std::string name);
+const char* distanceMetricName(DistanceMetric metric);
+
+// Batched forms of the other metrics, same lanes and scalar tail as boxDistanceBatch()
+void edgeGapDistanceBatch(const BoxArrays& boxes, size_t i, size_t begin, size_t end,
+                          const BoxDistanceParams& params, double* out);
+void centerChebyshevDistanceBatch(const BoxArrays& boxes, size_t i, size_t begin, size_t end,
+                                  const BoxDistanceParams& params, double* out);
+void iouDistanceBatch(const BoxArrays& boxes, size_t i, size_t begin, size_t end,
+                      const BoxDistanceParams& params, double* out);
+
+/**
+ * @brief Distance policies, one per DistanceMetric, for code templated on the metric
+ *
+ * MotionRegionConsolidator instantiates its neighbor-table build once per policy and
+ * picks the instance from the configured metric once per frame, so the per-pair loops
+ * hold no metric branch and no indirect call. Each policy has
+ * - distance(): the scalar reference for one pair
+ * - batch(): distances from box i to boxes [begin, end), matching distance() to the last
+ *   bit unless the compiler contracts a multiply-add
+ * - neighborReach(): a BoxGridIndex query margin that returns every box within @p eps of
+ *   a box, or a negative value when eps admits pairs at any separation (scan every pair)
+ */
+struct OverlapEdgeDistance {
+    static constexpr DistanceMetric kMetric = DistanceMetric::OverlapEdge;
+    static double distance(const BoxArrays& boxes, size_t i, size_t j, const BoxDistanceParams& params) {
+        return boxDistance(boxes, i, j, params);
+    }
+    static void batch(const BoxArrays& boxes, size_t i, size_t begin, size_t end, const BoxDistanceParams& params,
+                      double* out) {
+        boxDistanceBatch(boxes, i, begin, end, params, out);
+    }
+    // Pairs farther than maxEdgeDistance on both axes all share the capped distance
+    static double neighborReach(const BoxDistanceParams& params, double eps) {
+        return (params.overlapWeight + params.edgeWeight) * params.maxEdgeDistance > eps ? params.maxEdgeDistance
+                                                                                          : -1.0;
+    }
+};
+
+struct EdgeGapDistance {
+    static constexpr DistanceMetric kMetric = DistanceMetric::EdgeGap;
+    static double distance(const BoxArrays& boxes, size_t i, size_t j, const BoxDistanceParams& params) {
+        return boxEdgeGap(boxes, i, j, params.maxEdgeDistance);
+    }
+    static void batch(const BoxArrays& boxes, size_t i, size_t begin, size_t end, const BoxDistanceParams& params,
+                      double* out) {
+        edgeGapDistanceBatch(boxes, i, begin, end, params, out);
+    }
+    // A neighbor has a gap of at most eps on one axis, unless the cap puts every pair within eps
+    static double neighborReach(const BoxDistanceParams& params, double eps) {
+        return params.maxEdgeDistance > eps ? eps : -1.0;
+    }
+};
+
+struct CenterChebyshevDistance {
+    static constexpr DistanceMetric kMetric = DistanceMetric::CenterChebyshev;
+    static double distance(const BoxArrays& boxes, size_t i, size_t j, const BoxDistanceParams&) {
+        // Doubled centers are exact sums of the edges
+        const double dx = std::abs((boxes.left[i] + boxes.right[i]) - (boxes.left[j] + boxes.right[j]));
+        const double dy = std::abs((boxes.top[i] + boxes.bottom[i]) - (boxes.top[j] + boxes.bottom[j]));
+        return 0.5 * std::max(dx, dy);
+    }
+    static void batch(const BoxArrays& boxes, size_t i, size_t begin, size_t end, const BoxDistanceParams& params,
+                      double* out) {
+        centerChebyshevDistanceBatch(boxes, i, begin, end, params, out);
+    }
+    // A gap is never larger than the center distance along its axis
+    static double neighborReach(const BoxDistanceParams&, double eps) { return eps; }
+};
+
+struct IouDistance {
+    static constexpr DistanceMetric kMetric = DistanceMetric::Iou;
+    static double distance(const BoxArrays& boxes, size_t i, size_t j, const BoxDistanceParams& params) {
+        const double interWidth =
+            std::min(boxes.right[i], boxes.right[j]) - std::max(boxes.left[i], boxes.left[j]);
+        const double interHeight =
+            std::min(boxes.bottom[i], boxes.bottom[j]) - std::max(boxes.top[i], boxes.top[j]);
+        if (interWidth <= 0 || interHeight <= 0) return params.maxEdgeDistance;
+        const double intersection = interWidth * interHeight;
+        return params.maxEdgeDistance * (1.0 - intersection / (boxes.area[i] + boxes.area[j] - intersection));
+    }
+    static void batch(const BoxArrays& boxes, size_t i, size_t begin, size_t end, const BoxDistanceParams& params,
+                      double* out) {
+        iouDistanceBatch(boxes, i, begin, end, params, out);
+    }
+    // Below maxEdgeDistance only overlapping boxes are neighbors
+    static double neighborReach(const BoxDistanceParams& params, double eps) {
+        return params.maxEdgeDistance > eps ? 0.0 : -1.0;
+    }
+};
+
+/**
+ * @brief Integer-only form of "boxDistance(a, b) <= eps" for FPU-light targets
+ *
+ * The weights and eps are folded into thresholds once, so a pair costs only integer
+ * min/max, compares and one 64-bit cross-multiplication:
+ * - Overlapping boxes: overlap * overlapWeight <= eps becomes
+ *   intersection * kOverlapScale >= smallerArea * minOverlap, with the ratio threshold
+ *   rounded up to 1 / kOverlapScale (2^-20), the only difference from the double test.
+ * - Other boxes: the overlap term is the constant maxEdgeDistance, and the gaps are
+ *   integers, so the test is exactly gap <= maxGap.
+ */
+struct IntegerNeighborTest {
+    static constexpr int64_t kOverlapScale = int64_t{1} << 20;
+
+    int64_t minOverlap = 0;  // Scaled intersection / smaller-area ratio neighbors need
+    bool disjointNeighbors = false;  // Whether non-overlapping boxes can be neighbors at all
+    int maxGap = -1;         // Largest edge gap that still is within eps (disjointNeighbors)
+
+    IntegerNeighborTest() = default;
+    IntegerNeighborTest(const BoxDistanceParams& params, double eps) {
+        const double overlapTerm = params.overlapWeight * params.maxEdgeDistance;
+        // Overlapping: overlapTerm * (1 - ratio) <= eps  <=>  ratio >= 1 - eps / overlapTerm
+        const double ratio = overlapTerm > 0.0 ? 1.0 - eps / overlapTerm : 0.0;
+        minOverlap = std::max<int64_t>(0, static_cast<int64_t>(std::ceil(ratio * kOverlapScale)));
+
+        // Disjoint: overlapTerm + edgeWeight * min(gap, maxEdgeDistance) <= eps, evaluated
+        // with the same double expression as boxDistance() so integer gaps decide exactly
+        auto within = [&](int gap) {
+            return overlapTerm + params.edgeWeight * std::min<double>(gap, params.maxEdgeDistance) <= eps;
+        };
+        disjointNeighbors = within(0);
+        if (!disjointNeighbors) return;
+        if (within(static_cast<int>(std::min<double>(params.maxEdgeDistance, 1 << 30)) + 1)) {
+            maxGap = std::numeric_limits<int>::max();  // The cap keeps every gap within eps
+            return;
+        }
+        maxGap = static_cast<int>(std::min((eps - overlapTerm) / params.edgeWeight, params.maxEdgeDistance));
+        while (within(maxGap + 1)) ++maxGap;
+        while (maxGap > 0 && !within(maxGap)) --maxGap;
+    }
+
+    bool operator()(const cv::Rect& a, const cv::Rect& b) const {
+        const int interWidth = std::min(a.x + a.width, b.x + b.width) - std::max(a.x, b.x);
+        const int interHeight = std::min(a.y + a.height, b.y + b.height) - std::max(a.y, b.y);
+        if (interWidth > 0 && interHeight > 0) {
+            const int64_t smaller = std::min(int64_t{a.width} * a.height, int64_t{b.width} * b.height);
+            return int64_t{interWidth} * interHeight * kOverlapScale >= smaller * minOverlap;
+        }
+        // Negated intersection extents are the gaps; the edge term takes the smaller of the
+        // positive ones (0 when the boxes only touch)
+        const int gapX = -interWidth;
+        const int gapY = -interHeight;
+        const int gap = gapX > 0 ? (gapY > 0 ? std::min(gapX, gapY) : gapX) : std::max(gapY, 0);
+        return disjointNeighbors && gap <= maxGap;
+    }
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <opencv2/core.hpp>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Uniform-grid spatial index over bounding boxes for edge-distance neighbourhoods
+ *
+ * The consolidator's edge distance between two boxes is the smaller of their per-axis gaps
+ * (0 when they overlap), so a box can be "close" to one that is far away along the other
+ * axis. The neighbourhood of a box is therefore a cross: every box whose x-extent lies
+ * within the margin of its x-extent, plus every box whose y-extent does. The index keeps
+ * one uniform bucket grid per axis (columns and rows), registers each box in every bucket
+ * its extent spans, and answers a query by visiting only the buckets covering the two
+ * strips of the cross.
+ *
+ * query() returns indices in ascending order without duplicates, so callers that depended
+ * on a linear scan's ordering see identical results.
+ */
+class BoxGridIndex {
+   public:
+    /**
+     * @param boxes Boxes to index; the vector must outlive the index
+     * @param cellSize Bucket width in pixels (clamped to at least 1)
+     */
+    BoxGridIndex(const std::vector<cv::Rect>& boxes, double cellSize)
+        : boxes_(boxes), cellSize_(std::max(1.0, cellSize)) {
+        for (size_t i = 0; i < boxes_.size(); ++i) {
+            const int idx = static_cast<int>(i);
+            const cv::Rect& box = boxes_[i];
+            forEachBucket(box.x, box.x + box.width, 0.0,
+                          [&](long long bucket) { columns_[bucket].push_back(idx); });
+            forEachBucket(box.y, box.y + box.height, 0.0,
+                          [&](long long bucket) { rows_[bucket].push_back(idx); });
+        }
+    }
+
+    /**
+     * @brief Boxes whose x- or y-gap to @p box is at most @p margin (excluding @p excludeIdx)
+     *
+     * Every box whose edge distance to @p box is <= margin is returned; boxes outside the
+     * result are guaranteed to be farther than @p margin on both axes.
+     */
+    std::vector<int> query(const cv::Rect& box, double margin, int excludeIdx = -1) const {
+        std::vector<int> candidates;
+        auto collect = [&candidates](const BucketMap& buckets, long long bucket) {
+            auto it = buckets.find(bucket);
+            if (it != buckets.end()) {
+                candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+            }
+        };
+        forEachBucket(box.x, box.x + box.width, margin,
+                      [&](long long bucket) { collect(columns_, bucket); });
+        forEachBucket(box.y, box.y + box.height, margin,
+                      [&](long long bucket) { collect(rows_, bucket); });
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+        // Exact gap test drops boxes that merely share a bucket
+        std::vector<int> result;
+        result.reserve(candidates.size());
+        for (int idx : candidates) {
+            if (idx == excludeIdx) continue;
+            const cv::Rect& other = boxes_[idx];
+            if (gap(box.x, box.x + box.width, other.x, other.x + other.width) <= margin ||
+                gap(box.y, box.y + box.height, other.y, other.y + other.height) <= margin) {
+                result.push_back(idx);
+            }
+        }
+        return result;
+    }
+
+   private:
+    using BucketMap = std::unordered_map<long long, std::vector<int>>;
+
+    // Gap between two 1-D intervals (0 when they overlap or touch)
+    static double gap(int begin1, int end1, int begin2, int end2) {
+        return std::max({0, begin2 - end1, begin1 - end2});
+    }
+
+    template <typename Visitor>
+    void forEachBucket(int begin, int end, double margin, Visitor&& visit) const {
+        const auto first = static_cast<long long>(std::floor((begin - margin) / cellSize_));
+        const auto last = static_cast<long long>(std::floor((end + margin) / cellSize_));
+        for (long long bucket = first; bucket <= last; ++bucket) visit(bucket);
+    }
+
+    const std::vector<cv::Rect>& boxes_;
+    const double cellSize_;
+    BucketMap columns_;
+    BucketMap rows_;
+};
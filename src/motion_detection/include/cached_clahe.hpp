@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <vector>
+
+/**
+ * @brief CLAHE whose tile lookup tables are fitted occasionally and applied every frame
+ *
+ * cv::CLAHE does two things each frame. It builds a clipped, equalising lookup table from
+ * each tile's histogram, then maps every pixel through the four nearest tables with
+ * bilinear weights. The tables barely change between frames of a fixed camera. This class
+ * fits them from an INTER_AREA reduced copy of the frame, and only every updateInterval
+ * frames or when the scene's mean brightness has drifted. The per-frame work is the
+ * interpolation: four table lookups and three lerps per pixel, with the column tile
+ * indices and weights precomputed per frame size.
+ *
+ * The tables and the interpolation follow cv::CLAHE (clip limit relative to the tile
+ * area, redistribution of the clipped counts, BORDER_REFLECT_101 padding when the tiles
+ * do not divide the image). At scale 1, fitting and applying the same frame reproduces
+ * its output.
+ *
+ * Not thread-safe.
+ */
+class CachedClahe {
+   public:
+    /**
+     * @param clipLimit Contrast limit, as cv::createCLAHE
+     * @param tiles Tiles per row and column, as cv::createCLAHE's tile grid
+     * @param scale Resolution the tables are fitted at (0.1-1)
+     * @param updateInterval Frames between fits
+     * @param driftLimit Change of the mean gray level since the last fit that forces a new one
+     */
+    explicit CachedClahe(double clipLimit = 2.0, int tiles = 8, double scale = 0.5, int updateInterval = 30,
+                         double driftLimit = 8.0);
+
+    /**
+     * @brief Equalise a CV_8UC1 frame, refitting the tables first when they are due
+     * @param output Reallocated only on size change; may alias @p input
+     * @return true if the tables were refitted for this frame
+     */
+    bool apply(const cv::Mat& input, cv::Mat& output);
+
+    // Fit the tables to @p input (CV_8UC1) now
+    void fit(const cv::Mat& input);
+    // Map @p input through the current tables (fitted for its size)
+    void interpolate(const cv::Mat& input, cv::Mat& output);
+
+    bool fitted() const { return !luts_.empty(); }
+    uint64_t fitCount() const { return fitCount_; }
+
+   private:
+    // Mean gray level over every 8th row: a cheap brightness probe for the drift check
+    static double sampledMean(const cv::Mat& input);
+    // cv::CLAHE's tile size for an image (the padded image over the tiles)
+    cv::Size tileSize(const cv::Size& imageSize) const;
+
+    double clipLimit_;
+    int tiles_;
+    double scale_;
+    int updateInterval_;
+    double driftLimit_;
+
+    cv::Size fittedSize_;           // Full-resolution size the tables are for
+    std::vector<uchar> luts_;       // tiles^2 tables of 256 entries, row-major by tile
+    double fittedMean_ = 0.0;
+    int framesSinceFit_ = 0;
+    uint64_t fitCount_ = 0;
+
+    cv::Mat reduced_;               // The frame at the fitting scale, padded to whole tiles
+    cv::Size interpolationSize_;    // Size the column tables below are for
+    std::vector<int> leftTile_;     // Per column: offset of the left and right tile's table
+    std::vector<int> rightTile_;
+    std::vector<float> rightWeight_;
+};
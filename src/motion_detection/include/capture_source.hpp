@@ -0,0 +1,228 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <string>
+#include <vector>
+
+#include "frame_buffer_pool.hpp"
+#include "memory_placement.hpp"
+#include "motion_vector_map.hpp"
+
+class DecodeAheadReader;
+class MotionVectorDecoder;
+
+/**
+ * @brief Video capture backend
+ *
+ * - Auto: OpenCV's default backend for the source (the original behavior)
+ * - V4L2: local cameras through the kernel's mmap'd streaming buffers
+ * - GStreamer: RTSP / files through a generated (or configured) pipeline, with the decode
+ *   on nvv4l2decoder (Jetson / NVIDIA) or VAAPI when hardware decode is requested
+ * - FFmpeg: RTSP / files with FFmpeg's hwaccel decode
+ * - MotionVectors: RTSP / files decoded by libavcodec with the encoder's motion vectors
+ *   exported; frames whose vectors show no motion are dropped before colour conversion
+ *   (needs ENABLE_FFMPEG_MOTION_VECTORS, falls back to FFmpeg without it)
+ * - DecodeAhead: files decoded by libavcodec with frame and slice threads, on a thread
+ *   ahead of read() (needs ENABLE_FFMPEG_MOTION_VECTORS; live sources and builds without
+ *   libav fall back to FFmpeg)
+ */
+enum class CaptureBackend { Auto, V4L2, GStreamer, FFmpeg, MotionVectors, DecodeAhead };
+
+// Hardware decoder for the GStreamer and FFmpeg backends
+enum class HardwareDecode { None, Any, Nvidia, Vaapi };
+
+/**
+ * @brief Parse a backend name ("auto", "v4l2", "gstreamer", "ffmpeg", "motion_vectors",
+ *        "decode_ahead")
+ * @throws std::invalid_argument for unknown names
+ */
+CaptureBackend parseCaptureBackend(std::string name);
+const char* captureBackendName(CaptureBackend backend);
+
+/**
+ * @brief Parse a hardware decoder name ("none", "any", "nvidia", "vaapi")
+ * @throws std::invalid_argument for unknown names
+ */
+HardwareDecode parseHardwareDecode(std::string name);
+const char* hardwareDecodeName(HardwareDecode decode);
+
+struct CaptureConfig {
+    CaptureBackend backend = CaptureBackend::Auto;
+    std::string source;           // Video file, RTSP URL or device ("" = camera 0)
+    int width = 0;                // Requested camera resolution (0 = device default)
+    int height = 0;
+    double fps = 0.0;             // Requested camera frame rate (0 = device default)
+    HardwareDecode hardwareDecode = HardwareDecode::None;
+    std::string codec = "h264";   // RTSP stream codec: "h264" or "h265"
+    int rtspLatencyMs = 200;      // rtspsrc jitter buffer
+    std::string gstreamerPipeline;  // Full pipeline ending in appsink (overrides the generated one)
+    int deviceBuffers = 4;        // V4L2 mmap'd driver buffers
+    // Deliver CV_8UC1 luma instead of BGR (grayscale / ycrcb processing only needs Y)
+    bool lumaOnly = false;
+    size_t poolSize = 16;         // Recycled frame buffers
+    MemoryPlacement memory;       // Huge pages / NUMA node of the pooled buffers
+    // MotionVectors backend: which frames the encoder's vectors let through
+    double vectorMinMotion = 1.0;  // Pixels a macroblock must move to count as motion
+    int vectorMinBlocks = 2;       // Connected moving macroblocks that make a candidate region
+    bool vectorIntraAsMotion = true;  // Intra macroblocks of P/B frames count as motion
+    int vectorRefreshFrames = 30;  // Deliver at least every n-th frame (0 = only flagged frames)
+    // DecodeAhead backend
+    int decodeThreads = 0;         // libavcodec threads (0 = one per core)
+    size_t decodeLookahead = 8;    // Frames decoded ahead of read() (held out of the pool)
+};
+
+/**
+ * @brief Frame source over cv::VideoCapture with selectable, hardware-accelerated backends
+ *
+ * read() delivers each frame into a buffer from a FrameBufferPool, so steady-state capture
+ * does not allocate. With lumaOnly the frames are CV_8UC1: GStreamer negotiates GRAY8 from
+ * the decoder (the Y plane of its NV12 output, no BGR conversion at all), V4L2 reads the Y
+ * samples of the camera's raw YUYV buffer, and other backends convert their BGR output.
+ *
+ * The MotionVectors backend gates frames on their encoder motion vectors. read() skips
+ * every decoded frame whose vectors form no candidate region, and delivers only:
+ * - frames with candidate regions;
+ * - I frames and frames without exported vectors, where the vectors cannot tell;
+ * - every vectorRefreshFrames-th frame, so the background model keeps learning.
+ * A skipped frame is never converted to BGR or seen by the pixel-level detection.
+ * motionVectorRegions() holds the candidate regions of the delivered frame.
+ *
+ * The DecodeAhead backend decodes on a DecodeAheadReader thread into the pool, up to
+ * decodeLookahead frames ahead, so poolSize should cover the lookahead plus the frames in
+ * flight downstream. setDecodeStride() lets it decode only every k-th frame for the load
+ * shedder; lastSkippedFrames() says how many source frames it left out before each frame.
+ *
+ * Thread safety: none; open and read from one thread (the capture stage).
+ */
+class CaptureSource {
+   public:
+    explicit CaptureSource(CaptureConfig config);
+    ~CaptureSource();
+
+    CaptureSource(const CaptureSource&) = delete;
+    CaptureSource& operator=(const CaptureSource&) = delete;
+
+    /**
+     * @brief Open the configured source with the configured backend
+     * @return false (after logging why) if the source could not be opened
+     */
+    bool open();
+    bool isOpened() const;
+    void release();
+
+    /**
+     * @brief Read the next frame into a pooled buffer
+     * @return false at end of stream or on a read error
+     */
+    bool read(cv::Mat& frame);
+
+    /**
+     * @brief Backend timestamp of the frame the last read() returned, in milliseconds
+     *
+     * CAP_PROP_POS_MSEC at grab time: the stream PTS for files, RTSP, FFmpeg and GStreamer,
+     * the driver's buffer timestamp for V4L2 cameras. 0 where the backend reports none.
+     */
+    double lastTimestampMs() const { return lastTimestampMs_; }
+
+    struct StreamInfo {
+        cv::Size frameSize;
+        double fps = 0.0;           // 0 if neither the metadata nor the config knows it
+        bool fromMetadata = false;  // false: frameSize was measured on the first frame
+    };
+
+    /**
+     * @brief Resolution and frame rate of the opened stream, without seeking
+     *
+     * Taken from the backend's stream metadata; when the backend does not report a size
+     * (some RTSP and GStreamer sources before the first buffer) the first frame is read
+     * with peek() and measured instead. Either way no frame is lost.
+     */
+    StreamInfo probe();
+
+    /**
+     * @brief The next frame, without consuming it
+     *
+     * The frame is read once and held; the following read() returns it. An empty Mat
+     * means the stream ended (or failed) before its first frame.
+     */
+    const cv::Mat& peek();
+
+    // Camera or RTSP stream (frames keep coming at the source's pace) rather than a file
+    bool isLive() const;
+
+    // Source frame rate (0 if unknown)
+    double fps() const;
+    const CaptureConfig& config() const { return config_; }
+    const FrameBufferPool& bufferPool() const { return pool_; }
+
+    /**
+     * @brief Candidate regions of the last frame read, from its motion vectors
+     *
+     * Empty for other backends, and for frames delivered without vector evidence (I frames,
+     * frames without vectors, refresh frames).
+     */
+    const std::vector<cv::Rect>& motionVectorRegions() const { return vectorRegions_; }
+    // Decoded frames the MotionVectors backend skipped because their vectors showed no motion
+    // (safe to read from any thread)
+    uint64_t vectorSkippedFrames() const { return vectorSkippedFrames_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Ask the DecodeAhead backend for every @p stride-th source frame only
+     *
+     * The reader then skips non-reference frames in the decoder and drops the rest before
+     * conversion. Frames already decoded ahead still arrive; no-op for other backends.
+     */
+    void setDecodeStride(int stride);
+    // Source frames the backend left out (decode stride) just before the last frame read
+    uint64_t lastSkippedFrames() const { return lastSkippedFrames_; }
+
+    /**
+     * @brief GStreamer pipeline for a source, as open() builds it
+     *
+     * rtsp:// sources are depayloaded and decoded explicitly (nvv4l2decoder, vaapi or
+     * avdec) and end in an appsink that keeps only the newest frame; anything else goes
+     * through decodebin into an appsink that delivers every frame.
+     */
+    static std::string buildGStreamerPipeline(const CaptureConfig& config);
+
+   private:
+    bool openV4L2();
+    bool openGStreamer();
+    bool openFFmpeg();
+    bool openMotionVectors();
+    bool openDecodeAhead();
+    bool readFromVectors(cv::Mat& frame);
+
+    CaptureConfig config_;
+    cv::VideoCapture capture_;
+    FrameBufferPool pool_;
+    bool readFromBackend(cv::Mat& frame);
+
+    cv::Mat decodeBuffer_;         // Backend output awaiting conversion into a pooled frame
+    cv::Mat pendingFrame_;         // Read by peek(), returned by the next read()
+    double grabbedTimestampMs_ = 0.0;  // Of the last frame grabbed from the backend
+    double pendingTimestampMs_ = 0.0;
+    double lastTimestampMs_ = 0.0;
+    uint64_t grabbedSkippedFrames_ = 0;  // Source frames left out before the grabbed frame
+    uint64_t pendingSkippedFrames_ = 0;
+    uint64_t lastSkippedFrames_ = 0;
+    bool backendDeliversLuma_ = false;  // GStreamer GRAY8 caps
+    bool rawYuyv_ = false;         // V4L2 luma: raw YUYV buffers, Y extracted in read()
+    cv::Size yuyvSize_;            // Negotiated V4L2 resolution of the raw buffers
+    cv::Size frameSize_;           // Last frame read (pool buffers are sized from it)
+    int frameType_ = CV_8UC3;
+
+    std::unique_ptr<MotionVectorDecoder> vectorDecoder_;  // MotionVectors backend only
+    MotionVectorMap vectorMap_;
+    std::vector<cv::Rect> vectorRegions_;
+    std::vector<cv::Rect> pendingVectorRegions_;
+    std::atomic<uint64_t> vectorSkippedFrames_{0};
+    int framesSinceDelivered_ = 0;
+
+    std::unique_ptr<DecodeAheadReader> decodeAhead_;  // DecodeAhead backend only
+};
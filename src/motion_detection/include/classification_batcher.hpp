@@ -0,0 +1,90 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <thread>
+#include <vector>
+
+#include "region_classifier.hpp"
+
+struct ClassificationBatcherStats {
+    uint64_t requests = 0;  // submit() calls, with or without crops
+    uint64_t crops = 0;     // Crops classified
+    uint64_t batches = 0;   // Inference rounds (each one classifyCrops() call)
+    uint64_t discarded = 0; // Requests dropped by the destructor
+    size_t queuedCrops = 0;
+};
+
+/**
+ * @brief Gathers region crops from many streams into shared inference batches
+ *
+ * Every submit() queues one frame's crops with a callback. A single inference thread waits
+ * until maxBatch crops are queued or the oldest request is maxDelay old, takes whole
+ * requests (oldest first) up to maxBatch crops, classifies them in one
+ * RegionClassifier::classifyCrops() call and hands each request its slice of the results.
+ * Requests without crops only keep their place in line, so a stream's callbacks fire in
+ * the order it submitted them.
+ *
+ * Callbacks run on the inference thread and should be short. The crops must stay valid
+ * until their callback runs (views of a frame keep the frame alive).
+ *
+ * Thread safety: submit(), flush() and getStats() may be called from any thread.
+ */
+class ClassificationBatcher {
+   public:
+    using Callback = std::function<void(std::vector<RegionClassification>&)>;
+
+    // onThreadStart runs first on the inference thread (placement, see ThreadBudget)
+    ClassificationBatcher(std::unique_ptr<RegionClassifier> classifier, size_t maxBatch,
+                          std::chrono::microseconds maxDelay, std::function<void()> onThreadStart = nullptr);
+
+    // Finishes the running batch; queued requests are discarded without their callbacks
+    ~ClassificationBatcher();
+
+    ClassificationBatcher(const ClassificationBatcher&) = delete;
+    ClassificationBatcher& operator=(const ClassificationBatcher&) = delete;
+
+    void submit(std::vector<cv::Mat> crops, Callback callback);
+
+    // Classify everything queued now, without waiting for the deadline, and block until done
+    void flush();
+
+    ClassificationBatcherStats getStats() const;
+
+    // Padded crop of @p region in @p frame, as the classifier takes it
+    cv::Mat cropRegion(const cv::Mat& frame, const cv::Rect& region) const {
+        return classifier_->cropRegion(frame, region);
+    }
+
+   private:
+    struct Request {
+        std::vector<cv::Mat> crops;
+        Callback callback;
+        std::chrono::steady_clock::time_point arrival;
+    };
+
+    void run();
+
+    std::unique_ptr<RegionClassifier> classifier_;  // Inference thread only (cropRegion() reads the config)
+    const size_t maxBatch_;
+    const std::chrono::microseconds maxDelay_;
+    std::function<void()> onThreadStart_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::deque<Request> queue_;
+    size_t queuedCrops_ = 0;
+    size_t flushWaiters_ = 0;
+    bool busy_ = false;
+    bool stopping_ = false;
+    ClassificationBatcherStats stats_;
+    std::thread worker_;  // Last member: starts after everything above is constructed
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ClassificationCacheConfig {
+    int refreshIntervalFrames = 150;         // Re-check a confident label after this many frames (0 = never)
+    int uncertainRetryFrames = 5;            // Frames between attempts on a track without a confident label
+    double sizeChangeThreshold = 0.5;        // Relative box area change that invalidates the label
+    double appearanceChangeThreshold = 0.15; // Mean thumbnail difference (fraction of 255) that does
+};
+
+struct ClassificationCacheEntry {
+    std::string label = "unknown";
+    float confidence = 0.0f;
+    int classId = -1;
+    cv::Rect box;        // Track box when it was classified
+    cv::Mat appearance;  // Thumbnail of the box at that time
+    uint64_t frame = 0;  // Frame of the last classification attempt
+};
+
+struct ClassificationCacheStats {
+    uint64_t hits = 0;       // Track checks answered from the cache
+    uint64_t newTracks = 0;  // Tracks classified for the first time
+    uint64_t retries = 0;    // Attempts on tracks that had no confident label
+    uint64_t refreshes = 0;  // Confident labels re-checked (interval, size or appearance)
+};
+
+/**
+ * @brief Per-track classification results, so a bird is classified once rather than every frame
+ *
+ * A confident label is reused until the track's box changes area by more than
+ * sizeChangeThreshold, its appearance (an 8x8 thumbnail of the box) drifts by more than
+ * appearanceChangeThreshold, or refreshIntervalFrames frames have passed. Tracks without a
+ * confident label are retried every uncertainRetryFrames frames, so background clutter that
+ * never scores does not cost one inference per frame either. Inference cost therefore scales
+ * with the number of tracks, not with the frame rate.
+ *
+ * Call advanceFrame() once per frame before the checks of that frame and retain() with the
+ * live track IDs to forget tracks that ended.
+ *
+ * Thread safety: not thread-safe.
+ */
+class ClassificationCache {
+   public:
+    ClassificationCache(const ClassificationCacheConfig& config, float confidenceThreshold);
+
+    void advanceFrame() { ++frame_; }
+
+    /**
+     * @brief Whether track @p id at @p box in @p frame needs (re-)classification
+     *
+     * Counts the decision in the stats; call it once per track and frame.
+     */
+    bool needsClassification(int id, const cv::Mat& frame, const cv::Rect& box);
+
+    // Record a classification attempt of track @p id (a label of "unknown" when classId < 0)
+    void store(int id, const cv::Mat& frame, const cv::Rect& box, const std::string& label,
+               float confidence, int classId);
+
+    // Cached result of track @p id, or nullptr if it was never classified
+    const ClassificationCacheEntry* find(int id) const;
+
+    // Drop every track not in @p liveIds
+    void retain(const std::vector<int>& liveIds);
+
+    size_t size() const { return entries_.size(); }
+    const ClassificationCacheStats& getStats() const { return stats_; }
+
+    // Mean absolute difference of two thumbnails as a fraction of 255 (1 if either is missing)
+    static double appearanceDistance(const cv::Mat& a, const cv::Mat& b);
+
+    // 8x8 area-averaged thumbnail of @p box in @p frame (empty if the box misses the frame)
+    static cv::Mat thumbnail(const cv::Mat& frame, const cv::Rect& box);
+
+   private:
+    bool confident(const ClassificationCacheEntry& entry) const {
+        return entry.classId >= 0 && entry.confidence >= confidenceThreshold_;
+    }
+
+    ClassificationCacheConfig config_;
+    float confidenceThreshold_;
+    uint64_t frame_ = 0;
+    std::unordered_map<int, ClassificationCacheEntry> entries_;
+    ClassificationCacheStats stats_;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// One pairwise DBSCAN decision, as written to a dump (little-endian, 20 bytes)
+struct ClusteringTraceRecord {
+    uint32_t frame;     // Consolidator frame counter
+    int32_t idA;        // Object IDs of the pair
+    int32_t idB;
+    float distance;     // Overlap-aware distance; NaN where only the neighbor test ran (integer geometry)
+    uint8_t neighbor;   // 1 = within eps (and the center pre-filter), an edge of the neighbor table
+    uint8_t reserved[3];
+};
+static_assert(sizeof(ClusteringTraceRecord) == 20, "dump records are 20 bytes");
+
+/**
+ * @brief Ring of the newest pairwise clustering decisions, written to disk only on demand
+ *
+ * Logging every pair is O(n^2) formatted I/O per frame; the trace instead copies a
+ * 20-byte record into a buffer allocated once, and the buffer is written only when a dump
+ * is requested (an API call, SIGUSR1 in the application). When the ring is full the
+ * oldest decisions are overwritten.
+ *
+ * Dump format: the 8-byte magic "BOPCTRC1", a uint32 record size, a uint32 record count,
+ * then the records oldest first.
+ *
+ * Thread safety: requestDump() from any thread; everything else from the thread that owns
+ * the consolidator (parallel neighbor-table rows collect their decisions and add them
+ * after the rows are joined).
+ */
+class ClusteringTrace {
+   public:
+    explicit ClusteringTrace(size_t capacity = 0) { resize(capacity); }
+
+    bool isEnabled() const { return !records_.empty(); }
+    size_t capacity() const { return records_.size(); }
+    // Decisions recorded since the last clear, overwritten ones included
+    uint64_t recorded() const { return next_; }
+
+    // Reallocate for @p capacity records (0 = off); drops what was recorded
+    void resize(size_t capacity);
+    void clear() { next_ = 0; }
+
+    static ClusteringTraceRecord makeRecord(uint32_t frame, int idA, int idB, double distance, bool neighbor) {
+        return ClusteringTraceRecord{frame, idA, idB, static_cast<float>(distance),
+                                     neighbor ? uint8_t{1} : uint8_t{0}, {0, 0, 0}};
+    }
+
+    void add(const ClusteringTraceRecord& record) {
+        records_[next_ % records_.size()] = record;
+        ++next_;
+    }
+    void record(uint32_t frame, int idA, int idB, double distance, bool neighbor) {
+        add(makeRecord(frame, idA, idB, distance, neighbor));
+    }
+
+    // The retained decisions, oldest first
+    std::vector<ClusteringTraceRecord> records() const;
+
+    void write(std::ostream& out) const;
+    // Write the dump to @p path (directories are created); false after logging a failure
+    bool write(const std::string& path) const;
+
+    // Ask the owner to dump to @p path at its next opportunity
+    void requestDump(const std::string& path);
+    // The requested path, once per request; empty when none is pending
+    std::string takeDumpRequest();
+
+   private:
+    std::vector<ClusteringTraceRecord> records_;
+    uint64_t next_ = 0;
+
+    std::atomic<bool> dumpRequested_{false};
+    std::mutex dumpMutex_;
+    std::string dumpPath_;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "pipeline_config.hpp"
+
+struct ConfigWatchOptions {
+    bool watchFile = true;  // Reload when the file changes (otherwise only on requestReload())
+    // Wake-up period of the watcher thread: how often it checks for requests, and the stat()
+    // interval where inotify is unavailable
+    std::chrono::milliseconds pollInterval{500};
+    // Quiet time after the last change before the file is read, so an editor's
+    // truncate-then-write is not parsed half-written
+    std::chrono::milliseconds settleTime{200};
+};
+
+/**
+ * @brief Background thread that republishes a SharedPipelineConfig when its file changes
+ *
+ * Watches the config file's directory with inotify on Linux (editors often replace the file
+ * by renaming a temporary over it, which a watch on the file itself would miss) and falls
+ * back to polling its modification time and size elsewhere. requestReload() forces a reload,
+ * e.g. on SIGHUP. Parsing and validation happen on this thread; consumers pick up the new
+ * snapshot at their next frame boundary by comparing SharedPipelineConfig::version(), so the
+ * frame path never waits on the file system. Invalid files are rejected and counted.
+ *
+ * Thread safety: requestReload(), reloads() and rejected() may be called from any thread.
+ */
+class ConfigWatcher {
+   public:
+    explicit ConfigWatcher(SharedPipelineConfig& config, const ConfigWatchOptions& options = ConfigWatchOptions());
+    ~ConfigWatcher();
+
+    ConfigWatcher(const ConfigWatcher&) = delete;
+    ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+    // Reload on the watcher thread within one poll interval
+    void requestReload() { reloadRequested_.store(true, std::memory_order_release); }
+
+    uint64_t reloads() const { return reloads_.load(std::memory_order_relaxed); }
+    uint64_t rejected() const { return rejected_.load(std::memory_order_relaxed); }
+
+   private:
+    void run();
+    void reload();
+
+    SharedPipelineConfig& config_;
+    ConfigWatchOptions options_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> reloadRequested_{false};
+    std::atomic<uint64_t> reloads_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::thread thread_;
+};
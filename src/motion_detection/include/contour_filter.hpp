@@ -0,0 +1,109 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+/**
+ * @brief Area, aspect ratio and solidity filter for motion candidates, cheapest test first
+ *
+ * Every candidate is tested for area, then for the aspect ratio of its bounding rectangle,
+ * and last for solidity (area over convex hull area). The hull is the only test whose cost
+ * grows with the outline, so it only runs for candidates the two constant-time tests
+ * kept. A candidate that fails several filters is counted against the first in that order.
+ *
+ * check() takes a measured area and box plus a solidity callback, so connected components
+ * and traced contours share the order and the counters. evaluate() is the contour form:
+ * polygon approximation and hull go through scratch vectors owned by the filter, whose
+ * capacity survives from frame to frame.
+ *
+ * Not thread-safe.
+ */
+class ContourFilter {
+   public:
+    struct Settings {
+        bool approximation = false;   // Simplify outlines with approxPolyDP before measuring them
+        double epsilonFactor = 0.02;  // approxPolyDP tolerance, relative to the outline's length
+        bool solidity = true;         // Measure solidity (the convex hull)
+        bool shapeFilters = true;     // Reject on solidity and aspect ratio (area always filters)
+    };
+
+    struct Thresholds {
+        double minArea = 0.0;
+        double minSolidity = 0.0;
+        double maxAspectRatio = 0.0;
+    };
+
+    enum class Verdict { ACCEPTED, AREA, ASPECT_RATIO, SOLIDITY };
+
+    // Outcomes since begin()
+    struct Counts {
+        int candidates = 0;
+        int rejectedArea = 0;
+        int rejectedAspectRatio = 0;
+        int rejectedSolidity = 0;
+        int accepted = 0;
+        int solidityChecks = 0;  // Candidates whose solidity was measured
+    };
+
+    // Measurements of one evaluate() call; solidity is negative when it was not measured
+    struct Candidate {
+        double area = 0.0;
+        cv::Rect bounds;  // Empty when the area test rejected the contour
+        double solidity = -1.0;
+    };
+
+    ContourFilter() = default;
+    explicit ContourFilter(const Settings& settings);
+
+    // Start a frame: set its thresholds and zero the counts
+    void begin(const Thresholds& thresholds);
+
+    /**
+     * @brief Filter one candidate
+     * @param area Area in full-resolution pixels
+     * @param bounds Box used for the aspect ratio (width / height)
+     * @param solidity Called with no arguments only when solidity is measured; returns it
+     * @param measured Receives the solidity if it was measured, -1 otherwise
+     */
+    template <typename Solidity>
+    Verdict check(double area, const cv::Rect& bounds, Solidity&& solidity, double& measured) {
+        ++counts_.candidates;
+        measured = -1.0;
+        if (area < thresholds_.minArea) {
+            ++counts_.rejectedArea;
+            return Verdict::AREA;
+        }
+        if (settings_.shapeFilters &&
+            static_cast<double>(bounds.width) / bounds.height > thresholds_.maxAspectRatio) {
+            ++counts_.rejectedAspectRatio;
+            return Verdict::ASPECT_RATIO;
+        }
+        if (settings_.solidity) {
+            ++counts_.solidityChecks;
+            measured = solidity();
+            if (settings_.shapeFilters && measured < thresholds_.minSolidity) {
+                ++counts_.rejectedSolidity;
+                return Verdict::SOLIDITY;
+            }
+        }
+        ++counts_.accepted;
+        return Verdict::ACCEPTED;
+    }
+
+    /**
+     * @brief Filter a traced outline
+     * @param areaScale Detection pixel to full-resolution pixel area factor
+     */
+    Verdict evaluate(const std::vector<cv::Point>& contour, double areaScale, Candidate& candidate);
+
+    const Settings& settings() const { return settings_; }
+    const Thresholds& thresholds() const { return thresholds_; }
+    const Counts& counts() const { return counts_; }
+
+   private:
+    Settings settings_;
+    Thresholds thresholds_;
+    Counts counts_;
+    std::vector<cv::Point> approx_;  // Scratch: simplified outline
+    std::vector<cv::Point> hull_;    // Scratch: convex hull
+};
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <optional>
+#include <vector>
+
+#include "motion_region_consolidator.hpp"
+
+// Maps pixel coordinates of one camera onto another that watches the same feeder
+struct CameraPairCalibration {
+    size_t streamA = 0;
+    size_t streamB = 0;
+    cv::Matx33d homography = cv::Matx33d::eye();  // Stream A pixels to stream B pixels
+
+    /**
+     * @brief Pair calibration from two ground-plane (or feeder-plane) calibrations
+     * @param aToPlane, bToPlane Homographies from each camera's pixels to shared plane coordinates
+     */
+    static CameraPairCalibration fromPlane(size_t streamA, const cv::Matx33d& aToPlane, size_t streamB,
+                                           const cv::Matx33d& bToPlane);
+};
+
+struct CrossCameraConfig {
+    std::vector<CameraPairCalibration> pairs;  // Streams in no pair are passed through untouched
+    // Frames of two cameras captured this close together show the same moment
+    std::chrono::milliseconds maxTimeDelta{40};
+    // Longest a result waits for the overlapping cameras' frames before it goes out unlinked
+    std::chrono::milliseconds maxWait{250};
+    // Min IoU between a region projected into the other view and a region there
+    double minIou = 0.25;
+    // Side the region crops are scaled down to before their sharpness is measured
+    int sharpnessSide = 64;
+};
+
+// A region of one frame of one stream
+struct RegionViewRef {
+    size_t stream = 0;
+    uint64_t sequence = 0;  // StreamManager::StreamResult::sequence
+    size_t region = 0;      // Index into that result's regions
+};
+
+// How one region relates to the simultaneous regions of overlapping cameras
+struct CrossCameraLinks {
+    // Set on the other views of a bird: the region that is persisted and classified instead
+    std::optional<RegionViewRef> bestView;
+    // Set on the best view: the other views linked to it when it was chosen
+    std::vector<RegionViewRef> otherViews;
+    double viewScore = 0.0;  // Area times sharpness of the view
+
+    bool isDuplicate() const { return bestView.has_value(); }
+};
+
+struct CrossCameraStats {
+    uint64_t results = 0;          // Results that went through
+    uint64_t linkedRegions = 0;    // Regions linked to a region of another camera
+    uint64_t duplicates = 0;       // Of those, regions that were not the best view
+    uint64_t timedOut = 0;         // Results released by maxWait before every peer caught up
+};
+
+/**
+ * @brief Links the regions that overlapping cameras see of the same bird at the same time
+ *
+ * Each result is held until every camera it shares a calibration pair with has delivered a
+ * frame captured at least maxTimeDelta later (or maxWait passed), so all frames of the same
+ * moment are in. Regions of frames within maxTimeDelta of each other are linked when one,
+ * projected through the pair's homography, overlaps the other by minIou; links chain over
+ * three or more cameras. When the first frame of a linked group goes out, the view with the
+ * largest area times sharpness (standard deviation of the Laplacian of the region crop) is
+ * the best view and the others become its references. A view that links to a group after
+ * that is a reference of the view already chosen.
+ *
+ * Results of a stream are released in the order they were offered, and deliveries never run
+ * concurrently, so the release callback sees one stream's results in order.
+ *
+ * Thread safety: offer() and flush() from any thread; the release callback runs on the
+ * calling thread of one of them, never on two at once.
+ */
+class CrossCameraDeduplicator {
+   public:
+    using Clock = std::chrono::steady_clock;
+    // Hands over a result: @p links is parallel to @p regions
+    using Release = std::function<void(size_t stream, uint64_t sequence, cv::Mat& frame,
+                                       std::vector<ConsolidatedRegion>& regions,
+                                       std::vector<CrossCameraLinks>& links)>;
+
+    CrossCameraDeduplicator(CrossCameraConfig config, Release release);
+    ~CrossCameraDeduplicator();
+
+    CrossCameraDeduplicator(const CrossCameraDeduplicator&) = delete;
+    CrossCameraDeduplicator& operator=(const CrossCameraDeduplicator&) = delete;
+
+    // Whether @p stream is in a calibration pair (results of other streams need not be offered)
+    bool covers(size_t stream) const;
+
+    /**
+     * @brief Add a stream's result, captured at @p captured, and release what is complete
+     *
+     * Results of one stream must be offered in capture order.
+     */
+    void offer(size_t stream, uint64_t sequence, Clock::time_point captured, cv::Mat frame,
+               std::vector<ConsolidatedRegion> regions);
+
+    // Release every held result (end of stream, drain)
+    void flush();
+
+    CrossCameraStats getStats() const;
+
+    // Area times the standard deviation of the Laplacian of @p box in @p frame (gray or BGR)
+    static double viewScore(const cv::Mat& frame, const cv::Rect& box, int sharpnessSide);
+
+   private:
+    struct Group;
+    struct Entry;
+    struct Peer {
+        size_t stream;
+        cv::Matx33d homography;  // This stream's pixels to the peer's
+    };
+
+    void link(Entry& entry);
+    // Pops the releasable entries (all with @p all) in per-stream order
+    void collect(bool all, Clock::time_point now, std::vector<std::unique_ptr<Entry>>& out);
+    // Every peer has offered a frame captured at least maxTimeDelta after @p entry
+    bool ready(const Entry& entry) const;
+    void decide(Entry& entry);
+    void deliver(std::unique_lock<std::mutex>& lock, std::vector<std::unique_ptr<Entry>>& released);
+
+    const CrossCameraConfig config_;
+    const Release release_;
+    std::vector<std::vector<Peer>> peers_;  // By stream
+
+    mutable std::mutex mutex_;
+    std::vector<std::deque<std::unique_ptr<Entry>>> pending_;  // By stream, in offer order
+    std::vector<std::optional<Clock::time_point>> latest_;     // Newest capture offered per stream
+    std::mutex deliverMutex_;  // Taken before mutex_ is released, so deliveries keep their order
+    CrossCameraStats stats_;
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "bounded_queue.hpp"
+
+struct DebugArtifactStats {
+    uint64_t written = 0;
+    uint64_t dropped = 0;  // Queue was full
+    uint64_t skipped = 0;  // Left out by sampling
+    uint64_t failed = 0;
+    size_t queued = 0;
+};
+
+/**
+ * @brief Writes debug images (contour overlays, stage grids, consolidation views) off the
+ * processing thread
+ *
+ * submit() only queues the image; a background thread creates the directory (once per
+ * directory) and encodes the file. The queue is bounded and drops incoming artifacts when
+ * full, and only every Nth submitted artifact is kept (setSampleEvery), so diagnostics
+ * never stall or distort the timings of the pipeline they describe.
+ *
+ * shared() is the process-wide writer used by MotionProcessor and MotionRegionConsolidator.
+ * Its thread starts with the first submit() and drains the queue when the process exits.
+ *
+ * Thread safety: every method may be called from any thread.
+ */
+class DebugArtifactWriter {
+   public:
+    static constexpr size_t kDefaultQueueCapacity = 32;
+
+    explicit DebugArtifactWriter(size_t queueCapacity = kDefaultQueueCapacity);
+    ~DebugArtifactWriter();
+
+    DebugArtifactWriter(const DebugArtifactWriter&) = delete;
+    DebugArtifactWriter& operator=(const DebugArtifactWriter&) = delete;
+
+    static DebugArtifactWriter& shared();
+
+    /**
+     * @brief Queue an image to be written to @p path
+     *
+     * The image is written as is, without a copy: pass one that is not modified afterwards
+     * (clone reused buffers).
+     *
+     * @return false if the artifact was sampled out, dropped on a full queue, or empty
+     */
+    bool submit(const std::string& path, cv::Mat image);
+
+    // Keep one of every @p everyN submitted artifacts (1 = all)
+    void setSampleEvery(int everyN);
+    int sampleEvery() const { return sampleEvery_.load(); }
+
+    // Block until every queued artifact has been written
+    void flush();
+
+    DebugArtifactStats getStats() const;
+
+   private:
+    struct Artifact {
+        std::string path;
+        cv::Mat image;
+    };
+
+    void run();
+    void ensureStarted();
+
+    BoundedQueue<Artifact> queue_;
+    std::thread worker_;
+    std::once_flag started_;
+    std::set<std::string> createdDirectories_;  // Worker thread only
+
+    std::atomic<int> sampleEvery_{1};
+    std::atomic<uint64_t> submitted_{0};
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> skipped_{0};
+    std::atomic<uint64_t> failed_{0};
+
+    std::mutex flushMutex_;
+    std::condition_variable flushed_;
+    size_t pending_ = 0;  // Accepted but not yet written, guarded by flushMutex_
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <opencv2/core.hpp>
+#include <string>
+
+#include "frame_buffer_pool.hpp"
+
+struct DecodeAheadConfig {
+    int threads = 0;             // libavcodec frame and slice threads (0 = libav picks, one per core)
+    size_t lookaheadFrames = 8;  // Decoded frames kept queued ahead of read()
+    bool lumaOnly = false;       // Deliver CV_8UC1 luma instead of BGR
+};
+
+/**
+ * @brief Video file reader that decodes ahead of its consumer on a thread of its own
+ *
+ * cv::VideoCapture decodes inside read(), so the capture stage waits for every decode. This
+ * reader opens the file with libavformat and decodes it with libavcodec's frame and slice
+ * threading. A decode thread converts each frame into a buffer of @p pool and queues up to
+ * lookaheadFrames of them, in the order the decoder outputs them (presentation order).
+ * read() only waits when decoding falls behind the consumer.
+ *
+ * setStride(k) lowers the decode rate for the load shedder. With k > 1 the decoder discards
+ * non-reference frames (AVDISCARD_NONREF: never decoded at all). Of the frames it still
+ * outputs, only those at least k source frames after the last queued one are converted;
+ * the rest are dropped. skippedBefore() tells how many source frames were left out ahead
+ * of the frame read, counted from the PTS and the frame rate, so the caller can count
+ * them as shed. A new stride applies to frames decoded after the call; frames already
+ * queued keep the old one.
+ *
+ * Needs libav (ENABLE_FFMPEG_MOTION_VECTORS); without it available() is false and open()
+ * fails. @p pool is only acquired from by the decode thread, and must outlive the reader.
+ *
+ * Thread safety: open(), read() and close() from one thread (the capture stage);
+ * setStride() and the counters from any.
+ */
+class DecodeAheadReader {
+   public:
+    explicit DecodeAheadReader(FrameBufferPool& pool);
+    ~DecodeAheadReader();
+
+    DecodeAheadReader(const DecodeAheadReader&) = delete;
+    DecodeAheadReader& operator=(const DecodeAheadReader&) = delete;
+
+    // Built with libav
+    static bool available();
+
+    /**
+     * @brief Open @p path and start decoding ahead
+     * @return false (after logging why) if the file has no decodable video stream
+     */
+    bool open(const std::string& path, const DecodeAheadConfig& config);
+    bool isOpened() const;
+    // Stop the decode thread and drop the queued frames
+    void close();
+
+    /**
+     * @brief The next frame, waiting for the decoder if none is queued yet
+     * @return false at the end of the file or after a decode error
+     */
+    bool read(cv::Mat& frame);
+    // Of the frame the last read() returned: PTS in milliseconds, and source frames
+    // dropped (by the stride) between it and the frame before
+    double timestampMs() const;
+    uint64_t skippedBefore() const;
+
+    // Decode for every @p stride-th source frame (1 = all)
+    void setStride(int stride);
+
+    cv::Size frameSize() const;
+    double fps() const;  // 0 if the container does not tell
+    uint64_t decodedFrames() const;  // Frames out of the decoder, converted or not
+    uint64_t skippedFrames() const;  // Source frames left out by the stride
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
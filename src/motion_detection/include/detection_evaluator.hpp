@@ -0,0 +1,107 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct ConsolidatedRegion;
+
+// Detections of some frames scored against their ground truth boxes
+struct DetectionScore {
+    uint64_t truePositives = 0;      // Ground truth boxes found
+    uint64_t falseNegatives = 0;     // Ground truth boxes missed
+    uint64_t matchedDetections = 0;  // Detections that found one (with cover(), a region may find several)
+    uint64_t falsePositives = 0;     // Detections that found none
+    double overlapSum = 0.0;         // Per found box: IoU of its match (match()) or share covered (cover())
+
+    double recall() const;       // 1 without ground truth boxes
+    double precision() const;    // 1 without detections
+    double meanOverlap() const;  // 0 without found boxes
+    void add(const DetectionScore& other);
+
+    // One-to-one, greedy by highest IoU; a pair below @p minIou never matches
+    static DetectionScore match(const std::vector<cv::Rect>& detections, const std::vector<cv::Rect>& truth,
+                                double minIou);
+    // A true box is found when one region covers at least @p minCoverage of its area, so a
+    // region holding a whole flock finds every bird in it
+    static DetectionScore cover(const std::vector<cv::Rect>& regions, const std::vector<cv::Rect>& truth,
+                                double minCoverage);
+};
+
+// The annotation of one frame
+struct AnnotatedFrame {
+    std::vector<cv::Rect> boxes;                   // One per bird
+    std::optional<std::vector<cv::Rect>> regions;  // Expected consolidated regions, when annotated
+};
+
+/**
+ * @brief Ground truth boxes of a frame sequence, by frame index
+ *
+ * The text format is the one birds_of_play_replay --detections writes, so a replay's
+ * output corrected by hand becomes ground truth: one JSON object per line,
+ *
+ *   {"frame": 12, "boxes": [[x, y, width, height], ...], "regions": [[x, y, width, height], ...]}
+ *
+ * with frame the position in the replayed sequence and boxes the birds in frame pixels.
+ * "regions" is optional; without it regions are scored by how they cover the boxes. Blank
+ * lines and lines starting with # are skipped; frames without a line are not scored (an
+ * annotated frame with no birds has "boxes": []). A box capture (.bobx) loads as boxes only.
+ *
+ * Thread safety: const members are safe to share; add() is not synchronized.
+ */
+class GroundTruth {
+   public:
+    // A .bobx box capture or the text format above; throws std::runtime_error naming the bad line
+    static GroundTruth load(const std::string& path);
+    static GroundTruth parse(std::istream& in, const std::string& source = "<stream>");
+
+    void add(int64_t frame, AnnotatedFrame annotation);
+    // The annotation of @p frame, nullptr if it has none
+    const AnnotatedFrame* find(int64_t frame) const;
+
+    size_t size() const { return frames_.size(); }
+    bool empty() const { return frames_.empty(); }
+    const std::map<int64_t, AnnotatedFrame>& frames() const { return frames_; }
+
+   private:
+    std::map<int64_t, AnnotatedFrame> frames_;
+};
+
+// Scores of a run, per level
+struct AccuracyReport {
+    DetectionScore boxes;    // Motion boxes (ProcessingResult::detectedBounds) against the true boxes
+    DetectionScore regions;  // Consolidated regions against the annotated regions, or covering the boxes
+    uint64_t frames = 0;     // Annotated frames scored
+};
+
+/**
+ * @brief Accumulates the accuracy of a detection run, frame by frame, against a GroundTruth
+ *
+ * Motion boxes are matched one-to-one at minIou; regions are matched the same way where
+ * the frame annotates regions and otherwise scored with DetectionScore::cover(). Frames
+ * the ground truth does not annotate are skipped.
+ *
+ * Thread safety: not thread-safe; the ground truth must outlive the evaluator.
+ */
+class DetectionEvaluator {
+   public:
+    explicit DetectionEvaluator(const GroundTruth& truth, double minIou = 0.5, double minCoverage = 0.5);
+
+    // false (nothing scored) when @p frame is not annotated
+    bool addFrame(int64_t frame, const std::vector<cv::Rect>& boxes, const std::vector<cv::Rect>& regions);
+    bool addFrame(int64_t frame, const std::vector<cv::Rect>& boxes, const std::vector<ConsolidatedRegion>& regions);
+
+    const AccuracyReport& report() const { return report_; }
+    void reset() { report_ = AccuracyReport(); }
+
+   private:
+    const GroundTruth& truth_;
+    double minIou_;
+    double minCoverage_;
+    AccuracyReport report_;
+    std::vector<cv::Rect> regionBoxes_;  // addFrame() scratch
+};
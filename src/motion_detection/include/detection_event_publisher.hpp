@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <opencv2/core.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.hpp"
+#include "motion_region_consolidator.hpp"
+
+// What one published event describes
+enum class EventGranularity { Frame, Track };
+
+struct EventPublisherConfig {
+    bool enabled = false;
+    std::string transport = "zmq";          // "zmq" (PUB socket) or "mqtt"
+    std::string endpoint = "tcp://*:5556";  // zmq: address to bind; mqtt: broker host[:port]
+    std::string topic = "birds_of_play/detections";
+    std::string stream = "camera";          // Stream name carried by every batch
+    EventGranularity granularity = EventGranularity::Frame;
+    bool motionOnly = true;                        // Skip frames without regions (Frame) or tracks (Track)
+    std::chrono::milliseconds batchWindow{100};    // How long a batch collects events after its first
+    size_t maxBatchEvents = 64;                    // Publish as soon as this many are collected
+    size_t queueCapacity = 256;                    // Events waiting for the worker; the oldest are shed
+    int mqttQos = 0;
+};
+
+// One region of a frame event
+struct PublishedRegion {
+    cv::Rect box;
+    std::vector<int> trackIds;
+    std::string label;  // RegionClassifier label; empty when not classified
+    float confidence = 0.0f;
+};
+
+// One tracked box of a track event
+struct PublishedTrack {
+    int trackId = -1;
+    cv::Rect box;
+    std::string label;  // Label of the region the track belongs to; empty if none or unclassified
+    float confidence = 0.0f;
+};
+
+// What the render stage hands over for one frame (copied, so the packet can move on)
+struct PublishedEvent {
+    uint64_t frameIndex = 0;
+    int64_t captureUnixMs = 0;
+    std::vector<PublishedRegion> regions;  // Frame granularity
+    std::vector<PublishedTrack> tracks;    // Track granularity
+};
+
+struct EventPublisherStats {
+    uint64_t submitted = 0;  // Events accepted by publish()
+    uint64_t dropped = 0;    // Shed because the worker fell behind
+    uint64_t published = 0;  // Events in batches the transport accepted
+    uint64_t failed = 0;     // Events in batches the transport refused
+    uint64_t batches = 0;
+    uint64_t bytes = 0;      // Payload bytes handed to the transport
+};
+
+/**
+ * @brief A batch as MessagePack, compact positional arrays instead of maps:
+ *
+ *   batch:        [1 (format version), stream, "frame" | "track", [event, ...]]
+ *   frame event:  [frame_index, capture_unix_ms, [[x, y, width, height, [track_id, ...], label, confidence], ...]]
+ *   track event:  [frame_index, capture_unix_ms, [[track_id, x, y, width, height, label, confidence], ...]]
+ *
+ * Integers use the smallest MessagePack encoding and confidence is a float32, so a region
+ * with one track and no label takes about 20 bytes. msgpack.unpackb() in Python (or
+ * @msgpack/msgpack in Node) decodes it without a schema.
+ */
+void encodeEventBatch(const std::string& stream, EventGranularity granularity,
+                      const std::vector<PublishedEvent>& events, std::vector<uint8_t>& out);
+
+/**
+ * @brief Publishes detections to other systems in real time, in batches, off the pipeline
+ *
+ * publish() turns a frame's regions (or its tracked boxes) into an event and queues it; it
+ * never waits: a full queue sheds its oldest event. A worker thread collects the events of
+ * up to batchWindow (at most maxBatchEvents), encodes them with encodeEventBatch() and hands
+ * the payload to the send function under the configured topic.
+ *
+ * The transports built by open() never block either: ZeroMQ publishes from a PUB socket
+ * (subscribers filter on the topic frame; a slow subscriber loses messages at the socket's
+ * high-water mark), MQTT through libmosquitto's network thread, skipping batches while the
+ * broker is disconnected. Each needs its library at build time (ENABLE_ZEROMQ, ENABLE_MQTT).
+ *
+ * Thread safety: publish() from one producer (the render stage); stats() from any thread.
+ */
+class DetectionEventPublisher {
+   public:
+    // Sends one payload under @p topic; false if the transport refused it
+    using SendFunction = std::function<bool(const std::string& topic, const std::vector<uint8_t>& payload)>;
+
+    DetectionEventPublisher(const EventPublisherConfig& config, SendFunction send);
+    ~DetectionEventPublisher();  // Publishes what is queued, then stops the worker
+
+    DetectionEventPublisher(const DetectionEventPublisher&) = delete;
+    DetectionEventPublisher& operator=(const DetectionEventPublisher&) = delete;
+
+    /**
+     * @brief A started publisher on the configured transport
+     * @return nullptr (logged) if the transport is unknown, not compiled in or cannot be opened
+     */
+    static std::unique_ptr<DetectionEventPublisher> open(const EventPublisherConfig& config);
+
+    /**
+     * @brief Queue one frame's detections
+     *
+     * @p objectIds holds the TrackedObjectStore ID of each box in @p boxes (Track granularity
+     * only; empty otherwise).
+     */
+    void publish(uint64_t frameIndex, int64_t captureUnixUs, const std::vector<cv::Rect>& boxes,
+                 const std::vector<int>& objectIds, const std::vector<ConsolidatedRegion>& regions);
+
+    // Whether publish() needs the per-box object IDs
+    bool wantsTrackIds() const { return config_.granularity == EventGranularity::Track; }
+
+    EventPublisherStats stats() const;
+    const EventPublisherConfig& config() const { return config_; }
+
+   private:
+    void run();
+    void flush(std::vector<PublishedEvent>& batch);
+
+    const EventPublisherConfig config_;
+    SendFunction send_;
+    BoundedQueue<PublishedEvent> queue_;
+    std::thread worker_;
+    std::vector<uint8_t> payload_;  // Worker only: reused encode buffer
+
+    std::atomic<uint64_t> submitted_{0};
+    std::atomic<uint64_t> published_{0};
+    std::atomic<uint64_t> failed_{0};
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> bytes_{0};
+};
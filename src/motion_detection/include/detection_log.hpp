@@ -0,0 +1,190 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+#include "motion_region_consolidator.hpp"
+
+struct DetectionLogConfig {
+    bool enabled = false;
+    std::string directory = "data/detections";
+    size_t rowGroupFrames = 4096;                    // Write a row group at this many frames
+    std::chrono::milliseconds flushInterval{10000};  // ... or once its oldest frame is this old
+    uint64_t fileBytes = 256ull << 20;               // Start a new log file beyond this size
+};
+
+/**
+ * @brief On-disk layout, read by src/image_detection/detection_log_reader.py
+ *
+ * A log file is a FileHeader followed by row groups. A row group is a RowGroupHeader and
+ * then its column buffers, back to back in the order below, each padded to 8 bytes so a
+ * reader can map every column in place (numpy.frombuffer, Arrow buffers). All values are
+ * little-endian.
+ *
+ *   per frame (frames):    frame_index int64, timestamp_us int64, stream uint16
+ *   list offsets:          box_offsets int32 [frames + 1], region_offsets int32 [frames + 1]
+ *   per box (boxes):       box_x, box_y, box_width, box_height int16, box_object_id int32
+ *   per region (regions):  region_x, region_y, region_width, region_height int16,
+ *                          member_offsets int32 [regions + 1]
+ *   per member (members):  member_box int32
+ *
+ * Offsets index the row group's own columns (Arrow list offsets): the boxes of frame i are
+ * [box_offsets[i], box_offsets[i + 1]), and member_box holds row-group box indices, so
+ * region r consists of boxes member_box[member_offsets[r] .. member_offsets[r + 1]).
+ * Coordinates are clamped to int16. A row group is written with a single write; a crash can
+ * only leave a truncated last one, which readers skip. Bump kVersion whenever this changes.
+ */
+namespace detection_log_layout {
+
+constexpr uint32_t kMagic = 0x4C444F42;          // "BODL"
+constexpr uint32_t kRowGroupMagic = 0x47524F42;  // "BORG"
+constexpr uint32_t kVersion = 1;
+constexpr size_t kColumnCount = 16;
+
+struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    int64_t createdUs;  // Unix microseconds
+    uint64_t reserved[2];
+};
+
+struct RowGroupHeader {
+    uint32_t magic;
+    uint32_t columnCount;
+    uint64_t frames;
+    uint64_t boxes;
+    uint64_t regions;
+    uint64_t members;
+    uint64_t bodyBytes;        // Column bytes after this header, padding included
+    int64_t firstTimestampUs;  // Range of the row group, to skip it when scanning by time
+    int64_t lastTimestampUs;
+};
+
+static_assert(sizeof(FileHeader) == 32, "FileHeader layout changed");
+static_assert(sizeof(RowGroupHeader) == 64, "RowGroupHeader layout changed");
+
+}  // namespace detection_log_layout
+
+/**
+ * @brief One row group's columns, as the writer buffers them and the reader returns them
+ */
+struct DetectionLogColumns {
+    std::vector<int64_t> frameIndex;
+    std::vector<int64_t> timestampUs;
+    std::vector<uint16_t> stream;
+    std::vector<int32_t> boxOffsets{0};
+    std::vector<int32_t> regionOffsets{0};
+    std::vector<int16_t> boxX, boxY, boxWidth, boxHeight;
+    std::vector<int32_t> boxObjectId;
+    std::vector<int16_t> regionX, regionY, regionWidth, regionHeight;
+    std::vector<int32_t> memberOffsets{0};
+    std::vector<int32_t> memberBox;
+
+    size_t frames() const { return frameIndex.size(); }
+    size_t boxes() const { return boxX.size(); }
+    size_t regions() const { return regionX.size(); }
+    void clear();
+};
+
+struct DetectionLogStats {
+    uint64_t framesLogged = 0;  // Frames appended
+    uint64_t framesWritten = 0;
+    uint64_t rowGroupsWritten = 0;
+    uint64_t bytesWritten = 0;
+    uint64_t writeFailures = 0;  // Row groups lost to I/O errors
+    size_t pendingFrames = 0;    // In the open row group
+};
+
+/**
+ * @brief Columnar log of every frame's motion boxes and consolidated regions
+ *
+ * The MongoDB documents only cover the frames that are saved (about one a second); this log
+ * keeps all of them in a compact form for analytics. append() copies a frame's boxes and
+ * regions into the open row group's columns in memory, which is cheap enough for the render
+ * stage. flush() turns the open row group into one contiguous write; it is meant for the
+ * persistence worker, which calls it whenever flushDue() says the group is full or old
+ * enough, so the frame loop never waits for the disk. Files are named
+ * detections_<yyyymmdd_hhmmss>_<n>.bodl and rolled past fileBytes.
+ *
+ * Region membership comes from the objects the consolidator saw: the @p objectIds passed
+ * to append() are the TrackedObjectStore IDs of the boxes (one per box, in box order), and
+ * every ID a region lists is resolved to the box carrying it.
+ *
+ * Thread safety: append(), flushDue(), flush() and getStats() may be called concurrently;
+ * appends only wait for the swap of the open row group, never for a write.
+ */
+class DetectionLog {
+   public:
+    explicit DetectionLog(const DetectionLogConfig& config);
+    // Writes the open row group
+    ~DetectionLog();
+
+    DetectionLog(const DetectionLog&) = delete;
+    DetectionLog& operator=(const DetectionLog&) = delete;
+
+    void append(int64_t frameIndex, int64_t timestampUs, uint16_t stream,
+                const std::vector<cv::Rect>& boxes, const std::vector<int>& objectIds,
+                const std::vector<ConsolidatedRegion>& regions);
+
+    // Whether the open row group is full or older than flushInterval
+    bool flushDue(
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) const;
+
+    // Writes the open row group, if it has frames; false on an I/O error
+    bool flush();
+
+    DetectionLogStats getStats() const;
+    // File the next row group goes to ("" before the first one)
+    std::string currentPath() const;
+    const DetectionLogConfig& config() const { return config_; }
+
+   private:
+    bool openFile();
+    void closeFile();
+
+    const DetectionLogConfig config_;
+
+    mutable std::mutex appendMutex_;  // Guards open_, openedAt_ and framesLogged_
+    DetectionLogColumns open_;
+    std::chrono::steady_clock::time_point openedAt_;  // First frame of the open row group
+    uint64_t framesLogged_ = 0;
+
+    mutable std::mutex writeMutex_;  // Guards everything below
+    DetectionLogColumns writing_;    // Swapped with open_ by flush()
+    std::vector<unsigned char> buffer_;
+    int fd_ = -1;
+    std::string path_;
+    uint64_t fileIndex_ = 0;
+    uint64_t fileSize_ = 0;
+    std::string runStamp_;  // yyyymmdd_hhmmss of the first file
+    uint64_t framesWritten_ = 0;
+    uint64_t rowGroupsWritten_ = 0;
+    uint64_t bytesWritten_ = 0;
+    uint64_t writeFailures_ = 0;
+};
+
+/**
+ * @brief Sequential reader of a detection log file (tests, C++ tools)
+ */
+class DetectionLogReader {
+   public:
+    explicit DetectionLogReader(const std::string& path);
+    ~DetectionLogReader();
+
+    DetectionLogReader(const DetectionLogReader&) = delete;
+    DetectionLogReader& operator=(const DetectionLogReader&) = delete;
+
+    bool isOpen() const { return fd_ >= 0; }
+
+    // Reads the next complete row group; false at the end (or at a truncated row group)
+    bool next(DetectionLogColumns& columns);
+
+   private:
+    int fd_ = -1;
+    uint64_t offset_ = 0;
+};
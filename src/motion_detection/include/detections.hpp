@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <opencv2/core.hpp>
+#include <vector>
+
+/**
+ * @brief One frame's motion regions with what extraction measured on them
+ *
+ * Structure of arrays: row i of every column is region i, in the order of
+ * ProcessingResult::detectedBounds (rects holds the same boxes). Extraction has the contour
+ * or component in hand when it accepts a region, so its area, solidity and centroid come
+ * from work it does anyway; the mean difference reads the frame difference under the
+ * region's mask inside its box, for accepted regions only. Tracking, consolidation and
+ * the classification order read them here instead of deriving sizes from the boxes.
+ */
+struct Detections {
+    std::vector<cv::Rect> rects;         // Frame pixels
+    std::vector<float> areas;            // Contour area or pixel count, in frame pixels
+    std::vector<float> solidities;       // Area over convex hull area; -1 where not measured
+    std::vector<cv::Point2f> centroids;  // Center of mass of the region, frame pixels
+    std::vector<float> meanDiffs;        // Mean frame difference (0-255) under the region; -1 where not measured
+
+    size_t size() const { return rects.size(); }
+    bool empty() const { return rects.empty(); }
+
+    void clear() {
+        rects.clear();
+        areas.clear();
+        solidities.clear();
+        centroids.clear();
+        meanDiffs.clear();
+    }
+
+    void add(const cv::Rect& rect, float area, float solidity, const cv::Point2f& centroid, float meanDiff) {
+        rects.push_back(rect);
+        areas.push_back(area);
+        solidities.push_back(solidity);
+        centroids.push_back(centroid);
+        meanDiffs.push_back(meanDiff);
+    }
+};
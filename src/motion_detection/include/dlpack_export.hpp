@@ -0,0 +1,153 @@
+#pragma once
+
+#include <pybind11/pybind11.h>
+
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <stdexcept>
+
+#include "numpy_conversion.hpp"
+
+namespace py = pybind11;
+
+/**
+ * @file dlpack_export.hpp
+ * @brief Zero-copy DLPack export of cv::Mat for torch.from_dlpack / numpy.from_dlpack
+ *
+ * Like numpy_conversion.hpp, only the pybind11 translation units include this header.
+ *
+ * Every image the pipeline hands to Python lives in host memory: the OpenCL backend
+ * (compute_backend: opencl) keeps its working set in cv::UMat, but frames, masks and crops
+ * are downloaded before they leave MotionProcessor, and consumers such as PyTorch cannot
+ * import OpenCL buffers anyway. Tensors are therefore exported with device kDLCPU; a
+ * consumer that wants them on a CUDA device still copies them once, with .to("cuda").
+ */
+
+namespace dlpack {
+
+// The stable DLPack ABI (dlpack.h, v0.x unversioned capsules), declared here rather than
+// vendored because the extension only produces tensors
+enum DeviceType : int32_t { kDLCPU = 1 };
+enum DataTypeCode : uint8_t { kDLUInt = 1 };
+
+struct Device {
+    int32_t device_type;
+    int32_t device_id;
+};
+
+struct DataType {
+    uint8_t code;
+    uint8_t bits;
+    uint16_t lanes;
+};
+
+struct Tensor {
+    void* data;
+    Device device;
+    int32_t ndim;
+    DataType dtype;
+    int64_t* shape;
+    int64_t* strides;  // In elements, not bytes
+    uint64_t byte_offset;
+};
+
+struct ManagedTensor {
+    Tensor dl_tensor;
+    void* manager_ctx;
+    void (*deleter)(ManagedTensor* self);
+};
+
+// Name of an unconsumed capsule; a consumer renames it ("used_dltensor") and takes over the
+// deleter
+constexpr const char* kCapsuleName = "dltensor";
+
+}  // namespace dlpack
+
+/**
+ * @brief Export a uint8 cv::Mat (H x W or H x W x C) as a DLPack capsule
+ *
+ * The managed tensor holds its own cv::Mat header, so the pixels stay alive (via the Mat
+ * refcount) until the consumer's tensor is freed, or until the capsule is dropped unused.
+ * Row padding is kept through the strides.
+ */
+inline py::capsule cv_mat_to_dlpack(const cv::Mat& mat) {
+    if (mat.depth() != CV_8U) throw std::runtime_error("Only 8-bit Mats can be exported");
+
+    struct Context {
+        dlpack::ManagedTensor managed;
+        cv::Mat mat;
+        int64_t shape[3];
+        int64_t strides[3];
+    };
+    auto* context = new Context{};
+    context->mat = mat;
+    context->shape[0] = mat.rows;
+    context->shape[1] = mat.cols;
+    context->shape[2] = mat.channels();
+    context->strides[0] = static_cast<int64_t>(mat.step[0]);
+    context->strides[1] = mat.channels();
+    context->strides[2] = 1;
+
+    dlpack::Tensor& tensor = context->managed.dl_tensor;
+    tensor.data = mat.empty() ? nullptr : context->mat.data;
+    tensor.device = {dlpack::kDLCPU, 0};
+    tensor.ndim = mat.channels() > 1 ? 3 : 2;
+    tensor.dtype = {dlpack::kDLUInt, 8, 1};
+    tensor.shape = context->shape;
+    tensor.strides = context->strides;
+    tensor.byte_offset = 0;
+    context->managed.manager_ctx = context;
+    context->managed.deleter = [](dlpack::ManagedTensor* self) { delete static_cast<Context*>(self->manager_ctx); };
+
+    // Frees the tensor only if no consumer took it
+    PyObject* capsule = PyCapsule_New(&context->managed, dlpack::kCapsuleName, [](PyObject* self) {
+        if (!PyCapsule_IsValid(self, dlpack::kCapsuleName)) return;
+        auto* managed = static_cast<dlpack::ManagedTensor*>(PyCapsule_GetPointer(self, dlpack::kCapsuleName));
+        managed->deleter(managed);
+    });
+    if (!capsule) {
+        delete context;
+        throw py::error_already_set();
+    }
+    return py::reinterpret_steal<py::capsule>(capsule);
+}
+
+/**
+ * @brief A cv::Mat handed to Python as a DLPack producer (__dlpack__, __dlpack_device__)
+ *
+ * torch.from_dlpack(tensor) and numpy.from_dlpack(tensor) view the Mat's pixels without
+ * copying; each call exports the same buffer again. numpy() gives the zero-copy array of
+ * cv_mat_to_numpy() for code that still expects one.
+ *
+ * Thread safety: immutable after construction.
+ */
+class MatTensor {
+   public:
+    explicit MatTensor(cv::Mat mat) : mat_(std::move(mat)) {}
+
+    // Producers are called with stream (and, from array-API 2023 consumers, max_version,
+    // dl_device and copy); host tensors need no synchronisation and are never copied
+    py::capsule dlpack(const py::kwargs& /*options*/) const { return cv_mat_to_dlpack(mat_); }
+
+    py::tuple dlpackDevice() const { return py::make_tuple(static_cast<int>(dlpack::kDLCPU), 0); }
+
+    py::tuple shape() const {
+        if (mat_.channels() > 1) return py::make_tuple(mat_.rows, mat_.cols, mat_.channels());
+        return py::make_tuple(mat_.rows, mat_.cols);
+    }
+
+    py::array_t<unsigned char> numpy() const { return cv_mat_to_numpy(mat_); }
+
+   private:
+    cv::Mat mat_;
+};
+
+// Register MatTensor as @p name in @p module
+inline void bind_mat_tensor(py::module& module, const char* name) {
+    py::class_<MatTensor>(module, name)
+        .def("__dlpack__", &MatTensor::dlpack, "DLPack capsule of the pixels (kDLCPU, uint8, H x W[ x C])")
+        .def("__dlpack_device__", &MatTensor::dlpackDevice, "(kDLCPU, 0)")
+        .def_property_readonly("shape", &MatTensor::shape, "(height, width[, channels])")
+        .def("numpy", &MatTensor::numpy, "Zero-copy uint8 numpy view of the pixels")
+        .def("__array__", [](const MatTensor& self, py::args, py::kwargs) { return self.numpy(); });
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+/**
+ * @brief Edge-preserving smoothing at a fraction of cv::bilateralFilter's cost
+ *
+ * Both methods take the bilateral settings: a spatial radius and a colour sigma in gray
+ * levels. Their cost does not grow with the radius.
+ *
+ * GUIDED is the self-guided filter of He et al. Each output pixel is a linear function
+ * a * I + b of its input, fitted over the surrounding (2r+1)^2 box. With colour sigma s:
+ * - in flat areas the box variance v is small next to s^2, so a = v / (v + s^2) is near 0
+ *   and the output is the box mean;
+ * - across an edge v is large, a is near 1 and the edge passes through.
+ * It costs four box filters. With subsample > 1, a and b are fitted on an INTER_AREA
+ * reduced image and upsampled bilinearly ("fast guided filter"), which divides the box
+ * work by subsample^2.
+ *
+ * DOMAIN_TRANSFORM is the recursive filter of Gastal and Oliveira. Each pixel's distance
+ * to its neighbour is 1 + (sigma_s / sigma_r) * |colour step|, so a strong edge is a long
+ * way. A first-order recursion runs along that distance: left, right, down and up, three
+ * times with shrinking spatial sigmas. It does a dozen multiply-adds per pixel and
+ * channel, plus one table lookup per step. sigma_s is the standard deviation of the
+ * bilateral radius' box window (radius / sqrt(3)).
+ *
+ * Input is 8-bit with any channel count. Channels share their coefficients in the domain
+ * transform (the colour step sums them) and are filtered separately by the guided filter.
+ * Output is 8-bit, may alias the input and is reallocated only on size change.
+ *
+ * Neither result can be computed band by band: the box filters keep running sums and
+ * the recursion runs across the whole row or column, so a band's output depends on
+ * where it starts.
+ *
+ * Thread safety: apply() is const; concurrent calls need separate Workspaces.
+ */
+class EdgePreservingFilter {
+   public:
+    enum class Method { GUIDED, DOMAIN_TRANSFORM };
+
+    // Scratch buffers for apply(); sized on first use
+    struct Workspace {
+        cv::Mat image;   // CV_32F copy of the input
+        cv::Mat small;   // GUIDED: subsampled guide
+        cv::Mat mean;    // GUIDED: box mean, then the coefficient a
+        cv::Mat square;  // GUIDED: box mean of squares, then the coefficient b
+        cv::Mat fullA;   // GUIDED: coefficients upsampled to the input size
+        cv::Mat fullB;
+        cv::Mat output;                 // Result when the output is not a cv::Mat
+        cv::Mat stepX;                  // DOMAIN_TRANSFORM: CV_16U colour step to the left neighbour
+        cv::Mat stepY;                  // DOMAIN_TRANSFORM: CV_16U colour step to the upper neighbour
+        std::vector<float> weights;     // DOMAIN_TRANSFORM: recursion weight per colour step
+    };
+
+    /**
+     * @param radius Spatial radius in pixels (bilateral diameter / 2)
+     * @param sigmaColor Gray-level difference that counts as an edge
+     * @param subsample GUIDED only: fit the coefficients at 1/subsample resolution
+     */
+    explicit EdgePreservingFilter(Method method = Method::GUIDED, int radius = 7, double sigmaColor = 75.0,
+                                  int subsample = 1);
+
+    // @param output Same size and type as @p input; may alias it
+    void apply(cv::InputArray input, cv::OutputArray output, Workspace& workspace) const;
+
+    Method method() const { return method_; }
+    int radius() const { return radius_; }
+    double sigmaColor() const { return sigmaColor_; }
+    int subsample() const { return subsample_; }
+
+   private:
+    void guided(const cv::Mat& input, cv::Mat& output, Workspace& workspace) const;
+    void domainTransform(const cv::Mat& input, cv::Mat& output, Workspace& workspace) const;
+
+    Method method_;
+    int radius_;
+    double sigmaColor_;
+    int subsample_;
+};
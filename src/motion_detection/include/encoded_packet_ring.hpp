@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <utility>
+#include <vector>
+
+// One compressed video packet as demuxed from the camera stream
+struct EncodedPacket {
+    std::vector<unsigned char> data;
+    bool keyFrame = false;
+    std::chrono::steady_clock::time_point arrival;
+};
+
+/**
+ * @brief Pre-roll of compressed packets that always starts on a keyframe
+ *
+ * Packets are trimmed a whole GOP at a time, so whatever the ring holds can be remuxed into
+ * a playable segment as is. Packets arriving before the first keyframe are discarded (they
+ * cannot be decoded without it).
+ */
+class EncodedPacketRing {
+   public:
+    // Append a packet; returns false if it was discarded (no keyframe seen yet)
+    bool push(EncodedPacket packet) {
+        if (packets_.empty() && !packet.keyFrame) return false;
+        bytes_ += packet.data.size();
+        packets_.push_back(std::move(packet));
+        return true;
+    }
+
+    /**
+     * @brief Drop leading GOPs that ended before @p cutoff
+     *
+     * A GOP is dropped once the keyframe after it arrived at or before the cutoff, so the ring
+     * keeps at least the requested duration and begins on a keyframe.
+     */
+    void trim(std::chrono::steady_clock::time_point cutoff) {
+        while (!packets_.empty()) {
+            size_t next = 1;
+            while (next < packets_.size() && !packets_[next].keyFrame) ++next;
+            if (next == packets_.size() || packets_[next].arrival > cutoff) return;
+            for (size_t i = 0; i < next; ++i) bytes_ -= packets_[i].data.size();
+            packets_.erase(packets_.begin(), packets_.begin() + static_cast<std::ptrdiff_t>(next));
+        }
+    }
+
+    // Hand every buffered packet over (oldest first) and leave the ring empty
+    std::deque<EncodedPacket> takeAll() {
+        std::deque<EncodedPacket> packets;
+        packets.swap(packets_);
+        bytes_ = 0;
+        return packets;
+    }
+
+    void clear() {
+        packets_.clear();
+        bytes_ = 0;
+    }
+
+    bool empty() const { return packets_.empty(); }
+    size_t size() const { return packets_.size(); }
+    size_t bytes() const { return bytes_; }
+    const EncodedPacket& front() const { return packets_.front(); }
+
+   private:
+    std::deque<EncodedPacket> packets_;
+    size_t bytes_ = 0;
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.hpp"
+
+struct ClipRecorderConfig {
+    bool enabled = false;
+    std::string outputDir = "data/clips";
+    double preRollSeconds = 5.0;    // Video kept from before the event starts
+    double postRollSeconds = 5.0;   // Quiet time after the last region before the clip closes
+    double maxClipSeconds = 300.0;  // Split clips longer than this
+    int preRollQuality = 80;        // JPEG quality of the buffered pre-roll frames
+    std::string codec = "avc1";     // FOURCC of the clip encoder
+    std::string extension = ".mp4";
+    bool hardwareEncode = true;  // Ask FFmpeg for a hardware encoder (falls back to software)
+    size_t queueCapacity = 32;   // Frames waiting for the encoder thread
+    BackpressurePolicy backpressure = BackpressurePolicy::DropOldest;
+};
+
+struct ClipRecorderStats {
+    uint64_t clipsWritten = 0;
+    uint64_t framesWritten = 0;
+    uint64_t framesDropped = 0;  // Shed by the queue before the encoder thread saw them
+    size_t preRollFrames = 0;
+    size_t preRollBytes = 0;  // JPEG bytes currently buffered for the pre-roll
+    bool recording = false;
+};
+
+/**
+ * @brief Event-driven clip recorder with a compressed pre-roll
+ *
+ * push() hands each frame (a reference, never a copy) to an encoder thread. While no event
+ * is running the thread JPEG-compresses the frame into a pre-roll ring of the last
+ * preRollSeconds and lets the frame go, so the pre-roll costs tens of kilobytes per frame
+ * instead of a raw frame each. The first frame with an event opens a clip, writes the
+ * decoded pre-roll and then the live frames, and the clip closes after postRollSeconds
+ * without an event (or at maxClipSeconds).
+ *
+ * Durations are counted in frames at the fps passed to start(), so video files recorded
+ * faster or slower than real time still get the configured clip lengths.
+ *
+ * Thread safety: push() from one producer thread; getStats() and lastClipPath() from any.
+ */
+class EventClipRecorder {
+   public:
+    explicit EventClipRecorder(const ClipRecorderConfig& config);
+    ~EventClipRecorder();
+
+    EventClipRecorder(const EventClipRecorder&) = delete;
+    EventClipRecorder& operator=(const EventClipRecorder&) = delete;
+
+    // Start the encoder thread; fps <= 0 assumes 30
+    void start(double fps);
+
+    /**
+     * @brief Queue a frame (subject to the backpressure policy)
+     * @param eventActive True while the frame has consolidated regions
+     * @return false if the recorder is not running or the frame was dropped
+     */
+    bool push(const cv::Mat& frame, bool eventActive);
+
+    // Stop accepting frames, encode what is queued and close any open clip
+    void stop();
+
+    bool isEnabled() const { return config_.enabled; }
+    ClipRecorderStats getStats() const;
+    std::string lastClipPath() const;
+
+   private:
+    struct QueuedFrame {
+        cv::Mat frame;
+        bool eventActive = false;
+    };
+
+    void run();
+    void handle(const QueuedFrame& item);
+    void bufferPreRoll(const cv::Mat& frame);
+    bool openClip(const cv::Size& frameSize, bool color);
+    void writeFrame(const cv::Mat& frame);
+    void closeClip();
+
+    const ClipRecorderConfig config_;
+    BoundedQueue<QueuedFrame> queue_;
+    std::thread worker_;
+
+    // Encoder thread only
+    cv::VideoWriter writer_;
+    std::deque<std::vector<unsigned char>> preRoll_;
+    std::vector<std::vector<unsigned char>> spareBuffers_;  // Recycled pre-roll JPEG buffers
+    cv::Size clipSize_;
+    double fps_ = 30.0;
+    size_t preRollFrames_ = 0;
+    size_t postRollFrames_ = 0;
+    size_t maxClipFrames_ = 0;
+    size_t quietFrames_ = 0;
+    size_t clipFrames_ = 0;
+    bool openFailureLogged_ = false;
+
+    std::atomic<uint64_t> clipsWritten_{0};
+    std::atomic<uint64_t> framesWritten_{0};
+    std::atomic<size_t> preRollCount_{0};
+    std::atomic<size_t> preRollBytes_{0};
+    std::atomic<bool> recording_{false};
+    mutable std::mutex pathMutex_;
+    std::string lastClipPath_;
+};
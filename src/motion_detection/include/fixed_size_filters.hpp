@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <vector>
+
+/**
+ * @brief cv::GaussianBlur of a fixed kernel size, instantiated for the common sizes
+ *
+ * gaussian_blur_size takes a handful of values, so each supported size (3, 5, 7, 9, 11)
+ * is a template instance whose tap loops the compiler unrolls completely, 16 pixels per
+ * step in 128-bit universal intrinsics. plan() picks the instance once per configuration;
+ * apply() returns false for anything it does not cover, and the caller runs OpenCV.
+ *
+ * The arithmetic is OpenCV's fixed point for 8-bit images: taps with 8 fractional bits,
+ * a horizontal pass kept exact in 16 bits, a vertical pass summed in 32 bits and rounded
+ * once. The taps of sizes 3, 5 and 7 are exact in 8 bits, so those match cv::GaussianBlur
+ * bit for bit; 9 and 11 can differ by one grey level where OpenCV rounds a tap the other
+ * way. Borders are BORDER_REFLECT_101. The vertical pass streams the horizontal rows
+ * through a ring of kernel-size rows, so the intermediate stays in cache.
+ *
+ * Thread safety: apply() is const; concurrent calls need separate Workspaces.
+ */
+class FixedGaussianBlur {
+   public:
+    // Scratch buffers for apply(); sized on first use
+    struct Workspace {
+        std::vector<uchar> padded;   // One input row with reflected borders
+        std::vector<uint16_t> ring;  // Horizontal sums of the last kernel-size rows
+    };
+
+    static bool supports(int kernelSize);
+
+    // Select the instance for @p kernelSize; false (nothing planned) for other sizes
+    bool plan(int kernelSize);
+    bool planned() const { return run_ != nullptr; }
+    int kernelSize() const { return size_; }
+
+    /**
+     * @brief Blur a CV_8UC1 image
+     * @param output Reallocated only on size change; may alias @p input
+     * @return false, leaving @p output alone, when nothing is planned, the input is not
+     *         CV_8UC1 or it is no larger than the kernel radius
+     */
+    bool apply(const cv::Mat& input, cv::Mat& output, Workspace& workspace) const;
+
+   private:
+    using Run = void (*)(const cv::Mat&, cv::Mat&, const uint16_t*, Workspace&);
+
+    Run run_ = nullptr;
+    int size_ = 0;
+    std::vector<uint16_t> taps_;  // Q8, adding up to 256
+};
+
+/**
+ * @brief cv::erode / cv::dilate with a small structuring element, one instance per side
+ *
+ * Covers kernels of side 3, 5 or 7 whose rows are each one centred run of set pixels:
+ * the rectangle, the cross and the ellipses getStructuringElement builds. Each row is
+ * reduced once per distinct run width (growing the window one pixel either side at a
+ * time, 16 pixels per step); the output row is then the min or max of the kernel's rows
+ * of those, all in loops unrolled over the side. Pixels outside the image never win, as
+ * with OpenCV's default border, so results match cv::erode / cv::dilate exactly.
+ *
+ * Thread safety: apply() is const; concurrent calls need separate Workspaces.
+ */
+class FixedMorphology {
+   public:
+    // Scratch buffers for apply(); sized on first use
+    struct Workspace {
+        std::vector<uchar> padded;   // One input row with neutral borders
+        std::vector<uchar> ring;     // Per run width, the row reductions of the last side rows
+        std::vector<uchar> neutral;  // Stands in for rows outside the image
+    };
+
+    // Run width index of each kernel row (-1: empty row), and the half-width of each index
+    struct Shape {
+        int rowWidth[7];
+        int halfWidths[4];
+        int widthCount;
+    };
+
+    // Select the instance for @p kernel (CV_8U); false (nothing planned) if it is not covered
+    bool plan(const cv::Mat& kernel);
+    bool planned() const { return erode_ != nullptr; }
+
+    /**
+     * @brief @p iterations erosions or dilations of a CV_8UC1 mask
+     * @param output Reallocated only on size change; may alias @p input
+     */
+    void apply(bool dilate, const cv::Mat& input, cv::Mat& output, int iterations, Workspace& workspace) const;
+
+   private:
+    using Run = void (*)(const cv::Mat&, cv::Mat&, const Shape&, Workspace&);
+
+    Run erode_ = nullptr;
+    Run dilate_ = nullptr;
+    Shape shape_{};
+};
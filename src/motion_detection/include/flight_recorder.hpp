@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "motion_processor.hpp"
+
+struct FlightRecorderConfig {
+    bool enabled = false;
+    std::string directory = "data/flight_recorder";  // One subdirectory per dump
+    size_t frames = 90;                 // Frames kept (fewer when maxBytes is reached first)
+    size_t maxBytes = 16u << 20;        // Cap on the image memory of the ring
+    int thumbnailSide = 320;            // Stages are scaled down to fit this square
+    size_t maxBoxes = 64;               // Boxes kept per frame
+    bool dumpOnFlood = true;            // Dump when the flood guard suppresses a frame
+    double latencySloMs = 0.0;          // Dump when a frame takes longer, capture to output (0 = off)
+    double minDumpIntervalSeconds = 60.0;  // Between automatic (flood, latency) dumps
+};
+
+struct FlightRecorderStats {
+    uint64_t recorded = 0;
+    uint64_t skipped = 0;  // Arrived while a dump held the ring
+    uint64_t dumps = 0;
+    uint64_t failed = 0;   // Dumps that could not write their directory
+    size_t capacity = 0;   // Frames the ring holds (0 until the first frame)
+    size_t bytes = 0;      // Image memory of the ring
+};
+
+/**
+ * @brief Ring of the last frames' intermediate stages, written to disk only on a trigger
+ *
+ * record() keeps the processed frame, the frame difference, the threshold and the
+ * morphological mask of each frame scaled down to thumbnailSide, plus its boxes, in a ring
+ * allocated with the first frame: as many slots as frames and maxBytes allow, reused from
+ * then on, so recording costs a few small resizes per frame and nothing else. Stages the
+ * processor did not retain are left out.
+ *
+ * Nothing is written until a dump is triggered: by requestDump() (an API call or a
+ * signal), by a frame the flood guard suppressed, or by a frame over the latency SLO.
+ * Automatic triggers are at most one per minDumpIntervalSeconds. The dump runs on its own
+ * thread and writes, oldest frame first, every stage as a PNG, a "boxes" image (the
+ * processed frame with the boxes drawn; offset when regions of interest crop the processed
+ * frame) and frames.csv into directory/<time>_<reason>. It holds the ring meanwhile:
+ * record() never waits, frames arriving during a dump are skipped.
+ *
+ * Thread safety: every method may be called from any thread; record() from one at a time.
+ */
+class FlightRecorder {
+   public:
+    explicit FlightRecorder(FlightRecorderConfig config);
+    ~FlightRecorder();  // Waits for a dump in progress
+
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+    bool isEnabled() const { return config_.enabled; }
+    const FlightRecorderConfig& config() const { return config_; }
+
+    // Keep the stages and boxes of a processed frame of @p frameSize (right after
+    // processFrame(), before the processor reuses its buffers)
+    void record(int frameIndex, int64_t captureUnixUs, const cv::Size& frameSize,
+                const MotionProcessor::ProcessingResult& result);
+
+    // Check a frame's capture-to-output latency against the SLO
+    void recordLatency(int frameIndex, double latencyMs);
+
+    /**
+     * @brief Write the ring now, on the recorder's thread
+     * @param reason Names the dump directory (letters, digits and '_' are kept)
+     * @return false when disabled, nothing is recorded yet, or a dump is already running
+     */
+    bool requestDump(const std::string& reason);
+
+    // Block until no dump is running
+    void waitIdle();
+
+    // Directory of the last dump started (empty before the first)
+    std::string lastDumpPath() const;
+
+    FlightRecorderStats getStats() const;
+
+   private:
+    struct Slot {
+        int frameIndex = -1;
+        int64_t captureUnixUs = 0;
+        cv::Size frameSize;  // Input frame, the coordinates of the boxes
+        MotionProcessor::FloodKind flood = MotionProcessor::FloodKind::NONE;
+        unsigned stages = 0;  // ResultStage bits of the images below holding this frame
+        cv::Mat processed;
+        cv::Mat frameDiff;
+        cv::Mat thresh;
+        cv::Mat morphological;
+        std::vector<cv::Rect> boxes;  // Frame pixels, capacity maxBoxes
+    };
+
+    void allocate(const MotionProcessor::ProcessingResult& result);
+    bool trigger(const std::string& reason, bool automatic);
+    void dump(std::string path);
+
+    FlightRecorderConfig config_;
+
+    std::mutex ringMutex_;  // Held by record() (try_lock) and by a dump
+    std::vector<Slot> slots_;
+    size_t next_ = 0;    // Slot the next frame goes to
+    size_t filled_ = 0;  // Slots holding a frame
+
+    mutable std::mutex dumpMutex_;  // Guards what follows
+    std::thread dumpThread_;
+    std::string lastDumpPath_;
+    std::chrono::steady_clock::time_point lastAutomaticDump_;
+    bool automaticDumped_ = false;
+    std::atomic<bool> dumping_{false};
+
+    std::atomic<uint64_t> recorded_{0};
+    std::atomic<uint64_t> skipped_{0};
+    std::atomic<uint64_t> dumps_{0};
+    std::atomic<uint64_t> failed_{0};
+    std::atomic<size_t> capacity_{0};
+    std::atomic<size_t> bytes_{0};
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+struct FrameArenaStats {
+    uint64_t frames = 0;          // reset() calls
+    uint64_t overflowFrames = 0;  // Frames that needed more than the buffer held
+    size_t peakBytes = 0;         // Largest single-frame demand
+};
+
+/**
+ * @brief Per-frame monotonic memory resource for transient pipeline containers
+ *
+ * Allocations bump a pointer through one pre-allocated buffer and deallocation is a no-op;
+ * reset() at the end of the frame releases everything at once. A frame that needs more than
+ * the buffer spills to the heap (std::pmr::monotonic_buffer_resource chunks) and the buffer
+ * is enlarged at the next reset(), so a long-running process settles on one buffer and its
+ * per-frame scratch neither reaches the allocator nor fragments the heap.
+ *
+ * Nothing allocated from the arena may outlive the frame. Thread safety: not thread-safe;
+ * use one arena per pipeline thread or stream (see MotionPipelineContext).
+ */
+class FrameArena : public std::pmr::memory_resource {
+   public:
+    explicit FrameArena(size_t initialBytes = 64 * 1024);
+    ~FrameArena() override;
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // End of frame: invalidates every allocation and grows the buffer if the frame overflowed
+    void reset();
+
+    size_t capacity() const { return capacity_; }  // Buffer size (allocated on first use)
+    size_t bytesUsed() const { return used_; }  // Requested since the last reset()
+    const FrameArenaStats& getStats() const { return stats_; }
+
+   private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}  // Released by reset()
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    // The buffer is allocated on first use, so an arena that is never used costs nothing
+    void allocateBuffer();
+
+    std::unique_ptr<std::byte[]> buffer_;
+    size_t capacity_ = 0;
+    std::optional<std::pmr::monotonic_buffer_resource> resource_;
+    size_t used_ = 0;
+    FrameArenaStats stats_;
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <vector>
+
+/**
+ * @brief Recycles frame buffers between a capture loop and the stages consuming its frames
+ *
+ * acquire() hands out a header over one of up to capacity pooled buffers that nobody else
+ * references any more (OpenCV's reference count is back to the pool's own), so steady-state
+ * capture allocates nothing: a frame released by the last pipeline stage (or dropped by
+ * backpressure) is written again a few frames later. When every pooled buffer is still in
+ * use the pool allocates an unpooled one instead of waiting, so a slow consumer costs memory,
+ * never frames. With setAllocator() the buffers are mapped by a custom cv::MatAllocator
+ * (huge pages or NUMA-local memory, see PlacedMatAllocator).
+ *
+ * Thread safety: acquire() must be called from one thread (the capture loop); the returned
+ * frames may be released, and the counters read, on any thread.
+ */
+class FrameBufferPool {
+   public:
+    explicit FrameBufferPool(size_t capacity = 16) : capacity_(capacity) { slots_.reserve(capacity); }
+
+    /**
+     * @brief Allocate buffers with @p allocator (nullptr = OpenCV's default)
+     *
+     * Pooled buffers are dropped and reallocated with it on demand; buffers still in use
+     * are released by their last user as usual. Call from the acquire() thread.
+     */
+    void setAllocator(cv::MatAllocator* allocator) {
+        allocator_ = allocator;
+        slots_.clear();
+    }
+
+    /**
+     * @brief A size x type buffer no other frame shares
+     *
+     * The contents are whatever the buffer held last; callers overwrite the whole frame.
+     */
+    cv::Mat acquire(const cv::Size& size, int type) {
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            cv::Mat& slot = slots_[(next_ + i) % slots_.size()];
+            if (!isUnshared(slot)) continue;
+            if (slot.size() != size || slot.type() != type) {
+                slot.release();
+                slot.allocator = allocator_;
+                slot.create(size, type);  // Resolution or layout changed: reallocate in place
+                allocations_.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                reuses_.fetch_add(1, std::memory_order_relaxed);
+            }
+            next_ = (next_ + i + 1) % slots_.size();
+            return slot;
+        }
+
+        allocations_.fetch_add(1, std::memory_order_relaxed);
+        if (slots_.size() < capacity_) {
+            slots_.push_back(allocate(size, type));
+            return slots_.back();
+        }
+        return allocate(size, type);  // Pool exhausted: unpooled, freed by its last user
+    }
+
+    size_t capacity() const { return capacity_; }
+    size_t pooled() const { return slots_.size(); }
+    // Buffers allocated (pooled or not) and buffers handed out again without allocating
+    uint64_t allocations() const { return allocations_.load(std::memory_order_relaxed); }
+    uint64_t reuses() const { return reuses_.load(std::memory_order_relaxed); }
+
+   private:
+    cv::Mat allocate(const cv::Size& size, int type) const {
+        cv::Mat frame;
+        frame.allocator = allocator_;
+        frame.create(size, type);
+        return frame;
+    }
+
+    // Only the pool's own Mat references the buffer
+    static bool isUnshared(const cv::Mat& slot) { return slot.u && CV_XADD(&slot.u->refcount, 0) == 1; }
+
+    size_t capacity_;
+    cv::MatAllocator* allocator_ = nullptr;
+    size_t next_ = 0;  // Round-robin start, so recently released buffers rest before reuse
+    std::vector<cv::Mat> slots_;
+    std::atomic<uint64_t> allocations_{0};
+    std::atomic<uint64_t> reuses_{0};
+};
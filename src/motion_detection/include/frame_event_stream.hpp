@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.hpp"
+#include "capture_source.hpp"
+#include "motion_processor.hpp"
+#include "motion_region_consolidator.hpp"
+#include "object_tracker.hpp"
+#include "pipeline_config.hpp"
+
+struct FrameEventStreamOptions {
+    int frameSkip = 0;           // Frames dropped after each processed one (0 = process every frame)
+    bool motionOnly = true;      // Emit only frames with at least one consolidated region
+    bool crops = true;           // Attach a view of the frame per region
+    size_t inFlight = 3;         // Frames overlapped by the PipelinedFrameExecutor
+    size_t queueCapacity = 8;    // Events waiting for the consumer
+    // What a full event queue does: Block paces a file to the consumer, DropOldest keeps a
+    // live source real time by discarding the stalest events
+    BackpressurePolicy policy = BackpressurePolicy::Block;
+};
+
+// Counters of a stream, as of the event that carries them
+struct FrameEventStats {
+    uint64_t framesRead = 0;
+    uint64_t framesSkipped = 0;     // By frameSkip, never processed
+    uint64_t framesProcessed = 0;
+    uint64_t eventsEmitted = 0;
+    uint64_t eventsDropped = 0;     // By a DropOldest queue the consumer fell behind on
+    uint64_t processingErrors = 0;
+    double processedFps = 0.0;      // framesProcessed over the time since start()
+};
+
+// One processed frame handed to the consumer
+struct FrameEvent {
+    uint64_t frameIndex = 0;        // Position in the source, skipped frames included
+    double timestampMs = 0.0;       // Backend timestamp (CaptureSource::lastTimestampMs)
+    cv::Mat frame;
+    std::vector<cv::Rect> boxes;
+    std::vector<ConsolidatedRegion> regions;
+    std::vector<cv::Mat> crops;     // ROI headers into frame, one per region (no pixel copies)
+    FrameEventStats stats;
+    std::string error;              // What a stage threw; empty on success
+};
+
+/**
+ * @brief Capture, detection and consolidation on native threads, delivered as a stream of events
+ *
+ * A reader thread pulls frames from the source, drops frameSkip frames after each one it
+ * keeps and runs the kept ones through a PipelinedFrameExecutor (detect and consolidate on
+ * two more threads). Finished frames become FrameEvents in a bounded queue that next()
+ * pops, so a consumer (the Python iterator in particular) only wakes up for the frames it
+ * asked for and never pays a per-frame call into the pipeline.
+ *
+ * Event frames are the capture buffers themselves and crops are ROI headers into them;
+ * holding an event keeps its buffer out of the capture pool, which allocates a new one
+ * rather than overwrite it.
+ *
+ * Thread safety: start(), next(), nextFor() and stop() from one consumer thread; stats()
+ * from any thread.
+ */
+class FrameEventStream {
+   public:
+    // Reads the next frame and its timestamp; false at the end of the source
+    using FrameReader = std::function<bool(cv::Mat& frame, double& timestampMs)>;
+
+    FrameEventStream(std::shared_ptr<const PipelineConfig> config, FrameReader reader,
+                     FrameEventStreamOptions options = FrameEventStreamOptions());
+    ~FrameEventStream();
+
+    FrameEventStream(const FrameEventStream&) = delete;
+    FrameEventStream& operator=(const FrameEventStream&) = delete;
+
+    /**
+     * @brief A stream over a CaptureSource opened with @p capture
+     * @throws std::runtime_error if the source cannot be opened
+     */
+    static std::unique_ptr<FrameEventStream> open(std::shared_ptr<const PipelineConfig> config,
+                                                  CaptureConfig capture,
+                                                  FrameEventStreamOptions options = FrameEventStreamOptions());
+
+    // Start the reader thread (idempotent)
+    void start();
+
+    // The next event, waiting for it; nullopt once the source ended (or stop()) and every event was taken
+    std::optional<FrameEvent> next();
+
+    // Like next(), but returns nullopt after @p timeout too; finished() tells the two apart
+    std::optional<FrameEvent> nextFor(std::chrono::milliseconds timeout);
+
+    // Stop reading; events already queued can still be taken
+    void stop();
+
+    bool finished() const { return events_.isDrained(); }
+    FrameEventStats stats() const;
+    const FrameEventStreamOptions& options() const { return options_; }
+
+   private:
+    void run();
+    void emit(FrameEvent event);
+
+    std::shared_ptr<const PipelineConfig> config_;
+    FrameReader reader_;
+    const FrameEventStreamOptions options_;
+
+    MotionProcessor processor_;
+    MotionRegionConsolidator consolidator_;
+    std::unique_ptr<ObjectTracker> tracker_;
+    std::unique_ptr<CaptureSource> capture_;  // Owned when created by open()
+
+    BoundedQueue<FrameEvent> events_;
+    std::thread thread_;
+    std::atomic<bool> stopping_{false};
+    std::chrono::steady_clock::time_point started_;
+
+    std::atomic<uint64_t> framesRead_{0};
+    std::atomic<uint64_t> framesSkipped_{0};
+    std::atomic<uint64_t> framesProcessed_{0};
+    std::atomic<uint64_t> eventsEmitted_{0};
+    std::atomic<uint64_t> processingErrors_{0};
+};
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <memory>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "async_file_writer.hpp"
+#include "frame_metadata.hpp"
+#include "frame_segment_store.hpp"
+#include "image_encoder.hpp"
+#include "thumbnail_atlas.hpp"
+
+// One consolidated region stored as its own JPEG (region-crop persistence)
+struct StoredRegionCrop {
+    std::string path;
+    cv::Rect region;  // Consolidated region in frame coordinates
+    cv::Rect crop;    // Area actually stored: the region, padded and clamped to the frame
+    uint64_t bytes = 0;  // Encoded size
+};
+
+/**
+ * @brief Background image that plate-and-patch records are reconstructed on
+ *
+ * Stored as <storagePath>/plates/YYYY/MM/DD/HH/<id>.jpg (full-frame codec) at the size the
+ * background model learns at, which may be smaller than the frame and gray: readers scale it
+ * to original_frame_shape and paste the region crops at their crop rectangles.
+ */
+struct StoredPlate {
+    std::string id;    // Empty: the record has no plate
+    std::string path;
+    cv::Size size;
+};
+
+// Codec, quality and effort of each kind of stored image
+struct StorageEncoding {
+    ImageEncodeSettings full{ImageCodec::Jpeg, 95, 3};       // Original and processed frames
+    ImageEncodeSettings crop{ImageCodec::Jpeg, 95, 3};       // Region crops
+    ImageEncodeSettings thumbnail{ImageCodec::Jpeg, 75, 3};  // Thumbnails and visit context images
+};
+
+/**
+ * @brief Frame whose images are on disk and whose metadata document is ready to insert
+ *
+ * Paths follow the FileStorageManager layout (data/frames/{original,processed}[_thumbnails]/
+ * YYYY/MM/DD/HH/<uuid>.jpg, by UTC hour of writing) so documents match what
+ * FrameDatabaseV2.save_frame_with_original() writes. Other codecs change the extension
+ * (.webp, .avif, .jxl) and set the segment extents' content type.
+ *
+ * Documents also list every stored image under "images" as {url, bytes} (storedImageLinks()),
+ * so the viewer can page through frames without reading paths or image data.
+ */
+struct StoredFrameRecord {
+    std::string uuid;
+    std::string originalPath;   // Empty for region-crop records
+    std::string processedPath;  // Empty for region-crop records
+    std::string originalThumbnailPath;   // Empty if the thumbnail could not be written
+    std::string processedThumbnailPath;  // Empty if the thumbnail could not be written
+    // With a segment store the images are appended to segments instead: the paths above
+    // stay empty and these extents are set
+    SegmentExtent originalSegment;
+    SegmentExtent processedSegment;
+    SegmentExtent originalThumbnailSegment;
+    SegmentExtent processedThumbnailSegment;
+    // Encoded sizes of the four images above, file or extent; 0 for those not stored
+    uint64_t originalBytes = 0;
+    uint64_t processedBytes = 0;
+    uint64_t originalThumbnailBytes = 0;
+    uint64_t processedThumbnailBytes = 0;
+    cv::Size originalSize;
+    int originalChannels = 3;
+    cv::Size processedSize;
+    int processedChannels = 3;
+    std::vector<StoredRegionCrop> regionCrops;  // Region-crop records only
+    StoredPlate plate;  // Plate-and-patch records: the background their crops go onto
+    AtlasCell atlasCell;  // Gallery thumbnail in a ThumbnailAtlas sheet (useAtlas())
+    FrameMetadata metadata;
+};
+
+/**
+ * @brief One stored image of a record, as the web viewer fetches it
+ *
+ * The URL names the frame and the kind of image rather than where the bytes are; a stored
+ * image is never rewritten, so responses for its URL may be cached indefinitely.
+ */
+struct StoredImageLink {
+    const char* kind;  // "original", "processed", "original_thumbnail" or "processed_thumbnail"
+    std::string url;   // /api/frames/<uuid>/image/<kind>
+    uint64_t bytes;
+};
+
+// Links of the images @p record stored, in the order of the kinds above
+inline std::vector<StoredImageLink> storedImageLinks(const StoredFrameRecord& record) {
+    std::vector<StoredImageLink> links;
+    for (const auto& image :
+         {std::make_tuple("original", &record.originalPath, &record.originalSegment, record.originalBytes),
+          std::make_tuple("processed", &record.processedPath, &record.processedSegment, record.processedBytes),
+          std::make_tuple("original_thumbnail", &record.originalThumbnailPath, &record.originalThumbnailSegment,
+                          record.originalThumbnailBytes),
+          std::make_tuple("processed_thumbnail", &record.processedThumbnailPath,
+                          &record.processedThumbnailSegment, record.processedThumbnailBytes)}) {
+        if (std::get<1>(image)->empty() && std::get<2>(image)->empty()) continue;
+        links.push_back({std::get<0>(image), "/api/frames/" + record.uuid + "/image/" + std::get<0>(image),
+                         std::get<3>(image)});
+    }
+    return links;
+}
+
+// URL of region crop @p index of a record
+inline std::string regionCropUrl(const std::string& uuid, size_t index) {
+    return "/api/frames/" + uuid + "/crops/" + std::to_string(index);
+}
+
+/**
+ * @brief Native replacement for the Python FileStorageManager write path
+ *
+ * Encodes original/processed frames and their thumbnails as JPEG (JpegEncoder: TurboJPEG when
+ * available) using the same directory layout, qualities and thumbnail size, so no Python is
+ * needed to store images; useEncoding() picks another codec (ImageEncoder) per kind of
+ * image. FrameDatabaseV2.insert_frame_records() adds the files to the FileStorageManager index.
+ * The four images are encoded in parallel and each file is written with a single buffered write.
+ *
+ * Thread safety: write() and remove() may be called concurrently from several threads.
+ */
+class FrameFileStorage {
+   public:
+    explicit FrameFileStorage(const std::string& storagePath = "data/frames", int jpegQuality = 95,
+                              int thumbnailQuality = 75,
+                              const cv::Size& thumbnailSize = cv::Size(320, 240),
+                              const std::string& regionPath = "data/regions");
+
+    // Create the storage and region directories; returns false if any could not be created
+    bool ensureDirectories() const;
+
+    /**
+     * @brief Append full frames and thumbnails to @p segments instead of writing a file each
+     *
+     * Region crops stay individual files (batch_detect_regions.py reads them by name).
+     * Call before the first write(); nullptr returns to one file per image.
+     */
+    void useSegments(std::shared_ptr<FrameSegmentStore> segments) {
+        segments_ = std::move(segments);
+    }
+
+    /**
+     * @brief Codec, quality and effort for full frames, region crops and thumbnails
+     *
+     * A codec that was not built in falls back to JPEG at the same quality (logged). Call
+     * before the first write(); the constructor's qualities are JPEG at those settings.
+     */
+    void useEncoding(const StorageEncoding& encoding);
+    const StorageEncoding& encoding() const { return encoding_; }
+
+    /**
+     * @brief Hand image files to @p writer instead of writing them on the encoding threads
+     *
+     * write() and writeRegions() still return once the record's files are closed, so the
+     * document never points at a missing image. Call before the first write().
+     */
+    void useWriter(std::shared_ptr<AsyncFileWriter> writer) { writer_ = std::move(writer); }
+
+    /**
+     * @brief Also place each record's gallery thumbnail in @p atlas (per-hour sprite sheets)
+     *
+     * The processed frame of write() records and the context image of region records go to
+     * the sheet of the hour partition they are written in; StoredFrameRecord::atlasCell says
+     * where. The individual thumbnails are still written. Call before the first write().
+     */
+    void useAtlas(std::shared_ptr<ThumbnailAtlas> atlas) { atlas_ = std::move(atlas); }
+
+    /**
+     * @brief Write both frames and thumbnails under a fresh UUID
+     * @param record Filled with the UUID, paths and shapes (metadata is left untouched)
+     * @return false if either full-size image failed (nothing is left on disk in that case)
+     */
+    bool write(const cv::Mat& original, const cv::Mat& processed, StoredFrameRecord& record) const;
+
+    /**
+     * @brief Write only the consolidated region crops plus one context thumbnail
+     *
+     * Each region becomes <regionPath>/<uuid>_<index>.jpg (the crop codec's extension), the
+     * path batch_detect_regions.py reads from the document. Regions smaller than @p minCropSide are
+     * grown around their center to that size (clamped to the frame) so the detector sees
+     * some context; 0 stores the exact boxes. The context thumbnail of @p original goes to
+     * the original_thumbnails/ hour partition and no full-size image is written.
+     *
+     * @param record Filled like write(), with regionCrops instead of the full-size paths
+     * @return false if any crop failed (nothing is left on disk in that case)
+     */
+    bool writeRegions(const cv::Mat& original, const std::vector<cv::Rect>& regions,
+                      int minCropSide, StoredFrameRecord& record) const;
+
+    /**
+     * @brief Like writeRegions(), for crops already cut from different frames (visit documents)
+     *
+     * crops[i] is the area areas[i] of a @p frameSize frame and shows region regions[i];
+     * @p context (any size) becomes the context thumbnail.
+     */
+    bool writeCrops(const cv::Size& frameSize, const cv::Mat& context, const std::vector<cv::Mat>& crops,
+                    const std::vector<cv::Rect>& regions, const std::vector<cv::Rect>& areas,
+                    StoredFrameRecord& record) const;
+
+    /**
+     * @brief Write a background plate that later region-crop records can refer to
+     *
+     * Plates are shared by many records, so remove() leaves them alone; they are deleted with
+     * the hour partitions that hold them.
+     * @return false if it could not be encoded or written (nothing is left on disk then)
+     */
+    bool writePlate(const cv::Mat& background, StoredPlate& plate) const;
+
+    // Region grown around its center to at least minSide per axis, clamped to the frame
+    static cv::Rect regionCropRect(const cv::Rect& region, const cv::Size& frameSize, int minSide);
+
+    // Delete every file belonging to a record (missing files are ignored). Segment extents
+    // cannot be freed individually; their space goes when the segment is deleted.
+    void remove(const StoredFrameRecord& record) const;
+
+    /**
+     * @brief Delete the hour partitions of every image directory that end before @p cutoff
+     *
+     * Retention is one directory unlink per expired hour: only the YYYY/MM/DD/HH directory
+     * levels are listed, never the files in them, as in FileStorageManager.cleanup_old_frames().
+     * Day, month and year directories left empty go too. Files outside the partitions
+     * (region crops, segments) are not touched.
+     * @return Number of hour partitions deleted
+     */
+    size_t removePartitionsBefore(std::time_t cutoff) const;
+
+    const std::string& storagePath() const { return storagePath_; }
+
+    // Random version 4 UUID in canonical form, like Python's str(uuid.uuid4())
+    static std::string generateUuid();
+
+   private:
+    // Fresh UUID, thumbnail path and regionCrops entries of a region-crop record
+    void startRegionRecord(const cv::Size& frameSize, int channels, const std::vector<cv::Rect>& regions,
+                           const std::vector<cv::Rect>& areas, StoredFrameRecord& record) const;
+    // Encode crops[i] to regionCrops[i] and the context thumbnail; removes the files on failure
+    bool encodeRegionRecord(const cv::Mat& context, const std::vector<cv::Mat>& crops,
+                            StoredFrameRecord& record) const;
+
+    // <storagePath>/<subdir>/<partition>, created if missing
+    std::filesystem::path partitionDirectory(const char* subdir,
+                                             const std::string& partition) const;
+
+    std::string storagePath_;
+    StorageEncoding encoding_;
+    cv::Size thumbnailSize_;
+    std::string regionPath_;
+    std::shared_ptr<FrameSegmentStore> segments_;
+    std::shared_ptr<AsyncFileWriter> writer_;
+    std::shared_ptr<ThumbnailAtlas> atlas_;
+};
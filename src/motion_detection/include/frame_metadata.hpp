@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+// One consolidated region of a saved frame ("consolidated_regions" entry)
+struct RegionMetadata {
+    cv::Rect box;
+    int objectCount = 0;
+    std::string classLabel = "unknown";
+    float classConfidence = 0.0f;
+    int classId = -1;
+    float speed = 0.0f;      // Frame pixels per frame (motion_history; 0 = not measured)
+    float direction = 0.0f;  // Degrees, 0 = right, 90 = down
+};
+
+// Where a saved frame's time went before its save was scheduled ("latency_ms" subdocument)
+struct LatencyMetadata {
+    double detectQueuedMs = 0.0;  // Waiting for the detect stage
+    double detectMs = 0.0;
+    double consolidateQueuedMs = 0.0;
+    double consolidateMs = 0.0;
+    double renderQueuedMs = 0.0;
+    double totalMs = 0.0;  // Capture to save scheduling
+};
+
+// Run-length encoded motion mask of a saved frame ("motion_mask" subdocument, see RleMask)
+struct MotionMaskMetadata {
+    cv::Size size;         // Mask grid (detection resolution); empty = no mask
+    cv::Rect frameArea;    // Frame pixels the grid covers
+    int64_t pixels = 0;    // Set pixels of the grid
+    cv::Rect bounds;       // Frame pixels
+    cv::Point2d centroid;  // Frame pixels
+    std::string counts;    // RleMask::encode(); empty when the mask was too large to store
+};
+
+// A point of a visit's path: region center, milliseconds after the visit started
+struct VisitPathPoint {
+    cv::Point center;
+    int64_t offsetMs = 0;
+};
+
+// What a visit document (VisitAggregator) adds to its metadata ("visit" subdocument)
+struct VisitMetadata {
+    int64_t startUs = 0;  // Unix microseconds of the first and last frame the visit was seen in
+    int64_t endUs = 0;
+    int frames = 0;
+    std::vector<int> trackIds;
+    std::vector<VisitPathPoint> path;
+    std::vector<double> cropScores;  // One per consolidated region, i.e. per stored crop
+};
+
+/**
+ * @brief Metadata document of one saved frame
+ *
+ * Built by the capture loop and serialized directly into its destination: a BSON document
+ * by FrameStore and a Python dict by MongoFrameSession, with no JSON text in between. Field
+ * names and types match the documents the JSON path used to write, except that timestamp is
+ * a BSON date so the viewer can sort and page on it through an index:
+ *
+ *   source, frame_count, timestamp (UTC date), auto_saved, motion_detected,
+ *   motion_regions, consolidated_regions_count, confidence,
+ *   consolidated_regions [{x, y, width, height, object_count, class_label, class_confidence,
+ *   class_id, speed, direction}], motion_boxes [{x, y, width, height}] when includeMotionBoxes is set,
+ *   capture_time (UTC date), source_timestamp_ms and latency_ms {detect_queued, detect,
+ *   consolidate_queued, consolidate, render_queued, total} when captureTimeUs is set, and
+ *   motion_mask {width, height, roi {x, y, width, height}, pixels, bounds {x, y, width,
+ *   height}, centroid {x, y}, counts} when the frame carries a motion mask
+ *
+ * A visit document (isVisit) stands for every frame of one bird visit: its consolidated
+ * regions are the visit's best crops and it adds visit {start_time (UTC date), end_time
+ * (UTC date), duration_s, frames, track_ids, path [{x, y, t_ms}], crop_scores}.
+ */
+struct FrameMetadata {
+    std::string source = "motion_detection_cpp";
+    int frameCount = 0;
+    int64_t timestamp = 0;  // Unix seconds
+    bool autoSaved = true;
+    bool motionDetected = false;
+    int motionRegions = 0;  // Individual motion boxes
+    double confidence = 0.0;
+    std::vector<RegionMetadata> consolidatedRegions;
+    // Saves that store no annotated frame list the individual motion boxes
+    bool includeMotionBoxes = false;
+    std::vector<cv::Rect> motionBoxes;
+    // Frames that went through the live pipeline carry their capture time and latency trace
+    int64_t captureTimeUs = 0;       // Unix microseconds (0 = not traced)
+    double sourceTimestampMs = 0.0;  // Backend's frame time (stream PTS or driver timestamp)
+    LatencyMetadata latency;
+    MotionMaskMetadata motionMask;  // motion_mask_rle
+    bool isVisit = false;
+    VisitMetadata visit;
+};
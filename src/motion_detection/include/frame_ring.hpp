@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <opencv2/core.hpp>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief The last N frames, stored without copies
+ *
+ * push() swaps the frame into the slot after the newest one. Once the ring is full that
+ * slot holds the oldest frame, whose buffer goes back to the caller to write the next
+ * frame into, so a steady stream allocates nothing. Age 0 is the newest frame; at()
+ * returns an empty Mat for ages the ring does not hold (yet).
+ */
+class FrameRing {
+   public:
+    explicit FrameRing(size_t capacity = 1) : slots_(std::max<size_t>(1, capacity)) {}
+
+    // Store @p frame as the newest; @p frame receives the recycled buffer (may be empty)
+    void push(cv::Mat& frame) {
+        newest_ = (newest_ + 1) % slots_.size();
+        std::swap(slots_[newest_], frame);
+        size_ = std::min(size_ + 1, slots_.size());
+    }
+
+    // Store a copy of @p frame, for callers that keep using it
+    void pushCopy(const cv::Mat& frame) {
+        newest_ = (newest_ + 1) % slots_.size();
+        slots_[newest_] = frame.clone();
+        size_ = std::min(size_ + 1, slots_.size());
+    }
+
+    const cv::Mat& at(size_t age) const {
+        static const cv::Mat none;
+        return age < size_ ? slots_[(newest_ + slots_.size() - age) % slots_.size()] : none;
+    }
+    const cv::Mat& newest() const { return at(0); }
+
+    // Keeps the newest min(size, capacity) frames
+    void setCapacity(size_t capacity) {
+        capacity = std::max<size_t>(1, capacity);
+        if (capacity == slots_.size()) return;
+        std::vector<cv::Mat> slots(capacity);
+        const size_t kept = std::min(size_, capacity);
+        for (size_t age = 0; age < kept; ++age) {
+            slots[kept - 1 - age] = slots_[(newest_ + slots_.size() - age) % slots_.size()];
+        }
+        slots_ = std::move(slots);
+        newest_ = (kept + capacity - 1) % capacity;
+        size_ = kept;
+    }
+
+    // Forget every frame; the buffers stay allocated for reuse
+    void clear() { size_ = 0; }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t capacity() const { return slots_.size(); }
+
+   private:
+    std::vector<cv::Mat> slots_;
+    size_t newest_ = 0;
+    size_t size_ = 0;
+};
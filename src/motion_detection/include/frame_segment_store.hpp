@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Where one stored image lives inside a segment file
+struct SegmentExtent {
+    std::string file;  // Segment file path
+    uint64_t offset = 0;
+    uint64_t length = 0;
+    std::string contentType;  // MIME type of the bytes; empty for JPEG
+
+    bool empty() const { return file.empty(); }
+};
+
+/**
+ * @brief What appended bytes do to the page cache
+ *
+ * - PageCache:  ordinary buffered writes; the kernel keeps the pages until memory runs short
+ * - DropBehind: buffered writes, flushed and dropped from the cache every dropBehindBytes
+ * - Direct:     O_DIRECT writes from an aligned staging buffer, never cached (DropBehind
+ *               where the file system refuses O_DIRECT)
+ */
+enum class SegmentCachePolicy { PageCache, DropBehind, Direct };
+
+/**
+ * @brief Parse a cache policy name ("page_cache", "drop_behind", "direct")
+ * @throws std::invalid_argument for unknown names
+ */
+inline SegmentCachePolicy parseSegmentCachePolicy(std::string name) {
+    std::transform(name.begin(), name.end(), name.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (name == "page_cache") return SegmentCachePolicy::PageCache;
+    if (name == "drop_behind") return SegmentCachePolicy::DropBehind;
+    if (name == "direct") return SegmentCachePolicy::Direct;
+    throw std::invalid_argument("Unknown segment cache policy: " + name);
+}
+
+inline const char* segmentCachePolicyName(SegmentCachePolicy policy) {
+    switch (policy) {
+        case SegmentCachePolicy::PageCache:
+            return "page_cache";
+        case SegmentCachePolicy::DropBehind:
+            return "drop_behind";
+        case SegmentCachePolicy::Direct:
+            return "direct";
+    }
+    return "unknown";
+}
+
+struct SegmentStoreConfig {
+    std::string directory = "data/frames/segments";
+    uint64_t segmentBytes = 256ull << 20;  // Start a new segment once the current one is this big
+    bool syncOnRoll = true;                // fdatasync a segment when it is closed
+    SegmentCachePolicy cachePolicy = SegmentCachePolicy::PageCache;
+    uint64_t dropBehindBytes = 8ull << 20;  // DropBehind: flush and drop the written range this often
+    size_t directBufferBytes = 1u << 20;    // Direct: staging buffer; larger images go in pieces
+};
+
+/**
+ * @brief Append-only store that packs many JPEGs into a few large segment files
+ *
+ * Instead of creating a file (and an inode, a directory entry and a journal update) per
+ * image, append() adds the bytes to the end of the current segment_<n>.seg and returns the
+ * extent to put into the frame's document. A new segment is started once the current one
+ * reaches segmentBytes. Readers open the segment and read the extent (mmap in Python, a
+ * ranged read stream in the web server); nothing in a segment is ever rewritten, so
+ * retention deletes whole segment files.
+ *
+ * A crash can leave a partly written image at the end of a segment; no document points at
+ * it, and appends after a restart continue behind it.
+ *
+ * On 1 GB devices the written images would otherwise fill the page cache and evict the
+ * pipeline's and the database's working sets; cachePolicy keeps them out of it. Direct
+ * writes whole blocks (offset, length and memory aligned to kDirectAlignment): the partial
+ * block at the end of the segment stays in the staging buffer and is written again, with
+ * the next image behind it, by the next append(). The zero padding behind the last image
+ * is truncated when the segment is closed.
+ *
+ * Thread safety: append() and read() may be called concurrently.
+ */
+class FrameSegmentStore {
+   public:
+    explicit FrameSegmentStore(const SegmentStoreConfig& config = SegmentStoreConfig());
+    ~FrameSegmentStore();
+
+    FrameSegmentStore(const FrameSegmentStore&) = delete;
+    FrameSegmentStore& operator=(const FrameSegmentStore&) = delete;
+
+    // Appends @p bytes to the current segment; an empty extent if the write failed
+    SegmentExtent append(const std::vector<unsigned char>& bytes);
+
+    // Reads an extent written by append() (from any FrameSegmentStore on the same directory)
+    static bool read(const SegmentExtent& extent, std::vector<unsigned char>& bytes);
+
+    const SegmentStoreConfig& config() const { return config_; }
+    // The policy in effect: Direct falls back to DropBehind where O_DIRECT is refused
+    SegmentCachePolicy cachePolicy() const { return policy_.load(); }
+
+    // O_DIRECT offset, length and buffer alignment (the largest common logical block size)
+    static constexpr size_t kDirectAlignment = 4096;
+
+   private:
+    struct AlignedFree {
+        void operator()(unsigned char* data) const;
+    };
+
+    bool openSegment(uint64_t index);
+    void closeSegment();
+    bool appendDirect(const unsigned char* data, size_t length, uint64_t offset);
+    bool loadDirectTail();
+    void dropBehind(bool all);
+
+    SegmentStoreConfig config_;
+    std::mutex mutex_;
+    int fd_ = -1;
+    uint64_t index_ = 0;  // Number of the open segment
+    std::string path_;    // Path of the open segment
+    uint64_t size_ = 0;   // Bytes in the open segment
+
+    std::atomic<SegmentCachePolicy> policy_;  // Changed under mutex_ only
+    uint64_t droppedUpTo_ = 0;                // DropBehind: start of the range still in the cache
+    // Direct: staging buffer holding the segment's partial last block at its start
+    std::unique_ptr<unsigned char, AlignedFree> staging_;
+    size_t stagingBytes_ = 0;
+};
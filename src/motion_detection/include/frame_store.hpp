@@ -0,0 +1,103 @@
+#pragma once
+
+#include <memory>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+#include "frame_file_storage.hpp"
+#include "frame_metadata.hpp"
+#include "motion_stats_aggregator.hpp"
+#include "persistence_backend.hpp"
+
+/**
+ * @brief Connection settings for the native frame store
+ */
+struct FrameStoreConfig {
+    std::string uri = "mongodb://localhost:27017";
+    std::string databaseName = "birds_of_play";
+    std::string collectionName = "captured_frames";  // Same collection as FrameDatabaseV2
+    std::string statsCollectionName = "motion_stats";  // Per-minute MotionMinuteSummary docs
+    std::string storagePath = "data/frames";
+    // Create a missing frame collection as a time-series collection (timestamp as timeField,
+    // "stream" = metadata.source as metaField); an existing collection keeps its type
+    bool timeSeries = true;
+    // Frame documents expire this many days after their timestamp through the server's TTL,
+    // and their image files with the hour partitions that hold them (0 = keep everything)
+    int retentionDays = 0;
+};
+
+/**
+ * @brief Native MongoDB frame writer (mongocxx), schema-compatible with FrameDatabaseV2
+ *
+ * Images are written by FrameFileStorage; metadata documents carry the same fields as
+ * frame_database_v2.py (_id uuid, image/thumbnail paths, shapes, dtypes, timestamp,
+ * created_at, metadata), so the Python readers and the web UI see no difference. Clients
+ * come from a mongocxx::pool, and no embedded interpreter or GIL is involved. This is the
+ * "native" PersistenceBackend; it is only built with ENABLE_MONGO.
+ *
+ * Retention needs no scan job. Documents carry a TTL (the time-series collection's
+ * expireAfterSeconds, or a TTL timestamp index on a regular collection), and once an hour
+ * the insert path unlinks the image partitions that have aged out. Time-series collections
+ * do not enforce a unique _id, so inserts into one first skip the frames already stored
+ * (a resend), which a regular collection reports as duplicate keys.
+ *
+ * Thread safety: call connect() once before use; all other methods may be called
+ * concurrently.
+ */
+class FrameStore : public PersistenceBackend {
+   public:
+    explicit FrameStore(const FrameStoreConfig& config = FrameStoreConfig());
+    ~FrameStore() override;
+
+    FrameStore(const FrameStore&) = delete;
+    FrameStore& operator=(const FrameStore&) = delete;
+
+    const char* name() const override { return "native"; }
+
+    /**
+     * @brief Create the client pool, ping the server, create the frame collection if missing
+     *        and ensure the FrameDatabaseV2 indexes and the retention TTL
+     * @return true if the server is reachable (the pool is kept either way for a valid URI)
+     */
+    bool connect() override;
+
+    // True once a client pool exists; individual inserts may still fail if the server is down
+    bool isConnected() const;
+
+    /**
+     * @brief Write both frames to disk and insert their metadata document
+     * @return Frame UUID, or an empty string on failure
+     */
+    std::string saveFrame(const cv::Mat& original, const cv::Mat& processed,
+                          const FrameMetadata& metadata);
+
+    /**
+     * @brief Insert documents for frames already written with fileStorage() (one insert_many)
+     *
+     * Files of records that fail to insert are removed.
+     * @return UUIDs of the inserted documents
+     */
+    std::vector<std::string> insertRecords(const std::vector<StoredFrameRecord>& records) override;
+
+    /**
+     * @brief Upsert one document per (source, minute) into the stats collection (one bulk write)
+     *
+     * Counters are added to an existing document for the same minute (a restart within the
+     * minute), maxima are kept, and percentiles and the mean describe the latest write.
+     * @return false if the write failed
+     */
+    bool upsertMotionSummaries(const std::vector<MotionMinuteSummary>& summaries) override;
+
+    const FrameFileStorage& fileStorage() const { return fileStorage_; }
+
+   private:
+    struct Impl;
+
+    // Unlink the image partitions past retentionDays, at most once per hour
+    void expirePartitions();
+
+    FrameStoreConfig config_;
+    FrameFileStorage fileStorage_;
+    std::unique_ptr<Impl> impl_;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Pipeline stages a frame passes through after capture, in order
+enum class TraceStage : size_t { DETECT, CONSOLIDATE, RENDER, COUNT };
+
+inline const char* traceStageName(TraceStage stage) {
+    static constexpr const char* kNames[] = {"detect", "consolidate", "render"};
+    static_assert(sizeof(kNames) / sizeof(kNames[0]) == static_cast<size_t>(TraceStage::COUNT),
+                  "one name per stage");
+    return kNames[static_cast<size_t>(stage)];
+}
+
+/**
+ * @brief Timestamps of one frame from capture to the pipeline output
+ *
+ * Stamped by whichever thread holds the frame: the capture thread sets the capture times,
+ * each stage its enter/exit pair (FrameTrace::Scope), and the consumer popping the output
+ * sets delivered. The frame moves between threads through the pipeline queues, so no
+ * field is ever written and read concurrently. Stamps are steady_clock reads; a stage the
+ * frame has not reached yet has default (zero) time points.
+ */
+struct FrameTrace {
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t kStageCount = static_cast<size_t>(TraceStage::COUNT);
+
+    Clock::time_point captured;
+    int64_t captureUnixUs = 0;       // Wall clock at capture (Unix microseconds)
+    double sourceTimestampMs = 0.0;  // Backend's own frame time: stream PTS or driver timestamp
+    std::array<Clock::time_point, kStageCount> entered{};
+    std::array<Clock::time_point, kStageCount> exited{};
+    Clock::time_point delivered;  // Popped from the pipeline output
+
+    // Stamps enter on construction and exit on destruction, across every return path
+    class Scope {
+       public:
+        Scope(FrameTrace& trace, TraceStage stage) : trace_(trace), index_(static_cast<size_t>(stage)) {
+            trace_.entered[index_] = Clock::now();
+        }
+        ~Scope() { trace_.exited[index_] = Clock::now(); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+       private:
+        FrameTrace& trace_;
+        size_t index_;
+    };
+
+    bool reached(TraceStage stage) const {
+        return exited[static_cast<size_t>(stage)] != Clock::time_point{};
+    }
+
+    // Time spent queued in front of a stage (since capture or the previous stage's exit)
+    double waitMs(TraceStage stage) const {
+        const size_t index = static_cast<size_t>(stage);
+        return milliseconds(index == 0 ? captured : exited[index - 1], entered[index]);
+    }
+
+    // Time spent running a stage
+    double runMs(TraceStage stage) const {
+        const size_t index = static_cast<size_t>(stage);
+        return milliseconds(entered[index], exited[index]);
+    }
+
+    // Capture to @p until (e.g. now, or delivered)
+    double sinceCaptureMs(Clock::time_point until) const { return milliseconds(captured, until); }
+
+    static double milliseconds(Clock::time_point from, Clock::time_point to) {
+        if (from == Clock::time_point{} || to < from) return 0.0;
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef BIRDS_HAVE_OPENGL
+#include <opencv2/core/opengl.hpp>
+#endif
+
+// What the local window draws over a frame, in frame pixels
+struct PreviewOverlay {
+    struct Box {
+        cv::Rect rect;
+        cv::Scalar color;  // BGR
+        int thickness = 1;
+    };
+    // Drawn like cv::putText with FONT_HERSHEY_SIMPLEX: @p origin is the baseline's left end
+    struct Text {
+        std::string text;
+        cv::Point origin;
+        cv::Scalar color;  // BGR
+        double fontScale = 0.5;
+        int thickness = 1;
+    };
+
+    std::vector<Box> boxes;
+    std::vector<Text> texts;  // Drawn above the boxes
+
+    void clear() {
+        boxes.clear();
+        texts.clear();
+    }
+};
+
+/**
+ * @brief Local preview window that draws the frame and its overlay with OpenGL
+ *
+ * The imshow path copies every frame, draws the boxes and labels into the copy on the CPU
+ * and has highgui scale it to the window. Here the frame is uploaded once as a texture
+ * (cv::ogl::Texture2D) and the GPU scales it; boxes are GL line loops drawn from the region
+ * list and labels are small textures rasterized once per distinct string and cached, so a
+ * frame costs one upload however large the window or busy the scene.
+ *
+ * Needs OpenCV built WITH_OPENGL and a GL context for the window: open() reports false
+ * (logged) otherwise, and the caller keeps the imshow path. Without BIRDS_HAVE_OPENGL
+ * (ENABLE_OPENGL_PREVIEW off or no OpenGL found) open() always reports false.
+ *
+ * Thread safety: GUI thread only, like every highgui call; the caller still pumps events
+ * with cv::waitKey().
+ */
+class GlPreviewWindow {
+   public:
+    explicit GlPreviewWindow(std::string title);
+    ~GlPreviewWindow();
+
+    GlPreviewWindow(const GlPreviewWindow&) = delete;
+    GlPreviewWindow& operator=(const GlPreviewWindow&) = delete;
+
+    /**
+     * @brief Create the OpenGL window
+     * @return false (and logs why) if this build or OpenCV has no OpenGL support
+     */
+    bool open();
+    bool isOpen() const { return open_; }
+
+    // Upload @p frame (8-bit gray or BGR) and redraw the window with @p overlay
+    void show(const cv::Mat& frame, const PreviewOverlay& overlay);
+
+    void close();
+
+    const std::string& title() const { return title_; }
+
+   private:
+#ifdef BIRDS_HAVE_OPENGL
+    struct Label {
+        cv::ogl::Texture2D texture;
+        cv::Size size;      // Texture size, in frame pixels
+        int baseline = 0;   // Rows below the text's baseline
+        uint64_t lastUsed = 0;
+    };
+
+    static void onDraw(void* self);
+    void draw();
+    Label& label(const PreviewOverlay::Text& text);
+    void evictLabels();
+
+    cv::ogl::Texture2D frameTexture_;
+    cv::Mat converted_;  // Gray frames expanded to BGR before the upload
+    std::unordered_map<std::string, Label> labels_;
+    cv::Size frameSize_;
+    PreviewOverlay overlay_;
+    uint64_t frames_ = 0;
+#endif
+    std::string title_;
+    bool open_ = false;
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <opencv2/core.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Still image formats the persistence stage can store
+ *
+ * JPEG is always available (JpegEncoder). WebP, AVIF and JPEG XL need libwebp, libavif
+ * (1.0+) and libjxl (0.9+) at build time (BIRDS_HAVE_WEBP, BIRDS_HAVE_AVIF, BIRDS_HAVE_JXL).
+ */
+enum class ImageCodec { Jpeg, WebP, Avif, JpegXl };
+
+/**
+ * @brief Parse a codec name ("jpeg"/"jpg", "webp", "avif", "jxl"/"jpegxl")
+ * @throws std::invalid_argument for unknown names
+ */
+inline ImageCodec parseImageCodec(std::string name) {
+    std::transform(name.begin(), name.end(), name.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (name == "jpeg" || name == "jpg") return ImageCodec::Jpeg;
+    if (name == "webp") return ImageCodec::WebP;
+    if (name == "avif") return ImageCodec::Avif;
+    if (name == "jxl" || name == "jpegxl") return ImageCodec::JpegXl;
+    throw std::invalid_argument("Unknown image codec: " + name);
+}
+
+inline const char* imageCodecName(ImageCodec codec) {
+    switch (codec) {
+        case ImageCodec::Jpeg:
+            return "jpeg";
+        case ImageCodec::WebP:
+            return "webp";
+        case ImageCodec::Avif:
+            return "avif";
+        case ImageCodec::JpegXl:
+            return "jxl";
+    }
+    return "unknown";
+}
+
+// File name extension, dot included
+inline const char* imageCodecExtension(ImageCodec codec) {
+    switch (codec) {
+        case ImageCodec::Jpeg:
+            return ".jpg";
+        case ImageCodec::WebP:
+            return ".webp";
+        case ImageCodec::Avif:
+            return ".avif";
+        case ImageCodec::JpegXl:
+            return ".jxl";
+    }
+    return ".jpg";
+}
+
+inline const char* imageCodecMimeType(ImageCodec codec) {
+    switch (codec) {
+        case ImageCodec::Jpeg:
+            return "image/jpeg";
+        case ImageCodec::WebP:
+            return "image/webp";
+        case ImageCodec::Avif:
+            return "image/avif";
+        case ImageCodec::JpegXl:
+            return "image/jxl";
+    }
+    return "application/octet-stream";
+}
+
+struct ImageEncodeSettings {
+    ImageCodec codec = ImageCodec::Jpeg;
+    int quality = 95;  // 1-100, mapped to each codec's own quality scale
+    // 1-9, higher = smaller files for more CPU: WebP method 0-6, AVIF speed 9-1, JPEG XL effort
+    // 1-9. JPEG ignores it (TurboJPEG always uses its fast DCT)
+    int effort = 3;
+};
+
+/**
+ * @brief Encodes 8-bit BGR and gray frames in any ImageCodec
+ *
+ * JPEG goes through JpegEncoder. The other codecs call their libraries directly with one
+ * encoder per call and a single thread each (the persistence stage already encodes the
+ * images of a frame in parallel); gray images are expanded to BGR for WebP and AVIF.
+ *
+ * recompressJpeg() turns a JPEG into a JPEG XL file without decoding it to pixels: the
+ * DCT coefficients are kept, so the result decodes back to the identical JPEG and is
+ * about 20% smaller. That suits the aggregator, which receives JPEG crops from the edges.
+ *
+ * Thread safety: every method may be called concurrently from any number of threads.
+ */
+class ImageEncoder {
+   public:
+    /**
+     * @brief Encode @p image into @p output (resized to the encoded size)
+     * @return false if the image is not CV_8UC1/CV_8UC3, the codec is not built in or the
+     *         encoder failed
+     */
+    static bool encode(const cv::Mat& image, const ImageEncodeSettings& settings, std::vector<unsigned char>& output);
+
+    // Whether @p codec was built in
+    static bool available(ImageCodec codec);
+
+    // Lossless JPEG to JPEG XL transcode; false without libjxl or for a broken JPEG
+    static bool recompressJpeg(const std::vector<unsigned char>& jpeg, std::vector<unsigned char>& output);
+
+    // Format of encoded bytes by their signature; false if none of the four matches
+    static bool detect(const std::vector<unsigned char>& bytes, ImageCodec& codec);
+};
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class IoReactor;
+
+/**
+ * @brief Fire-and-forget coroutine run by an IoReactor
+ *
+ * A function returning IoTask is a coroutine that starts suspended; IoReactor::spawn()
+ * takes it over and runs it on a reactor thread, and its frame frees itself when the body
+ * returns. An IoTask that is never spawned destroys the coroutine unstarted. Exceptions
+ * escaping the body are logged and swallowed, as in WorkStealingPool.
+ */
+class IoTask {
+   public:
+    struct promise_type {
+        std::atomic<size_t>* live = nullptr;  // IoReactor::liveTasks_ once spawned
+
+        ~promise_type() {
+            if (live) live->fetch_sub(1);
+        }
+        IoTask get_return_object() { return IoTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept;
+    };
+
+    IoTask(IoTask&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    IoTask& operator=(IoTask&& other) noexcept {
+        if (this != &other) {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    ~IoTask() {
+        if (handle_) handle_.destroy();
+    }
+
+   private:
+    friend class IoReactor;
+    explicit IoTask(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+struct IoReactorStats {
+    uint64_t spawned = 0;   // Tasks handed to spawn()
+    size_t live = 0;        // Spawned tasks whose body has not returned yet
+    uint64_t waits = 0;     // Suspensions on a descriptor or a timer
+    uint64_t timeouts = 0;  // Descriptor waits that ran out of time
+};
+
+/**
+ * @brief Runs I/O-bound coroutines on a few threads around one epoll instance
+ *
+ * Network servers and other I/O-bound components that would otherwise keep a thread each,
+ * blocked in poll(), accept() or recv() most of the time, run as IoTask coroutines here
+ * instead: a task co_awaits readable(fd), writable(fd) or sleepFor(), and whichever reactor
+ * thread sees the descriptor become ready (or the deadline pass) resumes it. A handful of
+ * threads then serve every connection of every such component. CPU work stays on the
+ * WorkStealingPool; a task must not block, and hands anything heavier than building a
+ * short reply to the pool.
+ *
+ * Descriptors must be non-blocking, and a descriptor has at most one wait at a time
+ * (readable or writable, not both). Waits are one-shot (EPOLLONESHOT), so two threads never
+ * resume the same task. Awaits return false when they time out or are cancelled: by
+ * cancel(fd), which the owner calls before closing a descriptor some task may be waiting
+ * on, or by stop(). Once stopping, awaits return false without suspending, so tasks run to
+ * their end; stop() resumes the tasks still waiting and returns when none is left waiting.
+ *
+ * Linux only (epoll and eventfd); start() fails elsewhere and callers keep their own
+ * threads.
+ *
+ * Thread safety: start() and stop() from the owning thread; spawn(), cancel(), stats() and
+ * the awaitables from any thread, including reactor threads.
+ */
+class IoReactor {
+   public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr Clock::duration kNoTimeout = Clock::duration::max();
+
+    // threadCount 0 = 1; I/O-bound tasks rarely need more than a couple of threads
+    explicit IoReactor(size_t threadCount = 1);
+    ~IoReactor();
+
+    IoReactor(const IoReactor&) = delete;
+    IoReactor& operator=(const IoReactor&) = delete;
+
+    /**
+     * @brief Create the epoll instance and start the threads
+     * @return false (and logs why) without epoll
+     */
+    bool start();
+
+    // Cancel every wait, let the tasks run to their end and join the threads
+    void stop();
+
+    bool isRunning() const { return running_.load(); }
+    // From stop() on: awaits no longer suspend, so loops over them must check this
+    bool stopping() const { return stopping_.load(); }
+    size_t threadCount() const { return threadCount_; }
+
+    // Run @p task on a reactor thread; false (the task destroyed unstarted) if not running
+    bool spawn(IoTask task);
+
+    // Wake the wait on @p fd, if any, with false
+    void cancel(int fd);
+
+    IoReactorStats stats() const;
+
+    // co_await: true once @p fd is readable (or writable), false on timeout or cancellation
+    class FdWait {
+       public:
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> handle) {
+            return reactor_.addWait(handle, fd_, events_, timeout_, &result_);
+        }
+        bool await_resume() const noexcept { return result_; }
+
+       private:
+        friend class IoReactor;
+        FdWait(IoReactor& reactor, int fd, uint32_t events, Clock::duration timeout)
+            : reactor_(reactor), fd_(fd), events_(events), timeout_(timeout) {}
+
+        IoReactor& reactor_;
+        const int fd_;
+        const uint32_t events_;
+        const Clock::duration timeout_;
+        bool result_ = false;
+    };
+    FdWait readable(int fd, Clock::duration timeout = kNoTimeout);
+    FdWait writable(int fd, Clock::duration timeout = kNoTimeout);
+
+    // co_await: true after @p duration, false if the reactor stops first
+    FdWait sleepFor(Clock::duration duration) { return FdWait(*this, -1, 0, duration); }
+
+    // co_await: continues on a reactor thread (inline when stopping)
+    class Schedule {
+       public:
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> handle) { return reactor_.post(handle); }
+        void await_resume() const noexcept {}
+
+       private:
+        friend class IoReactor;
+        explicit Schedule(IoReactor& reactor) : reactor_(reactor) {}
+        IoReactor& reactor_;
+    };
+    Schedule schedule() { return Schedule(*this); }
+
+   private:
+    struct Wait {
+        std::coroutine_handle<> handle;
+        int fd = -1;  // -1 = timer only
+        bool* result = nullptr;
+        std::multimap<Clock::time_point, uint64_t>::iterator deadline;
+        bool hasDeadline = false;
+    };
+
+    // False (with *result false) when stopping or the descriptor cannot be watched
+    bool addWait(std::coroutine_handle<> handle, int fd, uint32_t events, Clock::duration timeout, bool* result);
+    bool post(std::coroutine_handle<> handle);
+    // Removes wait @p id and returns its handle with *result set (null if already gone)
+    std::coroutine_handle<> complete(uint64_t id, bool ready, bool timedOut = false);
+    void run(size_t index);
+    void wake();
+    int nextTimeoutMs() const;
+    void drain();
+
+    const size_t threadCount_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> stopping_{false};
+    int epollFd_ = -1;
+    int wakeFd_ = -1;
+    std::vector<std::thread> threads_;
+
+    mutable std::mutex mutex_;
+    uint64_t nextWaitId_ = 1;  // 0 is the wake descriptor
+    std::unordered_map<uint64_t, Wait> waits_;
+    std::multimap<Clock::time_point, uint64_t> deadlines_;
+    std::deque<std::coroutine_handle<>> ready_;
+
+    std::atomic<uint64_t> spawned_{0};
+    std::atomic<size_t> liveTasks_{0};
+    std::atomic<uint64_t> waitCount_{0};
+    std::atomic<uint64_t> timeouts_{0};
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+/**
+ * @brief JPEG encoder for 8-bit BGR and gray frames
+ *
+ * Uses TurboJPEG directly when the build found libturbojpeg (BIRDS_HAVE_TURBOJPEG): one
+ * compressor handle per thread is kept alive and reused, and the output buffer is reused
+ * across calls. Otherwise the frame goes through cv::imencode, which is libjpeg-turbo in
+ * most OpenCV builds anyway but pays for its generic codec setup on every call.
+ *
+ * Thread safety: encode() may be called concurrently from any number of threads.
+ */
+class JpegEncoder {
+   public:
+    /**
+     * @brief Encode @p image at @p quality (1-100) into @p output (resized to the JPEG size)
+     * @return false if the image is not CV_8UC1/CV_8UC3 or the encoder failed
+     */
+    static bool encode(const cv::Mat& image, int quality, std::vector<unsigned char>& output);
+
+    // "turbojpeg" or "opencv"
+    static const char* backendName();
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+/**
+ * @brief Decodes only the parts of a stored JPEG that cover given regions
+ *
+ * Cropping regions out of an archived frame used to mean decoding the whole frame at full
+ * resolution. With TurboJPEG (BIRDS_HAVE_TURBOJPEG) every region is first cut out losslessly
+ * in one tjTransform pass, rounded out to the MCU grid, so only the MCU rows and columns
+ * covering a region are ever run through the IDCT. Each cut-out is then decoded with DCT
+ * scaling (1/2, 1/4 or 1/8) when the caller does not need full resolution.
+ *
+ * Without TurboJPEG the frame is decoded once through cv::imdecode at the finest scale any
+ * region needs (OpenCV's reduced decode uses the same DCT scaling) and the regions are cut
+ * from that.
+ *
+ * Thread safety: every method may be called concurrently from any number of threads.
+ */
+class JpegRegionDecoder {
+   public:
+    /**
+     * @brief Decode the @p regions of @p jpeg as BGR images, one per region in order
+     *
+     * Regions are clipped to the image; one that falls entirely outside it yields an empty
+     * Mat. Each region is decoded at scaleDenominator(region size, @p targetSide), so its
+     * image is about ceil(width / d) x ceil(height / d).
+     *
+     * @param targetSide Smallest longer side the caller needs (e.g. the classifier input); 0
+     *        decodes every region at full resolution
+     * @return false if the bytes are not a JPEG the decoder can read
+     */
+    static bool decode(const std::vector<unsigned char>& jpeg, const std::vector<cv::Rect>& regions, int targetSide,
+                       std::vector<cv::Mat>& images);
+
+    /**
+     * @brief Coarsest DCT scale (1, 2, 4 or 8) that keeps the longer side of a @p region
+     *        at or above @p targetSide; 1 when @p targetSide is 0 or larger than the region
+     */
+    static int scaleDenominator(cv::Size region, int targetSide);
+
+    // "turbojpeg" or "opencv"
+    static const char* backendName();
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/**
+ * @brief Lock-free latency histogram with fixed millisecond buckets
+ *
+ * Buckets are upper bounds (1, 2, 5, 10, ... 2000 ms) plus an overflow bucket, which is
+ * coarse but cheap enough to record on every frame from any thread.
+ *
+ * Thread safety: record() and all readers may be called concurrently.
+ */
+class LatencyHistogram {
+   public:
+    static constexpr size_t kBucketCount = 12;
+
+    // Upper bound of each bucket in milliseconds; the last bucket catches everything else
+    static constexpr std::array<double, kBucketCount - 1> kBucketBoundsMs = {
+        1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000};
+
+    void record(double milliseconds) {
+        size_t bucket = 0;
+        while (bucket < kBucketBoundsMs.size() && milliseconds > kBucketBoundsMs[bucket]) {
+            ++bucket;
+        }
+        buckets_[bucket]++;
+        count_++;
+        uint64_t micros = static_cast<uint64_t>(milliseconds * 1000.0);
+        totalMicros_ += micros;
+        uint64_t previous = maxMicros_.load();
+        while (micros > previous && !maxMicros_.compare_exchange_weak(previous, micros)) {
+        }
+    }
+
+    template <typename Rep, typename Period>
+    void record(const std::chrono::duration<Rep, Period>& duration) {
+        record(std::chrono::duration<double, std::milli>(duration).count());
+    }
+
+    uint64_t count() const { return count_.load(); }
+    uint64_t bucketCount(size_t bucket) const { return buckets_[bucket].load(); }
+
+    double meanMs() const {
+        uint64_t n = count_.load();
+        return n ? static_cast<double>(totalMicros_.load()) / 1000.0 / static_cast<double>(n) : 0.0;
+    }
+
+    double maxMs() const { return static_cast<double>(maxMicros_.load()) / 1000.0; }
+
+    /**
+     * @brief Approximate percentile, reported as the upper bound of the bucket containing it
+     * @param fraction Percentile in [0, 1] (e.g. 0.95)
+     */
+    double percentileMs(double fraction) const {
+        uint64_t n = count_.load();
+        if (n == 0) return 0.0;
+        uint64_t target = static_cast<uint64_t>(fraction * static_cast<double>(n));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBucketBoundsMs.size(); ++i) {
+            seen += buckets_[i].load();
+            if (seen > target) return kBucketBoundsMs[i];
+        }
+        return maxMs();
+    }
+
+    // One-line summary, e.g. "n=42 mean=3.1ms p50<=5ms p95<=20ms max=17.8ms"
+    std::string summary() const {
+        char buffer[128];
+        std::snprintf(buffer, sizeof(buffer), "n=%llu mean=%.1fms p50<=%gms p95<=%gms max=%.1fms",
+                      static_cast<unsigned long long>(count()), meanMs(), percentileMs(0.5),
+                      percentileMs(0.95), maxMs());
+        return buffer;
+    }
+
+   private:
+    std::array<std::atomic<uint64_t>, kBucketCount> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> totalMicros_{0};
+    std::atomic<uint64_t> maxMicros_{0};
+};
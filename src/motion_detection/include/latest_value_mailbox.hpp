@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include "profiler_zones.hpp"
+
+/**
+ * @brief Single-slot mailbox that only ever holds the newest value
+ *
+ * For a live camera, bounded staleness matters more than processing every frame: the
+ * capture thread publish()es every frame it reads, and the consumer take()s the freshest
+ * one whenever it is ready. A value published before the previous one was taken replaces
+ * it; overwrittenCount() counts those frames that were never processed.
+ *
+ * A lock-free triple buffer: the writer fills its own back slot and swaps it with the
+ * shared middle slot in one atomic exchange, the reader swaps its front slot with the
+ * middle one when that holds a fresh value. Neither side waits for the other or copies a
+ * value, and no memory is allocated after construction. The mutex and condition variable
+ * are only used to put an idle reader to sleep (wait(), waitFor()); publish() touches them
+ * only while a reader is asleep.
+ *
+ * Thread safety: one writer thread (publish(), close()) and one reader thread (take(),
+ * wait(), waitFor()); the counters and close() from any thread.
+ */
+template <typename T>
+class LatestValueMailbox {
+   public:
+    LatestValueMailbox() = default;
+    LatestValueMailbox(const LatestValueMailbox&) = delete;
+    LatestValueMailbox& operator=(const LatestValueMailbox&) = delete;
+
+    // Make @p value the newest; a value still waiting for the reader is dropped (and counted)
+    void publish(T value) {
+        slots_[back_] = std::move(value);
+        const uint8_t previous = middle_.exchange(static_cast<uint8_t>(back_ | kFresh));
+        back_ = previous & kIndexMask;
+        if (previous & kFresh) {
+            overwritten_.fetch_add(1, std::memory_order_relaxed);
+            slots_[back_] = T();  // Release what the stale value holds (a pooled frame buffer) now
+        }
+        published_.fetch_add(1, std::memory_order_relaxed);
+        if (sleepers_.load() > 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            wakeup_.notify_one();
+        }
+    }
+
+    // The newest value if one arrived since the last take(); never blocks
+    std::optional<T> take() {
+        if (!(middle_.load() & kFresh)) return std::nullopt;
+        front_ = middle_.exchange(front_) & kIndexMask;
+        taken_.fetch_add(1, std::memory_order_relaxed);
+        return std::move(slots_[front_]);
+    }
+
+    // The newest value, waiting for one; nullopt once closed with nothing left to take
+    std::optional<T> wait() {
+        for (;;) {
+            if (auto value = take()) return value;
+            if (closed_.load()) return take();
+            sleepUntilFreshOrClosed(nullptr);
+        }
+    }
+
+    // Like wait(), but also nullopt after @p timeout; isClosed() tells the two apart
+    template <typename Rep, typename Period>
+    std::optional<T> waitFor(const std::chrono::duration<Rep, Period>& timeout) {
+        if (auto value = take()) return value;
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        sleepUntilFreshOrClosed(&deadline);
+        return take();
+    }
+
+    // End of stream: wakes the reader, which still gets the last published value
+    void close() {
+        closed_.store(true);
+        std::lock_guard<std::mutex> lock(mutex_);
+        wakeup_.notify_all();
+    }
+
+    bool isClosed() const { return closed_.load(); }
+
+    uint64_t publishedCount() const { return published_.load(std::memory_order_relaxed); }
+    uint64_t takenCount() const { return taken_.load(std::memory_order_relaxed); }
+    // Values replaced before the reader took them (frames skipped to stay current)
+    uint64_t overwrittenCount() const { return overwritten_.load(std::memory_order_relaxed); }
+
+   private:
+    static constexpr uint8_t kIndexMask = 0x3;
+    static constexpr uint8_t kFresh = 0x4;
+
+    void sleepUntilFreshOrClosed(const std::chrono::steady_clock::time_point* deadline) {
+        PROFILE_ZONE("wait:latest_frame");
+        std::unique_lock<std::mutex> lock(mutex_);
+        // Announced before the check, so a publish() between the check and the sleep notifies
+        sleepers_.fetch_add(1);
+        const auto ready = [this] { return (middle_.load() & kFresh) || closed_.load(); };
+        if (deadline) {
+            wakeup_.wait_until(lock, *deadline, ready);
+        } else {
+            wakeup_.wait(lock, ready);
+        }
+        sleepers_.fetch_sub(1);
+    }
+
+    std::array<T, 3> slots_{};
+    uint8_t back_ = 0;                 // Writer's slot
+    std::atomic<uint8_t> middle_{1};   // Shared slot index, kFresh while it holds an untaken value
+    uint8_t front_ = 2;                // Reader's slot
+
+    std::atomic<bool> closed_{false};
+    std::atomic<int> sleepers_{0};
+    std::mutex mutex_;
+    std::condition_variable wakeup_;
+
+    std::atomic<uint64_t> published_{0};
+    std::atomic<uint64_t> taken_{0};
+    std::atomic<uint64_t> overwritten_{0};
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct LoadSheddingConfig {
+    bool enabled = false;
+    double frameIntervalMs = 1000.0 / 30.0;  // Time budget per frame of one stream (1000 / fps)
+    double overloadRatio = 0.9;   // Shed once processing needs this share of the budget
+    double recoverRatio = 0.6;    // Give a step back once it is below this share
+    int maxStride = 4;            // Quiet streams process at least every maxStride-th frame
+    double minScaleFactor = 0.5;  // Last step: detection_scale multiplied by this
+    int activeHoldFrames = 30;    // Processed frames a stream stays "active" after a region
+    int adjustIntervalFrames = 15;  // Processed frames between two shedding steps
+    double smoothing = 0.1;       // EWMA weight of the newest processing time
+};
+
+/**
+ * @brief Adaptive load shedding across streams when processing cannot keep up
+ *
+ * Tracks a smoothed processing time per stream and compares what all streams need per frame
+ * interval (time per frame / stride, summed) against what the workers can provide. When the
+ * estimate stays above overloadRatio, a quiet stream (no consolidated regions for
+ * activeHoldFrames) is moved one step down a ladder: every 2nd frame, every 3rd, ... up to
+ * maxStride, and finally detection at minScaleFactor of its configured detection_scale. The
+ * quiet stream at the lowest step goes first, so load is spread before any stream is cut
+ * hard. Below recoverRatio the most reduced stream gets a step back.
+ *
+ * A stream with active regions is put back to full rate and scale at once and never shed,
+ * so birds in view are followed at full rate; a reduced stream still sees every
+ * stride-th frame, which is how motion on it gets noticed.
+ *
+ * Steps are taken at most once per adjustIntervalFrames processed frames so that the
+ * smoothed times reflect the previous step before the next one.
+ *
+ * Thread safety: all methods may be called concurrently (one mutex, a few updates per frame).
+ */
+class LoadShedder {
+   public:
+    struct StreamRate {
+        double processingFps = 0.0;   // Frames processed per second over the last second
+        double processingMs = 0.0;    // Smoothed processing time per frame
+        int stride = 1;               // Processing every stride-th frame
+        double scaleFactor = 1.0;     // Multiplier on the stream's detection_scale
+        bool active = false;          // Consolidated regions within activeHoldFrames
+        uint64_t processed = 0;
+        uint64_t skipped = 0;         // Frames shed by the stride
+    };
+
+    /**
+     * @param workers Threads that process frames concurrently (the budget is workers
+     *                frame intervals per interval)
+     */
+    explicit LoadShedder(const LoadSheddingConfig& config = LoadSheddingConfig(),
+                         size_t workers = 1);
+
+    // Register a stream; returns its index
+    size_t addStream();
+
+    // Forget a stream that stopped (e.g. moved to another node): it no longer counts as load
+    void resetStream(size_t stream);
+
+    /**
+     * @brief Capture side: whether the next frame of @p stream should be processed (false = skip it)
+     * @param frames Source frames the offered frame stands for: 1 plus those a decoder already
+     *               left out ahead of it (CaptureSource::setDecodeStride), counted as shed
+     */
+    bool shouldProcess(size_t stream, uint64_t frames = 1);
+
+    /**
+     * @brief Report a processed frame: its processing time and whether it had regions
+     *
+     * Also the point where shedding steps are taken.
+     */
+    void recordProcessed(
+        size_t stream, double processingMs, bool active,
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    // Multiplier to apply to the stream's detection_scale (1 = as configured)
+    double scaleFactor(size_t stream) const;
+
+    StreamRate rate(size_t stream) const;
+    size_t streamCount() const;
+
+    // Estimated share of the processing budget in use (1 = exactly keeping up)
+    double utilization() const;
+
+    const LoadSheddingConfig& config() const { return config_; }
+
+   private:
+    struct Stream {
+        int level = 0;  // Step on the shedding ladder (0 = full rate and scale)
+        double processingMs = 0.0;
+        bool sampled = false;  // processingMs holds a measurement
+        uint64_t processed = 0;
+        uint64_t skipped = 0;
+        uint64_t sinceProcessed = 0;  // Frames offered since the last processed one
+        uint64_t lastActive = 0;      // processed count at the last frame with regions
+        bool everActive = false;
+        // Processing rate over one-second windows
+        std::chrono::steady_clock::time_point windowStart;
+        uint64_t windowProcessed = 0;
+        double processingFps = 0.0;
+    };
+
+    int stride(const Stream& stream) const;
+    double scaleFactor(const Stream& stream) const;
+    bool isActive(const Stream& stream) const;
+    double utilizationLocked() const;
+    void adjustLocked();
+
+    LoadSheddingConfig config_;
+    const size_t workers_;
+    const int maxLevel_;  // maxStride - 1 stride steps, plus the scale step
+    mutable std::mutex mutex_;
+    std::vector<Stream> streams_;
+    uint64_t sinceAdjust_ = 0;  // Processed frames (all streams) since the last step
+};
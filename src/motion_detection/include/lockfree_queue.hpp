@@ -0,0 +1,495 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "bounded_queue.hpp"
+#include "profiler_zones.hpp"
+
+// ENABLE_LOCKFREE_QUEUES in CMake defines BIRDS_LOCKFREE_QUEUES=1: the stage-to-stage links of
+// StagedPipeline and the persistence queue then use LockFreeQueue instead of BoundedQueue
+#ifndef BIRDS_LOCKFREE_QUEUES
+#define BIRDS_LOCKFREE_QUEUES 0
+#endif
+
+// Indices written by different threads live on separate lines so producers and consumers
+// never invalidate each other's cache (false sharing)
+constexpr size_t kCacheLineSize = 64;
+
+/**
+ * @brief Snapshot of a lock-free ring's fill level and traffic
+ */
+struct QueueOccupancy {
+    size_t depth = 0;          // Items waiting
+    size_t capacity = 0;
+    size_t highWatermark = 0;  // Deepest the ring has been
+    uint64_t pushed = 0;       // Items accepted since construction
+    uint64_t popped = 0;       // Items consumed since construction
+};
+
+namespace lockfree_detail {
+
+inline size_t roundUpToPowerOfTwo(size_t value) {
+    size_t rounded = 1;
+    while (rounded < value) rounded <<= 1;
+    return rounded;
+}
+
+// Relaxed max; the watermark is monitoring data, so a lost race only delays an update
+inline void raiseWatermark(std::atomic<size_t>& watermark, size_t depth) {
+    size_t current = watermark.load(std::memory_order_relaxed);
+    while (depth > current &&
+           !watermark.compare_exchange_weak(current, depth, std::memory_order_relaxed)) {
+    }
+}
+
+}  // namespace lockfree_detail
+
+/**
+ * @brief Bounded lock-free single-producer/single-consumer ring
+ *
+ * For a fixed link between two threads (one stage feeding the next). The producer owns
+ * tail_, the consumer owns head_; each keeps a cached copy of the other's index and only
+ * reloads it when the ring looks full (or empty), so the common case touches no shared
+ * cache line but the slot itself. popBatch() takes everything available with one index
+ * load and one index store.
+ *
+ * Thread safety: tryPush() from one thread and tryPop()/popBatch() from one (other) thread.
+ * size(), capacity() and occupancy() may be called from anywhere.
+ *
+ * @tparam T Movable item; default-constructible (slots are preallocated)
+ */
+template <typename T>
+class SpscRing {
+   public:
+    // @p capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity)
+        : mask_(lockfree_detail::roundUpToPowerOfTwo(std::max<size_t>(1, capacity)) - 1),
+          slots_(new T[mask_ + 1]) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Moves @p item in and returns true, or returns false (item untouched) when full
+    bool tryPush(T&& item) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cachedHead_ > mask_) {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if (tail - cachedHead_ > mask_) return false;
+        }
+        slots_[tail & mask_] = std::move(item);
+        tail_.store(tail + 1, std::memory_order_release);
+        // cachedHead_ trails the consumer and overstates the depth; refresh it only when the
+        // estimate would raise the watermark, which after warm-up is every few pushes at most
+        if (tail + 1 - cachedHead_ > highWatermark_.load(std::memory_order_relaxed)) {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            lockfree_detail::raiseWatermark(highWatermark_, tail + 1 - cachedHead_);
+        }
+        return true;
+    }
+
+    bool tryPop(T& item) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cachedTail_) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if (head == cachedTail_) return false;
+        }
+        item = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Append up to @p maxItems to @p items; returns how many were taken
+    size_t popBatch(std::vector<T>& items, size_t maxItems) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        cachedTail_ = tail_.load(std::memory_order_acquire);
+        const size_t count = std::min(cachedTail_ - head, maxItems);
+        for (size_t i = 0; i < count; ++i) items.push_back(std::move(slots_[(head + i) & mask_]));
+        if (count > 0) head_.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    size_t size() const {
+        const size_t head = head_.load(std::memory_order_acquire);
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        return tail >= head ? tail - head : 0;  // Loaded in sequence, so tail may trail head
+    }
+
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return mask_ + 1; }
+
+    QueueOccupancy occupancy() const {
+        QueueOccupancy occupancy;
+        occupancy.popped = head_.load(std::memory_order_acquire);
+        occupancy.pushed = tail_.load(std::memory_order_acquire);
+        occupancy.depth = occupancy.pushed >= occupancy.popped
+                              ? static_cast<size_t>(occupancy.pushed - occupancy.popped)
+                              : 0;
+        occupancy.capacity = capacity();
+        occupancy.highWatermark = highWatermark_.load(std::memory_order_relaxed);
+        return occupancy;
+    }
+
+   private:
+    // Consumer line: its index and its view of the producer's
+    alignas(kCacheLineSize) std::atomic<size_t> head_{0};
+    size_t cachedTail_ = 0;
+    // Producer line
+    alignas(kCacheLineSize) std::atomic<size_t> tail_{0};
+    size_t cachedHead_ = 0;
+    std::atomic<size_t> highWatermark_{0};
+    // Read-only after construction
+    alignas(kCacheLineSize) const size_t mask_;
+    const std::unique_ptr<T[]> slots_;
+};
+
+/**
+ * @brief Bounded lock-free multi-producer/multi-consumer ring
+ *
+ * For queues shared by several producers or consumers (the persistence worker, links whose
+ * producer also evicts). Each slot carries a sequence number that says whose turn it is:
+ * a producer claims the slot at enqueuePos_ once its sequence equals the position, a
+ * consumer claims the slot at dequeuePos_ once it equals the position + 1, and a single CAS
+ * on the padded position settles races between threads on the same side.
+ *
+ * Thread safety: every method may be called from any thread.
+ *
+ * @tparam T Movable item; default-constructible (slots are preallocated)
+ */
+template <typename T>
+class MpmcRing {
+   public:
+    // @p capacity is rounded up to a power of two
+    explicit MpmcRing(size_t capacity)
+        : mask_(lockfree_detail::roundUpToPowerOfTwo(std::max<size_t>(1, capacity)) - 1),
+          cells_(new Cell[mask_ + 1]) {
+        for (size_t i = 0; i <= mask_; ++i) cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpmcRing(const MpmcRing&) = delete;
+    MpmcRing& operator=(const MpmcRing&) = delete;
+
+    // Moves @p item in and returns true, or returns false (item untouched) when full
+    bool tryPush(T&& item) {
+        size_t position = enqueuePos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells_[position & mask_];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const auto lag = static_cast<std::ptrdiff_t>(sequence - position);
+            if (lag == 0) {
+                if (enqueuePos_.compare_exchange_weak(position, position + 1,
+                                                      std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (lag < 0) {
+                return false;  // The slot still holds an item from the previous lap
+            } else {
+                position = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(item);
+        cell->sequence.store(position + 1, std::memory_order_release);
+        const size_t popped = dequeuePos_.load(std::memory_order_relaxed);
+        if (popped <= position) {
+            lockfree_detail::raiseWatermark(highWatermark_, position + 1 - popped);
+        }
+        return true;
+    }
+
+    bool tryPop(T& item) {
+        size_t position = dequeuePos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells_[position & mask_];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const auto lag = static_cast<std::ptrdiff_t>(sequence - (position + 1));
+            if (lag == 0) {
+                if (dequeuePos_.compare_exchange_weak(position, position + 1,
+                                                      std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (lag < 0) {
+                return false;  // Empty (or the producer of this slot has not finished)
+            } else {
+                position = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        item = std::move(cell->value);
+        cell->sequence.store(position + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Append up to @p maxItems to @p items; returns how many were taken. Slots are claimed
+    // one at a time, so other consumers may interleave with the batch
+    size_t popBatch(std::vector<T>& items, size_t maxItems) {
+        size_t count = 0;
+        T item;
+        while (count < maxItems && tryPop(item)) {
+            items.push_back(std::move(item));
+            ++count;
+        }
+        return count;
+    }
+
+    size_t size() const {
+        const size_t popped = dequeuePos_.load(std::memory_order_acquire);
+        const size_t pushed = enqueuePos_.load(std::memory_order_acquire);
+        return pushed >= popped ? std::min(pushed - popped, capacity()) : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return mask_ + 1; }
+
+    QueueOccupancy occupancy() const {
+        QueueOccupancy occupancy;
+        occupancy.popped = dequeuePos_.load(std::memory_order_acquire);
+        occupancy.pushed = enqueuePos_.load(std::memory_order_acquire);
+        occupancy.depth = size();
+        occupancy.capacity = capacity();
+        occupancy.highWatermark = highWatermark_.load(std::memory_order_relaxed);
+        return occupancy;
+    }
+
+   private:
+    struct Cell {
+        std::atomic<size_t> sequence{0};
+        T value{};
+    };
+
+    alignas(kCacheLineSize) std::atomic<size_t> enqueuePos_{0};
+    alignas(kCacheLineSize) std::atomic<size_t> dequeuePos_{0};
+    alignas(kCacheLineSize) std::atomic<size_t> highWatermark_{0};
+    alignas(kCacheLineSize) const size_t mask_;
+    const std::unique_ptr<Cell[]> cells_;
+};
+
+// Who pushes to and pops from a LockFreeQueue
+enum class QueueLink {
+    Shared,  // Any number of producers and consumers (MpmcRing)
+    Fixed    // One producer thread and one consumer thread (SpscRing)
+};
+
+/**
+ * @brief Lock-free ring with BoundedQueue's interface: blocking pop, close and backpressure
+ *
+ * Items move through an SpscRing (QueueLink::Fixed) or an MpmcRing (QueueLink::Shared)
+ * without a lock. A thread that finds nothing to do yields for a few rounds and then parks
+ * on a condition variable; the other side only takes that mutex when a thread is parked,
+ * so a busy link never touches it. DropOldest needs the producer to evict, which makes it
+ * a second consumer, so such links always use the MpmcRing.
+ *
+ * Capacity is rounded up to a power of two. close() must not race with push() from another
+ * thread if every item pushed before it has to be popped (StagedPipeline closes each link
+ * from its producer); stop-style closes that abandon the queue are fine.
+ *
+ * Thread safety: as BoundedQueue for QueueLink::Shared; with QueueLink::Fixed, push() from
+ * one thread and pop()/popFor()/popBatch() from one thread.
+ */
+template <typename T>
+class LockFreeQueue {
+   public:
+    LockFreeQueue(size_t capacity, BackpressurePolicy policy = BackpressurePolicy::Block,
+                  QueueLink link = QueueLink::Shared)
+        : policy_(policy) {
+        if (link == QueueLink::Fixed && policy != BackpressurePolicy::DropOldest) {
+            spsc_ = std::make_unique<SpscRing<T>>(capacity);
+        } else {
+            mpmc_ = std::make_unique<MpmcRing<T>>(capacity);
+        }
+    }
+
+    LockFreeQueue(const LockFreeQueue&) = delete;
+    LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+    /**
+     * @brief Enqueue an item, applying the backpressure policy when full
+     * @return false if the item was rejected (queue closed or DropNewest on a full queue)
+     */
+    bool push(T item) {
+        if (closed_.load(std::memory_order_acquire)) return false;
+        for (int attempt = 0; !tryPush(item); ++attempt) {
+            switch (policy_) {
+                case BackpressurePolicy::Block:
+                    if (attempt < kYieldRounds) {
+                        std::this_thread::yield();
+                    } else {
+                        PROFILE_ZONE("wait:queue_full");
+                        notFull_.wait([this] { return isClosed() || !full(); });
+                    }
+                    if (isClosed()) return false;
+                    break;
+                case BackpressurePolicy::DropOldest: {
+                    T oldest;
+                    if (mpmc_->tryPop(oldest)) {
+                        dropped_.fetch_add(1, std::memory_order_relaxed);
+                        notFull_.notify();
+                    }
+                    break;
+                }
+                case BackpressurePolicy::DropNewest:
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+            }
+        }
+        notEmpty_.notify();
+        return true;
+    }
+
+    /**
+     * @brief Dequeue the next item, blocking until one is available
+     * @return std::nullopt once the queue is closed and drained
+     */
+    std::optional<T> pop() {
+        return popUntil(std::chrono::steady_clock::time_point::max());
+    }
+
+    /**
+     * @brief Dequeue the next item, waiting at most @p timeout
+     * @return std::nullopt on timeout or once the queue is closed and drained
+     */
+    template <typename Rep, typename Period>
+    std::optional<T> popFor(const std::chrono::duration<Rep, Period>& timeout) {
+        return popUntil(std::chrono::steady_clock::now() +
+                        std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout));
+    }
+
+    // Append whatever is queued, up to @p maxItems, without waiting; returns the count
+    size_t popBatch(std::vector<T>& items, size_t maxItems) {
+        const size_t count =
+            spsc_ ? spsc_->popBatch(items, maxItems) : mpmc_->popBatch(items, maxItems);
+        if (count > 0) notFull_.notify();
+        return count;
+    }
+
+    void close() {
+        closed_.store(true, std::memory_order_release);
+        notEmpty_.notifyAll();
+        notFull_.notifyAll();
+    }
+
+    bool isClosed() const { return closed_.load(std::memory_order_acquire); }
+
+    // True once the queue is closed and every remaining item has been consumed
+    bool isDrained() const { return isClosed() && size() == 0; }
+
+    size_t size() const { return spsc_ ? spsc_->size() : mpmc_->size(); }
+    size_t capacity() const { return spsc_ ? spsc_->capacity() : mpmc_->capacity(); }
+    BackpressurePolicy policy() const { return policy_; }
+    uint64_t droppedCount() const { return dropped_.load(std::memory_order_relaxed); }
+    size_t highWatermark() const { return occupancy().highWatermark; }
+    QueueOccupancy occupancy() const { return spsc_ ? spsc_->occupancy() : mpmc_->occupancy(); }
+
+   private:
+    static constexpr int kYieldRounds = 16;  // Before parking on the condition variable
+
+    /**
+     * @brief Condition variable that wakers skip while nobody waits on it
+     *
+     * A waiter registers itself before its final check of the predicate and the waker
+     * publishes its change before looking for waiters. Both touch waiters_ with a seq_cst
+     * read-modify-write: whichever comes second in its modification order sees the other
+     * (the waker reads the count, or the waiter synchronizes with the waker's change), so
+     * no wake-up is lost. RMWs rather than standalone fences, which ThreadSanitizer
+     * cannot follow.
+     */
+    class Parking {
+       public:
+        template <typename Predicate>
+        bool wait(Predicate ready,
+                  std::chrono::steady_clock::time_point deadline =
+                      std::chrono::steady_clock::time_point::max()) {
+            waiters_.fetch_add(1, std::memory_order_seq_cst);
+            bool result;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                if (deadline == std::chrono::steady_clock::time_point::max()) {
+                    condition_.wait(lock, ready);
+                    result = true;
+                } else {
+                    result = condition_.wait_until(lock, deadline, ready);
+                }
+            }
+            waiters_.fetch_sub(1, std::memory_order_relaxed);
+            return result;
+        }
+
+        void notify() { wake(false); }
+        void notifyAll() { wake(true); }
+
+       private:
+        void wake(bool all) {
+            if (waiters_.fetch_add(0, std::memory_order_seq_cst) == 0) return;
+            // Taking the mutex orders the notify after a waiter's predicate check
+            { std::lock_guard<std::mutex> lock(mutex_); }
+            if (all) {
+                condition_.notify_all();
+            } else {
+                condition_.notify_one();
+            }
+        }
+
+        std::atomic<int> waiters_{0};
+        std::mutex mutex_;
+        std::condition_variable condition_;
+    };
+
+    bool tryPush(T& item) {
+        return spsc_ ? spsc_->tryPush(std::move(item)) : mpmc_->tryPush(std::move(item));
+    }
+
+    bool tryPop(T& item) { return spsc_ ? spsc_->tryPop(item) : mpmc_->tryPop(item); }
+
+    bool full() const { return size() >= capacity(); }
+
+    std::optional<T> popUntil(std::chrono::steady_clock::time_point deadline) {
+        T item;
+        for (int attempt = 0;; ++attempt) {
+            if (tryPop(item)) {
+                notFull_.notify();
+                return std::optional<T>(std::move(item));
+            }
+            // Closed and empty: checked after the failed pop so a final push is not lost
+            if (isClosed() && size() == 0) return std::nullopt;
+            if (attempt < kYieldRounds) {
+                std::this_thread::yield();
+                continue;
+            }
+            bool woken;
+            {
+                PROFILE_ZONE("wait:queue_empty");
+                woken = notEmpty_.wait([this] { return isClosed() || size() > 0; }, deadline);
+            }
+            if (!woken) return std::nullopt;
+            if (std::chrono::steady_clock::now() >= deadline && size() == 0) return std::nullopt;
+        }
+    }
+
+    const BackpressurePolicy policy_;
+    std::unique_ptr<SpscRing<T>> spsc_;
+    std::unique_ptr<MpmcRing<T>> mpmc_;
+    std::atomic<bool> closed_{false};
+    std::atomic<uint64_t> dropped_{0};
+    Parking notEmpty_;
+    Parking notFull_;
+};
+
+// Queue behind the pipeline's frame handoff links and the persistence worker
+#if BIRDS_LOCKFREE_QUEUES
+template <typename T>
+using HandoffQueue = LockFreeQueue<T>;
+#else
+template <typename T>
+using HandoffQueue = BoundedQueue<T>;
+#endif
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+
+/**
+ * @brief Caps how often one log call site emits
+ *
+ * Allows at most linesPerSecond lines per one-second window (one line per 1 / rate
+ * seconds below 1 line per second; unlimited at 0 or below) and counts the lines it
+ * turns away, so the next line that passes can report them. One limiter per call site
+ * (see LOG_SITE_LIMITER in logger.hpp), shared by every thread and instance that reaches
+ * it, so multi-camera hosts get the same cap as a single camera.
+ */
+class LogRateLimiter {
+   public:
+    explicit LogRateLimiter(double linesPerSecond)
+        : unlimited_(linesPerSecond <= 0.0),
+          window_(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(
+              linesPerSecond >= 1.0 || unlimited_ ? 1.0 : 1.0 / linesPerSecond))),
+          maxLines_(linesPerSecond >= 1.0 ? static_cast<uint64_t>(std::floor(linesPerSecond)) : 1),
+          windowStart_(Clock::now() - window_) {}
+
+    /**
+     * @param suppressed Lines turned away since the previous line that passed (set on true)
+     * @return true if the caller may emit its line now
+     */
+    bool allow(uint64_t& suppressed) {
+        if (unlimited_) {
+            suppressed = 0;
+            return true;
+        }
+        const Clock::time_point now = Clock::now();
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (now - windowStart_ >= window_) {
+            windowStart_ = now;
+            linesInWindow_ = 0;
+        }
+        if (linesInWindow_ >= maxLines_) {
+            ++suppressed_;
+            return false;
+        }
+        ++linesInWindow_;
+        suppressed = suppressed_;
+        suppressed_ = 0;
+        return true;
+    }
+
+    bool allow() {
+        uint64_t suppressed = 0;
+        return allow(suppressed);
+    }
+
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    const bool unlimited_;
+    const Clock::duration window_;
+    const uint64_t maxLines_;
+    std::mutex mutex_;
+    Clock::time_point windowStart_;
+    uint64_t linesInWindow_ = 0;
+    uint64_t suppressed_ = 0;
+};
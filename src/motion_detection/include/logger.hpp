@@ -9,10 +9,70 @@
 #define LOG_CRITICAL(...) SPDLOG_LOGGER_CRITICAL(Logger::getInstance(), __VA_ARGS__)
 
 #include <spdlog/spdlog.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <string>
 
+#include "log_rate_limiter.hpp"
+
+// This call site's LogRateLimiter (one static per macro expansion), capped at
+// Logger::getDiagnosticRate() lines per second
+#define LOG_SITE_LIMITER()                                                    \
+    ([]() -> LogRateLimiter& {                                                \
+        static LogRateLimiter siteLimiter(Logger::getDiagnosticRate());       \
+        return siteLimiter;                                                   \
+    }())
+
+// Rate-limited line: emitted if the level is enabled and the call site is under its cap;
+// the next emitted line is followed by the number of lines suppressed in between
+#define LOG_RATE_LIMITED(level, ...)                                                          \
+    do {                                                                                      \
+        if (Logger::getInstance()->should_log(level)) {                                       \
+            uint64_t logSuppressedLines = 0;                                                  \
+            if (LOG_SITE_LIMITER().allow(logSuppressedLines)) {                               \
+                SPDLOG_LOGGER_CALL(Logger::getInstance(), level, __VA_ARGS__);                \
+                if (logSuppressedLines > 0) {                                                 \
+                    SPDLOG_LOGGER_CALL(Logger::getInstance(), level,                          \
+                                       "({} similar lines suppressed)", logSuppressedLines);  \
+                }                                                                             \
+            }                                                                                 \
+        }                                                                                     \
+    } while (0)
+
+// Condition for a multi-line block: true at most at the call site's rate, never when the
+// level is disabled at run time or compiled out
+#define LOG_SAMPLE(level) \
+    (Logger::getInstance()->should_log(level) && LOG_SITE_LIMITER().allow())
+
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_DEBUG
+#define LOG_DEBUG_LIMITED(...) LOG_RATE_LIMITED(spdlog::level::debug, __VA_ARGS__)
+#define LOG_DEBUG_SAMPLE() LOG_SAMPLE(spdlog::level::debug)
+#else
+#define LOG_DEBUG_LIMITED(...) (void)0
+#define LOG_DEBUG_SAMPLE() false
+#endif
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_INFO
+#define LOG_INFO_LIMITED(...) LOG_RATE_LIMITED(spdlog::level::info, __VA_ARGS__)
+#else
+#define LOG_INFO_LIMITED(...) (void)0
+#endif
+
+/**
+ * Statements below SPDLOG_ACTIVE_LEVEL (set by CMake's LOG_ACTIVE_LEVEL) are compiled out
+ * together with their arguments. Per-frame diagnostics use LOG_DEBUG, so builds with the
+ * default info level pay nothing for them; the runtime log_level filters the rest.
+ */
 class Logger {
 public:
+    // Asynchronous logging: records are formatted and written on a background thread
+    struct AsyncOptions {
+        bool enabled = false;
+        size_t queueSize = 8192;      // Records buffered between the caller and the writer thread
+        bool blockOnOverflow = false;  // true: callers wait for space; false: overwrite the oldest record
+        std::function<void()> onThreadStart;  // Runs first on the writer thread (e.g. its ThreadPolicy)
+    };
+
     // Delete copy and assignment operators to enforce singleton pattern
     Logger(const Logger&) = delete;
     void operator=(const Logger&) = delete;
@@ -20,8 +80,17 @@ public:
     // Static method to get the single instance of the logger
     static std::shared_ptr<spdlog::logger>& getInstance();
 
-    // Initialize the logger from configuration settings
+    // Initialize the logger from configuration settings (synchronous logging)
     static void init(const std::string& logLevel, const std::string& logFile, bool logToFile);
+    // Same, with asynchronous logging options (an overload rather than a default argument,
+    // because AsyncOptions is incomplete inside Logger)
+    static void init(const std::string& logLevel, const std::string& logFile, bool logToFile,
+                     const AsyncOptions& async);
+
+    // Lines per second each LOG_*_LIMITED / LOG_*_SAMPLE call site may emit (default 1; 0 =
+    // unlimited). Read when a call site first runs, so set it before processing starts.
+    static void setDiagnosticRate(double linesPerSecond) { diagnosticRate = linesPerSecond; }
+    static double getDiagnosticRate() { return diagnosticRate; }
 
 private:
     // Private constructor to prevent direct instantiation
@@ -29,6 +98,7 @@ private:
 
     // The single, static instance of the logger
     static std::shared_ptr<spdlog::logger> loggerInstance;
+    static inline double diagnosticRate = 1.0;
 };
 
 #endif // LOGGER_HPP 
\ No newline at end of file
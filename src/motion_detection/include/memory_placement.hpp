@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <opencv2/core.hpp>
+#include <vector>
+
+/**
+ * @brief Where the pixel buffers of one stream live
+ *
+ * hugePages backs each buffer with 2 MB pages: explicit MAP_HUGETLB pages when the system
+ * has a huge page pool, transparent huge pages (2 MB aligned, MADV_HUGEPAGE) otherwise.
+ * numaNode binds the pages to one memory node (preferred, so allocation still succeeds when
+ * the node is full), which should be the socket of the worker threads touching them.
+ */
+struct MemoryPlacement {
+    bool hugePages = false;
+    int numaNode = -1;  // -1 = wherever the kernel puts it
+
+    bool isDefault() const { return !hugePages && numaNode < 0; }
+};
+
+/**
+ * @brief cv::MatAllocator that maps Mat data according to a MemoryPlacement
+ *
+ * Set it as cv::Mat::allocator before create() (FrameBufferPool and MotionProcessor do this
+ * for their buffers); every Mat sharing that data releases it through the allocator. On
+ * systems without mmap/mbind (non-Linux) buffers come from the default allocator path.
+ *
+ * Instances are shared and live for the whole process (see forPlacement()), since Mats may
+ * outlive whoever configured them. Thread safety: thread-safe.
+ */
+class PlacedMatAllocator : public cv::MatAllocator {
+   public:
+    // The process-wide allocator for @p placement; nullptr (OpenCV's default) for the default placement
+    static cv::MatAllocator* forPlacement(const MemoryPlacement& placement);
+
+    explicit PlacedMatAllocator(const MemoryPlacement& placement) : placement_(placement) {}
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override;
+    bool allocate(cv::UMatData* data, cv::AccessFlag accessFlags,
+                  cv::UMatUsageFlags usageFlags) const override;
+    void deallocate(cv::UMatData* data) const override;
+
+    const MemoryPlacement& placement() const { return placement_; }
+
+   private:
+    void* map(size_t bytes) const;
+    void unmap(void* data, size_t bytes) const;
+
+    MemoryPlacement placement_;
+};
+
+// CPUs of each online NUMA node (index = node); a single entry on non-NUMA systems, empty if unknown
+std::vector<std::vector<int>> numaNodeCpus();
+
+// Restrict the calling thread to @p cpus; false if unsupported or refused
+bool pinCurrentThread(const std::vector<int>& cpus);
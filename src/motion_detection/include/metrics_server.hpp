@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "io_reactor.hpp"
+
+/**
+ * @brief Minimal HTTP server answering GET /metrics for Prometheus scrapes
+ *
+ * One background thread accepts connections and serves them one at a time; each request
+ * calls the render function on that thread, so the page is built from lock-free counters
+ * and the processing threads never wait on a scraper. Slow or idle clients are cut off
+ * by socket timeouts. POSIX sockets only.
+ *
+ * Given a running IoReactor, the server keeps no thread of its own: accepting and every
+ * connection are IoTask coroutines on the reactor threads, connections are served side by
+ * side, and the render function runs on a reactor thread. Without one (or off Linux) it
+ * falls back to the thread above.
+ *
+ * Thread safety: start() and stop() must come from the owning thread; the render function
+ * runs on the server thread (or a reactor thread).
+ */
+class MetricsServer {
+   public:
+    using RenderFunction = std::function<std::string()>;
+
+    /**
+     * @param render Builds the exposition page (see PrometheusTextWriter)
+     * @param port TCP port to listen on (0 picks a free port, see port())
+     * @param bindAddress IPv4 address to bind ("0.0.0.0" for every interface)
+     * @param reactor Serves the connections when running at start(); must outlive the server
+     */
+    MetricsServer(RenderFunction render, int port, std::string bindAddress = "127.0.0.1",
+                  IoReactor* reactor = nullptr);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    /**
+     * @brief Bind the socket and start serving
+     * @return false (and logs why) if the address cannot be bound
+     */
+    bool start();
+
+    // Stop accepting and join the server thread, or wait for the server's tasks (returns
+    // within the poll interval, or the socket timeout while a connection is being served)
+    void stop();
+
+    bool isRunning() const { return running_.load(); }
+    // Port actually bound (differs from the requested one when that was 0)
+    int port() const { return boundPort_; }
+    uint64_t requestsServed() const { return requestsServed_.load(); }
+
+   private:
+    void run();
+    void handleConnection(int clientFd);
+    // Response to one request (headers and body); counts the pages served
+    std::string respond(const std::string& request);
+
+    // Reactor mode: the accept loop and one task per connection, counted in tasks_
+    IoTask acceptLoop();
+    IoTask serveConnection(int clientFd);
+    bool spawnTask(IoTask task);
+    void taskFinished();
+
+    RenderFunction render_;
+    const int requestedPort_;
+    const std::string bindAddress_;
+    IoReactor* const reactor_;
+    bool onReactor_ = false;
+    int listenFd_ = -1;
+    int boundPort_ = 0;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> requestsServed_{0};
+    std::thread thread_;
+
+    std::mutex tasksMutex_;
+    std::condition_variable tasksDone_;
+    int tasks_ = 0;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+#include "fixed_size_filters.hpp"
+#include "packed_mask.hpp"
+
+/**
+ * @brief Planned sequence of erosions and dilations with one structuring element
+ *
+ * plan() turns the configured steps (close = dilate, erode; open = erode, dilate; ...)
+ * into passes, merging runs of the same operation. apply() then executes the passes
+ * through ping-pong buffers held by a Workspace, so the chain allocates nothing once the
+ * buffers have their size.
+ *
+ * Exact mode runs each pass as one cv::erode / cv::dilate call with the planned
+ * iteration count: the result is the same as calling morphologyEx step by step. Kernels
+ * of side 3, 5 or 7 run on the FixedMorphology instance for their side instead, with the
+ * same pixels.
+ *
+ * Approximate mode replaces the kernel with the square of the same size and runs every
+ * pass as a horizontal and a vertical van Herk/Gil-Werman line filter: three comparisons
+ * per pixel and direction regardless of the length, and a run of n equal operations is a
+ * single pass of length n * (size - 1) + 1. Borders behave like OpenCV's defaults
+ * (pixels outside the image never win).
+ *
+ * applyPacked() runs the same passes on a 1-bit PackedMask, always with the square kernel
+ * of approximate mode (its results are those of approximate mode).
+ *
+ * Thread safety: apply() is const; concurrent calls need separate Workspaces.
+ */
+class MorphologyChain {
+   public:
+    enum class Operation { ERODE, DILATE };
+
+    // Scratch buffers for apply(); sized on first use
+    struct Workspace {
+        cv::Mat ping;
+        cv::Mat pong;
+        cv::Mat lineForward;   // Vertical line filter: per-block prefix rows
+        cv::Mat lineBackward;  // Vertical line filter: per-block suffix rows
+        std::vector<uchar> rowPadded;
+        std::vector<uchar> rowForward;
+        std::vector<uchar> rowBackward;
+        std::vector<uchar> neutralRow;
+        FixedMorphology::Workspace fixed;  // Exact mode with a fixed-size kernel
+    };
+
+    /**
+     * @param steps Operations in order, all with @p kernel (CV_8U structuring element)
+     * @param approximate Use the square-kernel line-filter passes described above
+     */
+    void plan(const std::vector<Operation>& steps, const cv::Mat& kernel, bool approximate);
+
+    /**
+     * @brief Run the chain on a CV_8UC1 mask
+     * @param output Reallocated only on size change; may alias @p input
+     */
+    void apply(const cv::Mat& input, cv::Mat& output, Workspace& workspace) const;
+
+    // Run the chain on a packed mask; @p output may be @p input
+    void applyPacked(const PackedMask& input, PackedMask& output, PackedMask::Scratch& scratch) const;
+
+    // Rows (and columns) either side of an output pixel that the chain reads
+    int radius() const;
+
+    size_t passCount() const { return passes_.size(); }
+    bool isApproximate() const { return approximate_; }
+
+   private:
+    struct Pass {
+        Operation operation;
+        int iterations;  // Exact mode: consecutive applications of the kernel
+        int length;      // Approximate mode: square side of the merged run
+    };
+
+    void runPass(const Pass& pass, const cv::Mat& input, cv::Mat& output, Workspace& workspace) const;
+
+    std::vector<Pass> passes_;
+    cv::Mat kernel_;
+    FixedMorphology fixed_;  // Planned for exact mode when it covers the kernel
+    bool approximate_ = false;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cmath>
+#include <opencv2/core.hpp>
+#include <vector>
+
+class TrackedObjectStore;
+struct ConsolidatedRegion;
+
+// motion_history: section of the config file
+struct MotionHistoryConfig {
+    bool enabled = false;
+    int durationFrames = 15;       // Processed frames a pixel's motion stays in the history
+    double jitterMaxSpeed = 0.5;   // Frame pixels per frame: long-lived motion slower than this is jitter
+    int jitterMinAgeFrames = 10;   // Frames motion must have stayed in a box to be jitter
+    bool skipJitterSaves = false;  // Save scheduling passes over frames whose regions are all jitter
+};
+
+// Speed and direction of the motion inside a box, from the motion history
+struct RegionMotion {
+    float vx = 0.0f;          // Frame pixels per processed frame (+x = right)
+    float vy = 0.0f;          // Frame pixels per processed frame (+y = down)
+    float coverage = 0.0f;    // Share of the box's pixels with motion in the history (0 = not measured)
+    int ageFrames = 0;        // Frames the oldest motion in the box has been in the history (0 = new)
+    bool jitter = false;      // Long-lived motion that stays in place: leaves, water, a perched bird
+
+    bool measured() const { return coverage > 0.0f; }
+    float speed() const { return std::hypot(vx, vy); }
+    // Degrees in image coordinates: 0 = right, 90 = down
+    float direction() const {
+        const float degrees = std::atan2(vy, vx) * static_cast<float>(180.0 / CV_PI);
+        return degrees < 0.0f ? degrees + 360.0f : degrees;
+    }
+};
+
+/**
+ * @brief Motion history image: the frame of each mask pixel's latest motion
+ *
+ * update() stamps the pixels of the motion mask with a running frame number, so the image
+ * is maintained incrementally: stale motion is not cleared, it simply falls out of the
+ * durationFrames window. A moving object leaves a trail of older stamps behind it;
+ * measure() fits position against stamp over the trail pixels of a box (least squares,
+ * one pass over the box) and gets the velocity of the motion inside it, together with
+ * how much of the box moved recently and for how long. The current frame's own pixels
+ * only count towards coverage and age: their spread is the object's size, not its motion.
+ *
+ * These are cheap per-region features for scheduling: a fast or new region is likely a bird
+ * worth classifying and saving, while motion that has stayed in place for many frames
+ * without going anywhere (swaying leaves) is marked jitter and can wait.
+ *
+ * Thread safety: not thread-safe; owned by one MotionProcessor.
+ */
+class MotionHistory {
+   public:
+    explicit MotionHistory(const MotionHistoryConfig& config = MotionHistoryConfig());
+
+    // Stamp the non-zero pixels of @p mask (CV_8UC1) as the newest frame; a new size restarts the history
+    void update(const cv::Mat& mask);
+
+    // Motion inside @p box (mask coordinates); velocity in mask pixels per frame
+    RegionMotion measure(const cv::Rect& box) const;
+
+    // Whether @p motion (velocity in frame pixels) is jitter by the configured limits
+    bool isJitter(const RegionMotion& motion) const;
+
+    // Forget all motion (camera shake, scene change)
+    void reset();
+
+    bool isEmpty() const { return stamps_.empty(); }
+    const MotionHistoryConfig& getConfig() const { return config_; }
+    void updateConfig(const MotionHistoryConfig& config);
+
+    /**
+     * @brief Give each region the combined motion of its objects
+     *
+     * Row i of @p objects is box i of @p boxMotion (ObjectTracker::update() and
+     * makeTrackedObjects() keep the box order). Velocity and coverage are averaged weighted
+     * by each box's moving area, the age is the oldest member's; a region is jitter only if
+     * every measured member is. Regions without measured members keep RegionMotion().
+     */
+    static void summarizeRegions(const TrackedObjectStore& objects, const std::vector<RegionMotion>& boxMotion,
+                                 std::vector<ConsolidatedRegion>& regions);
+
+   private:
+    MotionHistoryConfig config_;
+    cv::Mat stamps_;  // CV_32S frame number of each pixel's latest motion (0 = none yet)
+    int frame_ = 0;
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <opencv2/core.hpp>
+#include <vector>
+
+/**
+ * @brief Histogram of 8-bit motion values (index = pixel value)
+ */
+using MotionHistogram = std::array<int, 256>;
+
+/**
+ * @brief Pass 1 of the fused motion mask: frame difference and its Otsu histogram
+ *
+ * Writes diff = |current - previous| (0 where @p excluded is non-zero) and counts, per
+ * pixel, the value Otsu's method would see: diff | background. Replaces the absdiff, setTo,
+ * bitwise_or and threshold-histogram passes of the unfused chain with a single one.
+ *
+ * @param current, previous CV_8UC1 frames of the same size
+ * @param background Optional CV_8UC1 background-model mask (empty = none)
+ * @param excluded Optional CV_8UC1 mask, non-zero = pixel ignored (empty = none)
+ * @param diff Output CV_8UC1 difference (reallocated only on size change)
+ * @param histogram Output histogram of diff | background
+ * @param histogramRowStep Count only every n-th row (1 = all); the difference is always full
+ */
+void absDiffHistogram(const cv::Mat& current, const cv::Mat& previous, const cv::Mat& background,
+                      const cv::Mat& excluded, cv::Mat& diff, MotionHistogram& histogram,
+                      int histogramRowStep = 1);
+
+/**
+ * @brief Three-frame variant of absDiffHistogram: diff = min(|current - previous|,
+ * |current - older|)
+ *
+ * The minimum is the AND of both differences before thresholding: an object is only where
+ * it differs from both earlier frames, so the ghosts it left at its previous positions drop
+ * out. An empty @p older falls back to the two-frame difference.
+ */
+void absDiffHistogram(const cv::Mat& current, const cv::Mat& previous, const cv::Mat& older,
+                      const cv::Mat& background, const cv::Mat& excluded, cv::Mat& diff,
+                      MotionHistogram& histogram, int histogramRowStep = 1);
+
+/**
+ * @brief Otsu's threshold of a histogram, selecting the same value as cv::THRESH_OTSU
+ */
+int otsuThreshold(const MotionHistogram& histogram);
+
+/**
+ * @brief Drift between two histograms: L1 distance of their normalized 16-bucket profiles
+ *
+ * 0 = same distribution, 2 = disjoint. Coarse buckets keep the metric stable when one side
+ * comes from a row-sampled histogram. Returns 2 if either histogram is empty.
+ */
+double histogramDrift(const MotionHistogram& a, const MotionHistogram& b);
+
+/**
+ * @brief Pass 2 of the fused motion mask: thresh = (diff | background) > threshold ? maxValue : 0
+ *
+ * Pixels where @p excluded is non-zero are 0. Matches cv::threshold(THRESH_BINARY) applied
+ * to the combined mask.
+ */
+void thresholdMotion(const cv::Mat& diff, const cv::Mat& background, const cv::Mat& excluded,
+                     int threshold, int maxValue, cv::Mat& thresh);
+
+/**
+ * @brief Hysteresis on top of thresholdMotion(): grow @p thresh over weak motion touching it
+ *
+ * A single threshold splits a bird whose wings or tail differ less than its body into
+ * several blobs, each of which becomes a tracked object the consolidator has to merge
+ * again. Here the pixels already in @p thresh are the strong seeds; a flood from them
+ * adds every 8-connected pixel whose combined value (diff | background) is above
+ * @p lowThreshold, so a component is kept whole as long as part of it is strong, while
+ * weak noise that touches nothing strong stays out. Pixels where @p excluded is non-zero
+ * are never added. Cost is proportional to the mask, one scan plus the grown pixels.
+ *
+ * @param stack Scratch for the flood (reused across frames)
+ * @return Pixels added to @p thresh
+ */
+int growHysteresis(const cv::Mat& diff, const cv::Mat& background, const cv::Mat& excluded, int lowThreshold,
+                   cv::Mat& thresh, std::vector<int>& stack);
@@ -0,0 +1,34 @@
+#pragma once
+
+/**
+ * @brief Per-instruction-set row kernels behind absDiffHistogram() and thresholdMotion()
+ *
+ * Internal to motion_mask_kernel.cpp, which picks one by simdLevel(). Each kernel handles
+ * the longest prefix of the row that fills whole vectors and returns its length; the caller
+ * finishes the row in scalar code. Optional rows (older, background, excluded) are nullptr
+ * when absent, and combined (the masked diff | background the histogram counts) is only
+ * written when non-null.
+ *
+ * Only the variants of the target architecture are built (BIRDS_SIMD_AVX2, BIRDS_SIMD_AVX512,
+ * BIRDS_SIMD_NEON). Their translation units are compiled with wider -m flags than the rest,
+ * so this header and they include nothing with inline functions shared with other files
+ * (no OpenCV): the linker could otherwise keep a copy that uses AVX2 for every caller.
+ */
+
+int absDiffRowAvx2(const unsigned char* current, const unsigned char* previous, const unsigned char* older,
+                   const unsigned char* background, const unsigned char* excluded, unsigned char* diff,
+                   unsigned char* combined, int cols);
+int thresholdRowAvx2(const unsigned char* diff, const unsigned char* background, const unsigned char* excluded,
+                     unsigned char level, unsigned char high, unsigned char* thresh, int cols);
+
+int absDiffRowAvx512(const unsigned char* current, const unsigned char* previous, const unsigned char* older,
+                     const unsigned char* background, const unsigned char* excluded, unsigned char* diff,
+                     unsigned char* combined, int cols);
+int thresholdRowAvx512(const unsigned char* diff, const unsigned char* background, const unsigned char* excluded,
+                       unsigned char level, unsigned char high, unsigned char* thresh, int cols);
+
+int absDiffRowNeon(const unsigned char* current, const unsigned char* previous, const unsigned char* older,
+                   const unsigned char* background, const unsigned char* excluded, unsigned char* diff,
+                   unsigned char* combined, int cols);
+int thresholdRowNeon(const unsigned char* diff, const unsigned char* background, const unsigned char* excluded,
+                     unsigned char level, unsigned char high, unsigned char* thresh, int cols);
@@ -1,13 +1,54 @@
 #pragma once
 
+#include "frame_arena.hpp"
 #include "motion_processor.hpp"
 #include "motion_region_consolidator.hpp"
+#include "object_tracker.hpp"
+#include "pipeline_config.hpp"
+#include "region_flow_propagator.hpp"
+#include "stage_graph.hpp"
 #include "tracked_object.hpp"
+#include "tracked_object_store.hpp"
 #include <opencv2/opencv.hpp>
 #include <utility>
 #include <vector>
 #include <string>
 
+/**
+ * @brief Wrap detected motion boxes as TrackedObjects with per-frame IDs for consolidation
+ *
+ * Stateless (and safe to call from several streams at once): boxes are numbered
+ * firstId, firstId + 1, ... in order, so IDs are only unique within one call. Use
+ * ObjectTracker::update() for IDs that persist across frames.
+ * @param detectedBounds Motion boxes from MotionProcessor::processFrame
+ * @param firstId ID of the first box
+ * @return One TrackedObject per box, in the same order
+ */
+std::vector<TrackedObject> makeTrackedObjects(const std::vector<cv::Rect>& detectedBounds,
+                                              int firstId = 0);
+
+/**
+ * @brief Allocation-free variant: fill @p store (cleared first) with one row per box
+ */
+void makeTrackedObjects(const std::vector<cv::Rect>& detectedBounds, TrackedObjectStore& store,
+                        int firstId = 0);
+
+/**
+ * @brief Reusable per-stream state of processFrameAndConsolidate()
+ *
+ * Keep one per video stream and pass it every frame: the object store and the region
+ * vector (including the ID vectors inside it) keep their capacity, so steady-state frames
+ * do not allocate for their outputs. Every member is overwritten by each call; the arena
+ * serves the frame's transient containers and is reset when the call returns.
+ */
+struct MotionPipelineContext {
+    MotionProcessor::ProcessingResult result;
+    TrackedObjectStore trackedObjects;        // Objects handed to the consolidator
+    std::vector<ConsolidatedRegion> regions;  // Consolidated regions of the frame
+    std::vector<cv::Mat> crops;               // MotionStageGraph "crops": the frame at each region
+    FrameArena arena;                         // Per-frame scratch (DBSCAN temporaries)
+};
+
 /**
  * @brief Unified function to process frame and consolidate regions with optional visualization
  * 
@@ -16,6 +57,9 @@
  * 2. Convert detected bounds to TrackedObjects  
  * 3. Consolidate regions using MotionRegionConsolidator
  * 4. Optionally save visualization
+ *
+ * The fixed form of MotionStageGraph's default stages; use the graph to add, drop or run
+ * stages concurrently from the stage_graph: config.
  * 
  * @param motionProcessor Reference to MotionProcessor instance
  * @param regionConsolidator Reference to MotionRegionConsolidator instance
@@ -28,3 +72,113 @@ processFrameAndConsolidate(MotionProcessor& motionProcessor,
                           MotionRegionConsolidator& regionConsolidator,
                           const cv::Mat& frame,
                           const std::string& visualizationPath = "");
+
+/**
+ * @brief Same pipeline with an ObjectTracker stage between detection and consolidation
+ *
+ * Detected boxes are associated with the tracker's live tracks, so the consolidator sees
+ * persistent object IDs (and trajectories) instead of fresh ones every frame.
+ *
+ * @param tracker Tracker for this video stream; updated even when nothing is detected so
+ *                unmatched tracks age out
+ */
+std::pair<MotionProcessor::ProcessingResult, std::vector<ConsolidatedRegion>>
+processFrameAndConsolidate(MotionProcessor& motionProcessor, ObjectTracker& tracker,
+                           MotionRegionConsolidator& regionConsolidator, const cv::Mat& frame,
+                           const std::string& visualizationPath = "");
+
+/**
+ * @brief Output-parameter variants: the results of the frame are written into @p context
+ *
+ * Same pipelines as above without the per-frame allocations of the returned pair.
+ */
+void processFrameAndConsolidate(MotionProcessor& motionProcessor,
+                                MotionRegionConsolidator& regionConsolidator, const cv::Mat& frame,
+                                MotionPipelineContext& context,
+                                const std::string& visualizationPath = "");
+
+void processFrameAndConsolidate(MotionProcessor& motionProcessor, ObjectTracker& tracker,
+                                MotionRegionConsolidator& regionConsolidator, const cv::Mat& frame,
+                                MotionPipelineContext& context,
+                                const std::string& visualizationPath = "");
+
+/**
+ * @brief Second half of the variant above without a tracker: consolidate @p context.result
+ *
+ * For callers that run detection (MotionProcessor::processFrame() into context.result) and
+ * consolidation as separate steps, e.g. StreamManager yielding to a more urgent stream in
+ * between.
+ */
+void consolidateDetections(MotionRegionConsolidator& regionConsolidator, const cv::Mat& frame,
+                           MotionPipelineContext& context);
+
+/**
+ * @brief Detect-every-k variant (flow_propagation:): optical flow between detection frames
+ *
+ * When @p propagator says detection is due, or loses a box, this is the tracker variant
+ * above, and the propagator is seeded with the detected boxes. On the frames in between
+ * the boxes of the last detection frame are moved by RegionFlowPropagator::propagate(), the
+ * tracker is updated with them (IDs and trajectories continue), and the regions still in
+ * @p context from the previous frame are moved with their objects instead of re-clustered.
+ * result.detectedBounds then holds the propagated boxes; the processor's images are empty.
+ *
+ * @return true if this frame ran full detection and consolidation
+ */
+bool processFrameOrPropagate(MotionProcessor& motionProcessor, ObjectTracker& tracker,
+                             MotionRegionConsolidator& regionConsolidator, RegionFlowPropagator& propagator,
+                             const cv::Mat& frame, MotionPipelineContext& context);
+
+/**
+ * @brief The detection pipeline as a StageGraph assembled from the stage_graph: config
+ *
+ * Stages, with the slots they read and fill:
+ *   detect       frame -> boxes, mask       MotionProcessor::processFrame
+ *   track        boxes -> objects           ObjectTracker::update (persistent IDs)
+ *   number       boxes -> objects           makeTrackedObjects (IDs within the frame)
+ *   consolidate  frame, objects -> regions  MotionRegionConsolidator
+ *   crops        frame, regions -> crops    Views of the frame at each region (for classifiers)
+ *   visualize    frame, objects, regions    Sink: saves the consolidation drawing when run() has a path
+ *
+ * An empty stage list is detect, track (number without a tracker), consolidate: the
+ * stages of processFrameAndConsolidate(), with the same results. Stages whose slots no
+ * requested output needs are skipped; requesting "mask" makes the processor retain its
+ * morphological stage (result.morphological). Slots live in the MotionPipelineContext
+ * (boxes and mask in result); those of skipped stages are left empty.
+ *
+ * Bind one graph to each stream's processor, consolidator and tracker and keep it, like
+ * the context: the graph is validated and scheduled once, not per frame.
+ *
+ * Not thread-safe; run() uses the pool only for stages of the same level.
+ */
+class MotionStageGraph {
+   public:
+    /**
+     * @param tracker Required by "track"; nullptr selects "number" for the default stages
+     * @throws std::invalid_argument for an unknown stage, "track" without a tracker, or a
+     *         graph StageGraph::compile() rejects (e.g. "consolidate" without "objects")
+     */
+    MotionStageGraph(MotionProcessor& processor, MotionRegionConsolidator& consolidator, ObjectTracker* tracker,
+                     const StageGraphSettings& settings = StageGraphSettings());
+
+    /**
+     * @brief Run the graph on one frame, writing its slots into @p context
+     * @param pool Runs the independent stages of a level concurrently; nullptr = this thread
+     */
+    void run(const cv::Mat& frame, MotionPipelineContext& context, const std::string& visualizationPath = "",
+             WorkStealingPool* pool = nullptr);
+
+    const StageGraph& graph() const { return graph_; }
+
+   private:
+    void addStage(const std::string& name);
+
+    MotionProcessor& processor_;
+    MotionRegionConsolidator& consolidator_;
+    ObjectTracker* tracker_;
+    StageGraph graph_;
+
+    // Bound for the duration of run()
+    const cv::Mat* frame_ = nullptr;
+    MotionPipelineContext* context_ = nullptr;
+    const std::string* visualizationPath_ = nullptr;
+};
@@ -1,15 +1,69 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
 #include <string>
 #include <memory>
+#include <tuple>
+
+#include "block_motion_map.hpp"
+#include "cached_clahe.hpp"
+#include "contour_filter.hpp"
+#include "detections.hpp"
+#include "edge_preserving_filter.hpp"
+#include "fixed_size_filters.hpp"
+#include "frame_ring.hpp"
+#include "morphology_chain.hpp"
+#include "motion_history.hpp"
+#include "motion_mask_kernel.hpp"
+#include "rle_mask.hpp"
+#include "stack_blur.hpp"
+#include "stage_timings.hpp"
+#include "streaming_quantile.hpp"
+#include "tile_occupancy.hpp"
+
+class PipelineConfig;
 
 /**
  * @brief Pure frame processing class - handles image preprocessing, motion detection,
  *        morphological operations, and contour extraction
+ *
+ * Thread safety: all per-stream state (previous frame, background model, adaptive
+ * thresholds, frame counters, working buffers) lives in the instance, so separate
+ * instances may run concurrently on separate threads, e.g. one per camera. A single
+ * instance is not thread-safe. Settings are applied from a PipelineConfig snapshot during
+ * construction and reloadConfig(); processors built from the same snapshot share one
+ * parse of the file. Give each instance its own visualization path when visualization
+ * is enabled, since debug images are named by frame number.
  */
 class MotionProcessor {
 public:
+    // Filter statistics of one frame's region extraction (contours or components), the
+    // structured form of the rate-limited extraction log lines
+    struct ExtractionStats {
+        int candidates = 0;           // Contours / components found in the mask
+        int rejectedArea = 0;         // Smaller than minArea
+        int rejectedSolidity = 0;     // Less solid than minSolidity
+        int rejectedAspectRatio = 0;  // More elongated than maxAspectRatio
+        int accepted = 0;             // Returned as motion boxes
+        double minArea = 0.0;         // Thresholds applied to this frame
+        double minSolidity = 0.0;
+        double maxAspectRatio = 0.0;
+        double maskCoverage = 1.0;    // Fraction of the mask visited (below 1 with tile occupancy)
+        int solidityChecks = 0;       // Candidates whose convex hull / solidity was measured
+        int droppedOverCap = 0;       // Smallest candidates skipped by max_contours_per_frame
+    };
+
+    // Whole-frame events recognised by the flood guard (flood_guard, host path). A frame is a
+    // candidate when more than flood_motion_fraction of its mask is set; the global shift
+    // to its reference is then estimated by phase correlation on small thumbnails.
+    // SHAKE: a clear shift (the camera mount moved) that re-differencing against the
+    // reference warped by it did not explain away. ILLUMINATION: no coherent shift (a cloud,
+    // auto exposure). Either way the frame yields no boxes, morphology and region
+    // extraction are skipped, and it becomes the reference for the next frame.
+    enum class FloodKind { NONE, ILLUMINATION, SHAKE };
+
     struct ProcessingResult {
         cv::Mat originalFrame;      // Original input image for downstream processing
         cv::Mat processedFrame;
@@ -17,14 +71,91 @@ public:
         cv::Mat thresh;
         cv::Mat morphological;
         std::vector<cv::Rect> detectedBounds;
+        // detectedBounds with their area, solidity, centroid and mean difference, as
+        // extraction measured them (same rows; empty when the boxes did not come from
+        // extraction, e.g. moved by flow propagation)
+        Detections detections;
         bool hasMotion = false;
+        ExtractionStats extraction;  // Zero on frames skipped before extraction
+        FloodKind flood = FloodKind::NONE;  // Whole-frame change suppressed by the flood guard
+        bool shiftCompensated = false;      // Mask recomputed against the shifted reference
+        cv::Point2d globalShift;            // Estimated camera shift (detection pixels), if measured
+        // Per detectedBounds box, in frame pixels (motion_history enabled on the pixel paths; empty otherwise)
+        std::vector<RegionMotion> detectedMotion;
+        // motion_mask_rle: the cleaned mask as runs, on frames with motion (pixel paths; empty otherwise)
+        RleMask motionMask;
     };
 
+    // Intermediate stages that processFrame() keeps in ProcessingResult. Stages that are
+    // not selected are left as empty Mats so production callers only pay for the
+    // detections; detectedBounds and hasMotion are always populated.
+    enum ResultStage : unsigned {
+        STAGE_NONE = 0,
+        STAGE_ORIGINAL = 1u << 0,
+        STAGE_PROCESSED = 1u << 1,
+        STAGE_FRAME_DIFF = 1u << 2,
+        STAGE_THRESH = 1u << 3,
+        STAGE_MORPHOLOGICAL = 1u << 4,
+        STAGE_ALL = STAGE_ORIGINAL | STAGE_PROCESSED | STAGE_FRAME_DIFF | STAGE_THRESH |
+                    STAGE_MORPHOLOGICAL
+    };
+
+    // Stage variants. The config strings are parsed into these once (loadConfig),
+    // so the per-frame path switches on an enum instead of comparing strings.
+    enum class ProcessingMode { GRAYSCALE, HSV, RGB, YCRCB };
+    // Layout of the frames passed to processFrame(). NV12 is CV_8UC1 with height * 3 / 2
+    // rows (Y plane, then interleaved UV); YUYV is CV_8UC2. Luma modes read Y directly.
+    enum class InputFormat { BGR, NV12, YUYV };
+    enum class BlurType { NONE, GAUSSIAN, MEDIAN, BILATERAL, GUIDED, DOMAIN_TRANSFORM, STACK };
+    enum class ContourMode { ADAPTIVE, PERMISSIVE };
+    // CONTOURS traces outlines (findContours, contourArea, approxPolyDP, convexHull).
+    // COMPONENTS labels the mask once (connectedComponentsWithStats) and filters on the
+    // resulting boxes and pixel counts with a run-based solidity estimate.
+    enum class ExtractionMethod { CONTOURS, COMPONENTS };
+    // OTSU recomputes Otsu's threshold every frame. CACHED reuses the last value and only
+    // recomputes it every otsuUpdateInterval frames or when a row-sampled histogram of the
+    // motion mask drifts from the one the value was computed on (single-channel modes).
+    enum class ThresholdMode { OTSU, CACHED };
+    // FULL runs cv::CLAHE on every frame. CACHED fits the tile lookup tables on a reduced
+    // frame every claheUpdateInterval frames (or on brightness drift) and only interpolates
+    // through them in between (host path; the device path always runs FULL).
+    enum class ClaheMode { FULL, CACHED };
+    // CPU runs every stage on cv::Mat. OPENCL runs preprocessing through morphology on
+    // cv::UMat (OpenCV's T-API): the crop is uploaded once and only the binary mask is
+    // downloaded for extraction. Falls back to CPU when no OpenCL device is available.
+    enum class ComputeBackend { CPU, OPENCL };
+    // Model behind background_subtraction. MOG2 and KNN are OpenCV's Gaussian-mixture and
+    // nearest-neighbour models; RUNNING_AVERAGE and MEDIAN are the integer-math
+    // ApproximateBackgroundSubtractor: several times cheaper, but without shadow detection
+    // and with a single background value per pixel (swaying leaves stay foreground).
+    enum class BackgroundModel { MOG2, KNN, RUNNING_AVERAGE, MEDIAN };
+    // TWO_FRAME thresholds |t - (t-1)|, which also lights up the spot an object just left
+    // (ghosting: boxes twice the bird, neighbours merged). THREE_FRAME thresholds
+    // min(|t - (t-1)|, |t - (t-2)|), the pixels that differ from both earlier frames: only
+    // the object at its current position.
+    enum class DifferencingMode { TWO_FRAME, THREE_FRAME };
+    // PIXEL runs the per-pixel chain above (preprocessing, differencing or background
+    // model, threshold, morphology, contours). BLOCK is for devices too slow for it (e.g. a
+    // Raspberry Pi Zero): the gray crop is compared block by block with a running-average
+    // background in a single SAD pass (BlockMotionMap), and the blocks above block_threshold
+    // are grouped into boxes by labelling the small block grid. No blur, background model or
+    // morphology runs, and boxes are aligned to block_size.
+    enum class DetectionMethod { PIXEL, BLOCK };
+
+    // Reads @p configPath; a missing or invalid file leaves every setting at its default
     explicit MotionProcessor(const std::string& configPath);
+    explicit MotionProcessor(std::shared_ptr<const PipelineConfig> config);
     ~MotionProcessor() = default;
 
     // Main processing pipeline
     ProcessingResult processFrame(const cv::Mat& frame);
+
+    // Prepare for a stream whose first frame is @p frame before processFrame() sees it:
+    // builds the ROI geometry, seeds the background model and the reference frame, and
+    // (in buffer-reuse mode) sizes every working buffer, so the first real frame is
+    // differenced right away instead of paying allocations and model setup. No-op once
+    // the reference frame exists.
+    void warmUp(const cv::Mat& frame);
     
     // Individual processing steps (public for testing)
     cv::Mat preprocessFrame(const cv::Mat& frame);
@@ -36,11 +167,177 @@ public:
     void setPrevFrame(const cv::Mat& frame);
     bool isFirstFrame() const { return firstFrame; }
     void setFirstFrame(bool first) { firstFrame = first; }
+    // Start over on a new scene: forget the reference frames, the background model and the
+    // motion gate / refinement references, keeping the config, the cached resources, the
+    // working buffers and the adaptive contour statistics. The next frame is a first frame.
+    void resetState();
+
+    // Hot reload: apply a (possibly edited) config file without losing the previous
+    // frame or the background model. Cached resources are rebuilt from the new values.
+    void reloadConfig(const std::string& configPath);
+    void reloadConfig(std::shared_ptr<const PipelineConfig> config);
+    // Snapshot the current settings were applied from
+    const std::shared_ptr<const PipelineConfig>& getConfig() const { return pipelineConfig; }
 
     // Configuration getters
     int getMinContourArea() const { return minContourArea; }
     int getMaxThreshold() const { return maxThreshold; }
     bool isBackgroundSubtractionEnabled() const { return backgroundSubtraction; }
+    ProcessingMode getProcessingMode() const { return processingMode; }
+    InputFormat getInputFormat() const { return inputFormat; }
+    void setInputFormat(InputFormat format) { inputFormat = format; }
+    BlurType getBlurType() const { return blurType; }
+    ContourMode getContourMode() const { return contourMode; }
+    ExtractionMethod getExtractionMethod() const { return extractionMethod; }
+    ThresholdMode getThresholdMode() const { return thresholdMode; }
+    ClaheMode getClaheMode() const { return claheMode; }
+    ComputeBackend getComputeBackend() const { return computeBackend; }
+    BackgroundModel getBackgroundModel() const { return backgroundModel; }
+    DifferencingMode getDifferencingMode() const { return differencingMode; }
+    DetectionMethod getDetectionMethod() const { return detectionMethod; }
+    // Frames the motion gate skipped since construction
+    size_t getGatedFrameCount() const { return gatedFrameCount; }
+    // Frames the flood guard suppressed, and those it rescued by compensating a camera shift;
+    // safe to read from any thread
+    uint64_t getFloodFrameCount() const { return floodFrameCount.load(); }
+    uint64_t getShiftCompensatedFrameCount() const { return shiftCompensatedFrameCount.load(); }
+    // Motion threshold applied to the last frame (after the min_motion_threshold floor)
+    int getLastMotionThreshold() const { return lastMotionThreshold; }
+    // Mask pixels hysteresis_low_ratio added to the last frame's threshold (0 when off)
+    int getLastHysteresisGrowth() const { return lastHysteresisGrowth; }
+    // Motion history image the boxes' speed and direction come from (motion_history)
+    const MotionHistory& getMotionHistory() const { return motionHistory; }
+    // Statistics of the last extractContours() call
+    const ExtractionStats& getLastExtractionStats() const { return lastExtraction; }
+    // Background model snapshots (background_snapshot_dir). MOG2 does not expose its
+    // mixture state, so the learned background image is saved (on demand, and every
+    // background_snapshot_interval_frames on the processing thread) and the next process
+    // seeds its new model with it, if the snapshot is younger than
+    // background_snapshot_max_age_s and close enough to the first frame. Returns false when
+    // snapshots are disabled, no model exists yet or the write failed.
+    bool saveBackgroundSnapshot() const;
+    // <background_snapshot_dir>/background_<camera_id>.yml.gz ("" when disabled)
+    std::string getBackgroundSnapshotPath() const;
+    // The current background model was seeded from a snapshot
+    bool isBackgroundRestored() const { return backgroundRestored; }
+    // Learned background at detection size, as a snapshot stores it (empty without a model)
+    cv::Mat getBackgroundImage() const;
+    // Seed the next background model with @p background (from getBackgroundImage() of the same
+    // camera, e.g. on the node a stream migrates from), in place of the snapshot file; the same
+    // size and scene checks apply. Call before the first frame.
+    void seedBackground(const cv::Mat& background) { pendingBackground = background.clone(); }
+    // camera_id: snapshot file key, and the stream's name in StreamManager metrics
+    const std::string& getCameraId() const { return cameraId; }
+    // Per-stage latencies since construction (empty unless built with ENABLE_STAGE_TIMING)
+    const StageTimings& getStageTimings() const { return stageTimings; }
+    // Background models rebuilt after the first one (resolution/ROI change, re-enable);
+    // safe to read from any thread
+    uint64_t getBackgroundModelResets() const { return backgroundModelResets.load(); }
+    void resetStageTimings() { stageTimings.reset(); }
+
+    // Zero-allocation steady-state mode. When enabled, the Mats in ProcessingResult alias
+    // working buffers owned by the processor and are overwritten by the next processFrame()
+    // call; clone() anything that must outlive the frame. Buffers are sized lazily on the
+    // first frame and only reallocated when the input resolution or type changes.
+    void setBufferReuse(bool enable) { reuseBuffers = enable; }
+    bool isBufferReuseEnabled() const { return reuseBuffers; }
+
+    // Allocator of the persistent working buffers (e.g. PlacedMatAllocator for huge pages or
+    // NUMA-local memory; nullptr = OpenCV's default). Call before the first frame; the buffers
+    // are dropped and reallocated with it lazily.
+    void setBufferAllocator(cv::MatAllocator* allocator);
+
+    // Stage selection (bitwise OR of ResultStage). Enabling visualization retains all
+    // stages regardless of the mask.
+    void setRetainedStages(unsigned stages) { retainedStages = stages; }
+    unsigned getRetainedStages() const { return retainedStages; }
+
+    // Regions of interest and static exclusion zones, as polygons in full-frame pixel
+    // coordinates. processFrame() only processes the bounding rectangle of the ROI polygons
+    // (the whole frame when there are none) and zeroes pixels outside the ROI polygons or
+    // inside an exclusion polygon before thresholding. detectedBounds and originalFrame stay
+    // in full-frame coordinates; the other retained stages cover the ROI crop only.
+    void setRegionsOfInterest(const std::vector<std::vector<cv::Point>>& polygons);
+    void setExclusionZones(const std::vector<std::vector<cv::Point>>& polygons);
+    const std::vector<std::vector<cv::Point>>& getRegionsOfInterest() const { return roiPolygons; }
+    const std::vector<std::vector<cv::Point>>& getExclusionZones() const { return exclusionPolygons; }
+
+    // Detection resolution as a fraction of the input, in (0, 1]. Below 1 the ROI crop is
+    // downscaled (INTER_AREA) before preprocessing, so blur, differencing, morphology and
+    // contour extraction run on 1/scale^2 fewer pixels and kernel sizes act at that scale.
+    // Contour areas are converted back to full-resolution pixels, so the area thresholds keep
+    // their meaning, and detectedBounds are remapped to full-resolution coordinates.
+    void setDetectionScale(double scale);
+    double getDetectionScale() const { return detectionScale; }
+    // Coarse-to-fine detection (detection_refinement), effective while detection_scale < 1:
+    // each box found on the downscaled mask is detected again on the full-resolution luma
+    // difference inside a window padded by refinement_padding pixels, with the frame's
+    // motion threshold and area filter. The full-frame stages stay downscaled (e.g. 1/4),
+    // so the extra work scales with the motion area, while the boxes, small birds included,
+    // get full-resolution precision. A window with nothing at full resolution (e.g. motion
+    // only the background model sees) keeps its downscaled boxes. The previous input frame
+    // is referenced, not copied, unless the caller decodes every frame into one buffer
+    // (detected and then copied), so do not draw into frames handed to processFrame().
+    void setDetectionRefinement(bool enable);
+    bool isDetectionRefinementEnabled() const { return detectionRefinement; }
+    void setRefinementPadding(int pixels) { refinementPadding = std::max(0, pixels); }
+    int getRefinementPadding() const { return refinementPadding; }
+    // Tile occupancy (occupancy_tile_size > 0): the thresholded mask is scanned in tiles of
+    // this many pixels, and morphology and region extraction run only on windows around
+    // the tiles holding motion, grown by the morphology radius. Regions never cross a
+    // window, so the boxes are those of the whole-mask pass (possibly in another order).
+    // When the windows cover more than occupancy_max_fraction of the mask, the frame is
+    // processed whole. Host path only; takes precedence over tile_bands for morphology.
+    void setOccupancyTileSize(int pixels) { occupancyTileSize = std::max(0, pixels); }
+    int getOccupancyTileSize() const { return occupancyTileSize; }
+    void setOccupancyMaxFraction(double fraction) { occupancyMaxFraction = std::clamp(fraction, 0.0, 1.0); }
+    double getOccupancyMaxFraction() const { return occupancyMaxFraction; }
+    // Temporal ROI prediction (roi_prediction): once there is motion, the next frames are
+    // processed only on windows around the last frame's boxes and the setPredictedRegions()
+    // hints (tracker predictions), grown by roi_prediction_margin detection pixels, so an
+    // active scene costs in proportion to the birds' area. A full scan runs every
+    // roi_prediction_full_scan_interval frames, when there are no windows or they cover more
+    // than roi_prediction_max_fraction of the crop, and when at least
+    // roi_prediction_trigger_samples of a 1/8-sampled gray image changed by
+    // motion_gate_pixel_delta outside the windows since the last frame (a new arrival).
+    // Windowed frames threshold their difference to the references, and to the background
+    // image taken at the last full scan, at the last full scan's level; the background model
+    // only learns on full scans, and flood guard and hysteresis only run there. Outside the
+    // windows the reference keeps its pixels, so slow changes add up until the next full scan.
+    // Host path, pixel detection, single-channel frames without contrast enhancement;
+    // anything else scans every frame.
+    void setRoiPrediction(bool enable);
+    bool isRoiPredictionEnabled() const { return roiPrediction; }
+    // Frame coordinates; used by the next processFrame() only
+    void setPredictedRegions(std::vector<cv::Rect> regions) { predictionHints = std::move(regions); }
+    // Frames processed on windows only since construction; safe to read from any thread
+    uint64_t getPredictedFrameCount() const { return predictedFrameCount.load(); }
+    // Worst-case bound: at most this many candidates (contours or components) of a mask
+    // reach the filters and the consolidator, the largest by area, selected in linear time
+    // (0 = no limit). With tile occupancy and components, each window keeps its largest
+    // while the frame's budget lasts.
+    void setMaxContoursPerFrame(int count) { maxContoursPerFrame = std::max(0, count); }
+    int getMaxContoursPerFrame() const { return maxContoursPerFrame; }
+    // Packed masks (packed_masks): the fused threshold writes a 1-bit mask (PackedMask), the
+    // morphology chain runs on its words with the square kernel of morph_approximate, and a
+    // run labeler extracts the regions as the "components" extraction would. Host path,
+    // single-channel frames; frames that need the byte mask (flood guard, hysteresis,
+    // motion history, retained or visualized masks) keep the byte path.
+    void setPackedMasks(bool enable) { packedMasks = enable; }
+    bool isPackedMasksEnabled() const { return packedMasks; }
+    // Run-length motion masks (motion_mask_rle): frames with motion carry their cleaned mask
+    // as runs (ProcessingResult::motionMask), mapped onto the ROI, for saved-frame metadata.
+    // Packed-mask frames reuse the labeler's runs; others scan the byte mask once.
+    void setMotionMaskRle(bool enable) { motionMaskRle = enable; }
+    bool isMotionMaskRleEnabled() const { return motionMaskRle; }
+    // Flood guard (see FloodKind); flood_motion_fraction is the mask fraction that triggers it
+    void setFloodGuard(bool enable) { floodGuard = enable; }
+    bool isFloodGuardEnabled() const { return floodGuard; }
+    void setFloodMotionFraction(double fraction) { floodMotionFraction = std::clamp(fraction, 0.0, 1.0); }
+    double getFloodMotionFraction() const { return floodMotionFraction; }
+    // Horizontal bands processed in parallel (1 = untiled), from tile_bands
+    int getTileBands() const { return tileBands; }
+    const MorphologyChain& getMorphologyChain() const { return morphChain; }
     
     // Debug visualization control
     void enableVisualization(bool enable = true) { visualizationEnabled = enable; }
@@ -50,22 +347,274 @@ public:
     // Standalone visualization method
     void saveProcessingVisualization(const ProcessingResult& result, const std::string& outputPath = "");
     
-    // Adaptive contour detection methods
-    double calculateAdaptiveMinArea(const std::vector<std::vector<cv::Point>>& contours);
-    double calculateAdaptiveMinSolidity(const std::vector<std::vector<cv::Point>>& contours);
-    double calculateAdaptiveMaxAspectRatio(const std::vector<std::vector<cv::Point>>& contours);
+    // Adaptive thresholds currently applied (ADAPTIVE contour mode)
+    double getAdaptiveMinArea() const { return cachedAdaptiveMinArea; }
+    double getAdaptiveMinSolidity() const { return cachedAdaptiveMinSolidity; }
+    double getAdaptiveMaxAspectRatio() const { return cachedAdaptiveMaxAspectRatio; }
+    // Start from thresholds another processor of the same camera learned (a restart's
+    // predecessor) instead of the configured ones; they hold until the next refresh
+    void seedAdaptiveThresholds(double minArea, double minSolidity, double maxAspectRatio) {
+        cachedAdaptiveMinArea = minArea;
+        cachedAdaptiveMinSolidity = minSolidity;
+        cachedAdaptiveMaxAspectRatio = maxAspectRatio;
+    }
 
 private:
     // Configuration loading
-    void loadConfig(const std::string& configPath);
-    void initializeBackgroundSubtractor();
+    void loadConfig(const PipelineConfig& config);
+    // Creates the configured model; returns true if it was seeded from the loaded snapshot
+    bool initializeBackgroundSubtractor(const cv::Mat& firstFrame);
+    // Runs the model on @p frame, at background_update_scale of its size when below 1
+    // (the mask is scaled back up to the frame)
+    void applyBackgroundModel(cv::InputArray frame, cv::OutputArray mask, double learningRate);
+    // background_update_interval: true on every k-th frame, and whenever the last mask
+    // does not fit the frame; in between the last mask is reused
+    bool backgroundUpdateDue(const cv::Size& frameSize, const cv::Size& maskSize);
+    void loadBackgroundSnapshot();
+    void rebuildCachedResources();
 
-    // Frame state
-    cv::Mat prevFrame;
+    // Stage implementations writing into caller-provided destinations so the same code
+    // serves both the allocating path and the buffer-reuse path
+    cv::Mat decodeInput(const cv::Mat& frame, cv::Mat& buffer) const;
+    void preprocessInto(const cv::Mat& frame, cv::Mat& dst);
+    void detectMotionInto(const cv::Mat& processedFrame, cv::Mat& frameDiff, cv::Mat& thresh,
+                          const cv::Mat& excludedMask = cv::Mat());
+    void applyMorphologicalOpsInto(const cv::Mat& thresh, cv::Mat& dst);
+    bool applyOccupiedMorphology(const cv::Mat& thresh, cv::Mat& dst);
+    // Takes the occupancy windows if they describe @p mask (the last morphology output)
+    bool takeOccupancyWindows(const cv::Mat& mask);
+    void extractBlockRegions(Detections& detections);
+    void storePrevFrame(cv::Mat& processed);
+    // The frame before the previous one in THREE_FRAME mode; empty in TWO_FRAME mode or
+    // while the ring holds a single frame
+    const cv::Mat& olderReference() const;
+    int selectMotionThreshold(const cv::Mat& processedFrame, const cv::Mat& backgroundMask,
+                              const cv::Mat& excludedMask, cv::Mat& frameDiff);
+    // Speed and direction of each box (frame coordinates) from the motion history
+    void measureMotion(ProcessingResult& result) const;
+    void applyHysteresis(const cv::Mat& diff, const cv::Mat& backgroundMask, const cv::Mat& excludedMask,
+                         cv::Mat& thresh);
+    void updateRoiGeometry(const cv::Size& frameSize);
+    const cv::Mat& scaleForDetection(const cv::Mat& roiFrame, cv::Mat& scaled) const;
+    bool sampleMotionGate(const cv::Mat& roiFrame);
+    // roi_prediction: whether this frame runs on predictionWindows (false: full scan)
+    bool planPredictionWindows(const cv::Mat& roiFrame);
+    // Changed trigger samples outside predictionWindows since the last frame
+    int samplePredictionTrigger(const cv::Mat& roiFrame);
+    void refreshPredictionBackground();
+    // extractContours() with the statistics of each region; @p frameDiff (may be empty)
+    // gives the mean differences, detection coordinates throughout
+    void extractDetections(const cv::Mat& processed, const cv::Mat& frameDiff, Detections& detections);
+    void extractComponents(const cv::Mat& processed, const cv::Mat& frameDiff, int frameNumber,
+                           Detections& detections);
+    // extractComponents on packedMorphological, labelled by runLabeler
+    void extractPackedComponents(const cv::Mat& frameDiff, int frameNumber, Detections& detections);
+    // Whether this frame may use packed masks (the fused threshold decides the rest)
+    bool packedMasksApply() const;
+    // @p band selects the band's scratch when called from a tiled blur
+    void blurInto(cv::InputArray input, cv::OutputArray output, int band = -1) const;
+    // STACK blur on the host, banded when tiled; @p luma reduces a BGR input to luma first
+    void stackBlurInto(const cv::Mat& input, cv::Mat& output, bool luma);
+    int blurRadius() const;
+    // Radius the bilateral filter reads (bilateral_d / 2, or 1.5 sigma_space without a diameter)
+    int bilateralRadius() const;
+    bool edgePreservingBlur() const {
+        return blurType == BlurType::BILATERAL || blurType == BlurType::GUIDED ||
+               blurType == BlurType::DOMAIN_TRANSFORM;
+    }
+    void diffHistogram(const cv::Mat& processedFrame, const cv::Mat& backgroundMask,
+                       const cv::Mat& excludedMask, cv::Mat& frameDiff,
+                       MotionHistogram& histogram, int histogramRowStep);
+    void morphologyChainInto(const cv::Mat& thresh, cv::Mat& processed,
+                             MorphologyChain::Workspace& workspace) const;
+    cv::Rect toFrameCoordinates(const cv::Rect& detectionBounds) const;
+    cv::Point2f toFrameCoordinates(const cv::Point2f& detectionPoint) const;
+    bool refinementActive() const { return detectionRefinement && detectionSize != roiRect.size(); }
+    // Replaces @p detections (frame coordinates) with the refined regions
+    void refineDetections(const cv::Mat& image, Detections& detections);
+    void keepRefinementReference(const cv::Mat& image);
+
+    // Frame state: the last preprocessed frames, newest first (two in THREE_FRAME mode)
+    FrameRing previousFrames;
     bool firstFrame = true;
 
+    // Persistent per-resolution working buffers (used when reuseBuffers is set)
+    struct FrameBuffers {
+        cv::Mat original;
+        cv::Mat decoded;
+        cv::Mat scaled;
+        cv::Mat processed;
+        cv::Mat frameDiff;
+        cv::Mat thresh;
+        cv::Mat morphological;
+    };
+    // Stages 1-3 of processFrame(); false on the first frame (stored as the reference)
+    bool runHostStages(const cv::Mat& roiFrame, FrameBuffers& buffers, ProcessingResult& result);
+    bool runDeviceStages(const cv::Mat& roiFrame, FrameBuffers& buffers, ProcessingResult& result);
+    bool runBlockStages(const cv::Mat& roiFrame, FrameBuffers& buffers, ProcessingResult& result);
+    // Stages 1-3 on predictionWindows only (roi_prediction)
+    bool runPredictedStages(const cv::Mat& roiFrame, FrameBuffers& buffers, ProcessingResult& result);
+    FloodKind guardAgainstFlood(const cv::Mat& processed, FrameBuffers& buffers, ProcessingResult& result);
+    void preprocessOnDevice(const cv::UMat& frame, cv::UMat& processedFrame);
+
+    // OpenCL working set (compute_backend: opencl), allocated on the device once per size
+    struct DeviceBuffers {
+        cv::UMat input;
+        cv::UMat scaled;
+        cv::UMat processed;
+        cv::UMat previous;       // Reference frame, never downloaded
+        cv::UMat older;          // The frame before it (THREE_FRAME)
+        cv::UMat blurInput;
+        cv::UMat backgroundMask;
+        cv::UMat colorDiff;
+        cv::UMat frameDiff;
+        cv::UMat olderDiff;
+        cv::UMat motionMask;
+        cv::UMat excludedMask;   // roiExcludedMask, uploaded once per ROI geometry
+        cv::UMat thresh;
+        cv::UMat morphPing;
+        cv::UMat morphPong;
+        std::vector<cv::UMat> planes;
+    };
+    DeviceBuffers deviceBuffers;
+    bool reuseBuffers = false;
+    unsigned retainedStages = STAGE_ALL;
+    bool retainsStage(ResultStage stage) const {
+        return visualizationEnabled || (retainedStages & stage) != 0;
+    }
+    FrameBuffers workBuffers;
+    cv::Mat bgMaskBuffer;
+    cv::Mat motionMaskBuffer;
+    cv::Mat colorDiffBuffer;
+    cv::Mat olderDiffBuffer;
+    cv::Mat blurInputBuffer;
+
+    // Region of interest / exclusion zones (rebuilt lazily per input resolution)
+    std::vector<std::vector<cv::Point>> roiPolygons;
+    std::vector<std::vector<cv::Point>> exclusionPolygons;
+    cv::Size roiFrameSize;  // Input size roiRect and roiExcludedMask were built for
+    cv::Rect roiRect;       // Processed crop of the input frame
+    cv::Mat roiExcludedMask;  // Detection-sized, 255 = masked out; empty when nothing is masked
+
+    // Tiled execution: blur, frame difference, threshold and morphology run on this many
+    // horizontal bands in parallel (cv::parallel_for_), bit-identical to 1 = untiled
+    int tileBands = 1;
+    std::vector<cv::Mat> bandScratch;             // One output per band (with halo rows)
+    std::vector<MotionHistogram> bandHistograms;  // One histogram per band
+    std::vector<MorphologyChain::Workspace> bandMorphWorkspaces;  // One per band
+    std::vector<StackBlur::Workspace> bandStackBlurWorkspaces;    // One per band
+    mutable std::vector<FixedGaussianBlur::Workspace> bandGaussianWorkspaces;  // One per band
+
+    // Tile occupancy: windows of the last morphology output that hold all of its motion
+    int occupancyTileSize = 0;           // 0 = off
+    double occupancyMaxFraction = 0.3;   // Larger window area: process the whole mask
+    TileOccupancy tileOccupancy;
+    std::vector<cv::Rect> occupancyWindows;
+    const uchar* occupancyMask = nullptr;  // Data of the mask the windows describe
+    double occupancyCoverage = 1.0;        // Window area / mask area of that mask
+    cv::Mat occupancyScratch;              // Chain output of one window plus its halo
+    std::vector<std::vector<cv::Point>> windowContourBuffer;
+
+    // Motion gate: skip frames whose sparse sample barely differs from the reference
+    bool motionGate = false;
+    int motionGatePixelDelta = 25;         // Gray-level change that marks a sample as changed
+    int motionGateMinPixels = 4;           // Changed samples needed to process the frame
+    int motionGateBackgroundInterval = 10; // Skipped frames between background-model updates
+    cv::Mat gateReference;                 // Sample of the frame held in prevFrame
+    cv::Mat gateSample;                    // Sample of the current frame
+    cv::Mat gateSampleBuffer;
+    size_t gatedFrameCount = 0;
+    int gatedFramesSinceBackgroundUpdate = 0;
+
+    // Temporal ROI prediction: windows around the last boxes between full scans
+    bool roiPrediction = false;
+    int roiPredictionMargin = 32;            // Detection pixels around a box or hint
+    int roiPredictionFullScanInterval = 15;  // Frames between full scans
+    int roiPredictionTriggerSamples = 8;     // Changed samples outside the windows forcing a full scan (0 = off)
+    double roiPredictionMaxFraction = 0.5;   // Window area above which a frame is scanned whole
+    int framesSinceFullScan = 0;
+    std::vector<cv::Rect> predictionBoxes;    // Last frame's boxes, detection coordinates
+    std::vector<cv::Rect> predictionHints;    // setPredictedRegions(), frame coordinates
+    std::vector<cv::Rect> predictionWindows;  // This frame's windows, disjoint, detection coordinates
+    cv::Mat predictionSample;                 // Trigger samples of the current and the last frame
+    cv::Mat predictionSampleReference;
+    cv::Mat predictionSampleDiff;
+    cv::Mat predictionBackground;             // Background image at the last full scan (CV_8UC1)
+    cv::Mat predictionScratch;                // One window plus its blur halo
+    cv::Mat predictionDiff;
+    std::atomic<uint64_t> predictedFrameCount{0};
+
+    // Flood guard: whole-frame changes (light, camera shake) produce no boxes
+    bool floodGuard = false;
+    double floodMotionFraction = 0.35;   // Mask fraction that makes a frame a flood candidate
+    bool floodCompensateShift = true;    // Re-difference against the reference shifted by the estimate
+    int floodThumbnailWidth = 160;       // Columns of the phase-correlation thumbnails
+    double floodMinShift = 1.0;          // Detection pixels; smaller estimates count as no shift
+    double floodMaxShift = 16.0;         // Detection pixels; larger shifts are not compensated
+    double floodMinResponse = 0.1;       // Phase-correlation peak needed to trust the estimate
+    std::atomic<uint64_t> floodFrameCount{0};
+    std::atomic<uint64_t> shiftCompensatedFrameCount{0};
+    cv::Mat floodThumbCurrent;           // CV_32F thumbnails of the frame and its reference
+    cv::Mat floodThumbReference;
+    cv::Mat floodThumbScratch;
+    cv::Mat floodWindow;                 // Hanning window of the thumbnail size
+    cv::Mat floodWarped;                 // Reference shifted onto the frame
+
+    // Downscaled detection
+    double detectionScale = 1.0;
+    cv::Size detectionSize;         // roiRect size after scaling
+    double contourAreaScale = 1.0;  // Full-resolution pixels per detection pixel
+
+    // Coarse-to-fine refinement (full-resolution windows around downscaled boxes)
+    bool detectionRefinement = false;
+    int refinementPadding = 8;               // Full-resolution pixels around each coarse box
+    cv::Mat refinementReference;             // Previous decoded input frame, full resolution
+    cv::Mat refinementReferenceBuffer;       // Its copy, once the caller is seen reusing buffers
+    bool refinementCopiesReference = false;
+    cv::Mat roiExcludedMaskFull;             // roiExcludedMask at full resolution (refinement only)
+    std::vector<cv::Rect> refinementWindows;
+    Detections refinedDetections;            // refineDetections() output, swapped with the frame's
+    cv::Mat refinementCurrent;               // Window scratch: luma of both frames, then the mask
+    cv::Mat refinementPrevious;
+    cv::Mat refinementMask;
+
     // Background subtraction
     cv::Ptr<cv::BackgroundSubtractor> bgSubtractor;
+    bool backgroundModelCreated = false;
+    int framesSinceBackgroundUpdate = 0;
+    cv::Mat backgroundSmallFrame;  // Downscaled model input (background_update_scale < 1)
+    cv::Mat backgroundSmallMask;
+    std::atomic<uint64_t> backgroundModelResets{0};
+
+    // Background snapshots (warm start across restarts)
+    std::string cameraId = "default";          // Snapshot file key
+    std::string backgroundSnapshotDir;         // Empty = snapshots disabled
+    int backgroundSnapshotMaxAgeSeconds = 3600;  // Older snapshots are ignored (0 = any age)
+    int backgroundSnapshotIntervalFrames = 0;  // Periodic saves (0 = only saveBackgroundSnapshot())
+    double backgroundSnapshotMaxDiff = 40.0;   // Mean gray-level distance to the first frame
+    cv::Mat pendingBackground;                 // Loaded snapshot waiting for the first model
+    bool backgroundRestored = false;
+    int framesSinceBackgroundSnapshot = 0;
+
+    std::shared_ptr<const PipelineConfig> pipelineConfig;
+
+    // Config-derived resources (rebuilt by loadConfig / reloadConfig, not per frame)
+    cv::Ptr<cv::CLAHE> clahe;
+    CachedClahe cachedClahe;                  // CACHED CLAHE: tile tables kept across frames
+    cv::Mat morphKernel;
+    MorphologyChain morphChain;               // Planned close/open/dilate/erode sequence
+    std::vector<MorphologyChain::Operation> morphSteps;  // The unmerged steps (device path)
+    MorphologyChain::Workspace morphWorkspace;  // Ping-pong buffers of the untiled chain
+    EdgePreservingFilter edgeFilter;          // GUIDED / DOMAIN_TRANSFORM blur, from the bilateral settings
+    // Scratch of edgeFilter; blurInto is const, and the edge filters never run banded
+    mutable EdgePreservingFilter::Workspace edgeFilterWorkspace;
+    StackBlur stackBlur;  // STACK blur, radius matched to gaussian_blur_size
+    mutable StackBlur::Workspace stackBlurWorkspace;  // Scratch of the untiled stack blur
+    FixedGaussianBlur fixedGaussian;  // GAUSSIAN blur unrolled for gaussian_blur_size, when it is a common size
+    mutable FixedGaussianBlur::Workspace gaussianWorkspace;  // Scratch of the untiled fixed-size blur
+    // Settings the resources above were built with (rebuildCachedResources skips unchanged ones)
+    std::tuple<double, int, double, int, double> builtClaheSettings;
+    std::tuple<int, bool, bool, bool, bool, bool> builtMorphSettings;
 
     // ===============================
     // CONFIGURATION PARAMETERS
@@ -78,21 +627,67 @@ private:
     int maxThreshold;
     
     // INPUT COLOR PROCESSING
-    std::string processingMode;
+    ProcessingMode processingMode;
+    InputFormat inputFormat = InputFormat::BGR;
     
     // IMAGE PREPROCESSING
     bool contrastEnhancement;
-    std::string blurType;
+    BlurType blurType;
     double claheClipLimit;
     int claheTileSize;
+    ClaheMode claheMode = ClaheMode::FULL;
+    int claheUpdateInterval = 30;    // Frames between tile table fits (CACHED)
+    double claheDriftLimit = 8.0;    // Mean gray level change forcing an early fit (CACHED)
+    double claheLutScale = 0.5;      // Resolution the tile tables are fitted at (CACHED)
     int gaussianBlurSize;
     int medianBlurSize;
     int bilateralD;
     double bilateralSigmaColor;
     double bilateralSigmaSpace;
+    int guidedSubsample = 2;  // GUIDED: fit the filter coefficients at 1/n resolution
     
     // MOTION DETECTION METHODS
+    DetectionMethod detectionMethod = DetectionMethod::PIXEL;
+    int blockSize = 16;        // BLOCK: block side in detection pixels
+    int blockThreshold = 12;   // BLOCK: mean absolute difference of a moving block
+    int blockHistory = 32;     // BLOCK: frames the block background averages
+    int blockMinBlocks = 1;    // BLOCK: smallest region kept, in blocks
+    std::unique_ptr<BlockMotionMap> blockMotion;  // Built by rebuildCachedResources()
+    std::tuple<int, int> builtBlockSettings;
+    cv::Mat blockGrid;         // Blocks above the threshold (255)
+    cv::Mat blockExcluded;     // Blocks mostly masked by roiExcludedMask (255); grid-sized
+    DifferencingMode differencingMode = DifferencingMode::TWO_FRAME;
     bool backgroundSubtraction;
+    BackgroundModel backgroundModel = BackgroundModel::MOG2;
+    int backgroundHistory = 500;               // Frames the model remembers
+    double backgroundVarThreshold = 16.0;      // MOG2 squared Mahalanobis distance
+    double backgroundKnnThreshold = 400.0;     // KNN squared distance
+    bool backgroundDetectShadows = true;       // MOG2 / KNN: shadows masked as 127
+    int backgroundForegroundThreshold = 25;    // Running average / median gray-level distance
+    double backgroundLearningRate = -1.0;      // -1 = derived from the history
+    int backgroundUpdateInterval = 1;          // Model learns on every k-th frame
+    double backgroundUpdateScale = 1.0;        // Model runs at this fraction of the detection size
+    
+    // MOTION THRESHOLD
+    ThresholdMode thresholdMode = ThresholdMode::OTSU;
+    ComputeBackend computeBackend = ComputeBackend::CPU;
+    int otsuUpdateInterval = 30;     // Frames between Otsu recomputation (CACHED)
+    double otsuDriftLimit = 0.1;     // Histogram drift forcing an early recomputation (CACHED)
+    int minMotionThreshold = 0;      // Floor so motionless frames cannot pick a noise-level threshold
+    // Hysteresis: the mask grows from pixels above the threshold over connected pixels above
+    // this fraction of it (0 = single threshold)
+    double hysteresisLowRatio = 0.0;
+    std::vector<int> hysteresisStack;
+    int lastHysteresisGrowth = 0;
+
+    // MOTION HISTORY (speed/direction of the detected boxes, pixel paths only)
+    MotionHistory motionHistory;
+    
+    // Threshold cache (CACHED mode)
+    int cachedMotionThreshold = -1;  // -1 = recompute on the next frame
+    int framesSinceThresholdUpdate = 0;
+    MotionHistogram thresholdReferenceHistogram{};
+    int lastMotionThreshold = 0;
     
     // MORPHOLOGICAL OPERATIONS
     bool morphology;
@@ -101,13 +696,35 @@ private:
     bool morphOpen;
     bool dilation;
     bool erosion;
+    bool morphApproximate = false;  // Square kernel via O(1)-per-pixel line filters
     
     // CONTOUR PROCESSING
     bool convexHull;
     bool contourApproximation;
     bool contourFiltering;
     double contourEpsilonFactor;
-    std::string contourDetectionMode;
+    ContourMode contourMode;
+    ExtractionMethod extractionMethod = ExtractionMethod::CONTOURS;
+    int maxContoursPerFrame = 0;  // 0 = no limit
+    std::vector<std::pair<double, int>> candidateRanks;  // Scratch of the cap: (area, index)
+    std::vector<int> componentOrder;                     // Labels kept by the cap, in label order
+    cv::Mat componentLabels;     // CV_32S labels of the last mask (COMPONENTS)
+    // Packed masks: this frame's mask is packedThresh / packedMorphological, not the byte buffers
+    bool packedMasks = false;
+    bool packedMaskFrame = false;
+    PackedMask packedThresh;
+    PackedMask packedMorphological;
+    PackedMask::Scratch packedScratch;
+    RunLabeler runLabeler;
+    bool motionMaskRle = false;
+    cv::Mat componentStats;
+    cv::Mat componentCentroids;
+    // Contour scratch (CONTOURS), kept across frames so steady state reuses its capacity
+    std::vector<std::vector<cv::Point>> contourBuffer;
+    // Area / aspect / solidity filter of both extraction methods; rebuilt with the config
+    ContourFilter contourFilter;
+    ExtractionStats lastExtraction;
+    StageTimings stageTimings;
     
     // Permissive mode settings
     double permissiveMinArea;
@@ -117,16 +734,37 @@ private:
     // Adaptive calculation cache
     int adaptiveUpdateInterval;  // frames between adaptive recalculation
     int lastAdaptiveUpdate;     // frame count of last update
+    int contourFrameCount = 0;  // masks passed to extractContours
     double cachedAdaptiveMinArea;
     double cachedAdaptiveMinSolidity;
     double cachedAdaptiveMaxAspectRatio;
+    // Streaming percentiles of the contours seen since the last update
+    StreamingQuantile minAreaQuantile{0.1};
+    StreamingQuantile minSolidityQuantile{0.25};
+    StreamingQuantile maxAspectRatioQuantile{0.9};
+    void updateAdaptiveThresholds();
+    // Thresholds for a frame's mask (refreshes the adaptive ones when due)
+    ContourFilter::Thresholds contourThresholds(int frameNumber);
+    // lastExtraction from contourFilter's counts of the frame
+    ExtractionStats extractionStats(bool windowed, int droppedOverCap) const;
+    // max_contours_per_frame: keep the largest contours, in their traced order; returns the number dropped
+    int capContours(std::vector<std::vector<cv::Point>>& contours);
+    // componentOrder = the @p budget largest labels of componentStats (all when they fit)
+    void selectComponents(int labelCount, int budget);
+    // componentOrder = the @p budget largest of components [first, first + count), by
+    // @p pixelsOf(index), in index order
+    template <typename PixelsOf>
+    void selectLargest(int first, int count, int budget, PixelsOf pixelsOf);
     
     // Debug visualization control
     bool visualizationEnabled = false;
     std::string visualizationPath = "debug_output";
     
-    // Visualization helper methods
+    // Visualization helper methods. The returned image is a reused canvas, overwritten by
+    // the next call.
     cv::Mat createProcessingVisualization(const ProcessingResult& result) const;
+    mutable cv::Mat visualizationCanvas;   // Sized once per frame size
+    mutable cv::Mat visualizationScratch;  // Cell-sized grayscale step before color conversion
     void drawMotionBoxes(cv::Mat& image, const std::vector<cv::Rect>& detectedBounds) const;
     
 
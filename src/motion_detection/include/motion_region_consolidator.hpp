@@ -1,23 +1,53 @@
 #ifndef MOTION_REGION_CONSOLIDATOR_HPP
 #define MOTION_REGION_CONSOLIDATOR_HPP
 
+#include <cstdint>
+#include <memory_resource>
 #include <opencv2/core.hpp>
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/imgproc.hpp>
+#include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
-#include "tracked_object.hpp"  // For TrackedObject
+#include "box_distance_kernel.hpp"   // For BoxArrays, DistanceMetric and its policies
+#include "box_grid_index.hpp"        // For BoxGridIndex
+#include "clustering_trace.hpp"      // For ClusteringTrace
+#include "detections.hpp"            // For Detections
+#include "motion_history.hpp"        // For RegionMotion
+#include "single_linkage_tree.hpp"   // For SingleLinkageTree
+#include "small_vector.hpp"          // For SmallVector
+#include "stage_timings.hpp"         // For StageTimings
+#include "tracked_object.hpp"        // For TrackedObject
+#include "tracked_object_store.hpp"  // For TrackedObjectStore
+
+// Object IDs of one region: almost always a handful, so up to 8 are kept without allocating
+using RegionObjectIds = SmallVector<int, 8>;
 
 /**
  * @brief Consolidated motion region containing multiple tracked objects
  */
 struct ConsolidatedRegion {
-    cv::Rect boundingBox;               // Combined bounding box
-    std::vector<int> trackedObjectIds;  // IDs of objects in this region
+    cv::Rect boundingBox;              // Combined bounding box
+    RegionObjectIds trackedObjectIds;  // IDs of objects in this region, each listed once
     int framesSinceLastUpdate;          // Tracking stability
 
-    ConsolidatedRegion(const cv::Rect& bbox, const std::vector<int>& ids)
-        : boundingBox(bbox), trackedObjectIds(ids), framesSinceLastUpdate(0) {}
+    // Best detection of RegionClassifier (when in-process classification is enabled)
+    std::string classLabel = "unknown";
+    float classConfidence = 0.0f;
+    int classId = -1;
+
+    // Speed and direction of its objects (motion_history enabled; not measured otherwise)
+    RegionMotion motion;
+
+    // Moving area of its objects' detections (frame pixels) and their area-weighted mean
+    // difference (0-255); 0 without detection statistics (see summarizeDetections)
+    float motionArea = 0.0f;
+    float meanDiff = 0.0f;
+
+    ConsolidatedRegion(const cv::Rect& bbox, RegionObjectIds ids)
+        : boundingBox(bbox), trackedObjectIds(std::move(ids)), framesSinceLastUpdate(0) {}
 };
 
 /**
@@ -34,12 +64,105 @@ struct ConsolidationConfig {
         0.3;  // Weight for edge proximity component in distance calculation (0.0-1.0)
     double maxEdgeDistance = 100.0;  // Maximum edge-to-edge distance to consider
 
+    // Box distance DBSCAN compares with eps (see DistanceMetric). The weights above belong
+    // to the default OverlapEdge; EdgeGap and Iou use maxEdgeDistance as their cap.
+    DistanceMetric distanceMetric = DistanceMetric::OverlapEdge;
+
     // Region management
     cv::Size frameSize = cv::Size(1920, 1080);  // Frame size for boundary checking
     int maxFramesWithoutUpdate = 10;            // Max frames before removing region
 
     // Expansion parameters (minimal expansion only)
     double regionExpansionFactor = 1.1;  // Small factor to expand bounding box slightly
+
+    // Use a grid index to evaluate only nearby pairs in DBSCAN (same clusters as a full scan)
+    bool useSpatialIndex = true;
+
+    // Form DBSCAN clusters with a union-find over the neighbor table instead of the
+    // queue-based expansion (same clusters, with the same border point assignment)
+    bool unionFindClustering = true;
+
+    // Frames with at least this many boxes evaluate the neighbor pairs in parallel stripes
+    // and join the core points with a lock-free union-find (0 = always serial). Same
+    // clusters as the serial path, which small frames keep to avoid the thread handoff.
+    int parallelClusteringMinBoxes = 2000;
+
+    // Carry DBSCAN neighbor relations over between frames, keyed by TrackedObject::id, and
+    // re-evaluate distances only for boxes that are new or moved (same clusters as a full
+    // rebuild; pays off once object IDs are stable across frames)
+    bool incrementalClustering = false;
+
+    // Keyframe consolidation: full DBSCAN only every keyframeInterval frames (1 = every
+    // frame). In between, each box attaches to the existing region that contains its center
+    // or overlaps it by at least keyframeAttachIou, in one O(n log n) sweep. A keyframe is
+    // forced when the box count moved by more than keyframeBoxCountChange (relative to the
+    // last keyframe) or when more than keyframeMaxUnassigned of the boxes attach nowhere.
+    int keyframeInterval = 1;
+    double keyframeBoxCountChange = 0.25;
+    double keyframeMaxUnassigned = 0.2;
+    double keyframeAttachIou = 0.1;
+
+    // Skip clustering on keyframes whose boxes (IDs and positions, each coordinate divided
+    // by memoizeQuantization pixels, 0 or 1 = exact) match the last keyframe's: the regions
+    // the last DBSCAN run built are reused, and once the regions stop changing from one
+    // such frame to the next, only framesSinceLastUpdate advances. Exact quantization gives
+    // the same regions as clustering every frame; coarser steps let jittering boxes count
+    // as unchanged, at the price of regions that lag them by up to the step.
+    bool memoizeUnchangedFrames = false;
+    int memoizeQuantization = 0;
+
+    // Decide DBSCAN neighbors with IntegerNeighborTest instead of double distances (no
+    // division or floating point per pair; same clusters except overlap ratios within
+    // 2^-20 of the eps boundary) and expand regions in fixed point; the neighbor test
+    // applies to the OverlapEdge metric only
+    bool integerGeometry = false;
+    // Resolution-independent eps and maxEdgeDistance as fractions of the frame diagonal
+    // (0 = use the pixel values above). They are resolved to pixels for every new frame size
+    // (see MotionRegionConsolidator::setFrameSize), so one config clusters a 4K camera and a
+    // downscaled 720p stream alike.
+    double epsFraction = 0.0;
+    double maxEdgeDistanceFraction = 0.0;
+
+    // Spatial hash bucket size as a fraction of the frame diagonal (0 = derived from
+    // maxEdgeDistance and the mean box extent)
+    double gridCellSize = 0.0;
+
+    // Fast pre-filter for DBSCAN pairs: boxes whose centers are farther apart than this
+    // fraction of the frame diagonal are never neighbors (0 = off)
+    double maxDistanceThreshold = 0.0;
+
+    // Region filters, applied to new regions before they are merged and to the regions
+    // returned each frame, so junk regions never reach visualization or persistence
+    int minObjectsPerRegion = 1;  // Clusters with fewer objects form no region
+    double minRegionArea = 0.0;   // Pixels (0 = no minimum)
+    double maxRegionArea = 0.0;   // Pixels (0 = no maximum)
+
+    // Min overlap (intersection over the smaller box) for a new region to merge into an
+    // existing one (0 = any overlap)
+    double overlapThreshold = 0.0;
+
+    // Region hierarchy: every frame's boxes are also clustered at each of these distance cuts,
+    // given as multiples of eps (e.g. {1, 3}: single birds, then flocks), all read off one
+    // single-linkage merge tree (see MotionRegionConsolidator::getRegionLevels()). Single
+    // linkage ignores minPts and integerGeometry; a cut at or above the metric's cap (see
+    // DistanceMetric) joins every box. Empty = off.
+    std::vector<double> hierarchyLevels;
+
+    // Pairwise DBSCAN decisions kept in memory for an on-demand dump (0 = off), and where
+    // the application writes the dump (see ClusteringTrace)
+    int clusteringTraceCapacity = 0;
+    std::string clusteringTracePath = "data/traces/clustering_trace.bin";
+};
+
+// How the frames since construction were consolidated (see ConsolidationConfig::keyframeInterval)
+struct KeyframeStats {
+    uint64_t keyframes = 0;            // Frames clustered with DBSCAN
+    uint64_t attachedFrames = 0;       // Frames whose boxes attached to the existing regions
+    uint64_t countTriggered = 0;       // Keyframes forced early by a box count change
+    uint64_t unassignedTriggered = 0;  // Attach attempts that fell back to DBSCAN
+    uint64_t unassignedBoxes = 0;      // Boxes left out of every region on attached frames
+    uint64_t memoizedFrames = 0;       // Keyframes that reused the last DBSCAN run's regions
+    uint64_t settledFrames = 0;        // Of those, frames that only advanced the region ages
 };
 
 /**
@@ -47,7 +170,8 @@ struct ConsolidationConfig {
  *
  * This class analyzes tracked objects from MotionProcessor and groups objects
  * using DBSCAN clustering algorithm with a custom distance metric that considers
- * both bounding box overlap and edge proximity. No size constraints are applied.
+ * both bounding box overlap and edge proximity. Regions outside the configured object
+ * count and area bounds are dropped (see ConsolidationConfig).
  */
 class MotionRegionConsolidator {
    public:
@@ -58,32 +182,173 @@ class MotionRegionConsolidator {
     std::vector<ConsolidatedRegion> consolidateRegions(
         const std::vector<TrackedObject>& trackedObjects);
 
+    // Same, reading IDs and boxes straight from the hot columns of a TrackedObjectStore
+    std::vector<ConsolidatedRegion> consolidateRegions(const TrackedObjectStore& trackedObjects);
+
+    /**
+     * @brief Same as consolidateRegions(), writing the regions into @p out
+     *
+     * @p out is overwritten; a caller that keeps it across frames (see MotionPipelineContext)
+     * reuses its capacity, and that of the ID vectors inside it, so steady-state frames do
+     * not allocate for their result.
+     * @param scratch Resource for the frame's DBSCAN temporaries (labels, neighbor table,
+     *                clusters), typically a FrameArena reset after the frame; nullptr = heap
+     */
+    void consolidateRegionsInto(const std::vector<TrackedObject>& trackedObjects,
+                                std::vector<ConsolidatedRegion>& out,
+                                std::pmr::memory_resource* scratch = nullptr);
+    void consolidateRegionsInto(const TrackedObjectStore& trackedObjects,
+                                std::vector<ConsolidatedRegion>& out,
+                                std::pmr::memory_resource* scratch = nullptr);
+
+    /**
+     * @brief Give each region the moving area and contrast of its objects' detections
+     *
+     * Row i of @p objects is row i of @p detections (ObjectTracker::update() and
+     * makeTrackedObjects() keep the detection order). motionArea sums the members' areas;
+     * meanDiff averages the measured mean differences weighted by area.
+     */
+    static void summarizeDetections(const TrackedObjectStore& objects, const Detections& detections,
+                                    std::vector<ConsolidatedRegion>& regions);
+
+    // DBSCAN step alone: clusters as indices into trackedObjects (public for testing and
+    // benchmarks; with incrementalClustering it updates the neighbor cache like a frame would)
+    std::vector<std::vector<int>> clusterObjects(const TrackedObjectStore& trackedObjects) {
+        const Clusters clusters = dbscanClustering(ObjectBoxes{trackedObjects.ids(), trackedObjects.bounds()},
+                                                   std::pmr::get_default_resource());
+        std::vector<std::vector<int>> result;
+        result.reserve(clusters.size());
+        for (const auto& cluster : clusters) result.emplace_back(cluster.begin(), cluster.end());
+        return result;
+    }
+
     // Processing with visualization
     std::vector<ConsolidatedRegion> consolidateRegionsWithVisualization(
         const std::vector<TrackedObject>& trackedObjects, const cv::Mat& inputImage,
         const std::string& outputImagePath = "");
 
+    // Queue the drawing consolidateRegionsWithVisualization() saves, for regions already computed
+    void saveVisualization(const std::vector<TrackedObject>& trackedObjects,
+                           const std::vector<ConsolidatedRegion>& regions, const cv::Mat& inputImage,
+                           const std::string& outputImagePath) const;
+
     // Standalone consolidation with visualization (no input image required)
     std::vector<ConsolidatedRegion> consolidateRegionsStandalone(
         const std::vector<TrackedObject>& trackedObjects, const std::string& outputImagePath = "");
 
-    // Configuration management
+    // Configuration management (getConfig() holds eps and maxEdgeDistance as resolved for the frame size)
     void updateConfig(const ConsolidationConfig& config);
     const ConsolidationConfig& getConfig() const { return config_; }
 
+    /**
+     * @brief Adopt the resolution of the incoming frames
+     *
+     * A no-op while the size is unchanged. A new size re-resolves the diagonal-relative
+     * parameters and drops the regions and neighbor cache, whose boxes belong to the old
+     * resolution.
+     */
+    void setFrameSize(const cv::Size& frameSize);
+
     // Region management
-    void clearRegions() { consolidatedRegions_.clear(); }
+    void clearRegions() {
+        consolidatedRegions_.clear();
+        clearNeighborCache();
+        haveKeyframe_ = false;
+        haveMemo_ = false;
+    }
     const std::vector<ConsolidatedRegion>& getCurrentRegions() const {
         return consolidatedRegions_;
     }
+    // Continue from regions another consolidator of the same camera had (getCurrentRegions()
+    // at @p frameSize, e.g. a stream migrating between nodes); the next frame is a keyframe
+    void restoreRegions(const cv::Size& frameSize, std::vector<ConsolidatedRegion> regions) {
+        setFrameSize(frameSize);
+        clearRegions();
+        consolidatedRegions_ = std::move(regions);
+    }
+
+    // Pairwise decisions of the last frames (clusteringTraceCapacity); requestDump() on it
+    // from any thread is written by the next consolidation
+    ClusteringTrace& clusteringTrace() { return trace_; }
+    const ClusteringTrace& clusteringTrace() const { return trace_; }
+
+    // CLUSTERING and REGION_MERGE latencies (empty unless built with ENABLE_STAGE_TIMING)
+    const StageTimings& getStageTimings() const { return stageTimings_; }
+    void resetStageTimings() { stageTimings_.reset(); }
+
+    const KeyframeStats& getKeyframeStats() const { return keyframeStats_; }
+
+    // The last frame's regions at each hierarchyLevels cut, in config order. They are not
+    // tracked across frames (framesSinceLastUpdate 0), but expanded and filtered like new
+    // DBSCAN regions. Empty without hierarchyLevels.
+    const std::vector<std::vector<ConsolidatedRegion>>& getRegionLevels() const { return regionLevels_; }
+    // The merge tree they were cut from (rows of the last frame's objects as leaves)
+    const SingleLinkageTree& getMergeTree() const { return mergeTree_; }
 
    private:
+    // IDs and boxes of one frame's objects (parallel arrays, borrowed from the caller)
+    struct ObjectBoxes {
+        const std::vector<int>& ids;
+        const std::vector<cv::Rect>& bounds;
+        size_t size() const { return ids.size(); }
+        bool empty() const { return ids.empty(); }
+    };
+
+    // Per-frame index lists, allocated from the frame's scratch resource
+    using IndexList = std::pmr::vector<int>;
+    using Clusters = std::pmr::vector<IndexList>;
+
+    // Updates consolidatedRegions_ with one frame's objects
+    void consolidate(const ObjectBoxes& objects, std::pmr::memory_resource* scratch);
+
+    // Symmetric eps-neighborhoods of one frame in CSR form (ascending indices per point)
+    struct NeighborTable {
+        explicit NeighborTable(std::pmr::memory_resource* scratch) : offsets(scratch), neighbors(scratch) {}
+        IndexList offsets;  // Row i spans neighbors[offsets[i], offsets[i + 1])
+        IndexList neighbors;
+        const int* begin(int i) const { return neighbors.data() + offsets[i]; }
+        const int* end(int i) const { return neighbors.data() + offsets[i + 1]; }
+        size_t degree(int i) const { return static_cast<size_t>(offsets[i + 1] - offsets[i]); }
+    };
+
     // DBSCAN clustering algorithm
-    std::vector<std::vector<int>> dbscanClustering(const std::vector<TrackedObject>& objects);
-    std::vector<int> rangeQuery(const std::vector<TrackedObject>& objects, int pointIdx,
-                                double eps);
-    std::vector<ConsolidatedRegion> createConsolidatedRegions(
-        const std::vector<TrackedObject>& objects, const std::vector<std::vector<int>>& clusters);
+    Clusters dbscanClustering(const ObjectBoxes& objects, std::pmr::memory_resource* scratch);
+    Clusters expandClusters(const NeighborTable& table, std::pmr::memory_resource* scratch) const;
+    Clusters unionFindClusters(const NeighborTable& table, std::pmr::memory_resource* scratch) const;
+    bool parallelClustering(int boxCount) const;
+    // Runs the instance of buildNeighborTableWith for config_.distanceMetric
+    NeighborTable buildNeighborTable(const ObjectBoxes& objects, std::pmr::memory_resource* scratch);
+    template <typename Distance>
+    NeighborTable buildNeighborTableWith(const ObjectBoxes& objects, std::pmr::memory_resource* scratch);
+    BoxDistanceParams distanceParams() const;
+    // BoxGridIndex cell size for queries reaching @p reach
+    double gridCellSize(const std::vector<cv::Rect>& rects, double reach) const;
+
+    // Region hierarchy (hierarchyLevels): edges within the largest cut, one tree, every level
+    void buildRegionLevels(const ObjectBoxes& objects, std::pmr::memory_resource* scratch);
+    template <typename Distance>
+    void collectMergeEdges(const ObjectBoxes& objects, double maxDistance);
+
+    // Incremental clustering: neighbor pairs between boxes unchanged since the last frame
+    bool seedPairsFromCache(const ObjectBoxes& objects,
+                            const std::pmr::unordered_map<int, int>& idToIndex,
+                            std::pmr::vector<char>& changed,
+                            std::pmr::vector<std::pair<int, int>>& pairs) const;
+    void storeNeighborCache(const ObjectBoxes& objects, const NeighborTable& table);
+    void clearNeighborCache() {
+        cachedBounds_.clear();
+        cachedNeighbors_.clear();
+    }
+    void createConsolidatedRegions(const ObjectBoxes& objects, const Clusters& clusters,
+                                   std::vector<ConsolidatedRegion>& regions);
+
+    // Keyframe consolidation: whether this frame runs DBSCAN, and the frames in between
+    bool keyframeDue(size_t objectCount);
+    bool attachToRegions(const ObjectBoxes& objects);
+
+    // Unchanged-frame memoization: fingerprint of the quantized boxes and the shortcut
+    uint64_t boxFingerprint(const ObjectBoxes& objects) const;
+    bool regionsSettled(const std::vector<ConsolidatedRegion>& before) const;
 
     // Distance calculation with overlap and edge awareness
     double calculateOverlapAwareDistance(const TrackedObject& obj1,
@@ -92,14 +357,20 @@ class MotionRegionConsolidator {
     double calculateEdgeDistance(const cv::Rect& rect1, const cv::Rect& rect2) const;
 
     // Region update and management
-    void updateExistingRegions(const std::vector<TrackedObject>& objects);
+    void updateExistingRegions(const ObjectBoxes& objects,
+                               const std::unordered_map<int, int>& idToIndex);
     void removeStaleRegions();
+    bool regionAreaAccepted(const cv::Rect& box) const;
+    bool overlapsEnoughToMerge(const cv::Rect& newBox, const cv::Rect& existingBox) const;
+    double frameDiagonal() const;
+    void resolveRelativeParameters();
     ConsolidatedRegion mergeRegions(const ConsolidatedRegion& region1,
-                                    const ConsolidatedRegion& region2);
+                                    const ConsolidatedRegion& region2) const;
+    void mergeOverlappingRegions(std::vector<ConsolidatedRegion>& regions) const;
 
     // Utility methods
-    cv::Rect calculateBoundingBox(const std::vector<TrackedObject>& objects,
-                                  const std::vector<int>& indices) const;
+    // Union of the boxes of @p count objects at the rows given by @p indices
+    cv::Rect calculateBoundingBox(const ObjectBoxes& objects, const int* indices, size_t count) const;
     cv::Rect expandBoundingBox(const cv::Rect& bbox, double expansionFactor,
                                const cv::Size& frameSize);
 
@@ -114,6 +385,45 @@ class MotionRegionConsolidator {
     ConsolidationConfig config_;
     std::vector<ConsolidatedRegion> consolidatedRegions_;
     int frameCounter_;
+
+    // Per-frame scratch, kept so steady-state frames reuse its capacity
+    std::vector<ConsolidatedRegion> newRegions_;
+    std::unordered_map<int, int> idToIndex_;
+    std::vector<int> updatedIndices_;     // Rows of one existing region's surviving objects
+    std::vector<int> objectIds_;          // vector<TrackedObject> input only
+    std::vector<cv::Rect> objectBounds_;
+    std::vector<int> attachOrder_;        // attachToRegions() sweep: regions, then object rows
+    std::vector<int> activeRegions_;
+    std::vector<int> activeObjects_;
+    std::vector<int> attachments_;        // Region of each object row, -1 = none
+    std::vector<double> attachScores_;
+
+    // Frames since the last DBSCAN run and its box count (keyframeInterval > 1 only)
+    int framesSinceKeyframe_ = 0;
+    size_t keyframeObjectCount_ = 0;
+    bool haveKeyframe_ = false;
+    KeyframeStats keyframeStats_;
+
+    // Fingerprint of the last keyframe's boxes and the new regions it clustered, and whether
+    // the last frame left the regions as it found them (memoizeUnchangedFrames only)
+    uint64_t memoFingerprint_ = 0;
+    bool haveMemo_ = false;
+    bool memoSettled_ = false;
+    std::vector<ConsolidatedRegion> memoRegions_;
+    std::vector<ConsolidatedRegion> memoBefore_;
+
+    // Merge tree of the last frame and its regions per level (hierarchyLevels only)
+    std::vector<SingleLinkageTree::Edge> mergeEdges_;
+    SingleLinkageTree mergeTree_;
+    std::vector<int> levelLabels_;
+    std::vector<std::vector<ConsolidatedRegion>> regionLevels_;
+
+    // Last frame's boxes and neighbor IDs per object ID (incrementalClustering only)
+    std::unordered_map<int, cv::Rect> cachedBounds_;
+    std::unordered_map<int, std::vector<int>> cachedNeighbors_;
+
+    StageTimings stageTimings_;
+    ClusteringTrace trace_;
 };
 
 #endif  // MOTION_REGION_CONSOLIDATOR_HPP
\ No newline at end of file
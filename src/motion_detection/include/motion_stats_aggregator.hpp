@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Detection totals of one stream over one wall-clock minute
+ *
+ * Stored as one document per (source, minute) in the motion stats collection, so dashboards
+ * read a document per minute instead of scanning every saved frame.
+ */
+struct MotionMinuteSummary {
+    std::string source;
+    int64_t minuteStart = 0;     // Unix seconds, a multiple of 60
+    uint64_t frames = 0;         // Frames that reached the render stage
+    uint64_t motionFrames = 0;   // Frames with at least one motion box
+    uint64_t motionBoxes = 0;    // Individual motion boxes over all frames
+    uint64_t regions = 0;        // Consolidated regions over all frames
+    uint64_t maxRegions = 0;     // Most consolidated regions in one frame
+    // Capture-to-render latency of the minute's frames
+    double latencyP50Ms = 0.0;
+    double latencyP95Ms = 0.0;
+    double latencyP99Ms = 0.0;
+    double latencyMaxMs = 0.0;
+
+    double meanBoxesPerFrame() const {
+        return frames ? static_cast<double>(motionBoxes) / static_cast<double>(frames) : 0.0;
+    }
+
+    // Document key: "<source>:<minuteStart>"
+    std::string id() const { return source + ":" + std::to_string(minuteStart); }
+};
+
+/**
+ * @brief Rolls per-frame detection results up into per-minute summaries
+ *
+ * record() is called once per frame; when a frame falls into a later minute than the one
+ * being accumulated, the finished minute is returned for the caller to hand to the
+ * persistence worker. Latencies are kept exactly (a minute holds at most a few thousand
+ * samples) and reduced to percentiles once, when the minute closes.
+ *
+ * Thread safety: none; owned by the stage thread that calls record().
+ */
+class MotionStatsAggregator {
+   public:
+    explicit MotionStatsAggregator(std::string source = "motion_detection_cpp");
+
+    /**
+     * @brief Count one frame
+     * @param unixSeconds Wall-clock time of the frame
+     * @param motionBoxes Individual motion boxes detected in the frame
+     * @param regions Consolidated regions reported for the frame
+     * @param latencyMs Capture-to-render latency of the frame
+     * @return The previous minute's summary once this frame starts a new minute
+     */
+    std::optional<MotionMinuteSummary> record(int64_t unixSeconds, size_t motionBoxes,
+                                              size_t regions, double latencyMs);
+
+    // Summary of the minute in progress (e.g. at shutdown); nullopt if no frame was recorded
+    std::optional<MotionMinuteSummary> flush();
+
+   private:
+    std::string source_;
+    MotionMinuteSummary current_;
+    std::vector<double> latencies_;
+    bool active_ = false;
+};
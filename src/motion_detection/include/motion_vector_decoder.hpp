@@ -0,0 +1,73 @@
+#pragma once
+
+#include <memory>
+#include <opencv2/core.hpp>
+#include <string>
+
+#include "motion_vector_map.hpp"
+
+/**
+ * @brief Video decoder that exports the encoder's motion vectors of every frame
+ *
+ * Decodes a file or RTSP stream with libavformat / libavcodec directly (built with
+ * ENABLE_FFMPEG_MOTION_VECTORS, which defines BIRDS_HAVE_LIBAV). The decoder runs with
+ * flags2=+export_mvs, so each decoded frame carries its AV_FRAME_DATA_MOTION_VECTORS side
+ * data. decode() writes those vectors into a MotionVectorMap. The pixels stay in the
+ * decoder's YUV frame, and retrieve() converts them only for frames the caller keeps:
+ * - luma comes straight from the Y plane for planar YUV and NV12 frames;
+ * - BGR, and luma of any other layout, goes through swscale.
+ *
+ * libavcodec exports vectors for H.264 and the MPEG-1/2/4 decoders. Other codecs (HEVC
+ * among them) decode without side data; hasVectors() is false for their frames.
+ *
+ * Without libav in the build, available() is false and open() fails.
+ *
+ * Thread safety: none; open, decode and retrieve from one thread.
+ */
+class MotionVectorDecoder {
+   public:
+    MotionVectorDecoder();
+    ~MotionVectorDecoder();
+
+    MotionVectorDecoder(const MotionVectorDecoder&) = delete;
+    MotionVectorDecoder& operator=(const MotionVectorDecoder&) = delete;
+
+    // Whether the build links libav
+    static bool available();
+
+    /**
+     * @brief Open the video stream of a file or URL (RTSP over TCP)
+     * @return false (after logging why) if there is no decodable video stream
+     */
+    bool open(const std::string& source);
+    bool isOpened() const;
+    void release();
+
+    /**
+     * @brief Decode the next frame and put its vectors into @p map (reset to the frame size)
+     * @return false at end of stream or on a read error
+     */
+    bool decode(MotionVectorMap& map);
+
+    // The last decoded frame is an I frame (no vectors to export)
+    bool intraFrame() const;
+    // The last decoded frame carried motion vector side data
+    bool hasVectors() const;
+    // Presentation time of the last decoded frame in milliseconds (0 if unknown)
+    double timestampMs() const;
+
+    /**
+     * @brief Convert the last decoded frame into @p frame (CV_8UC1 luma or CV_8UC3 BGR)
+     *
+     * Writes into @p frame's buffer when it already has the right size and type.
+     */
+    bool retrieve(cv::Mat& frame, bool luma);
+
+    // Coded size and average frame rate from the stream metadata (empty / 0 if unknown)
+    cv::Size frameSize() const;
+    double fps() const;
+
+   private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+/**
+ * @brief Macroblock grid of a frame's encoder motion vectors, grouped into candidate regions
+ *
+ * The decoder reports one vector per inter-predicted block (16x16 down to 4x4 partitions,
+ * two for bi-predicted B blocks). addVector() stores the largest displacement per grid
+ * cell. It also marks the cells each block covers.
+ *
+ * flag() sets the cells that moved by at least the minimum. With uncoveredAsMotion it also
+ * sets the cells no vector covers: in a P or B frame those are intra-coded macroblocks,
+ * which encoders choose for newly uncovered content. regions() then joins the flagged cells
+ * 8-connected (as block detection does with its SAD grid) and returns their pixel bounds.
+ *
+ * Not thread-safe; the grids keep their size between frames.
+ */
+class MotionVectorMap {
+   public:
+    // @param blockSize Cell side in pixels (16: an H.264 / MPEG-4 macroblock)
+    explicit MotionVectorMap(int blockSize = 16);
+
+    int blockSize() const { return blockSize_; }
+
+    // Start the next frame: every cell unflagged, uncovered and at zero motion
+    void reset(const cv::Size& frameSize);
+
+    /**
+     * @brief Record the vector of one prediction block
+     * @param block Pixels the block covers in the current frame (clipped to the frame)
+     * @param dx, dy Displacement in pixels (the decoder's motion / motion_scale)
+     */
+    void addVector(const cv::Rect& block, float dx, float dy);
+
+    /**
+     * @brief Flag the cells that moved at least @p minMotion pixels
+     * @param uncoveredAsMotion Also flag cells no vector covered (intra macroblocks)
+     * @return Number of flagged cells
+     */
+    int flag(double minMotion, bool uncoveredAsMotion);
+
+    /**
+     * @brief Pixel bounds of each 8-connected group of at least @p minBlocks flagged cells
+     *
+     * The bounds are block-aligned and clipped to the frame. Uses the last flag() result.
+     */
+    std::vector<cv::Rect> regions(int minBlocks);
+
+    size_t vectorCount() const { return vectorCount_; }
+    cv::Size frameSize() const { return frameSize_; }
+    // CV_32FC1 largest displacement per cell
+    const cv::Mat& motion() const { return motion_; }
+    // CV_8UC1 255 for flagged cells
+    const cv::Mat& flags() const { return flags_; }
+
+   private:
+    int blockSize_;
+    cv::Size frameSize_;
+    size_t vectorCount_ = 0;
+    cv::Mat motion_;   // CV_32FC1
+    cv::Mat covered_;  // CV_8UC1, nonzero where a vector covered the cell
+    cv::Mat flags_;    // CV_8UC1
+    cv::Mat labels_, stats_, centroids_;
+};
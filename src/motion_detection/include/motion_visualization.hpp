@@ -9,6 +9,7 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#include <chrono>
 #include <vector>
 #include <string>
 
@@ -39,8 +40,31 @@ public:
     void setSplitScreenEnabled(bool enabled);
     void setWindowName(const std::string& windowName);
     
+    /**
+     * @brief Enable preview rendering for live debug display
+     *
+     * In preview mode the split screen is redrawn at most @p previewFps times per second
+     * (0 = every call); in between createSplitScreenVisualization() returns the last
+     * rendering without touching its inputs. The returned image is then the persistent
+     * canvas itself, overwritten by the next rendering, so clone it to keep it.
+     *
+     * @param enabled Whether preview mode is on
+     * @param previewFps Maximum renderings per second
+     */
+    void setPreviewRendering(bool enabled, double previewFps = 10.0);
+    
+    /**
+     * @brief Whether the next split screen would be redrawn
+     *
+     * Lets callers skip preparing the stage images when the preview is not due.
+     */
+    bool isRenderDue() const;
+    
     /**
      * @brief Create a split-screen visualization showing processing stages
+     *
+     * Each stage is resized to its panel first and converted to color at panel size,
+     * directly into a canvas that is only reallocated when the frame size changes.
      * @param originalFrame Original input frame
      * @param processedFrame Preprocessed frame
      * @param frameDiff Frame difference image
@@ -150,9 +174,20 @@ private:
         int padding;
     } layoutConfig;
     
+    // Split-screen canvas, sized in initializeLayoutConfig
+    cv::Mat canvas;
+    cv::Mat panelScratch;  // Panel-sized single-channel stage before color conversion
+    cv::Size canvasFrameSize;
+    
+    // Preview rendering
+    bool previewRendering;
+    double previewFps;
+    std::chrono::steady_clock::time_point lastRenderTime;
+    
     // Helper methods
     void initializeLayoutConfig(int frameWidth, int frameHeight);
     cv::Mat resizeForDisplay(const cv::Mat& image, cv::Size targetSize);
+    void renderPanel(const cv::Mat& image, const cv::Rect& panel);
     void addLabel(cv::Mat& image, const std::string& label, cv::Point position);
     cv::Scalar getColorForObject(int objectId);
     
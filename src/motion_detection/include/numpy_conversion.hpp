@@ -0,0 +1,99 @@
+#pragma once
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+
+#include <opencv2/core.hpp>
+#include <stdexcept>
+#include <vector>
+
+namespace py = pybind11;
+
+/**
+ * @file numpy_conversion.hpp
+ * @brief Zero-copy cv::Mat <-> numpy conversion shared by the extension module and the
+ *        embedded interpreter
+ *
+ * Only the pybind11 translation units include this header; the core library stays free of
+ * Python dependencies.
+ */
+
+/**
+ * @brief Wrap a uint8 numpy array (H x W or H x W x C) as a cv::Mat
+ *
+ * C-contiguous arrays are wrapped in place: the Mat borrows the array's buffer and does NOT
+ * own it, so the array must outlive the Mat (clone() the Mat to keep it longer). Any other
+ * layout or dtype is converted once into a fresh, owning Mat.
+ *
+ * @throws std::runtime_error for arrays that are not 2-D or 3-D
+ */
+inline cv::Mat numpy_to_cv_mat(const py::array& input) {
+    if (input.ndim() != 2 && input.ndim() != 3) {
+        throw std::runtime_error("Number of dimensions must be 2 or 3 (height, width[, channels])");
+    }
+
+    using ContiguousArray = py::array_t<unsigned char, py::array::c_style | py::array::forcecast>;
+    const bool zeroCopy = py::isinstance<py::array_t<unsigned char>>(input) &&
+                          (input.flags() & py::array::c_style);
+    ContiguousArray contiguous = zeroCopy ? py::reinterpret_borrow<ContiguousArray>(input)
+                                          : ContiguousArray::ensure(input);
+    if (!contiguous) throw std::runtime_error("Array is not convertible to uint8");
+
+    const int height = static_cast<int>(contiguous.shape(0));
+    const int width = static_cast<int>(contiguous.shape(1));
+    const int channels = contiguous.ndim() == 3 ? static_cast<int>(contiguous.shape(2)) : 1;
+    if (channels < 1 || channels > CV_CN_MAX) {
+        throw std::runtime_error("Unsupported channel count");
+    }
+
+    cv::Mat view(height, width, CV_8UC(channels), const_cast<unsigned char*>(contiguous.data()));
+    // A converted temporary dies with this scope, so only borrowed views skip the copy
+    return zeroCopy ? view : view.clone();
+}
+
+/**
+ * @brief Expose a cv::Mat to Python as a uint8 numpy array without copying pixels
+ *
+ * The array references the Mat's buffer through a capsule that holds its own cv::Mat
+ * header, so the pixel data stays alive (via the Mat refcount) for as long as Python keeps
+ * the array. Row padding is preserved through the strides. Writes from Python are visible
+ * to every Mat sharing the buffer.
+ */
+inline py::array_t<unsigned char> cv_mat_to_numpy(const cv::Mat& mat) {
+    if (mat.empty()) return py::array_t<unsigned char>(std::vector<py::ssize_t>{0, 0});
+    if (mat.depth() != CV_8U) throw std::runtime_error("Only 8-bit Mats can be exported");
+
+    auto* owner = new cv::Mat(mat);
+    py::capsule base(owner, [](void* ptr) { delete static_cast<cv::Mat*>(ptr); });
+
+    const auto elemSize1 = static_cast<py::ssize_t>(mat.elemSize1());
+    std::vector<py::ssize_t> shape = {mat.rows, mat.cols};
+    std::vector<py::ssize_t> strides = {static_cast<py::ssize_t>(mat.step[0]),
+                                        static_cast<py::ssize_t>(mat.elemSize())};
+    if (mat.channels() > 1) {
+        shape.push_back(mat.channels());
+        strides.push_back(elemSize1);
+    }
+    return py::array_t<unsigned char>(shape, strides, owner->data, base);
+}
+
+/**
+ * @brief Same as cv_mat_to_numpy(), for a Mat that may borrow @p owner's buffer
+ *
+ * A Mat from numpy_to_cv_mat() (or an ROI of one) does not own its pixels; its array takes
+ * @p owner, the numpy array it was wrapped from, as base instead, so the view keeps that
+ * array alive. Owning Mats are exported as by cv_mat_to_numpy().
+ */
+inline py::array_t<unsigned char> cv_mat_to_numpy(const cv::Mat& mat, const py::handle& owner) {
+    if (mat.empty() || mat.u != nullptr) return cv_mat_to_numpy(mat);
+    if (mat.depth() != CV_8U) throw std::runtime_error("Only 8-bit Mats can be exported");
+
+    std::vector<py::ssize_t> shape = {mat.rows, mat.cols};
+    std::vector<py::ssize_t> strides = {static_cast<py::ssize_t>(mat.step[0]),
+                                        static_cast<py::ssize_t>(mat.elemSize())};
+    if (mat.channels() > 1) {
+        shape.push_back(mat.channels());
+        strides.push_back(static_cast<py::ssize_t>(mat.elemSize1()));
+    }
+    return py::array_t<unsigned char>(shape, strides, mat.data, owner);
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/video/tracking.hpp>
+#include <vector>
+
+#include "detections.hpp"
+#include "tracked_object.hpp"
+#include "tracked_object_store.hpp"
+
+/**
+ * @brief Frame-to-frame association parameters for ObjectTracker
+ */
+struct TrackerConfig {
+    double minIou = 0.3;                // Minimum IoU between a track's prediction and a box
+    int maxFramesWithoutDetection = 5;  // Frames a track may coast unmatched before it is dropped
+    size_t maxTrajectoryLength = 64;    // Centers kept per track (at most kTrajectoryCapacity)
+    double smoothingFactor = 0.5;       // EMA weight of the newest center in smoothedCenter
+    bool useKalman = false;             // Predict tracks with a constant-velocity Kalman filter
+};
+
+/**
+ * @brief Greedy IoU multi-object tracker that gives motion boxes stable IDs across frames
+ *
+ * Each update() predicts every live track (the last box, or a constant-velocity Kalman
+ * estimate when enabled), finds the detections overlapping each prediction through a
+ * BoxGridIndex, and assigns track/detection pairs greedily in descending IoU order. Matched
+ * tracks take the detection's box and extend their trajectory; unmatched detections start
+ * new tracks; tracks unmatched for more than maxFramesWithoutDetection frames are dropped.
+ *
+ * Per frame the work is O((T + D) log(T + D)) for T tracks and D detections when boxes are
+ * spread out, instead of the O(T * D) of a full IoU matrix.
+ *
+ * Thread safety: not thread-safe; use one tracker per video stream.
+ */
+class ObjectTracker {
+   public:
+    explicit ObjectTracker(const TrackerConfig& config = TrackerConfig());
+
+    /**
+     * @brief Associate this frame's detections with the existing tracks
+     * @param detections Motion boxes from MotionProcessor::processFrame
+     * @param detected Cleared, then filled with one row per detection, in detection order,
+     *                 carrying its track's persistent ID, trajectory and smoothed center
+     */
+    void update(const std::vector<cv::Rect>& detections, TrackedObjectStore& detected);
+
+    /**
+     * @brief Same, with each track following the mask centroid of its detections
+     *
+     * Association still uses the boxes; the trajectory, smoothed center and Kalman
+     * measurement use Detections::centroids, which stay put while flapping wings change
+     * the box around the body.
+     */
+    void update(const Detections& detections, TrackedObjectStore& detected);
+
+    // Same as above, materialized as TrackedObjects (allocates per object)
+    std::vector<TrackedObject> update(const std::vector<cv::Rect>& detections);
+
+    // Drop every track (e.g. after a scene cut); IDs keep increasing
+    void reset();
+
+    // Live tracks, including ones coasting without a detection this frame
+    const TrackedObjectStore& tracks() const { return tracks_; }
+    std::vector<TrackedObject> getTracks() const { return tracks_.toTrackedObjects(); }
+    size_t trackCount() const { return tracks_.size(); }
+
+    // Where each live track's box is expected next frame, without advancing the filters
+    // (the last box, moved by one step of its Kalman velocity when enabled)
+    void predictNext(std::vector<cv::Rect>& out) const;
+
+    // Continue from another tracker's live tracks (hot columns) and ID counter, e.g. the
+    // process a restart takes over from; Kalman filters restart at each track's last center
+    void restoreTracks(const TrackedObjectStore& tracks, int nextId);
+    // ID the next new track gets
+    int nextId() const { return nextId_; }
+
+    // Persistence-side fields (uuid, class, initial frame) of a live track
+    TrackedObjectColdData& coldData(int id) { return tracks_.cold(id); }
+
+    const TrackerConfig& getConfig() const { return config_; }
+    // Retune a running tracker (hot reload). Tracks and IDs carry over, except that
+    // switching useKalman drops the tracks, whose filters belong to the other mode.
+    void updateConfig(const TrackerConfig& config);
+
+   private:
+    // @p centers: the point each detection is measured at (nullptr: its box center)
+    void associate(const std::vector<cv::Rect>& detections, const std::vector<cv::Point2f>* centers,
+                   TrackedObjectStore& detected);
+    size_t createTrack(const cv::Rect& bounds, const cv::Point& center);
+    // Parallel columns of a row just added to tracks_
+    void addTrackState(const cv::Rect& bounds, const cv::Point& center);
+    cv::Rect predict(size_t row);
+    void applyDetection(size_t row, const cv::Rect& bounds, const cv::Point& center);
+
+    TrackerConfig config_;
+    TrackedObjectStore tracks_;              // One row per live track
+    std::vector<cv::KalmanFilter> filters_;  // Parallel to tracks_ (initialized when useKalman)
+    std::vector<cv::Rect> predicted_;        // Parallel to tracks_: this frame's predicted box
+    std::vector<cv::Point> anchors_;         // Parallel to tracks_: the point its last box was measured at
+    int nextId_ = 0;
+};
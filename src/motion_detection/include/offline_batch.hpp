@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+#include "pipeline_config.hpp"
+
+struct OfflineBatchConfig {
+    double segmentSeconds = 120.0;  // Target segment length (each cut moves to the next keyframe)
+    double warmupSeconds = 10.0;    // Decoded before each segment so the background converges
+    size_t workers = 0;             // Segments processed at once (0 = one per hardware thread)
+};
+
+/**
+ * @brief Frame range of one video processed by one worker
+ *
+ * Frames [warmupBegin, begin) only train the segment's own MotionProcessor (and tracker);
+ * detections are kept for [begin, end). warmupBegin is a keyframe, so the seek to it does
+ * not decode anything that is thrown away.
+ */
+struct VideoSegment {
+    int64_t warmupBegin = 0;
+    int64_t begin = 0;
+    int64_t end = 0;
+};
+
+// What the batch needs to know about a file before it is split
+struct VideoProbe {
+    int64_t frameCount = 0;  // Demuxed packets with keyframes, else the container's frame count
+    double fps = 0.0;
+    cv::Size frameSize;
+    std::vector<int64_t> keyframes;  // Ascending frame indices (empty = not available)
+};
+
+struct OfflineFrameDetections {
+    int64_t frame = 0;
+    double seconds = 0.0;           // Position in the file (frame / fps)
+    std::vector<cv::Rect> boxes;    // Motion boxes
+    std::vector<cv::Rect> regions;  // Consolidated regions
+};
+
+struct OfflineFileSummary {
+    size_t index = 0;  // Position of the file in run()'s input list
+    std::string path;
+    size_t segments = 0;
+    int64_t frames = 0;         // Frames with kept detections (the file, if nothing failed)
+    int64_t decodedFrames = 0;  // Including the warm-up overlap
+    int64_t motionFrames = 0;
+    int64_t regionFrames = 0;
+    std::string error;          // Non-empty when the file or one of its segments failed
+};
+
+/**
+ * @brief Offline detection over archived video files, split into segments processed in parallel
+ *
+ * Each file is probed first: its keyframes come from the demuxed packets (FFmpeg raw mode,
+ * nothing decoded). The file is then cut into segments of about segmentSeconds that start on
+ * keyframes, and every segment gets its own MotionProcessor, ObjectTracker and consolidator
+ * (the same chain as birds_of_play_replay). A segment first decodes warmupSeconds of the
+ * preceding footage, from the keyframe at or before that point, and discards those results:
+ * the background model and the previous frames have converged by the time its own first
+ * frame is processed, so the cut is not seen as motion.
+ *
+ * Segments of all files go to one WorkStealingPool, so a directory of short files and one
+ * long file both keep every worker busy. Results are stitched per file: the sink sees every
+ * frame of a file exactly once, in frame order, whatever order the segments finish in.
+ *
+ * Track IDs start over in every segment; consolidated regions and boxes are unaffected.
+ * Background snapshots (background_snapshot_dir) are turned off: a segment of an archive has
+ * nothing to do with the camera's live background.
+ */
+class OfflineBatchProcessor {
+   public:
+    // Called for each frame, in frame order per file; calls for one file never overlap,
+    // calls for different files may run concurrently
+    using FrameSink = std::function<void(size_t file, const OfflineFrameDetections&)>;
+    // Called once per file after its last frame (or its error)
+    using FileDone = std::function<void(const OfflineFileSummary&)>;
+
+    OfflineBatchProcessor(std::shared_ptr<const PipelineConfig> config,
+                          const OfflineBatchConfig& batch);
+
+    // Process @p paths; returns once every file is done, summaries in input order
+    std::vector<OfflineFileSummary> run(const std::vector<std::string>& paths,
+                                        const FrameSink& sink, const FileDone& done = nullptr);
+
+    /**
+     * @brief Frame count, rate, size and keyframes of a video
+     * @throws std::runtime_error if the file cannot be opened
+     */
+    static VideoProbe probe(const std::string& path);
+
+    /**
+     * @brief Split [0, frameCount) into segments of about @p segmentFrames
+     *
+     * A segment starts at the first keyframe at or after the previous start + segmentFrames
+     * (any frame when @p keyframes is empty); its warm-up starts at the last keyframe at or
+     * before begin - warmupFrames. The last segment runs to frameCount.
+     */
+    static std::vector<VideoSegment> planSegments(const std::vector<int64_t>& keyframes,
+                                                  int64_t frameCount, int64_t segmentFrames,
+                                                  int64_t warmupFrames);
+
+    /**
+     * @brief Video files named by files, directories (their video files) and glob patterns
+     * @return Sorted per argument, in argument order
+     * @throws std::invalid_argument if an argument matches nothing
+     */
+    static std::vector<std::string> expandInputs(const std::vector<std::string>& arguments);
+
+    const OfflineBatchConfig& config() const { return batch_; }
+
+   private:
+    struct FileState;
+
+    void processSegment(FileState& file, size_t segmentIndex);
+
+    std::shared_ptr<const PipelineConfig> config_;
+    OfflineBatchConfig batch_;
+};
+
+// Regions of every frame from consolidateBoxBatch(), frame after frame
+struct ConsolidatedBoxBatch {
+    std::vector<ConsolidatedRegion> regions;
+    std::vector<size_t> regionOffsets;  // Frame f: regions[regionOffsets[f], regionOffsets[f + 1])
+};
+
+/**
+ * @brief Consolidate stored motion boxes of many frames in one call
+ *
+ * For re-running clustering with other settings over recorded motion regions. The boxes of
+ * frame f are boxes[frameOffsets[f], frameOffsets[f + 1]). A sequence (one recording or
+ * camera) begins at each entry of @p sequenceStarts and runs to the next; its frames go in
+ * order through one consolidator built from @p config, so regions carry over from frame to
+ * frame as in the live pipeline, where frames without boxes get no regions and leave the
+ * consolidator alone. Sequences are independent and run concurrently on a WorkStealingPool.
+ * Tracked-object IDs of a region are indices into its frame's boxes.
+ *
+ * @param sequenceStarts Ascending frame indices starting with 0; empty = one sequence
+ * @param workers Sequences consolidated at once (0 = one per hardware thread)
+ * @throws std::invalid_argument if the offsets do not cover @p boxes in order, or the
+ *         sequence starts are not ascending frame indices from 0
+ */
+ConsolidatedBoxBatch consolidateBoxBatch(const std::vector<cv::Rect>& boxes,
+                                         const std::vector<size_t>& frameOffsets,
+                                         const std::vector<size_t>& sequenceStarts,
+                                         const ConsolidationConfig& config, size_t workers = 0);
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <vector>
+
+/**
+ * @brief Binary mask at one bit per pixel, 64 pixels per word
+ *
+ * Rows are wordsPerRow() words long; pixel x of a row is bit x % 64 of word x / 64. The
+ * bits past cols() in the last word of a row are always zero, so word-wise operations
+ * and popcounts need no edge handling. A 640x480 mask is 38 KB instead of 300 KB, which
+ * is what the threshold, morphology and labelling passes stream through memory.
+ *
+ * Not thread-safe; the storage keeps its capacity between frames.
+ */
+class PackedMask {
+   public:
+    // Scratch of the packed morphology; sized on first use
+    struct Scratch {
+        std::vector<uint64_t> rows;  // Vertical passes: the mask before the pass
+        std::vector<uint64_t> row;   // Horizontal passes: one row before the step
+    };
+
+    // Contents are unspecified until written; reallocates only when the mask grows
+    void create(int rows, int cols);
+    void setZero();
+
+    bool empty() const { return rows_ == 0 || cols_ == 0; }
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    int wordsPerRow() const { return words_; }
+    cv::Size size() const { return cv::Size(cols_, rows_); }
+
+    uint64_t* row(int y) { return bits_.data() + static_cast<size_t>(y) * words_; }
+    const uint64_t* row(int y) const { return bits_.data() + static_cast<size_t>(y) * words_; }
+    bool at(int y, int x) const { return (row(y)[x >> 6] >> (x & 63)) & 1u; }
+
+    // Set pixels
+    size_t count() const;
+
+    // Bits of the non-zero pixels of a CV_8UC1 mask
+    void pack(const cv::Mat& mask);
+    // CV_8UC1 mask with @p value at the set pixels (reallocated only on size change)
+    void unpack(cv::Mat& mask, uchar value = 255) const;
+
+    // Set bits of the last word of a row (the pixels before cols())
+    uint64_t lastWordMask() const;
+    // Zero the bits past cols() again after an operation that shifted bits into them
+    void clearPadding();
+    // Flip every pixel (padding stays zero)
+    void invert();
+
+   private:
+    int rows_ = 0;
+    int cols_ = 0;
+    int words_ = 0;
+    std::vector<uint64_t> bits_;
+};
+
+/**
+ * @brief thresholdMotion() writing bits: set = (diff | background) > threshold, not excluded
+ *
+ * Same pixels as thresholdMotion() with a non-zero maxValue; 16 pixels per compare and
+ * sign-mask step where 128-bit SIMD is available.
+ */
+void thresholdMotionPacked(const cv::Mat& diff, const cv::Mat& background, const cv::Mat& excluded,
+                           int threshold, PackedMask& thresh);
+
+/**
+ * @brief Dilate or erode with the square of side 2 * @p radius + 1, in place
+ *
+ * A horizontal pass of shifted word-wise ORs, then a vertical pass ORing whole rows; the
+ * reach doubles every step, so a radius r costs about log2(r + 1) steps per direction.
+ * Erosion is the dilation of the complement. Pixels outside the mask never win, like the
+ * line filters of MorphologyChain's approximate mode, whose results these match exactly.
+ */
+void dilatePacked(PackedMask& mask, int radius, PackedMask::Scratch& scratch);
+void erodePacked(PackedMask& mask, int radius, PackedMask::Scratch& scratch);
+
+// Horizontal run of set pixels, columns [begin, end)
+struct MaskRun {
+    int row;
+    int begin;
+    int end;
+};
+
+// Append the runs of row @p y of @p mask to @p runs, left to right
+void appendMaskRuns(const PackedMask& mask, int y, std::vector<MaskRun>& runs);
+
+/**
+ * @brief 8-connected components of a packed mask, labelled by their runs
+ *
+ * Runs are read off the words with bit scans (a word of 64 unset pixels is one test), then
+ * merged with union-find wherever a run touches one of the row above, diagonals included.
+ * Cost is proportional to the number of runs, not of pixels. Components come in the order
+ * of their first run, i.e. their first pixel in raster order, as cv::connectedComponents
+ * numbers them.
+ *
+ * Not thread-safe; the buffers keep their capacity between frames.
+ */
+class RunLabeler {
+   public:
+    struct Component {
+        cv::Rect bounds;
+        int pixels = 0;
+        int firstRun = 0;  // Index into runs(); the rest follow through nextRun()
+    };
+
+    // Label @p mask; returns the number of components
+    int label(const PackedMask& mask);
+
+    const std::vector<Component>& components() const { return components_; }
+    const std::vector<MaskRun>& runs() const { return runs_; }
+    // Next run of the same component, in row order; -1 after its last
+    int nextRun(int run) const { return nextRun_[run]; }
+
+    /**
+     * @brief Pixel count over the area of the convex hull of the component's row extents
+     *
+     * The measure the "components" extraction uses (runSolidity in motion_processor.cpp).
+     */
+    double solidity(int component) const;
+
+   private:
+    int find(int run);
+
+    std::vector<MaskRun> runs_;
+    std::vector<int> parent_;     // Union-find over runs; a root is the first run of its component
+    std::vector<int> component_;  // Component of each root run
+    std::vector<int> nextRun_;
+    std::vector<int> lastRun_;    // Per component, while linking
+    std::vector<Component> components_;
+    mutable std::vector<cv::Point> corners_;
+    mutable std::vector<cv::Point> hull_;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <yaml-cpp/yaml.h>
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "detection_evaluator.hpp"
+
+// One top-level config key the tuner may change, with the values it tries (YAML scalars, in order)
+struct TuningParameter {
+    std::string key;
+    std::vector<std::string> values;
+};
+
+// A point of the search space: an index into each parameter's values
+using TuningAssignment = std::vector<size_t>;
+
+struct TuningTrial {
+    size_t index = 0;  // Order the trial was started in (0 = the base config)
+    TuningAssignment assignment;
+    DetectionScore score;
+    double cpuMsPerFrame = 0.0;
+    bool valid = true;  // false: the config was rejected or the replay failed (error says why)
+    std::string error;
+};
+
+/**
+ * @brief Searches config values for the cheapest detection that still meets a recall and precision floor
+ *
+ * The space is a list of top-level config keys with the candidate values of each, so every
+ * trial is the base document with some keys replaced: the result is a config file the
+ * application loads as is. run() starts with the base config's own values (trial 0, the
+ * reference the report compares against), then samples the space uniformly for the first
+ * explorationFraction of the trials and, after that, refines around the best trial so far:
+ * one or two parameters moved to a neighbouring or random value, skipping assignments
+ * already tried. A random search with local refinement rather than a Bayesian one: the
+ * space is small, discrete and mostly categorical, and a surrogate model would be more code
+ * than the trials it saves.
+ *
+ * Trials are ranked by better(): a trial meeting both floors beats one that does not;
+ * among those meeting them the lower CPU time per frame wins; among the rest the smaller
+ * shortfall. The caller's evaluate function measures a trial (replay, score, time) and is
+ * called from @p threads threads at once. The random phase is reproducible from the seed;
+ * the refinement phase depends on which trials finish first when threads > 1.
+ *
+ * Thread safety: run() is not reentrant; the other members are const and safe to share.
+ */
+class ParameterTuner {
+   public:
+    using Evaluate = std::function<void(TuningTrial& trial)>;
+
+    struct Settings {
+        double minRecall = 0.9;
+        double minPrecision = 0.8;
+        double explorationFraction = 0.5;  // Share of the trials sampled at random before refining
+        uint64_t seed = 1;
+    };
+
+    // Index of a key the base document leaves unset (baseline() only: trials always set a value)
+    static constexpr size_t kUnset = static_cast<size_t>(-1);
+
+    /**
+     * @param base The config document trials modify; each parameter's current value in it
+     *             is added to the parameter's candidates when missing
+     */
+    ParameterTuner(std::vector<TuningParameter> space, const YAML::Node& base, const Settings& settings);
+
+    // Keys worth tuning for CPU time: blur, morphology, contour filters, scale, background model, DBSCAN
+    static std::vector<TuningParameter> defaultSpace();
+    // A map of key -> list of candidate scalars, e.g. {gaussian_blur_size: [5, 7, 9]}
+    static std::vector<TuningParameter> parseSpace(const YAML::Node& node);
+
+    /**
+     * @brief Evaluate the base config and then @p trials - 1 more assignments
+     * @return Every trial, best first
+     */
+    std::vector<TuningTrial> run(size_t trials, size_t threads, const Evaluate& evaluate) const;
+
+    bool feasible(const TuningTrial& trial) const;
+    // Whether @p a ranks ahead of @p b
+    bool better(const TuningTrial& a, const TuningTrial& b) const;
+
+    // A copy of the base document with @p assignment's values
+    YAML::Node apply(const TuningAssignment& assignment) const;
+    // "key=value ..." for the parameters @p assignment changes from the base config
+    std::string describe(const TuningAssignment& assignment) const;
+
+    const std::vector<TuningParameter>& space() const { return space_; }
+    const TuningAssignment& baseline() const { return baseline_; }
+
+   private:
+    TuningAssignment sample(std::mt19937_64& rng) const;
+    TuningAssignment neighbour(const TuningAssignment& from, std::mt19937_64& rng) const;
+
+    std::vector<TuningParameter> space_;
+    YAML::Node base_;
+    Settings settings_;
+    TuningAssignment baseline_;
+};
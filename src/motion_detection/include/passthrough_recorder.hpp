@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "encoded_packet_ring.hpp"
+
+struct PassthroughConfig {
+    bool enabled = false;
+    std::string source;                // RTSP URL of the camera (its H.264/H.265 stream)
+    std::string outputDir = "data/clips";
+    double preRollSeconds = 5.0;       // At least this much video from before the event
+    double postRollSeconds = 5.0;      // Keep recording this long after the last region
+    double maxSegmentSeconds = 300.0;  // Split long events into segments (at a keyframe)
+    int reconnectDelayMs = 2000;       // Wait before reopening a dropped stream
+};
+
+struct PassthroughStats {
+    uint64_t segmentsWritten = 0;
+    uint64_t packetsWritten = 0;
+    size_t bufferedPackets = 0;  // Pre-roll ring
+    size_t bufferedBytes = 0;
+    bool connected = false;
+    bool recording = false;
+};
+
+/**
+ * @brief Records motion events by remuxing the camera's compressed stream (no re-encode)
+ *
+ * Opens its own FFmpeg connection to the camera in raw mode (CAP_PROP_FORMAT = -1), so the
+ * demuxed H.264/H.265 packets are never decoded. They wait in a keyframe-aligned
+ * EncodedPacketRing; when the analytics side reports an event the ring and the following
+ * packets are written into an MP4 segment with VideoWriter's raw mode, and the segment is
+ * closed postRollSeconds after the last event (long events are split at a keyframe).
+ *
+ * Overlays are not burned in: every addOverlay() call becomes a WebVTT cue with a JSON
+ * payload ({"frame_size":[w,h],"regions":[[x,y,w,h],...]}) in a <segment>.vtt sidecar, which
+ * the web viewer draws over the video. Cue times come from the steady clock on both sides,
+ * so they are as close to the video as the analytics stream is to the recording stream
+ * (typically one decode latency).
+ *
+ * Needs OpenCV 4.10+ built with FFmpeg (raw VideoWriter); elsewhere start() logs why and
+ * the recorder stays idle.
+ *
+ * Thread safety: addOverlay() and getStats() may be called from any thread.
+ */
+class PassthroughRecorder {
+   public:
+    explicit PassthroughRecorder(const PassthroughConfig& config);
+    ~PassthroughRecorder();
+
+    PassthroughRecorder(const PassthroughRecorder&) = delete;
+    PassthroughRecorder& operator=(const PassthroughRecorder&) = delete;
+
+    // Start the recording thread; returns false if disabled or unsupported by this OpenCV
+    bool start();
+
+    // Stop reading and close any open segment (with its sidecar)
+    void stop();
+
+    // Consolidated regions of an analyzed frame; non-empty regions mark the event as active
+    void addOverlay(std::chrono::steady_clock::time_point captureTime, const cv::Size& frameSize,
+                    const std::vector<cv::Rect>& regions);
+
+    bool isEnabled() const { return config_.enabled; }
+    PassthroughStats getStats() const;
+
+    // Raw VideoWriter support (OpenCV 4.10+ with the FFmpeg backend)
+    static bool isSupported();
+
+    // WebVTT cue timestamp, "HH:MM:SS.mmm"
+    static std::string webVttTimestamp(double seconds);
+
+   private:
+    struct OverlayCue {
+        std::chrono::steady_clock::time_point time;
+        cv::Size frameSize;
+        std::vector<cv::Rect> regions;
+    };
+
+    void run();
+    bool openStream();
+    bool openSegment(std::chrono::steady_clock::time_point start);
+    void writePacket(const EncodedPacket& packet);
+    void closeSegment(std::chrono::steady_clock::time_point end);
+    void writeSidecar(std::chrono::steady_clock::time_point end);
+    bool eventActive(std::chrono::steady_clock::time_point now) const;
+    // Move cues queued by addOverlay() over to the recording thread, dropping those before keepFrom
+    void collectCues(std::chrono::steady_clock::time_point keepFrom);
+
+    const PassthroughConfig config_;
+    std::thread worker_;
+    std::atomic<bool> stopRequested_{false};
+
+    // Recording thread only
+    cv::VideoCapture capture_;
+    cv::VideoWriter writer_;
+    EncodedPacketRing ring_;
+    std::deque<OverlayCue> cues_;  // Taken from pendingCues_, kept while they may be recorded
+    std::string segmentPath_;
+    std::chrono::steady_clock::time_point segmentStart_;
+    int fourcc_ = 0;
+    double fps_ = 0.0;
+    cv::Size frameSize_;
+    bool openFailureLogged_ = false;
+
+    mutable std::mutex cueMutex_;
+    std::vector<OverlayCue> pendingCues_;
+    std::atomic<int64_t> lastEventNanos_{0};  // steady_clock of the last frame with regions
+
+    std::atomic<uint64_t> segmentsWritten_{0};
+    std::atomic<uint64_t> packetsWritten_{0};
+    std::atomic<size_t> bufferedPackets_{0};
+    std::atomic<size_t> bufferedBytes_{0};
+    std::atomic<bool> connected_{false};
+    std::atomic<bool> recording_{false};
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "frame_file_storage.hpp"       // StoredFrameRecord
+#include "motion_stats_aggregator.hpp"  // MotionMinuteSummary
+
+/**
+ * @brief Where the persistence worker puts frame documents and per-minute motion summaries
+ *
+ * The images themselves are always written by FrameFileStorage (or a FrameSegmentStore);
+ * a backend only stores the documents that point at them. Implementations:
+ *
+ * - "none":   documents are dropped (images and region crops stay on disk for the batch steps)
+ * - "local":  newline-delimited JSON appended to FrameSegmentStore segments, no server
+ * - "sqlite": one database file (ENABLE_SQLITE builds)
+ * - "uplink": documents and region crops streamed to a central aggregator, spooled locally
+ *             while it is unreachable (UplinkPersistenceBackend)
+ * - "native": MongoDB through mongocxx, FrameStore (ENABLE_MONGO builds)
+ * - "python": MongoDB through the embedded FrameDatabaseV2, PythonPersistenceBackend in the
+ *             main executable (ENABLE_PYTHON builds)
+ *
+ * Documents carry the FrameDatabaseV2 fields whatever the backend, so frames stored by one
+ * can be imported into another.
+ *
+ * Thread safety: connect() before handing the backend to the persistence worker; after that
+ * insertRecords() and upsertMotionSummaries() are called from one thread at a time.
+ */
+class PersistenceBackend {
+   public:
+    virtual ~PersistenceBackend() = default;
+
+    // Configuration name ("none", "local", "sqlite", "uplink", "native", "python")
+    virtual const char* name() const = 0;
+
+    /**
+     * @brief Open the store
+     * @return false if it is unavailable now; inserts retry the connection where they can
+     */
+    virtual bool connect() = 0;
+
+    /**
+     * @brief Store the documents of frames whose images are already written (one round trip)
+     * @return UUIDs of the stored documents; the caller deletes the files of the others
+     */
+    virtual std::vector<std::string> insertRecords(const std::vector<StoredFrameRecord>& records) = 0;
+
+    // Add per-minute motion summaries to the stats; false if they could not be written
+    virtual bool upsertMotionSummaries(const std::vector<MotionMinuteSummary>& summaries) = 0;
+};
+
+// Settings of the backends makePersistenceBackend() builds
+struct PersistenceBackendConfig {
+    std::string name = "local";
+    std::string localPath = "data/frames/documents";  // "local": segment directories
+    uint64_t localSegmentBytes = 64ull << 20;
+    std::string sqlitePath = "data/frames/birds_of_play.sqlite";
+    std::string uplinkEndpoint = "localhost:7450";  // "uplink": aggregator host:port
+    std::string uplinkSite;                         // Sent in the hello; empty = hostname
+    std::string uplinkSpoolPath = "data/frames/uplink_spool";
+    size_t uplinkWindowBytes = 4u << 20;  // Unacknowledged plus waiting bytes
+};
+
+/**
+ * @brief Build the "none", "local", "sqlite" or "uplink" backend (not yet connected)
+ *
+ * "native" and "python" need their client libraries and are built by the caller.
+ * @throws std::invalid_argument for other names, and for "sqlite" in builds without SQLite
+ */
+std::unique_ptr<PersistenceBackend> makePersistenceBackend(const PersistenceBackendConfig& config);
+
+/**
+ * @brief A frame's document as one line of relaxed Extended JSON (no trailing newline)
+ *
+ * Same fields as FrameStore writes; dates are {"$date": "<ISO 8601>"} so mongoimport
+ * restores them as BSON dates. @p nowMs (Unix milliseconds) becomes timestamp and created_at.
+ */
+std::string frameDocumentJson(const StoredFrameRecord& record, int64_t nowMs);
+
+// A minute's summary with the motion_stats field names, as one line of relaxed Extended JSON
+std::string motionSummaryJson(const MotionMinuteSummary& summary, int64_t nowMs);
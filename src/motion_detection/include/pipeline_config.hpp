@@ -0,0 +1,157 @@
+#pragma once
+
+#include <yaml-cpp/yaml.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "adaptive_detection_scale.hpp"    // For AdaptiveScaleConfig
+#include "load_shedder.hpp"                // For LoadSheddingConfig
+#include "logger.hpp"                      // For Logger::AsyncOptions
+#include "motion_history.hpp"             // For MotionHistoryConfig
+#include "motion_region_consolidator.hpp"  // For ConsolidationConfig
+#include "object_tracker.hpp"              // For TrackerConfig
+#include "region_flow_propagator.hpp"      // For FlowPropagationConfig
+#include "state_handoff.hpp"               // For HandoffConfig
+#include "thread_budget.hpp"               // For ThreadBudgetSettings
+#include "thread_placement.hpp"            // For ThreadSettings
+#include "wake_trigger.hpp"                // For WakeTriggerConfig
+
+// logging: section of the config file
+struct LoggingSettings {
+    std::string level = "info";
+    bool toFile = false;
+    std::string filePath = "birdsofplay.log";
+    Logger::AsyncOptions async;
+    double diagnosticLinesPerSecond = -1.0;  // < 0 = keep the Logger default
+};
+
+// stage_graph: section of the config file (see MotionStageGraph)
+struct StageGraphSettings {
+    std::vector<std::string> stages;                 // Empty = detect, track (or number), consolidate
+    std::vector<std::string> outputs = {"regions"};  // Slots the caller reads after each frame
+
+    // The stages and slots MotionStageGraph provides
+    static const std::vector<std::string>& stageNames();
+    static const std::vector<std::string>& slotNames();
+};
+
+/**
+ * @brief Immutable, validated snapshot of one config file
+ *
+ * The file is parsed once; the keys every entry point reads the same way (logging,
+ * DBSCAN consolidation, tracker, flow propagation, motion history, stage graph, threads,
+ * thread budget, restart handoff, load shedding, adaptive detection scale, wake trigger, run mode) are converted into typed fields, and the parsed document is
+ * kept for the sections a single consumer reads itself (the MotionProcessor keys,
+ * capture, pipeline, ...). Snapshots are handed around as shared_ptr<const PipelineConfig>, so every
+ * MotionProcessor, stream and binding built from the same file shares one parse instead
+ * of re-reading it.
+ *
+ * Thread safety: never modified after load(), so it may be read from any thread. A
+ * reload produces a new snapshot (see SharedPipelineConfig).
+ */
+class PipelineConfig {
+   public:
+    /**
+     * @brief Parses and validates a config file
+     * @throws std::invalid_argument when the file cannot be read or parsed, or a known key
+     *         has the wrong type or an out-of-range value (every problem is listed)
+     */
+    static std::shared_ptr<const PipelineConfig> load(const std::string& path);
+    // Same, from YAML text; @p source names it in error messages
+    static std::shared_ptr<const PipelineConfig> fromYaml(const std::string& yaml,
+                                                          const std::string& source = "<string>");
+    // load(), but returns the snapshot already in use for @p path while any holder keeps it
+    // alive and the file's modification time and size are unchanged
+    static std::shared_ptr<const PipelineConfig> shared(const std::string& path);
+    // shared(), falling back to an all-defaults snapshot (with the error logged) when the
+    // file is missing or invalid: the lenient behaviour of MotionProcessor(configPath)
+    static std::shared_ptr<const PipelineConfig> loadOrDefaults(const std::string& path);
+
+    /**
+     * @brief This snapshot with top-level keys replaced by @p overrides (a processing profile)
+     *
+     * A map value is merged key by key into the section of the same name; any other value
+     * replaces the key. The result keeps path(), so a reload re-reads the same file.
+     * @throws std::invalid_argument when the merged document does not validate
+     */
+    std::shared_ptr<const PipelineConfig> withOverrides(const YAML::Node& overrides) const;
+
+    // File the snapshot was read from ("" for fromYaml / defaults)
+    const std::string& path() const { return path_; }
+    // The parsed document (an empty map for the defaults snapshot)
+    const YAML::Node& document() const { return document_; }
+
+    LoggingSettings logging;
+    ConsolidationConfig consolidation;  // frameSize is set by the consumer
+    TrackerConfig tracker;
+    FlowPropagationConfig flowPropagation;
+    MotionHistoryConfig motionHistory;
+    StageGraphSettings stageGraph;
+    ThreadSettings threads;
+    ThreadBudgetSettings threadBudget;
+    HandoffConfig handoff;
+    LoadSheddingConfig loadShedding;  // frameIntervalMs is set by the consumer
+    AdaptiveScaleConfig adaptiveScale;
+    WakeTriggerConfig wakeTrigger;
+    bool trackerEnabled = true;
+    bool headless = false;
+    bool saveOnlyConsolidatedRegions = false;
+
+   private:
+    PipelineConfig() = default;
+    static std::shared_ptr<const PipelineConfig> fromNode(const YAML::Node& document, const std::string& path,
+                                                          const std::string& source);
+
+    std::string path_;
+    YAML::Node document_;
+};
+
+/**
+ * @brief Current config snapshot with an atomic swap for hot reload
+ *
+ * Readers take current() once per unit of work (a frame, a stream setup) and keep using
+ * that snapshot; reload() parses the file into a new snapshot and publishes it in one
+ * atomic store, so readers see either the old or the new config, never a mix. An invalid
+ * file is rejected and the running snapshot stays in place.
+ *
+ * setOverrides() layers a processing profile (ProfileScheduler) over the file's settings:
+ * current() is then base() with the overrides applied, and later publish()/reload() calls
+ * keep applying them, so a profile survives an edit of the file.
+ *
+ * Thread safety: all members may be called concurrently.
+ */
+class SharedPipelineConfig {
+   public:
+    explicit SharedPipelineConfig(std::shared_ptr<const PipelineConfig> initial);
+
+    std::shared_ptr<const PipelineConfig> current() const { return std::atomic_load(&current_); }
+    // The published snapshot without the overrides
+    std::shared_ptr<const PipelineConfig> base() const;
+    // Incremented by every successful publish()/reload()/setOverrides()
+    uint64_t version() const { return version_.load(std::memory_order_acquire); }
+
+    void publish(std::shared_ptr<const PipelineConfig> config);
+    // Re-reads the current snapshot's file; false (config unchanged) when it is invalid
+    bool reload();
+    /**
+     * @brief Apply @p overrides (PipelineConfig::withOverrides()) to base() from now on
+     *
+     * A null node removes them. false (config unchanged) when the result does not validate.
+     */
+    bool setOverrides(const YAML::Node& overrides);
+
+   private:
+    // Publishes @p base with overrides_ applied; mutex_ held
+    void publishLocked(std::shared_ptr<const PipelineConfig> base);
+
+    std::shared_ptr<const PipelineConfig> current_;
+    std::atomic<uint64_t> version_{0};
+    mutable std::mutex mutex_;  // Serializes publishers; guards base_ and overrides_
+    std::shared_ptr<const PipelineConfig> base_;
+    YAML::Node overrides_;
+};
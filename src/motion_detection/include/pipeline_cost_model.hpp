@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "pipeline_config.hpp"
+
+/**
+ * @brief Pipeline stages the cost model is calibrated on
+ *
+ * The step kernels (Preprocess .. Extraction) are birds_of_play_bench's BM_Preprocess,
+ * BM_DetectMotion, BM_Morphology and BM_ExtractContours on a moving frame pair; QuietFrame
+ * and ActiveFrame are processFrame() on a still and a moving sequence with the config's own
+ * settings (detection_scale, tiles, background model, ...). Consolidation is per frame over a
+ * number of clustered boxes (BM_DbscanClustering's flocks), Encode one JPEG of a frame.
+ */
+enum class CostStage { Preprocess, Detect, Morphology, Extraction, QuietFrame, ActiveFrame, Consolidation, Encode, Count };
+
+const char* costStageName(CostStage stage);
+
+// Calibrated milliseconds of one stage: fixedMs + perUnitMs x units (megapixels, or boxes
+// for Consolidation), fitted by least squares over the calibration points
+struct StageCostFit {
+    double fixedMs = 0.0;
+    double perUnitMs = 0.0;
+
+    double at(double units) const;
+    static StageCostFit fit(const std::vector<double>& units, const std::vector<double>& ms);
+};
+
+// How a stream is expected to run
+struct StreamWorkload {
+    cv::Size resolution{1920, 1080};
+    double fps = 10.0;                  // Frames handed to the pipeline per second
+    double activity = 0.1;              // Share of frames with motion (a quiet feeder 0.05, a busy one 0.5)
+    double boxesPerActiveFrame = 8.0;   // Motion boxes of a frame with motion
+    double savedFramesPerSecond = 0.0;  // Frames the persistence worker encodes
+};
+
+struct StreamCostEstimate {
+    double cpuMsPerFrame = 0.0;  // Mean over quiet and active frames, consolidation included
+    double gpuMsPerFrame = 0.0;  // Of the frame cost, what runs on the OpenCL device
+    double encodeMsPerSecond = 0.0;
+    double cpuCores = 0.0;  // Worker cores the stream keeps busy: processing and encoding
+    double gpuShare = 0.0;  // Share of one OpenCL device
+};
+
+struct CalibrationSettings {
+    std::vector<cv::Size> resolutions = {{1280, 720}, {1920, 1080}, {3840, 2160}};
+    std::vector<size_t> boxCounts = {8, 32, 128};
+    int frames = 20;  // Timed frames per resolution and stage, after as many warm-up frames
+};
+
+/**
+ * @brief Per-stream CPU/GPU cost and streams per node, from a short calibration on the host
+ *
+ * calibrate() times each stage at a few resolutions on the calling thread with OpenCV's own
+ * pool off, so a fit is what the stage costs one worker, and fits a line through the points
+ * (cost grows with the pixels; clustering with the boxes). estimate() combines the fits with
+ * a StreamWorkload:
+ *
+ *     ms/frame = (1 - activity) x QuietFrame + activity x (ActiveFrame + Consolidation(boxes))
+ *     cores    = fps x ms/frame / 1000 + saved/s x Encode / 1000
+ *
+ * With compute_backend: opencl, preprocessing through morphology run on the device: their
+ * share of the step kernels is charged to the GPU instead (measured in wall time, which is
+ * what the device is busy for). maxStreamsPerNode() is how many such streams a node fills to
+ * a target utilization, the number StreamShardCoordinator plans with; it places streams no
+ * node has reported yet at estimate().cpuCores until real load metrics replace it.
+ *
+ * A calibration is per host and config: save() it next to the config and load() it on the
+ * coordinator instead of calibrating there.
+ */
+class PipelineCostModel {
+   public:
+    PipelineCostModel() = default;
+
+    static PipelineCostModel calibrate(const std::shared_ptr<const PipelineConfig>& config,
+                                       const CalibrationSettings& settings = CalibrationSettings());
+
+    // Throws std::runtime_error when @p path cannot be read or is not a calibration
+    static PipelineCostModel load(const std::string& path);
+    void save(const std::string& path) const;
+
+    const StageCostFit& stage(CostStage stage) const { return stages_[static_cast<size_t>(stage)]; }
+    void setStage(CostStage stage, const StageCostFit& fit) { stages_[static_cast<size_t>(stage)] = fit; }
+
+    // Preprocessing through morphology run on an OpenCL device (compute_backend: opencl)
+    bool deviceStages() const { return deviceStages_; }
+    void setDeviceStages(bool enabled) { deviceStages_ = enabled; }
+
+    StreamCostEstimate estimate(const StreamWorkload& workload) const;
+
+    /**
+     * @brief Streams of @p workload a node runs within @p targetUtilization of its workers
+     * @param devices OpenCL devices of the node (only counted with deviceStages())
+     */
+    size_t maxStreamsPerNode(const StreamWorkload& workload, size_t workers, double targetUtilization,
+                             size_t devices = 1) const;
+
+   private:
+    std::array<StageCostFit, static_cast<size_t>(CostStage::Count)> stages_{};
+    bool deviceStages_ = false;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "frame_trace.hpp"
+#include "latency_histogram.hpp"
+#include "motion_processor.hpp"
+#include "prometheus_text_writer.hpp"
+
+/**
+ * @brief Per-frame detection counters for the metrics exporter
+ *
+ * Recorded once per frame by the last processing stage with relaxed atomic increments, and
+ * read by the exporter thread at scrape time, so scrapes never wait on (or stall) frames.
+ */
+class PipelineMetrics {
+   public:
+    // Upper bounds of the regions-per-frame histogram buckets
+    static constexpr std::array<size_t, 7> kRegionBuckets = {0, 1, 2, 4, 8, 16, 32};
+
+    /**
+     * @brief Count one processed frame
+     * @param result Detection result of the frame (extraction counters included)
+     * @param regionCount Consolidated regions reported for the frame
+     */
+    void recordFrame(const MotionProcessor::ProcessingResult& result, size_t regionCount);
+
+    /**
+     * @brief Record where a frame's time went, once it has left the pipeline
+     * @param trace Trace with every stage and delivered stamped
+     */
+    void recordLatency(const FrameTrace& trace);
+
+    // Capture to pipeline output
+    const LatencyHistogram& endToEndLatency() const { return endToEnd_; }
+
+    uint64_t framesProcessed() const { return frames_.load(std::memory_order_relaxed); }
+    uint64_t motionFrames() const { return motionFrames_.load(std::memory_order_relaxed); }
+
+    // Frame, motion, region, contour-filter and frame latency families
+    void write(PrometheusTextWriter& writer) const;
+
+    // Resident set size of this process in bytes (0 where the platform offers no probe)
+    static uint64_t residentMemoryBytes();
+
+   private:
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> motionFrames_{0};
+    std::atomic<uint64_t> regionsTotal_{0};
+    std::array<std::atomic<uint64_t>, kRegionBuckets.size() + 1> regionBuckets_{};  // Last: +Inf
+
+    // Sums of MotionProcessor::ExtractionStats over every frame
+    std::atomic<uint64_t> candidates_{0};
+    std::atomic<uint64_t> rejectedArea_{0};
+    std::atomic<uint64_t> rejectedSolidity_{0};
+    std::atomic<uint64_t> rejectedAspectRatio_{0};
+    std::atomic<uint64_t> accepted_{0};
+    std::atomic<uint64_t> solidityChecks_{0};
+    std::atomic<uint64_t> droppedOverCap_{0};
+    std::atomic<uint64_t> cappedFrames_{0};  // Frames that hit max_contours_per_frame
+
+    LatencyHistogram endToEnd_;
+    std::array<LatencyHistogram, FrameTrace::kStageCount> stageWait_;  // Queued in front of a stage
+    std::array<LatencyHistogram, FrameTrace::kStageCount> stageRun_;
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "frame_arena.hpp"
+#include "motion_processor.hpp"
+#include "motion_region_consolidator.hpp"
+#include "object_tracker.hpp"
+#include "staged_pipeline.hpp"
+#include "tracked_object_store.hpp"
+
+/**
+ * @brief processFrameAndConsolidate() with consecutive frames overlapped on two threads
+ *
+ * Only detection depends on the previous frame (MotionProcessor's reference frame). One
+ * thread detects while a second one associates and consolidates the frame before it. The
+ * caller's own work on the result before that (rendering, persistence) overlaps both. Up
+ * to @p depth frames are in flight between push() and the delivery of their results.
+ *
+ * Results come out in submission order. Each stage is a single thread that takes frames
+ * in order, so the tracker and the consolidator see exactly the sequence of a synchronous
+ * loop, and their temporal state (track IDs, region ages, the neighbor cache) evolves
+ * identically. A frame whose stage throws is still delivered, with the error set.
+ *
+ * With reuse_buffers, the retained intermediate Mats of a result (processedFrame, thresh,
+ * ...) may already hold a later frame; the boxes, regions and originalFrame are always the
+ * frame's own.
+ *
+ * Thread safety: push() and finish() from one thread. The processor, tracker and
+ * consolidator belong to the executor until it is destroyed.
+ */
+class PipelinedFrameExecutor {
+   public:
+    struct Result {
+        uint64_t sequence = 0;  // 0 for the first pushed frame
+        cv::Mat frame;
+        MotionProcessor::ProcessingResult result;
+        std::vector<ConsolidatedRegion> regions;
+        std::string error;  // What a stage threw; empty on success
+        std::chrono::steady_clock::duration detectTime{};
+        std::chrono::steady_clock::duration trackTime{};
+        std::chrono::steady_clock::duration consolidateTime{};
+        std::chrono::steady_clock::time_point submitted;
+    };
+
+    /**
+     * @param tracker Persistent IDs as in the tracker overload of processFrameAndConsolidate();
+     *                nullptr numbers the boxes per frame
+     * @param depth Frames in flight (at least 1; 1 runs the stages one frame at a time)
+     */
+    PipelinedFrameExecutor(MotionProcessor& processor, MotionRegionConsolidator& consolidator,
+                           ObjectTracker* tracker, size_t depth = 3);
+    ~PipelinedFrameExecutor();
+
+    PipelinedFrameExecutor(const PipelinedFrameExecutor&) = delete;
+    PipelinedFrameExecutor& operator=(const PipelinedFrameExecutor&) = delete;
+
+    // Queue @p frame; once depth frames are in flight, waits for and returns the oldest result
+    std::optional<Result> push(cv::Mat frame);
+
+    // Next result still in flight (waiting for it), nullopt once every frame was delivered
+    std::optional<Result> finish();
+
+    size_t depth() const { return depth_; }
+    size_t inFlight() const { return inFlight_; }
+
+   private:
+    void detect(Result& packet);
+    void consolidate(Result& packet);
+    Result popResult();
+
+    MotionProcessor& processor_;
+    MotionRegionConsolidator& consolidator_;
+    ObjectTracker* tracker_;
+    const size_t depth_;
+    size_t inFlight_ = 0;
+    uint64_t nextSequence_ = 0;
+
+    // Only touched by the consolidate thread
+    TrackedObjectStore trackedObjects_;
+    FrameArena arena_;
+
+    StagedPipeline<Result> pipeline_;
+};
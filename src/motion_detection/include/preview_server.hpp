@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct PreviewConfig {
+    int port = 8090;                        // TCP port (0 picks a free port, see PreviewServer::port())
+    std::string bindAddress = "127.0.0.1";  // "0.0.0.0" to allow viewers on other hosts
+    int width = 640;                        // Preview width; height keeps the frame's aspect ratio
+    double fps = 5.0;                       // Highest preview frame rate
+    int quality = 70;                       // JPEG quality (1-100)
+};
+
+/**
+ * @brief Live MJPEG preview of the annotated stream over HTTP, encoded only while watched
+ *
+ * GET /stream answers with a multipart/x-mixed-replace MJPEG stream that browsers, VLC and
+ * ffplay display directly; GET / is a page that embeds it. The processing thread calls
+ * wantsFrame() once per frame: it is a single atomic load while nobody is connected, and
+ * true at most fps times a second otherwise. Only then does it hand the raw frame and an
+ * overlay function to offer(), which keeps the latest one.
+ *
+ * A dedicated thread scales the offered frame to the preview width, runs the overlay on the
+ * small image, encodes it once and sends it to every viewer. A second thread accepts
+ * connections. Viewers that stop reading are dropped after a send timeout, so a stalled
+ * browser costs at most one late preview frame, never a processing frame. POSIX sockets only.
+ *
+ * Thread safety: start() and stop() from the owning thread; wantsFrame() and offer() from
+ * any thread (the render stage in practice).
+ */
+class PreviewServer {
+   public:
+    // Draws onto the preview image; @p scale maps full-frame coordinates onto it
+    using Overlay = std::function<void(cv::Mat& preview, double scale)>;
+
+    explicit PreviewServer(PreviewConfig config);
+    ~PreviewServer();
+
+    PreviewServer(const PreviewServer&) = delete;
+    PreviewServer& operator=(const PreviewServer&) = delete;
+
+    /**
+     * @brief Bind the socket and start the accept and encoder threads
+     * @return false (and logs why) if the address cannot be bound
+     */
+    bool start();
+
+    // Disconnect every viewer and join both threads (returns within the poll interval)
+    void stop();
+
+    // True when a viewer is connected and the next preview frame is due
+    bool wantsFrame() const;
+
+    /**
+     * @brief Hand over the next preview frame (BGR or gray); replaces one not yet encoded
+     *
+     * @p frame is shared, not copied: the encoder thread only reads it, so the caller must
+     * not write into its pixels afterwards.
+     */
+    void offer(const cv::Mat& frame, Overlay overlay = nullptr);
+
+    bool isRunning() const { return running_.load(); }
+    // Port actually bound (differs from the requested one when that was 0)
+    int port() const { return boundPort_; }
+    int viewers() const { return viewerCount_.load(); }
+    uint64_t framesEncoded() const { return framesEncoded_.load(); }
+
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    void acceptLoop();
+    void encodeLoop();
+    void handleConnection(int clientFd);
+    // Encodes @p frame for the viewers; false if it could not be encoded
+    bool render(const cv::Mat& frame, const Overlay& overlay, std::vector<unsigned char>& jpeg) const;
+    void broadcast(const std::vector<unsigned char>& jpeg);
+    void closeViewers();
+
+    const PreviewConfig config_;
+    const Clock::duration frameInterval_;
+    int listenFd_ = -1;
+    int boundPort_ = 0;
+    std::atomic<bool> running_{false};
+    std::atomic<int> viewerCount_{0};
+    std::atomic<uint64_t> framesEncoded_{0};
+    std::atomic<Clock::rep> nextDue_{0};  // Clock ticks before which wantsFrame() is false
+
+    std::mutex viewersMutex_;
+    std::vector<int> viewers_;  // Sockets that got the stream headers; owned by the encoder thread
+
+    std::mutex frameMutex_;
+    std::condition_variable frameReady_;
+    cv::Mat pendingFrame_;
+    Overlay pendingOverlay_;
+    bool hasPending_ = false;
+
+    std::thread acceptThread_;
+    std::thread encodeThread_;
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <yaml-cpp/yaml.h>
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A named set of pipeline settings (processing_profiles.profiles in the config file)
+ *
+ * overrides holds top-level config keys that replace the file's values while the profile is
+ * active (detection_method, detection_scale, background_model, ...); a map value is merged
+ * into the file's section of that name instead (see PipelineConfig::withOverrides()).
+ */
+struct ProcessingProfile {
+    std::string name;
+    YAML::Node overrides;  // Map of config keys; empty = the file's settings
+    double maxFps = 0.0;   // Highest processing rate; 0 = every captured frame
+    bool inference = true;  // Run the region classifier on the consolidated regions
+};
+
+/**
+ * @brief A time of day, on the clock or relative to the local sunrise or sunset
+ *
+ * Written "HH:MM", "sunrise", "sunset", or an anchor with a minute offset ("sunset+30",
+ * "sunrise-45").
+ */
+struct DayTime {
+    enum class Anchor { CLOCK, SUNRISE, SUNSET };
+    Anchor anchor = Anchor::CLOCK;
+    int minutes = 0;  // CLOCK: minutes after midnight; otherwise the offset from the anchor
+
+    // @throws std::invalid_argument for text in none of the forms above
+    static DayTime parse(const std::string& text);
+};
+
+// Run @p profile from @p from until @p to (which may be past midnight)
+struct ScheduleEntry {
+    std::string profile;
+    DayTime from;
+    DayTime to;
+};
+
+// processing_profiles: section of the config file
+struct ProfileScheduleConfig {
+    bool enabled = false;
+    double latitude = 0.0;   // Degrees north; used by sunrise/sunset times
+    double longitude = 0.0;  // Degrees east
+    std::vector<ProcessingProfile> profiles;
+    std::vector<ScheduleEntry> schedule;  // First matching entry wins
+    std::string defaultProfile;           // Outside every entry; "" = the file's settings
+    // Profile forced while the stream is active, whatever the schedule says; "" = none
+    std::string activityProfile;
+    int activityMinFrames = 3;             // Active frames within the window that count as activity
+    double activityWindowSeconds = 60.0;
+    double activityHoldSeconds = 300.0;    // Stay in the activity profile this long after activity
+    double checkIntervalSeconds = 10.0;    // How often the schedule is re-evaluated
+
+    /**
+     * @brief Read the section; unknown profile names in schedule / default / activity are errors
+     * @throws std::invalid_argument listing the problem
+     */
+    static ProfileScheduleConfig parse(const YAML::Node& section);
+
+    // nullptr for "" or a name not in profiles
+    const ProcessingProfile* find(const std::string& name) const;
+};
+
+/**
+ * @brief Local sunrise or sunset on a day, in minutes after local midnight
+ *
+ * NOAA's solar position approximation (about a minute off at mid latitudes).
+ * @param utcOffsetMinutes Local time minus UTC
+ * @return a negative value when the sun does not rise or set that day (polar day or night)
+ */
+double sunEventMinutes(int dayOfYear, double latitude, double longitude, bool sunrise, int utcOffsetMinutes);
+
+/**
+ * @brief Picks the processing profile of one stream from a daily schedule and its activity
+ *
+ * Birds are diurnal, so a camera need not process at full quality through the night: a
+ * quiet-hours profile can run the block-SAD detector at a couple of frames per second
+ * while daylight hours run the full chain. The profile in effect is, in order:
+ *
+ * 1. activityProfile, while activityMinFrames active frames fell within the last
+ *    activityWindowSeconds, and for activityHoldSeconds after that, so a bird at night
+ *    switches the stream to full quality until it has been quiet again for a while;
+ * 2. the first schedule entry whose window holds the local time of day;
+ * 3. defaultProfile.
+ *
+ * update() re-evaluates at most every checkIntervalSeconds (immediately once activity
+ * starts) and reports a switch; the caller then applies the profile's overrides through the
+ * hot-reload path (SharedPipelineConfig::setOverrides()), so a switch takes effect between
+ * two frames with the background model and reference frames kept. admit() enforces the
+ * profile's maxFps at capture, so frames a quiet profile skips cost no processing at all.
+ * Use one scheduler per stream.
+ *
+ * Thread safety: all methods may be called concurrently (capture calls admit() and
+ * update(), the output side recordActivity()).
+ */
+class ProfileScheduler {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit ProfileScheduler(ProfileScheduleConfig config);
+
+    ProfileScheduler(const ProfileScheduler&) = delete;
+    ProfileScheduler& operator=(const ProfileScheduler&) = delete;
+
+    /**
+     * @brief Re-evaluate the schedule
+     * @param now Wall clock time (local time of day and sunrise/sunset are derived from it)
+     * @return true if the profile changed; current() holds the new one
+     */
+    bool update(std::time_t now, Clock::time_point steadyNow = Clock::now());
+
+    // Profile that update() last chose; nullptr = the file's settings
+    const ProcessingProfile* current() const;
+    std::string currentName() const;
+
+    // Profile due at @p now with the activity recorded so far (what update() would choose)
+    const ProcessingProfile* select(std::time_t now, Clock::time_point steadyNow) const;
+
+    // Record a processed frame; @p active = it had motion regions
+    void recordActivity(bool active, Clock::time_point now = Clock::now());
+
+    // Whether a frame captured at @p now should be processed under the current profile's maxFps
+    bool admit(Clock::time_point now = Clock::now());
+
+    uint64_t switches() const;
+    const ProfileScheduleConfig& config() const { return config_; }
+
+   private:
+    bool inWindow(const ScheduleEntry& entry, const std::tm& local) const;
+    double resolve(const DayTime& time, const std::tm& local) const;
+    bool activeLocked(Clock::time_point now) const;
+
+    const ProfileScheduleConfig config_;
+    const ProcessingProfile* activityProfile_;
+    const ProcessingProfile* defaultProfile_;
+    mutable std::mutex mutex_;
+    const ProcessingProfile* current_ = nullptr;
+    bool evaluated_ = false;
+    Clock::time_point nextCheck_{};
+    Clock::time_point nextAdmit_{};
+    std::deque<Clock::time_point> activeFrames_;  // Within the activity window
+    Clock::time_point activeUntil_{};             // End of the activity hold
+    uint64_t switches_ = 0;
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+// Timeline profiler instrumentation, chosen at configure time with -DPROFILER=tracy|itt (CMake),
+// which defines BIRDS_PROFILER to BIRDS_PROFILER_TRACY or BIRDS_PROFILER_ITT; otherwise every
+// PROFILE_* macro expands to nothing
+#define BIRDS_PROFILER_NONE 0
+#define BIRDS_PROFILER_TRACY 1
+#define BIRDS_PROFILER_ITT 2
+#ifndef BIRDS_PROFILER
+#define BIRDS_PROFILER BIRDS_PROFILER_NONE
+#endif
+
+#if BIRDS_PROFILER == BIRDS_PROFILER_TRACY
+#include <tracy/Tracy.hpp>
+#elif BIRDS_PROFILER == BIRDS_PROFILER_ITT
+#include <ittnotify.h>
+
+#include <unordered_map>
+#endif
+
+/**
+ * @brief Zones, frame marks and allocation events for Tracy or Intel VTune (ITT)
+ *
+ * Sampling profilers attribute OpenCV's thread pool poorly; these macros instead mark what
+ * the pipeline threads are doing, for a timeline of the live multi-stream pipeline:
+ *
+ * - PROFILE_ZONE("name") times the enclosing scope; the name must be a string literal.
+ *   PROFILE_ZONE_NAMED(name) takes a name chosen at run time, which must outlive the
+ *   program (a literal, pipelineStageName() or profiler::internName()). Every STAGE_TIMER
+ *   opens one for its stage, every StagedPipeline stage one per packet, and queues and
+ *   locks one while a thread waits on them ("wait:<what>").
+ * - PROFILE_FRAME_MARK(name) ends a frame of the named stream (one frame set per stream).
+ * - PROFILE_THREAD_NAME(name) names the calling thread (nameCurrentThread does).
+ * - PROFILE_ALLOC / PROFILE_FREE report buffers of the frame pools (PlacedMatAllocator,
+ *   FrameArena) under the pool's name, for Tracy's memory view. ITT has no counterpart;
+ *   they are no-ops there, as is PROFILE_PLOT.
+ */
+namespace profiler {
+
+// A copy of @p name that lives until exit, one per distinct name (for per-stream marks)
+inline const char* internName(const std::string& name) {
+    static std::mutex mutex;
+    static std::unordered_set<std::string> names;  // Node-based: elements never move
+    std::lock_guard<std::mutex> lock(mutex);
+    return names.insert(name).first->c_str();
+}
+
+#if BIRDS_PROFILER == BIRDS_PROFILER_ITT
+inline __itt_domain* ittDomain() {
+    static __itt_domain* domain = __itt_domain_create("birds_of_play");
+    return domain;
+}
+
+// ITT string handles by name address; the names are persistent, so the pointer is the key
+inline __itt_string_handle* ittHandle(const char* name) {
+    thread_local std::unordered_map<const char*, __itt_string_handle*> handles;
+    __itt_string_handle*& handle = handles[name];
+    if (!handle) handle = __itt_string_handle_create(name);
+    return handle;
+}
+
+class IttZone {
+   public:
+    explicit IttZone(__itt_string_handle* handle) { __itt_task_begin(ittDomain(), __itt_null, __itt_null, handle); }
+    ~IttZone() { __itt_task_end(ittDomain()); }
+    IttZone(const IttZone&) = delete;
+    IttZone& operator=(const IttZone&) = delete;
+};
+
+// One ITT domain per stream, so each stream gets its own frame track
+inline void ittFrameMark(const char* name) {
+    thread_local std::unordered_map<const char*, __itt_domain*> domains;
+    __itt_domain*& domain = domains[name];
+    if (!domain) {
+        domain = __itt_domain_create(name);
+    } else {
+        __itt_frame_end_v3(domain, nullptr);
+    }
+    __itt_frame_begin_v3(domain, nullptr);
+}
+#endif
+
+}  // namespace profiler
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if BIRDS_PROFILER == BIRDS_PROFILER_TRACY
+#define PROFILE_ZONE(name) ZoneScopedN(name)
+#define PROFILE_ZONE_NAMED(name) ZoneTransientN(PROFILE_CONCAT(profileZone, __LINE__), (name), true)
+#define PROFILE_FRAME_MARK(name) FrameMarkNamed(name)
+#define PROFILE_THREAD_NAME(name) tracy::SetThreadName(name)
+#define PROFILE_ALLOC(ptr, bytes, pool) TracyAllocN((ptr), (bytes), pool)
+#define PROFILE_FREE(ptr, pool) TracyFreeN((ptr), pool)
+#define PROFILE_PLOT(name, value) TracyPlot(name, static_cast<double>(value))
+#elif BIRDS_PROFILER == BIRDS_PROFILER_ITT
+#define PROFILE_ZONE(name)                                                                     \
+    static __itt_string_handle* const PROFILE_CONCAT(profileHandle, __LINE__) =                \
+        __itt_string_handle_create(name);                                                      \
+    profiler::IttZone PROFILE_CONCAT(profileZone, __LINE__)(PROFILE_CONCAT(profileHandle, __LINE__))
+#define PROFILE_ZONE_NAMED(name) profiler::IttZone PROFILE_CONCAT(profileZone, __LINE__)(profiler::ittHandle(name))
+#define PROFILE_FRAME_MARK(name) profiler::ittFrameMark(name)
+#define PROFILE_THREAD_NAME(name) __itt_thread_set_name(name)
+#define PROFILE_ALLOC(ptr, bytes, pool) ((void)0)
+#define PROFILE_FREE(ptr, pool) ((void)0)
+#define PROFILE_PLOT(name, value) ((void)0)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_ZONE_NAMED(name) ((void)0)
+#define PROFILE_FRAME_MARK(name) ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+#define PROFILE_ALLOC(ptr, bytes, pool) ((void)0)
+#define PROFILE_FREE(ptr, pool) ((void)0)
+#define PROFILE_PLOT(name, value) ((void)0)
+#endif
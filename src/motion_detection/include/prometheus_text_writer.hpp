@@ -0,0 +1,130 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "latency_histogram.hpp"
+#include "stage_latency_histogram.hpp"
+
+/**
+ * @brief Builds a Prometheus text exposition (format 0.0.4) page
+ *
+ * Write each metric family's header() once, followed by all of its samples. Durations
+ * are exported in seconds, the Prometheus base unit.
+ */
+class PrometheusTextWriter {
+   public:
+    using Labels = std::vector<std::pair<std::string, std::string>>;
+
+    // Bucket bounds (seconds) for per-stage latencies, which mostly run well under 10 ms
+    static constexpr std::array<double, 13> kStageBucketsSeconds = {
+        1e-5, 5e-5, 1e-4, 2.5e-4, 5e-4, 1e-3, 2.5e-3, 5e-3, 1e-2, 2.5e-2, 5e-2, 0.1, 0.25};
+
+    static constexpr const char* kContentType = "text/plain; version=0.0.4; charset=utf-8";
+
+    void header(const std::string& name, const char* type, const std::string& help) {
+        text_ += "# HELP " + name + " " + help + "\n";
+        text_ += "# TYPE " + name + " " + type + "\n";
+    }
+
+    void sample(const std::string& name, double value, const Labels& labels = {}) {
+        text_ += name;
+        appendLabels(labels);
+        text_ += ' ';
+        appendValue(value);
+        text_ += '\n';
+    }
+
+    void counter(const std::string& name, const std::string& help, uint64_t value) {
+        header(name, "counter", help);
+        sample(name, static_cast<double>(value));
+    }
+
+    void gauge(const std::string& name, const std::string& help, double value) {
+        header(name, "gauge", help);
+        sample(name, value);
+    }
+
+    // Cumulative buckets, _sum and _count of one stage histogram (header() written by caller)
+    void histogramSamples(const std::string& name, const StageLatencyHistogram& histogram,
+                          const Labels& labels) {
+        const uint64_t count = histogram.count();
+        for (double bound : kStageBucketsSeconds) {
+            const auto nanos = static_cast<uint64_t>(std::llround(bound * 1e9));
+            bucketSample(name, labels, bound, histogram.countBelowNanos(nanos));
+        }
+        bucketSample(name, labels, INFINITY, count);
+        sample(name + "_sum", static_cast<double>(histogram.totalNanos()) / 1e9, labels);
+        sample(name + "_count", static_cast<double>(count), labels);
+    }
+
+    // Same for a millisecond LatencyHistogram (its own bucket bounds are exact)
+    void histogramSamples(const std::string& name, const LatencyHistogram& histogram,
+                          const Labels& labels = {}) {
+        const uint64_t count = histogram.count();
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < LatencyHistogram::kBucketBoundsMs.size(); ++i) {
+            cumulative += histogram.bucketCount(i);
+            bucketSample(name, labels, LatencyHistogram::kBucketBoundsMs[i] / 1000.0, cumulative);
+        }
+        bucketSample(name, labels, INFINITY, count);
+        sample(name + "_sum", histogram.meanMs() * static_cast<double>(count) / 1000.0, labels);
+        sample(name + "_count", static_cast<double>(count), labels);
+    }
+
+    const std::string& text() const { return text_; }
+
+   private:
+    void bucketSample(const std::string& name, Labels labels, double bound, uint64_t count) {
+        std::string le;
+        appendValue(bound, le);
+        labels.emplace_back("le", le);
+        sample(name + "_bucket", static_cast<double>(count), labels);
+    }
+
+    void appendLabels(const Labels& labels) {
+        if (labels.empty()) return;
+        text_ += '{';
+        for (size_t i = 0; i < labels.size(); ++i) {
+            if (i > 0) text_ += ',';
+            text_ += labels[i].first + "=\"";
+            for (char c : labels[i].second) {
+                if (c == '\\' || c == '"') {
+                    text_ += '\\';
+                    text_ += c;
+                } else if (c == '\n') {
+                    text_ += "\\n";
+                } else {
+                    text_ += c;
+                }
+            }
+            text_ += '"';
+        }
+        text_ += '}';
+    }
+
+    void appendValue(double value) { appendValue(value, text_); }
+
+    static void appendValue(double value, std::string& out) {
+        if (std::isinf(value)) {
+            out += value > 0 ? "+Inf" : "-Inf";
+            return;
+        }
+        if (std::isnan(value)) {
+            out += "NaN";
+            return;
+        }
+        char buffer[32];
+        // Counters print as exact integers; everything else keeps 10 significant digits
+        const bool integral = value == std::floor(value) && std::fabs(value) < 9e15;
+        std::snprintf(buffer, sizeof(buffer), integral ? "%.0f" : "%.10g", value);
+        out += buffer;
+    }
+
+    std::string text_;
+};
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <opencv2/core.hpp>
+#include <opencv2/dnn.hpp>
+#include <string>
+#include <vector>
+
+#include "classification_cache.hpp"
+#include "motion_region_consolidator.hpp"
+#include "region_mosaic_packer.hpp"
+#include "region_tensor_builder.hpp"
+#include "tracked_object_store.hpp"
+
+struct RegionClassifierConfig {
+    bool enabled = false;
+    std::string modelPath = "models/yolo11n.onnx";  // YOLO11 exported with format=onnx
+    std::string backend = "cpu";        // "cpu", "opencl", "cuda" or "openvino" (OpenCV DNN)
+    int inputSize = 640;                // Square network input (letterboxed)
+    float confidenceThreshold = 0.5f;   // Best class score needed to label a region
+    int maxBatch = 8;                   // Regions per forward pass (1 = fixed-batch models)
+    double regionPadding = 0.1;         // Crop grows by this fraction of the region per side
+    std::vector<std::string> classNames;  // Model classes by ID (empty = the 80 COCO names)
+    ClassificationCacheConfig cache;      // When classifyRegions() re-classifies a track
+    int maxRegionsPerFrame = 0;           // classifyRegions() budget, new and fast regions first (0 = all)
+    RegionMosaicConfig mosaic;            // Pack small regions into shared inputs (tileSize = inputSize)
+    bool devicePreprocessing = false;     // Build classify()'s input tensor with one OpenCL launch per batch
+};
+
+struct RegionClassification {
+    int classId = -1;
+    std::string label = "unknown";
+    float confidence = 0.0f;
+    cv::Rect2f box;  // Detection: frame coordinates from classify(), crop coordinates from classifyCrops()
+};
+
+struct RegionClassifierStats {
+    uint64_t batches = 0;     // Forward passes
+    uint64_t tiles = 0;       // Network inputs (one per region, or per mosaic of small regions)
+    uint64_t classified = 0;  // Regions sent to the network
+    uint64_t labelled = 0;    // Regions above the confidence threshold
+    uint64_t skipped = 0;     // Regions whose objects were all answered by the cache
+    uint64_t deferred = 0;    // Regions over maxRegionsPerFrame, left for a later frame
+    uint64_t failures = 0;    // Forward passes that threw
+    uint64_t deviceBatches = 0;  // Batches whose input tensor was built on the OpenCL device
+    double lastBatchMs = 0.0;
+};
+
+/**
+ * @brief Runs a YOLO11 detector on the consolidated regions of a frame, in process
+ *
+ * Every region is cropped from the frame (with padding) and drawn into an inputSize tile:
+ * letterboxed on its own, or, with the mosaic enabled, packed at native scale together with
+ * other small regions (see RegionMosaicPacker). The tiles are written into one pooled NCHW
+ * tensor (allocated once for maxBatch tiles), so a frame's regions cost one forward pass
+ * (chunks of maxBatch). With devicePreprocessing, classify() and classifyRegions() build that
+ * tensor from the frame in one OpenCL kernel launch per batch instead (RegionTensorBuilder).
+ * The best-scoring detection centered in a region's part of its tile
+ * labels the region. The model runs through OpenCV's DNN module on the configured
+ * backend; ONNX exports with a fixed batch of 1 are detected on the first failing batch and
+ * fed one region at a time from then on.
+ *
+ * classifyRegions() writes the labels into the regions and into the cold data of their
+ * tracked objects (TrackedObject::classLabel/classConfidence/classId). Results are cached
+ * per track (see ClassificationCache): a region is only classified when one of its tracks
+ * is new, uncertain and due for a retry, or has changed size or appearance or outlived
+ * the refresh interval since its label was set, so a bird is classified once, not on
+ * every frame it stays in view. With maxRegionsPerFrame set, the regions over the budget
+ * are deferred to a later frame (their tracks stay due): regions with a track the cache
+ * has never seen go first, then by speed (RegionMotion, from the motion history), then by
+ * moving area times mean difference (ConsolidatedRegion::motionArea and meanDiff, from the
+ * detection statistics), with jitter (leaves swaying in place) last.
+ *
+ * A missing or unreadable model logs an error and leaves the classifier disabled.
+ *
+ * Thread safety: not thread-safe; use it from one pipeline stage.
+ */
+class RegionClassifier {
+   public:
+    explicit RegionClassifier(const RegionClassifierConfig& config);
+
+    // Enabled in the config and the model loaded
+    bool isEnabled() const { return enabled_; }
+
+    /**
+     * @brief Classify @p regions (frame coordinates) of @p frame
+     * @return One result per region, "unknown" below the confidence threshold
+     */
+    std::vector<RegionClassification> classify(const cv::Mat& frame, const std::vector<cv::Rect>& regions);
+
+    /**
+     * @brief Classify crops that may come from different frames (see ClassificationBatcher)
+     * @return One result per crop; empty crops stay "unknown"
+     */
+    std::vector<RegionClassification> classifyCrops(const std::vector<cv::Mat>& crops);
+
+    // The padded crop classify() takes for @p region (a view of @p frame, empty if outside)
+    cv::Mat cropRegion(const cv::Mat& frame, const cv::Rect& region) const;
+
+    /**
+     * @brief Label @p regions (one frame), classifying only the regions the track cache cannot answer
+     * @return Number of regions sent to the network
+     */
+    size_t classifyRegions(const cv::Mat& frame, std::vector<ConsolidatedRegion>& regions,
+                           TrackedObjectStore& objects);
+
+    const RegionClassifierConfig& getConfig() const { return config_; }
+    const RegionClassifierStats& getStats() const { return stats_; }
+    const ClassificationCacheStats& getCacheStats() const { return cache_.getStats(); }
+
+    /**
+     * @brief Best detection of batch item @p item of a YOLO output (public for testing)
+     *
+     * Accepts the [N, 4 + classes, anchors] layout of YOLOv8/YOLO11 exports as well as the
+     * transposed [N, anchors, 4 + classes]. Only anchors centered in @p area count (empty =
+     * all); the box is in network input coordinates.
+     */
+    static RegionClassification bestDetection(const cv::Mat& output, int item,
+                                              const std::vector<std::string>& classNames,
+                                              float confidenceThreshold, const cv::Rect& area = cv::Rect());
+
+    /**
+     * @brief Scale @p crop to fit a @p size square, padded with YOLO's gray (public for testing)
+     */
+    static void letterbox(const cv::Mat& crop, int size, cv::Mat& canvas);
+
+    // The 80 COCO class names of the pretrained YOLO models
+    static const std::vector<std::string>& cocoClassNames();
+
+   private:
+    // classifyCrops() for crops that are views of @p frame at @p cropRects (empty frame = any crops)
+    std::vector<RegionClassification> classifyCrops(const std::vector<cv::Mat>& crops, const cv::Mat& frame,
+                                                    const std::vector<cv::Rect>& cropRects);
+    void forward(const std::vector<cv::Mat>& crops, const cv::Mat& frame, const std::vector<cv::Rect>& cropRects,
+                 const std::vector<MosaicTile>& tiles, size_t begin, size_t end,
+                 std::vector<RegionClassification>& results);
+    bool buildOnDevice(const cv::Mat& frame, const std::vector<cv::Rect>& cropRects,
+                       const std::vector<MosaicTile>& tiles, size_t begin, size_t end);
+
+    RegionClassifierConfig config_;
+    cv::dnn::Net net_;
+    bool enabled_ = false;
+    bool batching_ = true;  // Cleared when the model rejects a batch larger than 1
+    cv::Mat tensor_;        // Pooled [maxBatch, 3, inputSize, inputSize] network input
+    cv::Mat canvas_;        // Letterboxed crop
+    cv::Mat scaledCanvas_;  // The crop as CV_32F in [0, 1]
+    RegionMosaicPacker packer_;  // Crops to tiles
+    std::unique_ptr<RegionTensorBuilder> deviceTensor_;  // devicePreprocessing with an OpenCL device
+    std::vector<TensorPlacement> devicePlacements_;
+    ClassificationCache cache_;  // Per-track labels of classifyRegions()
+    RegionClassifierStats stats_;
+};
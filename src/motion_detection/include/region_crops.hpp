@@ -0,0 +1,35 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+#include "motion_region_consolidator.hpp"
+
+/**
+ * @file region_crops.hpp
+ * @brief Region crops as ROI headers onto the frame the regions were found in
+ *
+ * A crop shares the frame's pixels and its reference count, so it lives exactly as long as
+ * its frame handle does: a crop held past its frame keeps a pooled capture buffer out of
+ * the FrameBufferPool (which allocates a new one meanwhile) instead of being overwritten.
+ * Pixels are copied only at the boundaries that need their own: the JPEG encoders read
+ * through the crop's row step, the classifier letterboxes crops into its input tile, and
+ * numpy views keep the row stride, so no consumer needs a packed copy of a crop.
+ */
+
+/**
+ * @brief One ROI header onto @p frame per region, clipped to the frame
+ *
+ * A region entirely outside the frame gets an empty Mat, so @p out stays index-aligned
+ * with @p regions. @p out is overwritten; a caller keeping it across frames reuses its
+ * capacity.
+ */
+inline void regionCrops(const cv::Mat& frame, const std::vector<ConsolidatedRegion>& regions,
+                        std::vector<cv::Mat>& out) {
+    const cv::Rect bounds(0, 0, frame.cols, frame.rows);
+    out.resize(regions.size());
+    for (size_t i = 0; i < regions.size(); ++i) {
+        const cv::Rect roi = regions[i].boundingBox & bounds;
+        out[i] = roi.empty() ? cv::Mat() : frame(roi);
+    }
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "motion_region_consolidator.hpp"
+#include "tracked_object_store.hpp"
+
+// flow_propagation: section of the config file
+struct FlowPropagationConfig {
+    bool enabled = false;
+    int detectEveryFrames = 5;            // Full detection and consolidation every k-th frame (1 = every frame)
+    int maxFeaturesPerBox = 16;           // Corners followed inside each box
+    int windowSize = 15;                  // Lucas-Kanade window (pixels, odd)
+    int pyramidLevels = 2;                // Pyramid levels above the base image (0 = single level)
+    double minTrackedFraction = 0.5;      // A box keeping fewer of its points is lost: detect again
+    double maxForwardBackwardError = 1.0; // Pixels a point may miss its start when tracked back
+};
+
+/**
+ * @brief Follows detected boxes between detection frames with sparse pyramidal Lucas-Kanade
+ *
+ * The full MotionProcessor + DBSCAN chain is far more than following a bird across the
+ * frame needs. In detect-every-k mode a detection frame seed()s the propagator with its
+ * boxes: a few Shi-Tomasi corners inside each box, plus a grayscale patch of the box and a
+ * search margin around it. On the frames in between, propagate() converts only those
+ * patches of the new frame, tracks the corners forward and back (points that do not come
+ * back to their start are dropped) and moves each box by the median displacement of its
+ * surviving points. The work per frame is proportional to the number and size of the
+ * boxes, not to the frame: an empty scene costs nothing until the next detection frame.
+ *
+ * A box keeping fewer than minTrackedFraction of its points (occlusion, a bird turning,
+ * a box leaving the frame) is a confidence drop: propagate() returns false and the caller
+ * runs full detection on that frame instead, then seeds again. New birds are picked up by
+ * the next detection frame, at most detectEveryFrames - 1 frames late.
+ *
+ * The motion processor only sees detection frames, so its reference frame and background
+ * model advance every k frames; frame differencing then measures k frames of motion.
+ *
+ * Thread safety: not thread-safe; use one propagator per video stream.
+ */
+class RegionFlowPropagator {
+   public:
+    struct Stats {
+        uint64_t detectionFrames = 0;   // seed() calls
+        uint64_t propagatedFrames = 0;  // Successful propagate() calls
+        uint64_t confidenceDrops = 0;   // propagate() calls that lost a box
+    };
+
+    explicit RegionFlowPropagator(const FlowPropagationConfig& config = FlowPropagationConfig());
+
+    // Whether the next frame needs full detection: never seeded, or the k-th frame since the last seed()
+    bool detectionDue() const;
+
+    // A detection frame: follow @p boxes (in this order) from @p frame on
+    void seed(const cv::Mat& frame, const std::vector<cv::Rect>& boxes);
+
+    /**
+     * @brief Move the followed boxes to @p frame
+     * @param boxes Filled with the moved boxes, in seed() order
+     * @return false on a confidence drop (the caller detects on this frame); @p boxes is then unspecified
+     */
+    bool propagate(const cv::Mat& frame, std::vector<cv::Rect>& boxes);
+
+    // Share of its points each box kept in the last propagate() (1 after seed()), in seed() order
+    const std::vector<float>& confidences() const { return confidences_; }
+    size_t boxCount() const { return tracks_.size(); }
+    const Stats& stats() const { return stats_; }
+
+    const FlowPropagationConfig& getConfig() const { return config_; }
+    // Takes effect at the next seed()
+    void updateConfig(const FlowPropagationConfig& config);
+
+    // Displacement of each box in the last propagate() (zero after seed()), in seed() order
+    const std::vector<cv::Point>& shifts() const { return shifts_; }
+
+    /**
+     * @brief Shift each region by the mean displacement of its objects
+     *
+     * Row i of @p objects is taken to have moved by @p shifts[i], box i of seed()
+     * (ObjectTracker::update() and makeTrackedObjects() keep the box order); regions without
+     * such an object stay put. Static, so a later pipeline stage can apply a copy of shifts().
+     */
+    static void moveRegions(const TrackedObjectStore& objects, const std::vector<cv::Point>& shifts,
+                            std::vector<ConsolidatedRegion>& regions);
+
+   private:
+    struct Track {
+        cv::Rect box;
+        cv::Rect patchRect;                // Box plus search margin, within the frame
+        cv::Mat patch;                     // Grayscale frame at patchRect
+        std::vector<cv::Point2f> points;   // Frame coordinates
+    };
+
+    void seedTrack(const cv::Mat& frame, const cv::Rect& box, Track& track) const;
+    void capturePatch(const cv::Mat& frame, Track& track) const;
+    void findCorners(Track& track) const;
+
+    FlowPropagationConfig config_;
+    int margin_ = 0;  // Search margin around a box: the pyramid's reach
+    std::vector<Track> tracks_;
+    std::vector<float> confidences_;
+    std::vector<cv::Point> shifts_;  // Per box, from the last propagate()
+    bool seeded_ = false;
+    int framesSinceDetection_ = 0;
+    Stats stats_;
+
+    // Per-call scratch, reused across frames
+    cv::Mat nextPatch_;
+    std::vector<cv::Point2f> startPoints_;
+    std::vector<cv::Point2f> movedPoints_;
+    std::vector<cv::Point2f> returnedPoints_;
+    std::vector<unsigned char> status_;
+    std::vector<unsigned char> backStatus_;
+    std::vector<float> errors_;
+    std::vector<float> dx_;
+    std::vector<float> dy_;
+};
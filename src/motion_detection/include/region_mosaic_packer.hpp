@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <opencv2/core.hpp>
+#include <vector>
+
+struct RegionMosaicConfig {
+    bool enabled = false;
+    int tileSize = 640;                  // Network input side (`push`)
+    double sizeTolerancePercent = 30.0;  // Regions within this % below tileSize (or larger) get a tile of their own
+    int spacing = 4;                     // Padding gray between packed regions
+};
+
+// Where one crop lands in a tile: tile = (source - source origin) * scale + target origin
+struct MosaicPlacement {
+    size_t item = 0;  // Index of the crop
+    cv::Rect target;  // Area of the tile the scaled crop fills
+    double scale = 1.0;
+};
+
+struct MosaicTile {
+    std::vector<MosaicPlacement> placements;
+};
+
+/**
+ * @brief Packs region crops into square network-input tiles (a region mosaic)
+ *
+ * Crops whose longer side is within sizeTolerancePercent of tileSize, or above it, are
+ * letterboxed into a tile of their own (scaled to fit, centered). Smaller crops keep their
+ * native scale and are packed with shelf first-fit decreasing into shared tiles, so a frame
+ * with several small birds costs one network input instead of one per bird, without
+ * upscaling any of them. Detections are mapped back with toSource().
+ *
+ * Thread safety: const methods may be called concurrently.
+ */
+class RegionMosaicPacker {
+   public:
+    explicit RegionMosaicPacker(const RegionMosaicConfig& config);
+
+    /**
+     * @brief Assign every non-empty size in @p sizes to a tile
+     * @return Tiles in packing order; empty sizes are left out
+     */
+    std::vector<MosaicTile> pack(const std::vector<cv::Size>& sizes) const;
+
+    // Draw @p tile of @p crops (indexed by MosaicPlacement::item) into a tileSize BGR canvas
+    void render(const std::vector<cv::Mat>& crops, const MosaicTile& tile, cv::Mat& canvas) const;
+
+    // Map @p tileBox (tile coordinates) back into the crop of @p placement
+    static cv::Rect2f toSource(const MosaicPlacement& placement, const cv::Rect2f& tileBox);
+
+    // Whether a crop of @p size gets a tile of its own
+    bool ownsTile(const cv::Size& size) const;
+
+    const RegionMosaicConfig& getConfig() const { return config_; }
+
+   private:
+    RegionMosaicConfig config_;
+};
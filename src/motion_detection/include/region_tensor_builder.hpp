@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <opencv2/core/ocl.hpp>
+#include <vector>
+
+// One crop's part of the network input: @p source (frame pixels) scaled into @p target of tile @p item
+struct TensorPlacement {
+    int item = 0;     // Batch item the crop is drawn into
+    cv::Rect source;  // Frame area (clipped to the frame)
+    cv::Rect target;  // Area of the tile the scaled crop fills
+};
+
+/**
+ * @brief Builds the classifier's NCHW input tensor on the OpenCL device, one launch per batch
+ *
+ * The host path renders every tile (resize or copy into a letterboxed canvas), converts it
+ * to float and splits it into the tensor's planes: three passes over every tile. Here one
+ * kernel does all of it for the whole batch: each work item is one tile pixel, sampled
+ * bilinearly from the frame area of the placement covering it (YOLO's 114 gray elsewhere),
+ * swapped to RGB, scaled to [0, 1] and written into its three planes. The frame is uploaded
+ * once per batch, and only the area spanning the batch's crops; the tensor stays on the
+ * device for a DNN_TARGET_OPENCL network. Gray (luma) frames are expanded to three planes.
+ *
+ * Without an OpenCL device, or when the kernel does not compile, onDevice() is false and
+ * the classifier keeps the host path.
+ *
+ * Thread safety: not thread-safe; one builder per classifier.
+ */
+class RegionTensorBuilder {
+   public:
+    RegionTensorBuilder(int maxBatch, int inputSize);
+
+    bool onDevice() const { return !kernel_.empty(); }
+
+    /**
+     * @brief Write items [0, @p items) of the tensor from @p frame (8-bit, 1 or 3 channels)
+     * @return false (nothing written) without a device or when the launch fails
+     */
+    bool build(const cv::Mat& frame, const std::vector<TensorPlacement>& placements, int items);
+
+    // The first @p items of the pooled [maxBatch, 3, inputSize, inputSize] tensor
+    cv::UMat tensor(int items) const;
+
+    uint64_t launches() const { return launches_; }
+
+   private:
+    int maxBatch_;
+    int inputSize_;
+    cv::ocl::Kernel kernel_;
+    cv::UMat frame_;       // Uploaded frame area of the last batch
+    cv::UMat tensor_;      // Pooled network input
+    cv::UMat placements_;  // 8 ints per placement: source x, y, width, height and target x, y, width, height
+    cv::UMat itemStart_;   // Placements of item i: [itemStart[i], itemStart[i + 1])
+    std::vector<int> placementData_;
+    std::vector<int> itemStartData_;
+    uint64_t launches_ = 0;
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Layout of a frame cache (.bofc): a raw dump that describes itself
+ *
+ * One page holding the Header, then the frames back to back, each starting on a page
+ * boundary (frameStride is frameBytes rounded up to kPageBytes). Every frame therefore
+ * maps onto whole pages and gives the SIMD kernels an aligned base. Little-endian; bump
+ * kVersion whenever this changes.
+ */
+namespace frame_cache_layout {
+
+constexpr uint32_t kMagic = 0x43464F42;  // "BOFC"
+constexpr uint32_t kVersion = 1;
+constexpr uint64_t kPageBytes = 4096;
+
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    int32_t width;
+    int32_t height;
+    int32_t type;  // CV_8UC3 or CV_8UC1
+    uint32_t reserved;
+    uint64_t frameCount;
+    uint64_t frameBytes;   // width * height * channels
+    uint64_t frameStride;  // Distance between frame starts
+    uint64_t dataOffset;   // First frame (kPageBytes)
+};
+
+static_assert(sizeof(Header) == 56, "Header layout changed");
+
+}  // namespace frame_cache_layout
+
+/**
+ * @brief Deterministic in-memory frame source for headless replays and benchmarks
+ *
+ * Frames come either from a video or image set decoded once up front (so decode cost and
+ * codec jitter stay out of the measurement) or from a file mapped read-only into memory
+ * (no decode at all, and the page cache is shared between runs). Two mapped formats exist:
+ * a raw dump is the frames back to back, width * height * channels bytes each, with no
+ * header (writeRawDump()); a frame cache adds a header with the size and type and puts
+ * every frame on a page boundary (writeFrameCache(), frame_cache_layout), so it opens
+ * without being told what it holds. birds_of_play_frame_cache converts videos and image
+ * sets into frame caches.
+ *
+ * Frames are immutable: frame() returns headers over the stored pixels, which callers must
+ * not write to (MotionProcessor only reads its input).
+ */
+class ReplayFrameSource {
+   public:
+    /**
+     * @brief Decode a video file into memory
+     * @param maxFrames Stop after this many frames (-1 = whole file)
+     * @throws std::runtime_error if the video cannot be opened or has no frames
+     */
+    static ReplayFrameSource fromVideo(const std::string& path, int maxFrames = -1);
+
+    /**
+     * @brief Decode image files into memory, in the given order
+     * @throws std::runtime_error if an image cannot be read or differs in size or type
+     */
+    static ReplayFrameSource fromImages(const std::vector<std::string>& paths);
+
+    /**
+     * @brief Map a raw frame dump
+     * @param frameSize Size of every frame in the dump
+     * @param type CV_8UC3 (BGR) or CV_8UC1 (gray / luma)
+     * @throws std::runtime_error if the file cannot be mapped or is not a whole number of frames
+     */
+    static ReplayFrameSource fromRawDump(const std::string& path, const cv::Size& frameSize, int type);
+
+    /**
+     * @brief Write frames (all the same size and type) as a raw dump
+     * @throws std::runtime_error on mismatched frames or I/O errors
+     */
+    static void writeRawDump(const std::string& path, const std::vector<cv::Mat>& frames);
+
+    /**
+     * @brief Map a frame cache written by writeFrameCache()
+     * @throws std::runtime_error if the file cannot be mapped or is not a complete frame cache
+     */
+    static ReplayFrameSource fromFrameCache(const std::string& path);
+
+    /**
+     * @brief Write frames (all the same size, CV_8UC3 or CV_8UC1) as a frame cache
+     * @throws std::runtime_error on mismatched frames or I/O errors
+     */
+    static void writeFrameCache(const std::string& path, const std::vector<cv::Mat>& frames);
+
+    // Whether @p path starts like a frame cache (false if it cannot be read)
+    static bool isFrameCache(const std::string& path);
+
+    ReplayFrameSource(ReplayFrameSource&& other) noexcept;
+    ReplayFrameSource& operator=(ReplayFrameSource&& other) noexcept;
+    ReplayFrameSource(const ReplayFrameSource&) = delete;
+    ReplayFrameSource& operator=(const ReplayFrameSource&) = delete;
+    ~ReplayFrameSource();
+
+    size_t size() const { return frameCount_; }
+    bool empty() const { return frameCount_ == 0; }
+    cv::Size frameSize() const { return frameSize_; }
+    int frameType() const { return frameType_; }
+    // Pixel bytes held in memory (decoded) or mapped (raw dump)
+    size_t byteSize() const;
+    bool isMapped() const { return mapping_ != nullptr; }
+
+    cv::Mat frame(size_t index) const;
+
+   private:
+    ReplayFrameSource() = default;
+    void unmap();
+
+    std::vector<cv::Mat> decoded_;  // fromVideo
+    void* mapping_ = nullptr;       // fromRawDump, fromFrameCache
+    size_t mappingBytes_ = 0;
+    size_t firstFrameOffset_ = 0;  // Into the mapping
+    size_t frameStride_ = 0;
+    size_t frameCount_ = 0;
+    cv::Size frameSize_;
+    int frameType_ = CV_8UC3;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+/**
+ * @brief Fixed-capacity ring buffer stored inline (no heap allocation)
+ *
+ * push() appends at the back and overwrites the oldest element once full, so the buffer
+ * always holds the most recent Capacity values. Index 0 is the oldest element.
+ */
+template <typename T, size_t Capacity>
+class FixedRingBuffer {
+    static_assert(Capacity > 0, "FixedRingBuffer needs a non-zero capacity");
+
+   public:
+    void push(const T& value) {
+        data_[(start_ + size_) % Capacity] = value;
+        if (size_ < Capacity) {
+            ++size_;
+        } else {
+            start_ = (start_ + 1) % Capacity;
+        }
+    }
+
+    void popFront() {
+        if (size_ == 0) return;
+        start_ = (start_ + 1) % Capacity;
+        --size_;
+    }
+
+    // Drop the oldest elements until at most maxSize remain
+    void truncateFront(size_t maxSize) {
+        while (size_ > maxSize) popFront();
+    }
+
+    void clear() {
+        start_ = 0;
+        size_ = 0;
+    }
+
+    const T& operator[](size_t i) const { return data_[(start_ + i) % Capacity]; }
+    const T& front() const { return (*this)[0]; }
+    const T& back() const { return (*this)[size_ - 1]; }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    static constexpr size_t capacity() { return Capacity; }
+
+   private:
+    std::array<T, Capacity> data_{};
+    size_t start_ = 0;
+    size_t size_ = 0;
+};
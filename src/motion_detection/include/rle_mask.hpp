@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+#include "packed_mask.hpp"
+
+/**
+ * @brief Binary mask stored as its runs of set pixels
+ *
+ * A motion mask is mostly empty with a few solid blobs, so a bird of 40 rows is some 40
+ * runs instead of a 300 KB byte mask. Area, bounds and centroid are sums over the runs,
+ * and encode() writes them as a few hundred characters for a saved frame's metadata, which
+ * the web viewer decodes to draw the mask over the frame.
+ *
+ * The grid is the detection grid (the ROI crop, possibly downscaled); frameArea() is the
+ * rectangle of frame pixels it covers, which toFrame() maps onto.
+ */
+class RleMask {
+   public:
+    struct Stats {
+        int64_t area = 0;      // Set pixels
+        cv::Rect bounds;       // Empty without set pixels
+        cv::Point2d centroid;  // Of the pixel centers, (x + 0.5, y + 0.5)
+    };
+
+    // Runs of the non-zero pixels of a CV_8UC1 mask
+    void assign(const cv::Mat& mask);
+    // Runs of the set bits, read with bit scans
+    void assign(const PackedMask& mask);
+    // Runs already found (e.g. RunLabeler::runs()); must be in raster order
+    void assign(cv::Size size, const std::vector<MaskRun>& runs);
+    void clear();
+
+    bool empty() const { return runs_.empty(); }
+    cv::Size size() const { return size_; }
+    const std::vector<MaskRun>& runs() const { return runs_; }
+
+    // Frame pixels the grid covers; toFrame() is the identity until it is set
+    void setFrameArea(const cv::Rect& area) { frameArea_ = area; }
+    const cv::Rect& frameArea() const { return frameArea_; }
+    cv::Rect toFrame(const cv::Rect& rect) const;
+    cv::Point2d toFrame(const cv::Point2d& point) const;
+
+    // One pass over the runs; grid coordinates
+    Stats stats() const;
+
+    // CV_8UC1 mask with @p value at the set pixels
+    void unpack(cv::Mat& mask, uchar value = 255) const;
+
+    /**
+     * @brief The mask as compressed RLE text
+     *
+     * The lengths of the alternating unset and set runs of the grid in row-major raster
+     * order, starting with unset (possibly 0) and adding up to width * height, written
+     * with the string codec of COCO's compressed RLE: each length is stored relative to
+     * the one two before it, in 5-bit groups as the characters '0' (48) to 111. Note the
+     * order is row-major, where COCO's is column-major.
+     */
+    std::string encode() const;
+
+    /**
+     * @brief Replace the mask with a decoded encode() string of a @p size grid
+     * @return false (mask cleared) when the text is malformed or does not cover the grid
+     */
+    bool decode(cv::Size size, const std::string& counts);
+
+   private:
+    cv::Size size_;
+    cv::Rect frameArea_;
+    std::vector<MaskRun> runs_;
+};
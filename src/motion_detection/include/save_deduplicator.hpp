@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <vector>
+
+#include "motion_region_consolidator.hpp"  // For ConsolidatedRegion
+
+struct SaveDedupConfig {
+    bool enabled = false;
+    int maxHashDistance = 6;               // dHash bits (of 64) a region may differ by and still match
+    double minIou = 0.8;                   // Box overlap a region needs to match its last save
+    std::chrono::seconds maxInterval{60};  // Save at least this often, even if nothing changed
+};
+
+/**
+ * @brief Persistence filter that skips saves of an unchanged scene
+ *
+ * Remembers the consolidated regions of the last saved frame with a 64-bit difference hash
+ * (dHash) of each region's crop. A later frame is a duplicate when every one of its regions
+ * matches a remembered region, i.e. the two share a tracked object ID or overlap by at least
+ * minIou, AND their hashes differ by at most maxHashDistance bits. Duplicates are skipped
+ * until maxInterval has passed since the matched save; any new, moved or changed region
+ * makes the frame a save again, and the remembered set becomes that frame's regions.
+ *
+ * Comparing against the last *saved* state (not the previous frame) means slow drift still
+ * triggers a save once it adds up.
+ *
+ * Thread safety: shouldSave() from one thread (the render stage); skipped() from any.
+ */
+class SaveDeduplicator {
+   public:
+    explicit SaveDeduplicator(const SaveDedupConfig& config = SaveDedupConfig());
+
+    /**
+     * @brief Whether a frame due for saving differs enough from the last save to store it
+     *
+     * Always true when disabled or when the frame has no regions (nothing to compare).
+     * A true result records the frame as the new reference.
+     */
+    bool shouldSave(const cv::Mat& frame, const std::vector<ConsolidatedRegion>& regions,
+                    std::chrono::steady_clock::time_point now);
+
+    // Saves rejected as duplicates so far
+    uint64_t skipped() const { return skipped_.load(std::memory_order_relaxed); }
+
+    const SaveDedupConfig& config() const { return config_; }
+
+    // Forget the reference regions (the next frame with regions is saved)
+    void reset() { saved_.clear(); }
+
+    // 64-bit difference hash: 9x8 grayscale thumbnail, one bit per horizontal gradient sign
+    static uint64_t differenceHash(const cv::Mat& image);
+
+    static int hammingDistance(uint64_t a, uint64_t b);
+
+   private:
+    struct SavedRegion {
+        cv::Rect box;
+        RegionObjectIds trackedObjectIds;
+        uint64_t hash = 0;
+        std::chrono::steady_clock::time_point savedAt;
+    };
+
+    SaveDedupConfig config_;
+    std::vector<SavedRegion> saved_;
+    std::atomic<uint64_t> skipped_{0};
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+struct SharedFrameRingConfig {
+    std::string name = "/birds_of_play_frames";  // POSIX shm name (/dev/shm/birds_of_play_frames)
+    uint32_t slotCount = 8;                      // Most recent frames kept
+    uint32_t maxWidth = 1920;                    // Larger frames are not published
+    uint32_t maxHeight = 1080;
+    uint32_t maxChannels = 3;
+};
+
+/**
+ * @brief Shared-memory layout, read by src/image_detection/shared_frame_reader.py
+ *
+ * All fields are little-endian and naturally aligned. The segment is one RingHeader followed
+ * by slotCount slots of slotBytes each; a slot is a SlotHeader followed by the pixels (rows
+ * of width * channels bytes, 8-bit BGR or gray, no padding). Bump kVersion whenever the
+ * layout changes.
+ */
+namespace shared_frame_layout {
+
+constexpr uint32_t kMagic = 0x52504F42;  // "BOPR"
+constexpr uint32_t kVersion = 1;
+constexpr size_t kMaxRegions = 24;
+constexpr size_t kHeaderBytes = 128;
+constexpr size_t kSlotHeaderBytes = 512;
+
+struct RingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t reserved;
+    uint64_t slotBytes;                // Distance between slots, slot header included
+    uint64_t maxPixelBytes;            // Pixel capacity of a slot
+    std::atomic<uint64_t> published;   // Frames published so far; the newest is published - 1
+    int64_t writerPid;
+};
+
+struct SlotHeader {
+    // Seqlock: odd while the writer fills the slot, 2 * (frameNumber + 1) once it is complete
+    std::atomic<uint64_t> sequence;
+    uint64_t frameNumber;  // Position in the publish order
+    int64_t frameIndex;    // Pipeline frame index
+    int64_t timestampUs;   // Unix microseconds
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;
+    uint32_t regionCount;      // Consolidated regions listed in regions
+    uint32_t motionBoxCount;   // Individual motion boxes in the frame (not listed)
+    uint32_t reserved;
+    int32_t regions[kMaxRegions][4];  // x, y, width, height
+};
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "atomic must be lock-free");
+static_assert(sizeof(RingHeader) <= kHeaderBytes, "RingHeader exceeds its reserved space");
+static_assert(sizeof(SlotHeader) <= kSlotHeaderBytes, "SlotHeader exceeds its reserved space");
+
+}  // namespace shared_frame_layout
+
+/**
+ * @brief Publishes the most recent frames into POSIX shared memory for other processes
+ *
+ * A single writer (the render stage) copies each published frame, its consolidated region
+ * boxes and a few counters into the next slot of a fixed ring. Readers in other processes
+ * (a YOLO worker, a live preview) map the segment read-only and look at the newest slots
+ * without any lock, socket or interpreter shared with the capture process; region crops are
+ * views into the frame given the boxes.
+ *
+ * Each slot is guarded by a seqlock: the writer marks the slot odd while copying and even
+ * once it is complete, then advances RingHeader::published. A reader samples the sequence
+ * before and after using a slot and discards the frame if it changed, so a slow reader never
+ * blocks the writer; it just loses frames older than slotCount.
+ *
+ * Thread safety: publish() from one thread only. The segment is unlinked by the destructor.
+ */
+class SharedFrameRing {
+   public:
+    explicit SharedFrameRing(const SharedFrameRingConfig& config = SharedFrameRingConfig());
+    ~SharedFrameRing();
+
+    SharedFrameRing(const SharedFrameRing&) = delete;
+    SharedFrameRing& operator=(const SharedFrameRing&) = delete;
+
+    // True if the segment was created and mapped
+    bool isOpen() const { return base_ != nullptr; }
+
+    /**
+     * @brief Copy @p frame (8-bit, 1 or 3 channels) and its regions into the next slot
+     * @return false if the ring is closed or the frame does not fit a slot
+     */
+    bool publish(const cv::Mat& frame, int64_t frameIndex, int64_t timestampUs,
+                 const std::vector<cv::Rect>& regions, size_t motionBoxCount);
+
+    uint64_t published() const;
+    const SharedFrameRingConfig& config() const { return config_; }
+
+   private:
+    shared_frame_layout::RingHeader* header() const;
+    unsigned char* slot(uint64_t frameNumber) const;
+
+    SharedFrameRingConfig config_;
+    unsigned char* base_ = nullptr;
+    size_t size_ = 0;
+    uint64_t inode_ = 0;      // Of the segment this writer created, to tell it from a successor's
+    uint64_t oversized_ = 0;  // Frames skipped because they exceed the slot size
+};
+
+/**
+ * @brief Read-only view of a SharedFrameRing segment (tests and native consumers)
+ *
+ * Python consumers use shared_frame_reader.py, which follows the same protocol.
+ */
+class SharedFrameRingReader {
+   public:
+    struct Frame {
+        uint64_t frameNumber = 0;
+        int64_t frameIndex = 0;
+        int64_t timestampUs = 0;
+        cv::Mat image;  // Copy, safe to keep
+        std::vector<cv::Rect> regions;
+        size_t motionBoxCount = 0;
+    };
+
+    explicit SharedFrameRingReader(const std::string& name = SharedFrameRingConfig().name);
+    ~SharedFrameRingReader();
+
+    SharedFrameRingReader(const SharedFrameRingReader&) = delete;
+    SharedFrameRingReader& operator=(const SharedFrameRingReader&) = delete;
+
+    bool isOpen() const { return base_ != nullptr; }
+    uint64_t published() const;
+
+    /**
+     * @brief Copy out the frame with the given publish number
+     * @return false if it was never published, was overwritten, or changed while copying
+     */
+    bool read(uint64_t frameNumber, Frame& frame) const;
+
+    // The newest complete frame
+    bool latest(Frame& frame) const;
+
+   private:
+    const unsigned char* base_ = nullptr;
+    size_t size_ = 0;
+};
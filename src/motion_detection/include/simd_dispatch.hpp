@@ -0,0 +1,36 @@
+#pragma once
+
+/**
+ * @brief Instruction sets the fused motion mask kernels (motion_mask_kernel.hpp) can run on
+ *
+ * Universal128 is OpenCV's 128-bit universal intrinsics (SSE2 / NEON / VSX, whatever the
+ * build targets). Avx2, Avx512 (AVX-512BW) and Neon are hand-written variants compiled
+ * into their own translation units with ENABLE_SIMD_DISPATCH, so one binary runs on any
+ * CPU of its architecture and uses the widest vectors it has.
+ */
+enum class SimdLevel {
+    Scalar,
+    Universal128,
+    Neon,
+    Avx2,
+    Avx512,
+};
+
+const char* simdLevelName(SimdLevel level);
+
+// Whether this build has @p level and the CPU running it can execute it
+bool simdLevelSupported(SimdLevel level);
+
+// The widest supported level: what simdLevel() starts at
+SimdLevel bestSimdLevel();
+
+// Level the kernels currently use
+SimdLevel simdLevel();
+
+/**
+ * @brief Force the kernels onto @p level (tests, benchmarks, A/B runs)
+ * @return false, leaving the level unchanged, if @p level is not supported
+ *
+ * Thread-safe; kernels already running finish on the previous level.
+ */
+bool setSimdLevel(SimdLevel level);
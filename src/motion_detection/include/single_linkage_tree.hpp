@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Single-linkage merge tree of one frame's boxes, cut at any distance
+ *
+ * Built once from the weighted neighbor edges (Kruskal: edges in ascending distance join
+ * components through a union-find), recording the distance of every merge. The clusters
+ * at a cut d are the components joined by merges at distance <= d: the connected components
+ * of the edges within d, which is DBSCAN at eps = d with minPts <= 1. One tree answers every
+ * cut, so regions at several granularities cost one pair evaluation and one sort.
+ *
+ * Nodes 0..leaves()-1 are the boxes; merge k creates node leaves() + k.
+ */
+class SingleLinkageTree {
+   public:
+    struct Edge {
+        int a = 0;
+        int b = 0;
+        double distance = 0.0;
+    };
+    struct Merge {
+        int left = 0;   // Node ids of the two joined subtrees
+        int right = 0;
+        double distance = 0.0;
+        int size = 0;   // Leaves below the new node
+    };
+
+    // Build over @p leaves points from @p edges (sorted in place; edges beyond the largest
+    // cut that will be asked for may be left out)
+    void build(int leaves, std::vector<Edge>& edges);
+
+    int leaves() const { return leaves_; }
+    // In ascending distance; ties in the order the sort left them
+    const std::vector<Merge>& merges() const { return merges_; }
+
+    /**
+     * @brief Clusters at @p distance
+     * @param labels Set to the cluster of every leaf; clusters are numbered in the order of
+     *               their smallest leaf
+     * @return Number of clusters (singletons included)
+     */
+    int cut(double distance, std::vector<int>& labels) const;
+
+   private:
+    int leaves_ = 0;
+    std::vector<Merge> merges_;
+    std::vector<std::pair<int, int>> mergedLeaves_;  // A leaf of each side of merge k
+    mutable std::vector<int> parent_;                // cut() scratch
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+
+/**
+ * @brief Vector that keeps up to InlineCapacity elements inline and moves to the heap beyond
+ *
+ * Meant for short lists in hot paths (the object IDs of a consolidated region) that would
+ * otherwise cost a heap allocation each. Limited to trivially copyable T, so elements are
+ * copied in bulk and never constructed or destroyed one by one. Copy assignment and clear()
+ * keep the current capacity.
+ */
+template <typename T, size_t InlineCapacity>
+class SmallVector {
+    static_assert(InlineCapacity > 0, "SmallVector needs a non-zero inline capacity");
+    static_assert(std::is_trivially_copyable<T>::value, "SmallVector only holds trivially copyable types");
+
+   public:
+    using value_type = T;
+    using size_type = size_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    SmallVector() = default;
+    SmallVector(std::initializer_list<T> values) { assign(values.begin(), values.end()); }
+    template <typename ForwardIt>
+    SmallVector(ForwardIt first, ForwardIt last) {
+        assign(first, last);
+    }
+
+    SmallVector(const SmallVector& other) { assign(other.begin(), other.end()); }
+    SmallVector(SmallVector&& other) noexcept { takeFrom(other); }
+
+    SmallVector& operator=(const SmallVector& other) {
+        if (this != &other) assign(other.begin(), other.end());
+        return *this;
+    }
+    SmallVector& operator=(SmallVector&& other) noexcept {
+        if (this != &other) {
+            heap_.reset();
+            takeFrom(other);
+        }
+        return *this;
+    }
+
+    template <typename ForwardIt>
+    void assign(ForwardIt first, ForwardIt last) {
+        const size_t count = static_cast<size_t>(std::distance(first, last));
+        reserve(count);
+        std::copy(first, last, data_);
+        size_ = count;
+    }
+
+    void push_back(const T& value) {
+        if (size_ == capacity_) {
+            const T copy = value;  // value may live in the storage that grow() releases
+            grow(capacity_ * 2);
+            data_[size_++] = copy;
+            return;
+        }
+        data_[size_++] = value;
+    }
+
+    void reserve(size_t capacity) {
+        if (capacity > capacity_) grow(capacity);
+    }
+
+    void clear() { size_ = 0; }
+
+    bool contains(const T& value) const { return std::find(begin(), end(), value) != end(); }
+
+    T& operator[](size_t i) { return data_[i]; }
+    const T& operator[](size_t i) const { return data_[i]; }
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+
+    iterator begin() { return data_; }
+    iterator end() { return data_ + size_; }
+    const_iterator begin() const { return data_; }
+    const_iterator end() const { return data_ + size_; }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t capacity() const { return capacity_; }
+    bool isInline() const { return data_ == inline_.data(); }
+
+    friend bool operator==(const SmallVector& a, const SmallVector& b) {
+        return a.size_ == b.size_ && std::equal(a.begin(), a.end(), b.begin());
+    }
+    friend bool operator!=(const SmallVector& a, const SmallVector& b) { return !(a == b); }
+
+   private:
+    void grow(size_t capacity) {
+        std::unique_ptr<T[]> storage(new T[capacity]);
+        std::copy(data_, data_ + size_, storage.get());
+        heap_ = std::move(storage);
+        data_ = heap_.get();
+        capacity_ = capacity;
+    }
+
+    // Leaves other empty; a heap buffer changes hands, inline elements are copied
+    void takeFrom(SmallVector& other) noexcept {
+        if (other.isInline()) {
+            std::copy(other.begin(), other.end(), inline_.data());
+            data_ = inline_.data();
+            capacity_ = InlineCapacity;
+        } else {
+            heap_ = std::move(other.heap_);
+            data_ = heap_.get();
+            capacity_ = other.capacity_;
+        }
+        size_ = other.size_;
+        other.data_ = other.inline_.data();
+        other.capacity_ = InlineCapacity;
+        other.size_ = 0;
+    }
+
+    std::array<T, InlineCapacity> inline_;
+    std::unique_ptr<T[]> heap_;
+    T* data_ = inline_.data();
+    size_t capacity_ = InlineCapacity;
+    size_t size_ = 0;
+};
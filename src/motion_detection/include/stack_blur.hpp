@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <vector>
+
+/**
+ * @brief Integer triangle ("stack") blur whose cost does not depend on the radius
+ *
+ * The kernel is the triangle w(k) = radius + 1 - |k|, applied horizontally and then
+ * vertically. Both passes keep three running sums per row or column, for the whole
+ * window, its left (upper) half and its right (lower) half. A step of the window then
+ * costs three additions and subtractions however large the radius. Borders are
+ * BORDER_REFLECT_101, as in cv::GaussianBlur.
+ *
+ * The arithmetic is exact integer: each output is the rounded weighted mean. A band of
+ * rows (plus radius() halo rows) therefore gives the same pixels as the whole frame.
+ *
+ * With @p luma, a BGR input is reduced to BT.601 luma in the same pass: the fixed-point
+ * weights and rounding of cv::cvtColor(COLOR_BGR2GRAY). The colour frame is then read
+ * once and only the blurred luma is written. The vertical pass streams the horizontal
+ * rows through a ring of 2 * radius + 3 rows, so the intermediate stays in cache.
+ *
+ * Thread safety: apply() is const; concurrent calls need separate Workspaces.
+ */
+class StackBlur {
+   public:
+    // Scratch buffers for apply(); sized on first use
+    struct Workspace {
+        std::vector<uchar> row;          // One input row reduced to luma, or one channel
+        std::vector<int> columns;        // Reflected column index per padded position
+        std::vector<uint32_t> ring;      // Horizontal sums of the last 2 * radius + 3 rows
+        std::vector<uint32_t> sum;       // Vertical window sums per column and channel
+        std::vector<uint32_t> sumAbove;  // Rows -radius..0 of the window
+        std::vector<uint32_t> sumBelow;  // Rows 1..radius of the window
+    };
+
+    // @param radius Triangle half-width, clamped to 1..31 (the sums stay within 32 bits)
+    explicit StackBlur(int radius = 2);
+
+    // Radius whose triangle has the variance of cv::GaussianBlur's kernel of @p kernelSize
+    // (sigma derived from the size, as GaussianBlur does for sigma 0)
+    static int radiusForGaussian(int kernelSize);
+
+    /**
+     * @brief Blur an 8-bit image
+     * @param luma With a 3-channel BGR input, write the blurred CV_8UC1 luma; otherwise
+     *        every channel is blurred and @p output has the input's type
+     * @param output Reallocated only on size change; may alias @p input unless reduced to luma
+     */
+    void apply(const cv::Mat& input, cv::Mat& output, Workspace& workspace, bool luma = false) const;
+
+    int radius() const { return radius_; }
+
+   private:
+    int radius_;
+};
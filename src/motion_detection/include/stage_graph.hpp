@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+class WorkStealingPool;
+
+/**
+ * @brief Per-frame dataflow graph of named stages connected by named slots
+ *
+ * A stage declares the slots it reads (inputs) and the slots it fills (outputs); each slot
+ * has one producer, or is a source filled by the caller before run(). compile() orders the
+ * stages into levels, a level holding the stages whose inputs the earlier levels produce,
+ * and deactivates every stage whose outputs nobody consumes: active stages are those that
+ * produce a requested output or feed another active stage, plus sinks (stages kept for a
+ * side effect such as writing a file).
+ *
+ * run() executes the active stages level by level. With a pool, the stages of one level
+ * run concurrently: the calling thread works through the level too and only waits for
+ * stages already running elsewhere, so run() may itself be called from a pool task without
+ * tying up a worker. Stages of one level must not touch the same data except read-only
+ * through their inputs.
+ *
+ * Thread safety: build and compile() from one thread; run() is not reentrant.
+ */
+class StageGraph {
+   public:
+    using StageFunction = std::function<void()>;
+
+    struct StageInfo {
+        std::string name;
+        std::vector<std::string> inputs;
+        std::vector<std::string> outputs;
+        bool sink = false;
+        bool active = false;  // Set by compile()
+        int level = -1;       // Set by compile(); -1 for inactive stages
+    };
+
+    // Declare a slot the caller fills before run() (e.g. the frame)
+    void addSource(const std::string& slot);
+
+    // @param sink Keep the stage even when none of its outputs is consumed
+    void addStage(const std::string& name, std::vector<std::string> inputs, std::vector<std::string> outputs,
+                  StageFunction function, bool sink = false);
+
+    // Slots the caller reads after run(); replaces earlier requests
+    void requestOutputs(std::vector<std::string> slots);
+
+    /**
+     * @brief Validate the graph and schedule its active stages
+     * @throws std::invalid_argument for a duplicate stage name, a slot with two producers,
+     *         an input or requested output that nothing produces, or a cycle
+     */
+    void compile();
+
+    // Run the active stages once; rethrows the first exception a stage threw (after the
+    // rest of its level has finished; later levels are skipped)
+    void run(WorkStealingPool* pool = nullptr);
+
+    const std::vector<StageInfo>& stages() const { return info_; }
+    // Active stage indices per level, in order of execution
+    const std::vector<std::vector<size_t>>& levels() const { return levels_; }
+    bool isActive(const std::string& stage) const;
+    // Whether an active stage (or the caller) reads @p slot
+    bool isConsumed(const std::string& slot) const;
+    bool isCompiled() const { return compiled_; }
+
+   private:
+    void runLevel(const std::vector<size_t>& level, WorkStealingPool& pool);
+
+    std::vector<std::string> sources_;
+    std::vector<std::string> requested_;
+    std::vector<StageInfo> info_;
+    std::vector<StageFunction> functions_;
+    std::vector<std::vector<size_t>> levels_;
+    std::vector<std::string> consumed_;
+    bool compiled_ = false;
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Lock-free log-linear latency histogram with ~12% resolution from 1 ns to ~1 min
+ *
+ * LatencyHistogram's millisecond buckets are too coarse for the per-stage timers (most
+ * stages take well under a millisecond), so durations are bucketed by power of two with
+ * eight linear sub-buckets each: values below 8 ns get exact buckets, larger ones land in
+ * a bucket at most 1/8 of its lower bound wide. Percentiles report the bucket's upper
+ * bound, i.e. never under-state a latency.
+ *
+ * Thread safety: record() and all readers may be called concurrently.
+ */
+class StageLatencyHistogram {
+   public:
+    static constexpr int kSubBuckets = 8;
+    static constexpr int kMaxExponent = 36;  // 2^36 ns ~ 69 s; longer durations share the last bucket
+    static constexpr size_t kBucketCount = static_cast<size_t>((kMaxExponent - 2) * kSubBuckets + 1);
+
+    void record(std::chrono::nanoseconds elapsed) {
+        const uint64_t nanos = elapsed.count() > 0 ? static_cast<uint64_t>(elapsed.count()) : 0;
+        buckets_[bucketOf(nanos)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        totalNanos_.fetch_add(nanos, std::memory_order_relaxed);
+        uint64_t previous = maxNanos_.load(std::memory_order_relaxed);
+        while (nanos > previous && !maxNanos_.compare_exchange_weak(previous, nanos, std::memory_order_relaxed)) {
+        }
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+
+    double meanMicros() const {
+        const uint64_t n = count();
+        if (n == 0) return 0.0;
+        return static_cast<double>(totalNanos_.load(std::memory_order_relaxed)) / 1000.0 / static_cast<double>(n);
+    }
+
+    double maxMicros() const { return static_cast<double>(maxNanos_.load(std::memory_order_relaxed)) / 1000.0; }
+
+    /**
+     * @brief Percentile in microseconds (upper bound of the bucket containing it, capped at the max)
+     * @param fraction Percentile in [0, 1] (e.g. 0.99)
+     */
+    double percentileMicros(double fraction) const {
+        const uint64_t n = count();
+        if (n == 0) return 0.0;
+        const uint64_t target = static_cast<uint64_t>(fraction * static_cast<double>(n));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBucketCount; ++i) {
+            seen += buckets_[i].load(std::memory_order_relaxed);
+            if (seen > target) {
+                const double bound = static_cast<double>(upperBoundNanos(i)) / 1000.0;
+                return bound < maxMicros() ? bound : maxMicros();
+            }
+        }
+        return maxMicros();
+    }
+
+    uint64_t totalNanos() const { return totalNanos_.load(std::memory_order_relaxed); }
+
+    // Samples in buckets that lie entirely below @p nanos (cumulative, for coarse exports)
+    uint64_t countBelowNanos(uint64_t nanos) const {
+        uint64_t below = 0;
+        for (size_t i = 0; i < kBucketCount && upperBoundNanos(i) <= nanos; ++i) {
+            below += buckets_[i].load(std::memory_order_relaxed);
+        }
+        return below;
+    }
+
+    void reset() {
+        for (auto& bucket : buckets_) bucket.store(0, std::memory_order_relaxed);
+        count_.store(0, std::memory_order_relaxed);
+        totalNanos_.store(0, std::memory_order_relaxed);
+        maxNanos_.store(0, std::memory_order_relaxed);
+    }
+
+    // Bucket index of a duration: exact below kSubBuckets, then (exponent, sub-bucket)
+    static size_t bucketOf(uint64_t nanos) {
+        if (nanos < kSubBuckets) return static_cast<size_t>(nanos);
+        int exponent = 0;
+        for (uint64_t v = nanos; v > 1; v >>= 1) ++exponent;  // floor(log2), >= 3 here
+        if (exponent >= kMaxExponent) return kBucketCount - 1;
+        const uint64_t sub = (nanos >> (exponent - 3)) & (kSubBuckets - 1);
+        return static_cast<size_t>((exponent - 2) * kSubBuckets) + static_cast<size_t>(sub);
+    }
+
+    // Exclusive upper bound of a bucket in nanoseconds
+    static uint64_t upperBoundNanos(size_t bucket) {
+        if (bucket < kSubBuckets) return bucket + 1;
+        const int exponent = static_cast<int>(bucket / kSubBuckets) + 2;
+        const uint64_t sub = bucket % kSubBuckets;
+        return (kSubBuckets + sub + 1) << (exponent - 3);
+    }
+
+   private:
+    std::array<std::atomic<uint64_t>, kBucketCount> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> totalNanos_{0};
+    std::atomic<uint64_t> maxNanos_{0};
+};
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "profiler_zones.hpp"
+#include "stage_latency_histogram.hpp"
+
+// Scoped stage timers are compiled in only with -DENABLE_STAGE_TIMING=ON (CMake), which
+// defines BIRDS_STAGE_TIMING=1; otherwise STAGE_TIMER expands to nothing and the
+// histograms stay empty
+#ifndef BIRDS_STAGE_TIMING
+#define BIRDS_STAGE_TIMING 0
+#endif
+// ENABLE_ALLOCATION_COUNTING builds (BIRDS_ALLOCATION_COUNTING=1) compile the scopes in too,
+// to charge allocations to the current stage (allocation_counter.hpp); they then only time
+// with BIRDS_STAGE_TIMING as well
+#ifndef BIRDS_ALLOCATION_COUNTING
+#define BIRDS_ALLOCATION_COUNTING 0
+#endif
+
+/**
+ * @brief Pipeline stages timed by STAGE_TIMER
+ *
+ * PREPROCESS covers the whole preprocessing step, so it includes CLAHE and BLUR. DIFF is
+ * the frame difference together with its threshold histogram; THRESHOLD applies the
+ * chosen level. PERSIST is the save scheduling on the processing thread (the persistence
+ * worker's encode/insert latencies are reported by FramePersistenceQueue).
+ */
+enum class PipelineStage : size_t {
+    PREPROCESS,
+    CLAHE,
+    BLUR,
+    DIFF,
+    BACKGROUND,  // MOG2 model update
+    THRESHOLD,
+    FLOOD_GUARD,  // Whole-frame change check (and shift compensation) of the mask
+    MORPHOLOGY,
+    EXTRACTION,  // Contour / component extraction and filtering
+    REFINEMENT,  // Full-resolution re-detection around downscaled boxes
+    CLUSTERING,  // DBSCAN
+    REGION_MERGE,
+    RENDER,
+    PERSIST,
+    COUNT
+};
+
+inline const char* pipelineStageName(PipelineStage stage) {
+    static constexpr const char* kNames[] = {"preprocess",  "clahe",      "blur",       "diff",
+                                             "background",  "threshold",  "flood_guard", "morphology",
+                                             "extraction",  "refinement", "clustering", "region_merge",
+                                             "render",      "persist"};
+    static_assert(sizeof(kNames) / sizeof(kNames[0]) == static_cast<size_t>(PipelineStage::COUNT),
+                  "one name per stage");
+    return kNames[static_cast<size_t>(stage)];
+}
+
+// Stage of the innermost STAGE_TIMER scope on this thread (COUNT outside every scope); only
+// maintained with BIRDS_ALLOCATION_COUNTING, where the counting operator new reads it
+inline thread_local PipelineStage currentPipelineStage = PipelineStage::COUNT;
+
+/**
+ * @brief One latency histogram per pipeline stage, owned by the component that runs them
+ *
+ * Instrument a stage with STAGE_TIMER(timings, PipelineStage::X) at the top of the scope
+ * to time: it records steady_clock time from there to the end of the scope (a vDSO clock
+ * read on Linux, tens of nanoseconds). Readers may run concurrently with the timed thread.
+ */
+class StageTimings {
+   public:
+    static constexpr size_t kStageCount = static_cast<size_t>(PipelineStage::COUNT);
+    static constexpr bool kEnabled = BIRDS_STAGE_TIMING != 0;
+
+    struct Summary {
+        uint64_t count = 0;
+        double meanMicros = 0.0;
+        double p50Micros = 0.0;
+        double p95Micros = 0.0;
+        double p99Micros = 0.0;
+        double maxMicros = 0.0;
+    };
+
+    // Records the lifetime of the scope into one stage (and marks it the thread's current stage
+    // in allocation-counting builds)
+    class Scope {
+       public:
+        Scope(StageTimings& timings, PipelineStage stage)
+            : timings_(timings), stage_(stage), enclosing_(currentPipelineStage) {
+            if (BIRDS_ALLOCATION_COUNTING) currentPipelineStage = stage;
+            if (kEnabled) start_ = std::chrono::steady_clock::now();
+        }
+        ~Scope() {
+            if (kEnabled) timings_.record(stage_, std::chrono::steady_clock::now() - start_);
+            if (BIRDS_ALLOCATION_COUNTING) currentPipelineStage = enclosing_;
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+       private:
+        StageTimings& timings_;
+        PipelineStage stage_;
+        PipelineStage enclosing_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    void record(PipelineStage stage, std::chrono::nanoseconds elapsed) {
+        histograms_[static_cast<size_t>(stage)].record(elapsed);
+    }
+
+    const StageLatencyHistogram& histogram(PipelineStage stage) const {
+        return histograms_[static_cast<size_t>(stage)];
+    }
+
+    Summary summary(PipelineStage stage) const {
+        const StageLatencyHistogram& h = histogram(stage);
+        Summary s;
+        s.count = h.count();
+        s.meanMicros = h.meanMicros();
+        s.p50Micros = h.percentileMicros(0.50);
+        s.p95Micros = h.percentileMicros(0.95);
+        s.p99Micros = h.percentileMicros(0.99);
+        s.maxMicros = h.maxMicros();
+        return s;
+    }
+
+    void reset() {
+        for (auto& h : histograms_) h.reset();
+    }
+
+   private:
+    std::array<StageLatencyHistogram, kStageCount> histograms_;
+};
+
+#define STAGE_TIMER_CONCAT_INNER(a, b) a##b
+#define STAGE_TIMER_CONCAT(a, b) STAGE_TIMER_CONCAT_INNER(a, b)
+// Profiling builds (profiler_zones.hpp) also open a profiler zone named after the stage
+#if BIRDS_STAGE_TIMING || BIRDS_ALLOCATION_COUNTING
+#define STAGE_TIMER(timings, stage)                                                         \
+    StageTimings::Scope STAGE_TIMER_CONCAT(stageTimerScope, __LINE__)((timings), (stage)); \
+    PROFILE_ZONE_NAMED(pipelineStageName(stage))
+#else
+#define STAGE_TIMER(timings, stage) PROFILE_ZONE_NAMED(pipelineStageName(stage))
+#endif
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.hpp"
+#include "lockfree_queue.hpp"
+#include "logger.hpp"
+#include "profiler_zones.hpp"
+#include "thread_placement.hpp"
+
+/**
+ * @brief Linear chain of worker threads connected by bounded queues
+ *
+ * Each stage runs on its own thread, pops a packet from its input queue, transforms it
+ * in place and forwards it to the next stage. The last stage feeds an output queue that
+ * the owner drains (e.g. the GUI thread). Every queue uses the same capacity and
+ * backpressure policy, so a slow stage either throttles its producers (Block) or sheds
+ * load (DropOldest / DropNewest) instead of stalling capture indefinitely. Built with
+ * ENABLE_LOCKFREE_QUEUES, the queues are LockFreeQueues: the links between stages have one
+ * producer and one consumer thread and use an SpscRing, the input and output an MpmcRing.
+ *
+ * Stage threads are named after their stage (nameCurrentThread), and a thread start hook
+ * can apply scheduling policies to them. Profiling builds (profiler_zones.hpp) show every
+ * packet a stage runs as a zone named after the stage.
+ *
+ * Thread safety: addStage()/setThreadStartHook()/setInputSource()/start() must be called
+ * from the owning thread before any packet is submitted. submit(), popOutputFor(),
+ * getStats() and stop() are thread-safe.
+ *
+ * @tparam Packet Movable per-frame work item passed between stages
+ */
+template <typename Packet>
+class StagedPipeline {
+   public:
+    // Stage body; return false to drop the packet instead of forwarding it
+    using StageFunction = std::function<bool(Packet&)>;
+    // Runs first on every stage thread, with the stage's name
+    using ThreadStartHook = std::function<void(const std::string&)>;
+    // Pulled by the first stage instead of its input queue; blocks, nullopt = end of stream
+    using InputSource = std::function<std::optional<Packet>()>;
+
+    struct StageStats {
+        std::string name;
+        size_t queueDepth = 0;     // Packets waiting in the stage's input queue
+        size_t queueCapacity = 0;
+        uint64_t processed = 0;    // Packets the stage has run on
+        uint64_t filtered = 0;     // Packets the stage chose not to forward
+        uint64_t dropped = 0;      // Packets shed by backpressure on the input queue
+        size_t queueHighWatermark = 0;  // Deepest the input queue has been
+    };
+
+    StagedPipeline(size_t queueCapacity, BackpressurePolicy policy)
+        : queueCapacity_(queueCapacity), policy_(policy) {}
+
+    ~StagedPipeline() { stop(); }
+
+    StagedPipeline(const StagedPipeline&) = delete;
+    StagedPipeline& operator=(const StagedPipeline&) = delete;
+
+    void addStage(const std::string& name, StageFunction function) {
+        if (started_) throw std::logic_error("StagedPipeline: addStage() after start()");
+        // Only the first stage's input is fed by submit() callers; the others by one stage
+        const bool fixedLink = !stages_.empty();
+        auto stage = std::make_unique<Stage>(queueCapacity_, policy_, fixedLink);
+        stage->name = name;
+        stage->function = std::move(function);
+        stages_.push_back(std::move(stage));
+    }
+
+    void setThreadStartHook(ThreadStartHook hook) {
+        if (started_) throw std::logic_error("StagedPipeline: setThreadStartHook() after start()");
+        threadStartHook_ = std::move(hook);
+    }
+
+    /**
+     * @brief Let the first stage pull its packets from @p source instead of submit()
+     *
+     * The first stage then calls the source whenever it is ready for the next packet, so it
+     * can hand out the freshest frame (LatestValueMailbox::wait) rather than the oldest
+     * queued one. The source must return nullopt once its owner closes it, and be closed
+     * before stop(), which cannot wake it.
+     */
+    void setInputSource(InputSource source) {
+        if (started_) throw std::logic_error("StagedPipeline: setInputSource() after start()");
+        inputSource_ = std::move(source);
+    }
+
+    /**
+     * @brief Launch one thread per stage
+     * @param collectOutput When false, packets leaving the last stage are discarded
+     */
+    void start(bool collectOutput = true) {
+        if (started_) return;
+        if (stages_.empty()) throw std::logic_error("StagedPipeline: no stages");
+        if (collectOutput) {
+            output_ = std::make_unique<HandoffQueue<Packet>>(queueCapacity_, policy_);
+        }
+        started_ = true;
+        for (size_t i = 0; i < stages_.size(); ++i) {
+            HandoffQueue<Packet>* next =
+                (i + 1 < stages_.size()) ? &stages_[i + 1]->input : output_.get();
+            stages_[i]->worker = std::thread(&StagedPipeline::runStage, this,
+                                             std::ref(*stages_[i]), next);
+        }
+    }
+
+    // Feed a packet into the first stage (subject to its backpressure policy); false with an input source
+    bool submit(Packet packet) {
+        if (!started_ || inputSource_) return false;
+        return stages_.front()->input.push(std::move(packet));
+    }
+
+    template <typename Rep, typename Period>
+    std::optional<Packet> popOutputFor(const std::chrono::duration<Rep, Period>& timeout) {
+        if (!output_) return std::nullopt;
+        return output_->popFor(timeout);
+    }
+
+    // True once all submitted packets have flowed through and been collected
+    bool isFinished() const { return !output_ || output_->isDrained(); }
+
+    // Stop accepting packets; queued work keeps flowing to the output
+    void closeInput() {
+        if (!stages_.empty()) stages_.front()->input.close();
+    }
+
+    // Stop accepting packets and block until every queued packet has been processed
+    // (with a collected output and the Block policy, the output must still be drained)
+    void drain() {
+        closeInput();
+        for (auto& stage : stages_) {
+            if (stage->worker.joinable()) stage->worker.join();
+        }
+    }
+
+    // Close every queue (discarding in-flight packets) and join all stage threads
+    void stop() {
+        aborted_ = true;
+        for (auto& stage : stages_) stage->input.close();
+        if (output_) output_->close();
+        for (auto& stage : stages_) {
+            if (stage->worker.joinable()) stage->worker.join();
+        }
+    }
+
+    std::vector<StageStats> getStats() const {
+        std::vector<StageStats> stats;
+        stats.reserve(stages_.size() + (output_ ? 1 : 0));
+        for (const auto& stage : stages_) {
+            StageStats s;
+            s.name = stage->name;
+            s.queueDepth = stage->input.size();
+            s.queueCapacity = stage->input.capacity();
+            s.processed = stage->processed.load();
+            s.filtered = stage->filtered.load();
+            s.dropped = stage->input.droppedCount();
+            s.queueHighWatermark = stage->input.highWatermark();
+            stats.push_back(s);
+        }
+        if (output_) {
+            StageStats s;
+            s.name = "output";
+            s.queueDepth = output_->size();
+            s.queueCapacity = output_->capacity();
+            s.dropped = output_->droppedCount();
+            s.queueHighWatermark = output_->highWatermark();
+            stats.push_back(s);
+        }
+        return stats;
+    }
+
+   private:
+    struct Stage {
+#if BIRDS_LOCKFREE_QUEUES
+        Stage(size_t capacity, BackpressurePolicy policy, bool fixedLink)
+            : input(capacity, policy, fixedLink ? QueueLink::Fixed : QueueLink::Shared) {}
+#else
+        Stage(size_t capacity, BackpressurePolicy policy, bool /*fixedLink*/)
+            : input(capacity, policy) {}
+#endif
+        std::string name;
+        StageFunction function;
+        HandoffQueue<Packet> input;
+        std::thread worker;
+        std::atomic<uint64_t> processed{0};
+        std::atomic<uint64_t> filtered{0};
+    };
+
+    void runStage(Stage& stage, HandoffQueue<Packet>* next) {
+        nameCurrentThread(stage.name);
+        if (threadStartHook_) threadStartHook_(stage.name);
+        const bool pullsSource = inputSource_ && &stage == stages_.front().get();
+        [[maybe_unused]] const char* zoneName = profiler::internName(stage.name);
+        while (auto packet = pullsSource ? inputSource_() : stage.input.pop()) {
+            if (aborted_) break;
+            bool forward = false;
+            PROFILE_ZONE_NAMED(zoneName);
+            try {
+                forward = stage.function(*packet);
+            } catch (const std::exception& e) {
+                LOG_ERROR("Pipeline stage '{}' failed: {}", stage.name, e.what());
+            }
+            stage.processed++;
+            if (!forward) {
+                stage.filtered++;
+                continue;
+            }
+            if (next) next->push(std::move(*packet));
+        }
+        // Propagate end-of-stream so downstream stages drain and exit
+        if (next) next->close();
+    }
+
+    const size_t queueCapacity_;
+    const BackpressurePolicy policy_;
+    std::vector<std::unique_ptr<Stage>> stages_;
+    std::unique_ptr<HandoffQueue<Packet>> output_;
+    ThreadStartHook threadStartHook_;
+    InputSource inputSource_;
+    bool started_ = false;
+    std::atomic<bool> aborted_{false};
+};
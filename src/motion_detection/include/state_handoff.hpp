@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+struct HandoffConfig {
+    bool enabled = false;
+    std::string socketPath = "/tmp/birds_of_play_handoff.sock";
+    // How long a successor waits for the running instance to stop between two frames and
+    // release the capture device, and for it to save what it had queued
+    std::chrono::milliseconds stateTimeout{20000};
+    std::chrono::milliseconds releaseTimeout{60000};
+};
+
+/**
+ * @brief Messages of the restart handoff on its Unix socket
+ *
+ * Every message is a 12-byte header (magic, version, kind, payload length; little-endian)
+ * followed by the payload:
+ *
+ *     successor   -> predecessor  Hello     camera_id of the successor
+ *     predecessor -> successor    Refused   why (another camera), then it keeps running
+ *     predecessor -> successor    State     encodeStreamState() once the capture is released
+ *     predecessor -> successor    Released  (empty) once its persistence queue is drained
+ */
+namespace handoff_wire {
+constexpr uint32_t kMagic = 0x48504F42;  // "BOPH"
+constexpr uint16_t kVersion = 1;
+constexpr size_t kHeaderBytes = 12;
+constexpr uint32_t kMaxPayloadBytes = 256u << 20;  // Backgrounds are a few MB at most
+enum Kind : uint16_t { kHello = 1, kRefused = 2, kState = 3, kReleased = 4 };
+}  // namespace handoff_wire
+
+/**
+ * @brief The running instance's end of a zero-downtime restart
+ *
+ * Listens on the handoff socket (replacing a stale socket file a crashed instance left) on
+ * one background thread. When a successor of the same camera says hello, the listener stops
+ * accepting and requested() turns true; the owner then stops capturing, lets the frames in
+ * flight finish, and between two frames sends the stream's state with sendState() after
+ * releasing the capture device, so the successor opens it and starts from that state while
+ * this instance saves what it had queued. sendReleased() tells the successor the storage is
+ * its own from then on (segment files, atlas sheets and the detection log only ever have one
+ * writer). A successor of another camera is refused and this instance keeps running.
+ *
+ * The socket file is only removed on stop() if it is still this listener's and nobody took
+ * over, so it never unlinks the successor's socket.
+ *
+ * Thread safety: requested() may be called from any thread; everything else from the owner.
+ */
+class HandoffListener {
+   public:
+    HandoffListener(std::string socketPath, std::string cameraId);
+    ~HandoffListener();
+
+    HandoffListener(const HandoffListener&) = delete;
+    HandoffListener& operator=(const HandoffListener&) = delete;
+
+    /**
+     * @brief Bind the socket and wait for a successor
+     * @return false (and logs why) if the socket cannot be bound or another instance listens
+     */
+    bool start();
+    void stop();
+
+    // A successor is waiting for the state
+    bool requested() const { return requested_.load(std::memory_order_acquire); }
+
+    // Hand the encoded stream state to the successor; false if it hung up
+    bool sendState(const std::vector<unsigned char>& state);
+    // The persistence queue is drained; closes the connection
+    void sendReleased();
+
+    const std::string& socketPath() const { return socketPath_; }
+
+   private:
+    void run();
+    bool greet(int clientFd);
+
+    const std::string socketPath_;
+    const std::string cameraId_;
+    int listenFd_ = -1;
+    int successorFd_ = -1;  // Set before requested_
+    ino_t socketInode_ = 0;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> requested_{false};
+};
+
+/**
+ * @brief The new instance's end of a zero-downtime restart
+ *
+ * connect() before opening the capture device: false means nobody listens on the socket
+ * (a cold start). receiveState() returns once the running instance has stopped between
+ * two frames and released the device; waitReleased() blocks until it has drained its
+ * persistence queue, which the new instance's persistence worker waits for before its
+ * first write (its own queue buffers the frames in the meantime).
+ *
+ * Thread safety: one thread at a time (receiveState() and waitReleased() may run on
+ * different threads one after the other).
+ */
+class HandoffClient {
+   public:
+    HandoffClient() = default;
+    ~HandoffClient();
+
+    HandoffClient(const HandoffClient&) = delete;
+    HandoffClient& operator=(const HandoffClient&) = delete;
+
+    // Ask the instance listening on @p socketPath for the stream of @p cameraId
+    bool connect(const std::string& socketPath, const std::string& cameraId);
+    bool isConnected() const { return fd_ >= 0; }
+
+    /**
+     * @brief Wait for the predecessor's stream state
+     * @return false if it refused, hung up or did not answer within @p timeout (the
+     *         connection is closed then, and waitReleased() returns at once)
+     */
+    bool receiveState(std::vector<unsigned char>& state, std::chrono::milliseconds timeout);
+
+    // Block until the predecessor saved its queue (true), or hung up or @p timeout passed
+    bool waitReleased(std::chrono::milliseconds timeout);
+
+   private:
+    void close();
+
+    int fd_ = -1;
+};
@@ -0,0 +1,357 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+#include "adaptive_detection_scale.hpp"
+#include "bounded_queue.hpp"
+#include "classification_batcher.hpp"
+#include "cross_camera_dedup.hpp"
+#include "load_shedder.hpp"
+#include "memory_placement.hpp"
+#include "motion_pipeline.hpp"
+#include "motion_processor.hpp"
+#include "motion_region_consolidator.hpp"
+#include "prometheus_text_writer.hpp"
+#include "region_classifier.hpp"
+#include "work_stealing_pool.hpp"
+
+/**
+ * @brief Runs several camera streams in one process on a shared WorkStealingPool
+ *
+ * Each stream owns a MotionProcessor and an optional MotionRegionConsolidator (both keep
+ * per-stream state, see MotionProcessor) plus a bounded queue of pending frames. A stream
+ * with pending frames has exactly one task in the pool; the task processes one frame and
+ * re-submits itself while frames remain, so a stream's frames are processed strictly in
+ * submission order and never on two threads at once, while busy streams spread over every
+ * core that idle streams leave free.
+ *
+ * Results are delivered to the result callback on the worker thread that produced them:
+ * in order per stream, concurrently across streams. A shared sink (e.g. one persistence
+ * backend for all cameras) must therefore be thread-safe.
+ *
+ * With a region classifier, the regions of every stream go through one
+ * ClassificationBatcher, so crops from all cameras share inference batches; results are
+ * then delivered on the batcher thread once their regions are labelled (still in order
+ * per stream).
+ *
+ * With StreamPlacement::numaLocal on a multi-socket machine there is one pool per NUMA
+ * node, its workers pinned to the node's CPUs; streams are assigned to nodes round-robin
+ * and their working buffers are bound to the node, so a stream's pixels never cross the
+ * interconnect. Stealing then only happens within a node.
+ *
+ * With a thread budget (ThreadBudget), the workers are pinned to its compute partition
+ * (intersected with each node's CPUs under NUMA placement) and the classification thread to
+ * its classification partition, so neither competes with persistence or with the other;
+ * size threadCount and cv::setNumThreads() from the same budget.
+ *
+ * With load shedding (setLoadShedding()), a LoadShedder compares the streams' processing
+ * times with the frame interval; when the pool cannot keep up, quiet streams are processed
+ * at every k-th submitted frame (the others are skipped at submit()) and finally at a lower
+ * detection_scale, while streams with consolidated regions keep full rate. The processing
+ * rate of every stream is reported in StreamStats either way.
+ *
+ * With adaptive detection scale (setAdaptiveScale()), each stream's AdaptiveDetectionScale
+ * learns the size of its birds and picks the stream's detection_scale from it, replacing the
+ * configured one; the load-shedding factor applies on top.
+ *
+ * With cross-camera deduplication (setCrossCameraDedup()), the results of streams in a
+ * calibration pair go through a CrossCameraDeduplicator before classification: they wait
+ * until the overlapping cameras' frames of the same moment are in, and a bird seen by two
+ * or more cameras is classified once, on its best view. StreamResult::crossCamera tells the
+ * sink which regions are that best view and which are references to it, so only one view is
+ * persisted. Linked results are delivered on the thread that released them.
+ *
+ * With deadline scheduling (setDeadlineScheduling()), a pool no longer runs stream tasks in
+ * the order they were queued: each task runs the most urgent ready stream of its pool, by
+ * priority class first (StreamSlo::priority; a class is served before the next) and then by
+ * earliest deadline (the frame's capture time plus the stream's StreamSlo::latency). A
+ * stream with a consolidator also yields at the stage boundary between detection and
+ * consolidation when a more urgent stream became ready meanwhile, and continues the frame
+ * when it is the most urgent again. A flood frame on one camera then delays the others by at
+ * most its current stage. Deadline misses (frames finished after their deadline) and yields
+ * are counted per stream either way (StreamStats, writeMetrics()).
+ *
+ * Streams can join and leave while others run, which is how a StreamShardCoordinator moves
+ * cameras between processing nodes: checkpointStream() serializes a stream's state between
+ * two frames, detachStream() takes it out (and hands back its processor and consolidator),
+ * and addStream() on the other node continues it from that state (restoreStreamState()).
+ * writeMetrics() exports the per-stream load the coordinator plans with.
+ *
+ * Thread safety: setResultCallback(), setRegionClassifier(), setLoadShedding(),
+ * setAdaptiveScale(), setCrossCameraDedup() and setDeadlineScheduling() must be called before
+ * the first submit(). addStream(), detachStream(), checkpointStream(), setStreamSlo(),
+ * submit(), drain(), getStats(), writeMetrics() and streamCount() are thread-safe; submit()
+ * with the Block policy, detachStream() and checkpointStream() must not be called from a
+ * result callback (they may wait on themselves).
+ */
+// Where StreamManager runs streams and places their working buffers
+struct StreamPlacement {
+    bool numaLocal = false;  // One pinned pool per NUMA node, stream buffers bound to its node
+    bool hugePages = false;  // Stream working buffers on huge pages (see MemoryPlacement)
+    std::vector<int> workerCpus;      // Pin the workers to these CPUs (ThreadBudget compute partition); empty = any
+    std::vector<int> classifierCpus;  // Pin the classification thread to these CPUs; empty = any
+};
+
+class StreamManager {
+   public:
+    // Scheduling class under deadline scheduling; a ready stream of a class runs before any of the next
+    enum class Priority { Critical, Normal, Background };
+
+    // A stream's latency target: a frame is due latency after its capture
+    struct StreamSlo {
+        std::chrono::milliseconds latency{1000};
+        Priority priority = Priority::Normal;
+    };
+
+    struct StreamResult {
+        size_t stream = 0;
+        uint64_t sequence = 0;  // Index of the frame among the stream's submitted frames
+        MotionProcessor::ProcessingResult result;
+        std::vector<ConsolidatedRegion> regions;  // Empty without a consolidator
+        std::chrono::steady_clock::time_point captured;  // Given to submit(), else its call time
+        // Parallel to regions for streams in a calibration pair; empty otherwise
+        std::vector<CrossCameraLinks> crossCamera;
+    };
+    using ResultCallback = std::function<void(StreamResult&)>;
+
+    struct StreamStats {
+        size_t queued = 0;       // Frames waiting to be processed
+        uint64_t processed = 0;  // Frames processed
+        uint64_t dropped = 0;    // Frames shed by backpressure
+        uint64_t skipped = 0;    // Frames shed by load shedding
+        double processingFps = 0.0;  // Frames processed per second over the last second
+        double processingMs = 0.0;   // Smoothed processing time per frame
+        int frameStride = 1;         // Processing every frameStride-th submitted frame
+        double scaleFactor = 1.0;    // Multiplier on the stream's detection_scale
+        double detectionScale = 1.0;  // detection_scale the last frame ran at (adaptive times shedding)
+        uint64_t deadlineMisses = 0;  // Frames finished later than capture + StreamSlo::latency
+        uint64_t yields = 0;          // Frames that yielded to a more urgent stream between stages
+        bool detached = false;       // Taken out by detachStream()
+    };
+
+    // A stream taken out of the manager, with the state it had learned
+    struct DetachedStream {
+        std::unique_ptr<MotionProcessor> processor;
+        std::unique_ptr<MotionRegionConsolidator> consolidator;
+    };
+
+    /**
+     * @param threadCount Pool size (0 = one worker per hardware thread)
+     * @param queueCapacity Frames each stream may have pending
+     * @param policy What a stream does when a frame arrives with a full queue
+     * @param placement Thread and buffer placement; numaLocal splits threadCount over the nodes
+     */
+    explicit StreamManager(size_t threadCount = 0, size_t queueCapacity = 4,
+                           BackpressurePolicy policy = BackpressurePolicy::DropOldest,
+                           const StreamPlacement& placement = {});
+
+    // Waits for the frames already running, discards the rest
+    ~StreamManager();
+
+    StreamManager(const StreamManager&) = delete;
+    StreamManager& operator=(const StreamManager&) = delete;
+
+    /**
+     * @brief Register a stream (also while others run)
+     * @param consolidator Optional; when set, results carry consolidated regions
+     * @return Stream index used by submit() and in StreamResult
+     */
+    size_t addStream(std::unique_ptr<MotionProcessor> processor,
+                     std::unique_ptr<MotionRegionConsolidator> consolidator = nullptr);
+
+    /**
+     * @brief Take a stream out: waits for its running frame, discards its pending ones
+     *
+     * The index stays reserved: submit() returns false, getStats() keeps processed and dropped.
+     * @throws std::logic_error if the stream was already detached
+     */
+    DetachedStream detachStream(size_t stream);
+
+    /**
+     * @brief encodeStreamState() of a stream, taken between two of its frames
+     *
+     * The stream's next frame waits for the capture (a background image copy).
+     * @throws std::logic_error if the stream was detached
+     */
+    std::vector<unsigned char> checkpointStream(size_t stream);
+
+    void setResultCallback(ResultCallback callback);
+
+    /**
+     * @brief Label the consolidated regions of every stream with one shared classifier
+     * @param maxBatchDelay How long a crop may wait for others to fill its batch
+     */
+    void setRegionClassifier(std::unique_ptr<RegionClassifier> classifier,
+                             std::chrono::microseconds maxBatchDelay = std::chrono::milliseconds(5));
+
+    /**
+     * @brief Shed load from quiet streams when processing falls behind the frame rate
+     *
+     * The LoadShedder's budget is threadCount() frame intervals per interval.
+     */
+    void setLoadShedding(const LoadSheddingConfig& config);
+
+    // Pick each stream's detection_scale from the sizes of its birds (AdaptiveDetectionScale)
+    void setAdaptiveScale(const AdaptiveScaleConfig& config);
+
+    /**
+     * @brief Link the regions that overlapping cameras see at the same time
+     *
+     * Stream indices in the config's pairs are addStream() indices. Duplicate views are not
+     * classified (they keep the default label); the sink persists the regions that are not
+     * CrossCameraLinks::isDuplicate().
+     */
+    void setCrossCameraDedup(const CrossCameraConfig& config);
+
+    // Run the most urgent ready stream first instead of the longest queued one (see above)
+    void setDeadlineScheduling(bool enabled);
+    bool isDeadlineScheduling() const { return deadlineScheduling_; }
+
+    // Latency target and class of @p stream (also while it runs; applies from its next frame)
+    void setStreamSlo(size_t stream, const StreamSlo& slo);
+
+    /**
+     * @brief Queue a frame of @p stream (subject to the backpressure policy)
+     * @return false if the frame was discarded (DropNewest on a full queue, skipped by load
+     *         shedding, or stopped)
+     */
+    bool submit(size_t stream, cv::Mat frame);
+    // Same, with the frame's capture time (cross-camera deduplication matches frames by it)
+    bool submit(size_t stream, cv::Mat frame, std::chrono::steady_clock::time_point captured);
+
+    // Block until every queued frame of every stream has been processed and delivered
+    void drain();
+
+    StreamStats getStats(size_t stream) const;
+    // Zeroes without a region classifier
+    ClassificationBatcherStats getClassificationStats() const;
+    // Zeroes without cross-camera deduplication
+    CrossCameraStats getCrossCameraStats() const;
+
+    /**
+     * @brief Per-stream load for a node's /metrics page (see parseNodeLoadReport())
+     *
+     * Worker count, then processing time, rate, stride and frame counters of every attached
+     * stream, labelled with its camera_id.
+     */
+    void writeMetrics(PrometheusTextWriter& writer) const;
+
+    // Streams ever added (detached ones included)
+    size_t streamCount() const;
+    size_t threadCount() const;
+    // Pools the streams are spread over: the NUMA nodes in use, or 1
+    size_t nodeCount() const { return pools_.size(); }
+    // NUMA node whose pool runs @p stream, -1 without NUMA placement
+    int streamNode(size_t stream) const;
+
+   private:
+    struct Stream {
+        std::unique_ptr<MotionProcessor> processor;
+        std::unique_ptr<MotionRegionConsolidator> consolidator;
+        MotionPipelineContext pipeline;  // Only touched by the stream's running task
+        mutable std::mutex mutex;
+        std::condition_variable spaceAvailable;            // Block policy
+        struct PendingFrame {
+            uint64_t sequence = 0;
+            cv::Mat frame;
+            std::chrono::steady_clock::time_point captured;
+        };
+        std::deque<PendingFrame> pending;
+        std::deque<StreamResult> linking;  // Results in the deduplicator, in sequence order
+        uint64_t nextSequence = 0;
+        bool scheduled = false;  // A task for this stream is queued or running
+        int pauses = 0;          // Checkpoints or a detach holding the stream between frames
+        bool detached = false;
+        std::condition_variable idle;  // scheduled went false
+        size_t pool = 0;         // Index into pools_
+        std::atomic<uint64_t> processed{0};
+        std::atomic<uint64_t> dropped{0};
+        double baseScale = 1.0;          // Configured detection_scale
+        std::unique_ptr<AdaptiveDetectionScale> adaptiveScale;  // Replaces baseScale when set
+        std::atomic<double> appliedScale{1.0};  // detection_scale the processor runs at
+        const char* profileName = "";     // Zone and frame-mark name in profiling builds
+        StreamSlo slo;
+        // A frame that yielded between detection and consolidation (deadline scheduling); the
+        // stream's task continues it before taking the next pending frame
+        bool yielded = false;
+        cv::Mat yieldedFrame;
+        StreamResult yieldedOutput;
+        double yieldedBusyMs = 0.0;  // Detection time of the yielded frame
+        std::atomic<uint64_t> deadlineMisses{0};
+        std::atomic<uint64_t> yields{0};
+    };
+
+    // When a stream's next step is due (deadline scheduling), ordered most urgent first
+    struct Urgency {
+        Priority priority = Priority::Normal;
+        std::chrono::steady_clock::time_point deadline;
+        bool before(const Urgency& other) const {
+            return priority != other.priority ? priority < other.priority : deadline < other.deadline;
+        }
+    };
+    struct ReadyStream {
+        Urgency urgency;
+        uint64_t ticket = 0;  // Equal urgencies run in the order they became ready
+        size_t stream = 0;
+        // Heap order: the most urgent entry is the greatest
+        bool operator<(const ReadyStream& other) const {
+            return other.urgency.before(urgency) || (!urgency.before(other.urgency) && other.ticket < ticket);
+        }
+    };
+    // Streams of one pool waiting for a worker (deadline scheduling), as a heap
+    struct ReadyQueue {
+        std::mutex mutex;
+        std::vector<ReadyStream> heap;
+        uint64_t nextTicket = 0;
+    };
+
+    Stream& streamAt(size_t index) const;
+    // Hold the stream between frames: no task is scheduled until resumeStream()
+    void pauseStream(Stream& stream, std::unique_lock<std::mutex>& lock);
+    void resumeStream(size_t index, Stream& stream);
+    // Urgency of the stream's next step; its mutex must be held and it must have one
+    static Urgency nextUrgencyLocked(const Stream& stream);
+    // Queue the stream's task: straight to the pool, or through its ready queue
+    void dispatch(size_t index, const Stream& stream, const Urgency& urgency);
+    void runMostUrgent(size_t pool);
+    // Deadline scheduling: a stream more urgent than @p urgency is ready in @p pool
+    bool moreUrgentReady(size_t pool, const Urgency& urgency);
+    void runStream(size_t index);
+    // Consolidate, account and deliver a detected frame
+    void finishFrame(size_t index, Stream& stream, cv::Mat frame, StreamResult output, double busyMs);
+    void deliver(cv::Mat frame, StreamResult output);
+    void classifyAndDeliver(cv::Mat frame, StreamResult output);
+    // CrossCameraDeduplicator release callback
+    void deliverLinked(size_t index, uint64_t sequence, cv::Mat& frame, std::vector<ConsolidatedRegion>& regions,
+                       std::vector<CrossCameraLinks>& links);
+
+    size_t queueCapacity_;
+    BackpressurePolicy policy_;
+    StreamPlacement placement_;
+    std::vector<int> poolNodes_;  // NUMA node of each pool; empty without NUMA placement
+    ResultCallback callback_;
+    mutable std::shared_mutex streamsMutex_;  // Guards the vector; streams themselves never move
+    std::vector<std::unique_ptr<Stream>> streams_;
+    std::unique_ptr<ClassificationBatcher> batcher_;  // Outlives the pool's tasks
+    std::unique_ptr<LoadShedder> shedder_;            // Processing rates; sheds when enabled
+    AdaptiveScaleConfig adaptiveScale_;               // For streams added later
+    std::unique_ptr<CrossCameraDeduplicator> dedup_;  // Null without cross-camera deduplication
+    bool deadlineScheduling_ = false;
+    std::vector<std::unique_ptr<ReadyQueue>> ready_;  // One per pool
+    std::atomic<bool> started_{false};
+    std::atomic<bool> stopping_{false};
+    // Last member: joined before the streams are destroyed
+    std::vector<std::unique_ptr<WorkStealingPool>> pools_;
+};
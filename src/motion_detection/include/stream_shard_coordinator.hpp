@@ -0,0 +1,143 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct ShardingConfig {
+    double overloadUtilization = 0.85;  // A node above this share of its workers gives streams away
+    double targetUtilization = 0.75;    // Load-driven moves never fill a node beyond this
+    double imbalance = 0.25;            // Rebalance while the busiest and idlest node differ by more
+    double defaultStreamCores = 0.25;   // Load assumed for a stream no node has reported yet, without an estimate
+    std::chrono::milliseconds nodeTimeout{10000};   // No report for this long: the node failed
+    std::chrono::milliseconds moveCooldown{60000};  // A moved stream stays put (unless its node fails)
+    size_t maxMovesPerPlan = 2;  // Overload and rebalance moves per plan(); failover is not limited
+};
+
+// One stream as a node reports it (StreamManager::writeMetrics())
+struct StreamLoadReport {
+    std::string stream;  // camera_id
+    double processingMs = 0.0;
+    double processingFps = 0.0;
+    int frameStride = 1;  // Load shedding: the stream needs frameStride times what it gets
+};
+
+struct NodeLoadReport {
+    std::string node;
+    size_t workers = 0;
+    std::vector<StreamLoadReport> streams;
+};
+
+/**
+ * @brief Fill @p report from a node's /metrics page (the StreamManager::writeMetrics() families)
+ *
+ * report.node is left as is: it names the scrape target, not something the node reports.
+ * @return false if the page has no birds_stream_workers sample
+ */
+bool parseNodeLoadReport(const std::string& metricsText, NodeLoadReport& report);
+
+struct StreamMove {
+    enum class Reason { Unassigned, NodeFailed, Overload, Rebalance };
+    std::string stream;
+    std::string from;  // Empty for a stream that had no node
+    std::string to;
+    Reason reason = Reason::Unassigned;
+};
+
+const char* toString(StreamMove::Reason reason);
+
+/**
+ * @brief Assigns a site's camera streams to processing nodes by their reported load
+ *
+ * Each node runs a StreamManager and reports its per-stream load (parseNodeLoadReport() of
+ * its /metrics page); a node is live from its first report until it misses nodeTimeout. A
+ * stream costs processingMs x processingFps x frameStride worker-milliseconds per second
+ * (before the first report, what addStream() estimated, e.g. PipelineCostModel::estimate()
+ * for the camera's resolution, frame rate and expected activity), and a node's utilization is the cost of the streams assigned to it over its workers, so plans
+ * account for the moves already made before the nodes report again.
+ *
+ * plan() returns the moves for the deployment to carry out, in this order:
+ *  - streams of failed nodes, and new streams, go to the live node they fill least (largest
+ *    first); failover moves start from the stream's last checkpoint
+ *  - a node above overloadUtilization hands its largest stream that fits elsewhere to the
+ *    idlest node, as long as that node stays within targetUtilization
+ *  - while the busiest and idlest live node differ by more than imbalance, the stream that
+ *    best evens them out moves, so a node that joins takes its share without configuration
+ * Load-driven moves are limited to maxMovesPerPlan and a moved stream is not moved again
+ * for moveCooldown, so reports can catch up and streams do not ping-pong between nodes.
+ *
+ * A live move is checkpointStream() on the old node, detachStream(), then addStream() with
+ * restoreStreamState() on the new one. Nodes also checkpoint their streams periodically
+ * into storeCheckpoint(): a failed node cannot be asked, so its streams resume from that.
+ *
+ * Thread safety: all methods may be called concurrently (one mutex).
+ */
+class StreamShardCoordinator {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    struct NodeStatus {
+        std::string node;
+        bool live = false;
+        size_t workers = 0;
+        double utilization = 0.0;  // Of the streams assigned now, at their last reported cost
+        std::vector<std::string> streams;
+    };
+
+    explicit StreamShardCoordinator(const ShardingConfig& config = ShardingConfig());
+
+    // A stream to place; the next plan() assigns it at @p estimatedCores (< 0 = defaultStreamCores)
+    // until a node reports its load
+    void addStream(const std::string& stream, double estimatedCores = -1.0);
+    // Stop assigning @p stream (the node running it keeps it until told otherwise)
+    void removeStream(const std::string& stream);
+
+    // Latest load of a node; an unknown node joins the site
+    void report(const NodeLoadReport& report, Clock::time_point now = Clock::now());
+
+    // Moves to make; the assignment already reflects them
+    std::vector<StreamMove> plan(Clock::time_point now = Clock::now());
+
+    // Last encodeStreamState() of @p stream, for failover
+    void storeCheckpoint(const std::string& stream, std::vector<unsigned char> state);
+    std::vector<unsigned char> checkpoint(const std::string& stream) const;
+
+    // Node @p stream is assigned to ("" = none)
+    std::string nodeOf(const std::string& stream) const;
+    std::vector<NodeStatus> nodes() const;
+
+   private:
+    struct Node {
+        bool live = false;
+        size_t workers = 1;
+        Clock::time_point lastReport;
+    };
+
+    struct Stream {
+        std::string node;              // Empty = unassigned
+        double cores = -1.0;           // Reported cost in workers; < 0 = not reported yet
+        double estimatedCores = -1.0;  // Cost until then; < 0 = defaultStreamCores
+        bool moved = false;
+        Clock::time_point movedAt;     // With moved: start of the cooldown
+        std::vector<unsigned char> checkpoint;
+    };
+
+    double costLocked(const Stream& stream) const;
+    double loadLocked(const std::string& node) const;  // Workers' worth of assigned streams
+    double utilizationLocked(const std::string& node) const;
+    void moveLocked(const std::string& stream, const std::string& to, StreamMove::Reason reason,
+                    Clock::time_point now, std::vector<StreamMove>& moves);
+    // Least utilized live node after adding @p cores ("" = none live), skipping @p exclude
+    std::string idlestNodeLocked(double cores, const std::string& exclude = "") const;
+    bool movableLocked(const Stream& stream, Clock::time_point now) const;
+    bool relieveOverloadLocked(Clock::time_point now, std::vector<StreamMove>& moves);
+    bool rebalanceLocked(Clock::time_point now, std::vector<StreamMove>& moves);
+
+    const ShardingConfig config_;
+    mutable std::mutex mutex_;
+    std::map<std::string, Node> nodes_;      // Ordered: ties go to the first node by name
+    std::map<std::string, Stream> streams_;
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+#include "motion_processor.hpp"
+#include "motion_region_consolidator.hpp"
+#include "object_tracker.hpp"
+
+/**
+ * @brief What a camera stream has learned, for moving it to another processing node
+ *
+ * The background model (as the learned background image, like a background snapshot), the
+ * adaptive contour thresholds, the consolidator's regions and the tracker's live tracks;
+ * everything else a stream keeps is rebuilt within a few frames. Encoded as a small binary
+ * blob (stream_state_wire) so a coordinator can keep the last checkpoint of every stream and
+ * hand it to the node that takes the stream over, and a restarting process can hand it to
+ * its successor (StateHandoff).
+ */
+struct StreamState {
+    std::string cameraId;
+    cv::Mat background;  // Empty: no background model yet (or background_subtraction off)
+    bool hasConsolidator = false;
+    cv::Size frameSize;  // Resolution the regions belong to
+    std::vector<ConsolidatedRegion> regions;
+    // MotionProcessor::getAdaptive*(); false in version 1 blobs, which predate them
+    bool hasAdaptive = false;
+    double adaptiveMinArea = 0.0;
+    double adaptiveMinSolidity = 0.0;
+    double adaptiveMaxAspectRatio = 0.0;
+    bool hasTracker = false;
+    int nextTrackId = 0;         // Where the tracker's IDs continue, so none is reused
+    TrackedObjectStore tracks;   // Live tracks, hot columns only (cold data is rebuilt on demand)
+};
+
+namespace stream_state_wire {
+constexpr uint32_t kMagic = 0x53504F42;  // "BOPS"
+constexpr uint16_t kVersion = 2;  // 2: adaptive thresholds and tracks; version 1 still decodes
+}  // namespace stream_state_wire
+
+// State of a stream between two frames; @p consolidator and @p tracker may be null
+StreamState captureStreamState(const MotionProcessor& processor, const MotionRegionConsolidator* consolidator,
+                               const ObjectTracker* tracker = nullptr);
+
+/**
+ * @brief Continue a stream from @p state on a freshly built processor (before its first frame)
+ *
+ * The background seeds the processor's first model (see MotionProcessor::seedBackground()),
+ * the adaptive thresholds replace its defaults until their next refresh; the regions go to
+ * @p consolidator and the tracks to @p tracker when both sides have them.
+ */
+void restoreStreamState(const StreamState& state, MotionProcessor& processor, MotionRegionConsolidator* consolidator,
+                        ObjectTracker* tracker = nullptr);
+
+std::vector<unsigned char> encodeStreamState(const StreamState& state);
+
+// Inverse of encodeStreamState(); false if @p data is not a complete stream state
+bool decodeStreamState(const std::vector<unsigned char>& data, StreamState& state);
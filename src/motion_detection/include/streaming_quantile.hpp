@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+/**
+ * @brief Online estimate of one quantile with the P² algorithm (Jain & Chlamtac, 1985)
+ *
+ * Keeps five markers (minimum, p/2, p, (1+p)/2 and maximum) whose heights are adjusted
+ * with piecewise-parabolic interpolation as samples arrive, so memory is constant and
+ * add() is O(1) regardless of how many samples are seen. Until five samples have
+ * arrived value() is exact: the sample at index count * fraction of the sorted samples.
+ *
+ * Thread safety: not thread-safe; use one estimator per stream.
+ */
+class StreamingQuantile {
+   public:
+    /**
+     * @param fraction Quantile to track, in (0, 1) (e.g. 0.1 for the 10th percentile)
+     */
+    explicit StreamingQuantile(double fraction) : fraction_(fraction) { reset(); }
+
+    void add(double x) {
+        if (count_ < kMarkers) {
+            heights_[count_++] = x;
+            if (count_ == kMarkers) std::sort(heights_.begin(), heights_.end());
+            return;
+        }
+        ++count_;
+
+        // Find the cell containing x, widening the extreme markers if needed
+        size_t cell;
+        if (x < heights_[0]) {
+            heights_[0] = x;
+            cell = 0;
+        } else if (x >= heights_[kMarkers - 1]) {
+            heights_[kMarkers - 1] = x;
+            cell = kMarkers - 2;
+        } else {
+            cell = 0;
+            while (x >= heights_[cell + 1]) ++cell;
+        }
+        for (size_t i = cell + 1; i < kMarkers; ++i) ++positions_[i];
+        for (size_t i = 0; i < kMarkers; ++i) desired_[i] += increments_[i];
+
+        // Move the middle markers towards their desired positions, one step at a time
+        for (size_t i = 1; i + 1 < kMarkers; ++i) {
+            const double offset = desired_[i] - positions_[i];
+            if ((offset >= 1.0 && positions_[i + 1] - positions_[i] > 1.0) ||
+                (offset <= -1.0 && positions_[i - 1] - positions_[i] < -1.0)) {
+                const double step = offset > 0.0 ? 1.0 : -1.0;
+                const double candidate = parabolic(i, step);
+                if (heights_[i - 1] < candidate && candidate < heights_[i + 1]) {
+                    heights_[i] = candidate;
+                } else {
+                    heights_[i] = linear(i, step);
+                }
+                positions_[i] += step;
+            }
+        }
+    }
+
+    // Current estimate (0 before the first sample)
+    double value() const {
+        if (count_ == 0) return 0.0;
+        if (count_ >= kMarkers) return heights_[2];
+        std::array<double, kMarkers> sorted = heights_;
+        std::sort(sorted.begin(), sorted.begin() + count_);
+        return sorted[static_cast<size_t>(static_cast<double>(count_) * fraction_)];
+    }
+
+    size_t count() const { return count_; }
+    double fraction() const { return fraction_; }
+
+    // Forget every sample (the next estimate covers only samples added after this)
+    void reset() {
+        count_ = 0;
+        heights_.fill(0.0);
+        positions_ = {0.0, 1.0, 2.0, 3.0, 4.0};
+        desired_ = {0.0, 2.0 * fraction_, 4.0 * fraction_, 2.0 + 2.0 * fraction_, 4.0};
+        increments_ = {0.0, fraction_ / 2.0, fraction_, (1.0 + fraction_) / 2.0, 1.0};
+    }
+
+   private:
+    static constexpr size_t kMarkers = 5;
+
+    double parabolic(size_t i, double step) const {
+        const double* n = positions_.data();
+        const double* q = heights_.data();
+        return q[i] + step / (n[i + 1] - n[i - 1]) *
+                          ((n[i] - n[i - 1] + step) * (q[i + 1] - q[i]) / (n[i + 1] - n[i]) +
+                           (n[i + 1] - n[i] - step) * (q[i] - q[i - 1]) / (n[i] - n[i - 1]));
+    }
+
+    double linear(size_t i, double step) const {
+        const size_t j = step > 0.0 ? i + 1 : i - 1;
+        return heights_[i] + step * (heights_[j] - heights_[i]) / (positions_[j] - positions_[i]);
+    }
+
+    double fraction_;
+    size_t count_ = 0;
+    std::array<double, kMarkers> heights_{};     // Marker heights (quantile estimates)
+    std::array<double, kMarkers> positions_{};   // Actual marker positions (0-based ranks)
+    std::array<double, kMarkers> desired_{};     // Desired marker positions
+    std::array<double, kMarkers> increments_{};  // Desired-position increment per sample
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "thread_placement.hpp"
+
+// thread_budget: section of the config file
+struct ThreadBudgetSettings {
+    int cores = 0;                // CPUs the process may use (0 = every CPU it is allowed to run on)
+    int persistenceCores = 1;     // Set aside for the persistence worker (0 = it shares the compute cores)
+    int classificationCores = 0;  // Set aside for region classification (0 = it shares the compute cores)
+    int opencvThreads = -1;       // OpenCV's internal pool, caller included (-1 = derived from the budget)
+    bool pin = false;             // Pin every role to its cores unless the threads: section pins it itself
+};
+
+// The part of the budget a thread role runs on
+enum class ThreadPartition { Compute, Persistence, Classification };
+
+/**
+ * @brief How the cores are split between stream workers, persistence, classification and OpenCV
+ *
+ * OpenCV parallelizes GaussianBlur, morphologyEx, MOG2, DNN and others on its own pool.
+ * Once the pipeline stages or stream workers run in parallel as well, the two layers
+ * oversubscribe the cores and throughput falls below the single-threaded run. plan()
+ * sets the persistence and classification cores aside (taken from the end of the CPU
+ * list, so core 0 stays with the compute workers), keeps at least one compute core, and
+ * sizes OpenCV's pool to the compute cores the workers leave idle plus the calling
+ * worker itself: the whole compute partition for one worker, 1 (sequential OpenCV) once
+ * there are as many workers as compute cores.
+ *
+ * OpenCV's thread count is process-wide, so applyOpenCvThreads() sets it once for every
+ * worker context; the pool's threads take the affinity of the thread that (re)creates
+ * them, so apply it from a thread that runs on the compute partition.
+ *
+ * Thread safety: a value type; applyOpenCvThreads() must not race other cv::setNumThreads() calls.
+ */
+struct ThreadBudget {
+    std::vector<int> computeCpus;
+    std::vector<int> persistenceCpus;     // Empty = shares the compute cores
+    std::vector<int> classificationCpus;  // Empty = shares the compute cores
+    size_t workers = 1;                   // Threads running OpenCV work at the same time
+    int opencvThreads = 1;
+    bool pin = false;
+
+    /**
+     * @param workers Threads that run OpenCV work concurrently (stream workers, pipeline stages)
+     * @param cpus The CPUs to split (allowedCpus() in the application)
+     */
+    static ThreadBudget plan(const ThreadBudgetSettings& settings, size_t workers, const std::vector<int>& cpus);
+
+    size_t cores() const { return computeCpus.size() + persistenceCpus.size() + classificationCpus.size(); }
+    const std::vector<int>& cpus(ThreadPartition partition) const;
+
+    /**
+     * @brief @p configured with each role pinned to its partition (only with pin set)
+     *
+     * Roles the threads: section already pins keep their CPUs; the rest of their policy is kept.
+     */
+    ThreadSettings placement(const ThreadSettings& configured,
+                             const std::vector<std::pair<std::string, ThreadPartition>>& roles) const;
+
+    // "12 cores: 10 compute (3 workers, OpenCV 8 threads), 1 persistence, 1 classification"
+    std::string describe() const;
+};
+
+// CPUs the calling thread may run on (its affinity mask); 0 .. hardware_concurrency-1 where unknown
+std::vector<int> allowedCpus();
+
+// Set OpenCV's process-wide pool to @p budget's opencvThreads
+void applyOpenCvThreads(const ThreadBudget& budget);
+
+const char* threadPartitionName(ThreadPartition partition);
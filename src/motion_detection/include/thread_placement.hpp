@@ -0,0 +1,74 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "profiler_zones.hpp"
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+/**
+ * @brief Scheduling of one kind of pipeline thread (threads: section of the config file)
+ *
+ * cpus pins the thread, realtimePriority moves it to SCHED_FIFO (it then preempts every
+ * normal thread on its CPUs, so keep such stages short and blocking on I/O, like capture),
+ * nice lowers or raises it among normal threads. cgroup names a cgroup v2 directory in
+ * threaded mode; the thread is moved into it (cgroup.threads), so the service manager can
+ * cap or isolate it without touching the other threads of the process.
+ */
+struct ThreadPolicy {
+    std::vector<int> cpus;      // Empty = any CPU
+    int nice = 0;               // -20 (highest) .. 19 under normal scheduling; 0 = unchanged
+    int realtimePriority = 0;   // 1-99 = SCHED_FIFO at this priority; 0 = normal scheduling
+    std::string cgroup;         // Threaded cgroup v2 directory; "" = stay in the process's cgroup
+
+    bool isDefault() const { return cpus.empty() && nice == 0 && realtimePriority == 0 && cgroup.empty(); }
+};
+
+// Policies by thread role; roles without an entry keep the defaults
+struct ThreadSettings {
+    std::map<std::string, ThreadPolicy> roles;
+
+    // The roles the application assigns: the capture thread, the processing stages, the
+    // persistence worker and the async log writer
+    static const std::vector<std::string>& roleNames() {
+        static const std::vector<std::string> names = {"capture", "detect", "consolidate", "render", "persist", "log"};
+        return names;
+    }
+
+    const ThreadPolicy* find(const std::string& role) const {
+        const auto it = roles.find(role);
+        return it == roles.end() ? nullptr : &it->second;
+    }
+};
+
+/**
+ * @brief Name the calling thread "bop-<name>" for top -H, ps -L, perf and cgroup tooling
+ *
+ * Linux keeps 15 characters of a thread name, so longer names are cut. A no-op elsewhere,
+ * except that profiling builds pass the full name to the profiler on every platform.
+ */
+inline void nameCurrentThread(const std::string& name) {
+    PROFILE_THREAD_NAME(("bop-" + name).c_str());
+#ifdef __linux__
+    const std::string full = ("bop-" + name).substr(0, 15);
+    pthread_setname_np(pthread_self(), full.c_str());
+#else
+    (void)name;
+#endif
+}
+
+/**
+ * @brief Apply @p policy to the calling thread
+ *
+ * Every part is attempted; one the system refuses (SCHED_FIFO or a negative nice value
+ * without CAP_SYS_NICE, a cgroup not in threaded mode, ...) is logged and skipped.
+ * @return true if the whole policy took effect
+ */
+bool applyThreadPolicy(const ThreadPolicy& policy);
+
+// Name the calling thread after @p role (or @p name when given) and apply the role's policy
+bool setupCurrentThread(const ThreadSettings& settings, const std::string& role, const std::string& name = "");
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "image_encoder.hpp"
+
+struct ThumbnailAtlasConfig {
+    bool enabled = false;
+    cv::Size cellSize{160, 120};  // Each thumbnail is fitted into one cell, aspect kept
+    int columns = 16;             // Cells per sheet row
+    int rows = 16;                // Cell rows per sheet
+    // Seal a sheet that has not filled up this long after its first thumbnail, so the
+    // gallery does not wait a whole hour for a quiet camera's sheet
+    std::chrono::seconds sealAfter{300};
+};
+
+// Where a record's gallery thumbnail sits in an atlas sheet
+struct AtlasCell {
+    std::string sheet;  // Sheet image relative to the atlas directory ("YYYY/MM/DD/HH/sheet_0003.jpg"); empty: none
+    cv::Size sheetSize;
+    cv::Rect rect;      // The thumbnail's pixels within the sheet
+};
+
+/**
+ * @brief Per-hour sprite sheets of gallery thumbnails with a JSON offset index
+ *
+ * Each thumbnail is scaled (INTER_AREA) straight into the next cell of the open sheet of
+ * its hour partition, so the gallery can show a page of frames from one or two sheet
+ * images instead of a request per thumbnail. A sheet is sealed when it is full, when a
+ * thumbnail of another hour arrives, sealAfter after its first thumbnail (sealDue()) or on
+ * seal(): the canvas is encoded once (thumbnail codec and quality) and written as
+ * <directory>/YYYY/MM/DD/HH/sheet_NNNN<ext>, followed by sheet_NNNN.json:
+ *
+ *     {"image": "sheet_0003.jpg", "size": [w, h], "cell": [w, h],
+ *      "thumbnails": {"<uuid>": [x, y, w, h], ...}}
+ *
+ * Both are written to a temporary name and renamed, so a sheet that exists is complete.
+ * Sealed sheets are never rewritten. Documents refer to their cell (AtlasCell) as soon as
+ * the thumbnail is placed; readers fall back to the individual thumbnail until the sheet
+ * exists. Sheets live in the hour partitions, so retention expires them with the frames.
+ *
+ * Thread safety: all methods may be called concurrently (one mutex; add() scales under it).
+ */
+class ThumbnailAtlas {
+   public:
+    ThumbnailAtlas(std::string directory, const ThumbnailAtlasConfig& config, const ImageEncodeSettings& encoding);
+    // Seals the open sheet
+    ~ThumbnailAtlas();
+
+    ThumbnailAtlas(const ThumbnailAtlas&) = delete;
+    ThumbnailAtlas& operator=(const ThumbnailAtlas&) = delete;
+
+    /**
+     * @brief Place @p image (CV_8UC1 or CV_8UC3, any size) in the open sheet of @p partition
+     * @param cell Set to the sheet and rectangle it went to; cleared on failure
+     * @return false for an empty or unsupported image
+     */
+    bool add(const std::string& partition, const std::string& uuid, const cv::Mat& image, AtlasCell& cell);
+
+    // Seal the open sheet if sealAfter has passed since its first thumbnail
+    void sealDue(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+    // Seal the open sheet now (no-op without one)
+    void seal();
+
+    uint64_t sheetsWritten() const;
+    uint64_t thumbnailsPlaced() const;
+    const std::string& directory() const { return directory_; }
+
+   private:
+    struct Sheet {
+        std::string partition;  // Empty: no sheet open
+        std::string name;       // sheet_NNNN
+        cv::Mat canvas;
+        std::vector<std::pair<std::string, cv::Rect>> thumbnails;
+        std::chrono::steady_clock::time_point opened;
+    };
+
+    void openLocked(const std::string& partition);
+    void sealLocked();
+    int capacity() const { return config_.columns * config_.rows; }
+
+    const std::string directory_;
+    const ThumbnailAtlasConfig config_;
+    const ImageEncodeSettings encoding_;
+    mutable std::mutex mutex_;
+    Sheet sheet_;
+    std::vector<unsigned char> encoded_;  // Reused between seals
+    uint64_t sheetsWritten_ = 0;
+    uint64_t thumbnailsPlaced_ = 0;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <vector>
+
+// Whether any of @p length bytes is nonzero (128-bit universal intrinsics, scalar tail)
+bool anyNonZero(const uchar* data, int length);
+
+/**
+ * @brief Which square tiles of a binary mask hold motion, and the windows to process
+ *
+ * scan() marks every tile with at least one nonzero pixel, testing the tile's rows with
+ * anyNonZero() and stopping at the first hit, so an empty tile costs one read of its
+ * bytes and an occupied one usually far less. windows() turns the occupied tiles into
+ * the rectangles that later stages have to visit:
+ * - every occupied tile is grown by a halo (e.g. the radius of the morphology chain),
+ *   so an operation whose output depends only on pixels within the halo is nonzero
+ *   only inside the windows;
+ * - grown tiles that overlap or touch, diagonals included, share one window, so each
+ *   8-connected region of such an output lies entirely inside a single window.
+ *
+ * The windows are clipped to the mask and pairwise separated by at least one pixel:
+ * labelling or tracing contours window by window (with the window's offset) finds the
+ * same regions as one pass over the whole mask.
+ *
+ * Not thread-safe; buffers keep their capacity between frames.
+ */
+class TileOccupancy {
+   public:
+    /**
+     * @brief Mark the occupied tiles of @p mask (CV_8UC1)
+     * @param tileSize Side of a tile in pixels; the last row and column of tiles may be smaller
+     */
+    void scan(const cv::Mat& mask, int tileSize);
+
+    int tileSize() const { return tileSize_; }
+    int tileColumns() const { return columns_; }
+    int tileRows() const { return rows_; }
+    bool occupied(int column, int row) const { return occupied_[row * columns_ + column] != 0; }
+    int occupiedCount() const { return occupiedCount_; }
+    // Occupied fraction of the tiles, 0 for an empty mask
+    double occupancy() const;
+
+    /**
+     * @brief Disjoint windows covering the occupied tiles grown by @p halo pixels
+     *
+     * Valid until the next scan() or windows() call. Empty when no tile is occupied.
+     */
+    const std::vector<cv::Rect>& windows(int halo);
+
+    // Pixels covered by the last windows() result
+    int64_t windowArea() const;
+
+   private:
+    cv::Size maskSize_;
+    int tileSize_ = 0;
+    int columns_ = 0;
+    int rows_ = 0;
+    int occupiedCount_ = 0;
+    std::vector<uint8_t> occupied_;  // Row-major, one flag per tile
+    std::vector<cv::Rect> windows_;
+};
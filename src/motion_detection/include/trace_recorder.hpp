@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "frame_trace.hpp"
+
+struct TraceRecorderConfig {
+    bool enabled = false;
+    std::string path = "data/traces/pipeline_trace.json";
+    double startAfterSeconds = 10.0;  // Past the first frame, so start-up is left out
+    double durationSeconds = 5.0;     // Window of capture times to record
+    size_t maxFrames = 10000;         // Bounds the memory of a long window
+};
+
+/**
+ * @brief Records the FrameTraces of a time window and writes them as a Chrome trace
+ *
+ * The output is Trace Event Format JSON, opened with chrome://tracing or ui.perfetto.dev:
+ * one track per stage holding a complete ("X") event for every frame it ran, a "queued"
+ * track per stage for the time frames waited in front of it, and an async "frame" span
+ * from capture to the pipeline output. Timestamps are microseconds since the first
+ * recorded capture.
+ *
+ * Frames are recorded as they leave the pipeline; the first one captured after the
+ * window ends writes the file, after which the recorder is done.
+ *
+ * Not thread-safe: one thread (the pipeline output consumer) records.
+ */
+class TraceRecorder {
+   public:
+    explicit TraceRecorder(TraceRecorderConfig config);
+
+    bool isEnabled() const { return config_.enabled; }
+    // The window was written (or abandoned after a write failure)
+    bool isDone() const { return done_; }
+    size_t size() const { return frames_.size(); }
+
+    // Record a frame whose trace is complete (delivered set)
+    void record(int frameIndex, const FrameTrace& trace);
+
+    /**
+     * @brief Write what the window holds so far, if not written yet (at shutdown)
+     * @return true if a trace file was written
+     */
+    bool finish();
+
+    // The trace events of the recorded frames
+    void writeJson(std::ostream& out) const;
+
+   private:
+    struct Entry {
+        int frameIndex;
+        FrameTrace trace;
+    };
+
+    bool writeFile();
+
+    TraceRecorderConfig config_;
+    std::vector<Entry> frames_;
+    FrameTrace::Clock::time_point windowStart_;
+    FrameTrace::Clock::time_point windowEnd_;
+    bool done_ = false;
+};
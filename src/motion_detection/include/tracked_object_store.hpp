@@ -0,0 +1,190 @@
+#pragma once
+
+#include <chrono>
+#include <opencv2/core.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ring_buffer.hpp"
+#include "tracked_object.hpp"
+
+/**
+ * @brief Per-object fields that are only needed when persisting or classifying
+ *
+ * Kept out of the hot columns so per-frame tracking and consolidation never touch strings or
+ * image buffers.
+ */
+struct TrackedObjectColdData {
+    std::string uuid;
+    std::chrono::system_clock::time_point firstSeen;
+    cv::Mat initialFrame;
+    std::string classLabel = "unknown";
+    float classConfidence = 0.0f;
+    int classId = -1;
+};
+
+/**
+ * @brief Structure-of-arrays store of tracked objects for the per-frame hot path
+ *
+ * Row i of every column describes one object. The hot columns hold only trivially copyable
+ * values (IDs, boxes, centers, counters) plus an inline fixed-capacity trajectory, so
+ * adding and copying rows does no heap allocation once the columns have grown to the
+ * working size (call clear() and reuse the store each frame). Strings and images live in a
+ * cold side table keyed by object ID that is only populated on demand.
+ *
+ * Thread safety: not thread-safe.
+ */
+class TrackedObjectStore {
+   public:
+    static constexpr size_t kTrajectoryCapacity = 64;
+    using Trajectory = FixedRingBuffer<cv::Point, kTrajectoryCapacity>;
+
+    /**
+     * @brief Append an object with a fresh trajectory (its center) and default counters
+     * @return Row index of the new object
+     */
+    size_t add(int id, const cv::Rect& bounds) {
+        return add(id, bounds, cv::Point(bounds.x + bounds.width / 2, bounds.y + bounds.height / 2));
+    }
+
+    // Same, starting the trajectory at @p center (e.g. the detection's mask centroid)
+    size_t add(int id, const cv::Rect& bounds, const cv::Point& center) {
+        ids_.push_back(id);
+        bounds_.push_back(bounds);
+        smoothedCenters_.push_back(center);
+        confidences_.push_back(1.0f);
+        framesWithoutDetection_.push_back(0);
+        trajectories_.emplace_back();
+        trajectories_.back().push(center);
+        return ids_.size() - 1;
+    }
+
+    // Append a copy of row @p row of @p other (hot columns only)
+    size_t addRow(const TrackedObjectStore& other, size_t row) {
+        ids_.push_back(other.ids_[row]);
+        bounds_.push_back(other.bounds_[row]);
+        smoothedCenters_.push_back(other.smoothedCenters_[row]);
+        confidences_.push_back(other.confidences_[row]);
+        framesWithoutDetection_.push_back(other.framesWithoutDetection_[row]);
+        trajectories_.push_back(other.trajectories_[row]);
+        return ids_.size() - 1;
+    }
+
+    /**
+     * @brief Remove every row whose @p remove flag is set, keeping the order of the rest
+     *
+     * Cold data of removed objects is erased as well.
+     */
+    void removeRows(const std::vector<char>& remove) {
+        size_t kept = 0;
+        for (size_t row = 0; row < ids_.size(); ++row) {
+            if (remove[row]) {
+                cold_.erase(ids_[row]);
+                continue;
+            }
+            if (kept != row) {
+                ids_[kept] = ids_[row];
+                bounds_[kept] = bounds_[row];
+                smoothedCenters_[kept] = smoothedCenters_[row];
+                confidences_[kept] = confidences_[row];
+                framesWithoutDetection_[kept] = framesWithoutDetection_[row];
+                trajectories_[kept] = trajectories_[row];
+            }
+            ++kept;
+        }
+        resize(kept);
+    }
+
+    // Drop every row but keep column capacity; cold data is kept unless @p clearCold
+    void clear(bool clearCold = false) {
+        resize(0);
+        if (clearCold) cold_.clear();
+    }
+
+    size_t size() const { return ids_.size(); }
+    bool empty() const { return ids_.empty(); }
+
+    // Hot columns
+    const std::vector<int>& ids() const { return ids_; }
+    const std::vector<cv::Rect>& bounds() const { return bounds_; }
+    int id(size_t row) const { return ids_[row]; }
+    cv::Rect& bounds(size_t row) { return bounds_[row]; }
+    const cv::Rect& bounds(size_t row) const { return bounds_[row]; }
+    cv::Point& smoothedCenter(size_t row) { return smoothedCenters_[row]; }
+    const cv::Point& smoothedCenter(size_t row) const { return smoothedCenters_[row]; }
+    float& confidence(size_t row) { return confidences_[row]; }
+    float confidence(size_t row) const { return confidences_[row]; }
+    int& framesWithoutDetection(size_t row) { return framesWithoutDetection_[row]; }
+    int framesWithoutDetection(size_t row) const { return framesWithoutDetection_[row]; }
+    Trajectory& trajectory(size_t row) { return trajectories_[row]; }
+    const Trajectory& trajectory(size_t row) const { return trajectories_[row]; }
+
+    /**
+     * @brief Cold data for object @p id, created on first access (uuid "uuid_<id>")
+     */
+    TrackedObjectColdData& cold(int id) {
+        auto [it, inserted] = cold_.try_emplace(id);
+        if (inserted) {
+            it->second.uuid = "uuid_" + std::to_string(id);
+            it->second.firstSeen = std::chrono::system_clock::now();
+        }
+        return it->second;
+    }
+
+    // Cold data for object @p id, or nullptr if it was never requested
+    const TrackedObjectColdData* findCold(int id) const {
+        auto it = cold_.find(id);
+        return it == cold_.end() ? nullptr : &it->second;
+    }
+
+    /**
+     * @brief Materialize row @p row as a TrackedObject (for visualization and persistence)
+     */
+    TrackedObject toTrackedObject(size_t row) const {
+        const int objectId = ids_[row];
+        const TrackedObjectColdData* coldData = findCold(objectId);
+        TrackedObject object(objectId, bounds_[row],
+                             coldData ? coldData->uuid : "uuid_" + std::to_string(objectId));
+        object.smoothedCenter = smoothedCenters_[row];
+        object.confidence = confidences_[row];
+        object.framesWithoutDetection = framesWithoutDetection_[row];
+        object.trajectory.clear();
+        const Trajectory& trajectory = trajectories_[row];
+        for (size_t i = 0; i < trajectory.size(); ++i) object.trajectory.push_back(trajectory[i]);
+        if (coldData) {
+            object.firstSeen = coldData->firstSeen;
+            object.initialFrame = coldData->initialFrame;
+            object.classLabel = coldData->classLabel;
+            object.classConfidence = coldData->classConfidence;
+            object.classId = coldData->classId;
+        }
+        return object;
+    }
+
+    std::vector<TrackedObject> toTrackedObjects() const {
+        std::vector<TrackedObject> objects;
+        objects.reserve(size());
+        for (size_t row = 0; row < size(); ++row) objects.push_back(toTrackedObject(row));
+        return objects;
+    }
+
+   private:
+    void resize(size_t rows) {
+        ids_.resize(rows);
+        bounds_.resize(rows);
+        smoothedCenters_.resize(rows);
+        confidences_.resize(rows);
+        framesWithoutDetection_.resize(rows);
+        trajectories_.resize(rows);
+    }
+
+    std::vector<int> ids_;
+    std::vector<cv::Rect> bounds_;
+    std::vector<cv::Point> smoothedCenters_;
+    std::vector<float> confidences_;
+    std::vector<int> framesWithoutDetection_;
+    std::vector<Trajectory> trajectories_;
+
+    std::unordered_map<int, TrackedObjectColdData> cold_;
+};
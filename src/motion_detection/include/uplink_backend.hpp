@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame_segment_store.hpp"
+#include "persistence_backend.hpp"
+
+/**
+ * @file uplink_backend.hpp
+ * @brief Wire format between an edge's "uplink" persistence backend and the aggregator
+ *
+ * One TCP connection per edge, little-endian throughout. The edge opens with a hello:
+ *
+ *   hello:    u32 magic "BOPU", u16 version (1), u16 site length, site (UTF-8)
+ *
+ * then sends messages, each a document and the encoded images it points at:
+ *
+ *   message:  u32 magic "BOPM", u8 kind (1 frame, 2 motion summary), u8 reserved,
+ *             u16 image count, u32 document length, document (one line of relaxed Extended
+ *             JSON, as frameDocumentJson() / motionSummaryJson() write it),
+ *             image count x (u32 length, JPEG bytes)
+ *
+ * A frame message carries the region crop JPEGs in region_crops order and nothing else:
+ * full-size frames and thumbnails stay on the edge. The aggregator answers with
+ *
+ *   ack:      u64 number of messages of this connection it has stored, counted from 1
+ *
+ * Acks are cumulative, so one ack may cover many messages. Messages are resent after a
+ * reconnect if their ack did not arrive; the aggregator upserts by _id, so a frame stored
+ * twice is stored once.
+ */
+namespace uplink_wire {
+constexpr uint32_t kHelloMagic = 0x55504F42;    // "BOPU"
+constexpr uint32_t kMessageMagic = 0x4D504F42;  // "BOPM"
+constexpr uint16_t kVersion = 1;
+constexpr size_t kMessageHeaderBytes = 12;
+constexpr uint8_t kFrameMessage = 1;
+constexpr uint8_t kSummaryMessage = 2;
+}  // namespace uplink_wire
+
+struct UplinkStats {
+    bool connected = false;
+    uint64_t connects = 0;          // Connections established (the first one included)
+    uint64_t sent = 0;              // Messages written to the socket (resends included)
+    uint64_t acknowledged = 0;      // Messages the aggregator confirmed
+    uint64_t spooled = 0;           // Messages that went to the spool instead of the socket
+    uint64_t spoolFailures = 0;     // Messages lost because the spool could not be written
+    uint64_t bytesAcknowledged = 0;
+    size_t spoolDepth = 0;          // Messages waiting in the spool
+    size_t inFlightBytes = 0;       // Sent, not yet acknowledged
+};
+
+/**
+ * @brief Persistence backend that ships documents and region crops to a central aggregator
+ *
+ * For deployments where each edge box would otherwise run its own database: the persistence
+ * worker's records become uplink_wire messages (the document plus its region crop JPEGs, so
+ * use persistence_mode region_crops or plate_patches; a background plate is sent once, with
+ * the first document that refers to it), and WAN traffic follows the number of saved
+ * frames, not the frame rate.
+ *
+ * insertRecords() never touches the network. A record goes to an in-memory outbox while the
+ * link is up and the bytes sent but not acknowledged plus those waiting stay under
+ * uplinkWindowBytes; otherwise it is appended to the spool, a FrameSegmentStore in
+ * uplinkSpoolPath. The
+ * uplink thread connects (retrying with backoff), sends spooled messages first, then the
+ * outbox, while less than uplinkWindowBytes is unacknowledged, and reads the acks. A slow
+ * aggregator or WAN therefore fills the window, then the spool, instead of the worker's
+ * queue. On a disconnect, unacknowledged and waiting messages move to the spool; once the
+ * spool has been replayed and acknowledged its segment files are deleted. Spooled messages
+ * left by a previous run are sent first after a restart.
+ *
+ * Thread safety: as PersistenceBackend; stats() from any thread.
+ */
+class UplinkPersistenceBackend : public PersistenceBackend {
+   public:
+    explicit UplinkPersistenceBackend(const PersistenceBackendConfig& config);
+    ~UplinkPersistenceBackend() override;  // Spools what was not acknowledged
+
+    const char* name() const override { return "uplink"; }
+
+    // Starts the uplink thread; true even while the aggregator is unreachable
+    bool connect() override;
+
+    // UUIDs of the records sent or spooled; a record whose crops cannot be read is left out
+    std::vector<std::string> insertRecords(const std::vector<StoredFrameRecord>& records) override;
+
+    bool upsertMotionSummaries(const std::vector<MotionMinuteSummary>& summaries) override;
+
+    UplinkStats stats() const;
+
+   private:
+    // A message in the outbox or on the wire; spooled messages are read back by extent
+    struct Message {
+        std::vector<unsigned char> bytes;
+        bool fromSpool = false;
+    };
+
+    bool enqueue(Message message);                        // False if it could not even be spooled
+    bool spool(const std::vector<unsigned char>& bytes);  // Caller holds mutex_
+    void recoverSpool();
+    void clearSpool();                                    // Caller holds mutex_
+    bool nextMessage(Message& message);
+    void acknowledge(uint64_t count);
+    void run();
+    bool openConnection();
+    void closeConnection();
+
+    const PersistenceBackendConfig config_;
+    std::string lastPlateSent_;  // Persistence worker only (insertRecords())
+    std::string host_;
+    std::string port_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    bool started_ = false;
+    bool stopping_ = false;
+    bool linkUp_ = false;  // Accepting outbox messages
+    std::deque<Message> outbox_;
+    size_t outboxBytes_ = 0;
+    std::unique_ptr<FrameSegmentStore> spoolStore_;  // Opened on the first spooled message
+    std::deque<SegmentExtent> spooled_;              // Oldest first
+    size_t spoolSending_ = 0;                        // Leading spooled_ entries on the wire
+    std::deque<Message> inFlight_;                   // Uplink thread only
+    size_t inFlightBytes_ = 0;
+    std::thread thread_;
+    int fd_ = -1;  // Uplink thread only
+
+    std::atomic<uint64_t> connects_{0};
+    std::atomic<uint64_t> sent_{0};
+    std::atomic<uint64_t> acknowledged_{0};
+    std::atomic<uint64_t> spooledCount_{0};
+    std::atomic<uint64_t> spoolFailures_{0};
+    std::atomic<uint64_t> bytesAcknowledged_{0};
+};
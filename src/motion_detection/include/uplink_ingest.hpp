@@ -0,0 +1,198 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.hpp"
+#include "classification_batcher.hpp"
+#include "persistence_backend.hpp"
+
+struct UplinkIngestConfig {
+    std::string listenAddress = "0.0.0.0";
+    int port = 7450;                               // 0 = any free port (see UplinkIngestServer::port())
+    std::string cropPath = "data/uplink_regions";  // Crops under <cropPath>/<site>/; empty = not written
+    size_t maxConnections = 16384;
+    size_t maxMessageBytes = 16u << 20;            // A larger message drops its connection
+    size_t decodeThreads = 4;                      // Parse documents, write crops, submit classification
+    size_t queueCapacity = 4096;                   // Messages waiting for a decode thread; full = stop reading
+    size_t maxBatch = 512;                         // Documents per bulk insert
+    std::chrono::milliseconds batchWindow{50};     // How long a bulk insert collects after its first document
+    // Store JPEG crops as lossless JPEG XL transcodes (about 20% smaller; needs libjxl)
+    bool recompressCrops = false;
+};
+
+struct UplinkIngestStats {
+    uint64_t connections = 0;      // Edge connections accepted (reconnects included)
+    size_t activeConnections = 0;
+    uint64_t bytesReceived = 0;
+    uint64_t received = 0;         // Messages decoded off the wire (resends included)
+    uint64_t stored = 0;           // Messages stored and acknowledged
+    uint64_t rejected = 0;         // Acknowledged without storing: the document could not be parsed
+    uint64_t failed = 0;           // Refused by the backend; their connection was dropped for a resend
+    uint64_t classified = 0;       // Regions labelled by the classifier
+    uint64_t bulkWrites = 0;       // insertRecords() and upsertMotionSummaries() calls
+    uint64_t protocolErrors = 0;   // Connections dropped for a malformed stream
+    uint64_t cropsRecompressed = 0;        // JPEG crops written as JPEG XL (recompressCrops)
+    uint64_t recompressionBytesSaved = 0;  // Their JPEG size minus their JPEG XL size
+};
+
+/**
+ * @brief Inverse of frameDocumentJson(): the record a frame document describes
+ *
+ * Dates come back as Unix time (metadata.timestamp in seconds, capture_time in
+ * microseconds); timestamp and created_at are not kept, insertRecords() sets them again.
+ * @return false if @p json is not a frame document, or its _id or background plate id is
+ *         not a plain file name ([A-Za-z0-9._-], not "." or "..") or the plate path lacks an
+ *         ImageCodec extension: they name the crop and plate files under cropPath
+ */
+bool parseFrameDocument(const std::string& json, StoredFrameRecord& record);
+
+// Inverse of motionSummaryJson(); false if @p json is not a motion summary
+bool parseMotionSummary(const std::string& json, MotionMinuteSummary& summary);
+
+/**
+ * @brief Incremental reader of one edge's uplink_wire stream (hello, then messages)
+ *
+ * Bytes are fed as they arrive, in chunks of any size; complete messages come out.
+ *
+ * Thread safety: not thread-safe; one decoder per connection.
+ */
+class UplinkStreamDecoder {
+   public:
+    struct Message {
+        uint8_t kind = 0;  // uplink_wire::kFrameMessage or kSummaryMessage
+        std::string document;
+        std::vector<std::vector<unsigned char>> images;
+    };
+
+    explicit UplinkStreamDecoder(size_t maxMessageBytes) : maxMessageBytes_(maxMessageBytes) {}
+
+    // Append the complete messages in @p data to @p out; false on a protocol error (see error())
+    bool feed(const unsigned char* data, size_t size, std::vector<Message>& out);
+
+    bool hasHello() const { return hasHello_; }
+    const std::string& site() const { return site_; }  // Safe as a directory name
+    const std::string& error() const { return error_; }
+
+   private:
+    bool fail(std::string error);
+
+    const size_t maxMessageBytes_;
+    std::vector<unsigned char> buffer_;
+    size_t consumed_ = 0;  // Bytes of buffer_ already decoded
+    bool hasHello_ = false;
+    std::string site_;
+    std::string error_;
+};
+
+/**
+ * @brief Central end of the uplink: accepts many edges and stores what they send
+ *
+ * The receiving side of UplinkPersistenceBackend, for deployments with thousands of edges
+ * where mongodb/uplink_aggregator.py (a thread per edge) does not keep up. One I/O thread
+ * multiplexes every connection with epoll and decodes the streams; decode threads parse the
+ * documents back into StoredFrameRecord / MotionMinuteSummary (tagging source with the
+ * edge's site, "<site>/<source>"), write the region crops under cropPath/<site>/ and, with
+ * a classifier, send the crops of unclassified regions through the ClassificationBatcher
+ * so the central GPU sees large batches drawn from many edges. A writer thread collects
+ * the results of up to batchWindow into one insertRecords() and one upsertMotionSummaries()
+ * call on the backend, so the database sees bulk writes whatever the number of edges.
+ *
+ * Each stored message is acknowledged to its edge (cumulatively, in the order received).
+ * A message the backend refuses drops its connection instead: the edge spools and resends
+ * it after reconnecting, and the backends store a resent frame once. When decoding falls
+ * queueCapacity messages behind, the I/O thread stops reading and TCP flow control slows
+ * the edges down, which in turn spool.
+ *
+ * Linux only (epoll); start() fails elsewhere.
+ *
+ * Thread safety: start() and stop() from one thread; stats() and port() from any thread.
+ */
+class UplinkIngestServer {
+   public:
+    // @p classifier may be null: documents are stored with the labels the edges gave them
+    UplinkIngestServer(const UplinkIngestConfig& config, std::unique_ptr<PersistenceBackend> backend,
+                       std::unique_ptr<ClassificationBatcher> classifier = nullptr);
+    ~UplinkIngestServer();  // stop()
+
+    UplinkIngestServer(const UplinkIngestServer&) = delete;
+    UplinkIngestServer& operator=(const UplinkIngestServer&) = delete;
+
+    // Listen and start the threads; false (logged) if the address cannot be bound
+    bool start();
+
+    // Stop accepting, close the connections and store what was already received
+    void stop();
+
+    int port() const { return boundPort_.load(); }
+    UplinkIngestStats stats() const;
+
+   private:
+    struct DecodeItem {
+        uint64_t connection = 0;
+        uint64_t sequence = 0;  // 1-based, per connection
+        std::string site;
+        UplinkStreamDecoder::Message message;
+    };
+
+    struct WriteItem {
+        uint64_t connection = 0;
+        uint64_t sequence = 0;
+        bool isSummary = false;
+        StoredFrameRecord record;
+        MotionMinuteSummary summary;
+    };
+
+    struct Completion {
+        uint64_t connection = 0;
+        uint64_t sequence = 0;
+        bool stored = false;
+    };
+
+    struct Connection;
+
+    void runIo();
+    void runDecode();
+    void runWriter();
+    void decode(DecodeItem& item);
+    void writeBatch(std::vector<WriteItem>& batch);
+    void complete(uint64_t connection, uint64_t sequence, bool stored);
+
+    const UplinkIngestConfig config_;
+    std::unique_ptr<PersistenceBackend> backend_;
+    std::unique_ptr<ClassificationBatcher> classifier_;
+
+    BoundedQueue<DecodeItem> decodeQueue_;
+    BoundedQueue<WriteItem> writeQueue_;
+    std::mutex completionsMutex_;
+    std::vector<Completion> completions_;  // Handed to the I/O thread through wakeFd_
+
+    int listenFd_ = -1;
+    int epollFd_ = -1;
+    int wakeFd_ = -1;  // eventfd: completions waiting, or stop
+    std::atomic<bool> stopping_{false};
+    std::atomic<int> boundPort_{0};
+    std::thread ioThread_;
+    std::vector<std::thread> decodeThreads_;
+    std::thread writerThread_;
+
+    std::atomic<uint64_t> connections_{0};
+    std::atomic<size_t> activeConnections_{0};
+    std::atomic<uint64_t> bytesReceived_{0};
+    std::atomic<uint64_t> received_{0};
+    std::atomic<uint64_t> stored_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> failed_{0};
+    std::atomic<uint64_t> classified_{0};
+    std::atomic<uint64_t> bulkWrites_{0};
+    std::atomic<uint64_t> protocolErrors_{0};
+    std::atomic<uint64_t> cropsRecompressed_{0};
+    std::atomic<uint64_t> recompressionBytesSaved_{0};
+};
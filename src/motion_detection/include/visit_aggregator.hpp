@@ -0,0 +1,114 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+#include "frame_metadata.hpp"              // VisitMetadata
+#include "motion_region_consolidator.hpp"  // For ConsolidatedRegion
+
+struct VisitConfig {
+    bool enabled = false;
+    size_t bestCrops = 3;                           // Crops a visit document keeps, best score first
+    std::chrono::milliseconds endAfter{5000};       // A visit ends once its regions were gone this long
+    std::chrono::milliseconds maxDuration{600000};  // Longer visits are split, so a resident bird is stored
+    std::chrono::milliseconds sampleInterval{250};  // Score a visit's regions at most this often
+    double minIou = 0.3;        // A region joins the visit whose last box it overlaps this much
+    bool matchTrackIds = true;  // Regions that share a tracked object belong to one visit (tracker on)
+    size_t maxPathPoints = 64;  // The path is thinned to at most this many points
+    int contextWidth = 320;     // Frames wider than this are downscaled for the context thumbnail
+};
+
+// One crop a visit keeps: its own copy of the pixels, so frame buffers are never held
+struct VisitCrop {
+    cv::Mat image;
+    cv::Rect region;         // Consolidated region (clamped to the frame), the area the image shows
+    double sharpness = 0.0;  // Variance of the Laplacian of the region's grayscale pixels
+    double score = 0.0;      // sharpness x sqrt(region area): sharp and large wins
+    int frameIndex = 0;
+};
+
+// A finished visit: everything its document needs
+struct Visit {
+    VisitMetadata summary;
+    std::vector<VisitCrop> crops;  // Best first
+    cv::Mat context;               // Downscaled frame of the best crop
+    cv::Size frameSize;
+    // Most confident label any of its regions got (one visit is one bird)
+    std::string classLabel = "unknown";
+    float classConfidence = 0.0f;
+    int classId = -1;
+};
+
+/**
+ * @brief Collapses the frames of one bird visit into a single document
+ *
+ * Saving a frame every save interval while regions exist turns a five-minute visit at the
+ * feeder into hundreds of near-identical documents. The aggregator instead follows each
+ * consolidated region through the frames: a region belongs to the open visit it shares a
+ * tracked object with (matchTrackIds) or, failing that, whose last box it overlaps by
+ * minIou; any other region starts a visit. Per visit it keeps the first and last time,
+ * the frame count, the tracked object IDs, a path of region centers (thinned by dropping
+ * every other point when it reaches maxPathPoints) and the bestCrops crops by score.
+ *
+ * Scoring needs a grayscale Laplacian of the region, so a visit's regions are scored at
+ * most every sampleInterval; a crop is only copied when it beats the worst one kept.
+ *
+ * A visit ends endAfter its last sighting, or when it has lasted maxDuration (the bird
+ * stays, and a new visit continues with the same tracks). takeEnded() hands out the ended
+ * visits, takeAll() the open ones at shutdown.
+ *
+ * Thread safety: not thread-safe; observe() and take*() from one thread (the render stage).
+ */
+class VisitAggregator {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit VisitAggregator(const VisitConfig& config = VisitConfig());
+
+    /**
+     * @brief Add a frame's regions to the visits they belong to (a no-op when disabled)
+     * @param now Capture time of the frame; @p unixUs the same as Unix microseconds
+     */
+    void observe(const cv::Mat& frame, const std::vector<ConsolidatedRegion>& regions, int frameIndex,
+                 Clock::time_point now, int64_t unixUs);
+
+    // Visits that ended by @p now, oldest first
+    std::vector<Visit> takeEnded(Clock::time_point now);
+
+    // Every visit, ended or not (shutdown)
+    std::vector<Visit> takeAll();
+
+    size_t openVisits() const { return open_.size(); }
+    // Frames with regions observed so far, each of which used to be a save candidate
+    uint64_t framesWithRegions() const { return framesWithRegions_; }
+
+    const VisitConfig& config() const { return config_; }
+
+    // Variance of the Laplacian: higher is sharper (motion blur and defocus lower it)
+    static double sharpness(const cv::Mat& image);
+
+   private:
+    struct OpenVisit {
+        Visit visit;
+        cv::Rect lastBox;
+        Clock::time_point started;
+        Clock::time_point lastSeen;
+        Clock::time_point lastSampled;
+        bool sampled = false;
+        int lastFrameIndex = -1;  // A frame counts once, whatever number of its regions joined
+        size_t pathStride = 1;    // Sightings per path point; doubles when the path is thinned
+        size_t pathSkipped = 0;
+    };
+
+    OpenVisit* match(const ConsolidatedRegion& region, const cv::Rect& box, Clock::time_point now);
+    void addPathPoint(OpenVisit& open, const cv::Rect& box, int64_t unixUs) const;
+    void offerCrop(OpenVisit& open, const cv::Mat& frame, const cv::Rect& box, int frameIndex) const;
+    static Visit finish(OpenVisit& open);
+
+    VisitConfig config_;
+    std::vector<OpenVisit> open_;
+    uint64_t framesWithRegions_ = 0;
+};
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <opencv2/core.hpp>
+#include <stdexcept>
+#include <string>
+
+#include "block_motion_map.hpp"
+
+// What wakes the pipeline from duty-cycled capture
+enum class WakeSource {
+    Gpio,  // A PIR sensor (or any digital line) read through its GPIO value file
+    Gate,  // The block-SAD gate on the low-rate frames captured while asleep
+    Both
+};
+
+/**
+ * @brief Parse a wake source name ("gpio", "gate", "both")
+ * @throws std::invalid_argument for unknown names
+ */
+inline WakeSource parseWakeSource(std::string name) {
+    std::transform(name.begin(), name.end(), name.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (name == "gpio") return WakeSource::Gpio;
+    if (name == "gate") return WakeSource::Gate;
+    if (name == "both") return WakeSource::Both;
+    throw std::invalid_argument("Unknown wake trigger source: " + name);
+}
+
+inline const char* wakeSourceName(WakeSource source) {
+    switch (source) {
+        case WakeSource::Gpio:
+            return "gpio";
+        case WakeSource::Gate:
+            return "gate";
+        case WakeSource::Both:
+            return "both";
+    }
+    return "unknown";
+}
+
+// wake_trigger: section of the config file
+struct WakeTriggerConfig {
+    bool enabled = false;
+    WakeSource source = WakeSource::Gate;
+    // Value file of the line, "0"/"1" (e.g. /sys/class/gpio/gpio17/value after exporting it)
+    std::string gpioPath = "/sys/class/gpio/gpio17/value";
+    bool gpioActiveLow = false;
+    double sleepFps = 1.0;            // Capture rate while asleep
+    double awakeHoldSeconds = 30.0;   // Stay awake this long after the last trigger or region
+    size_t preRollFrames = 4;         // Frames captured asleep that are processed first on wake
+    int gateBlockSize = 16;           // Gate: block side in pixels (a video macroblock)
+    int gateThreshold = 12;           // Gate: mean gray-level difference of a moving block
+    int gateMinBlocks = 2;            // Gate: moving blocks that wake the pipeline
+    int gateHistory = 8;              // Gate: frames its background averages over
+};
+
+/**
+ * @brief A digital input read through a sysfs-style GPIO value file
+ *
+ * wait() blocks until the line becomes active or the timeout passes. Where the kernel
+ * reports edges on the file (the sibling "edge" file is set to "both"), it sleeps in
+ * poll() until an edge; otherwise it re-reads the level every few tens of milliseconds.
+ *
+ * Not thread-safe.
+ */
+class GpioLine {
+   public:
+    GpioLine(std::string path, bool activeLow);
+    ~GpioLine();
+
+    GpioLine(const GpioLine&) = delete;
+    GpioLine& operator=(const GpioLine&) = delete;
+
+    bool isOpen() const { return fd_ >= 0; }
+    const std::string& path() const { return path_; }
+
+    // Current level; false when the file cannot be read
+    bool isActive();
+
+    // Whether the line is (or became) active within @p timeout
+    bool wait(std::chrono::milliseconds timeout);
+
+   private:
+    std::string path_;
+    bool activeLow_;
+    int fd_ = -1;
+    bool edges_ = false;  // poll() reports edges on fd_
+};
+
+/**
+ * @brief Duty-cycles capture on battery-powered units, waking the pipeline on a trigger
+ *
+ * Asleep, capture runs at sleepFps (the thread sleeps in waitForNextFrame() in between, or
+ * in poll() on the PIR line) and frames do not reach the pipeline: they only feed the
+ * block-SAD gate and a short pre-roll. A trigger (the PIR line, or gateMinBlocks moving
+ * blocks) wakes the pipeline; frames then flow at the camera's rate, the pre-roll first,
+ * so the frames from before the trigger are not lost to start-up. Activity reported by
+ * the pipeline (recordActivity()) and further triggers keep it awake; after
+ * awakeHoldSeconds without either it goes back to sleep.
+ *
+ * onFrame() reports the transitions. The caller saves the background model when the
+ * pipeline goes to sleep and, on wake, restarts detection from it (the reference frames
+ * are stale by then, the learned background is not), see MotionProcessor::seedBackground().
+ *
+ * Starts awake, so the background model is learned before the first sleep.
+ *
+ * Thread safety: onFrame() and waitForNextFrame() on the capture thread; recordActivity(),
+ * isAwake() and the counters from any thread.
+ */
+class WakeController {
+   public:
+    enum class Transition { None, Woke, Slept };
+
+    explicit WakeController(WakeTriggerConfig config);
+    ~WakeController();
+
+    WakeController(const WakeController&) = delete;
+    WakeController& operator=(const WakeController&) = delete;
+
+    /**
+     * @brief Classify a captured frame
+     * @param gray CV_8UC1 view of the frame for the gate (may be empty without the gate)
+     * @return Woke on the frame that woke the pipeline, Slept on the first frame held back
+     */
+    Transition onFrame(const cv::Mat& gray, std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    // Asleep: sleep until the next duty-cycle frame is due, or the PIR line fires
+    void waitForNextFrame();
+
+    // The pipeline found regions: stay awake
+    void recordActivity(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    bool isAwake() const { return awake_.load(std::memory_order_acquire); }
+    uint64_t wakeCount() const { return wakes_.load(std::memory_order_relaxed); }
+    // Frames captured while asleep (gate only, never processed)
+    uint64_t sleepFrames() const { return sleepFrames_.load(std::memory_order_relaxed); }
+    const WakeTriggerConfig& config() const { return config_; }
+
+   private:
+    bool gateFires(const cv::Mat& gray);
+    bool usesGpio() const { return config_.source != WakeSource::Gate; }
+    bool usesGate() const { return config_.source != WakeSource::Gpio; }
+
+    using Clock = std::chrono::steady_clock;
+    const WakeTriggerConfig config_;
+    std::unique_ptr<GpioLine> gpio_;
+    BlockMotionMap gate_;
+    std::atomic<bool> awake_{true};
+    std::atomic<int64_t> lastActivityTicks_;  // Clock ticks of the last trigger or region
+    Clock::time_point nextSleepFrame_{};
+    std::atomic<uint64_t> wakes_{0};
+    std::atomic<uint64_t> sleepFrames_{0};
+};
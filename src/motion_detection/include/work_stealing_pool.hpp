@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "logger.hpp"
+#include "profiler_zones.hpp"
+#include "thread_placement.hpp"
+
+/**
+ * @brief Fixed-size thread pool where idle workers steal queued tasks from busy ones
+ *
+ * Every worker owns a task deque. Tasks submitted from a worker thread go to that worker's
+ * deque and are popped newest-first (the data they touch is likely still in cache); tasks
+ * submitted from other threads are spread round-robin. A worker with an empty deque steals
+ * the oldest task of another worker before going to sleep.
+ *
+ * Exceptions escaping a task are logged and swallowed so the worker keeps running.
+ *
+ * Thread safety: submit(), waitIdle() and threadCount() may be called concurrently, also
+ * from inside tasks (except waitIdle(), which would wait for itself). The destructor runs
+ * every queued task, then joins the workers.
+ */
+class WorkStealingPool {
+   public:
+    using Task = std::function<void()>;
+
+    // threadCount 0 = one worker per hardware thread; onWorkerStart runs first on every worker
+    explicit WorkStealingPool(size_t threadCount = 0, std::function<void()> onWorkerStart = nullptr)
+        : onWorkerStart_(std::move(onWorkerStart)) {
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (size_t i = 0; i < threadCount; ++i) workers_.push_back(std::make_unique<Worker>());
+        for (size_t i = 0; i < threadCount; ++i) {
+            workers_[i]->thread = std::thread(&WorkStealingPool::run, this, i);
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (auto& worker : workers_) worker->thread.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    void submit(Task task) {
+        ++pending_;
+        const size_t target = currentPool_ == this
+                                  ? currentWorker_
+                                  : nextWorker_.fetch_add(1) % workers_.size();
+        {
+            // Counted under the wake mutex so a worker cannot miss it between check and
+            // wait, and before the push so the count never goes below zero
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            ++queued_;
+        }
+        {
+            std::lock_guard<std::mutex> lock(workers_[target]->mutex);
+            workers_[target]->tasks.push_back(std::move(task));
+        }
+        wake_.notify_one();
+    }
+
+    // Block until every submitted task (including tasks they submitted) has finished
+    void waitIdle() {
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        idle_.wait(lock, [this] { return pending_.load() == 0; });
+    }
+
+    size_t threadCount() const { return workers_.size(); }
+
+   private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    bool popLocal(size_t index, Task& task) {
+        Worker& worker = *workers_[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.tasks.empty()) return false;
+        task = std::move(worker.tasks.back());
+        worker.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(size_t thief, Task& task) {
+        for (size_t offset = 1; offset < workers_.size(); ++offset) {
+            Worker& victim = *workers_[(thief + offset) % workers_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.tasks.empty()) continue;
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    void run(size_t index) {
+        currentPool_ = this;
+        currentWorker_ = index;
+        nameCurrentThread("worker-" + std::to_string(index));
+        if (onWorkerStart_) onWorkerStart_();
+        while (true) {
+            Task task;
+            if (popLocal(index, task) || steal(index, task)) {
+                --queued_;
+                try {
+                    task();
+                } catch (const std::exception& e) {
+                    LOG_ERROR("WorkStealingPool task failed: {}", e.what());
+                } catch (...) {
+                    LOG_ERROR("WorkStealingPool task failed with an unknown exception");
+                }
+                if (--pending_ == 0) {
+                    std::lock_guard<std::mutex> lock(wakeMutex_);
+                    idle_.notify_all();
+                }
+                continue;
+            }
+
+            PROFILE_ZONE("wait:pool_task");
+            std::unique_lock<std::mutex> lock(wakeMutex_);
+            wake_.wait(lock, [this] { return stopping_ || queued_.load() > 0; });
+            if (stopping_ && queued_.load() == 0) return;
+        }
+    }
+
+    std::function<void()> onWorkerStart_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::mutex wakeMutex_;
+    std::condition_variable wake_;  // Tasks queued or stopping
+    std::condition_variable idle_;  // pending_ dropped to zero
+    std::atomic<size_t> queued_{0};   // Tasks sitting in a deque
+    std::atomic<size_t> pending_{0};  // Tasks queued or running
+    std::atomic<size_t> nextWorker_{0};
+    bool stopping_ = false;  // Guarded by wakeMutex_
+
+    static inline thread_local WorkStealingPool* currentPool_ = nullptr;
+    static inline thread_local size_t currentWorker_ = 0;
+};
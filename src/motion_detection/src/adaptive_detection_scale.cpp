@@ -0,0 +1,71 @@
+#include "adaptive_detection_scale.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "logger.hpp"
+
+AdaptiveDetectionScale::AdaptiveDetectionScale(const AdaptiveScaleConfig& config, double initialScale)
+    : config_(config), sizes_(std::clamp(config.percentile, 0.01, 0.99)), scale_(initialScale) {
+    config_.scaleStep = std::max(0.01, config_.scaleStep);
+    config_.maxScale = std::clamp(config_.maxScale, config_.scaleStep, 1.0);
+    config_.minScale = std::clamp(config_.minScale, config_.scaleStep, config_.maxScale);
+    config_.evaluateIntervalFrames = std::max(1, config_.evaluateIntervalFrames);
+    config_.minSamples = std::max(1, config_.minSamples);
+}
+
+bool AdaptiveDetectionScale::observe(const std::vector<cv::Rect>& boxes) {
+    if (!config_.enabled) return false;
+    for (const cv::Rect& box : boxes) {
+        const int side = std::min(box.width, box.height);
+        if (side > 0) sizes_.add(side);
+    }
+    if (++framesSinceEvaluation_ < config_.evaluateIntervalFrames) return false;
+    if (sizes_.count() < static_cast<size_t>(config_.minSamples)) return false;  // Too few birds yet
+    return evaluate();
+}
+
+void AdaptiveDetectionScale::reset(double scale) {
+    scale_ = scale;
+    sizes_.reset();
+    framesSinceEvaluation_ = 0;
+    lastQuantile_ = 0.0;
+}
+
+double AdaptiveDetectionScale::snap(double scale) const {
+    // Up to the next step: rounding down would take the bird below the minimum
+    const double steps = std::ceil(scale / config_.scaleStep - 1e-9);
+    return std::clamp(steps * config_.scaleStep, config_.minScale, config_.maxScale);
+}
+
+double AdaptiveDetectionScale::coarsestScaleFor(double size, double pixels) const {
+    if (size <= 0.0) return config_.maxScale;
+    return snap(pixels / size);
+}
+
+/**
+ * A finer scale wins at once (birds are about to be lost); a coarser one needs the
+ * hysteresis margin, so a quantile hovering around a step boundary does not flip the scale
+ * back and forth.
+ */
+bool AdaptiveDetectionScale::evaluate() {
+    lastQuantile_ = sizes_.value();
+    const size_t samples = sizes_.count();
+    sizes_.reset();
+    framesSinceEvaluation_ = 0;
+
+    double next = scale_;
+    const double needed = coarsestScaleFor(lastQuantile_, config_.minObjectPixels);
+    if (needed > scale_) {
+        next = needed;
+    } else {
+        const double coarser = coarsestScaleFor(lastQuantile_, config_.minObjectPixels * (1.0 + config_.hysteresis));
+        if (coarser < scale_) next = coarser;
+    }
+    if (next == scale_) return false;
+    LOG_INFO("Adaptive detection scale: {:.3f} -> {:.3f} ({:.0f}th percentile bird {:.1f} px across, {} boxes)",
+             scale_, next, config_.percentile * 100.0, lastQuantile_, samples);
+    scale_ = next;
+    changes_++;
+    return true;
+}
@@ -0,0 +1,181 @@
+#include "allocation_counter.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <sstream>
+
+#include <opencv2/core.hpp>
+
+namespace {
+
+struct Counters {
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> frees{0};
+    std::atomic<uint64_t> bytes{0};
+
+    AllocationCounts load() const {
+        AllocationCounts counts;
+        // Frees first: a snapshot taken while other threads allocate never shows more frees than allocations
+        counts.frees = frees.load(std::memory_order_relaxed);
+        counts.allocations = allocations.load(std::memory_order_relaxed);
+        counts.bytes = bytes.load(std::memory_order_relaxed);
+        return counts;
+    }
+};
+
+// Constant-initialized, so allocations made by other static constructors are counted safely
+Counters gTotal;
+Counters gStages[StageTimings::kStageCount + 1];
+
+void countAllocation(size_t bytes) {
+    gTotal.allocations.fetch_add(1, std::memory_order_relaxed);
+    gTotal.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    if (AllocationCounter::kStageAttribution) {
+        Counters& stage = gStages[static_cast<size_t>(currentPipelineStage)];
+        stage.allocations.fetch_add(1, std::memory_order_relaxed);
+        stage.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+}
+
+void countFree(const void* pointer) {
+    if (!pointer) return;
+    gTotal.frees.fetch_add(1, std::memory_order_relaxed);
+    if (AllocationCounter::kStageAttribution) {
+        gStages[static_cast<size_t>(currentPipelineStage)].frees.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// nullptr only when no new_handler could make room
+void* allocate(size_t bytes, size_t alignment) {
+    if (bytes == 0) bytes = 1;
+    for (;;) {
+        void* pointer = nullptr;
+        if (alignment <= alignof(std::max_align_t)) {
+            pointer = std::malloc(bytes);
+        } else if (posix_memalign(&pointer, alignment, bytes) != 0) {
+            pointer = nullptr;
+        }
+        if (pointer) {
+            countAllocation(bytes);
+            return pointer;
+        }
+        const std::new_handler handler = std::get_new_handler();
+        if (!handler) return nullptr;
+        handler();
+    }
+}
+
+void* allocateOrThrow(size_t bytes, size_t alignment) {
+    void* pointer = allocate(bytes, alignment);
+    if (!pointer) throw std::bad_alloc();
+    return pointer;
+}
+
+void* allocateNoThrow(size_t bytes, size_t alignment) noexcept {
+    try {
+        return allocate(bytes, alignment);
+    } catch (...) {  // A new_handler may throw
+        return nullptr;
+    }
+}
+
+void release(void* pointer) noexcept {
+    countFree(pointer);
+    std::free(pointer);
+}
+
+// Counts cv::Mat buffers, then hands them to the allocator it wraps
+class CountingMatAllocator : public cv::MatAllocator {
+   public:
+    explicit CountingMatAllocator(const cv::MatAllocator* inner) : inner_(inner) {}
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override {
+        cv::UMatData* u = inner_->allocate(dims, sizes, type, data, step, flags, usageFlags);
+        if (!u) return u;
+        // Release comes back here (and is forwarded) so buffers are counted both ways
+        u->currAllocator = this;
+        if (!data) countAllocation(u->size);
+        return u;
+    }
+
+    bool allocate(cv::UMatData* data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override {
+        return inner_->allocate(data, accessFlags, usageFlags);
+    }
+
+    void deallocate(cv::UMatData* u) const override {
+        if (!u) return;
+        if (!(u->flags & cv::UMatData::USER_ALLOCATED)) countFree(u->origdata);
+        u->currAllocator = inner_;
+        inner_->deallocate(u);
+    }
+
+   private:
+    const cv::MatAllocator* inner_;
+};
+
+}  // namespace
+
+AllocationCounts AllocationCounter::snapshot() { return gTotal.load(); }
+
+StageAllocations AllocationCounter::stages() {
+    StageAllocations counts;
+    for (size_t i = 0; i < counts.size(); ++i) counts[i] = gStages[i].load();
+    return counts;
+}
+
+std::string AllocationCounter::describe(const StageAllocations& before, const StageAllocations& after) {
+    std::ostringstream out;
+    for (size_t i = 0; i < after.size(); ++i) {
+        const AllocationCounts delta = after[i] - before[i];
+        if (delta.allocations == 0) continue;
+        if (out.tellp() > 0) out << ", ";
+        out << (i < StageTimings::kStageCount ? pipelineStageName(static_cast<PipelineStage>(i)) : "unscoped")
+            << ": " << delta.allocations << " allocations (" << delta.bytes << " bytes)";
+    }
+    return out.str();
+}
+
+void AllocationCounter::countMatAllocations() {
+    static std::once_flag installed;
+    std::call_once(installed, [] {
+        // Lives for the whole process: Mats allocated through it release through it
+        static CountingMatAllocator allocator(cv::Mat::getDefaultAllocator());
+        cv::Mat::setDefaultAllocator(&allocator);
+    });
+}
+
+// Global replacements; see allocation_counter.hpp for which programs link them
+
+void* operator new(size_t bytes) { return allocateOrThrow(bytes, 0); }
+void* operator new[](size_t bytes) { return allocateOrThrow(bytes, 0); }
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept { return allocateNoThrow(bytes, 0); }
+void* operator new[](size_t bytes, const std::nothrow_t&) noexcept { return allocateNoThrow(bytes, 0); }
+void* operator new(size_t bytes, std::align_val_t alignment) {
+    return allocateOrThrow(bytes, static_cast<size_t>(alignment));
+}
+void* operator new[](size_t bytes, std::align_val_t alignment) {
+    return allocateOrThrow(bytes, static_cast<size_t>(alignment));
+}
+void* operator new(size_t bytes, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocateNoThrow(bytes, static_cast<size_t>(alignment));
+}
+void* operator new[](size_t bytes, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocateNoThrow(bytes, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* pointer) noexcept { release(pointer); }
+void operator delete[](void* pointer) noexcept { release(pointer); }
+void operator delete(void* pointer, size_t) noexcept { release(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { release(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { release(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { release(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { release(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { release(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { release(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { release(pointer); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { release(pointer); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { release(pointer); }
@@ -0,0 +1,98 @@
+#include "approximate_background_subtractor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+// Nearest power-of-two exponent of 1 / rate; above 10 small differences (< 4 gray
+// levels) would never reach an 8.8 background
+int shiftForRate(double rate) {
+    return std::clamp(static_cast<int>(std::lround(std::log2(1.0 / rate))), 1, 10);
+}
+
+}  // namespace
+
+ApproximateBackgroundSubtractor::ApproximateBackgroundSubtractor(Method method, int history,
+                                                                 int foregroundThreshold)
+    : method_(method),
+      defaultShift_(shiftForRate(1.0 / std::max(2, history))),
+      medianStepInterval_(std::max(1, history / 256)),
+      foregroundThreshold_(std::clamp(foregroundThreshold, 0, 255)) {}
+
+void ApproximateBackgroundSubtractor::reset(const cv::Mat& frame) {
+    channels_ = frame.channels();
+    if (method_ == Method::RUNNING_AVERAGE) {
+        frame.convertTo(background_, CV_MAKETYPE(CV_16U, channels_), 256.0);
+    } else {
+        frame.copyTo(background_);
+    }
+    updates_ = 0;
+}
+
+void ApproximateBackgroundSubtractor::apply(cv::InputArray image, cv::OutputArray fgmask,
+                                            double learningRate) {
+    const cv::Mat frame = image.getMat();
+    CV_Assert(frame.depth() == CV_8U);
+    fgmask.create(frame.size(), CV_8UC1);
+    cv::Mat mask = fgmask.getMat();
+
+    if (background_.empty() || background_.size() != frame.size() || frame.channels() != channels_ ||
+        learningRate >= 1.0) {
+        reset(frame);
+        mask.setTo(cv::Scalar::all(0));
+        return;
+    }
+
+    const bool update = learningRate != 0.0;
+    const int channels = channels_;
+    const int threshold = foregroundThreshold_;
+    ++updates_;
+
+    if (method_ == Method::RUNNING_AVERAGE) {
+        const int shift = learningRate > 0.0 ? shiftForRate(learningRate) : defaultShift_;
+        for (int y = 0; y < frame.rows; ++y) {
+            const uchar* in = frame.ptr<uchar>(y);
+            ushort* bg = background_.ptr<ushort>(y);
+            uchar* out = mask.ptr<uchar>(y);
+            for (int x = 0; x < frame.cols; ++x) {
+                uchar foreground = 0;
+                for (int c = 0; c < channels; ++c, ++in, ++bg) {
+                    const int value = *bg;
+                    if (std::abs(*in - ((value + 128) >> 8)) > threshold) foreground = 255;
+                    if (update) *bg = static_cast<ushort>(value + (((*in << 8) - value) >> shift));
+                }
+                out[x] = foreground;
+            }
+        }
+        return;
+    }
+
+    const bool step = update && updates_ % static_cast<uint64_t>(medianStepInterval_) == 0;
+    for (int y = 0; y < frame.rows; ++y) {
+        const uchar* in = frame.ptr<uchar>(y);
+        uchar* bg = background_.ptr<uchar>(y);
+        uchar* out = mask.ptr<uchar>(y);
+        for (int x = 0; x < frame.cols; ++x) {
+            uchar foreground = 0;
+            for (int c = 0; c < channels; ++c, ++in, ++bg) {
+                if (std::abs(*in - *bg) > threshold) foreground = 255;
+                if (step) *bg = static_cast<uchar>(*bg + (*in > *bg) - (*in < *bg));
+            }
+            out[x] = foreground;
+        }
+    }
+}
+
+void ApproximateBackgroundSubtractor::getBackgroundImage(cv::OutputArray backgroundImage) const {
+    if (background_.empty()) {
+        backgroundImage.release();
+        return;
+    }
+    if (method_ == Method::RUNNING_AVERAGE) {
+        background_.convertTo(backgroundImage, CV_MAKETYPE(CV_8U, channels_), 1.0 / 256.0);
+    } else {
+        background_.copyTo(backgroundImage);
+    }
+}
@@ -0,0 +1,669 @@
+#include "async_file_writer.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <thread>
+#include <utility>
+
+#include "logger.hpp"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Raw io_uring system calls (no liburing); the headers need 5.6 for OPENAT, CLOSE and probing
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(IO_URING_OP_SUPPORTED) && defined(__NR_io_uring_setup)
+#define BIRDS_HAVE_IO_URING 1
+#endif
+#endif
+
+struct AsyncFileWriter::Request {
+    std::string path;
+    Buffer bytes;
+    size_t size = 0;  // bytes.size(), kept when the bytes were copied to a registered buffer
+    Completion done;
+    bool sync = false;
+    // io_uring progress
+    int stage = 0;
+    int fd = -1;
+    size_t offset = 0;
+    int fixedBuffer = -1;
+    bool ok = true;
+};
+
+class AsyncFileWriter::Engine {
+   public:
+    explicit Engine(AsyncFileWriter& owner) : owner_(owner) {}
+    virtual ~Engine() = default;
+
+    virtual void submit(std::unique_ptr<Request> request) = 0;
+    // Finish everything submitted and stop the threads
+    virtual void stop() = 0;
+    virtual void addStats(FileWriterStats& stats) const { (void)stats; }
+
+   protected:
+    void complete(std::unique_ptr<Request> request, bool written) {
+        owner_.complete(std::move(request), written);
+    }
+    void recycle(Buffer buffer) { owner_.recycle(std::move(buffer)); }
+
+    AsyncFileWriter& owner_;
+};
+
+namespace {
+
+#ifdef __linux__
+// Open, write, optionally fdatasync and close on the calling thread
+bool writeWholeFile(const std::string& path, const unsigned char* data, size_t size, bool sync) {
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    bool ok = true;
+    size_t offset = 0;
+    while (ok && offset < size) {
+        const ssize_t written = ::write(fd, data + offset, size - offset);
+        if (written > 0) {
+            offset += static_cast<size_t>(written);
+        } else if (written < 0 && errno == EINTR) {
+            continue;
+        } else {
+            ok = false;
+        }
+    }
+    if (ok && sync && ::fdatasync(fd) != 0) ok = false;
+    if (::close(fd) != 0) ok = false;
+    return ok;
+}
+#else
+bool writeWholeFile(const std::string& path, const unsigned char* data, size_t size, bool sync) {
+    (void)sync;  // No portable fdatasync
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+    bool ok = std::fwrite(data, 1, size, file) == size;
+    if (std::fclose(file) != 0) ok = false;
+    return ok;
+}
+#endif
+
+}  // namespace
+
+// A few threads making the system calls one file at a time
+class ThreadEngine : public AsyncFileWriter::Engine {
+   public:
+    ThreadEngine(AsyncFileWriter& owner, size_t threads) : Engine(owner) {
+        for (size_t i = 0; i < std::max<size_t>(1, threads); ++i) {
+            workers_.emplace_back([this] { run(); });
+        }
+    }
+
+    ~ThreadEngine() override { stop(); }
+
+    void submit(std::unique_ptr<AsyncFileWriter::Request> request) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(std::move(request));
+        }
+        wake_.notify_one();
+    }
+
+    void stop() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (std::thread& worker : workers_) {
+            if (worker.joinable()) worker.join();
+        }
+    }
+
+   private:
+    void run() {
+        while (true) {
+            std::unique_ptr<AsyncFileWriter::Request> request;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+                if (queue_.empty()) return;
+                request = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            const bool written =
+                writeWholeFile(request->path, request->bytes.data(), request->bytes.size(), request->sync);
+            complete(std::move(request), written);
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::unique_ptr<AsyncFileWriter::Request>> queue_;  // Guarded by mutex_
+    bool stopping_ = false;                                         // Guarded by mutex_
+    std::vector<std::thread> workers_;
+};
+
+#ifdef BIRDS_HAVE_IO_URING
+
+/**
+ * One thread owning an io_uring. Each file goes through OPENAT, WRITE (again after a short
+ * write), FSYNC when due and CLOSE, one operation at a time; the operations of every file in
+ * flight share the io_uring_enter() calls. A READ on an eventfd stays armed so that write()
+ * and stop() can wake the thread while it waits for completions.
+ */
+class IoUringEngine : public AsyncFileWriter::Engine {
+   public:
+    // nullptr (with the reason logged) when the kernel cannot run it
+    static std::unique_ptr<IoUringEngine> create(AsyncFileWriter& owner, const FileWriterConfig& config) {
+        std::unique_ptr<IoUringEngine> engine(new IoUringEngine(owner));
+        std::string reason;
+        if (!engine->setup(config, reason)) {
+            LOG_INFO("io_uring file writer unavailable ({}), using threads", reason);
+            return nullptr;
+        }
+        engine->thread_ = std::thread([engine = engine.get()] { engine->run(); });
+        return engine;
+    }
+
+    ~IoUringEngine() override {
+        stop();
+        if (sqes_) munmap(sqes_, sqesSize_);
+        if (cqRing_ && cqRing_ != sqRing_) munmap(cqRing_, cqRingSize_);
+        if (sqRing_) munmap(sqRing_, sqRingSize_);
+        if (ringFd_ >= 0) ::close(ringFd_);
+        if (eventFd_ >= 0) ::close(eventFd_);
+    }
+
+    void submit(std::unique_ptr<AsyncFileWriter::Request> request) override {
+        bool first;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            first = incoming_.empty();
+            incoming_.push_back(std::move(request));
+        }
+        // The ring thread takes the whole queue, so only the first file needs to wake it
+        if (first) wake();
+    }
+
+    void stop() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        if (!thread_.joinable()) return;
+        wake();
+        thread_.join();
+    }
+
+    void addStats(FileWriterStats& stats) const override {
+        stats.submitCalls = submitCalls_.load();
+        stats.sqesSubmitted = sqesSubmitted_.load();
+        stats.cqesReaped = cqesReaped_.load();
+        stats.sqHighWatermark = sqHighWatermark_.load();
+        stats.sqWaiting = sqWaiting_.load();
+        stats.cqOverflows = cqOverflow_ ? __atomic_load_n(cqOverflow_, __ATOMIC_RELAXED) : 0;
+        stats.fixedBufferWrites = fixedBufferWrites_.load();
+    }
+
+   private:
+    enum Stage { Open, Write, Sync, Close };
+    static constexpr uint64_t kWakeTag = 0;  // user_data of the eventfd READ; requests use their address
+
+    explicit IoUringEngine(AsyncFileWriter& owner) : Engine(owner) {}
+
+    static int enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+    }
+
+    static int registerRing(int fd, unsigned opcode, void* arg, unsigned count) {
+        return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+    }
+
+    bool setup(const FileWriterConfig& config, std::string& reason) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ringFd_ = static_cast<int>(syscall(__NR_io_uring_setup, std::max(4u, config.queueDepth), &params));
+        if (ringFd_ < 0) {
+            reason = std::string("io_uring_setup: ") + std::strerror(errno);
+            return false;
+        }
+        sqEntries_ = params.sq_entries;
+
+        sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMmap) sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+        sqRing_ = map(sqRingSize_, IORING_OFF_SQ_RING);
+        cqRing_ = singleMmap ? sqRing_ : map(cqRingSize_, IORING_OFF_CQ_RING);
+        sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(map(sqesSize_, IORING_OFF_SQES));
+        if (!sqRing_ || !cqRing_ || !sqes_) {
+            reason = std::string("mmap: ") + std::strerror(errno);
+            return false;
+        }
+        char* sq = static_cast<char*>(sqRing_);
+        char* cq = static_cast<char*>(cqRing_);
+        sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        cqOverflow_ = reinterpret_cast<unsigned*>(cq + params.cq_off.overflow);
+
+        // Kernels before 5.6 (and seccomp profiles) lack the file operations
+        std::vector<unsigned char> probeMemory(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+        auto* probe = reinterpret_cast<io_uring_probe*>(probeMemory.data());
+        if (registerRing(ringFd_, IORING_REGISTER_PROBE, probe, 256) < 0) {
+            reason = std::string("probe: ") + std::strerror(errno);
+            return false;
+        }
+        const auto supported = [probe](unsigned op) {
+            return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+        };
+        for (const unsigned op : {IORING_OP_OPENAT, IORING_OP_WRITE, IORING_OP_FSYNC, IORING_OP_CLOSE,
+                                  IORING_OP_READ}) {
+            if (!supported(op)) {
+                reason = "operation " + std::to_string(op) + " not supported";
+                return false;
+            }
+        }
+
+        eventFd_ = eventfd(0, EFD_CLOEXEC);
+        if (eventFd_ < 0) {
+            reason = std::string("eventfd: ") + std::strerror(errno);
+            return false;
+        }
+
+        // Registered buffers count against RLIMIT_MEMLOCK on older kernels: without them
+        // every write maps the caller's pages, which still works
+        if (config.registeredBuffers > 0 && config.bufferBytes > 0 && supported(IORING_OP_WRITE_FIXED)) {
+            bufferBytes_ = config.bufferBytes;
+            std::vector<iovec> iovecs;
+            for (size_t i = 0; i < config.registeredBuffers; ++i) {
+                fixedBuffers_.emplace_back(new unsigned char[bufferBytes_]);
+                iovecs.push_back({fixedBuffers_.back().get(), bufferBytes_});
+            }
+            if (registerRing(ringFd_, IORING_REGISTER_BUFFERS, iovecs.data(),
+                             static_cast<unsigned>(iovecs.size())) < 0) {
+                LOG_WARN("Could not register {} file writer buffers ({}), writing from encoder buffers",
+                         iovecs.size(), std::strerror(errno));
+                fixedBuffers_.clear();
+            }
+            for (size_t i = 0; i < fixedBuffers_.size(); ++i) freeFixedBuffers_.push_back(static_cast<int>(i));
+        }
+
+        // One operation per file in flight plus the wake READ: the completion queue (twice
+        // the submission queue) cannot overflow
+        maxActive_ = std::max(1u, sqEntries_ - 1);
+        return true;
+    }
+
+    void* map(size_t size, off_t offset) const {
+        void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, offset);
+        return memory == MAP_FAILED ? nullptr : memory;
+    }
+
+    void wake() const {
+        const uint64_t one = 1;
+        if (::write(eventFd_, &one, sizeof(one)) < 0) {
+            LOG_WARN("Could not wake the file writer: {}", std::strerror(errno));
+        }
+    }
+
+    // Queue the next operation of @p request, or park it until a submission entry is free
+    void prepare(AsyncFileWriter::Request* request) {
+        const unsigned tail = *sqTail_;
+        if (tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_) {
+            waiting_.push_back(request);
+            sqWaiting_.store(waiting_.size(), std::memory_order_relaxed);
+            return;
+        }
+        const unsigned index = tail & sqMask_;
+        io_uring_sqe* sqe = &sqes_[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->user_data = reinterpret_cast<uintptr_t>(request);
+        switch (request->stage) {
+            case Open:
+                sqe->opcode = IORING_OP_OPENAT;
+                sqe->fd = AT_FDCWD;
+                sqe->addr = reinterpret_cast<uintptr_t>(request->path.c_str());
+                sqe->len = 0644;
+                sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+                break;
+            case Write: {
+                const size_t remaining = std::min<size_t>(request->size - request->offset, 1u << 30);
+                sqe->fd = request->fd;
+                sqe->off = request->offset;
+                sqe->len = static_cast<unsigned>(remaining);
+                if (request->fixedBuffer >= 0) {
+                    sqe->opcode = IORING_OP_WRITE_FIXED;
+                    sqe->addr = reinterpret_cast<uintptr_t>(fixedBuffers_[request->fixedBuffer].get() +
+                                                            request->offset);
+                    sqe->buf_index = static_cast<uint16_t>(request->fixedBuffer);
+                    fixedBufferWrites_.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    sqe->opcode = IORING_OP_WRITE;
+                    sqe->addr = reinterpret_cast<uintptr_t>(request->bytes.data() + request->offset);
+                }
+                break;
+            }
+            case Sync:
+                sqe->opcode = IORING_OP_FSYNC;
+                sqe->fd = request->fd;
+                sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+                break;
+            case Close:
+                sqe->opcode = IORING_OP_CLOSE;
+                sqe->fd = request->fd;
+                break;
+        }
+        sqArray_[index] = index;
+        __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+        ++unsubmitted_;
+    }
+
+    bool armWake() {
+        const unsigned tail = *sqTail_;
+        if (tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_) return false;
+        const unsigned index = tail & sqMask_;
+        io_uring_sqe* sqe = &sqes_[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = eventFd_;
+        sqe->addr = reinterpret_cast<uintptr_t>(&wakeValue_);
+        sqe->len = sizeof(wakeValue_);
+        sqe->user_data = kWakeTag;
+        sqArray_[index] = index;
+        __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+        ++unsubmitted_;
+        return true;
+    }
+
+    // Start files from the incoming queue while fewer than maxActive_ are in flight
+    void admit(std::deque<std::unique_ptr<AsyncFileWriter::Request>>& admitted) {
+        while (!admitted.empty() && active_ < maxActive_) {
+            AsyncFileWriter::Request* request = admitted.front().release();
+            admitted.pop_front();
+            ++active_;
+            request->size = request->bytes.size();
+            if (!freeFixedBuffers_.empty() && request->size > 0 && request->size <= bufferBytes_) {
+                request->fixedBuffer = freeFixedBuffers_.back();
+                freeFixedBuffers_.pop_back();
+                std::memcpy(fixedBuffers_[request->fixedBuffer].get(), request->bytes.data(), request->size);
+                recycle(std::move(request->bytes));
+                request->bytes = AsyncFileWriter::Buffer();
+            }
+            request->stage = Open;
+            prepare(request);
+        }
+    }
+
+    void advance(AsyncFileWriter::Request* request, int result) {
+        switch (request->stage) {
+            case Open:
+                if (result < 0) {
+                    finish(request, false);
+                    return;
+                }
+                request->fd = result;
+                request->stage = request->size > 0 ? Write : (request->sync ? Sync : Close);
+                break;
+            case Write:
+                if (result == -EINTR || result == -EAGAIN) break;  // Same write again
+                if (result <= 0) {
+                    request->ok = false;
+                    request->stage = Close;
+                    break;
+                }
+                request->offset += static_cast<size_t>(result);
+                if (request->offset < request->size) break;  // Short write: the rest
+                request->stage = request->sync ? Sync : Close;
+                break;
+            case Sync:
+                if (result < 0) request->ok = false;
+                request->stage = Close;
+                break;
+            case Close:
+                finish(request, request->ok && result >= 0);
+                return;
+        }
+        prepare(request);
+    }
+
+    void finish(AsyncFileWriter::Request* request, bool written) {
+        if (request->fixedBuffer >= 0) freeFixedBuffers_.push_back(request->fixedBuffer);
+        --active_;
+        complete(std::unique_ptr<AsyncFileWriter::Request>(request), written);
+    }
+
+    void run() {
+        std::deque<std::unique_ptr<AsyncFileWriter::Request>> admitted;
+        bool wakeArmed = false;
+        std::vector<io_uring_cqe> completions;
+        while (true) {
+            bool stopping;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping = stopping_;
+                while (!incoming_.empty()) {
+                    admitted.push_back(std::move(incoming_.front()));
+                    incoming_.pop_front();
+                }
+            }
+            // The wake READ must complete before the ring goes; stop() wrote the eventfd
+            if (stopping && admitted.empty() && active_ == 0 && !wakeArmed) return;
+
+            // Parked operations first: they were ready before anything new
+            while (!waiting_.empty() && *sqTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) < sqEntries_) {
+                AsyncFileWriter::Request* request = waiting_.front();
+                waiting_.pop_front();
+                prepare(request);
+            }
+            sqWaiting_.store(waiting_.size(), std::memory_order_relaxed);
+            admit(admitted);
+            if (!wakeArmed && !stopping) wakeArmed = armWake();
+
+            const unsigned toSubmit = unsubmitted_;
+            const int result = enter(ringFd_, toSubmit, 1, IORING_ENTER_GETEVENTS);
+            if (result < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                LOG_ERROR("io_uring_enter failed: {}", std::strerror(errno));
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            if (result > 0) {
+                unsubmitted_ -= static_cast<unsigned>(result);
+                submitCalls_.fetch_add(1, std::memory_order_relaxed);
+                sqesSubmitted_.fetch_add(static_cast<uint64_t>(result), std::memory_order_relaxed);
+                if (static_cast<size_t>(result) > sqHighWatermark_.load(std::memory_order_relaxed)) {
+                    sqHighWatermark_.store(static_cast<size_t>(result), std::memory_order_relaxed);
+                }
+            }
+
+            // Copy the completions out first: handling them queues the next operations
+            completions.clear();
+            unsigned head = *cqHead_;
+            const unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head) completions.push_back(cqes_[head & cqMask_]);
+            __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+            cqesReaped_.fetch_add(completions.size(), std::memory_order_relaxed);
+            for (const io_uring_cqe& cqe : completions) {
+                if (cqe.user_data == kWakeTag) {
+                    wakeArmed = false;
+                } else {
+                    advance(reinterpret_cast<AsyncFileWriter::Request*>(cqe.user_data), cqe.res);
+                }
+            }
+        }
+    }
+
+    int ringFd_ = -1;
+    int eventFd_ = -1;
+    uint64_t wakeValue_ = 0;
+    unsigned sqEntries_ = 0;
+    void* sqRing_ = nullptr;
+    void* cqRing_ = nullptr;
+    size_t sqRingSize_ = 0;
+    size_t cqRingSize_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqesSize_ = 0;
+    unsigned* sqHead_ = nullptr;
+    unsigned* sqTail_ = nullptr;
+    unsigned sqMask_ = 0;
+    unsigned* sqArray_ = nullptr;
+    unsigned* cqHead_ = nullptr;
+    unsigned* cqTail_ = nullptr;
+    unsigned cqMask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned* cqOverflow_ = nullptr;
+
+    std::vector<std::unique_ptr<unsigned char[]>> fixedBuffers_;
+    size_t bufferBytes_ = 0;
+
+    std::mutex mutex_;
+    std::deque<std::unique_ptr<AsyncFileWriter::Request>> incoming_;  // Guarded by mutex_
+    bool stopping_ = false;                                            // Guarded by mutex_
+    std::thread thread_;
+
+    // Ring thread only
+    std::vector<int> freeFixedBuffers_;
+    std::deque<AsyncFileWriter::Request*> waiting_;
+    unsigned unsubmitted_ = 0;
+    unsigned active_ = 0;
+    unsigned maxActive_ = 1;
+
+    std::atomic<uint64_t> submitCalls_{0};
+    std::atomic<uint64_t> sqesSubmitted_{0};
+    std::atomic<uint64_t> cqesReaped_{0};
+    std::atomic<size_t> sqHighWatermark_{0};
+    std::atomic<size_t> sqWaiting_{0};
+    std::atomic<uint64_t> fixedBufferWrites_{0};
+};
+
+#endif  // BIRDS_HAVE_IO_URING
+
+AsyncFileWriter::AsyncFileWriter(const FileWriterConfig& config) : config_(config) {
+#ifdef BIRDS_HAVE_IO_URING
+    if (config_.backend != FileWriterBackend::Threads) {
+        engine_ = IoUringEngine::create(*this, config_);
+        if (engine_) backend_ = FileWriterBackend::IoUring;
+    }
+#else
+    if (config_.backend == FileWriterBackend::IoUring) {
+        LOG_INFO("io_uring file writer not built in, using threads");
+    }
+#endif
+    if (!engine_) {
+        engine_.reset(new ThreadEngine(*this, config_.threads));
+        backend_ = FileWriterBackend::Threads;
+    }
+    LOG_INFO("File writer: {} backend, fdatasync every {} file(s)", fileWriterBackendName(backend_),
+             config_.fsyncEvery);
+}
+
+AsyncFileWriter::~AsyncFileWriter() {
+    flush();
+    engine_->stop();
+}
+
+AsyncFileWriter::Buffer AsyncFileWriter::acquireBuffer() {
+    std::lock_guard<std::mutex> lock(bufferMutex_);
+    if (freeBuffers_.empty()) return Buffer();
+    Buffer buffer = std::move(freeBuffers_.back());
+    freeBuffers_.pop_back();
+    buffer.clear();
+    return buffer;
+}
+
+void AsyncFileWriter::recycle(Buffer buffer) {
+    if (buffer.capacity() == 0) return;
+    std::lock_guard<std::mutex> lock(bufferMutex_);
+    // About what a full queue holds; more would only keep memory from a burst
+    if (freeBuffers_.size() < std::max<size_t>(config_.queueDepth, 8)) freeBuffers_.push_back(std::move(buffer));
+}
+
+void AsyncFileWriter::write(std::string path, Buffer bytes, Completion done) {
+    std::unique_ptr<Request> request(new Request);
+    request->path = std::move(path);
+    request->size = bytes.size();
+    request->bytes = std::move(bytes);
+    request->done = std::move(done);
+    const uint64_t number = filesSubmitted_.fetch_add(1) + 1;
+    request->sync = config_.fsyncEvery > 0 && number % config_.fsyncEvery == 0;
+    {
+        std::lock_guard<std::mutex> lock(flushMutex_);
+        inFlightHighWatermark_ = std::max(inFlightHighWatermark_, ++inFlight_);
+    }
+    engine_->submit(std::move(request));
+}
+
+void AsyncFileWriter::complete(std::unique_ptr<Request> request, bool written) {
+    if (written) {
+        filesWritten_.fetch_add(1, std::memory_order_relaxed);
+        bytesWritten_.fetch_add(request->size, std::memory_order_relaxed);
+        if (request->sync) syncs_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        filesFailed_.fetch_add(1, std::memory_order_relaxed);
+        LOG_WARN("Could not write {}", request->path);
+    }
+    if (request->done) request->done(written);
+    recycle(std::move(request->bytes));
+    request.reset();
+    {
+        std::lock_guard<std::mutex> lock(flushMutex_);
+        --inFlight_;
+    }
+    flushed_.notify_all();
+}
+
+void AsyncFileWriter::flush() {
+    std::unique_lock<std::mutex> lock(flushMutex_);
+    flushed_.wait(lock, [this] { return inFlight_ == 0; });
+}
+
+FileWriterStats AsyncFileWriter::getStats() const {
+    FileWriterStats stats;
+    stats.backend = backend_;
+    stats.filesSubmitted = filesSubmitted_.load();
+    stats.filesWritten = filesWritten_.load();
+    stats.filesFailed = filesFailed_.load();
+    stats.bytesWritten = bytesWritten_.load();
+    stats.syncs = syncs_.load();
+    {
+        std::lock_guard<std::mutex> lock(flushMutex_);
+        stats.inFlight = inFlight_;
+        stats.inFlightHighWatermark = inFlightHighWatermark_;
+    }
+    engine_->addStats(stats);
+    return stats;
+}
+
+FileWriteBatch::FileWriteBatch(AsyncFileWriter& writer) : writer_(writer), state_(std::make_shared<State>()) {}
+
+void FileWriteBatch::write(std::string path, AsyncFileWriter::Buffer bytes, bool* written) {
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        ++state_->pending;
+    }
+    std::shared_ptr<State> state = state_;
+    writer_.write(std::move(path), std::move(bytes), [state, written](bool ok) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (written) *written = ok;
+        if (--state->pending == 0) state->done.notify_all();
+    });
+}
+
+void FileWriteBatch::wait() {
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    state_->done.wait(lock, [this] { return state_->pending == 0; });
+}
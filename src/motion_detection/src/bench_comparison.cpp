@@ -0,0 +1,302 @@
+#include "bench_comparison.hpp"
+
+#include <yaml-cpp/yaml.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ostream>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+// Fields of a benchmark entry that are not user counters
+const std::set<std::string> kStandardFields = {
+    "name",         "family_index",  "per_family_instance_index", "run_name",      "run_type",
+    "repetitions",  "repetition_index", "threads",                "iterations",    "real_time",
+    "cpu_time",     "time_unit",     "aggregate_name",            "aggregate_unit", "error_occurred",
+    "error_message", "label",        "big_o",                     "rms",           "complexity_n"};
+
+// Accuracy counters the bench reports, and which way is better
+const std::pair<const char*, bool> kQualityCounters[] = {
+    {"box_recall", true},     {"box_precision", true}, {"box_iou", true},
+    {"region_recall", true},  {"region_precision", true}, {"recall", true},
+    {"false_boxes/frame", false}, {"psnr_vs_reference", true}};
+
+double nanosecondsPer(const std::string& unit) {
+    if (unit == "us") return 1e3;
+    if (unit == "ms") return 1e6;
+    if (unit == "s") return 1e9;
+    return 1.0;
+}
+
+double median(std::vector<double> values) {
+    if (values.empty()) return 0.0;
+    const size_t middle = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + middle, values.end());
+    const double upper = values[middle];
+    if (values.size() % 2 == 1) return upper;
+    return 0.5 * (upper + *std::max_element(values.begin(), values.begin() + middle));
+}
+
+// Counter values of one entry, added to @p sums (value, count)
+void addCounters(const YAML::Node& entry, std::map<std::string, std::pair<double, int>>& sums) {
+    for (const auto& field : entry) {
+        const std::string key = field.first.as<std::string>();
+        if (kStandardFields.count(key) || !field.second.IsScalar()) continue;
+        try {
+            auto& sum = sums[key];
+            sum.first += field.second.as<double>();
+            sum.second++;
+        } catch (const YAML::Exception&) {
+            // Not a number
+        }
+    }
+}
+
+// Percentile interval of the median change, resampling both runs with replacement
+std::pair<double, double> bootstrapChange(const std::vector<double>& baseline, const std::vector<double>& current,
+                                          const BenchComparisonOptions& options) {
+    std::mt19937 random(20240607u);
+    std::uniform_int_distribution<size_t> pickBaseline(0, baseline.size() - 1);
+    std::uniform_int_distribution<size_t> pickCurrent(0, current.size() - 1);
+    std::vector<double> changes;
+    changes.reserve(options.resamples);
+    std::vector<double> a(baseline.size()), b(current.size());
+    for (int r = 0; r < options.resamples; ++r) {
+        for (double& value : a) value = baseline[pickBaseline(random)];
+        for (double& value : b) value = current[pickCurrent(random)];
+        const double base = median(a);
+        if (base > 0.0) changes.push_back(median(b) / base - 1.0);
+    }
+    if (changes.empty()) return {0.0, 0.0};
+    std::sort(changes.begin(), changes.end());
+    const double tail = (1.0 - options.confidence) / 2.0;
+    const auto at = [&](double quantile) {
+        const size_t index = static_cast<size_t>(std::lround(quantile * static_cast<double>(changes.size() - 1)));
+        return changes[std::min(index, changes.size() - 1)];
+    };
+    return {at(tail), at(1.0 - tail)};
+}
+
+std::string formatTime(double nanoseconds) {
+    char text[32];
+    if (nanoseconds >= 1e9) {
+        std::snprintf(text, sizeof(text), "%.3f s", nanoseconds * 1e-9);
+    } else if (nanoseconds >= 1e6) {
+        std::snprintf(text, sizeof(text), "%.3f ms", nanoseconds * 1e-6);
+    } else if (nanoseconds >= 1e3) {
+        std::snprintf(text, sizeof(text), "%.3f us", nanoseconds * 1e-3);
+    } else {
+        std::snprintf(text, sizeof(text), "%.1f ns", nanoseconds);
+    }
+    return text;
+}
+
+}  // namespace
+
+std::map<std::string, BenchmarkSamples> loadBenchmarkJson(const std::string& path) {
+    YAML::Node root;
+    try {
+        root = YAML::LoadFile(path);
+    } catch (const YAML::Exception& e) {
+        throw std::runtime_error(path + ": " + e.what());
+    }
+    const YAML::Node list = root["benchmarks"];
+    if (!list || !list.IsSequence()) throw std::runtime_error(path + ": no \"benchmarks\" list");
+
+    std::map<std::string, BenchmarkSamples> benchmarks;
+    std::map<std::string, std::map<std::string, std::pair<double, int>>> counterSums;
+    std::map<std::string, YAML::Node> means;  // Aggregates-only files: the mean of each benchmark
+    for (const YAML::Node& entry : list) {
+        if (entry["error_occurred"] && entry["error_occurred"].as<bool>()) continue;
+        const std::string name = (entry["run_name"] ? entry["run_name"] : entry["name"]).as<std::string>();
+        const std::string runType = entry["run_type"] ? entry["run_type"].as<std::string>() : "iteration";
+        if (runType == "aggregate") {
+            if (entry["aggregate_name"] && entry["aggregate_name"].as<std::string>() == "mean") means[name] = entry;
+            continue;
+        }
+        const std::string unit = entry["time_unit"] ? entry["time_unit"].as<std::string>() : "ns";
+        benchmarks[name].times.push_back(entry["real_time"].as<double>() * nanosecondsPer(unit));
+        addCounters(entry, counterSums[name]);
+    }
+    for (const auto& [name, entry] : means) {
+        if (benchmarks.count(name)) continue;
+        const std::string unit = entry["time_unit"] ? entry["time_unit"].as<std::string>() : "ns";
+        benchmarks[name].times.push_back(entry["real_time"].as<double>() * nanosecondsPer(unit));
+        addCounters(entry, counterSums[name]);
+    }
+    for (const auto& [name, sums] : counterSums) {
+        for (const auto& [key, sum] : sums) benchmarks[name].counters[key] = sum.first / sum.second;
+    }
+    return benchmarks;
+}
+
+double mannWhitneyPValue(const std::vector<double>& a, const std::vector<double>& b) {
+    const size_t m = a.size();
+    const size_t n = b.size();
+    if (m == 0 || n == 0) return 1.0;
+
+    // Ranks of the pooled samples, ties sharing their mean rank
+    std::vector<std::pair<double, bool>> pooled;  // (value, from a)
+    pooled.reserve(m + n);
+    for (double value : a) pooled.emplace_back(value, true);
+    for (double value : b) pooled.emplace_back(value, false);
+    std::sort(pooled.begin(), pooled.end(),
+              [](const auto& x, const auto& y) { return x.first < y.first; });
+    double rankSumA = 0.0;
+    double tieTerm = 0.0;  // Sum of t^3 - t over the groups of t tied values
+    for (size_t i = 0; i < pooled.size();) {
+        size_t j = i;
+        while (j < pooled.size() && pooled[j].first == pooled[i].first) ++j;
+        const double rank = 0.5 * static_cast<double>(i + 1 + j);  // Mean of ranks i + 1 .. j
+        for (size_t k = i; k < j; ++k) {
+            if (pooled[k].second) rankSumA += rank;
+        }
+        const double t = static_cast<double>(j - i);
+        tieTerm += t * t * t - t;
+        i = j;
+    }
+    const double pairs = static_cast<double>(m) * static_cast<double>(n);
+    const double u = rankSumA - static_cast<double>(m) * static_cast<double>(m + 1) / 2.0;
+    const double uSmall = std::min(u, pairs - u);
+
+    if (tieTerm == 0.0 && m * n <= 400) {
+        // counts[i][j][k]: arrangements of i values of a and j of b with U = k
+        std::vector<std::vector<std::vector<double>>> counts(m + 1, std::vector<std::vector<double>>(n + 1));
+        for (size_t i = 0; i <= m; ++i) {
+            for (size_t j = 0; j <= n; ++j) {
+                std::vector<double>& row = counts[i][j];
+                row.assign(i * j + 1, 0.0);
+                if (i == 0 || j == 0) {
+                    row[0] = 1.0;
+                    continue;
+                }
+                // The largest value is from a (beating all j of b) or from b
+                const std::vector<double>& withA = counts[i - 1][j];
+                const std::vector<double>& withB = counts[i][j - 1];
+                for (size_t k = 0; k < withA.size(); ++k) row[k + j] += withA[k];
+                for (size_t k = 0; k < withB.size(); ++k) row[k] += withB[k];
+            }
+        }
+        const std::vector<double>& distribution = counts[m][n];
+        double total = 0.0;
+        double tail = 0.0;
+        for (size_t k = 0; k < distribution.size(); ++k) {
+            total += distribution[k];
+            if (static_cast<double>(k) <= uSmall + 1e-9) tail += distribution[k];
+        }
+        return std::min(1.0, 2.0 * tail / total);
+    }
+
+    const double count = static_cast<double>(m + n);
+    const double variance = pairs / 12.0 * ((count + 1.0) - tieTerm / (count * (count - 1.0)));
+    if (variance <= 0.0) return 1.0;
+    const double z = std::max(0.0, std::abs(u - pairs / 2.0) - 0.5) / std::sqrt(variance);
+    return std::min(1.0, std::erfc(z / std::sqrt(2.0)));
+}
+
+size_t BenchComparison::regressions() const {
+    return static_cast<size_t>(std::count_if(deltas.begin(), deltas.end(), [](const BenchmarkDelta& delta) {
+        return delta.verdict == BenchmarkDelta::Verdict::Regression;
+    }));
+}
+
+size_t BenchComparison::qualityRegressions() const {
+    size_t count = 0;
+    for (const BenchmarkDelta& delta : deltas) {
+        for (const QualityDelta& quality : delta.quality) count += quality.worse ? 1 : 0;
+    }
+    return count;
+}
+
+BenchComparison compareBenchmarks(const std::map<std::string, BenchmarkSamples>& baseline,
+                                  const std::map<std::string, BenchmarkSamples>& current,
+                                  const BenchComparisonOptions& options) {
+    BenchComparison comparison;
+    for (const auto& [name, base] : baseline) {
+        const auto found = current.find(name);
+        if (found == current.end()) {
+            comparison.onlyBaseline.push_back(name);
+            continue;
+        }
+        const BenchmarkSamples& now = found->second;
+        BenchmarkDelta delta;
+        delta.name = name;
+        delta.baselineSamples = base.times.size();
+        delta.currentSamples = now.times.size();
+        delta.baselineMedian = median(base.times);
+        delta.currentMedian = median(now.times);
+        if (delta.baselineMedian > 0.0) delta.change = delta.currentMedian / delta.baselineMedian - 1.0;
+        delta.changeLow = delta.changeHigh = delta.change;
+        if (std::min(delta.baselineSamples, delta.currentSamples) >= 3) {
+            std::tie(delta.changeLow, delta.changeHigh) = bootstrapChange(base.times, now.times, options);
+            delta.pValue = mannWhitneyPValue(base.times, now.times);
+            const bool significant = delta.pValue < options.alpha &&
+                                     (delta.changeLow > 0.0 || delta.changeHigh < 0.0) &&
+                                     std::abs(delta.change) > options.minChange;
+            delta.verdict = !significant           ? BenchmarkDelta::Verdict::Unchanged
+                            : delta.change > 0.0 ? BenchmarkDelta::Verdict::Regression
+                                                 : BenchmarkDelta::Verdict::Improvement;
+        }
+        for (const auto& [counter, higherIsBetter] : kQualityCounters) {
+            const auto before = base.counters.find(counter);
+            const auto after = now.counters.find(counter);
+            if (before == base.counters.end() || after == now.counters.end()) continue;
+            QualityDelta quality;
+            quality.name = counter;
+            quality.baseline = before->second;
+            quality.current = after->second;
+            quality.higherIsBetter = higherIsBetter;
+            const double gain = higherIsBetter ? quality.current - quality.baseline : quality.baseline - quality.current;
+            quality.worse = gain < -options.qualityTolerance;
+            delta.quality.push_back(std::move(quality));
+        }
+        comparison.deltas.push_back(std::move(delta));
+    }
+    for (const auto& entry : current) {
+        if (!baseline.count(entry.first)) comparison.onlyCurrent.push_back(entry.first);
+    }
+    return comparison;
+}
+
+const char* verdictName(BenchmarkDelta::Verdict verdict) {
+    switch (verdict) {
+        case BenchmarkDelta::Verdict::Unchanged: return "unchanged";
+        case BenchmarkDelta::Verdict::Improvement: return "improvement";
+        case BenchmarkDelta::Verdict::Regression: return "REGRESSION";
+        case BenchmarkDelta::Verdict::Insufficient: return "too few samples";
+    }
+    return "?";
+}
+
+void printBenchComparison(std::ostream& out, const BenchComparison& comparison) {
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-48s %12s %12s %8s %19s %7s  %s\n", "Benchmark", "baseline", "current",
+                  "change", "interval", "p", "verdict");
+    out << line;
+    size_t improvements = 0;
+    for (const BenchmarkDelta& delta : comparison.deltas) {
+        char interval[32];
+        std::snprintf(interval, sizeof(interval), "[%+.1f%%, %+.1f%%]", delta.changeLow * 100.0,
+                      delta.changeHigh * 100.0);
+        std::snprintf(line, sizeof(line), "%-48s %12s %12s %+7.1f%% %19s %7.4f  %s\n", delta.name.c_str(),
+                      formatTime(delta.baselineMedian).c_str(), formatTime(delta.currentMedian).c_str(),
+                      delta.change * 100.0, interval, delta.pValue, verdictName(delta.verdict));
+        out << line;
+        for (const QualityDelta& quality : delta.quality) {
+            std::snprintf(line, sizeof(line), "    %-20s %10.4f -> %10.4f (%+.4f)%s\n", quality.name.c_str(),
+                          quality.baseline, quality.current, quality.current - quality.baseline,
+                          quality.worse ? "  WORSE" : "");
+            out << line;
+        }
+        if (delta.verdict == BenchmarkDelta::Verdict::Improvement) improvements++;
+    }
+    for (const std::string& name : comparison.onlyBaseline) out << "only in baseline: " << name << '\n';
+    for (const std::string& name : comparison.onlyCurrent) out << "only in current:  " << name << '\n';
+    out << comparison.deltas.size() << " benchmarks compared: " << comparison.regressions() << " regressions, "
+        << improvements << " improvements, " << comparison.qualityRegressions() << " accuracy counters worse\n";
+}
@@ -0,0 +1,363 @@
+/**
+ * birds_of_play_autotune: searches config values for the cheapest detection on recorded
+ * footage that still finds the birds, and writes the result as a tuned config file
+ *
+ * Usage:
+ *   birds_of_play_autotune <config.yaml> <video | frame cache | raw dump> [options]
+ *     --raw WxH[xC]         Input is a raw frame dump of WxH frames with C channels (3 or 1)
+ *     --max-frames N        Replay at most N frames per trial
+ *     --ground-truth FILE   Annotated bird boxes (GroundTruth: the --detections text format
+ *                           or a .bobx box capture); frame N is the input's N-th frame.
+ *                           Frames it does not list are not scored
+ *     --level L             Score "regions" (consolidated, default) or "boxes" (motion boxes)
+ *     --min-iou X           IoU a detection needs with a true box to count (default 0.3)
+ *     --min-coverage X      Share of a true box a region must cover, where the ground truth
+ *                           annotates no regions (default 0.5)
+ *     --min-recall X        Recall floor of a usable config (default 0.9)
+ *     --min-precision X     Precision floor of a usable config (default 0.8)
+ *     --trials N            Configs to evaluate, the base config included (default 64)
+ *     --threads N           Trials evaluated at once (default 0 = one per allowed CPU)
+ *     --seed N              Seed of the random search (default 1)
+ *     --space FILE          YAML map of key -> candidate values to search instead of the
+ *                           default space (ParameterTuner::defaultSpace())
+ *     --output FILE         Tuned config to write (default tuned.yaml)
+ *     --trials-csv FILE     Write every trial's values, CPU time, recall and precision
+ *
+ * Each trial replays the frames through MotionProcessor -> ObjectTracker ->
+ * MotionRegionConsolidator on one thread, like birds_of_play_replay, and is measured in
+ * thread CPU time per frame: with OpenCV's own pool off (one thread per trial) the trials
+ * run side by side without skewing each other's numbers, and the number is what the config
+ * costs the camera's cores rather than what it takes on an idle machine. The search
+ * (ParameterTuner) minimizes that CPU time subject to the recall and precision floors.
+ *
+ * Without --ground-truth the tuner is heuristic: the base config's own detections are the
+ * reference, so the floors bound how far a cheaper config may drift from it. A replay's
+ * --detections output makes a starting point for a hand-corrected ground truth file.
+ *
+ * Tuning is per camera: run it on a recording of each camera with that camera's config;
+ * the tuned file is the base document with the chosen values, keys and sections it does not
+ * tune (camera_id, paths, ...) unchanged, though without the original's comments. Trials
+ * never read or write background snapshots.
+ */
+#include <time.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <yaml-cpp/yaml.h>
+
+#include "detection_evaluator.hpp"
+#include "logger.hpp"
+#include "motion_pipeline.hpp"
+#include "motion_processor.hpp"
+#include "motion_region_consolidator.hpp"
+#include "object_tracker.hpp"
+#include "parameter_tuner.hpp"
+#include "pipeline_config.hpp"
+#include "region_flow_propagator.hpp"
+#include "replay_frame_source.hpp"
+#include "thread_budget.hpp"
+#include "tracked_object_store.hpp"
+
+namespace {
+
+struct AutotuneOptions {
+    std::string configPath;
+    std::string inputPath;
+    bool raw = false;
+    cv::Size rawSize;
+    int rawChannels = 3;
+    int maxFrames = -1;
+    std::string groundTruthPath;
+    bool regionLevel = true;
+    double minIou = 0.3;
+    double minCoverage = 0.5;
+    ParameterTuner::Settings tuner;
+    size_t trials = 64;
+    size_t threads = 0;  // 0 = one per allowed CPU
+    std::string spacePath;
+    std::string outputPath = "tuned.yaml";
+    std::string trialsCsvPath;
+};
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <config.yaml> <video | frame cache | raw dump> [--raw WxH[xC]]\n"
+              << "       [--max-frames N] [--ground-truth FILE] [--level regions|boxes] [--min-iou X]\n"
+              << "       [--min-coverage X] [--min-recall X] [--min-precision X] [--trials N] [--threads N]\n"
+              << "       [--seed N] [--space FILE] [--output FILE] [--trials-csv FILE]" << std::endl;
+}
+
+AutotuneOptions parseOptions(int argc, char** argv) {
+    if (argc < 3) throw std::invalid_argument("missing config or input path");
+    AutotuneOptions options;
+    options.configPath = argv[1];
+    options.inputPath = argv[2];
+    for (int i = 3; i < argc; ++i) {
+        const std::string flag = argv[i];
+        if (i + 1 >= argc) throw std::invalid_argument(flag + " needs a value");
+        const std::string value = argv[++i];
+        if (flag == "--raw") {
+            int width = 0, height = 0, channels = 3;
+            if (std::sscanf(value.c_str(), "%dx%dx%d", &width, &height, &channels) < 2 || width <= 0 ||
+                height <= 0 || (channels != 1 && channels != 3)) {
+                throw std::invalid_argument("--raw expects WxH or WxHxC (C = 1 or 3)");
+            }
+            options.raw = true;
+            options.rawSize = cv::Size(width, height);
+            options.rawChannels = channels;
+        } else if (flag == "--max-frames") {
+            options.maxFrames = std::stoi(value);
+        } else if (flag == "--ground-truth") {
+            options.groundTruthPath = value;
+        } else if (flag == "--level") {
+            if (value != "regions" && value != "boxes") {
+                throw std::invalid_argument("--level expects regions or boxes");
+            }
+            options.regionLevel = value == "regions";
+        } else if (flag == "--min-iou") {
+            options.minIou = std::stod(value);
+        } else if (flag == "--min-coverage") {
+            options.minCoverage = std::stod(value);
+        } else if (flag == "--min-recall") {
+            options.tuner.minRecall = std::stod(value);
+        } else if (flag == "--min-precision") {
+            options.tuner.minPrecision = std::stod(value);
+        } else if (flag == "--trials") {
+            options.trials = static_cast<size_t>(std::max(1, std::stoi(value)));
+        } else if (flag == "--threads") {
+            options.threads = static_cast<size_t>(std::max(0, std::stoi(value)));
+        } else if (flag == "--seed") {
+            options.tuner.seed = std::stoull(value);
+        } else if (flag == "--space") {
+            options.spacePath = value;
+        } else if (flag == "--output") {
+            options.outputPath = value;
+        } else if (flag == "--trials-csv") {
+            options.trialsCsvPath = value;
+        } else {
+            throw std::invalid_argument("unknown option " + flag);
+        }
+    }
+    return options;
+}
+
+// Mapped sources hold every frame; --max-frames is applied when replaying them
+ReplayFrameSource loadSource(const AutotuneOptions& options) {
+    if (options.raw) {
+        return ReplayFrameSource::fromRawDump(options.inputPath, options.rawSize,
+                                              options.rawChannels == 3 ? CV_8UC3 : CV_8UC1);
+    }
+    if (ReplayFrameSource::isFrameCache(options.inputPath)) {
+        return ReplayFrameSource::fromFrameCache(options.inputPath);
+    }
+    return ReplayFrameSource::fromVideo(options.inputPath, options.maxFrames);
+}
+
+double threadCpuSeconds() {
+    timespec now{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return static_cast<double>(now.tv_sec) + static_cast<double>(now.tv_nsec) * 1e-9;
+}
+
+// Per frame of a replay: the motion boxes and the consolidated region boxes
+struct ReplayDetections {
+    std::vector<std::vector<cv::Rect>> boxes;
+    std::vector<std::vector<cv::Rect>> regions;
+};
+
+/**
+ * @brief Replays the first @p frames of @p source through @p config on the calling thread
+ * @param detections Filled with each frame's motion boxes and regions
+ * @return The calling thread's CPU time per frame in milliseconds
+ */
+double replayDetections(const std::shared_ptr<const PipelineConfig>& config, const ReplayFrameSource& source,
+                        size_t frames, ReplayDetections& detections) {
+    MotionProcessor motionProcessor(config);
+    motionProcessor.enableVisualization(false);
+    motionProcessor.setVisualizationPath("");
+    motionProcessor.setRetainedStages(MotionProcessor::STAGE_NONE);
+    ConsolidationConfig consolidationConfig = config->consolidation;
+    consolidationConfig.frameSize = source.frameSize();
+    MotionRegionConsolidator regionConsolidator(consolidationConfig);
+    ObjectTracker objectTracker(config->tracker);
+    RegionFlowPropagator propagator(config->flowPropagation);
+    const bool propagate = config->flowPropagation.enabled;
+
+    TrackedObjectStore trackedObjects;
+    std::vector<ConsolidatedRegion> regions;
+    MotionProcessor::ProcessingResult result;
+    detections.boxes.assign(frames, {});
+    detections.regions.assign(frames, {});
+    const double start = threadCpuSeconds();
+    for (size_t i = 0; i < frames; ++i) {
+        const cv::Mat frame = source.frame(i);
+        const bool propagated =
+            propagate && !propagator.detectionDue() && propagator.propagate(frame, result.detectedBounds);
+        if (!propagated) {
+            result = motionProcessor.processFrame(frame);
+            if (propagate) propagator.seed(frame, result.detectedBounds);
+        }
+        if (config->trackerEnabled) {
+            objectTracker.update(result.detectedBounds, trackedObjects);
+        } else {
+            makeTrackedObjects(result.detectedBounds, trackedObjects);
+        }
+        if (propagated) {
+            RegionFlowPropagator::moveRegions(trackedObjects, propagator.shifts(), regions);
+        } else {
+            regions.clear();
+            if (!trackedObjects.empty()) regions = regionConsolidator.consolidateRegions(trackedObjects);
+        }
+
+        detections.boxes[i] = result.detectedBounds;
+        detections.regions[i].reserve(regions.size());
+        for (const ConsolidatedRegion& region : regions) detections.regions[i].push_back(region.boundingBox);
+    }
+    const double cpuSeconds = threadCpuSeconds() - start;
+    return frames > 0 ? 1000.0 * cpuSeconds / static_cast<double>(frames) : 0.0;
+}
+
+void writeTrialsCsv(const std::string& path, const ParameterTuner& tuner, const std::vector<TuningTrial>& trials) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) throw std::runtime_error("Cannot write " + path);
+    out << "trial,valid,cpu_ms_per_frame,recall,precision";
+    for (const TuningParameter& parameter : tuner.space()) out << ',' << parameter.key;
+    out << '\n';
+    for (const TuningTrial& trial : trials) {
+        out << trial.index << ',' << (trial.valid ? 1 : 0) << ',' << trial.cpuMsPerFrame << ','
+            << trial.score.recall() << ',' << trial.score.precision();
+        for (size_t p = 0; p < tuner.space().size(); ++p) {
+            const size_t value = trial.assignment[p];
+            out << ',' << (value < tuner.space()[p].values.size() ? tuner.space()[p].values[value] : "");
+        }
+        out << '\n';
+    }
+}
+
+void printTrial(const char* label, const ParameterTuner& tuner, const TuningTrial& trial) {
+    std::printf("  %-6s #%-4zu %8.3f ms/frame  recall %.3f  precision %.3f%s  %s\n", label, trial.index,
+                trial.cpuMsPerFrame, trial.score.recall(), trial.score.precision(),
+                tuner.feasible(trial) ? "" : " (below floor)", tuner.describe(trial.assignment).c_str());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    AutotuneOptions options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    try {
+        const std::shared_ptr<const PipelineConfig> config = PipelineConfig::load(options.configPath);
+        // Warnings only: dozens of pipelines log their setup
+        Logger::init("warn", "birds_of_play_autotune.log", false);
+        // One OpenCV thread per trial: trials run in parallel instead, and thread CPU time covers all the work
+        cv::setNumThreads(1);
+
+        const ReplayFrameSource source = loadSource(options);
+        const size_t frames = source.isMapped() && options.maxFrames >= 0
+                                  ? std::min(source.size(), static_cast<size_t>(options.maxFrames))
+                                  : source.size();
+        if (frames == 0) throw std::runtime_error("no frames in " + options.inputPath);
+
+        const std::vector<TuningParameter> space =
+            options.spacePath.empty() ? ParameterTuner::defaultSpace()
+                                      : ParameterTuner::parseSpace(YAML::LoadFile(options.spacePath));
+        const ParameterTuner tuner(space, config->document(), options.tuner);
+        const size_t threads = options.threads > 0 ? options.threads : allowedCpus().size();
+
+        GroundTruth truth;
+        if (!options.groundTruthPath.empty()) {
+            truth = GroundTruth::load(options.groundTruthPath);
+        } else {
+            std::printf("No ground truth: scoring against the base config's own %s\n",
+                        options.regionLevel ? "regions" : "boxes");
+            ReplayDetections base;
+            replayDetections(config, source, frames, base);
+            for (size_t i = 0; i < frames; ++i) {
+                truth.add(static_cast<int64_t>(i), AnnotatedFrame{base.boxes[i], base.regions[i]});
+            }
+        }
+        const auto scoredFrames = std::count_if(truth.frames().begin(), truth.frames().end(), [&](const auto& entry) {
+            return entry.first >= 0 && static_cast<size_t>(entry.first) < frames;
+        });
+        std::printf("Tuning %zu parameters over %zu frames of %dx%d (%ld scored), %zu trials on %zu threads\n",
+                    tuner.space().size(), frames, source.frameSize().width, source.frameSize().height,
+                    static_cast<long>(scoredFrames), options.trials, threads);
+
+        std::mutex printMutex;
+        auto evaluate = [&](TuningTrial& trial) {
+            YAML::Node document = tuner.apply(trial.assignment);
+            document["background_snapshot_dir"] = "";
+            const auto trialConfig =
+                PipelineConfig::fromYaml(YAML::Dump(document), "trial " + std::to_string(trial.index));
+            ReplayDetections detections;
+            trial.cpuMsPerFrame = replayDetections(trialConfig, source, frames, detections);
+            DetectionEvaluator evaluator(truth, options.minIou, options.minCoverage);
+            for (size_t i = 0; i < frames; ++i) {
+                evaluator.addFrame(static_cast<int64_t>(i), detections.boxes[i], detections.regions[i]);
+            }
+            trial.score = options.regionLevel ? evaluator.report().regions : evaluator.report().boxes;
+            std::lock_guard<std::mutex> lock(printMutex);
+            std::printf("trial %4zu: %8.3f ms/frame  recall %.3f  precision %.3f\n", trial.index,
+                        trial.cpuMsPerFrame, trial.score.recall(), trial.score.precision());
+            std::fflush(stdout);
+        };
+        const std::vector<TuningTrial> trials = tuner.run(options.trials, threads, evaluate);
+
+        const auto base = std::find_if(trials.begin(), trials.end(),
+                                       [](const TuningTrial& trial) { return trial.index == 0; });
+        const TuningTrial& best = trials.front();
+        const auto rejected = std::count_if(trials.begin(), trials.end(),
+                                            [](const TuningTrial& trial) { return !trial.valid; });
+        std::printf("Best trials (%ld of %zu rejected as invalid configs):\n", static_cast<long>(rejected),
+                    trials.size());
+        for (size_t i = 0; i < trials.size() && i < 5 && trials[i].valid; ++i) printTrial("", tuner, trials[i]);
+        // Trial 0 is always run
+        if (base->valid) {
+            printTrial("base", tuner, *base);
+        } else {
+            std::printf("  base config rejected: %s\n", base->error.c_str());
+        }
+        if (!best.valid) throw std::runtime_error("every trial was rejected: " + best.error);
+        if (!tuner.feasible(best)) {
+            LOG_WARN("No trial met recall {:.2f} and precision {:.2f}; writing the closest one",
+                     options.tuner.minRecall, options.tuner.minPrecision);
+        }
+
+        std::ofstream out(options.outputPath, std::ios::trunc);
+        if (!out) throw std::runtime_error("Cannot write " + options.outputPath);
+        YAML::Emitter emitter;
+        emitter << tuner.apply(best.assignment);
+        out << "# Tuned by birds_of_play_autotune from " << options.configPath << " on " << options.inputPath
+            << " (" << trials.size() << " trials, " << frames << " frames)\n"
+            << "# " << best.cpuMsPerFrame << " ms/frame CPU (base " << (base->valid ? base->cpuMsPerFrame : 0.0)
+            << "), recall " << best.score.recall() << ", precision " << best.score.precision() << " against "
+            << (options.groundTruthPath.empty() ? "the base config" : options.groundTruthPath) << "\n"
+            << "# Changed: " << tuner.describe(best.assignment) << "\n"
+            << emitter.c_str() << "\n";
+        if (!out) throw std::runtime_error("Cannot write " + options.outputPath);
+        std::printf("Wrote %s\n", options.outputPath.c_str());
+        if (!options.trialsCsvPath.empty()) writeTrialsCsv(options.trialsCsvPath, tuner, trials);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        spdlog::shutdown();
+        return 1;
+    }
+
+    spdlog::shutdown();
+    return 0;
+}
@@ -0,0 +1,185 @@
+/**
+ * birds_of_play_batch: offline detection over archived footage, with the segments of every
+ * file processed in parallel (see OfflineBatchProcessor)
+ *
+ * Usage:
+ *   birds_of_play_batch <config.yaml> <video | directory | glob>... [options]
+ *     --output DIR           Directory for the <name>.detections.jsonl files (default data/batch)
+ *     --workers N            Segments processed at once (default: one per hardware thread)
+ *     --segment-seconds S    Target segment length (default 120; cut at the next keyframe)
+ *     --warmup-seconds S     Footage decoded before each segment and discarded (default 10)
+ *
+ * Every output line is one frame with motion, in frame order:
+ *   {"frame":N,"time":S,"boxes":[[x,y,w,h],...],"regions":[[x,y,w,h],...]}
+ * A file that fails is reported and the others go on; the exit status is then 1.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "logger.hpp"
+#include "offline_batch.hpp"
+#include "pipeline_config.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct BatchOptions {
+    std::string configPath;
+    std::vector<std::string> inputs;
+    std::string outputDir = "data/batch";
+    OfflineBatchConfig batch;
+};
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <config.yaml> <video | directory | glob>... [--output DIR]\n"
+              << "       [--workers N] [--segment-seconds S] [--warmup-seconds S]" << std::endl;
+}
+
+BatchOptions parseOptions(int argc, char** argv) {
+    if (argc < 3) throw std::invalid_argument("missing config or input path");
+    BatchOptions options;
+    options.configPath = argv[1];
+    for (int i = 2; i < argc; ++i) {
+        const std::string argument = argv[i];
+        if (argument.rfind("--", 0) != 0) {
+            options.inputs.push_back(argument);
+            continue;
+        }
+        if (i + 1 >= argc) throw std::invalid_argument(argument + " needs a value");
+        const std::string value = argv[++i];
+        if (argument == "--output") {
+            options.outputDir = value;
+        } else if (argument == "--workers") {
+            options.batch.workers = static_cast<size_t>(std::max(0, std::stoi(value)));
+        } else if (argument == "--segment-seconds") {
+            options.batch.segmentSeconds = std::stod(value);
+        } else if (argument == "--warmup-seconds") {
+            options.batch.warmupSeconds = std::stod(value);
+        } else {
+            throw std::invalid_argument("unknown option " + argument);
+        }
+    }
+    if (options.inputs.empty()) throw std::invalid_argument("missing input path");
+    return options;
+}
+
+void writeBoxes(std::ostream& out, const std::vector<cv::Rect>& boxes) {
+    out << '[';
+    for (size_t i = 0; i < boxes.size(); ++i) {
+        if (i > 0) out << ',';
+        out << '[' << boxes[i].x << ',' << boxes[i].y << ',' << boxes[i].width << ',' << boxes[i].height << ']';
+    }
+    out << ']';
+}
+
+// <stem>.detections.jsonl, with the input position added when two inputs share a stem
+std::vector<std::string> outputPaths(const std::vector<std::string>& inputs, const std::string& outputDir) {
+    std::vector<std::string> paths;
+    std::set<std::string> used;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        std::string name = fs::path(inputs[i]).stem().string();
+        if (!used.insert(name).second) name += "_" + std::to_string(i);
+        paths.push_back((fs::path(outputDir) / (name + ".detections.jsonl")).string());
+    }
+    return paths;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    BatchOptions options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    size_t failed = 0;
+    try {
+        // Same snapshot type, keys and defaults as the live application (src/main.cpp)
+        const std::shared_ptr<const PipelineConfig> config = PipelineConfig::load(options.configPath);
+        // Info and above only: per-frame debug lines from every worker would swamp the log
+        Logger::init("info", "birds_of_play_batch.log", false);
+
+        const std::vector<std::string> inputs = OfflineBatchProcessor::expandInputs(options.inputs);
+        fs::create_directories(options.outputDir);
+        const std::vector<std::string> outputs = outputPaths(inputs, options.outputDir);
+        // One stream per file, opened with its first frame; the processor never calls the sink
+        // for one file from two threads at once
+        std::vector<std::unique_ptr<std::ofstream>> streams(inputs.size());
+
+        std::mutex printMutex;
+        size_t filesDone = 0;
+        const auto sink = [&](size_t file, const OfflineFrameDetections& frame) {
+            if (!streams[file]) {
+                streams[file] = std::make_unique<std::ofstream>(outputs[file], std::ios::trunc);
+            }
+            std::ostream& out = *streams[file];
+            // A stream that failed to open swallows the writes; done() reports the file
+            if (!out || (frame.boxes.empty() && frame.regions.empty())) return;
+            out << "{\"frame\":" << frame.frame << ",\"time\":" << frame.seconds << ",\"boxes\":";
+            writeBoxes(out, frame.boxes);
+            out << ",\"regions\":";
+            writeBoxes(out, frame.regions);
+            out << "}\n";
+        };
+        const auto done = [&](const OfflineFileSummary& summary) {
+            std::string error = summary.error;
+            if (std::unique_ptr<std::ofstream>& stream = streams[summary.index]) {
+                stream->close();
+                if (!*stream && error.empty()) error = "cannot write " + outputs[summary.index];
+                stream.reset();
+            }
+            std::lock_guard<std::mutex> lock(printMutex);
+            ++filesDone;
+            if (!error.empty()) {
+                ++failed;
+                std::printf("[%zu/%zu] %s: FAILED (%s)\n", filesDone, inputs.size(), summary.path.c_str(),
+                            error.c_str());
+                return;
+            }
+            std::printf("[%zu/%zu] %s: %lld frames in %zu segment(s), %lld with motion, %lld with regions -> %s\n",
+                        filesDone, inputs.size(), summary.path.c_str(), static_cast<long long>(summary.frames),
+                        summary.segments, static_cast<long long>(summary.motionFrames),
+                        static_cast<long long>(summary.regionFrames), outputs[summary.index].c_str());
+            std::fflush(stdout);
+        };
+
+        const auto start = std::chrono::steady_clock::now();
+        OfflineBatchProcessor processor(config, options.batch);
+        const std::vector<OfflineFileSummary> summaries = processor.run(inputs, sink, done);
+        const double elapsedSeconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        long long frames = 0;
+        long long decoded = 0;
+        for (const OfflineFileSummary& summary : summaries) {
+            frames += summary.frames;
+            decoded += summary.decodedFrames;
+        }
+        std::printf("Processed %lld frames of %zu file(s) in %.1f s: %.1f frames/s, warm-up overhead %.1f%%%s\n",
+                    frames, summaries.size(), elapsedSeconds, elapsedSeconds > 0 ? frames / elapsedSeconds : 0.0,
+                    frames > 0 ? 100.0 * static_cast<double>(decoded - frames) / frames : 0.0,
+                    failed > 0 ? (", " + std::to_string(failed) + " file(s) failed").c_str() : "");
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        spdlog::shutdown();
+        return 1;
+    }
+
+    spdlog::shutdown();
+    return failed > 0 ? 1 : 0;
+}
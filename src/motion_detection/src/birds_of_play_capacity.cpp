@@ -0,0 +1,161 @@
+/**
+ * birds_of_play_capacity: predicts what a camera stream costs this host and how many of them
+ * a processing node runs, from a short calibration of the pipeline stages (PipelineCostModel)
+ *
+ * Usage:
+ *   birds_of_play_capacity <config.yaml> [options]
+ *     --resolution WxH      Camera resolution (default 1920x1080)
+ *     --fps X               Frames processed per second (default 10)
+ *     --activity X          Share of frames with motion, 0-1 (default 0.1)
+ *     --boxes N             Motion boxes of a frame with motion (default 8)
+ *     --saves X             Frames saved per second (default 0)
+ *     --workers N           Worker cores of a node (default: the CPUs this process may use)
+ *     --devices N           OpenCL devices of a node, with compute_backend: opencl (default 1)
+ *     --target X            Utilization to fill a node to (default 0.75, the shard
+ *                           coordinator's target_utilization)
+ *     --frames N            Timed frames per stage and resolution (default 20)
+ *     --calibration FILE    Load an earlier calibration instead of calibrating
+ *     --save FILE           Write the calibration, for the coordinator or a later run
+ *
+ * The calibration runs each stage on one thread at 720p, 1080p and 4K with the config's own
+ * settings (a few seconds) and fits a line per stage; the camera's resolution is then read
+ * off those lines, so it need not be one of them. The prediction is for this host: calibrate
+ * on the hardware that will run the streams, or load the calibration it saved.
+ */
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "logger.hpp"
+#include "pipeline_config.hpp"
+#include "pipeline_cost_model.hpp"
+#include "stream_shard_coordinator.hpp"
+#include "thread_budget.hpp"
+
+namespace {
+
+struct CapacityOptions {
+    std::string configPath;
+    StreamWorkload workload;
+    size_t workers = 0;  // 0 = the CPUs this process may use
+    size_t devices = 1;
+    double targetUtilization = ShardingConfig().targetUtilization;
+    int frames = 20;
+    std::string calibrationPath;
+    std::string savePath;
+};
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <config.yaml> [--resolution WxH] [--fps X] [--activity X] [--boxes N]\n"
+              << "       [--saves X] [--workers N] [--devices N] [--target X] [--frames N]\n"
+              << "       [--calibration FILE] [--save FILE]" << std::endl;
+}
+
+CapacityOptions parseOptions(int argc, char** argv) {
+    if (argc < 2) throw std::invalid_argument("missing config path");
+    CapacityOptions options;
+    options.configPath = argv[1];
+    for (int i = 2; i < argc; ++i) {
+        const std::string flag = argv[i];
+        if (i + 1 >= argc) throw std::invalid_argument(flag + " needs a value");
+        const std::string value = argv[++i];
+        if (flag == "--resolution") {
+            int width = 0, height = 0;
+            if (std::sscanf(value.c_str(), "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+                throw std::invalid_argument("--resolution expects WxH");
+            }
+            options.workload.resolution = cv::Size(width, height);
+        } else if (flag == "--fps") {
+            options.workload.fps = std::stod(value);
+        } else if (flag == "--activity") {
+            options.workload.activity = std::stod(value);
+            if (options.workload.activity < 0.0 || options.workload.activity > 1.0) {
+                throw std::invalid_argument("--activity expects a share between 0 and 1");
+            }
+        } else if (flag == "--boxes") {
+            options.workload.boxesPerActiveFrame = std::stod(value);
+        } else if (flag == "--saves") {
+            options.workload.savedFramesPerSecond = std::stod(value);
+        } else if (flag == "--workers") {
+            options.workers = static_cast<size_t>(std::max(0, std::stoi(value)));
+        } else if (flag == "--devices") {
+            options.devices = static_cast<size_t>(std::max(0, std::stoi(value)));
+        } else if (flag == "--target") {
+            options.targetUtilization = std::stod(value);
+        } else if (flag == "--frames") {
+            options.frames = std::max(1, std::stoi(value));
+        } else if (flag == "--calibration") {
+            options.calibrationPath = value;
+        } else if (flag == "--save") {
+            options.savePath = value;
+        } else {
+            throw std::invalid_argument("unknown option " + flag);
+        }
+    }
+    return options;
+}
+
+void printStages(const PipelineCostModel& model) {
+    std::printf("Stage costs on this host (one worker):\n");
+    for (size_t i = 0; i < static_cast<size_t>(CostStage::Count); ++i) {
+        const CostStage stage = static_cast<CostStage>(i);
+        const StageCostFit& fit = model.stage(stage);
+        std::printf("  %-14s %8.3f ms + %8.3f ms/%s\n", costStageName(stage), fit.fixedMs, fit.perUnitMs,
+                    stage == CostStage::Consolidation ? "box" : "MP");
+    }
+    if (model.deviceStages()) std::printf("  (preprocess, detect and morphology run on the OpenCL device)\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    CapacityOptions options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    try {
+        Logger::init("warn", "birds_of_play_capacity.log", false);
+        PipelineCostModel model;
+        if (!options.calibrationPath.empty()) {
+            model = PipelineCostModel::load(options.calibrationPath);
+        } else {
+            CalibrationSettings settings;
+            settings.frames = options.frames;
+            std::printf("Calibrating %s at %zu resolutions...\n", options.configPath.c_str(),
+                        settings.resolutions.size());
+            model = PipelineCostModel::calibrate(PipelineConfig::load(options.configPath), settings);
+        }
+        if (!options.savePath.empty()) {
+            model.save(options.savePath);
+            std::printf("Calibration written to %s\n", options.savePath.c_str());
+        }
+        printStages(model);
+
+        const StreamWorkload& workload = options.workload;
+        const StreamCostEstimate cost = model.estimate(workload);
+        const size_t workers = options.workers > 0 ? options.workers : allowedCpus().size();
+        std::printf("\nStream of %dx%d at %.1f fps, %.0f%% of frames with motion (%.0f boxes), %.1f saves/s:\n",
+                    workload.resolution.width, workload.resolution.height, workload.fps, workload.activity * 100.0,
+                    workload.boxesPerActiveFrame, workload.savedFramesPerSecond);
+        std::printf("  CPU  %8.3f ms/frame  %6.3f cores (encoding %.3f)\n", cost.cpuMsPerFrame, cost.cpuCores,
+                    cost.encodeMsPerSecond / 1000.0);
+        if (model.deviceStages()) {
+            std::printf("  GPU  %8.3f ms/frame  %6.3f of a device\n", cost.gpuMsPerFrame, cost.gpuShare);
+        }
+        std::printf("  Max streams per node of %zu workers at %.0f%% utilization: %zu\n", workers,
+                    options.targetUtilization * 100.0,
+                    model.maxStreamsPerNode(workload, workers, options.targetUtilization, options.devices));
+        std::printf("  (shard coordinator: addStream(camera, %.3f))\n", cost.cpuCores);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
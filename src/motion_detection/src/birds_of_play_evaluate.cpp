@@ -0,0 +1,107 @@
+/**
+ * birds_of_play_evaluate: accuracy of a replay's detections against annotated ground truth
+ *
+ * Usage:
+ *   birds_of_play_evaluate <ground truth> <detections> [options]
+ *     --min-iou X        IoU a box needs with a true box to count (default 0.5)
+ *     --min-coverage X   Share of a true box a region must cover, where the ground truth
+ *                        annotates no regions (default 0.5)
+ *
+ * The detections are the JSON lines birds_of_play_replay --detections writes; the ground
+ * truth is the same format with the true boxes (or a .bobx box capture), see GroundTruth.
+ * Prints box and region precision, recall and mean overlap (IoU, or coverage for regions
+ * scored against boxes), so a faster config or build can be checked for what it misses.
+ * Annotated frames without a detection line count as frames with no detections.
+ */
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "detection_evaluator.hpp"
+
+namespace {
+
+struct EvaluateOptions {
+    std::string groundTruthPath;
+    std::string detectionsPath;
+    double minIou = 0.5;
+    double minCoverage = 0.5;
+};
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <ground truth> <detections> [--min-iou X] [--min-coverage X]"
+              << std::endl;
+}
+
+EvaluateOptions parseOptions(int argc, char** argv) {
+    if (argc < 3) throw std::invalid_argument("missing ground truth or detections path");
+    EvaluateOptions options;
+    options.groundTruthPath = argv[1];
+    options.detectionsPath = argv[2];
+    for (int i = 3; i < argc; ++i) {
+        const std::string flag = argv[i];
+        if (i + 1 >= argc) throw std::invalid_argument(flag + " needs a value");
+        const std::string value = argv[++i];
+        if (flag == "--min-iou") {
+            options.minIou = std::stod(value);
+        } else if (flag == "--min-coverage") {
+            options.minCoverage = std::stod(value);
+        } else {
+            throw std::invalid_argument("unknown option " + flag);
+        }
+    }
+    return options;
+}
+
+void printScore(const char* level, const char* overlap, const DetectionScore& score) {
+    std::printf("  %-8s recall %.3f  precision %.3f  mean %s %.3f  (%llu found, %llu missed, %llu false)\n", level,
+                score.recall(), score.precision(), overlap, score.meanOverlap(),
+                static_cast<unsigned long long>(score.truePositives),
+                static_cast<unsigned long long>(score.falseNegatives),
+                static_cast<unsigned long long>(score.falsePositives));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    EvaluateOptions options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    try {
+        const GroundTruth truth = GroundTruth::load(options.groundTruthPath);
+        const GroundTruth detections = GroundTruth::load(options.detectionsPath);
+
+        DetectionEvaluator evaluator(truth, options.minIou, options.minCoverage);
+        size_t undetected = 0;
+        bool regionsAnnotated = false;
+        for (const auto& [frame, annotation] : truth.frames()) {
+            regionsAnnotated = regionsAnnotated || annotation.regions.has_value();
+            const AnnotatedFrame* detected = detections.find(frame);
+            if (!detected) {
+                ++undetected;
+                evaluator.addFrame(frame, {}, std::vector<cv::Rect>());
+                continue;
+            }
+            evaluator.addFrame(frame, detected->boxes, detected->regions.value_or(std::vector<cv::Rect>()));
+        }
+
+        const AccuracyReport& report = evaluator.report();
+        std::printf("Scored %llu annotated frames of %s against %s", static_cast<unsigned long long>(report.frames),
+                    options.detectionsPath.c_str(), options.groundTruthPath.c_str());
+        if (undetected > 0) std::printf(" (%zu without a detection line, scored as empty)", undetected);
+        std::printf("\n");
+        printScore("boxes", "IoU", report.boxes);
+        printScore("regions", regionsAnnotated ? "IoU" : "coverage", report.regions);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,134 @@
+/**
+ * birds_of_play_frame_cache: decode a video or an image set once into a frame cache, a
+ * memory-mapped raw frame file (frame_cache_layout in replay_frame_source.hpp)
+ *
+ * Usage:
+ *   birds_of_play_frame_cache <output.bofc> <video | image directory | image>... [options]
+ *     --max-frames N    Cache at most N frames
+ *     --gray            Store single-channel frames (luma) instead of BGR
+ *
+ * A single video is decoded frame by frame; otherwise every argument is an image, or a
+ * directory whose .jpg/.jpeg/.png/.bmp files are taken in name order. All frames must share
+ * one size. birds_of_play_replay and ReplayFrameSource::fromFrameCache() then map the file
+ * and hand out cv::Mat headers onto it, so repeated test and benchmark runs measure the
+ * pipeline instead of the decoder.
+ */
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <opencv2/imgproc.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "logger.hpp"
+#include "replay_frame_source.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct CacheOptions {
+    std::string outputPath;
+    std::vector<std::string> inputs;
+    int maxFrames = -1;
+    bool gray = false;
+};
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <output.bofc> <video | image directory | image>...\n"
+              << "       [--max-frames N] [--gray]" << std::endl;
+}
+
+CacheOptions parseOptions(int argc, char** argv) {
+    if (argc < 3) throw std::invalid_argument("missing output or input path");
+    CacheOptions options;
+    options.outputPath = argv[1];
+    for (int i = 2; i < argc; ++i) {
+        const std::string argument = argv[i];
+        if (argument == "--gray") {
+            options.gray = true;
+        } else if (argument == "--max-frames") {
+            if (i + 1 >= argc) throw std::invalid_argument(argument + " needs a value");
+            options.maxFrames = std::stoi(argv[++i]);
+        } else if (argument.rfind("--", 0) == 0) {
+            throw std::invalid_argument("unknown option " + argument);
+        } else {
+            options.inputs.push_back(argument);
+        }
+    }
+    if (options.inputs.empty()) throw std::invalid_argument("missing input path");
+    return options;
+}
+
+bool isImageFile(const fs::path& path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension == ".jpg" || extension == ".jpeg" || extension == ".png" || extension == ".bmp";
+}
+
+// Images named on the command line, directories expanded in name order
+std::vector<std::string> imagePaths(const std::vector<std::string>& inputs) {
+    std::vector<std::string> paths;
+    for (const std::string& input : inputs) {
+        if (!fs::is_directory(input)) {
+            paths.push_back(input);
+            continue;
+        }
+        std::vector<std::string> images;
+        for (const auto& entry : fs::directory_iterator(input)) {
+            if (entry.is_regular_file() && isImageFile(entry.path())) images.push_back(entry.path().string());
+        }
+        if (images.empty()) throw std::invalid_argument(input + " holds no images");
+        std::sort(images.begin(), images.end());
+        paths.insert(paths.end(), images.begin(), images.end());
+    }
+    return paths;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    CacheOptions options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    try {
+        Logger::init("info", "birds_of_play_frame_cache.log", false);
+
+        const bool singleVideo = options.inputs.size() == 1 && !fs::is_directory(options.inputs[0]) &&
+                                 !isImageFile(options.inputs[0]);
+        ReplayFrameSource source = singleVideo ? ReplayFrameSource::fromVideo(options.inputs[0], options.maxFrames)
+                                               : ReplayFrameSource::fromImages(imagePaths(options.inputs));
+        const size_t frameCount = options.maxFrames >= 0
+                                      ? std::min(source.size(), static_cast<size_t>(options.maxFrames))
+                                      : source.size();
+
+        std::vector<cv::Mat> frames;
+        frames.reserve(frameCount);
+        for (size_t i = 0; i < frameCount; ++i) {
+            cv::Mat frame = source.frame(i);
+            if (options.gray && frame.channels() == 3) cv::cvtColor(frame, frame, cv::COLOR_BGR2GRAY);
+            frames.push_back(frame);
+        }
+        ReplayFrameSource::writeFrameCache(options.outputPath, frames);
+        std::printf("Cached %zu frames (%dx%d, %d channel(s)) in %s, %.1f MB\n", frames.size(),
+                    source.frameSize().width, source.frameSize().height, frames.front().channels(),
+                    options.outputPath.c_str(), static_cast<double>(fs::file_size(options.outputPath)) / (1024.0 * 1024.0));
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        spdlog::shutdown();
+        return 1;
+    }
+
+    spdlog::shutdown();
+    return 0;
+}
@@ -0,0 +1,162 @@
+/**
+ * birds_of_play_ingest: central receiver for edges running the "uplink" persistence backend
+ *
+ * Usage:
+ *   birds_of_play_ingest [config.yaml]
+ *
+ * Reads the uplink_ingest section (listen address, crop directory, threads, bulk insert
+ * size), the persistence_backend / persistence_store settings for where the documents go
+ * ("local", "sqlite", "none", or "native" in ENABLE_MONGO builds), and region_classifier:
+ * when it is enabled with uplink_ingest.classify, the crops of regions the edges left
+ * unlabelled are classified here, in batches drawn from every edge (ClassificationBatcher).
+ * With uplink_ingest.recompress_crops, JPEG crops are stored as lossless JPEG XL transcodes.
+ * Runs until SIGINT or SIGTERM; stats are logged every stats_interval_s seconds.
+ */
+#include <yaml-cpp/yaml.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "classification_batcher.hpp"
+#include "image_encoder.hpp"
+#include "logger.hpp"
+#include "persistence_backend.hpp"
+#include "region_classifier.hpp"
+#include "uplink_ingest.hpp"
+
+#if BIRDS_HAVE_MONGO
+#include "frame_store.hpp"
+#endif
+
+namespace {
+
+std::atomic<bool> shutdownRequested{false};
+
+void requestShutdown(int) { shutdownRequested = true; }
+
+UplinkIngestConfig ingestConfig(const YAML::Node& node) {
+    UplinkIngestConfig config;
+    if (!node) return config;
+    if (node["listen_address"]) config.listenAddress = node["listen_address"].as<std::string>();
+    if (node["port"]) config.port = node["port"].as<int>();
+    if (node["crop_path"]) config.cropPath = node["crop_path"].as<std::string>();
+    if (node["max_connections"]) config.maxConnections = node["max_connections"].as<size_t>();
+    if (node["max_message_kb"]) config.maxMessageBytes = node["max_message_kb"].as<size_t>() << 10;
+    if (node["decode_threads"]) config.decodeThreads = node["decode_threads"].as<size_t>();
+    if (node["queue_capacity"]) config.queueCapacity = node["queue_capacity"].as<size_t>();
+    if (node["max_batch"]) config.maxBatch = node["max_batch"].as<size_t>();
+    if (node["batch_window_ms"]) config.batchWindow = std::chrono::milliseconds(node["batch_window_ms"].as<int>());
+    if (node["recompress_crops"]) config.recompressCrops = node["recompress_crops"].as<bool>();
+    if (config.recompressCrops && !ImageEncoder::available(ImageCodec::JpegXl)) {
+        LOG_WARN("uplink_ingest.recompress_crops needs libjxl, which is not built in; crops stay JPEG");
+    }
+    return config;
+}
+
+std::unique_ptr<PersistenceBackend> makeBackend(const YAML::Node& config) {
+    const std::string name =
+        config["persistence_backend"] ? config["persistence_backend"].as<std::string>() : std::string("local");
+    if (name == "native") {
+#if BIRDS_HAVE_MONGO
+        FrameStoreConfig storeConfig;
+        if (config["mongodb_uri"]) storeConfig.uri = config["mongodb_uri"].as<std::string>();
+        if (config["database_name"]) storeConfig.databaseName = config["database_name"].as<std::string>();
+        if (config["frame_time_series"]) storeConfig.timeSeries = config["frame_time_series"].as<bool>();
+        if (config["frame_retention_days"]) storeConfig.retentionDays = config["frame_retention_days"].as<int>();
+        return std::make_unique<FrameStore>(storeConfig);
+#else
+        throw std::invalid_argument("persistence backend \"native\" needs a build with ENABLE_MONGO");
+#endif
+    }
+    if (name == "uplink" || name == "python") {
+        throw std::invalid_argument("persistence backend \"" + name + "\" cannot store ingested frames");
+    }
+    PersistenceBackendConfig backendConfig;
+    backendConfig.name = name;
+    if (const YAML::Node storeNode = config["persistence_store"]) {
+        if (storeNode["local_path"]) backendConfig.localPath = storeNode["local_path"].as<std::string>();
+        if (storeNode["local_segment_mb"]) {
+            backendConfig.localSegmentBytes = storeNode["local_segment_mb"].as<uint64_t>() << 20;
+        }
+        if (storeNode["sqlite_path"]) backendConfig.sqlitePath = storeNode["sqlite_path"].as<std::string>();
+    }
+    return makePersistenceBackend(backendConfig);
+}
+
+// The region_classifier settings classifyCrops() uses (the track cache does not apply here)
+std::unique_ptr<ClassificationBatcher> makeClassifier(const YAML::Node& config, const YAML::Node& ingestNode) {
+    const YAML::Node node = config["region_classifier"];
+    if (!ingestNode || !ingestNode["classify"] || !ingestNode["classify"].as<bool>() || !node) return nullptr;
+    RegionClassifierConfig classifierConfig;
+    classifierConfig.enabled = node["enabled"] && node["enabled"].as<bool>();
+    if (!classifierConfig.enabled) return nullptr;
+    if (node["model_path"]) classifierConfig.modelPath = node["model_path"].as<std::string>();
+    if (node["backend"]) classifierConfig.backend = node["backend"].as<std::string>();
+    if (node["input_size"]) classifierConfig.inputSize = node["input_size"].as<int>();
+    if (node["confidence_threshold"]) classifierConfig.confidenceThreshold = node["confidence_threshold"].as<float>();
+    if (node["max_batch"]) classifierConfig.maxBatch = node["max_batch"].as<int>();
+    if (node["class_names"]) classifierConfig.classNames = node["class_names"].as<std::vector<std::string>>();
+    if (node["mosaic"]) classifierConfig.mosaic.enabled = node["mosaic"].as<bool>();
+    if (node["device_preprocessing"]) classifierConfig.devicePreprocessing = node["device_preprocessing"].as<bool>();
+    const size_t maxBatch = static_cast<size_t>(std::max(1, classifierConfig.maxBatch));
+    const int delayMs = ingestNode["classify_batch_delay_ms"] ? ingestNode["classify_batch_delay_ms"].as<int>() : 5;
+    return std::make_unique<ClassificationBatcher>(std::make_unique<RegionClassifier>(classifierConfig), maxBatch,
+                                                   std::chrono::milliseconds(delayMs));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const std::string configPath = argc > 1 ? argv[1] : "config.yaml";
+    Logger::init("info", "birds_of_play_ingest.log", false);
+
+    std::unique_ptr<UplinkIngestServer> server;
+    int statsIntervalSeconds = 10;
+    try {
+        const YAML::Node config = YAML::LoadFile(configPath);
+        const YAML::Node ingestNode = config["uplink_ingest"];
+        if (ingestNode && ingestNode["stats_interval_s"]) {
+            statsIntervalSeconds = ingestNode["stats_interval_s"].as<int>();
+        }
+        std::unique_ptr<PersistenceBackend> backend = makeBackend(config);
+        if (!backend->connect()) {
+            LOG_WARN("Persistence backend {} unavailable at startup; edges spool until it is back", backend->name());
+        }
+        server = std::make_unique<UplinkIngestServer>(ingestConfig(ingestNode), std::move(backend),
+                                                      makeClassifier(config, ingestNode));
+    } catch (const std::exception& e) {
+        std::cerr << "birds_of_play_ingest: " << e.what() << std::endl;
+        return 1;
+    }
+    if (!server->start()) return 1;
+
+    std::signal(SIGINT, requestShutdown);
+    std::signal(SIGTERM, requestShutdown);
+    auto nextStats = std::chrono::steady_clock::now() + std::chrono::seconds(statsIntervalSeconds);
+    UplinkIngestStats last;
+    while (!shutdownRequested) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        if (statsIntervalSeconds <= 0 || std::chrono::steady_clock::now() < nextStats) continue;
+        nextStats += std::chrono::seconds(statsIntervalSeconds);
+        const UplinkIngestStats stats = server->stats();
+        LOG_INFO("Ingest: {} edges, {:.0f} messages/s stored ({:.1f} MB/s), {} refused, {} rejected, {} regions "
+                 "classified, {} bulk writes, {} crops recompressed ({:.1f} MB saved)",
+                 stats.activeConnections,
+                 static_cast<double>(stats.stored - last.stored) / statsIntervalSeconds,
+                 static_cast<double>(stats.bytesReceived - last.bytesReceived) / statsIntervalSeconds / 1e6,
+                 stats.failed, stats.rejected, stats.classified, stats.bulkWrites, stats.cropsRecompressed,
+                 static_cast<double>(stats.recompressionBytesSaved) / 1e6);
+        last = stats;
+    }
+    LOG_INFO("Shutdown signal received, storing what was received");
+    server->stop();
+    return 0;
+}
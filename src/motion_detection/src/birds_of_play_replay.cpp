@@ -0,0 +1,477 @@
+/**
+ * birds_of_play_replay: headless, deterministic replay of recorded footage through the
+ * detection pipeline (MotionProcessor -> ObjectTracker -> MotionRegionConsolidator)
+ *
+ * Usage:
+ *   birds_of_play_replay <config.yaml> <video | frame cache | raw dump> [options]
+ *     --raw WxH[xC]       Input is a raw frame dump of WxH frames with C channels (3 or 1)
+ *     --fps N             Pace frames at N per second (default: as fast as possible)
+ *     --max-frames N      Load at most N frames
+ *     --loops N           Replay the loaded frames N times (default 1)
+ *     --in-flight N       Overlap detection of a frame with the consolidation of the ones
+ *                         before it, N frames in flight (default 1 = one frame at a time)
+ *     --detections FILE   Write one JSON line per frame with its boxes and regions
+ *     --dump-raw FILE     Write the loaded frames as a raw dump (for later --raw runs)
+ *     --record-boxes FILE Write the first loop's motion boxes as a box capture (.bobx) for
+ *                         the tracker and consolidator benchmarks (BoxCapture)
+ *     --ground-truth FILE Score the first loop's boxes and regions against annotated boxes
+ *                         (GroundTruth) and report precision and recall next to the speed
+ *     --scaling N         Replay once per core count from 1 to N (0 = every allowed CPU), each
+ *                         run on its own ThreadBudget, and print the throughput scaling curve
+ *
+ * A frame cache (birds_of_play_frame_cache) is recognised by its header and mapped like a
+ * raw dump. Frames are loaded before the clock starts, so the report covers processing only:
+ * frames/sec, per-stage latency percentiles (finer stages too in ENABLE_STAGE_TIMING
+ * builds) and peak RSS. With --in-flight, the frame latency runs from submission to the
+ * in-order delivery of the result.
+ *
+ * A --scaling run pins the replay to the first n CPUs of the thread budget's compute
+ * partition and sizes OpenCV's pool as ThreadBudget does for the application (thread_budget:
+ * section, without the persistence and classification cores), so the curve shows where
+ * adding cores stops paying off and whether OpenCV's threads and the --in-flight workers
+ * oversubscribe them.
+ */
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "box_capture.hpp"
+#include "detection_evaluator.hpp"
+#include "logger.hpp"
+#include "motion_pipeline.hpp"
+#include "motion_processor.hpp"
+#include "motion_region_consolidator.hpp"
+#include "object_tracker.hpp"
+#include "pipeline_config.hpp"
+#include "pipelined_frame_executor.hpp"
+#include "replay_frame_source.hpp"
+#include "stage_latency_histogram.hpp"
+#include "memory_placement.hpp"
+#include "stage_timings.hpp"
+#include "thread_budget.hpp"
+#include "tracked_object_store.hpp"
+
+namespace {
+
+struct ReplayOptions {
+    std::string configPath;
+    std::string inputPath;
+    bool raw = false;
+    cv::Size rawSize;
+    int rawChannels = 3;
+    double fps = 0.0;  // 0 = unpaced
+    int maxFrames = -1;
+    int loops = 1;
+    int inFlight = 1;
+    std::string detectionsPath;
+    std::string dumpRawPath;
+    std::string recordBoxesPath;
+    std::string groundTruthPath;
+    int scalingCores = -1;  // < 0 = a single run on every core
+};
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <config.yaml> <video | frame cache | raw dump> [--raw WxH[xC]] [--fps N]\n"
+              << "       [--max-frames N] [--loops N] [--in-flight N] [--detections FILE] [--dump-raw FILE]\n"
+              << "       [--record-boxes FILE] [--ground-truth FILE] [--scaling N]" << std::endl;
+}
+
+ReplayOptions parseOptions(int argc, char** argv) {
+    if (argc < 3) throw std::invalid_argument("missing config or input path");
+    ReplayOptions options;
+    options.configPath = argv[1];
+    options.inputPath = argv[2];
+    for (int i = 3; i < argc; ++i) {
+        const std::string flag = argv[i];
+        if (i + 1 >= argc) throw std::invalid_argument(flag + " needs a value");
+        const std::string value = argv[++i];
+        if (flag == "--raw") {
+            int width = 0, height = 0, channels = 3;
+            if (std::sscanf(value.c_str(), "%dx%dx%d", &width, &height, &channels) < 2 || width <= 0 ||
+                height <= 0 || (channels != 1 && channels != 3)) {
+                throw std::invalid_argument("--raw expects WxH or WxHxC (C = 1 or 3)");
+            }
+            options.raw = true;
+            options.rawSize = cv::Size(width, height);
+            options.rawChannels = channels;
+        } else if (flag == "--fps") {
+            options.fps = std::stod(value);
+        } else if (flag == "--max-frames") {
+            options.maxFrames = std::stoi(value);
+        } else if (flag == "--loops") {
+            options.loops = std::max(1, std::stoi(value));
+        } else if (flag == "--in-flight") {
+            options.inFlight = std::max(1, std::stoi(value));
+        } else if (flag == "--detections") {
+            options.detectionsPath = value;
+        } else if (flag == "--dump-raw") {
+            options.dumpRawPath = value;
+        } else if (flag == "--record-boxes") {
+            options.recordBoxesPath = value;
+        } else if (flag == "--ground-truth") {
+            options.groundTruthPath = value;
+        } else if (flag == "--scaling") {
+            options.scalingCores = std::max(0, std::stoi(value));
+        } else {
+            throw std::invalid_argument("unknown option " + flag);
+        }
+    }
+    if (options.scalingCores >= 0 && (!options.detectionsPath.empty() || !options.recordBoxesPath.empty() ||
+                                      !options.groundTruthPath.empty())) {
+        throw std::invalid_argument(
+            "--scaling replays several times; drop --detections, --record-boxes and --ground-truth");
+    }
+    return options;
+}
+
+// Mapped sources hold every frame; --max-frames is applied when replaying them
+ReplayFrameSource loadSource(const ReplayOptions& options) {
+    if (options.raw) {
+        return ReplayFrameSource::fromRawDump(options.inputPath, options.rawSize,
+                                              options.rawChannels == 3 ? CV_8UC3 : CV_8UC1);
+    }
+    if (ReplayFrameSource::isFrameCache(options.inputPath)) {
+        return ReplayFrameSource::fromFrameCache(options.inputPath);
+    }
+    return ReplayFrameSource::fromVideo(options.inputPath, options.maxFrames);
+}
+
+void writeBoxes(std::ostream& out, const std::vector<cv::Rect>& boxes) {
+    out << '[';
+    for (size_t i = 0; i < boxes.size(); ++i) {
+        if (i > 0) out << ',';
+        out << '[' << boxes[i].x << ',' << boxes[i].y << ',' << boxes[i].width << ',' << boxes[i].height << ']';
+    }
+    out << ']';
+}
+
+void writeDetections(std::ostream& out, size_t frameIndex, const std::vector<cv::Rect>& boxes,
+                     const std::vector<ConsolidatedRegion>& regions) {
+    std::vector<cv::Rect> regionBoxes;
+    regionBoxes.reserve(regions.size());
+    for (const auto& region : regions) regionBoxes.push_back(region.boundingBox);
+    out << "{\"frame\":" << frameIndex << ",\"boxes\":";
+    writeBoxes(out, boxes);
+    out << ",\"regions\":";
+    writeBoxes(out, regionBoxes);
+    out << "}\n";
+}
+
+// Peak resident set size in bytes (ru_maxrss is KiB on Linux, bytes on macOS)
+uint64_t peakResidentBytes() {
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+void printStage(const char* name, const StageLatencyHistogram& histogram) {
+    if (histogram.count() == 0) return;
+    std::printf("  %-14s mean %9.1f us  p50 %9.1f  p95 %9.1f  p99 %9.1f  max %9.1f\n", name,
+                histogram.meanMicros(), histogram.percentileMicros(0.50), histogram.percentileMicros(0.95),
+                histogram.percentileMicros(0.99), histogram.maxMicros());
+}
+
+void printStageTimings(const StageTimings& timings) {
+    for (size_t i = 0; i < StageTimings::kStageCount; ++i) {
+        const auto stage = static_cast<PipelineStage>(i);
+        printStage(pipelineStageName(stage), timings.histogram(stage));
+    }
+}
+
+// Latencies and counts of one replay
+struct ReplayStats {
+    StageLatencyHistogram detect;
+    StageLatencyHistogram track;
+    StageLatencyHistogram consolidate;
+    StageLatencyHistogram frame;
+    size_t motionFrames = 0;
+    size_t framesReplayed = 0;
+    size_t propagatedFrames = 0;  // Followed by optical flow instead of detected (flow_propagation:)
+    double elapsedSeconds = 0.0;
+};
+
+// Output of frame number sequence (loop * framesPerLoop + index), called in order
+using FrameOutput = std::function<void(size_t sequence, const std::vector<cv::Rect>& boxes,
+                                       const std::vector<ConsolidatedRegion>& regions)>;
+
+// Replays the loaded frames options.loops times; @p objectTracker null = tracking disabled,
+// @p propagator non-null = detect-every-k with optical flow in between (one frame in flight only)
+void replayFrames(const ReplayOptions& options, const ReplayFrameSource& source, size_t framesPerLoop,
+                  MotionProcessor& motionProcessor, ObjectTracker* objectTracker,
+                  MotionRegionConsolidator& regionConsolidator, RegionFlowPropagator* propagator,
+                  const FrameOutput& output, ReplayStats& stats) {
+    TrackedObjectStore trackedObjects;
+
+    using Clock = std::chrono::steady_clock;
+    const auto framePeriod = options.fps > 0 ? std::chrono::duration_cast<Clock::duration>(
+                                                   std::chrono::duration<double>(1.0 / options.fps))
+                                             : Clock::duration::zero();
+    const Clock::time_point start = Clock::now();
+    Clock::time_point nextFrame = start;
+
+    auto recordFrame = [&](size_t sequence, const std::vector<cv::Rect>& boxes, bool hasMotion,
+                           const std::vector<ConsolidatedRegion>& regions) {
+        if (hasMotion) ++stats.motionFrames;
+        if (output) output(sequence, boxes, regions);
+        ++stats.framesReplayed;
+    };
+    auto pace = [&] {
+        if (framePeriod > Clock::duration::zero()) {
+            std::this_thread::sleep_until(nextFrame);
+            nextFrame += framePeriod;
+        }
+    };
+
+    if (options.inFlight > 1) {
+        if (propagator) LOG_WARN("flow_propagation is not applied with --in-flight; every frame is detected");
+        PipelinedFrameExecutor executor(motionProcessor, regionConsolidator, objectTracker,
+                                        static_cast<size_t>(options.inFlight));
+        auto deliver = [&](const PipelinedFrameExecutor::Result& frame) {
+            stats.detect.record(frame.detectTime);
+            stats.track.record(frame.trackTime);
+            stats.consolidate.record(frame.consolidateTime);
+            stats.frame.record(Clock::now() - frame.submitted);
+            recordFrame(frame.sequence, frame.result.detectedBounds, frame.result.hasMotion, frame.regions);
+        };
+        for (int loop = 0; loop < options.loops; ++loop) {
+            for (size_t i = 0; i < framesPerLoop; ++i) {
+                pace();
+                if (auto done = executor.push(source.frame(i))) deliver(*done);
+            }
+        }
+        while (auto done = executor.finish()) deliver(*done);
+    } else {
+        std::vector<ConsolidatedRegion> regions;
+        MotionProcessor::ProcessingResult result;
+        for (int loop = 0; loop < options.loops; ++loop) {
+            for (size_t i = 0; i < framesPerLoop; ++i) {
+                pace();
+                const Clock::time_point frameStart = Clock::now();
+                const cv::Mat frame = source.frame(i);
+                const bool propagated = propagator && !propagator->detectionDue() &&
+                                        propagator->propagate(frame, result.detectedBounds);
+                if (propagated) {
+                    result.hasMotion = !result.detectedBounds.empty();
+                    ++stats.propagatedFrames;
+                } else {
+                    result = motionProcessor.processFrame(frame);
+                    if (propagator) propagator->seed(frame, result.detectedBounds);
+                }
+                const Clock::time_point detected = Clock::now();
+
+                if (objectTracker) {
+                    objectTracker->update(result.detectedBounds, trackedObjects);
+                } else {
+                    makeTrackedObjects(result.detectedBounds, trackedObjects);
+                }
+                const Clock::time_point tracked = Clock::now();
+
+                if (propagated) {
+                    RegionFlowPropagator::moveRegions(trackedObjects, propagator->shifts(), regions);
+                } else {
+                    regions.clear();
+                    if (!trackedObjects.empty()) regions = regionConsolidator.consolidateRegions(trackedObjects);
+                }
+                const Clock::time_point consolidated = Clock::now();
+
+                stats.detect.record(detected - frameStart);
+                stats.track.record(tracked - detected);
+                stats.consolidate.record(consolidated - tracked);
+                stats.frame.record(consolidated - frameStart);
+                recordFrame(stats.framesReplayed, result.detectedBounds, result.hasMotion, regions);
+            }
+        }
+    }
+    stats.elapsedSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// --scaling: the same replay on 1, 2, ... N cores, a fresh pipeline and thread budget per run
+void runScaling(const ReplayOptions& options, const std::shared_ptr<const PipelineConfig>& config,
+                const ReplayFrameSource& source, size_t framesPerLoop) {
+    const std::vector<int> cpus = allowedCpus();
+    const size_t maxCores = options.scalingCores > 0
+                                ? std::min(cpus.size(), static_cast<size_t>(options.scalingCores))
+                                : cpus.size();
+    // The replay persists and classifies nothing: every core of a run is a compute core
+    ThreadBudgetSettings settings = config->threadBudget;
+    settings.persistenceCores = 0;
+    settings.classificationCores = 0;
+    // With frames in flight, detection runs next to tracking and consolidation
+    const size_t workers = options.inFlight > 1 ? 2 : 1;
+
+    std::printf("Scaling of %zu frames x %d loops of %dx%d, %zu worker(s):\n", framesPerLoop, options.loops,
+                source.frameSize().width, source.frameSize().height, workers);
+    std::printf("  cores  opencv threads   frames/s  speedup  efficiency\n");
+    double baselineFps = 0.0;
+    // Ascending: OpenCV pool threads created by an earlier, smaller run keep a mask that is
+    // a subset of the current one, so no run ever spreads beyond its budget
+    for (size_t cores = 1; cores <= maxCores; ++cores) {
+        settings.cores = static_cast<int>(cores);
+        const ThreadBudget budget = ThreadBudget::plan(settings, workers, cpus);
+        // Threads started from here on (the executor's, OpenCV's pool) inherit the mask
+        if (!pinCurrentThread(budget.computeCpus)) LOG_WARN("Scaling: could not pin the replay to {} CPUs", cores);
+        applyOpenCvThreads(budget);
+
+        MotionProcessor motionProcessor(config);
+        motionProcessor.enableVisualization(false);
+        motionProcessor.setVisualizationPath("");
+        motionProcessor.setRetainedStages(MotionProcessor::STAGE_NONE);
+        ConsolidationConfig consolidationConfig = config->consolidation;
+        consolidationConfig.frameSize = source.frameSize();
+        MotionRegionConsolidator regionConsolidator(consolidationConfig);
+        ObjectTracker objectTracker(config->tracker);
+
+        RegionFlowPropagator propagator(config->flowPropagation);
+
+        ReplayStats stats;
+        replayFrames(options, source, framesPerLoop, motionProcessor,
+                     config->trackerEnabled ? &objectTracker : nullptr, regionConsolidator,
+                     config->flowPropagation.enabled ? &propagator : nullptr, nullptr, stats);
+        const double fps = stats.elapsedSeconds > 0 ? stats.framesReplayed / stats.elapsedSeconds : 0.0;
+        if (cores == 1) baselineFps = fps;
+        const double speedup = baselineFps > 0 ? fps / baselineFps : 0.0;
+        std::printf("  %5zu  %14d  %9.1f  %6.2fx  %9.0f%%\n", cores, budget.opencvThreads, fps, speedup,
+                    100.0 * speedup / static_cast<double>(cores));
+    }
+    pinCurrentThread(cpus);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    ReplayOptions options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    try {
+        // Same snapshot type, keys and defaults as the live application (src/main.cpp)
+        const std::shared_ptr<const PipelineConfig> config = PipelineConfig::load(options.configPath);
+        // Info and above only: per-frame debug lines would end up in the measurement
+        Logger::init("info", "birds_of_play_replay.log", false);
+
+        // Load every frame before timing starts
+        ReplayFrameSource source = loadSource(options);
+        if (!options.dumpRawPath.empty()) {
+            std::vector<cv::Mat> frames;
+            for (size_t i = 0; i < source.size(); ++i) frames.push_back(source.frame(i));
+            ReplayFrameSource::writeRawDump(options.dumpRawPath, frames);
+            std::printf("Wrote %zu frames to %s (replay with --raw %dx%dx%d)\n", frames.size(),
+                        options.dumpRawPath.c_str(), source.frameSize().width, source.frameSize().height,
+                        CV_MAT_CN(source.frameType()));
+        }
+        const size_t framesPerLoop = source.isMapped() && options.maxFrames >= 0
+                                         ? std::min(source.size(), static_cast<size_t>(options.maxFrames))
+                                         : source.size();
+        if (options.scalingCores >= 0) {
+            runScaling(options, config, source, framesPerLoop);
+            spdlog::shutdown();
+            return 0;
+        }
+
+        MotionProcessor motionProcessor(config);
+        motionProcessor.enableVisualization(false);
+        motionProcessor.setVisualizationPath("");
+        motionProcessor.setRetainedStages(MotionProcessor::STAGE_NONE);
+        ConsolidationConfig consolidationConfig = config->consolidation;
+        consolidationConfig.frameSize = source.frameSize();
+        MotionRegionConsolidator regionConsolidator(consolidationConfig);
+        const bool trackerEnabled = config->trackerEnabled;
+        ObjectTracker objectTracker(config->tracker);
+
+        std::ofstream detections;
+        if (!options.detectionsPath.empty()) {
+            detections.open(options.detectionsPath, std::ios::trunc);
+            if (!detections) throw std::runtime_error("Cannot write " + options.detectionsPath);
+        }
+        std::unique_ptr<BoxCaptureWriter> boxCapture;
+        if (!options.recordBoxesPath.empty()) {
+            boxCapture = std::make_unique<BoxCaptureWriter>(options.recordBoxesPath, source.frameSize());
+        }
+        GroundTruth truth;
+        std::unique_ptr<DetectionEvaluator> evaluator;
+        if (!options.groundTruthPath.empty()) {
+            truth = GroundTruth::load(options.groundTruthPath);
+            evaluator = std::make_unique<DetectionEvaluator>(truth);
+        }
+
+        ReplayStats stats;
+        auto output = [&](size_t sequence, const std::vector<cv::Rect>& boxes,
+                          const std::vector<ConsolidatedRegion>& regions) {
+            if (detections.is_open()) writeDetections(detections, sequence, boxes, regions);
+            // Frame position as the timestamp: replays are not paced like a camera
+            const auto i = static_cast<int64_t>(sequence % framesPerLoop);
+            if (boxCapture && sequence < framesPerLoop) boxCapture->append(i, i, boxes);
+            if (evaluator && sequence < framesPerLoop) evaluator->addFrame(i, boxes, regions);
+        };
+        RegionFlowPropagator propagator(config->flowPropagation);
+        replayFrames(options, source, framesPerLoop, motionProcessor, trackerEnabled ? &objectTracker : nullptr,
+                     regionConsolidator, config->flowPropagation.enabled ? &propagator : nullptr, output, stats);
+        const double elapsedSeconds = stats.elapsedSeconds;
+        const size_t framesReplayed = stats.framesReplayed;
+        if (boxCapture) {
+            if (!boxCapture->close()) throw std::runtime_error("Cannot write " + options.recordBoxesPath);
+            std::printf("Wrote %llu frames with %llu boxes to %s\n",
+                        static_cast<unsigned long long>(boxCapture->frames()),
+                        static_cast<unsigned long long>(boxCapture->boxes()), options.recordBoxesPath.c_str());
+        }
+
+        std::printf("Replayed %zu frames (%zu x %d loops) of %dx%d in %.3f s: %.1f frames/s%s%s\n", framesReplayed,
+                    framesPerLoop, options.loops, source.frameSize().width, source.frameSize().height,
+                    elapsedSeconds, elapsedSeconds > 0 ? framesReplayed / elapsedSeconds : 0.0,
+                    options.fps > 0 ? " (paced)" : "",
+                    options.inFlight > 1 ? (" (" + std::to_string(options.inFlight) + " in flight)").c_str() : "");
+        std::printf("Frames with motion: %zu | source %s, %zu MB | peak RSS %.1f MB\n", stats.motionFrames,
+                    source.isMapped() ? "mapped raw dump" : "decoded video", source.byteSize() >> 20,
+                    static_cast<double>(peakResidentBytes()) / (1024.0 * 1024.0));
+        if (config->flowPropagation.enabled && options.inFlight == 1) {
+            std::printf("Flow propagation: %zu of %zu frames followed by optical flow, %llu confidence drops\n",
+                        stats.propagatedFrames, framesReplayed,
+                        static_cast<unsigned long long>(propagator.stats().confidenceDrops));
+        }
+        if (evaluator) {
+            const AccuracyReport& accuracy = evaluator->report();
+            std::printf("Accuracy on %llu annotated frames: boxes recall %.3f precision %.3f IoU %.3f | regions "
+                        "recall %.3f precision %.3f\n",
+                        static_cast<unsigned long long>(accuracy.frames), accuracy.boxes.recall(),
+                        accuracy.boxes.precision(), accuracy.boxes.meanOverlap(), accuracy.regions.recall(),
+                        accuracy.regions.precision());
+        }
+        std::printf("Stage latencies:\n");
+        printStage("frame", stats.frame);
+        printStage("detect", stats.detect);
+        printStage("track", stats.track);
+        printStage("consolidate", stats.consolidate);
+        if (StageTimings::kEnabled) {
+            std::printf("Detection stages:\n");
+            printStageTimings(motionProcessor.getStageTimings());
+            printStageTimings(regionConsolidator.getStageTimings());
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        spdlog::shutdown();
+        return 1;
+    }
+
+    spdlog::shutdown();
+    return 0;
+}
@@ -0,0 +1,508 @@
+/**
+ * birds_of_play_soak: long-run leak and memory-budget test of the detection pipeline
+ * (MotionProcessor -> ObjectTracker -> MotionRegionConsolidator), at maximum speed
+ *
+ * Usage:
+ *   birds_of_play_soak <config.yaml> [video | frame cache | raw dump] [options]
+ *     --raw WxH[xC]                 Input is a raw frame dump of WxH frames with C channels (3 or 1)
+ *     --synthetic WxH               Frame size of the synthetic scene used without an input (default 640x480)
+ *     --birds N                     Birds crossing the synthetic scene at a time (default 4)
+ *     --duration SECONDS            Run time (default 3600)
+ *     --frames N                    Stop after N frames even if time is left
+ *     --warmup-frames N             Frames before measuring starts (default 1000)
+ *     --sample-every N              Frames between memory samples (default 100)
+ *     --report-every SECONDS        Progress line interval (default 60)
+ *     --max-allocs-per-frame N      Budget: mean steady-state heap allocations per frame
+ *     --max-rss-slope-mb-per-hour N Budget: slope of the resident set over the run
+ *     --max-live-allocs-per-kframe N
+ *                                   Budget: growth of unfreed allocations per 1000 frames
+ *     --python                      Build a save document as Python objects for every frame
+ *                                   with regions and pass it to a sink, like the "python"
+ *                                   persistence backend does per save
+ *     --python-sink MODULE:FUNCTION Sink of those documents (default json:dumps)
+ *     --max-python-blocks-per-kframe N
+ *                                   Budget: growth of Python allocated blocks per 1000 frames
+ *
+ * Without an input a synthetic scene is rendered: birds fly across a gradient, one after
+ * the other, so the tracker keeps creating objects with new IDs the way a feeder does over
+ * weeks. Inputs are replayed in a loop until the time is up.
+ *
+ * Heap allocations are counted by replacing operator new (allocation_counter.cpp) plus a
+ * counting cv::Mat allocator; the harness's own frame rendering and sampling are excluded,
+ * and ENABLE_ALLOCATION_COUNTING builds also break the steady-state allocations down by
+ * pipeline stage. The resident set is sampled every --sample-every frames after warm-up
+ * and its least-squares slope is the growth rate; unfreed allocations and Python's
+ * allocated blocks (sys.getallocatedblocks(), plus sys.gettotalrefcount() in debug builds
+ * of Python) are fitted the same way.
+ *
+ * Exit status: 0 within every budget, 3 when a budget is exceeded, 1 on errors, 2 on usage.
+ */
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <pybind11/embed.h>
+
+#include "allocation_counter.hpp"
+#include "logger.hpp"
+#include "motion_pipeline.hpp"
+#include "motion_processor.hpp"
+#include "motion_region_consolidator.hpp"
+#include "object_tracker.hpp"
+#include "pipeline_config.hpp"
+#include "replay_frame_source.hpp"
+#include "tracked_object_store.hpp"
+
+namespace py = pybind11;
+
+namespace {
+
+struct SoakOptions {
+    std::string configPath;
+    std::string inputPath;  // Empty = synthetic scene
+    bool raw = false;
+    cv::Size rawSize;
+    int rawChannels = 3;
+    cv::Size syntheticSize{640, 480};
+    int birds = 4;
+    double durationSeconds = 3600.0;
+    int64_t maxFrames = -1;
+    int64_t warmupFrames = 1000;
+    int64_t sampleEvery = 100;
+    double reportEverySeconds = 60.0;
+    // Budgets; negative = not checked
+    double maxAllocsPerFrame = -1.0;
+    double maxRssSlopeMbPerHour = -1.0;
+    double maxLiveAllocsPerKframe = -1.0;
+    bool python = false;
+    std::string pythonSink = "json:dumps";
+    double maxPythonBlocksPerKframe = -1.0;
+};
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <config.yaml> [video | frame cache | raw dump] [--raw WxH[xC]]\n"
+              << "       [--synthetic WxH] [--birds N] [--duration SECONDS] [--frames N] [--warmup-frames N]\n"
+              << "       [--sample-every N] [--report-every SECONDS] [--max-allocs-per-frame N]\n"
+              << "       [--max-rss-slope-mb-per-hour N] [--max-live-allocs-per-kframe N] [--python]\n"
+              << "       [--python-sink MODULE:FUNCTION] [--max-python-blocks-per-kframe N]" << std::endl;
+}
+
+SoakOptions parseOptions(int argc, char** argv) {
+    if (argc < 2) throw std::invalid_argument("missing config path");
+    SoakOptions options;
+    options.configPath = argv[1];
+    int i = 2;
+    if (i < argc && std::string(argv[i]).rfind("--", 0) != 0) options.inputPath = argv[i++];
+    for (; i < argc; ++i) {
+        const std::string flag = argv[i];
+        if (flag == "--python") {
+            options.python = true;
+            continue;
+        }
+        if (i + 1 >= argc) throw std::invalid_argument(flag + " needs a value");
+        const std::string value = argv[++i];
+        if (flag == "--raw") {
+            int width = 0, height = 0, channels = 3;
+            if (std::sscanf(value.c_str(), "%dx%dx%d", &width, &height, &channels) < 2 || width <= 0 ||
+                height <= 0 || (channels != 1 && channels != 3)) {
+                throw std::invalid_argument("--raw expects WxH or WxHxC (C = 1 or 3)");
+            }
+            options.raw = true;
+            options.rawSize = cv::Size(width, height);
+            options.rawChannels = channels;
+        } else if (flag == "--synthetic") {
+            int width = 0, height = 0;
+            if (std::sscanf(value.c_str(), "%dx%d", &width, &height) != 2 || width < 64 || height < 64) {
+                throw std::invalid_argument("--synthetic expects WxH of at least 64x64");
+            }
+            options.syntheticSize = cv::Size(width, height);
+        } else if (flag == "--birds") {
+            options.birds = std::max(1, std::stoi(value));
+        } else if (flag == "--duration") {
+            options.durationSeconds = std::stod(value);
+        } else if (flag == "--frames") {
+            options.maxFrames = std::stoll(value);
+        } else if (flag == "--warmup-frames") {
+            options.warmupFrames = std::max<int64_t>(0, std::stoll(value));
+        } else if (flag == "--sample-every") {
+            options.sampleEvery = std::max<int64_t>(1, std::stoll(value));
+        } else if (flag == "--report-every") {
+            options.reportEverySeconds = std::stod(value);
+        } else if (flag == "--max-allocs-per-frame") {
+            options.maxAllocsPerFrame = std::stod(value);
+        } else if (flag == "--max-rss-slope-mb-per-hour") {
+            options.maxRssSlopeMbPerHour = std::stod(value);
+        } else if (flag == "--max-live-allocs-per-kframe") {
+            options.maxLiveAllocsPerKframe = std::stod(value);
+        } else if (flag == "--python-sink") {
+            if (value.find(':') == std::string::npos) {
+                throw std::invalid_argument("--python-sink expects MODULE:FUNCTION");
+            }
+            options.pythonSink = value;
+        } else if (flag == "--max-python-blocks-per-kframe") {
+            options.maxPythonBlocksPerKframe = std::stod(value);
+        } else {
+            throw std::invalid_argument("unknown option " + flag);
+        }
+    }
+    if (options.raw && options.inputPath.empty()) throw std::invalid_argument("--raw needs an input path");
+    return options;
+}
+
+// Birds crossing a static gradient left to right, each on its own schedule; a bird that
+// leaves is replaced by a new one at another height, so tracker IDs keep increasing
+class SyntheticScene {
+   public:
+    SyntheticScene(cv::Size size, int birds) : size_(size), birds_(birds) {
+        background_.create(size, CV_8UC3);
+        for (int y = 0; y < size.height; ++y) {
+            const auto shade = static_cast<uchar>(90 + 100 * y / size.height);
+            background_.row(y).setTo(cv::Scalar(shade + 20, shade + 10, shade));
+        }
+    }
+
+    // Frame @p index into @p frame, reusing its buffer
+    void render(uint64_t index, cv::Mat& frame) const {
+        background_.copyTo(frame);
+        const int64_t period = size_.width / kSpeed + kGapFrames;
+        for (int bird = 0; bird < birds_; ++bird) {
+            const int64_t shifted = static_cast<int64_t>(index) + bird * period / birds_;
+            const int64_t flight = shifted / period;
+            const int64_t t = shifted % period;
+            if (t >= size_.width / kSpeed) continue;  // Between two birds on this lane
+            // Height and size vary per flight (a cheap integer hash, deterministic across runs)
+            const uint32_t hash = static_cast<uint32_t>((flight * 2654435761u) ^ (bird * 40503u));
+            const int height = 12 + static_cast<int>(hash % 20);
+            const int width = height * 3 / 2;
+            const int y = static_cast<int>((hash >> 8) % static_cast<uint32_t>(size_.height - height));
+            const int x = static_cast<int>(t * kSpeed) - width / 2;
+            cv::rectangle(frame, cv::Rect(x, y, width, height), cv::Scalar(30, 25, 20), cv::FILLED);
+        }
+    }
+
+   private:
+    static constexpr int kSpeed = 6;        // Pixels per frame
+    static constexpr int kGapFrames = 45;   // Empty frames between two birds of a lane
+
+    cv::Size size_;
+    int birds_;
+    cv::Mat background_;
+};
+
+// Current resident set size in bytes (peak where the current one is not available)
+uint64_t residentBytes() {
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    uint64_t sizePages = 0, residentPages = 0;
+    if (statm >> sizePages >> residentPages) {
+        return residentPages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    }
+#endif
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+// Least-squares slope of y over x; 0 with fewer than two distinct x
+double slope(const std::vector<double>& x, const std::vector<double>& y) {
+    const size_t n = std::min(x.size(), y.size());
+    if (n < 2) return 0.0;
+    double meanX = 0.0, meanY = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        meanX += x[i];
+        meanY += y[i];
+    }
+    meanX /= n;
+    meanY /= n;
+    double covariance = 0.0, variance = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        covariance += (x[i] - meanX) * (y[i] - meanY);
+        variance += (x[i] - meanX) * (x[i] - meanX);
+    }
+    return variance > 0.0 ? covariance / variance : 0.0;
+}
+
+// The embedded interpreter and the save documents handed to it
+class PythonSoak {
+   public:
+    explicit PythonSoak(const std::string& sink) {
+        const size_t colon = sink.find(':');
+        sink_ = py::module_::import(sink.substr(0, colon).c_str()).attr(sink.substr(colon + 1).c_str());
+        sys_ = py::module_::import("sys");
+        gc_ = py::module_::import("gc");
+        hasTotalRefcount_ = py::hasattr(sys_, "gettotalrefcount");
+    }
+
+    // The document of a save: what MongoFrameSession builds from a StoredFrameRecord
+    void save(uint64_t frameIndex, const std::vector<ConsolidatedRegion>& regions) {
+        py::dict document;
+        document["uuid"] = "soak-" + std::to_string(frameIndex);
+        document["original_image_path"] = py::none();
+        py::list regionList;
+        for (const auto& region : regions) {
+            py::dict entry;
+            entry["box"] = py::make_tuple(region.boundingBox.x, region.boundingBox.y, region.boundingBox.width,
+                                          region.boundingBox.height);
+            py::list ids;
+            for (const int id : region.trackedObjectIds) ids.append(id);
+            entry["tracked_object_ids"] = ids;
+            regionList.append(entry);
+        }
+        document["consolidated_regions"] = regionList;
+        sink_(document);
+    }
+
+    double allocatedBlocks() const { return sys_.attr("getallocatedblocks")().cast<double>(); }
+    double gcObjects() const { return static_cast<double>(py::len(gc_.attr("get_objects")())); }
+    // -1 outside debug builds of Python
+    double totalRefcount() const {
+        return hasTotalRefcount_ ? sys_.attr("gettotalrefcount")().cast<double>() : -1.0;
+    }
+
+   private:
+    py::object sink_;
+    py::module_ sys_;
+    py::module_ gc_;
+    bool hasTotalRefcount_ = false;
+};
+
+struct Samples {
+    std::vector<double> frames;
+    std::vector<double> hours;
+    std::vector<double> rssMb;
+    std::vector<double> liveAllocations;
+    std::vector<double> pythonBlocks;
+    std::vector<double> pythonObjects;
+    std::vector<double> pythonRefcount;
+};
+
+bool checkBudget(const char* name, double value, double budget, const char* unit) {
+    if (budget < 0.0) {
+        std::printf("  %-30s %12.2f %s\n", name, value, unit);
+        return true;
+    }
+    const bool ok = value <= budget;
+    std::printf("  %-30s %12.2f %s (budget %.2f) %s\n", name, value, unit, budget, ok ? "ok" : "EXCEEDED");
+    return ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    SoakOptions options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    bool withinBudget = true;
+    try {
+        AllocationCounter::countMatAllocations();
+        const std::shared_ptr<const PipelineConfig> config = PipelineConfig::load(options.configPath);
+        // Warnings only: a log line per frame for hours would measure spdlog
+        Logger::init("warn", "birds_of_play_soak.log", false);
+
+        std::optional<ReplayFrameSource> source;
+        std::optional<SyntheticScene> scene;
+        cv::Size frameSize = options.syntheticSize;
+        if (options.inputPath.empty()) {
+            scene.emplace(options.syntheticSize, options.birds);
+        } else if (options.raw) {
+            source = ReplayFrameSource::fromRawDump(options.inputPath, options.rawSize,
+                                                    options.rawChannels == 3 ? CV_8UC3 : CV_8UC1);
+        } else if (ReplayFrameSource::isFrameCache(options.inputPath)) {
+            source = ReplayFrameSource::fromFrameCache(options.inputPath);
+        } else {
+            source = ReplayFrameSource::fromVideo(options.inputPath);
+        }
+        if (source) {
+            if (source->size() == 0) throw std::runtime_error("No frames in " + options.inputPath);
+            frameSize = source->frameSize();
+        }
+
+        std::optional<py::scoped_interpreter> interpreter;
+        std::unique_ptr<PythonSoak> python;
+        if (options.python) {
+            interpreter.emplace();
+            python = std::make_unique<PythonSoak>(options.pythonSink);
+        }
+
+        MotionProcessor motionProcessor(config);
+        motionProcessor.enableVisualization(false);
+        motionProcessor.setVisualizationPath("");
+        motionProcessor.setRetainedStages(MotionProcessor::STAGE_NONE);
+        ConsolidationConfig consolidationConfig = config->consolidation;
+        consolidationConfig.frameSize = frameSize;
+        MotionRegionConsolidator regionConsolidator(consolidationConfig);
+        const bool trackerEnabled = config->trackerEnabled;
+        ObjectTracker objectTracker(config->tracker);
+        TrackedObjectStore trackedObjects;
+        std::vector<ConsolidatedRegion> regions;
+
+        using Clock = std::chrono::steady_clock;
+        const Clock::time_point start = Clock::now();
+        const Clock::time_point deadline = start + std::chrono::duration_cast<Clock::duration>(
+                                                       std::chrono::duration<double>(options.durationSeconds));
+        Clock::time_point nextReport = start;
+        const auto reportInterval = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(std::max(1.0, options.reportEverySeconds)));
+
+        Samples samples;
+        cv::Mat synthetic;
+        uint64_t frames = 0;
+        uint64_t motionFrames = 0;
+        uint64_t harnessAllocations = 0;  // Rendering and sampling, subtracted from the pipeline's count
+        AllocationCounts warm;            // Counts when warm-up ended
+        StageAllocations warmStages{};
+        uint64_t harnessAtWarm = 0;
+        AllocationCounts lastReport = AllocationCounter::snapshot();
+        uint64_t framesAtLastReport = 0;
+
+        auto sample = [&] {
+            const AllocationCounts before = AllocationCounter::snapshot();
+            samples.frames.push_back(static_cast<double>(frames));
+            samples.hours.push_back(std::chrono::duration<double, std::ratio<3600>>(Clock::now() - start).count());
+            samples.rssMb.push_back(static_cast<double>(residentBytes()) / (1024.0 * 1024.0));
+            samples.liveAllocations.push_back(static_cast<double>(before.live()));
+            if (python) {
+                samples.pythonBlocks.push_back(python->allocatedBlocks());
+                samples.pythonObjects.push_back(python->gcObjects());
+                samples.pythonRefcount.push_back(python->totalRefcount());
+            }
+            harnessAllocations += (AllocationCounter::snapshot() - before).allocations;
+        };
+
+        if (options.warmupFrames == 0) {
+            warm = AllocationCounter::snapshot();
+            warmStages = AllocationCounter::stages();
+            sample();
+        }
+        while (Clock::now() < deadline &&
+               (options.maxFrames < 0 || static_cast<int64_t>(frames) < options.maxFrames)) {
+            const AllocationCounts beforeFrame = AllocationCounter::snapshot();
+            if (scene) scene->render(frames, synthetic);
+            const cv::Mat frame = scene ? synthetic : source->frame(frames % source->size());
+            harnessAllocations += (AllocationCounter::snapshot() - beforeFrame).allocations;
+
+            MotionProcessor::ProcessingResult result = motionProcessor.processFrame(frame);
+            if (trackerEnabled) {
+                objectTracker.update(result.detectedBounds, trackedObjects);
+            } else {
+                makeTrackedObjects(result.detectedBounds, trackedObjects);
+            }
+            regions.clear();
+            if (!trackedObjects.empty()) regions = regionConsolidator.consolidateRegions(trackedObjects);
+            if (result.hasMotion) ++motionFrames;
+            if (python && !regions.empty()) python->save(frames, regions);
+            ++frames;
+
+            if (static_cast<int64_t>(frames) == options.warmupFrames) {
+                warm = AllocationCounter::snapshot();
+                warmStages = AllocationCounter::stages();
+                harnessAtWarm = harnessAllocations;
+            }
+            if (static_cast<int64_t>(frames) >= options.warmupFrames &&
+                (static_cast<int64_t>(frames) - options.warmupFrames) % options.sampleEvery == 0) {
+                sample();
+            }
+            const Clock::time_point now = Clock::now();
+            if (now >= nextReport) {
+                const AllocationCounts counts = AllocationCounter::snapshot();
+                const uint64_t harnessBefore = harnessAllocations;
+                const uint64_t interval = frames - framesAtLastReport;
+                std::printf("[%8.1f s] %10llu frames | %7.1f frames/s | RSS %8.1f MB | %8.1f allocs/frame | "
+                            "live %10lld | tracks %4zu | regions %3zu\n",
+                            std::chrono::duration<double>(now - start).count(),
+                            static_cast<unsigned long long>(frames),
+                            frames / std::max(1e-9, std::chrono::duration<double>(now - start).count()),
+                            static_cast<double>(residentBytes()) / (1024.0 * 1024.0),
+                            interval > 0 ? static_cast<double>((counts - lastReport).allocations) / interval : 0.0,
+                            static_cast<long long>(counts.live()), objectTracker.trackCount(),
+                            regionConsolidator.getCurrentRegions().size());
+                std::fflush(stdout);
+                lastReport = AllocationCounter::snapshot();
+                harnessAllocations = harnessBefore + (lastReport - counts).allocations;
+                framesAtLastReport = frames;
+                nextReport = now + reportInterval;
+            }
+        }
+        const double elapsedSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+        const AllocationCounts end = AllocationCounter::snapshot();
+
+        size_t regionIds = 0;
+        for (const auto& region : regionConsolidator.getCurrentRegions()) regionIds += region.trackedObjectIds.size();
+        std::printf("Soaked %llu frames of %dx%d (%s) in %.1f s: %.1f frames/s, %llu with motion\n",
+                    static_cast<unsigned long long>(frames), frameSize.width, frameSize.height,
+                    scene ? "synthetic" : options.inputPath.c_str(), elapsedSeconds,
+                    elapsedSeconds > 0 ? frames / elapsedSeconds : 0.0,
+                    static_cast<unsigned long long>(motionFrames));
+        std::printf("Final state: %zu live tracks | %zu regions holding %zu object IDs | %lld unfreed allocations\n",
+                    objectTracker.trackCount(), regionConsolidator.getCurrentRegions().size(), regionIds,
+                    static_cast<long long>(end.live()));
+
+        if (static_cast<int64_t>(frames) <= options.warmupFrames || samples.frames.size() < 2) {
+            std::printf("Too few frames after the %lld warm-up frames to measure; budgets not checked\n",
+                        static_cast<long long>(options.warmupFrames));
+        } else {
+            const uint64_t steadyFrames = frames - static_cast<uint64_t>(options.warmupFrames);
+            const uint64_t steadyAllocations = (end - warm).allocations - (harnessAllocations - harnessAtWarm);
+            std::printf("Steady state (%llu frames, %zu samples):\n", static_cast<unsigned long long>(steadyFrames),
+                        samples.frames.size());
+            withinBudget &= checkBudget("allocations per frame",
+                                        static_cast<double>(steadyAllocations) / steadyFrames,
+                                        options.maxAllocsPerFrame, "");
+            std::printf("  %-30s %12.1f bytes\n", "allocated per frame",
+                        static_cast<double>((end - warm).bytes) / steadyFrames);
+            if (AllocationCounter::kStageAttribution) {
+                std::printf("  by stage: %s\n",
+                            AllocationCounter::describe(warmStages, AllocationCounter::stages()).c_str());
+            }
+            withinBudget &= checkBudget("RSS slope", slope(samples.hours, samples.rssMb),
+                                        options.maxRssSlopeMbPerHour, "MB/hour");
+            withinBudget &= checkBudget("unfreed allocation growth",
+                                        1000.0 * slope(samples.frames, samples.liveAllocations),
+                                        options.maxLiveAllocsPerKframe, "per 1000 frames");
+            if (python) {
+                withinBudget &= checkBudget("Python block growth",
+                                            1000.0 * slope(samples.frames, samples.pythonBlocks),
+                                            options.maxPythonBlocksPerKframe, "per 1000 frames");
+                std::printf("  %-30s %12.2f per 1000 frames\n", "Python gc object growth",
+                            1000.0 * slope(samples.frames, samples.pythonObjects));
+                if (samples.pythonRefcount.back() >= 0.0) {
+                    std::printf("  %-30s %12.2f per 1000 frames\n", "Python total refcount growth",
+                                1000.0 * slope(samples.frames, samples.pythonRefcount));
+                }
+            }
+        }
+        python.reset();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        spdlog::shutdown();
+        return 1;
+    }
+
+    spdlog::shutdown();
+    if (!withinBudget) {
+        std::printf("Soak FAILED: a memory budget was exceeded\n");
+        return 3;
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include "block_motion_map.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <opencv2/core/hal/intrin.hpp>
+
+namespace {
+
+// Adds each block's SAD over one row to @p sums and moves the row's background towards it.
+// Up and down steps are shifted separately, so both directions round towards the background
+void sadUpdateRow(const uchar* in, ushort* bg, int cols, int blockSize, int shift, uint32_t* sums) {
+    for (int start = 0, block = 0; start < cols; start += blockSize, ++block) {
+        const int end = std::min(cols, start + blockSize);
+        uint32_t sum = 0;
+        int x = start;
+#if CV_SIMD128
+        const cv::v_uint16x8 half = cv::v_setall_u16(128);
+        for (; x + cv::v_uint8x16::nlanes <= end; x += cv::v_uint8x16::nlanes) {
+            const cv::v_uint8x16 pixels = cv::v_load(in + x);
+            cv::v_uint16x8 low = cv::v_load(bg + x);
+            cv::v_uint16x8 high = cv::v_load(bg + x + cv::v_uint16x8::nlanes);
+            // Saturating 16-bit arithmetic: one of the two steps is always zero
+            const cv::v_uint8x16 reference = cv::v_pack((low + half) >> 8, (high + half) >> 8);
+            sum += cv::v_reduce_sad(pixels, reference);
+
+            cv::v_uint16x8 inLow, inHigh;
+            cv::v_expand(pixels, inLow, inHigh);
+            inLow = inLow << 8;
+            inHigh = inHigh << 8;
+            low = low + ((inLow - low) >> shift) - ((low - inLow) >> shift);
+            high = high + ((inHigh - high) >> shift) - ((high - inHigh) >> shift);
+            cv::v_store(bg + x, low);
+            cv::v_store(bg + x + cv::v_uint16x8::nlanes, high);
+        }
+#endif
+        for (; x < end; ++x) {
+            const int value = bg[x];
+            const int target = in[x] << 8;
+            sum += static_cast<uint32_t>(std::abs(in[x] - ((value + 128) >> 8)));
+            const int up = std::max(0, target - value) >> shift;
+            const int down = std::max(0, value - target) >> shift;
+            bg[x] = static_cast<ushort>(value + up - down);
+        }
+        sums[block] += sum;
+    }
+}
+
+}  // namespace
+
+BlockMotionMap::BlockMotionMap(int blockSize, int history)
+    : blockSize_(std::max(1, blockSize)),
+      // Same rounding as the RUNNING_AVERAGE background model; at most 10 keeps small
+      // differences reaching the 8.8 background
+      shift_(std::clamp(static_cast<int>(std::lround(std::log2(std::max(2, history)))), 1, 10)) {}
+
+cv::Size BlockMotionMap::gridSize(const cv::Size& frameSize) const {
+    return cv::Size((frameSize.width + blockSize_ - 1) / blockSize_,
+                    (frameSize.height + blockSize_ - 1) / blockSize_);
+}
+
+bool BlockMotionMap::apply(const cv::Mat& gray) {
+    CV_Assert(gray.type() == CV_8UC1);
+    map_.create(gridSize(gray.size()), CV_8UC1);
+    if (background_.size() != gray.size()) {
+        gray.convertTo(background_, CV_16U, 256.0);
+        map_.setTo(cv::Scalar::all(0));
+        return false;
+    }
+
+    sums_.resize(map_.cols);
+    for (int blockRow = 0; blockRow < map_.rows; ++blockRow) {
+        const int top = blockRow * blockSize_;
+        const int bottom = std::min(gray.rows, top + blockSize_);
+        std::fill(sums_.begin(), sums_.end(), 0u);
+        for (int y = top; y < bottom; ++y) {
+            sadUpdateRow(gray.ptr<uchar>(y), background_.ptr<ushort>(y), gray.cols, blockSize_, shift_,
+                         sums_.data());
+        }
+        uchar* out = map_.ptr<uchar>(blockRow);
+        for (int column = 0; column < map_.cols; ++column) {
+            const int left = column * blockSize_;
+            const int width = std::min(gray.cols, left + blockSize_) - left;
+            const uint32_t pixels = static_cast<uint32_t>(width * (bottom - top));
+            out[column] = cv::saturate_cast<uchar>((sums_[column] + pixels / 2) / pixels);
+        }
+    }
+    return true;
+}
+
+void BlockMotionMap::backgroundImage(cv::Mat& image) const {
+    background_.convertTo(image, CV_8U, 1.0 / 256.0);
+}
@@ -0,0 +1,208 @@
+#include "box_capture.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "logger.hpp"
+
+using namespace box_capture_layout;
+
+namespace {
+
+// Full write at @p offset, retrying short writes and EINTR
+bool writeAt(int fd, const unsigned char* data, size_t length, uint64_t offset) {
+    while (length > 0) {
+        const ssize_t written = ::pwrite(fd, data, length, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+    return true;
+}
+
+template <typename Record>
+void appendRecord(std::vector<unsigned char>& buffer, const Record& record) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(&record);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(record));
+}
+
+}  // namespace
+
+BoxCaptureWriter::BoxCaptureWriter(const std::string& path, const cv::Size& frameSize)
+    : path_(path) {
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot create box capture " + path + ": " + std::strerror(errno));
+    }
+    header_.magic = kMagic;
+    header_.version = kVersion;
+    header_.frameWidth = frameSize.width;
+    header_.frameHeight = frameSize.height;
+    header_.createdUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::system_clock::now().time_since_epoch())
+                            .count();
+    buffer_.reserve(kBufferBytes + sizeof(FrameRecord));
+    appendRecord(buffer_, header_);
+}
+
+BoxCaptureWriter::~BoxCaptureWriter() { close(); }
+
+bool BoxCaptureWriter::append(int64_t frameIndex, int64_t timestampUs,
+                              const std::vector<cv::Rect>& boxes) {
+    if (fd_ < 0) return false;
+    FrameRecord record{};
+    record.frameIndex = frameIndex;
+    record.timestampUs = timestampUs;
+    record.boxCount = static_cast<uint32_t>(boxes.size());
+    appendRecord(buffer_, record);
+    for (const cv::Rect& box : boxes) {
+        appendRecord(buffer_, BoxRecord{box.x, box.y, box.width, box.height});
+    }
+    frames_++;
+    boxes_ += boxes.size();
+    return buffer_.size() < kBufferBytes || writeBuffer();
+}
+
+bool BoxCaptureWriter::close() {
+    if (fd_ < 0) return false;
+    bool ok = writeBuffer();
+    if (ok) {
+        header_.frameCount = frames_;
+        header_.boxCount = boxes_;
+        ok = writeAt(fd_, reinterpret_cast<const unsigned char*>(&header_), sizeof(header_), 0);
+        if (!ok) LOG_ERROR("Failed to finish box capture {}: {}", path_, std::strerror(errno));
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+        LOG_INFO("Box capture {}: {} frames, {} boxes", path_, frames_, boxes_);
+    }
+    return ok;
+}
+
+bool BoxCaptureWriter::writeBuffer() {
+    if (buffer_.empty()) return true;
+    if (!writeAt(fd_, buffer_.data(), buffer_.size(), fileSize_)) {
+        fail("write");
+        return false;
+    }
+    fileSize_ += buffer_.size();
+    buffer_.clear();
+    return true;
+}
+
+void BoxCaptureWriter::fail(const char* what) {
+    // The frames written so far stay readable: the header still says "not closed"
+    LOG_ERROR("Box capture {} stopped, failed to {}: {}", path_, what, std::strerror(errno));
+    ::close(fd_);
+    fd_ = -1;
+}
+
+void BoxCaptureFrame::copyTo(std::vector<cv::Rect>& out) const {
+    out.clear();
+    out.reserve(boxCount);
+    for (size_t i = 0; i < boxCount; ++i) {
+        out.emplace_back(boxes[i].x, boxes[i].y, boxes[i].width, boxes[i].height);
+    }
+}
+
+BoxCapture BoxCapture::open(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open box capture " + path + ": " + std::strerror(errno));
+    }
+    struct stat info {};
+    if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(FileHeader)) {
+        ::close(fd);
+        throw std::runtime_error(path + " is not a box capture");
+    }
+    const auto fileBytes = static_cast<size_t>(info.st_size);
+    void* mapping = ::mmap(nullptr, fileBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // The mapping keeps the file referenced
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Cannot map box capture " + path + ": " + std::strerror(errno));
+    }
+
+    BoxCapture capture;
+    capture.mapping_ = static_cast<const unsigned char*>(mapping);
+    capture.mappingBytes_ = fileBytes;
+    FileHeader header{};
+    std::memcpy(&header, capture.mapping_, sizeof(header));
+    if (header.magic != kMagic || header.version != kVersion) {
+        throw std::runtime_error(path + " is not a version " + std::to_string(kVersion) +
+                                 " box capture");
+    }
+    capture.frameSize_ = cv::Size(header.frameWidth, header.frameHeight);
+
+    // Index the frames; a frame cut short by a crash ends the capture
+    capture.frameOffsets_.reserve(header.frameCount);
+    size_t offset = sizeof(header);
+    while (offset + sizeof(FrameRecord) <= fileBytes) {
+        FrameRecord record{};
+        std::memcpy(&record, capture.mapping_ + offset, sizeof(record));
+        const size_t end = offset + sizeof(record) + size_t{record.boxCount} * sizeof(BoxRecord);
+        if (end > fileBytes) break;
+        capture.frameOffsets_.push_back(offset);
+        capture.totalBoxes_ += record.boxCount;
+        offset = end;
+    }
+    capture.complete_ = header.frameCount > 0 && header.frameCount == capture.size() &&
+                        header.boxCount == capture.totalBoxes_;
+    if (!capture.complete_) {
+        LOG_WARN("Box capture {} was not closed; read {} complete frames", path, capture.size());
+    }
+    ::madvise(mapping, fileBytes, MADV_SEQUENTIAL);
+    LOG_INFO("Mapped box capture {}: {} frames ({}x{}), {} boxes", path, capture.size(),
+             capture.frameSize_.width, capture.frameSize_.height, capture.totalBoxes_);
+    return capture;
+}
+
+BoxCapture::BoxCapture(BoxCapture&& other) noexcept { *this = std::move(other); }
+
+BoxCapture& BoxCapture::operator=(BoxCapture&& other) noexcept {
+    if (this != &other) {
+        unmap();
+        mapping_ = std::exchange(other.mapping_, nullptr);
+        mappingBytes_ = std::exchange(other.mappingBytes_, 0);
+        frameOffsets_ = std::move(other.frameOffsets_);
+        frameSize_ = other.frameSize_;
+        totalBoxes_ = std::exchange(other.totalBoxes_, 0);
+        complete_ = std::exchange(other.complete_, false);
+    }
+    return *this;
+}
+
+BoxCapture::~BoxCapture() { unmap(); }
+
+void BoxCapture::unmap() {
+    if (mapping_) {
+        ::munmap(const_cast<unsigned char*>(mapping_), mappingBytes_);
+        mapping_ = nullptr;
+        mappingBytes_ = 0;
+    }
+}
+
+BoxCaptureFrame BoxCapture::frame(size_t index) const {
+    const unsigned char* at = mapping_ + frameOffsets_.at(index);
+    FrameRecord record{};
+    std::memcpy(&record, at, sizeof(record));
+    BoxCaptureFrame frame;
+    frame.frameIndex = record.frameIndex;
+    frame.timestampUs = record.timestampUs;
+    // Records are multiples of 8 bytes after a 48-byte header, so boxes stay 4-byte aligned
+    frame.boxes = reinterpret_cast<const BoxRecord*>(at + sizeof(record));
+    frame.boxCount = record.boxCount;
+    return frame;
+}
@@ -0,0 +1,168 @@
+#include "box_distance_kernel.hpp"
+
+#include <cctype>
+#include <opencv2/core/hal/intrin.hpp>
+#include <stdexcept>
+
+DistanceMetric parseDistanceMetric(std::string name) {
+    std::transform(name.begin(), name.end(), name.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (name == "overlap_edge") return DistanceMetric::OverlapEdge;
+    if (name == "edge_gap") return DistanceMetric::EdgeGap;
+    if (name == "center_linf") return DistanceMetric::CenterChebyshev;
+    if (name == "iou") return DistanceMetric::Iou;
+    throw std::invalid_argument("Unknown distance metric: " + name);
+}
+
+const char* distanceMetricName(DistanceMetric metric) {
+    switch (metric) {
+        case DistanceMetric::OverlapEdge:
+            return "overlap_edge";
+        case DistanceMetric::EdgeGap:
+            return "edge_gap";
+        case DistanceMetric::CenterChebyshev:
+            return "center_linf";
+        case DistanceMetric::Iou:
+            return "iou";
+    }
+    return "unknown";
+}
+
+void boxDistanceBatch(const BoxArrays& boxes, size_t i, size_t begin, size_t end,
+                      const BoxDistanceParams& params, double* out) {
+    size_t j = begin;
+
+#if CV_SIMD128_64F
+    const cv::v_float64x2 zero = cv::v_setall_f64(0.0);
+    const cv::v_float64x2 one = cv::v_setall_f64(1.0);
+    const cv::v_float64x2 none = cv::v_setall_f64(std::numeric_limits<double>::max());
+    const cv::v_float64x2 maxEdge = cv::v_setall_f64(params.maxEdgeDistance);
+    const cv::v_float64x2 overlapWeight = cv::v_setall_f64(params.overlapWeight);
+    const cv::v_float64x2 edgeWeight = cv::v_setall_f64(params.edgeWeight);
+
+    const cv::v_float64x2 left1 = cv::v_setall_f64(boxes.left[i]);
+    const cv::v_float64x2 top1 = cv::v_setall_f64(boxes.top[i]);
+    const cv::v_float64x2 right1 = cv::v_setall_f64(boxes.right[i]);
+    const cv::v_float64x2 bottom1 = cv::v_setall_f64(boxes.bottom[i]);
+    const cv::v_float64x2 area1 = cv::v_setall_f64(boxes.area[i]);
+
+    constexpr size_t kLanes = cv::v_float64x2::nlanes;
+    for (; j + kLanes <= end; j += kLanes) {
+        const cv::v_float64x2 left2 = cv::v_load(boxes.left.data() + j);
+        const cv::v_float64x2 top2 = cv::v_load(boxes.top.data() + j);
+        const cv::v_float64x2 right2 = cv::v_load(boxes.right.data() + j);
+        const cv::v_float64x2 bottom2 = cv::v_load(boxes.bottom.data() + j);
+        const cv::v_float64x2 area2 = cv::v_load(boxes.area.data() + j);
+
+        // Overlap component; disjoint lanes divide by 1 and are then discarded
+        const cv::v_float64x2 interWidth = cv::v_min(right1, right2) - cv::v_max(left1, left2);
+        const cv::v_float64x2 interHeight = cv::v_min(bottom1, bottom2) - cv::v_max(top1, top2);
+        const cv::v_float64x2 overlaps = (interWidth > zero) & (interHeight > zero);
+        const cv::v_float64x2 minArea = cv::v_select(overlaps, cv::v_min(area1, area2), one);
+        const cv::v_float64x2 overlap = cv::v_select(
+            overlaps, maxEdge * (one - (interWidth * interHeight) / minArea), maxEdge);
+
+        // Edge component
+        const cv::v_float64x2 gapX = cv::v_max(left2 - right1, left1 - right2);
+        const cv::v_float64x2 gapY = cv::v_max(top2 - bottom1, top1 - bottom2);
+        const cv::v_float64x2 separatedX = gapX > zero;
+        const cv::v_float64x2 separatedY = gapY > zero;
+        const cv::v_float64x2 edgeGap = cv::v_min(
+            cv::v_min(cv::v_select(separatedX, gapX, none), cv::v_select(separatedY, gapY, none)),
+            maxEdge);
+        const cv::v_float64x2 edge = cv::v_select(separatedX | separatedY, edgeGap, zero);
+
+        cv::v_store(out + (j - begin), overlapWeight * overlap + edgeWeight * edge);
+    }
+#endif
+
+    for (; j < end; ++j) out[j - begin] = boxDistance(boxes, i, j, params);
+}
+
+void edgeGapDistanceBatch(const BoxArrays& boxes, size_t i, size_t begin, size_t end,
+                          const BoxDistanceParams& params, double* out) {
+    size_t j = begin;
+
+#if CV_SIMD128_64F
+    const cv::v_float64x2 zero = cv::v_setall_f64(0.0);
+    const cv::v_float64x2 none = cv::v_setall_f64(std::numeric_limits<double>::max());
+    const cv::v_float64x2 maxEdge = cv::v_setall_f64(params.maxEdgeDistance);
+
+    const cv::v_float64x2 left1 = cv::v_setall_f64(boxes.left[i]);
+    const cv::v_float64x2 top1 = cv::v_setall_f64(boxes.top[i]);
+    const cv::v_float64x2 right1 = cv::v_setall_f64(boxes.right[i]);
+    const cv::v_float64x2 bottom1 = cv::v_setall_f64(boxes.bottom[i]);
+
+    constexpr size_t kLanes = cv::v_float64x2::nlanes;
+    for (; j + kLanes <= end; j += kLanes) {
+        const cv::v_float64x2 gapX = cv::v_max(cv::v_load(boxes.left.data() + j) - right1,
+                                               left1 - cv::v_load(boxes.right.data() + j));
+        const cv::v_float64x2 gapY = cv::v_max(cv::v_load(boxes.top.data() + j) - bottom1,
+                                               top1 - cv::v_load(boxes.bottom.data() + j));
+        const cv::v_float64x2 separatedX = gapX > zero;
+        const cv::v_float64x2 separatedY = gapY > zero;
+        const cv::v_float64x2 edgeGap = cv::v_min(
+            cv::v_min(cv::v_select(separatedX, gapX, none), cv::v_select(separatedY, gapY, none)),
+            maxEdge);
+        cv::v_store(out + (j - begin), cv::v_select(separatedX | separatedY, edgeGap, zero));
+    }
+#endif
+
+    for (; j < end; ++j) out[j - begin] = EdgeGapDistance::distance(boxes, i, j, params);
+}
+
+void centerChebyshevDistanceBatch(const BoxArrays& boxes, size_t i, size_t begin, size_t end,
+                                  const BoxDistanceParams& params, double* out) {
+    size_t j = begin;
+
+#if CV_SIMD128_64F
+    const cv::v_float64x2 half = cv::v_setall_f64(0.5);
+    const cv::v_float64x2 centerX1 = cv::v_setall_f64(boxes.left[i] + boxes.right[i]);
+    const cv::v_float64x2 centerY1 = cv::v_setall_f64(boxes.top[i] + boxes.bottom[i]);
+
+    constexpr size_t kLanes = cv::v_float64x2::nlanes;
+    for (; j + kLanes <= end; j += kLanes) {
+        const cv::v_float64x2 centerX2 = cv::v_load(boxes.left.data() + j) + cv::v_load(boxes.right.data() + j);
+        const cv::v_float64x2 centerY2 = cv::v_load(boxes.top.data() + j) + cv::v_load(boxes.bottom.data() + j);
+        const cv::v_float64x2 distance =
+            cv::v_max(cv::v_absdiff(centerX1, centerX2), cv::v_absdiff(centerY1, centerY2));
+        cv::v_store(out + (j - begin), half * distance);
+    }
+#endif
+
+    for (; j < end; ++j) out[j - begin] = CenterChebyshevDistance::distance(boxes, i, j, params);
+}
+
+void iouDistanceBatch(const BoxArrays& boxes, size_t i, size_t begin, size_t end,
+                      const BoxDistanceParams& params, double* out) {
+    size_t j = begin;
+
+#if CV_SIMD128_64F
+    const cv::v_float64x2 zero = cv::v_setall_f64(0.0);
+    const cv::v_float64x2 one = cv::v_setall_f64(1.0);
+    const cv::v_float64x2 maxEdge = cv::v_setall_f64(params.maxEdgeDistance);
+
+    const cv::v_float64x2 left1 = cv::v_setall_f64(boxes.left[i]);
+    const cv::v_float64x2 top1 = cv::v_setall_f64(boxes.top[i]);
+    const cv::v_float64x2 right1 = cv::v_setall_f64(boxes.right[i]);
+    const cv::v_float64x2 bottom1 = cv::v_setall_f64(boxes.bottom[i]);
+    const cv::v_float64x2 area1 = cv::v_setall_f64(boxes.area[i]);
+
+    constexpr size_t kLanes = cv::v_float64x2::nlanes;
+    for (; j + kLanes <= end; j += kLanes) {
+        const cv::v_float64x2 interWidth =
+            cv::v_min(right1, cv::v_load(boxes.right.data() + j)) - cv::v_max(left1, cv::v_load(boxes.left.data() + j));
+        const cv::v_float64x2 interHeight =
+            cv::v_min(bottom1, cv::v_load(boxes.bottom.data() + j)) - cv::v_max(top1, cv::v_load(boxes.top.data() + j));
+        const cv::v_float64x2 overlaps = (interWidth > zero) & (interHeight > zero);
+        const cv::v_float64x2 intersection = interWidth * interHeight;
+        // Disjoint lanes divide by 1 and are then discarded
+        const cv::v_float64x2 unionArea =
+            cv::v_select(overlaps, area1 + cv::v_load(boxes.area.data() + j) - intersection, one);
+        cv::v_store(out + (j - begin),
+                    cv::v_select(overlaps, maxEdge * (one - intersection / unionArea), maxEdge));
+    }
+#endif
+
+    for (; j < end; ++j) out[j - begin] = IouDistance::distance(boxes, i, j, params);
+}
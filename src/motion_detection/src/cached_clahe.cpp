@@ -0,0 +1,155 @@
+#include "cached_clahe.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <opencv2/imgproc.hpp>
+
+namespace {
+
+constexpr int kHistSize = 256;
+constexpr int kMeanRowStep = 8;
+
+}  // namespace
+
+CachedClahe::CachedClahe(double clipLimit, int tiles, double scale, int updateInterval, double driftLimit)
+    : clipLimit_(clipLimit),
+      tiles_(std::max(1, tiles)),
+      scale_(std::clamp(scale, 0.1, 1.0)),
+      updateInterval_(std::max(1, updateInterval)),
+      driftLimit_(driftLimit) {}
+
+cv::Size CachedClahe::tileSize(const cv::Size& imageSize) const {
+    if (imageSize.width % tiles_ == 0 && imageSize.height % tiles_ == 0) {
+        return cv::Size(imageSize.width / tiles_, imageSize.height / tiles_);
+    }
+    // cv::CLAHE then pads both sides by tiles - remainder, a whole tile where it divided
+    return cv::Size((imageSize.width + tiles_ - imageSize.width % tiles_) / tiles_,
+                    (imageSize.height + tiles_ - imageSize.height % tiles_) / tiles_);
+}
+
+double CachedClahe::sampledMean(const cv::Mat& input) {
+    uint64_t sum = 0;
+    uint64_t count = 0;
+    for (int y = 0; y < input.rows; y += kMeanRowStep) {
+        const uchar* row = input.ptr<uchar>(y);
+        for (int x = 0; x < input.cols; ++x) sum += row[x];
+        count += static_cast<uint64_t>(input.cols);
+    }
+    return count > 0 ? static_cast<double>(sum) / static_cast<double>(count) : 0.0;
+}
+
+bool CachedClahe::apply(const cv::Mat& input, cv::Mat& output) {
+    CV_Assert(input.type() == CV_8UC1);
+    const double mean = sampledMean(input);
+    const bool due = !fitted() || input.size() != fittedSize_ || ++framesSinceFit_ >= updateInterval_ ||
+                     std::abs(mean - fittedMean_) > driftLimit_;
+    if (due) fit(input);
+    interpolate(input, output);
+    return due;
+}
+
+void CachedClahe::fit(const cv::Mat& input) {
+    CV_Assert(input.type() == CV_8UC1);
+    fittedSize_ = input.size();
+    fittedMean_ = sampledMean(input);
+    framesSinceFit_ = 0;
+    ++fitCount_;
+
+    const cv::Size size(std::max(tiles_, cvRound(input.cols * scale_)),
+                        std::max(tiles_, cvRound(input.rows * scale_)));
+    if (size == input.size()) {
+        input.copyTo(reduced_);
+    } else {
+        cv::resize(input, reduced_, size, 0, 0, cv::INTER_AREA);
+    }
+    // As cv::CLAHE: tiles that do not divide the image cover a reflected border
+    const cv::Size tile = tileSize(size);
+    if (tile.width * tiles_ != size.width || tile.height * tiles_ != size.height) {
+        cv::copyMakeBorder(reduced_, reduced_, 0, tile.height * tiles_ - size.height, 0,
+                           tile.width * tiles_ - size.width, cv::BORDER_REFLECT_101);
+    }
+
+    const int tileArea = tile.area();
+    int clipLimit = 0;
+    if (clipLimit_ > 0.0) clipLimit = std::max(1, static_cast<int>(clipLimit_ * tileArea / kHistSize));
+    const float lutScale = static_cast<float>(kHistSize - 1) / static_cast<float>(tileArea);
+
+    luts_.resize(static_cast<size_t>(tiles_) * tiles_ * kHistSize);
+    int hist[kHistSize];
+    for (int ty = 0; ty < tiles_; ++ty) {
+        for (int tx = 0; tx < tiles_; ++tx) {
+            std::fill(hist, hist + kHistSize, 0);
+            const cv::Mat block = reduced_(cv::Rect(tx * tile.width, ty * tile.height, tile.width, tile.height));
+            for (int y = 0; y < block.rows; ++y) {
+                const uchar* row = block.ptr<uchar>(y);
+                for (int x = 0; x < block.cols; ++x) ++hist[row[x]];
+            }
+            if (clipLimit > 0) {
+                // Clip the histogram and spread the excess evenly, the remainder at a stride
+                int clipped = 0;
+                for (int& count : hist) {
+                    if (count > clipLimit) {
+                        clipped += count - clipLimit;
+                        count = clipLimit;
+                    }
+                }
+                const int batch = clipped / kHistSize;
+                int residual = clipped - batch * kHistSize;
+                for (int& count : hist) count += batch;
+                if (residual != 0) {
+                    const int step = std::max(kHistSize / residual, 1);
+                    for (int i = 0; i < kHistSize && residual > 0; i += step, --residual) ++hist[i];
+                }
+            }
+            uchar* lut = luts_.data() + (static_cast<size_t>(ty) * tiles_ + tx) * kHistSize;
+            int sum = 0;
+            for (int i = 0; i < kHistSize; ++i) {
+                sum += hist[i];
+                lut[i] = cv::saturate_cast<uchar>(static_cast<float>(sum) * lutScale);
+            }
+        }
+    }
+}
+
+void CachedClahe::interpolate(const cv::Mat& input, cv::Mat& output) {
+    CV_Assert(input.type() == CV_8UC1 && fitted() && input.size() == fittedSize_);
+    // Tile centres at full resolution; the same geometry cv::CLAHE interpolates with
+    const cv::Size tile = tileSize(input.size());
+    const float inverseWidth = 1.0f / static_cast<float>(tile.width);
+    const float inverseHeight = 1.0f / static_cast<float>(tile.height);
+    if (interpolationSize_ != input.size()) {
+        interpolationSize_ = input.size();
+        leftTile_.resize(input.cols);
+        rightTile_.resize(input.cols);
+        rightWeight_.resize(input.cols);
+        for (int x = 0; x < input.cols; ++x) {
+            const float position = static_cast<float>(x) * inverseWidth - 0.5f;
+            const int left = cvFloor(position);
+            rightWeight_[x] = position - static_cast<float>(left);
+            leftTile_[x] = std::max(left, 0) * kHistSize;
+            rightTile_[x] = std::min(left + 1, tiles_ - 1) * kHistSize;
+        }
+    }
+
+    output.create(input.size(), CV_8UC1);
+    const size_t lutRow = static_cast<size_t>(tiles_) * kHistSize;
+    for (int y = 0; y < input.rows; ++y) {
+        const float position = static_cast<float>(y) * inverseHeight - 0.5f;
+        const int top = cvFloor(position);
+        const float bottomWeight = position - static_cast<float>(top);
+        const float topWeight = 1.0f - bottomWeight;
+        const uchar* upper = luts_.data() + static_cast<size_t>(std::max(top, 0)) * lutRow;
+        const uchar* lower = luts_.data() + static_cast<size_t>(std::min(top + 1, tiles_ - 1)) * lutRow;
+        const uchar* in = input.ptr<uchar>(y);
+        uchar* out = output.ptr<uchar>(y);
+        for (int x = 0; x < input.cols; ++x) {
+            const int value = in[x];
+            const float right = rightWeight_[x];
+            const float left = 1.0f - right;
+            const int a = leftTile_[x] + value;
+            const int b = rightTile_[x] + value;
+            out[x] = cv::saturate_cast<uchar>((upper[a] * left + upper[b] * right) * topWeight +
+                                              (lower[a] * left + lower[b] * right) * bottomWeight);
+        }
+    }
+}
@@ -0,0 +1,424 @@
+#include "capture_source.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <opencv2/imgproc.hpp>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "decode_ahead_reader.hpp"
+#include "logger.hpp"
+#include "motion_vector_decoder.hpp"
+
+namespace {
+
+std::string toLower(std::string name) {
+    std::transform(name.begin(), name.end(), name.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return name;
+}
+
+bool isRtsp(const std::string& source) { return toLower(source.substr(0, 7)) == "rtsp://"; }
+
+// "" and "0", "1", ... name camera indices; anything else is a path or URL
+bool isDeviceIndex(const std::string& source) {
+    return source.empty() || std::all_of(source.begin(), source.end(),
+                                         [](unsigned char c) { return std::isdigit(c) != 0; });
+}
+
+int deviceIndex(const std::string& source) { return source.empty() ? 0 : std::stoi(source); }
+
+}  // namespace
+
+CaptureBackend parseCaptureBackend(std::string name) {
+    name = toLower(std::move(name));
+    if (name == "auto") return CaptureBackend::Auto;
+    if (name == "v4l2") return CaptureBackend::V4L2;
+    if (name == "gstreamer") return CaptureBackend::GStreamer;
+    if (name == "ffmpeg") return CaptureBackend::FFmpeg;
+    if (name == "motion_vectors") return CaptureBackend::MotionVectors;
+    if (name == "decode_ahead") return CaptureBackend::DecodeAhead;
+    throw std::invalid_argument("Unknown capture backend: " + name);
+}
+
+const char* captureBackendName(CaptureBackend backend) {
+    switch (backend) {
+        case CaptureBackend::Auto:
+            return "auto";
+        case CaptureBackend::V4L2:
+            return "v4l2";
+        case CaptureBackend::GStreamer:
+            return "gstreamer";
+        case CaptureBackend::FFmpeg:
+            return "ffmpeg";
+        case CaptureBackend::MotionVectors:
+            return "motion_vectors";
+        case CaptureBackend::DecodeAhead:
+            return "decode_ahead";
+    }
+    return "unknown";
+}
+
+HardwareDecode parseHardwareDecode(std::string name) {
+    name = toLower(std::move(name));
+    if (name == "none") return HardwareDecode::None;
+    if (name == "any") return HardwareDecode::Any;
+    if (name == "nvidia") return HardwareDecode::Nvidia;
+    if (name == "vaapi") return HardwareDecode::Vaapi;
+    throw std::invalid_argument("Unknown hardware decoder: " + name);
+}
+
+const char* hardwareDecodeName(HardwareDecode decode) {
+    switch (decode) {
+        case HardwareDecode::None:
+            return "none";
+        case HardwareDecode::Any:
+            return "any";
+        case HardwareDecode::Nvidia:
+            return "nvidia";
+        case HardwareDecode::Vaapi:
+            return "vaapi";
+    }
+    return "unknown";
+}
+
+CaptureSource::CaptureSource(CaptureConfig config) : config_(std::move(config)), pool_(config_.poolSize) {
+    pool_.setAllocator(PlacedMatAllocator::forPlacement(config_.memory));
+}
+
+CaptureSource::~CaptureSource() = default;  // MotionVectorDecoder and DecodeAheadReader are complete here
+
+bool CaptureSource::isOpened() const {
+    if (decodeAhead_) return decodeAhead_->isOpened();
+    return vectorDecoder_ ? vectorDecoder_->isOpened() : capture_.isOpened();
+}
+
+void CaptureSource::release() {
+    pendingFrame_.release();
+    capture_.release();
+    if (vectorDecoder_) vectorDecoder_->release();
+    if (decodeAhead_) decodeAhead_->close();
+}
+
+double CaptureSource::fps() const {
+    if (decodeAhead_) return decodeAhead_->fps();
+    return vectorDecoder_ ? vectorDecoder_->fps() : capture_.get(cv::CAP_PROP_FPS);
+}
+
+void CaptureSource::setDecodeStride(int stride) {
+    if (decodeAhead_) decodeAhead_->setStride(stride);
+}
+
+std::string CaptureSource::buildGStreamerPipeline(const CaptureConfig& config) {
+    const std::string format = config.lumaOnly ? "GRAY8" : "BGR";
+    std::string pipeline;
+    if (isRtsp(config.source)) {
+        const bool h265 = toLower(config.codec) == "h265";
+        pipeline = "rtspsrc location=" + config.source + " latency=" + std::to_string(config.rtspLatencyMs) +
+                   (h265 ? " ! rtph265depay ! h265parse" : " ! rtph264depay ! h264parse");
+        switch (config.hardwareDecode) {
+            case HardwareDecode::Nvidia:
+                // nvvidconv leaves NVMM memory; GRAY8 is the Y plane, BGRx still needs a CPU pass
+                pipeline += std::string(" ! nvv4l2decoder ! nvvidconv ! video/x-raw,format=") +
+                            (config.lumaOnly ? "GRAY8" : "BGRx");
+                break;
+            case HardwareDecode::Vaapi:
+                pipeline += h265 ? " ! vaapih265dec" : " ! vaapih264dec";
+                break;
+            case HardwareDecode::Any:
+                pipeline += " ! decodebin";  // Highest-ranked decoder, hardware when installed
+                break;
+            case HardwareDecode::None:
+                pipeline += h265 ? " ! avdec_h265" : " ! avdec_h264";
+                break;
+        }
+        // Live stream: never queue stale frames behind a slow consumer
+        return pipeline + " ! videoconvert ! video/x-raw,format=" + format +
+               " ! appsink drop=true max-buffers=1 sync=false";
+    }
+
+    // Files: decodebin autoplugs hardware decoders by rank; every frame is delivered
+    return "filesrc location=\"" + config.source + "\" ! decodebin ! videoconvert ! video/x-raw,format=" + format +
+           " ! appsink sync=false";
+}
+
+bool CaptureSource::open() {
+    backendDeliversLuma_ = false;
+    rawYuyv_ = false;
+    pendingFrame_.release();
+    vectorDecoder_.reset();
+    decodeAhead_.reset();
+    pendingSkippedFrames_ = lastSkippedFrames_ = 0;
+    bool opened = false;
+    switch (config_.backend) {
+        case CaptureBackend::Auto:
+            opened = isDeviceIndex(config_.source) ? capture_.open(deviceIndex(config_.source))
+                                                   : capture_.open(config_.source);
+            if (opened && config_.width > 0 && config_.height > 0) {
+                capture_.set(cv::CAP_PROP_FRAME_WIDTH, config_.width);
+                capture_.set(cv::CAP_PROP_FRAME_HEIGHT, config_.height);
+            }
+            break;
+        case CaptureBackend::V4L2:
+            opened = openV4L2();
+            break;
+        case CaptureBackend::GStreamer:
+            opened = openGStreamer();
+            break;
+        case CaptureBackend::FFmpeg:
+            opened = openFFmpeg();
+            break;
+        case CaptureBackend::MotionVectors:
+            if (MotionVectorDecoder::available()) {
+                opened = openMotionVectors();
+            } else {
+                LOG_WARN("Built without libav (ENABLE_FFMPEG_MOTION_VECTORS); decoding every frame with ffmpeg");
+                opened = openFFmpeg();
+            }
+            break;
+        case CaptureBackend::DecodeAhead:
+            if (!DecodeAheadReader::available()) {
+                LOG_WARN("Built without libav (ENABLE_FFMPEG_MOTION_VECTORS); decoding with ffmpeg in read()");
+                opened = openFFmpeg();
+            } else if (isLive()) {
+                // A live source already arrives at its own pace; decoding ahead only adds latency
+                LOG_WARN("The decode_ahead backend reads files; decoding '{}' with ffmpeg", config_.source);
+                opened = openFFmpeg();
+            } else {
+                opened = openDecodeAhead();
+            }
+            break;
+    }
+    if (!opened) {
+        LOG_ERROR("Could not open capture source '{}' with the {} backend", config_.source,
+                  captureBackendName(config_.backend));
+        return false;
+    }
+    LOG_INFO("Capture source '{}' opened: backend {} ({}), hardware decode {}, {} output, {} pooled buffers",
+             config_.source.empty() ? "camera 0" : config_.source, captureBackendName(config_.backend),
+             vectorDecoder_ || decodeAhead_ ? std::string("libavcodec") : capture_.getBackendName(),
+             hardwareDecodeName(config_.hardwareDecode),
+             config_.lumaOnly ? "luma" : "BGR", pool_.capacity());
+    return true;
+}
+
+bool CaptureSource::openV4L2() {
+    const bool opened = isDeviceIndex(config_.source) ? capture_.open(deviceIndex(config_.source), cv::CAP_V4L2)
+                                                      : capture_.open(config_.source, cv::CAP_V4L2);
+    if (!opened) return false;
+
+    // OpenCV's V4L2 backend streams through this many mmap'd driver buffers
+    capture_.set(cv::CAP_PROP_BUFFERSIZE, config_.deviceBuffers);
+    if (config_.width > 0 && config_.height > 0) {
+        capture_.set(cv::CAP_PROP_FRAME_WIDTH, config_.width);
+        capture_.set(cv::CAP_PROP_FRAME_HEIGHT, config_.height);
+    }
+    if (config_.fps > 0.0) capture_.set(cv::CAP_PROP_FPS, config_.fps);
+
+    if (config_.lumaOnly) {
+        // Take the camera's YUYV buffers unconverted and read Y straight out of them
+        const double yuyv = cv::VideoWriter::fourcc('Y', 'U', 'Y', 'V');
+        if (capture_.set(cv::CAP_PROP_FOURCC, yuyv) && capture_.get(cv::CAP_PROP_FOURCC) == yuyv &&
+            capture_.set(cv::CAP_PROP_CONVERT_RGB, 0)) {
+            rawYuyv_ = true;
+            yuyvSize_ = cv::Size(static_cast<int>(capture_.get(cv::CAP_PROP_FRAME_WIDTH)),
+                                 static_cast<int>(capture_.get(cv::CAP_PROP_FRAME_HEIGHT)));
+        } else {
+            LOG_WARN("Camera does not stream raw YUYV; luma is converted from BGR");
+        }
+    }
+    return true;
+}
+
+bool CaptureSource::openGStreamer() {
+    const std::string pipeline =
+        config_.gstreamerPipeline.empty() ? buildGStreamerPipeline(config_) : config_.gstreamerPipeline;
+    LOG_INFO("GStreamer pipeline: {}", pipeline);
+    // A configured pipeline delivers luma only if it negotiates GRAY8 itself
+    backendDeliversLuma_ = config_.lumaOnly && (config_.gstreamerPipeline.empty() ||
+                                                pipeline.find("format=GRAY8") != std::string::npos);
+    return capture_.open(pipeline, cv::CAP_GSTREAMER);
+}
+
+bool CaptureSource::openFFmpeg() {
+    // RTSP over UDP loses packets (and so whole frames) on busy networks
+    if (isRtsp(config_.source)) {
+        setenv("OPENCV_FFMPEG_CAPTURE_OPTIONS", "rtsp_transport;tcp", 0);  // Keep a user override
+    }
+
+#if CV_VERSION_MAJOR > 4 || \
+    (CV_VERSION_MAJOR == 4 && (CV_VERSION_MINOR > 5 || (CV_VERSION_MINOR == 5 && CV_VERSION_REVISION >= 2)))
+    // FFmpeg has no CUDA-specific mode in OpenCV; "nvidia" takes whichever device decodes
+    int acceleration = cv::VIDEO_ACCELERATION_ANY;
+    if (config_.hardwareDecode == HardwareDecode::None) acceleration = cv::VIDEO_ACCELERATION_NONE;
+    if (config_.hardwareDecode == HardwareDecode::Vaapi) acceleration = cv::VIDEO_ACCELERATION_VAAPI;
+    const std::vector<int> params = {cv::CAP_PROP_HW_ACCELERATION, acceleration};
+    if (!capture_.open(config_.source, cv::CAP_FFMPEG, params)) return false;
+    if (config_.hardwareDecode != HardwareDecode::None &&
+        capture_.get(cv::CAP_PROP_HW_ACCELERATION) == cv::VIDEO_ACCELERATION_NONE) {
+        LOG_WARN("FFmpeg found no hardware decoder for '{}'; decoding in software", config_.source);
+    }
+    return true;
+#else
+    if (config_.hardwareDecode != HardwareDecode::None) {
+        LOG_WARN("FFmpeg hardware decode needs OpenCV 4.5.2 or newer; decoding in software");
+    }
+    return capture_.open(config_.source, cv::CAP_FFMPEG);
+#endif
+}
+
+bool CaptureSource::openMotionVectors() {
+    if (isDeviceIndex(config_.source)) {
+        LOG_ERROR("The motion_vectors backend reads encoded files and streams, not cameras");
+        return false;
+    }
+    if (config_.hardwareDecode != HardwareDecode::None) {
+        LOG_WARN("Motion vectors are only exported by software decoders; ignoring hardware_decode");
+    }
+    vectorDecoder_ = std::make_unique<MotionVectorDecoder>();
+    framesSinceDelivered_ = 0;
+    vectorSkippedFrames_.store(0, std::memory_order_relaxed);
+    return vectorDecoder_->open(config_.source);
+}
+
+bool CaptureSource::openDecodeAhead() {
+    if (config_.hardwareDecode != HardwareDecode::None) {
+        LOG_WARN("The decode_ahead backend decodes in software; ignoring hardware_decode");
+    }
+    decodeAhead_ = std::make_unique<DecodeAheadReader>(pool_);
+    DecodeAheadConfig reader;
+    reader.threads = config_.decodeThreads;
+    reader.lookaheadFrames = config_.decodeLookahead;
+    reader.lumaOnly = config_.lumaOnly;
+    if (reader.lookaheadFrames >= pool_.capacity()) {
+        LOG_WARN("decode_lookahead {} holds the whole buffer pool ({}); downstream frames will be allocated",
+                 reader.lookaheadFrames, pool_.capacity());
+    }
+    return decodeAhead_->open(config_.source, reader);
+}
+
+bool CaptureSource::read(cv::Mat& frame) {
+    if (!pendingFrame_.empty()) {
+        frame = pendingFrame_;
+        pendingFrame_.release();  // Drops only this reference; frame keeps the buffer
+        lastTimestampMs_ = pendingTimestampMs_;
+        lastSkippedFrames_ = pendingSkippedFrames_;
+        vectorRegions_.swap(pendingVectorRegions_);
+        return true;
+    }
+    if (!readFromBackend(frame)) return false;
+    lastTimestampMs_ = grabbedTimestampMs_;
+    lastSkippedFrames_ = grabbedSkippedFrames_;
+    return true;
+}
+
+const cv::Mat& CaptureSource::peek() {
+    if (pendingFrame_.empty()) {
+        if (!readFromBackend(pendingFrame_)) pendingFrame_.release();
+        pendingTimestampMs_ = grabbedTimestampMs_;
+        pendingSkippedFrames_ = grabbedSkippedFrames_;
+        pendingVectorRegions_.swap(vectorRegions_);  // Belong to the held frame
+        vectorRegions_.clear();
+    }
+    return pendingFrame_;
+}
+
+CaptureSource::StreamInfo CaptureSource::probe() {
+    StreamInfo info;
+    info.fps = fps();
+    if (info.fps <= 0.0) info.fps = config_.fps > 0.0 ? config_.fps : 0.0;
+
+    info.frameSize = decodeAhead_     ? decodeAhead_->frameSize()
+                     : vectorDecoder_ ? vectorDecoder_->frameSize()
+                     : rawYuyv_     ? yuyvSize_
+                              : cv::Size(static_cast<int>(capture_.get(cv::CAP_PROP_FRAME_WIDTH)),
+                                         static_cast<int>(capture_.get(cv::CAP_PROP_FRAME_HEIGHT)));
+    info.fromMetadata = info.frameSize.area() > 0;
+    if (!info.fromMetadata) info.frameSize = peek().size();
+    return info;
+}
+
+bool CaptureSource::readFromBackend(cv::Mat& frame) {
+    if (vectorDecoder_) return readFromVectors(frame);
+    if (decodeAhead_) {
+        // Decoded, converted and pooled on the reader's thread already
+        if (!decodeAhead_->read(frame)) return false;
+        grabbedTimestampMs_ = decodeAhead_->timestampMs();
+        grabbedSkippedFrames_ = decodeAhead_->skippedBefore();
+        frameSize_ = frame.size();
+        frameType_ = frame.type();
+        return true;
+    }
+    if (!capture_.grab()) return false;
+    // Queried before retrieve(), which some backends advance past the grabbed frame
+    grabbedTimestampMs_ = capture_.get(cv::CAP_PROP_POS_MSEC);
+
+    if (!config_.lumaOnly || backendDeliversLuma_) {
+        // The backend already produces the delivered layout: decode straight into the pool
+        if (!frameSize_.empty()) frame = pool_.acquire(frameSize_, frameType_);
+        if (!capture_.retrieve(frame) || frame.empty()) return false;
+        frameSize_ = frame.size();
+        frameType_ = frame.type();
+        return true;
+    }
+
+    if (!capture_.retrieve(decodeBuffer_) || decodeBuffer_.empty()) return false;
+    if (rawYuyv_) {
+        // Unconverted V4L2 buffers come back as raw bytes: view them as Y/U, Y/V pairs
+        if (decodeBuffer_.total() * decodeBuffer_.elemSize() != static_cast<size_t>(yuyvSize_.area()) * 2 ||
+            !decodeBuffer_.isContinuous()) {
+            LOG_ERROR("Raw V4L2 buffer does not hold a {}x{} YUYV frame", yuyvSize_.width, yuyvSize_.height);
+            return false;
+        }
+        const cv::Mat yuyv(yuyvSize_, CV_8UC2, decodeBuffer_.data);
+        frame = pool_.acquire(yuyvSize_, CV_8UC1);
+        cv::extractChannel(yuyv, frame, 0);
+        return true;
+    }
+
+    frame = pool_.acquire(decodeBuffer_.size(), CV_8UC1);
+    if (decodeBuffer_.channels() == 1) {
+        decodeBuffer_.copyTo(frame);
+    } else {
+        cv::cvtColor(decodeBuffer_, frame,
+                     decodeBuffer_.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+    }
+    return true;
+}
+
+bool CaptureSource::readFromVectors(cv::Mat& frame) {
+    // Decoding is unavoidable (the vectors come out of the decoder); everything after it,
+    // the colour conversion included, only runs for the frames let through
+    for (;;) {
+        if (!vectorDecoder_->decode(vectorMap_)) return false;
+        vectorRegions_.clear();
+        const bool evidence = !vectorDecoder_->intraFrame() && vectorDecoder_->hasVectors();
+        if (evidence && vectorMap_.flag(config_.vectorMinMotion, config_.vectorIntraAsMotion) > 0) {
+            vectorRegions_ = vectorMap_.regions(config_.vectorMinBlocks);
+        }
+        ++framesSinceDelivered_;
+        const bool refresh =
+            config_.vectorRefreshFrames > 0 && framesSinceDelivered_ >= config_.vectorRefreshFrames;
+        // The first frame always goes through: it seeds the background model
+        if (evidence && vectorRegions_.empty() && !refresh && frameSize_.area() > 0) {
+            vectorSkippedFrames_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        framesSinceDelivered_ = 0;
+        break;
+    }
+    grabbedTimestampMs_ = vectorDecoder_->timestampMs();
+
+    if (!frameSize_.empty()) frame = pool_.acquire(frameSize_, config_.lumaOnly ? CV_8UC1 : CV_8UC3);
+    if (!vectorDecoder_->retrieve(frame, config_.lumaOnly) || frame.empty()) return false;
+    frameSize_ = frame.size();
+    frameType_ = frame.type();
+    return true;
+}
+
+bool CaptureSource::isLive() const {
+    if (!config_.gstreamerPipeline.empty()) return config_.gstreamerPipeline.find("filesrc") == std::string::npos;
+    return isDeviceIndex(config_.source) || isRtsp(config_.source) || config_.source.rfind("/dev/", 0) == 0;
+}
@@ -0,0 +1,124 @@
+#include "classification_batcher.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+#include "logger.hpp"
+#include "thread_placement.hpp"
+
+ClassificationBatcher::ClassificationBatcher(std::unique_ptr<RegionClassifier> classifier,
+                                             size_t maxBatch, std::chrono::microseconds maxDelay,
+                                             std::function<void()> onThreadStart)
+    : classifier_(std::move(classifier)),
+      maxBatch_(std::max<size_t>(1, maxBatch)),
+      maxDelay_(std::max(std::chrono::microseconds(0), maxDelay)),
+      onThreadStart_(std::move(onThreadStart)) {
+    if (!classifier_) throw std::invalid_argument("ClassificationBatcher: no RegionClassifier");
+    worker_ = std::thread([this] { run(); });
+    LOG_INFO("ClassificationBatcher initialized: batches of up to {} crops, max delay {} us",
+             maxBatch_, maxDelay_.count());
+}
+
+ClassificationBatcher::~ClassificationBatcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    worker_.join();
+}
+
+void ClassificationBatcher::submit(std::vector<cv::Mat> crops, Callback callback) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.requests++;
+        queuedCrops_ += crops.size();
+        queue_.push_back({std::move(crops), std::move(callback), std::chrono::steady_clock::now()});
+    }
+    wake_.notify_one();
+}
+
+void ClassificationBatcher::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    flushWaiters_++;
+    wake_.notify_one();
+    idle_.wait(lock, [this] { return stopping_ || (queue_.empty() && !busy_); });
+    flushWaiters_--;
+}
+
+ClassificationBatcherStats ClassificationBatcher::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ClassificationBatcherStats stats = stats_;
+    stats.queuedCrops = queuedCrops_;
+    return stats;
+}
+
+/**
+ * Waits for a full batch, the oldest request's deadline or a flush, then takes whole requests
+ * until the next one would overflow maxBatch (a single larger request is taken alone and split
+ * by the classifier). Inference and callbacks run unlocked so submitters never wait on them.
+ */
+void ClassificationBatcher::run() {
+    nameCurrentThread("classify");
+    if (onThreadStart_) onThreadStart_();
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        if (stopping_) break;
+
+        const auto deadline = queue_.front().arrival + maxDelay_;
+        wake_.wait_until(lock, deadline, [this] {
+            return stopping_ || flushWaiters_ > 0 || queuedCrops_ >= maxBatch_;
+        });
+        if (stopping_) break;
+
+        std::vector<Request> batch;
+        size_t cropCount = 0;
+        while (!queue_.empty()) {
+            const size_t next = queue_.front().crops.size();
+            if (!batch.empty() && cropCount + next > maxBatch_) break;
+            cropCount += next;
+            batch.push_back(std::move(queue_.front()));
+            queue_.pop_front();
+        }
+        queuedCrops_ -= cropCount;
+        busy_ = true;
+        lock.unlock();
+
+        std::vector<cv::Mat> crops;
+        crops.reserve(cropCount);
+        for (const Request& request : batch) {
+            crops.insert(crops.end(), request.crops.begin(), request.crops.end());
+        }
+        std::vector<RegionClassification> results;
+        if (!crops.empty()) results = classifier_->classifyCrops(crops);
+        results.resize(cropCount);
+        crops.clear();
+
+        auto next = results.begin();
+        for (Request& request : batch) {
+            std::vector<RegionClassification> slice(next, next + request.crops.size());
+            next += request.crops.size();
+            request.crops.clear();  // Release the frames before the callback stores the results
+            try {
+                if (request.callback) request.callback(slice);
+            } catch (const std::exception& e) {
+                LOG_ERROR("Classification callback failed: {}", e.what());
+            }
+        }
+
+        lock.lock();
+        stats_.crops += cropCount;
+        if (cropCount > 0) stats_.batches++;
+        busy_ = false;
+        if (queue_.empty()) idle_.notify_all();
+    }
+
+    stats_.discarded += queue_.size();
+    if (!queue_.empty()) LOG_WARN("ClassificationBatcher: discarding {} queued requests", queue_.size());
+    queue_.clear();
+    queuedCrops_ = 0;
+    idle_.notify_all();
+}
@@ -0,0 +1,95 @@
+#include "classification_cache.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <opencv2/imgproc.hpp>
+#include <unordered_set>
+
+namespace {
+
+constexpr int kThumbnailSize = 8;
+
+}  // namespace
+
+ClassificationCache::ClassificationCache(const ClassificationCacheConfig& config, float confidenceThreshold)
+    : config_(config), confidenceThreshold_(confidenceThreshold) {
+    config_.refreshIntervalFrames = std::max(0, config_.refreshIntervalFrames);
+    config_.uncertainRetryFrames = std::max(1, config_.uncertainRetryFrames);
+}
+
+bool ClassificationCache::needsClassification(int id, const cv::Mat& frame, const cv::Rect& box) {
+    auto it = entries_.find(id);
+    if (it == entries_.end()) {
+        stats_.newTracks++;
+        return true;
+    }
+    const ClassificationCacheEntry& entry = it->second;
+    const uint64_t age = frame_ - entry.frame;
+
+    if (!confident(entry)) {
+        if (age >= static_cast<uint64_t>(config_.uncertainRetryFrames)) {
+            stats_.retries++;
+            return true;
+        }
+        stats_.hits++;
+        return false;
+    }
+
+    bool stale = config_.refreshIntervalFrames > 0 && age >= static_cast<uint64_t>(config_.refreshIntervalFrames);
+    if (!stale) {
+        const double cachedArea = std::max(1, entry.box.area());
+        stale = std::abs(box.area() / cachedArea - 1.0) > config_.sizeChangeThreshold;
+    }
+    // Cheapest checks first: the thumbnail is only taken when the box still matches
+    if (!stale) {
+        stale = appearanceDistance(entry.appearance, thumbnail(frame, box)) > config_.appearanceChangeThreshold;
+    }
+    if (stale) {
+        stats_.refreshes++;
+        return true;
+    }
+    stats_.hits++;
+    return false;
+}
+
+void ClassificationCache::store(int id, const cv::Mat& frame, const cv::Rect& box, const std::string& label,
+                                float confidence, int classId) {
+    ClassificationCacheEntry& entry = entries_[id];
+    entry.label = classId >= 0 ? label : "unknown";
+    entry.confidence = classId >= 0 ? confidence : 0.0f;
+    entry.classId = classId;
+    entry.box = box;
+    entry.appearance = thumbnail(frame, box);
+    entry.frame = frame_;
+}
+
+const ClassificationCacheEntry* ClassificationCache::find(int id) const {
+    auto it = entries_.find(id);
+    return it == entries_.end() ? nullptr : &it->second;
+}
+
+void ClassificationCache::retain(const std::vector<int>& liveIds) {
+    if (entries_.empty()) return;
+    const std::unordered_set<int> live(liveIds.begin(), liveIds.end());
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        it = live.count(it->first) ? std::next(it) : entries_.erase(it);
+    }
+}
+
+double ClassificationCache::appearanceDistance(const cv::Mat& a, const cv::Mat& b) {
+    if (a.empty() || b.empty() || a.size() != b.size() || a.type() != b.type()) {
+        return 1.0;
+    }
+    return cv::norm(a, b, cv::NORM_L1) / (static_cast<double>(a.total() * a.channels()) * 255.0);
+}
+
+cv::Mat ClassificationCache::thumbnail(const cv::Mat& frame, const cv::Rect& box) {
+    const cv::Rect clipped = box & cv::Rect(cv::Point(), frame.size());
+    if (clipped.empty()) {
+        return cv::Mat();
+    }
+    cv::Mat small;
+    cv::resize(frame(clipped), small, cv::Size(kThumbnailSize, kThumbnailSize), 0, 0, cv::INTER_AREA);
+    return small;
+}
@@ -0,0 +1,69 @@
+#include "clustering_trace.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+#include "logger.hpp"
+
+namespace {
+
+constexpr char kMagic[8] = {'B', 'O', 'P', 'C', 'T', 'R', 'C', '1'};
+
+}  // namespace
+
+void ClusteringTrace::resize(size_t capacity) {
+    records_.assign(capacity, ClusteringTraceRecord{});
+    clear();
+}
+
+std::vector<ClusteringTraceRecord> ClusteringTrace::records() const {
+    const uint64_t recorded = next_;
+    const size_t count = static_cast<size_t>(std::min<uint64_t>(recorded, records_.size()));
+    std::vector<ClusteringTraceRecord> ordered;
+    ordered.reserve(count);
+    for (uint64_t i = recorded - count; i < recorded; ++i) ordered.push_back(records_[i % records_.size()]);
+    return ordered;
+}
+
+void ClusteringTrace::write(std::ostream& out) const {
+    const std::vector<ClusteringTraceRecord> ordered = records();
+    const uint32_t recordSize = sizeof(ClusteringTraceRecord);
+    const uint32_t count = static_cast<uint32_t>(ordered.size());
+    out.write(kMagic, sizeof(kMagic));
+    out.write(reinterpret_cast<const char*>(&recordSize), sizeof(recordSize));
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    out.write(reinterpret_cast<const char*>(ordered.data()),
+              static_cast<std::streamsize>(ordered.size() * sizeof(ClusteringTraceRecord)));
+}
+
+bool ClusteringTrace::write(const std::string& path) const {
+    const std::filesystem::path file(path);
+    std::error_code error;
+    if (file.has_parent_path()) std::filesystem::create_directories(file.parent_path(), error);
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    if (out) write(out);
+    if (!out) {
+        LOG_ERROR("Failed to write the clustering trace to {}", path);
+        return false;
+    }
+    LOG_INFO("Wrote {} clustering decisions to {}", std::min<uint64_t>(recorded(), capacity()), path);
+    return true;
+}
+
+void ClusteringTrace::requestDump(const std::string& path) {
+    std::lock_guard<std::mutex> lock(dumpMutex_);
+    dumpPath_ = path;
+    dumpRequested_.store(true, std::memory_order_release);
+}
+
+std::string ClusteringTrace::takeDumpRequest() {
+    // Checked once per frame, so the common case stays a single atomic load
+    if (!dumpRequested_.load(std::memory_order_acquire)) return {};
+    std::lock_guard<std::mutex> lock(dumpMutex_);
+    dumpRequested_.store(false, std::memory_order_relaxed);
+    std::string path;
+    path.swap(dumpPath_);
+    return path;
+}
@@ -0,0 +1,137 @@
+#include "config_watcher.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#include "logger.hpp"
+#include "thread_placement.hpp"
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// What the polling fallback compares between wake-ups
+struct FileStamp {
+    fs::file_time_type modified{};
+    std::uintmax_t size = 0;
+    bool operator!=(const FileStamp& other) const { return modified != other.modified || size != other.size; }
+};
+
+FileStamp stampOf(const std::string& path) {
+    std::error_code error;
+    FileStamp stamp;
+    stamp.modified = fs::last_write_time(path, error);
+    if (!error) stamp.size = fs::file_size(path, error);
+    return error ? FileStamp() : stamp;
+}
+
+#ifdef __linux__
+// Waits up to @p timeout for directory events; true if one of them names @p fileName
+bool waitForFileEvent(int fd, const std::string& fileName, std::chrono::milliseconds timeout) {
+    pollfd descriptor{fd, POLLIN, 0};
+    if (poll(&descriptor, 1, static_cast<int>(timeout.count())) <= 0) return false;
+
+    bool changed = false;
+    alignas(inotify_event) char buffer[4096];
+    ssize_t length;
+    while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+        for (char* cursor = buffer; cursor < buffer + length;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(cursor);
+            if (event->len > 0 && fileName == event->name) changed = true;
+            cursor += sizeof(inotify_event) + event->len;
+        }
+    }
+    return changed;
+}
+#endif
+
+}  // namespace
+
+ConfigWatcher::ConfigWatcher(SharedPipelineConfig& config, const ConfigWatchOptions& options)
+    : config_(config), options_(options) {
+    thread_ = std::thread([this] { run(); });
+}
+
+ConfigWatcher::~ConfigWatcher() {
+    stopping_ = true;
+    if (thread_.joinable()) thread_.join();
+}
+
+void ConfigWatcher::run() {
+    nameCurrentThread("config-watch");
+    const std::string path = config_.current()->path();
+    const bool watching = options_.watchFile && !path.empty();
+
+#ifdef __linux__
+    int inotifyFd = -1;
+    const std::string fileName = fs::path(path).filename().string();
+    if (watching) {
+        const fs::path directory = fs::path(path).has_parent_path() ? fs::path(path).parent_path() : fs::path(".");
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotifyFd >= 0 &&
+            inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+            const int error = errno;
+            close(inotifyFd);
+            inotifyFd = -1;
+            errno = error;
+        }
+        if (inotifyFd < 0) LOG_WARN("ConfigWatcher: inotify unavailable ({}), polling {}", std::strerror(errno), path);
+    }
+#endif
+    if (watching) LOG_INFO("ConfigWatcher: reloading {} when it changes", path);
+
+    FileStamp lastStamp = stampOf(path);
+    bool pending = false;  // Changed, waiting for the settle time
+    Clock::time_point changedAt;
+    while (!stopping_) {
+        const auto wait = pending ? std::min(options_.pollInterval, options_.settleTime) : options_.pollInterval;
+        bool changed = false;
+#ifdef __linux__
+        if (inotifyFd >= 0) {
+            changed = waitForFileEvent(inotifyFd, fileName, wait);
+        } else
+#endif
+        {
+            std::this_thread::sleep_for(wait);
+            if (watching) {
+                const FileStamp stamp = stampOf(path);
+                changed = stamp != lastStamp;
+                lastStamp = stamp;
+            }
+        }
+        if (changed) {
+            pending = true;
+            changedAt = Clock::now();
+        }
+        if (pending && Clock::now() - changedAt >= options_.settleTime) {
+            pending = false;
+            reload();
+        }
+        if (reloadRequested_.exchange(false, std::memory_order_acq_rel)) reload();
+    }
+
+#ifdef __linux__
+    if (inotifyFd >= 0) close(inotifyFd);
+#endif
+}
+
+void ConfigWatcher::reload() {
+    if (config_.reload()) {
+        reloads_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,37 @@
+#include "contour_filter.hpp"
+
+#include <opencv2/imgproc.hpp>
+
+ContourFilter::ContourFilter(const Settings& settings) : settings_(settings) {}
+
+void ContourFilter::begin(const Thresholds& thresholds) {
+    thresholds_ = thresholds;
+    counts_ = Counts();
+}
+
+ContourFilter::Verdict ContourFilter::evaluate(const std::vector<cv::Point>& contour, double areaScale,
+                                               Candidate& candidate) {
+    const double pixels = cv::contourArea(contour);
+    candidate.area = pixels * areaScale;
+    candidate.bounds = cv::Rect();
+    candidate.solidity = -1.0;
+    // The area test needs nothing else, so approximation waits until it has passed
+    if (candidate.area < thresholds_.minArea) {
+        double unused;
+        return check(candidate.area, candidate.bounds, [] { return 1.0; }, unused);
+    }
+
+    const std::vector<cv::Point>* outline = &contour;
+    if (settings_.approximation) {
+        cv::approxPolyDP(contour, approx_, settings_.epsilonFactor * cv::arcLength(contour, true), true);
+        outline = &approx_;
+    }
+    // The hull's bounding rectangle is the outline's, so the box is known before the hull is
+    candidate.bounds = cv::boundingRect(*outline);
+    auto solidity = [&] {
+        cv::convexHull(*outline, hull_);
+        const double hullArea = cv::contourArea(hull_);
+        return hullArea > 0 ? pixels / hullArea : 0.0;
+    };
+    return check(candidate.area, candidate.bounds, solidity, candidate.solidity);
+}
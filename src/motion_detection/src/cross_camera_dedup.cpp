@@ -0,0 +1,272 @@
+#include "cross_camera_dedup.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <opencv2/imgproc.hpp>
+#include <utility>
+
+#include "logger.hpp"
+
+namespace {
+
+// Bounding box of @p box mapped through @p homography (empty if it crosses the horizon)
+cv::Rect project(const cv::Matx33d& homography, const cv::Rect& box) {
+    double minX = 0.0, minY = 0.0, maxX = 0.0, maxY = 0.0;
+    const cv::Point2d corners[] = {{static_cast<double>(box.x), static_cast<double>(box.y)},
+                                   {static_cast<double>(box.x + box.width), static_cast<double>(box.y)},
+                                   {static_cast<double>(box.x), static_cast<double>(box.y + box.height)},
+                                   {static_cast<double>(box.x + box.width), static_cast<double>(box.y + box.height)}};
+    for (size_t i = 0; i < 4; ++i) {
+        const cv::Vec3d mapped = homography * cv::Vec3d(corners[i].x, corners[i].y, 1.0);
+        if (mapped[2] <= 1e-9) return cv::Rect();
+        const double x = mapped[0] / mapped[2];
+        const double y = mapped[1] / mapped[2];
+        minX = i == 0 ? x : std::min(minX, x);
+        minY = i == 0 ? y : std::min(minY, y);
+        maxX = i == 0 ? x : std::max(maxX, x);
+        maxY = i == 0 ? y : std::max(maxY, y);
+    }
+    return cv::Rect(cv::Point(static_cast<int>(std::floor(minX)), static_cast<int>(std::floor(minY))),
+                    cv::Point(static_cast<int>(std::ceil(maxX)), static_cast<int>(std::ceil(maxY))));
+}
+
+double iou(const cv::Rect& a, const cv::Rect& b) {
+    const double overlap = (a & b).area();
+    if (overlap <= 0.0) return 0.0;
+    return overlap / (static_cast<double>(a.area()) + b.area() - overlap);
+}
+
+}  // namespace
+
+CameraPairCalibration CameraPairCalibration::fromPlane(size_t streamA, const cv::Matx33d& aToPlane, size_t streamB,
+                                                       const cv::Matx33d& bToPlane) {
+    CameraPairCalibration pair;
+    pair.streamA = streamA;
+    pair.streamB = streamB;
+    pair.homography = bToPlane.inv() * aToPlane;
+    return pair;
+}
+
+// Regions of one moment seen by several cameras; members are pending until decided
+struct CrossCameraDeduplicator::Group {
+    bool decided = false;
+    RegionViewRef best;
+    std::vector<std::pair<Entry*, size_t>> members;
+};
+
+struct CrossCameraDeduplicator::Entry {
+    size_t stream = 0;
+    uint64_t sequence = 0;
+    Clock::time_point captured;
+    Clock::time_point arrived;
+    cv::Mat frame;
+    std::vector<ConsolidatedRegion> regions;
+    std::vector<CrossCameraLinks> links;           // Parallel to regions
+    std::vector<std::shared_ptr<Group>> groups;    // Parallel to regions; null = not linked
+
+    RegionViewRef ref(size_t region) const { return RegionViewRef{stream, sequence, region}; }
+};
+
+CrossCameraDeduplicator::CrossCameraDeduplicator(CrossCameraConfig config, Release release)
+    : config_(std::move(config)), release_(std::move(release)) {
+    size_t streams = 0;
+    for (const CameraPairCalibration& pair : config_.pairs) {
+        streams = std::max({streams, pair.streamA + 1, pair.streamB + 1});
+    }
+    peers_.resize(streams);
+    for (const CameraPairCalibration& pair : config_.pairs) {
+        if (pair.streamA == pair.streamB) continue;
+        peers_[pair.streamA].push_back({pair.streamB, pair.homography});
+        peers_[pair.streamB].push_back({pair.streamA, pair.homography.inv()});
+    }
+    pending_.resize(streams);
+    latest_.resize(streams);
+}
+
+CrossCameraDeduplicator::~CrossCameraDeduplicator() = default;
+
+bool CrossCameraDeduplicator::covers(size_t stream) const {
+    return stream < peers_.size() && !peers_[stream].empty();
+}
+
+double CrossCameraDeduplicator::viewScore(const cv::Mat& frame, const cv::Rect& box, int sharpnessSide) {
+    const cv::Rect clipped = box & cv::Rect(0, 0, frame.cols, frame.rows);
+    if (clipped.area() <= 0) return 0.0;
+    cv::Mat gray;
+    if (frame.channels() == 3) {
+        cv::cvtColor(frame(clipped), gray, cv::COLOR_BGR2GRAY);
+    } else {
+        gray = frame(clipped);
+    }
+    const int side = std::max(8, sharpnessSide);
+    const double scale = std::min(1.0, static_cast<double>(side) / std::max(gray.cols, gray.rows));
+    if (scale < 1.0) {
+        cv::Mat small;
+        cv::resize(gray, small, cv::Size(), scale, scale, cv::INTER_AREA);
+        gray = small;
+    }
+    cv::Mat laplacian;
+    cv::Laplacian(gray, laplacian, CV_32F);
+    cv::Scalar mean, stddev;
+    cv::meanStdDev(laplacian, mean, stddev);
+    return static_cast<double>(box.area()) * stddev[0];
+}
+
+void CrossCameraDeduplicator::offer(size_t stream, uint64_t sequence, Clock::time_point captured, cv::Mat frame,
+                                    std::vector<ConsolidatedRegion> regions) {
+    auto entry = std::make_unique<Entry>();
+    entry->stream = stream;
+    entry->sequence = sequence;
+    entry->captured = captured;
+    entry->arrived = Clock::now();
+    entry->links.resize(regions.size());
+    entry->groups.resize(regions.size());
+    // Scored outside the lock: it reads pixels
+    if (covers(stream)) {
+        for (size_t i = 0; i < regions.size(); ++i) {
+            entry->links[i].viewScore = viewScore(frame, regions[i].boundingBox, config_.sharpnessSide);
+        }
+    }
+    entry->frame = std::move(frame);
+    entry->regions = std::move(regions);
+
+    std::vector<std::unique_ptr<Entry>> released;
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!covers(stream)) {
+        released.push_back(std::move(entry));  // Not in any pair: straight through
+    } else {
+        link(*entry);
+        latest_[stream] = latest_[stream] ? std::max(*latest_[stream], captured) : captured;
+        pending_[stream].push_back(std::move(entry));
+    }
+    collect(false, Clock::now(), released);
+    deliver(lock, released);
+}
+
+void CrossCameraDeduplicator::flush() {
+    std::vector<std::unique_ptr<Entry>> released;
+    std::unique_lock<std::mutex> lock(mutex_);
+    collect(true, Clock::now(), released);
+    deliver(lock, released);
+}
+
+CrossCameraStats CrossCameraDeduplicator::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void CrossCameraDeduplicator::link(Entry& entry) {
+    const auto join = [](Entry& a, size_t i, Entry& b, size_t j) {
+        std::shared_ptr<Group>& ga = a.groups[i];
+        std::shared_ptr<Group>& gb = b.groups[j];
+        if (ga && ga == gb) return;
+        if (!ga && !gb) {
+            ga = gb = std::make_shared<Group>();
+            ga->members = {{&a, i}, {&b, j}};
+            return;
+        }
+        // Join the decided group, or the larger one
+        const bool aFirst = !gb || (ga && (ga->decided || (!gb->decided && ga->members.size() >= gb->members.size())));
+        std::shared_ptr<Group> target = aFirst ? ga : gb;
+        std::shared_ptr<Group> other = aFirst ? gb : ga;
+        const std::pair<Entry*, size_t> joining = aFirst ? std::make_pair(&b, j) : std::make_pair(&a, i);
+        if (other && other->decided) return;  // Both chose their best view already
+        std::vector<std::pair<Entry*, size_t>> moving;
+        if (other) {
+            moving = std::move(other->members);
+        } else {
+            moving.push_back(joining);
+        }
+        for (const auto& [member, region] : moving) {
+            member->groups[region] = target;
+            if (target->decided) {
+                member->links[region].bestView = target->best;  // Late view of a bird already out
+            } else {
+                target->members.emplace_back(member, region);
+            }
+        }
+    };
+
+    const auto window = std::chrono::duration_cast<Clock::duration>(config_.maxTimeDelta);
+    for (const Peer& peer : peers_[entry.stream]) {
+        for (const auto& other : pending_[peer.stream]) {
+            const auto delta = entry.captured - other->captured;
+            if (delta > window || -delta > window) continue;
+            for (size_t i = 0; i < entry.regions.size(); ++i) {
+                const cv::Rect projected = project(peer.homography, entry.regions[i].boundingBox);
+                if (projected.area() <= 0) continue;
+                for (size_t j = 0; j < other->regions.size(); ++j) {
+                    if (iou(projected, other->regions[j].boundingBox) >= config_.minIou) join(entry, i, *other, j);
+                }
+            }
+        }
+    }
+}
+
+bool CrossCameraDeduplicator::ready(const Entry& entry) const {
+    const auto window = std::chrono::duration_cast<Clock::duration>(config_.maxTimeDelta);
+    for (const Peer& peer : peers_[entry.stream]) {
+        // Frames of a stream come in capture order: a later one means the simultaneous ones are in
+        if (!latest_[peer.stream] || *latest_[peer.stream] < entry.captured + window) return false;
+    }
+    return true;
+}
+
+void CrossCameraDeduplicator::collect(bool all, Clock::time_point now, std::vector<std::unique_ptr<Entry>>& out) {
+    const auto maxWait = std::chrono::duration_cast<Clock::duration>(config_.maxWait);
+    for (auto& queue : pending_) {
+        while (!queue.empty()) {
+            Entry& entry = *queue.front();
+            const bool complete = ready(entry);
+            if (!all && !complete && now - entry.arrived < maxWait) break;
+            if (!complete && !all) stats_.timedOut++;
+            decide(entry);
+            out.push_back(std::move(queue.front()));
+            queue.pop_front();
+        }
+    }
+    for (const auto& entry : out) {
+        stats_.results++;
+        for (size_t i = 0; i < entry->regions.size(); ++i) {
+            if (entry->groups[i]) stats_.linkedRegions++;
+            if (entry->links[i].isDuplicate()) stats_.duplicates++;
+        }
+    }
+}
+
+void CrossCameraDeduplicator::decide(Entry& entry) {
+    for (size_t i = 0; i < entry.regions.size(); ++i) {
+        const std::shared_ptr<Group>& group = entry.groups[i];
+        if (!group || group->decided) continue;
+        // Largest and sharpest view; ties go to the lower stream
+        const auto best = std::max_element(group->members.begin(), group->members.end(), [](const auto& a, const auto& b) {
+            const double scoreA = a.first->links[a.second].viewScore;
+            const double scoreB = b.first->links[b.second].viewScore;
+            return scoreA < scoreB || (scoreA == scoreB && a.first->stream > b.first->stream);
+        });
+        group->decided = true;
+        group->best = best->first->ref(best->second);
+        for (const auto& [member, region] : group->members) {
+            if (member == best->first && region == best->second) continue;
+            member->links[region].bestView = group->best;
+            best->first->links[best->second].otherViews.push_back(member->ref(region));
+        }
+        group->members.clear();  // Released entries are not referenced past this point
+    }
+}
+
+void CrossCameraDeduplicator::deliver(std::unique_lock<std::mutex>& lock,
+                                      std::vector<std::unique_ptr<Entry>>& released) {
+    if (released.empty()) return;
+    std::lock_guard<std::mutex> delivering(deliverMutex_);
+    lock.unlock();
+    for (const auto& entry : released) {
+        try {
+            release_(entry->stream, entry->sequence, entry->frame, entry->regions, entry->links);
+        } catch (const std::exception& e) {
+            LOG_ERROR("Cross-camera dedup: delivering stream {} frame {} failed: {}", entry->stream,
+                      entry->sequence, e.what());
+        }
+    }
+}
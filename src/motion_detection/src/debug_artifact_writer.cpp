@@ -0,0 +1,94 @@
+#include "debug_artifact_writer.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <opencv2/imgcodecs.hpp>
+
+#include "logger.hpp"
+#include "thread_placement.hpp"
+
+namespace fs = std::filesystem;
+
+DebugArtifactWriter::DebugArtifactWriter(size_t queueCapacity)
+    : queue_(queueCapacity, BackpressurePolicy::DropNewest) {}
+
+DebugArtifactWriter::~DebugArtifactWriter() {
+    queue_.close();  // The worker writes what is left, then exits
+    if (worker_.joinable()) worker_.join();
+}
+
+DebugArtifactWriter& DebugArtifactWriter::shared() {
+    static DebugArtifactWriter writer;
+    return writer;
+}
+
+void DebugArtifactWriter::setSampleEvery(int everyN) { sampleEvery_ = std::max(1, everyN); }
+
+bool DebugArtifactWriter::submit(const std::string& path, cv::Mat image) {
+    if (image.empty() || path.empty()) return false;
+    if (submitted_++ % static_cast<uint64_t>(sampleEvery_.load()) != 0) {
+        skipped_++;
+        return false;
+    }
+    ensureStarted();
+
+    {
+        std::lock_guard<std::mutex> lock(flushMutex_);
+        pending_++;
+    }
+    if (!queue_.push({path, std::move(image)})) {
+        std::lock_guard<std::mutex> lock(flushMutex_);
+        pending_--;
+        return false;  // Full: counted by the queue as dropped
+    }
+    return true;
+}
+
+void DebugArtifactWriter::flush() {
+    std::unique_lock<std::mutex> lock(flushMutex_);
+    flushed_.wait(lock, [this] { return pending_ == 0; });
+}
+
+DebugArtifactStats DebugArtifactWriter::getStats() const {
+    DebugArtifactStats stats;
+    stats.written = written_.load();
+    stats.dropped = queue_.droppedCount();
+    stats.skipped = skipped_.load();
+    stats.failed = failed_.load();
+    stats.queued = queue_.size();
+    return stats;
+}
+
+void DebugArtifactWriter::ensureStarted() {
+    std::call_once(started_, [this] { worker_ = std::thread(&DebugArtifactWriter::run, this); });
+}
+
+void DebugArtifactWriter::run() {
+    nameCurrentThread("debug-images");
+    while (auto artifact = queue_.pop()) {
+        bool ok = false;
+        try {
+            const std::string directory = fs::path(artifact->path).parent_path().string();
+            if (!directory.empty() && createdDirectories_.insert(directory).second) {
+                std::error_code ec;
+                fs::create_directories(directory, ec);
+            }
+            ok = cv::imwrite(artifact->path, artifact->image);
+        } catch (const cv::Exception& e) {
+            LOG_DEBUG_LIMITED("Debug artifact {} failed: {}", artifact->path, e.what());
+        }
+        if (ok) {
+            written_++;
+            LOG_DEBUG_LIMITED("Saved debug artifact: {}", artifact->path);
+        } else {
+            failed_++;
+            LOG_DEBUG_LIMITED("Could not write debug artifact: {}", artifact->path);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(flushMutex_);
+            pending_--;
+        }
+        flushed_.notify_all();
+    }
+}
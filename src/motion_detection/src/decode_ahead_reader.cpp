@@ -0,0 +1,347 @@
+#include "decode_ahead_reader.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "logger.hpp"
+
+#ifndef BIRDS_HAVE_LIBAV
+#define BIRDS_HAVE_LIBAV 0
+#endif
+
+#if BIRDS_HAVE_LIBAV
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libswscale/swscale.h>
+}
+
+namespace {
+
+std::string avError(int code) {
+    char text[AV_ERROR_MAX_STRING_SIZE] = {};
+    av_strerror(code, text, sizeof(text));
+    return text;
+}
+
+// Layouts whose first plane is the 8-bit luma
+bool lumaPlaneFirst(int format) {
+    switch (format) {
+        case AV_PIX_FMT_YUV420P:
+        case AV_PIX_FMT_YUVJ420P:
+        case AV_PIX_FMT_YUV422P:
+        case AV_PIX_FMT_YUVJ422P:
+        case AV_PIX_FMT_YUV444P:
+        case AV_PIX_FMT_YUVJ444P:
+        case AV_PIX_FMT_NV12:
+        case AV_PIX_FMT_GRAY8:
+            return true;
+        default:
+            return false;
+    }
+}
+
+}  // namespace
+
+struct DecodeAheadReader::Impl {
+    explicit Impl(FrameBufferPool& framePool) : pool(framePool) {}
+    ~Impl() { close(); }
+
+    struct Decoded {
+        cv::Mat frame;
+        double timestampMs = 0.0;
+        uint64_t skippedBefore = 0;
+    };
+
+    FrameBufferPool& pool;
+    DecodeAheadConfig config;
+
+    // Decode thread only (after open)
+    AVFormatContext* format = nullptr;
+    AVCodecContext* codec = nullptr;
+    AVPacket* packet = nullptr;
+    AVFrame* frame = nullptr;
+    SwsContext* scaler = nullptr;
+    int streamIndex = -1;
+    cv::Size size;  // From the stream parameters, so the consumer never reads the codec
+    double frameRate = 0.0;
+    bool draining = false;
+    int appliedStride = 1;
+    int64_t outputIndex = -1;  // Frames out of the decoder (source index without a usable PTS)
+    int64_t lastQueued = -1;   // Source index of the last queued frame
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Decoded> queue;
+    bool finished = false;
+    bool stopping = false;
+
+    std::atomic<int> stride{1};
+    std::atomic<uint64_t> decoded{0};
+    std::atomic<uint64_t> skipped{0};
+
+    // Consumer side
+    double timestampMs = 0.0;
+    uint64_t skippedBefore = 0;
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        if (thread.joinable()) thread.join();
+        queue.clear();
+        sws_freeContext(scaler);
+        scaler = nullptr;
+        av_frame_free(&frame);
+        av_packet_free(&packet);
+        avcodec_free_context(&codec);
+        avformat_close_input(&format);
+        streamIndex = -1;
+    }
+
+    void run();
+    bool decodeNext();
+    int64_t sourceIndex() const;
+    bool convert(cv::Mat& out);
+};
+
+void DecodeAheadReader::Impl::run() {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return stopping || queue.size() < config.lookaheadFrames; });
+            if (stopping) break;
+        }
+        const int wanted = std::max(1, stride.load(std::memory_order_relaxed));
+        if (wanted != appliedStride) {
+            // Frame threads pick the new setting up with the next packet
+            codec->skip_frame = wanted > 1 ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+            appliedStride = wanted;
+        }
+        if (!decodeNext()) break;
+        decoded.fetch_add(1, std::memory_order_relaxed);
+
+        const int64_t index = sourceIndex();
+        const int64_t gap = lastQueued < 0 ? 1 : index - lastQueued;
+        if (lastQueued >= 0 && gap < appliedStride) continue;  // Shed before any conversion
+
+        Decoded entry;
+        if (!convert(entry.frame)) break;
+        entry.timestampMs = frame->best_effort_timestamp == AV_NOPTS_VALUE
+                                ? 0.0
+                                : static_cast<double>(frame->best_effort_timestamp) *
+                                      av_q2d(format->streams[streamIndex]->time_base) * 1000.0;
+        entry.skippedBefore = static_cast<uint64_t>(std::max<int64_t>(0, gap - 1));
+        skipped.fetch_add(entry.skippedBefore, std::memory_order_relaxed);
+        lastQueued = index;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(std::move(entry));
+        }
+        changed.notify_all();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+    }
+    changed.notify_all();
+}
+
+bool DecodeAheadReader::Impl::decodeNext() {
+    for (;;) {
+        int result = avcodec_receive_frame(codec, frame);
+        if (result == 0) {
+            outputIndex++;
+            return true;
+        }
+        if (result != AVERROR(EAGAIN)) {
+            if (result != AVERROR_EOF) LOG_ERROR("Video decode failed: {}", avError(result));
+            return false;
+        }
+        if (draining) return false;
+        result = av_read_frame(format, packet);
+        if (result < 0) {
+            draining = true;
+            avcodec_send_packet(codec, nullptr);  // Flush the frames the threads still hold
+            continue;
+        }
+        if (packet->stream_index == streamIndex) {
+            result = avcodec_send_packet(codec, packet);
+            if (result < 0) LOG_DEBUG("Dropped a video packet the decoder rejected: {}", avError(result));
+        }
+        av_packet_unref(packet);
+    }
+}
+
+// Position in the source's frame sequence: from the PTS at the container's frame rate, so
+// frames the decoder discarded still count
+int64_t DecodeAheadReader::Impl::sourceIndex() const {
+    if (frameRate <= 0.0 || frame->best_effort_timestamp == AV_NOPTS_VALUE) return outputIndex;
+    const double seconds =
+        static_cast<double>(frame->best_effort_timestamp) * av_q2d(format->streams[streamIndex]->time_base);
+    return std::llround(seconds * frameRate);
+}
+
+bool DecodeAheadReader::Impl::convert(cv::Mat& out) {
+    const AVFrame& source = *frame;
+    const cv::Size size(source.width, source.height);
+    if (size.area() <= 0 || !source.data[0]) return false;
+    out = pool.acquire(size, config.lumaOnly ? CV_8UC1 : CV_8UC3);
+    if (config.lumaOnly && lumaPlaneFirst(source.format)) {
+        for (int y = 0; y < size.height; ++y) {
+            std::memcpy(out.ptr<uchar>(y), source.data[0] + static_cast<ptrdiff_t>(y) * source.linesize[0],
+                        size.width);
+        }
+        return true;
+    }
+    scaler = sws_getCachedContext(scaler, size.width, size.height, static_cast<AVPixelFormat>(source.format),
+                                  size.width, size.height, config.lumaOnly ? AV_PIX_FMT_GRAY8 : AV_PIX_FMT_BGR24,
+                                  SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!scaler) {
+        LOG_ERROR("swscale cannot convert the decoder's pixel format {}", source.format);
+        return false;
+    }
+    uint8_t* planes[4] = {out.data, nullptr, nullptr, nullptr};
+    int strides[4] = {static_cast<int>(out.step), 0, 0, 0};
+    sws_scale(scaler, source.data, source.linesize, 0, size.height, planes, strides);
+    return true;
+}
+
+DecodeAheadReader::DecodeAheadReader(FrameBufferPool& pool) : impl_(std::make_unique<Impl>(pool)) {}
+DecodeAheadReader::~DecodeAheadReader() = default;
+
+bool DecodeAheadReader::available() { return true; }
+
+bool DecodeAheadReader::open(const std::string& path, const DecodeAheadConfig& config) {
+    close();
+    Impl& d = *impl_;
+    d.config = config;
+    d.config.lookaheadFrames = std::max<size_t>(1, config.lookaheadFrames);
+    int result = avformat_open_input(&d.format, path.c_str(), nullptr, nullptr);
+    if (result < 0) {
+        LOG_ERROR("libav could not open '{}': {}", path, avError(result));
+        return false;
+    }
+    if ((result = avformat_find_stream_info(d.format, nullptr)) < 0) {
+        LOG_ERROR("libav found no stream info in '{}': {}", path, avError(result));
+        d.close();
+        return false;
+    }
+    d.streamIndex = av_find_best_stream(d.format, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (d.streamIndex < 0) {
+        LOG_ERROR("'{}' has no video stream", path);
+        d.close();
+        return false;
+    }
+    const AVStream* stream = d.format->streams[d.streamIndex];
+    const AVCodec* decoder = avcodec_find_decoder(stream->codecpar->codec_id);
+    if (!decoder) {
+        LOG_ERROR("libav has no decoder for the video stream of '{}'", path);
+        d.close();
+        return false;
+    }
+    d.codec = avcodec_alloc_context3(decoder);
+    result = d.codec ? avcodec_parameters_to_context(d.codec, stream->codecpar) : AVERROR(ENOMEM);
+    if (result >= 0) {
+        d.codec->thread_count = std::max(0, config.threads);
+        d.codec->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+        result = avcodec_open2(d.codec, decoder, nullptr);
+    }
+    d.packet = av_packet_alloc();
+    d.frame = av_frame_alloc();
+    if (result < 0 || !d.packet || !d.frame) {
+        LOG_ERROR("Could not open the {} decoder for '{}': {}", decoder->name, path, avError(result));
+        d.close();
+        return false;
+    }
+    const AVRational rate = stream->avg_frame_rate;
+    d.frameRate = rate.num > 0 && rate.den > 0 ? av_q2d(rate) : 0.0;
+    d.size = cv::Size(d.codec->width, d.codec->height);
+    d.draining = false;
+    d.appliedStride = 1;
+    d.outputIndex = -1;
+    d.lastQueued = -1;
+    d.finished = false;
+    d.stopping = false;
+    d.decoded.store(0, std::memory_order_relaxed);
+    d.skipped.store(0, std::memory_order_relaxed);
+    d.timestampMs = 0.0;
+    d.skippedBefore = 0;
+    d.thread = std::thread([&d] { d.run(); });
+    const int threading = d.codec->active_thread_type;
+    LOG_INFO("Decoding '{}' ahead with libavcodec {}: {} thread(s) ({}), {} frames of lookahead", path,
+             decoder->name, d.codec->thread_count,
+             (threading & FF_THREAD_FRAME) ? "frame" : (threading & FF_THREAD_SLICE) ? "slice" : "single",
+             d.config.lookaheadFrames);
+    return true;
+}
+
+bool DecodeAheadReader::isOpened() const { return impl_->codec != nullptr; }
+
+void DecodeAheadReader::close() { impl_->close(); }
+
+bool DecodeAheadReader::read(cv::Mat& frame) {
+    Impl& d = *impl_;
+    if (!d.codec) return false;
+    Impl::Decoded entry;
+    {
+        std::unique_lock<std::mutex> lock(d.mutex);
+        d.changed.wait(lock, [&] { return !d.queue.empty() || d.finished; });
+        if (d.queue.empty()) return false;
+        entry = std::move(d.queue.front());
+        d.queue.pop_front();
+    }
+    d.changed.notify_all();  // Room for the decoder
+    frame = std::move(entry.frame);
+    d.timestampMs = entry.timestampMs;
+    d.skippedBefore = entry.skippedBefore;
+    return true;
+}
+
+double DecodeAheadReader::timestampMs() const { return impl_->timestampMs; }
+uint64_t DecodeAheadReader::skippedBefore() const { return impl_->skippedBefore; }
+
+void DecodeAheadReader::setStride(int stride) { impl_->stride.store(std::max(1, stride), std::memory_order_relaxed); }
+
+cv::Size DecodeAheadReader::frameSize() const { return impl_->codec ? impl_->size : cv::Size(); }
+
+double DecodeAheadReader::fps() const { return impl_->frameRate; }
+uint64_t DecodeAheadReader::decodedFrames() const { return impl_->decoded.load(std::memory_order_relaxed); }
+uint64_t DecodeAheadReader::skippedFrames() const { return impl_->skipped.load(std::memory_order_relaxed); }
+
+#else  // !BIRDS_HAVE_LIBAV
+
+struct DecodeAheadReader::Impl {};
+
+DecodeAheadReader::DecodeAheadReader(FrameBufferPool&) : impl_(std::make_unique<Impl>()) {}
+DecodeAheadReader::~DecodeAheadReader() = default;
+
+bool DecodeAheadReader::available() { return false; }
+
+bool DecodeAheadReader::open(const std::string& path, const DecodeAheadConfig&) {
+    LOG_ERROR("Cannot decode '{}' ahead: built without libav (ENABLE_FFMPEG_MOTION_VECTORS)", path);
+    return false;
+}
+
+bool DecodeAheadReader::isOpened() const { return false; }
+void DecodeAheadReader::close() {}
+bool DecodeAheadReader::read(cv::Mat&) { return false; }
+double DecodeAheadReader::timestampMs() const { return 0.0; }
+uint64_t DecodeAheadReader::skippedBefore() const { return 0; }
+void DecodeAheadReader::setStride(int) {}
+cv::Size DecodeAheadReader::frameSize() const { return cv::Size(); }
+double DecodeAheadReader::fps() const { return 0.0; }
+uint64_t DecodeAheadReader::decodedFrames() const { return 0; }
+uint64_t DecodeAheadReader::skippedFrames() const { return 0; }
+
+#endif  // BIRDS_HAVE_LIBAV
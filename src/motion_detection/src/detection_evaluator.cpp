@@ -0,0 +1,185 @@
+#include "detection_evaluator.hpp"
+
+#include <yaml-cpp/yaml.h>
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#include "box_capture.hpp"
+#include "motion_region_consolidator.hpp"
+
+namespace {
+
+double intersectionOverUnion(const cv::Rect& a, const cv::Rect& b) {
+    const double overlap = (a & b).area();
+    const double combined = static_cast<double>(a.area()) + b.area() - overlap;
+    return combined > 0 ? overlap / combined : 0.0;
+}
+
+// [[x, y, width, height], ...]
+std::vector<cv::Rect> parseBoxes(const YAML::Node& node) {
+    if (!node.IsSequence()) throw std::invalid_argument("expected a list of [x, y, width, height] boxes");
+    std::vector<cv::Rect> boxes;
+    boxes.reserve(node.size());
+    for (const auto& box : node) {
+        if (!box.IsSequence() || box.size() != 4) throw std::invalid_argument("a box is [x, y, width, height]");
+        boxes.emplace_back(box[0].as<int>(), box[1].as<int>(), box[2].as<int>(), box[3].as<int>());
+    }
+    return boxes;
+}
+
+bool hasBoxCaptureExtension(const std::string& path) {
+    const std::string extension = ".bobx";
+    return path.size() >= extension.size() &&
+           path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+}  // namespace
+
+double DetectionScore::recall() const {
+    const uint64_t truth = truePositives + falseNegatives;
+    return truth > 0 ? static_cast<double>(truePositives) / static_cast<double>(truth) : 1.0;
+}
+
+double DetectionScore::precision() const {
+    const uint64_t detections = matchedDetections + falsePositives;
+    return detections > 0 ? static_cast<double>(matchedDetections) / static_cast<double>(detections) : 1.0;
+}
+
+double DetectionScore::meanOverlap() const {
+    return truePositives > 0 ? overlapSum / static_cast<double>(truePositives) : 0.0;
+}
+
+void DetectionScore::add(const DetectionScore& other) {
+    truePositives += other.truePositives;
+    falseNegatives += other.falseNegatives;
+    matchedDetections += other.matchedDetections;
+    falsePositives += other.falsePositives;
+    overlapSum += other.overlapSum;
+}
+
+DetectionScore DetectionScore::match(const std::vector<cv::Rect>& detections, const std::vector<cv::Rect>& truth,
+                                     double minIou) {
+    struct Pair {
+        double iou;
+        size_t detection;
+        size_t truth;
+    };
+    std::vector<Pair> pairs;
+    for (size_t d = 0; d < detections.size(); ++d) {
+        for (size_t t = 0; t < truth.size(); ++t) {
+            const double iou = intersectionOverUnion(detections[d], truth[t]);
+            if (iou > 0.0 && iou >= minIou) pairs.push_back({iou, d, t});
+        }
+    }
+    std::stable_sort(pairs.begin(), pairs.end(), [](const Pair& a, const Pair& b) { return a.iou > b.iou; });
+
+    std::vector<bool> detectionUsed(detections.size(), false);
+    std::vector<bool> truthUsed(truth.size(), false);
+    DetectionScore score;
+    for (const Pair& pair : pairs) {
+        if (detectionUsed[pair.detection] || truthUsed[pair.truth]) continue;
+        detectionUsed[pair.detection] = true;
+        truthUsed[pair.truth] = true;
+        ++score.truePositives;
+        score.overlapSum += pair.iou;
+    }
+    score.matchedDetections = score.truePositives;
+    score.falsePositives = detections.size() - score.matchedDetections;
+    score.falseNegatives = truth.size() - score.truePositives;
+    return score;
+}
+
+DetectionScore DetectionScore::cover(const std::vector<cv::Rect>& regions, const std::vector<cv::Rect>& truth,
+                                     double minCoverage) {
+    DetectionScore score;
+    std::vector<bool> regionUsed(regions.size(), false);
+    for (const cv::Rect& box : truth) {
+        double best = 0.0;
+        for (size_t r = 0; r < regions.size(); ++r) {
+            const double covered =
+                box.area() > 0 ? static_cast<double>((box & regions[r]).area()) / box.area() : 0.0;
+            if (covered > 0.0 && covered >= minCoverage) regionUsed[r] = true;
+            best = std::max(best, covered);
+        }
+        if (best > 0.0 && best >= minCoverage) {
+            ++score.truePositives;
+            score.overlapSum += best;
+        } else {
+            ++score.falseNegatives;
+        }
+    }
+    score.matchedDetections = static_cast<uint64_t>(std::count(regionUsed.begin(), regionUsed.end(), true));
+    score.falsePositives = regions.size() - score.matchedDetections;
+    return score;
+}
+
+GroundTruth GroundTruth::load(const std::string& path) {
+    GroundTruth truth;
+    if (hasBoxCaptureExtension(path)) {
+        const BoxCapture capture = BoxCapture::open(path);
+        for (size_t i = 0; i < capture.size(); ++i) {
+            const BoxCaptureFrame frame = capture.frame(i);
+            AnnotatedFrame annotation;
+            frame.copyTo(annotation.boxes);
+            truth.add(frame.frameIndex, std::move(annotation));
+        }
+        return truth;
+    }
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("Cannot read " + path);
+    return parse(in, path);
+}
+
+GroundTruth GroundTruth::parse(std::istream& in, const std::string& source) {
+    GroundTruth truth;
+    std::string line;
+    for (size_t number = 1; std::getline(in, line); ++number) {
+        const size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') continue;
+        try {
+            // JSON is YAML flow syntax
+            const YAML::Node node = YAML::Load(line);
+            if (!node.IsMap() || !node["frame"] || !node["boxes"]) {
+                throw std::invalid_argument("expected {\"frame\": N, \"boxes\": [...]}");
+            }
+            AnnotatedFrame annotation;
+            annotation.boxes = parseBoxes(node["boxes"]);
+            if (node["regions"]) annotation.regions = parseBoxes(node["regions"]);
+            truth.add(node["frame"].as<int64_t>(), std::move(annotation));
+        } catch (const std::exception& e) {
+            throw std::runtime_error(source + ":" + std::to_string(number) + ": " + e.what());
+        }
+    }
+    return truth;
+}
+
+void GroundTruth::add(int64_t frame, AnnotatedFrame annotation) { frames_[frame] = std::move(annotation); }
+
+const AnnotatedFrame* GroundTruth::find(int64_t frame) const {
+    const auto it = frames_.find(frame);
+    return it == frames_.end() ? nullptr : &it->second;
+}
+
+DetectionEvaluator::DetectionEvaluator(const GroundTruth& truth, double minIou, double minCoverage)
+    : truth_(truth), minIou_(minIou), minCoverage_(minCoverage) {}
+
+bool DetectionEvaluator::addFrame(int64_t frame, const std::vector<cv::Rect>& boxes,
+                                  const std::vector<cv::Rect>& regions) {
+    const AnnotatedFrame* annotation = truth_.find(frame);
+    if (!annotation) return false;
+    report_.boxes.add(DetectionScore::match(boxes, annotation->boxes, minIou_));
+    report_.regions.add(annotation->regions ? DetectionScore::match(regions, *annotation->regions, minIou_)
+                                            : DetectionScore::cover(regions, annotation->boxes, minCoverage_));
+    ++report_.frames;
+    return true;
+}
+
+bool DetectionEvaluator::addFrame(int64_t frame, const std::vector<cv::Rect>& boxes,
+                                  const std::vector<ConsolidatedRegion>& regions) {
+    regionBoxes_.clear();
+    for (const ConsolidatedRegion& region : regions) regionBoxes_.push_back(region.boundingBox);
+    return addFrame(frame, boxes, regionBoxes_);
+}
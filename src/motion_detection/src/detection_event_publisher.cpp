@@ -0,0 +1,370 @@
+#include "detection_event_publisher.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "logger.hpp"
+#include "thread_placement.hpp"
+
+#if BIRDS_HAVE_ZMQ
+#include <zmq.h>
+#endif
+#if BIRDS_HAVE_MOSQUITTO
+#include <mosquitto.h>
+#endif
+
+namespace {
+
+// Big-endian, as MessagePack stores every multi-byte value
+template <typename T>
+void appendBigEndian(std::vector<uint8_t>& out, T value) {
+    for (int shift = 8 * (static_cast<int>(sizeof(T)) - 1); shift >= 0; shift -= 8) {
+        out.push_back(static_cast<uint8_t>(static_cast<uint64_t>(value) >> shift));
+    }
+}
+
+void appendArrayHeader(std::vector<uint8_t>& out, size_t size) {
+    if (size < 16) {
+        out.push_back(static_cast<uint8_t>(0x90 | size));
+    } else if (size <= 0xFFFF) {
+        out.push_back(0xdc);
+        appendBigEndian(out, static_cast<uint16_t>(size));
+    } else {
+        out.push_back(0xdd);
+        appendBigEndian(out, static_cast<uint32_t>(size));
+    }
+}
+
+void appendString(std::vector<uint8_t>& out, const std::string& value) {
+    const size_t size = value.size();
+    if (size < 32) {
+        out.push_back(static_cast<uint8_t>(0xa0 | size));
+    } else if (size <= 0xFF) {
+        out.push_back(0xd9);
+        out.push_back(static_cast<uint8_t>(size));
+    } else if (size <= 0xFFFF) {
+        out.push_back(0xda);
+        appendBigEndian(out, static_cast<uint16_t>(size));
+    } else {
+        out.push_back(0xdb);
+        appendBigEndian(out, static_cast<uint32_t>(size));
+    }
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+void appendInteger(std::vector<uint8_t>& out, int64_t value) {
+    if (value >= 0) {
+        if (value < 128) {
+            out.push_back(static_cast<uint8_t>(value));
+        } else if (value <= 0xFF) {
+            out.push_back(0xcc);
+            out.push_back(static_cast<uint8_t>(value));
+        } else if (value <= 0xFFFF) {
+            out.push_back(0xcd);
+            appendBigEndian(out, static_cast<uint16_t>(value));
+        } else if (value <= 0xFFFFFFFFll) {
+            out.push_back(0xce);
+            appendBigEndian(out, static_cast<uint32_t>(value));
+        } else {
+            out.push_back(0xcf);
+            appendBigEndian(out, static_cast<uint64_t>(value));
+        }
+    } else if (value >= -32) {
+        out.push_back(static_cast<uint8_t>(static_cast<int8_t>(value)));  // Negative fixint
+    } else if (value >= -128) {
+        out.push_back(0xd0);
+        out.push_back(static_cast<uint8_t>(static_cast<int8_t>(value)));
+    } else if (value >= -32768) {
+        out.push_back(0xd1);
+        appendBigEndian(out, static_cast<uint16_t>(static_cast<int16_t>(value)));
+    } else if (value >= INT32_MIN) {
+        out.push_back(0xd2);
+        appendBigEndian(out, static_cast<uint32_t>(static_cast<int32_t>(value)));
+    } else {
+        out.push_back(0xd3);
+        appendBigEndian(out, static_cast<uint64_t>(value));
+    }
+}
+
+void appendFloat(std::vector<uint8_t>& out, float value) {
+    uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    out.push_back(0xca);
+    appendBigEndian(out, bits);
+}
+
+void appendBox(std::vector<uint8_t>& out, const cv::Rect& box) {
+    appendInteger(out, box.x);
+    appendInteger(out, box.y);
+    appendInteger(out, box.width);
+    appendInteger(out, box.height);
+}
+
+// Regions the classifier never labelled carry an empty label instead of "unknown"
+std::string publishedLabel(const ConsolidatedRegion& region) {
+    return region.classId >= 0 ? region.classLabel : std::string();
+}
+
+#if BIRDS_HAVE_ZMQ
+// PUB socket bound to the endpoint; sends never wait (ZMQ_DONTWAIT, and PUB drops at the
+// high-water mark rather than block)
+class ZmqTransport {
+   public:
+    bool open(const std::string& endpoint) {
+        context_ = zmq_ctx_new();
+        if (!context_) return false;
+        socket_ = zmq_socket(context_, ZMQ_PUB);
+        if (!socket_) return false;
+        const int linger = 0;
+        const int highWaterMark = 1000;
+        zmq_setsockopt(socket_, ZMQ_LINGER, &linger, sizeof(linger));
+        zmq_setsockopt(socket_, ZMQ_SNDHWM, &highWaterMark, sizeof(highWaterMark));
+        if (zmq_bind(socket_, endpoint.c_str()) != 0) {
+            LOG_ERROR("Event publisher could not bind {}: {}", endpoint, zmq_strerror(zmq_errno()));
+            return false;
+        }
+        return true;
+    }
+
+    ~ZmqTransport() {
+        if (socket_) zmq_close(socket_);
+        if (context_) zmq_ctx_term(context_);
+    }
+
+    bool send(const std::string& topic, const std::vector<uint8_t>& payload) {
+        if (zmq_send(socket_, topic.data(), topic.size(), ZMQ_SNDMORE | ZMQ_DONTWAIT) < 0) return false;
+        return zmq_send(socket_, payload.data(), payload.size(), ZMQ_DONTWAIT) >= 0;
+    }
+
+   private:
+    void* context_ = nullptr;
+    void* socket_ = nullptr;
+};
+#endif
+
+#if BIRDS_HAVE_MOSQUITTO
+// libmosquitto client whose network thread connects, reconnects and writes; publish() only
+// queues, and batches are skipped while the broker is disconnected so nothing piles up
+class MqttTransport {
+   public:
+    bool open(const std::string& endpoint, int qos) {
+        qos_ = qos;
+        std::string host = endpoint;
+        int port = 1883;
+        if (host.rfind("mqtt://", 0) == 0) host = host.substr(7);
+        const size_t colon = host.rfind(':');
+        if (colon != std::string::npos) {
+            port = std::stoi(host.substr(colon + 1));
+            host = host.substr(0, colon);
+        }
+        mosquitto_lib_init();
+        client_ = mosquitto_new(nullptr, true, this);
+        if (!client_) return false;
+        mosquitto_connect_callback_set(client_, [](mosquitto*, void* self, int rc) {
+            static_cast<MqttTransport*>(self)->connected_ = rc == 0;
+        });
+        mosquitto_disconnect_callback_set(client_, [](mosquitto*, void* self, int) {
+            static_cast<MqttTransport*>(self)->connected_ = false;
+        });
+        mosquitto_reconnect_delay_set(client_, 1, 30, true);
+        const int rc = mosquitto_connect_async(client_, host.c_str(), port, 30);
+        if (rc != MOSQ_ERR_SUCCESS) {
+            LOG_WARN("Event publisher: MQTT broker {}:{} not reachable yet ({})", host, port, mosquitto_strerror(rc));
+        }
+        return mosquitto_loop_start(client_) == MOSQ_ERR_SUCCESS;
+    }
+
+    ~MqttTransport() {
+        if (client_) {
+            mosquitto_disconnect(client_);
+            mosquitto_loop_stop(client_, false);
+            mosquitto_destroy(client_);
+        }
+        mosquitto_lib_cleanup();
+    }
+
+    bool send(const std::string& topic, const std::vector<uint8_t>& payload) {
+        if (!connected_) return false;
+        return mosquitto_publish(client_, nullptr, topic.c_str(), static_cast<int>(payload.size()), payload.data(),
+                                 qos_, false) == MOSQ_ERR_SUCCESS;
+    }
+
+   private:
+    mosquitto* client_ = nullptr;
+    int qos_ = 0;
+    std::atomic<bool> connected_{false};
+};
+#endif
+
+}  // namespace
+
+void encodeEventBatch(const std::string& stream, EventGranularity granularity,
+                      const std::vector<PublishedEvent>& events, std::vector<uint8_t>& out) {
+    out.clear();
+    appendArrayHeader(out, 4);
+    appendInteger(out, 1);
+    appendString(out, stream);
+    appendString(out, granularity == EventGranularity::Frame ? "frame" : "track");
+    appendArrayHeader(out, events.size());
+    for (const PublishedEvent& event : events) {
+        appendArrayHeader(out, 3);
+        appendInteger(out, static_cast<int64_t>(event.frameIndex));
+        appendInteger(out, event.captureUnixMs);
+        if (granularity == EventGranularity::Frame) {
+            appendArrayHeader(out, event.regions.size());
+            for (const PublishedRegion& region : event.regions) {
+                appendArrayHeader(out, 7);
+                appendBox(out, region.box);
+                appendArrayHeader(out, region.trackIds.size());
+                for (const int id : region.trackIds) appendInteger(out, id);
+                appendString(out, region.label);
+                appendFloat(out, region.confidence);
+            }
+        } else {
+            appendArrayHeader(out, event.tracks.size());
+            for (const PublishedTrack& track : event.tracks) {
+                appendArrayHeader(out, 7);
+                appendInteger(out, track.trackId);
+                appendBox(out, track.box);
+                appendString(out, track.label);
+                appendFloat(out, track.confidence);
+            }
+        }
+    }
+}
+
+DetectionEventPublisher::DetectionEventPublisher(const EventPublisherConfig& config, SendFunction send)
+    : config_(config),
+      send_(std::move(send)),
+      queue_(std::max<size_t>(1, config.queueCapacity), BackpressurePolicy::DropOldest) {
+    worker_ = std::thread(&DetectionEventPublisher::run, this);
+}
+
+DetectionEventPublisher::~DetectionEventPublisher() {
+    queue_.close();
+    if (worker_.joinable()) worker_.join();
+    const EventPublisherStats totals = stats();
+    LOG_INFO("Event publisher: {} events in {} batches ({} bytes), {} shed, {} refused", totals.published,
+             totals.batches, totals.bytes, totals.dropped, totals.failed);
+}
+
+std::unique_ptr<DetectionEventPublisher> DetectionEventPublisher::open(const EventPublisherConfig& config) {
+    SendFunction send;
+    if (config.transport == "zmq") {
+#if BIRDS_HAVE_ZMQ
+        auto transport = std::make_shared<ZmqTransport>();
+        if (!transport->open(config.endpoint)) return nullptr;
+        send = [transport](const std::string& topic, const std::vector<uint8_t>& payload) {
+            return transport->send(topic, payload);
+        };
+#else
+        LOG_ERROR("Event publisher: transport zmq needs a build with ENABLE_ZEROMQ and libzmq");
+        return nullptr;
+#endif
+    } else if (config.transport == "mqtt") {
+#if BIRDS_HAVE_MOSQUITTO
+        auto transport = std::make_shared<MqttTransport>();
+        if (!transport->open(config.endpoint, config.mqttQos)) return nullptr;
+        send = [transport](const std::string& topic, const std::vector<uint8_t>& payload) {
+            return transport->send(topic, payload);
+        };
+#else
+        LOG_ERROR("Event publisher: transport mqtt needs a build with ENABLE_MQTT and libmosquitto");
+        return nullptr;
+#endif
+    } else {
+        LOG_ERROR("Event publisher: unknown transport {} (zmq or mqtt)", config.transport);
+        return nullptr;
+    }
+    LOG_INFO("Event publisher: {} events on {} {} topic {}, batched over {} ms",
+             config.granularity == EventGranularity::Frame ? "frame" : "track", config.transport, config.endpoint,
+             config.topic, config.batchWindow.count());
+    return std::make_unique<DetectionEventPublisher>(config, std::move(send));
+}
+
+void DetectionEventPublisher::publish(uint64_t frameIndex, int64_t captureUnixUs, const std::vector<cv::Rect>& boxes,
+                                      const std::vector<int>& objectIds,
+                                      const std::vector<ConsolidatedRegion>& regions) {
+    PublishedEvent event;
+    event.frameIndex = frameIndex;
+    event.captureUnixMs = captureUnixUs / 1000;
+    if (config_.granularity == EventGranularity::Frame) {
+        if (config_.motionOnly && regions.empty()) return;
+        event.regions.reserve(regions.size());
+        for (const ConsolidatedRegion& region : regions) {
+            PublishedRegion published;
+            published.box = region.boundingBox;
+            published.trackIds.assign(region.trackedObjectIds.begin(), region.trackedObjectIds.end());
+            published.label = publishedLabel(region);
+            published.confidence = region.classConfidence;
+            event.regions.push_back(std::move(published));
+        }
+    } else {
+        const size_t tracked = std::min(boxes.size(), objectIds.size());
+        if (config_.motionOnly && tracked == 0) return;
+        event.tracks.reserve(tracked);
+        for (size_t i = 0; i < tracked; ++i) {
+            PublishedTrack track;
+            track.trackId = objectIds[i];
+            track.box = boxes[i];
+            for (const ConsolidatedRegion& region : regions) {
+                const auto& ids = region.trackedObjectIds;
+                if (std::find(ids.begin(), ids.end(), track.trackId) == ids.end()) continue;
+                track.label = publishedLabel(region);
+                track.confidence = region.classConfidence;
+                break;
+            }
+            event.tracks.push_back(std::move(track));
+        }
+    }
+    if (queue_.push(std::move(event))) submitted_++;
+}
+
+EventPublisherStats DetectionEventPublisher::stats() const {
+    EventPublisherStats stats;
+    stats.submitted = submitted_.load();
+    stats.dropped = queue_.droppedCount();
+    stats.published = published_.load();
+    stats.failed = failed_.load();
+    stats.batches = batches_.load();
+    stats.bytes = bytes_.load();
+    return stats;
+}
+
+void DetectionEventPublisher::run() {
+    nameCurrentThread("events");
+    std::vector<PublishedEvent> batch;
+    batch.reserve(config_.maxBatchEvents);
+    for (;;) {
+        auto event = queue_.pop();
+        if (!event) break;  // Closed and drained
+        batch.push_back(std::move(*event));
+
+        // Collect until the window closes or the batch is full
+        const auto deadline = std::chrono::steady_clock::now() + config_.batchWindow;
+        while (batch.size() < config_.maxBatchEvents) {
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= deadline) break;
+            auto next = queue_.popFor(deadline - now);
+            if (!next) break;
+            batch.push_back(std::move(*next));
+        }
+        flush(batch);
+    }
+}
+
+void DetectionEventPublisher::flush(std::vector<PublishedEvent>& batch) {
+    if (batch.empty()) return;
+    encodeEventBatch(config_.stream, config_.granularity, batch, payload_);
+    bool sent = false;
+    try {
+        sent = send_(config_.topic, payload_);
+    } catch (const std::exception& e) {
+        LOG_DEBUG_LIMITED("Event batch not sent: {}", e.what());
+    }
+    (sent ? published_ : failed_) += batch.size();
+    if (sent) bytes_ += payload_.size();
+    batches_++;
+    batch.clear();
+}
@@ -0,0 +1,331 @@
+#include "detection_log.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <limits>
+
+#include "logger.hpp"
+
+namespace fs = std::filesystem;
+using namespace detection_log_layout;
+
+namespace {
+
+int16_t clampToInt16(int value) {
+    return static_cast<int16_t>(std::clamp<int>(value, std::numeric_limits<int16_t>::min(),
+                                                std::numeric_limits<int16_t>::max()));
+}
+
+size_t paddedBytes(size_t bytes) { return (bytes + 7) & ~static_cast<size_t>(7); }
+
+// Visits the columns in file order (see detection_log_layout)
+template <typename Columns, typename Visit>
+void forEachColumn(Columns& columns, Visit&& visit) {
+    visit(columns.frameIndex);
+    visit(columns.timestampUs);
+    visit(columns.stream);
+    visit(columns.boxOffsets);
+    visit(columns.regionOffsets);
+    visit(columns.boxX);
+    visit(columns.boxY);
+    visit(columns.boxWidth);
+    visit(columns.boxHeight);
+    visit(columns.boxObjectId);
+    visit(columns.regionX);
+    visit(columns.regionY);
+    visit(columns.regionWidth);
+    visit(columns.regionHeight);
+    visit(columns.memberOffsets);
+    visit(columns.memberBox);
+}
+
+// Full write at @p offset, retrying short writes and EINTR
+bool writeAt(int fd, const unsigned char* data, size_t length, uint64_t offset) {
+    while (length > 0) {
+        const ssize_t written = pwrite(fd, data, length, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+    return true;
+}
+
+// Full read at @p offset; false on a short read (end of file)
+bool readAt(int fd, void* data, size_t length, uint64_t offset) {
+    auto* bytes = static_cast<unsigned char*>(data);
+    while (length > 0) {
+        const ssize_t got = pread(fd, bytes, length, static_cast<off_t>(offset));
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        bytes += got;
+        length -= static_cast<size_t>(got);
+        offset += static_cast<uint64_t>(got);
+    }
+    return true;
+}
+
+int64_t unixMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+}  // namespace
+
+void DetectionLogColumns::clear() {
+    forEachColumn(*this, [](auto& column) { column.clear(); });
+    boxOffsets.push_back(0);
+    regionOffsets.push_back(0);
+    memberOffsets.push_back(0);
+}
+
+DetectionLog::DetectionLog(const DetectionLogConfig& config) : config_(config) {}
+
+DetectionLog::~DetectionLog() {
+    flush();
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    closeFile();
+}
+
+void DetectionLog::append(int64_t frameIndex, int64_t timestampUs, uint16_t stream,
+                          const std::vector<cv::Rect>& boxes, const std::vector<int>& objectIds,
+                          const std::vector<ConsolidatedRegion>& regions) {
+    std::lock_guard<std::mutex> lock(appendMutex_);
+    DetectionLogColumns& columns = open_;
+    if (columns.frames() == 0) openedAt_ = std::chrono::steady_clock::now();
+
+    columns.frameIndex.push_back(frameIndex);
+    columns.timestampUs.push_back(timestampUs);
+    columns.stream.push_back(stream);
+
+    const size_t firstBox = columns.boxes();
+    for (size_t i = 0; i < boxes.size(); ++i) {
+        columns.boxX.push_back(clampToInt16(boxes[i].x));
+        columns.boxY.push_back(clampToInt16(boxes[i].y));
+        columns.boxWidth.push_back(clampToInt16(boxes[i].width));
+        columns.boxHeight.push_back(clampToInt16(boxes[i].height));
+        columns.boxObjectId.push_back(i < objectIds.size() ? objectIds[i] : -1);
+    }
+    columns.boxOffsets.push_back(static_cast<int32_t>(columns.boxes()));
+
+    const size_t knownIds = std::min(objectIds.size(), boxes.size());
+    for (const ConsolidatedRegion& region : regions) {
+        columns.regionX.push_back(clampToInt16(region.boundingBox.x));
+        columns.regionY.push_back(clampToInt16(region.boundingBox.y));
+        columns.regionWidth.push_back(clampToInt16(region.boundingBox.width));
+        columns.regionHeight.push_back(clampToInt16(region.boundingBox.height));
+        // A handful of boxes per frame: a linear search beats building a map
+        for (const int id : region.trackedObjectIds) {
+            const auto found = std::find(objectIds.begin(), objectIds.begin() + knownIds, id);
+            if (found != objectIds.begin() + knownIds) {
+                columns.memberBox.push_back(
+                    static_cast<int32_t>(firstBox + (found - objectIds.begin())));
+            }
+        }
+        columns.memberOffsets.push_back(static_cast<int32_t>(columns.memberBox.size()));
+    }
+    columns.regionOffsets.push_back(static_cast<int32_t>(columns.regions()));
+    framesLogged_++;
+}
+
+bool DetectionLog::flushDue(std::chrono::steady_clock::time_point now) const {
+    std::lock_guard<std::mutex> lock(appendMutex_);
+    return open_.frames() > 0 &&
+           (open_.frames() >= config_.rowGroupFrames || now - openedAt_ >= config_.flushInterval);
+}
+
+bool DetectionLog::flush() {
+    std::lock_guard<std::mutex> writeLock(writeMutex_);
+    {
+        // writing_ is empty here: the swap hands append() a cleared group with its capacity
+        std::lock_guard<std::mutex> lock(appendMutex_);
+        if (open_.frames() == 0) return true;
+        std::swap(open_, writing_);
+    }
+
+    RowGroupHeader header{};
+    header.magic = kRowGroupMagic;
+    header.columnCount = kColumnCount;
+    header.frames = writing_.frames();
+    header.boxes = writing_.boxes();
+    header.regions = writing_.regions();
+    header.members = writing_.memberBox.size();
+    header.firstTimestampUs =
+        *std::min_element(writing_.timestampUs.begin(), writing_.timestampUs.end());
+    header.lastTimestampUs =
+        *std::max_element(writing_.timestampUs.begin(), writing_.timestampUs.end());
+    forEachColumn(writing_, [&](const auto& column) {
+        header.bodyBytes += paddedBytes(column.size() * sizeof(column[0]));
+    });
+
+    buffer_.assign(sizeof(header) + header.bodyBytes, 0);
+    std::memcpy(buffer_.data(), &header, sizeof(header));
+    size_t position = sizeof(header);
+    forEachColumn(writing_, [&](const auto& column) {
+        const size_t bytes = column.size() * sizeof(column[0]);
+        if (bytes > 0) std::memcpy(buffer_.data() + position, column.data(), bytes);
+        position += paddedBytes(bytes);
+    });
+
+    const size_t frames = writing_.frames();
+    writing_.clear();
+
+    if (fd_ >= 0 && fileSize_ > sizeof(FileHeader) &&
+        fileSize_ + buffer_.size() > config_.fileBytes) {
+        closeFile();
+        fileIndex_++;
+    }
+    if (fd_ < 0 && !openFile()) {
+        writeFailures_++;
+        return false;
+    }
+    if (!writeAt(fd_, buffer_.data(), buffer_.size(), fileSize_)) {
+        // fileSize_ is not advanced: the next row group overwrites the partial one
+        LOG_ERROR("Failed to write {} detection log frames to {}: {}", frames, path_,
+                  std::strerror(errno));
+        writeFailures_++;
+        return false;
+    }
+    fileSize_ += buffer_.size();
+    framesWritten_ += frames;
+    rowGroupsWritten_++;
+    bytesWritten_ += buffer_.size();
+    return true;
+}
+
+DetectionLogStats DetectionLog::getStats() const {
+    DetectionLogStats stats;
+    {
+        std::lock_guard<std::mutex> lock(appendMutex_);
+        stats.framesLogged = framesLogged_;
+        stats.pendingFrames = open_.frames();
+    }
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    stats.framesWritten = framesWritten_;
+    stats.rowGroupsWritten = rowGroupsWritten_;
+    stats.bytesWritten = bytesWritten_;
+    stats.writeFailures = writeFailures_;
+    return stats;
+}
+
+std::string DetectionLog::currentPath() const {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    return path_;
+}
+
+bool DetectionLog::openFile() {
+    std::error_code ec;
+    fs::create_directories(config_.directory, ec);
+    if (runStamp_.empty()) {
+        const std::time_t now = std::time(nullptr);
+        std::tm local{};
+        localtime_r(&now, &local);
+        char stamp[32];
+        std::strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", &local);
+        runStamp_ = stamp;
+    }
+    char name[64];
+    std::snprintf(name, sizeof(name), "detections_%s_%03" PRIu64 ".bodl", runStamp_.c_str(),
+                  fileIndex_);
+    const std::string path = (fs::path(config_.directory) / name).string();
+
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    FileHeader header{};
+    header.magic = kMagic;
+    header.version = kVersion;
+    header.createdUs = unixMicros();
+    if (fd < 0 ||
+        !writeAt(fd, reinterpret_cast<const unsigned char*>(&header), sizeof(header), 0)) {
+        LOG_ERROR("Could not open detection log {}: {}", path, std::strerror(errno));
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    fd_ = fd;
+    path_ = path;
+    fileSize_ = sizeof(header);
+    LOG_INFO("Writing the detection log to {}", path_);
+    return true;
+}
+
+void DetectionLog::closeFile() {
+    if (fd_ < 0) return;
+    close(fd_);
+    fd_ = -1;
+}
+
+DetectionLogReader::DetectionLogReader(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    FileHeader header{};
+    if (!readAt(fd, &header, sizeof(header), 0) || header.magic != kMagic ||
+        header.version != kVersion) {
+        LOG_WARN("{} is not a version {} detection log", path, kVersion);
+        close(fd);
+        return;
+    }
+    fd_ = fd;
+    offset_ = sizeof(header);
+}
+
+DetectionLogReader::~DetectionLogReader() {
+    if (fd_ >= 0) close(fd_);
+}
+
+bool DetectionLogReader::next(DetectionLogColumns& columns) {
+    if (fd_ < 0) return false;
+    RowGroupHeader header{};
+    if (!readAt(fd_, &header, sizeof(header), offset_) || header.magic != kRowGroupMagic ||
+        header.columnCount != kColumnCount) {
+        return false;
+    }
+
+    columns.frameIndex.resize(header.frames);
+    columns.timestampUs.resize(header.frames);
+    columns.stream.resize(header.frames);
+    columns.boxOffsets.resize(header.frames + 1);
+    columns.regionOffsets.resize(header.frames + 1);
+    for (auto* column : {&columns.boxX, &columns.boxY, &columns.boxWidth, &columns.boxHeight}) {
+        column->resize(header.boxes);
+    }
+    columns.boxObjectId.resize(header.boxes);
+    for (auto* column : {&columns.regionX, &columns.regionY, &columns.regionWidth,
+                         &columns.regionHeight}) {
+        column->resize(header.regions);
+    }
+    columns.memberOffsets.resize(header.regions + 1);
+    columns.memberBox.resize(header.members);
+
+    uint64_t bodyBytes = 0;
+    forEachColumn(columns, [&](const auto& column) {
+        bodyBytes += paddedBytes(column.size() * sizeof(column[0]));
+    });
+    if (bodyBytes != header.bodyBytes) return false;
+    // Truncated by a crash: the padding is part of the row group, as readers map it in place
+    struct stat info {};
+    const uint64_t end = offset_ + sizeof(header) + bodyBytes;
+    if (fstat(fd_, &info) != 0 || static_cast<uint64_t>(info.st_size) < end) return false;
+
+    uint64_t position = offset_ + sizeof(header);
+    bool complete = true;
+    forEachColumn(columns, [&](auto& column) {
+        const size_t bytes = column.size() * sizeof(column[0]);
+        if (complete && bytes > 0) complete = readAt(fd_, column.data(), bytes, position);
+        position += paddedBytes(bytes);
+    });
+    if (!complete) return false;
+    offset_ = end;
+    return true;
+}
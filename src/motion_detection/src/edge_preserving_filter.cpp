@@ -0,0 +1,165 @@
+#include "edge_preserving_filter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <opencv2/imgproc.hpp>
+
+namespace {
+
+// Passes of the recursive filter; three already leave no visible stripes
+constexpr int kDomainTransformIterations = 3;
+
+// Sum over channels of |a - b|, the domain transform's colour step
+inline int colourStep(const uchar* a, const uchar* b, int channels) {
+    int step = 0;
+    for (int c = 0; c < channels; ++c) step += std::abs(a[c] - b[c]);
+    return step;
+}
+
+}  // namespace
+
+EdgePreservingFilter::EdgePreservingFilter(Method method, int radius, double sigmaColor, int subsample)
+    : method_(method),
+      radius_(std::max(1, radius)),
+      sigmaColor_(std::max(1.0, sigmaColor)),
+      subsample_(std::clamp(subsample, 1, 8)) {}
+
+void EdgePreservingFilter::apply(cv::InputArray input, cv::OutputArray output, Workspace& workspace) const {
+    const cv::Mat source = input.getMat();
+    CV_Assert(source.depth() == CV_8U);
+    // Device frames (cv::UMat) are filtered on the host and copied back
+    cv::Mat& target = output.isMat() ? output.getMatRef() : workspace.output;
+    if (method_ == Method::GUIDED) {
+        guided(source, target, workspace);
+    } else {
+        domainTransform(source, target, workspace);
+    }
+    if (!output.isMat()) workspace.output.copyTo(output);
+}
+
+void EdgePreservingFilter::guided(const cv::Mat& input, cv::Mat& output, Workspace& workspace) const {
+    input.convertTo(workspace.image, CV_32F);
+    const cv::Mat* guide = &workspace.image;
+    if (subsample_ > 1) {
+        const cv::Size reduced((input.cols + subsample_ - 1) / subsample_, (input.rows + subsample_ - 1) / subsample_);
+        cv::resize(workspace.image, workspace.small, reduced, 0, 0, cv::INTER_AREA);
+        guide = &workspace.small;
+    }
+    const int radius = std::max(1, radius_ / subsample_);
+    const cv::Size window(2 * radius + 1, 2 * radius + 1);
+    const cv::Point anchor(-1, -1);
+    cv::boxFilter(*guide, workspace.mean, CV_32F, window, anchor, true, cv::BORDER_REFLECT);
+    cv::sqrBoxFilter(*guide, workspace.square, CV_32F, window, anchor, true, cv::BORDER_REFLECT);
+
+    // Per box: a = variance / (variance + sigma^2), b = mean * (1 - a); computed in place
+    const float epsilon = static_cast<float>(sigmaColor_ * sigmaColor_);
+    const int width = guide->cols * guide->channels();
+    for (int y = 0; y < guide->rows; ++y) {
+        float* mean = workspace.mean.ptr<float>(y);
+        float* square = workspace.square.ptr<float>(y);
+        for (int x = 0; x < width; ++x) {
+            const float variance = std::max(0.0f, square[x] - mean[x] * mean[x]);
+            const float a = variance / (variance + epsilon);
+            square[x] = mean[x] - a * mean[x];
+            mean[x] = a;
+        }
+    }
+    // Every pixel lies in (2r+1)^2 boxes: average their coefficients
+    cv::boxFilter(workspace.mean, workspace.mean, CV_32F, window, anchor, true, cv::BORDER_REFLECT);
+    cv::boxFilter(workspace.square, workspace.square, CV_32F, window, anchor, true, cv::BORDER_REFLECT);
+    const cv::Mat* a = &workspace.mean;
+    const cv::Mat* b = &workspace.square;
+    if (subsample_ > 1) {
+        cv::resize(workspace.mean, workspace.fullA, input.size(), 0, 0, cv::INTER_LINEAR);
+        cv::resize(workspace.square, workspace.fullB, input.size(), 0, 0, cv::INTER_LINEAR);
+        a = &workspace.fullA;
+        b = &workspace.fullB;
+    }
+
+    // The input was copied into workspace.image, so the output may alias it
+    output.create(input.size(), input.type());
+    const int outputWidth = input.cols * input.channels();
+    for (int y = 0; y < input.rows; ++y) {
+        const float* in = workspace.image.ptr<float>(y);
+        const float* rowA = a->ptr<float>(y);
+        const float* rowB = b->ptr<float>(y);
+        uchar* out = output.ptr<uchar>(y);
+        for (int x = 0; x < outputWidth; ++x) out[x] = cv::saturate_cast<uchar>(rowA[x] * in[x] + rowB[x]);
+    }
+}
+
+void EdgePreservingFilter::domainTransform(const cv::Mat& input, cv::Mat& output, Workspace& workspace) const {
+    const int channels = input.channels();
+    const int rows = input.rows;
+    const int cols = input.cols;
+
+    // Colour steps to the left and upper neighbour; the first column / row has none
+    workspace.stepX.create(input.size(), CV_16UC1);
+    workspace.stepY.create(input.size(), CV_16UC1);
+    for (int y = 0; y < rows; ++y) {
+        const uchar* in = input.ptr<uchar>(y);
+        const uchar* above = input.ptr<uchar>(std::max(0, y - 1));
+        ushort* stepX = workspace.stepX.ptr<ushort>(y);
+        ushort* stepY = workspace.stepY.ptr<ushort>(y);
+        stepX[0] = 0;
+        for (int x = 1; x < cols; ++x) {
+            stepX[x] = static_cast<ushort>(colourStep(in + x * channels, in + (x - 1) * channels, channels));
+        }
+        for (int x = 0; x < cols; ++x) {
+            stepY[x] = static_cast<ushort>(colourStep(in + x * channels, above + x * channels, channels));
+        }
+    }
+    input.convertTo(workspace.image, CV_32F);
+
+    const double sigmaSpace = radius_ / std::sqrt(3.0);
+    const double ratio = sigmaSpace / sigmaColor_;
+    std::vector<float>& weights = workspace.weights;
+    weights.resize(static_cast<size_t>(255 * channels + 1));
+    for (int iteration = 0; iteration < kDomainTransformIterations; ++iteration) {
+        // Spatial sigma of this pass: the passes' variances add up to sigmaSpace^2
+        const double sigma = sigmaSpace * std::sqrt(3.0) * std::pow(2.0, kDomainTransformIterations - iteration - 1) /
+                             std::sqrt(std::pow(4.0, kDomainTransformIterations) - 1.0);
+        const double feedback = std::exp(-std::sqrt(2.0) / sigma);
+        // A neighbour at domain distance d contributes feedback^d
+        for (size_t step = 0; step < weights.size(); ++step) {
+            weights[step] = static_cast<float>(std::pow(feedback, 1.0 + ratio * static_cast<double>(step)));
+        }
+
+        for (int y = 0; y < rows; ++y) {
+            float* row = workspace.image.ptr<float>(y);
+            const ushort* stepX = workspace.stepX.ptr<ushort>(y);
+            for (int x = 1; x < cols; ++x) {
+                const float weight = weights[stepX[x]];
+                float* pixel = row + x * channels;
+                for (int c = 0; c < channels; ++c) pixel[c] += weight * (pixel[c - channels] - pixel[c]);
+            }
+            for (int x = cols - 2; x >= 0; --x) {
+                const float weight = weights[stepX[x + 1]];
+                float* pixel = row + x * channels;
+                for (int c = 0; c < channels; ++c) pixel[c] += weight * (pixel[c + channels] - pixel[c]);
+            }
+        }
+        // Vertical passes run row by row, so memory is read in order
+        for (int y = 1; y < rows; ++y) {
+            float* row = workspace.image.ptr<float>(y);
+            const float* above = workspace.image.ptr<float>(y - 1);
+            const ushort* stepY = workspace.stepY.ptr<ushort>(y);
+            for (int x = 0; x < cols; ++x) {
+                const float weight = weights[stepY[x]];
+                for (int c = x * channels; c < (x + 1) * channels; ++c) row[c] += weight * (above[c] - row[c]);
+            }
+        }
+        for (int y = rows - 2; y >= 0; --y) {
+            float* row = workspace.image.ptr<float>(y);
+            const float* below = workspace.image.ptr<float>(y + 1);
+            const ushort* stepY = workspace.stepY.ptr<ushort>(y + 1);
+            for (int x = 0; x < cols; ++x) {
+                const float weight = weights[stepY[x]];
+                for (int c = x * channels; c < (x + 1) * channels; ++c) row[c] += weight * (below[c] - row[c]);
+            }
+        }
+    }
+    // The steps and the float image hold everything read from the input, so it may alias the output
+    workspace.image.convertTo(output, input.type());
+}
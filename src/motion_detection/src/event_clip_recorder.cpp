@@ -0,0 +1,180 @@
+#include "event_clip_recorder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <filesystem>
+#include <opencv2/imgcodecs.hpp>
+
+#include "jpeg_encoder.hpp"
+#include "logger.hpp"
+#include "thread_placement.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+size_t framesFor(double seconds, double fps) {
+    return static_cast<size_t>(std::max(0.0, std::round(seconds * fps)));
+}
+
+// clip_YYYYmmdd_HHMMSS_<n><extension>, in local time
+std::string clipFileName(uint64_t index, const std::string& extension) {
+    const std::time_t now = std::time(nullptr);
+    std::tm local{};
+    localtime_r(&now, &local);
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", &local);
+    return std::string("clip_") + stamp + "_" + std::to_string(index) + extension;
+}
+
+}  // namespace
+
+EventClipRecorder::EventClipRecorder(const ClipRecorderConfig& config)
+    : config_(config), queue_(config.queueCapacity, config.backpressure) {}
+
+EventClipRecorder::~EventClipRecorder() { stop(); }
+
+void EventClipRecorder::start(double fps) {
+    if (!config_.enabled || worker_.joinable()) return;
+
+    fps_ = fps > 0.0 ? fps : 30.0;
+    preRollFrames_ = framesFor(config_.preRollSeconds, fps_);
+    postRollFrames_ = std::max<size_t>(1, framesFor(config_.postRollSeconds, fps_));
+    maxClipFrames_ = std::max<size_t>(1, framesFor(config_.maxClipSeconds, fps_));
+    LOG_INFO("Event clips: {} pre-roll / {} post-roll frames at {:.1f} fps into {}", preRollFrames_,
+             postRollFrames_, fps_, config_.outputDir);
+    worker_ = std::thread(&EventClipRecorder::run, this);
+}
+
+bool EventClipRecorder::push(const cv::Mat& frame, bool eventActive) {
+    if (!worker_.joinable() || frame.empty()) return false;
+    return queue_.push(QueuedFrame{frame, eventActive});
+}
+
+void EventClipRecorder::stop() {
+    queue_.close();
+    if (worker_.joinable()) worker_.join();
+}
+
+ClipRecorderStats EventClipRecorder::getStats() const {
+    ClipRecorderStats stats;
+    stats.clipsWritten = clipsWritten_.load();
+    stats.framesWritten = framesWritten_.load();
+    stats.framesDropped = queue_.droppedCount();
+    stats.preRollFrames = preRollCount_.load();
+    stats.preRollBytes = preRollBytes_.load();
+    stats.recording = recording_.load();
+    return stats;
+}
+
+std::string EventClipRecorder::lastClipPath() const {
+    std::lock_guard<std::mutex> lock(pathMutex_);
+    return lastClipPath_;
+}
+
+void EventClipRecorder::run() {
+    nameCurrentThread("clips");
+    while (auto item = queue_.pop()) handle(*item);
+    closeClip();
+}
+
+void EventClipRecorder::handle(const QueuedFrame& item) {
+    if (!writer_.isOpened()) {
+        if (item.eventActive && openClip(item.frame.size(), item.frame.channels() == 3)) {
+            // Pre-roll first, oldest frame first
+            for (auto& jpeg : preRoll_) {
+                cv::Mat decoded = cv::imdecode(jpeg, cv::IMREAD_UNCHANGED);
+                if (!decoded.empty()) writeFrame(decoded);
+                spareBuffers_.push_back(std::move(jpeg));
+            }
+            preRoll_.clear();
+            preRollCount_ = 0;
+            preRollBytes_ = 0;
+            writeFrame(item.frame);
+        } else {
+            bufferPreRoll(item.frame);
+        }
+        return;
+    }
+
+    writeFrame(item.frame);
+    quietFrames_ = item.eventActive ? 0 : quietFrames_ + 1;
+    if (quietFrames_ >= postRollFrames_ || clipFrames_ >= maxClipFrames_) closeClip();
+}
+
+void EventClipRecorder::bufferPreRoll(const cv::Mat& frame) {
+    if (preRollFrames_ == 0) return;
+
+    std::vector<unsigned char> jpeg;
+    if (preRoll_.size() >= preRollFrames_) {
+        preRollBytes_ -= preRoll_.front().size();
+        jpeg = std::move(preRoll_.front());
+        preRoll_.pop_front();
+    } else if (!spareBuffers_.empty()) {
+        jpeg = std::move(spareBuffers_.back());
+        spareBuffers_.pop_back();
+    }
+    if (JpegEncoder::encode(frame, config_.preRollQuality, jpeg)) {
+        preRollBytes_ += jpeg.size();
+        preRoll_.push_back(std::move(jpeg));
+    }
+    preRollCount_ = preRoll_.size();
+}
+
+bool EventClipRecorder::openClip(const cv::Size& frameSize, bool color) {
+    std::error_code ec;
+    fs::create_directories(config_.outputDir, ec);
+    const std::string path =
+        (fs::path(config_.outputDir) / clipFileName(clipsWritten_.load(), config_.extension)).string();
+    const std::string& codec = config_.codec;
+    const int fourcc = codec.size() == 4
+                           ? cv::VideoWriter::fourcc(codec[0], codec[1], codec[2], codec[3])
+                           : cv::VideoWriter::fourcc('a', 'v', 'c', '1');
+
+    bool opened = false;
+#if CV_VERSION_MAJOR > 4 || \
+    (CV_VERSION_MAJOR == 4 && (CV_VERSION_MINOR > 5 || (CV_VERSION_MINOR == 5 && CV_VERSION_REVISION >= 2)))
+    if (config_.hardwareEncode) {
+        const std::vector<int> params = {cv::VIDEOWRITER_PROP_HW_ACCELERATION, cv::VIDEO_ACCELERATION_ANY,
+                                         cv::VIDEOWRITER_PROP_IS_COLOR, color ? 1 : 0};
+        opened = writer_.open(path, cv::CAP_FFMPEG, fourcc, fps_, frameSize, params);
+    }
+#endif
+    if (!opened) opened = writer_.open(path, fourcc, fps_, frameSize, color);
+    if (!opened) {
+        if (!openFailureLogged_) {
+            LOG_ERROR("Could not open event clip {} (codec {}); frames stay in the pre-roll", path,
+                      codec);
+            openFailureLogged_ = true;
+        }
+        return false;
+    }
+
+    clipSize_ = frameSize;
+    quietFrames_ = 0;
+    clipFrames_ = 0;
+    recording_ = true;
+    {
+        std::lock_guard<std::mutex> lock(pathMutex_);
+        lastClipPath_ = path;
+    }
+    LOG_INFO("Event clip started: {} ({}x{} @ {:.1f} fps, {} pre-roll frames)", path,
+             frameSize.width, frameSize.height, fps_, preRoll_.size());
+    return true;
+}
+
+void EventClipRecorder::writeFrame(const cv::Mat& frame) {
+    if (frame.size() != clipSize_) return;  // Stream geometry changed mid-clip
+    writer_.write(frame);
+    ++clipFrames_;
+    framesWritten_++;
+}
+
+void EventClipRecorder::closeClip() {
+    if (!writer_.isOpened()) return;
+    writer_.release();
+    recording_ = false;
+    clipsWritten_++;
+    LOG_INFO("Event clip finished: {} ({} frames)", lastClipPath(), clipFrames_);
+}
@@ -0,0 +1,298 @@
+#include "fixed_size_filters.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/imgproc.hpp>
+
+namespace {
+
+inline int reflect101(int i, int size) { return i < 0 ? -i : (i >= size ? 2 * (size - 1) - i : i); }
+
+// ---------------------------------------------------------------------------------------
+// Gaussian blur
+// ---------------------------------------------------------------------------------------
+
+// out[x] = sum of padded[x + k] * taps[k]: at most 255 * 256, exact in 16 bits
+template <int K>
+void gaussianRow(const uchar* padded, const uint16_t* taps, uint16_t* out, int cols) {
+    int x = 0;
+#if CV_SIMD128
+    cv::v_uint16x8 tap[K];
+    for (int k = 0; k < K; ++k) tap[k] = cv::v_setall_u16(taps[k]);
+    for (; x + 16 <= cols; x += 16) {
+        cv::v_uint16x8 low = cv::v_setzero_u16();
+        cv::v_uint16x8 high = cv::v_setzero_u16();
+        for (int k = 0; k < K; ++k) {
+            cv::v_uint16x8 a, b;
+            cv::v_expand(cv::v_load(padded + x + k), a, b);
+            low = low + cv::v_mul_wrap(a, tap[k]);
+            high = high + cv::v_mul_wrap(b, tap[k]);
+        }
+        cv::v_store(out + x, low);
+        cv::v_store(out + x + 8, high);
+    }
+#endif
+    for (; x < cols; ++x) {
+        unsigned sum = 0;
+        for (int k = 0; k < K; ++k) sum += padded[x + k] * taps[k];
+        out[x] = static_cast<uint16_t>(sum);
+    }
+}
+
+// out[x] = sum of rows[k][x] * taps[k] in 16 fractional bits, rounded once
+template <int K>
+void gaussianColumn(const uint16_t* const* rows, const uint16_t* taps, uchar* out, int cols) {
+    int x = 0;
+#if CV_SIMD128
+    cv::v_uint16x8 tap[K];
+    for (int k = 0; k < K; ++k) tap[k] = cv::v_setall_u16(taps[k]);
+    const cv::v_uint32x4 half = cv::v_setall_u32(1u << 15);
+    for (; x + 16 <= cols; x += 16) {
+        cv::v_uint32x4 sum0 = half, sum1 = half, sum2 = half, sum3 = half;
+        for (int k = 0; k < K; ++k) {
+            cv::v_uint32x4 a, b, c, d;
+            cv::v_mul_expand(cv::v_load(rows[k] + x), tap[k], a, b);
+            cv::v_mul_expand(cv::v_load(rows[k] + x + 8), tap[k], c, d);
+            sum0 = sum0 + a;
+            sum1 = sum1 + b;
+            sum2 = sum2 + c;
+            sum3 = sum3 + d;
+        }
+        const cv::v_uint16x8 low = cv::v_pack(cv::v_shr<16>(sum0), cv::v_shr<16>(sum1));
+        const cv::v_uint16x8 high = cv::v_pack(cv::v_shr<16>(sum2), cv::v_shr<16>(sum3));
+        cv::v_store(out + x, cv::v_pack(low, high));
+    }
+#endif
+    for (; x < cols; ++x) {
+        uint32_t sum = 1u << 15;
+        for (int k = 0; k < K; ++k) sum += static_cast<uint32_t>(rows[k][x]) * taps[k];
+        out[x] = static_cast<uchar>(sum >> 16);
+    }
+}
+
+// Output row y reads the horizontal rows y - R..y + R, which are all among the last K
+// computed, so they live in a ring of K rows. In place works: an input row is read before
+// any output row at or below it is written.
+template <int K>
+void gaussianBlur(const cv::Mat& src, cv::Mat& dst, const uint16_t* taps, FixedGaussianBlur::Workspace& ws) {
+    constexpr int R = K / 2;
+    const int rows = src.rows;
+    const int cols = src.cols;
+    ws.padded.resize(cols + 2 * R);
+    ws.ring.resize(static_cast<size_t>(K) * cols);
+    uchar* padded = ws.padded.data();
+    uint16_t* ring = ws.ring.data();
+    const uint16_t* window[K];
+
+    dst.create(src.size(), CV_8UC1);
+    int next = 0;  // First input row not yet through the horizontal pass
+    for (int y = 0; y < rows; ++y) {
+        for (const int last = std::min(rows - 1, y + R); next <= last; ++next) {
+            const uchar* in = src.ptr<uchar>(next);
+            std::memcpy(padded + R, in, cols);
+            for (int i = 1; i <= R; ++i) {
+                padded[R - i] = in[i];
+                padded[R + cols - 1 + i] = in[cols - 1 - i];
+            }
+            gaussianRow<K>(padded, taps, ring + static_cast<size_t>(next % K) * cols, cols);
+        }
+        for (int k = 0; k < K; ++k) {
+            window[k] = ring + static_cast<size_t>(reflect101(y + k - R, rows) % K) * cols;
+        }
+        gaussianColumn<K>(window, taps, dst.ptr<uchar>(y), cols);
+    }
+}
+
+// ---------------------------------------------------------------------------------------
+// Erosion and dilation
+// ---------------------------------------------------------------------------------------
+
+template <bool IsMax>
+inline uchar pick(uchar a, uchar b) {
+    return IsMax ? std::max(a, b) : std::min(a, b);
+}
+
+#if CV_SIMD128
+template <bool IsMax>
+inline cv::v_uint8x16 pick(const cv::v_uint8x16& a, const cv::v_uint8x16& b) {
+    return IsMax ? cv::v_max(a, b) : cv::v_min(a, b);
+}
+#endif
+
+// The window around each pixel grows one pixel either side per step; at half-width w it
+// is stored to reduced[slotOfHalfWidth[w]] when some kernel row has that width
+template <int K, bool IsMax>
+void reduceRow(const uchar* padded, const int* slotOfHalfWidth, uchar* const* reduced, int cols) {
+    constexpr int R = K / 2;
+    const uchar* center = padded + R;
+    int x = 0;
+#if CV_SIMD128
+    for (; x + 16 <= cols; x += 16) {
+        cv::v_uint8x16 value = cv::v_load(center + x);
+        if (slotOfHalfWidth[0] >= 0) cv::v_store(reduced[slotOfHalfWidth[0]] + x, value);
+        for (int w = 1; w <= R; ++w) {
+            value = pick<IsMax>(value, pick<IsMax>(cv::v_load(center + x - w), cv::v_load(center + x + w)));
+            if (slotOfHalfWidth[w] >= 0) cv::v_store(reduced[slotOfHalfWidth[w]] + x, value);
+        }
+    }
+#endif
+    for (; x < cols; ++x) {
+        uchar value = center[x];
+        if (slotOfHalfWidth[0] >= 0) reduced[slotOfHalfWidth[0]][x] = value;
+        for (int w = 1; w <= R; ++w) {
+            value = pick<IsMax>(value, pick<IsMax>(center[x - w], center[x + w]));
+            if (slotOfHalfWidth[w] >= 0) reduced[slotOfHalfWidth[w]][x] = value;
+        }
+    }
+}
+
+template <int K, bool IsMax>
+void combineRows(const uchar* const* rows, uchar* out, int cols) {
+    int x = 0;
+#if CV_SIMD128
+    for (; x + 16 <= cols; x += 16) {
+        cv::v_uint8x16 value = cv::v_load(rows[0] + x);
+        for (int k = 1; k < K; ++k) value = pick<IsMax>(value, cv::v_load(rows[k] + x));
+        cv::v_store(out + x, value);
+    }
+#endif
+    for (; x < cols; ++x) {
+        uchar value = rows[0][x];
+        for (int k = 1; k < K; ++k) value = pick<IsMax>(value, rows[k][x]);
+        out[x] = value;
+    }
+}
+
+// Same ring streaming as gaussianBlur, one ring of K rows per distinct run width
+template <int K, bool IsMax>
+void morphologyPass(const cv::Mat& src, cv::Mat& dst, const FixedMorphology::Shape& shape,
+                    FixedMorphology::Workspace& ws) {
+    constexpr int R = K / 2;
+    const uchar neutral = IsMax ? 0 : 255;
+    const int rows = src.rows;
+    const int cols = src.cols;
+    ws.padded.assign(cols + 2 * R, neutral);
+    ws.ring.resize(static_cast<size_t>(shape.widthCount) * K * cols);
+    ws.neutral.assign(cols, neutral);
+    int slotOfHalfWidth[R + 1];
+    std::fill(slotOfHalfWidth, slotOfHalfWidth + R + 1, -1);
+    for (int j = 0; j < shape.widthCount; ++j) slotOfHalfWidth[shape.halfWidths[j]] = j;
+    auto ringRow = [&](int width, int row) { return ws.ring.data() + (static_cast<size_t>(width) * K + row % K) * cols; };
+    uchar* reduced[4];
+    const uchar* window[K];
+
+    dst.create(src.size(), CV_8UC1);
+    int next = 0;
+    for (int y = 0; y < rows; ++y) {
+        for (const int last = std::min(rows - 1, y + R); next <= last; ++next) {
+            std::memcpy(ws.padded.data() + R, src.ptr<uchar>(next), cols);
+            for (int j = 0; j < shape.widthCount; ++j) reduced[j] = ringRow(j, next);
+            reduceRow<K, IsMax>(ws.padded.data(), slotOfHalfWidth, reduced, cols);
+        }
+        for (int k = 0; k < K; ++k) {
+            const int row = y + k - R;
+            const bool outside = row < 0 || row >= rows || shape.rowWidth[k] < 0;
+            window[k] = outside ? ws.neutral.data() : ringRow(shape.rowWidth[k], row);
+        }
+        combineRows<K, IsMax>(window, dst.ptr<uchar>(y), cols);
+    }
+}
+
+}  // namespace
+
+bool FixedGaussianBlur::supports(int kernelSize) {
+    return kernelSize == 3 || kernelSize == 5 || kernelSize == 7 || kernelSize == 9 || kernelSize == 11;
+}
+
+bool FixedGaussianBlur::plan(int kernelSize) {
+    run_ = nullptr;
+    size_ = 0;
+    taps_.clear();
+    switch (kernelSize) {
+        case 3: run_ = &gaussianBlur<3>; break;
+        case 5: run_ = &gaussianBlur<5>; break;
+        case 7: run_ = &gaussianBlur<7>; break;
+        case 9: run_ = &gaussianBlur<9>; break;
+        case 11: run_ = &gaussianBlur<11>; break;
+        default: return false;
+    }
+    size_ = kernelSize;
+
+    // Sigma from the size, as GaussianBlur derives it for sigma 0; the centre tap takes
+    // the rounding remainder so the taps add up to exactly 1.0
+    const cv::Mat kernel = cv::getGaussianKernel(kernelSize, 0, CV_64F);
+    int sum = 0;
+    taps_.resize(kernelSize);
+    for (int k = 0; k < kernelSize; ++k) {
+        taps_[k] = static_cast<uint16_t>(cvRound(kernel.at<double>(k) * 256.0));
+        sum += taps_[k];
+    }
+    taps_[kernelSize / 2] = static_cast<uint16_t>(taps_[kernelSize / 2] + 256 - sum);
+    return true;
+}
+
+bool FixedGaussianBlur::apply(const cv::Mat& input, cv::Mat& output, Workspace& workspace) const {
+    const int radius = size_ / 2;
+    if (!run_ || input.type() != CV_8UC1 || input.rows <= radius || input.cols <= radius) return false;
+    run_(input, output, taps_.data(), workspace);
+    return true;
+}
+
+bool FixedMorphology::plan(const cv::Mat& kernel) {
+    erode_ = nullptr;
+    dilate_ = nullptr;
+    shape_ = Shape{};
+    const int side = kernel.rows;
+    if (kernel.type() != CV_8UC1 || kernel.cols != side || (side != 3 && side != 5 && side != 7)) return false;
+
+    const int radius = side / 2;
+    for (int y = 0; y < side; ++y) {
+        const uchar* row = kernel.ptr<uchar>(y);
+        int first = 0;
+        while (first < side && !row[first]) ++first;
+        if (first == side) {
+            shape_.rowWidth[y] = -1;
+            continue;
+        }
+        // One run, centred on the anchor
+        const int last = side - 1 - first;
+        for (int x = 0; x < side; ++x) {
+            if ((row[x] != 0) != (x >= first && x <= last)) return false;
+        }
+        const int halfWidth = radius - first;
+        int index = 0;
+        while (index < shape_.widthCount && shape_.halfWidths[index] != halfWidth) ++index;
+        if (index == shape_.widthCount) shape_.halfWidths[shape_.widthCount++] = halfWidth;
+        shape_.rowWidth[y] = index;
+    }
+    if (shape_.widthCount == 0) return false;
+
+    switch (side) {
+        case 3:
+            erode_ = &morphologyPass<3, false>;
+            dilate_ = &morphologyPass<3, true>;
+            break;
+        case 5:
+            erode_ = &morphologyPass<5, false>;
+            dilate_ = &morphologyPass<5, true>;
+            break;
+        case 7:
+            erode_ = &morphologyPass<7, false>;
+            dilate_ = &morphologyPass<7, true>;
+            break;
+    }
+    return true;
+}
+
+void FixedMorphology::apply(bool dilate, const cv::Mat& input, cv::Mat& output, int iterations,
+                            Workspace& workspace) const {
+    CV_Assert(planned() && input.type() == CV_8UC1);
+    if (iterations <= 0) {
+        input.copyTo(output);
+        return;
+    }
+    const Run run = dilate ? dilate_ : erode_;
+    run(input, output, shape_, workspace);
+    for (int i = 1; i < iterations; ++i) run(output, output, shape_, workspace);
+}
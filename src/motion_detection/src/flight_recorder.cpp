@@ -0,0 +1,247 @@
+#include "flight_recorder.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <utility>
+
+#include "logger.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Size of @p size scaled down (never up) to fit a square of @p side
+cv::Size fitted(const cv::Size& size, int side) {
+    const double scale = std::min(1.0, static_cast<double>(side) / std::max(size.width, size.height));
+    return cv::Size(std::max(1, static_cast<int>(std::lround(size.width * scale))),
+                    std::max(1, static_cast<int>(std::lround(size.height * scale))));
+}
+
+// Scale @p source into @p thumbnail; @p thumbnail is reallocated only on a size or type change
+bool shrink(const cv::Mat& source, int side, cv::Mat& thumbnail) {
+    if (source.empty()) return false;
+    const cv::Size size = fitted(source.size(), side);
+    if (size == source.size()) {
+        source.copyTo(thumbnail);
+    } else {
+        cv::resize(source, thumbnail, size, 0, 0, cv::INTER_AREA);
+    }
+    return true;
+}
+
+const char* floodName(MotionProcessor::FloodKind flood) {
+    switch (flood) {
+        case MotionProcessor::FloodKind::ILLUMINATION: return "illumination";
+        case MotionProcessor::FloodKind::SHAKE: return "shake";
+        default: return "none";
+    }
+}
+
+// Local time with milliseconds, for directory names that sort by time
+std::string timestamp() {
+    const auto now = std::chrono::system_clock::now();
+    const std::time_t seconds = std::chrono::system_clock::to_time_t(now);
+    const auto millis =
+        std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000;
+    std::tm local{};
+    localtime_r(&seconds, &local);
+    char stamp[32];
+    const size_t length = std::strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", &local);
+    std::snprintf(stamp + length, sizeof(stamp) - length, "_%03d", static_cast<int>(millis));
+    return stamp;
+}
+
+}  // namespace
+
+FlightRecorder::FlightRecorder(FlightRecorderConfig config) : config_(std::move(config)) {
+    config_.frames = std::max<size_t>(config_.frames, 1);
+    config_.thumbnailSide = std::max(config_.thumbnailSide, 16);
+}
+
+FlightRecorder::~FlightRecorder() { waitIdle(); }
+
+void FlightRecorder::allocate(const MotionProcessor::ProcessingResult& result) {
+    // Slot size from the stages of the first frame; the cap decides how many fit
+    size_t slotBytes = 0;
+    for (const cv::Mat* stage : {&result.processedFrame, &result.frameDiff, &result.thresh, &result.morphological}) {
+        if (!stage->empty()) slotBytes += fitted(stage->size(), config_.thumbnailSide).area() * stage->elemSize();
+    }
+    size_t count = config_.frames;
+    if (slotBytes > 0) count = std::clamp<size_t>(config_.maxBytes / slotBytes, 1, config_.frames);
+    slots_.resize(count);
+    for (Slot& slot : slots_) {
+        // Allocated now, so recording itself does not allocate
+        shrink(result.processedFrame, config_.thumbnailSide, slot.processed);
+        shrink(result.frameDiff, config_.thumbnailSide, slot.frameDiff);
+        shrink(result.thresh, config_.thumbnailSide, slot.thresh);
+        shrink(result.morphological, config_.thumbnailSide, slot.morphological);
+        slot.boxes.reserve(config_.maxBoxes);
+    }
+    capacity_ = count;
+    bytes_ = count * slotBytes;
+    LOG_INFO("Flight recorder: {} frames of {} KiB ({} KiB in all)", count, slotBytes / 1024,
+             count * slotBytes / 1024);
+}
+
+void FlightRecorder::record(int frameIndex, int64_t captureUnixUs, const cv::Size& frameSize,
+                            const MotionProcessor::ProcessingResult& result) {
+    if (!config_.enabled) return;
+    {
+        std::unique_lock<std::mutex> lock(ringMutex_, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            skipped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (slots_.empty()) allocate(result);
+        Slot& slot = slots_[next_];
+        next_ = (next_ + 1) % slots_.size();
+        filled_ = std::min(filled_ + 1, slots_.size());
+
+        slot.frameIndex = frameIndex;
+        slot.captureUnixUs = captureUnixUs;
+        slot.frameSize = frameSize;
+        slot.flood = result.flood;
+        slot.stages = MotionProcessor::STAGE_NONE;
+        const int side = config_.thumbnailSide;
+        if (shrink(result.processedFrame, side, slot.processed)) slot.stages |= MotionProcessor::STAGE_PROCESSED;
+        if (shrink(result.frameDiff, side, slot.frameDiff)) slot.stages |= MotionProcessor::STAGE_FRAME_DIFF;
+        if (shrink(result.thresh, side, slot.thresh)) slot.stages |= MotionProcessor::STAGE_THRESH;
+        if (shrink(result.morphological, side, slot.morphological)) {
+            slot.stages |= MotionProcessor::STAGE_MORPHOLOGICAL;
+        }
+        const size_t boxes = std::min(result.detectedBounds.size(), config_.maxBoxes);
+        slot.boxes.assign(result.detectedBounds.begin(), result.detectedBounds.begin() + boxes);
+    }
+    recorded_.fetch_add(1, std::memory_order_relaxed);
+    if (config_.dumpOnFlood && result.flood != MotionProcessor::FloodKind::NONE) {
+        trigger(std::string("flood_") + floodName(result.flood), true);
+    }
+}
+
+void FlightRecorder::recordLatency(int frameIndex, double latencyMs) {
+    if (!config_.enabled || config_.latencySloMs <= 0.0 || latencyMs <= config_.latencySloMs) return;
+    if (trigger("latency", true)) {
+        LOG_WARN("Flight recorder: frame {} took {:.1f} ms (SLO {:.1f} ms)", frameIndex, latencyMs,
+                 config_.latencySloMs);
+    }
+}
+
+bool FlightRecorder::requestDump(const std::string& reason) { return trigger(reason, false); }
+
+bool FlightRecorder::trigger(const std::string& reason, bool automatic) {
+    if (!config_.enabled) return false;
+    std::lock_guard<std::mutex> lock(dumpMutex_);
+    if (dumping_.load()) return false;
+    const auto now = std::chrono::steady_clock::now();
+    if (automatic && automaticDumped_ &&
+        now - lastAutomaticDump_ < std::chrono::duration<double>(config_.minDumpIntervalSeconds)) {
+        return false;
+    }
+    size_t frames = 0;
+    {
+        std::lock_guard<std::mutex> ring(ringMutex_);
+        frames = filled_;
+    }
+    if (frames == 0) return false;
+    if (automatic) {
+        automaticDumped_ = true;
+        lastAutomaticDump_ = now;
+    }
+
+    std::string name = timestamp() + "_";
+    for (const char c : reason) {
+        if (std::isalnum(static_cast<unsigned char>(c)) || c == '_') name += c;
+    }
+    if (dumpThread_.joinable()) dumpThread_.join();  // The previous dump has finished
+    lastDumpPath_ = (fs::path(config_.directory) / name).string();
+    LOG_INFO("Flight recorder: dumping {} frames to {} ({})", frames, lastDumpPath_, reason);
+    dumping_ = true;
+    dumpThread_ = std::thread(&FlightRecorder::dump, this, lastDumpPath_);
+    return true;
+}
+
+void FlightRecorder::dump(std::string path) {
+    std::lock_guard<std::mutex> ring(ringMutex_);
+    std::error_code error;
+    fs::create_directories(path, error);
+    std::ofstream index(fs::path(path) / "frames.csv");
+    if (error || !index) {
+        LOG_ERROR("Flight recorder: cannot write {}", path);
+        failed_.fetch_add(1);
+        dumping_ = false;
+        return;
+    }
+    index << "frame_index,capture_unix_us,flood,boxes\n";
+
+    const auto write = [&](const std::string& file, const cv::Mat& image) {
+        try {
+            if (!cv::imwrite(file, image)) LOG_WARN("Flight recorder: failed to write {}", file);
+        } catch (const cv::Exception& e) {
+            LOG_WARN("Flight recorder: failed to write {}: {}", file, e.what());
+        }
+    };
+    cv::Mat boxesImage;
+    for (size_t k = 0; k < filled_; ++k) {
+        const Slot& slot = slots_[(next_ + slots_.size() - filled_ + k) % slots_.size()];
+        char prefix[32];
+        std::snprintf(prefix, sizeof(prefix), "frame_%06d_", slot.frameIndex);
+        const std::string base = (fs::path(path) / prefix).string();
+        if (slot.stages & MotionProcessor::STAGE_PROCESSED) {
+            write(base + "processed.png", slot.processed);
+            if (slot.processed.channels() == 1) {
+                cv::cvtColor(slot.processed, boxesImage, cv::COLOR_GRAY2BGR);
+            } else {
+                slot.processed.copyTo(boxesImage);
+            }
+            const double sx = static_cast<double>(boxesImage.cols) / std::max(slot.frameSize.width, 1);
+            const double sy = static_cast<double>(boxesImage.rows) / std::max(slot.frameSize.height, 1);
+            for (const cv::Rect& box : slot.boxes) {
+                const cv::Rect scaled(cv::Point(cvRound(box.x * sx), cvRound(box.y * sy)),
+                                      cv::Point(cvRound(box.br().x * sx), cvRound(box.br().y * sy)));
+                cv::rectangle(boxesImage, scaled, cv::Scalar(0, 255, 0), 1);
+            }
+            write(base + "boxes.png", boxesImage);
+        }
+        if (slot.stages & MotionProcessor::STAGE_FRAME_DIFF) write(base + "diff.png", slot.frameDiff);
+        if (slot.stages & MotionProcessor::STAGE_THRESH) write(base + "thresh.png", slot.thresh);
+        if (slot.stages & MotionProcessor::STAGE_MORPHOLOGICAL) write(base + "morphological.png", slot.morphological);
+
+        index << slot.frameIndex << ',' << slot.captureUnixUs << ',' << floodName(slot.flood) << ',';
+        for (size_t i = 0; i < slot.boxes.size(); ++i) {
+            const cv::Rect& box = slot.boxes[i];
+            index << (i ? ";" : "") << box.x << ' ' << box.y << ' ' << box.width << ' ' << box.height;
+        }
+        index << '\n';
+    }
+    LOG_INFO("Flight recorder: {} frames written to {}", filled_, path);
+    dumps_.fetch_add(1);
+    dumping_ = false;
+}
+
+void FlightRecorder::waitIdle() {
+    std::lock_guard<std::mutex> lock(dumpMutex_);
+    if (dumpThread_.joinable()) dumpThread_.join();
+}
+
+std::string FlightRecorder::lastDumpPath() const {
+    std::lock_guard<std::mutex> lock(dumpMutex_);
+    return lastDumpPath_;
+}
+
+FlightRecorderStats FlightRecorder::getStats() const {
+    FlightRecorderStats stats;
+    stats.recorded = recorded_.load(std::memory_order_relaxed);
+    stats.skipped = skipped_.load(std::memory_order_relaxed);
+    stats.dumps = dumps_.load();
+    stats.failed = failed_.load();
+    stats.capacity = capacity_.load();
+    stats.bytes = bytes_.load();
+    return stats;
+}
@@ -0,0 +1,40 @@
+#include "frame_arena.hpp"
+
+#include <algorithm>
+
+#include "profiler_zones.hpp"
+
+FrameArena::FrameArena(size_t initialBytes) : capacity_(std::max<size_t>(initialBytes, 1024)) {}
+
+FrameArena::~FrameArena() {
+    if (buffer_) PROFILE_FREE(buffer_.get(), "frame_arena");
+}
+
+void FrameArena::reset() {
+    stats_.frames++;
+    stats_.peakBytes = std::max(stats_.peakBytes, used_);
+    PROFILE_PLOT("frame_arena bytes/frame", used_);
+    if (used_ > capacity_) {
+        // Room for the frame that overflowed plus headroom for the next larger one
+        stats_.overflowFrames++;
+        resource_.reset();
+        if (buffer_) PROFILE_FREE(buffer_.get(), "frame_arena");
+        buffer_.reset();
+        capacity_ = used_ + used_ / 2;
+    } else if (resource_) {
+        resource_->release();
+    }
+    used_ = 0;
+}
+
+void* FrameArena::do_allocate(size_t bytes, size_t alignment) {
+    if (!resource_) allocateBuffer();
+    used_ += bytes + alignment - 1;  // Worst-case padding, so an overflow is never missed
+    return resource_->allocate(bytes, alignment);
+}
+
+void FrameArena::allocateBuffer() {
+    buffer_.reset(new std::byte[capacity_]);  // Uninitialized; nothing reads it before writing
+    PROFILE_ALLOC(buffer_.get(), capacity_, "frame_arena");
+    resource_.emplace(buffer_.get(), capacity_, std::pmr::new_delete_resource());
+}
@@ -0,0 +1,129 @@
+#include "frame_event_stream.hpp"
+
+#include <deque>
+#include <stdexcept>
+#include <utility>
+
+#include "logger.hpp"
+#include "pipelined_frame_executor.hpp"
+#include "region_crops.hpp"
+#include "thread_placement.hpp"
+
+FrameEventStream::FrameEventStream(std::shared_ptr<const PipelineConfig> config, FrameReader reader,
+                                   FrameEventStreamOptions options)
+    : config_(std::move(config)),
+      reader_(std::move(reader)),
+      options_(options),
+      processor_(config_),
+      consolidator_(config_->consolidation),
+      tracker_(config_->trackerEnabled ? std::make_unique<ObjectTracker>(config_->tracker) : nullptr),
+      events_(options.queueCapacity, options.policy) {
+    // Events only carry boxes and regions, so the intermediate images are not kept
+    processor_.setRetainedStages(MotionProcessor::STAGE_NONE);
+}
+
+FrameEventStream::~FrameEventStream() { stop(); }
+
+std::unique_ptr<FrameEventStream> FrameEventStream::open(std::shared_ptr<const PipelineConfig> config,
+                                                         CaptureConfig capture, FrameEventStreamOptions options) {
+    auto source = std::make_unique<CaptureSource>(std::move(capture));
+    if (!source->open()) {
+        throw std::runtime_error("Could not open video source: " +
+                                 (source->config().source.empty() ? std::string("camera 0") : source->config().source));
+    }
+    CaptureSource* reader = source.get();
+    auto stream = std::make_unique<FrameEventStream>(
+        std::move(config),
+        [reader](cv::Mat& frame, double& timestampMs) {
+            if (!reader->read(frame)) return false;
+            timestampMs = reader->lastTimestampMs();
+            return true;
+        },
+        options);
+    stream->capture_ = std::move(source);
+    return stream;
+}
+
+void FrameEventStream::start() {
+    if (thread_.joinable()) return;
+    started_ = std::chrono::steady_clock::now();
+    thread_ = std::thread(&FrameEventStream::run, this);
+}
+
+std::optional<FrameEvent> FrameEventStream::next() { return events_.pop(); }
+
+std::optional<FrameEvent> FrameEventStream::nextFor(std::chrono::milliseconds timeout) {
+    return events_.popFor(timeout);
+}
+
+void FrameEventStream::stop() {
+    stopping_.store(true);
+    // Wakes a reader blocked on a full queue; what is queued stays poppable
+    events_.close();
+    if (thread_.joinable()) thread_.join();
+}
+
+FrameEventStats FrameEventStream::stats() const {
+    FrameEventStats stats;
+    stats.framesRead = framesRead_.load(std::memory_order_relaxed);
+    stats.framesSkipped = framesSkipped_.load(std::memory_order_relaxed);
+    stats.framesProcessed = framesProcessed_.load(std::memory_order_relaxed);
+    stats.eventsEmitted = eventsEmitted_.load(std::memory_order_relaxed);
+    stats.eventsDropped = events_.droppedCount();
+    stats.processingErrors = processingErrors_.load(std::memory_order_relaxed);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started_).count();
+    if (seconds > 0.0) stats.processedFps = static_cast<double>(stats.framesProcessed) / seconds;
+    return stats;
+}
+
+void FrameEventStream::run() {
+    nameCurrentThread("stream");
+    // Index and timestamp of the frames in the executor, which delivers them in order
+    std::deque<std::pair<uint64_t, double>> pending;
+    auto deliver = [&](PipelinedFrameExecutor::Result done) {
+        FrameEvent event;
+        event.frameIndex = pending.front().first;
+        event.timestampMs = pending.front().second;
+        pending.pop_front();
+        framesProcessed_.fetch_add(1, std::memory_order_relaxed);
+        if (!done.error.empty()) processingErrors_.fetch_add(1, std::memory_order_relaxed);
+        if (options_.motionOnly && done.regions.empty() && done.error.empty()) return;
+
+        event.frame = std::move(done.frame);
+        event.boxes = std::move(done.result.detectedBounds);
+        event.regions = std::move(done.regions);
+        event.error = std::move(done.error);
+        if (options_.crops) regionCrops(event.frame, event.regions, event.crops);
+        emit(std::move(event));
+    };
+
+    try {
+        PipelinedFrameExecutor executor(processor_, consolidator_, tracker_.get(), options_.inFlight);
+        const uint64_t stride = static_cast<uint64_t>(options_.frameSkip < 0 ? 0 : options_.frameSkip) + 1;
+        uint64_t index = 0;
+        cv::Mat frame;
+        double timestampMs = 0.0;
+        while (!stopping_.load() && reader_(frame, timestampMs)) {
+            framesRead_.fetch_add(1, std::memory_order_relaxed);
+            if (index++ % stride != 0) {
+                framesSkipped_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            pending.emplace_back(index - 1, timestampMs);
+            // The executor keeps the frame, so the next read() lands in another pooled buffer
+            if (auto done = executor.push(std::move(frame))) deliver(std::move(*done));
+            frame = cv::Mat();
+        }
+        while (auto done = executor.finish()) deliver(std::move(*done));
+    } catch (const std::exception& e) {
+        LOG_ERROR("Frame event stream stopped: {}", e.what());
+    }
+    events_.close();
+}
+
+void FrameEventStream::emit(FrameEvent event) {
+    if (stopping_.load()) return;
+    eventsEmitted_.fetch_add(1, std::memory_order_relaxed);
+    event.stats = stats();
+    events_.push(std::move(event));
+}
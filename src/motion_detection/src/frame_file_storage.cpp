@@ -0,0 +1,427 @@
+#include "frame_file_storage.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "async_file_writer.hpp"
+#include "logger.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+const char* const kStorageSubdirs[] = {"original", "processed", "original_thumbnails",
+                                       "processed_thumbnails", "plates", "atlases"};
+
+// UTC hour partition (YYYY/MM/DD/HH) of a time, as FileStorageManager.partition_for()
+std::string partitionFor(std::time_t time) {
+    std::tm utc{};
+    gmtime_r(&time, &utc);
+    char buffer[16];
+    std::strftime(buffer, sizeof(buffer), "%Y/%m/%d/%H", &utc);
+    return buffer;
+}
+
+// The partition new files go to
+std::string currentPartition() { return partitionFor(std::time(nullptr)); }
+
+// Subdirectories of @p directory, sorted by name (so partitions come oldest first)
+std::vector<fs::path> sortedSubdirectories(const fs::path& directory) {
+    std::vector<fs::path> subdirectories;
+    std::error_code ec;
+    for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->is_directory(ec)) subdirectories.push_back(it->path());
+    }
+    std::sort(subdirectories.begin(), subdirectories.end());
+    return subdirectories;
+}
+
+void removeIfEmpty(const fs::path& directory) {
+    std::error_code ec;
+    if (fs::is_empty(directory, ec) && !ec) fs::remove(directory, ec);
+}
+
+// The whole JPEG in one buffered write, instead of imwrite's encoder streaming to the file
+bool writeFile(const std::string& path, const std::vector<unsigned char>& bytes) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(file);
+}
+
+// One JPEG to produce: optionally resized, encoded and written to path (or appended to the
+// segment store, recording where, when extent is set)
+struct EncodeTask {
+    cv::Mat image;
+    cv::Size resizeTo;  // Empty: encode the image as is
+    ImageEncodeSettings settings;
+    const std::string* path = nullptr;
+    SegmentExtent* extent = nullptr;
+    uint64_t* size = nullptr;  // Set to the encoded size, when given
+    bool written = false;
+};
+
+bool store(EncodeTask& task, const std::vector<unsigned char>& bytes, FrameSegmentStore* segments) {
+    if (!task.extent) return writeFile(*task.path, bytes);
+    *task.extent = segments->append(bytes);
+    // Readers assume JPEG without a content type, as in documents written before codecs
+    if (!task.extent->empty() && task.settings.codec != ImageCodec::Jpeg) {
+        task.extent->contentType = imageCodecMimeType(task.settings.codec);
+    }
+    return !task.extent->empty();
+}
+
+// The images of a frame are independent, so they are encoded in parallel. With a writer
+// each JPEG is encoded into a buffer of its pool and handed over; the writes of the record
+// are waited for together.
+void encodeAll(std::vector<EncodeTask>& tasks, const std::string& uuid,
+               FrameSegmentStore* segments = nullptr, AsyncFileWriter* writer = nullptr) {
+    std::unique_ptr<FileWriteBatch> batch;
+    if (writer) batch.reset(new FileWriteBatch(*writer));
+    cv::parallel_for_(cv::Range(0, static_cast<int>(tasks.size())), [&](const cv::Range& range) {
+        thread_local std::vector<unsigned char> buffer;
+        for (int i = range.start; i < range.end; ++i) {
+            EncodeTask& task = tasks[i];
+            try {
+                cv::Mat resized;
+                if (!task.resizeTo.empty()) {
+                    cv::resize(task.image, resized, task.resizeTo, 0, 0, cv::INTER_AREA);
+                }
+                const cv::Mat& image = resized.empty() ? task.image : resized;
+                if (batch && !task.extent) {
+                    AsyncFileWriter::Buffer bytes = writer->acquireBuffer();
+                    if (ImageEncoder::encode(image, task.settings, bytes)) {
+                        if (task.size) *task.size = bytes.size();
+                        batch->write(*task.path, std::move(bytes), &task.written);
+                    }
+                    continue;
+                }
+                task.written = ImageEncoder::encode(image, task.settings, buffer) && store(task, buffer, segments);
+                if (task.written && task.size) *task.size = buffer.size();
+            } catch (const cv::Exception& e) {
+                LOG_ERROR("Failed to encode frame {}: {}", uuid, e.what());
+            }
+        }
+    });
+    if (batch) batch->wait();
+}
+}  // namespace
+
+FrameFileStorage::FrameFileStorage(const std::string& storagePath, int jpegQuality,
+                                   int thumbnailQuality, const cv::Size& thumbnailSize,
+                                   const std::string& regionPath)
+    : storagePath_(storagePath), thumbnailSize_(thumbnailSize), regionPath_(regionPath) {
+    encoding_.full.quality = jpegQuality;
+    encoding_.crop.quality = jpegQuality;
+    encoding_.thumbnail.quality = thumbnailQuality;
+}
+
+void FrameFileStorage::useEncoding(const StorageEncoding& encoding) {
+    encoding_ = encoding;
+    for (auto output : {std::make_pair("full frames", &encoding_.full),
+                        std::make_pair("region crops", &encoding_.crop),
+                        std::make_pair("thumbnails", &encoding_.thumbnail)}) {
+        ImageEncodeSettings& settings = *output.second;
+        if (!ImageEncoder::available(settings.codec)) {
+            LOG_WARN("Image codec {} for {} is not built in, storing JPEG", imageCodecName(settings.codec),
+                     output.first);
+            settings.codec = ImageCodec::Jpeg;
+        }
+        LOG_INFO("Stored {}: {} quality {} effort {}", output.first, imageCodecName(settings.codec),
+                 settings.quality, settings.effort);
+    }
+}
+
+bool FrameFileStorage::ensureDirectories() const {
+    bool ok = true;
+    for (const char* subdir : kStorageSubdirs) {
+        std::error_code ec;
+        fs::create_directories(fs::path(storagePath_) / subdir, ec);
+        if (ec) {
+            LOG_ERROR("Could not create frame storage directory {}/{}: {}", storagePath_, subdir,
+                      ec.message());
+            ok = false;
+        }
+    }
+    std::error_code ec;
+    fs::create_directories(regionPath_, ec);
+    if (ec) {
+        LOG_ERROR("Could not create region directory {}: {}", regionPath_, ec.message());
+        ok = false;
+    }
+    return ok;
+}
+
+size_t FrameFileStorage::removePartitionsBefore(std::time_t cutoff) const {
+    const std::string cutoffPartition = partitionFor(cutoff);
+    size_t removed = 0;
+    // Walks one level (year, month, day, hour) of a subdirectory's partitions. Partitions sort
+    // by name, so the walk ends at the first one not before the cutoff at that level; only
+    // the levels wholly before it may be left empty and deleted.
+    std::function<void(const fs::path&, const std::string&)> expire = [&](const fs::path& directory,
+                                                                          const std::string& prefix) {
+        for (const fs::path& child : sortedSubdirectories(directory)) {
+            const std::string partition = prefix.empty() ? child.filename().string()
+                                                         : prefix + "/" + child.filename().string();
+            const std::string cutoffLevel = cutoffPartition.substr(0, partition.size());
+            if (partition > cutoffLevel) break;
+            if (partition.size() == cutoffPartition.size()) {
+                if (partition == cutoffLevel) break;
+                std::error_code ec;
+                fs::remove_all(child, ec);
+                if (ec) {
+                    LOG_WARN("Could not delete expired partition {}: {}", child.string(), ec.message());
+                } else {
+                    ++removed;
+                }
+                continue;
+            }
+            expire(child, partition);
+            if (partition < cutoffLevel) removeIfEmpty(child);
+        }
+    };
+    for (const char* subdir : kStorageSubdirs) expire(fs::path(storagePath_) / subdir, std::string());
+    if (removed > 0) LOG_INFO("Deleted {} image partitions older than {}", removed, cutoffPartition);
+    return removed;
+}
+
+fs::path FrameFileStorage::partitionDirectory(const char* subdir,
+                                              const std::string& partition) const {
+    fs::path directory = fs::path(storagePath_) / subdir / partition;
+    std::error_code ec;
+    fs::create_directories(directory, ec);  // A stat per call once the hour's directory exists
+    if (ec) {
+        LOG_ERROR("Could not create frame storage directory {}: {}", directory.string(),
+                  ec.message());
+    }
+    return directory;
+}
+
+bool FrameFileStorage::write(const cv::Mat& original, const cv::Mat& processed,
+                             StoredFrameRecord& record) const {
+    record.uuid = generateUuid();
+    record.atlasCell = AtlasCell();
+    if (segments_) {
+        record.originalPath.clear();
+        record.processedPath.clear();
+        record.originalThumbnailPath.clear();
+        record.processedThumbnailPath.clear();
+    } else {
+        const std::string partition = currentPartition();
+        const std::string filename = record.uuid + imageCodecExtension(encoding_.full.codec);
+        const std::string thumbnailName = record.uuid + imageCodecExtension(encoding_.thumbnail.codec);
+        record.originalPath = (partitionDirectory("original", partition) / filename).string();
+        record.processedPath = (partitionDirectory("processed", partition) / filename).string();
+        record.originalThumbnailPath =
+            (partitionDirectory("original_thumbnails", partition) / thumbnailName).string();
+        record.processedThumbnailPath =
+            (partitionDirectory("processed_thumbnails", partition) / thumbnailName).string();
+    }
+    record.originalSize = original.size();
+    record.originalChannels = original.channels();
+    record.processedSize = processed.size();
+    record.processedChannels = processed.channels();
+
+    // Each thumbnail is a single INTER_AREA downscale of its full frame
+    std::vector<EncodeTask> tasks(4);
+    tasks[0] = {original, cv::Size(), encoding_.full, &record.originalPath};
+    tasks[1] = {processed, cv::Size(), encoding_.full, &record.processedPath};
+    tasks[2] = {original, thumbnailSize_, encoding_.thumbnail, &record.originalThumbnailPath};
+    tasks[3] = {processed, thumbnailSize_, encoding_.thumbnail, &record.processedThumbnailPath};
+    tasks[0].size = &record.originalBytes;
+    tasks[1].size = &record.processedBytes;
+    tasks[2].size = &record.originalThumbnailBytes;
+    tasks[3].size = &record.processedThumbnailBytes;
+    if (segments_) {
+        tasks[0].extent = &record.originalSegment;
+        tasks[1].extent = &record.processedSegment;
+        tasks[2].extent = &record.originalThumbnailSegment;
+        tasks[3].extent = &record.processedThumbnailSegment;
+    }
+    encodeAll(tasks, record.uuid, segments_.get(), writer_.get());
+
+    if (!tasks[0].written || !tasks[1].written) {
+        LOG_ERROR("Failed to write frame images for {}", record.uuid);
+        remove(record);
+        return false;
+    }
+    // Thumbnails are best effort, as in FileStorageManager
+    std::error_code ec;
+    if (!tasks[2].written) {
+        fs::remove(record.originalThumbnailPath, ec);
+        record.originalThumbnailPath.clear();
+        record.originalThumbnailBytes = 0;
+    }
+    if (!tasks[3].written) {
+        fs::remove(record.processedThumbnailPath, ec);
+        record.processedThumbnailPath.clear();
+        record.processedThumbnailBytes = 0;
+    }
+    if (atlas_) atlas_->add(currentPartition(), record.uuid, processed, record.atlasCell);
+    return true;
+}
+
+bool FrameFileStorage::writeRegions(const cv::Mat& original, const std::vector<cv::Rect>& regions,
+                                    int minCropSide, StoredFrameRecord& record) const {
+    std::vector<cv::Rect> areas;
+    areas.reserve(regions.size());
+    for (const cv::Rect& region : regions) areas.push_back(regionCropRect(region, original.size(), minCropSide));
+    startRegionRecord(original.size(), original.channels(), regions, areas, record);
+
+    // The crops are ROI views, so nothing is copied before the encoders read them
+    std::vector<cv::Mat> crops;
+    crops.reserve(areas.size());
+    for (const auto& crop : record.regionCrops) {
+        if (crop.crop.empty()) {
+            LOG_ERROR("Region {},{} {}x{} of frame {} lies outside the image", crop.region.x,
+                      crop.region.y, crop.region.width, crop.region.height, record.uuid);
+            return false;
+        }
+        crops.push_back(original(crop.crop));
+    }
+    return encodeRegionRecord(original, crops, record);
+}
+
+bool FrameFileStorage::writeCrops(const cv::Size& frameSize, const cv::Mat& context,
+                                  const std::vector<cv::Mat>& crops, const std::vector<cv::Rect>& regions,
+                                  const std::vector<cv::Rect>& areas, StoredFrameRecord& record) const {
+    if (crops.size() != regions.size() || crops.size() != areas.size()) {
+        LOG_ERROR("{} region crop(s) given for {} region(s)", crops.size(), regions.size());
+        return false;
+    }
+    startRegionRecord(frameSize, context.channels(), regions, areas, record);
+    for (const cv::Mat& crop : crops) {
+        if (crop.empty()) {
+            LOG_ERROR("Empty region crop for {}", record.uuid);
+            return false;
+        }
+    }
+    return encodeRegionRecord(context, crops, record);
+}
+
+void FrameFileStorage::startRegionRecord(const cv::Size& frameSize, int channels,
+                                         const std::vector<cv::Rect>& regions,
+                                         const std::vector<cv::Rect>& areas, StoredFrameRecord& record) const {
+    record.uuid = generateUuid();
+    record.originalPath.clear();
+    record.processedPath.clear();
+    record.processedThumbnailPath.clear();
+    record.originalBytes = 0;
+    record.processedBytes = 0;
+    record.processedThumbnailBytes = 0;
+    record.atlasCell = AtlasCell();
+    record.originalThumbnailPath =
+        (partitionDirectory("original_thumbnails", currentPartition()) /
+         (record.uuid + imageCodecExtension(encoding_.thumbnail.codec)))
+            .string();
+    record.originalSize = frameSize;
+    record.originalChannels = channels;
+    record.processedSize = frameSize;
+    record.processedChannels = channels;
+
+    record.regionCrops.clear();
+    record.regionCrops.reserve(regions.size());
+    for (size_t i = 0; i < regions.size(); ++i) {
+        StoredRegionCrop crop;
+        crop.path = (fs::path(regionPath_) /
+                     (record.uuid + "_" + std::to_string(i) + imageCodecExtension(encoding_.crop.codec)))
+                        .string();
+        crop.region = regions[i];
+        crop.crop = areas[i];
+        record.regionCrops.push_back(std::move(crop));
+    }
+}
+
+bool FrameFileStorage::encodeRegionRecord(const cv::Mat& context, const std::vector<cv::Mat>& crops,
+                                          StoredFrameRecord& record) const {
+    std::vector<EncodeTask> tasks;
+    tasks.reserve(crops.size() + 1);
+    for (size_t i = 0; i < crops.size(); ++i) {
+        tasks.push_back({crops[i], cv::Size(), encoding_.crop, &record.regionCrops[i].path, nullptr,
+                         &record.regionCrops[i].bytes});
+    }
+    tasks.push_back({context, thumbnailSize_, encoding_.thumbnail, &record.originalThumbnailPath, nullptr,
+                     &record.originalThumbnailBytes});
+    encodeAll(tasks, record.uuid, nullptr, writer_.get());
+
+    for (size_t i = 0; i + 1 < tasks.size(); ++i) {
+        if (!tasks[i].written) {
+            LOG_ERROR("Failed to write region crops for {}", record.uuid);
+            remove(record);
+            return false;
+        }
+    }
+    if (!tasks.back().written) {
+        std::error_code ec;
+        fs::remove(record.originalThumbnailPath, ec);
+        record.originalThumbnailPath.clear();
+        record.originalThumbnailBytes = 0;
+    }
+    if (atlas_) atlas_->add(currentPartition(), record.uuid, context, record.atlasCell);
+    return true;
+}
+
+bool FrameFileStorage::writePlate(const cv::Mat& background, StoredPlate& plate) const {
+    plate.id = generateUuid();
+    plate.path = (partitionDirectory("plates", currentPartition()) /
+                  (plate.id + imageCodecExtension(encoding_.full.codec)))
+                     .string();
+    plate.size = background.size();
+    std::vector<EncodeTask> tasks(1);
+    tasks[0] = {background, cv::Size(), encoding_.full, &plate.path};
+    encodeAll(tasks, plate.id, nullptr, writer_.get());
+    if (!tasks[0].written) {
+        LOG_ERROR("Failed to write background plate {}", plate.path);
+        std::error_code ec;
+        fs::remove(plate.path, ec);
+        plate = StoredPlate();
+        return false;
+    }
+    return true;
+}
+
+cv::Rect FrameFileStorage::regionCropRect(const cv::Rect& region, const cv::Size& frameSize,
+                                          int minSide) {
+    cv::Rect crop = region;
+    // Grow each axis around the center, then slide the window back inside the frame
+    const auto grow = [](int& start, int& length, int minLength, int limit) {
+        if (length >= minLength) return;
+        const int target = std::min(minLength, limit);
+        start -= (target - length) / 2;
+        length = target;
+        start = std::max(0, std::min(start, limit - length));
+    };
+    grow(crop.x, crop.width, minSide, frameSize.width);
+    grow(crop.y, crop.height, minSide, frameSize.height);
+    return crop & cv::Rect(cv::Point(0, 0), frameSize);
+}
+
+void FrameFileStorage::remove(const StoredFrameRecord& record) const {
+    std::error_code ec;
+    for (const std::string* path : {&record.originalPath, &record.processedPath,
+                                    &record.originalThumbnailPath, &record.processedThumbnailPath}) {
+        if (!path->empty()) fs::remove(*path, ec);
+    }
+    for (const auto& crop : record.regionCrops) fs::remove(crop.path, ec);
+}
+
+std::string FrameFileStorage::generateUuid() {
+    thread_local std::mt19937_64 rng{std::random_device{}()};
+    uint64_t high = rng();
+    uint64_t low = rng();
+    high = (high & 0xFFFFFFFFFFFF0FFFULL) | 0x0000000000004000ULL;  // Version 4
+    low = (low & 0x3FFFFFFFFFFFFFFFULL) | 0x8000000000000000ULL;    // RFC 4122 variant
+
+    char buffer[37];
+    std::snprintf(buffer, sizeof(buffer), "%08x-%04x-%04x-%04x-%012llx",
+                  static_cast<unsigned>(high >> 32), static_cast<unsigned>((high >> 16) & 0xFFFF),
+                  static_cast<unsigned>(high & 0xFFFF), static_cast<unsigned>(low >> 48),
+                  static_cast<unsigned long long>(low & 0xFFFFFFFFFFFFULL));
+    return buffer;
+}
@@ -0,0 +1,241 @@
+#include "frame_segment_store.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+#include "logger.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// segment_00000042.seg -> 42; false for other file names
+bool parseSegmentIndex(const std::string& name, uint64_t& index) {
+    unsigned long long value = 0;
+    char suffix[8] = {};
+    if (std::sscanf(name.c_str(), "segment_%8llu.%3s", &value, suffix) != 2) return false;
+    if (std::strcmp(suffix, "seg") != 0) return false;
+    index = value;
+    return true;
+}
+
+// Full write at @p offset, retrying short writes and EINTR
+bool writeAt(int fd, const unsigned char* data, size_t length, uint64_t offset) {
+    while (length > 0) {
+        const ssize_t written = pwrite(fd, data, length, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+    return true;
+}
+
+constexpr uint64_t kAlignMask = FrameSegmentStore::kDirectAlignment - 1;
+
+uint64_t alignUp(uint64_t value) { return (value + kAlignMask) & ~kAlignMask; }
+
+}  // namespace
+
+void FrameSegmentStore::AlignedFree::operator()(unsigned char* data) const { std::free(data); }
+
+FrameSegmentStore::FrameSegmentStore(const SegmentStoreConfig& config)
+    : config_(config), policy_(config.cachePolicy) {
+#ifndef O_DIRECT
+    if (policy_ == SegmentCachePolicy::Direct) {
+        LOG_WARN("O_DIRECT is not available here, dropping segment pages behind the writes instead");
+        policy_ = SegmentCachePolicy::DropBehind;
+    }
+#endif
+    std::error_code ec;
+    fs::create_directories(config_.directory, ec);
+    if (ec) {
+        LOG_ERROR("Could not create segment directory {}: {}", config_.directory, ec.message());
+        return;
+    }
+    // Continue the newest segment after a restart
+    for (const auto& entry : fs::directory_iterator(config_.directory, ec)) {
+        uint64_t index = 0;
+        if (parseSegmentIndex(entry.path().filename().string(), index) && index > index_) {
+            index_ = index;
+        }
+    }
+}
+
+FrameSegmentStore::~FrameSegmentStore() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closeSegment();
+}
+
+SegmentExtent FrameSegmentStore::append(const std::vector<unsigned char>& bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fd_ < 0 && !openSegment(index_)) return {};
+    if (size_ > 0 && size_ + bytes.size() > config_.segmentBytes) {
+        closeSegment();
+        if (!openSegment(index_ + 1)) return {};
+    }
+
+    const bool direct = policy_ == SegmentCachePolicy::Direct;
+    const bool written = direct ? appendDirect(bytes.data(), bytes.size(), size_)
+                                : writeAt(fd_, bytes.data(), bytes.size(), size_);
+    if (!written) {
+        // size_ is not advanced: the next append overwrites the partial bytes
+        LOG_ERROR("Failed to append {} bytes to {}: {}", bytes.size(), path_, std::strerror(errno));
+        // The staging buffer may no longer hold the last block; reopening reads it back
+        if (direct) closeSegment();
+        return {};
+    }
+    SegmentExtent extent{path_, size_, bytes.size(), {}};  // The caller labels non-JPEG bytes
+    size_ += bytes.size();
+    if (policy_ == SegmentCachePolicy::DropBehind) dropBehind(false);
+    return extent;
+}
+
+bool FrameSegmentStore::appendDirect(const unsigned char* data, size_t length, uint64_t offset) {
+    while (length > 0) {
+        // staging_ starts with the bytes of the partial block at offset
+        const uint64_t blockStart = offset & ~kAlignMask;
+        const size_t tail = static_cast<size_t>(offset - blockStart);
+        const size_t chunk = std::min(length, stagingBytes_ - tail);
+        unsigned char* staging = staging_.get();
+        std::memcpy(staging + tail, data, chunk);
+        const size_t filled = tail + chunk;
+        const size_t padded = static_cast<size_t>(alignUp(filled));
+        std::memset(staging + filled, 0, padded - filled);
+        if (!writeAt(fd_, staging, padded, blockStart)) return false;
+
+        // Keep the new partial block for the next write
+        const size_t whole = filled & ~static_cast<size_t>(kAlignMask);
+        std::memmove(staging, staging + whole, filled - whole);
+        data += chunk;
+        length -= chunk;
+        offset += chunk;
+    }
+    return true;
+}
+
+bool FrameSegmentStore::loadDirectTail() {
+    const uint64_t blockStart = size_ & ~kAlignMask;
+    const size_t tail = static_cast<size_t>(size_ - blockStart);
+    if (tail == 0) return true;
+    ssize_t got;
+    do {
+        got = pread(fd_, staging_.get(), kDirectAlignment, static_cast<off_t>(blockStart));
+    } while (got < 0 && errno == EINTR);
+    return got >= static_cast<ssize_t>(tail);
+}
+
+void FrameSegmentStore::dropBehind(bool all) {
+    const uint64_t length = size_ - droppedUpTo_;
+    if (length == 0 || (!all && length < config_.dropBehindBytes)) return;
+    // Dirty pages cannot be dropped, so the range is written out first (on the appending
+    // thread: the persistence worker, never the capture path)
+#ifdef __linux__
+    sync_file_range(fd_, static_cast<off_t>(droppedUpTo_), static_cast<off_t>(length),
+                    SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+#else
+    fsync(fd_);
+#endif
+#ifdef POSIX_FADV_DONTNEED
+    posix_fadvise(fd_, static_cast<off_t>(droppedUpTo_), static_cast<off_t>(length), POSIX_FADV_DONTNEED);
+#endif
+    droppedUpTo_ = size_;
+}
+
+bool FrameSegmentStore::read(const SegmentExtent& extent, std::vector<unsigned char>& bytes) {
+    const int fd = open(extent.file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    bytes.resize(extent.length);
+    size_t done = 0;
+    while (done < extent.length) {
+        const ssize_t got = pread(fd, bytes.data() + done, extent.length - done,
+                                  static_cast<off_t>(extent.offset + done));
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        done += static_cast<size_t>(got);
+    }
+    close(fd);
+    return done == extent.length;
+}
+
+bool FrameSegmentStore::openSegment(uint64_t index) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "segment_%08" PRIu64 ".seg", index);
+    const std::string path = (fs::path(config_.directory) / name).string();
+
+    int fd = -1;
+#ifdef O_DIRECT
+    if (policy_ == SegmentCachePolicy::Direct) {
+        // Read and write: the partial last block is read back into the staging buffer
+        fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | O_DIRECT, 0644);
+        if (fd < 0 && errno == EINVAL) {
+            LOG_WARN("{} does not support O_DIRECT, dropping segment pages behind the writes instead",
+                     config_.directory);
+            policy_ = SegmentCachePolicy::DropBehind;
+        }
+    }
+#endif
+    if (policy_ != SegmentCachePolicy::Direct) fd = open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    struct stat info {};
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        LOG_ERROR("Could not open segment {}: {}", path, std::strerror(errno));
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    fd_ = fd;
+    index_ = index;
+    path_ = path;
+    size_ = static_cast<uint64_t>(info.st_size);
+    droppedUpTo_ = 0;  // Pages of an earlier run may still be cached
+    if (policy_ == SegmentCachePolicy::Direct) {
+        if (!staging_) {
+            // Room for the partial block plus at least one whole one
+            stagingBytes_ = static_cast<size_t>(
+                std::max<uint64_t>(alignUp(config_.directBufferBytes), 2 * kDirectAlignment));
+            void* memory = nullptr;
+            if (posix_memalign(&memory, kDirectAlignment, stagingBytes_) != 0) {
+                LOG_ERROR("Could not allocate the {} byte segment staging buffer", stagingBytes_);
+                closeSegment();
+                return false;
+            }
+            staging_.reset(static_cast<unsigned char*>(memory));
+        }
+        if (!loadDirectTail()) {
+            LOG_ERROR("Could not read the last block of segment {}: {}", path_, std::strerror(errno));
+            closeSegment();
+            return false;
+        }
+    }
+    LOG_INFO("Appending frames to segment {} ({} bytes used, {})", path_, size_,
+             segmentCachePolicyName(policy_));
+    return true;
+}
+
+void FrameSegmentStore::closeSegment() {
+    if (fd_ < 0) return;
+    // Direct writes end in zero padding up to the block boundary
+    if (policy_ == SegmentCachePolicy::Direct && ftruncate(fd_, static_cast<off_t>(size_)) != 0) {
+        LOG_WARN("Could not trim segment {} to {} bytes: {}", path_, size_, std::strerror(errno));
+    }
+    if (policy_ == SegmentCachePolicy::DropBehind) dropBehind(true);
+    if (config_.syncOnRoll) {
+#ifdef __APPLE__
+        fsync(fd_);
+#else
+        fdatasync(fd_);
+#endif
+    }
+    close(fd_);
+    fd_ = -1;
+}
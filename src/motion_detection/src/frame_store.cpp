@@ -0,0 +1,440 @@
+#include "frame_store.hpp"
+
+#include <bsoncxx/builder/basic/array.hpp>
+#include <bsoncxx/builder/basic/document.hpp>
+#include <bsoncxx/builder/basic/kvp.hpp>
+#include <bsoncxx/types.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <mongocxx/bulk_write.hpp>
+#include <mongocxx/exception/bulk_write_exception.hpp>
+#include <mongocxx/exception/exception.hpp>
+#include <mongocxx/exception/operation_exception.hpp>
+#include <mongocxx/instance.hpp>
+#include <mongocxx/model/update_one.hpp>
+#include <mongocxx/options/bulk_write.hpp>
+#include <mongocxx/options/find.hpp>
+#include <mongocxx/options/insert.hpp>
+#include <mongocxx/pool.hpp>
+#include <mongocxx/uri.hpp>
+#include <set>
+#include <utility>
+
+#include "logger.hpp"
+
+using bsoncxx::builder::basic::kvp;
+using bsoncxx::builder::basic::make_array;
+using bsoncxx::builder::basic::make_document;
+
+namespace {
+
+constexpr int32_t kDuplicateKeyError = 11000;
+constexpr int32_t kNamespaceExistsError = 48;
+
+// The driver requires exactly one instance per process, created before any client
+mongocxx::instance& driverInstance() {
+    static mongocxx::instance instance;
+    return instance;
+}
+
+// The "metadata" subdocument, with the field names and types of the former JSON text
+bsoncxx::document::value buildMetadataDocument(const FrameMetadata& metadata) {
+    bsoncxx::builder::basic::array regions;
+    for (const auto& region : metadata.consolidatedRegions) {
+        regions.append(make_document(
+            kvp("x", region.box.x), kvp("y", region.box.y), kvp("width", region.box.width),
+            kvp("height", region.box.height), kvp("object_count", region.objectCount),
+            kvp("class_label", region.classLabel),
+            kvp("class_confidence", static_cast<double>(region.classConfidence)),
+            kvp("class_id", region.classId), kvp("speed", static_cast<double>(region.speed)),
+            kvp("direction", static_cast<double>(region.direction))));
+    }
+
+    bsoncxx::builder::basic::document document;
+    document.append(kvp("source", metadata.source), kvp("frame_count", metadata.frameCount),
+                    kvp("timestamp",
+                        bsoncxx::types::b_date{std::chrono::seconds(metadata.timestamp)}),
+                    kvp("auto_saved", metadata.autoSaved),
+                    kvp("motion_detected", metadata.motionDetected),
+                    kvp("motion_regions", metadata.motionRegions),
+                    kvp("consolidated_regions_count",
+                        static_cast<int32_t>(metadata.consolidatedRegions.size())),
+                    kvp("confidence", metadata.confidence), kvp("consolidated_regions", regions));
+    if (metadata.includeMotionBoxes) {
+        bsoncxx::builder::basic::array boxes;
+        for (const auto& box : metadata.motionBoxes) {
+            boxes.append(make_document(kvp("x", box.x), kvp("y", box.y), kvp("width", box.width),
+                                       kvp("height", box.height)));
+        }
+        document.append(kvp("motion_boxes", boxes));
+    }
+    if (metadata.captureTimeUs != 0) {
+        const LatencyMetadata& latency = metadata.latency;
+        const std::chrono::milliseconds captureTime(metadata.captureTimeUs / 1000);
+        document.append(
+            kvp("capture_time", bsoncxx::types::b_date{captureTime}),
+            kvp("source_timestamp_ms", metadata.sourceTimestampMs),
+            kvp("latency_ms", make_document(kvp("detect_queued", latency.detectQueuedMs),
+                                            kvp("detect", latency.detectMs),
+                                            kvp("consolidate_queued", latency.consolidateQueuedMs),
+                                            kvp("consolidate", latency.consolidateMs),
+                                            kvp("render_queued", latency.renderQueuedMs),
+                                            kvp("total", latency.totalMs))));
+    }
+    if (!metadata.motionMask.size.empty()) {
+        const MotionMaskMetadata& mask = metadata.motionMask;
+        const auto box = [](const cv::Rect& rect) {
+            return make_document(kvp("x", rect.x), kvp("y", rect.y), kvp("width", rect.width),
+                                 kvp("height", rect.height));
+        };
+        document.append(kvp(
+            "motion_mask",
+            make_document(kvp("width", mask.size.width), kvp("height", mask.size.height),
+                          kvp("roi", box(mask.frameArea)), kvp("pixels", mask.pixels),
+                          kvp("bounds", box(mask.bounds)),
+                          kvp("centroid", make_document(kvp("x", mask.centroid.x), kvp("y", mask.centroid.y))),
+                          kvp("counts", mask.counts))));
+    }
+    if (metadata.isVisit) {
+        const VisitMetadata& visit = metadata.visit;
+        bsoncxx::builder::basic::array trackIds;
+        for (const int id : visit.trackIds) trackIds.append(id);
+        bsoncxx::builder::basic::array path;
+        for (const VisitPathPoint& point : visit.path) {
+            path.append(make_document(kvp("x", point.center.x), kvp("y", point.center.y),
+                                      kvp("t_ms", point.offsetMs)));
+        }
+        bsoncxx::builder::basic::array scores;
+        for (const double score : visit.cropScores) scores.append(score);
+        document.append(kvp(
+            "visit",
+            make_document(kvp("start_time", bsoncxx::types::b_date{std::chrono::milliseconds(visit.startUs / 1000)}),
+                          kvp("end_time", bsoncxx::types::b_date{std::chrono::milliseconds(visit.endUs / 1000)}),
+                          kvp("duration_s", static_cast<double>(visit.endUs - visit.startUs) / 1e6),
+                          kvp("frames", visit.frames), kvp("track_ids", trackIds), kvp("path", path),
+                          kvp("crop_scores", scores))));
+    }
+    return document.extract();
+}
+
+bsoncxx::document::value buildFrameDocument(const StoredFrameRecord& record,
+                                            const bsoncxx::types::b_date& now) {
+    const bsoncxx::document::value metadata = buildMetadataDocument(record.metadata);
+
+    // Field names and types mirror FrameDatabaseV2.save_frame_with_original()
+    bsoncxx::builder::basic::document document;
+    document.append(kvp("_id", record.uuid));
+    // Python stores None for images that were not written (failed thumbnails, and the
+    // full-size frames of region-crop records)
+    for (const auto& image : {std::make_pair("original_image_path", &record.originalPath),
+                              std::make_pair("processed_image_path", &record.processedPath),
+                              std::make_pair("original_thumbnail_path",
+                                             &record.originalThumbnailPath),
+                              std::make_pair("processed_thumbnail_path",
+                                             &record.processedThumbnailPath)}) {
+        if (image.second->empty()) {
+            document.append(kvp(image.first, bsoncxx::types::b_null{}));
+        } else {
+            document.append(kvp(image.first, *image.second));
+        }
+    }
+    // Images appended to a FrameSegmentStore: {file, offset, length} instead of a path
+    for (const auto& image :
+         {std::make_pair("original_image_segment", &record.originalSegment),
+          std::make_pair("processed_image_segment", &record.processedSegment),
+          std::make_pair("original_thumbnail_segment", &record.originalThumbnailSegment),
+          std::make_pair("processed_thumbnail_segment", &record.processedThumbnailSegment)}) {
+        const SegmentExtent& extent = *image.second;
+        if (extent.empty()) continue;
+        bsoncxx::builder::basic::document segment;
+        segment.append(kvp("file", extent.file), kvp("offset", static_cast<int64_t>(extent.offset)),
+                       kvp("length", static_cast<int64_t>(extent.length)));
+        if (!extent.contentType.empty()) segment.append(kvp("content_type", extent.contentType));
+        document.append(kvp(image.first, segment.extract()));
+    }
+    // Stable URLs and sizes, all the viewer's frame list needs of the images
+    bsoncxx::builder::basic::document images;
+    for (const StoredImageLink& link : storedImageLinks(record)) {
+        images.append(kvp(link.kind, make_document(kvp("url", link.url),
+                                                   kvp("bytes", static_cast<int64_t>(link.bytes)))));
+    }
+    document.append(kvp("images", images.extract()));
+    if (!record.regionCrops.empty()) {
+        bsoncxx::builder::basic::array crops;
+        for (size_t i = 0; i < record.regionCrops.size(); ++i) {
+            const StoredRegionCrop& crop = record.regionCrops[i];
+            crops.append(make_document(
+                kvp("path", crop.path),
+                kvp("region", make_array(crop.region.x, crop.region.y, crop.region.width,
+                                         crop.region.height)),
+                kvp("crop", make_array(crop.crop.x, crop.crop.y, crop.crop.width,
+                                       crop.crop.height)),
+                kvp("url", regionCropUrl(record.uuid, i)),
+                kvp("bytes", static_cast<int64_t>(crop.bytes))));
+        }
+        document.append(kvp("region_crops", crops));
+    }
+    if (!record.plate.id.empty()) {
+        document.append(kvp("background_plate",
+                            make_document(kvp("id", record.plate.id), kvp("path", record.plate.path),
+                                          kvp("size", make_array(record.plate.size.width,
+                                                                 record.plate.size.height)))));
+    }
+    if (!record.atlasCell.sheet.empty()) {
+        const AtlasCell& cell = record.atlasCell;
+        document.append(kvp(
+            "thumbnail_atlas",
+            make_document(kvp("sheet", cell.sheet),
+                          kvp("sheet_size", make_array(cell.sheetSize.width, cell.sheetSize.height)),
+                          kvp("rect", make_array(cell.rect.x, cell.rect.y, cell.rect.width, cell.rect.height)))));
+    }
+    document.append(
+        kvp("frame_shape", make_array(record.processedSize.height, record.processedSize.width,
+                                      record.processedChannels)),
+        kvp("original_frame_shape", make_array(record.originalSize.height,
+                                               record.originalSize.width,
+                                               record.originalChannels)),
+        kvp("frame_dtype", "uint8"), kvp("original_frame_dtype", "uint8"), kvp("timestamp", now),
+        kvp("stream", record.metadata.source), kvp("created_at", now), kvp("metadata", metadata.view()));
+    return document.extract();
+}
+
+// Upsert of one minute's summary; same fields as FrameDatabaseV2.upsert_motion_stats()
+bsoncxx::document::value buildSummaryUpdate(const MotionMinuteSummary& summary,
+                                            const bsoncxx::types::b_date& now) {
+    const bsoncxx::types::b_date minute{std::chrono::seconds(summary.minuteStart)};
+    return make_document(
+        kvp("$setOnInsert", make_document(kvp("source", summary.source), kvp("minute", minute))),
+        kvp("$inc", make_document(
+                        kvp("frames", static_cast<int64_t>(summary.frames)),
+                        kvp("motion_frames", static_cast<int64_t>(summary.motionFrames)),
+                        kvp("motion_boxes", static_cast<int64_t>(summary.motionBoxes)),
+                        kvp("regions", static_cast<int64_t>(summary.regions)))),
+        kvp("$max", make_document(kvp("max_regions", static_cast<int64_t>(summary.maxRegions)),
+                                  kvp("latency_max_ms", summary.latencyMaxMs))),
+        kvp("$set", make_document(kvp("mean_boxes_per_frame", summary.meanBoxesPerFrame()),
+                                  kvp("latency_p50_ms", summary.latencyP50Ms),
+                                  kvp("latency_p95_ms", summary.latencyP95Ms),
+                                  kvp("latency_p99_ms", summary.latencyP99Ms),
+                                  kvp("updated_at", now))));
+}
+
+// Whether the frame collection is a time-series collection; a missing one is created as
+// one (timestamp as timeField, the stream as metaField) when config.timeSeries is set
+bool ensureFrameCollection(mongocxx::database& database, const FrameStoreConfig& config) {
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        for (const auto& info : database.list_collections(make_document(kvp("name", config.collectionName)))) {
+            return info["type"] && info["type"].get_string().value == bsoncxx::stdx::string_view("timeseries");
+        }
+        if (!config.timeSeries) return false;
+        bsoncxx::builder::basic::document options;
+        options.append(kvp("timeseries", make_document(kvp("timeField", "timestamp"), kvp("metaField", "stream"),
+                                                       kvp("granularity", "seconds"))));
+        if (config.retentionDays > 0) {
+            options.append(kvp("expireAfterSeconds", static_cast<int64_t>(config.retentionDays) * 86400));
+        }
+        try {
+            database.create_collection(config.collectionName, options.extract());
+            LOG_INFO("FrameStore created time-series collection {}", config.collectionName);
+            return true;
+        } catch (const mongocxx::operation_exception& e) {
+            // FrameDatabaseV2 (or another writer) created it first: look again
+            if (e.code().value() != kNamespaceExistsError) throw;
+        }
+    }
+    return false;
+}
+
+// Documents expire retentionDays after their timestamp: the collection's own TTL for a
+// time-series collection, the timestamp index made a TTL index for a regular one
+void applyRetention(mongocxx::database& database, const FrameStoreConfig& config, bool timeSeries) {
+    if (config.retentionDays <= 0) return;
+    const int64_t seconds = static_cast<int64_t>(config.retentionDays) * 86400;
+    if (timeSeries) {
+        database.run_command(
+            make_document(kvp("collMod", config.collectionName), kvp("expireAfterSeconds", seconds)));
+    } else {
+        database.run_command(make_document(
+            kvp("collMod", config.collectionName),
+            kvp("index", make_document(kvp("keyPattern", make_document(kvp("timestamp", 1))),
+                                       kvp("expireAfterSeconds", seconds)))));
+    }
+}
+
+}  // namespace
+
+struct FrameStore::Impl {
+    std::unique_ptr<mongocxx::pool> pool;
+    bool timeSeries = false;
+    std::atomic<int64_t> expiredHour{-1};  // Hour (Unix time / 3600) of the last partition expiry
+};
+
+FrameStore::FrameStore(const FrameStoreConfig& config)
+    : config_(config), fileStorage_(config.storagePath), impl_(std::make_unique<Impl>()) {}
+
+FrameStore::~FrameStore() = default;
+
+bool FrameStore::connect() {
+    driverInstance();
+    fileStorage_.ensureDirectories();
+    try {
+        impl_->pool = std::make_unique<mongocxx::pool>(mongocxx::uri{config_.uri});
+    } catch (const mongocxx::exception& e) {
+        LOG_ERROR("FrameStore: invalid MongoDB URI {}: {}", config_.uri, e.what());
+        impl_->pool.reset();
+        return false;
+    }
+
+    try {
+        auto client = impl_->pool->acquire();
+        auto database = (*client)[config_.databaseName];
+        database.run_command(make_document(kvp("ping", 1)));
+
+        // Same collection, indexes and TTL as FrameDatabaseV2._create_indexes()
+        impl_->timeSeries = ensureFrameCollection(database, config_);
+        auto collection = database[config_.collectionName];
+        for (const char* field : {"timestamp", "created_at", "metadata.source",
+                                  "metadata.motion_detected", "metadata.motion_regions"}) {
+            collection.create_index(make_document(kvp(field, 1)));
+        }
+        collection.create_index(make_document(kvp("metadata.timestamp", -1), kvp("_id", -1)));
+        // Time-series collections have no _id index of their own; insertRecords() looks ids up
+        if (impl_->timeSeries) collection.create_index(make_document(kvp("_id", 1)));
+        applyRetention(database, config_, impl_->timeSeries);
+        database[config_.statsCollectionName].create_index(
+            make_document(kvp("minute", -1), kvp("source", 1)));
+        LOG_INFO("FrameStore connected to {} ({}.{}{}, retention {} days)", config_.uri, config_.databaseName,
+                 config_.collectionName, impl_->timeSeries ? ", time-series" : "", config_.retentionDays);
+        return true;
+    } catch (const mongocxx::exception& e) {
+        // Keep the pool: the driver reconnects on its own once the server is reachable
+        LOG_ERROR("FrameStore could not reach {}: {}", config_.uri, e.what());
+        return false;
+    }
+}
+
+bool FrameStore::isConnected() const { return impl_->pool != nullptr; }
+
+std::string FrameStore::saveFrame(const cv::Mat& original, const cv::Mat& processed,
+                                  const FrameMetadata& metadata) {
+    StoredFrameRecord record;
+    if (!fileStorage_.write(original, processed, record)) return std::string("");
+    record.metadata = metadata;
+    std::vector<std::string> inserted = insertRecords({record});
+    return inserted.empty() ? std::string("") : inserted.front();
+}
+
+std::vector<std::string> FrameStore::insertRecords(const std::vector<StoredFrameRecord>& records) {
+    std::vector<std::string> inserted;
+    if (records.empty()) return inserted;
+    if (!isConnected()) {
+        LOG_ERROR("FrameStore not connected; dropping {} frames", records.size());
+        for (const auto& record : records) fileStorage_.remove(record);
+        return inserted;
+    }
+    expirePartitions();
+
+    const bsoncxx::types::b_date now{std::chrono::system_clock::now()};
+    std::set<size_t> failed;
+    try {
+        auto client = impl_->pool->acquire();
+        auto collection = (*client)[config_.databaseName][config_.collectionName];
+
+        // A time-series collection accepts a second document with the same _id, so frames a
+        // resend already stored are skipped here instead of failing as duplicate keys
+        std::set<std::string> stored;
+        if (impl_->timeSeries) {
+            bsoncxx::builder::basic::array ids;
+            for (const auto& record : records) ids.append(record.uuid);
+            mongocxx::options::find options;
+            options.projection(make_document(kvp("_id", 1)));
+            for (const auto& document :
+                 collection.find(make_document(kvp("_id", make_document(kvp("$in", ids)))), options)) {
+                const auto id = document["_id"].get_string().value;
+                stored.emplace(id.data(), id.size());
+            }
+        }
+
+        std::vector<bsoncxx::document::value> documents;
+        std::vector<size_t> positions;  // Index in records of each document
+        documents.reserve(records.size());
+        for (size_t i = 0; i < records.size(); ++i) {
+            if (stored.count(records[i].uuid)) continue;
+            documents.push_back(buildFrameDocument(records[i], now));
+            positions.push_back(i);
+        }
+        if (!documents.empty()) {
+            mongocxx::options::insert options;
+            options.ordered(false);  // One bad document must not block the rest of the batch
+            try {
+                collection.insert_many(documents, options);
+            } catch (const mongocxx::bulk_write_exception& e) {
+                LOG_ERROR("FrameStore batch insert partially failed: {}", e.what());
+                bool listed = false;  // The server named the failed documents
+                if (e.raw_server_error()) {
+                    auto writeErrors = e.raw_server_error()->view()["writeErrors"];
+                    if (writeErrors && writeErrors.type() == bsoncxx::type::k_array) {
+                        for (const auto& error : writeErrors.get_array().value) {
+                            listed = true;
+                            // Duplicate _id: the frame is already stored (a resend, see UplinkIngestServer)
+                            if (error["code"] && error["code"].get_int32().value == kDuplicateKeyError) continue;
+                            failed.insert(positions[static_cast<size_t>(error["index"].get_int32().value)]);
+                        }
+                    }
+                }
+                if (!listed) failed.insert(positions.begin(), positions.end());
+            }
+        }
+    } catch (const mongocxx::exception& e) {
+        LOG_ERROR("FrameStore batch insert failed: {}", e.what());
+        for (size_t i = 0; i < records.size(); ++i) failed.insert(i);
+    }
+
+    inserted.reserve(records.size() - failed.size());
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (failed.count(i)) {
+            fileStorage_.remove(records[i]);
+        } else {
+            inserted.push_back(records[i].uuid);
+        }
+    }
+    return inserted;
+}
+
+void FrameStore::expirePartitions() {
+    if (config_.retentionDays <= 0) return;
+    const std::time_t now = std::time(nullptr);
+    // Partitions are hours: once per hour one more may have aged out
+    if (impl_->expiredHour.exchange(now / 3600) == now / 3600) return;
+    fileStorage_.removePartitionsBefore(now - static_cast<std::time_t>(config_.retentionDays) * 86400);
+}
+
+bool FrameStore::upsertMotionSummaries(const std::vector<MotionMinuteSummary>& summaries) {
+    if (summaries.empty()) return true;
+    if (!isConnected()) {
+        LOG_ERROR("FrameStore not connected; dropping {} motion summaries", summaries.size());
+        return false;
+    }
+
+    const bsoncxx::types::b_date now{std::chrono::system_clock::now()};
+    try {
+        auto client = impl_->pool->acquire();
+        auto collection = (*client)[config_.databaseName][config_.statsCollectionName];
+        mongocxx::options::bulk_write options;
+        options.ordered(false);
+        auto bulk = collection.create_bulk_write(options);
+        for (const auto& summary : summaries) {
+            mongocxx::model::update_one upsert{make_document(kvp("_id", summary.id())),
+                                               buildSummaryUpdate(summary, now)};
+            upsert.upsert(true);
+            bulk.append(upsert);
+        }
+        bulk.execute();
+        return true;
+    } catch (const mongocxx::exception& e) {
+        LOG_ERROR("FrameStore motion summary upsert failed: {}", e.what());
+        return false;
+    }
+}
@@ -0,0 +1,176 @@
+#include "gl_preview_window.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include "logger.hpp"
+
+#ifdef BIRDS_HAVE_OPENGL
+#include <opencv2/highgui.hpp>
+#include <opencv2/imgproc.hpp>
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#endif
+
+namespace {
+
+#ifdef BIRDS_HAVE_OPENGL
+// Label textures kept before unused ones are dropped (the status line changes every frame)
+constexpr size_t kMaxLabels = 256;
+// Frames a label may go unused before it can be dropped
+constexpr uint64_t kLabelIdleFrames = 30;
+#endif
+
+}  // namespace
+
+GlPreviewWindow::GlPreviewWindow(std::string title) : title_(std::move(title)) {}
+
+GlPreviewWindow::~GlPreviewWindow() { close(); }
+
+#ifdef BIRDS_HAVE_OPENGL
+
+bool GlPreviewWindow::open() {
+    if (open_) return true;
+    try {
+        cv::namedWindow(title_, cv::WINDOW_OPENGL);
+        cv::setOpenGlDrawCallback(title_, &GlPreviewWindow::onDraw, this);
+    } catch (const cv::Exception& e) {
+        // OpenCV built without OpenGL, or no GL context for the window
+        LOG_WARN("OpenGL preview unavailable ({}); drawing the preview on the CPU", e.what());
+        try {
+            cv::destroyWindow(title_);
+        } catch (const cv::Exception&) {
+        }
+        return false;
+    }
+    open_ = true;
+    LOG_INFO("Preview window: OpenGL (frame uploaded as a texture, overlay drawn by the GPU)");
+    return true;
+}
+
+void GlPreviewWindow::close() {
+    if (!open_) return;
+    open_ = false;
+    try {
+        cv::setOpenGlContext(title_);
+        labels_.clear();
+        frameTexture_.release();
+        cv::setOpenGlDrawCallback(title_, nullptr, nullptr);
+        cv::destroyWindow(title_);
+    } catch (const cv::Exception& e) {
+        LOG_WARN("Closing the OpenGL preview: {}", e.what());
+    }
+}
+
+void GlPreviewWindow::show(const cv::Mat& frame, const PreviewOverlay& overlay) {
+    if (!open_ || frame.empty()) return;
+    cv::setOpenGlContext(title_);
+    if (frame.channels() == 1) {
+        cv::cvtColor(frame, converted_, cv::COLOR_GRAY2BGR);  // A one-channel texture would be red
+        frameTexture_.copyFrom(converted_);
+    } else {
+        frameTexture_.copyFrom(frame);  // Uploaded as GL_BGR, no swizzle needed
+    }
+    if (frame.size() != frameSize_) {
+        frameSize_ = frame.size();
+        cv::resizeWindow(title_, frameSize_.width, frameSize_.height);
+    }
+    overlay_ = overlay;
+    frames_++;
+    for (const PreviewOverlay::Text& text : overlay_.texts) label(text).lastUsed = frames_;
+    evictLabels();
+    cv::updateWindow(title_);
+}
+
+void GlPreviewWindow::onDraw(void* self) { static_cast<GlPreviewWindow*>(self)->draw(); }
+
+// cv::ogl::render leaves a [0,1] x [0,1] projection with y down, so frame pixels are
+// divided by the frame size; the window's size never enters the drawing.
+void GlPreviewWindow::draw() {
+    if (frameTexture_.empty() || frameSize_.area() <= 0) return;
+    const double w = frameSize_.width;
+    const double h = frameSize_.height;
+
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    cv::ogl::render(frameTexture_);
+
+    glDisable(GL_TEXTURE_2D);
+    for (const PreviewOverlay::Box& box : overlay_.boxes) {
+        const cv::Scalar& c = box.color;
+        glColor3ub(static_cast<GLubyte>(c[2]), static_cast<GLubyte>(c[1]), static_cast<GLubyte>(c[0]));
+        glLineWidth(static_cast<GLfloat>(std::max(1, box.thickness)));
+        glBegin(GL_LINE_LOOP);
+        glVertex2d(box.rect.x / w, box.rect.y / h);
+        glVertex2d((box.rect.x + box.rect.width) / w, box.rect.y / h);
+        glVertex2d((box.rect.x + box.rect.width) / w, (box.rect.y + box.rect.height) / h);
+        glVertex2d(box.rect.x / w, (box.rect.y + box.rect.height) / h);
+        glEnd();
+    }
+
+    // Labels are RGBA with a transparent background
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    for (const PreviewOverlay::Text& text : overlay_.texts) {
+        Label& cached = label(text);
+        const double top = text.origin.y - (cached.size.height - cached.baseline);
+        cv::ogl::render(cached.texture, cv::Rect_<double>(text.origin.x / w, top / h, cached.size.width / w,
+                                                          cached.size.height / h));
+    }
+    glDisable(GL_BLEND);
+    glDisable(GL_TEXTURE_2D);
+}
+
+GlPreviewWindow::Label& GlPreviewWindow::label(const PreviewOverlay::Text& text) {
+    const cv::Scalar& c = text.color;
+    const std::string key = text.text + '\x1f' + std::to_string(static_cast<int>(c[0])) + ',' +
+                            std::to_string(static_cast<int>(c[1])) + ',' + std::to_string(static_cast<int>(c[2])) +
+                            ',' + std::to_string(text.fontScale) + ',' + std::to_string(text.thickness);
+    auto it = labels_.find(key);
+    if (it != labels_.end()) return it->second;
+
+    // Rasterized once with the same font and size the CPU path draws, in frame pixels
+    int baseline = 0;
+    const cv::Size textSize =
+        cv::getTextSize(text.text, cv::FONT_HERSHEY_SIMPLEX, text.fontScale, text.thickness, &baseline);
+    Label created;
+    created.baseline = baseline + text.thickness;
+    created.size = cv::Size(std::max(1, textSize.width + text.thickness),
+                            std::max(1, textSize.height + created.baseline + text.thickness));
+    cv::Mat pixels(created.size, CV_8UC4, cv::Scalar::all(0));
+    cv::putText(pixels, text.text, cv::Point(0, created.size.height - created.baseline), cv::FONT_HERSHEY_SIMPLEX,
+                text.fontScale, cv::Scalar(c[0], c[1], c[2], 255), text.thickness);
+    created.texture.copyFrom(pixels);
+    return labels_.emplace(key, std::move(created)).first->second;
+}
+
+void GlPreviewWindow::evictLabels() {
+    if (labels_.size() <= kMaxLabels) return;
+    for (auto it = labels_.begin(); it != labels_.end();) {
+        if (it->second.lastUsed + kLabelIdleFrames < frames_) {
+            it = labels_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+#else  // !BIRDS_HAVE_OPENGL
+
+bool GlPreviewWindow::open() {
+    LOG_INFO("OpenGL preview not built (ENABLE_OPENGL_PREVIEW off or OpenGL not found); drawing the preview "
+             "on the CPU");
+    return false;
+}
+
+void GlPreviewWindow::close() { open_ = false; }
+
+void GlPreviewWindow::show(const cv::Mat& frame, const PreviewOverlay& overlay) {
+    (void)frame;
+    (void)overlay;
+}
+
+#endif  // BIRDS_HAVE_OPENGL
@@ -0,0 +1,240 @@
+#include "image_encoder.hpp"
+
+#include <cstring>
+#include <memory>
+#include <opencv2/imgproc.hpp>
+
+#include "jpeg_encoder.hpp"
+#include "logger.hpp"
+
+#ifndef BIRDS_HAVE_WEBP
+#define BIRDS_HAVE_WEBP 0
+#endif
+#ifndef BIRDS_HAVE_AVIF
+#define BIRDS_HAVE_AVIF 0
+#endif
+#ifndef BIRDS_HAVE_JXL
+#define BIRDS_HAVE_JXL 0
+#endif
+
+#if BIRDS_HAVE_WEBP
+#include <webp/encode.h>
+#endif
+#if BIRDS_HAVE_AVIF
+#include <avif/avif.h>
+#endif
+#if BIRDS_HAVE_JXL
+#include <jxl/encode.h>
+#endif
+
+namespace {
+
+[[maybe_unused]] int clampEffort(int effort) { return std::max(1, std::min(9, effort)); }
+
+// WebP and AVIF take BGR input only
+[[maybe_unused]] const cv::Mat& asBgr(const cv::Mat& image, cv::Mat& converted) {
+    if (image.channels() == 3) return image;
+    cv::cvtColor(image, converted, cv::COLOR_GRAY2BGR);
+    return converted;
+}
+
+#if BIRDS_HAVE_WEBP
+bool encodeWebP(const cv::Mat& image, const ImageEncodeSettings& settings, std::vector<unsigned char>& output) {
+    WebPConfig config;
+    if (!WebPConfigInit(&config)) return false;
+    config.quality = static_cast<float>(settings.quality);
+    config.method = ((clampEffort(settings.effort) - 1) * 6 + 4) / 8;  // 1..9 -> 0..6
+    WebPPicture picture;
+    if (!WebPPictureInit(&picture)) return false;
+    cv::Mat converted;
+    const cv::Mat& bgr = asBgr(image, converted);
+    picture.width = bgr.cols;
+    picture.height = bgr.rows;
+    WebPMemoryWriter writer;
+    WebPMemoryWriterInit(&writer);
+    picture.writer = WebPMemoryWrite;
+    picture.custom_ptr = &writer;
+    const bool ok = WebPPictureImportBGR(&picture, bgr.data, static_cast<int>(bgr.step)) &&
+                    WebPEncode(&config, &picture);
+    if (ok) output.assign(writer.mem, writer.mem + writer.size);
+    else LOG_ERROR("WebP encoding failed (error {})", static_cast<int>(picture.error_code));
+    WebPMemoryWriterClear(&writer);
+    WebPPictureFree(&picture);
+    return ok;
+}
+#endif
+
+#if BIRDS_HAVE_AVIF
+bool encodeAvif(const cv::Mat& image, const ImageEncodeSettings& settings, std::vector<unsigned char>& output) {
+    cv::Mat converted;
+    const cv::Mat& bgr = asBgr(image, converted);
+    std::unique_ptr<avifImage, decltype(&avifImageDestroy)> avif(
+        avifImageCreate(static_cast<uint32_t>(bgr.cols), static_cast<uint32_t>(bgr.rows), 8,
+                        AVIF_PIXEL_FORMAT_YUV420),
+        &avifImageDestroy);
+    std::unique_ptr<avifEncoder, decltype(&avifEncoderDestroy)> encoder(avifEncoderCreate(), &avifEncoderDestroy);
+    if (!avif || !encoder) return false;
+
+    avifRGBImage rgb;
+    avifRGBImageSetDefaults(&rgb, avif.get());
+    rgb.format = AVIF_RGB_FORMAT_BGR;
+    rgb.depth = 8;
+    rgb.pixels = const_cast<uint8_t*>(bgr.data);  // Only read
+    rgb.rowBytes = static_cast<uint32_t>(bgr.step);
+    avifResult result = avifImageRGBToYUV(avif.get(), &rgb);
+    if (result == AVIF_RESULT_OK) {
+        encoder->quality = settings.quality;
+        encoder->speed = 10 - clampEffort(settings.effort);  // 1..9 -> speed 9..1
+        encoder->maxThreads = 1;
+        avifRWData encoded = AVIF_DATA_EMPTY;
+        result = avifEncoderWrite(encoder.get(), avif.get(), &encoded);
+        if (result == AVIF_RESULT_OK) output.assign(encoded.data, encoded.data + encoded.size);
+        avifRWDataFree(&encoded);
+    }
+    if (result != AVIF_RESULT_OK) LOG_ERROR("AVIF encoding failed: {}", avifResultToString(result));
+    return result == AVIF_RESULT_OK;
+}
+#endif
+
+#if BIRDS_HAVE_JXL
+using JxlEncoderPtr = std::unique_ptr<JxlEncoder, decltype(&JxlEncoderDestroy)>;
+
+// Collect the encoder's output once its input is closed
+bool drainJxl(JxlEncoder* encoder, std::vector<unsigned char>& output) {
+    output.resize(64 * 1024);
+    size_t used = 0;
+    while (true) {
+        uint8_t* next = output.data() + used;
+        size_t available = output.size() - used;
+        const JxlEncoderStatus status = JxlEncoderProcessOutput(encoder, &next, &available);
+        used = static_cast<size_t>(next - output.data());
+        if (status == JXL_ENC_SUCCESS) break;
+        if (status != JXL_ENC_NEED_MORE_OUTPUT) {
+            LOG_ERROR("JPEG XL encoding failed (error {})", static_cast<int>(JxlEncoderGetError(encoder)));
+            return false;
+        }
+        output.resize(output.size() * 2);
+    }
+    output.resize(used);
+    return true;
+}
+
+bool encodeJxl(const cv::Mat& image, const ImageEncodeSettings& settings, std::vector<unsigned char>& output) {
+    JxlEncoderPtr encoder(JxlEncoderCreate(nullptr), &JxlEncoderDestroy);
+    if (!encoder) return false;
+    const bool gray = image.channels() == 1;
+    // libjxl wants RGB, tightly packed
+    cv::Mat pixels;
+    if (gray) {
+        pixels = image.isContinuous() ? image : image.clone();
+    } else {
+        cv::cvtColor(image, pixels, cv::COLOR_BGR2RGB);
+    }
+
+    JxlBasicInfo info;
+    JxlEncoderInitBasicInfo(&info);
+    info.xsize = static_cast<uint32_t>(pixels.cols);
+    info.ysize = static_cast<uint32_t>(pixels.rows);
+    info.bits_per_sample = 8;
+    info.num_color_channels = gray ? 1 : 3;
+    info.uses_original_profile = JXL_FALSE;  // Lossy: XYB
+    JxlColorEncoding color;
+    JxlColorEncodingSetToSRGB(&color, gray ? JXL_TRUE : JXL_FALSE);
+    JxlEncoderFrameSettings* frame = JxlEncoderFrameSettingsCreate(encoder.get(), nullptr);
+    const JxlPixelFormat format = {gray ? 1u : 3u, JXL_TYPE_UINT8, JXL_NATIVE_ENDIAN, 0};
+    if (JxlEncoderSetBasicInfo(encoder.get(), &info) != JXL_ENC_SUCCESS ||
+        JxlEncoderSetColorEncoding(encoder.get(), &color) != JXL_ENC_SUCCESS || !frame ||
+        JxlEncoderSetFrameDistance(frame, JxlEncoderDistanceFromQuality(static_cast<float>(settings.quality))) !=
+            JXL_ENC_SUCCESS ||
+        JxlEncoderFrameSettingsSetOption(frame, JXL_ENC_FRAME_SETTING_EFFORT, clampEffort(settings.effort)) !=
+            JXL_ENC_SUCCESS ||
+        JxlEncoderAddImageFrame(frame, &format, pixels.data, pixels.total() * pixels.elemSize()) !=
+            JXL_ENC_SUCCESS) {
+        LOG_ERROR("JPEG XL encoder setup failed (error {})", static_cast<int>(JxlEncoderGetError(encoder.get())));
+        return false;
+    }
+    JxlEncoderCloseInput(encoder.get());
+    return drainJxl(encoder.get(), output);
+}
+#endif
+
+}  // namespace
+
+bool ImageEncoder::encode(const cv::Mat& image, const ImageEncodeSettings& settings,
+                          std::vector<unsigned char>& output) {
+    if (settings.codec == ImageCodec::Jpeg) return JpegEncoder::encode(image, settings.quality, output);
+    if (image.empty() || image.depth() != CV_8U || (image.channels() != 1 && image.channels() != 3)) {
+        LOG_ERROR("{} encoding needs a CV_8UC1 or CV_8UC3 image, got type {}", imageCodecName(settings.codec),
+                  image.type());
+        return false;
+    }
+    switch (settings.codec) {
+#if BIRDS_HAVE_WEBP
+        case ImageCodec::WebP:
+            return encodeWebP(image, settings, output);
+#endif
+#if BIRDS_HAVE_AVIF
+        case ImageCodec::Avif:
+            return encodeAvif(image, settings, output);
+#endif
+#if BIRDS_HAVE_JXL
+        case ImageCodec::JpegXl:
+            return encodeJxl(image, settings, output);
+#endif
+        default:
+            LOG_ERROR("Image codec {} is not built in", imageCodecName(settings.codec));
+            return false;
+    }
+}
+
+bool ImageEncoder::available(ImageCodec codec) {
+    switch (codec) {
+        case ImageCodec::Jpeg:
+            return true;
+        case ImageCodec::WebP:
+            return BIRDS_HAVE_WEBP;
+        case ImageCodec::Avif:
+            return BIRDS_HAVE_AVIF;
+        case ImageCodec::JpegXl:
+            return BIRDS_HAVE_JXL;
+    }
+    return false;
+}
+
+bool ImageEncoder::recompressJpeg(const std::vector<unsigned char>& jpeg, std::vector<unsigned char>& output) {
+#if BIRDS_HAVE_JXL
+    JxlEncoderPtr encoder(JxlEncoderCreate(nullptr), &JxlEncoderDestroy);
+    if (!encoder) return false;
+    // The reconstruction data makes the transcode reversible to the byte
+    JxlEncoderUseContainer(encoder.get(), JXL_TRUE);
+    JxlEncoderFrameSettings* frame = JxlEncoderFrameSettingsCreate(encoder.get(), nullptr);
+    if (!frame || JxlEncoderStoreJPEGMetadata(encoder.get(), JXL_TRUE) != JXL_ENC_SUCCESS ||
+        JxlEncoderAddJPEGFrame(frame, jpeg.data(), jpeg.size()) != JXL_ENC_SUCCESS) {
+        return false;
+    }
+    JxlEncoderCloseInput(encoder.get());
+    return drainJxl(encoder.get(), output);
+#else
+    (void)jpeg;
+    (void)output;
+    return false;
+#endif
+}
+
+bool ImageEncoder::detect(const std::vector<unsigned char>& bytes, ImageCodec& codec) {
+    const auto startsWith = [&bytes](size_t offset, const char* signature, size_t length) {
+        return bytes.size() >= offset + length && std::memcmp(bytes.data() + offset, signature, length) == 0;
+    };
+    if (startsWith(0, "\xFF\xD8\xFF", 3)) {
+        codec = ImageCodec::Jpeg;
+    } else if (startsWith(0, "RIFF", 4) && startsWith(8, "WEBP", 4)) {
+        codec = ImageCodec::WebP;
+    } else if (startsWith(4, "ftypavif", 8) || startsWith(4, "ftypavis", 8)) {
+        codec = ImageCodec::Avif;
+    } else if (startsWith(0, "\xFF\x0A", 2) || startsWith(0, "\x00\x00\x00\x0CJXL \x0D\x0A\x87\x0A", 12)) {
+        codec = ImageCodec::JpegXl;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,283 @@
+#include "io_reactor.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <string>
+
+#include "logger.hpp"
+#include "thread_placement.hpp"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr int kMaxWaitMs = 100;      // Upper bound on how long a thread sleeps without an event
+constexpr int kEventsPerWake = 64;
+constexpr uint64_t kWakeId = 0;      // epoll_event.data.u64 of wakeFd_; waits count up from 1
+
+#ifdef __linux__
+constexpr uint32_t kReadable = EPOLLIN | EPOLLRDHUP;
+constexpr uint32_t kWritable = EPOLLOUT;
+#else
+constexpr uint32_t kReadable = 1;
+constexpr uint32_t kWritable = 4;
+#endif
+
+}  // namespace
+
+void IoTask::promise_type::unhandled_exception() noexcept {
+    try {
+        std::rethrow_exception(std::current_exception());
+    } catch (const std::exception& e) {
+        LOG_ERROR("I/O task failed: {}", e.what());
+    } catch (...) {
+        LOG_ERROR("I/O task failed with an unknown exception");
+    }
+}
+
+IoReactor::IoReactor(size_t threadCount) : threadCount_(std::max<size_t>(threadCount, 1)) {}
+
+IoReactor::~IoReactor() { stop(); }
+
+IoReactor::FdWait IoReactor::readable(int fd, Clock::duration timeout) { return FdWait(*this, fd, kReadable, timeout); }
+
+IoReactor::FdWait IoReactor::writable(int fd, Clock::duration timeout) { return FdWait(*this, fd, kWritable, timeout); }
+
+bool IoReactor::start() {
+#ifdef __linux__
+    if (running_) return true;
+    epollFd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    wakeFd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = kWakeId;
+    if (epollFd_ < 0 || wakeFd_ < 0 || ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &event) < 0) {
+        LOG_ERROR("I/O reactor: cannot create the epoll instance: {}", std::strerror(errno));
+        if (epollFd_ >= 0) ::close(epollFd_);
+        if (wakeFd_ >= 0) ::close(wakeFd_);
+        epollFd_ = wakeFd_ = -1;
+        return false;
+    }
+    stopping_ = false;
+    running_ = true;
+    for (size_t i = 0; i < threadCount_; ++i) threads_.emplace_back(&IoReactor::run, this, i);
+    LOG_INFO("I/O reactor started with {} thread(s)", threadCount_);
+    return true;
+#else
+    LOG_ERROR("The I/O reactor needs Linux (epoll)");
+    return false;
+#endif
+}
+
+void IoReactor::stop() {
+#ifdef __linux__
+    if (!running_) return;
+    stopping_ = true;
+    wake();
+    for (std::thread& thread : threads_) thread.join();
+    threads_.clear();
+    drain();
+    running_ = false;
+    ::close(epollFd_);
+    ::close(wakeFd_);
+    epollFd_ = wakeFd_ = -1;
+    const IoReactorStats totals = stats();
+    LOG_INFO("I/O reactor stopped: {} tasks run, {} waits ({} timed out), {} tasks left suspended", totals.spawned,
+             totals.waits, totals.timeouts, totals.live);
+#endif
+}
+
+bool IoReactor::spawn(IoTask task) {
+    if (!running_ || stopping_) {
+        LOG_WARN("I/O reactor not running; task dropped");
+        return false;
+    }
+    auto handle = std::exchange(task.handle_, nullptr);
+    handle.promise().live = &liveTasks_;
+    liveTasks_.fetch_add(1);
+    spawned_.fetch_add(1);
+    if (!post(handle)) handle.resume();  // Stopped in between: runs to its end inline
+    return true;
+}
+
+bool IoReactor::post(std::coroutine_handle<> handle) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) return false;
+        ready_.push_back(handle);
+    }
+    wake();
+    return true;
+}
+
+bool IoReactor::addWait(std::coroutine_handle<> handle, int fd, uint32_t events, Clock::duration timeout,
+                        bool* result) {
+    *result = false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_ || !running_) return false;
+    const uint64_t id = nextWaitId_++;
+    Wait wait;
+    wait.handle = handle;
+    wait.fd = fd;
+    wait.result = result;
+#ifdef __linux__
+    if (fd >= 0) {
+        epoll_event event{};
+        event.events = events | EPOLLONESHOT;
+        event.data.u64 = id;
+        if (::epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+            LOG_ERROR("I/O reactor: cannot watch descriptor {}: {}", fd, std::strerror(errno));
+            return false;
+        }
+    }
+#else
+    (void)events;
+#endif
+    if (timeout != kNoTimeout) {
+        wait.deadline = deadlines_.emplace(Clock::now() + timeout, id);
+        wait.hasDeadline = true;
+    }
+    const bool earliest = wait.hasDeadline && wait.deadline == deadlines_.begin();
+    waits_.emplace(id, wait);
+    waitCount_.fetch_add(1, std::memory_order_relaxed);
+    // A sleeping thread computed its timeout before this deadline existed
+    if (earliest) wake();
+    return true;
+}
+
+std::coroutine_handle<> IoReactor::complete(uint64_t id, bool ready, bool timedOut) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = waits_.find(id);
+    if (it == waits_.end()) return nullptr;  // Another thread got there first
+    Wait& wait = it->second;
+#ifdef __linux__
+    if (wait.fd >= 0) ::epoll_ctl(epollFd_, EPOLL_CTL_DEL, wait.fd, nullptr);
+#endif
+    if (wait.hasDeadline) deadlines_.erase(wait.deadline);
+    // A timer alone (sleepFor) did what it was asked for
+    *wait.result = ready || (timedOut && wait.fd < 0);
+    if (timedOut && wait.fd >= 0) timeouts_.fetch_add(1, std::memory_order_relaxed);
+    const std::coroutine_handle<> handle = wait.handle;
+    waits_.erase(it);
+    return handle;
+}
+
+void IoReactor::cancel(int fd) {
+    if (fd < 0) return;
+    std::vector<uint64_t> ids;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& [id, wait] : waits_) {
+            if (wait.fd == fd) ids.push_back(id);
+        }
+    }
+    for (const uint64_t id : ids) {
+        if (const auto handle = complete(id, false)) {
+            if (!post(handle)) handle.resume();
+        }
+    }
+}
+
+void IoReactor::wake() {
+#ifdef __linux__
+    const uint64_t one = 1;
+    (void)!::write(wakeFd_, &one, sizeof(one));
+#endif
+}
+
+int IoReactor::nextTimeoutMs() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!ready_.empty()) return 0;
+    if (deadlines_.empty()) return kMaxWaitMs;
+    const auto remaining = deadlines_.begin()->first - Clock::now();
+    const auto ms = std::chrono::ceil<std::chrono::milliseconds>(remaining).count();
+    return static_cast<int>(std::clamp<int64_t>(ms, 0, kMaxWaitMs));
+}
+
+void IoReactor::run(size_t index) {
+#ifdef __linux__
+    nameCurrentThread("io_" + std::to_string(index));
+    epoll_event events[kEventsPerWake];
+    std::vector<uint64_t> expired;
+    std::deque<std::coroutine_handle<>> batch;
+    while (!stopping_) {
+        const int ready = ::epoll_wait(epollFd_, events, kEventsPerWake, nextTimeoutMs());
+        if (ready < 0 && errno != EINTR) {
+            LOG_ERROR("I/O reactor: epoll_wait failed: {}", std::strerror(errno));
+            break;
+        }
+        for (int i = 0; i < ready; ++i) {
+            const uint64_t id = events[i].data.u64;
+            if (id == kWakeId) {
+                // Left set while stopping, so every thread sees it
+                if (stopping_) break;
+                uint64_t count = 0;
+                (void)!::read(wakeFd_, &count, sizeof(count));
+                continue;
+            }
+            if (const auto handle = complete(id, true)) handle.resume();
+        }
+        if (stopping_) break;
+
+        expired.clear();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const Clock::time_point now = Clock::now();
+            for (auto it = deadlines_.begin(); it != deadlines_.end() && it->first <= now; ++it) {
+                expired.push_back(it->second);
+            }
+        }
+        for (const uint64_t id : expired) {
+            if (const auto handle = complete(id, false, true)) handle.resume();
+        }
+
+        // Tasks posted by spawn(), schedule() and cancel(), one batch per wakeup
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            batch.swap(ready_);
+        }
+        for (const auto handle : batch) handle.resume();
+        batch.clear();
+    }
+#else
+    (void)index;
+#endif
+}
+
+void IoReactor::drain() {
+    // Every wait resumes with false, and tasks see stopping_ on their next await
+    for (;;) {
+        std::vector<std::coroutine_handle<>> handles;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto& [id, wait] : waits_) {
+#ifdef __linux__
+                if (wait.fd >= 0) ::epoll_ctl(epollFd_, EPOLL_CTL_DEL, wait.fd, nullptr);
+#endif
+                *wait.result = false;
+                handles.push_back(wait.handle);
+            }
+            waits_.clear();
+            deadlines_.clear();
+            handles.insert(handles.end(), ready_.begin(), ready_.end());
+            ready_.clear();
+        }
+        if (handles.empty()) return;
+        for (const auto handle : handles) handle.resume();
+    }
+}
+
+IoReactorStats IoReactor::stats() const {
+    IoReactorStats stats;
+    stats.spawned = spawned_.load();
+    stats.live = liveTasks_.load();
+    stats.waits = waitCount_.load(std::memory_order_relaxed);
+    stats.timeouts = timeouts_.load(std::memory_order_relaxed);
+    return stats;
+}
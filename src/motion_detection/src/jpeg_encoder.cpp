@@ -0,0 +1,58 @@
+#include "jpeg_encoder.hpp"
+
+#include <opencv2/imgcodecs.hpp>
+
+#include "logger.hpp"
+
+#ifndef BIRDS_HAVE_TURBOJPEG
+#define BIRDS_HAVE_TURBOJPEG 0
+#endif
+
+#if BIRDS_HAVE_TURBOJPEG
+#include <turbojpeg.h>
+
+namespace {
+
+// TurboJPEG handles are not thread-safe; each encoding thread keeps its own
+struct CompressorHandle {
+    tjhandle handle = tjInitCompress();
+    ~CompressorHandle() {
+        if (handle) tjDestroy(handle);
+    }
+};
+
+}  // namespace
+#endif
+
+bool JpegEncoder::encode(const cv::Mat& image, int quality, std::vector<unsigned char>& output) {
+    if (image.empty() || image.depth() != CV_8U || (image.channels() != 1 && image.channels() != 3)) {
+        LOG_ERROR("JPEG encoding needs a CV_8UC1 or CV_8UC3 image, got type {}", image.type());
+        return false;
+    }
+
+#if BIRDS_HAVE_TURBOJPEG
+    thread_local CompressorHandle compressor;
+    if (!compressor.handle) {
+        LOG_ERROR("Could not create a TurboJPEG compressor");
+        return false;
+    }
+    const bool gray = image.channels() == 1;
+    const int subsampling = gray ? TJSAMP_GRAY : TJSAMP_420;
+    // Compress straight into the caller's buffer, sized for the worst case up front
+    output.resize(tjBufSize(image.cols, image.rows, subsampling));
+    unsigned char* destination = output.data();
+    unsigned long size = static_cast<unsigned long>(output.size());
+    if (tjCompress2(compressor.handle, image.data, image.cols, static_cast<int>(image.step), image.rows,
+                    gray ? TJPF_GRAY : TJPF_BGR, &destination, &size, subsampling, quality,
+                    TJFLAG_NOREALLOC | TJFLAG_FASTDCT) != 0) {
+        LOG_ERROR("TurboJPEG encoding failed: {}", tjGetErrorStr2(compressor.handle));
+        return false;
+    }
+    output.resize(size);
+    return true;
+#else
+    return cv::imencode(".jpg", image, output, {cv::IMWRITE_JPEG_QUALITY, quality});
+#endif
+}
+
+const char* JpegEncoder::backendName() { return BIRDS_HAVE_TURBOJPEG ? "turbojpeg" : "opencv"; }
@@ -0,0 +1,177 @@
+#include "jpeg_region_decoder.hpp"
+
+#include <algorithm>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "logger.hpp"
+
+#ifndef BIRDS_HAVE_TURBOJPEG
+#define BIRDS_HAVE_TURBOJPEG 0
+#endif
+
+#if BIRDS_HAVE_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+
+namespace {
+
+int scaledSize(int size, int denominator) { return (size + denominator - 1) / denominator; }
+
+// @p region of the full image, inside an image decoded at 1 / @p denominator whose top-left
+// corner is at @p origin of the full image
+cv::Rect scaledRegion(const cv::Rect& region, cv::Point origin, int denominator, cv::Size decoded) {
+    const cv::Rect scaled((region.x - origin.x) / denominator, (region.y - origin.y) / denominator,
+                          scaledSize(region.width, denominator), scaledSize(region.height, denominator));
+    return scaled & cv::Rect(cv::Point(), decoded);
+}
+
+#if BIRDS_HAVE_TURBOJPEG
+// TurboJPEG handles are not thread-safe; each decoding thread keeps its own
+struct TurboHandle {
+    explicit TurboHandle(tjhandle created) : handle(created) {}
+    ~TurboHandle() {
+        if (handle) tjDestroy(handle);
+    }
+    tjhandle handle;
+};
+
+// The cut-outs tjTransform allocates
+struct TransformOutputs {
+    explicit TransformOutputs(size_t count) : buffers(count, nullptr), sizes(count, 0) {}
+    ~TransformOutputs() {
+        for (unsigned char* buffer : buffers) tjFree(buffer);
+    }
+    std::vector<unsigned char*> buffers;
+    std::vector<unsigned long> sizes;
+};
+
+bool decodeTurbo(const std::vector<unsigned char>& jpeg, const std::vector<cv::Rect>& regions, int targetSide,
+                 std::vector<cv::Mat>& images) {
+    thread_local TurboHandle transformer(tjInitTransform());
+    thread_local TurboHandle decompressor(tjInitDecompress());
+    if (!transformer.handle || !decompressor.handle) {
+        LOG_ERROR("Could not create the TurboJPEG decoders");
+        return false;
+    }
+    int width = 0;
+    int height = 0;
+    int subsampling = 0;
+    int colorspace = 0;
+    if (tjDecompressHeader3(decompressor.handle, jpeg.data(), static_cast<unsigned long>(jpeg.size()), &width,
+                            &height, &subsampling, &colorspace) != 0 ||
+        subsampling < 0 || subsampling >= TJ_NUMSAMP) {
+        LOG_WARN("Cannot read JPEG header: {}", tjGetErrorStr2(decompressor.handle));
+        return false;
+    }
+
+    // Lossless crops must start on the MCU grid: round each region out to it
+    const cv::Rect bounds(0, 0, width, height);
+    std::vector<tjtransform> transforms;
+    std::vector<size_t> indices;
+    for (size_t i = 0; i < regions.size(); ++i) {
+        const cv::Rect region = regions[i] & bounds;
+        if (region.empty()) continue;
+        tjtransform transform{};
+        transform.r.x = region.x / tjMCUWidth[subsampling] * tjMCUWidth[subsampling];
+        transform.r.y = region.y / tjMCUHeight[subsampling] * tjMCUHeight[subsampling];
+        transform.r.w = region.x + region.width - transform.r.x;
+        transform.r.h = region.y + region.height - transform.r.y;
+        transform.op = TJXOP_NONE;
+        transform.options = TJXOPT_CROP;
+        transforms.push_back(transform);
+        indices.push_back(i);
+    }
+    if (transforms.empty()) return true;
+
+    // One pass over the entropy-coded data cuts out every region
+    TransformOutputs outputs(transforms.size());
+    if (tjTransform(transformer.handle, jpeg.data(), static_cast<unsigned long>(jpeg.size()),
+                    static_cast<int>(transforms.size()), outputs.buffers.data(), outputs.sizes.data(),
+                    transforms.data(), 0) != 0) {
+        LOG_WARN("Cannot crop JPEG regions: {}", tjGetErrorStr2(transformer.handle));
+        return false;
+    }
+    for (size_t t = 0; t < transforms.size(); ++t) {
+        const cv::Rect region = regions[indices[t]] & bounds;
+        const int denominator = JpegRegionDecoder::scaleDenominator(region.size(), targetSide);
+        const tjscalingfactor factor = {1, denominator};
+        cv::Mat decoded(TJSCALED(transforms[t].r.h, factor), TJSCALED(transforms[t].r.w, factor), CV_8UC3);
+        if (tjDecompress2(decompressor.handle, outputs.buffers[t], outputs.sizes[t], decoded.data, decoded.cols,
+                          static_cast<int>(decoded.step), decoded.rows, TJPF_BGR, TJFLAG_FASTDCT) != 0) {
+            LOG_WARN("Cannot decode JPEG region: {}", tjGetErrorStr2(decompressor.handle));
+            return false;
+        }
+        // The cut-out is at most one MCU larger than the region; keep a view of it
+        images[indices[t]] =
+            decoded(scaledRegion(region, cv::Point(transforms[t].r.x, transforms[t].r.y), denominator, decoded.size()));
+    }
+    return true;
+}
+#endif
+
+int reducedColorFlag(int denominator) {
+    switch (denominator) {
+        case 2:
+            return cv::IMREAD_REDUCED_COLOR_2;
+        case 4:
+            return cv::IMREAD_REDUCED_COLOR_4;
+        case 8:
+            return cv::IMREAD_REDUCED_COLOR_8;
+        default:
+            return cv::IMREAD_COLOR;
+    }
+}
+
+bool decodeOpenCv(const std::vector<unsigned char>& jpeg, const std::vector<cv::Rect>& regions, int targetSide,
+                  std::vector<cv::Mat>& images) {
+    // One decode at the finest scale any region needs
+    int finest = 8;
+    for (const cv::Rect& region : regions) {
+        finest = std::min(finest, JpegRegionDecoder::scaleDenominator(region.size(), targetSide));
+    }
+    const cv::Mat frame = cv::imdecode(jpeg, reducedColorFlag(finest));
+    if (frame.empty()) {
+        LOG_WARN("Cannot decode image of {} bytes", jpeg.size());
+        return false;
+    }
+    const cv::Rect bounds(0, 0, frame.cols * finest, frame.rows * finest);
+    for (size_t i = 0; i < regions.size(); ++i) {
+        const cv::Rect region = regions[i] & bounds;
+        const cv::Rect scaled = scaledRegion(region, cv::Point(), finest, frame.size());
+        if (scaled.empty()) continue;
+        const int denominator = JpegRegionDecoder::scaleDenominator(region.size(), targetSide);
+        if (denominator == finest) {
+            images[i] = frame(scaled).clone();
+        } else {
+            cv::resize(frame(scaled), images[i],
+                       cv::Size(scaledSize(region.width, denominator), scaledSize(region.height, denominator)), 0, 0,
+                       cv::INTER_AREA);
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+bool JpegRegionDecoder::decode(const std::vector<unsigned char>& jpeg, const std::vector<cv::Rect>& regions,
+                               int targetSide, std::vector<cv::Mat>& images) {
+    images.assign(regions.size(), cv::Mat());
+    if (jpeg.empty()) return false;
+#if BIRDS_HAVE_TURBOJPEG
+    return decodeTurbo(jpeg, regions, targetSide, images);
+#else
+    return decodeOpenCv(jpeg, regions, targetSide, images);
+#endif
+}
+
+int JpegRegionDecoder::scaleDenominator(cv::Size region, int targetSide) {
+    if (targetSide <= 0) return 1;
+    const int longer = std::max(region.width, region.height);
+    for (int denominator : {8, 4, 2}) {
+        if (longer / denominator >= targetSide) return denominator;
+    }
+    return 1;
+}
+
+const char* JpegRegionDecoder::backendName() { return BIRDS_HAVE_TURBOJPEG ? "turbojpeg" : "opencv"; }
@@ -0,0 +1,181 @@
+#include "load_shedder.hpp"
+
+#include <algorithm>
+
+#include "logger.hpp"
+
+LoadShedder::LoadShedder(const LoadSheddingConfig& config, size_t workers)
+    : config_(config),
+      workers_(std::max<size_t>(1, workers)),
+      maxLevel_(std::max(1, config.maxStride) - 1 + (config.minScaleFactor < 1.0 ? 1 : 0)) {
+    config_.maxStride = std::max(1, config_.maxStride);
+    config_.minScaleFactor = std::clamp(config_.minScaleFactor, 0.05, 1.0);
+    config_.frameIntervalMs = std::max(1.0, config_.frameIntervalMs);
+    config_.adjustIntervalFrames = std::max(1, config_.adjustIntervalFrames);
+    config_.smoothing = std::clamp(config_.smoothing, 0.01, 1.0);
+}
+
+size_t LoadShedder::addStream() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    streams_.emplace_back();
+    return streams_.size() - 1;
+}
+
+void LoadShedder::resetStream(size_t stream) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    streams_.at(stream) = Stream();
+}
+
+int LoadShedder::stride(const Stream& stream) const {
+    return std::min(config_.maxStride, 1 + stream.level);
+}
+
+double LoadShedder::scaleFactor(const Stream& stream) const {
+    return stream.level >= config_.maxStride ? config_.minScaleFactor : 1.0;
+}
+
+bool LoadShedder::isActive(const Stream& stream) const {
+    return stream.everActive &&
+           stream.processed - stream.lastActive < static_cast<uint64_t>(config_.activeHoldFrames);
+}
+
+bool LoadShedder::shouldProcess(size_t index, uint64_t frames) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stream& stream = streams_.at(index);
+    frames = std::max<uint64_t>(1, frames);
+    stream.sinceProcessed += frames;
+    if (stream.sinceProcessed < static_cast<uint64_t>(stride(stream))) {
+        stream.skipped += frames;
+        return false;
+    }
+    stream.skipped += frames - 1;  // Left out upstream; this one is processed
+    stream.sinceProcessed = 0;
+    return true;
+}
+
+void LoadShedder::recordProcessed(size_t index, double processingMs, bool active,
+                                  std::chrono::steady_clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stream& stream = streams_.at(index);
+    const double delta = processingMs - stream.processingMs;
+    stream.processingMs =
+        stream.sampled ? stream.processingMs + config_.smoothing * delta : processingMs;
+    stream.sampled = true;
+    stream.processed++;
+
+    // The first frame starts the window; the frames after it are counted against its length
+    if (stream.processed == 1) {
+        stream.windowStart = now;
+    } else {
+        stream.windowProcessed++;
+        const double windowSeconds =
+            std::chrono::duration<double>(now - stream.windowStart).count();
+        if (windowSeconds >= 1.0) {
+            stream.processingFps = static_cast<double>(stream.windowProcessed) / windowSeconds;
+            stream.windowStart = now;
+            stream.windowProcessed = 0;
+        }
+    }
+
+    if (active) {
+        stream.lastActive = stream.processed;
+        stream.everActive = true;
+        if (stream.level > 0) {
+            LOG_INFO("Load shedding: stream {} has regions, back to full rate", index);
+            stream.level = 0;
+        }
+    }
+    if (config_.enabled) adjustLocked();
+}
+
+double LoadShedder::utilizationLocked() const {
+    double demandMs = 0.0;
+    for (const Stream& stream : streams_) demandMs += stream.processingMs / stride(stream);
+    return demandMs / (config_.frameIntervalMs * static_cast<double>(workers_));
+}
+
+/**
+ * One step per adjustIntervalFrames: shed the least reduced quiet stream (the most expensive
+ * of equals) when overloaded, or restore the most reduced one (the cheapest of equals) when
+ * the estimate with that step undone still stays below overloadRatio.
+ */
+void LoadShedder::adjustLocked() {
+    if (++sinceAdjust_ < static_cast<uint64_t>(config_.adjustIntervalFrames)) return;
+    sinceAdjust_ = 0;
+
+    const double utilization = utilizationLocked();
+    if (utilization > config_.overloadRatio) {
+        Stream* target = nullptr;
+        size_t targetIndex = 0;
+        for (size_t i = 0; i < streams_.size(); ++i) {
+            Stream& stream = streams_[i];
+            if (stream.level >= maxLevel_ || isActive(stream) || !stream.sampled) continue;
+            if (!target || stream.level < target->level ||
+                (stream.level == target->level && stream.processingMs > target->processingMs)) {
+                target = &stream;
+                targetIndex = i;
+            }
+        }
+        if (!target) return;  // Only active or fully reduced streams left
+        target->level++;
+        LOG_INFO("Load shedding: {:.0f}% of the frame budget in use; stream {} now processes every "
+                 "{} frame(s) at {:.2f}x detection scale",
+                 utilization * 100.0, targetIndex, stride(*target), scaleFactor(*target));
+    } else if (utilization < config_.recoverRatio) {
+        Stream* target = nullptr;
+        size_t targetIndex = 0;
+        for (size_t i = 0; i < streams_.size(); ++i) {
+            Stream& stream = streams_[i];
+            if (stream.level == 0) continue;
+            if (!target || stream.level > target->level ||
+                (stream.level == target->level && stream.processingMs < target->processingMs)) {
+                target = &stream;
+                targetIndex = i;
+            }
+        }
+        if (!target) return;
+        target->level--;
+        if (utilizationLocked() > config_.overloadRatio) {
+            target->level++;  // Would overload again straight away
+            return;
+        }
+        LOG_INFO("Load shedding: {:.0f}% of the frame budget in use; stream {} back to every {} "
+                 "frame(s) at {:.2f}x detection scale",
+                 utilization * 100.0, targetIndex, stride(*target), scaleFactor(*target));
+    }
+}
+
+double LoadShedder::scaleFactor(size_t index) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return scaleFactor(streams_.at(index));
+}
+
+LoadShedder::StreamRate LoadShedder::rate(size_t index) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Stream& stream = streams_.at(index);
+    StreamRate rate;
+    rate.processingFps = stream.processingFps;
+    // A stream that stopped processing keeps no stale rate
+    const auto age = std::chrono::steady_clock::now() - stream.windowStart;
+    const double windowSeconds = std::chrono::duration<double>(age).count();
+    if (stream.processed > 0 && windowSeconds >= 2.0) {
+        rate.processingFps = static_cast<double>(stream.windowProcessed) / windowSeconds;
+    }
+    rate.processingMs = stream.processingMs;
+    rate.stride = stride(stream);
+    rate.scaleFactor = scaleFactor(stream);
+    rate.active = isActive(stream);
+    rate.processed = stream.processed;
+    rate.skipped = stream.skipped;
+    return rate;
+}
+
+size_t LoadShedder::streamCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return streams_.size();
+}
+
+double LoadShedder::utilization() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return utilizationLocked();
+}
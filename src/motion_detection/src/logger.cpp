@@ -1,9 +1,13 @@
 #include "logger.hpp"
+#include <spdlog/async.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/sinks/basic_file_sink.h>
 #include <spdlog/pattern_formatter.h>
+#include <chrono>
 #include <memory>
 
+#include "thread_placement.hpp"
+
 std::shared_ptr<spdlog::logger> Logger::loggerInstance = nullptr;
 
 std::shared_ptr<spdlog::logger>& Logger::getInstance() {
@@ -14,6 +18,11 @@ std::shared_ptr<spdlog::logger>& Logger::getInstance() {
 }
 
 void Logger::init(const std::string& logLevel, const std::string& logFile, bool logToFile) {
+    init(logLevel, logFile, logToFile, AsyncOptions());
+}
+
+void Logger::init(const std::string& logLevel, const std::string& logFile, bool logToFile,
+                  const AsyncOptions& async) {
     std::vector<spdlog::sink_ptr> sinks;
 
     // Always include colored console output
@@ -26,7 +35,19 @@ void Logger::init(const std::string& logLevel, const std::string& logFile, bool
         sinks.push_back(fileSink);
     }
 
-    loggerInstance = std::make_shared<spdlog::logger>("BirdsOfPlayLogger", begin(sinks), end(sinks));
+    if (async.enabled) {
+        // One writer thread keeps records in order; the frame loop only enqueues
+        spdlog::init_thread_pool(async.queueSize, 1, [onThreadStart = async.onThreadStart] {
+            nameCurrentThread("log");
+            if (onThreadStart) onThreadStart();
+        });
+        loggerInstance = std::make_shared<spdlog::async_logger>(
+            "BirdsOfPlayLogger", begin(sinks), end(sinks), spdlog::thread_pool(),
+            async.blockOnOverflow ? spdlog::async_overflow_policy::block
+                                  : spdlog::async_overflow_policy::overrun_oldest);
+    } else {
+        loggerInstance = std::make_shared<spdlog::logger>("BirdsOfPlayLogger", begin(sinks), end(sinks));
+    }
     spdlog::register_logger(loggerInstance);
 
     // Set logging pattern: [timestamp] [level] [source:line function] message
@@ -46,5 +67,12 @@ void Logger::init(const std::string& logLevel, const std::string& logFile, bool
     else
         loggerInstance->set_level(spdlog::level::info);  // default
 
-    loggerInstance->flush_on(spdlog::level::info);
+    if (async.enabled) {
+        // Flushing every info record would serialize the writer on file I/O; flush warnings
+        // at once and everything else periodically
+        loggerInstance->flush_on(spdlog::level::warn);
+        spdlog::flush_every(std::chrono::seconds(1));
+    } else {
+        loggerInstance->flush_on(spdlog::level::info);
+    }
 }
@@ -0,0 +1,193 @@
+#include "memory_placement.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "logger.hpp"
+#include "profiler_zones.hpp"
+
+namespace {
+
+#ifdef __linux__
+
+constexpr size_t kHugePageSize = size_t(2) << 20;
+
+size_t roundUp(size_t value, size_t multiple) { return (value + multiple - 1) / multiple * multiple; }
+
+// "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11}
+std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        if (range.empty()) continue;
+        const size_t dash = range.find('-');
+        try {
+            const int first = std::stoi(range.substr(0, dash));
+            const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+        } catch (const std::exception&) {
+            return {};
+        }
+    }
+    return cpus;
+}
+
+// Anonymous mapping of @p length bytes starting on an @p alignment boundary
+void* alignedMap(size_t length, size_t alignment) {
+    const size_t padded = length + alignment;
+    void* raw = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return nullptr;
+    const uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+    const uintptr_t aligned = roundUp(start, alignment);
+    if (aligned > start) munmap(raw, aligned - start);
+    const size_t tail = start + padded - (aligned + length);
+    if (tail > 0) munmap(reinterpret_cast<void*>(aligned + length), tail);
+    return reinterpret_cast<void*>(aligned);
+}
+#endif
+
+}  // namespace
+
+cv::MatAllocator* PlacedMatAllocator::forPlacement(const MemoryPlacement& placement) {
+    if (placement.isDefault()) return nullptr;
+    static std::mutex mutex;
+    static std::map<std::pair<bool, int>, PlacedMatAllocator*> allocators;  // Never freed
+    std::lock_guard<std::mutex> lock(mutex);
+    PlacedMatAllocator*& allocator = allocators[{placement.hugePages, placement.numaNode}];
+    if (!allocator) allocator = new PlacedMatAllocator(placement);
+    return allocator;
+}
+
+cv::UMatData* PlacedMatAllocator::allocate(int dims, const int* sizes, int type, void* data0,
+                                           size_t* step, cv::AccessFlag, cv::UMatUsageFlags) const {
+    // Same layout as OpenCV's StdMatAllocator: dense rows unless the caller gave steps
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; --i) {
+        if (step) {
+            if (data0 && step[i] != CV_AUTOSTEP) {
+                total = step[i];
+            } else {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+    cv::UMatData* u = new cv::UMatData(this);
+    u->data = u->origdata = static_cast<uchar*>(data0 ? data0 : map(total));
+    u->size = total;
+    if (data0) {
+        u->flags |= cv::UMatData::USER_ALLOCATED;
+    } else {
+        PROFILE_ALLOC(u->origdata, total, "placed_frames");
+    }
+    return u;
+}
+
+bool PlacedMatAllocator::allocate(cv::UMatData* data, cv::AccessFlag, cv::UMatUsageFlags) const {
+    return data != nullptr;
+}
+
+void PlacedMatAllocator::deallocate(cv::UMatData* u) const {
+    if (!u) return;
+    CV_Assert(u->urefcount == 0);
+    CV_Assert(u->refcount == 0);
+    if (!(u->flags & cv::UMatData::USER_ALLOCATED)) {
+        PROFILE_FREE(u->origdata, "placed_frames");
+        unmap(u->origdata, u->size);
+        u->origdata = nullptr;
+    }
+    delete u;
+}
+
+#ifdef __linux__
+
+void* PlacedMatAllocator::map(size_t bytes) const {
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t length = roundUp(std::max<size_t>(bytes, 1), placement_.hugePages ? kHugePageSize : pageSize);
+    void* data = nullptr;
+    if (placement_.hugePages) {
+        data = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data == MAP_FAILED) {
+            // No reserved huge pages: 2 MB aligned, so transparent huge pages can back all of it
+            data = alignedMap(length, kHugePageSize);
+            if (data) madvise(data, length, MADV_HUGEPAGE);
+        }
+    } else {
+        data = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (data == MAP_FAILED) data = nullptr;
+    }
+    if (!data) throw std::bad_alloc();
+
+    if (placement_.numaNode >= 0) {
+        // Bind before the first touch, so every page is faulted in on the node
+        constexpr int kBitsPerWord = static_cast<int>(sizeof(unsigned long) * CHAR_BIT);
+        std::vector<unsigned long> nodeMask(placement_.numaNode / kBitsPerWord + 1, 0);
+        nodeMask[placement_.numaNode / kBitsPerWord] |= 1UL << (placement_.numaNode % kBitsPerWord);
+        constexpr int kMpolPreferred = 1;
+        if (syscall(SYS_mbind, data, length, kMpolPreferred, nodeMask.data(),
+                    nodeMask.size() * kBitsPerWord + 1, 0) != 0) {
+            LOG_DEBUG_LIMITED("mbind to NUMA node {} failed; buffer stays unbound", placement_.numaNode);
+        }
+    }
+    return data;
+}
+
+void PlacedMatAllocator::unmap(void* data, size_t bytes) const {
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    munmap(data, roundUp(std::max<size_t>(bytes, 1), placement_.hugePages ? kHugePageSize : pageSize));
+}
+
+std::vector<std::vector<int>> numaNodeCpus() {
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string nodeList;
+    if (!online || !std::getline(online, nodeList)) return {};
+    std::vector<std::vector<int>> nodes;
+    for (int node : parseCpuList(nodeList)) {
+        std::ifstream cpuList("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        std::string cpus;
+        if (!cpuList || !std::getline(cpuList, cpus)) return {};
+        if (node >= static_cast<int>(nodes.size())) nodes.resize(node + 1);
+        nodes[node] = parseCpuList(cpus);
+    }
+    return nodes;
+}
+
+bool pinCurrentThread(const std::vector<int>& cpus) {
+    if (cpus.empty()) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+#else  // No mmap/mbind: plain aligned heap buffers, no topology
+
+void* PlacedMatAllocator::map(size_t bytes) const { return cv::fastMalloc(bytes); }
+
+void PlacedMatAllocator::unmap(void* data, size_t) const { cv::fastFree(data); }
+
+std::vector<std::vector<int>> numaNodeCpus() { return {}; }
+
+bool pinCurrentThread(const std::vector<int>&) { return false; }
+
+#endif
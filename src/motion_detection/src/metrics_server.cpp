@@ -0,0 +1,265 @@
+#include "metrics_server.hpp"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <utility>
+
+#include "logger.hpp"
+#include "prometheus_text_writer.hpp"
+#include "thread_placement.hpp"
+
+namespace {
+
+constexpr int kPollIntervalMs = 200;     // Upper bound on how long stop() waits
+constexpr int kSocketTimeoutSec = 2;     // Per-client read/write timeout (per request on the reactor)
+constexpr size_t kMaxRequestBytes = 8192;
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;  // A client hanging up must not SIGPIPE the process
+#else
+constexpr int kSendFlags = 0;  // macOS: SO_NOSIGPIPE is set per socket instead
+#endif
+
+void sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        const ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, kSendFlags);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            return;  // Timed out or closed by the client
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
+
+std::string httpResponse(const char* status, const char* contentType, const std::string& body) {
+    return std::string("HTTP/1.1 ") + status + "\r\nContent-Type: " + contentType +
+           "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" +
+           body;
+}
+
+bool setNonBlocking(int fd) {
+    const int flags = ::fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+}  // namespace
+
+MetricsServer::MetricsServer(RenderFunction render, int port, std::string bindAddress, IoReactor* reactor)
+    : render_(std::move(render)), requestedPort_(port), bindAddress_(std::move(bindAddress)), reactor_(reactor) {}
+
+MetricsServer::~MetricsServer() { stop(); }
+
+bool MetricsServer::start() {
+    if (running_) return true;
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(requestedPort_));
+    if (::inet_pton(AF_INET, bindAddress_.c_str(), &address.sin_addr) != 1) {
+        LOG_ERROR("Metrics server: invalid bind address '{}'", bindAddress_);
+        return false;
+    }
+
+    listenFd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd_ < 0) {
+        LOG_ERROR("Metrics server: socket() failed: {}", std::strerror(errno));
+        return false;
+    }
+    const int reuse = 1;
+    ::setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (::bind(listenFd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(listenFd_, 8) < 0) {
+        LOG_ERROR("Metrics server: cannot listen on {}:{}: {}", bindAddress_, requestedPort_,
+                  std::strerror(errno));
+        ::close(listenFd_);
+        listenFd_ = -1;
+        return false;
+    }
+
+    socklen_t length = sizeof(address);
+    ::getsockname(listenFd_, reinterpret_cast<sockaddr*>(&address), &length);
+    boundPort_ = ntohs(address.sin_port);
+
+    running_ = true;
+    onReactor_ = reactor_ && reactor_->isRunning() && setNonBlocking(listenFd_) && spawnTask(acceptLoop());
+    if (!onReactor_) thread_ = std::thread(&MetricsServer::run, this);
+    LOG_INFO("Metrics server listening on http://{}:{}/metrics{}", bindAddress_, boundPort_,
+             onReactor_ ? " (I/O reactor)" : "");
+    return true;
+}
+
+void MetricsServer::stop() {
+    running_ = false;
+    if (thread_.joinable()) thread_.join();
+    if (onReactor_) {
+        reactor_->cancel(listenFd_);
+        std::unique_lock<std::mutex> lock(tasksMutex_);
+        tasksDone_.wait(lock, [this] { return tasks_ == 0; });
+        onReactor_ = false;
+    }
+    if (listenFd_ >= 0) {
+        ::close(listenFd_);
+        listenFd_ = -1;
+    }
+}
+
+void MetricsServer::run() {
+    nameCurrentThread("metrics");
+    pollfd listener{};
+    listener.fd = listenFd_;
+    listener.events = POLLIN;
+    while (running_) {
+        // Poll with a timeout instead of blocking in accept() so stop() is prompt
+        const int ready = ::poll(&listener, 1, kPollIntervalMs);
+        if (ready <= 0 || !(listener.revents & POLLIN)) continue;
+
+        const int clientFd = ::accept(listenFd_, nullptr, nullptr);
+        if (clientFd < 0) continue;
+        handleConnection(clientFd);
+        ::close(clientFd);
+    }
+}
+
+void MetricsServer::handleConnection(int clientFd) {
+    timeval timeout{};
+    timeout.tv_sec = kSocketTimeoutSec;
+    ::setsockopt(clientFd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ::setsockopt(clientFd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#ifdef SO_NOSIGPIPE
+    const int noSigpipe = 1;
+    ::setsockopt(clientFd, SOL_SOCKET, SO_NOSIGPIPE, &noSigpipe, sizeof(noSigpipe));
+#endif
+
+    // Only the request line matters; read until the end of the headers
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < kMaxRequestBytes) {
+        const ssize_t n = ::recv(clientFd, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            break;
+        }
+        request.append(buffer, static_cast<size_t>(n));
+    }
+    sendAll(clientFd, respond(request));
+}
+
+std::string MetricsServer::respond(const std::string& request) {
+    const std::string requestLine = request.substr(0, request.find("\r\n"));
+    const size_t methodEnd = requestLine.find(' ');
+    const size_t pathEnd = requestLine.find(' ', methodEnd + 1);
+    if (methodEnd == std::string::npos || pathEnd == std::string::npos) {
+        return httpResponse("400 Bad Request", "text/plain", "Bad request\n");
+    }
+    const std::string method = requestLine.substr(0, methodEnd);
+    std::string path = requestLine.substr(methodEnd + 1, pathEnd - methodEnd - 1);
+    path = path.substr(0, path.find('?'));
+
+    if (method != "GET") {
+        return httpResponse("405 Method Not Allowed", "text/plain", "Only GET is supported\n");
+    }
+    if (path != "/metrics") {
+        return httpResponse("404 Not Found", "text/plain", "Metrics are served at /metrics\n");
+    }
+
+    std::string body;
+    try {
+        body = render_();
+    } catch (const std::exception& e) {
+        LOG_ERROR("Metrics server: rendering failed: {}", e.what());
+        return httpResponse("500 Internal Server Error", "text/plain", "Rendering failed\n");
+    }
+    requestsServed_++;
+    return httpResponse("200 OK", PrometheusTextWriter::kContentType, body);
+}
+
+bool MetricsServer::spawnTask(IoTask task) {
+    {
+        std::lock_guard<std::mutex> lock(tasksMutex_);
+        ++tasks_;
+    }
+    if (reactor_->spawn(std::move(task))) return true;
+    taskFinished();
+    return false;
+}
+
+void MetricsServer::taskFinished() {
+    // Notified under the lock: stop() cannot return, and the server go away, before this is done
+    std::lock_guard<std::mutex> lock(tasksMutex_);
+    --tasks_;
+    tasksDone_.notify_all();
+}
+
+IoTask MetricsServer::acceptLoop() {
+    struct Finish {
+        MetricsServer& server;
+        ~Finish() { server.taskFinished(); }
+    } finish{*this};
+
+    // The poll interval bounds how long a stop() between two waits goes unnoticed
+    while (running_ && !reactor_->stopping()) {
+        if (!co_await reactor_->readable(listenFd_, std::chrono::milliseconds(kPollIntervalMs))) continue;
+        for (;;) {
+            const int clientFd = ::accept(listenFd_, nullptr, nullptr);
+            if (clientFd < 0) break;
+            if (!setNonBlocking(clientFd) || !spawnTask(serveConnection(clientFd))) ::close(clientFd);
+        }
+    }
+}
+
+IoTask MetricsServer::serveConnection(int clientFd) {
+    struct Finish {
+        MetricsServer& server;
+        int fd;
+        ~Finish() {
+            ::close(fd);
+            server.taskFinished();
+        }
+    } finish{*this, clientFd};
+#ifdef SO_NOSIGPIPE
+    const int noSigpipe = 1;
+    ::setsockopt(clientFd, SOL_SOCKET, SO_NOSIGPIPE, &noSigpipe, sizeof(noSigpipe));
+#endif
+    const auto deadline = IoReactor::Clock::now() + std::chrono::seconds(kSocketTimeoutSec);
+    const auto remaining = [&deadline] { return deadline - IoReactor::Clock::now(); };
+
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < kMaxRequestBytes) {
+        const ssize_t n = ::recv(clientFd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            request.append(buffer, static_cast<size_t>(n));
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!co_await reactor_->readable(clientFd, remaining())) break;  // Timed out or stopping
+        } else {
+            break;
+        }
+    }
+
+    const std::string response = respond(request);
+    size_t sent = 0;
+    while (sent < response.size()) {
+        const ssize_t n = ::send(clientFd, response.data() + sent, response.size() - sent, kSendFlags);
+        if (n > 0) {
+            sent += static_cast<size_t>(n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!co_await reactor_->writable(clientFd, remaining())) break;
+        } else {
+            break;
+        }
+    }
+}
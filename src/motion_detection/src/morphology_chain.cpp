@@ -0,0 +1,179 @@
+#include "morphology_chain.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <opencv2/imgproc.hpp>
+
+namespace {
+
+template <bool IsMax>
+inline uchar pick(uchar a, uchar b) {
+    return IsMax ? std::max(a, b) : std::min(a, b);
+}
+
+// Element-wise pick of two rows into a third (cv::min / cv::max vectorize this)
+template <bool IsMax>
+void pickRows(const uchar* a, const uchar* b, uchar* out, int cols) {
+    const cv::Mat rowA(1, cols, CV_8UC1, const_cast<uchar*>(a));
+    const cv::Mat rowB(1, cols, CV_8UC1, const_cast<uchar*>(b));
+    cv::Mat rowOut(1, cols, CV_8UC1, out);
+    if (IsMax) {
+        cv::max(rowA, rowB, rowOut);
+    } else {
+        cv::min(rowA, rowB, rowOut);
+    }
+}
+
+/**
+ * van Herk/Gil-Werman min (erode) or max (dilate) over a centred horizontal window of
+ * odd @p length. The padded row is split into blocks of @p length; a window then covers
+ * the tail of one block and the head of the next, so
+ *   out[x] = pick(suffix[x], prefix[x + length - 1])
+ * with per-block prefix and suffix running values. In place is allowed.
+ */
+template <bool IsMax>
+void lineFilterRows(const cv::Mat& src, cv::Mat& dst, int length, MorphologyChain::Workspace& ws) {
+    const uchar neutral = IsMax ? 0 : 255;
+    const int radius = length / 2;
+    const int cols = src.cols;
+    const int padded = cols + 2 * radius;
+    ws.rowPadded.assign(padded, neutral);
+    ws.rowForward.resize(padded);
+    ws.rowBackward.resize(padded);
+    uchar* g = ws.rowPadded.data();
+    uchar* prefix = ws.rowForward.data();
+    uchar* suffix = ws.rowBackward.data();
+
+    dst.create(src.size(), CV_8UC1);
+    for (int y = 0; y < src.rows; ++y) {
+        std::memcpy(g + radius, src.ptr<uchar>(y), cols);
+        for (int start = 0; start < padded; start += length) {
+            const int end = std::min(padded, start + length);
+            prefix[start] = g[start];
+            for (int i = start + 1; i < end; ++i) prefix[i] = pick<IsMax>(prefix[i - 1], g[i]);
+            suffix[end - 1] = g[end - 1];
+            for (int i = end - 2; i >= start; --i) suffix[i] = pick<IsMax>(suffix[i + 1], g[i]);
+        }
+        uchar* out = dst.ptr<uchar>(y);
+        for (int x = 0; x < cols; ++x) out[x] = pick<IsMax>(suffix[x], prefix[x + length - 1]);
+    }
+}
+
+// Same recurrence down the columns, one row at a time so every step is a row operation
+template <bool IsMax>
+void lineFilterCols(const cv::Mat& src, cv::Mat& dst, int length, MorphologyChain::Workspace& ws) {
+    const uchar neutral = IsMax ? 0 : 255;
+    const int radius = length / 2;
+    const int rows = src.rows;
+    const int cols = src.cols;
+    const int padded = rows + 2 * radius;
+    ws.neutralRow.assign(cols, neutral);
+    ws.lineForward.create(padded, cols, CV_8UC1);
+    ws.lineBackward.create(padded, cols, CV_8UC1);
+    auto input = [&](int i) -> const uchar* {
+        i -= radius;
+        return (i >= 0 && i < rows) ? src.ptr<uchar>(i) : ws.neutralRow.data();
+    };
+
+    for (int start = 0; start < padded; start += length) {
+        const int end = std::min(padded, start + length);
+        std::memcpy(ws.lineForward.ptr<uchar>(start), input(start), cols);
+        for (int i = start + 1; i < end; ++i) {
+            pickRows<IsMax>(ws.lineForward.ptr<uchar>(i - 1), input(i), ws.lineForward.ptr<uchar>(i), cols);
+        }
+        std::memcpy(ws.lineBackward.ptr<uchar>(end - 1), input(end - 1), cols);
+        for (int i = end - 2; i >= start; --i) {
+            pickRows<IsMax>(ws.lineBackward.ptr<uchar>(i + 1), input(i), ws.lineBackward.ptr<uchar>(i), cols);
+        }
+    }
+
+    // src is no longer read, so dst may alias it
+    dst.create(src.size(), CV_8UC1);
+    for (int y = 0; y < rows; ++y) {
+        pickRows<IsMax>(ws.lineBackward.ptr<uchar>(y), ws.lineForward.ptr<uchar>(y + length - 1),
+                        dst.ptr<uchar>(y), cols);
+    }
+}
+
+}  // namespace
+
+void MorphologyChain::plan(const std::vector<Operation>& steps, const cv::Mat& kernel, bool approximate) {
+    passes_.clear();
+    kernel_ = kernel;
+    approximate_ = approximate;
+    if (approximate) {
+        fixed_ = FixedMorphology();
+    } else {
+        fixed_.plan(kernel);  // Other kernels stay on cv::erode / cv::dilate
+    }
+    const int size = std::max(kernel.rows, kernel.cols);
+    for (Operation operation : steps) {
+        if (!passes_.empty() && passes_.back().operation == operation) {
+            passes_.back().iterations++;
+            passes_.back().length += size - 1;
+        } else {
+            passes_.push_back({operation, 1, size});
+        }
+    }
+}
+
+void MorphologyChain::apply(const cv::Mat& input, cv::Mat& output, Workspace& workspace) const {
+    CV_Assert(input.type() == CV_8UC1);
+    if (passes_.empty()) {
+        input.copyTo(output);
+        return;
+    }
+
+    // Ping-pong through the workspace; the last pass writes the output
+    const cv::Mat* current = &input;
+    for (size_t i = 0; i < passes_.size(); ++i) {
+        cv::Mat& target = (i + 1 == passes_.size()) ? output : (i % 2 == 0 ? workspace.ping : workspace.pong);
+        runPass(passes_[i], *current, target, workspace);
+        current = &target;
+    }
+}
+
+void MorphologyChain::applyPacked(const PackedMask& input, PackedMask& output, PackedMask::Scratch& scratch) const {
+    if (&output != &input) output = input;
+    for (const Pass& pass : passes_) {
+        if (pass.operation == Operation::DILATE) {
+            dilatePacked(output, pass.length / 2, scratch);
+        } else {
+            erodePacked(output, pass.length / 2, scratch);
+        }
+    }
+}
+
+int MorphologyChain::radius() const {
+    int total = 0;
+    for (const Pass& pass : passes_) {
+        total += approximate_ ? pass.length / 2 : pass.iterations * (kernel_.rows / 2);
+    }
+    return total;
+}
+
+void MorphologyChain::runPass(const Pass& pass, const cv::Mat& input, cv::Mat& output,
+                              Workspace& workspace) const {
+    const bool dilate = pass.operation == Operation::DILATE;
+    if (!approximate_) {
+        if (fixed_.planned()) {
+            fixed_.apply(dilate, input, output, pass.iterations, workspace.fixed);
+            return;
+        }
+        if (dilate) {
+            cv::dilate(input, output, kernel_, cv::Point(-1, -1), pass.iterations);
+        } else {
+            cv::erode(input, output, kernel_, cv::Point(-1, -1), pass.iterations);
+        }
+        return;
+    }
+
+    // Square kernel = horizontal line, then vertical line (in place on the output)
+    if (dilate) {
+        lineFilterRows<true>(input, output, pass.length, workspace);
+        lineFilterCols<true>(output, output, pass.length, workspace);
+    } else {
+        lineFilterRows<false>(input, output, pass.length, workspace);
+        lineFilterCols<false>(output, output, pass.length, workspace);
+    }
+}
@@ -0,0 +1,112 @@
+#include "motion_history.hpp"
+
+#include <algorithm>
+#include <climits>
+
+#include "motion_region_consolidator.hpp"
+#include "tracked_object_store.hpp"
+
+MotionHistory::MotionHistory(const MotionHistoryConfig& config) { updateConfig(config); }
+
+void MotionHistory::updateConfig(const MotionHistoryConfig& config) {
+    config_ = config;
+    config_.durationFrames = std::max(2, config_.durationFrames);
+}
+
+void MotionHistory::reset() {
+    stamps_.release();
+    frame_ = 0;
+}
+
+void MotionHistory::update(const cv::Mat& mask) {
+    CV_Assert(mask.empty() || mask.type() == CV_8UC1);
+    // A new size, or a frame counter about to wrap, starts over
+    if (stamps_.size() != mask.size() || frame_ == INT_MAX) {
+        stamps_.create(mask.size(), CV_32S);
+        stamps_.setTo(cv::Scalar::all(0));
+        frame_ = 0;
+    }
+    ++frame_;
+    stamps_.setTo(cv::Scalar::all(frame_), mask);
+}
+
+RegionMotion MotionHistory::measure(const cv::Rect& box) const {
+    RegionMotion motion;
+    const cv::Rect area = box & cv::Rect(cv::Point(), stamps_.size());
+    if (area.empty()) return motion;
+
+    // Least squares of x and y against the stamp, over the trail pixels (stamp < frame)
+    const int oldest = frame_ - config_.durationFrames + 1;
+    int moving = 0;
+    int oldestSeen = frame_;
+    double n = 0.0, sumT = 0.0, sumTT = 0.0, sumX = 0.0, sumY = 0.0, sumXT = 0.0, sumYT = 0.0;
+    for (int y = area.y; y < area.br().y; ++y) {
+        const int* stamps = stamps_.ptr<int>(y);
+        for (int x = area.x; x < area.br().x; ++x) {
+            const int stamp = stamps[x];
+            if (stamp < oldest || stamp <= 0) continue;
+            ++moving;
+            oldestSeen = std::min(oldestSeen, stamp);
+            if (stamp == frame_) continue;
+            const double t = stamp - frame_;
+            n += 1.0;
+            sumT += t;
+            sumTT += t * t;
+            sumX += x;
+            sumY += y;
+            sumXT += x * t;
+            sumYT += y * t;
+        }
+    }
+    if (moving == 0) return motion;
+    motion.coverage = static_cast<float>(moving) / static_cast<float>(area.area());
+    motion.ageFrames = frame_ - oldestSeen;
+    const double varianceT = n > 0.0 ? sumTT / n - (sumT / n) * (sumT / n) : 0.0;
+    if (varianceT > 1e-6) {
+        motion.vx = static_cast<float>((sumXT / n - sumX / n * (sumT / n)) / varianceT);
+        motion.vy = static_cast<float>((sumYT / n - sumY / n * (sumT / n)) / varianceT);
+    }
+    motion.jitter = isJitter(motion);
+    return motion;
+}
+
+bool MotionHistory::isJitter(const RegionMotion& motion) const {
+    return motion.measured() && motion.ageFrames >= config_.jitterMinAgeFrames &&
+           motion.speed() < config_.jitterMaxSpeed;
+}
+
+void MotionHistory::summarizeRegions(const TrackedObjectStore& objects, const std::vector<RegionMotion>& boxMotion,
+                                     std::vector<ConsolidatedRegion>& regions) {
+    if (boxMotion.empty()) return;
+    const std::vector<int>& ids = objects.ids();
+    const auto rowsEnd = ids.begin() + static_cast<std::ptrdiff_t>(std::min(ids.size(), boxMotion.size()));
+    for (ConsolidatedRegion& region : regions) {
+        RegionMotion combined;
+        double weight = 0.0, area = 0.0, vx = 0.0, vy = 0.0;
+        bool jitter = true;
+        for (int id : region.trackedObjectIds) {
+            const auto it = std::find(ids.begin(), rowsEnd, id);
+            if (it == rowsEnd) continue;
+            const size_t row = static_cast<size_t>(it - ids.begin());
+            const RegionMotion& motion = boxMotion[row];
+            if (!motion.measured()) continue;
+            const double boxArea = objects.bounds(row).area();
+            const double movingArea = boxArea * motion.coverage;
+            weight += movingArea;
+            area += boxArea;
+            vx += motion.vx * movingArea;
+            vy += motion.vy * movingArea;
+            combined.ageFrames = std::max(combined.ageFrames, motion.ageFrames);
+            jitter = jitter && motion.jitter;
+        }
+        if (weight <= 0.0) {
+            region.motion = RegionMotion();
+            continue;
+        }
+        combined.vx = static_cast<float>(vx / weight);
+        combined.vy = static_cast<float>(vy / weight);
+        combined.coverage = static_cast<float>(weight / area);
+        combined.jitter = jitter;
+        region.motion = combined;
+    }
+}
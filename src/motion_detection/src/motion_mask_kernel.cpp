@@ -0,0 +1,307 @@
+#include "motion_mask_kernel.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <opencv2/core/hal/intrin.hpp>
+
+#include "motion_mask_kernel_simd.hpp"
+#include "simd_dispatch.hpp"
+
+namespace {
+
+// Columns per chunk of the combined row the histogram is counted from (stack scratch)
+constexpr int kChunkCols = 1024;
+
+using AbsDiffRow = int (*)(const uchar*, const uchar*, const uchar*, const uchar*, const uchar*, uchar*, uchar*, int);
+using ThresholdRow = int (*)(const uchar*, const uchar*, const uchar*, uchar, uchar, uchar*, int);
+
+void checkMask(const cv::Mat& mask, const cv::Size& size) {
+    CV_Assert(mask.empty() || (mask.type() == CV_8UC1 && mask.size() == size));
+}
+
+int absDiffRowScalar(const uchar*, const uchar*, const uchar*, const uchar*, const uchar*, uchar*, uchar*, int) {
+    return 0;  // The caller's tail loop does the whole row
+}
+
+int thresholdRowScalar(const uchar*, const uchar*, const uchar*, uchar, uchar, uchar*, int) { return 0; }
+
+int absDiffRowUniversal(const uchar* a, const uchar* b, const uchar* o, const uchar* bg, const uchar* ex, uchar* d,
+                        uchar* combined, int cols) {
+    int x = 0;
+#if CV_SIMD128
+    const cv::v_uint8x16 zero = cv::v_setzero_u8();
+    for (; x + cv::v_uint8x16::nlanes <= cols; x += cv::v_uint8x16::nlanes) {
+        const cv::v_uint8x16 current16 = cv::v_load(a + x);
+        cv::v_uint8x16 delta = cv::v_absdiff(current16, cv::v_load(b + x));
+        if (o) delta = cv::v_min(delta, cv::v_absdiff(current16, cv::v_load(o + x)));
+        cv::v_uint8x16 mixed = bg ? (delta | cv::v_load(bg + x)) : delta;
+        if (ex) {
+            const cv::v_uint8x16 keep = cv::v_load(ex + x) == zero;
+            delta = delta & keep;
+            mixed = mixed & keep;
+        }
+        cv::v_store(d + x, delta);
+        if (combined) cv::v_store(combined + x, mixed);
+    }
+#else
+    (void)a, (void)b, (void)o, (void)bg, (void)ex, (void)d, (void)combined, (void)cols;
+#endif
+    return x;
+}
+
+int thresholdRowUniversal(const uchar* d, const uchar* bg, const uchar* ex, uchar level, uchar high, uchar* out,
+                          int cols) {
+    int x = 0;
+#if CV_SIMD128
+    const cv::v_uint8x16 zero = cv::v_setzero_u8();
+    const cv::v_uint8x16 levels = cv::v_setall_u8(level);
+    const cv::v_uint8x16 highs = cv::v_setall_u8(high);
+    for (; x + cv::v_uint8x16::nlanes <= cols; x += cv::v_uint8x16::nlanes) {
+        cv::v_uint8x16 mixed = cv::v_load(d + x);
+        if (bg) mixed = mixed | cv::v_load(bg + x);
+        cv::v_uint8x16 motion = (mixed > levels) & highs;
+        if (ex) motion = motion & (cv::v_load(ex + x) == zero);
+        cv::v_store(out + x, motion);
+    }
+#else
+    (void)d, (void)bg, (void)ex, (void)level, (void)high, (void)out, (void)cols;
+#endif
+    return x;
+}
+
+AbsDiffRow absDiffRowFor(SimdLevel level) {
+    switch (level) {
+#if BIRDS_SIMD_AVX512
+        case SimdLevel::Avx512:
+            return absDiffRowAvx512;
+#endif
+#if BIRDS_SIMD_AVX2
+        case SimdLevel::Avx2:
+            return absDiffRowAvx2;
+#endif
+#if BIRDS_SIMD_NEON
+        case SimdLevel::Neon:
+            return absDiffRowNeon;
+#endif
+        case SimdLevel::Universal128:
+            return absDiffRowUniversal;
+        default:
+            return absDiffRowScalar;
+    }
+}
+
+ThresholdRow thresholdRowFor(SimdLevel level) {
+    switch (level) {
+#if BIRDS_SIMD_AVX512
+        case SimdLevel::Avx512:
+            return thresholdRowAvx512;
+#endif
+#if BIRDS_SIMD_AVX2
+        case SimdLevel::Avx2:
+            return thresholdRowAvx2;
+#endif
+#if BIRDS_SIMD_NEON
+        case SimdLevel::Neon:
+            return thresholdRowNeon;
+#endif
+        case SimdLevel::Universal128:
+            return thresholdRowUniversal;
+        default:
+            return thresholdRowScalar;
+    }
+}
+
+}  // namespace
+
+void absDiffHistogram(const cv::Mat& current, const cv::Mat& previous, const cv::Mat& background,
+                      const cv::Mat& excluded, cv::Mat& diff, MotionHistogram& histogram,
+                      int histogramRowStep) {
+    absDiffHistogram(current, previous, cv::Mat(), background, excluded, diff, histogram, histogramRowStep);
+}
+
+void absDiffHistogram(const cv::Mat& current, const cv::Mat& previous, const cv::Mat& older,
+                      const cv::Mat& background, const cv::Mat& excluded, cv::Mat& diff,
+                      MotionHistogram& histogram, int histogramRowStep) {
+    CV_Assert(current.type() == CV_8UC1 && previous.type() == CV_8UC1);
+    CV_Assert(histogramRowStep >= 1);
+    CV_Assert(current.size() == previous.size());
+    CV_Assert(older.empty() || (older.type() == CV_8UC1 && older.size() == current.size()));
+    checkMask(background, current.size());
+    checkMask(excluded, current.size());
+    diff.create(current.size(), CV_8UC1);
+
+    // Four interleaved sub-histograms so runs of equal pixels do not serialize on one counter
+    std::array<MotionHistogram, 4> partial{};
+    const AbsDiffRow vectorRow = absDiffRowFor(simdLevel());
+    alignas(64) uchar combined[kChunkCols];
+    const int cols = current.cols;
+    for (int y = 0; y < current.rows; ++y) {
+        const uchar* a = current.ptr<uchar>(y);
+        const uchar* b = previous.ptr<uchar>(y);
+        const uchar* o = older.empty() ? nullptr : older.ptr<uchar>(y);
+        const uchar* bg = background.empty() ? nullptr : background.ptr<uchar>(y);
+        const uchar* ex = excluded.empty() ? nullptr : excluded.ptr<uchar>(y);
+        uchar* d = diff.ptr<uchar>(y);
+        const bool counted = y % histogramRowStep == 0;
+
+        for (int start = 0; start < cols; start += kChunkCols) {
+            const int n = std::min(kChunkCols, cols - start);
+            int x = vectorRow(a + start, b + start, o ? o + start : nullptr, bg ? bg + start : nullptr,
+                              ex ? ex + start : nullptr, d + start, counted ? combined : nullptr, n);
+            for (; x < n; ++x) {
+                const int i = start + x;
+                uchar delta = static_cast<uchar>(std::abs(a[i] - b[i]));
+                if (o) delta = std::min(delta, static_cast<uchar>(std::abs(a[i] - o[i])));
+                uchar mixed = bg ? static_cast<uchar>(delta | bg[i]) : delta;
+                if (ex && ex[i]) {
+                    delta = 0;
+                    mixed = 0;
+                }
+                d[i] = delta;
+                combined[x] = mixed;
+            }
+            if (!counted) continue;
+            int k = 0;
+            for (; k + 4 <= n; k += 4) {
+                ++partial[0][combined[k]];
+                ++partial[1][combined[k + 1]];
+                ++partial[2][combined[k + 2]];
+                ++partial[3][combined[k + 3]];
+            }
+            for (; k < n; ++k) ++partial[k & 3][combined[k]];
+        }
+    }
+
+    for (size_t v = 0; v < histogram.size(); ++v) {
+        histogram[v] = partial[0][v] + partial[1][v] + partial[2][v] + partial[3][v];
+    }
+}
+
+int otsuThreshold(const MotionHistogram& histogram) {
+    // Same arithmetic as OpenCV's getThreshVal_Otsu_8u so the selected value is identical
+    double total = 0.0;
+    double mu = 0.0;
+    for (size_t i = 0; i < histogram.size(); ++i) {
+        total += histogram[i];
+        mu += i * static_cast<double>(histogram[i]);
+    }
+    if (total <= 0.0) return 0;
+
+    const double scale = 1.0 / total;
+    mu *= scale;
+
+    double mu1 = 0.0;
+    double q1 = 0.0;
+    double maxSigma = 0.0;
+    int maxValue = 0;
+    for (size_t i = 0; i < histogram.size(); ++i) {
+        const double p = histogram[i] * scale;
+        mu1 *= q1;
+        q1 += p;
+        const double q2 = 1.0 - q1;
+        if (std::min(q1, q2) < FLT_EPSILON || std::max(q1, q2) > 1.0 - FLT_EPSILON) continue;
+
+        mu1 = (mu1 + i * p) / q1;
+        const double mu2 = (mu - q1 * mu1) / q2;
+        const double sigma = q1 * q2 * (mu1 - mu2) * (mu1 - mu2);
+        if (sigma > maxSigma) {
+            maxSigma = sigma;
+            maxValue = static_cast<int>(i);
+        }
+    }
+    return maxValue;
+}
+
+double histogramDrift(const MotionHistogram& a, const MotionHistogram& b) {
+    constexpr size_t kBuckets = 16;
+    constexpr size_t kBinsPerBucket = 256 / kBuckets;
+    std::array<double, kBuckets> bucketsA{};
+    std::array<double, kBuckets> bucketsB{};
+    double totalA = 0.0;
+    double totalB = 0.0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        bucketsA[i / kBinsPerBucket] += a[i];
+        bucketsB[i / kBinsPerBucket] += b[i];
+        totalA += a[i];
+        totalB += b[i];
+    }
+    if (totalA <= 0.0 || totalB <= 0.0) return 2.0;
+
+    double drift = 0.0;
+    for (size_t k = 0; k < kBuckets; ++k) {
+        drift += std::abs(bucketsA[k] / totalA - bucketsB[k] / totalB);
+    }
+    return drift;
+}
+
+void thresholdMotion(const cv::Mat& diff, const cv::Mat& background, const cv::Mat& excluded,
+                     int threshold, int maxValue, cv::Mat& thresh) {
+    CV_Assert(diff.type() == CV_8UC1);
+    CV_Assert(threshold >= 0 && threshold <= 255);
+    checkMask(background, diff.size());
+    checkMask(excluded, diff.size());
+    thresh.create(diff.size(), CV_8UC1);
+
+    const uchar high = cv::saturate_cast<uchar>(maxValue);
+    const uchar level = static_cast<uchar>(threshold);
+    const ThresholdRow vectorRow = thresholdRowFor(simdLevel());
+    const int cols = diff.cols;
+    for (int y = 0; y < diff.rows; ++y) {
+        const uchar* d = diff.ptr<uchar>(y);
+        const uchar* bg = background.empty() ? nullptr : background.ptr<uchar>(y);
+        const uchar* ex = excluded.empty() ? nullptr : excluded.ptr<uchar>(y);
+        uchar* out = thresh.ptr<uchar>(y);
+        int x = vectorRow(d, bg, ex, level, high, out, cols);
+        for (; x < cols; ++x) {
+            const uchar combined = bg ? static_cast<uchar>(d[x] | bg[x]) : d[x];
+            out[x] = (combined > level && !(ex && ex[x])) ? high : 0;
+        }
+    }
+}
+
+int growHysteresis(const cv::Mat& diff, const cv::Mat& background, const cv::Mat& excluded, int lowThreshold,
+                   cv::Mat& thresh, std::vector<int>& stack) {
+    CV_Assert(diff.type() == CV_8UC1);
+    CV_Assert(thresh.type() == CV_8UC1 && thresh.size() == diff.size() && thresh.isContinuous());
+    CV_Assert(lowThreshold >= 0 && lowThreshold <= 255);
+    checkMask(background, diff.size());
+    checkMask(excluded, diff.size());
+
+    const int cols = diff.cols;
+    const int rows = diff.rows;
+    uchar* mask = thresh.data;
+    // Seeds: every strong pixel; its value is what grown pixels get
+    stack.clear();
+    uchar high = 0;
+    for (int i = 0, total = rows * cols; i < total; ++i) {
+        if (mask[i]) {
+            high = mask[i];
+            stack.push_back(i);
+        }
+    }
+    const uchar level = static_cast<uchar>(lowThreshold);
+    int grown = 0;
+    while (!stack.empty()) {
+        const int index = stack.back();
+        stack.pop_back();
+        const int y = index / cols;
+        const int x = index - y * cols;
+        for (int ny = std::max(0, y - 1); ny <= std::min(rows - 1, y + 1); ++ny) {
+            const uchar* d = diff.ptr<uchar>(ny);
+            const uchar* bg = background.empty() ? nullptr : background.ptr<uchar>(ny);
+            const uchar* ex = excluded.empty() ? nullptr : excluded.ptr<uchar>(ny);
+            uchar* out = mask + static_cast<size_t>(ny) * cols;
+            for (int nx = std::max(0, x - 1); nx <= std::min(cols - 1, x + 1); ++nx) {
+                if (out[nx]) continue;
+                const uchar combined = bg ? static_cast<uchar>(d[nx] | bg[nx]) : d[nx];
+                if (combined <= level || (ex && ex[nx])) continue;
+                out[nx] = high;
+                stack.push_back(ny * cols + nx);
+                ++grown;
+            }
+        }
+    }
+    return grown;
+}
@@ -0,0 +1,53 @@
+// Compiled with -mavx2 (ENABLE_SIMD_DISPATCH); only called after a runtime AVX2 check
+#include <immintrin.h>
+
+#include "motion_mask_kernel_simd.hpp"
+
+namespace {
+
+inline __m256i load(const unsigned char* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+
+inline void store(unsigned char* p, __m256i v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+
+inline __m256i absDiff(__m256i a, __m256i b) { return _mm256_or_si256(_mm256_subs_epu8(a, b), _mm256_subs_epu8(b, a)); }
+
+}  // namespace
+
+int absDiffRowAvx2(const unsigned char* current, const unsigned char* previous, const unsigned char* older,
+                   const unsigned char* background, const unsigned char* excluded, unsigned char* diff,
+                   unsigned char* combined, int cols) {
+    const __m256i zero = _mm256_setzero_si256();
+    int x = 0;
+    for (; x + 32 <= cols; x += 32) {
+        const __m256i a = load(current + x);
+        __m256i delta = absDiff(a, load(previous + x));
+        if (older) delta = _mm256_min_epu8(delta, absDiff(a, load(older + x)));
+        __m256i mixed = background ? _mm256_or_si256(delta, load(background + x)) : delta;
+        if (excluded) {
+            const __m256i keep = _mm256_cmpeq_epi8(load(excluded + x), zero);
+            delta = _mm256_and_si256(delta, keep);
+            mixed = _mm256_and_si256(mixed, keep);
+        }
+        store(diff + x, delta);
+        if (combined) store(combined + x, mixed);
+    }
+    return x;
+}
+
+int thresholdRowAvx2(const unsigned char* diff, const unsigned char* background, const unsigned char* excluded,
+                     unsigned char level, unsigned char high, unsigned char* thresh, int cols) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i levels = _mm256_set1_epi8(static_cast<char>(level));
+    const __m256i highs = _mm256_set1_epi8(static_cast<char>(high));
+    int x = 0;
+    for (; x + 32 <= cols; x += 32) {
+        __m256i mixed = load(diff + x);
+        if (background) mixed = _mm256_or_si256(mixed, load(background + x));
+        // No unsigned byte compare in AVX2: mixed > level exactly where mixed - level saturates above 0
+        const __m256i atMost = _mm256_cmpeq_epi8(_mm256_subs_epu8(mixed, levels), zero);
+        __m256i motion = _mm256_andnot_si256(atMost, highs);
+        if (excluded) motion = _mm256_and_si256(motion, _mm256_cmpeq_epi8(load(excluded + x), zero));
+        store(thresh + x, motion);
+    }
+    return x;
+}
@@ -0,0 +1,51 @@
+// Compiled with -mavx512bw (ENABLE_SIMD_DISPATCH); only called after a runtime AVX-512BW check
+#include <immintrin.h>
+
+#include "motion_mask_kernel_simd.hpp"
+
+namespace {
+
+inline __m512i load(const unsigned char* p) { return _mm512_loadu_si512(p); }
+
+inline void store(unsigned char* p, __m512i v) { _mm512_storeu_si512(p, v); }
+
+inline __m512i absDiff(__m512i a, __m512i b) { return _mm512_or_si512(_mm512_subs_epu8(a, b), _mm512_subs_epu8(b, a)); }
+
+}  // namespace
+
+int absDiffRowAvx512(const unsigned char* current, const unsigned char* previous, const unsigned char* older,
+                     const unsigned char* background, const unsigned char* excluded, unsigned char* diff,
+                     unsigned char* combined, int cols) {
+    const __m512i zero = _mm512_setzero_si512();
+    int x = 0;
+    for (; x + 64 <= cols; x += 64) {
+        const __m512i a = load(current + x);
+        __m512i delta = absDiff(a, load(previous + x));
+        if (older) delta = _mm512_min_epu8(delta, absDiff(a, load(older + x)));
+        __m512i mixed = background ? _mm512_or_si512(delta, load(background + x)) : delta;
+        if (excluded) {
+            const __mmask64 keep = _mm512_cmpeq_epi8_mask(load(excluded + x), zero);
+            delta = _mm512_maskz_mov_epi8(keep, delta);
+            mixed = _mm512_maskz_mov_epi8(keep, mixed);
+        }
+        store(diff + x, delta);
+        if (combined) store(combined + x, mixed);
+    }
+    return x;
+}
+
+int thresholdRowAvx512(const unsigned char* diff, const unsigned char* background, const unsigned char* excluded,
+                       unsigned char level, unsigned char high, unsigned char* thresh, int cols) {
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i levels = _mm512_set1_epi8(static_cast<char>(level));
+    const __m512i highs = _mm512_set1_epi8(static_cast<char>(high));
+    int x = 0;
+    for (; x + 64 <= cols; x += 64) {
+        __m512i mixed = load(diff + x);
+        if (background) mixed = _mm512_or_si512(mixed, load(background + x));
+        __mmask64 motion = _mm512_cmpgt_epu8_mask(mixed, levels);
+        if (excluded) motion &= _mm512_cmpeq_epi8_mask(load(excluded + x), zero);
+        store(thresh + x, _mm512_maskz_mov_epi8(motion, highs));
+    }
+    return x;
+}
@@ -0,0 +1,64 @@
+// ARM64 NEON variant (ENABLE_SIMD_DISPATCH); NEON is part of ARMv8-A, so no runtime check
+#include <arm_neon.h>
+
+#include "motion_mask_kernel_simd.hpp"
+
+namespace {
+
+// One 16-byte block of absDiffRowNeon
+inline void absDiffBlock(const unsigned char* current, const unsigned char* previous, const unsigned char* older,
+                         const unsigned char* background, const unsigned char* excluded, unsigned char* diff,
+                         unsigned char* combined, int x) {
+    const uint8x16_t a = vld1q_u8(current + x);
+    uint8x16_t delta = vabdq_u8(a, vld1q_u8(previous + x));
+    if (older) delta = vminq_u8(delta, vabdq_u8(a, vld1q_u8(older + x)));
+    uint8x16_t mixed = background ? vorrq_u8(delta, vld1q_u8(background + x)) : delta;
+    if (excluded) {
+        const uint8x16_t keep = vceqq_u8(vld1q_u8(excluded + x), vdupq_n_u8(0));
+        delta = vandq_u8(delta, keep);
+        mixed = vandq_u8(mixed, keep);
+    }
+    vst1q_u8(diff + x, delta);
+    if (combined) vst1q_u8(combined + x, mixed);
+}
+
+inline void thresholdBlock(const unsigned char* diff, const unsigned char* background, const unsigned char* excluded,
+                           uint8x16_t levels, uint8x16_t highs, unsigned char* thresh, int x) {
+    uint8x16_t mixed = vld1q_u8(diff + x);
+    if (background) mixed = vorrq_u8(mixed, vld1q_u8(background + x));
+    uint8x16_t motion = vandq_u8(vcgtq_u8(mixed, levels), highs);
+    if (excluded) motion = vandq_u8(motion, vceqq_u8(vld1q_u8(excluded + x), vdupq_n_u8(0)));
+    vst1q_u8(thresh + x, motion);
+}
+
+}  // namespace
+
+// Two blocks per iteration: the cores this targets issue several NEON ops per cycle
+int absDiffRowNeon(const unsigned char* current, const unsigned char* previous, const unsigned char* older,
+                   const unsigned char* background, const unsigned char* excluded, unsigned char* diff,
+                   unsigned char* combined, int cols) {
+    int x = 0;
+    for (; x + 32 <= cols; x += 32) {
+        absDiffBlock(current, previous, older, background, excluded, diff, combined, x);
+        absDiffBlock(current, previous, older, background, excluded, diff, combined, x + 16);
+    }
+    for (; x + 16 <= cols; x += 16) {
+        absDiffBlock(current, previous, older, background, excluded, diff, combined, x);
+    }
+    return x;
+}
+
+int thresholdRowNeon(const unsigned char* diff, const unsigned char* background, const unsigned char* excluded,
+                     unsigned char level, unsigned char high, unsigned char* thresh, int cols) {
+    const uint8x16_t levels = vdupq_n_u8(level);
+    const uint8x16_t highs = vdupq_n_u8(high);
+    int x = 0;
+    for (; x + 32 <= cols; x += 32) {
+        thresholdBlock(diff, background, excluded, levels, highs, thresh, x);
+        thresholdBlock(diff, background, excluded, levels, highs, thresh, x + 16);
+    }
+    for (; x + 16 <= cols; x += 16) {
+        thresholdBlock(diff, background, excluded, levels, highs, thresh, x);
+    }
+    return x;
+}
@@ -1,38 +1,204 @@
 #include "motion_pipeline.hpp"
+
+#include <stdexcept>
+
 #include "logger.hpp"
+#include "region_crops.hpp"
+
+std::vector<TrackedObject> makeTrackedObjects(const std::vector<cv::Rect>& detectedBounds,
+                                              int firstId) {
+    std::vector<TrackedObject> trackedObjects;
+    trackedObjects.reserve(detectedBounds.size());
+    
+    int currentId = firstId;
+    for (const auto& bounds : detectedBounds) {
+        trackedObjects.emplace_back(currentId, bounds, "uuid_" + std::to_string(currentId));
+        ++currentId;
+    }
+    return trackedObjects;
+}
+
+void makeTrackedObjects(const std::vector<cv::Rect>& detectedBounds, TrackedObjectStore& store,
+                        int firstId) {
+    store.clear(true);
+    int currentId = firstId;
+    for (const auto& bounds : detectedBounds) store.add(currentId++, bounds);
+}
+
+namespace {
+
+// Consolidate one frame's objects into context.regions, saving a visualization when a path
+// is given (nothing is consolidated on frames without objects)
+void consolidateTrackedObjects(MotionRegionConsolidator& regionConsolidator,
+                               MotionPipelineContext& context,
+                               const std::string& visualizationPath) {
+    const TrackedObjectStore& trackedObjects = context.trackedObjects;
+    if (trackedObjects.empty()) {
+        context.regions.clear();
+        return;
+    }
+    if (!visualizationPath.empty() && !context.result.originalFrame.empty()) {
+        // Drawing needs materialized TrackedObjects
+        context.regions = regionConsolidator.consolidateRegionsWithVisualization(
+            trackedObjects.toTrackedObjects(), context.result.originalFrame, visualizationPath);
+    } else {
+        regionConsolidator.consolidateRegionsInto(trackedObjects, context.regions, &context.arena);
+    }
+    MotionHistory::summarizeRegions(trackedObjects, context.result.detectedMotion, context.regions);
+    MotionRegionConsolidator::summarizeDetections(trackedObjects, context.result.detections, context.regions);
+    LOG_DEBUG_LIMITED("Motion detection: {} -> {} regions", trackedObjects.size(),
+                      context.regions.size());
+}
+
+}  // namespace
+
+void processFrameAndConsolidate(MotionProcessor& motionProcessor,
+                                MotionRegionConsolidator& regionConsolidator, const cv::Mat& frame,
+                                MotionPipelineContext& context,
+                                const std::string& visualizationPath) {
+    context.result = motionProcessor.processFrame(frame);
+    regionConsolidator.setFrameSize(frame.size());
+
+    // One object per detected box, numbered within the frame
+    makeTrackedObjects(context.result.detectedBounds, context.trackedObjects);
+    consolidateTrackedObjects(regionConsolidator, context, visualizationPath);
+    context.arena.reset();  // Nothing allocated from it outlives the frame
+}
+
+void consolidateDetections(MotionRegionConsolidator& regionConsolidator, const cv::Mat& frame,
+                           MotionPipelineContext& context) {
+    regionConsolidator.setFrameSize(frame.size());
+    makeTrackedObjects(context.result.detectedBounds, context.trackedObjects);
+    consolidateTrackedObjects(regionConsolidator, context, "");
+    context.arena.reset();
+}
+
+void processFrameAndConsolidate(MotionProcessor& motionProcessor, ObjectTracker& tracker,
+                                MotionRegionConsolidator& regionConsolidator, const cv::Mat& frame,
+                                MotionPipelineContext& context,
+                                const std::string& visualizationPath) {
+    context.result = motionProcessor.processFrame(frame);
+    regionConsolidator.setFrameSize(frame.size());
+
+    // Associate detections with live tracks for persistent IDs (following the mask centroids)
+    tracker.update(context.result.detections, context.trackedObjects);
+    consolidateTrackedObjects(regionConsolidator, context, visualizationPath);
+    context.arena.reset();  // Nothing allocated from it outlives the frame
+}
+
+bool processFrameOrPropagate(MotionProcessor& motionProcessor, ObjectTracker& tracker,
+                             MotionRegionConsolidator& regionConsolidator, RegionFlowPropagator& propagator,
+                             const cv::Mat& frame, MotionPipelineContext& context) {
+    MotionProcessor::ProcessingResult& result = context.result;
+    if (!propagator.detectionDue() && propagator.propagate(frame, result.detectedBounds)) {
+        // Only the boxes are known; the bounds vector keeps its capacity
+        result.originalFrame.release();
+        result.processedFrame.release();
+        result.frameDiff.release();
+        result.thresh.release();
+        result.morphological.release();
+        result.hasMotion = !result.detectedBounds.empty();
+        result.extraction = MotionProcessor::ExtractionStats();
+        result.flood = MotionProcessor::FloodKind::NONE;
+        result.shiftCompensated = false;
+        result.globalShift = cv::Point2d();
+        result.detectedMotion.clear();  // Regions keep the motion of their last detection frame
+        result.detections.clear();
+        tracker.update(result.detectedBounds, context.trackedObjects);
+        RegionFlowPropagator::moveRegions(context.trackedObjects, propagator.shifts(), context.regions);
+        context.crops.clear();
+        return false;
+    }
+    processFrameAndConsolidate(motionProcessor, tracker, regionConsolidator, frame, context);
+    propagator.seed(frame, result.detectedBounds);
+    return true;
+}
 
 std::pair<MotionProcessor::ProcessingResult, std::vector<ConsolidatedRegion>> 
 processFrameAndConsolidate(MotionProcessor& motionProcessor, 
                           MotionRegionConsolidator& regionConsolidator,
                           const cv::Mat& frame,
                           const std::string& visualizationPath) {
-    
-    // Process frame using motion processor
-    MotionProcessor::ProcessingResult processingResult = motionProcessor.processFrame(frame);
-    
-    // Create simple TrackedObjects from detected bounds for region consolidation
-    std::vector<TrackedObject> trackedObjects;
-    static int nextId = 0; // Simple ID assignment
-    
-    for (const auto& bounds : processingResult.detectedBounds) {
-        int currentId = nextId++;
-        trackedObjects.emplace_back(currentId, bounds, "uuid_" + std::to_string(currentId));
+    MotionPipelineContext context;
+    processFrameAndConsolidate(motionProcessor, regionConsolidator, frame, context,
+                               visualizationPath);
+    return {std::move(context.result), std::move(context.regions)};
+}
+
+std::pair<MotionProcessor::ProcessingResult, std::vector<ConsolidatedRegion>>
+processFrameAndConsolidate(MotionProcessor& motionProcessor, ObjectTracker& tracker,
+                           MotionRegionConsolidator& regionConsolidator, const cv::Mat& frame,
+                           const std::string& visualizationPath) {
+    MotionPipelineContext context;
+    processFrameAndConsolidate(motionProcessor, tracker, regionConsolidator, frame, context,
+                               visualizationPath);
+    return {std::move(context.result), std::move(context.regions)};
+}
+
+MotionStageGraph::MotionStageGraph(MotionProcessor& processor, MotionRegionConsolidator& consolidator,
+                                   ObjectTracker* tracker, const StageGraphSettings& settings)
+    : processor_(processor), consolidator_(consolidator), tracker_(tracker) {
+    graph_.addSource("frame");
+    if (settings.stages.empty()) {
+        for (const char* name : {"detect", tracker ? "track" : "number", "consolidate"}) addStage(name);
+    } else {
+        for (const auto& name : settings.stages) addStage(name);
     }
-    
-    // Consolidate motion regions with optional visualization
-    std::vector<ConsolidatedRegion> consolidatedRegions;
-    if (!trackedObjects.empty()) {
-        if (!visualizationPath.empty()) {
-            // Use the original frame from motion processor for visualization
-            consolidatedRegions = regionConsolidator.consolidateRegionsWithVisualization(
-                trackedObjects, processingResult.originalFrame, visualizationPath);
-        } else {
-            consolidatedRegions = regionConsolidator.consolidateRegions(trackedObjects);
-        }
-        
-        LOG_INFO("Motion detection: {} -> {} regions", 
-                 trackedObjects.size(), consolidatedRegions.size());
+    graph_.requestOutputs(settings.outputs);
+    graph_.compile();
+    if (graph_.isConsumed("mask")) {
+        processor_.setRetainedStages(processor_.getRetainedStages() | MotionProcessor::STAGE_MORPHOLOGICAL);
     }
-    
-    return {processingResult, consolidatedRegions};
+}
+
+void MotionStageGraph::addStage(const std::string& name) {
+    if (name == "detect") {
+        graph_.addStage(name, {"frame"}, {"boxes", "mask"},
+                        [this] { context_->result = processor_.processFrame(*frame_); });
+    } else if (name == "track") {
+        if (!tracker_) throw std::invalid_argument("MotionStageGraph: stage 'track' needs a tracker");
+        graph_.addStage(name, {"boxes"}, {"objects"},
+                        [this] { tracker_->update(context_->result.detectedBounds, context_->trackedObjects); });
+    } else if (name == "number") {
+        graph_.addStage(name, {"boxes"}, {"objects"},
+                        [this] { makeTrackedObjects(context_->result.detectedBounds, context_->trackedObjects); });
+    } else if (name == "consolidate") {
+        graph_.addStage(name, {"frame", "objects"}, {"regions"}, [this] {
+            consolidator_.setFrameSize(frame_->size());
+            consolidateTrackedObjects(consolidator_, *context_, std::string());
+        });
+    } else if (name == "crops") {
+        graph_.addStage(name, {"frame", "regions"}, {"crops"},
+                        [this] { regionCrops(*frame_, context_->regions, context_->crops); });
+    } else if (name == "visualize") {
+        graph_.addStage(
+            name, {"frame", "objects", "regions"}, {},
+            [this] {
+                if (visualizationPath_->empty() || context_->trackedObjects.empty()) return;
+                consolidator_.saveVisualization(context_->trackedObjects.toTrackedObjects(), context_->regions,
+                                                *frame_, *visualizationPath_);
+            },
+            true);
+    } else {
+        throw std::invalid_argument("MotionStageGraph: unknown stage '" + name + "'");
+    }
+}
+
+void MotionStageGraph::run(const cv::Mat& frame, MotionPipelineContext& context,
+                           const std::string& visualizationPath, WorkStealingPool* pool) {
+    frame_ = &frame;
+    context_ = &context;
+    visualizationPath_ = &visualizationPath;
+    // Slots of skipped stages are empty rather than left from an earlier frame
+    if (!graph_.isActive("detect")) context.result = MotionProcessor::ProcessingResult();
+    if (!graph_.isActive("track") && !graph_.isActive("number")) context.trackedObjects.clear(true);
+    if (!graph_.isActive("consolidate")) context.regions.clear();
+    context.crops.clear();
+    try {
+        graph_.run(pool);
+    } catch (...) {
+        context.arena.reset();
+        throw;
+    }
+    context.arena.reset();  // Nothing allocated from it outlives the frame
 }
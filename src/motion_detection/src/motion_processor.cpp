@@ -20,12 +20,200 @@
  */
 
 #include "motion_processor.hpp"
+#include "approximate_background_subtractor.hpp"
+#include "debug_artifact_writer.hpp"
 #include "logger.hpp"
+#include "pipeline_config.hpp"
 #include <yaml-cpp/yaml.h>
+#include <opencv2/core/ocl.hpp>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
 #include <filesystem>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
 
 namespace fs = std::filesystem;
 
+namespace {
+
+// Names used in config.yaml and in the logs
+
+const char* toString(MotionProcessor::ProcessingMode mode) {
+    switch (mode) {
+        case MotionProcessor::ProcessingMode::HSV: return "hsv";
+        case MotionProcessor::ProcessingMode::RGB: return "rgb";
+        case MotionProcessor::ProcessingMode::YCRCB: return "ycrcb";
+        case MotionProcessor::ProcessingMode::GRAYSCALE: break;
+    }
+    return "grayscale";
+}
+
+const char* toString(MotionProcessor::InputFormat format) {
+    switch (format) {
+        case MotionProcessor::InputFormat::NV12: return "nv12";
+        case MotionProcessor::InputFormat::YUYV: return "yuyv";
+        case MotionProcessor::InputFormat::BGR: break;
+    }
+    return "bgr";
+}
+
+const char* toString(MotionProcessor::BlurType type) {
+    switch (type) {
+        case MotionProcessor::BlurType::GAUSSIAN: return "gaussian";
+        case MotionProcessor::BlurType::MEDIAN: return "median";
+        case MotionProcessor::BlurType::BILATERAL: return "bilateral";
+        case MotionProcessor::BlurType::GUIDED: return "guided";
+        case MotionProcessor::BlurType::DOMAIN_TRANSFORM: return "domain_transform";
+        case MotionProcessor::BlurType::STACK: return "stack";
+        case MotionProcessor::BlurType::NONE: break;
+    }
+    return "none";
+}
+
+const char* toString(MotionProcessor::ContourMode mode) {
+    return mode == MotionProcessor::ContourMode::ADAPTIVE ? "adaptive" : "permissive";
+}
+
+const char* toString(MotionProcessor::ExtractionMethod method) {
+    return method == MotionProcessor::ExtractionMethod::COMPONENTS ? "components" : "contours";
+}
+
+const char* toString(MotionProcessor::ComputeBackend backend) {
+    return backend == MotionProcessor::ComputeBackend::OPENCL ? "opencl" : "cpu";
+}
+
+const char* toString(MotionProcessor::DifferencingMode mode) {
+    return mode == MotionProcessor::DifferencingMode::THREE_FRAME ? "three_frame" : "two_frame";
+}
+
+const char* toString(MotionProcessor::DetectionMethod method) {
+    return method == MotionProcessor::DetectionMethod::BLOCK ? "block" : "pixel";
+}
+
+const char* toString(MotionProcessor::BackgroundModel model) {
+    switch (model) {
+        case MotionProcessor::BackgroundModel::KNN: return "knn";
+        case MotionProcessor::BackgroundModel::RUNNING_AVERAGE: return "running_average";
+        case MotionProcessor::BackgroundModel::MEDIAN: return "median";
+        case MotionProcessor::BackgroundModel::MOG2: break;
+    }
+    return "mog2";
+}
+
+// Run-based solidity of one labelled component: pixel count over the area of the convex
+// hull of its row runs. Each row contributes the outer corners of the pixels between its
+// leftmost and rightmost labelled pixel, so a filled rectangle scores exactly 1.0.
+// Only the component's bounding box is scanned.
+double runSolidity(const cv::Mat& labels, int label, const cv::Rect& bounds, int pixelCount) {
+    std::vector<cv::Point> corners;
+    corners.reserve(static_cast<size_t>(bounds.height) * 4);
+    for (int y = bounds.y; y < bounds.y + bounds.height; ++y) {
+        const int* row = labels.ptr<int>(y);
+        int left = bounds.x;
+        int right = bounds.x + bounds.width - 1;
+        while (left <= right && row[left] != label) ++left;
+        while (right > left && row[right] != label) --right;
+        if (left > right) continue;
+        corners.emplace_back(left, y);
+        corners.emplace_back(right + 1, y);
+        corners.emplace_back(left, y + 1);
+        corners.emplace_back(right + 1, y + 1);
+    }
+    if (corners.empty()) return 0.0;
+    std::vector<cv::Point> hull;
+    cv::convexHull(corners, hull);
+    const double hullArea = cv::contourArea(hull);
+    return hullArea > 0 ? pixelCount / hullArea : 0.0;
+}
+
+// Mean of @p frameDiff under the set pixels of @p mask inside @p box; -1 without a
+// single-channel difference of the mask's size
+float meanDiffUnder(const cv::Mat& frameDiff, const cv::Mat& mask, const cv::Rect& box) {
+    if (frameDiff.size() != mask.size() || frameDiff.type() != CV_8UC1) return -1.0f;
+    return static_cast<float>(cv::mean(frameDiff(box), mask(box))[0]);
+}
+
+// Band boundaries fall on multiples of this many rows, so every-8th-row histogram
+// sampling (CACHED threshold mode) picks the same rows with and without tiling
+constexpr int kBandRowAlignment = 8;
+
+// Splits rows into at most `bands` contiguous ranges with aligned boundaries
+std::vector<cv::Range> bandRanges(int rows, int bands) {
+    bands = std::max(1, std::min(bands, rows / kBandRowAlignment));
+    int step = (rows + bands - 1) / bands;
+    step = (step + kBandRowAlignment - 1) / kBandRowAlignment * kBandRowAlignment;
+    std::vector<cv::Range> ranges;
+    for (int start = 0; start < rows; start += step) {
+        ranges.emplace_back(start, std::min(rows, start + step));
+    }
+    return ranges;
+}
+
+// Band of an optional mask (empty stays empty)
+cv::Mat bandOf(const cv::Mat& mat, const cv::Range& rows) {
+    return mat.empty() ? cv::Mat() : mat.rowRange(rows);
+}
+
+// Runs fn(band, rows) for every band, in parallel on OpenCV's thread pool
+template <typename Fn>
+void parallelBands(const std::vector<cv::Range>& ranges, Fn fn) {
+    cv::parallel_for_(cv::Range(0, static_cast<int>(ranges.size())), [&](const cv::Range& range) {
+        for (int band = range.start; band < range.end; ++band) fn(band, ranges[band]);
+    });
+}
+
+// Runs op(band, input, output) on horizontal bands of src in parallel. Each band's input
+// extends `halo` rows into its neighbours (clipped at the frame edges), so a filter
+// chain whose output rows depend on at most `halo` rows either side reproduces the
+// untiled result exactly; only the band's own rows are copied into dst, which must
+// already have the output size and type and must not overlap src.
+template <typename Op>
+void forEachBand(const cv::Mat& src, cv::Mat& dst, int bands, int halo,
+                 std::vector<cv::Mat>& scratch, Op op) {
+    const std::vector<cv::Range> ranges = bandRanges(src.rows, bands);
+    if (scratch.size() < ranges.size()) scratch.resize(ranges.size());
+    parallelBands(ranges, [&](int band, const cv::Range& rows) {
+        const int top = std::max(0, rows.start - halo);
+        const int bottom = std::min(src.rows, rows.end + halo);
+        cv::Mat& output = scratch[band];
+        op(band, src.rowRange(top, bottom), output);
+        output.rowRange(rows.start - top, rows.end - top).copyTo(dst.rowRange(rows));
+    });
+}
+
+// Per-pixel maximum over the channels of an 8-bit image, in one pass without
+// splitting planes (the V channel of HSV for a BGR image)
+void maxOverChannels(const cv::Mat& src, cv::Mat& dst) {
+    CV_Assert(src.depth() == CV_8U);
+    const int channels = src.channels();
+    dst.create(src.size(), CV_8UC1);
+    for (int y = 0; y < src.rows; ++y) {
+        const uchar* in = src.ptr<uchar>(y);
+        uchar* out = dst.ptr<uchar>(y);
+        for (int x = 0; x < src.cols; ++x, in += channels) {
+            uchar value = in[0];
+            for (int c = 1; c < channels; ++c) value = std::max(value, in[c]);
+            out[x] = value;
+        }
+    }
+}
+
+// Device version: the per-plane maximum (OpenCL has no fused kernel for it)
+void maxOverChannels(const cv::UMat& src, cv::UMat& dst, std::vector<cv::UMat>& planes) {
+    if (src.channels() == 1) {
+        src.copyTo(dst);
+        return;
+    }
+    cv::split(src, planes);
+    cv::max(planes[0], planes[1], dst);
+    for (size_t c = 2; c < planes.size(); ++c) cv::max(dst, planes[c], dst);
+}
+
+}  // namespace
+
 /**
  * Constructor: Initializes Motion Processor with Configuration
  * ============================================================
@@ -40,19 +228,23 @@ namespace fs = std::filesystem;
  * 
  * @param configPath - Path to YAML configuration file
  */
-MotionProcessor::MotionProcessor(const std::string& configPath) 
+MotionProcessor::MotionProcessor(const std::string& configPath)
+    : MotionProcessor(PipelineConfig::loadOrDefaults(configPath)) {}
+
+MotionProcessor::MotionProcessor(std::shared_ptr<const PipelineConfig> config)
     : firstFrame(true),
+      pipelineConfig(std::move(config)),
       maxThreshold(255),
       
       // INPUT COLOR PROCESSING
       // "grayscale": Standard motion detection (faster, recommended)
       // "rgb": Color-based detection (slower, experimental)
-      processingMode("grayscale"),
+      processingMode(ProcessingMode::GRAYSCALE),
       
       // IMAGE PREPROCESSING
       // Contrast enhancement: Helps in low-light or varying conditions
       contrastEnhancement(false),
-      blurType("gaussian"),  // Options: "gaussian", "median", "bilateral"
+      blurType(BlurType::GAUSSIAN),  // Options: "gaussian", "median", "bilateral", "none"
       claheClipLimit(2.0),   // CLAHE contrast limit (higher = more enhancement)
       claheTileSize(8),      // CLAHE tile size (smaller = more local adaptation)
       gaussianBlurSize(5),   // Gaussian kernel size (odd number, larger = more blur)
@@ -80,10 +272,10 @@ MotionProcessor::MotionProcessor(const std::string& configPath)
       contourApproximation(true),  // Simplify contour shapes
       contourFiltering(true),      // Apply quality filters
       contourEpsilonFactor(0.03),  // How much to simplify contours (0.01-0.05)
-      contourDetectionMode("adaptive"),  // "adaptive" or "permissive"
+      contourMode(ContourMode::ADAPTIVE),  // "adaptive" or "permissive"
       
       // PERMISSIVE MODE DEFAULTS
-      // Used when contourDetectionMode = "permissive"
+      // Used when contourMode = "permissive"
       // Very loose thresholds to catch all potential motion
       permissiveMinArea(50),           // Minimum pixels (50 = very small)
       permissiveMinSolidity(0.1),      // Shape solidity (0.1 = very loose)
@@ -96,7 +288,9 @@ MotionProcessor::MotionProcessor(const std::string& configPath)
       cachedAdaptiveMinArea(minContourArea),
       cachedAdaptiveMinSolidity(minContourSolidity),
       cachedAdaptiveMaxAspectRatio(maxContourAspectRatio) {
-    loadConfig(configPath);  // Override defaults with config file values
+    if (!pipelineConfig) throw std::invalid_argument("MotionProcessor: no config");
+    loadConfig(*pipelineConfig);  // Override defaults with config file values
+    loadBackgroundSnapshot();
 }
 
 // ============================================================================
@@ -111,7 +305,8 @@ MotionProcessor::MotionProcessor(const std::string& configPath)
  * 4. Finds and filters motion regions using contour detection
  * 
  * @param frame Raw input frame from camera/video
- * @return ProcessingResult containing all intermediate steps and final detections
+ * @return ProcessingResult containing the retained intermediate steps (see
+ *         setRetainedStages) and the final detections
  */
 MotionProcessor::ProcessingResult MotionProcessor::processFrame(const cv::Mat& frame) {
     ProcessingResult result;
@@ -121,35 +316,110 @@ MotionProcessor::ProcessingResult MotionProcessor::processFrame(const cv::Mat& f
         return result;
     }
     
-    // Store the original frame for downstream processing
-    result.originalFrame = frame.clone();
-    
-    // Step 1: Preprocess the frame
-    // Convert to grayscale, apply blur for noise reduction,
-    // and optionally enhance contrast
-    result.processedFrame = preprocessFrame(frame);
+    // In buffer-reuse mode every stage writes into persistent, pre-sized buffers so the
+    // steady state performs no frame-sized allocations. Otherwise each frame gets fresh
+    // Mats that the caller may keep indefinitely.
+    FrameBuffers localBuffers;
+    FrameBuffers& buffers = reuseBuffers ? workBuffers : localBuffers;
     
-    // Special handling for the first frame:
-    // Just store it as reference and wait for next frame
-    if (firstFrame) {
-        setPrevFrame(result.processedFrame);
-        firstFrame = false;
+    // Decode YUV camera buffers into the image detection works on: the luma plane
+    // for the luma modes (no conversion), BGR otherwise; BGR input passes through
+    const cv::Mat image = decodeInput(frame, buffers.decoded);
+    if (image.empty()) {
         return result;
     }
     
-    // Step 2: Detect motion
-    // Either using frame differencing (comparing to previous frame)
-    // or background subtraction (comparing to learned background)
-    // Returns a binary mask where white pixels indicate motion
-    result.thresh = detectMotion(result.processedFrame, result.frameDiff, result.thresh);
+    // Store the original frame for downstream processing (always BGR)
+    // (skipped entirely when the caller did not ask for it)
+    if (retainsStage(STAGE_ORIGINAL)) {
+        switch (inputFormat) {
+            case InputFormat::NV12:
+                cv::cvtColor(frame, buffers.original, cv::COLOR_YUV2BGR_NV12);
+                break;
+            case InputFormat::YUYV:
+                cv::cvtColor(frame, buffers.original, cv::COLOR_YUV2BGR_YUYV);
+                break;
+            case InputFormat::BGR:
+                frame.copyTo(buffers.original);
+                break;
+        }
+        result.originalFrame = buffers.original;
+    }
     
-    // Step 3: Clean up the motion mask
-    // Uses morphological operations to:
-    // - Fill small holes (close)
-    // - Remove noise (open)
-    // - Connect nearby regions (dilate)
-    // - Shrink expanded regions (erode)
-    result.morphological = applyMorphologicalOps(result.thresh);
+    // Step 0: Restrict processing to the region of interest
+    // Only the bounding rectangle of the ROI polygons is preprocessed and differenced
+    // (a view, no copy); it is the whole frame when no ROI is configured
+    updateRoiGeometry(image.size());
+    const cv::Mat roiFrame = image(roiRect);
+    
+    // Motion gate (optional): compare a sparse sample of the crop with the sample of
+    // the reference frame and skip every expensive stage when (almost) nothing changed.
+    // The reference is only replaced by processed frames, so slow motion accumulates
+    // until it passes the gate and is then differenced against the same old frame.
+    if (motionGate) {
+        const bool changed = sampleMotionGate(roiFrame);
+        if (!firstFrame && !changed) {
+            ++gatedFrameCount;
+            // Keep the background model learning on a fraction of the skipped frames
+            if (backgroundSubtraction && detectionMethod == DetectionMethod::PIXEL &&
+                motionGateBackgroundInterval > 0 &&
+                ++gatedFramesSinceBackgroundUpdate >= motionGateBackgroundInterval) {
+                gatedFramesSinceBackgroundUpdate = 0;
+                preprocessInto(scaleForDetection(roiFrame, buffers.scaled), buffers.processed);
+                if (bgSubtractor.empty()) {
+                    initializeBackgroundSubtractor(buffers.processed);
+                }
+                applyBackgroundModel(buffers.processed, bgMaskBuffer, backgroundLearningRate);
+            }
+            return result;
+        }
+    }
+    
+    // Steps 1-3: preprocess, detect motion, clean up the mask, on the host (cv::Mat) or
+    // on the OpenCL device (cv::UMat); either way buffers.morphological ends up on the host.
+    // Block detection instead thresholds its block grid (blockGrid)
+    // (roi_prediction: on the windows around the last boxes, between full scans)
+    const bool blocks = detectionMethod == DetectionMethod::BLOCK;
+    const bool onDevice = !blocks && computeBackend == ComputeBackend::OPENCL;
+    const bool predicted = !blocks && !onDevice && roiPrediction && planPredictionWindows(roiFrame);
+    packedMaskFrame = false;  // The host path decides per frame
+    const bool measured = blocks      ? runBlockStages(roiFrame, buffers, result)
+                          : onDevice  ? runDeviceStages(roiFrame, buffers, result)
+                          : predicted ? runPredictedStages(roiFrame, buffers, result)
+                                      : runHostStages(roiFrame, buffers, result);
+    if (!measured) {
+        keepRefinementReference(image);
+        return result;  // First frame: stored as the reference
+    }
+    if (roiPrediction && !predicted) {
+        refreshPredictionBackground();  // The model just learned this frame
+    }
+    if (result.flood != FloodKind::NONE) {
+        predictionBoxes.clear();  // The next frame is scanned whole
+        // No contours, no boxes; the changed frame becomes the reference, so the next
+        // one is compared with the new light or view instead of flooding again
+        ++floodFrameCount;
+        LOG_INFO_LIMITED("Flood guard: {} frame suppressed ({} so far, shift {:.1f}, {:.1f} px)",
+                         result.flood == FloodKind::SHAKE ? "camera shake" : "illumination change",
+                         floodFrameCount.load(), result.globalShift.x, result.globalShift.y);
+        if (refinementActive()) {
+            keepRefinementReference(image);
+        }
+        storePrevFrame(buffers.processed);
+        motionHistory.reset();  // Its trails belong to the old view
+        return result;
+    }
+    if (backgroundSnapshotIntervalFrames > 0 && !bgSubtractor.empty() &&
+        ++framesSinceBackgroundSnapshot >= backgroundSnapshotIntervalFrames) {
+        framesSinceBackgroundSnapshot = 0;
+        saveBackgroundSnapshot();
+    }
+    
+    // Step 3b (motion_history): stamp the cleaned mask into the motion history image
+    const bool measuresMotion = motionHistory.getConfig().enabled && !blocks;
+    if (measuresMotion) {
+        motionHistory.update(buffers.morphological);
+    }
     
     // Step 4: Find motion regions
     // Detects contours in the cleaned mask and filters them based on:
@@ -157,27 +427,134 @@ MotionProcessor::ProcessingResult MotionProcessor::processFrame(const cv::Mat& f
     // - Shape (remove irregular shapes)
     // - Aspect ratio (remove too elongated regions)
     // Uses either adaptive or permissive thresholds
-    result.detectedBounds = extractContours(result.morphological);
+    {
+        STAGE_TIMER(stageTimings, PipelineStage::EXTRACTION);
+        if (blocks) {
+            extractBlockRegions(result.detections);
+        } else {
+            // The device path leaves no host copy of the difference: no mean differences there
+            extractDetections(buffers.morphological, onDevice ? cv::Mat() : buffers.frameDiff, result.detections);
+        }
+    }
+    result.extraction = lastExtraction;
+    Detections& detections = result.detections;
+    if (roiPrediction) {
+        predictionBoxes = detections.rects;  // The next frame's windows
+    }
+    
+    // Boxes were found in the (possibly downscaled) ROI crop; report them in
+    // full-frame coordinates (areas are full-resolution pixels already)
+    for (size_t i = 0; i < detections.size(); ++i) {
+        detections.rects[i] = toFrameCoordinates(detections.rects[i]);
+        detections.centroids[i] = toFrameCoordinates(detections.centroids[i]);
+    }
+    
+    // Step 5 (detection_refinement): detect each downscaled box again on the
+    // full-resolution difference around it
+    if (refinementActive()) {
+        if (!detections.empty()) {
+            STAGE_TIMER(stageTimings, PipelineStage::REFINEMENT);
+            refineDetections(image, detections);
+        }
+        keepRefinementReference(image);
+    }
     
     // Update motion detection status
+    result.detectedBounds = detections.rects;
     result.hasMotion = !result.detectedBounds.empty();
     
-    // Output overall motion detection summary
+    // Step 5b (motion_mask_rle): the mask the boxes came from, as runs over the ROI
+    if (motionMaskRle && result.hasMotion && !blocks) {
+        if (packedMaskFrame) {
+            result.motionMask.assign(packedMorphological.size(), runLabeler.runs());
+        } else {
+            result.motionMask.assign(buffers.morphological);
+        }
+        result.motionMask.setFrameArea(roiRect);
+    }
+    
+    // Step 6 (motion_history): speed and direction of every box
+    if (measuresMotion && result.hasMotion) {
+        measureMotion(result);
+    }
+    
+    // Output overall motion detection summary (rate-limited per call site)
     if (result.hasMotion) {
-        LOG_INFO("=== MOTION DETECTION SUMMARY ===");
-        LOG_INFO("Motion detected: {} regions", result.detectedBounds.size());
-        LOG_INFO("Frame size: {}x{}", result.processedFrame.cols, result.processedFrame.rows);
-        LOG_INFO("Processing mode: {}", processingMode);
-        LOG_INFO("Background subtraction: {}", backgroundSubtraction ? "enabled" : "disabled");
-        LOG_INFO("=== END MOTION DETECTION SUMMARY ===");
+        LOG_DEBUG_LIMITED("Motion detected: {} regions | Frame size: {}x{} | Mode: {} | Background subtraction: {}",
+                          result.detectedBounds.size(), detectionSize.width, detectionSize.height,
+                          toString(processingMode), backgroundSubtraction ? "enabled" : "disabled");
     }
     
-    // Store current frame for next comparison
-    setPrevFrame(result.processedFrame);
+    // Store current frame for next comparison (the device path and block mode keep their own)
+    if (!onDevice && !blocks) {
+        storePrevFrame(buffers.processed);
+    }
     
     return result;
 }
 
+void MotionProcessor::setBufferAllocator(cv::MatAllocator* allocator) {
+    for (cv::Mat* buffer : {&workBuffers.original, &workBuffers.decoded, &workBuffers.scaled,
+                            &workBuffers.processed, &workBuffers.frameDiff, &workBuffers.thresh,
+                            &workBuffers.morphological, &bgMaskBuffer, &motionMaskBuffer,
+                            &colorDiffBuffer, &olderDiffBuffer, &blurInputBuffer}) {
+        buffer->release();
+        buffer->allocator = allocator;
+    }
+}
+
+void MotionProcessor::warmUp(const cv::Mat& frame) {
+    if (frame.empty() || !firstFrame) {
+        return;
+    }
+
+    FrameBuffers localBuffers;
+    FrameBuffers& buffers = reuseBuffers ? workBuffers : localBuffers;
+    const cv::Mat image = decodeInput(frame, buffers.decoded);
+    if (image.empty()) {
+        return;
+    }
+    updateRoiGeometry(image.size());
+    const cv::Mat roiFrame = image(roiRect);
+    if (motionGate) {
+        sampleMotionGate(roiFrame);  // Becomes the gate reference with the frame below
+    }
+    if (detectionMethod == DetectionMethod::BLOCK) {
+        ProcessingResult seeded;
+        runBlockStages(roiFrame, buffers, seeded);  // Seeds the block background
+        stageTimings.reset();
+        LOG_INFO("Motion processor warmed up on a {}x{} frame", frame.cols, frame.rows);
+        return;
+    }
+    preprocessInto(scaleForDetection(roiFrame, buffers.scaled), buffers.processed);
+
+    if (backgroundSubtraction) {
+        bool restored = false;
+        if (bgSubtractor.empty()) {
+            restored = initializeBackgroundSubtractor(buffers.processed);
+        }
+        // A restored model just keeps learning; a fresh one starts as this frame
+        applyBackgroundModel(buffers.processed, bgMaskBuffer, restored ? backgroundLearningRate : 1.0);
+    }
+    if (reuseBuffers) {
+        // Differencing the frame with itself sizes the diff, mask and morphology buffers;
+        // the threshold it picks (no motion) must not be cached for real frames
+        setPrevFrame(buffers.processed);
+        packedMaskFrame = false;  // Sizes the byte buffers
+        detectMotionInto(buffers.processed, buffers.frameDiff, buffers.thresh, roiExcludedMask);
+        applyMorphologicalOpsInto(buffers.thresh, buffers.morphological);
+        occupancyMask = nullptr;  // Nor may its occupancy windows
+        cachedMotionThreshold = -1;
+        framesSinceThresholdUpdate = 0;
+        previousFrames.clear();  // The frame is stored once, below
+    }
+
+    storePrevFrame(buffers.processed);
+    firstFrame = false;
+    stageTimings.reset();  // Warm-up latencies are not frame latencies
+    LOG_INFO("Motion processor warmed up on a {}x{} frame", frame.cols, frame.rows);
+}
+
 // ============================================================================
 // VISUALIZATION METHODS
 // ============================================================================
@@ -188,112 +565,72 @@ void MotionProcessor::saveProcessingVisualization(const ProcessingResult& result
         return;
     }
     
-    cv::Mat visualization = createProcessingVisualization(result);
-    
     std::string finalPath = outputPath.empty() ? 
         visualizationPath + "/motion_processor_output.jpg" : outputPath;
     
-    // Ensure directory exists
-    fs::path path(finalPath);
-    fs::create_directories(path.parent_path());
-    
-    if (cv::imwrite(finalPath, visualization)) {
-        LOG_INFO("Saved MotionProcessor visualization to: {}", finalPath);
-    } else {
-        LOG_ERROR("Failed to save MotionProcessor visualization to: {}", finalPath);
-    }
+    // The canvas is reused by the next call, so the writer gets its own copy
+    DebugArtifactWriter::shared().submit(finalPath, createProcessingVisualization(result).clone());
 }
 
 cv::Mat MotionProcessor::createProcessingVisualization(const ProcessingResult& result) const {
-    // Create a comprehensive visualization showing all processing steps
-    cv::Mat visualization;
-    
-    // Create a 2x3 grid layout for all processing steps
-    std::vector<cv::Mat> steps;
-    
-    // Step 1: Original frame
-    cv::Mat originalWithBoxes = result.originalFrame.clone();
-    drawMotionBoxes(originalWithBoxes, result.detectedBounds);
-    steps.push_back(originalWithBoxes);
-    
-    // Step 2: Processed frame (grayscale/blurred)
-    cv::Mat processedDisplay;
-    if (result.processedFrame.channels() == 1) {
-        cv::cvtColor(result.processedFrame, processedDisplay, cv::COLOR_GRAY2BGR);
-    } else {
-        processedDisplay = result.processedFrame.clone();
-    }
-    steps.push_back(processedDisplay);
-    
-    // Step 3: Frame difference
-    cv::Mat diffDisplay;
-    if (!result.frameDiff.empty()) {
-        cv::cvtColor(result.frameDiff, diffDisplay, cv::COLOR_GRAY2BGR);
-    } else {
-        diffDisplay = cv::Mat::zeros(result.originalFrame.size(), CV_8UC3);
-    }
-    steps.push_back(diffDisplay);
-    
-    // Step 4: Threshold
-    cv::Mat threshDisplay;
-    if (!result.thresh.empty()) {
-        cv::cvtColor(result.thresh, threshDisplay, cv::COLOR_GRAY2BGR);
-    } else {
-        threshDisplay = cv::Mat::zeros(result.originalFrame.size(), CV_8UC3);
-    }
-    steps.push_back(threshDisplay);
-    
-    // Step 5: Morphological operations
-    cv::Mat morphDisplay;
-    if (!result.morphological.empty()) {
-        cv::cvtColor(result.morphological, morphDisplay, cv::COLOR_GRAY2BGR);
-    } else {
-        morphDisplay = cv::Mat::zeros(result.originalFrame.size(), CV_8UC3);
+    // A 3x2 grid of all processing steps. Every step is resized to its cell first and only
+    // then converted to color, straight into the (reused) canvas, so no full-resolution
+    // copies or conversions are made.
+    const int cols = 3;
+    const int rows = 2;
+    const cv::Size cellSize(result.originalFrame.cols / cols, result.originalFrame.rows / rows);
+    visualizationCanvas.create(cellSize.height * rows, cellSize.width * cols, CV_8UC3);
+
+    // Motion boxes are drawn on the cell, in cell coordinates
+    const double scaleX = static_cast<double>(cellSize.width) / result.originalFrame.cols;
+    const double scaleY = static_cast<double>(cellSize.height) / result.originalFrame.rows;
+    std::vector<cv::Rect> cellBounds;
+    cellBounds.reserve(result.detectedBounds.size());
+    for (const auto& bounds : result.detectedBounds) {
+        cellBounds.emplace_back(cvRound(bounds.x * scaleX), cvRound(bounds.y * scaleY),
+                                cvRound(bounds.width * scaleX), cvRound(bounds.height * scaleY));
     }
-    steps.push_back(morphDisplay);
-    
-    // Step 6: Final result (original with motion boxes)
-    cv::Mat finalResult = result.originalFrame.clone();
-    drawMotionBoxes(finalResult, result.detectedBounds);
-    steps.push_back(finalResult);
-    
-    // Create grid layout
-    int cols = 3;
-    int rows = 2;
-    int cellWidth = result.originalFrame.cols / cols;
-    int cellHeight = result.originalFrame.rows / rows;
-    
-    visualization = cv::Mat(cellHeight * rows, cellWidth * cols, CV_8UC3);
-    
-    std::vector<std::string> labels = {
+
+    const std::vector<const cv::Mat*> steps = {
+        &result.originalFrame, &result.processedFrame, &result.frameDiff,
+        &result.thresh,        &result.morphological,  &result.originalFrame};
+    const std::vector<std::string> labels = {
         "Original + Motion Boxes", "Processed Frame", "Frame Difference",
         "Threshold", "Morphological", "Final Result"
     };
-    
-    for (int i = 0; i < steps.size(); ++i) {
-        int row = i / cols;
-        int col = i % cols;
-        
-        cv::Mat cell = visualization(cv::Rect(col * cellWidth, row * cellHeight, cellWidth, cellHeight));
-        
-        // Resize step to fit cell
-        cv::Mat resizedStep;
-        cv::resize(steps[i], resizedStep, cv::Size(cellWidth, cellHeight));
-        resizedStep.copyTo(cell);
-        
+
+    for (size_t i = 0; i < steps.size(); ++i) {
+        const int row = static_cast<int>(i) / cols;
+        const int col = static_cast<int>(i) % cols;
+        cv::Mat cell = visualizationCanvas(
+            cv::Rect(col * cellSize.width, row * cellSize.height, cellSize.width, cellSize.height));
+
+        const cv::Mat& step = *steps[i];
+        if (step.empty()) {
+            cell.setTo(cv::Scalar::all(0));
+        } else if (step.channels() == 1) {
+            cv::resize(step, visualizationScratch, cellSize);
+            cv::cvtColor(visualizationScratch, cell, cv::COLOR_GRAY2BGR);
+        } else {
+            cv::resize(step, cell, cellSize);  // Writes into the cell (same size and type)
+        }
+        if (i == 0 || i == steps.size() - 1) {
+            drawMotionBoxes(cell, cellBounds);
+        }
+
         // Add label
-        cv::putText(visualization, labels[i], 
-                   cv::Point(col * cellWidth + 10, row * cellHeight + 30),
+        cv::putText(visualizationCanvas, labels[i],
+                   cv::Point(col * cellSize.width + 10, row * cellSize.height + 30),
                    cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(255, 255, 255), 2);
     }
-    
+
     // Add summary info
     std::string summary = "Motion Detected: " + std::to_string(result.detectedBounds.size()) + 
                          " regions | Has Motion: " + (result.hasMotion ? "YES" : "NO");
-    cv::putText(visualization, summary, cv::Point(10, visualization.rows - 20),
+    cv::putText(visualizationCanvas, summary, cv::Point(10, visualizationCanvas.rows - 20),
                cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(0, 255, 0), 2);
     
-    return visualization;
+    return visualizationCanvas;
 }
 
 void MotionProcessor::drawMotionBoxes(cv::Mat& image, const std::vector<cv::Rect>& detectedBounds) const {
@@ -331,619 +668,2291 @@ void MotionProcessor::drawMotionBoxes(cv::Mat& image, const std::vector<cv::Rect
 // ============================================================================
 
 /**
- * Prepares the input frame for motion detection by:
- * 1. Converting to appropriate color space (usually grayscale)
- * 2. Optionally enhancing contrast using CLAHE
- * 3. Applying blur to reduce noise
- * 
- * Each step is configurable via the config file:
- * - processingMode: Color space conversion
- * - contrastEnhancement: Whether to use CLAHE
- * - blurType: Type of blur (gaussian/median/bilateral)
+ * Steps 1-3 of processFrame() on the host: preprocess the (scaled) ROI crop, difference
+ * and threshold it, and clean the mask up. Returns false on the first frame, which only
+ * becomes the reference.
  */
-cv::Mat MotionProcessor::preprocessFrame(const cv::Mat& frame) {
-    cv::Mat processedFrame;
+bool MotionProcessor::runHostStages(const cv::Mat& roiFrame, FrameBuffers& buffers,
+                                    ProcessingResult& result) {
+    // Step 1: Preprocess the frame
+    // Convert to grayscale, apply blur for noise reduction,
+    // and optionally enhance contrast
+    // (on the downscaled crop when detection_scale < 1)
+    {
+        STAGE_TIMER(stageTimings, PipelineStage::PREPROCESS);
+        preprocessInto(scaleForDetection(roiFrame, buffers.scaled), buffers.processed);
+    }
+    if (retainsStage(STAGE_PROCESSED)) {
+        result.processedFrame = buffers.processed;
+    }
     
-    // Step 1: Color Space Conversion
-    // Usually convert to grayscale for motion detection
-    // RGB mode is available for color-based detection
-    if (processingMode == "grayscale") {
-        cv::cvtColor(frame, processedFrame, cv::COLOR_BGR2GRAY);
-    } else if (processingMode == "rgb") {
-        processedFrame = frame.clone();
-    } else {
-        cv::cvtColor(frame, processedFrame, cv::COLOR_BGR2GRAY);
+    // Special handling for the first frame:
+    // Just store it as reference and wait for next frame
+    if (firstFrame) {
+        storePrevFrame(buffers.processed);
+        firstFrame = false;
+        return false;
     }
     
-    // Step 2: Contrast Enhancement (optional)
-    // Uses CLAHE (Contrast Limited Adaptive Histogram Equalization)
-    // Helps with:
-    // - Low contrast scenes
-    // - Varying lighting conditions
-    // - Shadow regions
-    if (contrastEnhancement) {
-        cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE(claheClipLimit, cv::Size(claheTileSize, claheTileSize));
-        clahe->apply(processedFrame, processedFrame);
+    // Step 2: Detect motion
+    // Either using frame differencing (comparing to previous frame)
+    // or background subtraction (comparing to learned background)
+    // Returns a binary mask where white pixels indicate motion
+    // (packed_masks: as bits in packedThresh, when the fused threshold ran)
+    packedMaskFrame = packedMasksApply();
+    detectMotionInto(buffers.processed, buffers.frameDiff, buffers.thresh, roiExcludedMask);
+    if (retainsStage(STAGE_FRAME_DIFF)) result.frameDiff = buffers.frameDiff;
+    if (retainsStage(STAGE_THRESH)) result.thresh = buffers.thresh;
+    
+    // Step 2b (flood_guard): a mask lit up by a camera shift is recomputed against the
+    // shifted reference; one lit up by anything else global ends the frame here
+    if (floodGuard) {
+        STAGE_TIMER(stageTimings, PipelineStage::FLOOD_GUARD);
+        result.flood = guardAgainstFlood(buffers.processed, buffers, result);
+    }
+    if (result.flood != FloodKind::NONE) {
+        return true;
     }
     
-    // Step 3: Noise Reduction
-    // Three blur options:
-    // - Gaussian: General purpose, balanced blur
-    // - Median: Better for salt-and-pepper noise
-    // - Bilateral: Edge-preserving blur
-    if (blurType == "gaussian") {
-        cv::GaussianBlur(processedFrame, processedFrame, cv::Size(gaussianBlurSize, gaussianBlurSize), 0);
-    } else if (blurType == "median") {
-        cv::medianBlur(processedFrame, processedFrame, medianBlurSize);
-    } else if (blurType == "bilateral") {
-        // Bilateral filter requires 8-bit input
-        cv::Mat bilateralInput;
-        if (processedFrame.type() != CV_8UC1) {
-            processedFrame.convertTo(bilateralInput, CV_8UC1);
+    // Step 3: Clean up the motion mask
+    // Uses morphological operations to:
+    // - Fill small holes (close)
+    // - Remove noise (open)
+    // - Connect nearby regions (dilate)
+    // - Shrink expanded regions (erode)
+    {
+        STAGE_TIMER(stageTimings, PipelineStage::MORPHOLOGY);
+        if (packedMaskFrame) {
+            if (morphology) {
+                morphChain.applyPacked(packedThresh, packedMorphological, packedScratch);
+            } else {
+                packedMorphological = packedThresh;
+            }
         } else {
-            bilateralInput = processedFrame;
+            applyMorphologicalOpsInto(buffers.thresh, buffers.morphological);
         }
-        cv::bilateralFilter(bilateralInput, processedFrame, bilateralD, bilateralSigmaColor, bilateralSigmaSpace);
     }
-    
-    return processedFrame;
+    if (retainsStage(STAGE_MORPHOLOGICAL)) result.morphological = buffers.morphological;
+    return true;
+}
+
+bool MotionProcessor::packedMasksApply() const {
+    return packedMasks && !floodGuard && hysteresisLowRatio <= 0.0 && !motionHistory.getConfig().enabled &&
+           !retainsStage(STAGE_THRESH) && !retainsStage(STAGE_MORPHOLOGICAL);
 }
 
 /**
- * Detects motion by comparing the current frame with either:
- * 1. The previous frame (frame differencing)
- * 2. A learned background model (background subtraction)
- * 
- * The comparison produces a binary mask where white pixels indicate motion.
- * Uses Otsu's method for automatic threshold selection.
+ * Steps 1-3 of processFrame() on predictionWindows (roi_prediction). The frame starts as a
+ * copy of the reference and only the windows (plus the blur radius they read) are
+ * preprocessed into it, so it can become the next reference like a whole frame. Each
+ * window's difference to the references (THREE_FRAME: the smaller one) and to the
+ * background image of the last full scan (the larger one) is thresholded at the last full
+ * scan's level, and the chain runs on the window plus its radius. The windows are handed
+ * to region extraction like tile occupancy's, so only they are labelled or traced.
  */
-cv::Mat MotionProcessor::detectMotion(const cv::Mat& processedFrame, cv::Mat& frameDiff, cv::Mat& thresh) {
-    // Initialize background subtractor if needed
-    if (backgroundSubtraction && bgSubtractor.empty()) {
-        initializeBackgroundSubtractor();
+bool MotionProcessor::runPredictedStages(const cv::Mat& roiFrame, FrameBuffers& buffers,
+                                         ProcessingResult& result) {
+    const cv::Mat& reference = previousFrames.at(0);
+    const cv::Mat& olderFrame = olderReference();
+    const cv::Rect bounds(cv::Point(), detectionSize);
+    const auto grown = [&bounds](const cv::Rect& window, int halo) {
+        return cv::Rect(window.x - halo, window.y - halo, window.width + 2 * halo, window.height + 2 * halo) &
+               bounds;
+    };
+    {
+        STAGE_TIMER(stageTimings, PipelineStage::PREPROCESS);
+        const cv::Mat& scaled = scaleForDetection(roiFrame, buffers.scaled);
+        reference.copyTo(buffers.processed);
+        const int halo = blurRadius();
+        for (const cv::Rect& window : predictionWindows) {
+            const cv::Rect input = grown(window, halo);
+            preprocessInto(scaled(input), predictionScratch);
+            predictionScratch(window - input.tl()).copyTo(buffers.processed(window));
+        }
     }
-    
-    // Step 1: Frame Differencing
-    // Compare current frame with previous frame
-    // White pixels show where the frames differ (motion)
-    frameDiff = cv::Mat::zeros(processedFrame.size(), processedFrame.type());
-    if (!prevFrame.empty()) {
-        cv::absdiff(processedFrame, prevFrame, frameDiff);
+    if (retainsStage(STAGE_PROCESSED)) {
+        result.processedFrame = buffers.processed;
     }
-    
-    // Step 2: Background Subtraction (optional)
-    // Compare current frame with learned background model
-    // Better for:
-    // - Slow moving objects
-    // - Removing dynamic backgrounds
-    // - Continuous motion
-    cv::Mat bgMask;
-    if (backgroundSubtraction && !bgSubtractor.empty()) {
-        bgSubtractor->apply(processedFrame, bgMask);
+
+    {
+        STAGE_TIMER(stageTimings, PipelineStage::DIFF);
+        buffers.frameDiff.create(detectionSize, CV_8UC1);
+        buffers.frameDiff.setTo(0);
+        for (const cv::Rect& window : predictionWindows) {
+            const cv::Mat current = buffers.processed(window);
+            cv::Mat diff = buffers.frameDiff(window);
+            cv::absdiff(current, reference(window), diff);
+            if (!olderFrame.empty()) {
+                cv::absdiff(current, olderFrame(window), predictionDiff);
+                cv::min(diff, predictionDiff, diff);
+            }
+            if (!predictionBackground.empty()) {
+                cv::absdiff(current, predictionBackground(window), predictionDiff);
+                cv::max(diff, predictionDiff, diff);
+            }
+        }
     }
-    
-    // Step 3: Combine Detection Methods
-    // If using background subtraction, combine it with frame diff
-    // This helps catch both:
-    // - Sudden movements (frame diff)
-    // - Slow movements (background subtraction)
-    cv::Mat motionMask;
-    if (backgroundSubtraction && !bgSubtractor.empty()) {
-        motionMask = bgMask.clone();
-        cv::Mat combinedMask;
-        cv::bitwise_or(motionMask, frameDiff, combinedMask);
-        motionMask = combinedMask;
-    } else {
-        motionMask = frameDiff.clone();
+    {
+        STAGE_TIMER(stageTimings, PipelineStage::THRESHOLD);
+        buffers.thresh.create(detectionSize, CV_8UC1);
+        buffers.thresh.setTo(0);
+        const int level = std::clamp(lastMotionThreshold, 0, 255);
+        for (const cv::Rect& window : predictionWindows) {
+            cv::Mat thresh = buffers.thresh(window);
+            thresholdMotion(buffers.frameDiff(window), cv::Mat(),
+                            roiExcludedMask.empty() ? cv::Mat() : roiExcludedMask(window), level, maxThreshold,
+                            thresh);
+        }
     }
-    
-    // Step 4: Threshold Selection
-    // Use Otsu's method to automatically find the best threshold
-    // This adapts to varying lighting and motion conditions
-    cv::threshold(motionMask, thresh, 0, maxThreshold, cv::THRESH_BINARY | cv::THRESH_OTSU);
-    
-    return thresh;
+    if (retainsStage(STAGE_FRAME_DIFF)) result.frameDiff = buffers.frameDiff;
+    if (retainsStage(STAGE_THRESH)) result.thresh = buffers.thresh;
+
+    {
+        STAGE_TIMER(stageTimings, PipelineStage::MORPHOLOGY);
+        buffers.morphological.create(detectionSize, CV_8UC1);
+        buffers.morphological.setTo(0);
+        const int halo = morphology ? morphChain.radius() : 0;
+        int64_t windowArea = 0;
+        for (const cv::Rect& window : predictionWindows) {
+            const cv::Rect input = grown(window, halo);
+            morphologyChainInto(buffers.thresh(input), occupancyScratch, morphWorkspace);
+            occupancyScratch(window - input.tl()).copyTo(buffers.morphological(window));
+            windowArea += window.area();
+        }
+        // Extraction visits the windows only (see takeOccupancyWindows)
+        occupancyWindows.assign(predictionWindows.begin(), predictionWindows.end());
+        occupancyMask = buffers.morphological.data;
+        occupancyCoverage = static_cast<double>(windowArea) / bounds.area();
+    }
+    if (retainsStage(STAGE_MORPHOLOGICAL)) result.morphological = buffers.morphological;
+    predictedFrameCount.fetch_add(1, std::memory_order_relaxed);
+    return true;
 }
 
 /**
- * Cleans up the motion mask using morphological operations.
- * Operations are applied in this order:
- * 1. Close - Fills small holes in motion regions
- * 2. Open - Removes small noise blobs
- * 3. Dilate - Expands motion regions to connect nearby areas
- * 4. Erode - Optional shrinking to counter over-expansion
- * 
- * Uses an elliptical kernel for more natural shape preservation.
- * All operations are configurable via the config file.
+ * Step 2b of the host path (flood_guard), on the thresholded mask before morphology. An
+ * ordinary frame costs one countNonZero of the mask. Above floodMotionFraction, the
+ * frame and its reference are shrunk (INTER_AREA) to floodThumbnailWidth columns and
+ * phase-correlated with a Hanning window, which gives their global translation and a
+ * peak response in [0, 1]. A weak peak or a shift below floodMinShift detection pixels is
+ * no shift: ILLUMINATION. Otherwise, with floodCompensateShift and a shift of at most
+ * floodMaxShift, the reference is warped onto the frame and the difference (plus the
+ * background mask, minus exclusions) is thresholded again at the frame's level, leaving
+ * out the strips the shift brought into view. If that brings the mask below the fraction
+ * the frame goes on with the compensated mask; if not, it is a SHAKE.
+ *
+ * The compensated difference is taken against the newest reference only (not THREE_FRAME's
+ * minimum), and a background model that learned the old view keeps its flooded mask.
  */
-cv::Mat MotionProcessor::applyMorphologicalOps(const cv::Mat& thresh) {
-    cv::Mat processed = thresh.clone();
+MotionProcessor::FloodKind MotionProcessor::guardAgainstFlood(const cv::Mat& processed, FrameBuffers& buffers,
+                                                              ProcessingResult& result) {
+    const double floodPixels = floodMotionFraction * static_cast<double>(buffers.thresh.total());
+    if (buffers.thresh.empty() || cv::countNonZero(buffers.thresh) <= floodPixels) {
+        return FloodKind::NONE;
+    }
+    const cv::Mat& reference = previousFrames.at(0);
+    if (reference.empty() || reference.size() != processed.size() || reference.type() != processed.type()) {
+        return FloodKind::ILLUMINATION;  // Background model alone: nothing to correlate with
+    }
     
-    if (morphology) {
-        // Create an elliptical kernel for all operations
-        // Ellipse shape better matches natural motion shapes
-        // Size affects how aggressive each operation is
-        cv::Mat kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(morphKernelSize, morphKernelSize));
-        
-        // Step 1: Close Operation (optional)
-        // Fills small holes within motion regions
-        // Useful for:
-        // - Connecting broken contours
-        // - Filling internal gaps
-        // - Making shapes more solid
-        if (morphClose) {
-            cv::morphologyEx(processed, processed, cv::MORPH_CLOSE, kernel);
-        }
-        
-        // Step 2: Open Operation (optional)
-        // Removes small noise blobs
-        // Useful for:
-        // - Eliminating small false detections
-        // - Smoothing object boundaries
-        // - Removing thin connections
-        if (morphOpen) {
-            cv::morphologyEx(processed, processed, cv::MORPH_OPEN, kernel);
-        }
-        
-        // Step 3: Dilation (optional)
-        // Expands motion regions
-        // Useful for:
-        // - Connecting nearby motion regions
-        // - Compensating for under-detection
-        // - Making objects more visible
-        if (dilation) {
-            cv::dilate(processed, processed, kernel, cv::Point(-1, -1), 1);
+    const double scale = std::min(1.0, static_cast<double>(floodThumbnailWidth) / processed.cols);
+    const cv::Size thumbSize(std::max(8, cvRound(processed.cols * scale)),
+                             std::max(8, cvRound(processed.rows * scale)));
+    auto thumbnail = [&](const cv::Mat& image, cv::Mat& thumb) {
+        cv::resize(image, floodThumbScratch, thumbSize, 0, 0, cv::INTER_AREA);
+        if (floodThumbScratch.channels() > 1) {
+            cv::cvtColor(floodThumbScratch, floodThumbScratch, cv::COLOR_BGR2GRAY);
         }
-        
-        // Step 4: Erosion (optional)
-        // Shrinks motion regions
-        // Useful for:
-        // - Countering over-expansion from dilation
-        // - Separating barely-connected regions
-        // - Reducing false detections
-        if (erosion) {
-            cv::erode(processed, processed, kernel, cv::Point(-1, -1), 1);
+        floodThumbScratch.convertTo(thumb, CV_32F);
+    };
+    thumbnail(processed, floodThumbCurrent);
+    thumbnail(reference, floodThumbReference);
+    if (floodWindow.size() != thumbSize) {
+        cv::createHanningWindow(floodWindow, thumbSize, CV_32F);
+    }
+    double response = 0.0;
+    // How far the frame's content moved from where it was in the reference
+    const cv::Point2d thumbShift = cv::phaseCorrelate(floodThumbReference, floodThumbCurrent, floodWindow, &response);
+    const cv::Point2d shift(thumbShift.x * processed.cols / thumbSize.width,
+                            thumbShift.y * processed.rows / thumbSize.height);
+    result.globalShift = shift;
+    const double magnitude = std::hypot(shift.x, shift.y);
+    if (response < floodMinResponse || magnitude < floodMinShift) {
+        return FloodKind::ILLUMINATION;
+    }
+    if (!floodCompensateShift || magnitude > floodMaxShift) {
+        return FloodKind::SHAKE;
+    }
+    
+    const cv::Mat translation = (cv::Mat_<double>(2, 3) << 1, 0, shift.x, 0, 1, shift.y);
+    cv::warpAffine(reference, floodWarped, translation, reference.size(), cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+    cv::absdiff(processed, floodWarped, colorDiffBuffer);
+    maxOverChannels(colorDiffBuffer, buffers.frameDiff);
+    // Content that entered the view has no counterpart in the reference
+    const int marginX = std::min(buffers.frameDiff.cols, static_cast<int>(std::ceil(std::abs(shift.x))));
+    const int marginY = std::min(buffers.frameDiff.rows, static_cast<int>(std::ceil(std::abs(shift.y))));
+    if (marginX > 0) {
+        buffers.frameDiff.colRange(shift.x > 0 ? cv::Range(0, marginX)
+                                               : cv::Range(buffers.frameDiff.cols - marginX, buffers.frameDiff.cols))
+            .setTo(cv::Scalar::all(0));
+    }
+    if (marginY > 0) {
+        buffers.frameDiff.rowRange(shift.y > 0 ? cv::Range(0, marginY)
+                                               : cv::Range(buffers.frameDiff.rows - marginY, buffers.frameDiff.rows))
+            .setTo(cv::Scalar::all(0));
+    }
+    cv::Mat* motionMask = &buffers.frameDiff;
+    if (backgroundSubtraction && !bgSubtractor.empty() && bgMaskBuffer.size() == buffers.frameDiff.size()) {
+        cv::bitwise_or(bgMaskBuffer, buffers.frameDiff, motionMaskBuffer);
+        motionMask = &motionMaskBuffer;
+    }
+    if (!roiExcludedMask.empty()) {
+        motionMask->setTo(cv::Scalar::all(0), roiExcludedMask);
+    }
+    cv::threshold(*motionMask, buffers.thresh, lastMotionThreshold, maxThreshold, cv::THRESH_BINARY);
+    if (cv::countNonZero(buffers.thresh) > floodPixels) {
+        return FloodKind::SHAKE;
+    }
+    result.shiftCompensated = true;
+    ++shiftCompensatedFrameCount;
+    return FloodKind::NONE;
+}
+
+/**
+ * Steps 1-3 of processFrame() for detection_method "block": the luma of the crop at the
+ * detection size, one SAD pass against the block background (which learns in the same
+ * pass), and the threshold on the block grid, whose blocks under the exclusion mask are
+ * dropped. The first frame, or one of a new size, only seeds the background.
+ *
+ * Retained stages: processedFrame is the luma image; frameDiff (the per-block mean
+ * difference) and thresh (the moving blocks) are grid-sized.
+ */
+bool MotionProcessor::runBlockStages(const cv::Mat& roiFrame, FrameBuffers& buffers,
+                                     ProcessingResult& result) {
+    cv::Mat gray;
+    {
+        STAGE_TIMER(stageTimings, PipelineStage::PREPROCESS);
+        const cv::Mat& scaled = scaleForDetection(roiFrame, buffers.scaled);
+        if (scaled.channels() == 1) {
+            gray = scaled;  // Luma input: no conversion
+        } else {
+            cv::cvtColor(scaled, buffers.processed, cv::COLOR_BGR2GRAY);
+            gray = buffers.processed;
+        }
+    }
+    if (retainsStage(STAGE_PROCESSED)) result.processedFrame = gray;
+    
+    bool measured = false;
+    {
+        STAGE_TIMER(stageTimings, PipelineStage::DIFF);
+        measured = blockMotion->apply(gray);
+    }
+    if (!measured) {
+        firstFrame = false;
+        return false;
+    }
+    
+    {
+        STAGE_TIMER(stageTimings, PipelineStage::THRESHOLD);
+        const cv::Mat& map = blockMotion->map();
+        cv::compare(map, blockThreshold, blockGrid, cv::CMP_GT);
+        if (!roiExcludedMask.empty()) {
+            // A block counts as excluded when at least half of its pixels are
+            if (blockExcluded.size() != map.size()) {
+                cv::resize(roiExcludedMask, blockExcluded, map.size(), 0, 0, cv::INTER_AREA);
+                cv::threshold(blockExcluded, blockExcluded, 127, 255, cv::THRESH_BINARY);
+            }
+            blockGrid.setTo(cv::Scalar(0), blockExcluded);
+        }
+        lastMotionThreshold = blockThreshold;
+    }
+    // The grids are tiny; copies keep them valid after the next frame
+    if (retainsStage(STAGE_FRAME_DIFF)) result.frameDiff = blockMotion->map().clone();
+    if (retainsStage(STAGE_THRESH)) result.thresh = blockGrid.clone();
+    return true;
+}
+
+/**
+ * Steps 1-3 of processFrame() on the OpenCL device (OpenCV's T-API). The crop is uploaded
+ * once; scaling, color reduction, CLAHE, blur, the background model, differencing,
+ * exclusion, thresholding and morphology run on cv::UMat, and only the cleaned binary
+ * mask is downloaded for region extraction (other stages only when retained). The
+ * reference frame stays on the device.
+ *
+ * Differences from the host path: tile_bands and morph_approximate do not apply (the
+ * device runs the exact chain), OTSU's value comes from cv::threshold (computed on the
+ * host, OpenCV has no OpenCL Otsu kernel; the mask is mapped, not copied, on shared-memory
+ * GPUs), and CACHED reuses it for otsuUpdateInterval frames without the drift check.
+ */
+bool MotionProcessor::runDeviceStages(const cv::Mat& roiFrame, FrameBuffers& buffers,
+                                      ProcessingResult& result) {
+    DeviceBuffers& device = deviceBuffers;
+    
+    // Step 1: Preprocess
+    {
+        STAGE_TIMER(stageTimings, PipelineStage::PREPROCESS);
+        roiFrame.copyTo(device.input);  // The frame's only upload
+        if (detectionSize != roiRect.size()) {
+            cv::resize(device.input, device.scaled, detectionSize, 0, 0, cv::INTER_AREA);
+            preprocessOnDevice(device.scaled, device.processed);
+        } else {
+            preprocessOnDevice(device.input, device.processed);
+        }
+    }
+    if (retainsStage(STAGE_PROCESSED)) {
+        device.processed.copyTo(buffers.processed);
+        result.processedFrame = buffers.processed;
+    }
+    
+    // A reference from warmUp() or the host path is uploaded once
+    const cv::Mat& hostPrevious = previousFrames.newest();
+    if (device.previous.empty() && !hostPrevious.empty() && hostPrevious.size() == device.processed.size()) {
+        hostPrevious.copyTo(device.previous);
+    }
+    const auto storeReference = [this, &device]() {
+        // Rotates older <- previous <- processed; the oldest buffer takes the next frame
+        if (differencingMode == DifferencingMode::THREE_FRAME) {
+            std::swap(device.older, device.previous);
+        }
+        std::swap(device.previous, device.processed);
+        if (motionGate) {
+            std::swap(gateReference, gateSample);
+        }
+    };
+    if (firstFrame || device.previous.empty()) {
+        storeReference();
+        firstFrame = false;
+        return false;
+    }
+    
+    // Step 2: Detect motion
+    if (backgroundSubtraction && bgSubtractor.empty()) {
+        cv::Mat firstProcessed;  // One download, to compare a snapshot with the scene
+        device.processed.copyTo(firstProcessed);
+        initializeBackgroundSubtractor(firstProcessed);
+    }
+    const bool useBackgroundModel = backgroundSubtraction && !bgSubtractor.empty();
+    if (useBackgroundModel && backgroundUpdateDue(device.processed.size(), device.backgroundMask.size())) {
+        STAGE_TIMER(stageTimings, PipelineStage::BACKGROUND);
+        applyBackgroundModel(device.processed, device.backgroundMask, backgroundLearningRate);
+    }
+    
+    cv::UMat* motionMask = &device.frameDiff;
+    {
+        STAGE_TIMER(stageTimings, PipelineStage::DIFF);
+        cv::absdiff(device.processed, device.previous, device.colorDiff);
+        maxOverChannels(device.colorDiff, device.frameDiff, device.planes);
+        if (differencingMode == DifferencingMode::THREE_FRAME && device.older.size() == device.processed.size()) {
+            cv::absdiff(device.processed, device.older, device.colorDiff);
+            maxOverChannels(device.colorDiff, device.olderDiff, device.planes);
+            cv::min(device.frameDiff, device.olderDiff, device.frameDiff);
+        }
+        if (retainsStage(STAGE_FRAME_DIFF)) {
+            device.frameDiff.copyTo(buffers.frameDiff);
+            result.frameDiff = buffers.frameDiff;
+        }
+        if (useBackgroundModel) {
+            cv::bitwise_or(device.backgroundMask, device.frameDiff, device.motionMask);
+            motionMask = &device.motionMask;
+        }
+        if (!roiExcludedMask.empty()) {
+            if (device.excludedMask.empty()) {
+                roiExcludedMask.copyTo(device.excludedMask);  // Once per ROI geometry
+            }
+            motionMask->setTo(cv::Scalar::all(0), device.excludedMask);
+        }
+    }
+    
+    {
+        STAGE_TIMER(stageTimings, PipelineStage::THRESHOLD);
+        if (thresholdMode == ThresholdMode::CACHED && cachedMotionThreshold >= 0 &&
+            framesSinceThresholdUpdate < otsuUpdateInterval) {
+            ++framesSinceThresholdUpdate;
+            lastMotionThreshold = std::max(cachedMotionThreshold, minMotionThreshold);
+            cv::threshold(*motionMask, device.thresh, lastMotionThreshold, maxThreshold, cv::THRESH_BINARY);
+        } else {
+            cachedMotionThreshold = static_cast<int>(cv::threshold(
+                *motionMask, device.thresh, 0, maxThreshold, cv::THRESH_BINARY | cv::THRESH_OTSU));
+            framesSinceThresholdUpdate = 0;
+            lastMotionThreshold = std::max(cachedMotionThreshold, minMotionThreshold);
+            if (lastMotionThreshold != cachedMotionThreshold) {
+                cv::threshold(*motionMask, device.thresh, lastMotionThreshold, maxThreshold, cv::THRESH_BINARY);
+            }
+        }
+    }
+    if (retainsStage(STAGE_THRESH)) {
+        device.thresh.copyTo(buffers.thresh);
+        result.thresh = buffers.thresh;
+    }
+    
+    // Step 3: Clean up the motion mask (the planned steps, one kernel application each)
+    {
+        STAGE_TIMER(stageTimings, PipelineStage::MORPHOLOGY);
+        const cv::UMat* mask = &device.thresh;
+        if (morphology) {
+            for (const MorphologyChain::Operation operation : morphSteps) {
+                cv::UMat& output = mask == &device.morphPing ? device.morphPong : device.morphPing;
+                if (operation == MorphologyChain::Operation::ERODE) {
+                    cv::erode(*mask, output, morphKernel);
+                } else {
+                    cv::dilate(*mask, output, morphKernel);
+                }
+                mask = &output;
+            }
+        }
+        mask->copyTo(buffers.morphological);  // The download the detections need
+    }
+    if (retainsStage(STAGE_MORPHOLOGICAL)) result.morphological = buffers.morphological;
+    
+    storeReference();
+    return true;
+}
+
+/**
+ * preprocessInto() on the device: the same single-channel reduction, CLAHE and blur,
+ * ping-ponging through deviceBuffers.blurInput (OpenCL filters do not run in place).
+ */
+void MotionProcessor::preprocessOnDevice(const cv::UMat& frame, cv::UMat& processedFrame) {
+    DeviceBuffers& device = deviceBuffers;
+    if (frame.channels() == 1) {
+        frame.copyTo(processedFrame);
+    } else {
+        switch (processingMode) {
+            case ProcessingMode::RGB:
+                frame.copyTo(processedFrame);
+                break;
+            case ProcessingMode::HSV:
+                maxOverChannels(frame, processedFrame, device.planes);
+                break;
+            case ProcessingMode::GRAYSCALE:
+            case ProcessingMode::YCRCB:
+                cv::cvtColor(frame, processedFrame, cv::COLOR_BGR2GRAY);
+                break;
+        }
+    }
+    
+    if (contrastEnhancement && processedFrame.channels() == 1) {
+        STAGE_TIMER(stageTimings, PipelineStage::CLAHE);
+        clahe->apply(processedFrame, device.blurInput);
+        std::swap(processedFrame, device.blurInput);
+    }
+    
+    if (blurType == BlurType::NONE) {
+        return;
+    }
+    STAGE_TIMER(stageTimings, PipelineStage::BLUR);
+    if (edgePreservingBlur() && processedFrame.type() != CV_8UC1) {
+        processedFrame.convertTo(device.blurInput, CV_8UC1);
+    } else {
+        std::swap(processedFrame, device.blurInput);
+    }
+    blurInto(device.blurInput, processedFrame);
+}
+
+/**
+ * Prepares the input frame for motion detection by:
+ * 1. Converting to appropriate color space (usually grayscale)
+ * 2. Optionally enhancing contrast using CLAHE
+ * 3. Applying blur to reduce noise
+ * 
+ * Each step is configurable via the config file:
+ * - processingMode: Color space conversion
+ * - contrastEnhancement: Whether to use CLAHE
+ * - blurType: Type of blur (gaussian/median/bilateral/guided/domain_transform/stack)
+ */
+cv::Mat MotionProcessor::preprocessFrame(const cv::Mat& frame) {
+    cv::Mat processedFrame;
+    preprocessInto(frame, processedFrame);
+    return processedFrame;
+}
+
+/**
+ * Turns a raw camera frame into the image processFrame works on.
+ * - BGR input is returned as is
+ * - NV12 (CV_8UC1, Y plane followed by interleaved UV at half height): the Y plane
+ *   is returned as a view for the luma modes, otherwise the frame is converted to BGR
+ * - YUYV (CV_8UC2): Y is extracted in one pass for the luma modes, otherwise the
+ *   frame is converted to BGR
+ * Returns an empty Mat (and logs) when the frame does not match the input format.
+ */
+cv::Mat MotionProcessor::decodeInput(const cv::Mat& frame, cv::Mat& buffer) const {
+    const bool lumaOnly =
+        processingMode == ProcessingMode::GRAYSCALE || processingMode == ProcessingMode::YCRCB;
+    switch (inputFormat) {
+        case InputFormat::NV12:
+            if (frame.type() != CV_8UC1 || frame.rows % 3 != 0) {
+                LOG_ERROR("NV12 input must be CV_8UC1 with height * 3 / 2 rows, got {}x{} type {}",
+                          frame.cols, frame.rows, frame.type());
+                return cv::Mat();
+            }
+            if (lumaOnly) {
+                return frame.rowRange(0, frame.rows * 2 / 3);
+            }
+            cv::cvtColor(frame, buffer, cv::COLOR_YUV2BGR_NV12);
+            return buffer;
+        case InputFormat::YUYV:
+            if (frame.type() != CV_8UC2) {
+                LOG_ERROR("YUYV input must be CV_8UC2, got type {}", frame.type());
+                return cv::Mat();
+            }
+            if (lumaOnly) {
+                cv::extractChannel(frame, buffer, 0);
+            } else {
+                cv::cvtColor(frame, buffer, cv::COLOR_YUV2BGR_YUYV);
+            }
+            return buffer;
+        case InputFormat::BGR:
+            break;
+    }
+    return frame;
+}
+
+void MotionProcessor::preprocessInto(const cv::Mat& frame, cv::Mat& processedFrame) {
+    // Stack blur on a BGR frame whose luma goes straight to the blur: one fused pass reads
+    // the colour frame once and writes only the blurred luma
+    if (blurType == BlurType::STACK && frame.type() == CV_8UC3 && !contrastEnhancement &&
+        (processingMode == ProcessingMode::GRAYSCALE || processingMode == ProcessingMode::YCRCB)) {
+        STAGE_TIMER(stageTimings, PipelineStage::BLUR);
+        stackBlurInto(frame, processedFrame, true);
+        return;
+    }
+
+    // Step 1: Color Space Conversion
+    // Motion detection only needs one channel, so each mode extracts just
+    // that channel instead of converting the whole color space:
+    // - grayscale / ycrcb: luma (Y of YCrCb is the BT.601 luma BGR2GRAY computes)
+    // - hsv: value (V of HSV is the per-pixel maximum of B, G and R)
+    // - rgb: all three channels (diffed per channel, see detectMotionInto)
+    // Single-channel input (luma from a YUV camera buffer, gray video) is used as is
+    if (frame.channels() == 1) {
+        frame.copyTo(processedFrame);
+    } else {
+        switch (processingMode) {
+            case ProcessingMode::RGB:
+                frame.copyTo(processedFrame);
+                break;
+            case ProcessingMode::HSV:
+                maxOverChannels(frame, processedFrame);
+                break;
+            case ProcessingMode::GRAYSCALE:
+            case ProcessingMode::YCRCB:
+                cv::cvtColor(frame, processedFrame, cv::COLOR_BGR2GRAY);
+                break;
+        }
+    }
+    
+    // Step 2: Contrast Enhancement (optional)
+    // Uses CLAHE (Contrast Limited Adaptive Histogram Equalization)
+    // Helps with:
+    // - Low contrast scenes
+    // - Varying lighting conditions
+    // - Shadow regions
+    // The CLAHE object is built once per config (see rebuildCachedResources)
+    // CLAHE only works on single-channel images, so rgb mode skips it
+    // Cached mode reuses the tile tables and only interpolates through them per frame
+    if (contrastEnhancement && processedFrame.channels() == 1) {
+        STAGE_TIMER(stageTimings, PipelineStage::CLAHE);
+        if (claheMode == ClaheMode::CACHED) {
+            if (cachedClahe.apply(processedFrame, processedFrame)) {
+                LOG_DEBUG_LIMITED("CLAHE tile tables refitted ({} fits)", cachedClahe.fitCount());
+            }
+        } else {
+            clahe->apply(processedFrame, processedFrame);
+        }
+    }
+    
+    // Step 3: Noise Reduction
+    // Blur options:
+    // - Gaussian: General purpose, balanced blur
+    // - Median: Better for salt-and-pepper noise
+    // - Bilateral: Edge-preserving blur
+    // - Guided / domain transform: edge-preserving like bilateral, at a fraction of its cost
+    // - Stack: integer triangle blur close to Gaussian, cost independent of the kernel size
+    if (blurType == BlurType::NONE) {
+        return;
+    }
+    STAGE_TIMER(stageTimings, PipelineStage::BLUR);
+    if (blurType == BlurType::STACK) {
+        // Bands must not read rows another band already blurred
+        if (tileBands > 1) {
+            processedFrame.copyTo(blurInputBuffer);
+            stackBlurInto(blurInputBuffer, processedFrame, false);
+        } else {
+            stackBlurInto(processedFrame, processedFrame, false);
+        }
+        return;
+    }
+    // The guided filter's running box sums and the domain transform's recursion depend on
+    // where they start, so bands could not reproduce the whole-frame result: those run untiled
+    const bool banded = tileBands > 1 && blurType != BlurType::GUIDED && blurType != BlurType::DOMAIN_TRANSFORM;
+    if (blurType == BlurType::BILATERAL || banded || (edgePreservingBlur() && processedFrame.depth() != CV_8U)) {
+        // Edge-preserving filters require 8-bit input, bilateral cannot run in place, and
+        // bands must not read rows another band already blurred, so the source goes
+        // through a persistent scratch buffer
+        if (edgePreservingBlur() && processedFrame.type() != CV_8UC1) {
+            processedFrame.convertTo(blurInputBuffer, CV_8UC1);
+        } else {
+            processedFrame.copyTo(blurInputBuffer);
+        }
+        if (banded) {
+            // Tiled: bands (plus blur-radius halos) are blurred in parallel
+            processedFrame.create(blurInputBuffer.size(), blurInputBuffer.type());
+            if (bandGaussianWorkspaces.size() < static_cast<size_t>(tileBands)) bandGaussianWorkspaces.resize(tileBands);
+            forEachBand(blurInputBuffer, processedFrame, tileBands, blurRadius(), bandScratch,
+                        [this](int band, const cv::Mat& input, cv::Mat& output) { blurInto(input, output, band); });
+        } else {
+            blurInto(blurInputBuffer, processedFrame);
+        }
+    } else {
+        blurInto(processedFrame, processedFrame);
+    }
+}
+
+void MotionProcessor::stackBlurInto(const cv::Mat& input, cv::Mat& output, bool luma) {
+    if (tileBands <= 1) {
+        stackBlur.apply(input, output, stackBlurWorkspace, luma);
+        return;
+    }
+    // The sums are exact integers, so bands plus radius halos match the whole frame
+    if (bandStackBlurWorkspaces.size() < static_cast<size_t>(tileBands)) bandStackBlurWorkspaces.resize(tileBands);
+    output.create(input.size(), luma && input.channels() == 3 ? CV_8UC1 : input.type());
+    forEachBand(input, output, tileBands, stackBlur.radius(), bandScratch,
+                [this, luma](int band, const cv::Mat& in, cv::Mat& out) {
+                    stackBlur.apply(in, out, bandStackBlurWorkspaces[band], luma);
+                });
+}
+
+void MotionProcessor::blurInto(cv::InputArray input, cv::OutputArray output, int band) const {
+    switch (blurType) {
+        case BlurType::STACK:
+            if (output.isMat()) {
+                stackBlur.apply(input.getMat(), output.getMatRef(), stackBlurWorkspace);
+                break;
+            }
+            // Device frames: OpenCL's GaussianBlur of the configured size is the faster choice there
+            [[fallthrough]];
+        case BlurType::GAUSSIAN:
+            // Host frames of a common kernel size: the unrolled instance planned for it
+            if (output.isMat() && fixedGaussian.apply(input.getMat(), output.getMatRef(),
+                                                      band < 0 ? gaussianWorkspace : bandGaussianWorkspaces[band])) {
+                break;
+            }
+            cv::GaussianBlur(input, output, cv::Size(gaussianBlurSize, gaussianBlurSize), 0);
+            break;
+        case BlurType::MEDIAN:
+            cv::medianBlur(input, output, medianBlurSize);
+            break;
+        case BlurType::BILATERAL:
+            cv::bilateralFilter(input, output, bilateralD, bilateralSigmaColor, bilateralSigmaSpace);
+            break;
+        case BlurType::GUIDED:
+        case BlurType::DOMAIN_TRANSFORM:
+            edgeFilter.apply(input, output, edgeFilterWorkspace);
+            break;
+        case BlurType::NONE:
+            input.copyTo(output);
+            break;
+    }
+}
+
+int MotionProcessor::bilateralRadius() const {
+    return bilateralD > 0 ? bilateralD / 2 : cvRound(bilateralSigmaSpace * 1.5);
+}
+
+// Rows either side of an output row that the configured blur reads
+int MotionProcessor::blurRadius() const {
+    switch (blurType) {
+        case BlurType::GAUSSIAN: return gaussianBlurSize / 2;
+        case BlurType::STACK: return stackBlur.radius();
+        case BlurType::MEDIAN: return medianBlurSize / 2;
+        case BlurType::BILATERAL: return bilateralRadius();
+        // Guided: a pixel's coefficients average boxes that reach a radius further
+        case BlurType::GUIDED: return 2 * edgeFilter.radius() + edgeFilter.subsample();
+        // Recursive: every row of the frame; it is never banded (see preprocessInto)
+        case BlurType::DOMAIN_TRANSFORM: return edgeFilter.radius();
+        case BlurType::NONE: break;
+    }
+    return 0;
+}
+
+/**
+ * Detects motion by comparing the current frame with either:
+ * 1. The previous frame (frame differencing)
+ * 2. A learned background model (background subtraction)
+ * 
+ * The comparison produces a binary mask where white pixels indicate motion.
+ * Uses Otsu's method for automatic threshold selection.
+ */
+cv::Mat MotionProcessor::detectMotion(const cv::Mat& processedFrame, cv::Mat& frameDiff, cv::Mat& thresh) {
+    detectMotionInto(processedFrame, frameDiff, thresh);
+    return thresh;
+}
+
+void MotionProcessor::detectMotionInto(const cv::Mat& processedFrame, cv::Mat& frameDiff, cv::Mat& thresh,
+                                       const cv::Mat& excludedMask) {
+    // Initialize background subtractor if needed
+    if (backgroundSubtraction && bgSubtractor.empty()) {
+        initializeBackgroundSubtractor(processedFrame);
+    }
+    
+    // Step 1: Background Subtraction (optional)
+    // Compare current frame with learned background model
+    // Better for:
+    // - Slow moving objects
+    // - Removing dynamic backgrounds
+    // - Continuous motion
+    const bool useBackgroundModel = backgroundSubtraction && !bgSubtractor.empty();
+    if (useBackgroundModel && backgroundUpdateDue(processedFrame.size(), bgMaskBuffer.size())) {
+        STAGE_TIMER(stageTimings, PipelineStage::BACKGROUND);
+        applyBackgroundModel(processedFrame, bgMaskBuffer, backgroundLearningRate);
+    }
+    const cv::Mat noMask;
+    const cv::Mat& backgroundMask = useBackgroundModel ? bgMaskBuffer : noMask;
+    
+    // Fused fast path for single-channel frames (every mode except rgb):
+    // Pass 1 writes |current - previous| and builds the Otsu histogram of the
+    // combined (diff | background, exclusions zeroed) mask; pass 2 combines and
+    // thresholds. Same result as Steps 2-5 below in two passes instead of five.
+    const cv::Mat& prevFrame = previousFrames.at(0);
+    const cv::Mat& olderFrame = olderReference();
+    if (processedFrame.type() == CV_8UC1 && !prevFrame.empty()) {
+        {
+            STAGE_TIMER(stageTimings, PipelineStage::DIFF);
+            lastMotionThreshold = selectMotionThreshold(processedFrame, backgroundMask, excludedMask, frameDiff);
+        }
+        STAGE_TIMER(stageTimings, PipelineStage::THRESHOLD);
+        if (packedMaskFrame) {
+            // 1 bit per pixel from here to the labeler (the byte mask is not written)
+            thresholdMotionPacked(frameDiff, backgroundMask, excludedMask, lastMotionThreshold, packedThresh);
+            return;
+        }
+        if (tileBands > 1) {
+            thresh.create(frameDiff.size(), CV_8UC1);
+            parallelBands(bandRanges(frameDiff.rows, tileBands), [&](int, const cv::Range& rows) {
+                cv::Mat band = thresh.rowRange(rows);
+                thresholdMotion(frameDiff.rowRange(rows), bandOf(backgroundMask, rows),
+                                bandOf(excludedMask, rows), lastMotionThreshold, maxThreshold, band);
+            });
+        } else {
+            thresholdMotion(frameDiff, backgroundMask, excludedMask, lastMotionThreshold, maxThreshold, thresh);
+        }
+        applyHysteresis(frameDiff, backgroundMask, excludedMask, thresh);
+        return;
+    }
+    
+    packedMaskFrame = false;  // Multi-channel or first difference: byte masks
+
+    // Step 2: Frame Differencing
+    // Compare current frame with previous frame
+    // White pixels show where the frames differ (motion)
+    // create() is a no-op when frameDiff already has the right size and type
+    // Multi-channel (rgb) differences are reduced to their per-pixel maximum,
+    // because background subtraction and Otsu's threshold need one channel
+    // THREE_FRAME keeps the smaller of the differences to the last two frames
+    if (!prevFrame.empty()) {
+        STAGE_TIMER(stageTimings, PipelineStage::DIFF);
+        cv::absdiff(processedFrame, prevFrame, colorDiffBuffer);
+        maxOverChannels(colorDiffBuffer, frameDiff);
+        if (!olderFrame.empty()) {
+            cv::absdiff(processedFrame, olderFrame, colorDiffBuffer);
+            maxOverChannels(colorDiffBuffer, olderDiffBuffer);
+            cv::min(frameDiff, olderDiffBuffer, frameDiff);
+        }
+    } else {
+        frameDiff.create(processedFrame.size(), CV_MAKETYPE(processedFrame.depth(), 1));
+        frameDiff.setTo(cv::Scalar::all(0));
+    }
+    
+    // Step 3: Combine Detection Methods
+    // If using background subtraction, combine it with frame diff
+    // This helps catch both:
+    // - Sudden movements (frame diff)
+    // - Slow movements (background subtraction)
+    // Without a background model the diff is thresholded directly (no copy)
+    cv::Mat* motionMask = &frameDiff;
+    if (useBackgroundModel) {
+        cv::bitwise_or(bgMaskBuffer, frameDiff, motionMaskBuffer);
+        motionMask = &motionMaskBuffer;
+    }
+    
+    // Step 4: Exclusion Mask (optional)
+    // Zero pixels outside the ROI polygons or inside exclusion zones
+    // (sky, roads, swaying trees) so they can never produce contours
+    if (!excludedMask.empty()) {
+        motionMask->setTo(cv::Scalar::all(0), excludedMask);
+    }
+    
+    // Step 5: Threshold Selection
+    // Use Otsu's method to automatically find the best threshold
+    // This adapts to varying lighting and motion conditions
+    // Below the configured floor a fixed threshold is used instead
+    STAGE_TIMER(stageTimings, PipelineStage::THRESHOLD);
+    lastMotionThreshold = static_cast<int>(
+        cv::threshold(*motionMask, thresh, 0, maxThreshold, cv::THRESH_BINARY | cv::THRESH_OTSU));
+    if (lastMotionThreshold < minMotionThreshold) {
+        lastMotionThreshold = minMotionThreshold;
+        cv::threshold(*motionMask, thresh, minMotionThreshold, maxThreshold, cv::THRESH_BINARY);
+    }
+    // The exclusion mask is already zeroed in the combined mask
+    applyHysteresis(*motionMask, cv::Mat(), cv::Mat(), thresh);
+}
+
+/**
+ * The boxes are in frame coordinates and the motion history in detection coordinates (the
+ * possibly downscaled ROI crop): each box is mapped back onto the history, and the
+ * velocity scaled up to frame pixels.
+ */
+void MotionProcessor::measureMotion(ProcessingResult& result) const {
+    const double scaleX = static_cast<double>(detectionSize.width) / roiRect.width;
+    const double scaleY = static_cast<double>(detectionSize.height) / roiRect.height;
+    result.detectedMotion.clear();
+    result.detectedMotion.reserve(result.detectedBounds.size());
+    for (const cv::Rect& bounds : result.detectedBounds) {
+        const cv::Rect crop = bounds - roiRect.tl();
+        const cv::Point topLeft(cvFloor(crop.x * scaleX), cvFloor(crop.y * scaleY));
+        const cv::Point bottomRight(cvCeil(crop.br().x * scaleX), cvCeil(crop.br().y * scaleY));
+        RegionMotion motion = motionHistory.measure(cv::Rect(topLeft, bottomRight));
+        motion.vx = static_cast<float>(motion.vx / scaleX);
+        motion.vy = static_cast<float>(motion.vy / scaleY);
+        motion.jitter = motionHistory.isJitter(motion);  // The limits are in frame pixels
+        result.detectedMotion.push_back(motion);
+    }
+}
+
+/**
+ * Step 6 (optional): hysteresis. The threshold just applied is the high one: pixels above
+ * it seed a flood over connected pixels above hysteresis_low_ratio of it, so a bird whose
+ * wings differ less than its body stays one component instead of several fragments the
+ * consolidator would have to merge again. Skipped when the ratio is 0 or the low level
+ * would not be below the high one.
+ */
+void MotionProcessor::applyHysteresis(const cv::Mat& diff, const cv::Mat& backgroundMask,
+                                      const cv::Mat& excludedMask, cv::Mat& thresh) {
+    lastHysteresisGrowth = 0;
+    const int low = static_cast<int>(lastMotionThreshold * hysteresisLowRatio);
+    if (hysteresisLowRatio <= 0.0 || low >= lastMotionThreshold || maxThreshold <= 0) return;
+    // Timed as part of the caller's THRESHOLD stage
+    lastHysteresisGrowth = growHysteresis(diff, backgroundMask, excludedMask, low, thresh, hysteresisStack);
+}
+
+/**
+ * Runs pass 1 of the fused motion mask (frame difference + histogram) and picks
+ * the threshold for pass 2.
+ * - OTSU: Otsu's value of the full histogram, every frame
+ * - CACHED: reuse the last Otsu value, counting only every
+ *   kDriftSampleRows-th row for a cheap drift check against the histogram the
+ *   value came from. The value is recomputed every otsuUpdateInterval frames
+ *   (full histogram) or as soon as the drift exceeds otsuDriftLimit (from the
+ *   sampled histogram, which is already a good estimate).
+ * Either way the result is clamped to at least minMotionThreshold.
+ */
+int MotionProcessor::selectMotionThreshold(const cv::Mat& processedFrame, const cv::Mat& backgroundMask,
+                                           const cv::Mat& excludedMask, cv::Mat& frameDiff) {
+    constexpr int kDriftSampleRows = 8;
+    
+    MotionHistogram histogram;
+    int level = 0;
+    if (thresholdMode == ThresholdMode::CACHED && cachedMotionThreshold >= 0 &&
+        framesSinceThresholdUpdate < otsuUpdateInterval) {
+        diffHistogram(processedFrame, backgroundMask, excludedMask, frameDiff, histogram, kDriftSampleRows);
+        const double drift = histogramDrift(histogram, thresholdReferenceHistogram);
+        if (drift <= otsuDriftLimit) {
+            ++framesSinceThresholdUpdate;
+            return std::max(cachedMotionThreshold, minMotionThreshold);
+        }
+        LOG_DEBUG("Motion histogram drift {:.3f} > {:.3f}; recomputing threshold", drift, otsuDriftLimit);
+        level = otsuThreshold(histogram);
+    } else {
+        diffHistogram(processedFrame, backgroundMask, excludedMask, frameDiff, histogram, 1);
+        level = otsuThreshold(histogram);
+    }
+    
+    cachedMotionThreshold = level;
+    framesSinceThresholdUpdate = 0;
+    thresholdReferenceHistogram = histogram;
+    return std::max(level, minMotionThreshold);
+}
+
+/**
+ * Pass 1 of the fused motion mask against the previous frame, and in THREE_FRAME
+ * mode the one before it (see absDiffHistogram).
+ * Tiled, every band writes its rows of frameDiff and counts its own histogram;
+ * the sum is the untiled histogram because band boundaries are row-aligned.
+ */
+void MotionProcessor::diffHistogram(const cv::Mat& processedFrame, const cv::Mat& backgroundMask,
+                                    const cv::Mat& excludedMask, cv::Mat& frameDiff,
+                                    MotionHistogram& histogram, int histogramRowStep) {
+    const cv::Mat& prevFrame = previousFrames.at(0);
+    const cv::Mat& olderFrame = olderReference();
+    if (tileBands <= 1) {
+        absDiffHistogram(processedFrame, prevFrame, olderFrame, backgroundMask, excludedMask, frameDiff,
+                         histogram, histogramRowStep);
+        return;
+    }
+    
+    frameDiff.create(processedFrame.size(), CV_8UC1);
+    const std::vector<cv::Range> ranges = bandRanges(processedFrame.rows, tileBands);
+    bandHistograms.resize(ranges.size());
+    parallelBands(ranges, [&](int band, const cv::Range& rows) {
+        cv::Mat diffBand = frameDiff.rowRange(rows);
+        absDiffHistogram(processedFrame.rowRange(rows), prevFrame.rowRange(rows), bandOf(olderFrame, rows),
+                         bandOf(backgroundMask, rows), bandOf(excludedMask, rows), diffBand,
+                         bandHistograms[band], histogramRowStep);
+    });
+    histogram.fill(0);
+    for (size_t band = 0; band < ranges.size(); ++band) {
+        for (size_t v = 0; v < histogram.size(); ++v) histogram[v] += bandHistograms[band][v];
+    }
+}
+
+/**
+ * Cleans up the motion mask using morphological operations.
+ * Operations are applied in this order:
+ * 1. Close - Fills small holes in motion regions
+ * 2. Open - Removes small noise blobs
+ * 3. Dilate - Expands motion regions to connect nearby areas
+ * 4. Erode - Optional shrinking to counter over-expansion
+ * 
+ * Uses an elliptical kernel for more natural shape preservation.
+ * All operations are configurable via the config file. The sequence runs as one
+ * planned MorphologyChain; morph_approximate trades the ellipse for a square kernel
+ * filtered in constant time per pixel (van Herk/Gil-Werman), whatever its size.
+ */
+cv::Mat MotionProcessor::applyMorphologicalOps(const cv::Mat& thresh) {
+    cv::Mat processed;
+    applyMorphologicalOpsInto(thresh, processed);
+    return processed;
+}
+
+void MotionProcessor::applyMorphologicalOpsInto(const cv::Mat& thresh, cv::Mat& processed) {
+    occupancyMask = nullptr;
+    occupancyCoverage = 1.0;
+    if (occupancyTileSize > 0 && applyOccupiedMorphology(thresh, processed)) {
+        return;
+    }
+    if (morphology && tileBands > 1) {
+        // Tiled: each band runs the whole chain while it is cache-resident; the halo
+        // covers the radius the planned chain reads
+        processed.create(thresh.size(), thresh.type());
+        if (bandMorphWorkspaces.size() < static_cast<size_t>(tileBands)) bandMorphWorkspaces.resize(tileBands);
+        forEachBand(thresh, processed, tileBands, morphChain.radius(), bandScratch,
+                    [this](int band, const cv::Mat& input, cv::Mat& output) {
+                        morphologyChainInto(input, output, bandMorphWorkspaces[band]);
+                    });
+        return;
+    }
+    morphologyChainInto(thresh, processed, morphWorkspace);
+}
+
+/**
+ * Tile occupancy: run the chain only on the windows around the occupied tiles of the
+ * thresholded mask. The output is nonzero only within the chain's radius of a nonzero
+ * input pixel, so everything outside the windows (occupied tiles grown by that radius)
+ * is zero; each window is computed from itself plus the radius, the halo whose edge
+ * effects do not reach the window. Returns false, leaving the mask to the whole-frame
+ * path, when the windows cover more than occupancyMaxFraction of it.
+ */
+bool MotionProcessor::applyOccupiedMorphology(const cv::Mat& thresh, cv::Mat& processed) {
+    if (thresh.empty() || processed.data == thresh.data) {
+        return false;  // In place: the windows' inputs would be cleared first
+    }
+    tileOccupancy.scan(thresh, occupancyTileSize);
+    const int halo = morphology ? morphChain.radius() : 0;
+    const std::vector<cv::Rect>& windows = tileOccupancy.windows(halo);
+    const double coverage = static_cast<double>(tileOccupancy.windowArea()) / thresh.total();
+    if (coverage > occupancyMaxFraction) {
+        return false;
+    }
+    
+    processed.create(thresh.size(), thresh.type());
+    processed.setTo(0);
+    const cv::Rect bounds(0, 0, thresh.cols, thresh.rows);
+    for (const cv::Rect& window : windows) {
+        const cv::Rect input = cv::Rect(window.x - halo, window.y - halo, window.width + 2 * halo,
+                                        window.height + 2 * halo) & bounds;
+        morphologyChainInto(thresh(input), occupancyScratch, morphWorkspace);
+        occupancyScratch(window - input.tl()).copyTo(processed(window));
+    }
+    occupancyWindows.assign(windows.begin(), windows.end());
+    occupancyMask = processed.data;
+    occupancyCoverage = coverage;
+    return true;
+}
+
+bool MotionProcessor::takeOccupancyWindows(const cv::Mat& mask) {
+    const bool valid = occupancyMask != nullptr && mask.data == occupancyMask;
+    occupancyMask = nullptr;  // A later mask in the same buffer is not described by them
+    return valid;
+}
+
+void MotionProcessor::morphologyChainInto(const cv::Mat& thresh, cv::Mat& processed,
+                                          MorphologyChain::Workspace& workspace) const {
+    if (!morphology) {
+        thresh.copyTo(processed);
+        return;
+    }
+    // The close/open/dilate/erode sequence was planned by rebuildCachedResources()
+    morphChain.apply(thresh, processed, workspace);
+}
+
+/**
+ * Extract and Filter Contours from Motion Mask
+ * ============================================
+ * This is the critical function that converts a binary motion mask into
+ * discrete motion boxes (bounding rectangles).
+ * 
+ * Processing Flow:
+ * 1. Find all contours in the motion mask
+ * 2. Filter by area (remove tiny regions)
+ * 3. Simplify contour shapes (optional)
+ * 4. Filter by aspect ratio of the bounding box (remove elongated shapes)
+ * 5. Filter by solidity against the convex hull (how solid vs scattered)
+ * 6. Return bounding boxes of accepted contours, with their area, solidity,
+ *    centroid (contour moments) and mean difference (under the mask in the box)
+ * Steps 2-5 are the ContourFilter: the hull is only built for contours the cheap
+ * tests kept, and its scratch vectors are reused from frame to frame.
+ * 
+ * Modes:
+ * - Adaptive: Dynamically calculates thresholds from scene statistics
+ * - Permissive: Uses fixed, loose thresholds to catch everything
+ * 
+ * @param processed - Binary motion mask (white = motion, black = no motion)
+ * @param frameDiff - Difference the mask was thresholded from (empty: no mean differences)
+ * @param detections - Accepted regions → feed the consolidator
+ */
+void MotionProcessor::extractDetections(const cv::Mat& processed, const cv::Mat& frameDiff,
+                                        Detections& detections) {
+    detections.clear();
+    const int frameCount = ++contourFrameCount;
+    
+    // Packed masks: components of the runs of the 1-bit mask
+    if (packedMaskFrame) {
+        extractPackedComponents(frameDiff, frameCount, detections);
+        return;
+    }
+    
+    // Connected-components mode: boxes and areas from one labelling pass
+    if (extractionMethod == ExtractionMethod::COMPONENTS) {
+        extractComponents(processed, frameDiff, frameCount, detections);
+        return;
+    }
+    
+    // Step 1: Find Contours
+    // RETR_EXTERNAL = only outer contours (ignore holes)
+    // CHAIN_APPROX_SIMPLE = compress contour points (store endpoints only)
+    // (into the persistent buffer, whose point vectors keep their capacity between frames)
+    std::vector<std::vector<cv::Point>>& contours = contourBuffer;
+    const bool windowed = takeOccupancyWindows(processed);
+    if (windowed) {
+        // Tile occupancy: trace each window at its offset (no region crosses one)
+        contours.clear();
+        for (const cv::Rect& window : occupancyWindows) {
+            cv::findContours(processed(window), windowContourBuffer, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE,
+                             window.tl());
+            for (auto& contour : windowContourBuffer) contours.push_back(std::move(contour));
+        }
+    } else {
+        cv::findContours(processed, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+    }
+    // Pathological masks (noise, rain) trace thousands of contours: bound the work below
+    const int droppedOverCap = capContours(contours);
+    
+    // Debug visualization (only if enabled in config)
+    cv::Mat debugViz;
+    if (visualizationEnabled) {
+        cv::cvtColor(processed, debugViz, cv::COLOR_GRAY2BGR);
+    }
+    
+    // Step 2: Determine Filtering Thresholds (adaptive or permissive, see contourThresholds)
+    const bool adaptive = contourMode == ContourMode::ADAPTIVE;
+    contourFilter.begin(contourThresholds(frameCount));
+    
+    // Process each detected contour through the filters, cheapest first:
+    // area, then bounding-box aspect ratio, then solidity (the only one needing a hull)
+    ContourFilter::Candidate candidate;
+    for (size_t i = 0; i < contours.size(); ++i) {
+        const auto& contour = contours[i];
+        const ContourFilter::Verdict verdict = contourFilter.evaluate(contour, contourAreaScale, candidate);
+        
+        // Feed the adaptive estimators (shape samples only from regions of 100+ px,
+        // tiny ones give unreliable ratios)
+        if (adaptive) {
+            if (candidate.area > 0) {
+                minAreaQuantile.add(candidate.area);
+            }
+            if (candidate.area >= 100.0 * contourAreaScale) {
+                const cv::Rect outline = candidate.bounds.empty() ? cv::boundingRect(contour) : candidate.bounds;
+                maxAspectRatioQuantile.add(static_cast<double>(outline.width) / outline.height);
+                if (candidate.solidity > 0) {
+                    minSolidityQuantile.add(candidate.solidity);
+                }
+            }
+        }
+        
+        // Visualize if enabled: rejected contours in red
+        if (verdict != ContourFilter::Verdict::ACCEPTED) {
+            if (visualizationEnabled) {
+                cv::drawContours(debugViz, contours, i, cv::Scalar(0, 0, 255), 2);
+            }
+            continue;
+        }
+        
+        // This contour has passed all our quality filters!
+        const cv::Rect& bounds = candidate.bounds;
+        const cv::Moments moments = cv::moments(contour);
+        const cv::Point2f centroid =
+            moments.m00 > 0 ? cv::Point2f(static_cast<float>(moments.m10 / moments.m00),
+                                          static_cast<float>(moments.m01 / moments.m00))
+                            : cv::Point2f(bounds.x + (bounds.width - 1) * 0.5f, bounds.y + (bounds.height - 1) * 0.5f);
+        detections.add(bounds, static_cast<float>(candidate.area), static_cast<float>(candidate.solidity), centroid,
+                       meanDiffUnder(frameDiff, processed, bounds));
+        
+        // Update visualization if enabled
+        if (visualizationEnabled) {
+            // 1. Contour Outline (Green)
+            cv::drawContours(debugViz, contours, i, cv::Scalar(0, 255, 0), 3);
+            
+            // 2. Bounding Box (Blue)
+            // Draw rectangle around the motion region
+            cv::rectangle(debugViz, bounds, cv::Scalar(255, 0, 0), 2);
+            
+            // 3. Statistics Label (White)
+            // Show key metrics for this region (solidity 100% when it is not measured)
+            const double solidity = candidate.solidity < 0 ? 1.0 : candidate.solidity;
+            std::string label = "A:" + std::to_string((int)candidate.area) + " S:" +
+                                std::to_string((int)(solidity * 100)) + "%";
+            cv::putText(debugViz, label, cv::Point(bounds.x, bounds.y - 5), 
+                       cv::FONT_HERSHEY_SIMPLEX, 0.4, cv::Scalar(255, 255, 255), 1);
+        }
+    }
+    
+    // Extraction summary: structured every frame, logged at a capped rate
+    lastExtraction = extractionStats(windowed, droppedOverCap);
+    const int totalContours = lastExtraction.candidates;
+    if (totalContours > 0) {
+        const ExtractionStats& stats = lastExtraction;
+        LOG_DEBUG_LIMITED("Contour extraction (frame {}): mode {} | thresholds area {:.0f}, aspect {:.1f}, "
+                          "solidity {:.2f} | found {} | over cap {} | rejected area {}, aspect {}, solidity {} | "
+                          "accepted {}",
+                          frameCount, toString(contourMode), stats.minArea, stats.maxAspectRatio,
+                          stats.minSolidity, totalContours, stats.droppedOverCap, stats.rejectedArea,
+                          stats.rejectedAspectRatio, stats.rejectedSolidity, stats.accepted);
+    }
+    
+    // Output motion boxes metadata for motion_region_consolidator (sampled: one frame's
+    // boxes at most at the diagnostic rate)
+    if (!detections.empty() && LOG_DEBUG_SAMPLE()) {
+        LOG_DEBUG("=== MOTION BOXES METADATA (Frame {}) ===", frameCount);
+        LOG_DEBUG("Detected {} motion regions", detections.size());
+        
+        for (size_t i = 0; i < detections.size(); ++i) {
+            const cv::Rect& bounds = detections.rects[i];
+            double aspectRatio = static_cast<double>(bounds.width) / bounds.height;
+            const cv::Point2f& centroid = detections.centroids[i];
+            
+            LOG_DEBUG("Motion Box {}: BBox({},{},{},{}) | Centroid({:.1f},{:.1f}) | Area: {:.0f} | Aspect: {:.2f} | "
+                      "Solidity: {:.2f} | Mean diff: {:.1f}",
+                    i,
+                    bounds.x, bounds.y, bounds.width, bounds.height,
+                    centroid.x, centroid.y,
+                    detections.areas[i], aspectRatio, detections.solidities[i], detections.meanDiffs[i]);
+        }
+        LOG_DEBUG("=== END MOTION BOXES METADATA ===");
+    }
+    
+    // Save debug visualization if enabled
+    if (visualizationEnabled && !debugViz.empty() && (frameCount % 10 == 0 || totalContours > 0)) {
+        std::string debugPath = visualizationPath + "/debug_contours_frame_" + 
+                               std::to_string(frameCount) + ".jpg";
+        DebugArtifactWriter::shared().submit(debugPath, std::move(debugViz));
+    }
+}
+
+std::vector<cv::Rect> MotionProcessor::extractContours(const cv::Mat& processed) {
+    Detections detections;
+    extractDetections(processed, cv::Mat(), detections);
+    return std::move(detections.rects);
+}
+
+/**
+ * Extract Motion Boxes from Connected Components
+ * ==============================================
+ * Alternative to contour tracing (contour_extraction: "components").
+ * cv::connectedComponentsWithStats labels the mask in one linear pass and
+ * yields every region's bounding box and pixel count directly, so filtering
+ * needs no contour tracing, polygon areas or approximation.
+ * 
+ * Differences from the contour path:
+ * - Area is the region's pixel count (contourArea of the traced outline is
+ *   slightly smaller, since it runs through the boundary pixel centers)
+ * - Holes count towards nothing: a ring has the area of its pixels
+ * - Solidity uses the convex hull of the region's row runs (runSolidity),
+ *   computed only for regions that passed the area and aspect ratio filters
+ * - Outlines are traced only for the debug visualization
+ * - The centroid is the labelling's own (mean pixel position)
+ * 
+ * The same adaptive/permissive thresholds and filter order are applied.
+ * 
+ * @param processed - Binary motion mask (white = motion, black = no motion)
+ * @param frameDiff - Difference the mask was thresholded from (empty: no mean differences)
+ * @param frameNumber - Frame counter shared with extractContours
+ * @param detections - Accepted regions → feed the consolidator
+ */
+void MotionProcessor::extractComponents(const cv::Mat& processed, const cv::Mat& frameDiff, int frameNumber,
+                                        Detections& detections) {
+    auto boundsOf = [this](int label) {
+        const int* stats = componentStats.ptr<int>(label);
+        return cv::Rect(stats[cv::CC_STAT_LEFT], stats[cv::CC_STAT_TOP],
+                        stats[cv::CC_STAT_WIDTH], stats[cv::CC_STAT_HEIGHT]);
+    };
+    auto pixelsOf = [this](int label) { return componentStats.at<int>(label, cv::CC_STAT_AREA); };
+    
+    // Step 1: Determine Filtering Thresholds
+    // Same streaming estimators and filter as the contour path, fed with component statistics
+    const bool adaptive = contourMode == ContourMode::ADAPTIVE;
+    contourFilter.begin(contourThresholds(frameNumber));
+    
+    cv::Mat debugViz;
+    if (visualizationEnabled) {
+        cv::cvtColor(processed, debugViz, cv::COLOR_GRAY2BGR);
+    }
+    
+    // Step 2: Label regions (8-connected, like findContours outlines): the whole mask, or
+    // with tile occupancy each window, whose labels and stats are window-relative
+    const bool windowed = takeOccupancyWindows(processed);
+    if (!windowed) {
+        occupancyWindows.assign(1, cv::Rect(0, 0, processed.cols, processed.rows));
+    }
+    int droppedOverCap = 0;
+    int budget = maxContoursPerFrame > 0 ? maxContoursPerFrame : std::numeric_limits<int>::max();
+    for (const cv::Rect& window : occupancyWindows) {
+        const int labelCount = cv::connectedComponentsWithStats(processed(window), componentLabels, componentStats,
+                                                                componentCentroids, 8, CV_32S);
+        // max_contours_per_frame: the largest components while the frame's budget lasts
+        selectComponents(labelCount, budget);
+        const int kept = static_cast<int>(componentOrder.size());
+        droppedOverCap += labelCount - 1 - kept;
+        budget -= kept;
+        
+        // Step 3: Filter each component (area, aspect ratio, solidity)
+        for (const int label : componentOrder) {
+            const int pixels = pixelsOf(label);
+            const double area = pixels * contourAreaScale;
+            const cv::Rect local = boundsOf(label);
+            const cv::Rect bounds = local + window.tl();
+            const bool shapeSample = adaptive && pixels >= 100;
+            if (adaptive) {
+                minAreaQuantile.add(area);
+            }
+            if (shapeSample) {
+                maxAspectRatioQuantile.add(static_cast<double>(bounds.width) / bounds.height);
+            }
+            double solidity;
+            const auto verdict = contourFilter.check(
+                area, bounds, [&] { return runSolidity(componentLabels, label, local, pixels); }, solidity);
+            if (shapeSample && solidity >= 0) {
+                minSolidityQuantile.add(solidity);
+            }
+            if (verdict != ContourFilter::Verdict::ACCEPTED) {
+                continue;
+            }
+            const double* center = componentCentroids.ptr<double>(label);
+            detections.add(bounds, static_cast<float>(area), static_cast<float>(solidity),
+                           cv::Point2f(static_cast<float>(center[0] + window.x), static_cast<float>(center[1] + window.y)),
+                           meanDiffUnder(frameDiff, processed, bounds));
+            
+            // Contour geometry only for accepted regions, and only to draw them
+            if (visualizationEnabled) {
+                std::vector<std::vector<cv::Point>> outline;
+                cv::Mat regionMask = componentLabels(local) == label;
+                cv::findContours(regionMask, outline, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE, bounds.tl());
+                cv::drawContours(debugViz, outline, -1, cv::Scalar(0, 255, 0), 3);
+                cv::rectangle(debugViz, bounds, cv::Scalar(255, 0, 0), 2);
+                const double shown = solidity < 0 ? 1.0 : solidity;
+                std::string caption = "A:" + std::to_string((int)area) + " S:" +
+                                      std::to_string((int)(shown * 100)) + "%";
+                cv::putText(debugViz, caption, cv::Point(bounds.x, bounds.y - 5),
+                           cv::FONT_HERSHEY_SIMPLEX, 0.4, cv::Scalar(255, 255, 255), 1);
+            }
+        }
+    }
+    
+    lastExtraction = extractionStats(windowed, droppedOverCap);
+    const int totalComponents = lastExtraction.candidates;
+    if (totalComponents > 0) {
+        const ExtractionStats& stats = lastExtraction;
+        LOG_DEBUG_LIMITED("Component extraction (frame {}): mode {} | thresholds area {:.0f}, aspect {:.1f}, "
+                          "solidity {:.2f} | found {} | over cap {} | rejected area {}, aspect {}, solidity {} | "
+                          "accepted {}",
+                          frameNumber, toString(contourMode), stats.minArea, stats.maxAspectRatio,
+                          stats.minSolidity, totalComponents, stats.droppedOverCap, stats.rejectedArea,
+                          stats.rejectedAspectRatio, stats.rejectedSolidity, stats.accepted);
+    }
+    
+    if (visualizationEnabled && !debugViz.empty() && (frameNumber % 10 == 0 || totalComponents > 0)) {
+        std::string debugPath = visualizationPath + "/debug_components_frame_" +
+                               std::to_string(frameNumber) + ".jpg";
+        DebugArtifactWriter::shared().submit(debugPath, std::move(debugViz));
+    }
+}
+
+/**
+ * extractComponents on the packed mask (packed_masks): the run labeler's components
+ * carry the same pixel counts, boxes and run solidity as connectedComponentsWithStats
+ * labels, so the filters and the cap decide as in "components" mode. The mask is never
+ * unpacked; no debug visualization (visualized frames keep the byte path). Centroid and
+ * mean difference of an accepted component are sums over its runs.
+ */
+void MotionProcessor::extractPackedComponents(const cv::Mat& frameDiff, int frameNumber, Detections& detections) {
+    const bool adaptive = contourMode == ContourMode::ADAPTIVE;
+    contourFilter.begin(contourThresholds(frameNumber));
+    
+    const int count = runLabeler.label(packedMorphological);
+    const std::vector<RunLabeler::Component>& components = runLabeler.components();
+    selectLargest(0, count, maxContoursPerFrame > 0 ? maxContoursPerFrame : count,
+                  [&components](int index) { return components[index].pixels; });
+    const int droppedOverCap = count - static_cast<int>(componentOrder.size());
+    const bool measuresDiff = frameDiff.size() == packedMorphological.size() && frameDiff.type() == CV_8UC1;
+    
+    const std::vector<MaskRun>& runs = runLabeler.runs();
+    for (const int index : componentOrder) {
+        const RunLabeler::Component& component = components[index];
+        const double area = component.pixels * contourAreaScale;
+        const cv::Rect& bounds = component.bounds;
+        const bool shapeSample = adaptive && component.pixels >= 100;
+        if (adaptive) {
+            minAreaQuantile.add(area);
+        }
+        if (shapeSample) {
+            maxAspectRatioQuantile.add(static_cast<double>(bounds.width) / bounds.height);
+        }
+        double solidity;
+        const auto verdict =
+            contourFilter.check(area, bounds, [&] { return runLabeler.solidity(index); }, solidity);
+        if (shapeSample && solidity >= 0) {
+            minSolidityQuantile.add(solidity);
+        }
+        if (verdict != ContourFilter::Verdict::ACCEPTED) {
+            continue;
+        }
+        double sumX = 0.0, sumY = 0.0, diffSum = 0.0;
+        for (int run = component.firstRun; run >= 0; run = runLabeler.nextRun(run)) {
+            const MaskRun& span = runs[run];
+            const int length = span.end - span.begin;
+            sumX += (span.begin + span.end - 1) * 0.5 * length;
+            sumY += static_cast<double>(span.row) * length;
+            if (measuresDiff) {
+                const uchar* diff = frameDiff.ptr<uchar>(span.row);
+                for (int x = span.begin; x < span.end; ++x) diffSum += diff[x];
+            }
+        }
+        const double pixels = component.pixels;
+        detections.add(bounds, static_cast<float>(area), static_cast<float>(solidity),
+                       cv::Point2f(static_cast<float>(sumX / pixels), static_cast<float>(sumY / pixels)),
+                       measuresDiff ? static_cast<float>(diffSum / pixels) : -1.0f);
+    }
+    
+    lastExtraction = extractionStats(false, droppedOverCap);
+    if (lastExtraction.candidates > 0) {
+        const ExtractionStats& stats = lastExtraction;
+        LOG_DEBUG_LIMITED("Packed component extraction (frame {}): mode {} | thresholds area {:.0f}, aspect {:.1f}, "
+                          "solidity {:.2f} | found {} ({} runs) | over cap {} | rejected area {}, aspect {}, "
+                          "solidity {} | accepted {}",
+                          frameNumber, toString(contourMode), stats.minArea, stats.maxAspectRatio,
+                          stats.minSolidity, stats.candidates, runLabeler.runs().size(), stats.droppedOverCap,
+                          stats.rejectedArea, stats.rejectedAspectRatio, stats.rejectedSolidity, stats.accepted);
+    }
+}
+
+/**
+ * Motion boxes of detection_method "block": the 8-connected groups of moving blocks, in
+ * detection pixels. Groups smaller than block_min_blocks are dropped; no shape filters
+ * apply, the consolidator sees every group. Boxes are aligned to the block grid, so they
+ * extend up to a block beyond the bird on each side. A group's area is its blocks' area,
+ * its mean difference the mean of their block means; solidity is not measured.
+ */
+void MotionProcessor::extractBlockRegions(Detections& detections) {
+    detections.clear();
+    const int labelCount = cv::connectedComponentsWithStats(blockGrid, componentLabels, componentStats,
+                                                            componentCentroids, 8, CV_32S);
+    const int size = blockMotion->blockSize();
+    const cv::Rect frame(0, 0, detectionSize.width, detectionSize.height);
+    const cv::Mat& map = blockMotion->map();
+    int areaFiltered = 0;
+    for (int label = 1; label < labelCount; ++label) {
+        const int* stats = componentStats.ptr<int>(label);
+        if (stats[cv::CC_STAT_AREA] < blockMinBlocks) {
+            areaFiltered++;
+            continue;
+        }
+        const cv::Rect blocks(stats[cv::CC_STAT_LEFT], stats[cv::CC_STAT_TOP], stats[cv::CC_STAT_WIDTH],
+                              stats[cv::CC_STAT_HEIGHT]);
+        const double* center = componentCentroids.ptr<double>(label);
+        const cv::Scalar meanDiff = cv::mean(map(blocks), componentLabels(blocks) == label);
+        detections.add(cv::Rect(blocks.tl() * size, blocks.size() * size) & frame,
+                       static_cast<float>(stats[cv::CC_STAT_AREA] * size * size * contourAreaScale), -1.0f,
+                       cv::Point2f(static_cast<float>((center[0] + 0.5) * size - 0.5),
+                                   static_cast<float>((center[1] + 0.5) * size - 0.5)),
+                       static_cast<float>(meanDiff[0]));
+    }
+    lastExtraction = {labelCount - 1, areaFiltered, 0, 0, static_cast<int>(detections.size()),
+                      blockMinBlocks * size * size * contourAreaScale, 0.0, 0.0};
+}
+
+// ============================================================================
+// ADAPTIVE CONTOUR DETECTION METHODS
+// ============================================================================
+// Contour statistics from every frame are summarized by streaming percentile
+// estimators to determine optimal filtering thresholds. They help the system adapt to different scenes:
+// - Close-up scenes: Birds are large, use higher area thresholds
+// - Far-away scenes: Birds are small, use lower area thresholds
+// - Cluttered scenes: Many objects, use stricter shape filters
+// - Simple scenes: Few objects, can be more permissive
+
+/**
+ * Update Adaptive Thresholds
+ * ==========================
+ * Reads the streaming percentile estimators fed by every contour since the
+ * last update, stores the new thresholds and starts a new window.
+ * 
+ * Thresholds (each with safety bounds):
+ * - Min area: 10th percentile of contour areas, 50 - 1000 pixels.
+ *   Filters out the smallest 10% (likely noise).
+ *   E.g. areas [20, 30, 45, 50, 200, 250, 300, 500, 800] → 45 → clamped to 50
+ * - Min solidity: 25th percentile of contour area / convex hull area, 0.2 - 0.8.
+ *   More permissive than area (birds can have irregular shapes):
+ *   1.0 = solid (circle, square), 0.8 = typical bird, 0.5 = swaying branches,
+ *   0.2 = scattered reflections and shadows
+ * - Max aspect ratio: 90th percentile of width / height, 2.0 - 15.0.
+ *   Allows most bird poses, filters wires and shadows (10.0+)
+ * 
+ * Solidity and aspect ratio only sample regions of 100+ pixels; solidity is
+ * only sampled for regions that passed the area and aspect ratio filters (their
+ * hull is computed anyway). A window without any contour falls back to the permissive values;
+ * one without shape samples falls back to the configured solidity/aspect limits.
+ * 
+ * Each estimator is a P² quantile sketch (StreamingQuantile): constant memory
+ * and O(1) work per contour, and the thresholds reflect the whole window instead
+ * of the single frame that happened to land on the update interval.
+ */
+void MotionProcessor::updateAdaptiveThresholds() {
+    if (minAreaQuantile.count() == 0) {
+        cachedAdaptiveMinArea = permissiveMinArea;
+        cachedAdaptiveMinSolidity = permissiveMinSolidity;
+        cachedAdaptiveMaxAspectRatio = permissiveMaxAspectRatio;
+    } else {
+        cachedAdaptiveMinArea = std::max(50.0, std::min(1000.0, minAreaQuantile.value()));
+        cachedAdaptiveMinSolidity = minSolidityQuantile.count() == 0
+            ? minContourSolidity : std::max(0.2, std::min(0.8, minSolidityQuantile.value()));
+        cachedAdaptiveMaxAspectRatio = maxAspectRatioQuantile.count() == 0
+            ? maxContourAspectRatio : std::max(2.0, std::min(15.0, maxAspectRatioQuantile.value()));
+    }
+    
+    LOG_DEBUG("Adaptive thresholds: area {:.0f} ({} samples) | solidity {:.2f} ({}) | aspect {:.1f} ({})",
+              cachedAdaptiveMinArea, minAreaQuantile.count(),
+              cachedAdaptiveMinSolidity, minSolidityQuantile.count(),
+              cachedAdaptiveMaxAspectRatio, maxAspectRatioQuantile.count());
+    
+    minAreaQuantile.reset();
+    minSolidityQuantile.reset();
+    maxAspectRatioQuantile.reset();
+}
+
+/**
+ * Thresholds for the mask of frame @p frameNumber: in ADAPTIVE mode the cached
+ * estimates (refreshed every adaptive_update_interval masks), otherwise the
+ * permissive ones that let the consolidator do the heavy filtering.
+ */
+ContourFilter::Thresholds MotionProcessor::contourThresholds(int frameNumber) {
+    if (contourMode != ContourMode::ADAPTIVE) {
+        return {permissiveMinArea, permissiveMinSolidity, permissiveMaxAspectRatio};
+    }
+    if (frameNumber - lastAdaptiveUpdate >= adaptiveUpdateInterval) {
+        updateAdaptiveThresholds();
+        lastAdaptiveUpdate = frameNumber;
+        LOG_DEBUG("Updated adaptive values at frame {}", frameNumber);
+    }
+    return {cachedAdaptiveMinArea, cachedAdaptiveMinSolidity, cachedAdaptiveMaxAspectRatio};
+}
+
+MotionProcessor::ExtractionStats MotionProcessor::extractionStats(bool windowed, int droppedOverCap) const {
+    const ContourFilter::Counts& counts = contourFilter.counts();
+    const ContourFilter::Thresholds& thresholds = contourFilter.thresholds();
+    ExtractionStats stats;
+    stats.candidates = counts.candidates + droppedOverCap;
+    stats.rejectedArea = counts.rejectedArea;
+    stats.rejectedSolidity = counts.rejectedSolidity;
+    stats.rejectedAspectRatio = counts.rejectedAspectRatio;
+    stats.accepted = counts.accepted;
+    stats.minArea = thresholds.minArea;
+    stats.minSolidity = thresholds.minSolidity;
+    stats.maxAspectRatio = thresholds.maxAspectRatio;
+    stats.maskCoverage = windowed ? occupancyCoverage : 1.0;
+    stats.solidityChecks = counts.solidityChecks;
+    stats.droppedOverCap = droppedOverCap;
+    return stats;
+}
+
+/**
+ * Worst-case bound of the contour path: with more than max_contours_per_frame contours,
+ * only the largest (polygon area, ties to the first traced) are kept. nth_element picks
+ * them in linear time; they are then moved to the front in their traced order, so the
+ * boxes come out in the same order as without the cap.
+ */
+int MotionProcessor::capContours(std::vector<std::vector<cv::Point>>& contours) {
+    const int total = static_cast<int>(contours.size());
+    if (maxContoursPerFrame == 0 || total <= maxContoursPerFrame) {
+        return 0;
+    }
+    candidateRanks.resize(total);
+    for (int i = 0; i < total; ++i) {
+        candidateRanks[i] = {cv::contourArea(contours[i]), i};
+    }
+    auto larger = [](const std::pair<double, int>& a, const std::pair<double, int>& b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    };
+    std::nth_element(candidateRanks.begin(), candidateRanks.begin() + (maxContoursPerFrame - 1),
+                     candidateRanks.end(), larger);
+    candidateRanks.resize(maxContoursPerFrame);
+    std::sort(candidateRanks.begin(), candidateRanks.end(),
+              [](const std::pair<double, int>& a, const std::pair<double, int>& b) { return a.second < b.second; });
+    // Kept indices ascend and are never below their new position, so no kept contour is overwritten
+    for (int j = 0; j < maxContoursPerFrame; ++j) {
+        if (candidateRanks[j].second != j) contours[j].swap(contours[candidateRanks[j].second]);
+    }
+    contours.resize(maxContoursPerFrame);
+    return total - maxContoursPerFrame;
+}
+
+void MotionProcessor::selectComponents(int labelCount, int budget) {
+    // Label 0 is the background
+    selectLargest(1, labelCount - 1, budget,
+                  [this](int label) { return componentStats.at<int>(label, cv::CC_STAT_AREA); });
+}
+
+template <typename PixelsOf>
+void MotionProcessor::selectLargest(int first, int count, int budget, PixelsOf pixelsOf) {
+    componentOrder.clear();
+    if (count <= budget) {
+        for (int index = first; index < first + count; ++index) componentOrder.push_back(index);
+        return;
+    }
+    if (budget <= 0) {
+        return;
+    }
+    candidateRanks.resize(count);
+    for (int index = first; index < first + count; ++index) {
+        candidateRanks[index - first] = {pixelsOf(index), index};
+    }
+    std::nth_element(candidateRanks.begin(), candidateRanks.begin() + (budget - 1), candidateRanks.end(),
+                     [](const std::pair<double, int>& a, const std::pair<double, int>& b) {
+                         return a.first > b.first || (a.first == b.first && a.second < b.second);
+                     });
+    for (int i = 0; i < budget; ++i) componentOrder.push_back(candidateRanks[i].second);
+    std::sort(componentOrder.begin(), componentOrder.end());
+}
+
+const cv::Mat& MotionProcessor::olderReference() const {
+    static const cv::Mat none;
+    const cv::Mat& older = previousFrames.at(1);
+    if (differencingMode != DifferencingMode::THREE_FRAME || older.size() != previousFrames.newest().size() ||
+        older.type() != previousFrames.newest().type()) {
+        return none;
+    }
+    return older;
+}
+
+void MotionProcessor::setPrevFrame(const cv::Mat& frame) {
+    previousFrames.clear();
+    previousFrames.pushCopy(frame);
+}
+
+void MotionProcessor::resetState() {
+    previousFrames.clear();
+    deviceBuffers.previous.release();
+    deviceBuffers.older.release();
+    firstFrame = true;
+    bgSubtractor.release();
+    framesSinceBackgroundUpdate = 0;
+    if (blockMotion) blockMotion->reset();
+    cachedMotionThreshold = -1;
+    gateReference.release();
+    gatedFramesSinceBackgroundUpdate = 0;
+    refinementReference.release();
+    occupancyWindows.clear();
+    occupancyMask = nullptr;
+    occupancyCoverage = 1.0;
+    setRoiPrediction(roiPrediction);  // Drops its windows, samples and background image
+}
+
+void MotionProcessor::storePrevFrame(cv::Mat& processed) {
+    if (reuseBuffers) {
+        // Ring: the current frame becomes the newest reference and the oldest reference
+        // buffer is recycled as the next frame's preprocessing target
+        previousFrames.push(processed);
+    } else {
+        previousFrames.pushCopy(processed);
+    }
+    
+    // The gate reference always samples the newest reference frame
+    if (motionGate) {
+        std::swap(gateReference, gateSample);
+    }
+}
+
+/**
+ * Returns the crop the detection stages run on: the ROI crop itself, or its
+ * INTER_AREA downscale into @p scaled when detection_scale < 1.
+ */
+const cv::Mat& MotionProcessor::scaleForDetection(const cv::Mat& roiFrame, cv::Mat& scaled) const {
+    if (detectionSize == roiRect.size()) {
+        return roiFrame;
+    }
+    cv::resize(roiFrame, scaled, detectionSize, 0, 0, cv::INTER_AREA);
+    return scaled;
+}
+
+/**
+ * Samples every kGateStep-th pixel of the crop in both directions (nearest-neighbour
+ * resize, so only the sampled pixels are read), converts the small sample to gray
+ * and counts samples that differ from the reference sample by more than
+ * motionGatePixelDelta. Returns true when at least motionGateMinPixels changed, or
+ * when there is no comparable reference yet.
+ */
+bool MotionProcessor::sampleMotionGate(const cv::Mat& roiFrame) {
+    constexpr int kGateStep = 8;
+    const cv::Size sampleSize(std::max(1, roiFrame.cols / kGateStep), std::max(1, roiFrame.rows / kGateStep));
+    cv::resize(roiFrame, gateSampleBuffer, sampleSize, 0, 0, cv::INTER_NEAREST);
+    if (gateSampleBuffer.channels() > 1) {
+        cv::cvtColor(gateSampleBuffer, gateSample, cv::COLOR_BGR2GRAY);
+    } else {
+        std::swap(gateSample, gateSampleBuffer);
+    }
+    
+    if (gateReference.size() != gateSample.size()) {
+        return true;
+    }
+    cv::absdiff(gateSample, gateReference, gateSampleBuffer);
+    cv::threshold(gateSampleBuffer, gateSampleBuffer, motionGatePixelDelta, 255, cv::THRESH_BINARY);
+    const int changed = cv::countNonZero(gateSampleBuffer);
+    if (changed < motionGateMinPixels) {
+        LOG_DEBUG("Motion gate: {} of {} samples changed; skipping frame", changed, gateSample.total());
+        return false;
+    }
+    return true;
+}
+
+void MotionProcessor::setRoiPrediction(bool enable) {
+    roiPrediction = enable;
+    framesSinceFullScan = 0;
+    predictionBoxes.clear();
+    predictionHints.clear();
+    predictionWindows.clear();
+    predictionSampleReference.release();
+    predictionBackground.release();
+}
+
+/**
+ * The windows are the last frame's boxes and the hints (mapped from frame coordinates),
+ * grown by roiPredictionMargin, clipped to the crop and merged until no two touch, so a
+ * region never crosses a window. The trigger samples are taken on every frame, so each
+ * frame compares with the one before it.
+ */
+bool MotionProcessor::planPredictionWindows(const cv::Mat& roiFrame) {
+    const cv::Rect bounds(cv::Point(), detectionSize);
+    predictionWindows.clear();
+    const auto addWindow = [&](const cv::Rect& box) {
+        const cv::Rect window = cv::Rect(box.x - roiPredictionMargin, box.y - roiPredictionMargin,
+                                         box.width + 2 * roiPredictionMargin, box.height + 2 * roiPredictionMargin) &
+                                bounds;
+        if (!window.empty()) predictionWindows.push_back(window);
+    };
+    for (const cv::Rect& box : predictionBoxes) addWindow(box);
+    const double scaleX = static_cast<double>(detectionSize.width) / roiRect.width;
+    const double scaleY = static_cast<double>(detectionSize.height) / roiRect.height;
+    for (const cv::Rect& hint : predictionHints) {
+        const cv::Rect crop = hint - roiRect.tl();
+        addWindow(cv::Rect(cv::Point(cvFloor(crop.x * scaleX), cvFloor(crop.y * scaleY)),
+                           cv::Point(cvCeil(crop.br().x * scaleX), cvCeil(crop.br().y * scaleY))));
+    }
+    predictionHints.clear();
+    for (bool merged = true; merged;) {
+        merged = false;
+        for (size_t i = 0; i < predictionWindows.size() && !merged; ++i) {
+            const cv::Rect touching(predictionWindows[i].x - 1, predictionWindows[i].y - 1,
+                                    predictionWindows[i].width + 2, predictionWindows[i].height + 2);
+            for (size_t j = i + 1; j < predictionWindows.size(); ++j) {
+                if ((touching & predictionWindows[j]).empty()) continue;
+                predictionWindows[i] |= predictionWindows[j];
+                predictionWindows.erase(predictionWindows.begin() + static_cast<std::ptrdiff_t>(j));
+                merged = true;
+                break;
+            }
+        }
+    }
+    int64_t windowArea = 0;
+    for (const cv::Rect& window : predictionWindows) windowArea += window.area();
+
+    const cv::Mat& reference = previousFrames.at(0);
+    // CLAHE and the recursive filter depend on the whole crop, so windows would differ from it
+    const bool eligible = !firstFrame && !contrastEnhancement && blurType != BlurType::DOMAIN_TRANSFORM &&
+                          reference.type() == CV_8UC1 && reference.size() == detectionSize;
+    const int changed = samplePredictionTrigger(roiFrame);
+    const bool windowed = eligible && !predictionWindows.empty() &&
+                          framesSinceFullScan + 1 < roiPredictionFullScanInterval &&
+                          windowArea <= roiPredictionMaxFraction * bounds.area() &&
+                          (roiPredictionTriggerSamples <= 0 || changed < roiPredictionTriggerSamples);
+    if (!windowed) {
+        if (eligible && !predictionWindows.empty() && roiPredictionTriggerSamples > 0 &&
+            changed >= roiPredictionTriggerSamples) {
+            LOG_DEBUG_LIMITED("ROI prediction: {} samples changed outside {} windows; full scan", changed,
+                              predictionWindows.size());
+        }
+        framesSinceFullScan = 0;
+        predictionWindows.clear();
+        return false;
+    }
+    ++framesSinceFullScan;
+    return true;
+}
+
+/**
+ * The gray crop sampled every 8th pixel (nearest neighbour, so only the samples are read),
+ * differenced with the last frame's sample; samples inside the windows are not counted.
+ */
+int MotionProcessor::samplePredictionTrigger(const cv::Mat& roiFrame) {
+    constexpr int kSampleStep = 8;
+    const cv::Size sampleSize(std::max(1, roiFrame.cols / kSampleStep), std::max(1, roiFrame.rows / kSampleStep));
+    cv::resize(roiFrame, predictionSampleDiff, sampleSize, 0, 0, cv::INTER_NEAREST);
+    if (predictionSampleDiff.channels() > 1) {
+        cv::cvtColor(predictionSampleDiff, predictionSample, cv::COLOR_BGR2GRAY);
+    } else {
+        predictionSampleDiff.copyTo(predictionSample);
+    }
+    int changed = 0;
+    if (predictionSampleReference.size() == predictionSample.size()) {
+        cv::absdiff(predictionSample, predictionSampleReference, predictionSampleDiff);
+        cv::threshold(predictionSampleDiff, predictionSampleDiff, motionGatePixelDelta, 255, cv::THRESH_BINARY);
+        const double scaleX = static_cast<double>(sampleSize.width) / detectionSize.width;
+        const double scaleY = static_cast<double>(sampleSize.height) / detectionSize.height;
+        const cv::Rect sampleBounds(cv::Point(), sampleSize);
+        for (const cv::Rect& window : predictionWindows) {
+            const cv::Rect covered = cv::Rect(cv::Point(cvFloor(window.x * scaleX), cvFloor(window.y * scaleY)),
+                                              cv::Point(cvCeil(window.br().x * scaleX), cvCeil(window.br().y * scaleY))) &
+                                     sampleBounds;
+            if (!covered.empty()) predictionSampleDiff(covered).setTo(0);
+        }
+        changed = cv::countNonZero(predictionSampleDiff);
+    }
+    std::swap(predictionSample, predictionSampleReference);
+    return changed;
+}
+
+// Background image the windowed frames difference against (none without a usable model)
+void MotionProcessor::refreshPredictionBackground() {
+    predictionBackground.release();
+    if (!backgroundSubtraction || bgSubtractor.empty()) {
+        return;
+    }
+    cv::Mat background = getBackgroundImage();
+    if (background.size() == detectionSize && background.type() == CV_8UC1) {
+        predictionBackground = std::move(background);
+    }
+}
+
+void MotionProcessor::setDetectionRefinement(bool enable) {
+    detectionRefinement = enable;
+    roiFrameSize = cv::Size();  // Builds (or drops) the full-resolution exclusion mask
+    if (!enable) refinementReference.release();
+}
+
+/**
+ * Keeps the frame the next frame's refinement windows are differenced against: a header
+ * on the caller's buffer, or a copy once the caller turned out to reuse one buffer.
+ */
+void MotionProcessor::keepRefinementReference(const cv::Mat& image) {
+    if (!refinementActive()) {
+        refinementReference.release();
+        return;
+    }
+    if (refinementCopiesReference) {
+        image.copyTo(refinementReferenceBuffer);
+        refinementReference = refinementReferenceBuffer;
+    } else {
+        refinementReference = image;
+    }
+}
+
+/**
+ * Coarse-to-fine step: the downscaled boxes (full-frame coordinates) are padded, merged
+ * where the padded windows overlap, and each window of the full-resolution luma
+ * difference is thresholded at this frame's motion threshold, closed across about one
+ * detection pixel and contoured. Contours passing this frame's area filter replace the
+ * window's coarse boxes; shape filters are not repeated, the coarse contours passed them.
+ * A refined region has its own area and centroid (contour moments) and takes solidity and
+ * mean difference from the coarse region it overlaps most.
+ */
+void MotionProcessor::refineDetections(const cv::Mat& image, Detections& detections) {
+    if (refinementReference.size() != image.size() || refinementReference.type() != image.type()) {
+        return;  // No full-resolution reference yet
+    }
+    if (refinementReference.data == image.data) {
+        // This frame was decoded into the last one's buffer, so the reference is gone
+        LOG_INFO("Input frames share one buffer; detection refinement copies its reference from now on");
+        refinementCopiesReference = true;
+        return;
+    }
+    const std::vector<cv::Rect>& coarse = detections.rects;
+
+    const double detectionPixel = static_cast<double>(roiRect.width) / detectionSize.width;
+    const int padding = refinementPadding + cvCeil(detectionPixel);
+    std::vector<cv::Rect>& windows = refinementWindows;
+    windows.clear();
+    for (const cv::Rect& box : coarse) {
+        windows.push_back(cv::Rect(box.x - padding, box.y - padding, box.width + 2 * padding,
+                                   box.height + 2 * padding) & roiRect);
+    }
+    // Merge overlapping windows so no motion is contoured twice (a handful of boxes per frame)
+    for (bool merged = true; merged;) {
+        merged = false;
+        for (size_t i = 0; i < windows.size() && !merged; ++i) {
+            for (size_t j = i + 1; j < windows.size(); ++j) {
+                if ((windows[i] & windows[j]).empty()) continue;
+                windows[i] |= windows[j];
+                windows.erase(windows.begin() + static_cast<std::ptrdiff_t>(j));
+                merged = true;
+                break;
+            }
+        }
+    }
+
+    // The floor keeps sensor noise out when a quiet frame selected a very low threshold
+    const int threshold = std::max({lastMotionThreshold, minMotionThreshold, 10});
+    const int closeSize = 2 * cvRound(detectionPixel / 2.0) + 1;
+    const cv::Mat closeKernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(closeSize, closeSize));
+    Detections& refined = refinedDetections;
+    refined.clear();
+    for (const cv::Rect& window : windows) {
+        const cv::Mat current = image(window);
+        const cv::Mat previous = refinementReference(window);
+        if (current.channels() == 1) {
+            cv::absdiff(current, previous, refinementMask);
+        } else {
+            cv::cvtColor(current, refinementCurrent, cv::COLOR_BGR2GRAY);
+            cv::cvtColor(previous, refinementPrevious, cv::COLOR_BGR2GRAY);
+            cv::absdiff(refinementCurrent, refinementPrevious, refinementMask);
+        }
+        cv::GaussianBlur(refinementMask, refinementMask, cv::Size(3, 3), 0);
+        cv::threshold(refinementMask, refinementMask, threshold, 255, cv::THRESH_BINARY);
+        if (!roiExcludedMaskFull.empty()) {
+            refinementMask.setTo(0, roiExcludedMaskFull(window - roiRect.tl()));
+        }
+        cv::morphologyEx(refinementMask, refinementMask, cv::MORPH_CLOSE, closeKernel);
+        cv::findContours(refinementMask, contourBuffer, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+
+        const size_t windowStart = refined.size();
+        for (const auto& contour : contourBuffer) {
+            const cv::Moments moments = cv::moments(contour);
+            if (moments.m00 < lastExtraction.minArea || moments.m00 <= 0) continue;
+            const cv::Rect box = cv::boundingRect(contour) + window.tl();
+            size_t source = 0;
+            int overlap = -1;
+            for (size_t i = 0; i < coarse.size(); ++i) {
+                const int shared = (coarse[i] & box).area();
+                if (shared > overlap) {
+                    overlap = shared;
+                    source = i;
+                }
+            }
+            refined.add(box, static_cast<float>(moments.m00), detections.solidities[source],
+                        cv::Point2f(static_cast<float>(moments.m10 / moments.m00 + window.x),
+                                    static_cast<float>(moments.m01 / moments.m00 + window.y)),
+                        detections.meanDiffs[source]);
+        }
+        if (refined.size() == windowStart) {
+            for (size_t i = 0; i < coarse.size(); ++i) {
+                if ((coarse[i] & window) != coarse[i]) continue;
+                refined.add(coarse[i], detections.areas[i], detections.solidities[i], detections.centroids[i],
+                            detections.meanDiffs[i]);
+            }
         }
     }
-    
-    return processed;
+    LOG_DEBUG_LIMITED("Detection refinement: {} downscaled boxes -> {} boxes in {} windows",
+                      coarse.size(), refined.size(), windows.size());
+    std::swap(detections, refined);
+}
+
+void MotionProcessor::setRegionsOfInterest(const std::vector<std::vector<cv::Point>>& polygons) {
+    roiPolygons = polygons;
+    roiFrameSize = cv::Size();  // Rebuild the crop and mask on the next frame
+}
+
+void MotionProcessor::setExclusionZones(const std::vector<std::vector<cv::Point>>& polygons) {
+    exclusionPolygons = polygons;
+    roiFrameSize = cv::Size();
+}
+
+void MotionProcessor::setDetectionScale(double scale) {
+    if (!(scale > 0.0 && scale <= 1.0)) {
+        LOG_WARN("Ignoring detection_scale {} (must be in (0, 1]); using 1.0", scale);
+        scale = 1.0;
+    }
+    detectionScale = scale;
+    roiFrameSize = cv::Size();
 }
 
 /**
- * Extract and Filter Contours from Motion Mask
- * ============================================
- * This is the critical function that converts a binary motion mask into
- * discrete motion boxes (bounding rectangles).
- * 
- * Processing Flow:
- * 1. Find all contours in the motion mask
- * 2. Filter by area (remove tiny regions)
- * 3. Simplify contour shapes (optional)
- * 4. Analyze shape quality using convex hull
- * 5. Filter by solidity (how solid vs scattered)
- * 6. Filter by aspect ratio (remove elongated shapes)
- * 7. Return bounding boxes of accepted contours
- * 
- * Modes:
- * - Adaptive: Dynamically calculates thresholds from scene statistics
- * - Permissive: Uses fixed, loose thresholds to catch everything
- * 
- * @param processed - Binary motion mask (white = motion, black = no motion)
- * @return Vector of bounding rectangles (motion boxes) → feeds consolidator
+ * Rebuilds the ROI crop rectangle and exclusion mask for the given input size.
+ * Runs once per resolution (or after the zones change), not per frame.
+ * The crop is the bounding rectangle of the ROI polygons clipped to the frame;
+ * the mask marks crop pixels outside every ROI polygon or inside an exclusion polygon.
+ * Both are then sized for the detection scale.
+ * The reference frame is dropped when the crop moves so no stale diff is produced.
  */
-std::vector<cv::Rect> MotionProcessor::extractContours(const cv::Mat& processed) {
-    // Step 1: Find Contours
-    // RETR_EXTERNAL = only outer contours (ignore holes)
-    // CHAIN_APPROX_SIMPLE = compress contour points (store endpoints only)
-    std::vector<std::vector<cv::Point>> contours;
-    cv::findContours(processed, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
-    
-    std::vector<cv::Rect> newBounds;  // Output: motion boxes
-    static int frameCount = 0;
-    frameCount++;
+void MotionProcessor::updateRoiGeometry(const cv::Size& frameSize) {
+    if (frameSize == roiFrameSize) {
+        return;
+    }
     
-    // Debug visualization (only if enabled in config)
-    cv::Mat debugViz;
-    if (visualizationEnabled) {
-        cv::cvtColor(processed, debugViz, cv::COLOR_GRAY2BGR);
+    const cv::Rect frameRect(cv::Point(), frameSize);
+    cv::Rect crop;
+    for (const auto& polygon : roiPolygons) {
+        crop |= cv::boundingRect(polygon);
     }
+    crop &= frameRect;
     
-    // Tracking statistics for troubleshooting
-    int totalContours = contours.size();       // Total found
-    int areaFiltered = 0;                      // Rejected: too small
-    int solidityFiltered = 0;                  // Rejected: too scattered
-    int aspectRatioFiltered = 0;               // Rejected: too elongated
-    int finalAccepted = 0;                     // Accepted count
-    
-    // Step 2: Determine Filtering Thresholds
-    // Start with permissive defaults (will be updated based on mode)
-    double adaptiveMinArea = permissiveMinArea;
-    double adaptiveMinSolidity = permissiveMinSolidity;
-    double adaptiveMaxAspectRatio = permissiveMaxAspectRatio;
-    
-    // ADAPTIVE MODE: Learn thresholds from scene
-    // Recalculates thresholds every N frames based on detected contour statistics
-    // Helps adapt to different scenes (close vs far, many vs few birds, etc.)
-    if (contourDetectionMode == "adaptive") {
-        // Only recalculate periodically (expensive operation)
-        // Default: every 150 frames = 5 seconds at 30fps
-        if (frameCount - lastAdaptiveUpdate >= adaptiveUpdateInterval) {
-            // Calculate new thresholds from current contour distribution
-            cachedAdaptiveMinArea = calculateAdaptiveMinArea(contours);
-            cachedAdaptiveMinSolidity = calculateAdaptiveMinSolidity(contours);
-            cachedAdaptiveMaxAspectRatio = calculateAdaptiveMaxAspectRatio(contours);
-            lastAdaptiveUpdate = frameCount;
-            LOG_INFO("Updated adaptive values at frame {}", frameCount);
-        }
-        // Use cached values for this frame
-        adaptiveMinArea = cachedAdaptiveMinArea;
-        adaptiveMinSolidity = cachedAdaptiveMinSolidity;
-        adaptiveMaxAspectRatio = cachedAdaptiveMaxAspectRatio;
-    } 
-    // PERMISSIVE MODE: Use fixed, loose thresholds
-    // Catches everything possible, lets consolidator do the heavy filtering
-    else if (contourDetectionMode == "permissive") {
-        adaptiveMinArea = permissiveMinArea;              // 50 pixels (very small)
-        adaptiveMinSolidity = permissiveMinSolidity;      // 0.1 (very loose shape)
-        adaptiveMaxAspectRatio = permissiveMaxAspectRatio; // 10.0 (very elongated OK)
-    }
-    
-    if (frameCount % 30 == 0 || totalContours > 0) {
-        LOG_INFO("=== CONTOUR EXTRACTION (Frame {}) ===", frameCount);
-        LOG_INFO("Mode: {} | Area: {:.0f} | Aspect: {:.1f} | Solidity: {:.2f}", 
-                 contourDetectionMode, adaptiveMinArea, adaptiveMaxAspectRatio, adaptiveMinSolidity);
-        LOG_INFO("Summary: Found {} contours | Area: {} | Solidity: {} | Aspect: {} | Accepted: {}", 
-                 totalContours, areaFiltered, solidityFiltered, aspectRatioFiltered, finalAccepted);
-    }
-    
-    // Process each detected contour through a series of filters
-    // Each filter helps eliminate false detections while keeping real motion
-    for (size_t i = 0; i < contours.size(); ++i) {
-        const auto& contour = contours[i];
-        
-        // Step 1: Area Filter
-        // Calculate contour area and filter out tiny regions
-        // Area = number of pixels in the region
-        double area = cv::contourArea(contour);
-        
-        // Visualize if enabled: Draw all contours in red initially
-        if (visualizationEnabled) {
-            cv::drawContours(debugViz, contours, i, cv::Scalar(0, 0, 255), 2);
+    const bool useRoi = !crop.empty();
+    if (!useRoi) {
+        if (!roiPolygons.empty()) {
+            LOG_WARN("ROI polygons lie outside the {}x{} frame; processing the whole frame",
+                     frameSize.width, frameSize.height);
         }
-        
-        // Filter out small regions that are likely noise
-        // Uses either adaptive or permissive threshold
-        if (area < adaptiveMinArea) {
-            areaFiltered++;
-            continue;
+        crop = frameRect;
+    }
+    
+    detectionSize = crop.size();
+    if (detectionScale < 1.0) {
+        detectionSize = cv::Size(std::max(1, cvRound(crop.width * detectionScale)),
+                                 std::max(1, cvRound(crop.height * detectionScale)));
+    }
+    contourAreaScale = static_cast<double>(crop.area()) / detectionSize.area();
+    
+    roiExcludedMask.release();
+    roiExcludedMaskFull.release();
+    blockExcluded.release();
+    deviceBuffers.excludedMask.release();
+    if (useRoi || !exclusionPolygons.empty()) {
+        cv::Mat excluded(frameSize, CV_8UC1, cv::Scalar(useRoi ? 255 : 0));
+        if (useRoi) {
+            cv::fillPoly(excluded, roiPolygons, cv::Scalar(0));
         }
-        
-        // Step 2: Shape Simplification (optional)
-        // Approximate the contour with fewer points
-        // Helps smooth out noisy edges while keeping shape
-        std::vector<cv::Point> approxContour = contour;
-        if (contourApproximation) {
-            // epsilon = how far points can deviate from original contour
-            // Larger epsilon = more simplification
-            double epsilon = contourEpsilonFactor * cv::arcLength(contour, true);
-            cv::approxPolyDP(contour, approxContour, epsilon, true);
+        if (!exclusionPolygons.empty()) {
+            cv::fillPoly(excluded, exclusionPolygons, cv::Scalar(255));
         }
-        
-        // Step 3: Convex Hull Analysis (optional)
-        // Checks how well the shape fills its convex hull
-        // Helps identify solid vs scattered motion regions
-        cv::Rect bounds;
-        double solidity = 1.0;  // Perfect solidity by default
-        
-        if (convexHull) {
-            // Calculate convex hull (smallest convex shape containing contour)
-            std::vector<cv::Point> hull;
-            cv::convexHull(approxContour, hull);
-            double hullArea = cv::contourArea(hull);
-            
-            // Solidity = contour area / hull area
-            // 1.0 = perfectly solid, < 1.0 = more scattered
-            solidity = (hullArea > 0) ? area / hullArea : 0;
-            
-            // Filter out scattered/irregular shapes
-            if (contourFiltering && solidity < adaptiveMinSolidity) {
-                solidityFiltered++;
-                continue;  // Skip to next contour
+        // Keep the mask only if something inside the crop is actually masked
+        if (cv::countNonZero(excluded(crop)) > 0) {
+            cv::resize(excluded(crop), roiExcludedMask, detectionSize, 0, 0, cv::INTER_NEAREST);
+            if (detectionRefinement && detectionSize != crop.size()) {
+                roiExcludedMaskFull = excluded(crop).clone();
             }
-            bounds = cv::boundingRect(hull);
-        } else {
-            bounds = cv::boundingRect(approxContour);
-        }
-        
-        // Step 4: Aspect Ratio Filter
-        // Check if the shape is too elongated
-        // Helps filter out things like shadows or reflections
-        double aspectRatio = static_cast<double>(bounds.width) / bounds.height;
-        if (contourFiltering && aspectRatio > adaptiveMaxAspectRatio) {
-            aspectRatioFiltered++;
-            continue;  // Skip to next contour
-        }
-        
-        // This contour has passed all our quality filters!
-        finalAccepted++;
-        newBounds.push_back(bounds);
-        
-        // Update visualization if enabled
-        if (visualizationEnabled) {
-            // 1. Contour Outline (Green)
-            // Redraw the contour in green to show it passed
-            cv::drawContours(debugViz, contours, i, cv::Scalar(0, 255, 0), 3);
-            
-            // 2. Bounding Box (Blue)
-            // Draw rectangle around the motion region
-            cv::rectangle(debugViz, bounds, cv::Scalar(255, 0, 0), 2);
-            
-            // 3. Statistics Label (White)
-            // Show key metrics for this region
-            std::string label = "A:" + std::to_string((int)area) + " S:" + std::to_string((int)(solidity*100)) + "%";
-            cv::putText(debugViz, label, cv::Point(bounds.x, bounds.y - 5), 
-                       cv::FONT_HERSHEY_SIMPLEX, 0.4, cv::Scalar(255, 255, 255), 1);
         }
     }
     
-    // Output motion boxes metadata for motion_region_consolidator
-    if (!newBounds.empty()) {
-        LOG_INFO("=== MOTION BOXES METADATA (Frame {}) ===", frameCount);
-        LOG_INFO("Detected {} motion regions", newBounds.size());
-        
-        for (size_t i = 0; i < newBounds.size(); ++i) {
-            const cv::Rect& bounds = newBounds[i];
-            double area = bounds.width * bounds.height;
-            double aspectRatio = static_cast<double>(bounds.width) / bounds.height;
-            cv::Point center(bounds.x + bounds.width / 2, bounds.y + bounds.height / 2);
-            
-            LOG_INFO("Motion Box {}: BBox({},{},{},{}) | Center({},{}) | Area: {:.0f} | Aspect: {:.2f}", 
-                    i,
-                    bounds.x, bounds.y, bounds.width, bounds.height,
-                    center.x, center.y,
-                    area, aspectRatio);
-        }
-        LOG_INFO("=== END MOTION BOXES METADATA ===");
+    const cv::Size referenceSize =
+        !previousFrames.empty() ? previousFrames.newest().size() : deviceBuffers.previous.size();
+    if (!referenceSize.empty() &&
+        (referenceSize != detectionSize || (!roiRect.empty() && crop != roiRect))) {
+        previousFrames.clear();
+        deviceBuffers.previous.release();
+        deviceBuffers.older.release();
+        firstFrame = true;
+        bgSubtractor.release();
+        cachedMotionThreshold = -1;
+        gateReference.release();
     }
     
-    // Save debug visualization if enabled
-    if (visualizationEnabled && !debugViz.empty() && (frameCount % 10 == 0 || totalContours > 0)) {
-        std::string debugPath = visualizationPath + "/debug_contours_frame_" + 
-                               std::to_string(frameCount) + ".jpg";
-        cv::imwrite(debugPath, debugViz);
-        LOG_INFO("Saved contour debug visualization to: {}", debugPath);
+    roiRect = crop;
+    roiFrameSize = frameSize;
+    LOG_INFO("Motion ROI: {}x{} at ({}, {}) of {}x{} frame, {} exclusion zones, "
+             "detecting at {}x{}", roiRect.width, roiRect.height, roiRect.x, roiRect.y,
+             frameSize.width, frameSize.height, exclusionPolygons.size(),
+             detectionSize.width, detectionSize.height);
+}
+
+/**
+ * Maps a box found on the detection frame back to full-frame coordinates:
+ * undo the detection scale (rounding outwards so the box still encloses the
+ * motion), clip to the ROI crop, then add the crop offset.
+ */
+cv::Rect MotionProcessor::toFrameCoordinates(const cv::Rect& detectionBounds) const {
+    if (detectionSize == roiRect.size()) {
+        return detectionBounds + roiRect.tl();
     }
-    
-    return newBounds;
+    const double scaleX = static_cast<double>(roiRect.width) / detectionSize.width;
+    const double scaleY = static_cast<double>(roiRect.height) / detectionSize.height;
+    const cv::Point topLeft(cvFloor(detectionBounds.x * scaleX), cvFloor(detectionBounds.y * scaleY));
+    const cv::Point bottomRight(cvCeil(detectionBounds.br().x * scaleX),
+                                cvCeil(detectionBounds.br().y * scaleY));
+    const cv::Rect bounds = cv::Rect(topLeft, bottomRight) & cv::Rect(cv::Point(), roiRect.size());
+    return bounds + roiRect.tl();
+}
+
+// Pixel centers map onto pixel centers: (p + 0.5) detection pixels from the crop's edge
+cv::Point2f MotionProcessor::toFrameCoordinates(const cv::Point2f& detectionPoint) const {
+    const float scaleX = static_cast<float>(roiRect.width) / detectionSize.width;
+    const float scaleY = static_cast<float>(roiRect.height) / detectionSize.height;
+    return cv::Point2f(roiRect.x + (detectionPoint.x + 0.5f) * scaleX - 0.5f,
+                       roiRect.y + (detectionPoint.y + 0.5f) * scaleY - 0.5f);
 }
 
 // ============================================================================
-// ADAPTIVE CONTOUR DETECTION METHODS
+// CONFIGURATION AND SETUP
 // ============================================================================
-// These functions analyze the current frame's contours to determine optimal
-// filtering thresholds. They help the system adapt to different scenes:
-// - Close-up scenes: Birds are large, use higher area thresholds
-// - Far-away scenes: Birds are small, use lower area thresholds
-// - Cluttered scenes: Many objects, use stricter shape filters
-// - Simple scenes: Few objects, can be more permissive
 
-/**
- * Calculate Adaptive Minimum Area Threshold
- * =========================================
- * Analyzes the size distribution of detected contours to determine
- * what size objects are "real" vs "noise" in the current scene.
- * 
- * Strategy:
- * - Collect all contour areas
- * - Sort them by size
- * - Use 10th percentile as minimum threshold
- * - This filters out the smallest 10% (likely noise)
- * 
- * Example:
- * If detected areas are: [20, 30, 45, 50, 200, 250, 300, 500, 800]
- * 10th percentile ≈ 45 pixels
- * So anything < 45 pixels is rejected as noise
- * 
- * Bounds: 50 - 1000 pixels (safety limits)
- * 
- * @param contours - All contours detected in current frame
- * @return Adaptive minimum area threshold in pixels
- */
-double MotionProcessor::calculateAdaptiveMinArea(const std::vector<std::vector<cv::Point>>& contours) {
-    if (contours.empty()) return permissiveMinArea;
-    
-    // Step 1: Calculate area of each contour
-    std::vector<double> areas;
-    for (const auto& contour : contours) {
-        double area = cv::contourArea(contour);
-        if (area > 0) areas.push_back(area);
+namespace {
+
+// Config string parsing; unknown names log a warning and keep the current value
+
+void parseProcessingMode(const std::string& name, MotionProcessor::ProcessingMode& mode) {
+    if (name == "grayscale") {
+        mode = MotionProcessor::ProcessingMode::GRAYSCALE;
+    } else if (name == "hsv") {
+        mode = MotionProcessor::ProcessingMode::HSV;
+    } else if (name == "rgb") {
+        mode = MotionProcessor::ProcessingMode::RGB;
+    } else if (name == "ycrcb") {
+        mode = MotionProcessor::ProcessingMode::YCRCB;
+    } else {
+        LOG_WARN("Unknown processing_mode '{}'; keeping '{}'", name, toString(mode));
     }
-    
-    if (areas.empty()) return minContourArea;
-    
-    // Step 2: Sort areas from smallest to largest
-    std::sort(areas.begin(), areas.end());
-    
-    // Step 3: Use 10th percentile as minimum
-    // This means we reject the smallest 10% as noise
-    size_t percentileIndex = static_cast<size_t>(areas.size() * 0.1);
-    double adaptiveMin = areas[percentileIndex];
-    
-    // Step 4: Apply safety bounds
-    // Never go below 50 (too noisy) or above 1000 (miss small birds)
-    adaptiveMin = std::max(50.0, std::min(1000.0, adaptiveMin));
-    
-    LOG_DEBUG("Adaptive min area: {:.0f} pixels (from {} contours)", adaptiveMin, areas.size());
-    
-    return adaptiveMin;
 }
 
-/**
- * Calculate Adaptive Minimum Solidity Threshold
- * =============================================
- * Determines how "solid" a shape needs to be to qualify as a real object.
- * Solidity = contour area / convex hull area
- * 
- * Solidity Examples:
- * - 1.0 = Perfect solid shape (circle, square)
- * - 0.8 = Mostly solid with small irregularities (typical bird)
- * - 0.5 = Very irregular, scattered shape (tree branches swaying)
- * - 0.2 = Extremely scattered (reflections, shadows)
- * 
- * Strategy:
- * - Calculate solidity for all reasonable-sized contours
- * - Use 25th percentile as minimum threshold
- * - This allows the least solid 25% but rejects very scattered shapes
- * 
- * Why 25th percentile?
- * - More permissive than area (birds can have irregular shapes)
- * - Still filters out obvious non-objects
- * 
- * Bounds: 0.2 - 0.8 (safety limits)
- * 
- * @param contours - All contours detected in current frame
- * @return Adaptive minimum solidity threshold (0.0 - 1.0)
- */
-double MotionProcessor::calculateAdaptiveMinSolidity(const std::vector<std::vector<cv::Point>>& contours) {
-    if (contours.empty()) return permissiveMinSolidity;
-    
-    // Step 1: Calculate solidity for each reasonable-sized contour
-    // Skip tiny contours (<100px) as they give unreliable solidity values
-    std::vector<double> solidities;
-    for (const auto& contour : contours) {
-        double area = cv::contourArea(contour);
-        if (area < 100) continue; // Skip tiny noise
-        
-        // Calculate convex hull (smallest convex shape containing contour)
-        std::vector<cv::Point> hull;
-        cv::convexHull(contour, hull);
-        double hullArea = cv::contourArea(hull);
-        
-        if (hullArea > 0) {
-            // Solidity = how much of the hull is filled by the contour
-            double solidity = area / hullArea;
-            solidities.push_back(solidity);
-        }
+void parseInputFormat(const std::string& name, MotionProcessor::InputFormat& format) {
+    if (name == "bgr") {
+        format = MotionProcessor::InputFormat::BGR;
+    } else if (name == "nv12") {
+        format = MotionProcessor::InputFormat::NV12;
+    } else if (name == "yuyv") {
+        format = MotionProcessor::InputFormat::YUYV;
+    } else {
+        LOG_WARN("Unknown input_format '{}'; keeping '{}'", name, toString(format));
     }
-    
-    if (solidities.empty()) return minContourSolidity;
-    
-    // Step 2: Sort solidities from lowest to highest
-    std::sort(solidities.begin(), solidities.end());
-    
-    // Step 3: Use 25th percentile as minimum
-    // Allows irregularly-shaped birds while filtering scattered noise
-    size_t percentileIndex = static_cast<size_t>(solidities.size() * 0.25);
-    double adaptiveMin = solidities[percentileIndex];
-    
-    // Step 4: Apply safety bounds
-    // Never go below 0.2 (too scattered) or above 0.8 (miss irregular birds)
-    adaptiveMin = std::max(0.2, std::min(0.8, adaptiveMin));
-    
-    LOG_DEBUG("Adaptive min solidity: {:.2f} (from {} contours)", adaptiveMin, solidities.size());
-    
-    return adaptiveMin;
 }
 
-/**
- * Calculate Adaptive Maximum Aspect Ratio Threshold
- * =================================================
- * Determines how elongated a shape can be before it's rejected.
- * Aspect Ratio = width / height
- * 
- * Aspect Ratio Examples:
- * - 1.0 = Perfect square
- * - 2.0 = Twice as wide as tall (typical bird in flight)
- * - 5.0 = Very elongated (possible bird gliding)
- * - 10.0+ = Extremely elongated (likely shadow, wire, artifact)
- * 
- * Strategy:
- * - Calculate aspect ratio for all reasonable-sized contours
- * - Use 90th percentile as maximum threshold
- * - This allows most shapes (90%) but filters extreme outliers
- * 
- * Why 90th percentile?
- * - Permissive enough to allow various bird poses
- * - Strict enough to filter obvious non-birds (wires, shadows)
- * 
- * Bounds: 2.0 - 15.0 (safety limits)
- * 
- * @param contours - All contours detected in current frame
- * @return Adaptive maximum aspect ratio threshold
- */
-double MotionProcessor::calculateAdaptiveMaxAspectRatio(const std::vector<std::vector<cv::Point>>& contours) {
-    if (contours.empty()) return permissiveMaxAspectRatio;
-    
-    // Step 1: Calculate aspect ratio for each reasonable-sized contour
-    // Skip tiny contours (<100px) as they give unreliable ratios
-    std::vector<double> aspectRatios;
-    for (const auto& contour : contours) {
-        double area = cv::contourArea(contour);
-        if (area < 100) continue; // Skip tiny noise
-        
-        // Get bounding rectangle
-        cv::Rect bounds = cv::boundingRect(contour);
-        if (bounds.width > 0 && bounds.height > 0) {
-            // Aspect ratio = width / height
-            // Note: Always >= 1.0 in our case (we could flip for consistency)
-            double aspectRatio = static_cast<double>(bounds.width) / bounds.height;
-            aspectRatios.push_back(aspectRatio);
-        }
+void parseClaheMode(const std::string& name, MotionProcessor::ClaheMode& mode) {
+    if (name == "full") {
+        mode = MotionProcessor::ClaheMode::FULL;
+    } else if (name == "cached") {
+        mode = MotionProcessor::ClaheMode::CACHED;
+    } else {
+        LOG_WARN("Unknown clahe_mode '{}'; keeping '{}'", name,
+                 mode == MotionProcessor::ClaheMode::FULL ? "full" : "cached");
     }
-    
-    if (aspectRatios.empty()) return maxContourAspectRatio;
-    
-    // Step 2: Sort aspect ratios from lowest to highest
-    std::sort(aspectRatios.begin(), aspectRatios.end());
-    
-    // Step 3: Use 90th percentile as maximum
-    // This keeps 90% of shapes and only filters extreme outliers
-    size_t percentileIndex = static_cast<size_t>(aspectRatios.size() * 0.9);
-    double adaptiveMax = aspectRatios[percentileIndex];
-    
-    // Step 4: Apply safety bounds
-    // Never go below 2.0 (too strict) or above 15.0 (allows obvious artifacts)
-    adaptiveMax = std::max(2.0, std::min(15.0, adaptiveMax));
-    
-    LOG_DEBUG("Adaptive max aspect ratio: {:.1f} (from {} contours)", adaptiveMax, aspectRatios.size());
-    
-    return adaptiveMax;
 }
 
-void MotionProcessor::setPrevFrame(const cv::Mat& frame) {
-    prevFrame = frame.clone();
+void parseThresholdMode(const std::string& name, MotionProcessor::ThresholdMode& mode) {
+    if (name == "otsu") {
+        mode = MotionProcessor::ThresholdMode::OTSU;
+    } else if (name == "cached") {
+        mode = MotionProcessor::ThresholdMode::CACHED;
+    } else {
+        LOG_WARN("Unknown threshold_mode '{}'; keeping '{}'", name,
+                 mode == MotionProcessor::ThresholdMode::OTSU ? "otsu" : "cached");
+    }
 }
 
-// ============================================================================
-// CONFIGURATION AND SETUP
-// ============================================================================
+void parseBlurType(const std::string& name, MotionProcessor::BlurType& type) {
+    if (name == "gaussian") {
+        type = MotionProcessor::BlurType::GAUSSIAN;
+    } else if (name == "median") {
+        type = MotionProcessor::BlurType::MEDIAN;
+    } else if (name == "bilateral") {
+        type = MotionProcessor::BlurType::BILATERAL;
+    } else if (name == "guided") {
+        type = MotionProcessor::BlurType::GUIDED;
+    } else if (name == "domain_transform") {
+        type = MotionProcessor::BlurType::DOMAIN_TRANSFORM;
+    } else if (name == "stack") {
+        type = MotionProcessor::BlurType::STACK;
+    } else if (name == "none") {
+        type = MotionProcessor::BlurType::NONE;
+    } else {
+        LOG_WARN("Unknown blur_type '{}'; keeping '{}'", name, toString(type));
+    }
+}
+
+void parseExtractionMethod(const std::string& name, MotionProcessor::ExtractionMethod& method) {
+    if (name == "contours") {
+        method = MotionProcessor::ExtractionMethod::CONTOURS;
+    } else if (name == "components") {
+        method = MotionProcessor::ExtractionMethod::COMPONENTS;
+    } else {
+        LOG_WARN("Unknown contour_extraction '{}'; keeping '{}'", name, toString(method));
+    }
+}
+
+void parseComputeBackend(const std::string& name, MotionProcessor::ComputeBackend& backend) {
+    if (name == "cpu") {
+        backend = MotionProcessor::ComputeBackend::CPU;
+    } else if (name == "opencl") {
+        backend = MotionProcessor::ComputeBackend::OPENCL;
+    } else {
+        LOG_WARN("Unknown compute_backend '{}'; keeping '{}'", name, toString(backend));
+    }
+}
+
+void parseBackgroundModel(const std::string& name, MotionProcessor::BackgroundModel& model) {
+    if (name == "mog2") {
+        model = MotionProcessor::BackgroundModel::MOG2;
+    } else if (name == "knn") {
+        model = MotionProcessor::BackgroundModel::KNN;
+    } else if (name == "running_average") {
+        model = MotionProcessor::BackgroundModel::RUNNING_AVERAGE;
+    } else if (name == "median") {
+        model = MotionProcessor::BackgroundModel::MEDIAN;
+    } else {
+        LOG_WARN("Unknown background_model '{}'; keeping '{}'", name, toString(model));
+    }
+}
+
+void parseDifferencingMode(const std::string& name, MotionProcessor::DifferencingMode& mode) {
+    if (name == "two_frame") {
+        mode = MotionProcessor::DifferencingMode::TWO_FRAME;
+    } else if (name == "three_frame") {
+        mode = MotionProcessor::DifferencingMode::THREE_FRAME;
+    } else {
+        LOG_WARN("Unknown frame_differencing '{}'; keeping '{}'", name, toString(mode));
+    }
+}
+
+void parseDetectionMethod(const std::string& name, MotionProcessor::DetectionMethod& method) {
+    if (name == "pixel") {
+        method = MotionProcessor::DetectionMethod::PIXEL;
+    } else if (name == "block") {
+        method = MotionProcessor::DetectionMethod::BLOCK;
+    } else {
+        LOG_WARN("Unknown detection_method '{}'; keeping '{}'", name, toString(method));
+    }
+}
+
+void parseContourMode(const std::string& name, MotionProcessor::ContourMode& mode) {
+    if (name == "adaptive") {
+        mode = MotionProcessor::ContourMode::ADAPTIVE;
+    } else if (name == "permissive") {
+        mode = MotionProcessor::ContourMode::PERMISSIVE;
+    } else {
+        LOG_WARN("Unknown contour_detection_mode '{}'; keeping '{}'", name, toString(mode));
+    }
+}
+
+// Reads polygons written as [[x, y], [x, y], ...]; polygons with fewer than
+// three points cannot enclose any pixels and are skipped
+std::vector<std::vector<cv::Point>> parsePolygons(const YAML::Node& node, const std::string& key) {
+    std::vector<std::vector<cv::Point>> polygons;
+    for (const auto& polygonNode : node) {
+        std::vector<cv::Point> polygon;
+        for (const auto& pointNode : polygonNode) {
+            polygon.emplace_back(pointNode[0].as<int>(), pointNode[1].as<int>());
+        }
+        if (polygon.size() < 3) {
+            LOG_WARN("Ignoring {} entry with {} points (need at least 3)", key, polygon.size());
+            continue;
+        }
+        polygons.push_back(std::move(polygon));
+    }
+    return polygons;
+}
+
+}  // namespace
 
-void MotionProcessor::loadConfig(const std::string& configPath) {
+void MotionProcessor::loadConfig(const PipelineConfig& pipeline) {
     try {
-        YAML::Node config = YAML::LoadFile(configPath);
+        const YAML::Node& config = pipeline.document();
 
         // ===============================
         // IMAGE PROCESSING
         // ===============================
-        if (config["processing_mode"]) processingMode = config["processing_mode"].as<std::string>();
+        if (config["processing_mode"]) parseProcessingMode(config["processing_mode"].as<std::string>(), processingMode);
+        if (config["input_format"]) parseInputFormat(config["input_format"].as<std::string>(), inputFormat);
+        if (config["compute_backend"]) parseComputeBackend(config["compute_backend"].as<std::string>(), computeBackend);
         
         // Image Preprocessing
         if (config["contrast_enhancement"]) contrastEnhancement = config["contrast_enhancement"].as<bool>();
         if (config["clahe_clip_limit"]) claheClipLimit = config["clahe_clip_limit"].as<double>();
         if (config["clahe_tile_size"]) claheTileSize = config["clahe_tile_size"].as<int>();
+        if (config["clahe_mode"]) parseClaheMode(config["clahe_mode"].as<std::string>(), claheMode);
+        if (config["clahe_update_interval"]) claheUpdateInterval = config["clahe_update_interval"].as<int>();
+        if (config["clahe_drift_limit"]) claheDriftLimit = config["clahe_drift_limit"].as<double>();
+        if (config["clahe_lut_scale"]) claheLutScale = config["clahe_lut_scale"].as<double>();
         
         // Blur Parameters
+        if (config["blur_type"]) parseBlurType(config["blur_type"].as<std::string>(), blurType);
         if (config["gaussian_blur_size"]) gaussianBlurSize = config["gaussian_blur_size"].as<int>();
         if (config["median_blur_size"]) medianBlurSize = config["median_blur_size"].as<int>();
         if (config["bilateral_d"]) bilateralD = config["bilateral_d"].as<int>();
         if (config["bilateral_sigma_color"]) bilateralSigmaColor = config["bilateral_sigma_color"].as<double>();
         if (config["bilateral_sigma_space"]) bilateralSigmaSpace = config["bilateral_sigma_space"].as<double>();
+        if (config["guided_subsample"]) guidedSubsample = config["guided_subsample"].as<int>();
 
         // ===============================
         // MOTION DETECTION
         // ===============================
+        if (config["detection_method"]) parseDetectionMethod(config["detection_method"].as<std::string>(), detectionMethod);
+        if (config["block_size"]) blockSize = std::max(1, config["block_size"].as<int>());
+        if (config["block_threshold"]) blockThreshold = std::clamp(config["block_threshold"].as<int>(), 0, 255);
+        if (config["block_history"]) blockHistory = std::max(2, config["block_history"].as<int>());
+        if (config["block_min_blocks"]) blockMinBlocks = std::max(1, config["block_min_blocks"].as<int>());
+        if (config["frame_differencing"]) parseDifferencingMode(config["frame_differencing"].as<std::string>(), differencingMode);
         if (config["background_subtraction"]) backgroundSubtraction = config["background_subtraction"].as<bool>();
+        if (config["background_model"]) parseBackgroundModel(config["background_model"].as<std::string>(), backgroundModel);
+        if (config["background_history"]) backgroundHistory = std::max(1, config["background_history"].as<int>());
+        if (config["background_var_threshold"]) backgroundVarThreshold = config["background_var_threshold"].as<double>();
+        if (config["background_knn_threshold"]) backgroundKnnThreshold = config["background_knn_threshold"].as<double>();
+        if (config["background_detect_shadows"]) backgroundDetectShadows = config["background_detect_shadows"].as<bool>();
+        if (config["background_fg_threshold"]) backgroundForegroundThreshold = std::clamp(config["background_fg_threshold"].as<int>(), 0, 255);
+        if (config["background_learning_rate"]) backgroundLearningRate = config["background_learning_rate"].as<double>();
+        if (config["background_update_interval"]) backgroundUpdateInterval = std::max(1, config["background_update_interval"].as<int>());
+        if (config["background_update_scale"]) backgroundUpdateScale = std::clamp(config["background_update_scale"].as<double>(), 0.05, 1.0);
         if (config["max_threshold"]) maxThreshold = config["max_threshold"].as<int>();
+        if (config["threshold_mode"]) parseThresholdMode(config["threshold_mode"].as<std::string>(), thresholdMode);
+        if (config["otsu_update_interval"]) otsuUpdateInterval = config["otsu_update_interval"].as<int>();
+        if (config["otsu_drift_limit"]) otsuDriftLimit = config["otsu_drift_limit"].as<double>();
+        if (config["min_motion_threshold"]) minMotionThreshold = std::clamp(config["min_motion_threshold"].as<int>(), 0, 255);
+        if (config["hysteresis_low_ratio"]) hysteresisLowRatio = std::clamp(config["hysteresis_low_ratio"].as<double>(), 0.0, 1.0);
+        if (config["reuse_buffers"]) reuseBuffers = config["reuse_buffers"].as<bool>();
+        if (config["tile_bands"]) tileBands = std::max(1, config["tile_bands"].as<int>());
+        if (config["occupancy_tile_size"]) setOccupancyTileSize(config["occupancy_tile_size"].as<int>());
+        if (config["occupancy_max_fraction"]) setOccupancyMaxFraction(config["occupancy_max_fraction"].as<double>());
+        if (config["roi_prediction"]) setRoiPrediction(config["roi_prediction"].as<bool>());
+        if (config["roi_prediction_margin"]) roiPredictionMargin = std::max(0, config["roi_prediction_margin"].as<int>());
+        if (config["roi_prediction_full_scan_interval"]) roiPredictionFullScanInterval = std::max(1, config["roi_prediction_full_scan_interval"].as<int>());
+        if (config["roi_prediction_trigger_samples"]) roiPredictionTriggerSamples = std::max(0, config["roi_prediction_trigger_samples"].as<int>());
+        if (config["roi_prediction_max_fraction"]) roiPredictionMaxFraction = std::clamp(config["roi_prediction_max_fraction"].as<double>(), 0.0, 1.0);
+        if (config["motion_gate"]) motionGate = config["motion_gate"].as<bool>();
+        if (config["motion_gate_pixel_delta"]) motionGatePixelDelta = config["motion_gate_pixel_delta"].as<int>();
+        if (config["motion_gate_min_pixels"]) motionGateMinPixels = config["motion_gate_min_pixels"].as<int>();
+        if (config["motion_gate_background_interval"]) motionGateBackgroundInterval = config["motion_gate_background_interval"].as<int>();
+        if (config["flood_guard"]) floodGuard = config["flood_guard"].as<bool>();
+        if (config["flood_motion_fraction"]) setFloodMotionFraction(config["flood_motion_fraction"].as<double>());
+        if (config["flood_compensate_shift"]) floodCompensateShift = config["flood_compensate_shift"].as<bool>();
+        if (config["flood_thumbnail_width"]) floodThumbnailWidth = std::max(16, config["flood_thumbnail_width"].as<int>());
+        if (config["flood_min_shift"]) floodMinShift = std::max(0.0, config["flood_min_shift"].as<double>());
+        if (config["flood_max_shift"]) floodMaxShift = std::max(0.0, config["flood_max_shift"].as<double>());
+        if (config["flood_min_response"]) floodMinResponse = config["flood_min_response"].as<double>();
+        if (config["detection_scale"]) setDetectionScale(config["detection_scale"].as<double>());
+        if (config["detection_refinement"]) setDetectionRefinement(config["detection_refinement"].as<bool>());
+        if (config["refinement_padding"]) setRefinementPadding(config["refinement_padding"].as<int>());
+        if (config["camera_id"]) cameraId = config["camera_id"].as<std::string>();
+        if (config["background_snapshot_dir"]) backgroundSnapshotDir = config["background_snapshot_dir"].as<std::string>();
+        if (config["background_snapshot_max_age_s"]) backgroundSnapshotMaxAgeSeconds = config["background_snapshot_max_age_s"].as<int>();
+        if (config["background_snapshot_interval_frames"]) backgroundSnapshotIntervalFrames = config["background_snapshot_interval_frames"].as<int>();
+        if (config["background_snapshot_max_diff"]) backgroundSnapshotMaxDiff = config["background_snapshot_max_diff"].as<double>();
+        if (config["roi_polygons"]) {
+            setRegionsOfInterest(parsePolygons(config["roi_polygons"], "roi_polygons"));
+        }
+        if (config["exclusion_polygons"]) {
+            setExclusionZones(parsePolygons(config["exclusion_polygons"], "exclusion_polygons"));
+        }
 
         // ===============================
         // MORPHOLOGICAL OPERATIONS
@@ -954,6 +2963,9 @@ void MotionProcessor::loadConfig(const std::string& configPath) {
         if (config["morph_open"]) morphOpen = config["morph_open"].as<bool>();
         if (config["dilation"]) dilation = config["dilation"].as<bool>();
         if (config["erosion"]) erosion = config["erosion"].as<bool>();
+        if (config["morph_approximate"]) morphApproximate = config["morph_approximate"].as<bool>();
+        if (config["packed_masks"]) packedMasks = config["packed_masks"].as<bool>();
+        if (config["motion_mask_rle"]) motionMaskRle = config["motion_mask_rle"].as<bool>();
 
         // ===============================
         // CONTOUR PROCESSING
@@ -962,23 +2974,315 @@ void MotionProcessor::loadConfig(const std::string& configPath) {
         if (config["contour_approximation"]) contourApproximation = config["contour_approximation"].as<bool>();
         if (config["contour_epsilon_factor"]) contourEpsilonFactor = config["contour_epsilon_factor"].as<double>();
         if (config["contour_filtering"]) contourFiltering = config["contour_filtering"].as<bool>();
+        if (config["contour_detection_mode"]) parseContourMode(config["contour_detection_mode"].as<std::string>(), contourMode);
+        if (config["contour_extraction"]) parseExtractionMethod(config["contour_extraction"].as<std::string>(), extractionMethod);
+        if (config["max_contours_per_frame"]) setMaxContoursPerFrame(config["max_contours_per_frame"].as<int>());
 
         // Contour Filtering Parameters
         if (config["min_contour_area"]) minContourArea = config["min_contour_area"].as<int>();
         if (config["max_contour_aspect_ratio"]) maxContourAspectRatio = config["max_contour_aspect_ratio"].as<double>();
         if (config["min_contour_solidity"]) minContourSolidity = config["min_contour_solidity"].as<double>();
+
+        // Debug artifacts (written in the background, shared by every processor)
+        if (config["debug_artifact_sample_every"]) {
+            DebugArtifactWriter::shared().setSampleEvery(config["debug_artifact_sample_every"].as<int>());
+        }
         
-        LOG_INFO("MotionProcessor config loaded: min_contour_area={}, background_subtraction={}", 
-                 minContourArea, backgroundSubtraction);
+        LOG_INFO("MotionProcessor config loaded: min_contour_area={}, background_subtraction={} ({})", 
+                 minContourArea, backgroundSubtraction, toString(backgroundModel));
         
     } catch (const YAML::Exception& e) {
-        LOG_ERROR("Warning: Could not load config file: {}. Error: {}", configPath, e.what());
+        LOG_ERROR("Warning: Could not apply config file: {}. Error: {}", pipeline.path(), e.what());
     }
+    if (computeBackend == ComputeBackend::OPENCL) {
+        if (cv::ocl::haveOpenCL()) {
+            cv::ocl::setUseOpenCL(true);
+            LOG_INFO("MotionProcessor running on OpenCL device: {}", cv::ocl::Device::getDefault().name());
+        } else {
+            LOG_WARN("compute_backend 'opencl' requested but no OpenCL device is available; using 'cpu'");
+            computeBackend = ComputeBackend::CPU;
+        }
+    }
+    previousFrames.setCapacity(differencingMode == DifferencingMode::THREE_FRAME ? 2 : 1);
+    motionHistory.updateConfig(pipeline.motionHistory);
+    if (!pipeline.motionHistory.enabled) motionHistory.reset();
+    rebuildCachedResources();
 }
 
-void MotionProcessor::initializeBackgroundSubtractor() {
-    if (backgroundSubtraction) {
-        bgSubtractor = cv::createBackgroundSubtractorMOG2();
-        LOG_INFO("Using Background Subtraction (MOG2)");
+/**
+ * Hot reload: re-reads the config file into the running processor.
+ * Keys missing from the file keep their current values; a file that fails
+ * validation is rejected as a whole and the running settings stay. The previous frame and
+ * the learned background model survive, so thresholds can be retuned live
+ * without a warm-up; the model is only dropped when background_subtraction is
+ * turned off or the model settings (type, history, thresholds, update scale) change.
+ */
+void MotionProcessor::reloadConfig(const std::string& configPath) {
+    std::shared_ptr<const PipelineConfig> config;
+    try {
+        config = PipelineConfig::load(configPath);
+    } catch (const std::invalid_argument& e) {
+        LOG_ERROR("Config reload rejected, keeping the running config: {}", e.what());
+        return;
+    }
+    reloadConfig(std::move(config));
+}
+
+void MotionProcessor::reloadConfig(std::shared_ptr<const PipelineConfig> config) {
+    if (!config) throw std::invalid_argument("MotionProcessor: reloadConfig() without a config");
+    const auto modelSettings = [this] {
+        return std::make_tuple(backgroundModel, backgroundHistory, backgroundVarThreshold, backgroundKnnThreshold,
+                               backgroundDetectShadows, backgroundForegroundThreshold, backgroundUpdateScale);
+    };
+    const ComputeBackend previousBackend = computeBackend;
+    const DifferencingMode previousDifferencing = differencingMode;
+    const auto previousModelSettings = modelSettings();
+    pipelineConfig = std::move(config);
+    loadConfig(*pipelineConfig);
+    if (differencingMode != previousDifferencing) {
+        deviceBuffers.older.release();  // Stopped rotating in TWO_FRAME mode
+    }
+    if (previousBackend == ComputeBackend::OPENCL && computeBackend == ComputeBackend::CPU) {
+        cv::Mat reference;  // Keep differencing against the last frame
+        deviceBuffers.previous.copyTo(reference);
+        previousFrames.clear();
+        previousFrames.push(reference);
+    }
+    if (computeBackend != ComputeBackend::OPENCL) {
+        deviceBuffers = DeviceBuffers();
+    }
+    if (!backgroundSubtraction || modelSettings() != previousModelSettings) {
+        bgSubtractor.release();
+    }
+    cachedMotionThreshold = -1;  // Recompute with the new settings
+    gateReference.release();     // Gate settings may have changed; resample on the next frame
+    LOG_INFO("MotionProcessor config reloaded from {}", pipelineConfig->path());
+}
+
+/**
+ * Builds the per-frame resources that depend only on configuration
+ * (CLAHE object, morphology kernel) so processFrame never recreates them.
+ * Only resources whose settings changed are rebuilt, so a hot reload that
+ * retunes thresholds leaves the CLAHE object and the morphology plan alone.
+ */
+void MotionProcessor::rebuildCachedResources() {
+    const auto claheSettings =
+        std::make_tuple(claheClipLimit, claheTileSize, claheLutScale, claheUpdateInterval, claheDriftLimit);
+    if (!clahe || claheSettings != builtClaheSettings) {
+        clahe = cv::createCLAHE(claheClipLimit, cv::Size(claheTileSize, claheTileSize));
+        cachedClahe = CachedClahe(claheClipLimit, claheTileSize, claheLutScale, claheUpdateInterval, claheDriftLimit);
+        builtClaheSettings = claheSettings;
+    }
+    // A new block size or history restarts the block background
+    const auto blockSettings = std::make_tuple(blockSize, blockHistory);
+    if (detectionMethod != DetectionMethod::BLOCK) {
+        blockMotion.reset();
+    } else if (!blockMotion || blockSettings != builtBlockSettings) {
+        blockMotion = std::make_unique<BlockMotionMap>(blockSize, blockHistory);
+        builtBlockSettings = blockSettings;
+        blockExcluded.release();
+    }
+    ContourFilter::Settings filterSettings;
+    filterSettings.approximation = contourApproximation;
+    filterSettings.epsilonFactor = contourEpsilonFactor;
+    filterSettings.solidity = convexHull;
+    filterSettings.shapeFilters = contourFiltering;
+    contourFilter = ContourFilter(filterSettings);
+    stackBlur = StackBlur(StackBlur::radiusForGaussian(gaussianBlurSize));
+    fixedGaussian.plan(gaussianBlurSize);  // Sizes it has no instance for stay on cv::GaussianBlur
+    // The guided and domain transform blurs take the bilateral filter's radius and colour sigma
+    const auto edgeMethod = blurType == BlurType::DOMAIN_TRANSFORM ? EdgePreservingFilter::Method::DOMAIN_TRANSFORM
+                                                                   : EdgePreservingFilter::Method::GUIDED;
+    edgeFilter = EdgePreservingFilter(edgeMethod, bilateralRadius(), bilateralSigmaColor, guidedSubsample);
+    const auto morphSettings =
+        std::make_tuple(morphKernelSize, morphClose, morphOpen, dilation, erosion, morphApproximate);
+    if (!morphKernel.empty() && morphSettings == builtMorphSettings) {
+        return;
+    }
+    builtMorphSettings = morphSettings;
+    morphKernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(morphKernelSize, morphKernelSize));
+
+    // Morphology plan: one elliptical kernel for every step (ellipse matches natural
+    // motion shapes better; morph_approximate swaps it for the square of the same size)
+    // 1. Close (dilate, erode): fills holes, connects broken contours
+    // 2. Open (erode, dilate): removes small noise blobs and thin connections
+    // 3. Dilate: expands regions, joins nearby motion
+    // 4. Erode: counters over-expansion, separates barely-connected regions
+    // Adjacent equal steps (close + open erodes twice in a row) merge into one pass.
+    using Op = MorphologyChain::Operation;
+    std::vector<Op> steps;
+    if (morphClose) steps.insert(steps.end(), {Op::DILATE, Op::ERODE});
+    if (morphOpen) steps.insert(steps.end(), {Op::ERODE, Op::DILATE});
+    if (dilation) steps.push_back(Op::DILATE);
+    if (erosion) steps.push_back(Op::ERODE);
+    morphChain.plan(steps, morphKernel, morphApproximate);
+    morphSteps = steps;  // The device path runs them one by one
+}
+
+bool MotionProcessor::initializeBackgroundSubtractor(const cv::Mat& firstFrame) {
+    if (!backgroundSubtraction) {
+        return false;
+    }
+    switch (backgroundModel) {
+        case BackgroundModel::MOG2:
+            bgSubtractor = cv::createBackgroundSubtractorMOG2(backgroundHistory, backgroundVarThreshold,
+                                                              backgroundDetectShadows);
+            break;
+        case BackgroundModel::KNN:
+            bgSubtractor = cv::createBackgroundSubtractorKNN(backgroundHistory, backgroundKnnThreshold,
+                                                             backgroundDetectShadows);
+            break;
+        case BackgroundModel::RUNNING_AVERAGE:
+            bgSubtractor = cv::makePtr<ApproximateBackgroundSubtractor>(
+                ApproximateBackgroundSubtractor::Method::RUNNING_AVERAGE, backgroundHistory,
+                backgroundForegroundThreshold);
+            break;
+        case BackgroundModel::MEDIAN:
+            bgSubtractor = cv::makePtr<ApproximateBackgroundSubtractor>(
+                ApproximateBackgroundSubtractor::Method::MEDIAN, backgroundHistory, backgroundForegroundThreshold);
+            break;
+    }
+    if (backgroundModelCreated) backgroundModelResets++;
+    backgroundModelCreated = true;
+    backgroundRestored = false;
+    framesSinceBackgroundUpdate = 0;
+    LOG_INFO("Using Background Subtraction ({}, history {}, learning rate {}, every {} frame(s) at {:.2f}x)",
+             toString(backgroundModel), backgroundHistory, backgroundLearningRate, backgroundUpdateInterval,
+             backgroundUpdateScale);
+
+    // Only the first model of the process is seeded; later ones follow a geometry change
+    cv::Mat snapshot;
+    std::swap(snapshot, pendingBackground);
+    if (snapshot.empty()) {
+        return false;
+    }
+    if (snapshot.size() != firstFrame.size() || snapshot.type() != firstFrame.type()) {
+        LOG_WARN("Background snapshot is {}x{}, frames are {}x{}; learning from scratch", snapshot.cols,
+                 snapshot.rows, firstFrame.cols, firstFrame.rows);
+        return false;
+    }
+    // A snapshot from another time of day (or a moved camera) would be worse than none
+    const double meanDiff = cv::norm(snapshot, firstFrame, cv::NORM_L1) /
+                            static_cast<double>(firstFrame.total() * firstFrame.channels());
+    if (meanDiff > backgroundSnapshotMaxDiff) {
+        LOG_WARN("Background snapshot is {:.1f} gray levels from the scene (max {:.1f}); learning from scratch",
+                 meanDiff, backgroundSnapshotMaxDiff);
+        return false;
+    }
+    cv::Mat mask;
+    applyBackgroundModel(snapshot, mask, 1.0);  // Every pixel starts as the snapshot's background
+    backgroundRestored = true;
+    LOG_INFO("Background model restored from snapshot ({:.1f} gray levels from the scene)", meanDiff);
+    return true;
+}
+
+void MotionProcessor::applyBackgroundModel(cv::InputArray frame, cv::OutputArray mask, double learningRate) {
+    if (backgroundUpdateScale >= 1.0) {
+        bgSubtractor->apply(frame, mask, learningRate);
+        return;
+    }
+    // Learn on an area-averaged copy; nearest-neighbour upscaling keeps the mask binary
+    // (and MOG2/KNN shadows at 127)
+    const cv::Size frameSize = frame.size();
+    cv::resize(frame, backgroundSmallFrame, cv::Size(), backgroundUpdateScale, backgroundUpdateScale,
+               cv::INTER_AREA);
+    bgSubtractor->apply(backgroundSmallFrame, backgroundSmallMask, learningRate);
+    cv::resize(backgroundSmallMask, mask, frameSize, 0, 0, cv::INTER_NEAREST);
+}
+
+bool MotionProcessor::backgroundUpdateDue(const cv::Size& frameSize, const cv::Size& maskSize) {
+    if (maskSize != frameSize || ++framesSinceBackgroundUpdate >= backgroundUpdateInterval) {
+        framesSinceBackgroundUpdate = 0;
+        return true;
+    }
+    return false;
+}
+
+std::string MotionProcessor::getBackgroundSnapshotPath() const {
+    if (backgroundSnapshotDir.empty()) {
+        return "";
+    }
+    std::string key = cameraId;
+    std::replace_if(key.begin(), key.end(), [](unsigned char c) { return !std::isalnum(c) && c != '-'; }, '_');
+    return (fs::path(backgroundSnapshotDir) / ("background_" + key + ".yml.gz")).string();
+}
+
+void MotionProcessor::loadBackgroundSnapshot() {
+    pendingBackground.release();
+    if (backgroundSnapshotDir.empty() || !backgroundSubtraction) {
+        return;
+    }
+    const std::string path = getBackgroundSnapshotPath();
+    if (!fs::exists(path)) {
+        LOG_INFO("No background snapshot at {}; learning the background from scratch", path);
+        return;
+    }
+    try {
+        cv::FileStorage storage(path, cv::FileStorage::READ);
+        std::string mode;
+        double savedAt = 0.0;
+        cv::Mat background;
+        storage["processing_mode"] >> mode;
+        storage["saved_at"] >> savedAt;
+        storage["background"] >> background;
+
+        const double now = std::chrono::duration<double>(
+                               std::chrono::system_clock::now().time_since_epoch()).count();
+        const double ageSeconds = now - savedAt;
+        if (mode != toString(processingMode) || background.empty()) {
+            LOG_WARN("Background snapshot {} was saved in {} mode; ignoring it", path, mode);
+        } else if (backgroundSnapshotMaxAgeSeconds > 0 && ageSeconds > backgroundSnapshotMaxAgeSeconds) {
+            LOG_INFO("Background snapshot {} is {:.0f} s old (max {} s); ignoring it", path, ageSeconds,
+                     backgroundSnapshotMaxAgeSeconds);
+        } else {
+            pendingBackground = background;
+            LOG_INFO("Loaded {}x{} background snapshot {} ({:.0f} s old)", background.cols, background.rows, path,
+                     ageSeconds);
+        }
+    } catch (const cv::Exception& e) {
+        LOG_WARN("Cannot read background snapshot {}: {}", path, e.what());
+    }
+}
+
+cv::Mat MotionProcessor::getBackgroundImage() const {
+    cv::Mat background;
+    if (bgSubtractor.empty()) {
+        return background;
+    }
+    bgSubtractor->getBackgroundImage(background);
+    if (!background.empty() && background.size() != detectionSize && !detectionSize.empty()) {
+        // Model learns at background_update_scale; snapshots are compared at detection size
+        cv::resize(background, background, detectionSize, 0, 0, cv::INTER_LINEAR);
+    }
+    return background;
+}
+
+bool MotionProcessor::saveBackgroundSnapshot() const {
+    if (backgroundSnapshotDir.empty()) {
+        return false;
+    }
+    const cv::Mat background = getBackgroundImage();
+    if (background.empty()) {
+        return false;
+    }
+
+    const std::string path = getBackgroundSnapshotPath();
+    // Written next to the snapshot and renamed over it, so a crash mid-write keeps the old one
+    const std::string tempPath = path.substr(0, path.size() - std::string(".yml.gz").size()) + ".tmp.yml.gz";
+    try {
+        fs::create_directories(backgroundSnapshotDir);
+        cv::FileStorage storage(tempPath, cv::FileStorage::WRITE | cv::FileStorage::BASE64);
+        storage << "camera_id" << cameraId;
+        storage << "saved_at"
+                << std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+        storage << "processing_mode" << toString(processingMode);
+        storage << "background" << background;
+        storage.release();
+        fs::rename(tempPath, path);
+    } catch (const std::exception& e) {
+        LOG_WARN("Cannot write background snapshot {}: {}", path, e.what());
+        return false;
     }
+    LOG_DEBUG("Saved {}x{} background snapshot to {}", background.cols, background.rows, path);
+    return true;
 }
@@ -1,36 +1,72 @@
 #include "motion_region_consolidator.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <filesystem>
+#include <iterator>
 #include <limits>
 #include <map>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "debug_artifact_writer.hpp"
 #include "logger.hpp"
 
 namespace fs = std::filesystem;
 
 MotionRegionConsolidator::MotionRegionConsolidator(const ConsolidationConfig& config)
-    : config_(config), frameCounter_(0) {
+    : config_(config), frameCounter_(0), trace_(static_cast<size_t>(std::max(0, config.clusteringTraceCapacity))) {
+    resolveRelativeParameters();
     LOG_INFO("MotionRegionConsolidator initialized with config");
 }
 
-std::vector<std::vector<int>> MotionRegionConsolidator::dbscanClustering(
-    const std::vector<TrackedObject>& objects) {
-    const size_t n = objects.size();
-    std::vector<int> labels(n, -1);  // -1 = unvisited, -2 = noise, >= 0 = cluster ID
-    std::vector<std::vector<int>> clusters;
+MotionRegionConsolidator::Clusters MotionRegionConsolidator::dbscanClustering(
+    const ObjectBoxes& objects, std::pmr::memory_resource* scratch) {
+    LOG_DEBUG_LIMITED("Starting DBSCAN clustering for {} objects with eps={}, minPts={}", objects.size(),
+                      config_.eps, config_.minPts);
+
+    // Every pairwise distance is evaluated once, up front
+    const NeighborTable table = buildNeighborTable(objects, scratch);
+    LOG_DEBUG_LIMITED("DBSCAN neighbor table: {} neighbor pairs", table.neighbors.size() / 2);
+
+    Clusters clusters = config_.unionFindClustering ? unionFindClusters(table, scratch)
+                                                    : expandClusters(table, scratch);
+
+    LOG_DEBUG_LIMITED("DBSCAN clustering completed: {} clusters found", clusters.size());
+
+    // Log cluster information (one frame's clusters at most at the diagnostic rate; the
+    // pairwise decisions behind them go to the clustering trace)
+    if (LOG_DEBUG_SAMPLE()) {
+        for (size_t i = 0; i < clusters.size(); ++i) {
+            LOG_DEBUG("Cluster {}: {} objects", i, clusters[i].size());
+        }
+    }
+
+    return clusters;
+}
+
+// Textbook DBSCAN: grow each cluster from an unvisited core point through a queue of neighbors
+MotionRegionConsolidator::Clusters MotionRegionConsolidator::expandClusters(
+    const NeighborTable& table, std::pmr::memory_resource* scratch) const {
+    const size_t n = table.offsets.size() - 1;
+    IndexList labels(n, -1, scratch);  // -1 = unvisited, -2 = noise, >= 0 = cluster ID
+    Clusters clusters(scratch);
     int clusterId = 0;
 
-    LOG_DEBUG("Starting DBSCAN clustering for {} objects with eps={}, minPts={}", n, config_.eps,
-              config_.minPts);
+    // queuedFor[k] == clusterId when k is already in the current cluster's neighbor list
+    IndexList queuedFor(n, -1, scratch);
 
     for (size_t i = 0; i < n; ++i) {
         if (labels[i] != -1) continue;  // Already processed
 
-        // Find all neighbors within eps distance
-        std::vector<int> neighbors = rangeQuery(objects, static_cast<int>(i), config_.eps);
+        // All neighbors within eps distance
+        const int point = static_cast<int>(i);
+        IndexList neighbors(table.begin(point), table.end(point), scratch);
 
         if (neighbors.size() < static_cast<size_t>(config_.minPts)) {
             labels[i] = -2;  // Mark as noise
@@ -38,9 +74,10 @@ std::vector<std::vector<int>> MotionRegionConsolidator::dbscanClustering(
         }
 
         // Start a new cluster
-        std::vector<int> cluster;
+        IndexList cluster(scratch);
         labels[i] = clusterId;
-        cluster.push_back(static_cast<int>(i));
+        cluster.push_back(point);
+        for (int neighborIdx : neighbors) queuedFor[neighborIdx] = clusterId;
 
         // Process all neighbors
         for (size_t j = 0; j < neighbors.size(); ++j) {
@@ -55,48 +92,438 @@ std::vector<std::vector<int>> MotionRegionConsolidator::dbscanClustering(
                 labels[neighborIdx] = clusterId;
                 cluster.push_back(neighborIdx);
 
-                // Find neighbors of this neighbor
-                std::vector<int> neighborNeighbors = rangeQuery(objects, neighborIdx, config_.eps);
-                if (neighborNeighbors.size() >= static_cast<size_t>(config_.minPts)) {
-                    // Add new neighbors to the list for processing
-                    for (int newNeighbor : neighborNeighbors) {
-                        if (std::find(neighbors.begin(), neighbors.end(), newNeighbor) ==
-                            neighbors.end()) {
-                            neighbors.push_back(newNeighbor);
+                // Add this neighbor's neighbors if it is a core point
+                if (table.degree(neighborIdx) >= static_cast<size_t>(config_.minPts)) {
+                    for (const int* it = table.begin(neighborIdx); it != table.end(neighborIdx);
+                         ++it) {
+                        if (queuedFor[*it] != clusterId) {
+                            queuedFor[*it] = clusterId;
+                            neighbors.push_back(*it);
                         }
                     }
                 }
             }
         }
 
-        clusters.push_back(cluster);
+        // Members in ascending index order, as unionFindClusters() lists them
+        std::sort(cluster.begin(), cluster.end());
+        clusters.push_back(std::move(cluster));
         clusterId++;
     }
+    return clusters;
+}
 
-    LOG_DEBUG("DBSCAN clustering completed: {} clusters found", clusters.size());
-
-    // Log cluster information
-    for (size_t i = 0; i < clusters.size(); ++i) {
-        LOG_DEBUG("Cluster {}: {} objects", i, clusters[i].size());
+/**
+ * The clusters of expandClusters() without its queue. Core points (at least minPts
+ * neighbors) joined by an edge end up in one cluster: a union-find over the core-core
+ * edges, each root being the smallest index of its set. expandClusters() starts clusters
+ * at the lowest unvisited core point, so clusters are numbered by their root. A border
+ * point (not core, next to a core point) is claimed by the first cluster that reaches
+ * it, the lowest numbered among its core neighbors; a point with no core neighbor is
+ * noise. With minPts <= 1 every point with a neighbor is core and the clusters are the
+ * connected components of the neighbor graph.
+ */
+MotionRegionConsolidator::Clusters MotionRegionConsolidator::unionFindClusters(
+    const NeighborTable& table, std::pmr::memory_resource* scratch) const {
+    const int n = static_cast<int>(table.offsets.size()) - 1;
+    const size_t minPts = static_cast<size_t>(config_.minPts);  // As expandClusters() compares it
+    auto isCore = [&](int i) { return table.degree(i) >= minPts; };
+
+    IndexList parent(n, 0, scratch);
+    for (int i = 0; i < n; ++i) parent[i] = i;
+    auto find = [&](int i) {
+        while (parent[i] != i) {
+            parent[i] = parent[parent[i]];  // Path halving
+            i = parent[i];
+        }
+        return i;
+    };
+    if (parallelClustering(n)) {
+        // Lock-free union: a root is only ever linked below a smaller root, by compare-and-swap,
+        // so the sets and their roots (the smallest index) do not depend on the thread schedule
+        std::vector<std::atomic<int>> shared(n);
+        for (int i = 0; i < n; ++i) shared[i].store(i, std::memory_order_relaxed);
+        auto findShared = [&](int i) {
+            int up = shared[i].load(std::memory_order_relaxed);
+            while (up != i) {
+                const int grandparent = shared[up].load(std::memory_order_relaxed);
+                int expected = up;
+                shared[i].compare_exchange_weak(expected, grandparent, std::memory_order_relaxed);
+                i = grandparent;
+                up = shared[i].load(std::memory_order_relaxed);
+            }
+            return i;
+        };
+        cv::parallel_for_(cv::Range(0, n), [&](const cv::Range& range) {
+            for (int i = range.start; i < range.end; ++i) {
+                if (!isCore(i)) continue;
+                for (const int* it = table.begin(i); it != table.end(i); ++it) {
+                    if (*it > i || !isCore(*it)) continue;  // Each edge once
+                    int a = findShared(i);
+                    int b = findShared(*it);
+                    while (a != b) {
+                        if (a < b) std::swap(a, b);
+                        int expected = a;
+                        if (shared[a].compare_exchange_strong(expected, b, std::memory_order_relaxed)) break;
+                        a = findShared(a);  // Linked by another thread meanwhile
+                        b = findShared(b);
+                    }
+                }
+            }
+        });
+        for (int i = 0; i < n; ++i) parent[i] = shared[i].load(std::memory_order_relaxed);
+    } else {
+        for (int i = 0; i < n; ++i) {
+            if (!isCore(i)) continue;
+            for (const int* it = table.begin(i); it != table.end(i); ++it) {
+                if (*it > i || !isCore(*it)) continue;  // Each edge once
+                const int a = find(i);
+                const int b = find(*it);
+                if (a != b) parent[std::max(a, b)] = std::min(a, b);
+            }
+        }
     }
 
+    // Cluster number of every root, in ascending root order
+    IndexList clusterOf(n, -1, scratch);
+    Clusters clusters(scratch);
+    for (int i = 0; i < n; ++i) {
+        if (isCore(i) && find(i) == i) {
+            clusterOf[i] = static_cast<int>(clusters.size());
+            clusters.emplace_back();  // Allocates from scratch, like its parent
+        }
+    }
+    for (int i = 0; i < n; ++i) {
+        int cluster = -1;
+        if (isCore(i)) {
+            cluster = clusterOf[find(i)];
+        } else {
+            for (const int* it = table.begin(i); it != table.end(i); ++it) {
+                if (!isCore(*it)) continue;
+                const int candidate = clusterOf[find(*it)];
+                if (cluster < 0 || candidate < cluster) cluster = candidate;
+            }
+        }
+        if (cluster >= 0) clusters[cluster].push_back(i);
+    }
     return clusters;
 }
 
-std::vector<int> MotionRegionConsolidator::rangeQuery(const std::vector<TrackedObject>& objects,
-                                                      int pointIdx, double eps) {
-    std::vector<int> neighbors;
+bool MotionRegionConsolidator::parallelClustering(int boxCount) const {
+    return config_.parallelClusteringMinBoxes > 0 && boxCount >= config_.parallelClusteringMinBoxes;
+}
+
+MotionRegionConsolidator::NeighborTable MotionRegionConsolidator::buildNeighborTable(
+    const ObjectBoxes& objects, std::pmr::memory_resource* scratch) {
+    switch (config_.distanceMetric) {
+        case DistanceMetric::EdgeGap:
+            return buildNeighborTableWith<EdgeGapDistance>(objects, scratch);
+        case DistanceMetric::CenterChebyshev:
+            return buildNeighborTableWith<CenterChebyshevDistance>(objects, scratch);
+        case DistanceMetric::Iou:
+            return buildNeighborTableWith<IouDistance>(objects, scratch);
+        case DistanceMetric::OverlapEdge:
+            break;
+    }
+    return buildNeighborTableWith<OverlapEdgeDistance>(objects, scratch);
+}
+
+template <typename Distance>
+MotionRegionConsolidator::NeighborTable MotionRegionConsolidator::buildNeighborTableWith(
+    const ObjectBoxes& objects, std::pmr::memory_resource* scratch) {
+    const int n = static_cast<int>(objects.size());
+
+    // The integer neighbor test is a form of the OverlapEdge metric only
+    const bool integerGeometry = config_.integerGeometry && std::is_same_v<Distance, OverlapEdgeDistance>;
+    const std::vector<cv::Rect>& rects = objects.bounds;
+    const BoxArrays boxes = integerGeometry ? BoxArrays() : BoxArrays(rects);
+    const BoxDistanceParams params = distanceParams();
+
+    // The policy bounds how far apart (on both axes) a pair within eps can be; the grid
+    // index then only has to yield pairs within that reach. Without a bound every pair is
+    // scanned.
+    std::unique_ptr<BoxGridIndex> index;
+    const double reach = Distance::neighborReach(params, config_.eps);
+    if (config_.useSpatialIndex && n > 1 && reach >= 0.0) {
+        index = std::make_unique<BoxGridIndex>(rects, gridCellSize(rects, reach));
+    }
 
+    // Center-distance pre-filter in doubled integer coordinates (no floating point per pair)
+    const double centerReach = config_.maxDistanceThreshold * frameDiagonal();
+    const long long reachSquared4 =
+        centerReach > 0.0 ? static_cast<long long>(4.0 * centerReach * centerReach) : 0;
+    auto withinReach = [&](int i, int j) {
+        if (reachSquared4 == 0) return true;
+        const long long dx = 2LL * (rects[i].x - rects[j].x) + rects[i].width - rects[j].width;
+        const long long dy = 2LL * (rects[i].y - rects[j].y) + rects[i].height - rects[j].height;
+        return dx * dx + dy * dy <= reachSquared4;
+    };
+
+    // IDs key the incremental cache, so they must be unique within the frame
+    std::pmr::unordered_map<int, int> idToIndex(scratch);
+    bool uniqueIds = config_.incrementalClustering;
+    if (uniqueIds) {
+        idToIndex.reserve(objects.size());
+        for (int i = 0; i < n && uniqueIds; ++i) {
+            uniqueIds = idToIndex.emplace(objects.ids[i], i).second;
+        }
+        if (!uniqueIds) {
+            LOG_DEBUG("Duplicate object IDs; incremental clustering falls back to a full rebuild");
+        }
+    }
+
+    // Step 1: Collect neighbor pairs (i < j). In incremental mode, pairs between unchanged
+    // boxes come from the cache and only rows of changed boxes are evaluated.
+    std::pmr::vector<std::pair<int, int>> pairs(scratch);
+    std::pmr::vector<char> changed(scratch);
+    const bool incremental = uniqueIds && seedPairsFromCache(objects, idToIndex, changed, pairs);
+    const size_t seededPairs = pairs.size();
+
+    // Each pair is evaluated once: a full rebuild only looks ahead, an incremental row looks
+    // at every unchanged box and at changed boxes further ahead
+    auto evaluates = [&](int i, int j) {
+        return j > i || (incremental && j != i && !changed[j]);
+    };
+    const IntegerNeighborTest integerTest(params, config_.eps);
+    auto neighbors = [&](int i, int j) {
+        return integerGeometry ? integerTest(rects[i], rects[j])
+                               : Distance::distance(boxes, i, j, params) <= config_.eps;
+    };
+    // Decisions of pairs that reached the distance test go to the trace when it is on;
+    // parallel rows collect theirs in @p stripe, appended to the trace in row order
+    const bool tracing = trace_.isEnabled();
+    const uint32_t traceFrame = static_cast<uint32_t>(frameCounter_);
+    auto traceDecision = [&](int i, int j, double distance, bool neighbor,
+                             std::vector<ClusteringTraceRecord>* stripe) {
+        const ClusteringTraceRecord record =
+            ClusteringTrace::makeRecord(traceFrame, objects.ids[i], objects.ids[j], distance, neighbor);
+        if (stripe) {
+            stripe->push_back(record);
+        } else {
+            trace_.add(record);
+        }
+    };
+    auto pairDistance = [&](int i, int j) {
+        return integerGeometry ? std::numeric_limits<double>::quiet_NaN() : Distance::distance(boxes, i, j, params);
+    };
+    // Pairs of row i, appended to @p out; @p distances holds a dense row
+    auto evaluateRow = [&](int i, auto& out, double* distances, std::vector<ClusteringTraceRecord>* stripeTrace) {
+        if (incremental && !changed[i]) return;
+        if (index) {
+            for (int j : index->query(rects[i], reach, i)) {
+                if (!evaluates(i, j) || !withinReach(i, j)) continue;
+                const bool neighbor = neighbors(i, j);
+                if (tracing) traceDecision(i, j, pairDistance(i, j), neighbor, stripeTrace);
+                if (neighbor) out.emplace_back(std::min(i, j), std::max(i, j));
+            }
+        } else if (integerGeometry) {
+            for (int j = incremental ? 0 : i + 1; j < n; ++j) {
+                if (!evaluates(i, j) || !withinReach(i, j)) continue;
+                const bool neighbor = integerTest(rects[i], rects[j]);
+                if (tracing) traceDecision(i, j, pairDistance(i, j), neighbor, stripeTrace);
+                if (neighbor) out.emplace_back(std::min(i, j), std::max(i, j));
+            }
+        } else {
+            // Dense row: one SIMD batch over every box the row has to look at
+            const int first = incremental ? 0 : i + 1;
+            Distance::batch(boxes, i, first, n, params, distances);
+            for (int j = first; j < n; ++j) {
+                if (!evaluates(i, j)) continue;
+                const bool neighbor = distances[j - first] <= config_.eps && withinReach(i, j);
+                if (tracing) traceDecision(i, j, distances[j - first], neighbor, stripeTrace);
+                if (neighbor) out.emplace_back(std::min(i, j), std::max(i, j));
+            }
+        }
+    };
+    if (parallelClustering(n)) {
+        // Rows in stripes, each with its own pair list (on the heap: the frame's scratch
+        // resource is not thread-safe); concatenated in stripe order, as the serial loop
+        const int stripes = std::min(n, 4 * std::max(1, cv::getNumThreads()));
+        std::vector<std::vector<std::pair<int, int>>> stripePairs(stripes);
+        std::vector<std::vector<ClusteringTraceRecord>> stripeTraces(tracing ? stripes : 0);
+        cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range& range) {
+            std::vector<double> distances(integerGeometry ? 0 : n);
+            for (int stripe = range.start; stripe < range.end; ++stripe) {
+                std::vector<ClusteringTraceRecord>* stripeTrace = tracing ? &stripeTraces[stripe] : nullptr;
+                const int end = static_cast<int>(static_cast<long long>(n) * (stripe + 1) / stripes);
+                for (int i = static_cast<int>(static_cast<long long>(n) * stripe / stripes); i < end; ++i) {
+                    evaluateRow(i, stripePairs[stripe], distances.data(), stripeTrace);
+                }
+            }
+        });
+        for (const auto& part : stripePairs) pairs.insert(pairs.end(), part.begin(), part.end());
+        for (const auto& part : stripeTraces) {
+            for (const auto& record : part) trace_.add(record);
+        }
+    } else {
+        std::pmr::vector<double> distances(integerGeometry ? 0 : n, scratch);
+        for (int i = 0; i < n; ++i) evaluateRow(i, pairs, distances.data(), nullptr);
+    }
+    if (incremental) {
+        // Restore ascending (i, j) order so rows come out sorted like a full rebuild
+        std::sort(pairs.begin(), pairs.end());
+        LOG_DEBUG("Incremental DBSCAN: {} cached pairs, {} changed boxes re-evaluated",
+                  seededPairs, std::count(changed.begin(), changed.end(), 1));
+    }
+
+    // Step 2: Symmetric CSR fill
+    NeighborTable table(scratch);
+    table.offsets.assign(n + 1, 0);
+    for (const auto& [i, j] : pairs) {
+        table.offsets[i + 1]++;
+        table.offsets[j + 1]++;
+    }
+    for (int i = 0; i < n; ++i) table.offsets[i + 1] += table.offsets[i];
+    table.neighbors.resize(table.offsets[n]);
+    IndexList cursor(table.offsets.begin(), table.offsets.end() - 1, scratch);
+    for (const auto& [i, j] : pairs) {
+        table.neighbors[cursor[i]++] = j;
+        table.neighbors[cursor[j]++] = i;
+    }
+
+    if (uniqueIds) {
+        storeNeighborCache(objects, table);
+    } else {
+        clearNeighborCache();
+    }
+    return table;
+}
+
+bool MotionRegionConsolidator::seedPairsFromCache(const ObjectBoxes& objects,
+                                                  const std::pmr::unordered_map<int, int>& idToIndex,
+                                                  std::pmr::vector<char>& changed,
+                                                  std::pmr::vector<std::pair<int, int>>& pairs) const {
+    // A box is unchanged when its ID was seen last frame with exactly the same bounds; the
+    // distance between two unchanged boxes is then unchanged too
+    const size_t n = objects.size();
+    changed.assign(n, 1);
+    size_t unchanged = 0;
+    for (size_t i = 0; i < n; ++i) {
+        auto it = cachedBounds_.find(objects.ids[i]);
+        if (it != cachedBounds_.end() && it->second == objects.bounds[i]) {
+            changed[i] = 0;
+            ++unchanged;
+        }
+    }
+    if (unchanged == 0) return false;  // Nothing to reuse; a full rebuild is cheaper
+
+    for (size_t i = 0; i < n; ++i) {
+        if (changed[i]) continue;
+        for (int neighborId : cachedNeighbors_.at(objects.ids[i])) {
+            auto it = idToIndex.find(neighborId);
+            if (it != idToIndex.end() && !changed[it->second] &&
+                static_cast<size_t>(it->second) > i) {
+                pairs.emplace_back(static_cast<int>(i), it->second);
+            }
+        }
+    }
+    return true;
+}
+
+void MotionRegionConsolidator::storeNeighborCache(const ObjectBoxes& objects,
+                                                  const NeighborTable& table) {
+    clearNeighborCache();
+    cachedBounds_.reserve(objects.size());
+    cachedNeighbors_.reserve(objects.size());
     for (size_t i = 0; i < objects.size(); ++i) {
-        if (static_cast<int>(i) == pointIdx) continue;
+        const int point = static_cast<int>(i);
+        cachedBounds_.emplace(objects.ids[i], objects.bounds[i]);
+        std::vector<int>& neighborIds = cachedNeighbors_[objects.ids[i]];
+        neighborIds.reserve(table.degree(point));
+        for (const int* it = table.begin(point); it != table.end(point); ++it) {
+            neighborIds.push_back(objects.ids[*it]);
+        }
+    }
+}
 
-        double distance = calculateOverlapAwareDistance(objects[pointIdx], objects[i]);
-        if (distance <= eps) {
-            neighbors.push_back(static_cast<int>(i));
+double MotionRegionConsolidator::gridCellSize(const std::vector<cv::Rect>& rects, double reach) const {
+    const double cellSize = config_.gridCellSize * frameDiagonal();
+    if (cellSize > 0.0 || rects.empty()) return cellSize;
+    double extentSum = 0.0;
+    for (const auto& rect : rects) extentSum += std::max(rect.width, rect.height);
+    return std::max(reach, extentSum / static_cast<double>(rects.size()));
+}
+
+/**
+ * Cutting the tree at a level replays its merges up to that distance, so the levels share
+ * the pair evaluation: the edges are every pair within the largest cut, found like the
+ * DBSCAN neighbor table's (grid index when the metric bounds the reach, dense SIMD rows
+ * otherwise) but keeping the distance instead of an eps decision.
+ */
+void MotionRegionConsolidator::buildRegionLevels(const ObjectBoxes& objects, std::pmr::memory_resource* scratch) {
+    const std::vector<double>& levels = config_.hierarchyLevels;
+    const double maxDistance = *std::max_element(levels.begin(), levels.end()) * config_.eps;
+    mergeEdges_.clear();
+    if (objects.size() > 1) {
+        switch (config_.distanceMetric) {
+            case DistanceMetric::EdgeGap:
+                collectMergeEdges<EdgeGapDistance>(objects, maxDistance);
+                break;
+            case DistanceMetric::CenterChebyshev:
+                collectMergeEdges<CenterChebyshevDistance>(objects, maxDistance);
+                break;
+            case DistanceMetric::Iou:
+                collectMergeEdges<IouDistance>(objects, maxDistance);
+                break;
+            case DistanceMetric::OverlapEdge:
+                collectMergeEdges<OverlapEdgeDistance>(objects, maxDistance);
+                break;
         }
     }
+    const int n = static_cast<int>(objects.size());
+    mergeTree_.build(n, mergeEdges_);
+
+    regionLevels_.resize(levels.size());
+    for (size_t level = 0; level < levels.size(); ++level) {
+        const int count = mergeTree_.cut(levels[level] * config_.eps, levelLabels_);
+        Clusters clusters(static_cast<size_t>(count), IndexList(scratch), scratch);
+        for (int i = 0; i < n; ++i) clusters[levelLabels_[i]].push_back(i);
+        createConsolidatedRegions(objects, clusters, regionLevels_[level]);
+    }
+}
 
-    return neighbors;
+template <typename Distance>
+void MotionRegionConsolidator::collectMergeEdges(const ObjectBoxes& objects, double maxDistance) {
+    const int n = static_cast<int>(objects.size());
+    const std::vector<cv::Rect>& rects = objects.bounds;
+    const BoxArrays boxes(rects);
+    const BoxDistanceParams params = distanceParams();
+    const double reach = Distance::neighborReach(params, maxDistance);
+    // The DBSCAN center pre-filter applies at every level
+    const double centerReach = config_.maxDistanceThreshold * frameDiagonal();
+    const long long reachSquared4 =
+        centerReach > 0.0 ? static_cast<long long>(4.0 * centerReach * centerReach) : 0;
+    auto add = [&](int i, int j, double distance) {
+        if (distance > maxDistance) return;
+        if (reachSquared4 > 0) {
+            const long long dx = 2LL * (rects[i].x - rects[j].x) + rects[i].width - rects[j].width;
+            const long long dy = 2LL * (rects[i].y - rects[j].y) + rects[i].height - rects[j].height;
+            if (dx * dx + dy * dy > reachSquared4) return;
+        }
+        mergeEdges_.push_back({i, j, distance});
+    };
+    if (config_.useSpatialIndex && reach >= 0.0) {
+        const BoxGridIndex index(rects, gridCellSize(rects, reach));
+        for (int i = 0; i < n; ++i) {
+            for (int j : index.query(rects[i], reach, i)) {
+                if (j > i) add(i, j, Distance::distance(boxes, i, j, params));  // Each pair once
+            }
+        }
+        return;
+    }
+    std::vector<double> distances(n);
+    for (int i = 0; i + 1 < n; ++i) {
+        Distance::batch(boxes, i, i + 1, n, params, distances.data());
+        for (int j = i + 1; j < n; ++j) add(i, j, distances[j - i - 1]);
+    }
+}
+
+BoxDistanceParams MotionRegionConsolidator::distanceParams() const {
+    BoxDistanceParams params;
+    params.overlapWeight = config_.overlapWeight;
+    params.edgeWeight = config_.edgeWeight;
+    params.maxEdgeDistance = config_.maxEdgeDistance;
+    return params;
 }
 
 // Now implement the overlap-aware distance calculation methods
@@ -111,14 +538,9 @@ double MotionRegionConsolidator::calculateOverlapAwareDistance(const TrackedObje
     // Calculate edge distance component (distance between closest edges)
     double edgeComponent = calculateEdgeDistance(rect1, rect2);
 
-    // Combine components using weights
-    double combinedDistance =
-        (config_.overlapWeight * overlapComponent) + (config_.edgeWeight * edgeComponent);
-
-    LOG_DEBUG("Distance between objects {} and {}: overlap={:.2f}, edge={:.2f}, combined={:.2f}",
-              obj1.id, obj2.id, overlapComponent, edgeComponent, combinedDistance);
-
-    return combinedDistance;
+    // Combine components using weights (not logged: this runs per pair, and the clustering
+    // trace records the pairwise decisions)
+    return (config_.overlapWeight * overlapComponent) + (config_.edgeWeight * edgeComponent);
 }
 
 double MotionRegionConsolidator::calculateOverlapComponent(const cv::Rect& rect1,
@@ -192,23 +614,7 @@ double MotionRegionConsolidator::calculateEdgeDistance(const cv::Rect& rect1,
         minDistance = std::min(minDistance, static_cast<double>(top1 - bottom2));
     }
 
-    // If rectangles are diagonally separated, calculate corner-to-corner distance
-    if (minDistance == std::numeric_limits<double>::max()) {
-        // Calculate distances between all corner combinations
-        std::vector<cv::Point> corners1 = {cv::Point(left1, top1), cv::Point(right1, top1),
-                                           cv::Point(left1, bottom1), cv::Point(right1, bottom1)};
-        std::vector<cv::Point> corners2 = {cv::Point(left2, top2), cv::Point(right2, top2),
-                                           cv::Point(left2, bottom2), cv::Point(right2, bottom2)};
-
-        for (const auto& corner1 : corners1) {
-            for (const auto& corner2 : corners2) {
-                double dx = corner1.x - corner2.x;
-                double dy = corner1.y - corner2.y;
-                double distance = std::sqrt(dx * dx + dy * dy);
-                minDistance = std::min(minDistance, distance);
-            }
-        }
-    }
+    // Separated boxes always have a gap along at least one axis, so minDistance is set here
 
     // Cap the distance at maxEdgeDistance
     return std::min(minDistance, config_.maxEdgeDistance);
@@ -216,66 +622,205 @@ double MotionRegionConsolidator::calculateEdgeDistance(const cv::Rect& rect1,
 
 std::vector<ConsolidatedRegion> MotionRegionConsolidator::consolidateRegions(
     const std::vector<TrackedObject>& trackedObjects) {
+    std::vector<ConsolidatedRegion> regions;
+    consolidateRegionsInto(trackedObjects, regions);
+    return regions;
+}
+
+std::vector<ConsolidatedRegion> MotionRegionConsolidator::consolidateRegions(
+    const TrackedObjectStore& trackedObjects) {
+    std::vector<ConsolidatedRegion> regions;
+    consolidateRegionsInto(trackedObjects, regions);
+    return regions;
+}
+
+void MotionRegionConsolidator::consolidateRegionsInto(const std::vector<TrackedObject>& trackedObjects,
+                                                      std::vector<ConsolidatedRegion>& out,
+                                                      std::pmr::memory_resource* scratch) {
+    objectIds_.clear();
+    objectBounds_.clear();
+    objectIds_.reserve(trackedObjects.size());
+    objectBounds_.reserve(trackedObjects.size());
+    for (const auto& object : trackedObjects) {
+        objectIds_.push_back(object.id);
+        objectBounds_.push_back(object.currentBounds);
+    }
+    consolidate(ObjectBoxes{objectIds_, objectBounds_}, scratch);
+    // Copy assignment reuses the capacity of out and of the ID vectors of its elements
+    out = consolidatedRegions_;
+}
+
+void MotionRegionConsolidator::consolidateRegionsInto(const TrackedObjectStore& trackedObjects,
+                                                      std::vector<ConsolidatedRegion>& out,
+                                                      std::pmr::memory_resource* scratch) {
+    consolidate(ObjectBoxes{trackedObjects.ids(), trackedObjects.bounds()}, scratch);
+    out = consolidatedRegions_;
+}
+
+void MotionRegionConsolidator::summarizeDetections(const TrackedObjectStore& objects, const Detections& detections,
+                                                   std::vector<ConsolidatedRegion>& regions) {
+    const std::vector<int>& ids = objects.ids();
+    const auto rowsEnd = ids.begin() + static_cast<std::ptrdiff_t>(std::min(ids.size(), detections.size()));
+    for (ConsolidatedRegion& region : regions) {
+        double area = 0.0, diffArea = 0.0, diffSum = 0.0;
+        for (int id : region.trackedObjectIds) {
+            const auto it = std::find(ids.begin(), rowsEnd, id);
+            if (it == rowsEnd) continue;
+            const size_t row = static_cast<size_t>(it - ids.begin());
+            area += detections.areas[row];
+            if (detections.meanDiffs[row] < 0) continue;
+            diffArea += detections.areas[row];
+            diffSum += static_cast<double>(detections.meanDiffs[row]) * detections.areas[row];
+        }
+        region.motionArea = static_cast<float>(area);
+        region.meanDiff = diffArea > 0.0 ? static_cast<float>(diffSum / diffArea) : 0.0f;
+    }
+}
+
+void MotionRegionConsolidator::consolidate(const ObjectBoxes& trackedObjects,
+                                           std::pmr::memory_resource* scratch) {
+    if (scratch == nullptr) scratch = std::pmr::get_default_resource();
     frameCounter_++;
 
+    // A requested dump is written between frames, while no clustering row is recording
+    if (trace_.isEnabled()) {
+        const std::string dumpPath = trace_.takeDumpRequest();
+        if (!dumpPath.empty()) trace_.write(dumpPath);
+    }
+
+    if (!config_.hierarchyLevels.empty()) {
+        STAGE_TIMER(stageTimings_, PipelineStage::CLUSTERING);
+        buildRegionLevels(trackedObjects, scratch);
+    } else {
+        regionLevels_.clear();
+    }
+
     if (trackedObjects.empty()) {
+        memoSettled_ = false;
         removeStaleRegions();
-        return consolidatedRegions_;
+        return;
     }
 
-    LOG_DEBUG("Consolidating {} tracked objects using DBSCAN", trackedObjects.size());
+    // Between keyframes the boxes attach to the regions the last DBSCAN run left
+    if (!keyframeDue(trackedObjects.size())) {
+        STAGE_TIMER(stageTimings_, PipelineStage::REGION_MERGE);
+        if (attachToRegions(trackedObjects)) {
+            memoSettled_ = false;
+            removeStaleRegions();
+            return;
+        }
+    }
+    framesSinceKeyframe_ = 0;
+    keyframeObjectCount_ = trackedObjects.size();
+    haveKeyframe_ = true;
+    ++keyframeStats_.keyframes;
+
+    // The same boxes as the last keyframe cluster the same way
+    const uint64_t fingerprint = config_.memoizeUnchangedFrames ? boxFingerprint(trackedObjects) : 0;
+    const bool memoized = config_.memoizeUnchangedFrames && haveMemo_ && fingerprint == memoFingerprint_;
+    if (memoized) {
+        ++keyframeStats_.memoizedFrames;
+        if (memoSettled_) {
+            // Steps 2-5 would rebuild the regions as they are: updated regions stay current
+            // (framesSinceLastUpdate 0), the others age until removeStaleRegions() drops them
+            STAGE_TIMER(stageTimings_, PipelineStage::REGION_MERGE);
+            ++keyframeStats_.settledFrames;
+            for (auto& region : consolidatedRegions_) {
+                if (region.framesSinceLastUpdate > 0) region.framesSinceLastUpdate++;
+            }
+            removeStaleRegions();
+            return;
+        }
+        memoBefore_ = consolidatedRegions_;
+    }
 
     // Step 1: Apply DBSCAN clustering to group objects
-    auto clusters = dbscanClustering(trackedObjects);
+    Clusters clusters(scratch);
+    if (!memoized) {
+        LOG_DEBUG_LIMITED("Consolidating {} tracked objects using DBSCAN", trackedObjects.size());
+        STAGE_TIMER(stageTimings_, PipelineStage::CLUSTERING);
+        clusters = dbscanClustering(trackedObjects, scratch);
+    }
 
-    // Step 2: Create consolidated regions from clusters (no size filtering)
-    auto newRegions = createConsolidatedRegions(trackedObjects, clusters);
+    STAGE_TIMER(stageTimings_, PipelineStage::REGION_MERGE);  // Steps 2-5
+
+    // Step 2: Create consolidated regions from clusters (object count and area filtered)
+    if (memoized) {
+        newRegions_ = memoRegions_;
+    } else {
+        createConsolidatedRegions(trackedObjects, clusters, newRegions_);
+        if (config_.memoizeUnchangedFrames) {
+            memoRegions_ = newRegions_;
+            memoFingerprint_ = fingerprint;
+            haveMemo_ = true;
+        }
+    }
 
     // Step 3: Update existing regions
-    updateExistingRegions(trackedObjects);
-
-    // Step 4: Merge overlapping regions if needed
-    for (const auto& newRegion : newRegions) {
-        bool merged = false;
-        for (auto& existingRegion : consolidatedRegions_) {
-            // Use simple overlap check for merging
-            cv::Rect intersection = newRegion.boundingBox & existingRegion.boundingBox;
-            if (intersection.area() > 0) {
-                existingRegion = mergeRegions(existingRegion, newRegion);
-                merged = true;
-                break;
-            }
-        }
-        if (!merged) {
-            consolidatedRegions_.push_back(newRegion);
-        }
+    idToIndex_.clear();
+    idToIndex_.reserve(trackedObjects.size());
+    for (size_t i = 0; i < trackedObjects.size(); ++i) {
+        idToIndex_.emplace(trackedObjects.ids[i], static_cast<int>(i));
     }
+    updateExistingRegions(trackedObjects, idToIndex_);
 
-    // Step 5: Remove stale regions
+    // Step 4: Merge every group of overlapping regions, old and new alike
+    consolidatedRegions_.insert(consolidatedRegions_.end(), std::make_move_iterator(newRegions_.begin()),
+                                std::make_move_iterator(newRegions_.end()));
+    mergeOverlappingRegions(consolidatedRegions_);
+
+    // Step 5: Remove stale regions and regions that left the area bounds
     removeStaleRegions();
+    memoSettled_ = memoized && regionsSettled(memoBefore_);
 
-    LOG_INFO("DBSCAN consolidation completed: {} regions created", consolidatedRegions_.size());
+    LOG_DEBUG_LIMITED("DBSCAN consolidation completed: {} regions created", consolidatedRegions_.size());
 
-    // Debug: Log region information
-    for (size_t i = 0; i < consolidatedRegions_.size(); ++i) {
-        const auto& region = consolidatedRegions_[i];
-        LOG_DEBUG("Region {}: {}x{} at ({},{}) with {} objects", i, region.boundingBox.width,
-                  region.boundingBox.height, region.boundingBox.x, region.boundingBox.y,
-                  region.trackedObjectIds.size());
+    // Debug: Log region information (one frame's regions at most at the diagnostic rate)
+    if (LOG_DEBUG_SAMPLE()) {
+        for (size_t i = 0; i < consolidatedRegions_.size(); ++i) {
+            const auto& region = consolidatedRegions_[i];
+            LOG_DEBUG("Region {}: {}x{} at ({},{}) with {} objects", i, region.boundingBox.width,
+                      region.boundingBox.height, region.boundingBox.x, region.boundingBox.y,
+                      region.trackedObjectIds.size());
+        }
     }
+}
 
-    return consolidatedRegions_;
+uint64_t MotionRegionConsolidator::boxFingerprint(const ObjectBoxes& objects) const {
+    const int step = std::max(1, config_.memoizeQuantization);
+    uint64_t hash = objects.size();
+    auto mix = [&hash](int64_t value) {
+        hash ^= static_cast<uint64_t>(value) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    };
+    for (size_t i = 0; i < objects.size(); ++i) {
+        const cv::Rect& box = objects.bounds[i];
+        mix(objects.ids[i]);
+        mix(box.x / step);
+        mix(box.y / step);
+        mix(box.width / step);
+        mix(box.height / step);
+    }
+    return hash;
 }
 
-std::vector<ConsolidatedRegion> MotionRegionConsolidator::createConsolidatedRegions(
-    const std::vector<TrackedObject>& objects, const std::vector<std::vector<int>>& clusters) {
-    std::vector<ConsolidatedRegion> regions;
+// Whether this frame's regions are @p before's, up to framesSinceLastUpdate
+bool MotionRegionConsolidator::regionsSettled(const std::vector<ConsolidatedRegion>& before) const {
+    return std::equal(before.begin(), before.end(), consolidatedRegions_.begin(), consolidatedRegions_.end(),
+                      [](const ConsolidatedRegion& a, const ConsolidatedRegion& b) {
+                          return a.boundingBox == b.boundingBox && a.trackedObjectIds == b.trackedObjectIds;
+                      });
+}
+
+void MotionRegionConsolidator::createConsolidatedRegions(const ObjectBoxes& objects,
+                                                         const Clusters& clusters,
+                                                         std::vector<ConsolidatedRegion>& regions) {
+    regions.clear();
 
     for (const auto& cluster : clusters) {
         if (cluster.empty()) continue;
 
         // Calculate bounding box that encompasses all objects in the cluster
-        cv::Rect bbox = calculateBoundingBox(objects, cluster);
+        cv::Rect bbox = calculateBoundingBox(objects, cluster.data(), cluster.size());
 
         // Apply minimal expansion only
         bbox = expandBoundingBox(bbox, config_.regionExpansionFactor, config_.frameSize);
@@ -286,26 +831,39 @@ std::vector<ConsolidatedRegion> MotionRegionConsolidator::createConsolidatedRegi
         bbox.width = std::min(bbox.width, config_.frameSize.width - bbox.x);
         bbox.height = std::min(bbox.height, config_.frameSize.height - bbox.y);
 
-        regions.emplace_back(bbox, cluster);
+        // Pre-filter: junk regions are dropped before they can merge with real ones
+        if (static_cast<int>(cluster.size()) < config_.minObjectsPerRegion || !regionAreaAccepted(bbox)) {
+            LOG_DEBUG("Rejected region: {}x{} at ({},{}) with {} objects", bbox.width, bbox.height,
+                      bbox.x, bbox.y, cluster.size());
+            continue;
+        }
+
+        // Regions refer to objects by ID, not by their index in this frame
+        RegionObjectIds ids;
+        ids.reserve(cluster.size());
+        for (int idx : cluster) ids.push_back(objects.ids[idx]);
+
+        regions.emplace_back(bbox, std::move(ids));
         LOG_DEBUG("Created consolidated region: {}x{} at ({},{}) with {} objects", bbox.width,
                   bbox.height, bbox.x, bbox.y, cluster.size());
     }
 
-    LOG_INFO("Created {} consolidated regions from {} clusters", regions.size(), clusters.size());
-    return regions;
+    LOG_DEBUG_LIMITED("Created {} consolidated regions from {} clusters", regions.size(), clusters.size());
 }
 
-void MotionRegionConsolidator::updateExistingRegions(const std::vector<TrackedObject>& objects) {
+void MotionRegionConsolidator::updateExistingRegions(
+    const ObjectBoxes& objects, const std::unordered_map<int, int>& idToIndex) {
     for (auto& region : consolidatedRegions_) {
         region.framesSinceLastUpdate++;
 
         // Try to update region with current objects
-        std::vector<int> updatedIds;
+        RegionObjectIds updatedIds;
+        updatedIndices_.clear();
         for (int id : region.trackedObjectIds) {
-            auto it = std::find_if(objects.begin(), objects.end(),
-                                   [id](const TrackedObject& obj) { return obj.id == id; });
-            if (it != objects.end()) {
+            auto it = idToIndex.find(id);
+            if (it != idToIndex.end()) {
                 updatedIds.push_back(id);
+                updatedIndices_.push_back(it->second);
             }
         }
 
@@ -314,46 +872,238 @@ void MotionRegionConsolidator::updateExistingRegions(const std::vector<TrackedOb
             region.framesSinceLastUpdate = 0;
 
             // Recalculate bounding box
-            region.boundingBox = calculateBoundingBox(objects, updatedIds);
+            region.boundingBox = calculateBoundingBox(objects, updatedIndices_.data(), updatedIndices_.size());
         }
     }
 }
 
+bool MotionRegionConsolidator::keyframeDue(size_t objectCount) {
+    if (config_.keyframeInterval <= 1 || !haveKeyframe_) return true;
+    if (++framesSinceKeyframe_ >= config_.keyframeInterval) return true;
+    const double change = std::abs(static_cast<double>(objectCount) - static_cast<double>(keyframeObjectCount_));
+    if (change > config_.keyframeBoxCountChange * static_cast<double>(std::max<size_t>(keyframeObjectCount_, 1))) {
+        ++keyframeStats_.countTriggered;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Attaches every box to the region containing its center, or failing that to the region it
+ * overlaps most with an IoU of at least keyframeAttachIou. Regions and boxes are swept
+ * together in order of their left edge, as in mergeOverlappingRegions(), so only pairs that
+ * overlap in x are tested. Returns false, changing nothing, when more than
+ * keyframeMaxUnassigned of the boxes attach nowhere and the frame needs DBSCAN. Otherwise
+ * each region takes its attached boxes (expanded like a new region) and regions that grew
+ * into each other merge; boxes that attached nowhere wait for the next keyframe.
+ */
+bool MotionRegionConsolidator::attachToRegions(const ObjectBoxes& objects) {
+    const int regionCount = static_cast<int>(consolidatedRegions_.size());
+    const int n = static_cast<int>(objects.size());
+    auto boxOf = [&](int item) -> const cv::Rect& {
+        return item < regionCount ? consolidatedRegions_[item].boundingBox : objects.bounds[item - regionCount];
+    };
+    auto offer = [&](int row, int region) {
+        const cv::Rect& box = objects.bounds[row];
+        const cv::Rect& regionBox = consolidatedRegions_[region].boundingBox;
+        const double overlap = (box & regionBox).area();
+        if (overlap <= 0.0) return;
+        const double iou = overlap / (static_cast<double>(box.area()) + regionBox.area() - overlap);
+        const cv::Point center(box.x + box.width / 2, box.y + box.height / 2);
+        double score = 0.0;
+        if (regionBox.contains(center)) {
+            score = 2.0 + iou;  // Containment beats any IoU
+        } else if (iou >= config_.keyframeAttachIou) {
+            score = iou;
+        }
+        if (score > attachScores_[row]) {
+            attachScores_[row] = score;
+            attachments_[row] = region;
+        }
+    };
+
+    attachOrder_.resize(regionCount + n);
+    for (int i = 0; i < regionCount + n; ++i) attachOrder_[i] = i;
+    std::sort(attachOrder_.begin(), attachOrder_.end(),
+              [&](int a, int b) { return boxOf(a).x < boxOf(b).x || (boxOf(a).x == boxOf(b).x && a < b); });
+    attachments_.assign(n, -1);
+    attachScores_.assign(n, 0.0);
+    activeRegions_.clear();
+    activeObjects_.clear();
+    for (int item : attachOrder_) {
+        const cv::Rect& box = boxOf(item);
+        auto passed = [&](int other) {
+            const cv::Rect& otherBox = boxOf(other);
+            return otherBox.x + otherBox.width <= box.x;
+        };
+        activeRegions_.erase(std::remove_if(activeRegions_.begin(), activeRegions_.end(), passed),
+                             activeRegions_.end());
+        activeObjects_.erase(std::remove_if(activeObjects_.begin(), activeObjects_.end(), passed),
+                             activeObjects_.end());
+        if (item < regionCount) {
+            for (int other : activeObjects_) offer(other - regionCount, item);
+            activeRegions_.push_back(item);
+        } else {
+            for (int region : activeRegions_) offer(item - regionCount, region);
+            activeObjects_.push_back(item);
+        }
+    }
+
+    const auto unassigned = static_cast<size_t>(std::count(attachments_.begin(), attachments_.end(), -1));
+    if (static_cast<double>(unassigned) > config_.keyframeMaxUnassigned * static_cast<double>(n)) {
+        ++keyframeStats_.unassignedTriggered;
+        return false;
+    }
+    ++keyframeStats_.attachedFrames;
+    keyframeStats_.unassignedBoxes += unassigned;
+
+    // Rows grouped by region, in row order within a region
+    attachOrder_.clear();
+    for (int row = 0; row < n; ++row) {
+        if (attachments_[row] >= 0) attachOrder_.push_back(row);
+    }
+    std::stable_sort(attachOrder_.begin(), attachOrder_.end(),
+                     [this](int a, int b) { return attachments_[a] < attachments_[b]; });
+    for (auto& region : consolidatedRegions_) region.framesSinceLastUpdate++;
+    for (size_t begin = 0; begin < attachOrder_.size();) {
+        const int regionIndex = attachments_[attachOrder_[begin]];
+        size_t end = begin;
+        while (end < attachOrder_.size() && attachments_[attachOrder_[end]] == regionIndex) ++end;
+
+        ConsolidatedRegion& region = consolidatedRegions_[regionIndex];
+        region.trackedObjectIds.clear();
+        for (size_t i = begin; i < end; ++i) region.trackedObjectIds.push_back(objects.ids[attachOrder_[i]]);
+        const cv::Rect bounds = calculateBoundingBox(objects, attachOrder_.data() + begin, end - begin);
+        region.boundingBox = expandBoundingBox(bounds, config_.regionExpansionFactor, config_.frameSize);
+        region.framesSinceLastUpdate = 0;
+        begin = end;
+    }
+    mergeOverlappingRegions(consolidatedRegions_);
+    return true;
+}
+
 void MotionRegionConsolidator::removeStaleRegions() {
+    // Updates and merges change boxes, so the area bounds are checked again here
     consolidatedRegions_.erase(
         std::remove_if(consolidatedRegions_.begin(), consolidatedRegions_.end(),
                        [this](const ConsolidatedRegion& region) {
-                           return region.framesSinceLastUpdate > config_.maxFramesWithoutUpdate;
+                           return region.framesSinceLastUpdate > config_.maxFramesWithoutUpdate ||
+                                  !regionAreaAccepted(region.boundingBox);
                        }),
         consolidatedRegions_.end());
 }
 
+bool MotionRegionConsolidator::regionAreaAccepted(const cv::Rect& box) const {
+    const double area = static_cast<double>(box.area());
+    return area >= config_.minRegionArea && (config_.maxRegionArea <= 0.0 || area <= config_.maxRegionArea);
+}
+
+bool MotionRegionConsolidator::overlapsEnoughToMerge(const cv::Rect& newBox,
+                                                     const cv::Rect& existingBox) const {
+    const int intersection = (newBox & existingBox).area();
+    if (intersection <= 0) return false;
+    const int smaller = std::min(newBox.area(), existingBox.area());
+    return static_cast<double>(intersection) >= config_.overlapThreshold * smaller;
+}
+
+double MotionRegionConsolidator::frameDiagonal() const {
+    return std::hypot(config_.frameSize.width, config_.frameSize.height);
+}
+
+/**
+ * Transitive overlap closure in rounds. Each round sweeps the boxes in order of their left
+ * edge, keeping the boxes whose x-extent still covers the sweep position; only those can
+ * overlap the next box, so a round costs O(n log n) plus one test per x-overlapping pair.
+ * Overlapping pairs are joined in a union-find, each group is merged into its earliest
+ * region (keeping the order of older regions), and rounds repeat while merged boxes grew
+ * into new overlaps.
+ */
+void MotionRegionConsolidator::mergeOverlappingRegions(std::vector<ConsolidatedRegion>& regions) const {
+    std::vector<int> parent;
+    std::vector<int> order;
+    std::vector<int> active;
+    auto rootOf = [&parent](int i) {
+        while (parent[i] != i) i = parent[i] = parent[parent[i]];  // Path halving
+        return i;
+    };
+
+    while (regions.size() > 1) {
+        const int n = static_cast<int>(regions.size());
+        parent.resize(n);
+        order.resize(n);
+        for (int i = 0; i < n; ++i) parent[i] = order[i] = i;
+        std::sort(order.begin(), order.end(), [&regions](int a, int b) {
+            return regions[a].boundingBox.x < regions[b].boundingBox.x;
+        });
+
+        bool merged = false;
+        active.clear();
+        for (int i : order) {
+            const cv::Rect& box = regions[i].boundingBox;
+            active.erase(std::remove_if(active.begin(), active.end(),
+                                        [&](int a) {
+                                            const cv::Rect& other = regions[a].boundingBox;
+                                            return other.x + other.width <= box.x;
+                                        }),
+                         active.end());
+            for (int a : active) {
+                if (!overlapsEnoughToMerge(box, regions[a].boundingBox)) continue;
+                const int rootA = rootOf(a);
+                const int rootI = rootOf(i);
+                if (rootA == rootI) continue;
+                parent[std::max(rootA, rootI)] = std::min(rootA, rootI);  // Earliest region is the root
+                merged = true;
+            }
+            active.push_back(i);
+        }
+        if (!merged) break;
+
+        // Groups fold into their root in index order; roots keep their relative order
+        std::vector<ConsolidatedRegion> closure;
+        std::vector<int> slot(n, -1);
+        closure.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            const int root = rootOf(i);
+            if (slot[root] < 0) {
+                slot[root] = static_cast<int>(closure.size());
+                closure.push_back(std::move(regions[i]));
+            } else {
+                ConsolidatedRegion& group = closure[slot[root]];
+                group = mergeRegions(group, regions[i]);
+            }
+        }
+        regions = std::move(closure);
+    }
+}
+
 ConsolidatedRegion MotionRegionConsolidator::mergeRegions(const ConsolidatedRegion& region1,
-                                                          const ConsolidatedRegion& region2) {
+                                                          const ConsolidatedRegion& region2) const {
     // Merge bounding boxes
     cv::Rect mergedBox = region1.boundingBox | region2.boundingBox;
 
-    // Merge object IDs
-    std::vector<int> mergedIds = region1.trackedObjectIds;
-    mergedIds.insert(mergedIds.end(), region2.trackedObjectIds.begin(),
-                     region2.trackedObjectIds.end());
+    // Merge object IDs; an object in both regions (an updated region and the new region of
+    // the same cluster) is listed once
+    RegionObjectIds mergedIds = region1.trackedObjectIds;
+    for (int id : region2.trackedObjectIds) {
+        if (!region1.trackedObjectIds.contains(id)) mergedIds.push_back(id);
+    }
 
-    ConsolidatedRegion merged(mergedBox, mergedIds);
+    ConsolidatedRegion merged(mergedBox, std::move(mergedIds));
     merged.framesSinceLastUpdate =
         std::min(region1.framesSinceLastUpdate, region2.framesSinceLastUpdate);
 
     return merged;
 }
 
-cv::Rect MotionRegionConsolidator::calculateBoundingBox(const std::vector<TrackedObject>& objects,
-                                                        const std::vector<int>& indices) const {
-    if (indices.empty()) {
+cv::Rect MotionRegionConsolidator::calculateBoundingBox(const ObjectBoxes& objects, const int* indices,
+                                                        size_t count) const {
+    if (count == 0) {
         return cv::Rect();
     }
 
-    cv::Rect combinedBox = objects[indices[0]].currentBounds;
-    for (size_t i = 1; i < indices.size(); ++i) {
-        combinedBox |= objects[indices[i]].currentBounds;
+    cv::Rect combinedBox = objects.bounds[indices[0]];
+    for (size_t i = 1; i < count; ++i) {
+        combinedBox |= objects.bounds[indices[i]];
     }
 
     return combinedBox;
@@ -361,8 +1111,17 @@ cv::Rect MotionRegionConsolidator::calculateBoundingBox(const std::vector<Tracke
 
 cv::Rect MotionRegionConsolidator::expandBoundingBox(const cv::Rect& bbox, double expansionFactor,
                                                      const cv::Size& frameSize) {
-    int expandX = static_cast<int>((bbox.width * (expansionFactor - 1.0)) / 2.0);
-    int expandY = static_cast<int>((bbox.height * (expansionFactor - 1.0)) / 2.0);
+    int expandX = 0;
+    int expandY = 0;
+    if (config_.integerGeometry) {
+        // Half the growth in 16.16 fixed point
+        const int64_t growth = std::llround((expansionFactor - 1.0) * 32768.0);
+        expandX = static_cast<int>(bbox.width * growth / 65536);
+        expandY = static_cast<int>(bbox.height * growth / 65536);
+    } else {
+        expandX = static_cast<int>((bbox.width * (expansionFactor - 1.0)) / 2.0);
+        expandY = static_cast<int>((bbox.height * (expansionFactor - 1.0)) / 2.0);
+    }
 
     cv::Rect expanded(
         std::max(0, bbox.x - expandX), std::max(0, bbox.y - expandY),
@@ -373,10 +1132,40 @@ cv::Rect MotionRegionConsolidator::expandBoundingBox(const cv::Rect& bbox, doubl
 }
 
 void MotionRegionConsolidator::updateConfig(const ConsolidationConfig& config) {
+    const auto neighborSettings = [](const ConsolidationConfig& c) {
+        return std::make_tuple(c.eps, c.overlapWeight, c.edgeWeight, c.maxEdgeDistance, c.integerGeometry,
+                               c.distanceMetric);
+    };
+    const auto previousNeighborSettings = neighborSettings(config_);
     config_ = config;
+    resolveRelativeParameters();
+    haveMemo_ = false;  // Memoized regions were built with the old filters and expansion
+    // Cached neighbor relations depend on eps and the weights; the regions themselves
+    // carry over, so a live retune does not restart every region
+    if (neighborSettings(config_) != previousNeighborSettings) clearNeighborCache();
+    const size_t traceCapacity = static_cast<size_t>(std::max(0, config_.clusteringTraceCapacity));
+    if (traceCapacity != trace_.capacity()) trace_.resize(traceCapacity);
     LOG_INFO("MotionRegionConsolidator config updated");
 }
 
+void MotionRegionConsolidator::setFrameSize(const cv::Size& frameSize) {
+    if (frameSize.area() <= 0 || frameSize == config_.frameSize) {
+        return;
+    }
+    config_.frameSize = frameSize;
+    resolveRelativeParameters();
+    clearRegions();
+    LOG_INFO("MotionRegionConsolidator frame size {}x{}: eps={:.1f}, maxEdgeDistance={:.1f}",
+             frameSize.width, frameSize.height, config_.eps, config_.maxEdgeDistance);
+}
+
+void MotionRegionConsolidator::resolveRelativeParameters() {
+    if (config_.epsFraction > 0.0) config_.eps = config_.epsFraction * frameDiagonal();
+    if (config_.maxEdgeDistanceFraction > 0.0) {
+        config_.maxEdgeDistance = config_.maxEdgeDistanceFraction * frameDiagonal();
+    }
+}
+
 // ============================================================================
 // VISUALIZATION METHODS
 // ============================================================================
@@ -393,17 +1182,22 @@ std::vector<ConsolidatedRegion> MotionRegionConsolidator::consolidateRegionsWith
 
         // Save visualization if output path is provided
         if (!outputImagePath.empty()) {
-            if (cv::imwrite(outputImagePath, visualization)) {
-                LOG_INFO("Saved consolidation visualization to: {}", outputImagePath);
-            } else {
-                LOG_ERROR("Failed to save visualization to: {}", outputImagePath);
-            }
+            DebugArtifactWriter::shared().submit(outputImagePath, std::move(visualization));
         }
     }
 
     return regions;
 }
 
+void MotionRegionConsolidator::saveVisualization(const std::vector<TrackedObject>& trackedObjects,
+                                                 const std::vector<ConsolidatedRegion>& regions,
+                                                 const cv::Mat& inputImage,
+                                                 const std::string& outputImagePath) const {
+    if (inputImage.empty() || outputImagePath.empty()) return;
+    DebugArtifactWriter::shared().submit(outputImagePath,
+                                         createVisualization(trackedObjects, regions, inputImage));
+}
+
 std::vector<ConsolidatedRegion> MotionRegionConsolidator::consolidateRegionsStandalone(
     const std::vector<TrackedObject>& trackedObjects, const std::string& outputImagePath) {
     // Perform normal consolidation
@@ -0,0 +1,56 @@
+#include "motion_stats_aggregator.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// Nearest-rank percentile; partially sorts @p samples
+double percentile(std::vector<double>& samples, double fraction) {
+    if (samples.empty()) return 0.0;
+    const size_t rank =
+        std::min(samples.size() - 1, static_cast<size_t>(fraction * static_cast<double>(samples.size())));
+    std::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(rank),
+                     samples.end());
+    return samples[rank];
+}
+
+}  // namespace
+
+MotionStatsAggregator::MotionStatsAggregator(std::string source) : source_(std::move(source)) {}
+
+std::optional<MotionMinuteSummary> MotionStatsAggregator::record(int64_t unixSeconds,
+                                                                 size_t motionBoxes,
+                                                                 size_t regions,
+                                                                 double latencyMs) {
+    const int64_t minute = unixSeconds - ((unixSeconds % 60) + 60) % 60;
+    std::optional<MotionMinuteSummary> finished;
+    if (active_ && minute != current_.minuteStart) finished = flush();
+
+    if (!active_) {
+        current_ = MotionMinuteSummary();
+        current_.source = source_;
+        current_.minuteStart = minute;
+        active_ = true;
+    }
+    current_.frames++;
+    if (motionBoxes > 0) current_.motionFrames++;
+    current_.motionBoxes += motionBoxes;
+    current_.regions += regions;
+    current_.maxRegions = std::max<uint64_t>(current_.maxRegions, regions);
+    latencies_.push_back(latencyMs);
+    return finished;
+}
+
+std::optional<MotionMinuteSummary> MotionStatsAggregator::flush() {
+    if (!active_) return std::nullopt;
+    active_ = false;
+
+    current_.latencyP50Ms = percentile(latencies_, 0.50);
+    current_.latencyP95Ms = percentile(latencies_, 0.95);
+    current_.latencyP99Ms = percentile(latencies_, 0.99);
+    current_.latencyMaxMs =
+        latencies_.empty() ? 0.0 : *std::max_element(latencies_.begin(), latencies_.end());
+    latencies_.clear();
+    return current_;
+}
@@ -0,0 +1,251 @@
+#include "motion_vector_decoder.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+
+#include "logger.hpp"
+
+#ifndef BIRDS_HAVE_LIBAV
+#define BIRDS_HAVE_LIBAV 0
+#endif
+
+#if BIRDS_HAVE_LIBAV
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/motion_vector.h>
+#include <libswscale/swscale.h>
+}
+
+namespace {
+
+std::string avError(int code) {
+    char text[AV_ERROR_MAX_STRING_SIZE] = {};
+    av_strerror(code, text, sizeof(text));
+    return text;
+}
+
+// Layouts whose first plane is the 8-bit luma
+bool lumaPlaneFirst(int format) {
+    switch (format) {
+        case AV_PIX_FMT_YUV420P:
+        case AV_PIX_FMT_YUVJ420P:
+        case AV_PIX_FMT_YUV422P:
+        case AV_PIX_FMT_YUVJ422P:
+        case AV_PIX_FMT_YUV444P:
+        case AV_PIX_FMT_YUVJ444P:
+        case AV_PIX_FMT_NV12:
+        case AV_PIX_FMT_GRAY8:
+            return true;
+        default:
+            return false;
+    }
+}
+
+}  // namespace
+
+struct MotionVectorDecoder::Impl {
+    AVFormatContext* format = nullptr;
+    AVCodecContext* codec = nullptr;
+    AVPacket* packet = nullptr;
+    AVFrame* frame = nullptr;
+    SwsContext* scaler = nullptr;
+    int streamIndex = -1;
+    bool draining = false;  // Input ended; the decoder is flushing its delayed frames
+    bool intra = false;
+    bool hasVectors = false;
+    double timestampMs = 0.0;
+
+    ~Impl() { close(); }
+
+    void close() {
+        sws_freeContext(scaler);
+        scaler = nullptr;
+        av_frame_free(&frame);
+        av_packet_free(&packet);
+        avcodec_free_context(&codec);
+        avformat_close_input(&format);
+        streamIndex = -1;
+        draining = false;
+    }
+};
+
+MotionVectorDecoder::MotionVectorDecoder() : impl_(std::make_unique<Impl>()) {}
+MotionVectorDecoder::~MotionVectorDecoder() = default;
+
+bool MotionVectorDecoder::available() { return true; }
+
+bool MotionVectorDecoder::open(const std::string& source) {
+    release();
+    Impl& d = *impl_;
+    AVDictionary* formatOptions = nullptr;
+    // RTSP over UDP loses packets (and so whole frames) on busy networks
+    std::string scheme = source.substr(0, 7);
+    std::transform(scheme.begin(), scheme.end(), scheme.begin(), ::tolower);
+    if (scheme == "rtsp://") av_dict_set(&formatOptions, "rtsp_transport", "tcp", 0);
+    int result = avformat_open_input(&d.format, source.c_str(), nullptr, &formatOptions);
+    av_dict_free(&formatOptions);
+    if (result < 0) {
+        LOG_ERROR("libav could not open '{}': {}", source, avError(result));
+        return false;
+    }
+    if ((result = avformat_find_stream_info(d.format, nullptr)) < 0) {
+        LOG_ERROR("libav found no stream info in '{}': {}", source, avError(result));
+        d.close();
+        return false;
+    }
+    d.streamIndex = av_find_best_stream(d.format, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (d.streamIndex < 0) {
+        LOG_ERROR("'{}' has no video stream", source);
+        d.close();
+        return false;
+    }
+    const AVCodecParameters* parameters = d.format->streams[d.streamIndex]->codecpar;
+    const AVCodec* decoder = avcodec_find_decoder(parameters->codec_id);
+    if (!decoder) {
+        LOG_ERROR("libav has no decoder for the video stream of '{}'", source);
+        d.close();
+        return false;
+    }
+
+    d.codec = avcodec_alloc_context3(decoder);
+    AVDictionary* codecOptions = nullptr;
+    av_dict_set(&codecOptions, "flags2", "+export_mvs", 0);
+    result = d.codec ? avcodec_parameters_to_context(d.codec, parameters) : AVERROR(ENOMEM);
+    if (result >= 0) result = avcodec_open2(d.codec, decoder, &codecOptions);
+    av_dict_free(&codecOptions);
+    d.packet = av_packet_alloc();
+    d.frame = av_frame_alloc();
+    if (result < 0 || !d.packet || !d.frame) {
+        LOG_ERROR("Could not open the {} decoder for '{}': {}", decoder->name, source, avError(result));
+        d.close();
+        return false;
+    }
+    LOG_INFO("Decoding '{}' with libavcodec {} and exported motion vectors", source, decoder->name);
+    return true;
+}
+
+bool MotionVectorDecoder::isOpened() const { return impl_->codec != nullptr; }
+
+void MotionVectorDecoder::release() { impl_->close(); }
+
+bool MotionVectorDecoder::decode(MotionVectorMap& map) {
+    Impl& d = *impl_;
+    if (!d.codec) return false;
+    for (;;) {
+        int result = avcodec_receive_frame(d.codec, d.frame);
+        if (result == 0) break;
+        if (result != AVERROR(EAGAIN)) {
+            if (result != AVERROR_EOF) LOG_ERROR("Video decode failed: {}", avError(result));
+            return false;
+        }
+        // The decoder needs more input: feed it the next packet of the video stream
+        if (d.draining) return false;
+        result = av_read_frame(d.format, d.packet);
+        if (result < 0) {
+            d.draining = true;
+            avcodec_send_packet(d.codec, nullptr);  // Flush the frames it still holds
+            continue;
+        }
+        if (d.packet->stream_index == d.streamIndex) {
+            result = avcodec_send_packet(d.codec, d.packet);
+            // A damaged packet costs its frame, not the stream
+            if (result < 0) LOG_DEBUG("Dropped a video packet the decoder rejected: {}", avError(result));
+        }
+        av_packet_unref(d.packet);
+    }
+
+    const AVFrame& frame = *d.frame;
+    const AVRational timeBase = d.format->streams[d.streamIndex]->time_base;
+    d.timestampMs = frame.best_effort_timestamp == AV_NOPTS_VALUE
+                        ? 0.0
+                        : static_cast<double>(frame.best_effort_timestamp) * av_q2d(timeBase) * 1000.0;
+    d.intra = frame.pict_type == AV_PICTURE_TYPE_I;
+
+    map.reset(cv::Size(frame.width, frame.height));
+    const AVFrameSideData* side = av_frame_get_side_data(&frame, AV_FRAME_DATA_MOTION_VECTORS);
+    d.hasVectors = side != nullptr;
+    if (side) {
+        const auto* vectors = reinterpret_cast<const AVMotionVector*>(side->data);
+        const size_t count = side->size / sizeof(AVMotionVector);
+        for (size_t i = 0; i < count; ++i) {
+            const AVMotionVector& vector = vectors[i];
+            const float scale = vector.motion_scale > 0 ? static_cast<float>(vector.motion_scale) : 1.0f;
+            // dst_x/dst_y is the centre of the predicted block in this frame
+            map.addVector(cv::Rect(vector.dst_x - vector.w / 2, vector.dst_y - vector.h / 2, vector.w, vector.h),
+                          vector.motion_x / scale, vector.motion_y / scale);
+        }
+    }
+    return true;
+}
+
+bool MotionVectorDecoder::intraFrame() const { return impl_->intra; }
+bool MotionVectorDecoder::hasVectors() const { return impl_->hasVectors; }
+double MotionVectorDecoder::timestampMs() const { return impl_->timestampMs; }
+
+bool MotionVectorDecoder::retrieve(cv::Mat& frame, bool luma) {
+    Impl& d = *impl_;
+    if (!d.frame || d.frame->width <= 0 || !d.frame->data[0]) return false;
+    const AVFrame& source = *d.frame;
+    const cv::Size size(source.width, source.height);
+    frame.create(size, luma ? CV_8UC1 : CV_8UC3);
+
+    if (luma && lumaPlaneFirst(source.format)) {
+        for (int y = 0; y < size.height; ++y) {
+            std::memcpy(frame.ptr<uchar>(y), source.data[0] + static_cast<ptrdiff_t>(y) * source.linesize[0],
+                        size.width);
+        }
+        return true;
+    }
+
+    d.scaler = sws_getCachedContext(d.scaler, size.width, size.height, static_cast<AVPixelFormat>(source.format),
+                                    size.width, size.height, luma ? AV_PIX_FMT_GRAY8 : AV_PIX_FMT_BGR24,
+                                    SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!d.scaler) {
+        LOG_ERROR("swscale cannot convert the decoder's pixel format {}", source.format);
+        return false;
+    }
+    uint8_t* planes[4] = {frame.data, nullptr, nullptr, nullptr};
+    int strides[4] = {static_cast<int>(frame.step), 0, 0, 0};
+    sws_scale(d.scaler, source.data, source.linesize, 0, size.height, planes, strides);
+    return true;
+}
+
+cv::Size MotionVectorDecoder::frameSize() const {
+    return impl_->codec ? cv::Size(impl_->codec->width, impl_->codec->height) : cv::Size();
+}
+
+double MotionVectorDecoder::fps() const {
+    if (!impl_->format || impl_->streamIndex < 0) return 0.0;
+    const AVRational rate = impl_->format->streams[impl_->streamIndex]->avg_frame_rate;
+    return rate.num > 0 && rate.den > 0 ? av_q2d(rate) : 0.0;
+}
+
+#else  // !BIRDS_HAVE_LIBAV
+
+struct MotionVectorDecoder::Impl {};
+
+MotionVectorDecoder::MotionVectorDecoder() : impl_(std::make_unique<Impl>()) {}
+MotionVectorDecoder::~MotionVectorDecoder() = default;
+
+bool MotionVectorDecoder::available() { return false; }
+
+bool MotionVectorDecoder::open(const std::string& source) {
+    LOG_ERROR("Cannot decode '{}' with motion vectors: built without libav (ENABLE_FFMPEG_MOTION_VECTORS)",
+              source);
+    return false;
+}
+
+bool MotionVectorDecoder::isOpened() const { return false; }
+void MotionVectorDecoder::release() {}
+bool MotionVectorDecoder::decode(MotionVectorMap&) { return false; }
+bool MotionVectorDecoder::intraFrame() const { return false; }
+bool MotionVectorDecoder::hasVectors() const { return false; }
+double MotionVectorDecoder::timestampMs() const { return 0.0; }
+bool MotionVectorDecoder::retrieve(cv::Mat&, bool) { return false; }
+cv::Size MotionVectorDecoder::frameSize() const { return cv::Size(); }
+double MotionVectorDecoder::fps() const { return 0.0; }
+
+#endif  // BIRDS_HAVE_LIBAV
@@ -0,0 +1,70 @@
+#include "motion_vector_map.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <opencv2/imgproc.hpp>
+
+MotionVectorMap::MotionVectorMap(int blockSize) : blockSize_(std::max(1, blockSize)) {}
+
+void MotionVectorMap::reset(const cv::Size& frameSize) {
+    frameSize_ = frameSize;
+    vectorCount_ = 0;
+    const cv::Size grid((frameSize.width + blockSize_ - 1) / blockSize_,
+                        (frameSize.height + blockSize_ - 1) / blockSize_);
+    motion_.create(grid, CV_32FC1);
+    motion_.setTo(cv::Scalar::all(0));
+    covered_.create(grid, CV_8UC1);
+    covered_.setTo(cv::Scalar::all(0));
+    flags_.create(grid, CV_8UC1);
+    flags_.setTo(cv::Scalar::all(0));
+}
+
+void MotionVectorMap::addVector(const cv::Rect& block, float dx, float dy) {
+    const cv::Rect clipped = block & cv::Rect(0, 0, frameSize_.width, frameSize_.height);
+    if (clipped.empty()) return;
+    ++vectorCount_;
+    const float magnitude = std::hypot(dx, dy);
+    const int firstColumn = clipped.x / blockSize_;
+    const int lastColumn = (clipped.x + clipped.width - 1) / blockSize_;
+    const int firstRow = clipped.y / blockSize_;
+    const int lastRow = (clipped.y + clipped.height - 1) / blockSize_;
+    for (int row = firstRow; row <= lastRow; ++row) {
+        float* motion = motion_.ptr<float>(row);
+        uchar* covered = covered_.ptr<uchar>(row);
+        for (int column = firstColumn; column <= lastColumn; ++column) {
+            motion[column] = std::max(motion[column], magnitude);
+            covered[column] = 1;
+        }
+    }
+}
+
+int MotionVectorMap::flag(double minMotion, bool uncoveredAsMotion) {
+    int flagged = 0;
+    for (int row = 0; row < flags_.rows; ++row) {
+        const float* motion = motion_.ptr<float>(row);
+        const uchar* covered = covered_.ptr<uchar>(row);
+        uchar* flags = flags_.ptr<uchar>(row);
+        for (int column = 0; column < flags_.cols; ++column) {
+            const bool moved = motion[column] >= minMotion || (uncoveredAsMotion && covered[column] == 0);
+            flags[column] = moved ? 255 : 0;
+            flagged += moved ? 1 : 0;
+        }
+    }
+    return flagged;
+}
+
+std::vector<cv::Rect> MotionVectorMap::regions(int minBlocks) {
+    std::vector<cv::Rect> result;
+    if (flags_.empty()) return result;
+    const int count = cv::connectedComponentsWithStats(flags_, labels_, stats_, centroids_, 8, CV_32S);
+    const cv::Rect frame(0, 0, frameSize_.width, frameSize_.height);
+    for (int label = 1; label < count; ++label) {
+        if (stats_.at<int>(label, cv::CC_STAT_AREA) < minBlocks) continue;
+        const cv::Rect cells(stats_.at<int>(label, cv::CC_STAT_LEFT), stats_.at<int>(label, cv::CC_STAT_TOP),
+                             stats_.at<int>(label, cv::CC_STAT_WIDTH), stats_.at<int>(label, cv::CC_STAT_HEIGHT));
+        result.push_back(cv::Rect(cells.x * blockSize_, cells.y * blockSize_, cells.width * blockSize_,
+                                  cells.height * blockSize_) &
+                         frame);
+    }
+    return result;
+}
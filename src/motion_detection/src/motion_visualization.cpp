@@ -8,6 +8,7 @@
 #include "logger.hpp"
 #include <opencv2/imgproc.hpp>
 #include <opencv2/highgui.hpp>
+#include <algorithm>
 
 MotionVisualization::MotionVisualization() 
     : visualizationEnabled(true),
@@ -19,7 +20,9 @@ MotionVisualization::MotionVisualization()
       backgroundColor(0, 0, 0),       // Black
       lineThickness(2),
       fontScale(0.7),
-      fontType(cv::FONT_HERSHEY_SIMPLEX) {
+      fontType(cv::FONT_HERSHEY_SIMPLEX),
+      previewRendering(false),
+      previewFps(0.0) {
     
     // Initialize layout configuration with default values
     layoutConfig.largePanelWidth = 640;
@@ -41,7 +44,21 @@ void MotionVisualization::setWindowName(const std::string& windowName) {
     defaultWindowName = windowName;
 }
 
+void MotionVisualization::setPreviewRendering(bool enabled, double fps) {
+    previewRendering = enabled;
+    previewFps = std::max(0.0, fps);
+    lastRenderTime = {};
+}
+
+bool MotionVisualization::isRenderDue() const {
+    if (!previewRendering || previewFps <= 0.0 || canvas.empty()) return true;
+    const auto interval = std::chrono::duration<double>(1.0 / previewFps);
+    return std::chrono::steady_clock::now() - lastRenderTime >= interval;
+}
+
 void MotionVisualization::initializeLayoutConfig(int frameWidth, int frameHeight) {
+    if (!canvas.empty() && canvasFrameSize == cv::Size(frameWidth, frameHeight)) return;
+    
     // Calculate panel sizes based on input frame dimensions
     layoutConfig.largePanelWidth = frameWidth;
     layoutConfig.largePanelHeight = frameHeight;
@@ -51,6 +68,24 @@ void MotionVisualization::initializeLayoutConfig(int frameWidth, int frameHeight
     // Calculate total dimensions for split screen
     layoutConfig.totalWidth = layoutConfig.largePanelWidth * 2;
     layoutConfig.totalHeight = layoutConfig.largePanelHeight * 2;
+    
+    canvas.create(layoutConfig.totalHeight, layoutConfig.totalWidth, CV_8UC3);
+    canvasFrameSize = cv::Size(frameWidth, frameHeight);
+}
+
+void MotionVisualization::renderPanel(const cv::Mat& image, const cv::Rect& panel) {
+    cv::Mat target = canvas(panel);
+    if (image.empty()) {
+        target.setTo(backgroundColor);
+    } else if (image.channels() == 1) {
+        // Replicating gray into BGR commutes with resizing, so convert the small image
+        cv::resize(image, panelScratch, panel.size());
+        cv::cvtColor(panelScratch, target, cv::COLOR_GRAY2BGR);
+    } else if (image.size() == panel.size()) {
+        image.copyTo(target);
+    } else {
+        cv::resize(image, target, panel.size());  // Writes into the panel (same size and type)
+    }
 }
 
 cv::Mat MotionVisualization::ensureThreeChannel(const cv::Mat& image) {
@@ -76,7 +111,7 @@ void MotionVisualization::addLabel(cv::Mat& image, const std::string& label, cv:
 
 cv::Scalar MotionVisualization::getColorForObject(int objectId) {
     // Generate different colors for different objects
-    static std::vector<cv::Scalar> colors = {
+    static const std::vector<cv::Scalar> colors = {
         cv::Scalar(0, 255, 0),    // Green
         cv::Scalar(255, 0, 0),    // Blue
         cv::Scalar(0, 0, 255),    // Red
@@ -99,38 +134,27 @@ cv::Mat MotionVisualization::createSplitScreenVisualization(
         return originalFrame.clone();
     }
     
-    // Initialize layout based on frame size
-    initializeLayoutConfig(originalFrame.cols, originalFrame.rows);
-    
-    // Prepare all images for display (ensure 3-channel)
-    cv::Mat origDisplay = ensureThreeChannel(originalFrame);
-    cv::Mat procDisplay = ensureThreeChannel(processedFrame);
-    cv::Mat diffDisplay = ensureThreeChannel(frameDiff);
-    cv::Mat threshDisplay = ensureThreeChannel(thresholded);
-    cv::Mat finalDisplay = ensureThreeChannel(finalProcessed);
+    if (!isRenderDue()) {
+        return canvas;
+    }
     
-    // Create visualization canvas
-    cv::Mat visualization(layoutConfig.totalHeight, layoutConfig.totalWidth, CV_8UC3, backgroundColor);
+    // Initialize layout (and the canvas) when the frame size changes
+    initializeLayoutConfig(originalFrame.cols, originalFrame.rows);
+    canvas.setTo(backgroundColor);
     
     // Large panels (top row)
-    cv::Mat resizedOriginal = resizeForDisplay(origDisplay, 
-        cv::Size(layoutConfig.largePanelWidth, layoutConfig.largePanelHeight));
-    cv::Mat resizedFinal = resizeForDisplay(finalDisplay, 
-        cv::Size(layoutConfig.largePanelWidth, layoutConfig.largePanelHeight));
-    
-    // Place large panels
-    resizedOriginal.copyTo(visualization(cv::Rect(0, 0, 
-        layoutConfig.largePanelWidth, layoutConfig.largePanelHeight)));
-    resizedFinal.copyTo(visualization(cv::Rect(layoutConfig.largePanelWidth, 0, 
-        layoutConfig.largePanelWidth, layoutConfig.largePanelHeight)));
+    const cv::Size largeSize(layoutConfig.largePanelWidth, layoutConfig.largePanelHeight);
+    renderPanel(originalFrame, cv::Rect(cv::Point(0, 0), largeSize));
+    renderPanel(finalProcessed, cv::Rect(cv::Point(layoutConfig.largePanelWidth, 0), largeSize));
     
     // Add labels for large panels
-    addLabel(visualization, "Original", cv::Point(10, 30));
-    addLabel(visualization, "Final Result", cv::Point(layoutConfig.largePanelWidth + 10, 30));
+    addLabel(canvas, "Original", cv::Point(10, 30));
+    addLabel(canvas, "Final Result", cv::Point(layoutConfig.largePanelWidth + 10, 30));
     
     // Small panels (bottom row)
-    std::vector<cv::Mat> smallPanels = {procDisplay, diffDisplay, threshDisplay};
-    std::vector<std::string> smallLabels = {"Preprocessed", "Frame Diff", "Thresholded"};
+    const std::vector<const cv::Mat*> smallPanels = {&processedFrame, &frameDiff, &thresholded};
+    const std::vector<std::string> smallLabels = {"Preprocessed", "Frame Diff", "Thresholded"};
+    const cv::Size smallSize(layoutConfig.smallPanelWidth, layoutConfig.smallPanelHeight);
     
     int panelIndex = 0;
     for (size_t i = 0; i < smallPanels.size() && panelIndex < 4; ++i) {
@@ -140,17 +164,15 @@ cv::Mat MotionVisualization::createSplitScreenVisualization(
         int x = col * layoutConfig.smallPanelWidth;
         int y = layoutConfig.largePanelHeight + row * layoutConfig.smallPanelHeight;
         
-        cv::Mat resizedSmall = resizeForDisplay(smallPanels[i], 
-            cv::Size(layoutConfig.smallPanelWidth, layoutConfig.smallPanelHeight));
-        
-        resizedSmall.copyTo(visualization(cv::Rect(x, y, 
-            layoutConfig.smallPanelWidth, layoutConfig.smallPanelHeight)));
+        renderPanel(*smallPanels[i], cv::Rect(cv::Point(x, y), smallSize));
         
-        addLabel(visualization, smallLabels[i], cv::Point(x + 10, y + 30));
+        addLabel(canvas, smallLabels[i], cv::Point(x + 10, y + 30));
         panelIndex++;
     }
     
-    return visualization;
+    lastRenderTime = std::chrono::steady_clock::now();
+    // Outside preview mode every call hands out its own image, as before
+    return previewRendering ? canvas : canvas.clone();
 }
 
 cv::Mat MotionVisualization::drawMotionOverlays(
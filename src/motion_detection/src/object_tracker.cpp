@@ -0,0 +1,233 @@
+#include "object_tracker.hpp"
+
+#include <algorithm>
+#include <string>
+#include <tuple>
+
+#include "box_grid_index.hpp"
+#include "logger.hpp"
+
+namespace {
+
+double intersectionOverUnion(const cv::Rect& a, const cv::Rect& b) {
+    const int intersection = (a & b).area();
+    if (intersection <= 0) return 0.0;
+    return static_cast<double>(intersection) / (a.area() + b.area() - intersection);
+}
+
+cv::Point centerOf(const cv::Rect& box) {
+    return cv::Point(box.x + box.width / 2, box.y + box.height / 2);
+}
+
+// Keep the elements whose remove flag is clear, preserving order
+template <typename T>
+void compact(std::vector<T>& values, const std::vector<char>& remove) {
+    size_t kept = 0;
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (remove[i]) continue;
+        if (kept != i) values[kept] = std::move(values[i]);
+        ++kept;
+    }
+    values.resize(kept);
+}
+
+}  // namespace
+
+ObjectTracker::ObjectTracker(const TrackerConfig& config) : config_(config) {
+    config_.maxTrajectoryLength =
+        std::min(config_.maxTrajectoryLength, TrackedObjectStore::kTrajectoryCapacity);
+    LOG_INFO("ObjectTracker initialized: minIou={}, maxFramesWithoutDetection={}, kalman={}",
+             config_.minIou, config_.maxFramesWithoutDetection, config_.useKalman);
+}
+
+void ObjectTracker::update(const std::vector<cv::Rect>& detections, TrackedObjectStore& detected) {
+    associate(detections, nullptr, detected);
+}
+
+void ObjectTracker::update(const Detections& detections, TrackedObjectStore& detected) {
+    associate(detections.rects, &detections.centroids, detected);
+}
+
+void ObjectTracker::associate(const std::vector<cv::Rect>& detections, const std::vector<cv::Point2f>* centers,
+                              TrackedObjectStore& detected) {
+    const size_t trackTotal = tracks_.size();
+    const auto centerOfDetection = [&](size_t d) {
+        return centers ? cv::Point(cvRound((*centers)[d].x), cvRound((*centers)[d].y)) : centerOf(detections[d]);
+    };
+
+    // Step 1: Predict where every live track is in this frame
+    for (size_t t = 0; t < trackTotal; ++t) predicted_[t] = predict(t);
+
+    // Step 2: Candidate pairs from the detections near each prediction
+    std::vector<std::tuple<double, int, int>> candidates;  // (IoU, track, detection)
+    if (trackTotal > 0 && !detections.empty()) {
+        double extentSum = 0.0;
+        for (const auto& box : detections) extentSum += std::max(box.width, box.height);
+        const BoxGridIndex index(detections, extentSum / static_cast<double>(detections.size()));
+        for (size_t t = 0; t < trackTotal; ++t) {
+            for (int d : index.query(predicted_[t], 0.0)) {
+                const double iou = intersectionOverUnion(predicted_[t], detections[d]);
+                if (iou > 0.0 && iou >= config_.minIou) {
+                    candidates.emplace_back(iou, static_cast<int>(t), d);
+                }
+            }
+        }
+    }
+
+    // Step 3: Greedy assignment, best overlap first (ties broken by track, then detection)
+    std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+        if (std::get<0>(a) != std::get<0>(b)) return std::get<0>(a) > std::get<0>(b);
+        return std::make_pair(std::get<1>(a), std::get<2>(a)) <
+               std::make_pair(std::get<1>(b), std::get<2>(b));
+    });
+    std::vector<int> trackForDetection(detections.size(), -1);
+    std::vector<char> trackMatched(trackTotal, 0);
+    size_t matched = 0;
+    for (const auto& [iou, t, d] : candidates) {
+        if (trackMatched[t] || trackForDetection[d] != -1) continue;
+        trackMatched[t] = 1;
+        trackForDetection[d] = t;
+        applyDetection(t, detections[d], centerOfDetection(d));
+        ++matched;
+    }
+
+    // Step 4: Age unmatched tracks, then start tracks for unmatched detections
+    for (size_t t = 0; t < trackTotal; ++t) {
+        if (!trackMatched[t]) tracks_.framesWithoutDetection(t)++;
+    }
+    for (size_t d = 0; d < detections.size(); ++d) {
+        if (trackForDetection[d] == -1) {
+            trackForDetection[d] = static_cast<int>(createTrack(detections[d], centerOfDetection(d)));
+        }
+    }
+
+    detected.clear(true);
+    for (int t : trackForDetection) detected.addRow(tracks_, static_cast<size_t>(t));
+
+    // Step 5: Drop tracks that have coasted too long (after the output rows are copied)
+    std::vector<char> expired(tracks_.size(), 0);
+    size_t expiredCount = 0;
+    for (size_t t = 0; t < tracks_.size(); ++t) {
+        if (tracks_.framesWithoutDetection(t) > config_.maxFramesWithoutDetection) {
+            expired[t] = 1;
+            ++expiredCount;
+        }
+    }
+    if (expiredCount > 0) {
+        tracks_.removeRows(expired);
+        compact(filters_, expired);
+        compact(predicted_, expired);
+        compact(anchors_, expired);
+    }
+
+    LOG_DEBUG("Tracker: {} detections, {} matched, {} tracks live ({} dropped)",
+              detections.size(), matched, tracks_.size(), expiredCount);
+}
+
+std::vector<TrackedObject> ObjectTracker::update(const std::vector<cv::Rect>& detections) {
+    TrackedObjectStore detected;
+    update(detections, detected);
+    return detected.toTrackedObjects();
+}
+
+void ObjectTracker::updateConfig(const TrackerConfig& config) {
+    const bool kalmanChanged = config.useKalman != config_.useKalman;
+    config_ = config;
+    config_.maxTrajectoryLength =
+        std::min(config_.maxTrajectoryLength, TrackedObjectStore::kTrajectoryCapacity);
+    if (kalmanChanged) reset();
+    LOG_INFO("ObjectTracker config updated: minIou={}, maxFramesWithoutDetection={}, kalman={}",
+             config_.minIou, config_.maxFramesWithoutDetection, config_.useKalman);
+}
+
+void ObjectTracker::reset() {
+    tracks_.clear(true);
+    filters_.clear();
+    predicted_.clear();
+    anchors_.clear();
+}
+
+void ObjectTracker::restoreTracks(const TrackedObjectStore& tracks, int nextId) {
+    reset();
+    for (size_t row = 0; row < tracks.size(); ++row) {
+        tracks_.addRow(tracks, row);
+        const TrackedObjectStore::Trajectory& trajectory = tracks.trajectory(row);
+        addTrackState(tracks.bounds(row), trajectory.empty() ? tracks.smoothedCenter(row) : trajectory.back());
+        nextId = std::max(nextId, tracks.id(row) + 1);
+    }
+    nextId_ = std::max(nextId_, nextId);
+}
+
+size_t ObjectTracker::createTrack(const cv::Rect& bounds, const cv::Point& center) {
+    const size_t row = tracks_.add(nextId_++, bounds, center);
+    addTrackState(bounds, center);
+    return row;
+}
+
+void ObjectTracker::addTrackState(const cv::Rect& bounds, const cv::Point& center) {
+    filters_.emplace_back();
+    predicted_.push_back(bounds);
+    anchors_.push_back(center);
+
+    if (config_.useKalman) {
+        // State (cx, cy, vx, vy), measurement (cx, cy), one frame per step
+        cv::KalmanFilter& filter = filters_.back();
+        filter.init(4, 2, 0, CV_32F);
+        filter.transitionMatrix =
+            (cv::Mat_<float>(4, 4) << 1, 0, 1, 0, 0, 1, 0, 1, 0, 0, 1, 0, 0, 0, 0, 1);
+        cv::setIdentity(filter.measurementMatrix);
+        cv::setIdentity(filter.processNoiseCov, cv::Scalar::all(1e-2));
+        cv::setIdentity(filter.measurementNoiseCov, cv::Scalar::all(1e-1));
+        cv::setIdentity(filter.errorCovPost, cv::Scalar::all(1.0));
+        filter.statePost = (cv::Mat_<float>(4, 1) << static_cast<float>(center.x),
+                            static_cast<float>(center.y), 0.0f, 0.0f);
+    }
+}
+
+cv::Rect ObjectTracker::predict(size_t row) {
+    const cv::Rect& last = tracks_.bounds(row);
+    if (!config_.useKalman) return last;
+
+    // predict() also carries the state forward for tracks that go unmatched this frame
+    const cv::Mat state = filters_[row].predict();
+    const cv::Point& anchor = anchors_[row];
+    return last + cv::Point(cvRound(state.at<float>(0)) - anchor.x,
+                            cvRound(state.at<float>(1)) - anchor.y);
+}
+
+void ObjectTracker::predictNext(std::vector<cv::Rect>& out) const {
+    out.clear();
+    for (size_t row = 0; row < tracks_.size(); ++row) {
+        const cv::Rect& last = tracks_.bounds(row);
+        if (!config_.useKalman) {
+            out.push_back(last);
+            continue;
+        }
+        const cv::Mat& state = filters_[row].statePost;
+        const cv::Point& anchor = anchors_[row];
+        out.push_back(last + cv::Point(cvRound(state.at<float>(0) + state.at<float>(2)) - anchor.x,
+                                       cvRound(state.at<float>(1) + state.at<float>(3)) - anchor.y));
+    }
+}
+
+void ObjectTracker::applyDetection(size_t row, const cv::Rect& bounds, const cv::Point& center) {
+    tracks_.bounds(row) = bounds;
+    tracks_.framesWithoutDetection(row) = 0;
+    anchors_[row] = center;
+
+    cv::Point& smoothedCenter = tracks_.smoothedCenter(row);
+    if (config_.useKalman) {
+        const cv::Mat measurement =
+            (cv::Mat_<float>(2, 1) << static_cast<float>(center.x), static_cast<float>(center.y));
+        const cv::Mat state = filters_[row].correct(measurement);
+        smoothedCenter = cv::Point(cvRound(state.at<float>(0)), cvRound(state.at<float>(1)));
+    } else {
+        const double alpha = config_.smoothingFactor;
+        smoothedCenter = cv::Point(cvRound(alpha * center.x + (1.0 - alpha) * smoothedCenter.x),
+                                   cvRound(alpha * center.y + (1.0 - alpha) * smoothedCenter.y));
+    }
+
+    TrackedObjectStore::Trajectory& trajectory = tracks_.trajectory(row);
+    trajectory.push(smoothedCenter);
+    trajectory.truncateFront(config_.maxTrajectoryLength);
+}
@@ -0,0 +1,387 @@
+#include "offline_batch.hpp"
+
+#include <glob.h>
+#include <yaml-cpp/yaml.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <filesystem>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <opencv2/videoio.hpp>
+#include <stdexcept>
+#include <thread>
+
+#include "logger.hpp"
+#include "motion_pipeline.hpp"
+#include "work_stealing_pool.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char* const kVideoExtensions[] = {".mp4", ".m4v", ".mov", ".mkv", ".avi",
+                                        ".ts",  ".mts", ".webm", ".h264", ".h265"};
+
+constexpr double kFallbackFps = 30.0;  // Containers that do not report a rate
+
+bool isVideoFile(const fs::path& path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return std::find(std::begin(kVideoExtensions), std::end(kVideoExtensions), extension) !=
+           std::end(kVideoExtensions);
+}
+
+int64_t secondsToFrames(double seconds, double fps) {
+    return static_cast<int64_t>(std::llround(seconds * fps));
+}
+
+}  // namespace
+
+struct OfflineBatchProcessor::FileState {
+    OfflineFileSummary summary;
+    VideoProbe probe;
+    std::vector<VideoSegment> segments;
+    const FrameSink* sink = nullptr;
+    const FileDone* done = nullptr;
+
+    std::mutex mutex;  // Guards what follows and serializes the sink for this file
+    std::vector<std::optional<std::vector<OfflineFrameDetections>>> finished;  // Until stitched
+    size_t nextSegment = 0;  // First segment not handed to the sink yet
+};
+
+OfflineBatchProcessor::OfflineBatchProcessor(std::shared_ptr<const PipelineConfig> config,
+                                             const OfflineBatchConfig& batch)
+    : config_(std::move(config)), batch_(batch) {
+    if (!config_) throw std::invalid_argument("OfflineBatchProcessor: no config");
+    if (config_->document()["background_snapshot_dir"]) {
+        YAML::Node document = YAML::Clone(config_->document());
+        document.remove("background_snapshot_dir");
+        config_ = PipelineConfig::fromYaml(YAML::Dump(document), config_->path());
+    }
+    batch_.segmentSeconds = std::max(1.0, batch_.segmentSeconds);
+    batch_.warmupSeconds = std::max(0.0, batch_.warmupSeconds);
+}
+
+std::vector<OfflineFileSummary> OfflineBatchProcessor::run(const std::vector<std::string>& paths,
+                                                           const FrameSink& sink,
+                                                           const FileDone& done) {
+    std::vector<std::unique_ptr<FileState>> files;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        auto file = std::make_unique<FileState>();
+        file->summary.index = i;
+        file->summary.path = paths[i];
+        file->sink = &sink;
+        file->done = &done;
+        files.push_back(std::move(file));
+    }
+
+    {
+        WorkStealingPool pool(batch_.workers);
+        LOG_INFO("Offline batch: {} file(s) on {} worker(s), {:.0f} s segments, {:.0f} s warm-up",
+                 files.size(), pool.threadCount(), batch_.segmentSeconds, batch_.warmupSeconds);
+        for (const auto& file : files) {
+            FileState* state = file.get();
+            // Probing only demuxes, so files are probed concurrently too; the segments of a
+            // file are queued as soon as it is planned
+            pool.submit([this, state, &pool] {
+                try {
+                    state->probe = probe(state->summary.path);
+                } catch (const std::exception& e) {
+                    LOG_ERROR("Offline batch: {}", e.what());
+                    state->summary.error = e.what();
+                    if (*state->done) (*state->done)(state->summary);
+                    return;
+                }
+                double fps = state->probe.fps;
+                if (fps <= 0.0) {
+                    LOG_WARN("{} reports no frame rate; assuming {} fps", state->summary.path,
+                             kFallbackFps);
+                    fps = state->probe.fps = kFallbackFps;
+                }
+                if (state->probe.frameCount > 0) {
+                    state->segments = planSegments(state->probe.keyframes, state->probe.frameCount,
+                                                   secondsToFrames(batch_.segmentSeconds, fps),
+                                                   secondsToFrames(batch_.warmupSeconds, fps));
+                } else {
+                    // Unknown length (some streams): one segment that reads to the end
+                    LOG_WARN("{} reports no frame count; processing it in one segment",
+                             state->summary.path);
+                    state->segments.push_back(VideoSegment());
+                }
+                state->summary.segments = state->segments.size();
+                LOG_INFO("Offline batch: {} has {} frames ({} keyframes found), {} segment(s)",
+                         state->summary.path, state->probe.frameCount,
+                         state->probe.keyframes.size(), state->segments.size());
+                if (state->segments.empty()) {
+                    if (*state->done) (*state->done)(state->summary);
+                    return;
+                }
+                state->finished.resize(state->segments.size());
+                for (size_t s = 0; s < state->segments.size(); ++s) {
+                    pool.submit([this, state, s] { processSegment(*state, s); });
+                }
+            });
+        }
+        pool.waitIdle();
+    }
+
+    std::vector<OfflineFileSummary> summaries;
+    summaries.reserve(files.size());
+    for (const auto& file : files) summaries.push_back(file->summary);
+    return summaries;
+}
+
+void OfflineBatchProcessor::processSegment(FileState& file, size_t segmentIndex) {
+    const VideoSegment& segment = file.segments[segmentIndex];
+    // The last segment reads to the end of the file, whatever the container's count said
+    const bool last = segmentIndex + 1 == file.segments.size();
+    const int64_t end = last ? std::numeric_limits<int64_t>::max() : segment.end;
+
+    std::vector<OfflineFrameDetections> detections;
+    int64_t decoded = 0;
+    std::string error;
+    try {
+        cv::VideoCapture capture(file.summary.path);
+        if (!capture.isOpened()) throw std::runtime_error("cannot open " + file.summary.path);
+        int64_t position = 0;
+        if (segment.warmupBegin > 0) {
+            capture.set(cv::CAP_PROP_POS_FRAMES, static_cast<double>(segment.warmupBegin));
+            position = static_cast<int64_t>(std::llround(capture.get(cv::CAP_PROP_POS_FRAMES)));
+            if (position != segment.warmupBegin) {
+                // No exact seek in this backend: start over and skip frames up to the warm-up
+                LOG_WARN("{}: seek to frame {} landed on {}; skipping from the start",
+                         file.summary.path, segment.warmupBegin, position);
+                capture.release();
+                if (!capture.open(file.summary.path)) {
+                    throw std::runtime_error("cannot reopen " + file.summary.path);
+                }
+                position = 0;
+                while (position < segment.warmupBegin && capture.grab()) ++position;
+            }
+        }
+
+        MotionProcessor processor(config_);
+        processor.enableVisualization(false);
+        processor.setVisualizationPath("");
+        processor.setRetainedStages(MotionProcessor::STAGE_NONE);
+        ObjectTracker tracker(config_->tracker);
+        std::unique_ptr<MotionRegionConsolidator> consolidator;
+        MotionPipelineContext context;
+
+        if (segment.end > segment.begin) {
+            detections.reserve(static_cast<size_t>(segment.end - segment.begin));
+        }
+        cv::Mat frame;
+        for (; position < end && capture.read(frame); ++position) {
+            if (!consolidator) {
+                ConsolidationConfig consolidation = config_->consolidation;
+                consolidation.frameSize = frame.size();
+                consolidator = std::make_unique<MotionRegionConsolidator>(consolidation);
+            }
+            if (config_->trackerEnabled) {
+                processFrameAndConsolidate(processor, tracker, *consolidator, frame, context);
+            } else {
+                processFrameAndConsolidate(processor, *consolidator, frame, context);
+            }
+            ++decoded;
+            if (position < segment.begin) continue;  // Warm-up: trains the model, nothing kept
+
+            detections.emplace_back();
+            OfflineFrameDetections& out = detections.back();
+            out.frame = position;
+            out.seconds = static_cast<double>(position) / file.probe.fps;
+            out.boxes = context.result.detectedBounds;
+            out.regions.reserve(context.regions.size());
+            for (const ConsolidatedRegion& region : context.regions) {
+                out.regions.push_back(region.boundingBox);
+            }
+        }
+        if (!last && position < segment.end) {
+            error = "stopped at frame " + std::to_string(position) + " of [" +
+                    std::to_string(segment.begin) + ", " + std::to_string(segment.end) + ")";
+        }
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+
+    std::lock_guard<std::mutex> lock(file.mutex);
+    file.summary.decodedFrames += decoded;
+    if (!error.empty()) {
+        LOG_ERROR("Offline batch: {} segment {}: {}", file.summary.path, segmentIndex, error);
+        if (file.summary.error.empty()) {
+            file.summary.error = "segment " + std::to_string(segmentIndex) + ": " + error;
+        }
+    }
+    file.finished[segmentIndex] = std::move(detections);
+
+    // Stitch: hand over every segment that is now contiguous with what the sink has seen
+    while (file.nextSegment < file.finished.size() && file.finished[file.nextSegment]) {
+        for (const OfflineFrameDetections& frameDetections : *file.finished[file.nextSegment]) {
+            file.summary.frames++;
+            if (!frameDetections.boxes.empty()) file.summary.motionFrames++;
+            if (!frameDetections.regions.empty()) file.summary.regionFrames++;
+            if (*file.sink) (*file.sink)(file.summary.index, frameDetections);
+        }
+        file.finished[file.nextSegment].reset();
+        file.nextSegment++;
+    }
+    if (file.nextSegment == file.finished.size()) {
+        LOG_INFO("Offline batch: {} done, {} frames ({} with motion, {} with regions), {} decoded",
+                 file.summary.path, file.summary.frames, file.summary.motionFrames,
+                 file.summary.regionFrames, file.summary.decodedFrames);
+        if (*file.done) (*file.done)(file.summary);
+    }
+}
+
+VideoProbe OfflineBatchProcessor::probe(const std::string& path) {
+    VideoProbe probe;
+    {
+        cv::VideoCapture capture(path);
+        if (!capture.isOpened()) throw std::runtime_error("Cannot open video " + path);
+        probe.fps = capture.get(cv::CAP_PROP_FPS);
+        probe.frameCount =
+            std::max<int64_t>(0, std::llround(capture.get(cv::CAP_PROP_FRAME_COUNT)));
+        probe.frameSize = cv::Size(static_cast<int>(capture.get(cv::CAP_PROP_FRAME_WIDTH)),
+                                   static_cast<int>(capture.get(cv::CAP_PROP_FRAME_HEIGHT)));
+    }
+
+    // Raw mode (as in PassthroughRecorder): grab() only demuxes, and each packet carries its
+    // keyframe flag. Without FFmpeg the segments are cut anywhere and seeks decode from the
+    // preceding keyframe.
+    cv::VideoCapture packets;
+    if (packets.open(path, cv::CAP_FFMPEG) && packets.set(cv::CAP_PROP_FORMAT, -1)) {
+        std::vector<int64_t> keyframes;
+        int64_t count = 0;
+        while (packets.grab()) {
+            if (packets.get(cv::CAP_PROP_LRF_HAS_KEY_FRAME) != 0) keyframes.push_back(count);
+            ++count;
+        }
+        if (count > 0 && !keyframes.empty()) {
+            probe.keyframes = std::move(keyframes);
+            probe.frameCount = count;
+        }
+    }
+    return probe;
+}
+
+std::vector<VideoSegment> OfflineBatchProcessor::planSegments(const std::vector<int64_t>& keyframes,
+                                                              int64_t frameCount,
+                                                              int64_t segmentFrames,
+                                                              int64_t warmupFrames) {
+    std::vector<VideoSegment> segments;
+    if (frameCount <= 0) return segments;
+    segmentFrames = std::max<int64_t>(1, segmentFrames);
+    warmupFrames = std::max<int64_t>(0, warmupFrames);
+
+    const auto keyframeAtOrAfter = [&](int64_t frame) {
+        if (keyframes.empty()) return frame;
+        const auto it = std::lower_bound(keyframes.begin(), keyframes.end(), frame);
+        return it == keyframes.end() ? frameCount : *it;
+    };
+    const auto keyframeAtOrBefore = [&](int64_t frame) -> int64_t {
+        if (frame <= 0) return 0;
+        if (keyframes.empty()) return frame;
+        const auto it = std::upper_bound(keyframes.begin(), keyframes.end(), frame);
+        return it == keyframes.begin() ? 0 : *std::prev(it);
+    };
+
+    for (int64_t begin = 0; begin < frameCount;) {
+        VideoSegment segment;
+        segment.begin = begin;
+        segment.warmupBegin = keyframeAtOrBefore(begin - warmupFrames);
+        segment.end = std::min(frameCount, keyframeAtOrAfter(begin + segmentFrames));
+        segments.push_back(segment);
+        begin = segment.end;
+    }
+    return segments;
+}
+
+std::vector<std::string> OfflineBatchProcessor::expandInputs(
+    const std::vector<std::string>& arguments) {
+    std::vector<std::string> paths;
+    for (const std::string& argument : arguments) {
+        std::vector<std::string> matches;
+        std::error_code error;
+        if (fs::is_directory(argument, error)) {
+            for (const auto& entry : fs::directory_iterator(argument, error)) {
+                if (entry.is_regular_file(error) && isVideoFile(entry.path())) {
+                    matches.push_back(entry.path().string());
+                }
+            }
+        } else if (fs::exists(argument, error)) {
+            matches.push_back(argument);
+        } else {
+            glob_t found{};
+            if (::glob(argument.c_str(), 0, nullptr, &found) == 0) {
+                for (size_t i = 0; i < found.gl_pathc; ++i) {
+                    if (fs::is_regular_file(found.gl_pathv[i], error)) {
+                        matches.emplace_back(found.gl_pathv[i]);
+                    }
+                }
+            }
+            globfree(&found);
+        }
+        if (matches.empty()) throw std::invalid_argument(argument + " matches no video files");
+        std::sort(matches.begin(), matches.end());
+        paths.insert(paths.end(), matches.begin(), matches.end());
+    }
+    return paths;
+}
+
+ConsolidatedBoxBatch consolidateBoxBatch(const std::vector<cv::Rect>& boxes,
+                                         const std::vector<size_t>& frameOffsets,
+                                         const std::vector<size_t>& sequenceStarts,
+                                         const ConsolidationConfig& config, size_t workers) {
+    if (frameOffsets.empty() || frameOffsets.front() != 0 || frameOffsets.back() != boxes.size() ||
+        !std::is_sorted(frameOffsets.begin(), frameOffsets.end())) {
+        throw std::invalid_argument(
+            "consolidateBoxBatch: frame offsets must ascend from 0 to the box count");
+    }
+    const size_t frames = frameOffsets.size() - 1;
+    std::vector<size_t> starts = sequenceStarts.empty() ? std::vector<size_t>{0} : sequenceStarts;
+    if (starts.front() != 0 || std::adjacent_find(starts.begin(), starts.end(), std::greater_equal<>()) !=
+                                   starts.end() ||
+        (frames > 0 && starts.back() >= frames)) {
+        throw std::invalid_argument(
+            "consolidateBoxBatch: sequence starts must be ascending frame indices from 0");
+    }
+    starts.push_back(frames);
+
+    // Each sequence fills only its own frames, so the workers share nothing
+    std::vector<std::vector<ConsolidatedRegion>> frameRegions(frames);
+    {
+        const size_t threads = workers > 0 ? workers : std::max(1u, std::thread::hardware_concurrency());
+        WorkStealingPool pool(std::min(threads, starts.size() - 1));
+        for (size_t s = 0; s + 1 < starts.size(); ++s) {
+            pool.submit([&, s] {
+                MotionRegionConsolidator consolidator(config);
+                TrackedObjectStore objects;
+                FrameArena arena;
+                std::vector<cv::Rect> frameBoxes;
+                for (size_t f = starts[s]; f < starts[s + 1]; ++f) {
+                    if (frameOffsets[f] == frameOffsets[f + 1]) continue;
+                    frameBoxes.assign(boxes.begin() + frameOffsets[f], boxes.begin() + frameOffsets[f + 1]);
+                    makeTrackedObjects(frameBoxes, objects);
+                    consolidator.consolidateRegionsInto(objects, frameRegions[f], &arena);
+                    arena.reset();  // Nothing allocated from it outlives the frame
+                }
+            });
+        }
+        pool.waitIdle();
+    }
+
+    ConsolidatedBoxBatch batch;
+    batch.regionOffsets.reserve(frames + 1);
+    batch.regionOffsets.push_back(0);
+    for (auto& regions : frameRegions) {
+        std::move(regions.begin(), regions.end(), std::back_inserter(batch.regions));
+        batch.regionOffsets.push_back(batch.regions.size());
+    }
+    return batch;
+}
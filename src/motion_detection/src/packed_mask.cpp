@@ -0,0 +1,327 @@
+#include "packed_mask.hpp"
+
+#include <algorithm>
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/imgproc.hpp>
+
+namespace {
+
+inline int popCount64(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(word);
+#else
+    int count = 0;
+    for (; word != 0; word &= word - 1) ++count;
+    return count;
+#endif
+}
+
+// Index of the lowest set bit of a non-zero word
+inline int trailingZeros64(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else
+    int count = 0;
+    for (; (word & 1u) == 0; word >>= 1) ++count;
+    return count;
+#endif
+}
+
+// dst |= src moved @p shift pixels towards higher and towards lower columns
+void orShifted(const uint64_t* src, uint64_t* dst, int words, int shift) {
+    const int wordShift = shift >> 6;
+    const int bitShift = shift & 63;
+    for (int w = 0; w < words; ++w) {
+        uint64_t moved = 0;
+        const int from = w - wordShift;  // Pixel x - shift
+        if (from >= 0) {
+            moved |= src[from] << bitShift;
+            if (bitShift != 0 && from > 0) moved |= src[from - 1] >> (64 - bitShift);
+        }
+        const int to = w + wordShift;  // Pixel x + shift
+        if (to < words) {
+            moved |= src[to] >> bitShift;
+            if (bitShift != 0 && to + 1 < words) moved |= src[to + 1] << (64 - bitShift);
+        }
+        dst[w] |= moved;
+    }
+}
+
+// out |= above | below (either may be nullptr)
+void orRows(const uint64_t* above, const uint64_t* below, uint64_t* out, int words) {
+    int w = 0;
+#if CV_SIMD128
+    for (; w + cv::v_uint64x2::nlanes <= words; w += cv::v_uint64x2::nlanes) {
+        cv::v_uint64x2 value = cv::v_load(out + w);
+        if (above) value = value | cv::v_load(above + w);
+        if (below) value = value | cv::v_load(below + w);
+        cv::v_store(out + w, value);
+    }
+#endif
+    for (; w < words; ++w) {
+        if (above) out[w] |= above[w];
+        if (below) out[w] |= below[w];
+    }
+}
+
+// The window around each pixel grows from radius R to R + step. With step <= R + 1 the two
+// shifted copies and the original leave no gap, even where the border clipped one side of
+// the window (a wider step would, next to the border)
+inline int nextStep(int reach, int radius) { return std::min(reach + 1, radius - reach); }
+
+}  // namespace
+
+void PackedMask::create(int rows, int cols) {
+    rows_ = std::max(0, rows);
+    cols_ = std::max(0, cols);
+    words_ = (cols_ + 63) / 64;
+    bits_.resize(static_cast<size_t>(rows_) * words_);
+}
+
+void PackedMask::setZero() { std::fill(bits_.begin(), bits_.end(), 0); }
+
+size_t PackedMask::count() const {
+    size_t total = 0;
+    for (const uint64_t word : bits_) total += popCount64(word);
+    return total;
+}
+
+void PackedMask::pack(const cv::Mat& mask) {
+    CV_Assert(mask.type() == CV_8UC1);
+    create(mask.rows, mask.cols);
+    for (int y = 0; y < rows_; ++y) {
+        const uchar* in = mask.ptr<uchar>(y);
+        uint64_t* out = row(y);
+        for (int w = 0; w < words_; ++w) {
+            const int start = w * 64;
+            const int end = std::min(cols_, start + 64);
+            uint64_t bits = 0;
+            int x = start;
+#if CV_SIMD128
+            if (end - start == 64) {
+                const cv::v_uint8x16 zero = cv::v_setzero_u8();
+                for (int lane = 0; lane < 4; ++lane, x += 16) {
+                    const cv::v_uint8x16 set = cv::v_load(in + x) != zero;
+                    bits |= static_cast<uint64_t>(static_cast<uint16_t>(cv::v_signmask(set))) << (lane * 16);
+                }
+            }
+#endif
+            for (; x < end; ++x) {
+                if (in[x]) bits |= uint64_t(1) << (x - start);
+            }
+            out[w] = bits;
+        }
+    }
+}
+
+void PackedMask::unpack(cv::Mat& mask, uchar value) const {
+    mask.create(rows_, cols_, CV_8UC1);
+    for (int y = 0; y < rows_; ++y) {
+        const uint64_t* in = row(y);
+        uchar* out = mask.ptr<uchar>(y);
+        for (int x = 0; x < cols_; ++x) out[x] = ((in[x >> 6] >> (x & 63)) & 1u) ? value : 0;
+    }
+}
+
+uint64_t PackedMask::lastWordMask() const {
+    const int used = cols_ & 63;
+    return used == 0 ? ~uint64_t(0) : (uint64_t(1) << used) - 1;
+}
+
+void PackedMask::clearPadding() {
+    if ((cols_ & 63) == 0) return;
+    const uint64_t keep = lastWordMask();
+    for (int y = 0; y < rows_; ++y) row(y)[words_ - 1] &= keep;
+}
+
+void PackedMask::invert() {
+    for (uint64_t& word : bits_) word = ~word;
+    clearPadding();
+}
+
+void thresholdMotionPacked(const cv::Mat& diff, const cv::Mat& background, const cv::Mat& excluded,
+                           int threshold, PackedMask& thresh) {
+    CV_Assert(diff.type() == CV_8UC1);
+    thresh.create(diff.rows, diff.cols);
+    if (threshold >= 255) {
+        thresh.setZero();
+        return;
+    }
+    const bool every = threshold < 0;  // Every pixel is above it
+    const int cols = diff.cols;
+    const int words = thresh.wordsPerRow();
+    for (int y = 0; y < diff.rows; ++y) {
+        const uchar* d = diff.ptr<uchar>(y);
+        const uchar* b = background.empty() ? nullptr : background.ptr<uchar>(y);
+        const uchar* e = excluded.empty() ? nullptr : excluded.ptr<uchar>(y);
+        uint64_t* out = thresh.row(y);
+        for (int w = 0; w < words; ++w) {
+            const int start = w * 64;
+            const int end = std::min(cols, start + 64);
+            uint64_t bits = 0;
+            int x = start;
+#if CV_SIMD128
+            if (end - start == 64) {
+                const cv::v_uint8x16 zero = cv::v_setzero_u8();
+                const cv::v_uint8x16 level = cv::v_setall_u8(static_cast<uchar>(std::max(threshold, 0)));
+                for (int lane = 0; lane < 4; ++lane, x += 16) {
+                    cv::v_uint8x16 value = cv::v_load(d + x);
+                    if (b) value = value | cv::v_load(b + x);
+                    cv::v_uint8x16 set = every ? cv::v_setall_u8(255) : (value > level);
+                    if (e) set = set & (cv::v_load(e + x) == zero);
+                    bits |= static_cast<uint64_t>(static_cast<uint16_t>(cv::v_signmask(set))) << (lane * 16);
+                }
+            }
+#endif
+            for (; x < end; ++x) {
+                const int value = b ? (d[x] | b[x]) : d[x];
+                if (value > threshold && !(e && e[x])) bits |= uint64_t(1) << (x - start);
+            }
+            out[w] = bits;
+        }
+    }
+}
+
+void dilatePacked(PackedMask& mask, int radius, PackedMask::Scratch& scratch) {
+    if (mask.empty() || radius <= 0) return;
+    const int rows = mask.rows();
+    const int words = mask.wordsPerRow();
+    const uint64_t lastWord = mask.lastWordMask();
+
+    // Horizontal: shifted copies of each row, padding cleared before the next step reads it
+    scratch.row.resize(words);
+    for (int y = 0; y < rows; ++y) {
+        uint64_t* row = mask.row(y);
+        for (int reach = 0, step; reach < radius; reach += step) {
+            step = nextStep(reach, radius);
+            std::copy(row, row + words, scratch.row.begin());
+            orShifted(scratch.row.data(), row, words, step);
+            row[words - 1] &= lastWord;
+        }
+    }
+
+    // Vertical: whole rows step rows up and down
+    const size_t total = static_cast<size_t>(rows) * words;
+    for (int reach = 0, step; reach < radius; reach += step) {
+        step = nextStep(reach, radius);
+        scratch.rows.assign(mask.row(0), mask.row(0) + total);
+        const uint64_t* before = scratch.rows.data();
+        for (int y = 0; y < rows; ++y) {
+            const uint64_t* above = y - step >= 0 ? before + static_cast<size_t>(y - step) * words : nullptr;
+            const uint64_t* below = y + step < rows ? before + static_cast<size_t>(y + step) * words : nullptr;
+            orRows(above, below, mask.row(y), words);
+        }
+    }
+}
+
+void erodePacked(PackedMask& mask, int radius, PackedMask::Scratch& scratch) {
+    if (mask.empty() || radius <= 0) return;
+    // Outside pixels are unset in the complement, so they never win either way
+    mask.invert();
+    dilatePacked(mask, radius, scratch);
+    mask.invert();
+}
+
+void appendMaskRuns(const PackedMask& mask, int y, std::vector<MaskRun>& runs) {
+    const uint64_t* row = mask.row(y);
+    bool open = false;
+    int begin = 0;
+    for (int w = 0; w < mask.wordsPerRow(); ++w) {
+        const uint64_t word = row[w];
+        const int base = w << 6;
+        // Alternate between the next set bit (a run starts) and the next unset bit (it ends)
+        for (int bit = 0; bit < 64;) {
+            const uint64_t rest = (open ? ~word : word) >> bit;
+            if (rest == 0) break;
+            bit += trailingZeros64(rest);
+            if (open) {
+                runs.push_back({y, begin, base + bit});
+            } else {
+                begin = base + bit;
+            }
+            open = !open;
+        }
+    }
+    if (open) runs.push_back({y, begin, mask.cols()});
+}
+
+int RunLabeler::find(int run) {
+    while (parent_[run] != run) {
+        parent_[run] = parent_[parent_[run]];
+        run = parent_[run];
+    }
+    return run;
+}
+
+int RunLabeler::label(const PackedMask& mask) {
+    runs_.clear();
+    parent_.clear();
+    components_.clear();
+    lastRun_.clear();
+
+    int previousBegin = 0;
+    int previousEnd = 0;
+    for (int y = 0; y < mask.rows(); ++y) {
+        const int rowBegin = static_cast<int>(runs_.size());
+        appendMaskRuns(mask, y, runs_);
+        const int rowEnd = static_cast<int>(runs_.size());
+        for (int i = rowBegin; i < rowEnd; ++i) parent_.push_back(i);
+
+        // A run touches the runs of the row above that overlap it or end diagonally next to it
+        int first = previousBegin;
+        for (int i = rowBegin; i < rowEnd; ++i) {
+            const MaskRun& run = runs_[i];
+            while (first < previousEnd && runs_[first].end < run.begin) ++first;
+            for (int k = first; k < previousEnd && runs_[k].begin <= run.end; ++k) {
+                const int a = find(i);
+                const int b = find(k);
+                if (a != b) parent_[std::max(a, b)] = std::min(a, b);  // The earlier run stays the root
+            }
+        }
+        previousBegin = rowBegin;
+        previousEnd = rowEnd;
+    }
+
+    // A root is the first run of its component, so it is numbered before the others join it
+    const int runCount = static_cast<int>(runs_.size());
+    component_.resize(runCount);
+    nextRun_.assign(runCount, -1);
+    for (int i = 0; i < runCount; ++i) {
+        const MaskRun& run = runs_[i];
+        const cv::Rect bounds(run.begin, run.row, run.end - run.begin, 1);
+        const int root = find(i);
+        if (root == i) {
+            component_[i] = static_cast<int>(components_.size());
+            components_.push_back({bounds, bounds.width, i});
+            lastRun_.push_back(i);
+            continue;
+        }
+        const int index = component_[root];
+        Component& component = components_[index];
+        component.bounds |= bounds;
+        component.pixels += bounds.width;
+        nextRun_[lastRun_[index]] = i;
+        lastRun_[index] = i;
+    }
+    return static_cast<int>(components_.size());
+}
+
+double RunLabeler::solidity(int component) const {
+    corners_.clear();
+    for (int run = components_[component].firstRun; run >= 0;) {
+        const int y = runs_[run].row;
+        const int left = runs_[run].begin;
+        int right = runs_[run].end;
+        for (run = nextRun_[run]; run >= 0 && runs_[run].row == y; run = nextRun_[run]) {
+            right = std::max(right, runs_[run].end);
+        }
+        corners_.emplace_back(left, y);
+        corners_.emplace_back(right, y);
+        corners_.emplace_back(left, y + 1);
+        corners_.emplace_back(right, y + 1);
+    }
+    if (corners_.empty()) return 0.0;
+    cv::convexHull(corners_, hull_);
+    const double hullArea = cv::contourArea(hull_);
+    return hullArea > 0 ? components_[component].pixels / hullArea : 0.0;
+}
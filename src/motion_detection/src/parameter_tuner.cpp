@@ -0,0 +1,238 @@
+#include "parameter_tuner.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace {
+
+// @p text as a number, if all of it is one
+std::optional<double> numeric(const std::string& text) {
+    if (text.empty()) return std::nullopt;
+    char* end = nullptr;
+    const double value = std::strtod(text.c_str(), &end);
+    if (end != text.c_str() + text.size()) return std::nullopt;
+    return value;
+}
+
+bool sameValue(const std::string& a, const std::string& b) {
+    const auto x = numeric(a);
+    const auto y = numeric(b);
+    return x && y ? *x == *y : a == b;
+}
+
+}  // namespace
+
+ParameterTuner::ParameterTuner(std::vector<TuningParameter> space, const YAML::Node& base, const Settings& settings)
+    : base_(YAML::Clone(base)), settings_(settings) {
+    for (TuningParameter& parameter : space) {
+        if (parameter.values.empty() && !(base[parameter.key] && base[parameter.key].IsScalar())) continue;
+        size_t current = kUnset;
+        if (base[parameter.key] && base[parameter.key].IsScalar()) {
+            const std::string value = base[parameter.key].Scalar();
+            const auto found =
+                std::find_if(parameter.values.begin(), parameter.values.end(),
+                             [&](const std::string& candidate) { return sameValue(candidate, value); });
+            if (found != parameter.values.end()) {
+                current = static_cast<size_t>(found - parameter.values.begin());
+            } else {
+                // Keep numeric candidates in order, so neighbour() steps to the next larger or smaller value
+                auto at = parameter.values.end();
+                if (const auto number = numeric(value)) {
+                    at = std::find_if(parameter.values.begin(), parameter.values.end(), [&](const std::string& c) {
+                        const auto other = numeric(c);
+                        return other && *other > *number;
+                    });
+                }
+                current = static_cast<size_t>(at - parameter.values.begin());
+                parameter.values.insert(at, value);
+            }
+        }
+        space_.push_back(std::move(parameter));
+        baseline_.push_back(current);
+    }
+}
+
+std::vector<TuningParameter> ParameterTuner::defaultSpace() {
+    return {
+        {"detection_scale", {"0.25", "0.5", "0.75", "1.0"}},
+        {"blur_type", {"none", "stack", "gaussian", "median"}},
+        {"gaussian_blur_size", {"3", "5", "7", "9", "11", "13"}},
+        {"median_blur_size", {"3", "5", "7"}},
+        {"contrast_enhancement", {"false", "true"}},
+        {"clahe_mode", {"full", "cached"}},
+        {"frame_differencing", {"two_frame", "three_frame"}},
+        {"background_model", {"mog2", "knn", "running_average", "median"}},
+        {"background_update_interval", {"1", "2", "4"}},
+        {"background_update_scale", {"0.5", "1.0"}},
+        {"threshold_mode", {"otsu", "cached"}},
+        {"min_motion_threshold", {"0", "10", "15", "25"}},
+        {"hysteresis_low_ratio", {"0.0", "0.5"}},
+        {"morph_kernel_size", {"3", "5", "7", "9", "11"}},
+        {"morph_approximate", {"false", "true"}},
+        {"contour_extraction", {"contours", "components"}},
+        {"min_contour_area", {"200", "400", "800", "1200", "1600"}},
+        {"max_contour_aspect_ratio", {"2.0", "2.5", "3.0", "4.0"}},
+        {"min_contour_solidity", {"0.3", "0.4", "0.5", "0.6"}},
+        {"eps_fraction", {"0.015", "0.0227", "0.03", "0.04"}},
+        {"min_objects_per_region", {"1", "2", "3"}},
+        {"min_region_area", {"1000.0", "2000.0", "3000.0", "5000.0"}},
+    };
+}
+
+std::vector<TuningParameter> ParameterTuner::parseSpace(const YAML::Node& node) {
+    if (!node.IsMap()) throw std::invalid_argument("the search space must map config keys to lists of values");
+    std::vector<TuningParameter> space;
+    for (const auto& entry : node) {
+        TuningParameter parameter{entry.first.as<std::string>(), {}};
+        if (entry.second.IsScalar()) {
+            parameter.values.push_back(entry.second.Scalar());
+        } else if (entry.second.IsSequence()) {
+            for (const auto& value : entry.second) {
+                if (!value.IsScalar()) throw std::invalid_argument(parameter.key + ": values must be scalars");
+                parameter.values.push_back(value.Scalar());
+            }
+        } else {
+            throw std::invalid_argument(parameter.key + ": expected a list of values");
+        }
+        if (parameter.values.empty()) throw std::invalid_argument(parameter.key + ": no values to try");
+        space.push_back(std::move(parameter));
+    }
+    return space;
+}
+
+std::vector<TuningTrial> ParameterTuner::run(size_t trials, size_t threads, const Evaluate& evaluate) const {
+    trials = std::max<size_t>(1, trials);
+    const double fraction = std::clamp(settings_.explorationFraction, 0.0, 1.0);
+    const size_t exploration = 1 + static_cast<size_t>(fraction * static_cast<double>(trials - 1));
+
+    std::mutex mutex;
+    std::vector<TuningTrial> finished;
+    finished.reserve(trials);
+    std::set<TuningAssignment> tried{baseline_};
+    std::optional<TuningTrial> best;
+    size_t next = 0;
+
+    auto worker = [&] {
+        for (;;) {
+            TuningTrial trial;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (next >= trials) return;
+                trial.index = next++;
+                if (trial.index == 0) {
+                    trial.assignment = baseline_;
+                } else {
+                    // Drawn under the lock in trial order: the random phase only depends on the seed
+                    std::mt19937_64 rng(settings_.seed + trial.index * 0x9E3779B97F4A7C15ULL);
+                    for (int attempt = 0; attempt < 32; ++attempt) {
+                        trial.assignment = trial.index < exploration || !best ? sample(rng)
+                                                                              : neighbour(best->assignment, rng);
+                        if (tried.insert(trial.assignment).second) break;
+                    }
+                }
+            }
+            try {
+                evaluate(trial);
+            } catch (const std::exception& e) {
+                trial.valid = false;
+                trial.error = e.what();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!best || better(trial, *best)) best = trial;
+            finished.push_back(std::move(trial));
+        }
+    };
+
+    const size_t workers = std::clamp<size_t>(threads, 1, trials);
+    if (workers == 1) {
+        worker();
+    } else {
+        std::vector<std::thread> pool;
+        for (size_t i = 0; i < workers; ++i) pool.emplace_back(worker);
+        for (std::thread& thread : pool) thread.join();
+    }
+    std::stable_sort(finished.begin(), finished.end(),
+                     [this](const TuningTrial& a, const TuningTrial& b) { return better(a, b); });
+    return finished;
+}
+
+bool ParameterTuner::feasible(const TuningTrial& trial) const {
+    return trial.valid && trial.score.recall() >= settings_.minRecall &&
+           trial.score.precision() >= settings_.minPrecision;
+}
+
+bool ParameterTuner::better(const TuningTrial& a, const TuningTrial& b) const {
+    if (a.valid != b.valid) return a.valid;
+    if (!a.valid) return a.index < b.index;
+    const bool aFeasible = feasible(a);
+    if (aFeasible != feasible(b)) return aFeasible;
+    if (!aFeasible) {
+        auto shortfall = [this](const TuningTrial& trial) {
+            return std::max(0.0, settings_.minRecall - trial.score.recall()) +
+                   std::max(0.0, settings_.minPrecision - trial.score.precision());
+        };
+        const double aShortfall = shortfall(a);
+        const double bShortfall = shortfall(b);
+        if (aShortfall != bShortfall) return aShortfall < bShortfall;
+    }
+    return a.cpuMsPerFrame < b.cpuMsPerFrame;
+}
+
+YAML::Node ParameterTuner::apply(const TuningAssignment& assignment) const {
+    YAML::Node document = YAML::Clone(base_);
+    for (size_t p = 0; p < space_.size() && p < assignment.size(); ++p) {
+        if (assignment[p] < space_[p].values.size()) document[space_[p].key] = space_[p].values[assignment[p]];
+    }
+    return document;
+}
+
+std::string ParameterTuner::describe(const TuningAssignment& assignment) const {
+    std::ostringstream out;
+    for (size_t p = 0; p < space_.size() && p < assignment.size(); ++p) {
+        if (assignment[p] == baseline_[p] || assignment[p] >= space_[p].values.size()) continue;
+        if (out.tellp() > 0) out << ' ';
+        out << space_[p].key << '=' << space_[p].values[assignment[p]];
+    }
+    return out.tellp() > 0 ? out.str() : "(base config)";
+}
+
+TuningAssignment ParameterTuner::sample(std::mt19937_64& rng) const {
+    TuningAssignment assignment(space_.size());
+    for (size_t p = 0; p < space_.size(); ++p) {
+        assignment[p] = std::uniform_int_distribution<size_t>(0, space_[p].values.size() - 1)(rng);
+    }
+    return assignment;
+}
+
+TuningAssignment ParameterTuner::neighbour(const TuningAssignment& from, std::mt19937_64& rng) const {
+    TuningAssignment assignment = from;
+    if (space_.empty()) return assignment;
+    std::uniform_int_distribution<size_t> pick(0, space_.size() - 1);
+    const int changes = std::uniform_int_distribution<int>(1, 2)(rng);
+    for (int change = 0; change < changes; ++change) {
+        const size_t p = pick(rng);
+        const size_t count = space_[p].values.size();
+        if (count < 2) continue;
+        size_t& value = assignment[p];
+        if (value >= count) {
+            value = std::uniform_int_distribution<size_t>(0, count - 1)(rng);
+        } else if (std::bernoulli_distribution(0.5)(rng)) {
+            // Anywhere else: categorical keys have no meaningful order
+            const size_t other = std::uniform_int_distribution<size_t>(0, count - 2)(rng);
+            value = other >= value ? other + 1 : other;
+        } else if (value == 0 || (value + 1 < count && std::bernoulli_distribution(0.5)(rng))) {
+            ++value;
+        } else {
+            --value;
+        }
+    }
+    return assignment;
+}
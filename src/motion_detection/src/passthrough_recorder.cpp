@@ -0,0 +1,281 @@
+#include "passthrough_recorder.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+
+#include "logger.hpp"
+#include "thread_placement.hpp"
+
+// VIDEOWRITER_PROP_RAW_VIDEO / KEY_FLAG arrived in OpenCV 4.10
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 10)
+#define BIRDS_RAW_VIDEO_WRITER 1
+#else
+#define BIRDS_RAW_VIDEO_WRITER 0
+#endif
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+double secondsBetween(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double>(to - from).count();
+}
+
+Clock::duration secondsToDuration(double seconds) {
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+// event_YYYYmmdd_HHMMSS_<n>.mp4, in local time
+std::string segmentFileName(uint64_t index) {
+    const std::time_t now = std::time(nullptr);
+    std::tm local{};
+    localtime_r(&now, &local);
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", &local);
+    return std::string("event_") + stamp + "_" + std::to_string(index) + ".mp4";
+}
+
+// Longest a cue stays on screen when no later frame replaces it
+constexpr double kMaxCueSeconds = 0.5;
+
+}  // namespace
+
+PassthroughRecorder::PassthroughRecorder(const PassthroughConfig& config) : config_(config) {}
+
+PassthroughRecorder::~PassthroughRecorder() { stop(); }
+
+bool PassthroughRecorder::isSupported() { return BIRDS_RAW_VIDEO_WRITER != 0; }
+
+bool PassthroughRecorder::start() {
+    if (!config_.enabled || worker_.joinable()) return false;
+    if (!isSupported()) {
+        LOG_WARN("Pass-through recording needs OpenCV 4.10+ (raw VideoWriter); built against {}",
+                 CV_VERSION);
+        return false;
+    }
+    if (config_.source.empty()) {
+        LOG_WARN("Pass-through recording needs a network camera source; disabled");
+        return false;
+    }
+    stopRequested_ = false;
+    worker_ = std::thread(&PassthroughRecorder::run, this);
+    return true;
+}
+
+void PassthroughRecorder::stop() {
+    stopRequested_ = true;
+    if (worker_.joinable()) worker_.join();
+}
+
+void PassthroughRecorder::addOverlay(Clock::time_point captureTime, const cv::Size& frameSize,
+                                     const std::vector<cv::Rect>& regions) {
+    if (!config_.enabled || regions.empty()) return;
+    lastEventNanos_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          captureTime.time_since_epoch())
+                          .count();
+    std::lock_guard<std::mutex> lock(cueMutex_);
+    pendingCues_.push_back({captureTime, frameSize, regions});
+}
+
+PassthroughStats PassthroughRecorder::getStats() const {
+    PassthroughStats stats;
+    stats.segmentsWritten = segmentsWritten_.load();
+    stats.packetsWritten = packetsWritten_.load();
+    stats.bufferedPackets = bufferedPackets_.load();
+    stats.bufferedBytes = bufferedBytes_.load();
+    stats.connected = connected_.load();
+    stats.recording = recording_.load();
+    return stats;
+}
+
+std::string PassthroughRecorder::webVttTimestamp(double seconds) {
+    const long long millis = static_cast<long long>(std::max(0.0, seconds) * 1000.0 + 0.5);
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%02lld:%02lld:%02lld.%03lld", millis / 3600000,
+                  (millis / 60000) % 60, (millis / 1000) % 60, millis % 1000);
+    return buffer;
+}
+
+bool PassthroughRecorder::eventActive(Clock::time_point now) const {
+    const int64_t last = lastEventNanos_.load();
+    if (last == 0) return false;
+    const Clock::time_point lastEvent{std::chrono::duration_cast<Clock::duration>(
+        std::chrono::nanoseconds(last))};
+    return now - lastEvent <= secondsToDuration(config_.postRollSeconds);
+}
+
+void PassthroughRecorder::collectCues(Clock::time_point keepFrom) {
+    {
+        std::lock_guard<std::mutex> lock(cueMutex_);
+        cues_.insert(cues_.end(), std::make_move_iterator(pendingCues_.begin()),
+                     std::make_move_iterator(pendingCues_.end()));
+        pendingCues_.clear();
+    }
+    while (!cues_.empty() && cues_.front().time < keepFrom) cues_.pop_front();
+}
+
+#if BIRDS_RAW_VIDEO_WRITER
+void PassthroughRecorder::run() {
+    nameCurrentThread("passthrough");
+    const auto preRoll = secondsToDuration(config_.preRollSeconds);
+    const auto maxSegment = secondsToDuration(config_.maxSegmentSeconds);
+
+    while (!stopRequested_) {
+        if (!capture_.isOpened() && !openStream()) {
+            collectCues(Clock::now() - preRoll);  // Nothing to record them into
+            const auto retryAt = Clock::now() + std::chrono::milliseconds(config_.reconnectDelayMs);
+            while (!stopRequested_ && Clock::now() < retryAt) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+            continue;
+        }
+
+        cv::Mat raw;
+        if (!capture_.grab() || !capture_.retrieve(raw) || raw.empty()) {
+            LOG_WARN("Pass-through stream {} dropped; reconnecting", config_.source);
+            if (writer_.isOpened()) closeSegment(Clock::now());
+            capture_.release();
+            ring_.clear();
+            connected_ = false;
+            continue;
+        }
+
+        EncodedPacket packet;
+        packet.arrival = Clock::now();
+        packet.keyFrame = capture_.get(cv::CAP_PROP_LRF_HAS_KEY_FRAME) != 0;
+        packet.data.assign(raw.data, raw.data + raw.total() * raw.elemSize());
+        const bool active = eventActive(packet.arrival);
+
+        if (writer_.isOpened()) {
+            if (!active) {
+                closeSegment(packet.arrival);
+            } else if (packet.keyFrame && packet.arrival - segmentStart_ >= maxSegment) {
+                // Split long events on a keyframe, so every segment plays on its own
+                closeSegment(packet.arrival);
+                openSegment(packet.arrival);
+            }
+        }
+
+        if (writer_.isOpened()) {
+            writePacket(packet);
+            collectCues(segmentStart_);
+        } else {
+            ring_.push(std::move(packet));
+            ring_.trim(Clock::now() - preRoll);
+            if (active && !ring_.empty() && openSegment(ring_.front().arrival)) {
+                for (const auto& buffered : ring_.takeAll()) writePacket(buffered);
+            }
+            collectCues(writer_.isOpened() ? segmentStart_
+                                           : (ring_.empty() ? Clock::now() : ring_.front().arrival));
+        }
+        bufferedPackets_ = ring_.size();
+        bufferedBytes_ = ring_.bytes();
+    }
+
+    if (writer_.isOpened()) closeSegment(Clock::now());
+    capture_.release();
+    connected_ = false;
+}
+
+bool PassthroughRecorder::openStream() {
+    // Raw mode: retrieve() returns demuxed packets and nothing is decoded
+    const std::vector<int> params = {cv::CAP_PROP_OPEN_TIMEOUT_MSEC, 5000,
+                                     cv::CAP_PROP_READ_TIMEOUT_MSEC, 5000};
+    if (!capture_.open(config_.source, cv::CAP_FFMPEG, params) ||
+        !capture_.set(cv::CAP_PROP_FORMAT, -1)) {
+        if (!openFailureLogged_) {
+            LOG_WARN("Could not open {} for pass-through recording; retrying every {} ms",
+                     config_.source, config_.reconnectDelayMs);
+            openFailureLogged_ = true;
+        }
+        capture_.release();
+        return false;
+    }
+    openFailureLogged_ = false;
+
+    fourcc_ = static_cast<int>(capture_.get(cv::CAP_PROP_FOURCC));
+    fps_ = capture_.get(cv::CAP_PROP_FPS);
+    if (fps_ <= 0.0) fps_ = 25.0;
+    frameSize_ = cv::Size(static_cast<int>(capture_.get(cv::CAP_PROP_FRAME_WIDTH)),
+                          static_cast<int>(capture_.get(cv::CAP_PROP_FRAME_HEIGHT)));
+    connected_ = true;
+    LOG_INFO("Pass-through recording connected to {} ({}x{} @ {:.1f} fps, fourcc {:#x})",
+             config_.source, frameSize_.width, frameSize_.height, fps_, fourcc_);
+    return true;
+}
+
+bool PassthroughRecorder::openSegment(Clock::time_point start) {
+    std::error_code ec;
+    fs::create_directories(config_.outputDir, ec);
+    const std::string path =
+        (fs::path(config_.outputDir) / segmentFileName(segmentsWritten_.load())).string();
+    const std::vector<int> params = {cv::VIDEOWRITER_PROP_RAW_VIDEO, 1};
+    if (!writer_.open(path, cv::CAP_FFMPEG, fourcc_, fps_, frameSize_, params)) {
+        LOG_ERROR("Could not open pass-through segment {}", path);
+        return false;
+    }
+    segmentPath_ = path;
+    segmentStart_ = start;
+    recording_ = true;
+    LOG_INFO("Pass-through segment started: {}", path);
+    return true;
+}
+
+void PassthroughRecorder::writePacket(const EncodedPacket& packet) {
+    writer_.set(cv::VIDEOWRITER_PROP_KEY_FLAG, packet.keyFrame ? 1 : 0);
+    const cv::Mat bytes(1, static_cast<int>(packet.data.size()), CV_8UC1,
+                        const_cast<unsigned char*>(packet.data.data()));
+    writer_.write(bytes);
+    packetsWritten_++;
+}
+#else
+// start() never launches the recording thread on these builds
+void PassthroughRecorder::run() {}
+bool PassthroughRecorder::openStream() { return false; }
+bool PassthroughRecorder::openSegment(Clock::time_point) { return false; }
+void PassthroughRecorder::writePacket(const EncodedPacket&) {}
+#endif
+
+void PassthroughRecorder::closeSegment(Clock::time_point end) {
+    writer_.release();
+    collectCues(segmentStart_);
+    writeSidecar(end);
+    recording_ = false;
+    segmentsWritten_++;
+    LOG_INFO("Pass-through segment finished: {} ({:.1f} s)", segmentPath_,
+             secondsBetween(segmentStart_, end));
+}
+
+void PassthroughRecorder::writeSidecar(Clock::time_point end) {
+    const std::string path = fs::path(segmentPath_).replace_extension(".vtt").string();
+    std::ofstream vtt(path, std::ios::trunc);
+    if (!vtt) {
+        LOG_ERROR("Could not write overlay track {}", path);
+        return;
+    }
+    vtt << "WEBVTT\n\n";
+    for (size_t i = 0; i < cues_.size() && cues_[i].time <= end; ++i) {
+        const OverlayCue& cue = cues_[i];
+        Clock::time_point cueEnd = cue.time + secondsToDuration(kMaxCueSeconds);
+        if (i + 1 < cues_.size()) cueEnd = std::min(cueEnd, cues_[i + 1].time);
+        cueEnd = std::min(cueEnd, end);
+        if (cueEnd <= cue.time) continue;
+
+        vtt << webVttTimestamp(secondsBetween(segmentStart_, cue.time)) << " --> "
+            << webVttTimestamp(secondsBetween(segmentStart_, cueEnd)) << "\n";
+        vtt << "{\"frame_size\":[" << cue.frameSize.width << "," << cue.frameSize.height
+            << "],\"regions\":[";
+        for (size_t r = 0; r < cue.regions.size(); ++r) {
+            const cv::Rect& box = cue.regions[r];
+            vtt << (r ? "," : "") << "[" << box.x << "," << box.y << "," << box.width << ","
+                << box.height << "]";
+        }
+        vtt << "]}\n\n";
+    }
+    // Cues up to the end belong to this segment only
+    while (!cues_.empty() && cues_.front().time <= end) cues_.pop_front();
+}
@@ -0,0 +1,644 @@
+#include "persistence_backend.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <stdexcept>
+
+#include "frame_segment_store.hpp"
+#include "logger.hpp"
+#include "uplink_backend.hpp"
+
+#if BIRDS_HAVE_SQLITE
+#include <sqlite3.h>
+#endif
+
+namespace {
+
+// Comma before every member or element but the first
+void separate(std::string& out) {
+    if (!out.empty() && out.back() != '{' && out.back() != '[') out += ',';
+}
+
+void appendString(std::string& out, const std::string& value) {
+    out += '"';
+    for (const unsigned char c : value) {
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (c < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                } else {
+                    out += static_cast<char>(c);
+                }
+        }
+    }
+    out += '"';
+}
+
+void appendKey(std::string& out, const char* key) {
+    separate(out);
+    out += '"';
+    out += key;
+    out += "\":";
+}
+
+void appendNumber(std::string& out, double value) {
+    if (!std::isfinite(value)) {
+        out += "null";
+        return;
+    }
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.9g", value);
+    out += text;
+}
+
+void appendInteger(std::string& out, int64_t value) { out += std::to_string(value); }
+
+// Relaxed Extended JSON date with millisecond precision
+void appendDate(std::string& out, int64_t unixMs) {
+    const int64_t seconds = unixMs >= 0 ? unixMs / 1000 : (unixMs - 999) / 1000;
+    const std::time_t time = static_cast<std::time_t>(seconds);
+    std::tm utc{};
+    gmtime_r(&time, &utc);
+    char text[40];
+    const size_t length = std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%S", &utc);
+    std::snprintf(text + length, sizeof(text) - length, ".%03dZ", static_cast<int>(unixMs - seconds * 1000));
+    out += "{\"$date\":\"";
+    out += text;
+    out += "\"}";
+}
+
+void appendRect(std::string& out, const cv::Rect& rect) {
+    out += '[';
+    appendInteger(out, rect.x);
+    out += ',';
+    appendInteger(out, rect.y);
+    out += ',';
+    appendInteger(out, rect.width);
+    out += ',';
+    appendInteger(out, rect.height);
+    out += ']';
+}
+
+void appendBox(std::string& out, const cv::Rect& box) {
+    appendKey(out, "x");
+    appendInteger(out, box.x);
+    appendKey(out, "y");
+    appendInteger(out, box.y);
+    appendKey(out, "width");
+    appendInteger(out, box.width);
+    appendKey(out, "height");
+    appendInteger(out, box.height);
+}
+
+// The "metadata" subdocument, as FrameStore builds it
+void appendMetadata(std::string& out, const FrameMetadata& metadata) {
+    out += '{';
+    appendKey(out, "source");
+    appendString(out, metadata.source);
+    appendKey(out, "frame_count");
+    appendInteger(out, metadata.frameCount);
+    appendKey(out, "timestamp");
+    appendDate(out, metadata.timestamp * 1000);
+    appendKey(out, "auto_saved");
+    out += metadata.autoSaved ? "true" : "false";
+    appendKey(out, "motion_detected");
+    out += metadata.motionDetected ? "true" : "false";
+    appendKey(out, "motion_regions");
+    appendInteger(out, metadata.motionRegions);
+    appendKey(out, "consolidated_regions_count");
+    appendInteger(out, static_cast<int64_t>(metadata.consolidatedRegions.size()));
+    appendKey(out, "confidence");
+    appendNumber(out, metadata.confidence);
+    appendKey(out, "consolidated_regions");
+    out += '[';
+    for (const RegionMetadata& region : metadata.consolidatedRegions) {
+        separate(out);
+        out += '{';
+        appendBox(out, region.box);
+        appendKey(out, "object_count");
+        appendInteger(out, region.objectCount);
+        appendKey(out, "class_label");
+        appendString(out, region.classLabel);
+        appendKey(out, "class_confidence");
+        appendNumber(out, region.classConfidence);
+        appendKey(out, "class_id");
+        appendInteger(out, region.classId);
+        appendKey(out, "speed");
+        appendNumber(out, region.speed);
+        appendKey(out, "direction");
+        appendNumber(out, region.direction);
+        out += '}';
+    }
+    out += ']';
+    if (metadata.includeMotionBoxes) {
+        appendKey(out, "motion_boxes");
+        out += '[';
+        for (const cv::Rect& box : metadata.motionBoxes) {
+            separate(out);
+            out += '{';
+            appendBox(out, box);
+            out += '}';
+        }
+        out += ']';
+    }
+    if (metadata.captureTimeUs != 0) {
+        const LatencyMetadata& latency = metadata.latency;
+        appendKey(out, "capture_time");
+        appendDate(out, metadata.captureTimeUs / 1000);
+        appendKey(out, "source_timestamp_ms");
+        appendNumber(out, metadata.sourceTimestampMs);
+        appendKey(out, "latency_ms");
+        out += '{';
+        appendKey(out, "detect_queued");
+        appendNumber(out, latency.detectQueuedMs);
+        appendKey(out, "detect");
+        appendNumber(out, latency.detectMs);
+        appendKey(out, "consolidate_queued");
+        appendNumber(out, latency.consolidateQueuedMs);
+        appendKey(out, "consolidate");
+        appendNumber(out, latency.consolidateMs);
+        appendKey(out, "render_queued");
+        appendNumber(out, latency.renderQueuedMs);
+        appendKey(out, "total");
+        appendNumber(out, latency.totalMs);
+        out += '}';
+    }
+    if (!metadata.motionMask.size.empty()) {
+        const MotionMaskMetadata& mask = metadata.motionMask;
+        appendKey(out, "motion_mask");
+        out += '{';
+        appendKey(out, "width");
+        appendInteger(out, mask.size.width);
+        appendKey(out, "height");
+        appendInteger(out, mask.size.height);
+        appendKey(out, "roi");
+        out += '{';
+        appendBox(out, mask.frameArea);
+        out += '}';
+        appendKey(out, "pixels");
+        appendInteger(out, mask.pixels);
+        appendKey(out, "bounds");
+        out += '{';
+        appendBox(out, mask.bounds);
+        out += '}';
+        appendKey(out, "centroid");
+        out += '{';
+        appendKey(out, "x");
+        appendNumber(out, mask.centroid.x);
+        appendKey(out, "y");
+        appendNumber(out, mask.centroid.y);
+        out += '}';
+        appendKey(out, "counts");
+        appendString(out, mask.counts);
+        out += '}';
+    }
+    if (metadata.isVisit) {
+        const VisitMetadata& visit = metadata.visit;
+        appendKey(out, "visit");
+        out += '{';
+        appendKey(out, "start_time");
+        appendDate(out, visit.startUs / 1000);
+        appendKey(out, "end_time");
+        appendDate(out, visit.endUs / 1000);
+        appendKey(out, "duration_s");
+        appendNumber(out, static_cast<double>(visit.endUs - visit.startUs) / 1e6);
+        appendKey(out, "frames");
+        appendInteger(out, visit.frames);
+        appendKey(out, "track_ids");
+        out += '[';
+        for (const int id : visit.trackIds) {
+            separate(out);
+            appendInteger(out, id);
+        }
+        out += ']';
+        appendKey(out, "path");
+        out += '[';
+        for (const VisitPathPoint& point : visit.path) {
+            separate(out);
+            out += '{';
+            appendKey(out, "x");
+            appendInteger(out, point.center.x);
+            appendKey(out, "y");
+            appendInteger(out, point.center.y);
+            appendKey(out, "t_ms");
+            appendInteger(out, point.offsetMs);
+            out += '}';
+        }
+        out += ']';
+        appendKey(out, "crop_scores");
+        out += '[';
+        for (const double score : visit.cropScores) {
+            separate(out);
+            appendNumber(out, score);
+        }
+        out += ']';
+        out += '}';
+    }
+    out += '}';
+}
+
+int64_t unixMillisecondsNow() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+std::vector<std::string> recordUuids(const std::vector<StoredFrameRecord>& records) {
+    std::vector<std::string> uuids;
+    uuids.reserve(records.size());
+    for (const StoredFrameRecord& record : records) uuids.push_back(record.uuid);
+    return uuids;
+}
+
+// Stores nothing: every document counts as stored, so the images stay on disk
+class NullPersistenceBackend : public PersistenceBackend {
+   public:
+    const char* name() const override { return "none"; }
+    bool connect() override { return true; }
+    std::vector<std::string> insertRecords(const std::vector<StoredFrameRecord>& records) override {
+        return recordUuids(records);
+    }
+    bool upsertMotionSummaries(const std::vector<MotionMinuteSummary>&) override { return true; }
+};
+
+/**
+ * Frame documents go to <localPath>/frames and summaries to <localPath>/motion_stats, one
+ * JSON document per line, each batch in one append. Summaries are appended rather than
+ * merged: a reader adds up the counters of a minute's lines (a restart within the minute
+ * writes two) and keeps the maxima. A crash can leave a partial last line, which readers skip.
+ */
+class LocalPersistenceBackend : public PersistenceBackend {
+   public:
+    explicit LocalPersistenceBackend(const PersistenceBackendConfig& config) : config_(config) {}
+
+    const char* name() const override { return "local"; }
+
+    bool connect() override {
+        SegmentStoreConfig segmentConfig;
+        segmentConfig.segmentBytes = config_.localSegmentBytes;
+        segmentConfig.directory = (std::filesystem::path(config_.localPath) / "frames").string();
+        frames_ = std::make_unique<FrameSegmentStore>(segmentConfig);
+        segmentConfig.directory = (std::filesystem::path(config_.localPath) / "motion_stats").string();
+        summaries_ = std::make_unique<FrameSegmentStore>(segmentConfig);
+        return std::filesystem::is_directory(config_.localPath);
+    }
+
+    std::vector<std::string> insertRecords(const std::vector<StoredFrameRecord>& records) override {
+        if (!frames_ && !connect()) return {};
+        const int64_t now = unixMillisecondsNow();
+        lines_.clear();
+        for (const StoredFrameRecord& record : records) {
+            lines_ += frameDocumentJson(record, now);
+            lines_ += '\n';
+        }
+        if (!append(*frames_)) return {};
+        return recordUuids(records);
+    }
+
+    bool upsertMotionSummaries(const std::vector<MotionMinuteSummary>& summaries) override {
+        if (!summaries_ && !connect()) return false;
+        const int64_t now = unixMillisecondsNow();
+        lines_.clear();
+        for (const MotionMinuteSummary& summary : summaries) {
+            lines_ += motionSummaryJson(summary, now);
+            lines_ += '\n';
+        }
+        return append(*summaries_);
+    }
+
+   private:
+    bool append(FrameSegmentStore& store) {
+        bytes_.assign(lines_.begin(), lines_.end());
+        return bytes_.empty() || !store.append(bytes_).empty();
+    }
+
+    PersistenceBackendConfig config_;
+    std::unique_ptr<FrameSegmentStore> frames_;
+    std::unique_ptr<FrameSegmentStore> summaries_;
+    std::string lines_;                 // Reused batch text
+    std::vector<unsigned char> bytes_;  // Reused append buffer
+};
+
+#if BIRDS_HAVE_SQLITE
+/**
+ * captured_frames (id, source, timestamp, created_at, document) with the JSON document and
+ * the columns the viewer pages on, and motion_stats with one row per (source, minute),
+ * merged like FrameStore's upsert: counters added, maxima kept, the rest replaced. WAL
+ * journaling, so readers never block the worker; each batch is one transaction.
+ */
+class SqlitePersistenceBackend : public PersistenceBackend {
+   public:
+    explicit SqlitePersistenceBackend(const PersistenceBackendConfig& config) : path_(config.sqlitePath) {}
+
+    ~SqlitePersistenceBackend() override { close(); }
+
+    const char* name() const override { return "sqlite"; }
+
+    bool connect() override {
+        close();
+        const std::filesystem::path parent = std::filesystem::path(path_).parent_path();
+        std::error_code ec;
+        if (!parent.empty()) std::filesystem::create_directories(parent, ec);
+        if (sqlite3_open_v2(path_.c_str(), &db_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) !=
+            SQLITE_OK) {
+            LOG_ERROR("Could not open {}: {}", path_, db_ ? sqlite3_errmsg(db_) : "out of memory");
+            close();
+            return false;
+        }
+        const bool ready =
+            execute("PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL;"
+                    "CREATE TABLE IF NOT EXISTS captured_frames (id TEXT PRIMARY KEY, source TEXT, "
+                    "timestamp INTEGER, created_at INTEGER, document TEXT NOT NULL);"
+                    "CREATE INDEX IF NOT EXISTS captured_frames_timestamp ON captured_frames (timestamp);"
+                    "CREATE TABLE IF NOT EXISTS motion_stats (id TEXT PRIMARY KEY, source TEXT, "
+                    "minute INTEGER, frames INTEGER, motion_frames INTEGER, motion_boxes INTEGER, "
+                    "regions INTEGER, max_regions INTEGER, latency_max_ms REAL, mean_boxes_per_frame REAL, "
+                    "latency_p50_ms REAL, latency_p95_ms REAL, latency_p99_ms REAL, updated_at INTEGER);") &&
+            // A frame stored again (an uplink resend) replaces its document
+            prepare("INSERT INTO captured_frames (id, source, timestamp, created_at, document) "
+                    "VALUES (?1, ?2, ?3, ?4, ?5) ON CONFLICT (id) DO UPDATE SET source = excluded.source, "
+                    "timestamp = excluded.timestamp, document = excluded.document",
+                    insertFrame_) &&
+            prepare("INSERT INTO motion_stats VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11, ?12, ?13, ?14) "
+                    "ON CONFLICT (id) DO UPDATE SET frames = frames + excluded.frames, "
+                    "motion_frames = motion_frames + excluded.motion_frames, "
+                    "motion_boxes = motion_boxes + excluded.motion_boxes, regions = regions + excluded.regions, "
+                    "max_regions = max(max_regions, excluded.max_regions), "
+                    "latency_max_ms = max(latency_max_ms, excluded.latency_max_ms), "
+                    "mean_boxes_per_frame = excluded.mean_boxes_per_frame, "
+                    "latency_p50_ms = excluded.latency_p50_ms, latency_p95_ms = excluded.latency_p95_ms, "
+                    "latency_p99_ms = excluded.latency_p99_ms, updated_at = excluded.updated_at",
+                    upsertSummary_);
+        if (!ready) close();
+        return ready;
+    }
+
+    std::vector<std::string> insertRecords(const std::vector<StoredFrameRecord>& records) override {
+        std::vector<std::string> inserted;
+        if ((!db_ && !connect()) || !execute("BEGIN")) return inserted;
+        const int64_t now = unixMillisecondsNow();
+        for (const StoredFrameRecord& record : records) {
+            const std::string document = frameDocumentJson(record, now);
+            sqlite3_bind_text(insertFrame_, 1, record.uuid.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(insertFrame_, 2, record.metadata.source.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_int64(insertFrame_, 3, record.metadata.timestamp);
+            sqlite3_bind_int64(insertFrame_, 4, now);
+            sqlite3_bind_text(insertFrame_, 5, document.c_str(), static_cast<int>(document.size()), SQLITE_TRANSIENT);
+            if (sqlite3_step(insertFrame_) == SQLITE_DONE) {
+                inserted.push_back(record.uuid);
+            } else {
+                LOG_ERROR("Frame {} not stored in {}: {}", record.uuid, path_, sqlite3_errmsg(db_));
+            }
+            sqlite3_reset(insertFrame_);
+        }
+        if (!execute("COMMIT")) {
+            execute("ROLLBACK");
+            inserted.clear();
+        }
+        return inserted;
+    }
+
+    bool upsertMotionSummaries(const std::vector<MotionMinuteSummary>& summaries) override {
+        if ((!db_ && !connect()) || !execute("BEGIN")) return false;
+        const int64_t now = unixMillisecondsNow();
+        bool ok = true;
+        for (const MotionMinuteSummary& summary : summaries) {
+            const std::string id = summary.id();
+            sqlite3_bind_text(upsertSummary_, 1, id.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(upsertSummary_, 2, summary.source.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_int64(upsertSummary_, 3, summary.minuteStart);
+            sqlite3_bind_int64(upsertSummary_, 4, static_cast<int64_t>(summary.frames));
+            sqlite3_bind_int64(upsertSummary_, 5, static_cast<int64_t>(summary.motionFrames));
+            sqlite3_bind_int64(upsertSummary_, 6, static_cast<int64_t>(summary.motionBoxes));
+            sqlite3_bind_int64(upsertSummary_, 7, static_cast<int64_t>(summary.regions));
+            sqlite3_bind_int64(upsertSummary_, 8, static_cast<int64_t>(summary.maxRegions));
+            sqlite3_bind_double(upsertSummary_, 9, summary.latencyMaxMs);
+            sqlite3_bind_double(upsertSummary_, 10, summary.meanBoxesPerFrame());
+            sqlite3_bind_double(upsertSummary_, 11, summary.latencyP50Ms);
+            sqlite3_bind_double(upsertSummary_, 12, summary.latencyP95Ms);
+            sqlite3_bind_double(upsertSummary_, 13, summary.latencyP99Ms);
+            sqlite3_bind_int64(upsertSummary_, 14, now);
+            ok = sqlite3_step(upsertSummary_) == SQLITE_DONE && ok;
+            sqlite3_reset(upsertSummary_);
+        }
+        if (!ok || !execute("COMMIT")) {
+            LOG_ERROR("Motion summaries not stored in {}: {}", path_, sqlite3_errmsg(db_));
+            execute("ROLLBACK");
+            return false;
+        }
+        return true;
+    }
+
+   private:
+    bool execute(const char* sql) {
+        char* error = nullptr;
+        if (sqlite3_exec(db_, sql, nullptr, nullptr, &error) == SQLITE_OK) return true;
+        LOG_ERROR("SQLite error in {}: {}", path_, error ? error : "unknown");
+        sqlite3_free(error);
+        return false;
+    }
+
+    bool prepare(const char* sql, sqlite3_stmt*& statement) {
+        if (sqlite3_prepare_v2(db_, sql, -1, &statement, nullptr) == SQLITE_OK) return true;
+        LOG_ERROR("SQLite error in {}: {}", path_, sqlite3_errmsg(db_));
+        return false;
+    }
+
+    void close() {
+        sqlite3_finalize(insertFrame_);
+        sqlite3_finalize(upsertSummary_);
+        insertFrame_ = nullptr;
+        upsertSummary_ = nullptr;
+        sqlite3_close(db_);
+        db_ = nullptr;
+    }
+
+    std::string path_;
+    sqlite3* db_ = nullptr;
+    sqlite3_stmt* insertFrame_ = nullptr;
+    sqlite3_stmt* upsertSummary_ = nullptr;
+};
+#endif
+
+}  // namespace
+
+std::unique_ptr<PersistenceBackend> makePersistenceBackend(const PersistenceBackendConfig& config) {
+    if (config.name == "none") return std::make_unique<NullPersistenceBackend>();
+    if (config.name == "local") return std::make_unique<LocalPersistenceBackend>(config);
+    if (config.name == "uplink") return std::make_unique<UplinkPersistenceBackend>(config);
+    if (config.name == "sqlite") {
+#if BIRDS_HAVE_SQLITE
+        return std::make_unique<SqlitePersistenceBackend>(config);
+#else
+        throw std::invalid_argument("persistence backend \"sqlite\" needs a build with ENABLE_SQLITE");
+#endif
+    }
+    throw std::invalid_argument("Unknown persistence backend: " + config.name);
+}
+
+std::string frameDocumentJson(const StoredFrameRecord& record, int64_t nowMs) {
+    std::string out = "{";
+    appendKey(out, "_id");
+    appendString(out, record.uuid);
+    // null for images that were not written, as FrameDatabaseV2 stores them
+    for (const auto& image : {std::make_pair("original_image_path", &record.originalPath),
+                              std::make_pair("processed_image_path", &record.processedPath),
+                              std::make_pair("original_thumbnail_path", &record.originalThumbnailPath),
+                              std::make_pair("processed_thumbnail_path", &record.processedThumbnailPath)}) {
+        appendKey(out, image.first);
+        if (image.second->empty()) {
+            out += "null";
+        } else {
+            appendString(out, *image.second);
+        }
+    }
+    for (const auto& image :
+         {std::make_pair("original_image_segment", &record.originalSegment),
+          std::make_pair("processed_image_segment", &record.processedSegment),
+          std::make_pair("original_thumbnail_segment", &record.originalThumbnailSegment),
+          std::make_pair("processed_thumbnail_segment", &record.processedThumbnailSegment)}) {
+        const SegmentExtent& extent = *image.second;
+        if (extent.empty()) continue;
+        appendKey(out, image.first);
+        out += '{';
+        appendKey(out, "file");
+        appendString(out, extent.file);
+        appendKey(out, "offset");
+        appendInteger(out, static_cast<int64_t>(extent.offset));
+        appendKey(out, "length");
+        appendInteger(out, static_cast<int64_t>(extent.length));
+        if (!extent.contentType.empty()) {
+            appendKey(out, "content_type");
+            appendString(out, extent.contentType);
+        }
+        out += '}';
+    }
+    appendKey(out, "images");
+    out += '{';
+    for (const StoredImageLink& link : storedImageLinks(record)) {
+        appendKey(out, link.kind);
+        out += '{';
+        appendKey(out, "url");
+        appendString(out, link.url);
+        appendKey(out, "bytes");
+        appendInteger(out, static_cast<int64_t>(link.bytes));
+        out += '}';
+    }
+    out += '}';
+    if (!record.regionCrops.empty()) {
+        appendKey(out, "region_crops");
+        out += '[';
+        for (size_t i = 0; i < record.regionCrops.size(); ++i) {
+            const StoredRegionCrop& crop = record.regionCrops[i];
+            separate(out);
+            out += '{';
+            appendKey(out, "path");
+            appendString(out, crop.path);
+            appendKey(out, "region");
+            appendRect(out, crop.region);
+            appendKey(out, "crop");
+            appendRect(out, crop.crop);
+            appendKey(out, "url");
+            appendString(out, regionCropUrl(record.uuid, i));
+            appendKey(out, "bytes");
+            appendInteger(out, static_cast<int64_t>(crop.bytes));
+            out += '}';
+        }
+        out += ']';
+    }
+    if (!record.plate.id.empty()) {
+        appendKey(out, "background_plate");
+        out += '{';
+        appendKey(out, "id");
+        appendString(out, record.plate.id);
+        appendKey(out, "path");
+        appendString(out, record.plate.path);
+        appendKey(out, "size");
+        out += '[' + std::to_string(record.plate.size.width) + ',' + std::to_string(record.plate.size.height) + ']';
+        out += '}';
+    }
+    if (!record.atlasCell.sheet.empty()) {
+        const AtlasCell& cell = record.atlasCell;
+        appendKey(out, "thumbnail_atlas");
+        out += '{';
+        appendKey(out, "sheet");
+        appendString(out, cell.sheet);
+        appendKey(out, "sheet_size");
+        out += '[' + std::to_string(cell.sheetSize.width) + ',' + std::to_string(cell.sheetSize.height) + ']';
+        appendKey(out, "rect");
+        appendRect(out, cell.rect);
+        out += '}';
+    }
+    appendKey(out, "frame_shape");
+    out += '[' + std::to_string(record.processedSize.height) + ',' + std::to_string(record.processedSize.width) +
+           ',' + std::to_string(record.processedChannels) + ']';
+    appendKey(out, "original_frame_shape");
+    out += '[' + std::to_string(record.originalSize.height) + ',' + std::to_string(record.originalSize.width) +
+           ',' + std::to_string(record.originalChannels) + ']';
+    appendKey(out, "frame_dtype");
+    out += "\"uint8\"";
+    appendKey(out, "original_frame_dtype");
+    out += "\"uint8\"";
+    appendKey(out, "timestamp");
+    appendDate(out, nowMs);
+    appendKey(out, "created_at");
+    appendDate(out, nowMs);
+    appendKey(out, "metadata");
+    appendMetadata(out, record.metadata);
+    out += '}';
+    return out;
+}
+
+std::string motionSummaryJson(const MotionMinuteSummary& summary, int64_t nowMs) {
+    std::string out = "{";
+    appendKey(out, "_id");
+    appendString(out, summary.id());
+    appendKey(out, "source");
+    appendString(out, summary.source);
+    appendKey(out, "minute");
+    appendDate(out, summary.minuteStart * 1000);
+    appendKey(out, "frames");
+    appendInteger(out, static_cast<int64_t>(summary.frames));
+    appendKey(out, "motion_frames");
+    appendInteger(out, static_cast<int64_t>(summary.motionFrames));
+    appendKey(out, "motion_boxes");
+    appendInteger(out, static_cast<int64_t>(summary.motionBoxes));
+    appendKey(out, "regions");
+    appendInteger(out, static_cast<int64_t>(summary.regions));
+    appendKey(out, "max_regions");
+    appendInteger(out, static_cast<int64_t>(summary.maxRegions));
+    appendKey(out, "latency_max_ms");
+    appendNumber(out, summary.latencyMaxMs);
+    appendKey(out, "mean_boxes_per_frame");
+    appendNumber(out, summary.meanBoxesPerFrame());
+    appendKey(out, "latency_p50_ms");
+    appendNumber(out, summary.latencyP50Ms);
+    appendKey(out, "latency_p95_ms");
+    appendNumber(out, summary.latencyP95Ms);
+    appendKey(out, "latency_p99_ms");
+    appendNumber(out, summary.latencyP99Ms);
+    appendKey(out, "updated_at");
+    appendDate(out, nowMs);
+    out += '}';
+    return out;
+}
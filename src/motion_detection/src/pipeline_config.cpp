@@ -0,0 +1,648 @@
+#include "pipeline_config.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <initializer_list>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Collects every problem of one document so a bad file is reported in one message
+class Validator {
+   public:
+    explicit Validator(const YAML::Node& document) : document_(document) {}
+
+    // Converts document[section][key] (or document[key] without a section) into @p value
+    // when present; a wrong type is recorded and leaves @p value unchanged
+    template <typename T>
+    bool read(const char* key, T& value, const char* section = nullptr) {
+        const YAML::Node parent = section ? document_[section] : document_;
+        if (!parent || !parent.IsMap()) return false;
+        const YAML::Node node = parent[key];
+        if (!node) return false;
+        try {
+            value = node.as<T>();
+            return true;
+        } catch (const YAML::Exception&) {
+            fail(section, key, std::string("expected ") + typeName<T>());
+            return false;
+        }
+    }
+
+    template <typename T>
+    void requireType(std::initializer_list<const char*> keys) {
+        for (const char* key : keys) {
+            T ignored{};
+            read(key, ignored);
+        }
+    }
+
+    void fail(const char* section, const char* key, const std::string& problem) {
+        errors_.push_back((section ? std::string(section) + "." : std::string()) + key + ": " + problem);
+    }
+
+    const std::vector<std::string>& errors() const { return errors_; }
+
+   private:
+    template <typename T>
+    static const char* typeName() {
+        if constexpr (std::is_same_v<T, bool>) return "a boolean";
+        if constexpr (std::is_integral_v<T>) return "an integer";
+        if constexpr (std::is_floating_point_v<T>) return "a number";
+        if constexpr (std::is_same_v<T, std::vector<std::string>>) return "a list of strings";
+        if constexpr (std::is_same_v<T, std::vector<double>>) return "a list of numbers";
+        return "a string";
+    }
+
+    const YAML::Node& document_;
+    std::vector<std::string> errors_;
+};
+
+void readLogging(Validator& validator, LoggingSettings& logging) {
+    if (validator.read("log_level", logging.level, "logging")) {
+        static const char* const kLevels[] = {"trace", "debug", "info", "warn", "warning",
+                                              "error", "critical", "off"};
+        bool known = false;
+        for (const char* level : kLevels) known = known || logging.level == level;
+        if (!known) validator.fail("logging", "log_level", "unknown level '" + logging.level + "'");
+    }
+    validator.read("log_to_file", logging.toFile, "logging");
+    validator.read("log_file_path", logging.filePath, "logging");
+    validator.read("async", logging.async.enabled, "logging");
+    if (validator.read("async_queue_size", logging.async.queueSize, "logging") && logging.async.queueSize == 0) {
+        validator.fail("logging", "async_queue_size", "must be positive");
+    }
+    std::string overflow;
+    if (validator.read("async_overflow", overflow, "logging")) {
+        logging.async.blockOnOverflow = overflow == "block";
+    }
+    validator.read("diagnostic_lines_per_second", logging.diagnosticLinesPerSecond, "logging");
+}
+
+void readConsolidation(Validator& validator, ConsolidationConfig& consolidation) {
+    if (validator.read("eps", consolidation.eps) && consolidation.eps <= 0.0) {
+        validator.fail(nullptr, "eps", "must be positive");
+    }
+    if (validator.read("min_pts", consolidation.minPts) && consolidation.minPts < 1) {
+        validator.fail(nullptr, "min_pts", "must be at least 1");
+    }
+    if (validator.read("overlap_weight", consolidation.overlapWeight) && consolidation.overlapWeight < 0.0) {
+        validator.fail(nullptr, "overlap_weight", "must not be negative");
+    }
+    if (validator.read("edge_weight", consolidation.edgeWeight) && consolidation.edgeWeight < 0.0) {
+        validator.fail(nullptr, "edge_weight", "must not be negative");
+    }
+    validator.read("max_edge_distance", consolidation.maxEdgeDistance);
+    std::string metric;
+    if (validator.read("distance_metric", metric)) {
+        try {
+            consolidation.distanceMetric = parseDistanceMetric(metric);
+        } catch (const std::invalid_argument&) {
+            validator.fail(nullptr, "distance_metric", "unknown metric '" + metric + "'");
+        }
+    }
+    validator.read("max_frames_without_update", consolidation.maxFramesWithoutUpdate);
+    validator.read("region_expansion_factor", consolidation.regionExpansionFactor);
+    validator.read("incremental_clustering", consolidation.incrementalClustering);
+    if (validator.read("keyframe_interval", consolidation.keyframeInterval) && consolidation.keyframeInterval < 1) {
+        validator.fail(nullptr, "keyframe_interval", "must be at least 1");
+    }
+    if (validator.read("keyframe_box_count_change", consolidation.keyframeBoxCountChange) &&
+        consolidation.keyframeBoxCountChange < 0.0) {
+        validator.fail(nullptr, "keyframe_box_count_change", "must not be negative");
+    }
+    if (validator.read("keyframe_max_unassigned", consolidation.keyframeMaxUnassigned) &&
+        (consolidation.keyframeMaxUnassigned < 0.0 || consolidation.keyframeMaxUnassigned > 1.0)) {
+        validator.fail(nullptr, "keyframe_max_unassigned", "must be within [0, 1]");
+    }
+    if (validator.read("keyframe_attach_iou", consolidation.keyframeAttachIou) &&
+        (consolidation.keyframeAttachIou < 0.0 || consolidation.keyframeAttachIou > 1.0)) {
+        validator.fail(nullptr, "keyframe_attach_iou", "must be within [0, 1]");
+    }
+    validator.read("memoize_unchanged_frames", consolidation.memoizeUnchangedFrames);
+    if (validator.read("memoize_quantization", consolidation.memoizeQuantization) &&
+        consolidation.memoizeQuantization < 0) {
+        validator.fail(nullptr, "memoize_quantization", "must not be negative");
+    }
+    if (validator.read("parallel_clustering_min_boxes", consolidation.parallelClusteringMinBoxes) &&
+        consolidation.parallelClusteringMinBoxes < 0) {
+        validator.fail(nullptr, "parallel_clustering_min_boxes", "must not be negative");
+    }
+    validator.read("grid_cell_size", consolidation.gridCellSize);
+    validator.read("max_distance_threshold", consolidation.maxDistanceThreshold);
+    validator.read("min_objects_per_region", consolidation.minObjectsPerRegion);
+    validator.read("min_region_area", consolidation.minRegionArea);
+    validator.read("max_region_area", consolidation.maxRegionArea);
+    validator.read("overlap_threshold", consolidation.overlapThreshold);
+    validator.read("eps_fraction", consolidation.epsFraction);
+    validator.read("max_edge_distance_fraction", consolidation.maxEdgeDistanceFraction);
+    if (validator.read("clustering_trace_capacity", consolidation.clusteringTraceCapacity) &&
+        consolidation.clusteringTraceCapacity < 0) {
+        validator.fail(nullptr, "clustering_trace_capacity", "must not be negative");
+    }
+    validator.read("clustering_trace_path", consolidation.clusteringTracePath);
+    if (validator.read("hierarchy_levels", consolidation.hierarchyLevels)) {
+        for (double level : consolidation.hierarchyLevels) {
+            if (level <= 0.0) validator.fail(nullptr, "hierarchy_levels", "cuts must be positive multiples of eps");
+        }
+    }
+}
+
+void readTracker(Validator& validator, PipelineConfig& config) {
+    validator.read("tracker_enabled", config.trackerEnabled);
+    if (validator.read("tracker_min_iou", config.tracker.minIou) &&
+        (config.tracker.minIou < 0.0 || config.tracker.minIou > 1.0)) {
+        validator.fail(nullptr, "tracker_min_iou", "must be within [0, 1]");
+    }
+    validator.read("tracker_max_missed_frames", config.tracker.maxFramesWithoutDetection);
+    validator.read("tracker_use_kalman", config.tracker.useKalman);
+}
+
+// MotionProcessor keys: applied by the processor itself, but a wrong type is caught here
+// instead of silently falling back to the default on every stream
+void readStageGraph(Validator& validator, StageGraphSettings& stageGraph) {
+    auto checkNames = [&](const char* key, const std::vector<std::string>& names,
+                          const std::vector<std::string>& known, const char* what) {
+        for (size_t i = 0; i < names.size(); ++i) {
+            if (std::find(known.begin(), known.end(), names[i]) == known.end()) {
+                validator.fail("stage_graph", key, "unknown " + std::string(what) + " '" + names[i] + "'");
+            } else if (std::find(names.begin(), names.begin() + i, names[i]) != names.begin() + i) {
+                validator.fail("stage_graph", key, "'" + names[i] + "' is listed twice");
+            }
+        }
+    };
+    if (validator.read("stages", stageGraph.stages, "stage_graph")) {
+        checkNames("stages", stageGraph.stages, StageGraphSettings::stageNames(), "stage");
+    }
+    if (validator.read("outputs", stageGraph.outputs, "stage_graph")) {
+        checkNames("outputs", stageGraph.outputs, StageGraphSettings::slotNames(), "slot");
+    }
+}
+
+// threads: one map per role, e.g. capture: {cpus: [3], realtime_priority: 20}
+void readThreads(const YAML::Node& document, Validator& validator, ThreadSettings& threads) {
+    const YAML::Node section = document["threads"];
+    if (!section) return;
+    if (!section.IsMap()) {
+        validator.fail(nullptr, "threads", "expected a map of thread roles");
+        return;
+    }
+    const auto& roles = ThreadSettings::roleNames();
+    for (const auto& entry : section) {
+        const std::string role = entry.first.as<std::string>();
+        if (std::find(roles.begin(), roles.end(), role) == roles.end()) {
+            validator.fail("threads", role.c_str(), "unknown thread role");
+            continue;
+        }
+        if (!entry.second.IsMap()) {
+            validator.fail("threads", role.c_str(), "expected a map");
+            continue;
+        }
+        ThreadPolicy policy;
+        auto read = [&](const char* key, auto& value) {
+            const YAML::Node node = entry.second[key];
+            if (!node) return false;
+            try {
+                value = node.as<std::decay_t<decltype(value)>>();
+                return true;
+            } catch (const YAML::Exception&) {
+                validator.fail("threads", (role + "." + key).c_str(), "wrong type");
+                return false;
+            }
+        };
+        if (read("cpus", policy.cpus)) {
+            for (int cpu : policy.cpus) {
+                if (cpu < 0) validator.fail("threads", (role + ".cpus").c_str(), "CPU numbers must not be negative");
+            }
+        }
+        if (read("nice", policy.nice) && (policy.nice < -20 || policy.nice > 19)) {
+            validator.fail("threads", (role + ".nice").c_str(), "must be within [-20, 19]");
+        }
+        if (read("realtime_priority", policy.realtimePriority) &&
+            (policy.realtimePriority < 0 || policy.realtimePriority > 99)) {
+            validator.fail("threads", (role + ".realtime_priority").c_str(), "must be within [0, 99]");
+        }
+        read("cgroup", policy.cgroup);
+        threads.roles[role] = policy;
+    }
+}
+
+// flow_propagation: detect every k-th frame, follow the boxes with optical flow in between
+void readFlowPropagation(Validator& validator, FlowPropagationConfig& flow) {
+    validator.read("enabled", flow.enabled, "flow_propagation");
+    if (validator.read("detect_every_frames", flow.detectEveryFrames, "flow_propagation") &&
+        flow.detectEveryFrames < 1) {
+        validator.fail("flow_propagation", "detect_every_frames", "must be at least 1");
+    }
+    if (validator.read("max_features_per_box", flow.maxFeaturesPerBox, "flow_propagation") &&
+        flow.maxFeaturesPerBox < 1) {
+        validator.fail("flow_propagation", "max_features_per_box", "must be at least 1");
+    }
+    if (validator.read("window_size", flow.windowSize, "flow_propagation") &&
+        (flow.windowSize < 3 || flow.windowSize % 2 == 0)) {
+        validator.fail("flow_propagation", "window_size", "must be odd and at least 3");
+    }
+    if (validator.read("pyramid_levels", flow.pyramidLevels, "flow_propagation") &&
+        (flow.pyramidLevels < 0 || flow.pyramidLevels > 5)) {
+        validator.fail("flow_propagation", "pyramid_levels", "must be within [0, 5]");
+    }
+    if (validator.read("min_tracked_fraction", flow.minTrackedFraction, "flow_propagation") &&
+        (flow.minTrackedFraction < 0.0 || flow.minTrackedFraction > 1.0)) {
+        validator.fail("flow_propagation", "min_tracked_fraction", "must be within [0, 1]");
+    }
+    if (validator.read("max_forward_backward_error", flow.maxForwardBackwardError, "flow_propagation") &&
+        flow.maxForwardBackwardError <= 0.0) {
+        validator.fail("flow_propagation", "max_forward_backward_error", "must be positive");
+    }
+}
+
+// motion_history: per-region speed and direction for scheduling
+void readMotionHistory(Validator& validator, MotionHistoryConfig& history) {
+    validator.read("enabled", history.enabled, "motion_history");
+    if (validator.read("duration_frames", history.durationFrames, "motion_history") && history.durationFrames < 2) {
+        validator.fail("motion_history", "duration_frames", "must be at least 2");
+    }
+    if (validator.read("jitter_max_speed", history.jitterMaxSpeed, "motion_history") &&
+        history.jitterMaxSpeed < 0.0) {
+        validator.fail("motion_history", "jitter_max_speed", "must not be negative");
+    }
+    if (validator.read("jitter_min_age_frames", history.jitterMinAgeFrames, "motion_history") &&
+        history.jitterMinAgeFrames < 1) {
+        validator.fail("motion_history", "jitter_min_age_frames", "must be at least 1");
+    }
+    validator.read("skip_jitter_saves", history.skipJitterSaves, "motion_history");
+}
+
+// thread_budget: core split between the compute workers, persistence, classification and OpenCV
+void readThreadBudget(Validator& validator, ThreadBudgetSettings& budget) {
+    if (validator.read("cores", budget.cores, "thread_budget") && budget.cores < 0) {
+        validator.fail("thread_budget", "cores", "must not be negative (0 = every allowed CPU)");
+    }
+    if (validator.read("persistence_cores", budget.persistenceCores, "thread_budget") &&
+        budget.persistenceCores < 0) {
+        validator.fail("thread_budget", "persistence_cores", "must not be negative");
+    }
+    if (validator.read("classification_cores", budget.classificationCores, "thread_budget") &&
+        budget.classificationCores < 0) {
+        validator.fail("thread_budget", "classification_cores", "must not be negative");
+    }
+    if (validator.read("opencv_threads", budget.opencvThreads, "thread_budget") && budget.opencvThreads < -1) {
+        validator.fail("thread_budget", "opencv_threads", "must be -1 (derived), 0 (sequential) or a thread count");
+    }
+    validator.read("pin", budget.pin, "thread_budget");
+}
+
+// handoff: zero-downtime restart through a Unix socket (see HandoffListener)
+void readHandoff(Validator& validator, HandoffConfig& handoff) {
+    validator.read("enabled", handoff.enabled, "handoff");
+    if (validator.read("socket_path", handoff.socketPath, "handoff") && handoff.socketPath.empty()) {
+        validator.fail("handoff", "socket_path", "must not be empty");
+    }
+    auto readTimeout = [&](const char* key, std::chrono::milliseconds& timeout) {
+        int ms = 0;
+        if (!validator.read(key, ms, "handoff")) return;
+        if (ms < 0) {
+            validator.fail("handoff", key, "must not be negative");
+        } else {
+            timeout = std::chrono::milliseconds(ms);
+        }
+    };
+    readTimeout("state_timeout_ms", handoff.stateTimeout);
+    readTimeout("release_timeout_ms", handoff.releaseTimeout);
+}
+
+// load_shedding: quiet streams step down to every k-th frame when processing falls behind
+void readLoadShedding(Validator& validator, LoadSheddingConfig& shedding) {
+    validator.read("enabled", shedding.enabled, "load_shedding");
+    if (validator.read("overload_ratio", shedding.overloadRatio, "load_shedding") && shedding.overloadRatio <= 0.0) {
+        validator.fail("load_shedding", "overload_ratio", "must be positive");
+    }
+    if (validator.read("recover_ratio", shedding.recoverRatio, "load_shedding") && shedding.recoverRatio < 0.0) {
+        validator.fail("load_shedding", "recover_ratio", "must not be negative");
+    }
+    if (shedding.recoverRatio >= shedding.overloadRatio) {
+        validator.fail("load_shedding", "recover_ratio", "must be below overload_ratio");
+    }
+    if (validator.read("max_stride", shedding.maxStride, "load_shedding") && shedding.maxStride < 1) {
+        validator.fail("load_shedding", "max_stride", "must be at least 1");
+    }
+    if (validator.read("min_scale_factor", shedding.minScaleFactor, "load_shedding") &&
+        (shedding.minScaleFactor <= 0.0 || shedding.minScaleFactor > 1.0)) {
+        validator.fail("load_shedding", "min_scale_factor", "must be within (0, 1]");
+    }
+    if (validator.read("active_hold_frames", shedding.activeHoldFrames, "load_shedding") &&
+        shedding.activeHoldFrames < 0) {
+        validator.fail("load_shedding", "active_hold_frames", "must not be negative");
+    }
+}
+
+// adaptive_scale: detection_scale picked from the sizes of the birds a camera sees
+void readAdaptiveScale(Validator& validator, AdaptiveScaleConfig& scale) {
+    validator.read("enabled", scale.enabled, "adaptive_scale");
+    if (validator.read("percentile", scale.percentile, "adaptive_scale") &&
+        (scale.percentile <= 0.0 || scale.percentile >= 1.0)) {
+        validator.fail("adaptive_scale", "percentile", "must be within (0, 1)");
+    }
+    if (validator.read("min_object_pixels", scale.minObjectPixels, "adaptive_scale") &&
+        scale.minObjectPixels <= 0.0) {
+        validator.fail("adaptive_scale", "min_object_pixels", "must be positive");
+    }
+    const bool minScaleRead = validator.read("min_scale", scale.minScale, "adaptive_scale");
+    if (minScaleRead && (scale.minScale <= 0.0 || scale.minScale > 1.0)) {
+        validator.fail("adaptive_scale", "min_scale", "must be within (0, 1]");
+    }
+    const bool maxScaleRead = validator.read("max_scale", scale.maxScale, "adaptive_scale");
+    if (maxScaleRead && (scale.maxScale <= 0.0 || scale.maxScale > 1.0)) {
+        validator.fail("adaptive_scale", "max_scale", "must be within (0, 1]");
+    }
+    if ((minScaleRead || maxScaleRead) && scale.minScale > scale.maxScale) {
+        validator.fail("adaptive_scale", "min_scale", "must not exceed max_scale");
+    }
+    if (validator.read("scale_step", scale.scaleStep, "adaptive_scale") &&
+        (scale.scaleStep <= 0.0 || scale.scaleStep > 1.0)) {
+        validator.fail("adaptive_scale", "scale_step", "must be within (0, 1]");
+    }
+    if (validator.read("evaluate_interval_frames", scale.evaluateIntervalFrames, "adaptive_scale") &&
+        scale.evaluateIntervalFrames < 1) {
+        validator.fail("adaptive_scale", "evaluate_interval_frames", "must be at least 1");
+    }
+    if (validator.read("min_samples", scale.minSamples, "adaptive_scale") && scale.minSamples < 1) {
+        validator.fail("adaptive_scale", "min_samples", "must be at least 1");
+    }
+    if (validator.read("hysteresis", scale.hysteresis, "adaptive_scale") && scale.hysteresis < 0.0) {
+        validator.fail("adaptive_scale", "hysteresis", "must not be negative");
+    }
+}
+
+// wake_trigger: duty-cycled capture woken by a GPIO line or the block gate
+void readWakeTrigger(Validator& validator, WakeTriggerConfig& wake) {
+    validator.read("enabled", wake.enabled, "wake_trigger");
+    std::string source;
+    if (validator.read("source", source, "wake_trigger")) {
+        try {
+            wake.source = parseWakeSource(source);
+        } catch (const std::invalid_argument&) {
+            validator.fail("wake_trigger", "source", "unknown source '" + source + "'");
+        }
+    }
+    validator.read("gpio_path", wake.gpioPath, "wake_trigger");
+    validator.read("gpio_active_low", wake.gpioActiveLow, "wake_trigger");
+    if (validator.read("sleep_fps", wake.sleepFps, "wake_trigger") && wake.sleepFps <= 0.0) {
+        validator.fail("wake_trigger", "sleep_fps", "must be positive");
+    }
+    if (validator.read("awake_hold_s", wake.awakeHoldSeconds, "wake_trigger") && wake.awakeHoldSeconds < 0.0) {
+        validator.fail("wake_trigger", "awake_hold_s", "must not be negative");
+    }
+    int preRollFrames = 0;
+    if (validator.read("pre_roll_frames", preRollFrames, "wake_trigger")) {
+        if (preRollFrames < 0) {
+            validator.fail("wake_trigger", "pre_roll_frames", "must not be negative");
+        } else {
+            wake.preRollFrames = static_cast<size_t>(preRollFrames);
+        }
+    }
+    if (validator.read("gate_block_size", wake.gateBlockSize, "wake_trigger") && wake.gateBlockSize < 4) {
+        validator.fail("wake_trigger", "gate_block_size", "must be at least 4");
+    }
+    if (validator.read("gate_threshold", wake.gateThreshold, "wake_trigger") &&
+        (wake.gateThreshold < 0 || wake.gateThreshold > 255)) {
+        validator.fail("wake_trigger", "gate_threshold", "must be within [0, 255]");
+    }
+    if (validator.read("gate_min_blocks", wake.gateMinBlocks, "wake_trigger") && wake.gateMinBlocks < 1) {
+        validator.fail("wake_trigger", "gate_min_blocks", "must be at least 1");
+    }
+    if (validator.read("gate_history", wake.gateHistory, "wake_trigger") && wake.gateHistory < 1) {
+        validator.fail("wake_trigger", "gate_history", "must be at least 1");
+    }
+}
+
+void checkProcessorKeys(Validator& validator) {
+    validator.requireType<int>({"max_threshold", "clahe_tile_size", "bilateral_d", "background_history",
+                                "background_fg_threshold", "background_update_interval", "otsu_update_interval",
+                                "min_motion_threshold", "tile_bands", "motion_gate_pixel_delta",
+                                "motion_gate_min_pixels", "motion_gate_background_interval",
+                                "background_snapshot_max_age_s", "background_snapshot_interval_frames",
+                                "min_contour_area", "debug_artifact_sample_every", "refinement_padding",
+                                "occupancy_tile_size", "block_size", "block_threshold", "block_history",
+                                "block_min_blocks", "flood_thumbnail_width", "guided_subsample",
+                                "clahe_update_interval", "max_contours_per_frame", "roi_prediction_margin",
+                                "roi_prediction_full_scan_interval", "roi_prediction_trigger_samples"});
+    validator.requireType<double>({"clahe_clip_limit", "clahe_drift_limit", "clahe_lut_scale",
+                                   "bilateral_sigma_color", "bilateral_sigma_space",
+                                   "background_var_threshold", "background_knn_threshold",
+                                   "background_learning_rate", "background_update_scale", "otsu_drift_limit",
+                                   "detection_scale", "background_snapshot_max_diff", "contour_epsilon_factor",
+                                   "max_contour_aspect_ratio", "min_contour_solidity", "occupancy_max_fraction",
+                                   "flood_motion_fraction", "flood_min_shift", "flood_max_shift",
+                                   "flood_min_response", "hysteresis_low_ratio", "roi_prediction_max_fraction"});
+    validator.requireType<bool>({"contrast_enhancement", "background_subtraction", "background_detect_shadows",
+                                 "reuse_buffers", "motion_gate", "detection_refinement", "morphology",
+                                 "morph_close", "morph_open", "dilation", "erosion", "morph_approximate",
+                                 "packed_masks", "motion_mask_rle", "convex_hull", "contour_approximation",
+                                 "contour_filtering", "flood_guard", "flood_compensate_shift", "roi_prediction"});
+    // Kernel sizes OpenCV rejects at the first frame
+    for (const char* key : {"gaussian_blur_size", "median_blur_size"}) {
+        int size = 1;
+        if (validator.read(key, size) && (size < 1 || size % 2 == 0)) {
+            validator.fail(nullptr, key, "must be a positive odd number");
+        }
+    }
+    int morphKernelSize = 1;
+    if (validator.read("morph_kernel_size", morphKernelSize) && morphKernelSize < 1) {
+        validator.fail(nullptr, "morph_kernel_size", "must be positive");
+    }
+    double hysteresisLowRatio = 0.0;
+    if (validator.read("hysteresis_low_ratio", hysteresisLowRatio) &&
+        (hysteresisLowRatio < 0.0 || hysteresisLowRatio >= 1.0)) {
+        validator.fail(nullptr, "hysteresis_low_ratio", "must be within [0, 1)");
+    }
+}
+
+// Snapshots handed out by PipelineConfig::shared(), by path
+struct SharedSnapshot {
+    std::weak_ptr<const PipelineConfig> config;
+    std::filesystem::file_time_type modified;
+    std::uintmax_t size = 0;
+};
+
+std::mutex& sharedSnapshotsMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::unordered_map<std::string, SharedSnapshot>& sharedSnapshots() {
+    static std::unordered_map<std::string, SharedSnapshot> snapshots;
+    return snapshots;
+}
+
+}  // namespace
+
+std::shared_ptr<const PipelineConfig> PipelineConfig::load(const std::string& path) {
+    YAML::Node document;
+    try {
+        document = YAML::LoadFile(path);
+    } catch (const YAML::Exception& e) {
+        throw std::invalid_argument("Cannot load config " + path + ": " + e.what());
+    }
+    return fromNode(document, path, path);
+}
+
+std::shared_ptr<const PipelineConfig> PipelineConfig::fromYaml(const std::string& yaml, const std::string& source) {
+    YAML::Node document;
+    try {
+        document = YAML::Load(yaml);
+    } catch (const YAML::Exception& e) {
+        throw std::invalid_argument("Cannot parse config " + source + ": " + e.what());
+    }
+    return fromNode(document, "", source);
+}
+
+std::shared_ptr<const PipelineConfig> PipelineConfig::shared(const std::string& path) {
+    std::error_code error;
+    const auto modified = std::filesystem::last_write_time(path, error);
+    const auto size = error ? 0 : std::filesystem::file_size(path, error);
+    if (error) return load(path);  // Reports the missing file
+
+    std::lock_guard<std::mutex> lock(sharedSnapshotsMutex());
+    SharedSnapshot& entry = sharedSnapshots()[path];
+    if (auto config = entry.config.lock(); config && entry.modified == modified && entry.size == size) {
+        return config;
+    }
+    auto config = load(path);
+    entry = {config, modified, size};
+    return config;
+}
+
+std::shared_ptr<const PipelineConfig> PipelineConfig::loadOrDefaults(const std::string& path) {
+    try {
+        return shared(path);
+    } catch (const std::invalid_argument& e) {
+        LOG_ERROR("{}; using defaults", e.what());
+        return fromNode(YAML::Node(YAML::NodeType::Map), "", "<defaults>");
+    }
+}
+
+std::shared_ptr<const PipelineConfig> PipelineConfig::fromNode(const YAML::Node& document, const std::string& path,
+                                                               const std::string& source) {
+    // An empty file parses as a null document: same as no keys at all
+    const YAML::Node root = document.IsNull() ? YAML::Node(YAML::NodeType::Map) : document;
+    if (!root.IsMap()) {
+        throw std::invalid_argument("Invalid config " + source + ": top level must be a map of keys");
+    }
+
+    std::shared_ptr<PipelineConfig> config(new PipelineConfig());
+    config->path_ = path;
+    config->document_ = root;
+
+    Validator validator(root);
+    readLogging(validator, config->logging);
+    readConsolidation(validator, config->consolidation);
+    readTracker(validator, *config);
+    readFlowPropagation(validator, config->flowPropagation);
+    readMotionHistory(validator, config->motionHistory);
+    readStageGraph(validator, config->stageGraph);
+    readThreads(root, validator, config->threads);
+    readThreadBudget(validator, config->threadBudget);
+    readHandoff(validator, config->handoff);
+    readLoadShedding(validator, config->loadShedding);
+    readAdaptiveScale(validator, config->adaptiveScale);
+    readWakeTrigger(validator, config->wakeTrigger);
+    validator.read("headless", config->headless);
+    validator.read("save_only_consolidated_regions", config->saveOnlyConsolidatedRegions);
+    checkProcessorKeys(validator);
+
+    if (!validator.errors().empty()) {
+        std::string message = "Invalid config " + source + ":";
+        for (const auto& error : validator.errors()) message += "\n  " + error;
+        throw std::invalid_argument(message);
+    }
+    return config;
+}
+
+const std::vector<std::string>& StageGraphSettings::stageNames() {
+    static const std::vector<std::string> names = {"detect", "track", "number", "consolidate", "crops", "visualize"};
+    return names;
+}
+
+const std::vector<std::string>& StageGraphSettings::slotNames() {
+    static const std::vector<std::string> names = {"frame", "mask", "boxes", "objects", "regions", "crops"};
+    return names;
+}
+
+std::shared_ptr<const PipelineConfig> PipelineConfig::withOverrides(const YAML::Node& overrides) const {
+    YAML::Node merged = YAML::Clone(document_);
+    if (overrides && overrides.IsMap()) {
+        for (const auto& item : overrides) {
+            const std::string key = item.first.as<std::string>();
+            const YAML::Node existing = merged[key];
+            if (item.second.IsMap() && existing && existing.IsMap()) {
+                for (const auto& inner : item.second) {
+                    merged[key][inner.first.as<std::string>()] = YAML::Clone(inner.second);
+                }
+            } else {
+                merged[key] = YAML::Clone(item.second);
+            }
+        }
+    }
+    return fromNode(merged, path_, (path_.empty() ? std::string("<string>") : path_) + " (with overrides)");
+}
+
+SharedPipelineConfig::SharedPipelineConfig(std::shared_ptr<const PipelineConfig> initial)
+    : current_(initial), base_(std::move(initial)) {
+    if (!current_) throw std::invalid_argument("SharedPipelineConfig: no initial config");
+}
+
+std::shared_ptr<const PipelineConfig> SharedPipelineConfig::base() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return base_;
+}
+
+void SharedPipelineConfig::publish(std::shared_ptr<const PipelineConfig> config) {
+    if (!config) throw std::invalid_argument("SharedPipelineConfig: publish() without a config");
+    std::lock_guard<std::mutex> lock(mutex_);
+    publishLocked(std::move(config));
+}
+
+bool SharedPipelineConfig::reload() {
+    const std::string path = base()->path();
+    if (path.empty()) return false;
+    try {
+        publish(PipelineConfig::load(path));
+    } catch (const std::invalid_argument& e) {
+        LOG_ERROR("Config reload rejected, keeping the running config: {}", e.what());
+        return false;
+    }
+    LOG_INFO("Config reloaded from {} (version {})", path, version());
+    return true;
+}
+
+bool SharedPipelineConfig::setOverrides(const YAML::Node& overrides) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const YAML::Node previous = overrides_;
+    overrides_ = overrides ? YAML::Clone(overrides) : YAML::Node();
+    try {
+        publishLocked(base_);
+    } catch (const std::invalid_argument& e) {
+        LOG_ERROR("Config overrides rejected, keeping the running config: {}", e.what());
+        overrides_ = previous;
+        return false;
+    }
+    return true;
+}
+
+void SharedPipelineConfig::publishLocked(std::shared_ptr<const PipelineConfig> base) {
+    // Throws before anything is swapped when the overrides do not validate against @p base
+    std::shared_ptr<const PipelineConfig> effective = base;
+    if (overrides_ && overrides_.IsMap() && overrides_.size() > 0) {
+        effective = base->withOverrides(overrides_);
+    }
+    base_ = std::move(base);
+    std::atomic_store(&current_, std::move(effective));
+    version_.fetch_add(1, std::memory_order_acq_rel);
+}
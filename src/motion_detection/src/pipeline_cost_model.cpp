@@ -0,0 +1,282 @@
+#include "pipeline_cost_model.hpp"
+
+#include <yaml-cpp/yaml.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+#include <opencv2/imgproc.hpp>
+
+#include "image_encoder.hpp"
+#include "logger.hpp"
+#include "motion_pipeline.hpp"
+#include "motion_processor.hpp"
+#include "motion_region_consolidator.hpp"
+#include "tracked_object_store.hpp"
+
+namespace {
+
+constexpr int kSequenceLength = 6;  // Frames of the moving sequence before the blobs start over
+constexpr int kFileVersion = 1;
+
+double megapixels(const cv::Size& size) { return static_cast<double>(size.area()) * 1e-6; }
+
+// The bench's frames: a fixed noise texture with blobs that advance one unit per frame
+cv::Mat syntheticFrame(const cv::Mat& texture, int frame) {
+    cv::Mat image = texture.clone();
+    const int unit = std::max(1, texture.cols / 64);
+    for (int i = 0; i < 12; ++i) {
+        const cv::Point center((i * 5 + 3) * unit + (frame % kSequenceLength) * unit,
+                               ((i * 7) % 30 + 3) * texture.rows / 36);
+        cv::ellipse(image, center, cv::Size(unit, unit * 2 / 3), 15.0 * i, 0, 360, cv::Scalar(200, 210, 220),
+                    cv::FILLED);
+    }
+    return image;
+}
+
+cv::Mat noiseTexture(const cv::Size& size) {
+    cv::Mat texture(size, CV_8UC3);
+    cv::RNG rng(12345);
+    rng.fill(texture, cv::RNG::UNIFORM, cv::Scalar::all(40), cv::Scalar::all(90));
+    cv::GaussianBlur(texture, texture, cv::Size(7, 7), 0);
+    return texture;
+}
+
+// Flocks of ~8 overlapping boxes on a 1080p frame, like BM_DbscanClustering's clustered case
+std::vector<cv::Rect> flockBoxes(size_t count) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> sizeDist(20, 80);
+    std::uniform_int_distribution<int> centerX(100, 1820);
+    std::uniform_int_distribution<int> centerY(100, 980);
+    std::normal_distribution<double> spread(0.0, 40.0);
+    std::vector<cv::Rect> boxes;
+    cv::Point center;
+    for (size_t i = 0; i < count; ++i) {
+        if (i % 8 == 0) center = cv::Point(centerX(rng), centerY(rng));
+        boxes.emplace_back(center.x + static_cast<int>(spread(rng)), center.y + static_cast<int>(spread(rng)),
+                           sizeDist(rng), sizeDist(rng));
+    }
+    return boxes;
+}
+
+// Mean milliseconds of @p run over @p frames calls, after as many untimed ones
+template <typename Run>
+double timeMs(int frames, Run run) {
+    for (int i = 0; i < frames; ++i) run(i);
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; ++i) run(frames + i);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return frames > 0 ? ms / frames : 0.0;
+}
+
+std::unique_ptr<MotionProcessor> makeProcessor(const std::shared_ptr<const PipelineConfig>& config) {
+    auto processor = std::make_unique<MotionProcessor>(config);
+    processor->enableVisualization(false);
+    processor->setVisualizationPath("");
+    processor->setRetainedStages(MotionProcessor::STAGE_NONE);
+    return processor;
+}
+
+}  // namespace
+
+const char* costStageName(CostStage stage) {
+    static constexpr const char* kNames[] = {"preprocess",  "detect",       "morphology",    "extraction",
+                                             "quiet_frame", "active_frame", "consolidation", "encode"};
+    static_assert(sizeof(kNames) / sizeof(kNames[0]) == static_cast<size_t>(CostStage::Count),
+                  "one name per stage");
+    return kNames[static_cast<size_t>(stage)];
+}
+
+double StageCostFit::at(double units) const { return std::max(0.0, fixedMs + perUnitMs * units); }
+
+StageCostFit StageCostFit::fit(const std::vector<double>& units, const std::vector<double>& ms) {
+    StageCostFit result;
+    const size_t n = std::min(units.size(), ms.size());
+    if (n == 0) return result;
+    double meanUnits = 0.0;
+    double meanMs = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        meanUnits += units[i] / static_cast<double>(n);
+        meanMs += ms[i] / static_cast<double>(n);
+    }
+    double covariance = 0.0;
+    double variance = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        covariance += (units[i] - meanUnits) * (ms[i] - meanMs);
+        variance += (units[i] - meanUnits) * (units[i] - meanUnits);
+    }
+    if (variance <= 0.0) {
+        // One size only: proportional to it
+        result.perUnitMs = meanUnits > 0.0 ? meanMs / meanUnits : 0.0;
+        return result;
+    }
+    result.perUnitMs = std::max(0.0, covariance / variance);
+    result.fixedMs = meanMs - result.perUnitMs * meanUnits;
+    if (result.fixedMs < 0.0) {
+        // Noise on a small host: a negative intercept would make small streams free
+        result.fixedMs = 0.0;
+        double weighted = 0.0;
+        double squares = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            weighted += units[i] * ms[i];
+            squares += units[i] * units[i];
+        }
+        result.perUnitMs = squares > 0.0 ? weighted / squares : 0.0;
+    }
+    return result;
+}
+
+PipelineCostModel PipelineCostModel::calibrate(const std::shared_ptr<const PipelineConfig>& config,
+                                               const CalibrationSettings& settings) {
+    // No warm start from a snapshot and no debug output: only the processing is timed
+    YAML::Node document = YAML::Clone(config->document());
+    document["background_snapshot_dir"] = "";
+    document["logging"]["log_to_file"] = false;
+    const auto calibrationConfig = PipelineConfig::fromYaml(YAML::Dump(document), "calibration");
+
+    // One worker's cost: OpenCV's own pool would spread a stage over the whole host
+    const int openCvThreads = cv::getNumThreads();
+    cv::setNumThreads(1);
+
+    PipelineCostModel model;
+    const size_t stageCount = static_cast<size_t>(CostStage::Count);
+    std::vector<std::vector<double>> units(stageCount);
+    std::vector<std::vector<double>> ms(stageCount);
+    const auto addPoint = [&units, &ms](CostStage stage, double x, double y) {
+        units[static_cast<size_t>(stage)].push_back(x);
+        ms[static_cast<size_t>(stage)].push_back(y);
+    };
+
+    for (const cv::Size& size : settings.resolutions) {
+        const double mp = megapixels(size);
+        const cv::Mat texture = noiseTexture(size);
+        std::vector<cv::Mat> sequence;
+        for (int f = 0; f < kSequenceLength; ++f) sequence.push_back(syntheticFrame(texture, f));
+
+        // Step kernels on a moving pair
+        auto steps = makeProcessor(calibrationConfig);
+        if (steps->getComputeBackend() == MotionProcessor::ComputeBackend::OPENCL) model.deviceStages_ = true;
+        addPoint(CostStage::Preprocess, mp, timeMs(settings.frames, [&](int) { steps->preprocessFrame(sequence[0]); }));
+        steps->setPrevFrame(steps->preprocessFrame(sequence[0]));
+        steps->setFirstFrame(false);
+        const cv::Mat current = steps->preprocessFrame(sequence[1]);
+        cv::Mat frameDiff;
+        cv::Mat thresh;
+        addPoint(CostStage::Detect, mp,
+                 timeMs(settings.frames, [&](int) { steps->detectMotion(current, frameDiff, thresh); }));
+        const cv::Mat mask = steps->detectMotion(current, frameDiff, thresh).clone();
+        addPoint(CostStage::Morphology, mp, timeMs(settings.frames, [&](int) { steps->applyMorphologicalOps(mask); }));
+        const cv::Mat morphological = steps->applyMorphologicalOps(mask);
+        addPoint(CostStage::Extraction, mp,
+                 timeMs(settings.frames, [&](int) { steps->extractContours(morphological); }));
+
+        // Whole frames with the config's own settings
+        auto quiet = makeProcessor(calibrationConfig);
+        addPoint(CostStage::QuietFrame, mp, timeMs(settings.frames, [&](int) { quiet->processFrame(sequence[0]); }));
+        auto active = makeProcessor(calibrationConfig);
+        addPoint(CostStage::ActiveFrame, mp, timeMs(settings.frames, [&](int f) {
+                     active->processFrame(sequence[f % kSequenceLength]);
+                 }));
+
+        ImageEncodeSettings encoding;
+        encoding.quality = 90;
+        std::vector<unsigned char> bytes;
+        addPoint(CostStage::Encode, mp,
+                 timeMs(settings.frames, [&](int) { ImageEncoder::encode(sequence[0], encoding, bytes); }));
+        LOG_INFO("Cost model: calibrated {}x{}", size.width, size.height);
+    }
+
+    ConsolidationConfig consolidation = calibrationConfig->consolidation;
+    consolidation.frameSize = cv::Size(1920, 1080);
+    MotionRegionConsolidator consolidator(consolidation);
+    for (size_t count : settings.boxCounts) {
+        TrackedObjectStore objects;
+        makeTrackedObjects(flockBoxes(count), objects);
+        addPoint(CostStage::Consolidation, static_cast<double>(count),
+                 timeMs(settings.frames, [&](int) { consolidator.consolidateRegions(objects); }));
+    }
+    cv::setNumThreads(openCvThreads);
+
+    for (size_t i = 0; i < stageCount; ++i) model.stages_[i] = StageCostFit::fit(units[i], ms[i]);
+    return model;
+}
+
+StreamCostEstimate PipelineCostModel::estimate(const StreamWorkload& workload) const {
+    const double mp = megapixels(workload.resolution);
+    const double activity = std::clamp(workload.activity, 0.0, 1.0);
+    const double consolidation = workload.boxesPerActiveFrame > 0.0
+                                     ? stage(CostStage::Consolidation).at(workload.boxesPerActiveFrame)
+                                     : 0.0;
+
+    StreamCostEstimate estimate;
+    const double detectionMs =
+        (1.0 - activity) * stage(CostStage::QuietFrame).at(mp) + activity * stage(CostStage::ActiveFrame).at(mp);
+    if (deviceStages_) {
+        // The steps' device share of detection; extraction and clustering stay on the host
+        const double device = stage(CostStage::Preprocess).at(mp) + stage(CostStage::Detect).at(mp) +
+                              stage(CostStage::Morphology).at(mp);
+        const double steps = device + stage(CostStage::Extraction).at(mp);
+        estimate.gpuMsPerFrame = steps > 0.0 ? detectionMs * device / steps : 0.0;
+    }
+    estimate.cpuMsPerFrame = detectionMs - estimate.gpuMsPerFrame + activity * consolidation;
+    estimate.encodeMsPerSecond = std::max(0.0, workload.savedFramesPerSecond) * stage(CostStage::Encode).at(mp);
+    const double fps = std::max(0.0, workload.fps);
+    estimate.cpuCores = (fps * estimate.cpuMsPerFrame + estimate.encodeMsPerSecond) / 1000.0;
+    estimate.gpuShare = fps * estimate.gpuMsPerFrame / 1000.0;
+    return estimate;
+}
+
+size_t PipelineCostModel::maxStreamsPerNode(const StreamWorkload& workload, size_t workers, double targetUtilization,
+                                            size_t devices) const {
+    const StreamCostEstimate cost = estimate(workload);
+    const double budget = static_cast<double>(workers) * targetUtilization;
+    if (cost.cpuCores <= 0.0) return 0;  // Not calibrated
+    size_t streams = static_cast<size_t>(std::floor(budget / cost.cpuCores + 1e-9));
+    if (deviceStages_ && cost.gpuShare > 0.0) {
+        const double deviceBudget = static_cast<double>(devices) * targetUtilization;
+        streams = std::min(streams, static_cast<size_t>(std::floor(deviceBudget / cost.gpuShare + 1e-9)));
+    }
+    return streams;
+}
+
+PipelineCostModel PipelineCostModel::load(const std::string& path) {
+    YAML::Node root;
+    try {
+        root = YAML::LoadFile(path);
+    } catch (const YAML::Exception& e) {
+        throw std::runtime_error("Cannot read cost model " + path + ": " + e.what());
+    }
+    if (!root["cost_model_version"] || root["cost_model_version"].as<int>() != kFileVersion || !root["stages"]) {
+        throw std::runtime_error(path + " is not a cost model calibration");
+    }
+    PipelineCostModel model;
+    model.deviceStages_ = root["device_stages"].as<bool>(false);
+    for (size_t i = 0; i < static_cast<size_t>(CostStage::Count); ++i) {
+        const YAML::Node node = root["stages"][costStageName(static_cast<CostStage>(i))];
+        if (!node) throw std::runtime_error(path + " has no stage " + costStageName(static_cast<CostStage>(i)));
+        model.stages_[i].fixedMs = node["fixed_ms"].as<double>(0.0);
+        model.stages_[i].perUnitMs = node["per_unit_ms"].as<double>(0.0);
+    }
+    return model;
+}
+
+void PipelineCostModel::save(const std::string& path) const {
+    YAML::Emitter emitter;
+    emitter << YAML::BeginMap;
+    emitter << YAML::Key << "cost_model_version" << YAML::Value << kFileVersion;
+    emitter << YAML::Key << "device_stages" << YAML::Value << deviceStages_;
+    emitter << YAML::Key << "stages" << YAML::Value << YAML::BeginMap;
+    for (size_t i = 0; i < static_cast<size_t>(CostStage::Count); ++i) {
+        emitter << YAML::Key << costStageName(static_cast<CostStage>(i)) << YAML::Value << YAML::Flow
+                << YAML::BeginMap << YAML::Key << "fixed_ms" << YAML::Value << stages_[i].fixedMs << YAML::Key
+                << "per_unit_ms" << YAML::Value << stages_[i].perUnitMs << YAML::EndMap;
+    }
+    emitter << YAML::EndMap << YAML::EndMap;
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) throw std::runtime_error("Cannot write " + path);
+    out << emitter.c_str() << '\n';
+}
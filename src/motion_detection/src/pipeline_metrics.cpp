@@ -0,0 +1,127 @@
+#include "pipeline_metrics.hpp"
+
+#include <fstream>
+#include <string>
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#endif
+
+namespace {
+
+void addRelaxed(std::atomic<uint64_t>& counter, int value) {
+    if (value > 0) counter.fetch_add(static_cast<uint64_t>(value), std::memory_order_relaxed);
+}
+
+}  // namespace
+
+void PipelineMetrics::recordFrame(const MotionProcessor::ProcessingResult& result, size_t regionCount) {
+    frames_.fetch_add(1, std::memory_order_relaxed);
+    if (result.hasMotion) motionFrames_.fetch_add(1, std::memory_order_relaxed);
+    regionsTotal_.fetch_add(regionCount, std::memory_order_relaxed);
+
+    size_t bucket = 0;
+    while (bucket < kRegionBuckets.size() && regionCount > kRegionBuckets[bucket]) ++bucket;
+    regionBuckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+
+    const MotionProcessor::ExtractionStats& extraction = result.extraction;
+    addRelaxed(candidates_, extraction.candidates);
+    addRelaxed(rejectedArea_, extraction.rejectedArea);
+    addRelaxed(rejectedSolidity_, extraction.rejectedSolidity);
+    addRelaxed(rejectedAspectRatio_, extraction.rejectedAspectRatio);
+    addRelaxed(accepted_, extraction.accepted);
+    addRelaxed(solidityChecks_, extraction.solidityChecks);
+    addRelaxed(droppedOverCap_, extraction.droppedOverCap);
+    if (extraction.droppedOverCap > 0) cappedFrames_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PipelineMetrics::recordLatency(const FrameTrace& trace) {
+    for (size_t i = 0; i < FrameTrace::kStageCount; ++i) {
+        const auto stage = static_cast<TraceStage>(i);
+        if (!trace.reached(stage)) return;  // Filtered out by an earlier stage
+        stageWait_[i].record(trace.waitMs(stage));
+        stageRun_[i].record(trace.runMs(stage));
+    }
+    endToEnd_.record(trace.sinceCaptureMs(trace.delivered));
+}
+
+void PipelineMetrics::write(PrometheusTextWriter& writer) const {
+    const uint64_t frames = framesProcessed();
+    writer.counter("birds_frames_processed_total", "Frames that completed detection and consolidation",
+                   frames);
+    writer.counter("birds_motion_frames_total", "Processed frames with at least one motion box",
+                   motionFrames());
+
+    // Bucket counts are read one by one, so a scrape racing a frame may see it in _count only
+    writer.header("birds_regions_per_frame", "histogram", "Consolidated regions per processed frame");
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < kRegionBuckets.size(); ++i) {
+        cumulative += regionBuckets_[i].load(std::memory_order_relaxed);
+        writer.sample("birds_regions_per_frame_bucket", static_cast<double>(cumulative),
+                      {{"le", std::to_string(kRegionBuckets[i])}});
+    }
+    cumulative += regionBuckets_.back().load(std::memory_order_relaxed);
+    writer.sample("birds_regions_per_frame_bucket", static_cast<double>(cumulative), {{"le", "+Inf"}});
+    writer.sample("birds_regions_per_frame_sum",
+                  static_cast<double>(regionsTotal_.load(std::memory_order_relaxed)));
+    writer.sample("birds_regions_per_frame_count", static_cast<double>(cumulative));
+
+    writer.counter("birds_contour_candidates_total", "Contours or components found in motion masks",
+                   candidates_.load(std::memory_order_relaxed));
+    writer.header("birds_contours_rejected_total", "counter",
+                  "Candidates dropped by the contour filters, by filter");
+    writer.sample("birds_contours_rejected_total",
+                  static_cast<double>(rejectedArea_.load(std::memory_order_relaxed)), {{"filter", "area"}});
+    writer.sample("birds_contours_rejected_total",
+                  static_cast<double>(rejectedSolidity_.load(std::memory_order_relaxed)),
+                  {{"filter", "solidity"}});
+    writer.sample("birds_contours_rejected_total",
+                  static_cast<double>(rejectedAspectRatio_.load(std::memory_order_relaxed)),
+                  {{"filter", "aspect_ratio"}});
+    writer.sample("birds_contours_rejected_total",
+                  static_cast<double>(droppedOverCap_.load(std::memory_order_relaxed)), {{"filter", "cap"}});
+    writer.counter("birds_contours_accepted_total", "Candidates reported as motion boxes",
+                   accepted_.load(std::memory_order_relaxed));
+    writer.counter("birds_contour_solidity_checks_total",
+                   "Candidates whose convex hull was built for the solidity filter",
+                   solidityChecks_.load(std::memory_order_relaxed));
+    writer.counter("birds_contour_cap_frames_total",
+                   "Masks with more candidates than max_contours_per_frame (the smallest were skipped)",
+                   cappedFrames_.load(std::memory_order_relaxed));
+
+    writer.header("birds_frame_latency_seconds", "histogram",
+                  "Time from capture to the pipeline output, per frame");
+    writer.histogramSamples("birds_frame_latency_seconds", endToEnd_);
+    writer.header("birds_frame_stage_seconds", "histogram",
+                  "Per-frame time queued in front of and running in each pipeline stage");
+    for (size_t i = 0; i < FrameTrace::kStageCount; ++i) {
+        const char* stage = traceStageName(static_cast<TraceStage>(i));
+        writer.histogramSamples("birds_frame_stage_seconds", stageWait_[i],
+                                {{"stage", stage}, {"phase", "queued"}});
+        writer.histogramSamples("birds_frame_stage_seconds", stageRun_[i],
+                                {{"stage", stage}, {"phase", "running"}});
+    }
+}
+
+uint64_t PipelineMetrics::residentMemoryBytes() {
+#if defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) !=
+        KERN_SUCCESS) {
+        return 0;
+    }
+    return info.resident_size;
+#elif defined(__linux__)
+    // Second field of /proc/self/statm: resident pages
+    std::ifstream statm("/proc/self/statm");
+    uint64_t sizePages = 0;
+    uint64_t residentPages = 0;
+    if (!(statm >> sizePages >> residentPages)) return 0;
+    return residentPages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,104 @@
+#include "pipelined_frame_executor.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+#include "logger.hpp"
+#include "motion_pipeline.hpp"
+
+namespace {
+
+constexpr auto kResultPollInterval = std::chrono::milliseconds(100);
+
+}  // namespace
+
+PipelinedFrameExecutor::PipelinedFrameExecutor(MotionProcessor& processor, MotionRegionConsolidator& consolidator,
+                                               ObjectTracker* tracker, size_t depth)
+    : processor_(processor),
+      consolidator_(consolidator),
+      tracker_(tracker),
+      depth_(std::max<size_t>(1, depth)),
+      // Block on every queue: at most depth frames exist, so nothing waits for long and
+      // nothing is ever dropped
+      pipeline_(depth_, BackpressurePolicy::Block) {
+    pipeline_.addStage("detect", [this](Result& packet) {
+        detect(packet);
+        return true;
+    });
+    pipeline_.addStage("consolidate", [this](Result& packet) {
+        consolidate(packet);
+        return true;
+    });
+    pipeline_.start();
+}
+
+PipelinedFrameExecutor::~PipelinedFrameExecutor() { pipeline_.stop(); }
+
+void PipelinedFrameExecutor::detect(Result& packet) {
+    const auto started = std::chrono::steady_clock::now();
+    try {
+        packet.result = processor_.processFrame(packet.frame);
+    } catch (const std::exception& e) {
+        packet.error = std::string("detect: ") + e.what();
+    }
+    packet.detectTime = std::chrono::steady_clock::now() - started;
+}
+
+void PipelinedFrameExecutor::consolidate(Result& packet) {
+    const auto started = std::chrono::steady_clock::now();
+    auto tracked = started;
+    try {
+        // Runs on every frame, a failed detection included: the tracker ages its tracks and
+        // the consolidator its regions exactly as a synchronous loop would
+        consolidator_.setFrameSize(packet.frame.size());
+        if (tracker_) {
+            tracker_->update(packet.result.detectedBounds, trackedObjects_);
+        } else {
+            makeTrackedObjects(packet.result.detectedBounds, trackedObjects_);
+        }
+        tracked = std::chrono::steady_clock::now();
+        if (trackedObjects_.empty()) {
+            packet.regions.clear();
+        } else {
+            consolidator_.consolidateRegionsInto(trackedObjects_, packet.regions, &arena_);
+        }
+    } catch (const std::exception& e) {
+        if (packet.error.empty()) packet.error = std::string("consolidate: ") + e.what();
+    }
+    arena_.reset();
+    const auto finished = std::chrono::steady_clock::now();
+    packet.trackTime = tracked - started;
+    packet.consolidateTime = finished - tracked;
+}
+
+std::optional<PipelinedFrameExecutor::Result> PipelinedFrameExecutor::push(cv::Mat frame) {
+    std::optional<Result> oldest;
+    if (inFlight_ >= depth_) oldest = popResult();
+
+    Result packet;
+    packet.sequence = nextSequence_++;
+    packet.frame = std::move(frame);
+    packet.submitted = std::chrono::steady_clock::now();
+    pipeline_.submit(std::move(packet));
+    ++inFlight_;
+    return oldest;
+}
+
+std::optional<PipelinedFrameExecutor::Result> PipelinedFrameExecutor::finish() {
+    if (inFlight_ == 0) return std::nullopt;
+    return popResult();
+}
+
+PipelinedFrameExecutor::Result PipelinedFrameExecutor::popResult() {
+    // Stages forward every packet and the queues never drop, so the oldest one always arrives
+    for (;;) {
+        if (auto result = pipeline_.popOutputFor(kResultPollInterval)) {
+            --inFlight_;
+            if (!result->error.empty()) {
+                LOG_ERROR("Pipelined frame {} failed: {}", result->sequence, result->error);
+            }
+            return std::move(*result);
+        }
+    }
+}
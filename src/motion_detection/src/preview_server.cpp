@@ -0,0 +1,306 @@
+#include "preview_server.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <opencv2/imgproc.hpp>
+#include <utility>
+
+#include "jpeg_encoder.hpp"
+#include "logger.hpp"
+#include "thread_placement.hpp"
+
+namespace {
+
+constexpr int kPollIntervalMs = 200;  // Upper bound on how long stop() waits
+constexpr int kRequestTimeoutSec = 2;  // Reading the request line
+constexpr int kSendTimeoutMs = 500;    // A viewer not taking a preview frame within this is dropped
+constexpr size_t kMaxRequestBytes = 8192;
+constexpr const char* kBoundary = "preview-frame";
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;  // A viewer hanging up must not SIGPIPE the process
+#else
+constexpr int kSendFlags = 0;  // macOS: SO_NOSIGPIPE is set per socket instead
+#endif
+
+bool sendAll(int fd, const char* data, size_t size) {
+    size_t sent = 0;
+    while (sent < size) {
+        const ssize_t n = ::send(fd, data + sent, size - sent, kSendFlags);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            return false;  // Timed out or closed by the viewer
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool sendAll(int fd, const std::string& data) { return sendAll(fd, data.data(), data.size()); }
+
+std::string httpResponse(const char* status, const char* contentType, const std::string& body) {
+    return std::string("HTTP/1.1 ") + status + "\r\nContent-Type: " + contentType +
+           "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" +
+           body;
+}
+
+const char* const kIndexPage =
+    "<!doctype html><html><head><title>Birds of Play preview</title></head>"
+    "<body style=\"margin:0;background:#111\"><img src=\"/stream\" style=\"width:100%\" "
+    "alt=\"Live preview\"></body></html>\n";
+
+std::string streamHeaders() {
+    return std::string("HTTP/1.1 200 OK\r\nContent-Type: multipart/x-mixed-replace; boundary=") + kBoundary +
+           "\r\nCache-Control: no-store\r\nConnection: close\r\n\r\n";
+}
+
+// A steady_clock time as the tick count an atomic can hold
+std::chrono::steady_clock::rep ticks(std::chrono::steady_clock::time_point time) {
+    return time.time_since_epoch().count();
+}
+
+}  // namespace
+
+PreviewServer::PreviewServer(PreviewConfig config)
+    : config_(std::move(config)),
+      frameInterval_(std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double>(config_.fps > 0.0 ? 1.0 / config_.fps : 0.0))) {}
+
+PreviewServer::~PreviewServer() { stop(); }
+
+bool PreviewServer::start() {
+    if (running_) return true;
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(config_.port));
+    if (::inet_pton(AF_INET, config_.bindAddress.c_str(), &address.sin_addr) != 1) {
+        LOG_ERROR("Preview server: invalid bind address '{}'", config_.bindAddress);
+        return false;
+    }
+
+    listenFd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd_ < 0) {
+        LOG_ERROR("Preview server: socket() failed: {}", std::strerror(errno));
+        return false;
+    }
+    const int reuse = 1;
+    ::setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (::bind(listenFd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(listenFd_, 8) < 0) {
+        LOG_ERROR("Preview server: cannot listen on {}:{}: {}", config_.bindAddress, config_.port,
+                  std::strerror(errno));
+        ::close(listenFd_);
+        listenFd_ = -1;
+        return false;
+    }
+
+    socklen_t length = sizeof(address);
+    ::getsockname(listenFd_, reinterpret_cast<sockaddr*>(&address), &length);
+    boundPort_ = ntohs(address.sin_port);
+
+    running_ = true;
+    acceptThread_ = std::thread(&PreviewServer::acceptLoop, this);
+    encodeThread_ = std::thread(&PreviewServer::encodeLoop, this);
+    LOG_INFO("Preview server streaming on http://{}:{}/ ({} px wide, up to {} fps)", config_.bindAddress,
+             boundPort_, config_.width, config_.fps);
+    return true;
+}
+
+void PreviewServer::stop() {
+    running_ = false;
+    frameReady_.notify_all();
+    if (acceptThread_.joinable()) acceptThread_.join();
+    if (encodeThread_.joinable()) encodeThread_.join();
+    closeViewers();
+    if (listenFd_ >= 0) {
+        ::close(listenFd_);
+        listenFd_ = -1;
+    }
+    std::lock_guard<std::mutex> lock(frameMutex_);
+    pendingFrame_.release();
+    pendingOverlay_ = nullptr;
+    hasPending_ = false;
+}
+
+bool PreviewServer::wantsFrame() const {
+    return viewerCount_.load(std::memory_order_relaxed) > 0 &&
+           ticks(Clock::now()) >= nextDue_.load(std::memory_order_relaxed);
+}
+
+void PreviewServer::offer(const cv::Mat& frame, Overlay overlay) {
+    if (frame.empty()) return;
+    nextDue_.store(ticks(Clock::now() + frameInterval_), std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(frameMutex_);
+        pendingFrame_ = frame;
+        pendingOverlay_ = std::move(overlay);
+        hasPending_ = true;
+    }
+    frameReady_.notify_one();
+}
+
+void PreviewServer::acceptLoop() {
+    nameCurrentThread("preview-accept");
+    pollfd listener{};
+    listener.fd = listenFd_;
+    listener.events = POLLIN;
+    while (running_) {
+        // Poll with a timeout instead of blocking in accept() so stop() is prompt
+        const int ready = ::poll(&listener, 1, kPollIntervalMs);
+        if (ready <= 0 || !(listener.revents & POLLIN)) continue;
+
+        const int clientFd = ::accept(listenFd_, nullptr, nullptr);
+        if (clientFd < 0) continue;
+        handleConnection(clientFd);
+    }
+}
+
+void PreviewServer::handleConnection(int clientFd) {
+    timeval timeout{};
+    timeout.tv_sec = kRequestTimeoutSec;
+    ::setsockopt(clientFd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    timeval sendTimeout{};
+    sendTimeout.tv_usec = kSendTimeoutMs * 1000;
+    ::setsockopt(clientFd, SOL_SOCKET, SO_SNDTIMEO, &sendTimeout, sizeof(sendTimeout));
+#ifdef SO_NOSIGPIPE
+    const int noSigpipe = 1;
+    ::setsockopt(clientFd, SOL_SOCKET, SO_NOSIGPIPE, &noSigpipe, sizeof(noSigpipe));
+#endif
+
+    // Only the request line matters; read until the end of the headers
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < kMaxRequestBytes) {
+        const ssize_t n = ::recv(clientFd, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            break;
+        }
+        request.append(buffer, static_cast<size_t>(n));
+    }
+
+    const std::string requestLine = request.substr(0, request.find("\r\n"));
+    const size_t methodEnd = requestLine.find(' ');
+    const size_t pathEnd = requestLine.find(' ', methodEnd + 1);
+    std::string path;
+    if (methodEnd != std::string::npos && pathEnd != std::string::npos) {
+        path = requestLine.substr(methodEnd + 1, pathEnd - methodEnd - 1);
+        path = path.substr(0, path.find('?'));
+    }
+
+    if (methodEnd == std::string::npos || pathEnd == std::string::npos) {
+        sendAll(clientFd, httpResponse("400 Bad Request", "text/plain", "Bad request\n"));
+    } else if (requestLine.compare(0, methodEnd, "GET") != 0) {
+        sendAll(clientFd, httpResponse("405 Method Not Allowed", "text/plain", "Only GET is supported\n"));
+    } else if (path == "/") {
+        sendAll(clientFd, httpResponse("200 OK", "text/html; charset=utf-8", kIndexPage));
+    } else if (path != "/stream") {
+        sendAll(clientFd, httpResponse("404 Not Found", "text/plain", "The preview is served at /stream\n"));
+    } else if (sendAll(clientFd, streamHeaders())) {
+        // The encoder thread takes it from here; the first frame is due right away
+        std::lock_guard<std::mutex> lock(viewersMutex_);
+        viewers_.push_back(clientFd);
+        viewerCount_.store(static_cast<int>(viewers_.size()));
+        nextDue_.store(0);
+        LOG_INFO("Preview viewer connected ({} watching)", viewers_.size());
+        return;
+    }
+    ::close(clientFd);
+}
+
+void PreviewServer::encodeLoop() {
+    nameCurrentThread("preview");
+    std::vector<unsigned char> jpeg;
+    while (running_) {
+        cv::Mat frame;
+        Overlay overlay;
+        {
+            std::unique_lock<std::mutex> lock(frameMutex_);
+            frameReady_.wait_for(lock, std::chrono::milliseconds(kPollIntervalMs),
+                                 [this] { return hasPending_ || !running_; });
+            if (!hasPending_ || !running_) continue;
+            frame = std::move(pendingFrame_);
+            overlay = std::move(pendingOverlay_);
+            pendingFrame_ = cv::Mat();
+            pendingOverlay_ = nullptr;
+            hasPending_ = false;
+        }
+        if (viewerCount_.load() == 0) continue;  // The last viewer left after the offer
+        if (!render(frame, overlay, jpeg)) continue;
+        frame.release();  // Back to the capture pool before the (possibly slow) sends
+        framesEncoded_++;
+        broadcast(jpeg);
+    }
+}
+
+bool PreviewServer::render(const cv::Mat& frame, const Overlay& overlay, std::vector<unsigned char>& jpeg) const {
+    const double scale = config_.width > 0 && frame.cols > config_.width
+                             ? static_cast<double>(config_.width) / frame.cols
+                             : 1.0;
+    // A fresh image for the overlay to draw on; the offered frame is shared with the pipeline
+    cv::Mat preview;
+    try {
+        cv::Mat scaled = frame;
+        if (scale < 1.0) {
+            const cv::Size size(config_.width, std::max(1, static_cast<int>(std::lround(frame.rows * scale))));
+            cv::resize(frame, scaled, size, 0, 0, cv::INTER_AREA);
+        }
+        if (scaled.channels() == 1) {
+            cv::cvtColor(scaled, preview, cv::COLOR_GRAY2BGR);
+        } else if (scaled.data == frame.data) {
+            preview = scaled.clone();
+        } else {
+            preview = scaled;
+        }
+        if (overlay) overlay(preview, scale);
+    } catch (const std::exception& e) {
+        LOG_WARN("Preview server: rendering failed: {}", e.what());
+        return false;
+    }
+    return JpegEncoder::encode(preview, config_.quality, jpeg);
+}
+
+void PreviewServer::broadcast(const std::vector<unsigned char>& jpeg) {
+    std::vector<int> viewers;
+    {
+        std::lock_guard<std::mutex> lock(viewersMutex_);
+        viewers = viewers_;
+    }
+    const std::string header = std::string("--") + kBoundary +
+                               "\r\nContent-Type: image/jpeg\r\nContent-Length: " + std::to_string(jpeg.size()) +
+                               "\r\n\r\n";
+    std::vector<int> gone;
+    for (int fd : viewers) {
+        const bool sent = sendAll(fd, header) &&
+                          sendAll(fd, reinterpret_cast<const char*>(jpeg.data()), jpeg.size()) &&
+                          sendAll(fd, "\r\n", 2);
+        if (!sent) gone.push_back(fd);
+    }
+    if (gone.empty()) return;
+
+    std::lock_guard<std::mutex> lock(viewersMutex_);
+    for (int fd : gone) {
+        viewers_.erase(std::remove(viewers_.begin(), viewers_.end(), fd), viewers_.end());
+        ::close(fd);
+    }
+    viewerCount_.store(static_cast<int>(viewers_.size()));
+    LOG_INFO("Preview viewer left ({} watching)", viewers_.size());
+}
+
+void PreviewServer::closeViewers() {
+    std::lock_guard<std::mutex> lock(viewersMutex_);
+    for (int fd : viewers_) ::close(fd);
+    viewers_.clear();
+    viewerCount_.store(0);
+}
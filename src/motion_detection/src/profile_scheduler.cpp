@@ -0,0 +1,268 @@
+#include "profile_scheduler.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr int kMinutesPerDay = 24 * 60;
+
+double radians(double degrees) { return degrees * kPi / 180.0; }
+
+double seconds(const YAML::Node& node, const char* key, double fallback) {
+    return node[key] ? node[key].as<double>() : fallback;
+}
+
+}  // namespace
+
+DayTime DayTime::parse(const std::string& text) {
+    std::string value;
+    for (char c : text) {
+        if (!std::isspace(static_cast<unsigned char>(c))) value += static_cast<char>(std::tolower(c));
+    }
+    DayTime time;
+    for (const auto& [name, anchor] : {std::make_pair("sunrise", Anchor::SUNRISE),
+                                       std::make_pair("sunset", Anchor::SUNSET)}) {
+        const std::string prefix(name);
+        if (value.compare(0, prefix.size(), prefix) != 0) continue;
+        time.anchor = anchor;
+        const std::string offset = value.substr(prefix.size());
+        if (offset.empty()) return time;
+        if ((offset[0] == '+' || offset[0] == '-') && offset.size() > 1 &&
+            std::all_of(offset.begin() + 1, offset.end(), [](char c) { return std::isdigit(c); })) {
+            time.minutes = std::stoi(offset);
+            return time;
+        }
+        throw std::invalid_argument("Invalid time of day '" + text + "': offset must be +N or -N minutes");
+    }
+    const size_t colon = value.find(':');
+    const auto digits = [](const std::string& part) {
+        return !part.empty() && part.size() <= 2 &&
+               std::all_of(part.begin(), part.end(), [](char c) { return std::isdigit(c); });
+    };
+    if (colon != std::string::npos && digits(value.substr(0, colon)) && digits(value.substr(colon + 1))) {
+        const int hours = std::stoi(value.substr(0, colon));
+        const int minutes = std::stoi(value.substr(colon + 1));
+        if (hours <= 24 && minutes < 60 && hours * 60 + minutes <= kMinutesPerDay) {
+            time.minutes = hours * 60 + minutes;
+            return time;
+        }
+    }
+    throw std::invalid_argument("Invalid time of day '" + text + "': expected HH:MM, sunrise[+-N] or sunset[+-N]");
+}
+
+ProfileScheduleConfig ProfileScheduleConfig::parse(const YAML::Node& section) {
+    ProfileScheduleConfig config;
+    if (!section) return config;
+    if (!section.IsMap()) throw std::invalid_argument("processing_profiles: expected a map");
+    try {
+        if (section["enabled"]) config.enabled = section["enabled"].as<bool>();
+        if (section["latitude"]) config.latitude = section["latitude"].as<double>();
+        if (section["longitude"]) config.longitude = section["longitude"].as<double>();
+        if (section["default_profile"]) config.defaultProfile = section["default_profile"].as<std::string>();
+        if (const YAML::Node activity = section["activity"]) {
+            if (activity["profile"]) config.activityProfile = activity["profile"].as<std::string>();
+            if (activity["min_frames"]) config.activityMinFrames = activity["min_frames"].as<int>();
+            config.activityWindowSeconds = seconds(activity, "window_s", config.activityWindowSeconds);
+            config.activityHoldSeconds = seconds(activity, "hold_s", config.activityHoldSeconds);
+        }
+        config.checkIntervalSeconds = seconds(section, "check_interval_s", config.checkIntervalSeconds);
+
+        if (const YAML::Node profiles = section["profiles"]) {
+            if (!profiles.IsMap()) throw std::invalid_argument("processing_profiles.profiles: expected a map");
+            for (const auto& item : profiles) {
+                ProcessingProfile profile;
+                profile.name = item.first.as<std::string>();
+                const YAML::Node body = item.second;
+                if (body && !body.IsNull()) {
+                    if (!body.IsMap()) {
+                        throw std::invalid_argument("processing_profiles.profiles." + profile.name +
+                                                    ": expected a map");
+                    }
+                    if (body["max_fps"]) profile.maxFps = body["max_fps"].as<double>();
+                    if (body["inference"]) profile.inference = body["inference"].as<bool>();
+                    if (const YAML::Node overrides = body["overrides"]) {
+                        if (!overrides.IsMap()) {
+                            throw std::invalid_argument("processing_profiles.profiles." + profile.name +
+                                                        ".overrides: expected a map of config keys");
+                        }
+                        profile.overrides = YAML::Clone(overrides);
+                    }
+                }
+                if (profile.maxFps < 0.0) {
+                    throw std::invalid_argument("processing_profiles.profiles." + profile.name +
+                                                ".max_fps: must be >= 0");
+                }
+                config.profiles.push_back(std::move(profile));
+            }
+        }
+
+        if (const YAML::Node schedule = section["schedule"]) {
+            if (!schedule.IsSequence()) throw std::invalid_argument("processing_profiles.schedule: expected a list");
+            for (const auto& item : schedule) {
+                if (!item["profile"] || !item["from"] || !item["to"]) {
+                    throw std::invalid_argument("processing_profiles.schedule: every entry needs profile, from and to");
+                }
+                ScheduleEntry entry;
+                entry.profile = item["profile"].as<std::string>();
+                entry.from = DayTime::parse(item["from"].as<std::string>());
+                entry.to = DayTime::parse(item["to"].as<std::string>());
+                config.schedule.push_back(std::move(entry));
+            }
+        }
+    } catch (const YAML::Exception& e) {
+        throw std::invalid_argument(std::string("processing_profiles: ") + e.what());
+    }
+
+    const auto known = [&config](const std::string& name, const std::string& where) {
+        if (!name.empty() && !config.find(name)) {
+            throw std::invalid_argument("processing_profiles." + where + ": unknown profile '" + name + "'");
+        }
+    };
+    known(config.defaultProfile, "default_profile");
+    known(config.activityProfile, "activity.profile");
+    for (const ScheduleEntry& entry : config.schedule) {
+        if (entry.profile.empty()) throw std::invalid_argument("processing_profiles.schedule: empty profile name");
+        known(entry.profile, "schedule");
+    }
+    if (config.activityMinFrames < 1) throw std::invalid_argument("processing_profiles.activity.min_frames: must be >= 1");
+    if (config.latitude < -90.0 || config.latitude > 90.0) {
+        throw std::invalid_argument("processing_profiles.latitude: must be within [-90, 90]");
+    }
+    return config;
+}
+
+const ProcessingProfile* ProfileScheduleConfig::find(const std::string& name) const {
+    if (name.empty()) return nullptr;
+    for (const ProcessingProfile& profile : profiles) {
+        if (profile.name == name) return &profile;
+    }
+    return nullptr;
+}
+
+double sunEventMinutes(int dayOfYear, double latitude, double longitude, bool sunrise, int utcOffsetMinutes) {
+    // Fractional year at local noon
+    const double gamma = 2.0 * kPi / 365.0 * (dayOfYear - 1);
+    const double equationOfTime =
+        229.18 * (0.000075 + 0.001868 * std::cos(gamma) - 0.032077 * std::sin(gamma) -
+                  0.014615 * std::cos(2 * gamma) - 0.040849 * std::sin(2 * gamma));
+    const double declination = 0.006918 - 0.399912 * std::cos(gamma) + 0.070257 * std::sin(gamma) -
+                               0.006758 * std::cos(2 * gamma) + 0.000907 * std::sin(2 * gamma) -
+                               0.002697 * std::cos(3 * gamma) + 0.00148 * std::sin(3 * gamma);
+    const double lat = radians(latitude);
+    // 90.833 degrees: refraction and the sun's radius
+    const double cosHourAngle = std::cos(radians(90.833)) / (std::cos(lat) * std::cos(declination)) -
+                                std::tan(lat) * std::tan(declination);
+    if (cosHourAngle < -1.0 || cosHourAngle > 1.0) return -1.0;
+    const double hourAngle = std::acos(cosHourAngle) * 180.0 / kPi;
+    const double utcMinutes = 720.0 - 4.0 * (longitude + (sunrise ? hourAngle : -hourAngle)) - equationOfTime;
+    return std::fmod(utcMinutes + utcOffsetMinutes + 2.0 * kMinutesPerDay, static_cast<double>(kMinutesPerDay));
+}
+
+ProfileScheduler::ProfileScheduler(ProfileScheduleConfig config)
+    : config_(std::move(config)),
+      activityProfile_(config_.find(config_.activityProfile)),
+      defaultProfile_(config_.find(config_.defaultProfile)) {}
+
+bool ProfileScheduler::update(std::time_t now, Clock::time_point steadyNow) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Activity is acted on at once; the clock-driven schedule only every check interval
+    const bool activityDue = activityProfile_ && current_ != activityProfile_ && activeLocked(steadyNow);
+    if (evaluated_ && steadyNow < nextCheck_ && !activityDue) return false;
+    evaluated_ = true;
+    nextCheck_ = steadyNow + std::chrono::duration_cast<Clock::duration>(
+                                 std::chrono::duration<double>(config_.checkIntervalSeconds));
+    const ProcessingProfile* next = nullptr;
+    if (activityProfile_ && activeLocked(steadyNow)) {
+        next = activityProfile_;
+    } else {
+        std::tm local{};
+        localtime_r(&now, &local);
+        next = defaultProfile_;
+        for (const ScheduleEntry& entry : config_.schedule) {
+            if (inWindow(entry, local)) {
+                next = config_.find(entry.profile);
+                break;
+            }
+        }
+    }
+    if (next == current_) return false;
+    current_ = next;
+    nextAdmit_ = Clock::time_point();
+    switches_++;
+    return true;
+}
+
+const ProcessingProfile* ProfileScheduler::current() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return current_;
+}
+
+std::string ProfileScheduler::currentName() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return current_ ? current_->name : std::string();
+}
+
+const ProcessingProfile* ProfileScheduler::select(std::time_t now, Clock::time_point steadyNow) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (activityProfile_ && activeLocked(steadyNow)) return activityProfile_;
+    std::tm local{};
+    localtime_r(&now, &local);
+    for (const ScheduleEntry& entry : config_.schedule) {
+        if (inWindow(entry, local)) return config_.find(entry.profile);
+    }
+    return defaultProfile_;
+}
+
+void ProfileScheduler::recordActivity(bool active, Clock::time_point now) {
+    if (!active || !activityProfile_) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto window = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(config_.activityWindowSeconds));
+    while (!activeFrames_.empty() && activeFrames_.front() < now - window) activeFrames_.pop_front();
+    activeFrames_.push_back(now);
+    if (activeFrames_.size() >= static_cast<size_t>(config_.activityMinFrames)) {
+        activeUntil_ = now + std::chrono::duration_cast<Clock::duration>(
+                                 std::chrono::duration<double>(config_.activityHoldSeconds));
+    }
+}
+
+bool ProfileScheduler::admit(Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!current_ || current_->maxFps <= 0.0) return true;
+    if (now < nextAdmit_) return false;
+    const auto interval =
+        std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / current_->maxFps));
+    // From the slot, not from now, so the rate holds with jittery capture; a long gap restarts it
+    nextAdmit_ = (nextAdmit_ == Clock::time_point() || now - nextAdmit_ > interval) ? now + interval
+                                                                                    : nextAdmit_ + interval;
+    return true;
+}
+
+uint64_t ProfileScheduler::switches() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return switches_;
+}
+
+bool ProfileScheduler::inWindow(const ScheduleEntry& entry, const std::tm& local) const {
+    const double from = resolve(entry.from, local);
+    const double to = resolve(entry.to, local);
+    if (from < 0.0 || to < 0.0) return false;  // No sunrise or sunset today
+    const double minute = local.tm_hour * 60 + local.tm_min + local.tm_sec / 60.0;
+    return from <= to ? (minute >= from && minute < to) : (minute >= from || minute < to);
+}
+
+double ProfileScheduler::resolve(const DayTime& time, const std::tm& local) const {
+    if (time.anchor == DayTime::Anchor::CLOCK) return time.minutes;
+    const int utcOffsetMinutes = static_cast<int>(local.tm_gmtoff / 60);
+    const double event = sunEventMinutes(local.tm_yday + 1, config_.latitude, config_.longitude,
+                                         time.anchor == DayTime::Anchor::SUNRISE, utcOffsetMinutes);
+    if (event < 0.0) return -1.0;
+    return std::fmod(event + time.minutes + kMinutesPerDay, static_cast<double>(kMinutesPerDay));
+}
+
+bool ProfileScheduler::activeLocked(Clock::time_point now) const { return now < activeUntil_; }
@@ -2,99 +2,805 @@
 #include <pybind11/stl.h>
 #include <pybind11/numpy.h>
 #include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include "capture_source.hpp"
+#include "dlpack_export.hpp"  // MatTensor (torch.from_dlpack)
+#include "frame_event_stream.hpp"
+#include "jpeg_region_decoder.hpp"
 #include "motion_processor.hpp"
 #include "motion_visualization.hpp"
 #include "motion_region_consolidator.hpp"
 #include "motion_pipeline.hpp"
+#include "offline_batch.hpp"  // consolidateBoxBatch
 #include "logger.hpp"
+#include "numpy_conversion.hpp"  // numpy_to_cv_mat, cv_mat_to_numpy (zero-copy)
+#include "pipeline_config.hpp"
+#include "region_crops.hpp"
 
 namespace py = pybind11;
 
-// Convert numpy array to cv::Mat
-cv::Mat numpy_to_cv_mat(py::array_t<unsigned char>& input) {
-    py::buffer_info buf = input.request();
-    
-    if (buf.ndim != 3) {
-        throw std::runtime_error("Number of dimensions must be 3 (height, width, channels)");
+// Detections of one frame, gathered while the GIL is released
+struct FrameDetections {
+    int frameIndex = 0;
+    bool hasMotion = false;
+    std::vector<cv::Rect> boxes;
+};
+
+// Convert bounding boxes to an N x 4 int32 array of (x, y, width, height)
+py::array_t<int32_t> rects_to_numpy(const std::vector<cv::Rect>& rects) {
+    py::array_t<int32_t> array(std::vector<py::ssize_t>{static_cast<py::ssize_t>(rects.size()), 4});
+    auto view = array.mutable_unchecked<2>();
+    for (size_t i = 0; i < rects.size(); ++i) {
+        view(i, 0) = rects[i].x;
+        view(i, 1) = rects[i].y;
+        view(i, 2) = rects[i].width;
+        view(i, 3) = rects[i].height;
     }
-    
-    int height = static_cast<int>(buf.shape[0]);
-    int width = static_cast<int>(buf.shape[1]);
-    int channels = static_cast<int>(buf.shape[2]);
-    
-    cv::Mat mat(height, width, CV_8UC(channels), buf.ptr);
-    return mat.clone(); // Return a copy to ensure data ownership
+    return array;
 }
 
-// Convert cv::Mat to numpy array
-py::array_t<unsigned char> cv_mat_to_numpy(const cv::Mat& mat) {
-    py::array_t<unsigned char> array({mat.rows, mat.cols, mat.channels()});
-    py::buffer_info buf = array.request();
-    
-    unsigned char* ptr = static_cast<unsigned char*>(buf.ptr);
-    std::memcpy(ptr, mat.data, mat.total() * mat.elemSize());
-    
+py::list detections_to_python(const std::vector<FrameDetections>& detections) {
+    py::list frames;
+    for (const auto& frame : detections) {
+        py::dict entry;
+        entry["frame_index"] = frame.frameIndex;
+        entry["has_motion"] = frame.hasMotion;
+        entry["boxes"] = rects_to_numpy(frame.boxes);
+        frames.append(std::move(entry));
+    }
+    return frames;
+}
+
+// Row of the consolidated-region structured array returned to Python
+struct RegionRecord {
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+    int32_t frames_since_update;
+    int32_t object_count;
+};
+
+py::array_t<RegionRecord> regions_to_numpy(const std::vector<ConsolidatedRegion>& regions) {
+    py::array_t<RegionRecord> array(static_cast<py::ssize_t>(regions.size()));
+    auto view = array.mutable_unchecked<1>();
+    for (size_t i = 0; i < regions.size(); ++i) {
+        const auto& region = regions[i];
+        view(i) = {region.boundingBox.x, region.boundingBox.y, region.boundingBox.width,
+                   region.boundingBox.height, region.framesSinceLastUpdate,
+                   static_cast<int32_t>(region.trackedObjectIds.size())};
+    }
     return array;
 }
 
+// Tracked-object IDs of each region (ragged, so one int32 array per region)
+py::list region_object_ids_to_python(const std::vector<ConsolidatedRegion>& regions) {
+    py::list ids;
+    for (const auto& region : regions) {
+        py::array_t<int32_t> regionIds(static_cast<py::ssize_t>(region.trackedObjectIds.size()));
+        std::copy(region.trackedObjectIds.begin(), region.trackedObjectIds.end(),
+                  regionIds.mutable_data());
+        ids.append(std::move(regionIds));
+    }
+    return ids;
+}
+
+// {stage name: {count, mean_us, p50_us, p95_us, p99_us, max_us}} for stages with samples
+py::dict stage_timings_to_python(const StageTimings& timings) {
+    py::dict stages;
+    for (size_t i = 0; i < StageTimings::kStageCount; ++i) {
+        const auto stage = static_cast<PipelineStage>(i);
+        const StageTimings::Summary summary = timings.summary(stage);
+        if (summary.count == 0) continue;
+        py::dict entry;
+        entry["count"] = summary.count;
+        entry["mean_us"] = summary.meanMicros;
+        entry["p50_us"] = summary.p50Micros;
+        entry["p95_us"] = summary.p95Micros;
+        entry["p99_us"] = summary.p99Micros;
+        entry["max_us"] = summary.maxMicros;
+        stages[pipelineStageName(stage)] = std::move(entry);
+    }
+    return stages;
+}
+
+// Parse an N x 4 (x, y, width, height) array of boxes
+std::vector<cv::Rect> numpy_to_rects(
+    const py::array_t<int32_t, py::array::c_style | py::array::forcecast>& boxes) {
+    if (boxes.size() == 0) return {};
+    if (boxes.ndim() != 2 || boxes.shape(1) != 4) {
+        throw std::runtime_error("Boxes must be an N x 4 array of (x, y, width, height)");
+    }
+    auto view = boxes.unchecked<2>();
+    std::vector<cv::Rect> rects;
+    rects.reserve(boxes.shape(0));
+    for (py::ssize_t i = 0; i < boxes.shape(0); ++i) {
+        rects.emplace_back(view(i, 0), view(i, 1), view(i, 2), view(i, 3));
+    }
+    return rects;
+}
+
+// Image handed to Python: a numpy array, or with @p tensors a MatTensor for from_dlpack()
+py::object image_to_python(const cv::Mat& image, bool tensors) {
+    if (tensors) return py::cast(MatTensor(image));
+    return cv_mat_to_numpy(image);
+}
+
+// Stage names of MotionProcessor.process_frame(stage=...)
+MotionProcessor::ResultStage parse_result_stage(const std::string& name) {
+    if (name == "none") return MotionProcessor::STAGE_NONE;
+    if (name == "processed") return MotionProcessor::STAGE_PROCESSED;
+    if (name == "frame_diff") return MotionProcessor::STAGE_FRAME_DIFF;
+    if (name == "thresh") return MotionProcessor::STAGE_THRESH;
+    if (name == "morphological") return MotionProcessor::STAGE_MORPHOLOGICAL;
+    throw py::value_error("Unknown stage '" + name + "' (none, processed, frame_diff, thresh, morphological)");
+}
+
+const cv::Mat& stage_image(const MotionProcessor::ProcessingResult& result, MotionProcessor::ResultStage stage) {
+    static const cv::Mat none;
+    switch (stage) {
+        case MotionProcessor::STAGE_PROCESSED: return result.processedFrame;
+        case MotionProcessor::STAGE_FRAME_DIFF: return result.frameDiff;
+        case MotionProcessor::STAGE_THRESH: return result.thresh;
+        case MotionProcessor::STAGE_MORPHOLOGICAL: return result.morphological;
+        default: return none;
+    }
+}
+
+// Wrap an output array in place; anything but a writable, C-contiguous uint8 array is rejected
+cv::Mat writable_cv_mat(const py::object& object) {
+    if (!py::isinstance<py::array_t<unsigned char>>(object)) throw py::value_error("out must be a uint8 numpy array");
+    py::array array = py::reinterpret_borrow<py::array>(object);
+    if (!(array.flags() & py::array::c_style)) throw py::value_error("out must be C-contiguous");
+    if (!array.writeable()) throw py::value_error("out must be writable");
+    if (array.ndim() != 2 && array.ndim() != 3) throw py::value_error("out must be H x W or H x W x C");
+    const int channels = array.ndim() == 3 ? static_cast<int>(array.shape(2)) : 1;
+    if (channels < 1 || channels > CV_CN_MAX) throw py::value_error("out has an unsupported channel count");
+    return cv::Mat(static_cast<int>(array.shape(0)), static_cast<int>(array.shape(1)), CV_8UC(channels),
+                   array.mutable_data());
+}
+
+// Decode the regions of a stored JPEG (bytes or a path); None if it cannot be read
+py::object decode_jpeg_regions(const py::object& source,
+                               const py::array_t<int32_t, py::array::c_style | py::array::forcecast>& regions,
+                               int target_side) {
+    const std::vector<cv::Rect> rects = numpy_to_rects(regions);
+    std::vector<unsigned char> jpeg;
+    std::string path;
+    if (py::isinstance<py::bytes>(source)) {
+        const std::string bytes = source.cast<std::string>();
+        jpeg.assign(bytes.begin(), bytes.end());
+    } else {
+        path = py::module::import("os").attr("fspath")(source).cast<std::string>();
+    }
+    std::vector<cv::Mat> images;
+    bool decoded = false;
+    {
+        py::gil_scoped_release release;
+        if (!path.empty()) {
+            std::ifstream file(path, std::ios::binary);
+            jpeg.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+        decoded = JpegRegionDecoder::decode(jpeg, rects, target_side, images);
+    }
+    if (!decoded) return py::none();
+    py::list crops;
+    for (const cv::Mat& image : images) {
+        if (image.empty()) crops.append(py::none());
+        else crops.append(cv_mat_to_numpy(image));
+    }
+    return crops;
+}
+
+// Offsets array (CSR style) as size_t; negative entries are rejected
+std::vector<size_t> numpy_to_offsets(const py::array_t<int64_t, py::array::c_style | py::array::forcecast>& offsets,
+                                     const char* name) {
+    if (offsets.ndim() > 1) throw py::value_error(std::string(name) + " must be one-dimensional");
+    std::vector<size_t> values;
+    values.reserve(offsets.size());
+    for (const int64_t* value = offsets.data(); value != offsets.data() + offsets.size(); ++value) {
+        if (*value < 0) throw py::value_error(std::string(name) + " must not be negative");
+        values.push_back(static_cast<size_t>(*value));
+    }
+    return values;
+}
+
+// Consolidate stored boxes of many frames natively; see consolidateBoxBatch()
+py::dict consolidate_batch(const py::array_t<int32_t, py::array::c_style | py::array::forcecast>& boxes,
+                           const py::array_t<int64_t, py::array::c_style | py::array::forcecast>& frame_offsets,
+                           const ConsolidationConfig& config, const py::object& sequence_starts, size_t workers) {
+    const std::vector<cv::Rect> rects = numpy_to_rects(boxes);
+    const std::vector<size_t> frameOffsets = numpy_to_offsets(frame_offsets, "frame_offsets");
+    std::vector<size_t> sequenceStarts;
+    if (!sequence_starts.is_none()) {
+        sequenceStarts = numpy_to_offsets(
+            sequence_starts.cast<py::array_t<int64_t, py::array::c_style | py::array::forcecast>>(),
+            "sequence_starts");
+    }
+    ConsolidatedBoxBatch batch;
+    {
+        py::gil_scoped_release release;
+        batch = consolidateBoxBatch(rects, frameOffsets, sequenceStarts, config, workers);
+    }
+
+    py::array_t<int64_t> regionOffsets(static_cast<py::ssize_t>(batch.regionOffsets.size()));
+    std::copy(batch.regionOffsets.begin(), batch.regionOffsets.end(), regionOffsets.mutable_data());
+    // Member IDs of all regions, flattened the same way
+    py::array_t<int64_t> idOffsets(static_cast<py::ssize_t>(batch.regions.size() + 1));
+    int64_t* idOffset = idOffsets.mutable_data();
+    idOffset[0] = 0;
+    for (size_t i = 0; i < batch.regions.size(); ++i) {
+        idOffset[i + 1] = idOffset[i] + static_cast<int64_t>(batch.regions[i].trackedObjectIds.size());
+    }
+    py::array_t<int32_t> ids(static_cast<py::ssize_t>(idOffset[batch.regions.size()]));
+    int32_t* id = ids.mutable_data();
+    for (const auto& region : batch.regions) {
+        id = std::copy(region.trackedObjectIds.begin(), region.trackedObjectIds.end(), id);
+    }
+
+    py::dict result;
+    result["regions"] = regions_to_numpy(batch.regions);
+    result["region_offsets"] = std::move(regionOffsets);
+    result["region_object_ids"] = std::move(ids);
+    result["object_id_offsets"] = std::move(idOffsets);
+    return result;
+}
+
+// Wrapper class for MotionRegionConsolidator
+//
+// Consolidation keeps region state across frames, so calls are serialized with a mutex
+// and run with the GIL released like the processor.
+class MotionRegionConsolidatorWrapper {
+private:
+    MotionRegionConsolidator consolidator;
+    std::mutex consolidatorMutex;
+
+public:
+    explicit MotionRegionConsolidatorWrapper(const ConsolidationConfig& config = ConsolidationConfig())
+        : consolidator(config) {}
+
+    // Access for MotionProcessorWrapper (lock consolidatorMutex first)
+    MotionRegionConsolidator& get() { return consolidator; }
+    std::mutex& mutex() { return consolidatorMutex; }
+
+    // Boundary clipping needs the real frame size (caller holds consolidatorMutex)
+    void matchFrameSize(const cv::Size& frameSize) {
+        if (consolidator.getConfig().frameSize == frameSize) return;
+        ConsolidationConfig config = consolidator.getConfig();
+        config.frameSize = frameSize;
+        consolidator.updateConfig(config);
+    }
+
+    // Consolidate N x 4 boxes; returns {regions, region_object_ids}
+    py::dict consolidate(const py::array_t<int32_t, py::array::c_style | py::array::forcecast>& boxes) {
+        std::vector<cv::Rect> rects = numpy_to_rects(boxes);
+        std::vector<ConsolidatedRegion> regions;
+        std::vector<std::vector<ConsolidatedRegion>> levels;
+        {
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> lock(consolidatorMutex);
+            regions = consolidator.consolidateRegions(makeTrackedObjects(rects));
+            levels = consolidator.getRegionLevels();
+        }
+        py::dict result;
+        result["regions"] = regions_to_numpy(regions);
+        result["region_object_ids"] = region_object_ids_to_python(regions);
+        if (!levels.empty()) {
+            // One {regions, region_object_ids} per hierarchy_levels cut, in config order
+            py::list levelList;
+            for (const auto& level : levels) {
+                py::dict entry;
+                entry["regions"] = regions_to_numpy(level);
+                entry["region_object_ids"] = region_object_ids_to_python(level);
+                levelList.append(std::move(entry));
+            }
+            result["levels"] = std::move(levelList);
+        }
+        return result;
+    }
+
+    py::array_t<RegionRecord> get_current_regions() {
+        std::lock_guard<std::mutex> lock(consolidatorMutex);
+        return regions_to_numpy(consolidator.getCurrentRegions());
+    }
+
+    void clear_regions() {
+        std::lock_guard<std::mutex> lock(consolidatorMutex);
+        consolidator.clearRegions();
+    }
+
+    py::dict get_stage_timings() { return stage_timings_to_python(consolidator.getStageTimings()); }
+
+    ConsolidationConfig get_config() {
+        std::lock_guard<std::mutex> lock(consolidatorMutex);
+        return consolidator.getConfig();
+    }
+
+    void update_config(const ConsolidationConfig& config) {
+        std::lock_guard<std::mutex> lock(consolidatorMutex);
+        consolidator.updateConfig(config);
+    }
+};
+
 // Wrapper class for MotionProcessor
+//
+// All C++ work runs with the GIL released so Python threads (decoding, YOLO, ...) can
+// overlap with motion detection. A per-wrapper mutex keeps concurrent callers from
+// sharing the processor's frame state.
 class MotionProcessorWrapper {
 private:
     std::unique_ptr<MotionProcessor> processor;
-    
+    std::string configPath;
+    std::shared_ptr<const PipelineConfig> config;  // Parsed once; reset() reuses it
+    std::mutex processorMutex;
+
+    // Most recent results, kept for get_detections() / get_last_result() (guarded by processorMutex)
+    bool lastHasMotion = false;
+    std::vector<cv::Rect> lastDetections;
+    std::vector<ConsolidatedRegion> lastRegions;
+
+    void rememberDetections(const FrameDetections& detections) {
+        lastHasMotion = detections.hasMotion;
+        lastDetections = detections.boxes;
+        lastRegions.clear();
+    }
+
+    // Run frames through the processor keeping only detections (caller holds processorMutex)
+    FrameDetections detect(const cv::Mat& frame, int frameIndex) {
+        auto result = processor->processFrame(frame);
+        return {frameIndex, result.hasMotion, std::move(result.detectedBounds)};
+    }
+
+    // Keep only the intermediate images a call returns (none for the detection-only calls)
+    class DetectionsOnlyScope {
+    public:
+        explicit DetectionsOnlyScope(MotionProcessor& processor, unsigned stages = MotionProcessor::STAGE_NONE)
+            : processor(processor), saved(processor.getRetainedStages()) {
+            processor.setRetainedStages(stages);
+        }
+        ~DetectionsOnlyScope() { processor.setRetainedStages(saved); }
+
+    private:
+        MotionProcessor& processor;
+        unsigned saved;
+    };
+
 public:
     MotionProcessorWrapper(const std::string& config_path = "") {
         // Initialize logger first
         Logger::init("info", "python_bindings.log", false);
         
         // MotionProcessor requires a config path, so we'll use a default one if empty
-        std::string actual_config = config_path.empty() ? "config.yaml" : config_path;
-        processor = std::make_unique<MotionProcessor>(actual_config);
+        configPath = config_path.empty() ? "config.yaml" : config_path;
+        config = PipelineConfig::loadOrDefaults(configPath);
+        processor = std::make_unique<MotionProcessor>(config);
     }
     
-    py::array_t<unsigned char> process_frame(py::array_t<unsigned char>& input_frame) {
+    // Process one frame; returns the @p stage image ("processed", "thresh", "morphological",
+    // "frame_diff") or None for "none". With @p out the image is written into that array,
+    // which must be a writable, C-contiguous uint8 array of the image's shape, and out is
+    // returned, so a loop that passes the same array every frame allocates nothing. With
+    // @p tensor the image comes back as a MatTensor for from_dlpack().
+    py::object process_frame(const py::array& input_frame, const py::object& out, const std::string& stage,
+                             bool tensor) {
+        const MotionProcessor::ResultStage selected = parse_result_stage(stage);
+        const bool hasOut = !out.is_none();
+        cv::Mat target;
+        if (hasOut) {
+            if (selected == MotionProcessor::STAGE_NONE) throw py::value_error("out= needs a stage image");
+            target = writable_cv_mat(out);
+        }
+
+        // Borrows the numpy buffer; processFrame copies what it keeps between frames
         cv::Mat frame = numpy_to_cv_mat(input_frame);
-        auto result = processor->processFrame(frame);
-        return cv_mat_to_numpy(result.processedFrame);
+        cv::Mat image;
+        bool fits = true;
+        {
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> lock(processorMutex);
+            DetectionsOnlyScope stageOnly(*processor, selected);
+            auto result = processor->processFrame(frame);
+            rememberDetections({0, result.hasMotion, result.detectedBounds});
+            image = stage_image(result, selected);
+            if (hasOut) {
+                // An empty stage (first frame) leaves out untouched
+                fits = image.empty() || (image.size() == target.size() && image.type() == target.type());
+                if (fits && !image.empty()) image.copyTo(target);
+            } else if (processor->isBufferReuseEnabled()) {
+                // Reused work buffers are overwritten by the next frame, so hand Python its own copy
+                image = image.clone();
+            }
+        }
+        if (!fits) {
+            throw py::value_error("out has shape/dtype of " + std::to_string(target.rows) + " x " +
+                                  std::to_string(target.cols) + " x " + std::to_string(target.channels()) +
+                                  " uint8, the " + stage + " image is " + std::to_string(image.rows) + " x " +
+                                  std::to_string(image.cols) + " x " + std::to_string(image.channels()));
+        }
+        if (hasOut) return out;
+        if (selected == MotionProcessor::STAGE_NONE) return py::none();
+        return image_to_python(image, tensor);
+    }
+
+    // Process a list of frames in one native call; returns one detections dict per frame
+    py::list process_frames(const std::vector<py::array>& input_frames) {
+        std::vector<cv::Mat> frames;
+        frames.reserve(input_frames.size());
+        for (const auto& input : input_frames) frames.push_back(numpy_to_cv_mat(input));
+
+        std::vector<FrameDetections> detections;
+        detections.reserve(frames.size());
+        {
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> lock(processorMutex);
+            DetectionsOnlyScope detectionsOnly(*processor);
+            for (size_t i = 0; i < frames.size(); ++i) {
+                detections.push_back(detect(frames[i], static_cast<int>(i)));
+            }
+            if (!detections.empty()) rememberDetections(detections.back());
+        }
+        return detections_to_python(detections);
+    }
+
+    // Decode and process a whole video file natively; returns one detections dict per frame
+    py::list process_video(const std::string& video_path, int max_frames) {
+        std::vector<FrameDetections> detections;
+        bool opened = false;
+        {
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> lock(processorMutex);
+            cv::VideoCapture capture(video_path);
+            opened = capture.isOpened();
+            if (opened) {
+                DetectionsOnlyScope detectionsOnly(*processor);
+                cv::Mat frame;
+                int frameIndex = 0;
+                while ((max_frames < 0 || frameIndex < max_frames) && capture.read(frame)) {
+                    detections.push_back(detect(frame, frameIndex++));
+                }
+                if (!detections.empty()) rememberDetections(detections.back());
+            }
+        }
+        if (!opened) throw std::runtime_error("Could not open video: " + video_path);
+        return detections_to_python(detections);
     }
     
-    std::vector<py::dict> get_detections() {
-        // For now, return empty list since we need to store the last result
-        // This can be enhanced later to store the last ProcessingResult
-        return std::vector<py::dict>();
+    // Run detection and DBSCAN consolidation (processFrameAndConsolidate) on one frame; with
+    // crops, the result also holds one view of input_frame per region (no pixels copied)
+    py::dict process_and_consolidate(const py::array& input_frame,
+                                     MotionRegionConsolidatorWrapper& consolidator, bool crops) {
+        cv::Mat frame = numpy_to_cv_mat(input_frame);
+        std::vector<cv::Mat> regionViews;
+        {
+            py::gil_scoped_release release;
+            std::scoped_lock lock(processorMutex, consolidator.mutex());
+            DetectionsOnlyScope detectionsOnly(*processor);
+            consolidator.matchFrameSize(frame.size());
+            auto [result, regions] = processFrameAndConsolidate(*processor, consolidator.get(), frame);
+            lastHasMotion = result.hasMotion;
+            lastDetections = std::move(result.detectedBounds);
+            lastRegions = std::move(regions);
+            if (crops) regionCrops(frame, lastRegions, regionViews);
+        }
+        py::dict result = get_last_result();
+        if (crops) {
+            // Views of the caller's array (or of the converted copy, if it needed one)
+            py::list views;
+            for (const cv::Mat& crop : regionViews) views.append(cv_mat_to_numpy(crop, input_frame));
+            result["crops"] = views;
+        }
+        return result;
+    }
+
+    // Boxes of the most recent frame as an N x 4 int32 array of (x, y, width, height)
+    py::array_t<int32_t> get_detections() {
+        std::lock_guard<std::mutex> lock(processorMutex);
+        return rects_to_numpy(lastDetections);
     }
     
+    // Re-read the config file, keeping the previous frame and background model; an invalid
+    // file raises ValueError and the running config stays
+    void reload_config() {
+        py::gil_scoped_release release;
+        auto reloaded = PipelineConfig::load(configPath);
+        std::lock_guard<std::mutex> lock(processorMutex);
+        config = reloaded;
+        processor->reloadConfig(std::move(reloaded));
+    }
+
+    // Forget the previous frames and the background model, keeping the parsed config and
+    // every allocated buffer; the next frame starts a new scene
+    void reset_state() {
+        std::lock_guard<std::mutex> lock(processorMutex);
+        processor->resetState();
+        rememberDetections({});
+    }
+
     void reset() {
-        // Reset by creating a new processor instance
-        std::string config_path = "config.yaml"; // Default config
-        processor = std::make_unique<MotionProcessor>(config_path);
+        // Reset by creating a new processor instance from the same config snapshot (no re-parse)
+        std::lock_guard<std::mutex> lock(processorMutex);
+        processor = std::make_unique<MotionProcessor>(config);
     }
     
-    // Get the last processing result
+    // Get the last processing result: {has_motion, boxes, regions, region_object_ids}
+    // (regions are only filled by process_and_consolidate)
     py::dict get_last_result() {
-        // This would need to be implemented by storing the last ProcessingResult
-        // For now, return empty dict
-        return py::dict();
+        std::lock_guard<std::mutex> lock(processorMutex);
+        py::dict result;
+        result["has_motion"] = lastHasMotion;
+        result["boxes"] = rects_to_numpy(lastDetections);
+        result["regions"] = regions_to_numpy(lastRegions);
+        result["region_object_ids"] = region_object_ids_to_python(lastRegions);
+        return result;
+    }
+
+    // Histograms are read lock-free; the mutex only keeps reset() from swapping the processor
+    py::dict get_stage_timings() {
+        std::lock_guard<std::mutex> lock(processorMutex);
+        return stage_timings_to_python(processor->getStageTimings());
+    }
+};
+
+py::dict frame_event_stats_to_python(const FrameEventStats& stats) {
+    py::dict entry;
+    entry["frames_read"] = stats.framesRead;
+    entry["frames_skipped"] = stats.framesSkipped;
+    entry["frames_processed"] = stats.framesProcessed;
+    entry["events_emitted"] = stats.eventsEmitted;
+    entry["events_dropped"] = stats.eventsDropped;
+    entry["processing_errors"] = stats.processingErrors;
+    entry["processed_fps"] = stats.processedFps;
+    return entry;
+}
+
+// Frame event of a Pipeline as {frame_index, timestamp_ms, frame, boxes, regions,
+// region_object_ids, crops, stats, error}; frame and crops are views of the capture buffer
+py::dict frame_event_to_python(const FrameEvent& event, bool tensors) {
+    py::dict entry;
+    entry["frame_index"] = event.frameIndex;
+    entry["timestamp_ms"] = event.timestampMs;
+    entry["frame"] = image_to_python(event.frame, tensors);
+    entry["boxes"] = rects_to_numpy(event.boxes);
+    entry["regions"] = regions_to_numpy(event.regions);
+    entry["region_object_ids"] = region_object_ids_to_python(event.regions);
+    py::list crops;
+    for (const auto& crop : event.crops) crops.append(image_to_python(crop, tensors));
+    entry["crops"] = std::move(crops);
+    entry["stats"] = frame_event_stats_to_python(event.stats);
+    entry["error"] = event.error;
+    return entry;
+}
+
+// Capture and pipeline running on native threads, consumed as a Python (async) iterator
+//
+// Iteration waits with the GIL released, waking up every kSignalPollInterval to let Python
+// handle Ctrl-C. The async iterator runs the same wait on the event loop's default executor.
+class PipelineWrapper {
+private:
+    static constexpr auto kSignalPollInterval = std::chrono::milliseconds(100);
+
+    std::unique_ptr<FrameEventStream> stream;
+    bool tensors = false;  // Frames and crops as MatTensor instead of numpy arrays
+
+public:
+    PipelineWrapper(const std::string& config_path, const std::string& source, int frame_skip,
+                    bool motion_only, bool crops, size_t queue_size, bool drop_when_full,
+                    const std::string& backend, bool tensors)
+        : tensors(tensors) {
+        Logger::init("info", "python_bindings.log", false);
+        auto config = PipelineConfig::loadOrDefaults(config_path.empty() ? "config.yaml" : config_path);
+
+        CaptureConfig capture;
+        capture.backend = parseCaptureBackend(backend);
+        capture.source = source;
+        FrameEventStreamOptions options;
+        options.frameSkip = frame_skip;
+        options.motionOnly = motion_only;
+        options.crops = crops;
+        options.queueCapacity = queue_size;
+        options.policy = drop_when_full ? BackpressurePolicy::DropOldest : BackpressurePolicy::Block;
+
+        py::gil_scoped_release release;
+        stream = FrameEventStream::open(std::move(config), std::move(capture), options);
+        stream->start();
+    }
+
+    // Next event, or None once the source is exhausted (or the pipeline was closed)
+    py::object next_event() {
+        for (;;) {
+            std::optional<FrameEvent> event;
+            bool finished = false;
+            {
+                py::gil_scoped_release release;
+                event = stream->nextFor(kSignalPollInterval);
+                if (!event) finished = stream->finished();
+            }
+            if (event) return frame_event_to_python(*event, tensors);
+            if (finished) return py::none();
+            if (PyErr_CheckSignals() != 0) throw py::error_already_set();
+        }
+    }
+
+    py::dict next() {
+        py::object event = next_event();
+        if (event.is_none()) throw py::stop_iteration();
+        return event;
+    }
+
+    // Awaitable of the next event; raises StopAsyncIteration at the end
+    py::object anext() {
+        py::object loop = py::module::import("asyncio").attr("get_running_loop")();
+        py::object self = py::cast(this, py::return_value_policy::reference);
+        py::cpp_function wait([self]() -> py::object {
+            py::object event = self.cast<PipelineWrapper&>().next_event();
+            if (event.is_none()) {
+                PyErr_SetNone(PyExc_StopAsyncIteration);
+                throw py::error_already_set();
+            }
+            return event;
+        });
+        return loop.attr("run_in_executor")(py::none(), wait);
+    }
+
+    // Call callback(event) for every event until the end; returns the number of events
+    size_t run(const py::function& callback) {
+        size_t count = 0;
+        for (py::object event = next_event(); !event.is_none(); event = next_event()) {
+            callback(event);
+            ++count;
+        }
+        return count;
+    }
+
+    void close() {
+        py::gil_scoped_release release;
+        stream->stop();
+    }
+
+    py::dict get_stats() {
+        return frame_event_stats_to_python(stream->stats());
     }
 };
 
 PYBIND11_MODULE(birds_of_play_python, m) {
     m.doc() = "Python bindings for Birds of Play motion detection library";
+
+    PYBIND11_NUMPY_DTYPE(RegionRecord, x, y, width, height, frames_since_update, object_count);
+
+    // Zero-copy DLPack producer for frames, masks and crops (torch.from_dlpack)
+    bind_mat_tensor(m, "Tensor");
+
+    // DBSCAN consolidation settings
+    py::class_<ConsolidationConfig>(m, "ConsolidationConfig")
+        .def(py::init<>())
+        .def_readwrite("eps", &ConsolidationConfig::eps)
+        .def_readwrite("min_pts", &ConsolidationConfig::minPts)
+        .def_readwrite("overlap_weight", &ConsolidationConfig::overlapWeight)
+        .def_readwrite("edge_weight", &ConsolidationConfig::edgeWeight)
+        .def_readwrite("max_edge_distance", &ConsolidationConfig::maxEdgeDistance)
+        .def_property(
+            "distance_metric",
+            [](const ConsolidationConfig& c) { return std::string(distanceMetricName(c.distanceMetric)); },
+            [](ConsolidationConfig& c, const std::string& name) { c.distanceMetric = parseDistanceMetric(name); },
+            "\"overlap_edge\", \"edge_gap\", \"center_linf\" or \"iou\"")
+        .def_readwrite("max_frames_without_update", &ConsolidationConfig::maxFramesWithoutUpdate)
+        .def_readwrite("region_expansion_factor", &ConsolidationConfig::regionExpansionFactor)
+        .def_readwrite("integer_geometry", &ConsolidationConfig::integerGeometry)
+        .def_readwrite("keyframe_interval", &ConsolidationConfig::keyframeInterval)
+        .def_readwrite("keyframe_box_count_change", &ConsolidationConfig::keyframeBoxCountChange)
+        .def_readwrite("keyframe_max_unassigned", &ConsolidationConfig::keyframeMaxUnassigned)
+        .def_readwrite("keyframe_attach_iou", &ConsolidationConfig::keyframeAttachIou)
+        .def_readwrite("memoize_unchanged_frames", &ConsolidationConfig::memoizeUnchangedFrames)
+        .def_readwrite("memoize_quantization", &ConsolidationConfig::memoizeQuantization)
+        .def_readwrite("parallel_clustering_min_boxes", &ConsolidationConfig::parallelClusteringMinBoxes)
+        .def_readwrite("grid_cell_size", &ConsolidationConfig::gridCellSize)
+        .def_readwrite("max_distance_threshold", &ConsolidationConfig::maxDistanceThreshold)
+        .def_readwrite("min_objects_per_region", &ConsolidationConfig::minObjectsPerRegion)
+        .def_readwrite("min_region_area", &ConsolidationConfig::minRegionArea)
+        .def_readwrite("max_region_area", &ConsolidationConfig::maxRegionArea)
+        .def_readwrite("overlap_threshold", &ConsolidationConfig::overlapThreshold)
+        .def_readwrite("eps_fraction", &ConsolidationConfig::epsFraction)
+        .def_readwrite("max_edge_distance_fraction", &ConsolidationConfig::maxEdgeDistanceFraction)
+        .def_readwrite("hierarchy_levels", &ConsolidationConfig::hierarchyLevels,
+                       "Extra distance cuts (multiples of eps) returned as 'levels' by consolidate()")
+        .def_property(
+            "frame_size",
+            [](const ConsolidationConfig& c) { return py::make_tuple(c.frameSize.width, c.frameSize.height); },
+            [](ConsolidationConfig& c, std::pair<int, int> size) { c.frameSize = cv::Size(size.first, size.second); },
+            "(width, height) used for boundary clipping");
+
+    // MotionRegionConsolidator wrapper
+    py::class_<MotionRegionConsolidatorWrapper>(m, "MotionRegionConsolidator")
+        .def(py::init<const ConsolidationConfig&>(), py::arg("config") = ConsolidationConfig())
+        .def("consolidate", &MotionRegionConsolidatorWrapper::consolidate, py::arg("boxes"),
+             "Consolidate N x 4 (x, y, w, h) boxes; returns {regions, region_object_ids}, plus 'levels' "
+             "(one such dict per hierarchy_levels cut) when configured")
+        .def("get_current_regions", &MotionRegionConsolidatorWrapper::get_current_regions,
+             "Regions as a structured array (x, y, width, height, frames_since_update, object_count)")
+        .def("clear_regions", &MotionRegionConsolidatorWrapper::clear_regions, "Forget all regions")
+        .def("get_stage_timings", &MotionRegionConsolidatorWrapper::get_stage_timings,
+             "Clustering / region-merge latency percentiles (empty unless built with ENABLE_STAGE_TIMING)")
+        .def_property("config", &MotionRegionConsolidatorWrapper::get_config,
+                      &MotionRegionConsolidatorWrapper::update_config);
     
     // MotionProcessor wrapper
     py::class_<MotionProcessorWrapper>(m, "MotionProcessor")
         .def(py::init<const std::string&>(), py::arg("config_path") = "")
-        .def("process_frame", &MotionProcessorWrapper::process_frame, "Process a frame and return the result")
-        .def("get_detections", &MotionProcessorWrapper::get_detections, "Get current detections")
-        .def("reset", &MotionProcessorWrapper::reset, "Reset the processor state")
-        .def("get_last_result", &MotionProcessorWrapper::get_last_result, "Get the last processing result");
+        .def("process_frame", &MotionProcessorWrapper::process_frame, py::arg("frame"), py::arg("out") = py::none(),
+             py::arg("stage") = "processed", py::arg("tensor") = false,
+             "Process a frame; returns the stage image (\"none\", \"processed\", \"thresh\", \"morphological\", "
+             "\"frame_diff\"), written into out= when given, or as a Tensor for from_dlpack() with tensor=True")
+        .def("process_frames", &MotionProcessorWrapper::process_frames, py::arg("frames"),
+             "Process a list of frames natively; returns [{frame_index, has_motion, boxes (N x 4 int32 x, y, w, h)}]")
+        .def("process_video", &MotionProcessorWrapper::process_video, py::arg("video_path"),
+             py::arg("max_frames") = -1,
+             "Decode and process a video file natively; returns one detections dict per frame")
+        .def("process_and_consolidate", &MotionProcessorWrapper::process_and_consolidate,
+             py::arg("frame"), py::arg("consolidator"), py::arg("crops") = false,
+             "Detect motion and consolidate regions; returns {has_motion, boxes, regions, region_object_ids}, "
+             "plus crops (views of frame, one per region) when crops=True")
+        .def("get_detections", &MotionProcessorWrapper::get_detections,
+             "Boxes of the last frame as an N x 4 int32 array (x, y, w, h)")
+        .def("reload_config", &MotionProcessorWrapper::reload_config,
+             "Re-read the config file without losing the frame reference or background model")
+        .def("reset_state", &MotionProcessorWrapper::reset_state,
+             "Forget the previous frames and background model without rebuilding the processor")
+        .def("reset", &MotionProcessorWrapper::reset, "Recreate the processor from the loaded config")
+        .def("get_last_result", &MotionProcessorWrapper::get_last_result, "Get the last processing result")
+        .def("get_stage_timings", &MotionProcessorWrapper::get_stage_timings,
+             "Per-stage latency percentiles in microseconds (empty unless built with ENABLE_STAGE_TIMING)");
     
+    // Native capture + pipeline as an event stream
+    py::class_<PipelineWrapper>(m, "Pipeline")
+        .def(py::init<const std::string&, const std::string&, int, bool, bool, size_t, bool, const std::string&,
+                      bool>(),
+             py::arg("config") = "", py::arg("source") = "", py::arg("frame_skip") = 0,
+             py::arg("motion_only") = true, py::arg("crops") = true, py::arg("queue_size") = 8,
+             py::arg("drop_when_full") = false, py::arg("backend") = "auto", py::arg("tensors") = false,
+             "Open source (file, RTSP URL or device; \"\" = camera 0) and start capturing and processing "
+             "on native threads; with tensors=True frame and crops are Tensor objects for from_dlpack()")
+        .def("__iter__", [](py::object self) { return self; })
+        .def("__next__", &PipelineWrapper::next,
+             "Next event: {frame_index, timestamp_ms, frame, boxes, regions, region_object_ids, crops, stats, "
+             "error}; frame and crops are zero-copy views of the captured frame")
+        .def("__aiter__", [](py::object self) { return self; })
+        .def("__anext__", &PipelineWrapper::anext, "Awaitable of the next event (waits on the default executor)")
+        .def("run", &PipelineWrapper::run, py::arg("callback"),
+             "Call callback(event) for every event until the source ends; returns the number of events")
+        .def("close", &PipelineWrapper::close, "Stop capturing; events already queued can still be taken")
+        .def("__enter__", [](py::object self) { return self; })
+        .def("__exit__", [](PipelineWrapper& self, py::args) { self.close(); })
+        .def_property_readonly("stats", &PipelineWrapper::get_stats,
+                               "{frames_read, frames_skipped, frames_processed, events_emitted, events_dropped, "
+                               "processing_errors, processed_fps}");
+
+    // Offline re-consolidation of stored motion regions
+    m.def("consolidate_batch", &consolidate_batch, py::arg("boxes"), py::arg("frame_offsets"),
+          py::arg("config") = ConsolidationConfig(), py::arg("sequence_starts") = py::none(),
+          py::arg("workers") = 0,
+          "Consolidate N x 4 int32 (x, y, w, h) boxes of many frames natively, frame f owning "
+          "boxes[frame_offsets[f]:frame_offsets[f + 1]]; frames of a sequence (from each of sequence_starts, "
+          "default one) share a consolidator in order, sequences run in parallel on workers threads (0 = all). "
+          "Returns {regions, region_offsets, region_object_ids, object_id_offsets}: frame f's regions are "
+          "regions[region_offsets[f]:region_offsets[f + 1]], region r's member box indices (within its frame) "
+          "are region_object_ids[object_id_offsets[r]:object_id_offsets[r + 1]]");
+
+    // Cropped, DCT-scaled decodes of stored frames (FrameDatabaseV2.get_frame_regions)
+    m.def("decode_jpeg_regions", &decode_jpeg_regions, py::arg("jpeg"), py::arg("regions"),
+          py::arg("target_side") = 0,
+          "Decode only the N x 4 (x, y, w, h) regions of a JPEG (bytes or a path) as BGR arrays, each at the "
+          "coarsest 1/2, 1/4 or 1/8 DCT scale keeping its longer side >= target_side (0 = full resolution); "
+          "None for a region outside the image, or instead of the list if the JPEG cannot be read");
+
     // Function to save frames directly to MongoDB with file storage and thumbnails
     m.def("save_frame_to_mongodb", [](py::array_t<unsigned char>& frame_array, const std::string& metadata_json) {
         try {
-            // Convert numpy array to cv::Mat first
-            cv::Mat frame = numpy_to_cv_mat(frame_array);
-            
             // Import Python modules
             py::module sys = py::module::import("sys");
             py::module os = py::module::import("os");
@@ -122,11 +828,9 @@ PYBIND11_MODULE(birds_of_play_python, m) {
             py::module json = py::module::import("json");
             py::object metadata = json.attr("loads")(metadata_json);
             
-            // Convert cv::Mat to numpy array for Python
-            py::array_t<unsigned char> numpy_frame = cv_mat_to_numpy(frame);
-            
             // Save frame with automatic thumbnail generation and file storage
-            py::object result = frame_db.attr("save_frame")(numpy_frame, metadata);
+            // (the caller's array is passed through as-is, no conversion needed)
+            py::object result = frame_db.attr("save_frame")(frame_array, metadata);
             
             // Disconnect
             db_manager.attr("disconnect")();
@@ -145,10 +849,6 @@ PYBIND11_MODULE(birds_of_play_python, m) {
     // Function to save both original and processed frames to MongoDB with file storage and thumbnails
     m.def("save_frames_to_mongodb", [](py::array_t<unsigned char>& original_frame_array, py::array_t<unsigned char>& processed_frame_array, const std::string& metadata_json) {
         try {
-            // Convert numpy arrays to cv::Mat first
-            cv::Mat original_frame = numpy_to_cv_mat(original_frame_array);
-            cv::Mat processed_frame = numpy_to_cv_mat(processed_frame_array);
-            
             // Import Python modules
             py::module sys = py::module::import("sys");
             py::module os = py::module::import("os");
@@ -176,12 +876,9 @@ PYBIND11_MODULE(birds_of_play_python, m) {
             py::module json = py::module::import("json");
             py::object metadata = json.attr("loads")(metadata_json);
             
-            // Convert cv::Mat to numpy arrays for Python
-            py::array_t<unsigned char> numpy_original = cv_mat_to_numpy(original_frame);
-            py::array_t<unsigned char> numpy_processed = cv_mat_to_numpy(processed_frame);
-            
             // Save both frames with automatic thumbnail generation and file storage
-            py::object result = frame_db.attr("save_frame_with_original")(numpy_original, numpy_processed, metadata);
+            // (the caller's arrays are passed through as-is, no conversion needed)
+            py::object result = frame_db.attr("save_frame_with_original")(original_frame_array, processed_frame_array, metadata);
             
             // Disconnect
             db_manager.attr("disconnect")();
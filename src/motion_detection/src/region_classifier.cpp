@@ -0,0 +1,375 @@
+#include "region_classifier.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <opencv2/imgproc.hpp>
+#include <unordered_map>
+
+#include "logger.hpp"
+
+namespace {
+
+void selectBackend(cv::dnn::Net& net, const std::string& backend) {
+    if (backend == "opencl") {
+        net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+        net.setPreferableTarget(cv::dnn::DNN_TARGET_OPENCL);
+    } else if (backend == "cuda") {
+        net.setPreferableBackend(cv::dnn::DNN_BACKEND_CUDA);
+        net.setPreferableTarget(cv::dnn::DNN_TARGET_CUDA);
+    } else if (backend == "openvino") {
+        net.setPreferableBackend(cv::dnn::DNN_BACKEND_INFERENCE_ENGINE);
+        net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+    } else {
+        if (backend != "cpu") LOG_WARN("Unknown classifier backend '{}'; using 'cpu'", backend);
+        net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+        net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+    }
+}
+
+// Region grown by @p padding of its size per side, clipped to the frame
+cv::Rect paddedCrop(const cv::Rect& region, double padding, const cv::Size& frameSize) {
+    const int padX = static_cast<int>(region.width * padding);
+    const int padY = static_cast<int>(region.height * padding);
+    const cv::Rect grown(region.x - padX, region.y - padY, region.width + 2 * padX, region.height + 2 * padY);
+    return grown & cv::Rect(cv::Point(), frameSize);
+}
+
+// The packer of the classifier: without the mosaic every crop owns (is letterboxed into) a tile
+RegionMosaicConfig packerConfig(const RegionClassifierConfig& config) {
+    RegionMosaicConfig mosaic = config.mosaic;
+    mosaic.tileSize = std::max(32, config.inputSize);
+    if (!mosaic.enabled) mosaic.sizeTolerancePercent = 100.0;
+    return mosaic;
+}
+
+}  // namespace
+
+RegionClassifier::RegionClassifier(const RegionClassifierConfig& config)
+    : config_(config), packer_(packerConfig(config)), cache_(config.cache, config.confidenceThreshold) {
+    config_.inputSize = std::max(32, config_.inputSize);
+    config_.maxBatch = std::max(1, config_.maxBatch);
+    if (config_.classNames.empty()) config_.classNames = cocoClassNames();
+    if (!config_.enabled) {
+        return;
+    }
+    if (!std::filesystem::exists(config_.modelPath)) {
+        LOG_ERROR("Region classifier model not found: {}; classification disabled", config_.modelPath);
+        return;
+    }
+    try {
+        net_ = cv::dnn::readNet(config_.modelPath);
+        selectBackend(net_, config_.backend);
+        enabled_ = !net_.empty();
+    } catch (const cv::Exception& e) {
+        LOG_ERROR("Cannot load region classifier model {}: {}", config_.modelPath, e.what());
+    }
+    if (enabled_ && config_.devicePreprocessing) {
+        deviceTensor_ = std::make_unique<RegionTensorBuilder>(config_.maxBatch, config_.inputSize);
+        if (!deviceTensor_->onDevice()) deviceTensor_.reset();
+    }
+    if (enabled_) {
+        LOG_INFO("Region classifier: {} on {} ({}x{} input, batches of {}, threshold {:.2f}, mosaic {})",
+                 config_.modelPath, config_.backend, config_.inputSize, config_.inputSize, config_.maxBatch,
+                 config_.confidenceThreshold, config_.mosaic.enabled ? "on" : "off");
+    }
+}
+
+cv::Mat RegionClassifier::cropRegion(const cv::Mat& frame, const cv::Rect& region) const {
+    const cv::Rect crop = paddedCrop(region, config_.regionPadding, frame.size());
+    return crop.empty() ? cv::Mat() : frame(crop);
+}
+
+std::vector<RegionClassification> RegionClassifier::classify(const cv::Mat& frame,
+                                                             const std::vector<cv::Rect>& regions) {
+    std::vector<cv::Mat> crops(regions.size());
+    std::vector<cv::Rect> cropRects(regions.size());
+    if (enabled_ && !frame.empty()) {
+        for (size_t i = 0; i < regions.size(); ++i) {
+            cropRects[i] = paddedCrop(regions[i], config_.regionPadding, frame.size());
+            if (!cropRects[i].empty()) crops[i] = frame(cropRects[i]);
+        }
+    }
+    std::vector<RegionClassification> results = classifyCrops(crops, frame, cropRects);
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i].classId >= 0) {
+            results[i].box.x += cropRects[i].x;  // Crop to frame coordinates
+            results[i].box.y += cropRects[i].y;
+        }
+    }
+    return results;
+}
+
+std::vector<RegionClassification> RegionClassifier::classifyCrops(const std::vector<cv::Mat>& crops) {
+    return classifyCrops(crops, cv::Mat(), {});
+}
+
+std::vector<RegionClassification> RegionClassifier::classifyCrops(const std::vector<cv::Mat>& crops,
+                                                                  const cv::Mat& frame,
+                                                                  const std::vector<cv::Rect>& cropRects) {
+    std::vector<RegionClassification> results(crops.size());
+    if (!enabled_) {
+        return results;
+    }
+
+    // Empty crops (regions outside the frame) get no tile and stay "unknown"
+    std::vector<cv::Size> sizes;
+    sizes.reserve(crops.size());
+    for (const cv::Mat& crop : crops) sizes.push_back(crop.size());
+    const std::vector<MosaicTile> tiles = packer_.pack(sizes);
+
+    for (size_t begin = 0; begin < tiles.size();) {
+        const size_t batch = batching_ ? static_cast<size_t>(config_.maxBatch) : 1;
+        const size_t end = std::min(tiles.size(), begin + batch);
+        try {
+            forward(crops, frame, cropRects, tiles, begin, end, results);
+        } catch (const cv::Exception& e) {
+            if (end - begin > 1 && batching_) {
+                LOG_WARN("Region classifier model rejected a batch of {} ({}); classifying one tile at a time",
+                         end - begin, e.what());
+                batching_ = false;
+                continue;  // Same tiles, one by one
+            }
+            stats_.failures++;
+            LOG_DEBUG_LIMITED("Region classification failed: {}", e.what());
+        }
+        begin = end;
+    }
+
+    for (const MosaicTile& tile : tiles) {
+        stats_.classified += tile.placements.size();
+        for (const MosaicPlacement& placement : tile.placements) {
+            if (results[placement.item].classId >= 0) stats_.labelled++;
+        }
+    }
+    stats_.tiles += tiles.size();
+    return results;
+}
+
+/**
+ * Runs tiles[begin..end) through the network. Each tile (one letterboxed crop, or a mosaic
+ * of small ones) is drawn and written straight into the planes of the pooled input tensor
+ * (allocated once for maxBatch tiles; a smaller batch is a view of its first items), RGB and
+ * scaled to [0, 1] like the ultralytics preprocessing. With the crops' frame at hand and a
+ * device tensor builder, the same tensor is built on the device instead. Every crop takes
+ * the best detection centered in its part of the tile, mapped back to crop coordinates.
+ */
+void RegionClassifier::forward(const std::vector<cv::Mat>& crops, const cv::Mat& frame,
+                               const std::vector<cv::Rect>& cropRects, const std::vector<MosaicTile>& tiles,
+                               size_t begin, size_t end, std::vector<RegionClassification>& results) {
+    const auto start = std::chrono::steady_clock::now();
+    const int size = config_.inputSize;
+    const int count = static_cast<int>(end - begin);
+    if (buildOnDevice(frame, cropRects, tiles, begin, end)) {
+        net_.setInput(deviceTensor_->tensor(count));
+        stats_.deviceBatches++;
+    } else {
+        const int tensorSize[] = {config_.maxBatch, 3, size, size};
+        if (tensor_.empty()) {
+            tensor_.create(4, tensorSize, CV_32F);
+        }
+        for (int item = 0; item < count; ++item) {
+            packer_.render(crops, tiles[begin + item], canvas_);
+            canvas_.convertTo(scaledCanvas_, CV_32F, 1.0 / 255.0);
+            // split() writes into the planes in place: their size and type already match
+            std::vector<cv::Mat> planes = {cv::Mat(size, size, CV_32F, tensor_.ptr<float>(item, 2)),
+                                           cv::Mat(size, size, CV_32F, tensor_.ptr<float>(item, 1)),
+                                           cv::Mat(size, size, CV_32F, tensor_.ptr<float>(item, 0))};
+            cv::split(scaledCanvas_, planes);
+        }
+        const std::vector<cv::Range> items = {cv::Range(0, count), cv::Range::all(), cv::Range::all(),
+                                              cv::Range::all()};
+        net_.setInput(tensor_(items));
+    }
+    const cv::Mat output = net_.forward();
+    for (int item = 0; item < count; ++item) {
+        for (const MosaicPlacement& placement : tiles[begin + item].placements) {
+            RegionClassification& result = results[placement.item];
+            result = bestDetection(output, item, config_.classNames, config_.confidenceThreshold, placement.target);
+            if (result.classId >= 0) result.box = RegionMosaicPacker::toSource(placement, result.box);
+        }
+    }
+    stats_.batches++;
+    stats_.lastBatchMs =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Tiles [begin, end) as placements of frame areas, built into the device tensor in one launch
+bool RegionClassifier::buildOnDevice(const cv::Mat& frame, const std::vector<cv::Rect>& cropRects,
+                                     const std::vector<MosaicTile>& tiles, size_t begin, size_t end) {
+    if (!deviceTensor_ || frame.empty()) return false;
+    devicePlacements_.clear();
+    for (size_t item = begin; item < end; ++item) {
+        for (const MosaicPlacement& placement : tiles[item].placements) {
+            if (placement.item >= cropRects.size()) return false;
+            const int batchItem = static_cast<int>(item - begin);
+            devicePlacements_.push_back({batchItem, cropRects[placement.item], placement.target});
+        }
+    }
+    return deviceTensor_->build(frame, devicePlacements_, static_cast<int>(end - begin));
+}
+
+size_t RegionClassifier::classifyRegions(const cv::Mat& frame, std::vector<ConsolidatedRegion>& regions,
+                                         TrackedObjectStore& objects) {
+    if (!enabled_) {
+        return 0;
+    }
+    cache_.advanceFrame();
+    cache_.retain(objects.ids());
+
+    std::unordered_map<int, size_t> rows;
+    rows.reserve(objects.size());
+    for (size_t row = 0; row < objects.size(); ++row) rows.emplace(objects.id(row), row);
+
+    // Regions with a track the cache cannot answer; the others take the best cached label
+    // among their tracks
+    std::vector<cv::Rect> pending;
+    std::vector<size_t> pendingRegions;
+    std::vector<bool> newTracks(regions.size(), false);  // Regions with a track the cache has never labelled
+    for (size_t i = 0; i < regions.size(); ++i) {
+        ConsolidatedRegion& region = regions[i];
+        bool cached = !region.trackedObjectIds.empty();
+        for (int id : region.trackedObjectIds) {
+            auto row = rows.find(id);
+            const cv::Rect box = row != rows.end() ? objects.bounds(row->second) : region.boundingBox;
+            if (cache_.needsClassification(id, frame, box)) {
+                cached = false;
+                if (!cache_.find(id)) newTracks[i] = true;
+                continue;
+            }
+            const ClassificationCacheEntry* entry = cache_.find(id);
+            if (entry->classId >= 0 && entry->confidence > region.classConfidence) {
+                region.classLabel = entry->label;
+                region.classConfidence = entry->confidence;
+                region.classId = entry->classId;
+            }
+        }
+        if (cached) {
+            stats_.skipped++;
+            continue;
+        }
+        pending.push_back(region.boundingBox);
+        pendingRegions.push_back(i);
+    }
+    if (pending.empty()) {
+        return 0;
+    }
+    const size_t budget = static_cast<size_t>(std::max(0, config_.maxRegionsPerFrame));
+    if (budget > 0 && pendingRegions.size() > budget) {
+        // Spend the budget where it counts: new tracks, then fast motion, then large,
+        // strong changes (detection statistics); jitter waits
+        std::stable_sort(pendingRegions.begin(), pendingRegions.end(), [&](size_t a, size_t b) {
+            const RegionMotion& motionA = regions[a].motion;
+            const RegionMotion& motionB = regions[b].motion;
+            if (newTracks[a] != newTracks[b]) return static_cast<bool>(newTracks[a]);
+            if (motionA.jitter != motionB.jitter) return motionB.jitter;
+            if (motionA.speed() != motionB.speed()) return motionA.speed() > motionB.speed();
+            const auto salience = [](const ConsolidatedRegion& region) {
+                return region.motionArea * (region.meanDiff > 0.0f ? region.meanDiff : 1.0f);
+            };
+            return salience(regions[a]) > salience(regions[b]);
+        });
+        stats_.deferred += pendingRegions.size() - budget;
+        pendingRegions.resize(budget);
+        pending.clear();
+        for (size_t i : pendingRegions) pending.push_back(regions[i].boundingBox);
+    }
+
+    // The newest result replaces a track's label, also when it comes back unknown
+    const std::vector<RegionClassification> results = classify(frame, pending);
+    for (size_t k = 0; k < results.size(); ++k) {
+        const RegionClassification& result = results[k];
+        ConsolidatedRegion& region = regions[pendingRegions[k]];
+        if (result.classId >= 0) {
+            region.classLabel = result.label;
+            region.classConfidence = result.confidence;
+            region.classId = result.classId;
+        }
+        for (int id : region.trackedObjectIds) {
+            auto row = rows.find(id);
+            const cv::Rect box = row != rows.end() ? objects.bounds(row->second) : region.boundingBox;
+            cache_.store(id, frame, box, result.label, result.confidence, result.classId);
+            TrackedObjectColdData& cold = objects.cold(id);
+            cold.classLabel = result.label;
+            cold.classConfidence = result.confidence;
+            cold.classId = result.classId;
+        }
+    }
+    return pending.size();
+}
+
+RegionClassification RegionClassifier::bestDetection(const cv::Mat& output, int item,
+                                                     const std::vector<std::string>& classNames,
+                                                     float confidenceThreshold, const cv::Rect& area) {
+    CV_Assert(output.dims == 3 && output.type() == CV_32F && item >= 0 && item < output.size[0]);
+    cv::Mat prediction(output.size[1], output.size[2], CV_32F, const_cast<float*>(output.ptr<float>(item)));
+    if (prediction.rows > prediction.cols) {
+        prediction = prediction.t();  // [anchors, 4 + classes] -> [4 + classes, anchors]
+    }
+    CV_Assert(prediction.rows > 4);
+
+    // Rows 0-3 are the box (cx, cy, w, h); the rest one score per class and anchor
+    const int anchors = prediction.cols;
+    const float* cx = prediction.ptr<float>(0);
+    const float* cy = prediction.ptr<float>(1);
+    std::vector<char> inArea;
+    if (!area.empty()) {
+        inArea.resize(anchors);
+        for (int a = 0; a < anchors; ++a) {
+            inArea[a] = cx[a] >= area.x && cx[a] < area.x + area.width && cy[a] >= area.y &&
+                        cy[a] < area.y + area.height;
+        }
+    }
+
+    RegionClassification best;
+    float bestScore = 0.0f;
+    int bestAnchor = -1;
+    for (int c = 0; c + 4 < prediction.rows; ++c) {
+        const float* scores = prediction.ptr<float>(c + 4);
+        for (int a = 0; a < anchors; ++a) {
+            if (scores[a] > bestScore && (inArea.empty() || inArea[a])) {
+                bestScore = scores[a];
+                best.classId = c;
+                bestAnchor = a;
+            }
+        }
+    }
+    if (best.classId < 0 || bestScore < confidenceThreshold) {
+        return RegionClassification();
+    }
+    best.confidence = bestScore;
+    best.label = static_cast<size_t>(best.classId) < classNames.size() ? classNames[best.classId]
+                                                                       : "class_" + std::to_string(best.classId);
+    const float width = prediction.at<float>(2, bestAnchor);
+    const float height = prediction.at<float>(3, bestAnchor);
+    best.box = cv::Rect2f(cx[bestAnchor] - width / 2, cy[bestAnchor] - height / 2, width, height);
+    return best;
+}
+
+void RegionClassifier::letterbox(const cv::Mat& crop, int size, cv::Mat& canvas) {
+    RegionMosaicConfig config;
+    config.tileSize = size;
+    config.sizeTolerancePercent = 100.0;  // Every crop owns a tile
+    const RegionMosaicPacker packer(config);
+    const std::vector<MosaicTile> tiles = packer.pack({crop.size()});
+    packer.render({crop}, tiles.empty() ? MosaicTile() : tiles.front(), canvas);
+}
+
+const std::vector<std::string>& RegionClassifier::cocoClassNames() {
+    static const std::vector<std::string> names = {
+        "person",        "bicycle",      "car",           "motorcycle",    "airplane",     "bus",
+        "train",         "truck",        "boat",          "traffic light", "fire hydrant", "stop sign",
+        "parking meter", "bench",        "bird",          "cat",           "dog",          "horse",
+        "sheep",         "cow",          "elephant",      "bear",          "zebra",        "giraffe",
+        "backpack",      "umbrella",     "handbag",       "tie",           "suitcase",     "frisbee",
+        "skis",          "snowboard",    "sports ball",   "kite",          "baseball bat", "baseball glove",
+        "skateboard",    "surfboard",    "tennis racket", "bottle",        "wine glass",   "cup",
+        "fork",          "knife",        "spoon",         "bowl",          "banana",       "apple",
+        "sandwich",      "orange",       "broccoli",      "carrot",        "hot dog",      "pizza",
+        "donut",         "cake",         "chair",         "couch",         "potted plant", "bed",
+        "dining table",  "toilet",       "tv",            "laptop",        "mouse",        "remote",
+        "keyboard",      "cell phone",   "microwave",     "oven",          "toaster",      "sink",
+        "refrigerator",  "book",         "clock",         "vase",          "scissors",     "teddy bear",
+        "hair drier",    "toothbrush"};
+    return names;
+}
@@ -0,0 +1,192 @@
+#include "region_flow_propagator.hpp"
+
+#include <algorithm>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+
+#include "logger.hpp"
+
+namespace {
+
+// Grayscale copy of @p image into @p gray (reuses its buffer when the size matches)
+void toGray(const cv::Mat& image, cv::Mat& gray) {
+    switch (image.channels()) {
+        case 3:
+            cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+            break;
+        case 4:
+            cv::cvtColor(image, gray, cv::COLOR_BGRA2GRAY);
+            break;
+        default:
+            image.copyTo(gray);
+            break;
+    }
+}
+
+// Median of @p values (reordered)
+float median(std::vector<float>& values) {
+    const auto middle = values.begin() + static_cast<std::ptrdiff_t>(values.size() / 2);
+    std::nth_element(values.begin(), middle, values.end());
+    return *middle;
+}
+
+}  // namespace
+
+RegionFlowPropagator::RegionFlowPropagator(const FlowPropagationConfig& config) { updateConfig(config); }
+
+void RegionFlowPropagator::updateConfig(const FlowPropagationConfig& config) {
+    config_ = config;
+    config_.detectEveryFrames = std::max(1, config_.detectEveryFrames);
+    config_.maxFeaturesPerBox = std::max(1, config_.maxFeaturesPerBox);
+    config_.windowSize = std::max(3, config_.windowSize | 1);
+    config_.pyramidLevels = std::clamp(config_.pyramidLevels, 0, 5);
+    // calcOpticalFlowPyrLK follows a point up to about half a window per level, doubling per level
+    margin_ = (config_.windowSize / 2 + 1) << config_.pyramidLevels;
+}
+
+bool RegionFlowPropagator::detectionDue() const {
+    return !seeded_ || framesSinceDetection_ + 1 >= config_.detectEveryFrames;
+}
+
+void RegionFlowPropagator::seed(const cv::Mat& frame, const std::vector<cv::Rect>& boxes) {
+    tracks_.resize(boxes.size());
+    for (size_t i = 0; i < boxes.size(); ++i) seedTrack(frame, boxes[i], tracks_[i]);
+    confidences_.assign(boxes.size(), 1.0f);
+    shifts_.assign(boxes.size(), cv::Point());
+    seeded_ = true;
+    framesSinceDetection_ = 0;
+    ++stats_.detectionFrames;
+}
+
+void RegionFlowPropagator::seedTrack(const cv::Mat& frame, const cv::Rect& box, Track& track) const {
+    track.box = box & cv::Rect(0, 0, frame.cols, frame.rows);
+    track.points.clear();
+    if (track.box.empty()) {
+        track.patch.release();
+        return;
+    }
+    capturePatch(frame, track);
+    findCorners(track);
+}
+
+void RegionFlowPropagator::capturePatch(const cv::Mat& frame, Track& track) const {
+    const cv::Rect searchArea(track.box.x - margin_, track.box.y - margin_, track.box.width + 2 * margin_,
+                              track.box.height + 2 * margin_);
+    track.patchRect = searchArea & cv::Rect(0, 0, frame.cols, frame.rows);
+    toGray(frame(track.patchRect), track.patch);
+}
+
+void RegionFlowPropagator::findCorners(Track& track) const {
+    const cv::Rect boxInPatch = (track.box - track.patchRect.tl()) & cv::Rect(cv::Point(), track.patch.size());
+    if (boxInPatch.empty()) return;
+    const int wanted = config_.maxFeaturesPerBox - static_cast<int>(track.points.size());
+    if (wanted <= 0) return;
+    std::vector<cv::Point2f> corners;
+    const double minDistance = std::max(2, std::min(boxInPatch.width, boxInPatch.height) / 8);
+    cv::goodFeaturesToTrack(track.patch(boxInPatch), corners, wanted, 0.01, minDistance);
+    const cv::Point2f offset(static_cast<float>(track.box.x), static_cast<float>(track.box.y));
+    if (corners.empty()) {
+        // Featureless box: a 3x3 grid still moves with the edges LK can lock onto
+        for (int gy = 1; gy <= 3; ++gy) {
+            for (int gx = 1; gx <= 3; ++gx) {
+                corners.emplace_back(boxInPatch.width * gx / 4.0f, boxInPatch.height * gy / 4.0f);
+            }
+        }
+    }
+    for (const cv::Point2f& corner : corners) track.points.push_back(corner + offset);
+}
+
+bool RegionFlowPropagator::propagate(const cv::Mat& frame, std::vector<cv::Rect>& boxes) {
+    boxes.clear();
+    if (!seeded_) return false;
+    const cv::Rect frameRect(0, 0, frame.cols, frame.rows);
+    const cv::Size window(config_.windowSize, config_.windowSize);
+    const auto maxError = static_cast<float>(config_.maxForwardBackwardError);
+    bool lost = false;
+
+    for (size_t i = 0; i < tracks_.size() && !lost; ++i) {
+        Track& track = tracks_[i];
+        // A track without points, or a resolution change, cannot be followed
+        if (track.points.empty() || (track.patchRect & frameRect) != track.patchRect) {
+            lost = true;
+            break;
+        }
+        toGray(frame(track.patchRect), nextPatch_);
+        const cv::Point2f origin(static_cast<float>(track.patchRect.x), static_cast<float>(track.patchRect.y));
+        startPoints_.clear();
+        for (const cv::Point2f& point : track.points) startPoints_.push_back(point - origin);
+
+        cv::calcOpticalFlowPyrLK(track.patch, nextPatch_, startPoints_, movedPoints_, status_, errors_, window,
+                                 config_.pyramidLevels);
+        cv::calcOpticalFlowPyrLK(nextPatch_, track.patch, movedPoints_, returnedPoints_, backStatus_, errors_,
+                                 window, config_.pyramidLevels);
+
+        // Keep the points tracked both ways that land back on their start
+        const cv::Rect2f patchArea(0.0f, 0.0f, static_cast<float>(nextPatch_.cols),
+                                   static_cast<float>(nextPatch_.rows));
+        dx_.clear();
+        dy_.clear();
+        size_t kept = 0;
+        for (size_t p = 0; p < startPoints_.size(); ++p) {
+            if (!status_[p] || !backStatus_[p] || !patchArea.contains(movedPoints_[p])) continue;
+            const cv::Point2f drift = returnedPoints_[p] - startPoints_[p];
+            if (drift.x * drift.x + drift.y * drift.y > maxError * maxError) continue;
+            dx_.push_back(movedPoints_[p].x - startPoints_[p].x);
+            dy_.push_back(movedPoints_[p].y - startPoints_[p].y);
+            track.points[kept++] = movedPoints_[p] + origin;
+        }
+        track.points.resize(kept);
+        confidences_[i] = static_cast<float>(kept) / static_cast<float>(startPoints_.size());
+        if (kept == 0 || confidences_[i] < config_.minTrackedFraction) {
+            lost = true;
+            break;
+        }
+
+        shifts_[i] = cv::Point(cvRound(median(dx_)), cvRound(median(dy_)));
+        track.box += shifts_[i];
+        track.box &= frameRect;
+        if (track.box.empty()) {
+            lost = true;
+            break;
+        }
+        const cv::Rect previousPatch = track.patchRect;
+        const cv::Rect searchArea(track.box.x - margin_, track.box.y - margin_, track.box.width + 2 * margin_,
+                                  track.box.height + 2 * margin_);
+        if ((searchArea & frameRect) == previousPatch) {
+            std::swap(track.patch, nextPatch_);  // Already converted
+        } else {
+            capturePatch(frame, track);
+        }
+        if (track.points.size() * 2 < static_cast<size_t>(config_.maxFeaturesPerBox)) findCorners(track);
+        boxes.push_back(track.box);
+    }
+
+    if (lost) {
+        ++stats_.confidenceDrops;
+        seeded_ = false;
+        LOG_DEBUG_LIMITED("Flow propagation lost a box after {} frames; detecting again", framesSinceDetection_);
+        return false;
+    }
+    ++framesSinceDetection_;
+    ++stats_.propagatedFrames;
+    return true;
+}
+
+void RegionFlowPropagator::moveRegions(const TrackedObjectStore& objects, const std::vector<cv::Point>& shifts,
+                                       std::vector<ConsolidatedRegion>& regions) {
+    const std::vector<int>& ids = objects.ids();
+    const size_t rows = std::min(ids.size(), shifts.size());
+    for (ConsolidatedRegion& region : regions) {
+        cv::Point total;
+        int members = 0;
+        for (int id : region.trackedObjectIds) {
+            const auto it = std::find(ids.begin(), ids.begin() + static_cast<std::ptrdiff_t>(rows), id);
+            if (it == ids.begin() + static_cast<std::ptrdiff_t>(rows)) continue;
+            total += shifts[static_cast<size_t>(it - ids.begin())];
+            ++members;
+        }
+        // The mean shift keeps the consolidator's padding around the objects
+        if (members > 0) region.boundingBox += cv::Point(cvRound(static_cast<double>(total.x) / members),
+                                                         cvRound(static_cast<double>(total.y) / members));
+    }
+}
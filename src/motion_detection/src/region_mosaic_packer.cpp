@@ -0,0 +1,102 @@
+#include "region_mosaic_packer.hpp"
+
+#include <algorithm>
+#include <opencv2/imgproc.hpp>
+#include <utility>
+
+RegionMosaicPacker::RegionMosaicPacker(const RegionMosaicConfig& config) : config_(config) {
+    config_.tileSize = std::max(32, config_.tileSize);
+    config_.sizeTolerancePercent = std::clamp(config_.sizeTolerancePercent, 0.0, 100.0);
+    config_.spacing = std::max(0, config_.spacing);
+}
+
+bool RegionMosaicPacker::ownsTile(const cv::Size& size) const {
+    const double threshold = config_.tileSize * (1.0 - config_.sizeTolerancePercent / 100.0);
+    return std::max(size.width, size.height) >= threshold;
+}
+
+/**
+ * Large crops come first, one tile each. The small ones are sorted tallest first and placed
+ * on the first shelf (a row of the tile as tall as its first crop) with room left; a crop
+ * that fits no shelf opens a new shelf below the others, or a new tile.
+ */
+std::vector<MosaicTile> RegionMosaicPacker::pack(const std::vector<cv::Size>& sizes) const {
+    const int side = config_.tileSize;
+    std::vector<MosaicTile> tiles;
+    std::vector<size_t> small;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        const cv::Size& size = sizes[i];
+        if (size.width <= 0 || size.height <= 0) continue;
+        if (!ownsTile(size)) {
+            small.push_back(i);
+            continue;
+        }
+        const double scale = static_cast<double>(side) / std::max(size.width, size.height);
+        const cv::Size scaled(std::clamp(static_cast<int>(size.width * scale), 1, side),
+                              std::clamp(static_cast<int>(size.height * scale), 1, side));
+        MosaicTile tile;
+        tile.placements.push_back(
+            {i, cv::Rect(cv::Point((side - scaled.width) / 2, (side - scaled.height) / 2), scaled), scale});
+        tiles.push_back(std::move(tile));
+    }
+
+    std::stable_sort(small.begin(), small.end(), [&sizes](size_t a, size_t b) {
+        return sizes[a].height > sizes[b].height;
+    });
+    struct Shelf {
+        size_t tile;
+        int y;
+        int height;
+        int x;  // Next free column
+    };
+    std::vector<Shelf> shelves;
+    std::vector<std::pair<size_t, int>> mosaics;  // (tile, next free row)
+    for (size_t i : small) {
+        const cv::Size& size = sizes[i];
+        size_t shelf = 0;
+        while (shelf < shelves.size() &&
+               (size.height > shelves[shelf].height || shelves[shelf].x + size.width > side)) {
+            ++shelf;
+        }
+        if (shelf == shelves.size()) {
+            auto mosaic = std::find_if(mosaics.begin(), mosaics.end(),
+                                       [&](const auto& m) { return m.second + size.height <= side; });
+            if (mosaic == mosaics.end()) {
+                tiles.emplace_back();
+                mosaics.emplace_back(tiles.size() - 1, 0);
+                mosaic = mosaics.end() - 1;
+            }
+            shelves.push_back({mosaic->first, mosaic->second, size.height, 0});
+            mosaic->second += size.height + config_.spacing;
+        }
+        Shelf& target = shelves[shelf];
+        tiles[target.tile].placements.push_back({i, cv::Rect(cv::Point(target.x, target.y), size), 1.0});
+        target.x += size.width + config_.spacing;
+    }
+    return tiles;
+}
+
+void RegionMosaicPacker::render(const std::vector<cv::Mat>& crops, const MosaicTile& tile, cv::Mat& canvas) const {
+    canvas.create(config_.tileSize, config_.tileSize, CV_8UC3);
+    canvas.setTo(cv::Scalar::all(114));  // YOLO's letterbox gray
+    for (const MosaicPlacement& placement : tile.placements) {
+        const cv::Mat& crop = crops[placement.item];
+        if (crop.empty()) continue;
+        cv::Mat target = canvas(placement.target);
+        if (crop.channels() == 1) {
+            cv::Mat resized;
+            cv::resize(crop, resized, placement.target.size(), 0, 0, cv::INTER_LINEAR);
+            cv::cvtColor(resized, target, cv::COLOR_GRAY2BGR);  // Luma capture
+        } else if (crop.size() == placement.target.size()) {
+            crop.copyTo(target);
+        } else {
+            cv::resize(crop, target, placement.target.size(), 0, 0, cv::INTER_LINEAR);
+        }
+    }
+}
+
+cv::Rect2f RegionMosaicPacker::toSource(const MosaicPlacement& placement, const cv::Rect2f& tileBox) {
+    const float scale = static_cast<float>(placement.scale);
+    return cv::Rect2f((tileBox.x - placement.target.x) / scale, (tileBox.y - placement.target.y) / scale,
+                      tileBox.width / scale, tileBox.height / scale);
+}
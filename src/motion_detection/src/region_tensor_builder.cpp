@@ -0,0 +1,137 @@
+#include "region_tensor_builder.hpp"
+
+#include <algorithm>
+
+#include "logger.hpp"
+
+namespace {
+
+// One work item per tile pixel (x, y) of batch item z. Sampling follows cv::resize's
+// INTER_LINEAR pixel-center convention, so a crop at native scale is copied exactly.
+const char* const kRegionTensorSource = R"CLC(
+__kernel void region_tensor(__global const uchar* frame, int frameStep, int frameOffset,
+                            __global const int* placements, __global const int* itemStart,
+                            __global float* tensor, int size, int channels) {
+    const int x = get_global_id(0);
+    const int y = get_global_id(1);
+    const int item = get_global_id(2);
+    if (x >= size || y >= size) return;
+
+    float r = 114.0f, g = 114.0f, b = 114.0f;
+    for (int p = itemStart[item]; p < itemStart[item + 1]; ++p) {
+        __global const int* q = placements + 8 * p;
+        const int tx = q[4], ty = q[5], tw = q[6], th = q[7];
+        if (x < tx || y < ty || x >= tx + tw || y >= ty + th) continue;
+
+        const int sw = q[2], sh = q[3];
+        const float fx = clamp((x - tx + 0.5f) * sw / (float)tw - 0.5f, 0.0f, (float)(sw - 1));
+        const float fy = clamp((y - ty + 0.5f) * sh / (float)th - 0.5f, 0.0f, (float)(sh - 1));
+        const int x0 = (int)fx, y0 = (int)fy;
+        const int x1 = min(x0 + 1, sw - 1), y1 = min(y0 + 1, sh - 1);
+        const float ax = fx - x0, ay = fy - y0;
+        __global const uchar* row0 = frame + frameOffset + (q[1] + y0) * frameStep + q[0] * channels;
+        __global const uchar* row1 = frame + frameOffset + (q[1] + y1) * frameStep + q[0] * channels;
+        float value[3];
+        for (int c = 0; c < channels && c < 3; ++c) {
+            const float top = mix((float)row0[x0 * channels + c], (float)row0[x1 * channels + c], ax);
+            const float bottom = mix((float)row1[x0 * channels + c], (float)row1[x1 * channels + c], ax);
+            value[c] = mix(top, bottom, ay);
+        }
+        if (channels >= 3) {
+            b = value[0];
+            g = value[1];
+            r = value[2];
+        } else {
+            r = g = b = value[0];
+        }
+        break;  // Placements of a tile never overlap
+    }
+
+    const int plane = size * size;
+    __global float* out = tensor + item * 3 * plane + y * size + x;
+    out[0] = r / 255.0f;
+    out[plane] = g / 255.0f;
+    out[2 * plane] = b / 255.0f;
+}
+)CLC";
+
+}  // namespace
+
+RegionTensorBuilder::RegionTensorBuilder(int maxBatch, int inputSize)
+    : maxBatch_(std::max(1, maxBatch)), inputSize_(std::max(1, inputSize)) {
+    if (!cv::ocl::haveOpenCL()) {
+        LOG_WARN("Region classifier: no OpenCL device; preprocessing stays on the host");
+        return;
+    }
+    cv::String errors;
+    const cv::ocl::ProgramSource source(kRegionTensorSource);
+    if (!kernel_.create("region_tensor", source, "", &errors)) {
+        LOG_WARN("Region classifier: preprocessing kernel did not compile ({}); staying on the host", errors);
+        return;
+    }
+    const int sizes[] = {maxBatch_, 3, inputSize_, inputSize_};
+    tensor_.create(4, sizes, CV_32F);
+    LOG_INFO("Region classifier: preprocessing on OpenCL device {}", cv::ocl::Device::getDefault().name());
+}
+
+bool RegionTensorBuilder::build(const cv::Mat& frame, const std::vector<TensorPlacement>& placements, int items) {
+    if (kernel_.empty() || frame.empty() || frame.depth() != CV_8U || items <= 0 || items > maxBatch_) return false;
+    if (frame.channels() != 1 && frame.channels() != 3) return false;
+
+    // Upload only the frame area the batch's crops span
+    cv::Rect area;
+    for (const TensorPlacement& placement : placements) {
+        if (placement.item < 0 || placement.item >= items || placement.source.empty()) continue;
+        area = area.empty() ? placement.source : (area | placement.source);
+    }
+    area &= cv::Rect(0, 0, frame.cols, frame.rows);
+
+    // Placements grouped by item (counting sort), sources relative to the uploaded area
+    itemStartData_.assign(items + 1, 0);
+    for (const TensorPlacement& placement : placements) {
+        if (placement.item >= 0 && placement.item < items && !(placement.source & area).empty()) {
+            ++itemStartData_[placement.item + 1];
+        }
+    }
+    for (int i = 0; i < items; ++i) itemStartData_[i + 1] += itemStartData_[i];
+    placementData_.assign(8 * std::max(1, itemStartData_[items]), 0);
+    std::vector<int> next(itemStartData_.begin(), itemStartData_.end() - 1);
+    for (const TensorPlacement& placement : placements) {
+        if (placement.item < 0 || placement.item >= items) continue;
+        const cv::Rect source = placement.source & area;
+        if (source.empty()) continue;
+        int* q = &placementData_[8 * next[placement.item]++];
+        q[0] = source.x - area.x;
+        q[1] = source.y - area.y;
+        q[2] = source.width;
+        q[3] = source.height;
+        q[4] = placement.target.x;
+        q[5] = placement.target.y;
+        q[6] = placement.target.width;
+        q[7] = placement.target.height;
+    }
+
+    try {
+        if (!area.empty()) frame(area).copyTo(frame_);
+        if (frame_.empty()) frame_.create(1, 1, frame.type());  // A batch of empty tiles still needs an argument
+        cv::Mat(placementData_).copyTo(placements_);
+        cv::Mat(itemStartData_).copyTo(itemStart_);
+        kernel_.args(cv::ocl::KernelArg::ReadOnlyNoSize(frame_), cv::ocl::KernelArg::PtrReadOnly(placements_),
+                     cv::ocl::KernelArg::PtrReadOnly(itemStart_), cv::ocl::KernelArg::PtrWriteOnly(tensor_),
+                     inputSize_, frame.channels());
+        size_t globalSize[] = {static_cast<size_t>(inputSize_), static_cast<size_t>(inputSize_),
+                               static_cast<size_t>(items)};
+        if (!kernel_.run(3, globalSize, nullptr, false)) return false;
+    } catch (const cv::Exception& e) {
+        LOG_DEBUG_LIMITED("Region tensor kernel failed: {}", e.what());
+        return false;
+    }
+    launches_++;
+    return true;
+}
+
+cv::UMat RegionTensorBuilder::tensor(int items) const {
+    const std::vector<cv::Range> ranges = {cv::Range(0, std::clamp(items, 1, maxBatch_)), cv::Range::all(),
+                                           cv::Range::all(), cv::Range::all()};
+    return tensor_(ranges);
+}
@@ -0,0 +1,249 @@
+#include "replay_frame_source.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/videoio.hpp>
+#include <stdexcept>
+#include <utility>
+
+#include "logger.hpp"
+
+ReplayFrameSource ReplayFrameSource::fromVideo(const std::string& path, int maxFrames) {
+    cv::VideoCapture capture(path);
+    if (!capture.isOpened()) {
+        throw std::runtime_error("Cannot open video: " + path);
+    }
+
+    ReplayFrameSource source;
+    cv::Mat frame;
+    while ((maxFrames < 0 || static_cast<int>(source.decoded_.size()) < maxFrames) && capture.read(frame) &&
+           !frame.empty()) {
+        if (source.decoded_.empty()) {
+            source.frameSize_ = frame.size();
+            source.frameType_ = frame.type();
+        } else if (frame.size() != source.frameSize_ || frame.type() != source.frameType_) {
+            throw std::runtime_error("Video changes resolution mid-stream: " + path);
+        }
+        source.decoded_.push_back(frame.clone());  // read() reuses its buffer
+    }
+    source.frameCount_ = source.decoded_.size();
+    if (source.empty()) {
+        throw std::runtime_error("Video has no frames: " + path);
+    }
+    LOG_INFO("Decoded {} frames ({}x{}) from {} into {} MB", source.size(), source.frameSize_.width,
+             source.frameSize_.height, path, source.byteSize() >> 20);
+    return source;
+}
+
+ReplayFrameSource ReplayFrameSource::fromImages(const std::vector<std::string>& paths) {
+    ReplayFrameSource source;
+    for (const std::string& path : paths) {
+        cv::Mat image = cv::imread(path, cv::IMREAD_COLOR);
+        if (image.empty()) {
+            throw std::runtime_error("Cannot read image: " + path);
+        }
+        if (!source.decoded_.empty() && (image.size() != source.frameSize_ || image.type() != source.frameType_)) {
+            throw std::runtime_error("Image differs in size from the first one: " + path);
+        }
+        source.frameSize_ = image.size();
+        source.frameType_ = image.type();
+        source.decoded_.push_back(std::move(image));
+    }
+    source.frameCount_ = source.decoded_.size();
+    if (source.empty()) {
+        throw std::runtime_error("No images given");
+    }
+    LOG_INFO("Decoded {} images ({}x{}) into {} MB", source.size(), source.frameSize_.width,
+             source.frameSize_.height, source.byteSize() >> 20);
+    return source;
+}
+
+ReplayFrameSource ReplayFrameSource::fromRawDump(const std::string& path, const cv::Size& frameSize, int type) {
+    if (type != CV_8UC3 && type != CV_8UC1) {
+        throw std::runtime_error("Raw dumps hold CV_8UC3 or CV_8UC1 frames");
+    }
+    const size_t frameBytes = static_cast<size_t>(frameSize.area()) * CV_ELEM_SIZE(type);
+    if (frameBytes == 0) {
+        throw std::runtime_error("Raw dump frame size must be positive");
+    }
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open raw dump " + path + ": " + std::strerror(errno));
+    }
+    struct stat info {};
+    if (::fstat(fd, &info) != 0 || info.st_size <= 0 || static_cast<size_t>(info.st_size) % frameBytes != 0) {
+        ::close(fd);
+        throw std::runtime_error("Raw dump " + path + " is not a whole number of " + std::to_string(frameSize.width) +
+                                 "x" + std::to_string(frameSize.height) + " frames");
+    }
+    const auto fileBytes = static_cast<size_t>(info.st_size);
+    void* mapping = ::mmap(nullptr, fileBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // The mapping keeps the file referenced
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Cannot map raw dump " + path + ": " + std::strerror(errno));
+    }
+    ::madvise(mapping, fileBytes, MADV_SEQUENTIAL);
+
+    ReplayFrameSource source;
+    source.mapping_ = mapping;
+    source.mappingBytes_ = fileBytes;
+    source.frameCount_ = fileBytes / frameBytes;
+    source.frameStride_ = frameBytes;
+    source.frameSize_ = frameSize;
+    source.frameType_ = type;
+    LOG_INFO("Mapped {} raw frames ({}x{}) from {}", source.size(), frameSize.width, frameSize.height, path);
+    return source;
+}
+
+void ReplayFrameSource::writeRawDump(const std::string& path, const std::vector<cv::Mat>& frames) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Cannot write raw dump: " + path);
+    }
+    for (const auto& frame : frames) {
+        if (frame.size() != frames.front().size() || frame.type() != frames.front().type()) {
+            throw std::runtime_error("Raw dump frames must share one size and type");
+        }
+        const cv::Mat continuous = frame.isContinuous() ? frame : frame.clone();
+        out.write(reinterpret_cast<const char*>(continuous.data),
+                  static_cast<std::streamsize>(continuous.total() * continuous.elemSize()));
+    }
+    if (!out) {
+        throw std::runtime_error("Failed writing raw dump: " + path);
+    }
+}
+
+ReplayFrameSource ReplayFrameSource::fromFrameCache(const std::string& path) {
+    using namespace frame_cache_layout;
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open frame cache " + path + ": " + std::strerror(errno));
+    }
+    struct stat info {};
+    Header header{};
+    if (::fstat(fd, &info) != 0 || ::pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+        header.magic != kMagic || header.version != kVersion) {
+        ::close(fd);
+        throw std::runtime_error(path + " is not a version " + std::to_string(kVersion) + " frame cache");
+    }
+    const int type = header.type;
+    const cv::Size frameSize(header.width, header.height);
+    const auto fileBytes = static_cast<size_t>(info.st_size);
+    if ((type != CV_8UC3 && type != CV_8UC1) || frameSize.area() <= 0 || header.frameCount == 0 ||
+        header.frameBytes != static_cast<uint64_t>(frameSize.area()) * CV_ELEM_SIZE(type) ||
+        header.frameStride < header.frameBytes || header.dataOffset < sizeof(header) ||
+        header.dataOffset + (header.frameCount - 1) * header.frameStride + header.frameBytes > fileBytes) {
+        ::close(fd);
+        throw std::runtime_error("Frame cache " + path + " is truncated or has an invalid header");
+    }
+    void* mapping = ::mmap(nullptr, fileBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // The mapping keeps the file referenced
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Cannot map frame cache " + path + ": " + std::strerror(errno));
+    }
+    ::madvise(mapping, fileBytes, MADV_SEQUENTIAL);
+
+    ReplayFrameSource source;
+    source.mapping_ = mapping;
+    source.mappingBytes_ = fileBytes;
+    source.firstFrameOffset_ = header.dataOffset;
+    source.frameStride_ = header.frameStride;
+    source.frameCount_ = header.frameCount;
+    source.frameSize_ = frameSize;
+    source.frameType_ = type;
+    LOG_INFO("Mapped {} cached frames ({}x{}) from {}", source.size(), frameSize.width, frameSize.height, path);
+    return source;
+}
+
+void ReplayFrameSource::writeFrameCache(const std::string& path, const std::vector<cv::Mat>& frames) {
+    using namespace frame_cache_layout;
+    if (frames.empty()) {
+        throw std::runtime_error("No frames to cache");
+    }
+    const cv::Mat& first = frames.front();
+    if (first.type() != CV_8UC3 && first.type() != CV_8UC1) {
+        throw std::runtime_error("Frame caches hold CV_8UC3 or CV_8UC1 frames");
+    }
+    Header header{};
+    header.magic = kMagic;
+    header.version = kVersion;
+    header.width = first.cols;
+    header.height = first.rows;
+    header.type = first.type();
+    header.frameCount = frames.size();
+    header.frameBytes = first.total() * first.elemSize();
+    header.frameStride = (header.frameBytes + kPageBytes - 1) / kPageBytes * kPageBytes;
+    header.dataOffset = kPageBytes;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Cannot write frame cache: " + path);
+    }
+    const std::string padding(kPageBytes, '\0');
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(padding.data(), static_cast<std::streamsize>(kPageBytes - sizeof(header)));
+    for (const auto& frame : frames) {
+        if (frame.size() != first.size() || frame.type() != first.type()) {
+            throw std::runtime_error("Frame cache frames must share one size and type");
+        }
+        const cv::Mat continuous = frame.isContinuous() ? frame : frame.clone();
+        out.write(reinterpret_cast<const char*>(continuous.data), static_cast<std::streamsize>(header.frameBytes));
+        out.write(padding.data(), static_cast<std::streamsize>(header.frameStride - header.frameBytes));
+    }
+    if (!out) {
+        throw std::runtime_error("Failed writing frame cache: " + path);
+    }
+}
+
+bool ReplayFrameSource::isFrameCache(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    uint32_t magic = 0;
+    return in.read(reinterpret_cast<char*>(&magic), sizeof(magic)) && magic == frame_cache_layout::kMagic;
+}
+
+ReplayFrameSource::ReplayFrameSource(ReplayFrameSource&& other) noexcept { *this = std::move(other); }
+
+ReplayFrameSource& ReplayFrameSource::operator=(ReplayFrameSource&& other) noexcept {
+    if (this != &other) {
+        unmap();
+        decoded_ = std::move(other.decoded_);
+        mapping_ = std::exchange(other.mapping_, nullptr);
+        mappingBytes_ = std::exchange(other.mappingBytes_, 0);
+        firstFrameOffset_ = std::exchange(other.firstFrameOffset_, 0);
+        frameStride_ = std::exchange(other.frameStride_, 0);
+        frameCount_ = std::exchange(other.frameCount_, 0);
+        frameSize_ = other.frameSize_;
+        frameType_ = other.frameType_;
+    }
+    return *this;
+}
+
+ReplayFrameSource::~ReplayFrameSource() { unmap(); }
+
+void ReplayFrameSource::unmap() {
+    if (mapping_) {
+        ::munmap(mapping_, mappingBytes_);
+        mapping_ = nullptr;
+        mappingBytes_ = 0;
+    }
+}
+
+size_t ReplayFrameSource::byteSize() const {
+    return mapping_ ? mappingBytes_
+                    : frameCount_ * static_cast<size_t>(frameSize_.area()) * CV_ELEM_SIZE(frameType_);
+}
+
+cv::Mat ReplayFrameSource::frame(size_t index) const {
+    if (!mapping_) return decoded_[index];
+    // PROT_READ mapping: the header must never be written through
+    return cv::Mat(frameSize_, frameType_,
+                   static_cast<unsigned char*>(mapping_) + firstFrameOffset_ + index * frameStride_);
+}
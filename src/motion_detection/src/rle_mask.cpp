@@ -0,0 +1,177 @@
+#include "rle_mask.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Longest length the codec reads: 12 groups of 5 bits
+constexpr int kMaxCodeGroups = 12;
+
+}  // namespace
+
+void RleMask::assign(const cv::Mat& mask) {
+    CV_Assert(mask.type() == CV_8UC1);
+    runs_.clear();
+    size_ = mask.size();
+    frameArea_ = cv::Rect();
+    for (int y = 0; y < mask.rows; ++y) {
+        const uchar* row = mask.ptr<uchar>(y);
+        int x = 0;
+        while (x < mask.cols) {
+            // Skip unset pixels 8 at a time; motion masks are mostly empty
+            uint64_t word;
+            while (x + 8 <= mask.cols && (std::memcpy(&word, row + x, 8), word == 0)) x += 8;
+            while (x < mask.cols && row[x] == 0) ++x;
+            if (x == mask.cols) break;
+            const int begin = x;
+            while (x < mask.cols && row[x] != 0) ++x;
+            runs_.push_back({y, begin, x});
+        }
+    }
+}
+
+void RleMask::assign(const PackedMask& mask) {
+    runs_.clear();
+    size_ = mask.size();
+    frameArea_ = cv::Rect();
+    for (int y = 0; y < mask.rows(); ++y) appendMaskRuns(mask, y, runs_);
+}
+
+void RleMask::assign(cv::Size size, const std::vector<MaskRun>& runs) {
+    size_ = size;
+    frameArea_ = cv::Rect();
+    runs_.assign(runs.begin(), runs.end());
+}
+
+void RleMask::clear() {
+    size_ = cv::Size();
+    frameArea_ = cv::Rect();
+    runs_.clear();
+}
+
+cv::Rect RleMask::toFrame(const cv::Rect& rect) const {
+    if (frameArea_.empty()) return rect;
+    if (frameArea_.size() == size_) return rect + frameArea_.tl();
+    const double scaleX = static_cast<double>(frameArea_.width) / size_.width;
+    const double scaleY = static_cast<double>(frameArea_.height) / size_.height;
+    const cv::Point topLeft(cvFloor(rect.x * scaleX), cvFloor(rect.y * scaleY));
+    const cv::Point bottomRight(cvCeil(rect.br().x * scaleX), cvCeil(rect.br().y * scaleY));
+    return (cv::Rect(topLeft, bottomRight) & cv::Rect(cv::Point(), frameArea_.size())) + frameArea_.tl();
+}
+
+cv::Point2d RleMask::toFrame(const cv::Point2d& point) const {
+    if (frameArea_.empty()) return point;
+    return cv::Point2d(frameArea_.x + point.x * frameArea_.width / size_.width,
+                       frameArea_.y + point.y * frameArea_.height / size_.height);
+}
+
+RleMask::Stats RleMask::stats() const {
+    Stats stats;
+    double sumX = 0.0;
+    double sumY = 0.0;
+    for (const MaskRun& run : runs_) {
+        const int length = run.end - run.begin;
+        stats.area += length;
+        sumX += 0.5 * length * (run.begin + run.end);  // Sum of x + 0.5 over the run
+        sumY += length * (run.row + 0.5);
+        stats.bounds |= cv::Rect(run.begin, run.row, length, 1);
+    }
+    if (stats.area > 0) stats.centroid = cv::Point2d(sumX / stats.area, sumY / stats.area);
+    return stats;
+}
+
+void RleMask::unpack(cv::Mat& mask, uchar value) const {
+    mask.create(size_, CV_8UC1);
+    mask.setTo(0);
+    for (const MaskRun& run : runs_) {
+        uchar* row = mask.ptr<uchar>(run.row);
+        std::fill(row + run.begin, row + run.end, value);
+    }
+}
+
+std::string RleMask::encode() const {
+    // Alternating unset and set lengths over the raster; a run that ends a row and one that
+    // starts the next are one set length
+    std::vector<int64_t> counts;
+    const int64_t total = static_cast<int64_t>(size_.width) * size_.height;
+    int64_t position = 0;
+    for (const MaskRun& run : runs_) {
+        const int64_t begin = static_cast<int64_t>(run.row) * size_.width + run.begin;
+        const int64_t end = begin + (run.end - run.begin);
+        if (begin == position && !counts.empty()) {
+            counts.back() += end - begin;
+        } else {
+            counts.push_back(begin - position);
+            counts.push_back(end - begin);
+        }
+        position = end;
+    }
+    if (position < total || counts.empty()) counts.push_back(total - position);
+
+    std::string text;
+    text.reserve(counts.size() * 2);
+    for (size_t i = 0; i < counts.size(); ++i) {
+        int64_t value = counts[i];
+        if (i > 2) value -= counts[i - 2];
+        for (bool more = true; more;) {
+            int64_t group = value & 0x1f;
+            value >>= 5;
+            more = (group & 0x10) ? value != -1 : value != 0;
+            if (more) group |= 0x20;
+            text += static_cast<char>(group + 48);
+        }
+    }
+    return text;
+}
+
+bool RleMask::decode(cv::Size size, const std::string& counts) {
+    clear();
+    if (size.width <= 0 || size.height <= 0) return false;
+
+    std::vector<int64_t> lengths;
+    for (size_t p = 0; p < counts.size();) {
+        int64_t value = 0;
+        for (int group = 0;; ++group) {
+            const int code = p < counts.size() ? static_cast<unsigned char>(counts[p]) - 48 : -1;
+            if (code < 0 || code > 63 || group == kMaxCodeGroups) return false;
+            ++p;
+            value |= static_cast<int64_t>(code & 0x1f) << (5 * group);
+            if (code & 0x20) continue;
+            if (code & 0x10) value |= ~((int64_t(1) << (5 * (group + 1))) - 1);  // Negative: sign-extend
+            break;
+        }
+        if (lengths.size() > 2) value += lengths[lengths.size() - 2];
+        if (value < 0) return false;
+        lengths.push_back(value);
+    }
+
+    const int64_t total = static_cast<int64_t>(size.width) * size.height;
+    int64_t position = 0;
+    for (size_t i = 0; i < lengths.size(); ++i) {
+        int64_t left = lengths[i];
+        if (left > total - position) {
+            runs_.clear();
+            return false;
+        }
+        if ((i & 1) == 0) {
+            position += left;
+            continue;
+        }
+        // Set pixels, split at the row ends
+        while (left > 0) {
+            const int row = static_cast<int>(position / size.width);
+            const int column = static_cast<int>(position % size.width);
+            const int length = static_cast<int>(std::min<int64_t>(left, size.width - column));
+            runs_.push_back({row, column, column + length});
+            position += length;
+            left -= length;
+        }
+    }
+    if (position != total) {
+        runs_.clear();
+        return false;
+    }
+    size_ = size;
+    return true;
+}
@@ -0,0 +1,92 @@
+#include "save_deduplicator.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <opencv2/imgproc.hpp>
+
+namespace {
+
+double intersectionOverUnion(const cv::Rect& a, const cv::Rect& b) {
+    const double intersection = (a & b).area();
+    const double unionArea = a.area() + b.area() - intersection;
+    return unionArea > 0.0 ? intersection / unionArea : 0.0;
+}
+
+bool sharesTrackedObject(const RegionObjectIds& a, const RegionObjectIds& b) {
+    for (int id : a) {
+        if (std::find(b.begin(), b.end(), id) != b.end()) return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+SaveDeduplicator::SaveDeduplicator(const SaveDedupConfig& config) : config_(config) {}
+
+bool SaveDeduplicator::shouldSave(const cv::Mat& frame,
+                                  const std::vector<ConsolidatedRegion>& regions,
+                                  std::chrono::steady_clock::time_point now) {
+    if (!config_.enabled || regions.empty() || frame.empty()) return true;
+
+    const cv::Rect frameRect(0, 0, frame.cols, frame.rows);
+    std::vector<SavedRegion> current;
+    current.reserve(regions.size());
+    for (const auto& region : regions) {
+        SavedRegion entry;
+        entry.box = region.boundingBox & frameRect;
+        entry.trackedObjectIds = region.trackedObjectIds;
+        entry.hash = entry.box.empty() ? 0 : differenceHash(frame(entry.box));
+        entry.savedAt = now;
+        current.push_back(std::move(entry));
+    }
+
+    bool duplicate = !saved_.empty();
+    for (const auto& entry : current) {
+        if (!duplicate) break;
+        const SavedRegion* match = nullptr;
+        for (const auto& previous : saved_) {
+            if (sharesTrackedObject(entry.trackedObjectIds, previous.trackedObjectIds) ||
+                intersectionOverUnion(entry.box, previous.box) >= config_.minIou) {
+                match = &previous;
+                break;
+            }
+        }
+        duplicate = match && now - match->savedAt < config_.maxInterval &&
+                    intersectionOverUnion(entry.box, match->box) >= config_.minIou &&
+                    hammingDistance(entry.hash, match->hash) <= config_.maxHashDistance;
+    }
+
+    if (duplicate) {
+        skipped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    saved_ = std::move(current);
+    return true;
+}
+
+uint64_t SaveDeduplicator::differenceHash(const cv::Mat& image) {
+    cv::Mat gray;
+    if (image.channels() == 3) {
+        cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+    } else if (image.channels() == 4) {
+        cv::cvtColor(image, gray, cv::COLOR_BGRA2GRAY);
+    } else {
+        gray = image;
+    }
+    cv::Mat small;
+    cv::resize(gray, small, cv::Size(9, 8), 0, 0, cv::INTER_AREA);
+    if (small.depth() != CV_8U) small.convertTo(small, CV_8U);
+
+    uint64_t hash = 0;
+    for (int y = 0; y < 8; ++y) {
+        const uchar* row = small.ptr<uchar>(y);
+        for (int x = 0; x < 8; ++x) {
+            hash = (hash << 1) | (row[x] < row[x + 1] ? 1u : 0u);
+        }
+    }
+    return hash;
+}
+
+int SaveDeduplicator::hammingDistance(uint64_t a, uint64_t b) {
+    return static_cast<int>(std::bitset<64>(a ^ b).count());
+}
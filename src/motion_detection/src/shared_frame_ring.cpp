@@ -0,0 +1,215 @@
+#include "shared_frame_ring.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#include "logger.hpp"
+
+using namespace shared_frame_layout;
+
+SharedFrameRing::SharedFrameRing(const SharedFrameRingConfig& config) : config_(config) {
+    config_.slotCount = std::max<uint32_t>(1, config_.slotCount);
+    const uint64_t maxPixelBytes =
+        uint64_t{config_.maxWidth} * config_.maxHeight * std::max<uint32_t>(1, config_.maxChannels);
+    // Slots start on a cache line so headers of neighbouring slots never share one
+    const uint64_t slotBytes = (kSlotHeaderBytes + maxPixelBytes + 63) & ~uint64_t{63};
+    size_ = kHeaderBytes + slotBytes * config_.slotCount;
+
+    // A stale segment from a crashed run may have another size or layout; start over
+    shm_unlink(config_.name.c_str());
+    const int fd = shm_open(config_.name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        LOG_ERROR("Could not create shared frame ring {}: {}", config_.name, std::strerror(errno));
+        return;
+    }
+    if (ftruncate(fd, static_cast<off_t>(size_)) != 0) {
+        LOG_ERROR("Could not size shared frame ring {} to {} bytes: {}", config_.name, size_,
+                  std::strerror(errno));
+        close(fd);
+        shm_unlink(config_.name.c_str());
+        return;
+    }
+    struct stat info {};
+    if (fstat(fd, &info) == 0) inode_ = static_cast<uint64_t>(info.st_ino);
+    void* mapped = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        LOG_ERROR("Could not map shared frame ring {}: {}", config_.name, std::strerror(errno));
+        shm_unlink(config_.name.c_str());
+        return;
+    }
+    base_ = static_cast<unsigned char*>(mapped);
+
+    // ftruncate zero-fills, so every slot starts with sequence 0 (never written)
+    RingHeader* ring = new (base_) RingHeader();
+    ring->version = kVersion;
+    ring->slotCount = config_.slotCount;
+    ring->slotBytes = slotBytes;
+    ring->maxPixelBytes = maxPixelBytes;
+    ring->writerPid = static_cast<int64_t>(getpid());
+    ring->published.store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < config_.slotCount; ++i) new (slot(i)) SlotHeader();
+    // Readers check the magic last, so they never see a half-initialized header
+    std::atomic_thread_fence(std::memory_order_release);
+    ring->magic = kMagic;
+
+    LOG_INFO("Shared frame ring {}: {} slots of up to {}x{}x{} ({} MB)", config_.name,
+             config_.slotCount, config_.maxWidth, config_.maxHeight, config_.maxChannels,
+             size_ >> 20);
+}
+
+SharedFrameRing::~SharedFrameRing() {
+    if (!base_) return;
+    munmap(base_, size_);
+    // Readers that still have it mapped keep their view; new readers wait for the next writer.
+    // After a restart handoff the name already belongs to the successor's ring: leave it.
+    const int fd = shm_open(config_.name.c_str(), O_RDONLY, 0);
+    struct stat info {};
+    const bool ours = fd >= 0 && fstat(fd, &info) == 0 && static_cast<uint64_t>(info.st_ino) == inode_;
+    if (fd >= 0) close(fd);
+    if (ours) shm_unlink(config_.name.c_str());
+}
+
+RingHeader* SharedFrameRing::header() const { return reinterpret_cast<RingHeader*>(base_); }
+
+unsigned char* SharedFrameRing::slot(uint64_t frameNumber) const {
+    return base_ + kHeaderBytes + (frameNumber % config_.slotCount) * header()->slotBytes;
+}
+
+uint64_t SharedFrameRing::published() const {
+    return base_ ? header()->published.load(std::memory_order_acquire) : 0;
+}
+
+bool SharedFrameRing::publish(const cv::Mat& frame, int64_t frameIndex, int64_t timestampUs,
+                              const std::vector<cv::Rect>& regions, size_t motionBoxCount) {
+    if (!base_ || frame.empty() || frame.depth() != CV_8U) return false;
+    const size_t rowBytes = static_cast<size_t>(frame.cols) * frame.elemSize();
+    if (rowBytes * static_cast<size_t>(frame.rows) > header()->maxPixelBytes) {
+        if (oversized_++ == 0) {
+            LOG_WARN("Frames of {}x{}x{} exceed the shared frame ring slots ({}x{}x{}); not "
+                     "published",
+                     frame.cols, frame.rows, frame.channels(), config_.maxWidth,
+                     config_.maxHeight, config_.maxChannels);
+        }
+        return false;
+    }
+
+    RingHeader* ring = header();
+    const uint64_t frameNumber = ring->published.load(std::memory_order_relaxed);
+    unsigned char* base = slot(frameNumber);
+    auto* slotHeader = reinterpret_cast<SlotHeader*>(base);
+
+    // Odd: readers that sample the slot now or while it is copied discard what they read
+    const uint64_t sequence = slotHeader->sequence.load(std::memory_order_relaxed);
+    slotHeader->sequence.store(sequence | 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slotHeader->frameNumber = frameNumber;
+    slotHeader->frameIndex = frameIndex;
+    slotHeader->timestampUs = timestampUs;
+    slotHeader->width = static_cast<uint32_t>(frame.cols);
+    slotHeader->height = static_cast<uint32_t>(frame.rows);
+    slotHeader->channels = static_cast<uint32_t>(frame.channels());
+    slotHeader->motionBoxCount = static_cast<uint32_t>(motionBoxCount);
+    const size_t regionCount = std::min(regions.size(), kMaxRegions);
+    slotHeader->regionCount = static_cast<uint32_t>(regionCount);
+    for (size_t i = 0; i < regionCount; ++i) {
+        slotHeader->regions[i][0] = regions[i].x;
+        slotHeader->regions[i][1] = regions[i].y;
+        slotHeader->regions[i][2] = regions[i].width;
+        slotHeader->regions[i][3] = regions[i].height;
+    }
+
+    unsigned char* pixels = base + kSlotHeaderBytes;
+    if (frame.isContinuous()) {
+        std::memcpy(pixels, frame.data, rowBytes * static_cast<size_t>(frame.rows));
+    } else {
+        for (int row = 0; row < frame.rows; ++row) {
+            std::memcpy(pixels + static_cast<size_t>(row) * rowBytes, frame.ptr(row), rowBytes);
+        }
+    }
+
+    slotHeader->sequence.store(2 * (frameNumber + 1), std::memory_order_release);
+    ring->published.store(frameNumber + 1, std::memory_order_release);
+    return true;
+}
+
+SharedFrameRingReader::SharedFrameRingReader(const std::string& name) {
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) return;
+    struct stat info {};
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < kHeaderBytes) {
+        close(fd);
+        return;
+    }
+    void* mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return;
+
+    const auto* ring = static_cast<const RingHeader*>(mapped);
+    if (ring->magic != kMagic || ring->version != kVersion ||
+        kHeaderBytes + ring->slotBytes * ring->slotCount > static_cast<size_t>(info.st_size)) {
+        munmap(mapped, static_cast<size_t>(info.st_size));
+        return;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    base_ = static_cast<const unsigned char*>(mapped);
+    size_ = static_cast<size_t>(info.st_size);
+}
+
+SharedFrameRingReader::~SharedFrameRingReader() {
+    if (base_) munmap(const_cast<unsigned char*>(base_), size_);
+}
+
+uint64_t SharedFrameRingReader::published() const {
+    if (!base_) return 0;
+    return reinterpret_cast<const RingHeader*>(base_)->published.load(std::memory_order_acquire);
+}
+
+bool SharedFrameRingReader::read(uint64_t frameNumber, Frame& frame) const {
+    if (!base_) return false;
+    const auto* ring = reinterpret_cast<const RingHeader*>(base_);
+    const unsigned char* base =
+        base_ + kHeaderBytes + (frameNumber % ring->slotCount) * ring->slotBytes;
+    const auto* slotHeader = reinterpret_cast<const SlotHeader*>(base);
+
+    const uint64_t expected = 2 * (frameNumber + 1);
+    if (slotHeader->sequence.load(std::memory_order_acquire) != expected) return false;
+
+    const uint32_t width = slotHeader->width;
+    const uint32_t height = slotHeader->height;
+    const uint32_t channels = slotHeader->channels;
+    if (channels == 0 || channels > 4 ||
+        uint64_t{width} * height * channels > ring->maxPixelBytes) {
+        return false;
+    }
+    frame.frameNumber = frameNumber;
+    frame.frameIndex = slotHeader->frameIndex;
+    frame.timestampUs = slotHeader->timestampUs;
+    frame.motionBoxCount = slotHeader->motionBoxCount;
+    frame.regions.clear();
+    const size_t regionCount = std::min<size_t>(slotHeader->regionCount, kMaxRegions);
+    for (size_t i = 0; i < regionCount; ++i) {
+        frame.regions.emplace_back(slotHeader->regions[i][0], slotHeader->regions[i][1],
+                                   slotHeader->regions[i][2], slotHeader->regions[i][3]);
+    }
+    cv::Mat(static_cast<int>(height), static_cast<int>(width), CV_8UC(static_cast<int>(channels)),
+            const_cast<unsigned char*>(base + kSlotHeaderBytes))
+        .copyTo(frame.image);
+
+    // Unchanged sequence: nothing was written into the slot while it was copied
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slotHeader->sequence.load(std::memory_order_relaxed) == expected;
+}
+
+bool SharedFrameRingReader::latest(Frame& frame) const {
+    const uint64_t count = published();
+    return count > 0 && read(count - 1, frame);
+}
@@ -0,0 +1,77 @@
+#include "simd_dispatch.hpp"
+
+#include <atomic>
+#include <opencv2/core/hal/intrin.hpp>
+
+namespace {
+
+std::atomic<int>& activeLevel() {
+    static std::atomic<int> level{static_cast<int>(bestSimdLevel())};
+    return level;
+}
+
+}  // namespace
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Scalar:
+            return "scalar";
+        case SimdLevel::Universal128:
+            return "universal128";
+        case SimdLevel::Neon:
+            return "neon";
+        case SimdLevel::Avx2:
+            return "avx2";
+        case SimdLevel::Avx512:
+            return "avx512";
+    }
+    return "unknown";
+}
+
+bool simdLevelSupported(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Scalar:
+            return true;
+        case SimdLevel::Universal128:
+#if CV_SIMD128
+            return true;
+#else
+            return false;
+#endif
+        case SimdLevel::Neon:
+#if BIRDS_SIMD_NEON
+            return true;  // Baseline on ARMv8-A
+#else
+            return false;
+#endif
+        case SimdLevel::Avx2:
+#if BIRDS_SIMD_AVX2
+            return __builtin_cpu_supports("avx2");
+#else
+            return false;
+#endif
+        case SimdLevel::Avx512:
+#if BIRDS_SIMD_AVX512
+            // Also checks that the OS saves the ZMM state
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+SimdLevel bestSimdLevel() {
+    for (SimdLevel level : {SimdLevel::Avx512, SimdLevel::Avx2, SimdLevel::Neon, SimdLevel::Universal128}) {
+        if (simdLevelSupported(level)) return level;
+    }
+    return SimdLevel::Scalar;
+}
+
+SimdLevel simdLevel() { return static_cast<SimdLevel>(activeLevel().load(std::memory_order_relaxed)); }
+
+bool setSimdLevel(SimdLevel level) {
+    if (!simdLevelSupported(level)) return false;
+    activeLevel().store(static_cast<int>(level), std::memory_order_relaxed);
+    return true;
+}
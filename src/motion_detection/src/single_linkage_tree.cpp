@@ -0,0 +1,64 @@
+#include "single_linkage_tree.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+namespace {
+
+int findRoot(std::vector<int>& parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];  // Path halving
+        i = parent[i];
+    }
+    return i;
+}
+
+}  // namespace
+
+void SingleLinkageTree::build(int leaves, std::vector<Edge>& edges) {
+    leaves_ = std::max(0, leaves);
+    merges_.clear();
+    mergedLeaves_.clear();
+    // Stable: equal distances merge in the order the edges were found
+    std::stable_sort(edges.begin(), edges.end(),
+                     [](const Edge& x, const Edge& y) { return x.distance < y.distance; });
+
+    std::vector<int>& parent = parent_;
+    parent.resize(leaves_);
+    std::iota(parent.begin(), parent.end(), 0);
+    std::vector<int> nodeOf(leaves_);  // Tree node of each root
+    std::iota(nodeOf.begin(), nodeOf.end(), 0);
+    std::vector<int> sizeOf(leaves_, 1);
+    for (const Edge& edge : edges) {
+        if (merges_.size() + 1 >= static_cast<size_t>(leaves_)) break;  // One tree already
+        const int a = findRoot(parent, edge.a);
+        const int b = findRoot(parent, edge.b);
+        if (a == b) continue;
+        merges_.push_back({nodeOf[a], nodeOf[b], edge.distance, sizeOf[a] + sizeOf[b]});
+        mergedLeaves_.emplace_back(edge.a, edge.b);
+        const int root = std::min(a, b);
+        parent[std::max(a, b)] = root;
+        nodeOf[root] = leaves_ + static_cast<int>(merges_.size()) - 1;
+        sizeOf[root] = merges_.back().size;
+    }
+}
+
+int SingleLinkageTree::cut(double distance, std::vector<int>& labels) const {
+    std::vector<int>& parent = parent_;
+    parent.resize(leaves_);
+    std::iota(parent.begin(), parent.end(), 0);
+    for (size_t k = 0; k < merges_.size() && merges_[k].distance <= distance; ++k) {
+        const int a = findRoot(parent, mergedLeaves_[k].first);
+        const int b = findRoot(parent, mergedLeaves_[k].second);
+        parent[std::max(a, b)] = std::min(a, b);  // Roots stay the smallest leaf
+    }
+    labels.assign(leaves_, -1);
+    int clusters = 0;
+    for (int i = 0; i < leaves_; ++i) {
+        const int root = findRoot(parent, i);
+        if (labels[root] < 0) labels[root] = clusters++;  // root <= i: seen first
+        labels[i] = labels[root];
+    }
+    return clusters;
+}
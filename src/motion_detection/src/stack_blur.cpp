@@ -0,0 +1,133 @@
+#include "stack_blur.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+// cv::cvtColor(COLOR_BGR2GRAY) on 8-bit input: BT.601 weights in 14-bit fixed point
+constexpr int kLumaShift = 14;
+constexpr int kLumaB = 1868;
+constexpr int kLumaG = 9617;
+constexpr int kLumaR = 4899;
+
+// Normalisation by multiply and shift; 40 bits keep the result exact to 1e-4 at radius 31
+constexpr int kNormShift = 40;
+
+void lumaRow(const uchar* bgr, int width, uchar* out) {
+    for (int x = 0; x < width; ++x, bgr += 3) {
+        out[x] = static_cast<uchar>((bgr[0] * kLumaB + bgr[1] * kLumaG + bgr[2] * kLumaR +
+                                     (1 << (kLumaShift - 1))) >> kLumaShift);
+    }
+}
+
+// Triangle sums of one row: out[x * stride] = sum over k of (radius + 1 - |k|) * in[x + k].
+// @p columns maps padded positions -radius..width+radius (offset by radius) to source columns
+void triangleRow(const uchar* in, int stride, int width, int radius, const int* columns, uint32_t* out) {
+    auto at = [&](int x) { return static_cast<uint32_t>(in[columns[x + radius] * stride]); };
+    uint32_t sum = 0;
+    uint32_t left = 0;   // Positions x - radius .. x
+    uint32_t right = 0;  // Positions x + 1 .. x + radius
+    for (int k = -radius; k <= radius; ++k) {
+        const uint32_t value = at(k);
+        sum += static_cast<uint32_t>(radius + 1 - std::abs(k)) * value;
+        (k <= 0 ? left : right) += value;
+    }
+    for (int x = 0; x < width; ++x) {
+        out[x * stride] = sum;
+        const uint32_t entering = at(x + radius + 1);
+        const uint32_t moving = at(x + 1);
+        sum += right + entering - left;
+        left += moving - at(x - radius);
+        right += entering - moving;
+    }
+}
+
+}  // namespace
+
+StackBlur::StackBlur(int radius) : radius_(std::clamp(radius, 1, 31)) {}
+
+int StackBlur::radiusForGaussian(int kernelSize) {
+    const double sigma = 0.3 * ((kernelSize - 1) * 0.5 - 1.0) + 0.8;
+    // A triangle of radius r has variance r (r + 2) / 6
+    return std::clamp(static_cast<int>(std::lround(std::sqrt(1.0 + 6.0 * sigma * sigma) - 1.0)), 1, 31);
+}
+
+void StackBlur::apply(const cv::Mat& input, cv::Mat& output, Workspace& workspace, bool luma) const {
+    CV_Assert(input.depth() == CV_8U);
+    const bool toLuma = luma && input.channels() == 3;
+    const int channels = toLuma ? 1 : input.channels();
+    const int rows = input.rows;
+    const int cols = input.cols;
+    const int radius = radius_;
+    const size_t rowLength = static_cast<size_t>(cols) * channels;
+    output.create(input.size(), CV_MAKETYPE(CV_8U, channels));
+    if (input.empty()) return;
+
+    workspace.columns.resize(static_cast<size_t>(cols + 2 * radius + 1));
+    for (int i = 0; i < static_cast<int>(workspace.columns.size()); ++i) {
+        workspace.columns[i] = cv::borderInterpolate(i - radius, cols, cv::BORDER_REFLECT_101);
+    }
+    const int ringRows = 2 * radius + 3;
+    workspace.ring.resize(static_cast<size_t>(ringRows) * rowLength);
+    if (toLuma) workspace.row.resize(static_cast<size_t>(cols));
+
+    // Horizontal sums of each input row are computed once, on first use. The window never
+    // reaches back more than ringRows rows, so the ring slot is still intact when read
+    int computed = -1;
+    auto horizontal = [&](int row) {
+        uint32_t* slot = workspace.ring.data() + static_cast<size_t>(row % ringRows) * rowLength;
+        while (computed < row) {
+            ++computed;
+            uint32_t* out = workspace.ring.data() + static_cast<size_t>(computed % ringRows) * rowLength;
+            const uchar* in = input.ptr<uchar>(computed);
+            if (toLuma) {
+                lumaRow(in, cols, workspace.row.data());
+                triangleRow(workspace.row.data(), 1, cols, radius, workspace.columns.data(), out);
+            } else {
+                for (int c = 0; c < channels; ++c) {
+                    triangleRow(in + c, channels, cols, radius, workspace.columns.data(), out + c);
+                }
+            }
+        }
+        return static_cast<const uint32_t*>(slot);
+    };
+    auto source = [&](int row) { return horizontal(cv::borderInterpolate(row, rows, cv::BORDER_REFLECT_101)); };
+
+    std::vector<uint32_t>& sum = workspace.sum;
+    std::vector<uint32_t>& above = workspace.sumAbove;
+    std::vector<uint32_t>& below = workspace.sumBelow;
+    sum.assign(rowLength, 0);
+    above.assign(rowLength, 0);
+    below.assign(rowLength, 0);
+    for (int k = -radius; k <= radius; ++k) {
+        const uint32_t* values = source(k);
+        const uint32_t weight = static_cast<uint32_t>(radius + 1 - std::abs(k));
+        uint32_t* half = k <= 0 ? above.data() : below.data();
+        for (size_t i = 0; i < rowLength; ++i) {
+            sum[i] += weight * values[i];
+            half[i] += values[i];
+        }
+    }
+
+    const uint64_t weight = static_cast<uint64_t>(radius + 1) * (radius + 1) * (radius + 1) * (radius + 1);
+    const uint64_t scale = ((uint64_t{1} << kNormShift) + weight / 2) / weight;
+    const uint64_t half = uint64_t{1} << (kNormShift - 1);
+    for (int y = 0; y < rows; ++y) {
+        uchar* out = output.ptr<uchar>(y);
+        for (size_t i = 0; i < rowLength; ++i) {
+            out[i] = static_cast<uchar>((sum[i] * scale + half) >> kNormShift);
+        }
+        if (y + 1 == rows) break;
+        // Row y + radius + 1 enters the lower half, y + 1 moves to the upper, y - radius leaves
+        const uint32_t* entering = source(y + radius + 1);
+        const uint32_t* moving = source(y + 1);
+        const uint32_t* leaving = source(y - radius);
+        for (size_t i = 0; i < rowLength; ++i) {
+            sum[i] += below[i] + entering[i] - above[i];
+            above[i] += moving[i] - leaving[i];
+            below[i] += entering[i] - moving[i];
+        }
+    }
+}
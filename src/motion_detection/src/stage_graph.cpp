@@ -0,0 +1,191 @@
+#include "stage_graph.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+#include "work_stealing_pool.hpp"
+
+namespace {
+
+constexpr int kSource = -1;  // Producer index of a slot the caller fills
+
+bool contains(const std::vector<std::string>& names, const std::string& name) {
+    return std::find(names.begin(), names.end(), name) != names.end();
+}
+
+}  // namespace
+
+void StageGraph::addSource(const std::string& slot) {
+    sources_.push_back(slot);
+    compiled_ = false;
+}
+
+void StageGraph::addStage(const std::string& name, std::vector<std::string> inputs,
+                          std::vector<std::string> outputs, StageFunction function, bool sink) {
+    StageInfo info;
+    info.name = name;
+    info.inputs = std::move(inputs);
+    info.outputs = std::move(outputs);
+    info.sink = sink;
+    info_.push_back(std::move(info));
+    functions_.push_back(std::move(function));
+    compiled_ = false;
+}
+
+void StageGraph::requestOutputs(std::vector<std::string> slots) {
+    requested_ = std::move(slots);
+    compiled_ = false;
+}
+
+void StageGraph::compile() {
+    compiled_ = false;
+    levels_.clear();
+    consumed_.clear();
+
+    std::unordered_map<std::string, int> producers;
+    auto addProducer = [&](const std::string& slot, int producer) {
+        if (!producers.emplace(slot, producer).second) {
+            throw std::invalid_argument("StageGraph: slot '" + slot + "' has more than one producer");
+        }
+    };
+    for (const auto& slot : sources_) addProducer(slot, kSource);
+    for (size_t i = 0; i < info_.size(); ++i) {
+        for (size_t j = 0; j < i; ++j) {
+            if (info_[j].name == info_[i].name) {
+                throw std::invalid_argument("StageGraph: duplicate stage '" + info_[i].name + "'");
+            }
+        }
+        for (const auto& slot : info_[i].outputs) addProducer(slot, static_cast<int>(i));
+    }
+    auto producerOf = [&](const std::string& slot, const std::string& reader) {
+        const auto it = producers.find(slot);
+        if (it == producers.end()) {
+            throw std::invalid_argument("StageGraph: nothing produces '" + slot + "' (read by " + reader + ")");
+        }
+        return it->second;
+    };
+
+    // Levels over every stage, so a cycle is reported even among stages that are inactive
+    std::vector<int> level(info_.size(), -1);
+    for (size_t placed = 0; placed < info_.size();) {
+        size_t progress = 0;
+        for (size_t i = 0; i < info_.size(); ++i) {
+            if (level[i] >= 0) continue;
+            int stageLevel = 0;
+            bool ready = true;
+            for (const auto& slot : info_[i].inputs) {
+                const int producer = producerOf(slot, "stage '" + info_[i].name + "'");
+                if (producer == kSource) continue;
+                if (level[producer] < 0) {
+                    ready = false;
+                    break;
+                }
+                stageLevel = std::max(stageLevel, level[producer] + 1);
+            }
+            if (!ready) continue;
+            level[i] = stageLevel;
+            ++progress;
+        }
+        if (progress == 0) throw std::invalid_argument("StageGraph: the stages form a cycle");
+        placed += progress;
+    }
+
+    // Walk back from the requested outputs and the sinks
+    std::vector<size_t> pending;
+    for (const auto& slot : requested_) {
+        const int producer = producerOf(slot, "the caller");
+        if (producer != kSource) pending.push_back(static_cast<size_t>(producer));
+        if (!contains(consumed_, slot)) consumed_.push_back(slot);
+    }
+    for (size_t i = 0; i < info_.size(); ++i) {
+        info_[i].active = false;
+        info_[i].level = -1;
+        if (info_[i].sink) pending.push_back(i);
+    }
+    while (!pending.empty()) {
+        const size_t stage = pending.back();
+        pending.pop_back();
+        if (info_[stage].active) continue;
+        info_[stage].active = true;
+        info_[stage].level = level[stage];
+        for (const auto& slot : info_[stage].inputs) {
+            if (!contains(consumed_, slot)) consumed_.push_back(slot);
+            const int producer = producers.at(slot);
+            if (producer != kSource) pending.push_back(static_cast<size_t>(producer));
+        }
+    }
+
+    // An active stage's producers are active, so the active levels are contiguous from 0
+    for (size_t i = 0; i < info_.size(); ++i) {
+        if (!info_[i].active) continue;
+        if (levels_.size() <= static_cast<size_t>(level[i])) levels_.resize(level[i] + 1);
+        levels_[level[i]].push_back(i);
+    }
+    compiled_ = true;
+}
+
+void StageGraph::run(WorkStealingPool* pool) {
+    if (!compiled_) compile();
+    for (const auto& level : levels_) {
+        if (pool && level.size() > 1) {
+            runLevel(level, *pool);
+        } else {
+            for (size_t stage : level) functions_[stage]();
+        }
+    }
+}
+
+void StageGraph::runLevel(const std::vector<size_t>& level, WorkStealingPool& pool) {
+    // Shared with the helper tasks: a helper that starts after the level is done finds no
+    // stage left to claim and returns without touching the graph
+    struct LevelRun {
+        std::atomic<size_t> next{0};
+        size_t size = 0;
+        std::mutex mutex;
+        std::condition_variable finished;
+        size_t done = 0;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<LevelRun>();
+    state->size = level.size();
+    auto work = [state, &level, this] {
+        for (;;) {
+            const size_t claimed = state->next.fetch_add(1);
+            if (claimed >= state->size) return;
+            std::exception_ptr error;
+            try {
+                functions_[level[claimed]]();
+            } catch (...) {
+                error = std::current_exception();
+            }
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (error && !state->error) state->error = error;
+                ++state->done;
+            }
+            state->finished.notify_all();
+        }
+    };
+    for (size_t i = 1; i < level.size(); ++i) pool.submit(work);
+    work();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&] { return state->done == state->size; });
+    if (state->error) std::rethrow_exception(state->error);
+}
+
+bool StageGraph::isActive(const std::string& stage) const {
+    for (const auto& info : info_) {
+        if (info.name == stage) return info.active;
+    }
+    return false;
+}
+
+bool StageGraph::isConsumed(const std::string& slot) const { return contains(consumed_, slot); }
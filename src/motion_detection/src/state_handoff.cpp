@@ -0,0 +1,296 @@
+#include "state_handoff.hpp"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include "logger.hpp"
+#include "thread_placement.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kPollIntervalMs = 200;  // Upper bound on how long stop() waits
+constexpr std::chrono::milliseconds kHelloTimeout{2000};
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;  // The other side hanging up must not SIGPIPE the process
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+bool socketAddress(const std::string& path, sockaddr_un& address) {
+    address = sockaddr_un{};
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) return false;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+bool sendAll(int fd, const unsigned char* data, size_t size) {
+    size_t sent = 0;
+    while (sent < size) {
+        const ssize_t n = ::send(fd, data + sent, size - sent, kSendFlags);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool writeMessage(int fd, handoff_wire::Kind kind, const unsigned char* payload, size_t size) {
+    unsigned char header[handoff_wire::kHeaderBytes];
+    const auto put = [&header](size_t offset, uint64_t value, size_t bytes) {
+        for (size_t i = 0; i < bytes; ++i) header[offset + i] = static_cast<unsigned char>(value >> (8 * i));
+    };
+    put(0, handoff_wire::kMagic, 4);
+    put(4, handoff_wire::kVersion, 2);
+    put(6, kind, 2);
+    put(8, size, 4);
+    return sendAll(fd, header, sizeof(header)) && (size == 0 || sendAll(fd, payload, size));
+}
+
+// Reads exactly @p size bytes, or fails at @p deadline or when the other side hangs up
+bool readExactly(int fd, unsigned char* data, size_t size, Clock::time_point deadline) {
+    size_t done = 0;
+    while (done < size) {
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+        if (left.count() <= 0) return false;
+        pollfd readable{};
+        readable.fd = fd;
+        readable.events = POLLIN;
+        const int ready = ::poll(&readable, 1, static_cast<int>(std::min<int64_t>(left.count(), kPollIntervalMs)));
+        if (ready < 0 && errno != EINTR) return false;
+        if (ready <= 0) continue;
+        const ssize_t n = ::recv(fd, data + done, size - done, 0);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+        if (n <= 0) return false;
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool readMessage(int fd, Clock::time_point deadline, uint16_t& kind, std::vector<unsigned char>& payload) {
+    unsigned char header[handoff_wire::kHeaderBytes];
+    if (!readExactly(fd, header, sizeof(header), deadline)) return false;
+    const auto get = [&header](size_t offset, size_t bytes) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes; ++i) value |= static_cast<uint64_t>(header[offset + i]) << (8 * i);
+        return value;
+    };
+    if (get(0, 4) != handoff_wire::kMagic || get(4, 2) != handoff_wire::kVersion) return false;
+    kind = static_cast<uint16_t>(get(6, 2));
+    const uint64_t size = get(8, 4);
+    if (size > handoff_wire::kMaxPayloadBytes) return false;
+    payload.resize(size);
+    return size == 0 || readExactly(fd, payload.data(), payload.size(), deadline);
+}
+
+}  // namespace
+
+// ============================================================================
+// HandoffListener
+// ============================================================================
+
+HandoffListener::HandoffListener(std::string socketPath, std::string cameraId)
+    : socketPath_(std::move(socketPath)), cameraId_(std::move(cameraId)) {}
+
+HandoffListener::~HandoffListener() { stop(); }
+
+bool HandoffListener::start() {
+    if (running_) return true;
+    sockaddr_un address;
+    if (!socketAddress(socketPath_, address)) {
+        LOG_ERROR("Handoff: socket path '{}' is empty or too long", socketPath_);
+        return false;
+    }
+    listenFd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd_ < 0) {
+        LOG_ERROR("Handoff: socket() failed: {}", std::strerror(errno));
+        return false;
+    }
+    bool bound = ::bind(listenFd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    if (!bound && errno == EADDRINUSE) {
+        // Left behind by an instance that is gone, unless somebody still answers on it
+        const int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        const bool answered =
+            probe >= 0 && ::connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+        if (probe >= 0) ::close(probe);
+        if (!answered) {
+            ::unlink(socketPath_.c_str());
+            bound = ::bind(listenFd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+        } else {
+            errno = EADDRINUSE;
+        }
+    }
+    if (!bound || ::listen(listenFd_, 1) < 0) {
+        LOG_ERROR("Handoff: cannot listen on {}: {}", socketPath_, std::strerror(errno));
+        ::close(listenFd_);
+        listenFd_ = -1;
+        return false;
+    }
+    struct stat info {};
+    if (::stat(socketPath_.c_str(), &info) == 0) socketInode_ = info.st_ino;
+
+    running_ = true;
+    thread_ = std::thread(&HandoffListener::run, this);
+    LOG_INFO("Handoff: a restarted instance can take over through {}", socketPath_);
+    return true;
+}
+
+void HandoffListener::stop() {
+    running_ = false;
+    if (thread_.joinable()) thread_.join();
+    if (listenFd_ >= 0) {
+        ::close(listenFd_);
+        listenFd_ = -1;
+    }
+    if (successorFd_ >= 0) {
+        ::close(successorFd_);
+        successorFd_ = -1;
+    }
+    // Once a successor took over, the socket file is (or is about to be) its own
+    struct stat info {};
+    if (socketInode_ != 0 && !requested() && ::stat(socketPath_.c_str(), &info) == 0 &&
+        info.st_ino == socketInode_) {
+        ::unlink(socketPath_.c_str());
+    }
+    socketInode_ = 0;
+}
+
+bool HandoffListener::sendState(const std::vector<unsigned char>& state) {
+    if (successorFd_ < 0) return false;
+    if (!writeMessage(successorFd_, handoff_wire::kState, state.data(), state.size())) {
+        LOG_ERROR("Handoff: the successor hung up before it got the state");
+        return false;
+    }
+    return true;
+}
+
+void HandoffListener::sendReleased() {
+    if (successorFd_ < 0) return;
+    writeMessage(successorFd_, handoff_wire::kReleased, nullptr, 0);
+    ::close(successorFd_);
+    successorFd_ = -1;
+}
+
+void HandoffListener::run() {
+    nameCurrentThread("handoff");
+    pollfd listener{};
+    listener.fd = listenFd_;
+    listener.events = POLLIN;
+    while (running_) {
+        // Poll with a timeout instead of blocking in accept() so stop() is prompt
+        const int ready = ::poll(&listener, 1, kPollIntervalMs);
+        if (ready <= 0 || !(listener.revents & POLLIN)) continue;
+
+        const int clientFd = ::accept(listenFd_, nullptr, nullptr);
+        if (clientFd < 0) continue;
+        if (!greet(clientFd)) {
+            ::close(clientFd);
+            continue;
+        }
+        // One successor: nobody else may connect to a listener that is going away
+        ::close(listenFd_);
+        listenFd_ = -1;
+        successorFd_ = clientFd;
+        requested_.store(true, std::memory_order_release);
+        return;
+    }
+}
+
+bool HandoffListener::greet(int clientFd) {
+    uint16_t kind = 0;
+    std::vector<unsigned char> payload;
+    if (!readMessage(clientFd, Clock::now() + kHelloTimeout, kind, payload) || kind != handoff_wire::kHello) {
+        LOG_WARN("Handoff: ignoring a connection that did not say hello");
+        return false;
+    }
+    const std::string cameraId(payload.begin(), payload.end());
+    if (cameraId != cameraId_) {
+        const std::string reason = "this instance runs camera '" + cameraId_ + "'";
+        writeMessage(clientFd, handoff_wire::kRefused, reinterpret_cast<const unsigned char*>(reason.data()),
+                     reason.size());
+        LOG_WARN("Handoff: refused a successor for camera '{}' ({})", cameraId, reason);
+        return false;
+    }
+    LOG_INFO("Handoff: a successor for camera '{}' is waiting; stopping between two frames", cameraId);
+    return true;
+}
+
+// ============================================================================
+// HandoffClient
+// ============================================================================
+
+HandoffClient::~HandoffClient() { close(); }
+
+bool HandoffClient::connect(const std::string& socketPath, const std::string& cameraId) {
+    close();
+    sockaddr_un address;
+    if (!socketAddress(socketPath, address)) {
+        LOG_ERROR("Handoff: socket path '{}' is empty or too long", socketPath);
+        return false;
+    }
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd_ < 0) return false;
+    if (::connect(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        // No socket file, or nobody listening on it: nothing to take over
+        close();
+        return false;
+    }
+    if (!writeMessage(fd_, handoff_wire::kHello, reinterpret_cast<const unsigned char*>(cameraId.data()),
+                      cameraId.size())) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool HandoffClient::receiveState(std::vector<unsigned char>& state, std::chrono::milliseconds timeout) {
+    if (fd_ < 0) return false;
+    uint16_t kind = 0;
+    std::vector<unsigned char> payload;
+    if (!readMessage(fd_, Clock::now() + timeout, kind, payload)) {
+        LOG_WARN("Handoff: no state from the running instance within {} ms", timeout.count());
+        close();
+        return false;
+    }
+    if (kind == handoff_wire::kRefused) {
+        LOG_WARN("Handoff: the running instance refused: {}", std::string(payload.begin(), payload.end()));
+        close();
+        return false;
+    }
+    if (kind != handoff_wire::kState) {
+        close();
+        return false;
+    }
+    state = std::move(payload);
+    return true;
+}
+
+bool HandoffClient::waitReleased(std::chrono::milliseconds timeout) {
+    if (fd_ < 0) return false;
+    uint16_t kind = 0;
+    std::vector<unsigned char> payload;
+    const bool released = readMessage(fd_, Clock::now() + timeout, kind, payload) && kind == handoff_wire::kReleased;
+    if (!released) LOG_WARN("Handoff: the previous instance did not confirm its last saves; writing anyway");
+    close();
+    return released;
+}
+
+void HandoffClient::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
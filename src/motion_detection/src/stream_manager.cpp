@@ -0,0 +1,629 @@
+#include "stream_manager.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+#include "logger.hpp"
+#include "motion_pipeline.hpp"
+#include "profiler_zones.hpp"
+#include "stream_state.hpp"
+
+StreamManager::StreamManager(size_t threadCount, size_t queueCapacity, BackpressurePolicy policy,
+                             const StreamPlacement& placement)
+    : queueCapacity_(std::max<size_t>(1, queueCapacity)), policy_(policy), placement_(placement) {
+    std::vector<std::vector<int>> nodeCpus;
+    if (placement_.numaLocal) {
+        const std::vector<std::vector<int>> nodes = numaNodeCpus();
+        for (size_t node = 0; node < nodes.size(); ++node) {
+            std::vector<int> cpus = nodes[node];
+            if (!placement_.workerCpus.empty()) {
+                // Only the budget's compute cores of the node
+                cpus.erase(std::remove_if(cpus.begin(), cpus.end(),
+                                          [this](int cpu) {
+                                              return std::find(placement_.workerCpus.begin(),
+                                                               placement_.workerCpus.end(),
+                                                               cpu) == placement_.workerCpus.end();
+                                          }),
+                           cpus.end());
+            }
+            if (cpus.empty()) continue;  // Memory-only node, or none of its CPUs in the budget
+            poolNodes_.push_back(static_cast<int>(node));
+            nodeCpus.push_back(std::move(cpus));
+        }
+        if (poolNodes_.size() < 2) {
+            LOG_INFO("StreamManager: single NUMA node, NUMA placement not needed");
+            poolNodes_.clear();
+            nodeCpus.clear();
+        }
+    }
+
+    if (poolNodes_.empty()) {
+        std::function<void()> pin;
+        if (!placement_.workerCpus.empty()) {
+            pin = [cpus = placement_.workerCpus] {
+                if (!pinCurrentThread(cpus)) {
+                    LOG_WARN("StreamManager: could not pin a worker to {} CPUs", cpus.size());
+                }
+            };
+        }
+        pools_.push_back(std::make_unique<WorkStealingPool>(threadCount, std::move(pin)));
+    } else {
+        if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t i = 0; i < poolNodes_.size(); ++i) {
+            // Spread the threads evenly, at least one per node
+            const size_t share = std::max<size_t>(
+                1, threadCount / poolNodes_.size() + (i < threadCount % poolNodes_.size() ? 1 : 0));
+            const std::vector<int> cpus = nodeCpus[i];
+            const int node = poolNodes_[i];
+            pools_.push_back(std::make_unique<WorkStealingPool>(share, [cpus, node] {
+                if (!pinCurrentThread(cpus)) LOG_WARN("StreamManager: could not pin a worker to NUMA node {}", node);
+            }));
+        }
+    }
+    for (size_t i = 0; i < pools_.size(); ++i) ready_.push_back(std::make_unique<ReadyQueue>());
+    shedder_ = std::make_unique<LoadShedder>(LoadSheddingConfig(), threadCount());
+    LOG_INFO("StreamManager initialized: {} threads on {} node(s), queue capacity {}, policy {}, huge pages {}",
+             threadCount(), pools_.size(), queueCapacity_, backpressurePolicyName(policy_),
+             placement_.hugePages ? "on" : "off");
+}
+
+StreamManager::~StreamManager() {
+    stopping_ = true;
+    std::shared_lock<std::shared_mutex> streamsLock(streamsMutex_);
+    for (auto& stream : streams_) {
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        stream->pending.clear();
+        stream->spaceAvailable.notify_all();
+    }
+    streamsLock.unlock();
+    for (auto& pool : pools_) pool->waitIdle();
+}
+
+size_t StreamManager::addStream(std::unique_ptr<MotionProcessor> processor,
+                                std::unique_ptr<MotionRegionConsolidator> consolidator) {
+    if (!processor) throw std::invalid_argument("StreamManager: stream without a MotionProcessor");
+    std::unique_lock<std::shared_mutex> streamsLock(streamsMutex_);
+    auto stream = std::make_unique<Stream>();
+    stream->pool = streams_.size() % pools_.size();
+    MemoryPlacement memory;
+    memory.hugePages = placement_.hugePages;
+    memory.numaNode = poolNodes_.empty() ? -1 : poolNodes_[stream->pool];
+    if (!memory.isDefault()) processor->setBufferAllocator(PlacedMatAllocator::forPlacement(memory));
+    stream->baseScale = processor->getDetectionScale();
+    stream->appliedScale = stream->baseScale;
+    if (adaptiveScale_.enabled) {
+        stream->adaptiveScale = std::make_unique<AdaptiveDetectionScale>(adaptiveScale_, stream->baseScale);
+    }
+    stream->profileName = profiler::internName("stream " + processor->getCameraId());
+    stream->processor = std::move(processor);
+    stream->consolidator = std::move(consolidator);
+    streams_.push_back(std::move(stream));
+    shedder_->addStream();  // Same index: both grow under streamsMutex_
+    return streams_.size() - 1;
+}
+
+StreamManager::DetachedStream StreamManager::detachStream(size_t index) {
+    Stream& stream = streamAt(index);
+    DetachedStream detached;
+    {
+        std::unique_lock<std::mutex> lock(stream.mutex);
+        if (stream.detached) throw std::logic_error("StreamManager: stream already detached");
+        pauseStream(stream, lock);
+        stream.detached = true;
+        stream.pending.clear();
+        detached.processor = std::move(stream.processor);
+        detached.consolidator = std::move(stream.consolidator);
+    }
+    stream.spaceAvailable.notify_all();
+    shedder_->resetStream(index);
+    LOG_INFO("StreamManager: stream {} ({}) detached after {} frames", index, detached.processor->getCameraId(),
+             stream.processed.load());
+    return detached;
+}
+
+std::vector<unsigned char> StreamManager::checkpointStream(size_t index) {
+    Stream& stream = streamAt(index);
+    {
+        std::unique_lock<std::mutex> lock(stream.mutex);
+        if (stream.detached) throw std::logic_error("StreamManager: checkpoint of a detached stream");
+        pauseStream(stream, lock);
+    }
+    // Paused: no task touches the processor or the consolidator until resumeStream()
+    std::vector<unsigned char> state;
+    try {
+        state = encodeStreamState(captureStreamState(*stream.processor, stream.consolidator.get()));
+    } catch (...) {
+        resumeStream(index, stream);
+        throw;
+    }
+    resumeStream(index, stream);
+    return state;
+}
+
+StreamManager::Stream& StreamManager::streamAt(size_t index) const {
+    std::shared_lock<std::shared_mutex> lock(streamsMutex_);
+    if (index >= streams_.size()) throw std::out_of_range("StreamManager: unknown stream");
+    return *streams_[index];
+}
+
+void StreamManager::pauseStream(Stream& stream, std::unique_lock<std::mutex>& lock) {
+    stream.pauses++;
+    stream.idle.wait(lock, [&] { return !stream.scheduled; });
+}
+
+void StreamManager::resumeStream(size_t index, Stream& stream) {
+    bool schedule = false;
+    Urgency urgency;
+    {
+        std::lock_guard<std::mutex> lock(stream.mutex);
+        if (--stream.pauses == 0 && !stream.scheduled && !stream.pending.empty() && !stopping_) {
+            stream.scheduled = true;
+            schedule = true;
+            urgency = nextUrgencyLocked(stream);
+        }
+    }
+    if (schedule) dispatch(index, stream, urgency);
+}
+
+void StreamManager::setResultCallback(ResultCallback callback) {
+    if (started_) throw std::logic_error("StreamManager: setResultCallback() after submit()");
+    callback_ = std::move(callback);
+}
+
+void StreamManager::setRegionClassifier(std::unique_ptr<RegionClassifier> classifier,
+                                        std::chrono::microseconds maxBatchDelay) {
+    if (started_) throw std::logic_error("StreamManager: setRegionClassifier() after submit()");
+    batcher_.reset();
+    if (!classifier) return;
+    const size_t maxBatch = static_cast<size_t>(std::max(1, classifier->getConfig().maxBatch));
+    std::function<void()> pin;
+    if (!placement_.classifierCpus.empty()) {
+        pin = [cpus = placement_.classifierCpus] {
+            if (!pinCurrentThread(cpus)) {
+                LOG_WARN("StreamManager: could not pin the classifier to {} CPUs", cpus.size());
+            }
+        };
+    }
+    batcher_ = std::make_unique<ClassificationBatcher>(std::move(classifier), maxBatch, maxBatchDelay,
+                                                       std::move(pin));
+}
+
+void StreamManager::setLoadShedding(const LoadSheddingConfig& config) {
+    if (started_) throw std::logic_error("StreamManager: setLoadShedding() after submit()");
+    shedder_ = std::make_unique<LoadShedder>(config, threadCount());
+    for (size_t i = 0; i < streamCount(); ++i) shedder_->addStream();
+}
+
+void StreamManager::setCrossCameraDedup(const CrossCameraConfig& config) {
+    if (started_) throw std::logic_error("StreamManager: setCrossCameraDedup() after submit()");
+    dedup_.reset();
+    if (config.pairs.empty()) return;
+    dedup_ = std::make_unique<CrossCameraDeduplicator>(
+        config, [this](size_t index, uint64_t sequence, cv::Mat& frame, std::vector<ConsolidatedRegion>& regions,
+                       std::vector<CrossCameraLinks>& links) { deliverLinked(index, sequence, frame, regions, links); });
+    LOG_INFO("StreamManager: cross-camera deduplication over {} camera pair(s)", config.pairs.size());
+}
+
+void StreamManager::setDeadlineScheduling(bool enabled) {
+    if (started_) throw std::logic_error("StreamManager: setDeadlineScheduling() after submit()");
+    deadlineScheduling_ = enabled;
+    if (enabled) LOG_INFO("StreamManager: deadline scheduling by priority class and earliest deadline");
+}
+
+void StreamManager::setStreamSlo(size_t index, const StreamSlo& slo) {
+    Stream& stream = streamAt(index);
+    std::lock_guard<std::mutex> lock(stream.mutex);
+    stream.slo = slo;
+}
+
+void StreamManager::setAdaptiveScale(const AdaptiveScaleConfig& config) {
+    if (started_) throw std::logic_error("StreamManager: setAdaptiveScale() after submit()");
+    std::unique_lock<std::shared_mutex> streamsLock(streamsMutex_);
+    adaptiveScale_ = config;
+    for (auto& stream : streams_) {
+        stream->adaptiveScale.reset();
+        if (config.enabled) stream->adaptiveScale = std::make_unique<AdaptiveDetectionScale>(config, stream->baseScale);
+    }
+}
+
+bool StreamManager::submit(size_t index, cv::Mat frame) {
+    return submit(index, std::move(frame), std::chrono::steady_clock::now());
+}
+
+bool StreamManager::submit(size_t index, cv::Mat frame, std::chrono::steady_clock::time_point captured) {
+    Stream& stream = streamAt(index);
+    started_ = true;
+
+    if (!shedder_->shouldProcess(index)) {
+        std::lock_guard<std::mutex> lock(stream.mutex);
+        stream.nextSequence++;  // Sequences keep counting submitted frames
+        return false;
+    }
+
+    bool schedule = false;
+    Urgency urgency;
+    {
+        std::unique_lock<std::mutex> lock(stream.mutex);
+        if (stream.pending.size() >= queueCapacity_) {
+            switch (policy_) {
+                case BackpressurePolicy::Block: {
+                    PROFILE_ZONE("wait:stream_full");
+                    stream.spaceAvailable.wait(lock, [&] {
+                        return stopping_ || stream.detached || stream.pending.size() < queueCapacity_;
+                    });
+                    break;
+                }
+                case BackpressurePolicy::DropOldest:
+                    stream.pending.pop_front();
+                    stream.dropped++;
+                    break;
+                case BackpressurePolicy::DropNewest:
+                    stream.nextSequence++;
+                    stream.dropped++;
+                    return false;
+            }
+        }
+        if (stopping_ || stream.detached) return false;
+        stream.pending.push_back({stream.nextSequence++, std::move(frame), captured});
+        if (!stream.scheduled && stream.pauses == 0) {
+            stream.scheduled = true;
+            schedule = true;
+            urgency = nextUrgencyLocked(stream);
+        }
+    }
+    if (schedule) dispatch(index, stream, urgency);
+    return true;
+}
+
+void StreamManager::drain() {
+    for (auto& pool : pools_) pool->waitIdle();
+    if (dedup_) dedup_->flush();  // No more offers: releases what still waits for a peer
+    if (batcher_) batcher_->flush();
+}
+
+StreamManager::StreamStats StreamManager::getStats(size_t index) const {
+    const Stream& stream = streamAt(index);
+    StreamStats stats;
+    {
+        std::lock_guard<std::mutex> lock(stream.mutex);
+        stats.queued = stream.pending.size();
+        stats.detached = stream.detached;
+    }
+    stats.processed = stream.processed.load();
+    stats.dropped = stream.dropped.load();
+    const LoadShedder::StreamRate rate = shedder_->rate(index);
+    stats.skipped = rate.skipped;
+    stats.processingFps = rate.processingFps;
+    stats.processingMs = rate.processingMs;
+    stats.frameStride = rate.stride;
+    stats.scaleFactor = rate.scaleFactor;
+    stats.detectionScale = stream.appliedScale.load();
+    stats.deadlineMisses = stream.deadlineMisses.load();
+    stats.yields = stream.yields.load();
+    return stats;
+}
+
+size_t StreamManager::threadCount() const {
+    size_t threads = 0;
+    for (const auto& pool : pools_) threads += pool->threadCount();
+    return threads;
+}
+
+size_t StreamManager::streamCount() const {
+    std::shared_lock<std::shared_mutex> lock(streamsMutex_);
+    return streams_.size();
+}
+
+int StreamManager::streamNode(size_t index) const {
+    const Stream& stream = streamAt(index);
+    return poolNodes_.empty() ? -1 : poolNodes_[stream.pool];
+}
+
+ClassificationBatcherStats StreamManager::getClassificationStats() const {
+    return batcher_ ? batcher_->getStats() : ClassificationBatcherStats{};
+}
+
+CrossCameraStats StreamManager::getCrossCameraStats() const {
+    return dedup_ ? dedup_->getStats() : CrossCameraStats{};
+}
+
+void StreamManager::writeMetrics(PrometheusTextWriter& writer) const {
+    writer.gauge("birds_stream_workers", "Threads processing the streams of this node",
+                 static_cast<double>(threadCount()));
+
+    struct Sample {
+        PrometheusTextWriter::Labels labels;
+        StreamStats stats;
+    };
+    std::vector<Sample> samples;
+    for (size_t i = 0; i < streamCount(); ++i) {
+        const Stream& stream = streamAt(i);
+        std::string cameraId;
+        {
+            std::lock_guard<std::mutex> lock(stream.mutex);
+            if (stream.detached) continue;
+            cameraId = stream.processor->getCameraId();  // Only moved out by a detach, under the lock
+        }
+        samples.push_back({{{"stream", cameraId}}, getStats(i)});
+    }
+
+    writer.header("birds_stream_processing_seconds", "gauge", "Smoothed processing time per frame");
+    for (const Sample& sample : samples) {
+        writer.sample("birds_stream_processing_seconds", sample.stats.processingMs / 1000.0, sample.labels);
+    }
+    writer.header("birds_stream_processing_fps", "gauge", "Frames processed per second over the last second");
+    for (const Sample& sample : samples) {
+        writer.sample("birds_stream_processing_fps", sample.stats.processingFps, sample.labels);
+    }
+    writer.header("birds_stream_frame_stride", "gauge", "Load shedding: every n-th submitted frame is processed");
+    for (const Sample& sample : samples) {
+        writer.sample("birds_stream_frame_stride", sample.stats.frameStride, sample.labels);
+    }
+    writer.header("birds_stream_detection_scale", "gauge", "detection_scale the stream runs at");
+    for (const Sample& sample : samples) {
+        writer.sample("birds_stream_detection_scale", sample.stats.detectionScale, sample.labels);
+    }
+    writer.header("birds_stream_frames_processed_total", "counter", "Frames processed per stream");
+    for (const Sample& sample : samples) {
+        writer.sample("birds_stream_frames_processed_total", static_cast<double>(sample.stats.processed),
+                      sample.labels);
+    }
+    writer.header("birds_stream_frames_dropped_total", "counter", "Frames shed by backpressure per stream");
+    for (const Sample& sample : samples) {
+        writer.sample("birds_stream_frames_dropped_total", static_cast<double>(sample.stats.dropped), sample.labels);
+    }
+    writer.header("birds_stream_deadline_misses_total", "counter",
+                  "Frames finished later than their capture time plus the stream's latency target");
+    for (const Sample& sample : samples) {
+        writer.sample("birds_stream_deadline_misses_total", static_cast<double>(sample.stats.deadlineMisses),
+                      sample.labels);
+    }
+    writer.header("birds_stream_yields_total", "counter",
+                  "Frames that yielded to a more urgent stream between detection and consolidation");
+    for (const Sample& sample : samples) {
+        writer.sample("birds_stream_yields_total", static_cast<double>(sample.stats.yields), sample.labels);
+    }
+    if (dedup_) {
+        const CrossCameraStats stats = dedup_->getStats();
+        writer.counter("birds_cross_camera_linked_regions_total", "Regions linked to a view of another camera",
+                       stats.linkedRegions);
+        writer.counter("birds_cross_camera_duplicates_total", "Linked regions that were not the best view",
+                       stats.duplicates);
+    }
+}
+
+StreamManager::Urgency StreamManager::nextUrgencyLocked(const Stream& stream) {
+    const auto captured = stream.yielded ? stream.yieldedOutput.captured : stream.pending.front().captured;
+    return {stream.slo.priority, captured + stream.slo.latency};
+}
+
+void StreamManager::dispatch(size_t index, const Stream& stream, const Urgency& urgency) {
+    WorkStealingPool& pool = *pools_[stream.pool];
+    if (!deadlineScheduling_) {
+        pool.submit([this, index] { runStream(index); });
+        return;
+    }
+    // One pool task per ready entry; whichever worker takes a task runs the most urgent entry
+    ReadyQueue& ready = *ready_[stream.pool];
+    {
+        std::lock_guard<std::mutex> lock(ready.mutex);
+        ready.heap.push_back({urgency, ready.nextTicket++, index});
+        std::push_heap(ready.heap.begin(), ready.heap.end());
+    }
+    pool.submit([this, poolIndex = stream.pool] { runMostUrgent(poolIndex); });
+}
+
+void StreamManager::runMostUrgent(size_t pool) {
+    ReadyQueue& ready = *ready_[pool];
+    size_t index = 0;
+    {
+        std::lock_guard<std::mutex> lock(ready.mutex);
+        if (ready.heap.empty()) return;  // Not reached: tasks and entries come in pairs
+        std::pop_heap(ready.heap.begin(), ready.heap.end());
+        index = ready.heap.back().stream;
+        ready.heap.pop_back();
+    }
+    runStream(index);
+}
+
+bool StreamManager::moreUrgentReady(size_t pool, const Urgency& urgency) {
+    ReadyQueue& ready = *ready_[pool];
+    std::lock_guard<std::mutex> lock(ready.mutex);
+    return !ready.heap.empty() && ready.heap.front().urgency.before(urgency);
+}
+
+/**
+ * Processes the oldest pending frame of one stream, then re-submits itself if more are
+ * pending (one frame per task keeps streams interleaved fairly). Only one task per
+ * stream exists at a time, which is what keeps the stream's frames in order.
+ *
+ * Under deadline scheduling a frame may stop after detection when a more urgent stream is
+ * ready: it stays with the stream (yielded) and the stream is queued again at the frame's
+ * urgency; its next task consolidates and delivers it before anything else.
+ */
+void StreamManager::runStream(size_t index) {
+    Stream& stream = streamAt(index);
+
+    StreamResult output;
+    cv::Mat frame;
+    double busyMs = 0.0;
+    bool resumed = false;
+    StreamSlo slo;
+    {
+        std::unique_lock<std::mutex> lock(stream.mutex);
+        slo = stream.slo;
+        if (stream.yielded) {
+            // Finish the frame before a checkpoint or detach gets the stream
+            stream.yielded = false;
+            frame = std::move(stream.yieldedFrame);
+            output = std::move(stream.yieldedOutput);
+            busyMs = stream.yieldedBusyMs;
+            resumed = true;
+        } else {
+            if (stream.pending.empty() || stream.pauses > 0) {
+                stream.scheduled = false;
+                lock.unlock();
+                stream.idle.notify_all();
+                return;
+            }
+            output.sequence = stream.pending.front().sequence;
+            output.captured = stream.pending.front().captured;
+            frame = std::move(stream.pending.front().frame);
+            stream.pending.pop_front();
+        }
+    }
+    if (!resumed) stream.spaceAvailable.notify_one();
+
+    output.stream = index;
+    try {
+        if (!resumed) {
+            const double base = stream.adaptiveScale ? stream.adaptiveScale->scale() : stream.baseScale;
+            const double scale = base * shedder_->scaleFactor(index);
+            if (scale != stream.appliedScale.load(std::memory_order_relaxed)) {
+                stream.processor->setDetectionScale(scale);
+                stream.appliedScale = scale;
+            }
+            const auto started = std::chrono::steady_clock::now();
+            {
+                PROFILE_ZONE_NAMED(stream.profileName);
+                if (stream.consolidator) {
+                    // The object store stays in the context; result and regions travel with the output
+                    stream.pipeline.result = stream.processor->processFrame(frame);
+                } else {
+                    output.result = stream.processor->processFrame(frame);
+                }
+            }
+            busyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+
+            const Urgency urgency{slo.priority, output.captured + slo.latency};
+            if (stream.consolidator && deadlineScheduling_ && moreUrgentReady(stream.pool, urgency)) {
+                {
+                    std::lock_guard<std::mutex> lock(stream.mutex);
+                    stream.yielded = true;
+                    stream.yieldedFrame = std::move(frame);
+                    stream.yieldedOutput = std::move(output);
+                    stream.yieldedBusyMs = busyMs;
+                }
+                stream.yields++;
+                dispatch(index, stream, urgency);  // Still scheduled: no other task may start
+                return;
+            }
+        }
+        finishFrame(index, stream, std::move(frame), std::move(output), busyMs);
+    } catch (const std::exception& e) {
+        LOG_ERROR("Stream {} frame {} failed: {}", index, output.sequence, e.what());
+    }
+
+    bool more = false;
+    Urgency next;
+    {
+        std::lock_guard<std::mutex> lock(stream.mutex);
+        more = !stream.pending.empty() && !stopping_ && stream.pauses == 0;
+        if (more) {
+            next = nextUrgencyLocked(stream);
+        } else {
+            stream.scheduled = false;
+        }
+    }
+    if (more) {
+        dispatch(index, stream, next);
+    } else {
+        stream.idle.notify_all();
+    }
+}
+
+void StreamManager::finishFrame(size_t index, Stream& stream, cv::Mat frame, StreamResult output, double busyMs) {
+    StreamSlo slo;
+    {
+        std::lock_guard<std::mutex> lock(stream.mutex);
+        slo = stream.slo;
+    }
+    if (stream.consolidator) {
+        const auto started = std::chrono::steady_clock::now();
+        {
+            PROFILE_ZONE_NAMED(stream.profileName);
+            consolidateDetections(*stream.consolidator, frame, stream.pipeline);
+        }
+        busyMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        output.result = std::move(stream.pipeline.result);
+        output.regions = std::move(stream.pipeline.regions);
+    }
+    const auto finished = std::chrono::steady_clock::now();
+    if (finished - output.captured > slo.latency) stream.deadlineMisses++;
+    // Without a consolidator, any motion counts as activity
+    const bool active = stream.consolidator ? !output.regions.empty() : !output.result.detectedBounds.empty();
+    shedder_->recordProcessed(index, busyMs, active, finished);
+    // Applied from the next frame on
+    if (stream.adaptiveScale) stream.adaptiveScale->observe(output.result.detectedBounds);
+    stream.processed++;
+    PROFILE_FRAME_MARK(stream.profileName);
+    if (dedup_ && dedup_->covers(index)) {
+        // Comes back through deliverLinked(), maybe on another stream's thread
+        std::vector<ConsolidatedRegion> regions = std::move(output.regions);
+        const uint64_t sequence = output.sequence;
+        const auto captured = output.captured;
+        {
+            std::lock_guard<std::mutex> lock(stream.mutex);
+            stream.linking.push_back(std::move(output));
+        }
+        dedup_->offer(index, sequence, captured, std::move(frame), std::move(regions));
+    } else {
+        deliver(std::move(frame), std::move(output));
+    }
+}
+
+void StreamManager::deliver(cv::Mat frame, StreamResult output) {
+    if (batcher_) {
+        classifyAndDeliver(std::move(frame), std::move(output));
+    } else if (callback_) {
+        callback_(output);
+    }
+}
+
+void StreamManager::deliverLinked(size_t index, uint64_t sequence, cv::Mat& frame,
+                                  std::vector<ConsolidatedRegion>& regions, std::vector<CrossCameraLinks>& links) {
+    Stream& stream = streamAt(index);
+    StreamResult output;
+    {
+        std::lock_guard<std::mutex> lock(stream.mutex);
+        // Results whose offer() threw never come back
+        while (!stream.linking.empty() && stream.linking.front().sequence < sequence) stream.linking.pop_front();
+        if (stream.linking.empty() || stream.linking.front().sequence != sequence) {
+            LOG_ERROR("StreamManager: stream {} frame {} released without its result", index, sequence);
+            return;
+        }
+        output = std::move(stream.linking.front());
+        stream.linking.pop_front();
+    }
+    output.regions = std::move(regions);
+    output.crossCamera = std::move(links);
+    deliver(std::move(frame), std::move(output));
+}
+
+/**
+ * Hands the regions of one result to the batcher; the callback fills in their labels and
+ * delivers the result. Results without regions go through the batcher as well, so that
+ * they cannot overtake an earlier frame of the same stream.
+ */
+void StreamManager::classifyAndDeliver(cv::Mat frame, StreamResult output) {
+    std::vector<cv::Mat> crops;
+    std::vector<size_t> cropped;  // Region of each crop: another camera's view stands in for duplicates
+    crops.reserve(output.regions.size());
+    for (size_t i = 0; i < output.regions.size(); ++i) {
+        if (i < output.crossCamera.size() && output.crossCamera[i].isDuplicate()) continue;
+        crops.push_back(batcher_->cropRegion(frame, output.regions[i].boundingBox));
+        cropped.push_back(i);
+    }
+    auto result = std::make_shared<StreamResult>(std::move(output));
+    batcher_->submit(std::move(crops), [this, result, cropped](std::vector<RegionClassification>& labels) {
+        for (size_t i = 0; i < labels.size() && i < cropped.size(); ++i) {
+            ConsolidatedRegion& region = result->regions[cropped[i]];
+            region.classId = labels[i].classId;
+            region.classLabel = std::move(labels[i].label);
+            region.classConfidence = labels[i].confidence;
+        }
+        if (callback_) callback_(*result);
+    });
+}
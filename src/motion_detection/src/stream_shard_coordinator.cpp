@@ -0,0 +1,324 @@
+#include "stream_shard_coordinator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <utility>
+
+#include "logger.hpp"
+
+namespace {
+
+// Value of label @p key in the "{...}" part of a sample line ("" when absent)
+std::string labelValue(const std::string& labels, const std::string& key) {
+    size_t pos = 0;
+    while (pos < labels.size()) {
+        const size_t equals = labels.find('=', pos);
+        if (equals == std::string::npos || equals + 1 >= labels.size() || labels[equals + 1] != '"') break;
+        const std::string name = labels.substr(pos, equals - pos);
+        std::string value;
+        size_t i = equals + 2;
+        for (; i < labels.size() && labels[i] != '"'; ++i) {
+            if (labels[i] == '\\' && i + 1 < labels.size()) {
+                ++i;
+                value += labels[i] == 'n' ? '\n' : labels[i];
+            } else {
+                value += labels[i];
+            }
+        }
+        if (name == key) return value;
+        pos = i + 1;
+        if (pos < labels.size() && labels[pos] == ',') ++pos;
+    }
+    return "";
+}
+
+// (cost, stream) pairs by descending cost, then by name
+bool largestFirst(const std::pair<double, std::string>& a, const std::pair<double, std::string>& b) {
+    return a.first > b.first || (a.first == b.first && a.second < b.second);
+}
+
+}  // namespace
+
+bool parseNodeLoadReport(const std::string& metricsText, NodeLoadReport& report) {
+    std::map<std::string, StreamLoadReport> streams;
+    bool haveWorkers = false;
+    std::istringstream in(metricsText);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#' || line.compare(0, 13, "birds_stream_") != 0) continue;
+        const size_t nameEnd = line.find_first_of("{ ");
+        if (nameEnd == std::string::npos) continue;
+        const std::string name = line.substr(0, nameEnd);
+        std::string stream;
+        size_t valueStart = nameEnd;
+        if (line[nameEnd] == '{') {
+            // The closing brace is the last one: label values may contain braces, not newlines
+            const size_t close = line.rfind('}');
+            if (close == std::string::npos || close < nameEnd) continue;
+            stream = labelValue(line.substr(nameEnd + 1, close - nameEnd - 1), "stream");
+            valueStart = close + 1;
+        }
+        const double value = std::strtod(line.c_str() + valueStart, nullptr);
+        if (name == "birds_stream_workers") {
+            report.workers = static_cast<size_t>(std::max(0.0, value));
+            haveWorkers = true;
+            continue;
+        }
+        if (stream.empty()) continue;
+        StreamLoadReport& load = streams[stream];
+        load.stream = stream;
+        if (name == "birds_stream_processing_seconds") {
+            load.processingMs = value * 1000.0;
+        } else if (name == "birds_stream_processing_fps") {
+            load.processingFps = value;
+        } else if (name == "birds_stream_frame_stride") {
+            load.frameStride = std::max(1, static_cast<int>(value));
+        }
+    }
+    report.streams.clear();
+    for (auto& entry : streams) report.streams.push_back(std::move(entry.second));
+    return haveWorkers;
+}
+
+const char* toString(StreamMove::Reason reason) {
+    switch (reason) {
+        case StreamMove::Reason::Unassigned:
+            return "unassigned";
+        case StreamMove::Reason::NodeFailed:
+            return "node failed";
+        case StreamMove::Reason::Overload:
+            return "overload";
+        case StreamMove::Reason::Rebalance:
+            return "rebalance";
+    }
+    return "unknown";
+}
+
+StreamShardCoordinator::StreamShardCoordinator(const ShardingConfig& config) : config_(config) {}
+
+void StreamShardCoordinator::addStream(const std::string& stream, double estimatedCores) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    streams_[stream].estimatedCores = estimatedCores;
+}
+
+void StreamShardCoordinator::removeStream(const std::string& stream) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    streams_.erase(stream);
+}
+
+void StreamShardCoordinator::report(const NodeLoadReport& report, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Node& node = nodes_[report.node];
+    if (!node.live) LOG_INFO("Shard coordinator: node {} is live with {} workers", report.node, report.workers);
+    node.live = true;
+    node.workers = std::max<size_t>(1, report.workers);
+    node.lastReport = now;
+    for (const StreamLoadReport& load : report.streams) {
+        const auto it = streams_.find(load.stream);
+        if (it == streams_.end()) continue;
+        Stream& stream = it->second;
+        // A stream the node already runs (e.g. after a coordinator restart) stays there
+        if (stream.node.empty()) stream.node = report.node;
+        // A stream that just started has no rate yet; keep the estimate until it has
+        if (load.processingMs > 0.0 && load.processingFps > 0.0) {
+            stream.cores = load.processingMs * load.processingFps * std::max(1, load.frameStride) / 1000.0;
+        }
+    }
+}
+
+std::vector<StreamMove> StreamShardCoordinator::plan(Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<StreamMove> moves;
+    for (auto& [name, node] : nodes_) {
+        if (node.live && now - node.lastReport > config_.nodeTimeout) {
+            node.live = false;
+            LOG_WARN("Shard coordinator: node {} missed its reports for {} ms; moving its streams away", name,
+                     config_.nodeTimeout.count());
+        }
+    }
+
+    // Streams without a live node, largest first so the small ones fill the gaps
+    std::vector<std::pair<double, std::string>> homeless;
+    for (const auto& [name, stream] : streams_) {
+        if (stream.node.empty() || !nodes_[stream.node].live) homeless.emplace_back(costLocked(stream), name);
+    }
+    std::sort(homeless.begin(), homeless.end(), largestFirst);
+    for (const auto& [cores, name] : homeless) {
+        const std::string to = idlestNodeLocked(cores);
+        if (to.empty()) {
+            LOG_WARN("Shard coordinator: no live node for {} stream(s)", homeless.size());
+            break;
+        }
+        const bool failed = !streams_[name].node.empty();
+        moveLocked(name, to, failed ? StreamMove::Reason::NodeFailed : StreamMove::Reason::Unassigned, now, moves);
+    }
+
+    size_t loadMoves = 0;
+    while (loadMoves < config_.maxMovesPerPlan && relieveOverloadLocked(now, moves)) ++loadMoves;
+    while (loadMoves < config_.maxMovesPerPlan && rebalanceLocked(now, moves)) ++loadMoves;
+    return moves;
+}
+
+void StreamShardCoordinator::storeCheckpoint(const std::string& stream, std::vector<unsigned char> state) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = streams_.find(stream);
+    if (it != streams_.end()) it->second.checkpoint = std::move(state);
+}
+
+std::vector<unsigned char> StreamShardCoordinator::checkpoint(const std::string& stream) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = streams_.find(stream);
+    return it == streams_.end() ? std::vector<unsigned char>() : it->second.checkpoint;
+}
+
+std::string StreamShardCoordinator::nodeOf(const std::string& stream) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = streams_.find(stream);
+    return it == streams_.end() ? std::string() : it->second.node;
+}
+
+std::vector<StreamShardCoordinator::NodeStatus> StreamShardCoordinator::nodes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<NodeStatus> statuses;
+    for (const auto& [name, node] : nodes_) {
+        NodeStatus status;
+        status.node = name;
+        status.live = node.live;
+        status.workers = node.workers;
+        status.utilization = utilizationLocked(name);
+        for (const auto& [streamName, stream] : streams_) {
+            if (stream.node == name) status.streams.push_back(streamName);
+        }
+        statuses.push_back(std::move(status));
+    }
+    return statuses;
+}
+
+double StreamShardCoordinator::costLocked(const Stream& stream) const {
+    if (stream.cores >= 0.0) return stream.cores;
+    return stream.estimatedCores >= 0.0 ? stream.estimatedCores : config_.defaultStreamCores;
+}
+
+double StreamShardCoordinator::loadLocked(const std::string& node) const {
+    double load = 0.0;
+    for (const auto& entry : streams_) {
+        if (entry.second.node == node) load += costLocked(entry.second);
+    }
+    return load;
+}
+
+double StreamShardCoordinator::utilizationLocked(const std::string& node) const {
+    const auto it = nodes_.find(node);
+    return it == nodes_.end() ? 0.0 : loadLocked(node) / static_cast<double>(it->second.workers);
+}
+
+void StreamShardCoordinator::moveLocked(const std::string& stream, const std::string& to, StreamMove::Reason reason,
+                                        Clock::time_point now, std::vector<StreamMove>& moves) {
+    Stream& entry = streams_[stream];
+    moves.push_back({stream, entry.node, to, reason});
+    LOG_INFO("Shard coordinator: stream {} {} -> {} ({})", stream, entry.node.empty() ? "-" : entry.node, to,
+             toString(reason));
+    entry.node = to;
+    entry.moved = true;
+    entry.movedAt = now;
+}
+
+std::string StreamShardCoordinator::idlestNodeLocked(double cores, const std::string& exclude) const {
+    std::string best;
+    double bestUtilization = 0.0;
+    for (const auto& [name, node] : nodes_) {
+        if (!node.live || name == exclude) continue;
+        const double utilization = (loadLocked(name) + cores) / static_cast<double>(node.workers);
+        if (best.empty() || utilization < bestUtilization) {
+            best = name;
+            bestUtilization = utilization;
+        }
+    }
+    return best;
+}
+
+bool StreamShardCoordinator::movableLocked(const Stream& stream, Clock::time_point now) const {
+    return !stream.moved || now - stream.movedAt >= config_.moveCooldown;
+}
+
+/**
+ * Busiest overloaded node first: its largest movable stream that the idlest other node can
+ * take without going past targetUtilization.
+ */
+bool StreamShardCoordinator::relieveOverloadLocked(Clock::time_point now, std::vector<StreamMove>& moves) {
+    std::vector<std::pair<double, std::string>> overloaded;
+    for (const auto& [name, node] : nodes_) {
+        const double utilization = utilizationLocked(name);
+        if (node.live && utilization > config_.overloadUtilization) overloaded.emplace_back(utilization, name);
+    }
+    std::sort(overloaded.rbegin(), overloaded.rend());
+    for (const auto& entry : overloaded) {
+        const std::string& from = entry.second;
+        std::vector<std::pair<double, std::string>> candidates;
+        for (const auto& [name, stream] : streams_) {
+            if (stream.node == from && movableLocked(stream, now)) candidates.emplace_back(costLocked(stream), name);
+        }
+        std::sort(candidates.begin(), candidates.end(), largestFirst);
+        for (const auto& [cores, name] : candidates) {
+            const std::string to = idlestNodeLocked(cores, from);
+            if (to.empty()) return false;  // A single live node: nowhere to go
+            const double receiving = (loadLocked(to) + cores) / static_cast<double>(nodes_[to].workers);
+            if (receiving > config_.targetUtilization) continue;
+            moveLocked(name, to, StreamMove::Reason::Overload, now, moves);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Busiest against idlest live node: the movable stream that leaves the busier of the two
+ * least loaded, if that is below where the busiest node is now. The receiving node may not
+ * go past targetUtilization, unless it still ends up no busier than the giving one (a site
+ * that is full everywhere is still evened out).
+ */
+bool StreamShardCoordinator::rebalanceLocked(Clock::time_point now, std::vector<StreamMove>& moves) {
+    std::string busiest;
+    std::string idlest;
+    double busiestUtilization = 0.0;
+    double idlestUtilization = 0.0;
+    for (const auto& [name, node] : nodes_) {
+        if (!node.live) continue;
+        const double utilization = utilizationLocked(name);
+        if (busiest.empty() || utilization > busiestUtilization) {
+            busiest = name;
+            busiestUtilization = utilization;
+        }
+        if (idlest.empty() || utilization < idlestUtilization) {
+            idlest = name;
+            idlestUtilization = utilization;
+        }
+    }
+    if (busiest.empty() || busiest == idlest || busiestUtilization - idlestUtilization <= config_.imbalance) {
+        return false;
+    }
+
+    const double busiestLoad = loadLocked(busiest);
+    const double idlestLoad = loadLocked(idlest);
+    const auto busiestWorkers = static_cast<double>(nodes_[busiest].workers);
+    const auto idlestWorkers = static_cast<double>(nodes_[idlest].workers);
+    std::string best;
+    double bestPeak = busiestUtilization;
+    for (const auto& [name, stream] : streams_) {
+        if (stream.node != busiest || !movableLocked(stream, now)) continue;
+        const double cores = costLocked(stream);
+        const double giving = (busiestLoad - cores) / busiestWorkers;
+        const double receiving = (idlestLoad + cores) / idlestWorkers;
+        if (receiving > config_.targetUtilization && receiving > giving) continue;
+        const double peak = std::max(giving, receiving);
+        if (peak < bestPeak - 1e-9) {
+            best = name;
+            bestPeak = peak;
+        }
+    }
+    if (best.empty()) return false;
+    moveLocked(best, idlest, StreamMove::Reason::Rebalance, now, moves);
+    return true;
+}
@@ -0,0 +1,266 @@
+#include "stream_state.hpp"
+
+#include <cstring>
+#include <utility>
+
+#include "logger.hpp"
+
+namespace {
+
+template <typename T>
+void appendLittleEndian(std::vector<unsigned char>& out, T value) {
+    for (size_t i = 0; i < sizeof(T); ++i) out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+}
+
+void appendInt(std::vector<unsigned char>& out, int value) { appendLittleEndian(out, static_cast<uint32_t>(value)); }
+
+void appendFloat(std::vector<unsigned char>& out, float value) {
+    uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    appendLittleEndian(out, bits);
+}
+
+void appendDouble(std::vector<unsigned char>& out, double value) {
+    uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    appendLittleEndian(out, bits);
+}
+
+void appendString(std::vector<unsigned char>& out, const std::string& value) {
+    appendLittleEndian(out, static_cast<uint32_t>(value.size()));
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+// Bounds-checked little-endian reads; any short read leaves ok() false
+class Reader {
+   public:
+    explicit Reader(const std::vector<unsigned char>& data) : data_(data) {}
+
+    uint64_t read(size_t bytes) {
+        if (!take(bytes)) return 0;
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes; ++i) value |= static_cast<uint64_t>(data_[offset_ - bytes + i]) << (8 * i);
+        return value;
+    }
+    int readInt() { return static_cast<int>(static_cast<uint32_t>(read(4))); }
+    float readFloat() {
+        const auto bits = static_cast<uint32_t>(read(4));
+        float value = 0.0f;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    double readDouble() {
+        const uint64_t bits = read(8);
+        double value = 0.0;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    std::string readString() {
+        const size_t size = read(4);
+        if (!take(size)) return {};
+        return std::string(reinterpret_cast<const char*>(data_.data()) + offset_ - size, size);
+    }
+    const unsigned char* readBytes(size_t size) { return take(size) ? data_.data() + offset_ - size : nullptr; }
+
+    bool ok() const { return ok_; }
+    bool atEnd() const { return offset_ == data_.size(); }
+    size_t remaining() const { return data_.size() - offset_; }
+
+   private:
+    bool take(size_t bytes) {
+        if (!ok_ || bytes > data_.size() - offset_) return ok_ = false;
+        offset_ += bytes;
+        return true;
+    }
+
+    const std::vector<unsigned char>& data_;
+    size_t offset_ = 0;
+    bool ok_ = true;
+};
+
+}  // namespace
+
+StreamState captureStreamState(const MotionProcessor& processor, const MotionRegionConsolidator* consolidator,
+                               const ObjectTracker* tracker) {
+    StreamState state;
+    state.cameraId = processor.getCameraId();
+    state.background = processor.getBackgroundImage();
+    if (consolidator) {
+        state.hasConsolidator = true;
+        state.frameSize = consolidator->getConfig().frameSize;
+        state.regions = consolidator->getCurrentRegions();
+    }
+    state.hasAdaptive = true;
+    state.adaptiveMinArea = processor.getAdaptiveMinArea();
+    state.adaptiveMinSolidity = processor.getAdaptiveMinSolidity();
+    state.adaptiveMaxAspectRatio = processor.getAdaptiveMaxAspectRatio();
+    if (tracker) {
+        state.hasTracker = true;
+        state.nextTrackId = tracker->nextId();
+        for (size_t row = 0; row < tracker->tracks().size(); ++row) state.tracks.addRow(tracker->tracks(), row);
+    }
+    return state;
+}
+
+void restoreStreamState(const StreamState& state, MotionProcessor& processor, MotionRegionConsolidator* consolidator,
+                        ObjectTracker* tracker) {
+    if (!state.background.empty()) processor.seedBackground(state.background);
+    if (state.hasAdaptive) {
+        processor.seedAdaptiveThresholds(state.adaptiveMinArea, state.adaptiveMinSolidity,
+                                         state.adaptiveMaxAspectRatio);
+    }
+    if (consolidator && state.hasConsolidator) consolidator->restoreRegions(state.frameSize, state.regions);
+    if (tracker && state.hasTracker) tracker->restoreTracks(state.tracks, state.nextTrackId);
+    LOG_INFO("Stream {} restored: {}x{} background, {} region(s), {} track(s)", state.cameraId,
+             state.background.cols, state.background.rows, state.regions.size(), state.tracks.size());
+}
+
+std::vector<unsigned char> encodeStreamState(const StreamState& state) {
+    const cv::Mat& background = state.background;
+    const size_t rowBytes = background.empty() ? 0 : static_cast<size_t>(background.cols) * background.elemSize();
+    std::vector<unsigned char> out;
+    out.reserve(64 + state.cameraId.size() + rowBytes * static_cast<size_t>(background.rows) +
+                state.regions.size() * 64);
+    appendLittleEndian(out, stream_state_wire::kMagic);
+    appendLittleEndian(out, stream_state_wire::kVersion);
+    appendLittleEndian(out, static_cast<uint16_t>(0));
+    appendString(out, state.cameraId);
+
+    appendInt(out, background.empty() ? 0 : background.rows);
+    appendInt(out, background.empty() ? 0 : background.cols);
+    appendInt(out, background.empty() ? 0 : background.type());
+    for (int y = 0; y < (background.empty() ? 0 : background.rows); ++y) {
+        const unsigned char* row = background.ptr(y);
+        out.insert(out.end(), row, row + rowBytes);
+    }
+
+    out.push_back(state.hasConsolidator ? 1 : 0);
+    appendInt(out, state.frameSize.width);
+    appendInt(out, state.frameSize.height);
+    appendLittleEndian(out, static_cast<uint32_t>(state.regions.size()));
+    for (const ConsolidatedRegion& region : state.regions) {
+        appendInt(out, region.boundingBox.x);
+        appendInt(out, region.boundingBox.y);
+        appendInt(out, region.boundingBox.width);
+        appendInt(out, region.boundingBox.height);
+        appendInt(out, region.framesSinceLastUpdate);
+        appendInt(out, region.classId);
+        uint32_t confidence = 0;
+        std::memcpy(&confidence, &region.classConfidence, sizeof(confidence));
+        appendLittleEndian(out, confidence);
+        appendString(out, region.classLabel);
+        appendLittleEndian(out, static_cast<uint32_t>(region.trackedObjectIds.size()));
+        for (const int id : region.trackedObjectIds) appendInt(out, id);
+    }
+
+    out.push_back(state.hasAdaptive ? 1 : 0);
+    appendDouble(out, state.adaptiveMinArea);
+    appendDouble(out, state.adaptiveMinSolidity);
+    appendDouble(out, state.adaptiveMaxAspectRatio);
+
+    const TrackedObjectStore& tracks = state.tracks;
+    out.push_back(state.hasTracker ? 1 : 0);
+    appendInt(out, state.nextTrackId);
+    appendLittleEndian(out, static_cast<uint32_t>(tracks.size()));
+    for (size_t row = 0; row < tracks.size(); ++row) {
+        const cv::Rect& box = tracks.bounds(row);
+        appendInt(out, tracks.id(row));
+        appendInt(out, box.x);
+        appendInt(out, box.y);
+        appendInt(out, box.width);
+        appendInt(out, box.height);
+        appendInt(out, tracks.smoothedCenter(row).x);
+        appendInt(out, tracks.smoothedCenter(row).y);
+        appendFloat(out, tracks.confidence(row));
+        appendInt(out, tracks.framesWithoutDetection(row));
+        const TrackedObjectStore::Trajectory& trajectory = tracks.trajectory(row);
+        appendLittleEndian(out, static_cast<uint32_t>(trajectory.size()));
+        for (size_t i = 0; i < trajectory.size(); ++i) {
+            appendInt(out, trajectory[i].x);
+            appendInt(out, trajectory[i].y);
+        }
+    }
+    return out;
+}
+
+bool decodeStreamState(const std::vector<unsigned char>& data, StreamState& state) {
+    Reader reader(data);
+    if (reader.read(4) != stream_state_wire::kMagic) return false;
+    const auto version = static_cast<uint16_t>(reader.read(2));
+    if (version < 1 || version > stream_state_wire::kVersion) return false;
+    reader.read(2);
+    StreamState decoded;
+    decoded.cameraId = reader.readString();
+
+    const int rows = reader.readInt();
+    const int cols = reader.readInt();
+    const int type = reader.readInt();
+    if (!reader.ok() || rows < 0 || cols < 0) return false;
+    if (rows > 0 && cols > 0) {
+        if (type != CV_8UC1 && type != CV_8UC3) return false;  // What background models learn
+        const size_t rowBytes = static_cast<size_t>(cols) * (type == CV_8UC3 ? 3 : 1);
+        if (rowBytes * static_cast<size_t>(rows) > reader.remaining()) return false;  // Before allocating
+        decoded.background.create(cv::Size(cols, rows), type);
+        for (int y = 0; y < rows; ++y) {
+            const unsigned char* row = reader.readBytes(rowBytes);
+            if (!row) return false;
+            std::memcpy(decoded.background.ptr(y), row, rowBytes);
+        }
+    }
+
+    decoded.hasConsolidator = reader.read(1) != 0;
+    decoded.frameSize.width = reader.readInt();
+    decoded.frameSize.height = reader.readInt();
+    const size_t regionCount = reader.read(4);
+    for (size_t i = 0; i < regionCount && reader.ok(); ++i) {
+        cv::Rect box;
+        box.x = reader.readInt();
+        box.y = reader.readInt();
+        box.width = reader.readInt();
+        box.height = reader.readInt();
+        ConsolidatedRegion region(box, {});
+        region.framesSinceLastUpdate = reader.readInt();
+        region.classId = reader.readInt();
+        const auto confidence = static_cast<uint32_t>(reader.read(4));
+        std::memcpy(&region.classConfidence, &confidence, sizeof(confidence));
+        region.classLabel = reader.readString();
+        const size_t idCount = reader.read(4);
+        for (size_t j = 0; j < idCount && reader.ok(); ++j) region.trackedObjectIds.push_back(reader.readInt());
+        decoded.regions.push_back(std::move(region));
+    }
+
+    if (version >= 2) {
+        decoded.hasAdaptive = reader.read(1) != 0;
+        decoded.adaptiveMinArea = reader.readDouble();
+        decoded.adaptiveMinSolidity = reader.readDouble();
+        decoded.adaptiveMaxAspectRatio = reader.readDouble();
+
+        decoded.hasTracker = reader.read(1) != 0;
+        decoded.nextTrackId = reader.readInt();
+        const size_t trackCount = reader.read(4);
+        for (size_t i = 0; i < trackCount && reader.ok(); ++i) {
+            const int id = reader.readInt();
+            cv::Rect box;
+            box.x = reader.readInt();
+            box.y = reader.readInt();
+            box.width = reader.readInt();
+            box.height = reader.readInt();
+            const size_t row = decoded.tracks.add(id, box);
+            decoded.tracks.smoothedCenter(row).x = reader.readInt();
+            decoded.tracks.smoothedCenter(row).y = reader.readInt();
+            decoded.tracks.confidence(row) = reader.readFloat();
+            decoded.tracks.framesWithoutDetection(row) = reader.readInt();
+            const size_t points = reader.read(4);
+            if (points > TrackedObjectStore::kTrajectoryCapacity) return false;
+            TrackedObjectStore::Trajectory& trajectory = decoded.tracks.trajectory(row);
+            trajectory.clear();
+            for (size_t j = 0; j < points; ++j) {
+                const int x = reader.readInt();
+                trajectory.push(cv::Point(x, reader.readInt()));
+            }
+        }
+    }
+    if (!reader.ok() || !reader.atEnd()) return false;
+    state = std::move(decoded);
+    return true;
+}
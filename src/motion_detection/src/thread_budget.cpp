@@ -0,0 +1,106 @@
+#include "thread_budget.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include <opencv2/core.hpp>
+
+ThreadBudget ThreadBudget::plan(const ThreadBudgetSettings& settings, size_t workers, const std::vector<int>& cpus) {
+    ThreadBudget budget;
+    budget.pin = settings.pin;
+    budget.workers = std::max<size_t>(1, workers);
+
+    std::vector<int> available = cpus.empty() ? std::vector<int>{0} : cpus;
+    if (settings.cores > 0 && static_cast<size_t>(settings.cores) < available.size()) {
+        available.resize(static_cast<size_t>(settings.cores));
+    }
+    // Set-aside partitions come off the end of the list; one compute core always stays
+    size_t spare = available.size() - 1;
+    auto setAside = [&](int wanted, std::vector<int>& partition) {
+        const size_t count = std::min<size_t>(static_cast<size_t>(std::max(0, wanted)), spare);
+        partition.assign(available.end() - static_cast<std::ptrdiff_t>(count), available.end());
+        available.resize(available.size() - count);
+        spare -= count;
+    };
+    setAside(settings.persistenceCores, budget.persistenceCpus);
+    setAside(settings.classificationCores, budget.classificationCpus);
+    budget.computeCpus = std::move(available);
+
+    // The workers' own threads count as busy cores; OpenCV gets the idle ones plus its caller
+    const size_t compute = budget.computeCpus.size();
+    budget.opencvThreads = settings.opencvThreads >= 0
+                               ? settings.opencvThreads
+                               : static_cast<int>(budget.workers >= compute ? 1 : compute - budget.workers + 1);
+    return budget;
+}
+
+const std::vector<int>& ThreadBudget::cpus(ThreadPartition partition) const {
+    switch (partition) {
+        case ThreadPartition::Persistence:
+            return persistenceCpus.empty() ? computeCpus : persistenceCpus;
+        case ThreadPartition::Classification:
+            return classificationCpus.empty() ? computeCpus : classificationCpus;
+        case ThreadPartition::Compute:
+            break;
+    }
+    return computeCpus;
+}
+
+ThreadSettings ThreadBudget::placement(const ThreadSettings& configured,
+                                       const std::vector<std::pair<std::string, ThreadPartition>>& roles) const {
+    ThreadSettings settings = configured;
+    if (!pin) return settings;
+    for (const auto& [role, partition] : roles) {
+        ThreadPolicy& policy = settings.roles[role];
+        if (policy.cpus.empty()) policy.cpus = cpus(partition);
+    }
+    return settings;
+}
+
+std::string ThreadBudget::describe() const {
+    auto partition = [](const std::vector<int>& cpus) {
+        return cpus.empty() ? std::string("shared") : std::to_string(cpus.size());
+    };
+    std::ostringstream out;
+    out << cores() << " cores: " << computeCpus.size() << " compute (" << workers << " workers, OpenCV "
+        << opencvThreads << " threads), " << partition(persistenceCpus) << " persistence, "
+        << partition(classificationCpus) << " classification" << (pin ? ", pinned" : "");
+    return out.str();
+}
+
+std::vector<int> allowedCpus() {
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+        }
+    }
+#endif
+    if (cpus.empty()) {
+        const int count = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        for (int cpu = 0; cpu < count; ++cpu) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+void applyOpenCvThreads(const ThreadBudget& budget) { cv::setNumThreads(budget.opencvThreads); }
+
+const char* threadPartitionName(ThreadPartition partition) {
+    switch (partition) {
+        case ThreadPartition::Compute:
+            return "compute";
+        case ThreadPartition::Persistence:
+            return "persistence";
+        case ThreadPartition::Classification:
+            return "classification";
+    }
+    return "unknown";
+}
@@ -0,0 +1,61 @@
+#include "thread_placement.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "logger.hpp"
+#include "memory_placement.hpp"
+
+bool applyThreadPolicy(const ThreadPolicy& policy) {
+    if (policy.isDefault()) return true;
+#ifdef __linux__
+    bool applied = true;
+    const pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+    if (!policy.cpus.empty() && !pinCurrentThread(policy.cpus)) {
+        LOG_WARN("Thread {}: could not pin to {} CPUs", tid, policy.cpus.size());
+        applied = false;
+    }
+    if (policy.realtimePriority > 0) {
+        sched_param param{};
+        param.sched_priority = policy.realtimePriority;
+        const int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (error != 0) {
+            LOG_WARN("Thread {}: SCHED_FIFO priority {} refused: {}", tid, policy.realtimePriority,
+                     std::strerror(error));
+            applied = false;
+        }
+    } else if (policy.nice != 0) {
+        // Under Linux the nice value is per thread when set through the thread ID
+        if (setpriority(PRIO_PROCESS, static_cast<id_t>(tid), policy.nice) != 0) {
+            LOG_WARN("Thread {}: nice {} refused: {}", tid, policy.nice, std::strerror(errno));
+            applied = false;
+        }
+    }
+    if (!policy.cgroup.empty()) {
+        std::ofstream threads(policy.cgroup + "/cgroup.threads");
+        threads << tid << std::endl;
+        if (!threads) {
+            LOG_WARN("Thread {}: could not join cgroup {}", tid, policy.cgroup);
+            applied = false;
+        }
+    }
+    return applied;
+#else
+    LOG_WARN("Thread policies are only supported on Linux");
+    return false;
+#endif
+}
+
+bool setupCurrentThread(const ThreadSettings& settings, const std::string& role, const std::string& name) {
+    nameCurrentThread(name.empty() ? role : name);
+    const ThreadPolicy* policy = settings.find(role);
+    return !policy || applyThreadPolicy(*policy);
+}
@@ -0,0 +1,151 @@
+#include "thumbnail_atlas.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <opencv2/imgproc.hpp>
+
+#include "logger.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Written under a temporary name and renamed, so the final name only ever holds a whole file
+bool writeAtomically(const fs::path& path, const char* data, size_t size) {
+    const fs::path temporary = path.string() + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(data, static_cast<std::streamsize>(size));
+        if (!file) return false;
+    }
+    std::error_code ec;
+    fs::rename(temporary, path, ec);
+    if (ec) fs::remove(temporary, ec);
+    return !ec;
+}
+
+std::string sheetName(int index) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "sheet_%04d", index);
+    return buffer;
+}
+
+}  // namespace
+
+ThumbnailAtlas::ThumbnailAtlas(std::string directory, const ThumbnailAtlasConfig& config,
+                               const ImageEncodeSettings& encoding)
+    : directory_(std::move(directory)), config_(config), encoding_(encoding) {}
+
+ThumbnailAtlas::~ThumbnailAtlas() { seal(); }
+
+bool ThumbnailAtlas::add(const std::string& partition, const std::string& uuid, const cv::Mat& image,
+                         AtlasCell& cell) {
+    cell = AtlasCell();
+    if (image.empty() || (image.type() != CV_8UC1 && image.type() != CV_8UC3)) return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sheet_.partition != partition) {
+        sealLocked();  // A new hour starts a new sheet
+        openLocked(partition);
+    }
+    const int index = static_cast<int>(sheet_.thumbnails.size());
+    const cv::Size& cellSize = config_.cellSize;
+    const double scale = std::min(static_cast<double>(cellSize.width) / image.cols,
+                                  static_cast<double>(cellSize.height) / image.rows);
+    const cv::Rect rect((index % config_.columns) * cellSize.width, (index / config_.columns) * cellSize.height,
+                        std::clamp(static_cast<int>(std::lround(image.cols * scale)), 1, cellSize.width),
+                        std::clamp(static_cast<int>(std::lround(image.rows * scale)), 1, cellSize.height));
+    cv::Mat target = sheet_.canvas(rect);
+    if (image.channels() == 3) {
+        cv::resize(image, target, rect.size(), 0, 0, cv::INTER_AREA);  // Straight into the canvas
+    } else {
+        cv::Mat scaled;
+        cv::resize(image, scaled, rect.size(), 0, 0, cv::INTER_AREA);
+        cv::cvtColor(scaled, target, cv::COLOR_GRAY2BGR);
+    }
+    sheet_.thumbnails.emplace_back(uuid, rect);
+    thumbnailsPlaced_++;
+
+    cell.sheet = sheet_.partition + "/" + sheet_.name + imageCodecExtension(encoding_.codec);
+    cell.sheetSize = sheet_.canvas.size();
+    cell.rect = rect;
+    if (static_cast<int>(sheet_.thumbnails.size()) >= capacity()) sealLocked();
+    return true;
+}
+
+void ThumbnailAtlas::sealDue(std::chrono::steady_clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!sheet_.partition.empty() && now - sheet_.opened >= config_.sealAfter) sealLocked();
+}
+
+void ThumbnailAtlas::seal() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sealLocked();
+}
+
+uint64_t ThumbnailAtlas::sheetsWritten() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sheetsWritten_;
+}
+
+uint64_t ThumbnailAtlas::thumbnailsPlaced() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return thumbnailsPlaced_;
+}
+
+void ThumbnailAtlas::openLocked(const std::string& partition) {
+    const fs::path directory = fs::path(directory_) / partition;
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+    // Sheets of the hour sealed before (e.g. before a restart) keep their numbers
+    int index = 0;
+    while (fs::exists(directory / (sheetName(index) + imageCodecExtension(encoding_.codec)), ec)) ++index;
+
+    sheet_.partition = partition;
+    sheet_.name = sheetName(index);
+    sheet_.canvas.create(config_.cellSize.height * config_.rows, config_.cellSize.width * config_.columns, CV_8UC3);
+    sheet_.canvas.setTo(cv::Scalar::all(0));
+    sheet_.thumbnails.clear();
+    sheet_.opened = std::chrono::steady_clock::now();
+}
+
+void ThumbnailAtlas::sealLocked() {
+    if (sheet_.partition.empty()) return;
+    const fs::path directory = fs::path(directory_) / sheet_.partition;
+    const std::string imageName = sheet_.name + imageCodecExtension(encoding_.codec);
+    bool ok = !sheet_.thumbnails.empty();
+    if (ok) {
+        // Unused cells stay black, which costs the codec next to nothing
+        ok = ImageEncoder::encode(sheet_.canvas, encoding_, encoded_) &&
+             writeAtomically(directory / imageName, reinterpret_cast<const char*>(encoded_.data()), encoded_.size());
+    }
+    if (ok) {
+        std::string index = "{\"image\":\"" + imageName + "\",\"size\":[" + std::to_string(sheet_.canvas.cols) +
+                            "," + std::to_string(sheet_.canvas.rows) + "],\"cell\":[" +
+                            std::to_string(config_.cellSize.width) + "," + std::to_string(config_.cellSize.height) +
+                            "],\"thumbnails\":{";
+        for (size_t i = 0; i < sheet_.thumbnails.size(); ++i) {
+            const cv::Rect& rect = sheet_.thumbnails[i].second;
+            if (i > 0) index += ',';
+            index += "\"" + sheet_.thumbnails[i].first + "\":[" + std::to_string(rect.x) + "," +
+                     std::to_string(rect.y) + "," + std::to_string(rect.width) + "," +
+                     std::to_string(rect.height) + "]";
+        }
+        index += "}}\n";
+        ok = writeAtomically(directory / (sheet_.name + ".json"), index.data(), index.size());
+        if (ok) {
+            sheetsWritten_++;
+            LOG_DEBUG("Thumbnail atlas {}/{}: {} thumbnails, {} bytes", sheet_.partition, imageName,
+                      sheet_.thumbnails.size(), encoded_.size());
+        }
+    }
+    if (!ok && !sheet_.thumbnails.empty()) {
+        // The documents keep their individual thumbnails, which readers fall back to
+        LOG_WARN("Could not write thumbnail atlas {}/{}", directory.string(), imageName);
+    }
+    sheet_.partition.clear();
+    sheet_.thumbnails.clear();
+}
@@ -0,0 +1,95 @@
+#include "tile_occupancy.hpp"
+
+#include <algorithm>
+#include <opencv2/core/hal/intrin.hpp>
+#include <stdexcept>
+
+namespace {
+
+// Overlapping or adjacent (diagonals included): no pixel row or column separates them
+bool touches(const cv::Rect& a, const cv::Rect& b) {
+    return a.x <= b.x + b.width && b.x <= a.x + a.width && a.y <= b.y + b.height && b.y <= a.y + a.height;
+}
+
+}  // namespace
+
+bool anyNonZero(const uchar* data, int length) {
+    int i = 0;
+#if CV_SIMD128
+    // OR the vectors together and test once: a mask row is read at full bandwidth
+    const cv::v_uint8x16 zero = cv::v_setzero_u8();
+    cv::v_uint8x16 bits = zero;
+    constexpr int kLanes = cv::v_uint8x16::nlanes;
+    for (; i + kLanes <= length; i += kLanes) bits = bits | cv::v_load(data + i);
+    if (!cv::v_check_all(bits == zero)) return true;
+#endif
+    for (; i < length; ++i) {
+        if (data[i] != 0) return true;
+    }
+    return false;
+}
+
+void TileOccupancy::scan(const cv::Mat& mask, int tileSize) {
+    if (mask.type() != CV_8UC1) throw std::invalid_argument("TileOccupancy needs a CV_8UC1 mask");
+    if (tileSize <= 0) throw std::invalid_argument("TileOccupancy tile size must be positive");
+    maskSize_ = mask.size();
+    tileSize_ = tileSize;
+    columns_ = (mask.cols + tileSize - 1) / tileSize;
+    rows_ = (mask.rows + tileSize - 1) / tileSize;
+    occupied_.assign(static_cast<size_t>(columns_) * rows_, 0);
+    occupiedCount_ = 0;
+    windows_.clear();
+
+    for (int row = 0; row < rows_; ++row) {
+        const int top = row * tileSize;
+        const int bottom = std::min(mask.rows, top + tileSize);
+        for (int column = 0; column < columns_; ++column) {
+            const int left = column * tileSize;
+            const int width = std::min(mask.cols, left + tileSize) - left;
+            for (int y = top; y < bottom; ++y) {
+                if (anyNonZero(mask.ptr<uchar>(y) + left, width)) {
+                    occupied_[row * columns_ + column] = 1;
+                    ++occupiedCount_;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+double TileOccupancy::occupancy() const {
+    return occupied_.empty() ? 0.0 : static_cast<double>(occupiedCount_) / occupied_.size();
+}
+
+const std::vector<cv::Rect>& TileOccupancy::windows(int halo) {
+    windows_.clear();
+    const cv::Rect bounds(0, 0, maskSize_.width, maskSize_.height);
+    for (int row = 0; row < rows_; ++row) {
+        for (int column = 0; column < columns_; ++column) {
+            if (!occupied(column, row)) continue;
+            cv::Rect window = cv::Rect(column * tileSize_ - halo, row * tileSize_ - halo, tileSize_ + 2 * halo,
+                                       tileSize_ + 2 * halo) &
+                              bounds;
+            // Absorb every window the grown one touches; windows_ stays pairwise separated.
+            // A merge grows the window, so the search restarts
+            for (size_t i = 0; i < windows_.size();) {
+                if (touches(windows_[i], window)) {
+                    window |= windows_[i];
+                    windows_[i] = windows_.back();
+                    windows_.pop_back();
+                    i = 0;
+                } else {
+                    ++i;
+                }
+            }
+            windows_.push_back(window);
+        }
+    }
+    return windows_;
+}
+
+int64_t TileOccupancy::windowArea() const {
+    int64_t area = 0;
+    for (const cv::Rect& window : windows_) area += static_cast<int64_t>(window.width) * window.height;
+    return area;
+}
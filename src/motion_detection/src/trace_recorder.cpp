@@ -0,0 +1,145 @@
+#include "trace_recorder.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <utility>
+
+#include "logger.hpp"
+
+namespace {
+
+constexpr int kProcessId = 1;
+
+// Stage i runs on track (thread id) i + 1
+int stageThreadId(size_t stage) { return static_cast<int>(stage) + 1; }
+
+double microsSince(FrameTrace::Clock::time_point base, FrameTrace::Clock::time_point at) {
+    return std::chrono::duration<double, std::micro>(at - base).count();
+}
+
+// Separates events: every event but the first is preceded by ",\n"
+class EventWriter {
+   public:
+    explicit EventWriter(std::ostream& out) : out_(out) {}
+
+    void event(const char* json) {
+        out_ << (first_ ? "\n" : ",\n") << json;
+        first_ = false;
+    }
+
+   private:
+    std::ostream& out_;
+    bool first_ = true;
+};
+
+}  // namespace
+
+TraceRecorder::TraceRecorder(TraceRecorderConfig config) : config_(std::move(config)) {
+    if (!config_.enabled) done_ = true;
+}
+
+void TraceRecorder::record(int frameIndex, const FrameTrace& trace) {
+    if (done_) return;
+    if (windowStart_ == FrameTrace::Clock::time_point{}) {
+        // The window is placed relative to the first frame seen
+        windowStart_ = trace.captured + std::chrono::duration_cast<FrameTrace::Clock::duration>(
+                                            std::chrono::duration<double>(config_.startAfterSeconds));
+        windowEnd_ = windowStart_ + std::chrono::duration_cast<FrameTrace::Clock::duration>(
+                                        std::chrono::duration<double>(config_.durationSeconds));
+        frames_.reserve(std::min<size_t>(config_.maxFrames, 1024));
+    }
+    if (trace.captured < windowStart_) return;
+    if (trace.captured >= windowEnd_ || frames_.size() >= config_.maxFrames) {
+        writeFile();
+        return;
+    }
+    frames_.push_back({frameIndex, trace});
+}
+
+bool TraceRecorder::finish() {
+    if (done_ || frames_.empty()) return false;
+    return writeFile();
+}
+
+bool TraceRecorder::writeFile() {
+    done_ = true;
+    const std::filesystem::path path(config_.path);
+    std::error_code error;
+    if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path(), error);
+    std::ofstream out(path);
+    if (out) writeJson(out);
+    out.close();
+    if (!out) {
+        LOG_ERROR("Failed to write pipeline trace {}", config_.path);
+        frames_.clear();
+        return false;
+    }
+    LOG_INFO("Pipeline trace of {} frames written to {}", frames_.size(), config_.path);
+    frames_.clear();
+    frames_.shrink_to_fit();
+    return true;
+}
+
+void TraceRecorder::writeJson(std::ostream& out) const {
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    EventWriter events(out);
+    char json[512];
+
+    std::snprintf(json, sizeof(json),
+                  R"({"name":"process_name","ph":"M","pid":%d,"tid":0,"args":{"name":"birds_of_play"}})",
+                  kProcessId);
+    events.event(json);
+    for (size_t stage = 0; stage < FrameTrace::kStageCount; ++stage) {
+        std::snprintf(json, sizeof(json),
+                      R"({"name":"thread_name","ph":"M","pid":%d,"tid":%d,"args":{"name":"%s"}})",
+                      kProcessId, stageThreadId(stage), traceStageName(static_cast<TraceStage>(stage)));
+        events.event(json);
+    }
+
+    if (!frames_.empty()) {
+        FrameTrace::Clock::time_point base = frames_.front().trace.captured;
+        for (const Entry& entry : frames_) base = std::min(base, entry.trace.captured);
+
+        for (const Entry& entry : frames_) {
+            const FrameTrace& trace = entry.trace;
+            // Async span from capture to output, carrying the frame's clocks
+            const FrameTrace::Clock::time_point end =
+                trace.delivered != FrameTrace::Clock::time_point{} ? trace.delivered : trace.exited.back();
+            std::snprintf(json, sizeof(json),
+                          R"({"name":"frame","cat":"frame","ph":"b","id":%d,"pid":%d,"tid":0,"ts":%.3f,)"
+                          R"("args":{"frame":%d,"capture_unix_us":%lld,"source_timestamp_ms":%.3f}})",
+                          entry.frameIndex, kProcessId, microsSince(base, trace.captured), entry.frameIndex,
+                          static_cast<long long>(trace.captureUnixUs), trace.sourceTimestampMs);
+            events.event(json);
+            std::snprintf(json, sizeof(json),
+                          R"({"name":"frame","cat":"frame","ph":"e","id":%d,"pid":%d,"tid":0,"ts":%.3f})",
+                          entry.frameIndex, kProcessId, microsSince(base, end));
+            events.event(json);
+
+            for (size_t stage = 0; stage < FrameTrace::kStageCount; ++stage) {
+                if (!trace.reached(static_cast<TraceStage>(stage))) break;
+                const char* name = traceStageName(static_cast<TraceStage>(stage));
+                const FrameTrace::Clock::time_point queuedFrom =
+                    stage == 0 ? trace.captured : trace.exited[stage - 1];
+                // Several frames can wait in one queue at once, so waits are async spans
+                std::snprintf(json, sizeof(json),
+                              R"({"name":"queued: %s","cat":"queue","ph":"b","id":%d,"pid":%d,"tid":0,"ts":%.3f})",
+                              name, entry.frameIndex, kProcessId, microsSince(base, queuedFrom));
+                events.event(json);
+                std::snprintf(json, sizeof(json),
+                              R"({"name":"queued: %s","cat":"queue","ph":"e","id":%d,"pid":%d,"tid":0,"ts":%.3f})",
+                              name, entry.frameIndex, kProcessId, microsSince(base, trace.entered[stage]));
+                events.event(json);
+                std::snprintf(json, sizeof(json),
+                              R"({"name":"%s","cat":"stage","ph":"X","pid":%d,"tid":%d,"ts":%.3f,"dur":%.3f,)"
+                              R"("args":{"frame":%d}})",
+                              name, kProcessId, stageThreadId(stage), microsSince(base, trace.entered[stage]),
+                              trace.runMs(static_cast<TraceStage>(stage)) * 1000.0, entry.frameIndex);
+                events.event(json);
+            }
+        }
+    }
+    out << "\n]}\n";
+}
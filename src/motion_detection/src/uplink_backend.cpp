@@ -0,0 +1,481 @@
+#include "uplink_backend.hpp"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <utility>
+
+#include "logger.hpp"
+#include "thread_placement.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr int kConnectTimeoutMs = 3000;
+constexpr int kSendTimeoutSec = 5;   // A send stalled this long (WAN gone) drops the connection
+constexpr int kPollIntervalMs = 100;  // Also the longest a message waits in the outbox
+constexpr auto kAckTimeout = std::chrono::seconds(30);
+constexpr auto kMinRetry = std::chrono::seconds(1);
+constexpr auto kMaxRetry = std::chrono::seconds(30);
+constexpr uint64_t kSpoolSegmentBytes = 64ull << 20;
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;  // The aggregator hanging up must not SIGPIPE the process
+#else
+constexpr int kSendFlags = 0;  // macOS: SO_NOSIGPIPE is set per socket instead
+#endif
+
+template <typename T>
+void appendLittleEndian(std::vector<unsigned char>& out, T value) {
+    for (size_t i = 0; i < sizeof(T); ++i) out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+}
+
+uint64_t readLittleEndian(const unsigned char* data, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) value |= static_cast<uint64_t>(data[i]) << (8 * i);
+    return value;
+}
+
+std::vector<unsigned char> encodeMessage(uint8_t kind, const std::string& document,
+                                         const std::vector<std::vector<unsigned char>>& images) {
+    size_t size = uplink_wire::kMessageHeaderBytes + document.size();
+    for (const auto& image : images) size += 4 + image.size();
+    std::vector<unsigned char> out;
+    out.reserve(size);
+    appendLittleEndian(out, uplink_wire::kMessageMagic);
+    out.push_back(kind);
+    out.push_back(0);
+    appendLittleEndian(out, static_cast<uint16_t>(images.size()));
+    appendLittleEndian(out, static_cast<uint32_t>(document.size()));
+    out.insert(out.end(), document.begin(), document.end());
+    for (const auto& image : images) {
+        appendLittleEndian(out, static_cast<uint32_t>(image.size()));
+        out.insert(out.end(), image.begin(), image.end());
+    }
+    return out;
+}
+
+bool readFile(const std::string& path, std::vector<unsigned char>& bytes) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) return false;
+    bytes.resize(static_cast<size_t>(in.tellg()));
+    in.seekg(0);
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(bytes.data()), bytes.size()));
+}
+
+bool sendAll(int fd, const unsigned char* data, size_t size) {
+    while (size > 0) {
+        const ssize_t n = ::send(fd, data, size, kSendFlags);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            return false;  // Timed out (SO_SNDTIMEO) or reset
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Connected blocking socket, or -1 once every address failed or timed out
+int connectTo(const std::string& host, const std::string& port) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0) return -1;
+    int fd = -1;
+    for (addrinfo* address = addresses; address && fd < 0; address = address->ai_next) {
+        fd = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (fd < 0) continue;
+        const int flags = fcntl(fd, F_GETFL, 0);
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+        bool connected = ::connect(fd, address->ai_addr, address->ai_addrlen) == 0;
+        if (!connected && errno == EINPROGRESS) {
+            pollfd pending{fd, POLLOUT, 0};
+            int error = 0;
+            socklen_t length = sizeof(error);
+            connected = ::poll(&pending, 1, kConnectTimeoutMs) == 1 &&
+                        getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0;
+        }
+        if (!connected) {
+            ::close(fd);
+            fd = -1;
+            continue;
+        }
+        fcntl(fd, F_SETFL, flags);
+        timeval timeout{kSendTimeoutSec, 0};
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        const int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+#ifdef SO_NOSIGPIPE
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    }
+    freeaddrinfo(addresses);
+    return fd;
+}
+
+int64_t unixMillisecondsNow() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+std::vector<fs::path> spoolSegments(const std::string& directory) {
+    std::vector<fs::path> segments;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(directory, ec)) {
+        const std::string name = entry.path().filename().string();
+        if (name.rfind("segment_", 0) == 0 && entry.path().extension() == ".seg") segments.push_back(entry.path());
+    }
+    std::sort(segments.begin(), segments.end());  // Zero-padded indices: oldest first
+    return segments;
+}
+
+}  // namespace
+
+UplinkPersistenceBackend::UplinkPersistenceBackend(const PersistenceBackendConfig& config) : config_(config) {
+    // host:port, or [v6 address]:port
+    const size_t colon = config_.uplinkEndpoint.rfind(':');
+    host_ = config_.uplinkEndpoint.substr(0, colon);
+    port_ = colon == std::string::npos ? "7450" : config_.uplinkEndpoint.substr(colon + 1);
+    if (host_.size() > 2 && host_.front() == '[' && host_.back() == ']') host_ = host_.substr(1, host_.size() - 2);
+    recoverSpool();
+}
+
+UplinkPersistenceBackend::~UplinkPersistenceBackend() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) thread_.join();
+    const UplinkStats totals = stats();
+    LOG_INFO("Uplink: {} messages acknowledged ({} bytes), {} spooled, {} left in the spool, {} lost",
+             totals.acknowledged, totals.bytesAcknowledged, totals.spooled, totals.spoolDepth,
+             totals.spoolFailures);
+}
+
+bool UplinkPersistenceBackend::connect() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!started_) {
+        started_ = true;
+        thread_ = std::thread(&UplinkPersistenceBackend::run, this);
+    }
+    return true;
+}
+
+std::vector<std::string> UplinkPersistenceBackend::insertRecords(const std::vector<StoredFrameRecord>& records) {
+    std::vector<std::string> accepted;
+    const int64_t now = unixMillisecondsNow();
+    std::vector<std::vector<unsigned char>> crops;
+    for (const StoredFrameRecord& record : records) {
+        crops.resize(record.regionCrops.size());
+        bool readable = true;
+        for (size_t i = 0; i < crops.size() && readable; ++i) {
+            readable = readFile(record.regionCrops[i].path, crops[i]);
+        }
+        // A background plate rides along (after the crops) with the first document naming it
+        const bool sendPlate = readable && !record.plate.id.empty() && record.plate.id != lastPlateSent_;
+        if (sendPlate) {
+            crops.emplace_back();
+            readable = readFile(record.plate.path, crops.back());
+        }
+        if (!readable) {
+            LOG_ERROR("Uplink: region crops of frame {} could not be read", record.uuid);
+            continue;
+        }
+        Message message;
+        message.bytes = encodeMessage(uplink_wire::kFrameMessage, frameDocumentJson(record, now), crops);
+        if (!enqueue(std::move(message))) continue;
+        accepted.push_back(record.uuid);
+        if (sendPlate) lastPlateSent_ = record.plate.id;
+    }
+    return accepted;
+}
+
+bool UplinkPersistenceBackend::upsertMotionSummaries(const std::vector<MotionMinuteSummary>& summaries) {
+    const int64_t now = unixMillisecondsNow();
+    bool ok = true;
+    for (const MotionMinuteSummary& summary : summaries) {
+        Message message;
+        message.bytes = encodeMessage(uplink_wire::kSummaryMessage, motionSummaryJson(summary, now), {});
+        ok = enqueue(std::move(message)) && ok;
+    }
+    return ok;
+}
+
+UplinkStats UplinkPersistenceBackend::stats() const {
+    UplinkStats stats;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats.connected = linkUp_;
+        stats.spoolDepth = spooled_.size();
+        stats.inFlightBytes = inFlightBytes_;
+    }
+    stats.connects = connects_.load();
+    stats.sent = sent_.load();
+    stats.acknowledged = acknowledged_.load();
+    stats.spooled = spooledCount_.load();
+    stats.spoolFailures = spoolFailures_.load();
+    stats.bytesAcknowledged = bytesAcknowledged_.load();
+    return stats;
+}
+
+bool UplinkPersistenceBackend::enqueue(Message message) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Behind a spool the outbox would overtake it; beyond the window the link is not keeping up
+    if (linkUp_ && spooled_.empty() &&
+        outboxBytes_ + inFlightBytes_ + message.bytes.size() <= config_.uplinkWindowBytes) {
+        outboxBytes_ += message.bytes.size();
+        outbox_.push_back(std::move(message));
+        return true;
+    }
+    return spool(message.bytes);
+}
+
+bool UplinkPersistenceBackend::spool(const std::vector<unsigned char>& bytes) {
+    if (!spoolStore_) {
+        SegmentStoreConfig spoolConfig;
+        spoolConfig.directory = config_.uplinkSpoolPath;
+        spoolConfig.segmentBytes = kSpoolSegmentBytes;
+        spoolStore_ = std::make_unique<FrameSegmentStore>(spoolConfig);
+    }
+    SegmentExtent extent = spoolStore_->append(bytes);
+    if (extent.empty()) {
+        spoolFailures_++;
+        return false;
+    }
+    spooled_.push_back(std::move(extent));
+    spooledCount_++;
+    return true;
+}
+
+void UplinkPersistenceBackend::recoverSpool() {
+    for (const fs::path& segment : spoolSegments(config_.uplinkSpoolPath)) {
+        std::ifstream in(segment, std::ios::binary);
+        std::error_code ec;
+        const uint64_t fileSize = fs::file_size(segment, ec);
+        uint64_t offset = 0;
+        // Walk the messages by their length fields; a crash mid-append ends the segment early
+        for (;;) {
+            unsigned char header[uplink_wire::kMessageHeaderBytes];
+            in.seekg(static_cast<std::streamoff>(offset));
+            if (!in.read(reinterpret_cast<char*>(header), sizeof(header))) break;
+            if (readLittleEndian(header, 4) != uplink_wire::kMessageMagic) break;
+            uint64_t length = sizeof(header) + readLittleEndian(header + 8, 4);
+            const uint64_t images = readLittleEndian(header + 6, 2);
+            bool complete = true;
+            for (uint64_t i = 0; i < images && complete; ++i) {
+                unsigned char imageLength[4];
+                in.seekg(static_cast<std::streamoff>(offset + length));
+                complete = static_cast<bool>(in.read(reinterpret_cast<char*>(imageLength), sizeof(imageLength)));
+                length += sizeof(imageLength) + readLittleEndian(imageLength, 4);
+            }
+            if (!complete || offset + length > fileSize) break;
+            spooled_.push_back({segment.string(), offset, length});
+            offset += length;
+        }
+    }
+    if (!spooled_.empty()) {
+        LOG_INFO("Uplink: {} spooled messages from the previous run to send", spooled_.size());
+    }
+}
+
+void UplinkPersistenceBackend::clearSpool() {
+    spoolStore_.reset();
+    std::error_code ec;
+    for (const fs::path& segment : spoolSegments(config_.uplinkSpoolPath)) fs::remove(segment, ec);
+}
+
+bool UplinkPersistenceBackend::nextMessage(Message& message) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto fits = [this](size_t size) {
+        return inFlightBytes_ == 0 || inFlightBytes_ + size <= config_.uplinkWindowBytes;
+    };
+    while (spoolSending_ < spooled_.size()) {
+        const SegmentExtent& extent = spooled_[spoolSending_];
+        if (!fits(extent.length)) return false;
+        if (!FrameSegmentStore::read(extent, message.bytes)) {
+            LOG_ERROR("Uplink: spooled message in {} at {} unreadable, dropped", extent.file, extent.offset);
+            spooled_.erase(spooled_.begin() + static_cast<std::ptrdiff_t>(spoolSending_));
+            spoolFailures_++;
+            continue;
+        }
+        message.fromSpool = true;
+        spoolSending_++;
+        inFlightBytes_ += message.bytes.size();
+        return true;
+    }
+    if (outbox_.empty() || !fits(outbox_.front().bytes.size())) return false;
+    message = std::move(outbox_.front());
+    outbox_.pop_front();
+    outboxBytes_ -= message.bytes.size();
+    inFlightBytes_ += message.bytes.size();
+    return true;
+}
+
+void UplinkPersistenceBackend::acknowledge(uint64_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool replayed = false;
+    for (; count > 0 && !inFlight_.empty(); --count) {
+        const Message& message = inFlight_.front();
+        inFlightBytes_ -= message.bytes.size();
+        bytesAcknowledged_ += message.bytes.size();
+        acknowledged_++;
+        if (message.fromSpool) {
+            spooled_.pop_front();
+            spoolSending_--;
+            replayed = true;
+        }
+        inFlight_.pop_front();
+    }
+    if (replayed && spooled_.empty()) clearSpool();  // Also the segments left by a previous run
+}
+
+void UplinkPersistenceBackend::run() {
+    nameCurrentThread("uplink");
+    auto retry = std::chrono::duration_cast<std::chrono::milliseconds>(kMinRetry);
+    bool outageLogged = false;
+    uint64_t acknowledgedOnConnection = 0;
+    unsigned char ack[8];
+    size_t ackFill = 0;
+    auto lastProgress = std::chrono::steady_clock::now();
+
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) break;
+        }
+        if (fd_ < 0) {
+            if (!openConnection()) {
+                if (!outageLogged) {
+                    LOG_WARN("Uplink: aggregator {}:{} unreachable; spooling to {} and retrying", host_, port_,
+                             config_.uplinkSpoolPath);
+                    outageLogged = true;
+                }
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait_for(lock, retry, [this] { return stopping_; });
+                retry = std::min(retry * 2, std::chrono::duration_cast<std::chrono::milliseconds>(kMaxRetry));
+                continue;
+            }
+            outageLogged = false;
+            retry = std::chrono::duration_cast<std::chrono::milliseconds>(kMinRetry);
+            acknowledgedOnConnection = 0;
+            ackFill = 0;
+            lastProgress = std::chrono::steady_clock::now();
+        }
+
+        // Fill the window
+        Message message;
+        bool sendFailed = false;
+        while (!sendFailed && nextMessage(message)) {
+            sendFailed = !sendAll(fd_, message.bytes.data(), message.bytes.size());
+            if (!sendFailed) sent_++;
+            inFlight_.push_back(std::move(message));  // Even a failed one: closeConnection() spools it
+            message = Message();
+        }
+        if (sendFailed) {
+            LOG_WARN("Uplink: send to {}:{} failed ({}); reconnecting", host_, port_, std::strerror(errno));
+            closeConnection();
+            continue;
+        }
+
+        // Collect acks; each is the running count of this connection's stored messages
+        pollfd readable{fd_, POLLIN, 0};
+        if (::poll(&readable, 1, kPollIntervalMs) > 0) {
+            bool closed = false;
+            for (;;) {
+                const ssize_t n = ::recv(fd_, ack + ackFill, sizeof(ack) - ackFill, MSG_DONTWAIT);
+                if (n > 0) {
+                    ackFill += static_cast<size_t>(n);
+                    if (ackFill < sizeof(ack)) continue;
+                    ackFill = 0;
+                    const uint64_t total = readLittleEndian(ack, sizeof(ack));
+                    if (total > acknowledgedOnConnection) {
+                        acknowledge(total - acknowledgedOnConnection);
+                        acknowledgedOnConnection = total;
+                        lastProgress = std::chrono::steady_clock::now();
+                    }
+                    continue;
+                }
+                if (n < 0 && errno == EINTR) continue;
+                closed = n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+                break;
+            }
+            if (closed) {
+                LOG_WARN("Uplink: aggregator {}:{} closed the connection", host_, port_);
+                closeConnection();
+                continue;
+            }
+        }
+        if (inFlight_.empty()) {
+            lastProgress = std::chrono::steady_clock::now();
+        } else if (std::chrono::steady_clock::now() - lastProgress > kAckTimeout) {
+            LOG_WARN("Uplink: no ack from {}:{} for {} s; reconnecting", host_, port_, kAckTimeout.count());
+            closeConnection();
+        }
+    }
+    closeConnection();
+}
+
+bool UplinkPersistenceBackend::openConnection() {
+    const int fd = connectTo(host_, port_);
+    if (fd < 0) return false;
+
+    std::string site = config_.uplinkSite;
+    if (site.empty()) {
+        char hostname[256] = {};
+        gethostname(hostname, sizeof(hostname) - 1);
+        site = hostname;
+    }
+    std::vector<unsigned char> hello;
+    appendLittleEndian(hello, uplink_wire::kHelloMagic);
+    appendLittleEndian(hello, uplink_wire::kVersion);
+    appendLittleEndian(hello, static_cast<uint16_t>(site.size()));
+    hello.insert(hello.end(), site.begin(), site.end());
+    if (!sendAll(fd, hello.data(), hello.size())) {
+        ::close(fd);
+        return false;
+    }
+
+    fd_ = fd;
+    connects_++;
+    size_t spooled = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        linkUp_ = true;
+        spooled = spooled_.size();
+    }
+    LOG_INFO("Uplink: connected to {}:{} as {} ({} spooled messages to send)", host_, port_, site, spooled);
+    return true;
+}
+
+void UplinkPersistenceBackend::closeConnection() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    linkUp_ = false;
+    // Spooled messages stay where they are and are resent from the front; the rest joins them
+    for (const Message& message : inFlight_) {
+        if (!message.fromSpool) spool(message.bytes);
+    }
+    for (const Message& message : outbox_) spool(message.bytes);
+    inFlight_.clear();
+    inFlightBytes_ = 0;
+    outbox_.clear();
+    outboxBytes_ = 0;
+    spoolSending_ = 0;
+}
@@ -0,0 +1,1032 @@
+#include "uplink_ingest.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <opencv2/imgcodecs.hpp>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "image_encoder.hpp"
+#include "logger.hpp"
+#include "thread_placement.hpp"
+#include "uplink_backend.hpp"
+
+#ifdef __linux__
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr size_t kHelloBytes = 8;
+constexpr size_t kRetainedBufferBytes = 256u << 10;  // Larger decode buffers are released once empty
+constexpr size_t kReadChunkBytes = 64u << 10;
+constexpr size_t kMaxReadPerEvent = 1u << 20;  // Per connection and wakeup, so one edge cannot starve the rest
+constexpr int kEpollTimeoutMs = 100;
+constexpr uint64_t kListenId = 0;  // epoll_event.data.u64 of the listening socket
+constexpr uint64_t kWakeId = 1;    // ... and of wakeFd_; connections count up from 2
+
+uint64_t readLittleEndian(const unsigned char* data, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) value |= static_cast<uint64_t>(data[i]) << (8 * i);
+    return value;
+}
+
+// [A-Za-z0-9._-]: the characters a name from an edge may use in a path under cropPath
+bool isFileNameChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '.' || c == '_' || c == '-';
+}
+
+// The site becomes a directory under cropPath: any other character is replaced
+std::string sanitizeSite(const std::string& site) {
+    std::string out = site;
+    for (char& c : out) {
+        if (!isFileNameChar(c)) c = '_';
+    }
+    if (out.empty() || out == "." || out == "..") return "unknown";
+    return out;
+}
+
+// Document ids name files under cropPath too, but are also database keys: rewriting one
+// would store the frame under a different id than the edge acknowledges, so it is refused
+bool isSafeFileName(const std::string& name) {
+    return !name.empty() && name != "." && name != ".." && std::all_of(name.begin(), name.end(), isFileNameChar);
+}
+
+// A background plate keeps the extension of the edge's file: only one an ImageCodec writes
+bool isImageExtension(const std::string& extension) {
+    for (const ImageCodec codec : {ImageCodec::Jpeg, ImageCodec::WebP, ImageCodec::Avif, ImageCodec::JpegXl}) {
+        if (extension == imageCodecExtension(codec)) return true;
+    }
+    return false;
+}
+
+/**
+ * Just enough JSON for the documents frameDocumentJson() and motionSummaryJson() write:
+ * a small tree, numbers as doubles (exact below 2^53), no comments or NaN. yaml-cpp reads
+ * the same text but takes about 20 times longer, and the decode threads parse every
+ * document an edge sends.
+ */
+struct JsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object };
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> items;                            // Array
+    std::vector<std::pair<std::string, JsonValue>> members;  // Object, in document order
+
+    const JsonValue* find(const char* key) const {
+        for (const auto& member : members) {
+            if (member.first == key) return &member.second;
+        }
+        return nullptr;
+    }
+};
+
+class JsonReader {
+   public:
+    explicit JsonReader(const std::string& text) : p_(text.data()), end_(text.data() + text.size()) {}
+
+    // The whole text as one value; false if it is not valid JSON
+    bool read(JsonValue& value) {
+        if (!parseValue(value, 0)) return false;
+        skipSpace();
+        return p_ == end_;
+    }
+
+   private:
+    static constexpr int kMaxDepth = 16;
+
+    void skipSpace() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) ++p_;
+    }
+
+    bool consume(char c) {
+        skipSpace();
+        if (p_ == end_ || *p_ != c) return false;
+        ++p_;
+        return true;
+    }
+
+    bool literal(const char* word) {
+        const size_t length = std::strlen(word);
+        if (static_cast<size_t>(end_ - p_) < length || std::memcmp(p_, word, length) != 0) return false;
+        p_ += length;
+        return true;
+    }
+
+    bool parseValue(JsonValue& value, int depth) {
+        skipSpace();
+        if (p_ == end_ || depth > kMaxDepth) return false;
+        switch (*p_) {
+            case '{':
+                value.type = JsonValue::Type::Object;
+                ++p_;
+                if (consume('}')) return true;
+                do {
+                    std::string key;
+                    skipSpace();
+                    if (!parseString(key) || !consume(':')) return false;
+                    value.members.emplace_back(std::move(key), JsonValue());
+                    if (!parseValue(value.members.back().second, depth + 1)) return false;
+                } while (consume(','));
+                return consume('}');
+            case '[':
+                value.type = JsonValue::Type::Array;
+                ++p_;
+                if (consume(']')) return true;
+                do {
+                    value.items.emplace_back();
+                    if (!parseValue(value.items.back(), depth + 1)) return false;
+                } while (consume(','));
+                return consume(']');
+            case '"':
+                value.type = JsonValue::Type::String;
+                return parseString(value.string);
+            case 't':
+                value.type = JsonValue::Type::Bool;
+                value.boolean = true;
+                return literal("true");
+            case 'f':
+                value.type = JsonValue::Type::Bool;
+                return literal("false");
+            case 'n':
+                return literal("null");
+            default: {
+                // std::string keeps a terminating NUL, so strtod stops inside the text
+                char* numberEnd = nullptr;
+                value.type = JsonValue::Type::Number;
+                value.number = std::strtod(p_, &numberEnd);
+                if (numberEnd == p_ || numberEnd > end_) return false;
+                p_ = numberEnd;
+                return true;
+            }
+        }
+    }
+
+    bool parseHex(uint32_t& code) {
+        if (end_ - p_ < 4) return false;
+        code = 0;
+        for (int i = 0; i < 4; ++i, ++p_) {
+            const char c = *p_;
+            code <<= 4;
+            if (c >= '0' && c <= '9') {
+                code |= static_cast<uint32_t>(c - '0');
+            } else if (c >= 'a' && c <= 'f') {
+                code |= static_cast<uint32_t>(c - 'a' + 10);
+            } else if (c >= 'A' && c <= 'F') {
+                code |= static_cast<uint32_t>(c - 'A' + 10);
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static void appendUtf8(std::string& out, uint32_t code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    // p_ at the opening quote
+    bool parseString(std::string& out) {
+        if (p_ == end_ || *p_ != '"') return false;
+        ++p_;
+        for (;;) {
+            const char* run = p_;
+            while (p_ < end_ && *p_ != '"' && *p_ != '\\') ++p_;
+            out.append(run, p_);
+            if (p_ == end_) return false;
+            if (*p_++ == '"') return true;
+            if (p_ == end_) return false;
+            const char escaped = *p_++;
+            switch (escaped) {
+                case '"':
+                case '\\':
+                case '/':
+                    out += escaped;
+                    break;
+                case 'b':
+                    out += '\b';
+                    break;
+                case 'f':
+                    out += '\f';
+                    break;
+                case 'n':
+                    out += '\n';
+                    break;
+                case 'r':
+                    out += '\r';
+                    break;
+                case 't':
+                    out += '\t';
+                    break;
+                case 'u': {
+                    uint32_t code = 0;
+                    if (!parseHex(code)) return false;
+                    if (code >= 0xD800 && code < 0xDC00) {  // High surrogate: its pair follows
+                        uint32_t low = 0;
+                        if (end_ - p_ < 2 || p_[0] != '\\' || p_[1] != 'u') return false;
+                        p_ += 2;
+                        if (!parseHex(low) || low < 0xDC00 || low >= 0xE000) return false;
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    appendUtf8(out, code);
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+    }
+
+    const char* p_;
+    const char* end_;
+};
+
+const JsonValue* member(const JsonValue* object, const char* key) {
+    return object && object->type == JsonValue::Type::Object ? object->find(key) : nullptr;
+}
+
+std::string text(const JsonValue* value, const std::string& fallback = "") {
+    return value && value->type == JsonValue::Type::String ? value->string : fallback;
+}
+
+double number(const JsonValue* value, double fallback = 0.0) {
+    return value && value->type == JsonValue::Type::Number ? value->number : fallback;
+}
+
+int integer(const JsonValue* value, int fallback = 0) { return static_cast<int>(number(value, fallback)); }
+
+bool flag(const JsonValue* value, bool fallback) {
+    return value && value->type == JsonValue::Type::Bool ? value->boolean : fallback;
+}
+
+// Elements of an array member; none if it is missing or not an array
+const std::vector<JsonValue>& elements(const JsonValue* value) {
+    static const std::vector<JsonValue> none;
+    return value && value->type == JsonValue::Type::Array ? value->items : none;
+}
+
+// {"$date": "YYYY-MM-DDTHH:MM:SS.mmmZ"} as Unix milliseconds, as appendDate() writes it
+bool parseDate(const JsonValue* value, int64_t& unixMs) {
+    const JsonValue* date = member(value, "$date");
+    if (!date || date->type != JsonValue::Type::String) return false;
+    std::tm utc{};
+    int millis = 0;
+    if (std::sscanf(date->string.c_str(), "%d-%d-%dT%d:%d:%d.%dZ", &utc.tm_year, &utc.tm_mon, &utc.tm_mday,
+                    &utc.tm_hour, &utc.tm_min, &utc.tm_sec, &millis) < 6) {
+        return false;
+    }
+    utc.tm_year -= 1900;
+    utc.tm_mon -= 1;
+    unixMs = static_cast<int64_t>(timegm(&utc)) * 1000 + millis;
+    return true;
+}
+
+int64_t floorDivide(int64_t value, int64_t divisor) {
+    return value >= 0 ? value / divisor : (value - divisor + 1) / divisor;
+}
+
+cv::Rect rectFromArray(const JsonValue* value) {
+    const std::vector<JsonValue>& items = elements(value);
+    if (items.size() != 4) return {};
+    return {integer(&items[0]), integer(&items[1]), integer(&items[2]), integer(&items[3])};
+}
+
+cv::Rect rectFromBox(const JsonValue& box) {
+    return {integer(member(&box, "x")), integer(member(&box, "y")), integer(member(&box, "width")),
+            integer(member(&box, "height"))};
+}
+
+void parseShape(const JsonValue* value, cv::Size& size, int& channels) {
+    const std::vector<JsonValue>& items = elements(value);
+    if (items.size() < 3) return;
+    size = cv::Size(integer(&items[1]), integer(&items[0]));
+    channels = integer(&items[2]);
+}
+
+void parseMetadata(const JsonValue& node, FrameMetadata& metadata) {
+    metadata.source = text(member(&node, "source"), metadata.source);
+    metadata.frameCount = integer(member(&node, "frame_count"));
+    int64_t unixMs = 0;
+    if (parseDate(member(&node, "timestamp"), unixMs)) metadata.timestamp = floorDivide(unixMs, 1000);
+    metadata.autoSaved = flag(member(&node, "auto_saved"), true);
+    metadata.motionDetected = flag(member(&node, "motion_detected"), false);
+    metadata.motionRegions = integer(member(&node, "motion_regions"));
+    metadata.confidence = number(member(&node, "confidence"));
+    for (const JsonValue& entry : elements(member(&node, "consolidated_regions"))) {
+        RegionMetadata region;
+        region.box = rectFromBox(entry);
+        region.objectCount = integer(member(&entry, "object_count"));
+        region.classLabel = text(member(&entry, "class_label"), region.classLabel);
+        region.classConfidence = static_cast<float>(number(member(&entry, "class_confidence")));
+        region.classId = integer(member(&entry, "class_id"), -1);
+        region.speed = static_cast<float>(number(member(&entry, "speed")));
+        region.direction = static_cast<float>(number(member(&entry, "direction")));
+        metadata.consolidatedRegions.push_back(std::move(region));
+    }
+    if (const JsonValue* boxes = member(&node, "motion_boxes")) {
+        metadata.includeMotionBoxes = true;
+        for (const JsonValue& box : elements(boxes)) metadata.motionBoxes.push_back(rectFromBox(box));
+    }
+    if (parseDate(member(&node, "capture_time"), unixMs)) {
+        metadata.captureTimeUs = unixMs * 1000;
+        metadata.sourceTimestampMs = number(member(&node, "source_timestamp_ms"));
+        if (const JsonValue* latency = member(&node, "latency_ms")) {
+            metadata.latency.detectQueuedMs = number(member(latency, "detect_queued"));
+            metadata.latency.detectMs = number(member(latency, "detect"));
+            metadata.latency.consolidateQueuedMs = number(member(latency, "consolidate_queued"));
+            metadata.latency.consolidateMs = number(member(latency, "consolidate"));
+            metadata.latency.renderQueuedMs = number(member(latency, "render_queued"));
+            metadata.latency.totalMs = number(member(latency, "total"));
+        }
+    }
+    if (const JsonValue* mask = member(&node, "motion_mask")) {
+        MotionMaskMetadata& motionMask = metadata.motionMask;
+        motionMask.size = cv::Size(integer(member(mask, "width")), integer(member(mask, "height")));
+        if (const JsonValue* roi = member(mask, "roi")) motionMask.frameArea = rectFromBox(*roi);
+        motionMask.pixels = static_cast<int64_t>(number(member(mask, "pixels")));
+        if (const JsonValue* bounds = member(mask, "bounds")) motionMask.bounds = rectFromBox(*bounds);
+        if (const JsonValue* centroid = member(mask, "centroid")) {
+            motionMask.centroid = cv::Point2d(number(member(centroid, "x")), number(member(centroid, "y")));
+        }
+        motionMask.counts = text(member(mask, "counts"));
+    }
+    if (const JsonValue* visit = member(&node, "visit")) {
+        metadata.isVisit = true;
+        if (parseDate(member(visit, "start_time"), unixMs)) metadata.visit.startUs = unixMs * 1000;
+        if (parseDate(member(visit, "end_time"), unixMs)) metadata.visit.endUs = unixMs * 1000;
+        metadata.visit.frames = integer(member(visit, "frames"));
+        for (const JsonValue& id : elements(member(visit, "track_ids"))) {
+            metadata.visit.trackIds.push_back(integer(&id));
+        }
+        for (const JsonValue& point : elements(member(visit, "path"))) {
+            metadata.visit.path.push_back({cv::Point(integer(member(&point, "x")), integer(member(&point, "y"))),
+                                           static_cast<int64_t>(number(member(&point, "t_ms")))});
+        }
+        for (const JsonValue& score : elements(member(visit, "crop_scores"))) {
+            metadata.visit.cropScores.push_back(number(&score));
+        }
+    }
+}
+
+bool writeFile(const std::string& path, const std::vector<unsigned char>& bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(out);
+}
+
+}  // namespace
+
+bool parseFrameDocument(const std::string& json, StoredFrameRecord& record) {
+    JsonValue document;
+    if (!JsonReader(json).read(document)) return false;
+    const JsonValue* id = member(&document, "_id");
+    const JsonValue* metadata = member(&document, "metadata");
+    if (!id || id->type != JsonValue::Type::String || !isSafeFileName(id->string) || !metadata ||
+        metadata->type != JsonValue::Type::Object) {
+        return false;
+    }
+    record = StoredFrameRecord{};
+    record.uuid = id->string;
+    record.originalPath = text(member(&document, "original_image_path"));
+    record.processedPath = text(member(&document, "processed_image_path"));
+    record.originalThumbnailPath = text(member(&document, "original_thumbnail_path"));
+    record.processedThumbnailPath = text(member(&document, "processed_thumbnail_path"));
+    for (const auto& image : {std::make_pair("original_image_segment", &record.originalSegment),
+                              std::make_pair("processed_image_segment", &record.processedSegment),
+                              std::make_pair("original_thumbnail_segment", &record.originalThumbnailSegment),
+                              std::make_pair("processed_thumbnail_segment", &record.processedThumbnailSegment)}) {
+        const JsonValue* extent = member(&document, image.first);
+        if (!extent) continue;
+        image.second->file = text(member(extent, "file"));
+        image.second->offset = static_cast<uint64_t>(number(member(extent, "offset")));
+        image.second->length = static_cast<uint64_t>(number(member(extent, "length")));
+        image.second->contentType = text(member(extent, "content_type"));
+    }
+    if (const JsonValue* images = member(&document, "images")) {
+        for (const auto& image : {std::make_pair("original", &record.originalBytes),
+                                  std::make_pair("processed", &record.processedBytes),
+                                  std::make_pair("original_thumbnail", &record.originalThumbnailBytes),
+                                  std::make_pair("processed_thumbnail", &record.processedThumbnailBytes)}) {
+            *image.second = static_cast<uint64_t>(number(member(member(images, image.first), "bytes")));
+        }
+    }
+    for (const JsonValue& entry : elements(member(&document, "region_crops"))) {
+        record.regionCrops.push_back({text(member(&entry, "path")), rectFromArray(member(&entry, "region")),
+                                      rectFromArray(member(&entry, "crop")),
+                                      static_cast<uint64_t>(number(member(&entry, "bytes")))});
+    }
+    if (const JsonValue* plate = member(&document, "background_plate")) {
+        record.plate.id = text(member(plate, "id"));
+        record.plate.path = text(member(plate, "path"));
+        const std::vector<JsonValue>& size = elements(member(plate, "size"));
+        if (size.size() == 2) record.plate.size = cv::Size(integer(&size[0]), integer(&size[1]));
+        // The plate is stored as cropPath/<site>/plates/<id><extension>
+        if (!record.plate.id.empty() &&
+            (!isSafeFileName(record.plate.id) ||
+             !isImageExtension(fs::path(record.plate.path).extension().string()))) {
+            return false;
+        }
+    }
+    parseShape(member(&document, "frame_shape"), record.processedSize, record.processedChannels);
+    parseShape(member(&document, "original_frame_shape"), record.originalSize, record.originalChannels);
+    parseMetadata(*metadata, record.metadata);
+    return true;
+}
+
+bool parseMotionSummary(const std::string& json, MotionMinuteSummary& summary) {
+    JsonValue document;
+    int64_t minuteMs = 0;
+    if (!JsonReader(json).read(document)) return false;
+    const JsonValue* source = member(&document, "source");
+    if (!source || source->type != JsonValue::Type::String || !parseDate(member(&document, "minute"), minuteMs)) {
+        return false;
+    }
+    summary = MotionMinuteSummary{};
+    summary.source = source->string;
+    summary.minuteStart = floorDivide(minuteMs, 1000);
+    summary.frames = static_cast<uint64_t>(number(member(&document, "frames")));
+    summary.motionFrames = static_cast<uint64_t>(number(member(&document, "motion_frames")));
+    summary.motionBoxes = static_cast<uint64_t>(number(member(&document, "motion_boxes")));
+    summary.regions = static_cast<uint64_t>(number(member(&document, "regions")));
+    summary.maxRegions = static_cast<uint64_t>(number(member(&document, "max_regions")));
+    summary.latencyP50Ms = number(member(&document, "latency_p50_ms"));
+    summary.latencyP95Ms = number(member(&document, "latency_p95_ms"));
+    summary.latencyP99Ms = number(member(&document, "latency_p99_ms"));
+    summary.latencyMaxMs = number(member(&document, "latency_max_ms"));
+    return true;
+}
+
+bool UplinkStreamDecoder::fail(std::string error) {
+    error_ = std::move(error);
+    buffer_.clear();
+    consumed_ = 0;
+    return false;
+}
+
+bool UplinkStreamDecoder::feed(const unsigned char* data, size_t size, std::vector<Message>& out) {
+    if (!error_.empty()) return false;
+    buffer_.insert(buffer_.end(), data, data + size);
+    for (;;) {
+        const unsigned char* p = buffer_.data() + consumed_;
+        const size_t available = buffer_.size() - consumed_;
+        if (!hasHello_) {
+            if (available < kHelloBytes) break;
+            if (readLittleEndian(p, 4) != uplink_wire::kHelloMagic) return fail("not an uplink hello");
+            const uint64_t version = readLittleEndian(p + 4, 2);
+            if (version != uplink_wire::kVersion) {
+                return fail("unsupported uplink version " + std::to_string(version));
+            }
+            const size_t siteLength = readLittleEndian(p + 6, 2);
+            if (available < kHelloBytes + siteLength) break;
+            site_ = sanitizeSite(std::string(reinterpret_cast<const char*>(p + kHelloBytes), siteLength));
+            hasHello_ = true;
+            consumed_ += kHelloBytes + siteLength;
+            continue;
+        }
+
+        if (available < uplink_wire::kMessageHeaderBytes) break;
+        if (readLittleEndian(p, 4) != uplink_wire::kMessageMagic) return fail("bad message magic");
+        const uint8_t kind = p[4];
+        if (kind != uplink_wire::kFrameMessage && kind != uplink_wire::kSummaryMessage) {
+            return fail("unknown message kind " + std::to_string(kind));
+        }
+        const size_t imageCount = readLittleEndian(p + 6, 2);
+        const size_t documentLength = readLittleEndian(p + 8, 4);
+        // Walk the image lengths that have arrived; the whole message must fit maxMessageBytes
+        size_t end = uplink_wire::kMessageHeaderBytes + documentLength;
+        bool complete = available >= end;
+        for (size_t i = 0; i < imageCount && complete; ++i) {
+            if (available < end + 4) {
+                complete = false;
+                break;
+            }
+            end += 4 + readLittleEndian(p + end, 4);
+            complete = available >= end;
+        }
+        if (end > maxMessageBytes_) return fail("message larger than " + std::to_string(maxMessageBytes_) + " bytes");
+        if (!complete) break;
+
+        Message message;
+        message.kind = kind;
+        message.document.assign(reinterpret_cast<const char*>(p + uplink_wire::kMessageHeaderBytes), documentLength);
+        size_t offset = uplink_wire::kMessageHeaderBytes + documentLength;
+        message.images.resize(imageCount);
+        for (auto& image : message.images) {
+            const size_t length = readLittleEndian(p + offset, 4);
+            image.assign(p + offset + 4, p + offset + 4 + length);
+            offset += 4 + length;
+        }
+        out.push_back(std::move(message));
+        consumed_ += end;
+    }
+
+    if (consumed_ == buffer_.size()) {
+        buffer_.clear();
+        consumed_ = 0;
+        if (buffer_.capacity() > kRetainedBufferBytes) buffer_.shrink_to_fit();
+    } else if (consumed_ > buffer_.size() / 2) {
+        buffer_.erase(buffer_.begin(), buffer_.begin() + static_cast<std::ptrdiff_t>(consumed_));
+        consumed_ = 0;
+    }
+    return true;
+}
+
+// I/O thread state of one edge
+struct UplinkIngestServer::Connection {
+    explicit Connection(int fd, size_t maxMessageBytes) : fd(fd), decoder(maxMessageBytes) {}
+
+    int fd;
+    UplinkStreamDecoder decoder;
+    uint64_t received = 0;          // Messages handed to the decode threads
+    uint64_t completedThrough = 0;  // Every message up to this one is stored
+    std::set<uint64_t> completedAhead;
+    uint64_t acknowledged = 0;      // Count in the last ack written
+    unsigned char ack[8] = {};
+    size_t ackOffset = 8;           // Bytes of ack already written (8 = none pending)
+    bool waitingWritable = false;
+};
+
+UplinkIngestServer::UplinkIngestServer(const UplinkIngestConfig& config, std::unique_ptr<PersistenceBackend> backend,
+                                       std::unique_ptr<ClassificationBatcher> classifier)
+    : config_(config),
+      backend_(std::move(backend)),
+      classifier_(std::move(classifier)),
+      decodeQueue_(std::max<size_t>(1, config.queueCapacity)),
+      writeQueue_(std::max<size_t>(1, config.queueCapacity)) {}
+
+UplinkIngestServer::~UplinkIngestServer() { stop(); }
+
+bool UplinkIngestServer::start() {
+#ifdef __linux__
+    if (ioThread_.joinable()) return true;
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* addresses = nullptr;
+    const std::string port = std::to_string(config_.port);
+    const int status = ::getaddrinfo(config_.listenAddress.empty() ? nullptr : config_.listenAddress.c_str(),
+                                     port.c_str(), &hints, &addresses);
+    if (status != 0) {
+        LOG_ERROR("Uplink ingest cannot resolve {}: {}", config_.listenAddress, gai_strerror(status));
+        return false;
+    }
+    for (addrinfo* address = addresses; address && listenFd_ < 0; address = address->ai_next) {
+        const int fd = ::socket(address->ai_family, address->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                                address->ai_protocol);
+        if (fd < 0) continue;
+        const int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (::bind(fd, address->ai_addr, address->ai_addrlen) == 0 && ::listen(fd, SOMAXCONN) == 0) {
+            listenFd_ = fd;
+        } else {
+            ::close(fd);
+        }
+    }
+    ::freeaddrinfo(addresses);
+    if (listenFd_ < 0) {
+        LOG_ERROR("Uplink ingest cannot listen on {}:{}: {}", config_.listenAddress, config_.port,
+                  std::strerror(errno));
+        return false;
+    }
+    sockaddr_storage bound{};
+    socklen_t boundLength = sizeof(bound);
+    ::getsockname(listenFd_, reinterpret_cast<sockaddr*>(&bound), &boundLength);
+    boundPort_ = ntohs(bound.ss_family == AF_INET6 ? reinterpret_cast<sockaddr_in6*>(&bound)->sin6_port
+                                                   : reinterpret_cast<sockaddr_in*>(&bound)->sin_port);
+
+    epollFd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    wakeFd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = kListenId;
+    ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, listenFd_, &event);
+    event.data.u64 = kWakeId;
+    ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &event);
+
+    stopping_ = false;
+    writerThread_ = std::thread(&UplinkIngestServer::runWriter, this);
+    for (size_t i = 0; i < std::max<size_t>(1, config_.decodeThreads); ++i) {
+        decodeThreads_.emplace_back(&UplinkIngestServer::runDecode, this);
+    }
+    ioThread_ = std::thread(&UplinkIngestServer::runIo, this);
+    LOG_INFO("Uplink ingest listening on {}:{} ({} backend, {} decode threads, classifier {})",
+             config_.listenAddress, boundPort_.load(), backend_->name(), decodeThreads_.size(),
+             classifier_ ? "on" : "off");
+    return true;
+#else
+    LOG_ERROR("The uplink ingest server needs Linux (epoll)");
+    return false;
+#endif
+}
+
+void UplinkIngestServer::stop() {
+#ifdef __linux__
+    if (!ioThread_.joinable()) return;
+    stopping_ = true;
+    const uint64_t one = 1;
+    (void)!::write(wakeFd_, &one, sizeof(one));
+    ioThread_.join();
+    decodeQueue_.close();
+    for (std::thread& thread : decodeThreads_) thread.join();
+    decodeThreads_.clear();
+    if (classifier_) classifier_->flush();  // Its callbacks hand the last records to the writer
+    writeQueue_.close();
+    writerThread_.join();
+    ::close(epollFd_);
+    ::close(wakeFd_);
+    epollFd_ = wakeFd_ = -1;
+    const UplinkIngestStats totals = stats();
+    LOG_INFO("Uplink ingest stopped: {} messages stored, {} rejected, {} refused by the backend", totals.stored,
+             totals.rejected, totals.failed);
+#endif
+}
+
+UplinkIngestStats UplinkIngestServer::stats() const {
+    UplinkIngestStats stats;
+    stats.connections = connections_.load();
+    stats.activeConnections = activeConnections_.load();
+    stats.bytesReceived = bytesReceived_.load();
+    stats.received = received_.load();
+    stats.stored = stored_.load();
+    stats.rejected = rejected_.load();
+    stats.failed = failed_.load();
+    stats.classified = classified_.load();
+    stats.bulkWrites = bulkWrites_.load();
+    stats.protocolErrors = protocolErrors_.load();
+    stats.cropsRecompressed = cropsRecompressed_.load();
+    stats.recompressionBytesSaved = recompressionBytesSaved_.load();
+    return stats;
+}
+
+void UplinkIngestServer::runIo() {
+#ifdef __linux__
+    nameCurrentThread("uplink_io");
+    std::unordered_map<uint64_t, Connection> connections;
+    uint64_t nextId = kWakeId + 1;
+    std::vector<epoll_event> events(1024);
+    std::vector<unsigned char> chunk(kReadChunkBytes);
+    std::vector<UplinkStreamDecoder::Message> messages;
+    std::vector<Completion> completions;
+
+    const auto closeConnection = [&](std::unordered_map<uint64_t, Connection>::iterator it) {
+        ::epoll_ctl(epollFd_, EPOLL_CTL_DEL, it->second.fd, nullptr);
+        ::close(it->second.fd);
+        connections.erase(it);
+        activeConnections_.fetch_sub(1);
+    };
+
+    const auto watchWritable = [&](uint64_t id, Connection& connection, bool writable) {
+        if (connection.waitingWritable == writable) return;
+        epoll_event event{};
+        event.events = writable ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        event.data.u64 = id;
+        ::epoll_ctl(epollFd_, EPOLL_CTL_MOD, connection.fd, &event);
+        connection.waitingWritable = writable;
+    };
+
+    // Write the latest cumulative ack; false if the connection is gone
+    const auto sendAck = [&](uint64_t id, Connection& connection) {
+        for (;;) {
+            if (connection.ackOffset == sizeof(connection.ack)) {
+                if (connection.acknowledged == connection.completedThrough) break;
+                connection.acknowledged = connection.completedThrough;
+                for (size_t i = 0; i < sizeof(connection.ack); ++i) {
+                    connection.ack[i] = static_cast<unsigned char>(connection.acknowledged >> (8 * i));
+                }
+                connection.ackOffset = 0;
+            }
+            const ssize_t n = ::send(connection.fd, connection.ack + connection.ackOffset,
+                                     sizeof(connection.ack) - connection.ackOffset, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                watchWritable(id, connection, true);
+                return true;
+            }
+            if (n <= 0) return false;
+            connection.ackOffset += static_cast<size_t>(n);
+        }
+        watchWritable(id, connection, false);
+        return true;
+    };
+
+    while (!stopping_) {
+        const int ready = ::epoll_wait(epollFd_, events.data(), static_cast<int>(events.size()), kEpollTimeoutMs);
+        if (ready < 0 && errno != EINTR) {
+            LOG_ERROR("Uplink ingest epoll_wait failed: {}", std::strerror(errno));
+            break;
+        }
+        for (int i = 0; i < ready && !stopping_; ++i) {
+            const uint64_t id = events[i].data.u64;
+            if (id == kListenId) {
+                for (;;) {
+                    const int fd = ::accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                    if (fd < 0) break;
+                    if (connections.size() >= config_.maxConnections) {
+                        LOG_WARN("Uplink ingest at {} connections; refusing another edge", connections.size());
+                        ::close(fd);
+                        continue;
+                    }
+                    const int one = 1;
+                    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));  // Acks are tiny
+                    epoll_event event{};
+                    event.events = EPOLLIN;
+                    event.data.u64 = nextId;
+                    ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event);
+                    connections.emplace(nextId++, Connection(fd, config_.maxMessageBytes));
+                    connections_.fetch_add(1);
+                    activeConnections_.fetch_add(1);
+                }
+                continue;
+            }
+
+            if (id == kWakeId) {
+                uint64_t count = 0;
+                (void)!::read(wakeFd_, &count, sizeof(count));
+                {
+                    std::lock_guard<std::mutex> lock(completionsMutex_);
+                    completions.swap(completions_);
+                }
+                std::unordered_set<uint64_t> touched;
+                for (const Completion& completion : completions) {
+                    auto it = connections.find(completion.connection);
+                    if (it == connections.end()) continue;  // Closed; the edge resends what was not acknowledged
+                    Connection& connection = it->second;
+                    if (!completion.stored) {
+                        LOG_WARN("Edge {}: message {} not stored; dropping the connection so it is resent",
+                                 connection.decoder.site(), completion.sequence);
+                        touched.erase(it->first);
+                        closeConnection(it);
+                        continue;
+                    }
+                    connection.completedAhead.insert(completion.sequence);
+                    while (!connection.completedAhead.empty() &&
+                           *connection.completedAhead.begin() == connection.completedThrough + 1) {
+                        connection.completedAhead.erase(connection.completedAhead.begin());
+                        ++connection.completedThrough;
+                    }
+                    touched.insert(it->first);
+                }
+                completions.clear();
+                for (const uint64_t touchedId : touched) {
+                    auto it = connections.find(touchedId);
+                    if (it != connections.end() && !sendAck(touchedId, it->second)) closeConnection(it);
+                }
+                continue;
+            }
+
+            auto it = connections.find(id);
+            if (it == connections.end()) continue;
+            Connection& connection = it->second;
+            bool open = true;
+            if (events[i].events & EPOLLOUT) open = sendAck(id, connection);
+            if (open && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+                size_t readBytes = 0;
+                while (open && readBytes < kMaxReadPerEvent) {
+                    const ssize_t n = ::recv(connection.fd, chunk.data(), chunk.size(), 0);
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+                    if (n <= 0) {
+                        open = false;  // The edge hung up (or reset)
+                        break;
+                    }
+                    readBytes += static_cast<size_t>(n);
+                    messages.clear();
+                    if (!connection.decoder.feed(chunk.data(), static_cast<size_t>(n), messages)) {
+                        LOG_WARN("Uplink ingest dropping a connection: {}", connection.decoder.error());
+                        protocolErrors_.fetch_add(1);
+                        open = false;
+                    }
+                    for (UplinkStreamDecoder::Message& message : messages) {
+                        // Blocks while the decode threads are queueCapacity behind: TCP backpressure
+                        decodeQueue_.push({id, ++connection.received, connection.decoder.site(), std::move(message)});
+                    }
+                    received_.fetch_add(messages.size());
+                }
+                bytesReceived_.fetch_add(readBytes);
+            }
+            if (!open) closeConnection(it);
+        }
+    }
+
+    for (auto& entry : connections) ::close(entry.second.fd);
+    activeConnections_.fetch_sub(connections.size());
+    ::close(listenFd_);
+    listenFd_ = -1;
+#endif
+}
+
+void UplinkIngestServer::runDecode() {
+    nameCurrentThread("uplink_decode");
+    while (auto item = decodeQueue_.pop()) decode(*item);
+}
+
+void UplinkIngestServer::decode(DecodeItem& item) {
+    UplinkStreamDecoder::Message& message = item.message;
+    WriteItem write;
+    write.connection = item.connection;
+    write.sequence = item.sequence;
+    write.isSummary = message.kind == uplink_wire::kSummaryMessage;
+    const bool parsed = write.isSummary ? parseMotionSummary(message.document, write.summary)
+                                        : parseFrameDocument(message.document, write.record);
+    if (!parsed) {
+        // A resend would not parse either: acknowledge it so the edge moves on
+        LOG_WARN("Edge {}: unreadable {} document skipped", item.site, write.isSummary ? "summary" : "frame");
+        rejected_.fetch_add(1);
+        complete(item.connection, item.sequence, true);
+        return;
+    }
+    if (write.isSummary) {
+        write.summary.source = item.site + "/" + write.summary.source;
+        writeQueue_.push(std::move(write));
+        return;
+    }
+
+    StoredFrameRecord& record = write.record;
+    record.metadata.source = item.site + "/" + record.metadata.source;
+    const size_t crops = std::min(record.regionCrops.size(), message.images.size());
+    if (!config_.cropPath.empty() && crops > 0) {
+        const fs::path directory = fs::path(config_.cropPath) / item.site;
+        std::error_code ec;
+        fs::create_directories(directory, ec);
+        std::vector<unsigned char> recompressed;
+        for (size_t i = 0; i < crops; ++i) {
+            // Edges may store crops in any ImageCodec; the file name follows the bytes
+            ImageCodec codec = ImageCodec::Jpeg;
+            ImageEncoder::detect(message.images[i], codec);
+            const std::vector<unsigned char>* bytes = &message.images[i];
+            if (config_.recompressCrops && codec == ImageCodec::Jpeg &&
+                ImageEncoder::recompressJpeg(message.images[i], recompressed) &&
+                recompressed.size() < message.images[i].size()) {
+                codec = ImageCodec::JpegXl;
+                bytes = &recompressed;
+                cropsRecompressed_.fetch_add(1);
+                recompressionBytesSaved_.fetch_add(message.images[i].size() - recompressed.size());
+            }
+            const std::string path =
+                (directory / (record.uuid + "_" + std::to_string(i) + imageCodecExtension(codec))).string();
+            if (!writeFile(path, *bytes)) {
+                LOG_ERROR("Edge {}: cannot write region crop {}", item.site, path);
+                failed_.fetch_add(1);
+                complete(item.connection, item.sequence, false);
+                return;
+            }
+            record.regionCrops[i].path = path;
+            record.regionCrops[i].bytes = bytes->size();
+        }
+    }
+    // plate_patches: a background plate comes once, after the crops of the first document
+    // that refers to it; later documents only name it
+    if (!config_.cropPath.empty() && !record.plate.id.empty()) {
+        const fs::path directory = fs::path(config_.cropPath) / item.site / "plates";
+        const std::string path =
+            (directory / (record.plate.id + fs::path(record.plate.path).extension().string())).string();
+        if (message.images.size() > record.regionCrops.size()) {
+            std::error_code ec;
+            fs::create_directories(directory, ec);
+            if (!writeFile(path, message.images[record.regionCrops.size()])) {
+                LOG_ERROR("Edge {}: cannot write background plate {}", item.site, path);
+                failed_.fetch_add(1);
+                complete(item.connection, item.sequence, false);
+                return;
+            }
+        }
+        record.plate.path = path;
+    }
+
+    // Regions the edge did not label, with their crop decoded for the central classifier
+    std::vector<cv::Mat> images;
+    std::vector<size_t> regionIndices;
+    if (classifier_) {
+        std::vector<RegionMetadata>& regions = record.metadata.consolidatedRegions;
+        for (size_t i = 0; i < crops; ++i) {
+            const auto region = std::find_if(regions.begin(), regions.end(), [&](const RegionMetadata& candidate) {
+                return candidate.box == record.regionCrops[i].region && candidate.classId < 0;
+            });
+            if (region == regions.end()) continue;
+            cv::Mat image = cv::imdecode(message.images[i], cv::IMREAD_COLOR);
+            if (image.empty()) continue;
+            images.push_back(std::move(image));
+            regionIndices.push_back(static_cast<size_t>(region - regions.begin()));
+        }
+    }
+    if (images.empty()) {
+        writeQueue_.push(std::move(write));
+        return;
+    }
+    auto pending = std::make_shared<WriteItem>(std::move(write));
+    const auto onClassified = [this, pending, regionIndices](std::vector<RegionClassification>& results) {
+        std::vector<RegionMetadata>& regions = pending->record.metadata.consolidatedRegions;
+        for (size_t i = 0; i < results.size() && i < regionIndices.size(); ++i) {
+            if (results[i].classId < 0) continue;
+            RegionMetadata& region = regions[regionIndices[i]];
+            region.classLabel = results[i].label;
+            region.classConfidence = results[i].confidence;
+            region.classId = results[i].classId;
+            classified_.fetch_add(1);
+        }
+        writeQueue_.push(std::move(*pending));
+    };
+    classifier_->submit(std::move(images), onClassified);
+}
+
+void UplinkIngestServer::runWriter() {
+    nameCurrentThread("uplink_writer");
+    std::vector<WriteItem> batch;
+    while (auto first = writeQueue_.pop()) {
+        batch.push_back(std::move(*first));
+        const auto deadline = std::chrono::steady_clock::now() + config_.batchWindow;
+        while (batch.size() < config_.maxBatch) {
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= deadline) break;
+            auto next = writeQueue_.popFor(deadline - now);
+            if (!next) break;
+            batch.push_back(std::move(*next));
+        }
+        writeBatch(batch);
+        batch.clear();
+    }
+}
+
+void UplinkIngestServer::writeBatch(std::vector<WriteItem>& batch) {
+    std::vector<StoredFrameRecord> records;
+    std::vector<MotionMinuteSummary> summaries;
+    for (WriteItem& item : batch) {
+        if (item.isSummary) {
+            summaries.push_back(std::move(item.summary));
+        } else {
+            records.push_back(std::move(item.record));
+        }
+    }
+
+    std::unordered_set<std::string> inserted;
+    if (!records.empty()) {
+        for (std::string& uuid : backend_->insertRecords(records)) inserted.insert(std::move(uuid));
+        bulkWrites_.fetch_add(1);
+    }
+    bool summariesStored = true;
+    if (!summaries.empty()) {
+        summariesStored = backend_->upsertMotionSummaries(summaries);
+        bulkWrites_.fetch_add(1);
+    }
+
+    size_t recordIndex = 0;
+    for (const WriteItem& item : batch) {
+        bool stored = summariesStored;
+        if (!item.isSummary) {
+            const StoredFrameRecord& record = records[recordIndex++];
+            stored = inserted.count(record.uuid) > 0;
+            if (!stored && !config_.cropPath.empty()) {
+                // The resend writes them again
+                std::error_code ec;
+                for (const StoredRegionCrop& crop : record.regionCrops) fs::remove(crop.path, ec);
+            }
+        }
+        (stored ? stored_ : failed_).fetch_add(1);
+        complete(item.connection, item.sequence, stored);
+    }
+}
+
+void UplinkIngestServer::complete(uint64_t connection, uint64_t sequence, bool stored) {
+    {
+        std::lock_guard<std::mutex> lock(completionsMutex_);
+        completions_.push_back({connection, sequence, stored});
+    }
+#ifdef __linux__
+    const uint64_t one = 1;
+    (void)!::write(wakeFd_, &one, sizeof(one));
+#endif
+}
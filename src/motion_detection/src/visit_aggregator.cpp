@@ -0,0 +1,169 @@
+#include "visit_aggregator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <opencv2/imgproc.hpp>
+
+namespace {
+
+double intersectionOverUnion(const cv::Rect& a, const cv::Rect& b) {
+    const double intersection = (a & b).area();
+    const double unionArea = a.area() + b.area() - intersection;
+    return unionArea > 0.0 ? intersection / unionArea : 0.0;
+}
+
+bool contains(const std::vector<int>& ids, int id) { return std::find(ids.begin(), ids.end(), id) != ids.end(); }
+
+}  // namespace
+
+VisitAggregator::VisitAggregator(const VisitConfig& config) : config_(config) {}
+
+double VisitAggregator::sharpness(const cv::Mat& image) {
+    if (image.empty()) return 0.0;
+    cv::Mat gray;
+    if (image.channels() == 3) {
+        cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+    } else {
+        gray = image;
+    }
+    cv::Mat laplacian;
+    cv::Laplacian(gray, laplacian, CV_64F);
+    cv::Scalar mean, stddev;
+    cv::meanStdDev(laplacian, mean, stddev);
+    return stddev[0] * stddev[0];
+}
+
+void VisitAggregator::observe(const cv::Mat& frame, const std::vector<ConsolidatedRegion>& regions,
+                              int frameIndex, Clock::time_point now, int64_t unixUs) {
+    if (!config_.enabled || frame.empty() || regions.empty()) return;
+    ++framesWithRegions_;
+
+    const cv::Rect frameRect(0, 0, frame.cols, frame.rows);
+    for (const ConsolidatedRegion& region : regions) {
+        const cv::Rect box = region.boundingBox & frameRect;
+        if (box.empty()) continue;
+
+        OpenVisit* open = match(region, box, now);
+        if (!open) {
+            open_.emplace_back();
+            open = &open_.back();
+            open->started = now;
+            open->visit.summary.startUs = unixUs;
+            open->visit.frameSize = frame.size();
+        }
+        VisitMetadata& summary = open->visit.summary;
+        if (open->lastFrameIndex != frameIndex) {
+            open->lastFrameIndex = frameIndex;
+            ++summary.frames;
+        }
+        summary.endUs = unixUs;
+        open->lastSeen = now;
+        open->lastBox = box;
+        for (const int id : region.trackedObjectIds) {
+            if (!contains(summary.trackIds, id)) summary.trackIds.push_back(id);
+        }
+        if (region.classConfidence > open->visit.classConfidence) {
+            open->visit.classLabel = region.classLabel;
+            open->visit.classConfidence = region.classConfidence;
+            open->visit.classId = region.classId;
+        }
+        addPathPoint(*open, box, unixUs);
+
+        // Every region of the sampled frame is scored, then the visit rests for the interval
+        if (!open->sampled || open->lastSampled == now || now - open->lastSampled >= config_.sampleInterval) {
+            open->sampled = true;
+            open->lastSampled = now;
+            offerCrop(*open, frame, box, frameIndex);
+        }
+    }
+}
+
+VisitAggregator::OpenVisit* VisitAggregator::match(const ConsolidatedRegion& region, const cv::Rect& box,
+                                                   Clock::time_point now) {
+    OpenVisit* best = nullptr;
+    double bestIou = config_.minIou;
+    for (OpenVisit& open : open_) {
+        if (now - open.lastSeen >= config_.endAfter) continue;  // Ended, waiting for takeEnded()
+        if (config_.matchTrackIds) {
+            for (const int id : region.trackedObjectIds) {
+                if (contains(open.visit.summary.trackIds, id)) return &open;
+            }
+        }
+        const double iou = intersectionOverUnion(box, open.lastBox);
+        if (iou >= bestIou) {
+            best = &open;
+            bestIou = iou;
+        }
+    }
+    return best;
+}
+
+void VisitAggregator::addPathPoint(OpenVisit& open, const cv::Rect& box, int64_t unixUs) const {
+    if (++open.pathSkipped < open.pathStride) return;
+    open.pathSkipped = 0;
+    std::vector<VisitPathPoint>& path = open.visit.summary.path;
+    if (config_.maxPathPoints > 1 && path.size() >= config_.maxPathPoints) {
+        // Keep every other point, and take half as many from now on
+        size_t kept = 0;
+        for (size_t i = 0; i < path.size(); i += 2) path[kept++] = path[i];
+        path.resize(kept);
+        open.pathStride *= 2;
+    }
+    const cv::Point center(box.x + box.width / 2, box.y + box.height / 2);
+    path.push_back({center, (unixUs - open.visit.summary.startUs) / 1000});
+}
+
+void VisitAggregator::offerCrop(OpenVisit& open, const cv::Mat& frame, const cv::Rect& box, int frameIndex) const {
+    if (config_.bestCrops == 0) return;
+    std::vector<VisitCrop>& crops = open.visit.crops;
+    const double sharp = sharpness(frame(box));
+    const double score = sharp * std::sqrt(static_cast<double>(box.area()));
+    if (crops.size() >= config_.bestCrops && score <= crops.back().score) return;
+
+    VisitCrop crop;
+    crop.image = frame(box).clone();
+    crop.region = box;
+    crop.sharpness = sharp;
+    crop.score = score;
+    crop.frameIndex = frameIndex;
+    const auto position = std::upper_bound(crops.begin(), crops.end(), score,
+                                           [](double value, const VisitCrop& kept) { return value > kept.score; });
+    const bool newBest = position == crops.begin();
+    crops.insert(position, std::move(crop));
+    if (crops.size() > config_.bestCrops) crops.pop_back();
+
+    if (newBest) {
+        if (config_.contextWidth > 0 && frame.cols > config_.contextWidth) {
+            const int height = std::max(1, frame.rows * config_.contextWidth / frame.cols);
+            cv::resize(frame, open.visit.context, cv::Size(config_.contextWidth, height), 0, 0, cv::INTER_AREA);
+        } else {
+            open.visit.context = frame.clone();
+        }
+    }
+}
+
+Visit VisitAggregator::finish(OpenVisit& open) {
+    Visit visit = std::move(open.visit);
+    visit.summary.cropScores.clear();
+    for (const VisitCrop& crop : visit.crops) visit.summary.cropScores.push_back(crop.score);
+    return visit;
+}
+
+std::vector<Visit> VisitAggregator::takeEnded(Clock::time_point now) {
+    std::vector<Visit> ended;
+    auto end = std::remove_if(open_.begin(), open_.end(), [&](OpenVisit& open) {
+        if (now - open.lastSeen < config_.endAfter && now - open.started < config_.maxDuration) return false;
+        ended.push_back(finish(open));
+        return true;
+    });
+    open_.erase(end, open_.end());
+    return ended;
+}
+
+std::vector<Visit> VisitAggregator::takeAll() {
+    std::vector<Visit> visits;
+    visits.reserve(open_.size());
+    for (OpenVisit& open : open_) visits.push_back(finish(open));
+    open_.clear();
+    return visits;
+}
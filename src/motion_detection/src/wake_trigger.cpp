@@ -0,0 +1,151 @@
+#include "wake_trigger.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <thread>
+#include <utility>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include "logger.hpp"
+
+namespace {
+
+// Level re-read interval of a line without edge reporting
+constexpr std::chrono::milliseconds kLevelPollInterval{50};
+
+}  // namespace
+
+#ifdef __linux__
+
+GpioLine::GpioLine(std::string path, bool activeLow) : path_(std::move(path)), activeLow_(activeLow) {
+    fd_ = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) {
+        LOG_WARN("Cannot open GPIO value file {}; the line never triggers", path_);
+        return;
+    }
+    // sysfs lines report edges to poll() once their edge file asks for them
+    const size_t slash = path_.rfind('/');
+    if (slash != std::string::npos) {
+        std::ofstream edge(path_.substr(0, slash + 1) + "edge");
+        edges_ = edge && (edge << "both" << std::flush);
+    }
+    isActive();  // A read arms the edge notification
+}
+
+GpioLine::~GpioLine() {
+    if (fd_ >= 0) ::close(fd_);
+}
+
+bool GpioLine::isActive() {
+    if (fd_ < 0) return false;
+    char value = '0';
+    if (::pread(fd_, &value, 1, 0) != 1) return false;
+    return (value == '1') != activeLow_;
+}
+
+bool GpioLine::wait(std::chrono::milliseconds timeout) {
+    if (fd_ < 0) {
+        std::this_thread::sleep_for(timeout);
+        return false;
+    }
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+        if (isActive()) return true;
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0) return false;
+        if (edges_) {
+            pollfd descriptor{fd_, POLLPRI | POLLERR, 0};
+            if (::poll(&descriptor, 1, static_cast<int>(left.count())) <= 0) return isActive();
+        } else {
+            std::this_thread::sleep_for(std::min(left, kLevelPollInterval));
+        }
+    }
+}
+
+#else  // No sysfs GPIO: the line never triggers
+
+GpioLine::GpioLine(std::string path, bool activeLow) : path_(std::move(path)), activeLow_(activeLow) {
+    LOG_WARN("GPIO wake triggers need Linux; {} never triggers", path_);
+}
+
+GpioLine::~GpioLine() = default;
+
+bool GpioLine::isActive() { return false; }
+
+bool GpioLine::wait(std::chrono::milliseconds timeout) {
+    std::this_thread::sleep_for(timeout);
+    return false;
+}
+
+#endif
+
+WakeController::WakeController(WakeTriggerConfig config)
+    : config_(std::move(config)),
+      gate_(std::max(4, config_.gateBlockSize), std::max(1, config_.gateHistory)),
+      lastActivityTicks_(Clock::now().time_since_epoch().count()) {
+    if (usesGpio()) gpio_ = std::make_unique<GpioLine>(config_.gpioPath, config_.gpioActiveLow);
+}
+
+WakeController::~WakeController() = default;
+
+WakeController::Transition WakeController::onFrame(const cv::Mat& gray, Clock::time_point now) {
+    if (awake_.load(std::memory_order_relaxed)) {
+        if (gpio_ && gpio_->isActive()) recordActivity(now);
+        const Clock::time_point lastActivity{Clock::duration(lastActivityTicks_.load(std::memory_order_relaxed))};
+        if (now - lastActivity < std::chrono::duration<double>(config_.awakeHoldSeconds)) return Transition::None;
+        awake_.store(false, std::memory_order_release);
+        gate_.reset();  // Its background is stale after the awake period
+        nextSleepFrame_ = now;
+        sleepFrames_.fetch_add(1, std::memory_order_relaxed);
+        if (usesGate() && !gray.empty()) gate_.apply(gray);
+        return Transition::Slept;
+    }
+
+    const bool triggered = (gpio_ && gpio_->isActive()) || (usesGate() && gateFires(gray));
+    if (!triggered) {
+        sleepFrames_.fetch_add(1, std::memory_order_relaxed);
+        return Transition::None;
+    }
+    recordActivity(now);
+    awake_.store(true, std::memory_order_release);
+    wakes_.fetch_add(1, std::memory_order_relaxed);
+    return Transition::Woke;
+}
+
+void WakeController::waitForNextFrame() {
+    if (awake_.load(std::memory_order_relaxed)) return;
+    const auto interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / std::max(config_.sleepFps, 0.01)));
+    nextSleepFrame_ += interval;
+    const Clock::time_point now = Clock::now();
+    if (nextSleepFrame_ < now) nextSleepFrame_ = now;  // Fell behind (slow read): no burst
+    const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(nextSleepFrame_ - now);
+    if (gpio_) {
+        gpio_->wait(wait);  // Returns early on the line's edge; the next onFrame() sees it
+    } else {
+        std::this_thread::sleep_until(nextSleepFrame_);
+    }
+}
+
+void WakeController::recordActivity(Clock::time_point now) {
+    lastActivityTicks_.store(now.time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+bool WakeController::gateFires(const cv::Mat& gray) {
+    if (gray.empty()) return false;
+    if (!gate_.apply(gray)) return false;  // (Re)started its background from this frame
+    const cv::Mat& map = gate_.map();
+    int moving = 0;
+    for (int y = 0; y < map.rows; ++y) {
+        const uchar* row = map.ptr<uchar>(y);
+        for (int x = 0; x < map.cols; ++x) {
+            if (row[x] >= config_.gateThreshold && ++moving >= config_.gateMinBlocks) return true;
+        }
+    }
+    return false;
+}
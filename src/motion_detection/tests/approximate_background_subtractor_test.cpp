@@ -0,0 +1,108 @@
+#include "approximate_background_subtractor.hpp"
+
+#include <gtest/gtest.h>
+
+#include <opencv2/opencv.hpp>
+
+#include "logger.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("debug", "approximate_background_subtractor_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class ApproximateBackgroundSubtractorTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const approximateBackgroundSubtractorEnv =
+    ::testing::AddGlobalTestEnvironment(new ApproximateBackgroundSubtractorTestEnvironment());
+
+namespace {
+
+using Method = ApproximateBackgroundSubtractor::Method;
+
+class ApproximateBackgroundSubtractorTest : public ::testing::TestWithParam<Method> {};
+
+cv::Mat sceneWithBlob(bool blob) {
+    cv::Mat frame(60, 80, CV_8UC1, cv::Scalar(100));
+    if (blob) cv::rectangle(frame, cv::Rect(30, 20, 12, 12), cv::Scalar(200), cv::FILLED);
+    return frame;
+}
+
+}  // namespace
+
+TEST_P(ApproximateBackgroundSubtractorTest, FirstFrameBecomesTheBackground) {
+    ApproximateBackgroundSubtractor model(GetParam(), 100, 25);
+    cv::Mat mask;
+    model.apply(sceneWithBlob(false), mask);
+    EXPECT_EQ(mask.type(), CV_8UC1);
+    EXPECT_EQ(cv::countNonZero(mask), 0);
+
+    cv::Mat background;
+    model.getBackgroundImage(background);
+    EXPECT_EQ(cv::norm(background, sceneWithBlob(false), cv::NORM_INF), 0.0);
+}
+
+TEST_P(ApproximateBackgroundSubtractorTest, MarksOnlyTheChangedPixels) {
+    ApproximateBackgroundSubtractor model(GetParam(), 100, 25);
+    cv::Mat mask;
+    model.apply(sceneWithBlob(false), mask);
+    model.apply(sceneWithBlob(true), mask);
+
+    EXPECT_EQ(cv::countNonZero(mask), 12 * 12);
+    EXPECT_EQ(mask.at<uchar>(25, 35), 255);
+    EXPECT_EQ(mask.at<uchar>(5, 5), 0);
+}
+
+TEST_P(ApproximateBackgroundSubtractorTest, AbsorbsAStaticChange) {
+    ApproximateBackgroundSubtractor model(GetParam(), 16, 25);
+    cv::Mat mask;
+    model.apply(sceneWithBlob(false), mask);
+    for (int i = 0; i < 400; ++i) model.apply(sceneWithBlob(true), mask);
+
+    EXPECT_EQ(cv::countNonZero(mask), 0);  // The blob is part of the background now
+}
+
+TEST_P(ApproximateBackgroundSubtractorTest, ZeroLearningRateOnlyClassifies) {
+    ApproximateBackgroundSubtractor model(GetParam(), 16, 25);
+    cv::Mat mask;
+    model.apply(sceneWithBlob(false), mask);
+    for (int i = 0; i < 100; ++i) model.apply(sceneWithBlob(true), mask, 0.0);
+
+    EXPECT_EQ(cv::countNonZero(mask), 12 * 12);
+}
+
+TEST_P(ApproximateBackgroundSubtractorTest, LearningRateOneResets) {
+    ApproximateBackgroundSubtractor model(GetParam(), 100, 25);
+    cv::Mat mask;
+    model.apply(sceneWithBlob(false), mask);
+    model.apply(sceneWithBlob(true), mask, 1.0);
+    EXPECT_EQ(cv::countNonZero(mask), 0);
+
+    model.apply(sceneWithBlob(true), mask);
+    EXPECT_EQ(cv::countNonZero(mask), 0);
+}
+
+TEST_P(ApproximateBackgroundSubtractorTest, AnyChannelMakesForeground) {
+    ApproximateBackgroundSubtractor model(GetParam(), 100, 25);
+    cv::Mat frame(20, 20, CV_8UC3, cv::Scalar(50, 50, 50));
+    cv::Mat mask;
+    model.apply(frame, mask);
+
+    frame.at<cv::Vec3b>(10, 10) = cv::Vec3b(50, 50, 120);  // Red channel only
+    model.apply(frame, mask);
+    EXPECT_EQ(mask.size(), frame.size());
+    EXPECT_EQ(cv::countNonZero(mask), 1);
+    EXPECT_EQ(mask.at<uchar>(10, 10), 255);
+}
+
+INSTANTIATE_TEST_SUITE_P(Methods, ApproximateBackgroundSubtractorTest,
+                         ::testing::Values(Method::RUNNING_AVERAGE, Method::MEDIAN));
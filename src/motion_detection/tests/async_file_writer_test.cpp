@@ -0,0 +1,160 @@
+#include "async_file_writer.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "logger.hpp"
+
+namespace fs = std::filesystem;
+
+void initLogger() {
+    try {
+        Logger::init("debug", "async_file_writer_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class AsyncFileWriterTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const asyncFileWriterEnv =
+    ::testing::AddGlobalTestEnvironment(new AsyncFileWriterTestEnvironment());
+
+namespace {
+
+class AsyncFileWriterTest : public ::testing::TestWithParam<FileWriterBackend> {
+   protected:
+    void SetUp() override {
+        directory_ = fs::temp_directory_path() /
+                     ("async_file_writer_test_" + std::string(fileWriterBackendName(GetParam())));
+        fs::remove_all(directory_);
+        fs::create_directories(directory_);
+    }
+
+    void TearDown() override { fs::remove_all(directory_); }
+
+    FileWriterConfig config() const {
+        FileWriterConfig config;
+        config.backend = GetParam();
+        config.queueDepth = 8;  // Fewer entries than files, so operations wait for free ones
+        config.registeredBuffers = 2;
+        config.bufferBytes = 4096;
+        return config;
+    }
+
+    // Contents of file @p index: large ones do not fit a registered buffer
+    static AsyncFileWriter::Buffer contents(int index) {
+        const size_t size = index % 5 == 0 ? 100000 : 100 + index * 37;
+        AsyncFileWriter::Buffer bytes(size);
+        for (size_t i = 0; i < size; ++i) bytes[i] = static_cast<unsigned char>((i * 31 + index) & 0xFF);
+        return bytes;
+    }
+
+    static AsyncFileWriter::Buffer read(const fs::path& path) {
+        std::ifstream file(path, std::ios::binary);
+        return AsyncFileWriter::Buffer(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    std::string path(int index) const { return (directory_ / (std::to_string(index) + ".jpg")).string(); }
+
+    fs::path directory_;
+};
+
+}  // namespace
+
+TEST_P(AsyncFileWriterTest, WritesEveryFileCompletely) {
+    AsyncFileWriter writer(config());
+    if (GetParam() == FileWriterBackend::IoUring && writer.backend() != FileWriterBackend::IoUring) {
+        GTEST_SKIP() << "io_uring not available here";
+    }
+    std::atomic<int> completed{0};
+    size_t bytes = 0;
+    for (int i = 0; i < 40; ++i) {
+        AsyncFileWriter::Buffer buffer = writer.acquireBuffer();
+        EXPECT_TRUE(buffer.empty());
+        buffer = contents(i);
+        bytes += buffer.size();
+        writer.write(path(i), std::move(buffer), [&completed](bool written) {
+            EXPECT_TRUE(written);
+            ++completed;
+        });
+    }
+    writer.flush();
+    EXPECT_EQ(completed.load(), 40);
+    for (int i = 0; i < 40; ++i) EXPECT_EQ(read(path(i)), contents(i)) << "file " << i;
+
+    const FileWriterStats stats = writer.getStats();
+    EXPECT_EQ(stats.filesSubmitted, 40u);
+    EXPECT_EQ(stats.filesWritten, 40u);
+    EXPECT_EQ(stats.filesFailed, 0u);
+    EXPECT_EQ(stats.bytesWritten, bytes);
+    EXPECT_EQ(stats.syncs, 0u);
+    EXPECT_EQ(stats.inFlight, 0u);
+    EXPECT_GE(stats.inFlightHighWatermark, 1u);
+    if (writer.backend() == FileWriterBackend::IoUring) {
+        EXPECT_GE(stats.sqesSubmitted, 40u * 3);  // Open, write and close at least
+        EXPECT_EQ(stats.cqOverflows, 0u);
+        EXPECT_LE(stats.sqHighWatermark, 8u);
+        EXPECT_LT(stats.submitCalls, stats.sqesSubmitted);
+    }
+
+    // Buffers come back to the pool with their capacity
+    EXPECT_GT(writer.acquireBuffer().capacity(), 0u);
+}
+
+TEST_P(AsyncFileWriterTest, SyncsEveryNthFileAndReportsFailures) {
+    FileWriterConfig syncing = config();
+    syncing.fsyncEvery = 3;
+    AsyncFileWriter writer(syncing);
+    for (int i = 0; i < 9; ++i) writer.write(path(i), contents(i), nullptr);
+
+    bool written = true;
+    {
+        FileWriteBatch batch(writer);
+        batch.write((directory_ / "missing" / "0.jpg").string(), contents(1), &written);
+        batch.write(path(9), contents(9), nullptr);
+        batch.wait();
+        EXPECT_FALSE(written);
+        EXPECT_TRUE(fs::exists(path(9)));
+    }
+    writer.flush();
+
+    const FileWriterStats stats = writer.getStats();
+    EXPECT_EQ(stats.filesWritten, 10u);
+    EXPECT_EQ(stats.filesFailed, 1u);
+    EXPECT_EQ(stats.syncs, 3u);  // Files 3, 6 and 9; the tenth submitted was the missing one
+}
+
+// Destroying the writer finishes what was queued
+TEST_P(AsyncFileWriterTest, DestructorDrainsTheQueue) {
+    {
+        AsyncFileWriter writer(config());
+        for (int i = 0; i < 20; ++i) writer.write(path(i), contents(i), nullptr);
+    }
+    for (int i = 0; i < 20; ++i) EXPECT_EQ(read(path(i)), contents(i)) << "file " << i;
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, AsyncFileWriterTest,
+                         ::testing::Values(FileWriterBackend::Threads, FileWriterBackend::IoUring),
+                         [](const ::testing::TestParamInfo<FileWriterBackend>& info) {
+                             return info.param == FileWriterBackend::Threads ? "Threads" : "IoUring";
+                         });
+
+TEST(FileWriterBackendTest, ParsesNames) {
+    EXPECT_EQ(parseFileWriterBackend("AUTO"), FileWriterBackend::Auto);
+    EXPECT_EQ(parseFileWriterBackend("io_uring"), FileWriterBackend::IoUring);
+    EXPECT_EQ(parseFileWriterBackend("threads"), FileWriterBackend::Threads);
+    EXPECT_THROW(parseFileWriterBackend("aio"), std::invalid_argument);
+    EXPECT_STREQ(fileWriterBackendName(FileWriterBackend::IoUring), "io_uring");
+}
@@ -0,0 +1,121 @@
+#include "bench_comparison.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Google Benchmark --benchmark_out JSON: each benchmark's repetitions plus its mean
+std::string benchmarkJson(const std::vector<std::pair<std::string, std::vector<double>>>& runs, double recall) {
+    std::ostringstream json;
+    json << "{\"context\": {\"library_build_type\": \"release\"},\n \"benchmarks\": [\n";
+    bool first = true;
+    for (const auto& [name, times] : runs) {
+        double sum = 0.0;
+        for (size_t i = 0; i < times.size(); ++i) {
+            json << (first ? "" : ",\n") << "  {\"name\": \"" << name << "\", \"run_name\": \"" << name
+                 << "\", \"run_type\": \"iteration\", \"repetitions\": " << times.size()
+                 << ", \"repetition_index\": " << i << ", \"iterations\": 100, \"real_time\": " << times[i]
+                 << ", \"cpu_time\": " << times[i] << ", \"time_unit\": \"us\", \"box_recall\": " << recall
+                 << ", \"Mpix/s\": 12.5}";
+            first = false;
+            sum += times[i];
+        }
+        json << ",\n  {\"name\": \"" << name << "_mean\", \"run_name\": \"" << name
+             << "\", \"run_type\": \"aggregate\", \"aggregate_name\": \"mean\", \"real_time\": "
+             << sum / times.size() << ", \"cpu_time\": 0, \"time_unit\": \"us\"}";
+    }
+    json << "\n]}\n";
+    return json.str();
+}
+
+std::string writeFile(const std::string& name, const std::string& text) {
+    const fs::path path = fs::temp_directory_path() / name;
+    std::ofstream(path) << text;
+    return path.string();
+}
+
+}  // namespace
+
+// Exact p-values for small samples match the tables (and scipy.stats.mannwhitneyu)
+TEST(BenchComparisonTest, MannWhitneyPValues) {
+    EXPECT_NEAR(mannWhitneyPValue({1, 2, 3, 4, 5}, {6, 7, 8, 9, 10}), 2.0 / 252.0, 1e-12);
+    EXPECT_NEAR(mannWhitneyPValue({1, 3, 5, 7, 9}, {2, 4, 6, 8, 10}), 0.6904761904761905, 1e-12);
+    EXPECT_NEAR(mannWhitneyPValue({6, 7, 8, 9, 10}, {1, 2, 3, 4, 5}), 2.0 / 252.0, 1e-12);
+    EXPECT_DOUBLE_EQ(mannWhitneyPValue({}, {1, 2}), 1.0);
+    // Ties: normal approximation
+    const double tied = mannWhitneyPValue({1, 1, 2, 2, 3, 3}, {4, 4, 5, 5, 6, 6});
+    EXPECT_GT(tied, 0.001);
+    EXPECT_LT(tied, 0.01);
+    EXPECT_DOUBLE_EQ(mannWhitneyPValue({2, 2, 2}, {2, 2, 2}), 1.0);
+}
+
+// Repetitions become samples in nanoseconds; a clear slow-down is a regression, noise is not,
+// and the accuracy counters are compared alongside
+TEST(BenchComparisonTest, FlagsSignificantRegressions) {
+    const std::vector<double> steady{100.2, 99.1, 100.8, 99.6, 100.4, 99.9, 100.1, 100.6, 99.4, 100.0};
+    std::vector<double> slower, noisy;
+    for (size_t i = 0; i < steady.size(); ++i) {
+        slower.push_back(steady[i] * 1.2);
+        noisy.push_back(steady[(i + 3) % steady.size()] + (i % 2 ? 0.3 : -0.3));
+    }
+    const std::string baselinePath = writeFile(
+        "birds_bench_baseline.json",
+        benchmarkJson({{"BM_Slower", steady}, {"BM_Same", steady}, {"BM_Dropped", steady}}, 0.9));
+    const std::string currentPath = writeFile(
+        "birds_bench_current.json", benchmarkJson({{"BM_Slower", slower}, {"BM_Same", noisy}, {"BM_New", steady}}, 0.8));
+
+    const auto baseline = loadBenchmarkJson(baselinePath);
+    const auto current = loadBenchmarkJson(currentPath);
+    ASSERT_EQ(baseline.size(), 3u);
+    ASSERT_EQ(baseline.at("BM_Slower").times.size(), 10u);
+    EXPECT_DOUBLE_EQ(baseline.at("BM_Slower").times[0], 100.2e3);
+    EXPECT_DOUBLE_EQ(baseline.at("BM_Slower").counters.at("box_recall"), 0.9);
+
+    const BenchComparison comparison = compareBenchmarks(baseline, current);
+    ASSERT_EQ(comparison.deltas.size(), 2u);
+    const BenchmarkDelta& same = comparison.deltas[0];
+    const BenchmarkDelta& slowerDelta = comparison.deltas[1];
+    EXPECT_EQ(same.name, "BM_Same");
+    EXPECT_EQ(same.verdict, BenchmarkDelta::Verdict::Unchanged);
+    EXPECT_EQ(slowerDelta.verdict, BenchmarkDelta::Verdict::Regression);
+    EXPECT_NEAR(slowerDelta.change, 0.2, 1e-9);
+    EXPECT_GT(slowerDelta.changeLow, 0.15);
+    EXPECT_LT(slowerDelta.pValue, 0.001);
+    ASSERT_EQ(slowerDelta.quality.size(), 1u);
+    EXPECT_EQ(slowerDelta.quality[0].name, "box_recall");
+    EXPECT_TRUE(slowerDelta.quality[0].worse);
+    EXPECT_EQ(comparison.regressions(), 1u);
+    EXPECT_EQ(comparison.qualityRegressions(), 2u);
+    EXPECT_EQ(comparison.onlyBaseline, std::vector<std::string>{"BM_Dropped"});
+    EXPECT_EQ(comparison.onlyCurrent, std::vector<std::string>{"BM_New"});
+
+    std::ostringstream report;
+    printBenchComparison(report, comparison);
+    EXPECT_NE(report.str().find("REGRESSION"), std::string::npos);
+    EXPECT_NE(report.str().find("1 regressions"), std::string::npos);
+    fs::remove(baselinePath);
+    fs::remove(currentPath);
+}
+
+// Aggregates-only files keep one sample (the mean) per benchmark: reported, never flagged
+TEST(BenchComparisonTest, AggregatesOnlyRunsAreInsufficient) {
+    const std::string path = writeFile(
+        "birds_bench_aggregates.json",
+        "{\"benchmarks\": [{\"name\": \"BM_A_mean\", \"run_name\": \"BM_A\", \"run_type\": \"aggregate\", "
+        "\"aggregate_name\": \"mean\", \"real_time\": 2.5, \"cpu_time\": 2.5, \"time_unit\": \"ms\"}]}");
+    const auto runs = loadBenchmarkJson(path);
+    ASSERT_EQ(runs.at("BM_A").times, std::vector<double>{2.5e6});
+    const BenchComparison comparison = compareBenchmarks(runs, runs);
+    ASSERT_EQ(comparison.deltas.size(), 1u);
+    EXPECT_EQ(comparison.deltas[0].verdict, BenchmarkDelta::Verdict::Insufficient);
+    EXPECT_THROW(loadBenchmarkJson(writeFile("birds_bench_empty.json", "{\"context\": {}}")), std::runtime_error);
+    fs::remove(path);
+}
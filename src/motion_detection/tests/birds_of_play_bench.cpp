@@ -0,0 +1,1178 @@
+/**
+ * Birds of Play benchmark suite (Google Benchmark)
+ *
+ * - MotionProcessor steps (preprocess, detect, morphology, extraction) at 720p/1080p/4K
+ * - processFrame end-to-end for each config preset at the same resolutions, with the preset's
+ *   accuracy on the moving sequence next to its speed (box_recall, box_precision, box_iou,
+ *   region_recall, region_precision against the blobs' boxes, DetectionEvaluator)
+ * - Gaussian blur and erosion per kernel size on a 1080p frame: the unrolled instances of
+ *   fixed_size_filters.hpp against the OpenCV call they replace
+ * - Background models (MOG2, KNN, running average, median, reduced-rate updates): cost per
+ *   frame over a moving sequence plus detection quality (blob recall, false boxes)
+ * - MotionRegionConsolidator DBSCAN scaling over N = 10..2000 synthetic boxes, clustered
+ *   (birds in flocks) and uniform (noise over the whole frame), and with each distance metric
+ * - Stage handoff queues: BoundedQueue against LockFreeQueue and the raw SpscRing / MpmcRing,
+ *   single and batch pop, with 1 or 4 producers feeding one consumer
+ * - UplinkIngestServer with 1k, 5k and 10k simulated edges on loopback: frame documents with
+ *   a region crop, stored by the "none" backend, so decoding, parsing and bulk batching set the
+ *   pace (messages/s); skipped when the open-file limit cannot be raised to two per edge
+ * - Storage codecs (ImageEncoder): JPEG, WebP, AVIF and JPEG XL at efforts 1, 3 and 7 on a
+ *   1080p frame and a 320x240 crop, with encode ms/MP, bytes per image and cv::imdecode ms/MP
+ *   (where OpenCV reads the format), and the lossless JPEG to JPEG XL recompression the ingest
+ *   service applies; codecs not built in are skipped
+ * - processFrame over recorded footage from a frame cache (BIRDS_BENCH_FRAME_CACHE, written by
+ *   birds_of_play_frame_cache), mapped so no decoding shows up in the numbers; scored like
+ *   the presets when BIRDS_BENCH_GROUND_TRUTH names annotations of that footage (GroundTruth)
+ * - ObjectTracker and the whole consolidate stage (tracker + consolidator) on real motion
+ *   boxes from a box capture (BENCHMARK_BOX_CAPTURE at configure time, or the
+ *   BIRDS_BENCH_BOX_CAPTURE environment variable), frame by frame from the mapped file
+ *
+ * In ENABLE_ALLOCATION_COUNTING builds the detection and clustering benchmarks also report
+ * heap allocations per iteration (allocs, alloc_bytes) and by pipeline stage (allocs:<stage>),
+ * so a zero-allocation hot path that regresses shows up next to its timing.
+ *
+ * Frames are synthetic: a fixed noise texture with bright blobs that move between the two
+ * frames of a pair, so every run sees the same pixels. Record a baseline with the
+ * bench_baseline target and compare later runs against it with bench_compare.
+ *
+ * birds_of_play_bench --compare <baseline.json> <current.json> [--alpha X] [--min-change X]
+ * runs nothing: it compares two --benchmark_out files repetition by repetition (Mann-Whitney
+ * U test, bootstrap interval of the median change, see bench_comparison.hpp), prints the
+ * accuracy counters of both runs under each benchmark and exits 1 when a benchmark regressed
+ * or an accuracy counter got worse.
+ */
+#include <arpa/inet.h>
+#include <benchmark/benchmark.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <yaml-cpp/yaml.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <opencv2/opencv.hpp>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "allocation_counter.hpp"
+#include "bench_comparison.hpp"
+#include "bounded_queue.hpp"
+#include "box_capture.hpp"
+#include "detection_evaluator.hpp"
+#include "fixed_size_filters.hpp"
+#include "frame_arena.hpp"
+#include "image_encoder.hpp"
+#include "jpeg_region_decoder.hpp"
+#include "lockfree_queue.hpp"
+#include "logger.hpp"
+#include "motion_pipeline.hpp"
+#include "motion_processor.hpp"
+#include "motion_region_consolidator.hpp"
+#include "object_tracker.hpp"
+#include "pipeline_config.hpp"
+#include "replay_frame_source.hpp"
+#include "tracked_object_store.hpp"
+#include "uplink_backend.hpp"
+#include "uplink_ingest.hpp"
+
+#ifndef BENCH_CONFIG_PATH
+#define BENCH_CONFIG_PATH "config.yaml"
+#endif
+
+#ifndef BIRDS_BUILD_FLAVOR
+#define BIRDS_BUILD_FLAVOR "unknown"
+#endif
+
+#ifndef BENCH_BOX_CAPTURE_PATH
+#define BENCH_BOX_CAPTURE_PATH ""
+#endif
+
+namespace {
+
+const std::vector<cv::Size> kResolutions = {{1280, 720}, {1920, 1080}, {3840, 2160}};
+
+// Config presets for processFrame: overrides applied on top of config.yaml
+struct ConfigPreset {
+    const char* name;
+    std::vector<std::pair<const char*, const char*>> overrides;
+};
+
+const std::vector<ConfigPreset> kPresets = {
+    {"default", {}},
+    {"fast",
+     {{"detection_scale", "0.5"},
+      {"threshold_mode", "cached"},
+      {"contour_extraction", "components"},
+      {"morph_approximate", "true"},
+      {"reuse_buffers", "true"}}},
+    {"tiled", {{"tile_bands", "4"}, {"reuse_buffers", "true"}}},
+    {"three_frame", {{"frame_differencing", "three_frame"}, {"reuse_buffers", "true"}}},
+    {"no_background", {{"background_subtraction", "false"}}},
+    {"rgb", {{"processing_mode", "rgb"}}},
+    {"clahe_cached", {{"clahe_mode", "cached"}}},
+    {"block", {{"detection_method", "block"}}},
+};
+
+// Background model presets, compared by BM_BackgroundModel
+const std::vector<ConfigPreset> kBackgroundPresets = {
+    {"bg_mog2", {{"background_model", "mog2"}}},
+    {"bg_mog2_fast_learning", {{"background_model", "mog2"}, {"background_learning_rate", "0.05"}}},
+    {"bg_mog2_every4", {{"background_model", "mog2"}, {"background_update_interval", "4"}}},
+    {"bg_mog2_half", {{"background_model", "mog2"}, {"background_update_scale", "0.5"}}},
+    {"bg_knn", {{"background_model", "knn"}}},
+    {"bg_running_average", {{"background_model", "running_average"}}},
+    {"bg_median", {{"background_model", "median"}}},
+};
+
+// Blurs compared by BM_Blur, each group against its first entry: the edge-preserving
+// filters (config.yaml's bilateral_* settings) and the smoothing ones (gaussian_blur_size)
+const std::vector<ConfigPreset> kBlurPresets = {
+    {"blur_bilateral", {{"blur_type", "bilateral"}}},
+    {"blur_guided", {{"blur_type", "guided"}, {"guided_subsample", "1"}}},
+    {"blur_guided_fast", {{"blur_type", "guided"}, {"guided_subsample", "2"}}},
+    {"blur_domain_transform", {{"blur_type", "domain_transform"}}},
+};
+const std::vector<ConfigPreset> kSmoothingPresets = {
+    {"blur_gaussian", {{"blur_type", "gaussian"}}},
+    {"blur_stack", {{"blur_type", "stack"}}},
+};
+
+// Frames of the moving sequence: blobs advance one unit per frame, then start over
+constexpr int kSequenceLength = 6;
+
+// Writes config.yaml with a preset's overrides to the temp directory; returns the path
+std::string writePresetConfig(const ConfigPreset& preset) {
+    YAML::Node config = YAML::LoadFile(BENCH_CONFIG_PATH);
+    for (const auto& [key, value] : preset.overrides) config[key] = YAML::Load(value);
+    // Benchmarks measure processing, not log I/O
+    config["logging"]["log_to_file"] = false;
+    config["background_snapshot_dir"] = "";  // No warm start from an earlier run
+
+    const std::filesystem::path path =
+        std::filesystem::temp_directory_path() / (std::string("birds_bench_") + preset.name + ".yaml");
+    std::ofstream out(path);
+    out << config;
+    return path.string();
+}
+
+// Centres of the blobs drawn into frame @p frame
+std::vector<cv::Point> blobCenters(const cv::Size& size, int frame) {
+    const int unit = size.width / 64;
+    std::vector<cv::Point> centers;
+    for (int i = 0; i < 12; ++i) {
+        centers.emplace_back((i * 5 + 3) * unit + frame * unit, ((i * 7) % 30 + 3) * size.height / 36);
+    }
+    return centers;
+}
+
+// Noise texture plus blobs that shift one unit per frame (frame 0 and 1 form the pair)
+cv::Mat syntheticFrame(const cv::Size& size, int frame) {
+    static std::map<std::pair<int, int>, cv::Mat> textures;
+    cv::Mat& texture = textures[{size.width, size.height}];
+    if (texture.empty()) {
+        texture.create(size, CV_8UC3);
+        cv::theRNG().state = 12345;
+        cv::randu(texture, cv::Scalar::all(40), cv::Scalar::all(90));
+        cv::GaussianBlur(texture, texture, cv::Size(7, 7), 0);
+    }
+    cv::Mat image = texture.clone();
+    const int unit = size.width / 64;
+    const std::vector<cv::Point> centers = blobCenters(size, frame);
+    for (size_t i = 0; i < centers.size(); ++i) {
+        cv::ellipse(image, centers[i], cv::Size(unit, unit * 2 / 3), 15.0 * static_cast<double>(i), 0, 360,
+                    cv::Scalar(200, 210, 220), cv::FILLED);
+    }
+    return image;
+}
+
+std::unique_ptr<MotionProcessor> makeProcessor(const std::string& configPath) {
+    auto processor = std::make_unique<MotionProcessor>(configPath);
+    processor->enableVisualization(false);
+    processor->setVisualizationPath("");
+    processor->setRetainedStages(MotionProcessor::STAGE_NONE);
+    return processor;
+}
+
+const std::string& defaultConfig() {
+    static const std::string path = writePresetConfig(kPresets.front());
+    return path;
+}
+
+void setResolutionLabel(benchmark::State& state, const cv::Size& size) {
+    state.SetLabel(std::to_string(size.width) + "x" + std::to_string(size.height));
+    state.SetItemsProcessed(state.iterations());
+    state.counters["Mpix/s"] = benchmark::Counter(static_cast<double>(size.area()) * 1e-6 *
+                                                      static_cast<double>(state.iterations()),
+                                                  benchmark::Counter::kIsRate);
+}
+
+// Heap allocations of a benchmark's timed loop: construct right before the loop, report()
+// after it. Only counts in ENABLE_ALLOCATION_COUNTING builds (the hook is linked in then).
+class AllocationCounters {
+   public:
+    AllocationCounters() {
+#if BIRDS_ALLOCATION_COUNTING
+        AllocationCounter::countMatAllocations();
+        stages_ = AllocationCounter::stages();
+        counts_ = AllocationCounter::snapshot();
+#endif
+    }
+
+    void report(benchmark::State& state) const {
+#if BIRDS_ALLOCATION_COUNTING
+        const AllocationCounts total = AllocationCounter::snapshot() - counts_;
+        const StageAllocations stages = AllocationCounter::stages();
+        state.counters["allocs"] =
+            benchmark::Counter(static_cast<double>(total.allocations), benchmark::Counter::kAvgIterations);
+        state.counters["alloc_bytes"] =
+            benchmark::Counter(static_cast<double>(total.bytes), benchmark::Counter::kAvgIterations);
+        for (size_t i = 0; i < StageTimings::kStageCount; ++i) {
+            const uint64_t allocations = stages[i].allocations - stages_[i].allocations;
+            if (allocations == 0) continue;
+            state.counters[std::string("allocs:") + pipelineStageName(static_cast<PipelineStage>(i))] =
+                benchmark::Counter(static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+        }
+#else
+        (void)state;
+#endif
+    }
+
+   private:
+#if BIRDS_ALLOCATION_COUNTING
+    StageAllocations stages_{};
+    AllocationCounts counts_;
+#endif
+};
+
+// ============================================================================
+// MotionProcessor steps
+// ============================================================================
+
+void BM_Preprocess(benchmark::State& state) {
+    const cv::Size size = kResolutions[state.range(0)];
+    auto processor = makeProcessor(defaultConfig());
+    const cv::Mat frame = syntheticFrame(size, 0);
+    const AllocationCounters allocations;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(processor->preprocessFrame(frame));
+    }
+    allocations.report(state);
+    setResolutionLabel(state, size);
+}
+
+void BM_DetectMotion(benchmark::State& state) {
+    const cv::Size size = kResolutions[state.range(0)];
+    auto processor = makeProcessor(defaultConfig());
+    processor->setPrevFrame(processor->preprocessFrame(syntheticFrame(size, 0)));
+    processor->setFirstFrame(false);
+    const cv::Mat current = processor->preprocessFrame(syntheticFrame(size, 1));
+    cv::Mat frameDiff;
+    cv::Mat thresh;
+    const AllocationCounters allocations;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(processor->detectMotion(current, frameDiff, thresh));
+    }
+    allocations.report(state);
+    setResolutionLabel(state, size);
+}
+
+// Motion mask of a frame pair, for the mask-consuming steps
+cv::Mat motionMask(MotionProcessor& processor, const cv::Size& size) {
+    processor.setPrevFrame(processor.preprocessFrame(syntheticFrame(size, 0)));
+    const cv::Mat current = processor.preprocessFrame(syntheticFrame(size, 1));
+    cv::Mat frameDiff;
+    cv::Mat thresh;
+    return processor.detectMotion(current, frameDiff, thresh).clone();
+}
+
+void BM_Morphology(benchmark::State& state) {
+    const cv::Size size = kResolutions[state.range(0)];
+    auto processor = makeProcessor(defaultConfig());
+    const cv::Mat thresh = motionMask(*processor, size);
+    const AllocationCounters allocations;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(processor->applyMorphologicalOps(thresh));
+    }
+    allocations.report(state);
+    setResolutionLabel(state, size);
+}
+
+void BM_ExtractContours(benchmark::State& state) {
+    const cv::Size size = kResolutions[state.range(0)];
+    auto processor = makeProcessor(defaultConfig());
+    const cv::Mat morphological = processor->applyMorphologicalOps(motionMask(*processor, size));
+    const AllocationCounters allocations;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(processor->extractContours(morphological));
+    }
+    allocations.report(state);
+    setResolutionLabel(state, size);
+}
+
+// Preprocessing with one blur preset (registered in main); quality is the PSNR of its
+// output against the reference preset's, the result the fast filters stand in for
+void BM_Blur(benchmark::State& state, const std::string& configPath, const std::string& referencePath) {
+    const cv::Size size = kResolutions[state.range(0)];
+    auto processor = makeProcessor(configPath);
+    const cv::Mat frame = syntheticFrame(size, 0);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(processor->preprocessFrame(frame));
+    }
+    setResolutionLabel(state, size);
+
+    const cv::Mat blurred = processor->preprocessFrame(frame);
+    const cv::Mat reference = makeProcessor(referencePath)->preprocessFrame(frame);
+    state.counters["psnr_vs_reference"] = cv::PSNR(blurred, reference);
+}
+
+// Gaussian blur of one kernel size (range 0) on a 1080p luma frame: OpenCV (range 1 = 0) or
+// the FixedGaussianBlur instance for the size (range 1 = 1)
+void BM_GaussianKernel(benchmark::State& state) {
+    const int size = static_cast<int>(state.range(0));
+    const bool fixed = state.range(1) != 0;
+    cv::Mat gray;
+    cv::cvtColor(syntheticFrame(kResolutions[1], 0), gray, cv::COLOR_BGR2GRAY);
+    FixedGaussianBlur blur;
+    blur.plan(size);
+    FixedGaussianBlur::Workspace workspace;
+    cv::Mat blurred;
+    for (auto _ : state) {
+        if (!fixed || !blur.apply(gray, blurred, workspace)) cv::GaussianBlur(gray, blurred, cv::Size(size, size), 0);
+        benchmark::DoNotOptimize(blurred.data);
+    }
+    state.SetLabel(fixed ? "fixed" : "opencv");
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(gray.total()));
+}
+
+// Erosion with the elliptical kernel of one side (range 0) on a 1080p motion mask: OpenCV
+// (range 1 = 0) or the FixedMorphology instance (range 1 = 1)
+void BM_MorphologyKernel(benchmark::State& state) {
+    const int size = static_cast<int>(state.range(0));
+    const bool fixed = state.range(1) != 0;
+    auto processor = makeProcessor(defaultConfig());
+    const cv::Mat mask = motionMask(*processor, kResolutions[1]);
+    const cv::Mat kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(size, size));
+    FixedMorphology morphology;
+    morphology.plan(kernel);
+    FixedMorphology::Workspace workspace;
+    cv::Mat eroded;
+    for (auto _ : state) {
+        if (fixed) {
+            morphology.apply(false, mask, eroded, 1, workspace);
+        } else {
+            cv::erode(mask, eroded, kernel);
+        }
+        benchmark::DoNotOptimize(eroded.data);
+    }
+    state.SetLabel(fixed ? "fixed" : "opencv");
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(mask.total()));
+}
+
+// ============================================================================
+// Accuracy next to speed
+// ============================================================================
+
+// Ground truth of the moving sequence: the bounding box of each blob, per frame
+GroundTruth syntheticGroundTruth(const cv::Size& size) {
+    GroundTruth truth;
+    const int unit = size.width / 64;
+    const cv::Rect frameRect(cv::Point(), size);
+    for (int frame = 0; frame < kSequenceLength; ++frame) {
+        AnnotatedFrame annotation;
+        const std::vector<cv::Point> centers = blobCenters(size, frame);
+        for (size_t i = 0; i < centers.size(); ++i) {
+            std::vector<cv::Point> outline;
+            cv::ellipse2Poly(centers[i], cv::Size(unit, unit * 2 / 3), static_cast<int>(15 * i), 0, 360, 5, outline);
+            const cv::Rect box = cv::boundingRect(outline) & frameRect;
+            if (!box.empty()) annotation.boxes.push_back(box);
+        }
+        truth.add(frame, std::move(annotation));
+    }
+    return truth;
+}
+
+// Replays @p frames (frame i is ground truth frame i) through a fresh processor and
+// consolidator, @p laps times after @p warmupLaps, and adds the accuracy counters
+void reportAccuracy(benchmark::State& state, const std::string& configPath, const std::vector<cv::Mat>& frames,
+                    const GroundTruth& truth, double minIou, int warmupLaps, int laps) {
+    auto processor = makeProcessor(configPath);
+    ConsolidationConfig consolidation = PipelineConfig::load(configPath)->consolidation;
+    consolidation.frameSize = frames.front().size();
+    MotionRegionConsolidator consolidator(consolidation);
+    DetectionEvaluator evaluator(truth, minIou);
+    TrackedObjectStore objects;
+    std::vector<ConsolidatedRegion> regions;
+    const size_t warmup = static_cast<size_t>(warmupLaps) * frames.size();
+    for (size_t i = 0; i < warmup + static_cast<size_t>(laps) * frames.size(); ++i) {
+        const size_t frame = i % frames.size();
+        const std::vector<cv::Rect> boxes = processor->processFrame(frames[frame]).detectedBounds;
+        makeTrackedObjects(boxes, objects);
+        regions.clear();
+        if (!objects.empty()) regions = consolidator.consolidateRegions(objects);
+        if (i >= warmup) evaluator.addFrame(static_cast<int64_t>(frame), boxes, regions);
+    }
+    const AccuracyReport& report = evaluator.report();
+    state.counters["box_recall"] = report.boxes.recall();
+    state.counters["box_precision"] = report.boxes.precision();
+    state.counters["box_iou"] = report.boxes.meanOverlap();
+    state.counters["region_recall"] = report.regions.recall();
+    state.counters["region_precision"] = report.regions.precision();
+}
+
+// ============================================================================
+// processFrame end-to-end per preset (registered in main)
+// ============================================================================
+
+void BM_ProcessFrame(benchmark::State& state, const std::string& configPath) {
+    const cv::Size size = kResolutions[state.range(0)];
+    auto processor = makeProcessor(configPath);
+    const cv::Mat frames[2] = {syntheticFrame(size, 0), syntheticFrame(size, 1)};
+    processor->processFrame(frames[0]);  // Reference frame
+    int next = 1;
+    const AllocationCounters allocations;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(processor->processFrame(frames[next]));
+        next ^= 1;
+    }
+    allocations.report(state);
+    setResolutionLabel(state, size);
+
+    // Outside the timed loop, on the moving sequence. A two-frame difference box spans the
+    // blob's previous position too, so a match needs IoU 0.3 rather than the usual 0.5
+    std::vector<cv::Mat> sequence;
+    for (int i = 0; i < kSequenceLength; ++i) sequence.push_back(syntheticFrame(size, i));
+    reportAccuracy(state, configPath, sequence, syntheticGroundTruth(size), 0.3, 2, 4);
+}
+
+// Every frame of a frame cache in turn, looping (registered in main); @p truth may be null
+void BM_ProcessFrameCached(benchmark::State& state, const ReplayFrameSource& frames, const GroundTruth* truth) {
+    auto processor = makeProcessor(defaultConfig());
+    size_t next = 0;
+    const AllocationCounters allocations;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(processor->processFrame(frames.frame(next)));
+        if (++next == frames.size()) next = 0;
+    }
+    allocations.report(state);
+    setResolutionLabel(state, frames.frameSize());
+
+    if (truth) {
+        std::vector<cv::Mat> sequence;
+        for (size_t i = 0; i < frames.size(); ++i) sequence.push_back(frames.frame(i));
+        reportAccuracy(state, defaultConfig(), sequence, *truth, 0.5, 0, 1);
+    }
+}
+
+// ============================================================================
+// Background models: cost and detection quality (registered in main)
+// ============================================================================
+
+void BM_BackgroundModel(benchmark::State& state, const std::string& configPath) {
+    const cv::Size size = kResolutions[state.range(0)];
+    std::vector<cv::Mat> frames;
+    for (int i = 0; i < kSequenceLength; ++i) frames.push_back(syntheticFrame(size, i));
+
+    auto processor = makeProcessor(configPath);
+    processor->processFrame(frames[0]);  // Reference frame
+    int next = 1;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(processor->processFrame(frames[next]));
+        next = (next + 1) % kSequenceLength;
+    }
+    setResolutionLabel(state, size);
+
+    // Quality, outside the timed loop: after a warm-up lap, the share of blob centres
+    // inside a detected box and the boxes that contain no blob
+    auto scored = makeProcessor(configPath);
+    for (int i = 0; i < 2 * kSequenceLength; ++i) scored->processFrame(frames[i % kSequenceLength]);
+    size_t blobs = 0;
+    size_t found = 0;
+    size_t falseBoxes = 0;
+    const int laps = 4;
+    for (int i = 0; i < laps * kSequenceLength; ++i) {
+        const int frame = i % kSequenceLength;
+        const auto boxes = scored->processFrame(frames[frame]).detectedBounds;
+        const std::vector<cv::Point> centers = blobCenters(size, frame);
+        for (const cv::Point& center : centers) {
+            if (!cv::Rect(cv::Point(), size).contains(center)) continue;
+            ++blobs;
+            for (const cv::Rect& box : boxes) {
+                if (box.contains(center)) {
+                    ++found;
+                    break;
+                }
+            }
+        }
+        for (const cv::Rect& box : boxes) {
+            bool hit = false;
+            for (const cv::Point& center : centers) hit = hit || box.contains(center);
+            if (!hit) ++falseBoxes;
+        }
+    }
+    state.counters["recall"] = blobs > 0 ? static_cast<double>(found) / static_cast<double>(blobs) : 0.0;
+    state.counters["false_boxes/frame"] =
+        static_cast<double>(falseBoxes) / static_cast<double>(laps * kSequenceLength);
+}
+
+// ============================================================================
+// DBSCAN scaling
+// ============================================================================
+
+// N boxes on a 1080p frame: clustered = flocks of ~8 overlapping boxes, uniform = anywhere
+void syntheticBoxes(size_t count, bool clustered, TrackedObjectStore& store) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> sizeDist(20, 80);
+    std::vector<cv::Rect> boxes;
+    boxes.reserve(count);
+    if (clustered) {
+        std::uniform_int_distribution<int> centerX(100, 1820);
+        std::uniform_int_distribution<int> centerY(100, 980);
+        std::normal_distribution<double> spread(0.0, 40.0);
+        cv::Point center;
+        for (size_t i = 0; i < count; ++i) {
+            if (i % 8 == 0) center = cv::Point(centerX(rng), centerY(rng));
+            boxes.emplace_back(center.x + static_cast<int>(spread(rng)), center.y + static_cast<int>(spread(rng)),
+                               sizeDist(rng), sizeDist(rng));
+        }
+    } else {
+        std::uniform_int_distribution<int> x(0, 1840);
+        std::uniform_int_distribution<int> y(0, 1000);
+        for (size_t i = 0; i < count; ++i) boxes.emplace_back(x(rng), y(rng), sizeDist(rng), sizeDist(rng));
+    }
+    makeTrackedObjects(boxes, store);
+}
+
+void BM_DbscanClustering(benchmark::State& state, bool clustered, bool unionFind, bool parallel,
+                         DistanceMetric metric = DistanceMetric::OverlapEdge) {
+    const auto count = static_cast<size_t>(state.range(0));
+    ConsolidationConfig config;
+    config.frameSize = cv::Size(1920, 1080);
+    config.distanceMetric = metric;
+    config.unionFindClustering = unionFind;
+    config.parallelClusteringMinBoxes = parallel ? 1 : 0;
+    MotionRegionConsolidator consolidator(config);
+    TrackedObjectStore objects;
+    syntheticBoxes(count, clustered, objects);
+    size_t clusters = 0;
+    const AllocationCounters allocations;
+    for (auto _ : state) {
+        clusters = consolidator.clusterObjects(objects).size();
+        benchmark::ClobberMemory();
+    }
+    allocations.report(state);
+    state.SetComplexityN(state.range(0));
+    state.counters["clusters"] = static_cast<double>(clusters);
+}
+
+// ============================================================================
+// Recorded box streams (registered in main when a capture is given)
+// ============================================================================
+
+// BIRDS_BENCH_BOX_CAPTURE, else the capture configured at build time ("" = none)
+std::string boxCapturePath() {
+    const char* path = std::getenv("BIRDS_BENCH_BOX_CAPTURE");
+    return path && *path ? path : BENCH_BOX_CAPTURE_PATH;
+}
+
+// One iteration per recorded frame, looping over the capture. Copying a frame's boxes out of
+// the mapping stands in for the handoff from the detect stage, which also passes a vector.
+template <typename ProcessFrame>
+void runCapture(benchmark::State& state, const BoxCapture& capture, ProcessFrame processFrame) {
+    std::vector<cv::Rect> boxes;
+    size_t next = 0;
+    uint64_t boxCount = 0;
+    const AllocationCounters allocations;
+    for (auto _ : state) {
+        capture.frame(next).copyTo(boxes);
+        processFrame(boxes);
+        boxCount += boxes.size();
+        if (++next == capture.size()) next = 0;
+    }
+    allocations.report(state);
+    state.SetItemsProcessed(state.iterations());
+    state.counters["boxes/frame"] =
+        state.iterations() > 0 ? static_cast<double>(boxCount) / static_cast<double>(state.iterations()) : 0.0;
+}
+
+void BM_RecordedTracking(benchmark::State& state, const BoxCapture& capture) {
+    const auto config = PipelineConfig::load(defaultConfig());
+    ObjectTracker tracker(config->tracker);
+    TrackedObjectStore objects;
+    runCapture(state, capture, [&](const std::vector<cv::Rect>& boxes) {
+        tracker.update(boxes, objects);
+        benchmark::DoNotOptimize(objects.size());
+    });
+}
+
+// What the consolidate stage does per frame in src/main.cpp
+void BM_RecordedConsolidation(benchmark::State& state, const BoxCapture& capture) {
+    const auto config = PipelineConfig::load(defaultConfig());
+    ObjectTracker tracker(config->tracker);
+    ConsolidationConfig consolidation = config->consolidation;
+    consolidation.frameSize = capture.frameSize();
+    MotionRegionConsolidator consolidator(consolidation);
+    TrackedObjectStore objects;
+    FrameArena arena;
+    std::vector<ConsolidatedRegion> regions;
+    uint64_t regionCount = 0;
+    runCapture(state, capture, [&](const std::vector<cv::Rect>& boxes) {
+        if (config->trackerEnabled) {
+            tracker.update(boxes, objects);
+        } else {
+            makeTrackedObjects(boxes, objects);
+        }
+        if (!objects.empty()) {
+            consolidator.consolidateRegionsInto(objects, regions, &arena);
+            arena.reset();
+        }
+        regionCount += regions.size();
+    });
+    state.counters["regions/frame"] =
+        state.iterations() > 0 ? static_cast<double>(regionCount) / static_cast<double>(state.iterations()) : 0.0;
+}
+
+// ============================================================================
+// Stage handoff queues
+// ============================================================================
+
+// What a stage link carries: a frame header (shared pixels) and an index, like FramePacket
+struct HandoffItem {
+    int64_t frameIndex = 0;
+    cv::Mat frame;
+};
+
+// Producers call tryPush until @p stop is set; the caller's loop is the consumer
+template <typename TryPush>
+std::vector<std::thread> startProducers(int count, const std::atomic<bool>& stop, TryPush tryPush) {
+    static const cv::Mat frame(720, 1280, CV_8UC3, cv::Scalar::all(0));
+    std::vector<std::thread> producers;
+    for (int p = 0; p < count; ++p) {
+        producers.emplace_back([&stop, tryPush, p]() mutable {
+            HandoffItem item{p, frame};
+            for (int64_t index = p; !stop.load(std::memory_order_relaxed);) {
+                if (tryPush(item)) {
+                    index += 4;
+                    item = HandoffItem{index, frame};
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    return producers;
+}
+
+// Mutex baseline: BoundedQueue with the Block policy, one item per pop
+void BM_BoundedQueueHandoff(benchmark::State& state) {
+    BoundedQueue<HandoffItem> queue(64, BackpressurePolicy::Block);
+    std::atomic<bool> stop{false};
+    auto producers = startProducers(static_cast<int>(state.range(0)), stop,
+                                    [&queue](HandoffItem& item) { return queue.push(std::move(item)); });
+    int64_t items = 0;
+    for (auto _ : state) {
+        auto item = queue.pop();
+        benchmark::DoNotOptimize(item->frameIndex);
+        ++items;
+    }
+    stop = true;
+    queue.close();
+    for (auto& producer : producers) producer.join();
+    state.SetItemsProcessed(items);
+}
+
+// The blocking adapter the pipeline uses with ENABLE_LOCKFREE_QUEUES; range(0) = producers
+// (1: QueueLink::Fixed, an SpscRing)
+void BM_LockFreeQueueHandoff(benchmark::State& state) {
+    const auto producerCount = static_cast<int>(state.range(0));
+    LockFreeQueue<HandoffItem> queue(64, BackpressurePolicy::Block,
+                                     producerCount == 1 ? QueueLink::Fixed : QueueLink::Shared);
+    std::atomic<bool> stop{false};
+    auto producers = startProducers(producerCount, stop,
+                                    [&queue](HandoffItem& item) { return queue.push(std::move(item)); });
+    int64_t items = 0;
+    for (auto _ : state) {
+        auto item = queue.pop();
+        benchmark::DoNotOptimize(item->frameIndex);
+        ++items;
+    }
+    stop = true;
+    queue.close();
+    for (auto& producer : producers) producer.join();
+    state.SetItemsProcessed(items);
+    state.counters["high_watermark"] = static_cast<double>(queue.highWatermark());
+}
+
+// Consumer side of the ring benchmarks: one tryPop or one popBatch per iteration
+template <typename Ring>
+void consumeHandoff(benchmark::State& state, Ring& ring, size_t batchSize) {
+    std::vector<HandoffItem> batch;
+    batch.reserve(batchSize);
+    HandoffItem item;
+    int64_t items = 0;
+    for (auto _ : state) {
+        if (batchSize == 1) {
+            while (!ring.tryPop(item)) std::this_thread::yield();
+            benchmark::DoNotOptimize(item.frameIndex);
+            ++items;
+        } else {
+            batch.clear();
+            while (ring.popBatch(batch, batchSize) == 0) std::this_thread::yield();
+            benchmark::DoNotOptimize(batch.back().frameIndex);
+            items += static_cast<int64_t>(batch.size());
+        }
+    }
+    state.SetItemsProcessed(items);
+    state.counters["high_watermark"] = static_cast<double>(ring.occupancy().highWatermark);
+}
+
+// range(0) = batch size (1: tryPop)
+void BM_SpscRingHandoff(benchmark::State& state) {
+    SpscRing<HandoffItem> ring(64);
+    std::atomic<bool> stop{false};
+    auto producers = startProducers(1, stop, [&ring](HandoffItem& item) { return ring.tryPush(std::move(item)); });
+    consumeHandoff(state, ring, static_cast<size_t>(state.range(0)));
+    stop = true;
+    for (auto& producer : producers) producer.join();
+}
+
+// range(0) = producers, range(1) = batch size (1: tryPop)
+void BM_MpmcRingHandoff(benchmark::State& state) {
+    MpmcRing<HandoffItem> ring(64);
+    std::atomic<bool> stop{false};
+    auto producers = startProducers(static_cast<int>(state.range(0)), stop,
+                                    [&ring](HandoffItem& item) { return ring.tryPush(std::move(item)); });
+    consumeHandoff(state, ring, static_cast<size_t>(state.range(1)));
+    stop = true;
+    for (auto& producer : producers) producer.join();
+}
+
+// ============================================================================
+// Central uplink ingest
+// ============================================================================
+
+template <typename T>
+void appendLittleEndian(std::vector<unsigned char>& out, T value) {
+    for (size_t i = 0; i < sizeof(T); ++i) out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+}
+
+// A frame message as an edge sends it: a document with two regions and one 8 KB crop
+std::vector<unsigned char> edgeFrameMessage() {
+    StoredFrameRecord record;
+    record.uuid = "3f0c9a52-5d7e-4b8e-9a61-7c2d0f4e1b23";
+    record.originalSize = {1920, 1080};
+    record.processedSize = {1920, 1080};
+    record.originalThumbnailPath = "data/frames/thumbnails/3f0c9a52.jpg";
+    record.regionCrops.push_back({"data/regions/3f0c9a52_0.jpg", {400, 300, 120, 90}, {380, 280, 160, 130}});
+    record.metadata.source = "camera";
+    record.metadata.timestamp = 1760000000;
+    record.metadata.motionDetected = true;
+    record.metadata.motionRegions = 5;
+    for (const cv::Rect& box : {cv::Rect(400, 300, 120, 90), cv::Rect(1500, 200, 60, 40)}) {
+        RegionMetadata region;
+        region.box = box;
+        region.objectCount = 2;
+        record.metadata.consolidatedRegions.push_back(region);
+    }
+    record.metadata.captureTimeUs = 1760000000000000;
+    const std::string document = frameDocumentJson(record, 1760000000500);
+    const std::vector<unsigned char> crop(8 << 10, 0x5a);
+
+    std::vector<unsigned char> message;
+    appendLittleEndian(message, uplink_wire::kMessageMagic);
+    message.push_back(uplink_wire::kFrameMessage);
+    message.push_back(0);
+    appendLittleEndian(message, static_cast<uint16_t>(1));
+    appendLittleEndian(message, static_cast<uint32_t>(document.size()));
+    message.insert(message.end(), document.begin(), document.end());
+    appendLittleEndian(message, static_cast<uint32_t>(crop.size()));
+    message.insert(message.end(), crop.begin(), crop.end());
+    return message;
+}
+
+bool sendAll(int fd, const std::vector<unsigned char>& bytes) {
+    for (size_t sent = 0; sent < bytes.size();) {
+        const ssize_t n = ::send(fd, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// range(0) edges, each with its own connection, send kMessagesPerEdge frames per iteration;
+// the iteration ends when the server has stored all of them
+void BM_UplinkIngest(benchmark::State& state) {
+    constexpr size_t kMessagesPerEdge = 4;
+    const size_t edges = static_cast<size_t>(state.range(0));
+    const rlim_t needed = static_cast<rlim_t>(2 * edges + 256);  // Both ends of every connection
+    rlimit limit{};
+    ::getrlimit(RLIMIT_NOFILE, &limit);
+    if (limit.rlim_cur < needed) {
+        limit.rlim_cur = std::min(needed, limit.rlim_max);
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    if (limit.rlim_cur < needed) {
+        state.SkipWithError("open-file limit too low for this many edges (raise ulimit -n)");
+        return;
+    }
+
+    PersistenceBackendConfig backendConfig;
+    backendConfig.name = "none";
+    UplinkIngestConfig config;
+    config.listenAddress = "127.0.0.1";
+    config.port = 0;
+    config.cropPath = "";
+    config.batchWindow = std::chrono::milliseconds(5);
+    UplinkIngestServer server(config, makePersistenceBackend(backendConfig));
+    if (!server.start()) {
+        state.SkipWithError("ingest server could not listen");
+        return;
+    }
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(server.port()));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    std::vector<int> sockets;
+    for (size_t i = 0; i < edges; ++i) {
+        const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0 || ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            if (fd >= 0) ::close(fd);
+            break;
+        }
+        const std::string site = "edge-" + std::to_string(i);
+        std::vector<unsigned char> hello;
+        appendLittleEndian(hello, uplink_wire::kHelloMagic);
+        appendLittleEndian(hello, uplink_wire::kVersion);
+        appendLittleEndian(hello, static_cast<uint16_t>(site.size()));
+        hello.insert(hello.end(), site.begin(), site.end());
+        sendAll(fd, hello);
+        sockets.push_back(fd);
+    }
+    const auto connected = [&] { return server.stats().activeConnections >= edges; };
+    for (int wait = 0; sockets.size() == edges && !connected() && wait < 1000; ++wait) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (sockets.size() < edges || !connected()) {
+        for (const int fd : sockets) ::close(fd);
+        state.SkipWithError("could not connect every simulated edge");
+        return;
+    }
+
+    const std::vector<unsigned char> message = edgeFrameMessage();
+    const UplinkIngestStats before = server.stats();
+    unsigned char acks[4096];
+    for (auto _ : state) {
+        const uint64_t target = server.stats().stored + edges * kMessagesPerEdge;
+        for (size_t m = 0; m < kMessagesPerEdge; ++m) {
+            for (const int fd : sockets) sendAll(fd, message);
+        }
+        while (server.stats().stored < target) std::this_thread::sleep_for(std::chrono::microseconds(200));
+
+        state.PauseTiming();  // Keep the edges' receive buffers from filling with acks
+        for (const int fd : sockets) {
+            while (::recv(fd, acks, sizeof(acks), MSG_DONTWAIT) > 0) {
+            }
+        }
+        state.ResumeTiming();
+    }
+    const UplinkIngestStats after = server.stats();
+    const auto messages = static_cast<int64_t>(after.stored - before.stored);
+    state.SetItemsProcessed(messages);
+    state.SetBytesProcessed(static_cast<int64_t>(after.bytesReceived - before.bytesReceived));
+    state.counters["docs/bulk_write"] =
+        after.bulkWrites > before.bulkWrites
+            ? static_cast<double>(messages) / static_cast<double>(after.bulkWrites - before.bulkWrites)
+            : 0.0;
+    for (const int fd : sockets) ::close(fd);
+    server.stop();
+}
+
+// ============================================================================
+// Storage codecs
+// ============================================================================
+
+// Arguments: effort, then 0 = 1080p frame, 1 = 320x240 region crop
+cv::Mat codecImage(int64_t kind) {
+    const cv::Mat frame = syntheticFrame(cv::Size(1920, 1080), 0);
+    return kind == 0 ? frame : frame(cv::Rect(0, 0, 320, 240)).clone();
+}
+
+// Encode ms/MP, bytes per image and decode ms/MP of @p bytes; skipped when OpenCV cannot read it
+void reportCodecCounters(benchmark::State& state, const cv::Mat& image, double encodeSeconds,
+                         const std::vector<unsigned char>& bytes) {
+    const double megapixels = static_cast<double>(image.total()) * 1e-6;
+    state.SetLabel(std::to_string(image.cols) + "x" + std::to_string(image.rows));
+    state.counters["ms/MP"] = encodeSeconds * 1e3 / megapixels / static_cast<double>(state.iterations());
+    state.counters["bytes/image"] = static_cast<double>(bytes.size());
+    state.counters["bits/pixel"] = static_cast<double>(bytes.size()) * 8.0 / static_cast<double>(image.total());
+    constexpr int kDecodes = 5;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kDecodes; ++i) {
+        cv::Mat decoded;
+        try {
+            decoded = cv::imdecode(bytes, cv::IMREAD_UNCHANGED);
+        } catch (const cv::Exception&) {
+        }
+        if (decoded.empty()) return;
+        benchmark::DoNotOptimize(decoded.data);
+    }
+    const double decodeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    state.counters["decode_ms/MP"] = decodeSeconds * 1e3 / megapixels / kDecodes;
+}
+
+void BM_ImageEncode(benchmark::State& state, ImageCodec codec) {
+    if (!ImageEncoder::available(codec)) {
+        state.SkipWithError((std::string(imageCodecName(codec)) + " is not built in").c_str());
+        return;
+    }
+    const cv::Mat image = codecImage(state.range(1));
+    ImageEncodeSettings settings;
+    settings.codec = codec;
+    settings.quality = 90;
+    settings.effort = static_cast<int>(state.range(0));
+    std::vector<unsigned char> bytes;
+    double seconds = 0.0;
+    for (auto _ : state) {
+        const auto start = std::chrono::steady_clock::now();
+        if (!ImageEncoder::encode(image, settings, bytes)) {
+            state.SkipWithError("encoding failed");
+            return;
+        }
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    reportCodecCounters(state, image, seconds, bytes);
+}
+
+// What the ingest service does to the edges' JPEG crops (uplink_ingest.recompress_crops);
+// argument: image kind as in codecImage()
+void BM_JpegXlRecompress(benchmark::State& state) {
+    if (!ImageEncoder::available(ImageCodec::JpegXl)) {
+        state.SkipWithError("jxl is not built in");
+        return;
+    }
+    const cv::Mat image = codecImage(state.range(0));
+    std::vector<unsigned char> jpeg;
+    ImageEncoder::encode(image, ImageEncodeSettings{ImageCodec::Jpeg, 90, 1}, jpeg);
+    std::vector<unsigned char> bytes;
+    double seconds = 0.0;
+    for (auto _ : state) {
+        const auto start = std::chrono::steady_clock::now();
+        if (!ImageEncoder::recompressJpeg(jpeg, bytes)) {
+            state.SkipWithError("recompression failed");
+            return;
+        }
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    reportCodecCounters(state, image, seconds, bytes);
+    state.counters["saved_%"] = 100.0 * (1.0 - static_cast<double>(bytes.size()) / static_cast<double>(jpeg.size()));
+}
+
+// Cropping four consolidated regions out of a stored 1080p JPEG. Argument: 0 = full cv::imdecode
+// then slicing (what get_frame and the batch job did), 1 = JpegRegionDecoder at full
+// resolution, 2 = JpegRegionDecoder scaled for a 64 px classifier input
+void BM_JpegRegionDecode(benchmark::State& state) {
+    const int64_t mode = state.range(0);
+    std::vector<unsigned char> jpeg;
+    ImageEncoder::encode(codecImage(0), ImageEncodeSettings{ImageCodec::Jpeg, 90, 1}, jpeg);
+    const std::vector<cv::Rect> regions = {cv::Rect(100, 120, 240, 180), cv::Rect(900, 500, 320, 260),
+                                           cv::Rect(1500, 80, 200, 200), cv::Rect(400, 800, 360, 240)};
+    std::vector<cv::Mat> images;
+    for (auto _ : state) {
+        if (mode == 0) {
+            const cv::Mat frame = cv::imdecode(jpeg, cv::IMREAD_COLOR);
+            images.clear();
+            for (const cv::Rect& region : regions) images.push_back(frame(region).clone());
+        } else if (!JpegRegionDecoder::decode(jpeg, regions, mode == 2 ? 64 : 0, images)) {
+            state.SkipWithError("decoding failed");
+            return;
+        }
+        benchmark::DoNotOptimize(images.data());
+    }
+    state.SetLabel(JpegRegionDecoder::backendName());
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(regions.size()));
+}
+
+void codecArgs(benchmark::internal::Benchmark* benchmark) {
+    for (int64_t kind : {0, 1}) {
+        for (int64_t effort : {1, 3, 7}) benchmark->Args({effort, kind});
+    }
+    benchmark->Unit(benchmark::kMillisecond);
+}
+
+void resolutionArgs(benchmark::internal::Benchmark* benchmark) {
+    for (size_t i = 0; i < kResolutions.size(); ++i) benchmark->Arg(static_cast<int64_t>(i));
+    benchmark->Unit(benchmark::kMillisecond);
+}
+
+// Every specialized size, OpenCV then the fixed-size instance
+void kernelSizeArgs(benchmark::internal::Benchmark* benchmark, std::initializer_list<int64_t> sizes) {
+    for (int64_t size : sizes) {
+        for (int64_t fixed : {0, 1}) benchmark->Args({size, fixed});
+    }
+    benchmark->Unit(benchmark::kMicrosecond);
+}
+
+void boxCountArgs(benchmark::internal::Benchmark* benchmark) {
+    for (int64_t count : {10, 50, 100, 250, 500, 1000, 2000}) benchmark->Arg(count);
+    benchmark->Unit(benchmark::kMicrosecond)->Complexity();
+}
+
+// --compare mode: report the differences between two result files
+int compareRuns(int argc, char** argv) {
+    if (argc < 4) {
+        std::fprintf(stderr, "Usage: %s --compare <baseline.json> <current.json> [--alpha X] [--min-change X]\n",
+                     argv[0]);
+        return 2;
+    }
+    BenchComparisonOptions options;
+    for (int i = 4; i + 1 < argc; i += 2) {
+        const std::string flag = argv[i];
+        if (flag == "--alpha") {
+            options.alpha = std::stod(argv[i + 1]);
+        } else if (flag == "--min-change") {
+            options.minChange = std::stod(argv[i + 1]);
+        } else {
+            std::fprintf(stderr, "Unknown option %s\n", flag.c_str());
+            return 2;
+        }
+    }
+    try {
+        const BenchComparison comparison =
+            compareBenchmarks(loadBenchmarkJson(argv[2]), loadBenchmarkJson(argv[3]), options);
+        printBenchComparison(std::cout, comparison);
+        return comparison.regressions() + comparison.qualityRegressions() > 0 ? 1 : 0;
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 2;
+    }
+}
+
+}  // namespace
+
+BENCHMARK(BM_Preprocess)->Apply(resolutionArgs);
+BENCHMARK(BM_DetectMotion)->Apply(resolutionArgs);
+BENCHMARK(BM_Morphology)->Apply(resolutionArgs);
+BENCHMARK(BM_ExtractContours)->Apply(resolutionArgs);
+BENCHMARK(BM_GaussianKernel)->Apply([](benchmark::internal::Benchmark* b) { kernelSizeArgs(b, {3, 5, 7, 9, 11}); });
+BENCHMARK(BM_MorphologyKernel)->Apply([](benchmark::internal::Benchmark* b) { kernelSizeArgs(b, {3, 5, 7}); });
+BENCHMARK_CAPTURE(BM_DbscanClustering, clustered, true, true, false)->Apply(boxCountArgs);
+BENCHMARK_CAPTURE(BM_DbscanClustering, uniform, false, true, false)->Apply(boxCountArgs);
+BENCHMARK_CAPTURE(BM_DbscanClustering, clustered_queue, true, false, false)->Apply(boxCountArgs);
+BENCHMARK_CAPTURE(BM_DbscanClustering, uniform_queue, false, false, false)->Apply(boxCountArgs);
+BENCHMARK_CAPTURE(BM_DbscanClustering, clustered_parallel, true, true, true)->Apply(boxCountArgs);
+BENCHMARK_CAPTURE(BM_DbscanClustering, uniform_parallel, false, true, true)->Apply(boxCountArgs);
+BENCHMARK_CAPTURE(BM_DbscanClustering, clustered_edge_gap, true, true, false, DistanceMetric::EdgeGap)
+    ->Apply(boxCountArgs);
+BENCHMARK_CAPTURE(BM_DbscanClustering, clustered_center_linf, true, true, false, DistanceMetric::CenterChebyshev)
+    ->Apply(boxCountArgs);
+BENCHMARK_CAPTURE(BM_DbscanClustering, clustered_iou, true, true, false, DistanceMetric::Iou)->Apply(boxCountArgs);
+BENCHMARK(BM_BoundedQueueHandoff)->Arg(1)->Arg(4)->UseRealTime();
+BENCHMARK(BM_LockFreeQueueHandoff)->Arg(1)->Arg(4)->UseRealTime();
+BENCHMARK(BM_SpscRingHandoff)->Arg(1)->Arg(16)->UseRealTime();
+BENCHMARK(BM_MpmcRingHandoff)->Args({1, 1})->Args({4, 1})->Args({4, 16})->UseRealTime();
+BENCHMARK_CAPTURE(BM_ImageEncode, jpeg, ImageCodec::Jpeg)->Apply(codecArgs);
+BENCHMARK_CAPTURE(BM_ImageEncode, webp, ImageCodec::WebP)->Apply(codecArgs);
+BENCHMARK_CAPTURE(BM_ImageEncode, avif, ImageCodec::Avif)->Apply(codecArgs);
+BENCHMARK_CAPTURE(BM_ImageEncode, jxl, ImageCodec::JpegXl)->Apply(codecArgs);
+BENCHMARK(BM_JpegXlRecompress)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_JpegRegionDecode)->Arg(0)->Arg(1)->Arg(2)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_UplinkIngest)->Arg(1000)->Arg(5000)->Arg(10000)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "--compare") return compareRuns(argc, argv);
+    Logger::init("warn", "birds_of_play_bench.log", false);
+
+    for (const auto& preset : kPresets) {
+        const std::string configPath = writePresetConfig(preset);
+        benchmark::RegisterBenchmark((std::string("BM_ProcessFrame/") + preset.name).c_str(),
+                                     [configPath](benchmark::State& state) { BM_ProcessFrame(state, configPath); })
+            ->Apply(resolutionArgs);
+    }
+    for (const auto& preset : kBackgroundPresets) {
+        const std::string configPath = writePresetConfig(preset);
+        benchmark::RegisterBenchmark((std::string("BM_BackgroundModel/") + preset.name).c_str(),
+                                     [configPath](benchmark::State& state) { BM_BackgroundModel(state, configPath); })
+            ->Apply(resolutionArgs);
+    }
+    for (const auto* presets : {&kBlurPresets, &kSmoothingPresets}) {
+        const std::string referencePath = writePresetConfig(presets->front());
+        for (const auto& preset : *presets) {
+            const std::string configPath = writePresetConfig(preset);
+            benchmark::RegisterBenchmark((std::string("BM_Blur/") + preset.name).c_str(),
+                                         [configPath, referencePath](benchmark::State& state) {
+                                             BM_Blur(state, configPath, referencePath);
+                                         })
+                ->Apply(resolutionArgs);
+        }
+    }
+
+    // Recorded footage, decoded once by birds_of_play_frame_cache
+    std::unique_ptr<ReplayFrameSource> cachedFrames;
+    std::unique_ptr<GroundTruth> cachedTruth;
+    if (const char* cachePath = std::getenv("BIRDS_BENCH_FRAME_CACHE"); cachePath && *cachePath) {
+        try {
+            cachedFrames = std::make_unique<ReplayFrameSource>(ReplayFrameSource::fromFrameCache(cachePath));
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "%s\n", e.what());
+            return 1;
+        }
+        if (const char* truthPath = std::getenv("BIRDS_BENCH_GROUND_TRUTH"); truthPath && *truthPath) {
+            try {
+                cachedTruth = std::make_unique<GroundTruth>(GroundTruth::load(truthPath));
+            } catch (const std::exception& e) {
+                std::fprintf(stderr, "%s\n", e.what());
+                return 1;
+            }
+            benchmark::AddCustomContext("ground_truth", std::filesystem::path(truthPath).filename().string());
+        }
+        const ReplayFrameSource& frames = *cachedFrames;
+        const GroundTruth* truth = cachedTruth.get();
+        benchmark::RegisterBenchmark("BM_ProcessFrameCached", [&frames, truth](benchmark::State& state) {
+            BM_ProcessFrameCached(state, frames, truth);
+        })->Unit(benchmark::kMillisecond);
+        benchmark::AddCustomContext("frame_cache", std::filesystem::path(cachePath).filename().string());
+    }
+
+    // Real box streams from a busy feeder, when a capture was recorded
+    // (birds_of_play_replay --record-boxes, or box_capture in config.yaml)
+    std::unique_ptr<BoxCapture> capture;
+    if (const std::string capturePath = boxCapturePath(); !capturePath.empty()) {
+        try {
+            capture = std::make_unique<BoxCapture>(BoxCapture::open(capturePath));
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "%s\n", e.what());
+            return 1;
+        }
+        if (!capture->empty()) {
+            const std::string label = std::filesystem::path(capturePath).filename().string();
+            const BoxCapture& frames = *capture;
+            benchmark::RegisterBenchmark("BM_RecordedTracking",
+                                         [&frames](benchmark::State& state) { BM_RecordedTracking(state, frames); })
+                ->Unit(benchmark::kMicrosecond);
+            benchmark::RegisterBenchmark("BM_RecordedConsolidation", [&frames](benchmark::State& state) {
+                BM_RecordedConsolidation(state, frames);
+            })->Unit(benchmark::kMicrosecond);
+            benchmark::AddCustomContext("box_capture", label);
+        }
+    }
+
+    // Lets bench_compare runs tell a plain build from an LTO/PGO one
+    benchmark::AddCustomContext("build_flavor", BIRDS_BUILD_FLAVOR);
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
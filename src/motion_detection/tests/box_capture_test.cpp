@@ -0,0 +1,117 @@
+#include "box_capture.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "logger.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("debug", "box_capture_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class BoxCaptureTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const boxCaptureEnv =
+    ::testing::AddGlobalTestEnvironment(new BoxCaptureTestEnvironment());
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string capturePath(const char* name) {
+    return (fs::temp_directory_path() / (std::string("birds_") + name + ".bobx")).string();
+}
+
+// Frame i has i boxes
+std::vector<cv::Rect> boxesOfFrame(int frame) {
+    std::vector<cv::Rect> boxes;
+    for (int i = 0; i < frame; ++i) boxes.emplace_back(10 * frame + i, -i, 20 + i, 30);
+    return boxes;
+}
+
+}  // namespace
+
+TEST(BoxCaptureTest, RoundTripsFramesAndBoxes) {
+    const std::string path = capturePath("box_capture_round_trip");
+    {
+        BoxCaptureWriter writer(path, cv::Size(1920, 1080));
+        // Enough frames to go through several buffer writes
+        for (int frame = 0; frame < 3000; ++frame) {
+            ASSERT_TRUE(writer.append(100 + frame, 1000 * frame, boxesOfFrame(frame % 7)));
+        }
+        EXPECT_TRUE(writer.close());
+        EXPECT_FALSE(writer.append(0, 0, {}));
+    }
+
+    const BoxCapture capture = BoxCapture::open(path);
+    EXPECT_TRUE(capture.isComplete());
+    ASSERT_EQ(capture.size(), 3000u);
+    EXPECT_EQ(capture.frameSize(), cv::Size(1920, 1080));
+    std::vector<cv::Rect> boxes;
+    uint64_t totalBoxes = 0;
+    for (size_t i = 0; i < capture.size(); ++i) {
+        const BoxCaptureFrame frame = capture.frame(i);
+        EXPECT_EQ(frame.frameIndex, static_cast<int64_t>(100 + i));
+        EXPECT_EQ(frame.timestampUs, static_cast<int64_t>(1000 * i));
+        frame.copyTo(boxes);
+        ASSERT_EQ(boxes, boxesOfFrame(static_cast<int>(i % 7))) << "frame " << i;
+        totalBoxes += boxes.size();
+    }
+    EXPECT_EQ(capture.totalBoxes(), totalBoxes);
+    EXPECT_THROW(capture.frame(3000), std::out_of_range);
+    fs::remove(path);
+}
+
+// A capture the writer never closed (crash) is read up to its last complete frame
+TEST(BoxCaptureTest, UnclosedCaptureKeepsCompleteFrames) {
+    const std::string path = capturePath("box_capture_unclosed");
+    const std::string copy = capturePath("box_capture_unclosed_copy");
+    {
+        BoxCaptureWriter writer(path, cv::Size(640, 480));
+        for (int frame = 0; frame < 4; ++frame) writer.append(frame, frame, boxesOfFrame(3));
+        ASSERT_TRUE(writer.close());
+    }
+    // Header as the writer leaves it before close(), and half of the last frame gone
+    fs::copy_file(path, copy, fs::copy_options::overwrite_existing);
+    {
+        std::fstream file(copy, std::ios::in | std::ios::out | std::ios::binary);
+        const box_capture_layout::FileHeader header{box_capture_layout::kMagic,
+                                                    box_capture_layout::kVersion, 640, 480, 0, 0,
+                                                    0, 0};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+    fs::resize_file(copy, fs::file_size(copy) - 20);
+
+    const BoxCapture capture = BoxCapture::open(copy);
+    EXPECT_FALSE(capture.isComplete());
+    EXPECT_EQ(capture.size(), 3u);
+    EXPECT_EQ(capture.totalBoxes(), 9u);
+    EXPECT_EQ(capture.frame(2).boxCount, 3u);
+    fs::remove(path);
+    fs::remove(copy);
+}
+
+TEST(BoxCaptureTest, RejectsOtherFiles) {
+    const std::string path = capturePath("box_capture_not_a_capture");
+    std::ofstream(path) << std::string(64, 'x');
+    EXPECT_THROW(BoxCapture::open(path), std::runtime_error);
+    EXPECT_THROW(BoxCapture::open(capturePath("box_capture_missing")), std::runtime_error);
+    EXPECT_THROW(BoxCaptureWriter("/nonexistent/dir/capture.bobx", cv::Size(1, 1)),
+                 std::runtime_error);
+    fs::remove(path);
+}
@@ -0,0 +1,220 @@
+#include "capture_source.hpp"
+
+#include <gtest/gtest.h>
+
+#include <opencv2/opencv.hpp>
+#include <stdexcept>
+#include <vector>
+
+#include "frame_buffer_pool.hpp"
+#include "logger.hpp"
+#include "memory_placement.hpp"
+#include "motion_vector_map.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("debug", "capture_source_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class CaptureSourceTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const captureSourceEnv =
+    ::testing::AddGlobalTestEnvironment(new CaptureSourceTestEnvironment());
+
+TEST(FrameBufferPoolTest, ReusesReleasedBuffers) {
+    FrameBufferPool pool(2);
+    const unsigned char* first = nullptr;
+    {
+        cv::Mat frame = pool.acquire(cv::Size(64, 48), CV_8UC3);
+        first = frame.data;
+    }
+    // Only the pool references the buffer again, so the next acquire writes into it
+    cv::Mat again = pool.acquire(cv::Size(64, 48), CV_8UC3);
+    EXPECT_EQ(again.data, first);
+    EXPECT_EQ(pool.allocations(), 1u);
+    EXPECT_EQ(pool.reuses(), 1u);
+}
+
+TEST(FrameBufferPoolTest, NeverHandsOutABufferStillInUse) {
+    FrameBufferPool pool(2);
+    cv::Mat a = pool.acquire(cv::Size(32, 32), CV_8UC1);
+    cv::Mat b = pool.acquire(cv::Size(32, 32), CV_8UC1);
+    EXPECT_NE(a.data, b.data);
+    EXPECT_EQ(pool.pooled(), 2u);
+
+    // Exhausted: an unpooled buffer, not one of the two held above
+    cv::Mat c = pool.acquire(cv::Size(32, 32), CV_8UC1);
+    EXPECT_NE(c.data, a.data);
+    EXPECT_NE(c.data, b.data);
+    EXPECT_EQ(pool.pooled(), 2u);
+    EXPECT_EQ(pool.allocations(), 3u);
+
+    // A released slot is reallocated in place when the frame layout changes
+    b.release();
+    cv::Mat resized = pool.acquire(cv::Size(64, 64), CV_8UC1);
+    EXPECT_EQ(resized.size(), cv::Size(64, 64));
+    EXPECT_NE(resized.data, a.data);
+    EXPECT_EQ(pool.allocations(), 4u);
+}
+
+TEST(FrameBufferPoolTest, PlacedBuffersAreReusedLikeDefaultOnes) {
+    MemoryPlacement placement;
+    EXPECT_EQ(PlacedMatAllocator::forPlacement(placement), nullptr);
+    placement.hugePages = true;
+    cv::MatAllocator* allocator = PlacedMatAllocator::forPlacement(placement);
+    ASSERT_NE(allocator, nullptr);
+    EXPECT_EQ(PlacedMatAllocator::forPlacement(placement), allocator);  // One per placement
+
+    FrameBufferPool pool(2);
+    pool.setAllocator(allocator);
+    const unsigned char* first = nullptr;
+    {
+        cv::Mat frame = pool.acquire(cv::Size(640, 480), CV_8UC3);
+        EXPECT_EQ(frame.allocator, allocator);
+        frame.setTo(cv::Scalar(1, 2, 3));
+        cv::Mat copy = frame.clone();  // Derived Mats use the default allocator again
+        EXPECT_EQ(cv::norm(frame, copy, cv::NORM_INF), 0.0);
+        first = frame.data;
+    }
+    cv::Mat again = pool.acquire(cv::Size(640, 480), CV_8UC3);
+    EXPECT_EQ(again.data, first);
+    EXPECT_EQ(pool.allocations(), 1u);
+}
+
+TEST(CaptureSourceTest, ParsesBackendAndDecoderNames) {
+    EXPECT_EQ(parseCaptureBackend("GStreamer"), CaptureBackend::GStreamer);
+    EXPECT_EQ(parseCaptureBackend("v4l2"), CaptureBackend::V4L2);
+    EXPECT_STREQ(captureBackendName(CaptureBackend::FFmpeg), "ffmpeg");
+    EXPECT_EQ(parseHardwareDecode("vaapi"), HardwareDecode::Vaapi);
+    EXPECT_STREQ(hardwareDecodeName(HardwareDecode::Nvidia), "nvidia");
+    EXPECT_THROW(parseCaptureBackend("dshow"), std::invalid_argument);
+    EXPECT_THROW(parseHardwareDecode("cuda"), std::invalid_argument);
+}
+
+TEST(CaptureSourceTest, BuildsRtspPipelineWithHardwareDecode) {
+    CaptureConfig config;
+    config.source = "rtsp://camera.local/stream1";
+    config.hardwareDecode = HardwareDecode::Nvidia;
+    config.lumaOnly = true;
+    const std::string pipeline = CaptureSource::buildGStreamerPipeline(config);
+    EXPECT_NE(pipeline.find("rtspsrc location=rtsp://camera.local/stream1 latency=200"), std::string::npos);
+    EXPECT_NE(pipeline.find("rtph264depay ! h264parse ! nvv4l2decoder ! nvvidconv ! video/x-raw,format=GRAY8"),
+              std::string::npos);
+    EXPECT_NE(pipeline.find("appsink drop=true max-buffers=1"), std::string::npos);
+
+    config.hardwareDecode = HardwareDecode::Vaapi;
+    config.codec = "h265";
+    config.lumaOnly = false;
+    const std::string vaapi = CaptureSource::buildGStreamerPipeline(config);
+    EXPECT_NE(vaapi.find("rtph265depay ! h265parse ! vaapih265dec ! videoconvert ! video/x-raw,format=BGR"),
+              std::string::npos);
+}
+
+TEST(CaptureSourceTest, FilePipelineDeliversEveryFrame) {
+    CaptureConfig config;
+    config.source = "/videos/bird feeder.mp4";
+    const std::string pipeline = CaptureSource::buildGStreamerPipeline(config);
+    EXPECT_EQ(pipeline.rfind("filesrc location=\"/videos/bird feeder.mp4\" ! decodebin", 0), 0u);
+    EXPECT_EQ(pipeline.find("drop=true"), std::string::npos);
+}
+
+TEST(CaptureSourceTest, OpenFailsForMissingSource) {
+    CaptureConfig config;
+    config.source = "/nonexistent/video.mp4";
+    CaptureSource source(config);
+    EXPECT_FALSE(source.open());
+    EXPECT_FALSE(source.isOpened());
+
+    // Nothing to peek at or read, and probing does not throw
+    EXPECT_TRUE(source.peek().empty());
+    cv::Mat frame;
+    EXPECT_FALSE(source.read(frame));
+    EXPECT_EQ(source.probe().frameSize.area(), 0);
+}
+
+TEST(MotionVectorMapTest, GroupsMovingMacroblocksIntoRegions) {
+    MotionVectorMap map(16);
+    map.reset(cv::Size(200, 100));  // 13 x 7 macroblocks, the last column and row partial
+    EXPECT_EQ(map.motion().size(), cv::Size(13, 7));
+
+    // Background: every macroblock predicted with a zero or sub-threshold vector...
+    for (int y = 0; y < 100; y += 16) {
+        for (int x = 0; x < 200; x += 16) map.addVector(cv::Rect(x, y, 16, 16), 0.25f, 0.0f);
+    }
+    // ...except a bird moving across two 8x8 partitions and the macroblock beside them
+    map.addVector(cv::Rect(32, 32, 8, 8), 3.0f, 4.0f);
+    map.addVector(cv::Rect(40, 40, 8, 8), -2.0f, 0.0f);
+    map.addVector(cv::Rect(48, 32, 16, 16), 1.5f, 0.0f);
+    // One isolated noisy macroblock in the partial corner, and one outside the frame
+    map.addVector(cv::Rect(192, 96, 16, 16), 2.0f, 0.0f);
+    map.addVector(cv::Rect(300, 0, 16, 16), 9.0f, 0.0f);
+    EXPECT_EQ(map.vectorCount(), 13u * 7u + 4u);
+    EXPECT_FLOAT_EQ(map.motion().at<float>(2, 2), 5.0f);
+
+    EXPECT_EQ(map.flag(1.0, true), 3);
+    const std::vector<cv::Rect> regions = map.regions(2);
+    ASSERT_EQ(regions.size(), 1u);
+    EXPECT_EQ(regions[0], cv::Rect(32, 32, 32, 16));
+    ASSERT_EQ(map.regions(1).size(), 2u);
+    // Clipped to the frame: the bottom-right macroblock holds 8 x 4 pixels
+    EXPECT_EQ(map.regions(1)[1], cv::Rect(192, 96, 8, 4));
+}
+
+TEST(MotionVectorMapTest, UncoveredMacroblocksAreIntraCoded) {
+    MotionVectorMap map(16);
+    map.reset(cv::Size(64, 64));
+    for (int y = 0; y < 64; y += 16) {
+        for (int x = 0; x < 64; x += 16) {
+            if (x < 32 || y < 32) map.addVector(cv::Rect(x, y, 16, 16), 0.0f, 0.0f);
+        }
+    }
+    // The encoder intra-coded the bottom-right quarter: new content, no vector to report
+    EXPECT_EQ(map.flag(1.0, false), 0);
+    EXPECT_TRUE(map.regions(1).empty());
+    EXPECT_EQ(map.flag(1.0, true), 4);
+    const std::vector<cv::Rect> regions = map.regions(2);
+    ASSERT_EQ(regions.size(), 1u);
+    EXPECT_EQ(regions[0], cv::Rect(32, 32, 32, 32));
+}
+
+TEST(CaptureSourceTest, MotionVectorBackendFailsForMissingSource) {
+    EXPECT_EQ(parseCaptureBackend("motion_vectors"), CaptureBackend::MotionVectors);
+    EXPECT_STREQ(captureBackendName(CaptureBackend::MotionVectors), "motion_vectors");
+
+    // With libav or through the ffmpeg fallback, a missing file does not open
+    CaptureConfig config;
+    config.backend = CaptureBackend::MotionVectors;
+    config.source = "/nonexistent/video.mp4";
+    CaptureSource source(config);
+    EXPECT_FALSE(source.open());
+    EXPECT_FALSE(source.isOpened());
+    cv::Mat frame;
+    EXPECT_FALSE(source.read(frame));
+    EXPECT_TRUE(source.motionVectorRegions().empty());
+    EXPECT_EQ(source.vectorSkippedFrames(), 0u);
+}
+
+TEST(CaptureSourceTest, DecodeAheadBackendFailsForMissingSource) {
+    EXPECT_EQ(parseCaptureBackend("decode_ahead"), CaptureBackend::DecodeAhead);
+    EXPECT_STREQ(captureBackendName(CaptureBackend::DecodeAhead), "decode_ahead");
+
+    CaptureConfig config;
+    config.backend = CaptureBackend::DecodeAhead;
+    config.source = "/nonexistent/video.mp4";
+    CaptureSource source(config);
+    EXPECT_FALSE(source.open());
+    EXPECT_FALSE(source.isOpened());
+    source.setDecodeStride(3);  // Nothing to decode: no-op
+    cv::Mat frame;
+    EXPECT_FALSE(source.read(frame));
+    EXPECT_EQ(source.lastSkippedFrames(), 0u);
+}
@@ -0,0 +1,110 @@
+#include "classification_cache.hpp"
+
+#include <gtest/gtest.h>
+
+#include <opencv2/opencv.hpp>
+
+namespace {
+
+// A bird-colored box on a gray frame
+cv::Mat sceneWithBox(const cv::Rect& box, const cv::Scalar& color) {
+    cv::Mat frame(240, 320, CV_8UC3, cv::Scalar(90, 90, 90));
+    cv::rectangle(frame, box, color, cv::FILLED);
+    return frame;
+}
+
+ClassificationCacheConfig testConfig() {
+    ClassificationCacheConfig config;
+    config.refreshIntervalFrames = 10;
+    config.uncertainRetryFrames = 3;
+    return config;
+}
+
+const cv::Scalar kBrown(40, 70, 120);
+
+}  // namespace
+
+TEST(ClassificationCacheTest, ReusesAConfidentLabelUntilTheRefreshInterval) {
+    ClassificationCache cache(testConfig(), 0.5f);
+    const cv::Rect box(100, 80, 40, 30);
+    const cv::Mat frame = sceneWithBox(box, kBrown);
+
+    cache.advanceFrame();
+    ASSERT_TRUE(cache.needsClassification(7, frame, box));
+    cache.store(7, frame, box, "bird", 0.9f, 14);
+
+    for (int f = 1; f < 10; ++f) {
+        cache.advanceFrame();
+        EXPECT_FALSE(cache.needsClassification(7, frame, box)) << "frame " << f;
+    }
+    cache.advanceFrame();
+    EXPECT_TRUE(cache.needsClassification(7, frame, box));
+
+    const ClassificationCacheStats& stats = cache.getStats();
+    EXPECT_EQ(stats.newTracks, 1u);
+    EXPECT_EQ(stats.hits, 9u);
+    EXPECT_EQ(stats.refreshes, 1u);
+    ASSERT_NE(cache.find(7), nullptr);
+    EXPECT_EQ(cache.find(7)->label, "bird");
+}
+
+TEST(ClassificationCacheTest, SizeOrAppearanceChangeInvalidatesTheLabel) {
+    ClassificationCache cache(testConfig(), 0.5f);
+    const cv::Rect box(100, 80, 40, 30);
+    const cv::Mat frame = sceneWithBox(box, kBrown);
+    cache.advanceFrame();
+    cache.store(1, frame, box, "bird", 0.9f, 14);
+
+    // Slight jitter keeps the label
+    cache.advanceFrame();
+    EXPECT_FALSE(cache.needsClassification(1, frame, cv::Rect(101, 80, 40, 31)));
+
+    // The box doubled: something else (or more of it) is in view
+    cache.advanceFrame();
+    const cv::Rect grown(100, 80, 80, 30);
+    EXPECT_TRUE(cache.needsClassification(1, sceneWithBox(grown, kBrown), grown));
+
+    // Same box, different content
+    cache.advanceFrame();
+    EXPECT_TRUE(cache.needsClassification(1, sceneWithBox(box, cv::Scalar(250, 250, 250)), box));
+    EXPECT_EQ(cache.getStats().refreshes, 2u);
+}
+
+TEST(ClassificationCacheTest, UncertainTracksAreRetriedAtTheRetryInterval) {
+    ClassificationCache cache(testConfig(), 0.5f);
+    const cv::Rect box(10, 10, 20, 20);
+    const cv::Mat frame = sceneWithBox(box, kBrown);
+    cache.advanceFrame();
+    cache.store(3, frame, box, "bird", 0.2f, 14);  // Below the threshold
+
+    int attempts = 0;
+    for (int f = 0; f < 9; ++f) {
+        cache.advanceFrame();
+        if (cache.needsClassification(3, frame, box)) {
+            attempts++;
+            cache.store(3, frame, box, "unknown", 0.0f, -1);  // Still nothing confident
+        }
+    }
+    EXPECT_EQ(attempts, 3);  // Frames 3, 6 and 9 after the first attempt
+    EXPECT_EQ(cache.find(3)->label, "unknown");
+}
+
+TEST(ClassificationCacheTest, RetainForgetsEndedTracks) {
+    ClassificationCache cache(testConfig(), 0.5f);
+    const cv::Mat frame = sceneWithBox(cv::Rect(0, 0, 10, 10), kBrown);
+    for (int id = 0; id < 4; ++id) cache.store(id, frame, cv::Rect(0, 0, 10, 10), "bird", 0.9f, 14);
+    cache.retain({1, 3});
+    EXPECT_EQ(cache.size(), 2u);
+    EXPECT_EQ(cache.find(0), nullptr);
+    EXPECT_NE(cache.find(3), nullptr);
+}
+
+TEST(ClassificationCacheTest, AppearanceDistanceIsZeroForIdenticalThumbnails) {
+    const cv::Rect box(50, 50, 64, 48);
+    const cv::Mat frame = sceneWithBox(box, kBrown);
+    const cv::Mat a = ClassificationCache::thumbnail(frame, box);
+    ASSERT_EQ(a.size(), cv::Size(8, 8));
+    EXPECT_DOUBLE_EQ(ClassificationCache::appearanceDistance(a, a), 0.0);
+    EXPECT_DOUBLE_EQ(ClassificationCache::appearanceDistance(a, cv::Mat()), 1.0);
+    EXPECT_TRUE(ClassificationCache::thumbnail(frame, cv::Rect(400, 400, 10, 10)).empty());
+}
@@ -0,0 +1,81 @@
+#include "debug_artifact_writer.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <opencv2/opencv.hpp>
+
+#include "logger.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("debug", "debug_artifact_writer_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class DebugArtifactWriterTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const debugArtifactWriterEnv =
+    ::testing::AddGlobalTestEnvironment(new DebugArtifactWriterTestEnvironment());
+
+namespace {
+
+cv::Mat makeImage() { return cv::Mat(48, 64, CV_8UC3, cv::Scalar(10, 120, 200)); }
+
+}  // namespace
+
+TEST(DebugArtifactWriterTest, WritesIntoNewDirectories) {
+    const auto dir = std::filesystem::temp_directory_path() / "birds_debug_artifact_test";
+    std::filesystem::remove_all(dir);
+    {
+        DebugArtifactWriter writer;
+        const std::string path = (dir / "nested" / "frame_1.jpg").string();
+        EXPECT_TRUE(writer.submit(path, makeImage()));
+        writer.flush();
+
+        EXPECT_TRUE(std::filesystem::exists(path));
+        const DebugArtifactStats stats = writer.getStats();
+        EXPECT_EQ(stats.written, 1u);
+        EXPECT_EQ(stats.failed, 0u);
+        EXPECT_EQ(stats.queued, 0u);
+    }
+    std::filesystem::remove_all(dir);
+}
+
+TEST(DebugArtifactWriterTest, KeepsOneInEverySampledArtifact) {
+    const auto dir = std::filesystem::temp_directory_path() / "birds_debug_artifact_sampling";
+    std::filesystem::remove_all(dir);
+    {
+        DebugArtifactWriter writer;
+        writer.setSampleEvery(3);
+        int accepted = 0;
+        for (int i = 0; i < 9; ++i) {
+            const std::string path = (dir / ("frame_" + std::to_string(i) + ".jpg")).string();
+            if (writer.submit(path, makeImage())) ++accepted;
+        }
+        writer.flush();
+
+        EXPECT_EQ(accepted, 3);
+        EXPECT_EQ(writer.getStats().skipped, 6u);
+        EXPECT_EQ(writer.getStats().written, 3u);
+        EXPECT_TRUE(std::filesystem::exists(dir / "frame_0.jpg"));
+        EXPECT_FALSE(std::filesystem::exists(dir / "frame_1.jpg"));
+        EXPECT_TRUE(std::filesystem::exists(dir / "frame_3.jpg"));
+    }
+    std::filesystem::remove_all(dir);
+}
+
+TEST(DebugArtifactWriterTest, RejectsEmptyImages) {
+    DebugArtifactWriter writer;
+    EXPECT_FALSE(writer.submit("unused.jpg", cv::Mat()));
+    writer.flush();
+    EXPECT_EQ(writer.getStats().written, 0u);
+}
@@ -0,0 +1,163 @@
+#include "detection_event_publisher.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logger.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("debug", "detection_event_publisher_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class DetectionEventPublisherTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const detectionEventPublisherEnv =
+    ::testing::AddGlobalTestEnvironment(new DetectionEventPublisherTestEnvironment());
+
+namespace {
+
+// Send function that keeps every payload it is handed
+struct CapturingTransport {
+    std::mutex mutex;
+    std::vector<std::string> topics;
+    std::vector<std::vector<uint8_t>> payloads;
+    bool accept = true;
+
+    DetectionEventPublisher::SendFunction sender() {
+        return [this](const std::string& topic, const std::vector<uint8_t>& payload) {
+            std::lock_guard<std::mutex> lock(mutex);
+            topics.push_back(topic);
+            payloads.push_back(payload);
+            return accept;
+        };
+    }
+};
+
+EventPublisherConfig testConfig(EventGranularity granularity) {
+    EventPublisherConfig config;
+    config.enabled = true;
+    config.stream = "cam";
+    config.topic = "birds";
+    config.granularity = granularity;
+    config.batchWindow = std::chrono::milliseconds(200);
+    return config;
+}
+
+ConsolidatedRegion labelledRegion(const cv::Rect& box, RegionObjectIds ids, const std::string& label,
+                                  float confidence) {
+    ConsolidatedRegion region(box, std::move(ids));
+    region.classLabel = label;
+    region.classId = 0;
+    region.classConfidence = confidence;
+    return region;
+}
+
+}  // namespace
+
+// The positional MessagePack layout, byte for byte
+TEST(DetectionEventPublisherTest, EncodesCompactMessagePack) {
+    PublishedEvent event;
+    event.frameIndex = 300;
+    event.captureUnixMs = -1;
+    PublishedRegion region;
+    region.box = cv::Rect(1, 2, 200, 4);
+    region.trackIds = {7};
+    region.label = "bird";
+    region.confidence = 1.0f;
+    event.regions.push_back(region);
+
+    std::vector<uint8_t> out;
+    encodeEventBatch("cam", EventGranularity::Frame, {event}, out);
+    const std::vector<uint8_t> expected = {
+        0x94, 0x01, 0xa3, 'c', 'a', 'm', 0xa5, 'f', 'r', 'a', 'm', 'e',  // [1, "cam", "frame",
+        0x91,                                                            //  [
+        0x93, 0xcd, 0x01, 0x2c, 0xff,                                    //   [300, -1,
+        0x91, 0x97, 0x01, 0x02, 0xcc, 0xc8, 0x04,                        //    [[1, 2, 200, 4,
+        0x91, 0x07,                                                      //      [7],
+        0xa4, 'b', 'i', 'r', 'd', 0xca, 0x3f, 0x80, 0x00, 0x00};         //      "bird", 1.0]]]]]
+    EXPECT_EQ(out, expected);
+
+    encodeEventBatch("cam", EventGranularity::Track, {}, out);
+    EXPECT_EQ(out, (std::vector<uint8_t>{0x94, 0x01, 0xa3, 'c', 'a', 'm', 0xa5, 't', 'r', 'a', 'c', 'k', 0x90}));
+}
+
+// Frames published inside one window leave as one batch; quiet frames are skipped
+TEST(DetectionEventPublisherTest, BatchesFramesWithinTheWindow) {
+    CapturingTransport transport;
+    {
+        DetectionEventPublisher publisher(testConfig(EventGranularity::Frame), transport.sender());
+        EXPECT_FALSE(publisher.wantsTrackIds());
+        publisher.publish(1, 1000000, {}, {}, {ConsolidatedRegion(cv::Rect(0, 0, 5, 5), {1})});
+        publisher.publish(2, 1033000, {}, {}, {});  // No regions: motion_only skips it
+        publisher.publish(3, 1066000, {}, {}, {labelledRegion(cv::Rect(9, 9, 5, 5), {2, 3}, "bird", 0.5f)});
+    }  // The destructor publishes the open batch
+
+    ASSERT_EQ(transport.payloads.size(), 1u);
+    EXPECT_EQ(transport.topics[0], "birds");
+
+    PublishedEvent first;
+    first.frameIndex = 1;
+    first.captureUnixMs = 1000;
+    first.regions.push_back({cv::Rect(0, 0, 5, 5), {1}, "", 0.0f});  // Unclassified: empty label
+    PublishedEvent third;
+    third.frameIndex = 3;
+    third.captureUnixMs = 1066;
+    third.regions.push_back({cv::Rect(9, 9, 5, 5), {2, 3}, "bird", 0.5f});
+    std::vector<uint8_t> expected;
+    encodeEventBatch("cam", EventGranularity::Frame, {first, third}, expected);
+    EXPECT_EQ(transport.payloads[0], expected);
+}
+
+// A full batch does not wait for its window; refused batches are counted, not retried
+TEST(DetectionEventPublisherTest, FlushesFullBatchesAndCountsRefusals) {
+    CapturingTransport transport;
+    transport.accept = false;
+    EventPublisherConfig config = testConfig(EventGranularity::Track);
+    config.batchWindow = std::chrono::seconds(10);
+    config.maxBatchEvents = 2;
+    {
+        DetectionEventPublisher publisher(config, transport.sender());
+        EXPECT_TRUE(publisher.wantsTrackIds());
+        const std::vector<ConsolidatedRegion> regions = {labelledRegion(cv::Rect(0, 0, 50, 50), {4}, "cat", 0.9f)};
+        publisher.publish(1, 0, {{1, 1, 2, 2}, {3, 3, 2, 2}}, {4, 5}, regions);
+        publisher.publish(2, 0, {{1, 1, 2, 2}}, {4}, regions);
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (publisher.stats().batches == 0 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        const EventPublisherStats stats = publisher.stats();
+        EXPECT_EQ(stats.submitted, 2u);
+        EXPECT_EQ(stats.batches, 1u);
+        EXPECT_EQ(stats.failed, 2u);
+        EXPECT_EQ(stats.published, 0u);
+        EXPECT_EQ(stats.bytes, 0u);
+    }
+
+    ASSERT_EQ(transport.payloads.size(), 1u);
+    PublishedEvent first;
+    first.frameIndex = 1;
+    first.tracks.push_back({4, cv::Rect(1, 1, 2, 2), "cat", 0.9f});
+    first.tracks.push_back({5, cv::Rect(3, 3, 2, 2), "", 0.0f});  // In no region
+    PublishedEvent second;
+    second.frameIndex = 2;
+    second.tracks.push_back({4, cv::Rect(1, 1, 2, 2), "cat", 0.9f});
+    std::vector<uint8_t> expected;
+    encodeEventBatch("cam", EventGranularity::Track, {first, second}, expected);
+    EXPECT_EQ(transport.payloads[0], expected);
+}
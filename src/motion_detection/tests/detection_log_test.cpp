@@ -0,0 +1,160 @@
+#include "detection_log.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "logger.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("debug", "detection_log_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class DetectionLogTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const detectionLogEnv =
+    ::testing::AddGlobalTestEnvironment(new DetectionLogTestEnvironment());
+
+namespace fs = std::filesystem;
+
+namespace {
+
+DetectionLogConfig testConfig(const fs::path& dir) {
+    DetectionLogConfig config;
+    config.enabled = true;
+    config.directory = dir.string();
+    config.rowGroupFrames = 3;
+    return config;
+}
+
+std::vector<fs::path> logFiles(const fs::path& dir) {
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::directory_iterator(dir)) files.push_back(entry.path());
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+}  // namespace
+
+// Boxes, regions and their membership come back column by column, one row group per flush
+TEST(DetectionLogTest, RoundTripsColumnsAndMembership) {
+    const fs::path dir = fs::temp_directory_path() / "birds_detection_log_test";
+    fs::remove_all(dir);
+    {
+        DetectionLog log(testConfig(dir));
+        // Frame 10: three boxes (objects 7, 8, 9); one region of objects 9 and 7
+        log.append(10, 1000, 0, {{1, 2, 3, 4}, {10, 20, 30, 40}, {50, 60, 7, 8}}, {7, 8, 9},
+                   {ConsolidatedRegion(cv::Rect(1, 2, 60, 70), {9, 7})});
+        log.append(11, 2000, 1, {}, {}, {});  // A quiet frame still gets its row
+        EXPECT_FALSE(log.flushDue());
+        // Frame 12: coordinates beyond int16 are clamped; unknown IDs have no member
+        log.append(12, 3000, 0, {{40000, -40000, 5, 5}}, {3},
+                   {ConsolidatedRegion(cv::Rect(0, 0, 9, 9), {3, 99})});
+        EXPECT_TRUE(log.flushDue());  // rowGroupFrames reached
+        ASSERT_TRUE(log.flush());
+        EXPECT_FALSE(log.flushDue());
+
+        log.append(13, 4000, 0, {{5, 5, 5, 5}}, {1}, {});
+        const DetectionLogStats stats = log.getStats();
+        EXPECT_EQ(stats.framesLogged, 4u);
+        EXPECT_EQ(stats.framesWritten, 3u);
+        EXPECT_EQ(stats.rowGroupsWritten, 1u);
+        EXPECT_EQ(stats.pendingFrames, 1u);
+    }  // The destructor writes frame 13
+
+    const std::vector<fs::path> files = logFiles(dir);
+    ASSERT_EQ(files.size(), 1u);
+    DetectionLogReader reader(files[0].string());
+    ASSERT_TRUE(reader.isOpen());
+
+    DetectionLogColumns group;
+    ASSERT_TRUE(reader.next(group));
+    ASSERT_EQ(group.frames(), 3u);
+    EXPECT_EQ(group.frameIndex, (std::vector<int64_t>{10, 11, 12}));
+    EXPECT_EQ(group.timestampUs, (std::vector<int64_t>{1000, 2000, 3000}));
+    EXPECT_EQ(group.stream, (std::vector<uint16_t>{0, 1, 0}));
+    EXPECT_EQ(group.boxOffsets, (std::vector<int32_t>{0, 3, 3, 4}));
+    EXPECT_EQ(group.regionOffsets, (std::vector<int32_t>{0, 1, 1, 2}));
+    EXPECT_EQ(group.boxX, (std::vector<int16_t>{1, 10, 50, 32767}));
+    EXPECT_EQ(group.boxY, (std::vector<int16_t>{2, 20, 60, -32768}));
+    EXPECT_EQ(group.boxObjectId, (std::vector<int32_t>{7, 8, 9, 3}));
+    EXPECT_EQ(group.regionWidth, (std::vector<int16_t>{60, 9}));
+    EXPECT_EQ(group.memberOffsets, (std::vector<int32_t>{0, 2, 3}));
+    EXPECT_EQ(group.memberBox, (std::vector<int32_t>{2, 0, 3}));  // Row-group box indices
+
+    ASSERT_TRUE(reader.next(group));
+    EXPECT_EQ(group.frameIndex, (std::vector<int64_t>{13}));
+    EXPECT_EQ(group.boxOffsets, (std::vector<int32_t>{0, 1}));
+    EXPECT_FALSE(reader.next(group));
+    fs::remove_all(dir);
+}
+
+// A row group cut short by a crash is skipped; the ones before it stay readable
+TEST(DetectionLogTest, TruncatedRowGroupEndsTheFile) {
+    const fs::path dir = fs::temp_directory_path() / "birds_detection_log_truncated";
+    fs::remove_all(dir);
+    {
+        DetectionLog log(testConfig(dir));
+        log.append(1, 1, 0, {{1, 1, 1, 1}}, {0}, {});
+        ASSERT_TRUE(log.flush());
+        log.append(2, 2, 0, {{2, 2, 2, 2}}, {0}, {});
+        ASSERT_TRUE(log.flush());
+    }
+    const fs::path file = logFiles(dir).at(0);
+    fs::resize_file(file, fs::file_size(file) - 4);
+
+    DetectionLogReader reader(file.string());
+    DetectionLogColumns group;
+    ASSERT_TRUE(reader.next(group));
+    EXPECT_EQ(group.frameIndex, (std::vector<int64_t>{1}));
+    EXPECT_FALSE(reader.next(group));
+    fs::remove_all(dir);
+}
+
+// Row groups go to a new file once the current one would exceed fileBytes
+TEST(DetectionLogTest, RollsFilesAndFlushesOldRowGroups) {
+    const fs::path dir = fs::temp_directory_path() / "birds_detection_log_roll";
+    fs::remove_all(dir);
+    DetectionLogConfig config = testConfig(dir);
+    config.rowGroupFrames = 1000;
+    config.flushInterval = std::chrono::milliseconds(20);
+    config.fileBytes = 400;  // Roughly two small row groups
+    {
+        DetectionLog log(config);
+        for (int i = 0; i < 6; ++i) {
+            log.append(i, i, 0, {{i, i, 4, 4}}, {i}, {});
+            EXPECT_FALSE(log.flushDue());
+            EXPECT_TRUE(log.flushDue(std::chrono::steady_clock::now() + config.flushInterval));
+            ASSERT_TRUE(log.flush());
+        }
+    }
+
+    const std::vector<fs::path> files = logFiles(dir);
+    ASSERT_GT(files.size(), 1u);
+    int64_t expected = 0;
+    for (const fs::path& file : files) {
+        EXPECT_LE(fs::file_size(file), config.fileBytes);
+        DetectionLogReader reader(file.string());
+        DetectionLogColumns group;
+        while (reader.next(group)) {
+            ASSERT_EQ(group.frames(), 1u);
+            EXPECT_EQ(group.frameIndex[0], expected++);
+        }
+    }
+    EXPECT_EQ(expected, 6);
+    fs::remove_all(dir);
+}
@@ -0,0 +1,97 @@
+#include "event_clip_recorder.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <opencv2/opencv.hpp>
+
+#include "logger.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("debug", "event_clip_recorder_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class EventClipRecorderTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const eventClipRecorderEnv =
+    ::testing::AddGlobalTestEnvironment(new EventClipRecorderTestEnvironment());
+
+namespace {
+
+// OpenCV's built-in MJPEG writer, so the tests do not depend on FFmpeg or GStreamer
+ClipRecorderConfig testConfig(const std::filesystem::path& dir) {
+    ClipRecorderConfig config;
+    config.enabled = true;
+    config.outputDir = dir.string();
+    config.preRollSeconds = 0.5;   // 5 frames at 10 fps
+    config.postRollSeconds = 0.3;  // 3 frames
+    config.codec = "MJPG";
+    config.extension = ".avi";
+    config.hardwareEncode = false;
+    config.backpressure = BackpressurePolicy::Block;
+    return config;
+}
+
+cv::Mat makeFrame(int index) {
+    cv::Mat frame(96, 128, CV_8UC3, cv::Scalar(30, 60, 90));
+    cv::putText(frame, std::to_string(index), cv::Point(10, 60), cv::FONT_HERSHEY_SIMPLEX, 1.0,
+                cv::Scalar(255, 255, 255), 2);
+    return frame;
+}
+
+int countFrames(const std::string& path) {
+    cv::VideoCapture capture(path);
+    int frames = 0;
+    cv::Mat frame;
+    while (capture.read(frame)) ++frames;
+    return frames;
+}
+
+}  // namespace
+
+TEST(EventClipRecorderTest, ClipHoldsPreRollEventAndPostRoll) {
+    const auto dir = std::filesystem::temp_directory_path() / "birds_event_clip_test";
+    std::filesystem::remove_all(dir);
+    {
+        EventClipRecorder recorder(testConfig(dir));
+        recorder.start(10.0);
+        int index = 0;
+        for (int i = 0; i < 20; ++i) recorder.push(makeFrame(index++), false);  // Quiet
+        for (int i = 0; i < 6; ++i) recorder.push(makeFrame(index++), true);    // Event
+        for (int i = 0; i < 10; ++i) recorder.push(makeFrame(index++), false);  // Quiet again
+        recorder.stop();
+
+        const ClipRecorderStats stats = recorder.getStats();
+        EXPECT_EQ(stats.clipsWritten, 1u);
+        EXPECT_FALSE(stats.recording);
+        // 5 pre-roll + 6 event + 3 post-roll frames
+        EXPECT_EQ(stats.framesWritten, 14u);
+        // Quiet frames after the clip closed went back into the pre-roll as JPEGs
+        EXPECT_EQ(stats.preRollFrames, 5u);
+        EXPECT_GT(stats.preRollBytes, 0u);
+        EXPECT_LT(stats.preRollBytes, 5u * 96 * 128 * 3);
+
+        ASSERT_FALSE(recorder.lastClipPath().empty());
+        EXPECT_EQ(countFrames(recorder.lastClipPath()), 14);
+    }
+    std::filesystem::remove_all(dir);
+}
+
+TEST(EventClipRecorderTest, DisabledRecorderIgnoresFrames) {
+    ClipRecorderConfig config;
+    EventClipRecorder recorder(config);
+    recorder.start(30.0);
+    EXPECT_FALSE(recorder.push(makeFrame(0), true));
+    recorder.stop();
+    EXPECT_EQ(recorder.getStats().framesWritten, 0u);
+}
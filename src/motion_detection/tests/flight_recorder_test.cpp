@@ -0,0 +1,142 @@
+#include "flight_recorder.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <opencv2/imgcodecs.hpp>
+#include <string>
+#include <vector>
+
+#include "logger.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("debug", "flight_recorder_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class FlightRecorderTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const flightRecorderEnv =
+    ::testing::AddGlobalTestEnvironment(new FlightRecorderTestEnvironment());
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// 320 x 240 stages with one box, as processFrame() leaves them with every stage retained
+MotionProcessor::ProcessingResult makeResult(int frame) {
+    MotionProcessor::ProcessingResult result;
+    result.processedFrame = cv::Mat(240, 320, CV_8UC1, cv::Scalar(frame));
+    result.frameDiff = cv::Mat(240, 320, CV_8UC1, cv::Scalar(10));
+    result.thresh = cv::Mat::zeros(240, 320, CV_8UC1);
+    result.morphological = cv::Mat::zeros(240, 320, CV_8UC1);
+    result.detectedBounds = {cv::Rect(10 + frame, 20, 30, 30)};
+    result.hasMotion = true;
+    return result;
+}
+
+std::vector<std::string> readLines(const fs::path& path) {
+    std::ifstream in(path);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(in, line);) lines.push_back(line);
+    return lines;
+}
+
+FlightRecorderConfig testConfig(const char* name) {
+    FlightRecorderConfig config;
+    config.enabled = true;
+    config.directory = (fs::temp_directory_path() / name).string();
+    config.frames = 8;
+    config.thumbnailSide = 64;
+    fs::remove_all(config.directory);
+    return config;
+}
+
+}  // namespace
+
+// The ring keeps the last frames at thumbnail size and writes them, oldest first, only when asked
+TEST(FlightRecorderTest, DumpsTheLastFramesOnRequest) {
+    const FlightRecorderConfig config = testConfig("birds_flight_recorder");
+    FlightRecorder recorder(config);
+    EXPECT_FALSE(recorder.requestDump("early"));  // Nothing recorded yet
+
+    for (int frame = 0; frame < 20; ++frame) {
+        recorder.record(frame, 1700000000000000 + frame, cv::Size(640, 480), makeResult(frame));
+    }
+    EXPECT_FALSE(fs::exists(config.directory));  // Nothing written without a trigger
+
+    ASSERT_TRUE(recorder.requestDump("manual dump!"));
+    recorder.waitIdle();
+    const FlightRecorderStats stats = recorder.getStats();
+    EXPECT_EQ(stats.recorded, 20u);
+    EXPECT_EQ(stats.capacity, 8u);
+    EXPECT_EQ(stats.bytes, 8u * 4 * 64 * 48);
+    EXPECT_EQ(stats.dumps, 1u);
+
+    const fs::path dump = recorder.lastDumpPath();
+    EXPECT_NE(dump.filename().string().find("_manualdump"), std::string::npos) << dump;
+    const std::vector<std::string> lines = readLines(dump / "frames.csv");
+    ASSERT_EQ(lines.size(), 9u);
+    EXPECT_EQ(lines[1], "12,1700000000000012,none,22 20 30 30");
+    EXPECT_EQ(lines[8], "19,1700000000000019,none,29 20 30 30");
+    for (const char* stage : {"processed", "boxes", "diff", "thresh", "morphological"}) {
+        const cv::Mat image = cv::imread((dump / ("frame_000019_" + std::string(stage) + ".png")).string(),
+                                         cv::IMREAD_UNCHANGED);
+        ASSERT_FALSE(image.empty()) << stage;
+        EXPECT_EQ(image.size(), cv::Size(64, 48)) << stage;
+    }
+    EXPECT_FALSE(fs::exists(dump / "frame_000011_processed.png"));  // Overwritten in the ring
+
+    // A smaller cap holds fewer frames
+    FlightRecorderConfig capped = config;
+    capped.maxBytes = 3 * 4 * 64 * 48 + 100;
+    FlightRecorder small(capped);
+    small.record(0, 0, cv::Size(640, 480), makeResult(0));
+    EXPECT_EQ(small.getStats().capacity, 3u);
+    fs::remove_all(config.directory);
+}
+
+// Flood frames and SLO breaches dump at most once per interval; explicit requests always do
+TEST(FlightRecorderTest, AutomaticTriggersAreRateLimited) {
+    FlightRecorderConfig config = testConfig("birds_flight_recorder_triggers");
+    config.latencySloMs = 100.0;
+    config.minDumpIntervalSeconds = 3600.0;
+    FlightRecorder recorder(config);
+
+    MotionProcessor::ProcessingResult flood = makeResult(0);
+    flood.flood = MotionProcessor::FloodKind::SHAKE;
+    flood.detectedBounds.clear();
+    recorder.record(0, 0, cv::Size(640, 480), makeResult(0));
+    recorder.record(1, 0, cv::Size(640, 480), flood);
+    recorder.waitIdle();
+    EXPECT_EQ(recorder.getStats().dumps, 1u);
+    EXPECT_NE(recorder.lastDumpPath().find("_flood_shake"), std::string::npos);
+    EXPECT_EQ(readLines(fs::path(recorder.lastDumpPath()) / "frames.csv").back(), "1,0,shake,");
+
+    recorder.record(2, 0, cv::Size(640, 480), flood);
+    recorder.recordLatency(2, 250.0);
+    recorder.waitIdle();
+    EXPECT_EQ(recorder.getStats().dumps, 1u);
+
+    EXPECT_TRUE(recorder.requestDump("signal"));
+    recorder.waitIdle();
+    EXPECT_EQ(recorder.getStats().dumps, 2u);
+
+    // Disabled: records nothing and never dumps
+    config.enabled = false;
+    FlightRecorder disabled(config);
+    disabled.record(0, 0, cv::Size(640, 480), flood);
+    EXPECT_FALSE(disabled.requestDump("signal"));
+    EXPECT_EQ(disabled.getStats().recorded, 0u);
+    fs::remove_all(config.directory);
+}
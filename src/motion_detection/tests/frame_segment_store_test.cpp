@@ -0,0 +1,468 @@
+#include "frame_segment_store.hpp"
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame_file_storage.hpp"
+#include "logger.hpp"
+#include "persistence_backend.hpp"
+#include "thumbnail_atlas.hpp"
+#include "uplink_backend.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("debug", "frame_segment_store_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class FrameSegmentStoreTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const frameSegmentStoreEnv =
+    ::testing::AddGlobalTestEnvironment(new FrameSegmentStoreTestEnvironment());
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::vector<unsigned char> makeImage(size_t size, unsigned char seed) {
+    std::vector<unsigned char> bytes(size);
+    for (size_t i = 0; i < size; ++i) bytes[i] = static_cast<unsigned char>(seed + i * 7);
+    return bytes;
+}
+
+// Listening socket on 127.0.0.1:port (0 picks one); -1 if it cannot be bound
+int listenOn(int port) {
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    const int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, 1) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int boundPort(int fd) {
+    sockaddr_in address{};
+    socklen_t length = sizeof(address);
+    getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+    return ntohs(address.sin_port);
+}
+
+bool readExact(int fd, void* data, size_t size) {
+    auto* bytes = static_cast<unsigned char*>(data);
+    while (size > 0) {
+        pollfd readable{fd, POLLIN, 0};
+        if (::poll(&readable, 1, 10000) != 1) return false;
+        const ssize_t n = ::recv(fd, bytes, size, 0);
+        if (n <= 0) return false;
+        bytes += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// One uplink message as the aggregator sees it
+struct ReceivedMessage {
+    uint8_t kind = 0;
+    std::string document;
+    std::vector<std::vector<unsigned char>> images;
+};
+
+bool readMessage(int fd, ReceivedMessage& message) {
+    unsigned char header[uplink_wire::kMessageHeaderBytes];
+    if (!readExact(fd, header, sizeof(header))) return false;
+    uint32_t magic = 0;
+    uint16_t images = 0;
+    uint32_t documentLength = 0;
+    std::memcpy(&magic, header, 4);  // Little-endian host
+    std::memcpy(&images, header + 6, 2);
+    std::memcpy(&documentLength, header + 8, 4);
+    if (magic != uplink_wire::kMessageMagic) return false;
+    message.kind = header[4];
+    message.document.resize(documentLength);
+    if (!readExact(fd, &message.document[0], documentLength)) return false;
+    message.images.resize(images);
+    for (auto& image : message.images) {
+        uint32_t length = 0;
+        if (!readExact(fd, &length, sizeof(length))) return false;
+        image.resize(length);
+        if (!readExact(fd, image.data(), length)) return false;
+    }
+    return true;
+}
+
+template <typename Predicate>
+bool waitFor(Predicate done) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!done()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+class FrameSegmentStoreTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        directory = (fs::temp_directory_path() / "frame_segment_store_test").string();
+        fs::remove_all(directory);
+    }
+
+    void TearDown() override { fs::remove_all(directory); }
+
+    std::string directory;
+};
+
+}  // namespace
+
+// Appended images read back byte for byte, and a full segment rolls over to the next file
+TEST_F(FrameSegmentStoreTest, AppendsRollsAndReadsBack) {
+    SegmentStoreConfig config;
+    config.directory = directory;
+    config.segmentBytes = 1000;
+    FrameSegmentStore store(config);
+
+    std::vector<SegmentExtent> extents;
+    std::vector<std::vector<unsigned char>> images;
+    for (int i = 0; i < 5; ++i) {
+        images.push_back(makeImage(300, static_cast<unsigned char>(i)));
+        extents.push_back(store.append(images.back()));
+        ASSERT_FALSE(extents.back().empty());
+    }
+
+    // Three 300-byte images fit a 1000-byte segment; the fourth starts a new one
+    EXPECT_EQ(extents[0].file, extents[2].file);
+    EXPECT_EQ(extents[2].offset, 600u);
+    EXPECT_NE(extents[3].file, extents[2].file);
+    EXPECT_EQ(extents[3].offset, 0u);
+
+    for (size_t i = 0; i < extents.size(); ++i) {
+        std::vector<unsigned char> bytes;
+        ASSERT_TRUE(FrameSegmentStore::read(extents[i], bytes));
+        EXPECT_EQ(bytes, images[i]) << "image " << i;
+    }
+}
+
+// A new store on the same directory continues behind what is already there
+TEST_F(FrameSegmentStoreTest, ContinuesNewestSegmentAfterRestart) {
+    SegmentStoreConfig config;
+    config.directory = directory;
+    SegmentExtent first;
+    {
+        FrameSegmentStore store(config);
+        first = store.append(makeImage(128, 1));
+    }
+    FrameSegmentStore reopened(config);
+    const SegmentExtent second = reopened.append(makeImage(64, 2));
+    EXPECT_EQ(second.file, first.file);
+    EXPECT_EQ(second.offset, 128u);
+
+    std::vector<unsigned char> bytes;
+    ASSERT_TRUE(FrameSegmentStore::read(first, bytes));
+    EXPECT_EQ(bytes, makeImage(128, 1));
+}
+
+// Concurrent appends never overlap
+TEST_F(FrameSegmentStoreTest, ConcurrentAppendsDoNotOverlap) {
+    SegmentStoreConfig config;
+    config.directory = directory;
+    config.segmentBytes = 64 * 1024;
+    FrameSegmentStore store(config);
+
+    constexpr int kThreads = 4;
+    constexpr int kPerThread = 50;
+    std::vector<std::vector<SegmentExtent>> extents(kThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < kPerThread; ++i) {
+                const auto image = makeImage(500 + t, static_cast<unsigned char>(t));
+                extents[t].push_back(store.append(image));
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    for (int t = 0; t < kThreads; ++t) {
+        for (const auto& extent : extents[t]) {
+            std::vector<unsigned char> bytes;
+            ASSERT_TRUE(FrameSegmentStore::read(extent, bytes));
+            EXPECT_EQ(bytes, makeImage(500 + t, static_cast<unsigned char>(t)));
+        }
+    }
+}
+
+// O_DIRECT appends rewrite the partial last block; images of any size read back, the
+// padding is trimmed on close and a restart continues behind the last image
+TEST_F(FrameSegmentStoreTest, DirectAppendsReadBackAndTrimPadding) {
+    SegmentStoreConfig config;
+    config.directory = directory;
+    config.cachePolicy = SegmentCachePolicy::Direct;
+    config.directBufferBytes = 8192;  // The 20000-byte image goes in pieces
+    const std::vector<size_t> sizes = {100, 5000, 20000, 1, 3995, 4096, 777};
+
+    std::vector<SegmentExtent> extents;
+    uint64_t total = 0;
+    {
+        FrameSegmentStore store(config);
+        for (size_t i = 0; i < sizes.size(); ++i) {
+            extents.push_back(store.append(makeImage(sizes[i], static_cast<unsigned char>(i))));
+            ASSERT_FALSE(extents.back().empty());
+            EXPECT_EQ(extents.back().offset, total);
+            total += sizes[i];
+        }
+        // tmpfs before Linux 6.6 refuses O_DIRECT; the store then drops pages behind instead
+        EXPECT_NE(store.cachePolicy(), SegmentCachePolicy::PageCache);
+    }
+    EXPECT_EQ(fs::file_size(extents[0].file), total);
+
+    FrameSegmentStore reopened(config);
+    const SegmentExtent last = reopened.append(makeImage(300, 9));
+    EXPECT_EQ(last.offset, total);
+    extents.push_back(last);
+    for (size_t i = 0; i < extents.size(); ++i) {
+        std::vector<unsigned char> bytes;
+        ASSERT_TRUE(FrameSegmentStore::read(extents[i], bytes));
+        const size_t size = i < sizes.size() ? sizes[i] : 300;
+        EXPECT_EQ(bytes, makeImage(size, static_cast<unsigned char>(i < sizes.size() ? i : 9))) << "image " << i;
+    }
+}
+
+TEST_F(FrameSegmentStoreTest, DropBehindAppendsReadBack) {
+    SegmentStoreConfig config;
+    config.directory = directory;
+    config.cachePolicy = SegmentCachePolicy::DropBehind;
+    config.dropBehindBytes = 1000;
+    FrameSegmentStore store(config);
+    std::vector<SegmentExtent> extents;
+    for (int i = 0; i < 10; ++i) extents.push_back(store.append(makeImage(450, static_cast<unsigned char>(i))));
+    for (int i = 0; i < 10; ++i) {
+        std::vector<unsigned char> bytes;
+        ASSERT_TRUE(FrameSegmentStore::read(extents[i], bytes));
+        EXPECT_EQ(bytes, makeImage(450, static_cast<unsigned char>(i)));
+    }
+    EXPECT_EQ(parseSegmentCachePolicy("DIRECT"), SegmentCachePolicy::Direct);
+    EXPECT_THROW(parseSegmentCachePolicy("mmap"), std::invalid_argument);
+}
+
+// The "local" backend appends each batch as JSON lines to a segment of its own directory
+TEST_F(FrameSegmentStoreTest, LocalPersistenceBackendAppendsJsonLines) {
+    PersistenceBackendConfig config;
+    config.name = "local";
+    config.localPath = directory;
+    const std::unique_ptr<PersistenceBackend> backend = makePersistenceBackend(config);
+    ASSERT_TRUE(backend->connect());
+
+    std::vector<StoredFrameRecord> records(2);
+    records[0].uuid = "a";
+    records[0].originalPath = "data/frames/a.jpg";
+    records[0].metadata.source = "cam \"1\"";
+    records[1].uuid = "b";
+    records[1].originalSegment = {"segment_00000000.seg", 10, 20};
+    EXPECT_EQ(backend->insertRecords(records), (std::vector<std::string>{"a", "b"}));
+    MotionMinuteSummary summary;
+    summary.source = "cam";
+    summary.minuteStart = 60;
+    summary.frames = 3;
+    EXPECT_TRUE(backend->upsertMotionSummaries({summary}));
+
+    std::vector<fs::path> segments;
+    for (const auto& entry : fs::directory_iterator(fs::path(directory) / "frames")) segments.push_back(entry.path());
+    ASSERT_EQ(segments.size(), 1u);
+    std::ifstream in(segments[0]);
+    const std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(text.find("{\"_id\":\"a\",\"original_image_path\":\"data/frames/a.jpg\",\"processed_image_path\":null"),
+              0u);
+    EXPECT_NE(text.find("\"source\":\"cam \\\"1\\\"\""), std::string::npos);
+    EXPECT_NE(text.find("\n{\"_id\":\"b\""), std::string::npos);
+    EXPECT_NE(text.find("\"original_image_segment\":{\"file\":\"segment_00000000.seg\",\"offset\":10,\"length\":20}"),
+              std::string::npos);
+    EXPECT_EQ(text.back(), '\n');
+    EXPECT_NE(motionSummaryJson(summary, 0).find("\"minute\":{\"$date\":\"1970-01-01T00:01:00.000Z\"}"),
+              std::string::npos);
+    EXPECT_TRUE(fs::is_directory(fs::path(directory) / "motion_stats"));
+}
+
+// Retention deletes whole hour partitions before the cutoff, and the day, month and year
+// directories they leave empty, without touching newer partitions or loose files
+TEST_F(FrameSegmentStoreTest, ExpiresWholeHourPartitions) {
+    const fs::path root(directory);
+    for (const char* file : {"original/2019/12/31/23/a.jpg", "original/2020/01/01/00/b.jpg",
+                             "original/2020/01/01/05/c.jpg", "original_thumbnails/2020/01/01/04/d.jpg",
+                             "plates/2020/01/02/00/e.jpg", "processed/flat.jpg"}) {
+        fs::create_directories((root / file).parent_path());
+        std::ofstream(root / file) << "jpeg";
+    }
+    FrameFileStorage storage(directory);
+    std::tm cutoff{};
+    cutoff.tm_year = 120;  // 2020-01-01 05:30 UTC
+    cutoff.tm_mday = 1;
+    cutoff.tm_hour = 5;
+    cutoff.tm_min = 30;
+    EXPECT_EQ(storage.removePartitionsBefore(timegm(&cutoff)), 3u);
+    EXPECT_FALSE(fs::exists(root / "original/2019"));
+    EXPECT_FALSE(fs::exists(root / "original/2020/01/01/00"));
+    EXPECT_FALSE(fs::exists(root / "original_thumbnails/2020/01/01/04"));
+    EXPECT_TRUE(fs::exists(root / "original/2020/01/01/05/c.jpg"));
+    EXPECT_TRUE(fs::exists(root / "plates/2020/01/02/00/e.jpg"));
+    EXPECT_TRUE(fs::exists(root / "processed/flat.jpg"));
+    EXPECT_EQ(storage.removePartitionsBefore(timegm(&cutoff)), 0u);
+}
+
+// Thumbnails fill a sheet cell by cell; a full sheet, and one of an hour that has passed, is
+// written with its JSON index, and a record's cell says where its thumbnail went
+TEST_F(FrameSegmentStoreTest, ThumbnailAtlasSealsFullAndPastHourSheets) {
+    ThumbnailAtlasConfig config;
+    config.cellSize = cv::Size(40, 30);
+    config.columns = 2;
+    config.rows = 1;
+    ThumbnailAtlas atlas(directory, config, ImageEncodeSettings{ImageCodec::Jpeg, 75, 3});
+    const cv::Mat wide(60, 160, CV_8UC3, cv::Scalar(0, 128, 255));
+    const cv::Mat gray(120, 120, CV_8UC1, cv::Scalar(200));
+
+    AtlasCell cells[3];
+    ASSERT_TRUE(atlas.add("2020/01/01/05", "a", wide, cells[0]));
+    EXPECT_EQ(cells[0].sheet, "2020/01/01/05/sheet_0000.jpg");
+    EXPECT_EQ(cells[0].sheetSize, cv::Size(80, 30));
+    EXPECT_EQ(cells[0].rect, cv::Rect(0, 0, 40, 15));  // Fitted, aspect kept
+    EXPECT_FALSE(fs::exists(fs::path(directory) / cells[0].sheet));
+    ASSERT_TRUE(atlas.add("2020/01/01/05", "b", gray, cells[1]));
+    EXPECT_EQ(cells[1].rect, cv::Rect(40, 0, 30, 30));
+    EXPECT_EQ(atlas.sheetsWritten(), 1u);  // Full
+    const fs::path hour = fs::path(directory) / "2020/01/01/05";
+    EXPECT_FALSE(cv::imread((hour / "sheet_0000.jpg").string()).empty());
+    std::ifstream indexFile(hour / "sheet_0000.json");
+    const std::string index((std::istreambuf_iterator<char>(indexFile)), std::istreambuf_iterator<char>());
+    EXPECT_NE(index.find("\"size\":[80,30]"), std::string::npos);
+    EXPECT_NE(index.find("\"a\":[0,0,40,15]"), std::string::npos);
+    EXPECT_NE(index.find("\"b\":[40,0,30,30]"), std::string::npos);
+
+    ASSERT_TRUE(atlas.add("2020/01/01/05", "c", wide, cells[2]));
+    EXPECT_EQ(cells[2].sheet, "2020/01/01/05/sheet_0001.jpg");
+    AtlasCell next;
+    ASSERT_TRUE(atlas.add("2020/01/01/06", "d", wide, next));  // The hour's partial sheet goes out
+    EXPECT_EQ(atlas.sheetsWritten(), 2u);
+    EXPECT_TRUE(fs::exists(hour / "sheet_0001.json"));
+    EXPECT_FALSE(atlas.add("2020/01/01/06", "e", cv::Mat(), next));
+    EXPECT_TRUE(next.sheet.empty());
+    atlas.seal();
+    EXPECT_TRUE(fs::exists(fs::path(directory) / "2020/01/01/06/sheet_0000.jpg"));
+
+    // The storage places the processed frame of each record it writes
+    FrameFileStorage storage((fs::path(directory) / "frames").string());
+    auto frames = std::make_shared<ThumbnailAtlas>((fs::path(directory) / "frames" / "atlases").string(), config,
+                                                   storage.encoding().thumbnail);
+    storage.useAtlas(frames);
+    StoredFrameRecord record;
+    ASSERT_TRUE(storage.write(wide, wide, record));
+    EXPECT_FALSE(record.atlasCell.sheet.empty());
+    EXPECT_EQ(record.atlasCell.rect, cv::Rect(0, 0, 40, 15));
+    EXPECT_EQ(frames->thumbnailsPlaced(), 1u);
+}
+
+// While the aggregator is down records are spooled; once it is up they are sent first, the
+// spool is deleted after the ack and later records go straight through the window
+TEST_F(FrameSegmentStoreTest, UplinkBackendSpoolsDuringOutageAndReplays) {
+    int listener = listenOn(0);
+    ASSERT_GE(listener, 0);
+    const int port = boundPort(listener);
+    ::close(listener);  // Outage: the port refuses connections
+
+    const fs::path crop = fs::path(directory) / "crop.jpg";
+    fs::create_directories(directory);
+    const std::vector<unsigned char> cropBytes = makeImage(300, 5);
+    std::ofstream(crop, std::ios::binary).write(reinterpret_cast<const char*>(cropBytes.data()), cropBytes.size());
+
+    PersistenceBackendConfig config;
+    config.name = "uplink";
+    config.uplinkEndpoint = "127.0.0.1:" + std::to_string(port);
+    config.uplinkSite = "edge-1";
+    config.uplinkSpoolPath = (fs::path(directory) / "spool").string();
+    const std::unique_ptr<PersistenceBackend> backend = makePersistenceBackend(config);
+    auto* uplink = dynamic_cast<UplinkPersistenceBackend*>(backend.get());
+    ASSERT_NE(uplink, nullptr);
+    ASSERT_TRUE(backend->connect());
+
+    std::vector<StoredFrameRecord> records(1);
+    records[0].uuid = "spooled";
+    records[0].regionCrops.push_back({crop.string(), cv::Rect(1, 2, 3, 4), cv::Rect(1, 2, 3, 4)});
+    EXPECT_EQ(backend->insertRecords(records), (std::vector<std::string>{"spooled"}));
+    EXPECT_EQ(uplink->stats().spoolDepth, 1u);
+
+    listener = listenOn(port);
+    ASSERT_GE(listener, 0);
+    pollfd pending{listener, POLLIN, 0};
+    ASSERT_EQ(::poll(&pending, 1, 10000), 1);  // The backend retries within a few seconds
+    const int connection = ::accept(listener, nullptr, nullptr);
+    ASSERT_GE(connection, 0);
+
+    unsigned char hello[8];
+    ASSERT_TRUE(readExact(connection, hello, sizeof(hello)));
+    uint32_t magic = 0;
+    uint16_t siteLength = 0;
+    std::memcpy(&magic, hello, 4);
+    std::memcpy(&siteLength, hello + 6, 2);
+    EXPECT_EQ(magic, uplink_wire::kHelloMagic);
+    std::string site(siteLength, '\0');
+    ASSERT_TRUE(readExact(connection, &site[0], siteLength));
+    EXPECT_EQ(site, "edge-1");
+
+    ReceivedMessage message;
+    ASSERT_TRUE(readMessage(connection, message));
+    EXPECT_EQ(message.kind, uplink_wire::kFrameMessage);
+    EXPECT_EQ(message.document.find("{\"_id\":\"spooled\""), 0u);
+    ASSERT_EQ(message.images.size(), 1u);
+    EXPECT_EQ(message.images[0], cropBytes);
+
+    uint64_t acknowledged = 1;
+    ASSERT_EQ(::send(connection, &acknowledged, sizeof(acknowledged), 0), 8);
+    ASSERT_TRUE(waitFor([&] { return uplink->stats().acknowledged == 1; }));
+    EXPECT_EQ(uplink->stats().spoolDepth, 0u);
+    EXPECT_TRUE(fs::is_empty(config.uplinkSpoolPath));
+
+    // Link up, spool empty: through the outbox
+    MotionMinuteSummary summary;
+    summary.source = "cam";
+    EXPECT_TRUE(backend->upsertMotionSummaries({summary}));
+    ASSERT_TRUE(readMessage(connection, message));
+    EXPECT_EQ(message.kind, uplink_wire::kSummaryMessage);
+    EXPECT_TRUE(message.images.empty());
+    acknowledged = 2;
+    ASSERT_EQ(::send(connection, &acknowledged, sizeof(acknowledged), 0), 8);
+    ASSERT_TRUE(waitFor([&] { return uplink->stats().acknowledged == 2; }));
+    const UplinkStats stats = uplink->stats();
+    EXPECT_EQ(stats.spooled, 1u);
+    EXPECT_EQ(stats.connects, 1u);
+    EXPECT_EQ(stats.inFlightBytes, 0u);
+
+    ::close(connection);
+    ::close(listener);
+}
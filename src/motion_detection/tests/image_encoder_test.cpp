@@ -0,0 +1,118 @@
+#include "image_encoder.hpp"
+
+#include <gtest/gtest.h>
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "logger.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("debug", "image_encoder_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class ImageEncoderTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const imageEncoderEnv =
+    ::testing::AddGlobalTestEnvironment(new ImageEncoderTestEnvironment());
+
+namespace {
+
+cv::Mat makeImage() {
+    cv::Mat image(120, 160, CV_8UC3, cv::Scalar(40, 90, 40));
+    cv::circle(image, cv::Point(80, 60), 30, cv::Scalar(200, 180, 20), -1);
+    cv::rectangle(image, cv::Rect(10, 10, 30, 20), cv::Scalar(20, 20, 220), -1);
+    return image;
+}
+
+class ImageCodecTest : public ::testing::TestWithParam<ImageCodec> {};
+
+}  // namespace
+
+TEST(ImageCodecNamesTest, ParsesNamesAndExtensions) {
+    EXPECT_EQ(parseImageCodec("JPG"), ImageCodec::Jpeg);
+    EXPECT_EQ(parseImageCodec("webp"), ImageCodec::WebP);
+    EXPECT_EQ(parseImageCodec("avif"), ImageCodec::Avif);
+    EXPECT_EQ(parseImageCodec("jpegxl"), ImageCodec::JpegXl);
+    EXPECT_THROW(parseImageCodec("png"), std::invalid_argument);
+    EXPECT_STREQ(imageCodecName(ImageCodec::JpegXl), "jxl");
+    EXPECT_STREQ(imageCodecExtension(ImageCodec::Avif), ".avif");
+    EXPECT_STREQ(imageCodecMimeType(ImageCodec::WebP), "image/webp");
+    EXPECT_TRUE(ImageEncoder::available(ImageCodec::Jpeg));
+}
+
+TEST(ImageCodecNamesTest, DetectsSignatures) {
+    ImageCodec codec = ImageCodec::Jpeg;
+    const std::vector<unsigned char> webp = {'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'E', 'B', 'P'};
+    EXPECT_TRUE(ImageEncoder::detect(webp, codec));
+    EXPECT_EQ(codec, ImageCodec::WebP);
+    const std::vector<unsigned char> avif = {0, 0, 0, 0x1C, 'f', 't', 'y', 'p', 'a', 'v', 'i', 'f'};
+    EXPECT_TRUE(ImageEncoder::detect(avif, codec));
+    EXPECT_EQ(codec, ImageCodec::Avif);
+    EXPECT_TRUE(ImageEncoder::detect({0xFF, 0x0A, 0x00}, codec));
+    EXPECT_EQ(codec, ImageCodec::JpegXl);
+    EXPECT_FALSE(ImageEncoder::detect({0x89, 'P', 'N', 'G'}, codec));
+    EXPECT_FALSE(ImageEncoder::detect({}, codec));
+}
+
+TEST_P(ImageCodecTest, EncodesColorAndGrayInItsFormat) {
+    ImageEncodeSettings settings;
+    settings.codec = GetParam();
+    settings.effort = 1;
+    std::vector<unsigned char> bytes;
+    if (!ImageEncoder::available(GetParam())) {
+        EXPECT_FALSE(ImageEncoder::encode(makeImage(), settings, bytes));
+        GTEST_SKIP() << imageCodecName(GetParam()) << " is not built in";
+    }
+
+    cv::Mat gray;
+    cv::cvtColor(makeImage(), gray, cv::COLOR_BGR2GRAY);
+    for (const cv::Mat& image : {makeImage(), gray}) {
+        ASSERT_TRUE(ImageEncoder::encode(image, settings, bytes));
+        ImageCodec detected = ImageCodec::Jpeg;
+        ASSERT_TRUE(ImageEncoder::detect(bytes, detected));
+        EXPECT_EQ(detected, GetParam());
+    }
+
+    // Higher effort must not give a larger file than the lowest
+    const size_t fastBytes = bytes.size();
+    settings.effort = 7;
+    ASSERT_TRUE(ImageEncoder::encode(gray, settings, bytes));
+    if (GetParam() != ImageCodec::Jpeg) EXPECT_LE(bytes.size(), fastBytes * 11 / 10);
+
+    EXPECT_FALSE(ImageEncoder::encode(cv::Mat(), settings, bytes));
+}
+
+INSTANTIATE_TEST_SUITE_P(Codecs, ImageCodecTest,
+                         ::testing::Values(ImageCodec::Jpeg, ImageCodec::WebP, ImageCodec::Avif, ImageCodec::JpegXl),
+                         [](const ::testing::TestParamInfo<ImageCodec>& info) {
+                             return std::string(imageCodecName(info.param));
+                         });
+
+TEST(ImageEncoderTest, RecompressesJpegLosslesslySmaller) {
+    std::vector<unsigned char> jpeg;
+    ASSERT_TRUE(ImageEncoder::encode(makeImage(), ImageEncodeSettings{ImageCodec::Jpeg, 90, 1}, jpeg));
+    std::vector<unsigned char> jxl;
+    if (!ImageEncoder::available(ImageCodec::JpegXl)) {
+        EXPECT_FALSE(ImageEncoder::recompressJpeg(jpeg, jxl));
+        GTEST_SKIP() << "jxl is not built in";
+    }
+    ASSERT_TRUE(ImageEncoder::recompressJpeg(jpeg, jxl));
+    ImageCodec codec = ImageCodec::Jpeg;
+    ASSERT_TRUE(ImageEncoder::detect(jxl, codec));
+    EXPECT_EQ(codec, ImageCodec::JpegXl);
+    EXPECT_LT(jxl.size(), jpeg.size());
+
+    const std::vector<unsigned char> broken(jpeg.begin(), jpeg.begin() + 40);
+    EXPECT_FALSE(ImageEncoder::recompressJpeg(broken, jxl));
+}
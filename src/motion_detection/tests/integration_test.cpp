@@ -3,15 +3,20 @@
 #include <algorithm>
 #include <filesystem>
 #include <map>
+#include <stdexcept>
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/opencv.hpp>
 #include <string>
 #include <vector>
 
+#include "debug_artifact_writer.hpp"
+#include "frame_event_stream.hpp"
 #include "logger.hpp"
 #include "motion_pipeline.hpp"
 #include "motion_processor.hpp"
 #include "motion_region_consolidator.hpp"
+#include "object_tracker.hpp"
+#include "pipelined_frame_executor.hpp"
 #include "tracked_object.hpp"
 
 namespace fs = std::filesystem;
@@ -219,6 +224,7 @@ TEST_F(IntegrationTest, QuickFileCreationValidation) {
                 "test_results/integration_test/2_consolidation_visualizations/" +
                 pairName + "_consolidation.jpg";
 
+            DebugArtifactWriter::shared().flush();  // Visualizations are written in the background
             EXPECT_TRUE(fs::exists(motionOutput))
                 << "Motion processor visualization missing: " << motionOutput;
             EXPECT_TRUE(fs::exists(consolidationOutput))
@@ -231,6 +237,151 @@ TEST_F(IntegrationTest, QuickFileCreationValidation) {
     EXPECT_GT(processedCount, 0) << "No image pairs were processed for verification";
 }
 
+// The default stage graph runs the same pipeline as processFrameAndConsolidate(); extra
+// outputs add their stages and unread slots skip theirs
+TEST(MotionStageGraphTest, DefaultGraphMatchesProcessFrameAndConsolidate) {
+    ConsolidationConfig config;
+    config.frameSize = cv::Size(640, 480);
+    MotionProcessor directProcessor("config.yaml");
+    MotionProcessor graphProcessor("config.yaml");
+    MotionRegionConsolidator directConsolidator(config);
+    MotionRegionConsolidator graphConsolidator(config);
+
+    StageGraphSettings settings;
+    settings.stages = {"detect", "number", "consolidate", "crops", "visualize"};
+    settings.outputs = {"regions", "crops"};
+    MotionStageGraph graph(graphProcessor, graphConsolidator, nullptr, settings);
+    EXPECT_EQ(graph.graph().levels().size(), 4u);  // detect, number, consolidate, crops + visualize
+
+    MotionPipelineContext direct;
+    MotionPipelineContext staged;
+    for (int i = 0; i < 4; ++i) {
+        cv::Mat frame(480, 640, CV_8UC3, cv::Scalar(40, 40, 40));
+        if (i > 0) {
+            // Two nearby movers, so DBSCAN has something to merge
+            cv::rectangle(frame, cv::Rect(100 + 10 * i, 120, 60, 50), cv::Scalar(230, 230, 230), cv::FILLED);
+            cv::rectangle(frame, cv::Rect(175 + 10 * i, 130, 50, 60), cv::Scalar(220, 220, 220), cv::FILLED);
+        }
+        processFrameAndConsolidate(directProcessor, directConsolidator, frame, direct);
+        graph.run(frame, staged);
+
+        EXPECT_EQ(staged.result.detectedBounds, direct.result.detectedBounds) << "frame " << i;
+        ASSERT_EQ(staged.regions.size(), direct.regions.size()) << "frame " << i;
+        ASSERT_EQ(staged.crops.size(), staged.regions.size());
+        for (size_t r = 0; r < staged.regions.size(); ++r) {
+            EXPECT_EQ(staged.regions[r].boundingBox, direct.regions[r].boundingBox);
+            EXPECT_EQ(staged.crops[r].size(), (staged.regions[r].boundingBox & cv::Rect(0, 0, 640, 480)).size());
+        }
+    }
+
+    // Only the boxes requested: numbering and consolidation are skipped
+    StageGraphSettings boxesOnly;
+    boxesOnly.outputs = {"boxes"};
+    MotionStageGraph detectOnly(graphProcessor, graphConsolidator, nullptr, boxesOnly);
+    EXPECT_TRUE(detectOnly.graph().isActive("detect"));
+    EXPECT_FALSE(detectOnly.graph().isActive("number"));
+    EXPECT_FALSE(detectOnly.graph().isActive("consolidate"));
+
+    settings.stages = {"detect", "track", "consolidate"};
+    EXPECT_THROW(MotionStageGraph(graphProcessor, graphConsolidator, nullptr, settings), std::invalid_argument);
+    settings.stages = {"detect", "consolidate"};  // Nothing produces the objects
+    EXPECT_THROW(MotionStageGraph(graphProcessor, graphConsolidator, nullptr, settings), std::invalid_argument);
+}
+
+// Overlapping frames must not change any result: same boxes, regions and track IDs, in order
+TEST(PipelinedFrameExecutorTest, MatchesTheSynchronousLoop) {
+    ConsolidationConfig config;
+    config.frameSize = cv::Size(640, 480);
+    MotionProcessor directProcessor("config.yaml");
+    MotionProcessor pipelinedProcessor("config.yaml");
+    MotionRegionConsolidator directConsolidator(config);
+    MotionRegionConsolidator pipelinedConsolidator(config);
+    ObjectTracker directTracker;
+    ObjectTracker pipelinedTracker;
+
+    std::vector<cv::Mat> frames;
+    for (int i = 0; i < 12; ++i) {
+        cv::Mat frame(480, 640, CV_8UC3, cv::Scalar(40, 40, 40));
+        if (i > 0 && i != 6) {  // A still frame in the middle lets regions age
+            cv::rectangle(frame, cv::Rect(80 + 15 * i, 120, 60, 50), cv::Scalar(230, 230, 230), cv::FILLED);
+            cv::rectangle(frame, cv::Rect(160 + 15 * i, 140, 50, 60), cv::Scalar(220, 220, 220), cv::FILLED);
+        }
+        frames.push_back(frame);
+    }
+
+    std::vector<PipelinedFrameExecutor::Result> delivered;
+    {
+        PipelinedFrameExecutor executor(pipelinedProcessor, pipelinedConsolidator, &pipelinedTracker, 3);
+        for (const cv::Mat& frame : frames) {
+            if (auto done = executor.push(frame)) delivered.push_back(std::move(*done));
+            EXPECT_LE(executor.inFlight(), 3u);
+        }
+        while (auto done = executor.finish()) delivered.push_back(std::move(*done));
+    }
+
+    ASSERT_EQ(delivered.size(), frames.size());
+    MotionPipelineContext direct;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        processFrameAndConsolidate(directProcessor, directTracker, directConsolidator, frames[i], direct);
+        const PipelinedFrameExecutor::Result& pipelined = delivered[i];
+        EXPECT_EQ(pipelined.sequence, i);
+        EXPECT_TRUE(pipelined.error.empty()) << pipelined.error;
+        EXPECT_EQ(pipelined.result.detectedBounds, direct.result.detectedBounds) << "frame " << i;
+        ASSERT_EQ(pipelined.regions.size(), direct.regions.size()) << "frame " << i;
+        for (size_t r = 0; r < direct.regions.size(); ++r) {
+            EXPECT_EQ(pipelined.regions[r].boundingBox, direct.regions[r].boundingBox);
+            EXPECT_EQ(pipelined.regions[r].framesSinceLastUpdate, direct.regions[r].framesSinceLastUpdate);
+            EXPECT_TRUE(std::equal(pipelined.regions[r].trackedObjectIds.begin(),
+                                   pipelined.regions[r].trackedObjectIds.end(),
+                                   direct.regions[r].trackedObjectIds.begin(),
+                                   direct.regions[r].trackedObjectIds.end()));
+        }
+    }
+}
+
+// Skipped frames are never processed; kept ones arrive in order with crops viewing the frame
+TEST(FrameEventStreamTest, SkipsFramesAndCropsRegionsWithoutCopies) {
+    int next = 0;
+    auto reader = [&next](cv::Mat& frame, double& timestampMs) {
+        if (next == 12) return false;
+        frame = cv::Mat(480, 640, CV_8UC3, cv::Scalar(40, 40, 40));
+        if (next % 4 == 2) {  // Motion on every other kept frame
+            cv::rectangle(frame, cv::Rect(80 + 10 * next, 120, 60, 50), cv::Scalar(230, 230, 230), cv::FILLED);
+        }
+        timestampMs = 40.0 * next++;
+        return true;
+    };
+    FrameEventStreamOptions options;
+    options.frameSkip = 1;
+    FrameEventStream stream(PipelineConfig::loadOrDefaults("config.yaml"), reader, options);
+    stream.start();
+
+    std::vector<FrameEvent> events;
+    while (auto event = stream.next()) events.push_back(std::move(*event));
+    EXPECT_TRUE(stream.finished());
+
+    const FrameEventStats stats = stream.stats();
+    EXPECT_EQ(stats.framesRead, 12u);
+    EXPECT_EQ(stats.framesSkipped, 6u);
+    EXPECT_EQ(stats.framesProcessed, 6u);
+    EXPECT_EQ(stats.eventsEmitted, events.size());
+    ASSERT_FALSE(events.empty());
+    uint64_t previous = 0;
+    for (const FrameEvent& event : events) {
+        EXPECT_EQ(event.frameIndex % 2, 0u);
+        EXPECT_GE(event.frameIndex, previous);
+        previous = event.frameIndex;
+        EXPECT_DOUBLE_EQ(event.timestampMs, 40.0 * event.frameIndex);
+        ASSERT_FALSE(event.regions.empty());  // motionOnly
+        ASSERT_EQ(event.crops.size(), event.regions.size());
+        for (size_t r = 0; r < event.regions.size(); ++r) {
+            const cv::Rect roi = event.regions[r].boundingBox & cv::Rect(0, 0, event.frame.cols, event.frame.rows);
+            EXPECT_EQ(event.crops[r].size(), roi.size());
+            EXPECT_EQ(event.crops[r].datastart, event.frame.datastart);
+        }
+    }
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
 
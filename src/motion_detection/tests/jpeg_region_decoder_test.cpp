@@ -0,0 +1,107 @@
+#include "jpeg_region_decoder.hpp"
+
+#include <gtest/gtest.h>
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "jpeg_encoder.hpp"
+#include "logger.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("debug", "jpeg_region_decoder_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class JpegRegionDecoderTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const jpegRegionDecoderEnv =
+    ::testing::AddGlobalTestEnvironment(new JpegRegionDecoderTestEnvironment());
+
+namespace {
+
+// Smooth gradients, so full and partial decodes differ only by rounding
+cv::Mat makeFrame() {
+    cv::Mat frame(480, 640, CV_8UC3);
+    for (int y = 0; y < frame.rows; ++y) {
+        for (int x = 0; x < frame.cols; ++x) {
+            frame.at<cv::Vec3b>(y, x) = cv::Vec3b(static_cast<uchar>(x * 255 / frame.cols),
+                                                  static_cast<uchar>(y * 255 / frame.rows),
+                                                  static_cast<uchar>((x + y) * 255 / (frame.cols + frame.rows)));
+        }
+    }
+    return frame;
+}
+
+std::vector<unsigned char> encodeFrame() {
+    std::vector<unsigned char> jpeg;
+    EXPECT_TRUE(JpegEncoder::encode(makeFrame(), 95, jpeg));
+    return jpeg;
+}
+
+}  // namespace
+
+TEST(JpegRegionDecoderTest, DecodesRegionsLikeAFullDecode) {
+    const std::vector<unsigned char> jpeg = encodeFrame();
+    const cv::Mat full = cv::imdecode(jpeg, cv::IMREAD_COLOR);
+    ASSERT_FALSE(full.empty());
+
+    // Off the MCU grid, on it, and touching the right and bottom edges
+    const std::vector<cv::Rect> regions = {cv::Rect(37, 21, 101, 77), cv::Rect(64, 32, 128, 96),
+                                           cv::Rect(600, 450, 40, 30)};
+    std::vector<cv::Mat> images;
+    ASSERT_TRUE(JpegRegionDecoder::decode(jpeg, regions, 0, images));
+    ASSERT_EQ(images.size(), regions.size());
+    for (size_t i = 0; i < regions.size(); ++i) {
+        ASSERT_EQ(images[i].size(), regions[i].size()) << "region " << i;
+        ASSERT_EQ(images[i].type(), CV_8UC3);
+        EXPECT_LT(cv::norm(images[i], full(regions[i]), cv::NORM_L1) / images[i].total(), 6.0) << "region " << i;
+    }
+}
+
+TEST(JpegRegionDecoderTest, ScalesRegionsDownToTheTargetSide) {
+    const std::vector<unsigned char> jpeg = encodeFrame();
+    const std::vector<cv::Rect> regions = {cv::Rect(0, 0, 640, 480), cv::Rect(100, 100, 200, 90),
+                                           cv::Rect(10, 10, 50, 50)};
+    std::vector<cv::Mat> images;
+    ASSERT_TRUE(JpegRegionDecoder::decode(jpeg, regions, 100, images));
+    EXPECT_EQ(images[0].size(), cv::Size(160, 120));  // 1/4: 1/8 would leave 80 < 100
+    EXPECT_EQ(images[1].size(), cv::Size(100, 45));   // 1/2
+    EXPECT_EQ(images[2].size(), cv::Size(50, 50));    // Already smaller than the target
+
+    // The scaled region still shows the same part of the frame
+    cv::Mat expected;
+    cv::resize(makeFrame()(regions[1]), expected, images[1].size(), 0, 0, cv::INTER_AREA);
+    EXPECT_LT(cv::norm(images[1], expected, cv::NORM_L1) / expected.total(), 12.0);
+}
+
+TEST(JpegRegionDecoderTest, ClipsRegionsAndRejectsBrokenInput) {
+    const std::vector<unsigned char> jpeg = encodeFrame();
+    std::vector<cv::Mat> images;
+    ASSERT_TRUE(JpegRegionDecoder::decode(jpeg, {cv::Rect(620, 470, 50, 50), cv::Rect(700, 0, 10, 10)}, 0, images));
+    EXPECT_EQ(images[0].size(), cv::Size(20, 10));
+    EXPECT_TRUE(images[1].empty());
+
+    const std::vector<unsigned char> broken = {'n', 'o', 't', ' ', 'j', 'p', 'e', 'g'};
+    EXPECT_FALSE(JpegRegionDecoder::decode(broken, {cv::Rect(0, 0, 8, 8)}, 0, images));
+    EXPECT_FALSE(JpegRegionDecoder::decode({}, {cv::Rect(0, 0, 8, 8)}, 0, images));
+    ASSERT_EQ(images.size(), 1u);
+    EXPECT_TRUE(images[0].empty());
+}
+
+TEST(JpegRegionDecoderTest, PicksTheCoarsestSufficientScale) {
+    EXPECT_EQ(JpegRegionDecoder::scaleDenominator(cv::Size(1920, 1080), 0), 1);
+    EXPECT_EQ(JpegRegionDecoder::scaleDenominator(cv::Size(1920, 1080), 224), 8);
+    EXPECT_EQ(JpegRegionDecoder::scaleDenominator(cv::Size(300, 900), 224), 4);
+    EXPECT_EQ(JpegRegionDecoder::scaleDenominator(cv::Size(640, 480), 320), 2);
+    EXPECT_EQ(JpegRegionDecoder::scaleDenominator(cv::Size(200, 100), 224), 1);
+}
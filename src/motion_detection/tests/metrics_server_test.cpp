@@ -0,0 +1,305 @@
+#include "metrics_server.hpp"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "io_reactor.hpp"
+#include "logger.hpp"
+#include "motion_stats_aggregator.hpp"
+#include "pipeline_metrics.hpp"
+#include "prometheus_text_writer.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("debug", "metrics_server_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class MetricsServerTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const metricsServerEnv =
+    ::testing::AddGlobalTestEnvironment(new MetricsServerTestEnvironment());
+
+namespace {
+
+// Sends one raw HTTP request to 127.0.0.1:port and returns the whole response
+std::string httpRequest(int port, const std::string& request) {
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    ::inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    std::string response;
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+        ::send(fd, request.data(), request.size(), 0);
+        char buffer[4096];
+        ssize_t n = 0;
+        while ((n = ::recv(fd, buffer, sizeof(buffer), 0)) > 0) response.append(buffer, n);
+    }
+    ::close(fd);
+    return response;
+}
+
+bool contains(const std::string& text, const std::string& needle) {
+    return text.find(needle) != std::string::npos;
+}
+
+}  // namespace
+
+TEST(PrometheusTextWriterTest, WritesCountersHistogramsAndEscapedLabels) {
+    PrometheusTextWriter writer;
+    writer.counter("birds_test_total", "A counter", 12345678901ull);
+    writer.header("birds_test_seconds", "histogram", "A histogram");
+    StageLatencyHistogram histogram;
+    histogram.record(std::chrono::microseconds(20));
+    histogram.record(std::chrono::microseconds(800));
+    histogram.record(std::chrono::milliseconds(30));
+    writer.histogramSamples("birds_test_seconds", histogram, {{"stage", "a\"b"}});
+    const std::string& text = writer.text();
+
+    EXPECT_TRUE(contains(text, "# TYPE birds_test_total counter\nbirds_test_total 12345678901\n"));
+    // Cumulative and monotone: 20 us is below 50 us, 800 us below 1 ms, all three in +Inf
+    EXPECT_TRUE(contains(text, "birds_test_seconds_bucket{stage=\"a\\\"b\",le=\"1e-05\"} 0\n"));
+    EXPECT_TRUE(contains(text, "birds_test_seconds_bucket{stage=\"a\\\"b\",le=\"5e-05\"} 1\n"));
+    EXPECT_TRUE(contains(text, "birds_test_seconds_bucket{stage=\"a\\\"b\",le=\"0.001\"} 2\n"));
+    EXPECT_TRUE(contains(text, "birds_test_seconds_bucket{stage=\"a\\\"b\",le=\"+Inf\"} 3\n"));
+    EXPECT_TRUE(contains(text, "birds_test_seconds_count{stage=\"a\\\"b\"} 3\n"));
+    EXPECT_TRUE(contains(text, "birds_test_seconds_sum{stage=\"a\\\"b\"} 0.03082\n"));
+}
+
+TEST(PipelineMetricsTest, CountsFramesRegionsAndRejections) {
+    PipelineMetrics metrics;
+    MotionProcessor::ProcessingResult still;
+    MotionProcessor::ProcessingResult moving;
+    moving.hasMotion = true;
+    moving.extraction.candidates = 5;
+    moving.extraction.rejectedArea = 2;
+    moving.extraction.rejectedAspectRatio = 1;
+    moving.extraction.accepted = 2;
+    moving.extraction.solidityChecks = 2;
+    moving.extraction.droppedOverCap = 3;
+    metrics.recordFrame(still, 0);
+    metrics.recordFrame(moving, 3);
+
+    EXPECT_EQ(metrics.framesProcessed(), 2u);
+    EXPECT_EQ(metrics.motionFrames(), 1u);
+
+    PrometheusTextWriter writer;
+    metrics.write(writer);
+    const std::string& text = writer.text();
+    EXPECT_TRUE(contains(text, "birds_regions_per_frame_bucket{le=\"0\"} 1\n"));
+    EXPECT_TRUE(contains(text, "birds_regions_per_frame_bucket{le=\"2\"} 1\n"));
+    EXPECT_TRUE(contains(text, "birds_regions_per_frame_bucket{le=\"4\"} 2\n"));
+    EXPECT_TRUE(contains(text, "birds_regions_per_frame_sum 3\n"));
+    EXPECT_TRUE(contains(text, "birds_contours_rejected_total{filter=\"area\"} 2\n"));
+    EXPECT_TRUE(contains(text, "birds_contours_rejected_total{filter=\"solidity\"} 0\n"));
+    EXPECT_TRUE(contains(text, "birds_contours_accepted_total 2\n"));
+    EXPECT_TRUE(contains(text, "birds_contour_solidity_checks_total 2\n"));
+    EXPECT_TRUE(contains(text, "birds_contours_rejected_total{filter=\"cap\"} 3\n"));
+    EXPECT_TRUE(contains(text, "birds_contour_cap_frames_total 1\n"));
+#if defined(__linux__) || defined(__APPLE__)
+    EXPECT_GT(PipelineMetrics::residentMemoryBytes(), 0u);
+#endif
+}
+
+TEST(PipelineMetricsTest, RecordsFrameLatencyByStage) {
+    using namespace std::chrono_literals;
+    PipelineMetrics metrics;
+    FrameTrace trace;
+    trace.captured = FrameTrace::Clock::now();
+    FrameTrace::Clock::time_point at = trace.captured;
+    for (size_t stage = 0; stage < FrameTrace::kStageCount; ++stage) {
+        trace.entered[stage] = at += 3ms;  // Queued 3 ms, ran 4 ms
+        trace.exited[stage] = at += 4ms;
+    }
+    trace.delivered = at;
+    metrics.recordLatency(trace);
+
+    // A frame the consolidate stage filtered out counts for detect only
+    FrameTrace filtered = trace;
+    filtered.exited[static_cast<size_t>(TraceStage::CONSOLIDATE)] = {};
+    metrics.recordLatency(filtered);
+
+    EXPECT_EQ(metrics.endToEndLatency().count(), 1u);
+    EXPECT_NEAR(metrics.endToEndLatency().meanMs(), 21.0, 0.01);
+    PrometheusTextWriter writer;
+    metrics.write(writer);
+    const std::string& text = writer.text();
+    EXPECT_TRUE(contains(text, "birds_frame_latency_seconds_bucket{le=\"0.05\"} 1\n"));
+    EXPECT_TRUE(contains(text, "birds_frame_stage_seconds_count{stage=\"detect\",phase=\"queued\"} 2\n"));
+    EXPECT_TRUE(contains(text, "birds_frame_stage_seconds_count{stage=\"render\",phase=\"running\"} 1\n"));
+    EXPECT_TRUE(contains(text,
+                         "birds_frame_stage_seconds_bucket{stage=\"consolidate\",phase=\"running\",le=\"0.005\"} 1\n"));
+}
+
+// A frame in a later minute closes the previous one; flush() returns the partial minute
+TEST(MotionStatsAggregatorTest, SummarizesEachMinute) {
+    MotionStatsAggregator aggregator("camera");
+    const int64_t minute = 1700000040;  // A multiple of 60
+    for (int i = 0; i < 100; ++i) {
+        const size_t boxes = i % 2 == 0 ? 3 : 0;
+        EXPECT_FALSE(aggregator.record(minute + i % 60, boxes, boxes ? 1 : 0, i + 1.0));
+    }
+
+    const auto summary = aggregator.record(minute + 61, 0, 0, 5.0);
+    ASSERT_TRUE(summary);
+    EXPECT_EQ(summary->source, "camera");
+    EXPECT_EQ(summary->minuteStart, minute);
+    EXPECT_EQ(summary->id(), "camera:1700000040");
+    EXPECT_EQ(summary->frames, 100u);
+    EXPECT_EQ(summary->motionFrames, 50u);
+    EXPECT_EQ(summary->motionBoxes, 150u);
+    EXPECT_EQ(summary->regions, 50u);
+    EXPECT_EQ(summary->maxRegions, 1u);
+    EXPECT_DOUBLE_EQ(summary->meanBoxesPerFrame(), 1.5);
+    EXPECT_DOUBLE_EQ(summary->latencyP50Ms, 51.0);
+    EXPECT_DOUBLE_EQ(summary->latencyP95Ms, 96.0);
+    EXPECT_DOUBLE_EQ(summary->latencyP99Ms, 100.0);
+    EXPECT_DOUBLE_EQ(summary->latencyMaxMs, 100.0);
+
+    const auto partial = aggregator.flush();
+    ASSERT_TRUE(partial);
+    EXPECT_EQ(partial->minuteStart, minute + 60);
+    EXPECT_EQ(partial->frames, 1u);
+    EXPECT_DOUBLE_EQ(partial->latencyP99Ms, 5.0);
+    EXPECT_FALSE(aggregator.flush());
+}
+
+TEST(MetricsServerTest, ServesMetricsAndRejectsOtherPaths) {
+    MetricsServer server([] { return std::string("birds_up 1\n"); }, 0);
+    ASSERT_TRUE(server.start());
+    ASSERT_GT(server.port(), 0);
+
+    const std::string ok = httpRequest(server.port(), "GET /metrics HTTP/1.1\r\nHost: x\r\n\r\n");
+    EXPECT_EQ(ok.rfind("HTTP/1.1 200 OK\r\n", 0), 0u) << ok;
+    EXPECT_TRUE(contains(ok, "Content-Type: text/plain; version=0.0.4"));
+    EXPECT_TRUE(contains(ok, "\r\n\r\nbirds_up 1\n"));
+
+    const std::string missing = httpRequest(server.port(), "GET / HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(missing.rfind("HTTP/1.1 404", 0), 0u) << missing;
+    const std::string post = httpRequest(server.port(), "POST /metrics HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(post.rfind("HTTP/1.1 405", 0), 0u) << post;
+    EXPECT_EQ(server.requestsServed(), 1u);
+
+    // stop() returns promptly and the port is released
+    const auto start = std::chrono::steady_clock::now();
+    server.stop();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+    EXPECT_FALSE(server.isRunning());
+}
+
+#ifdef __linux__
+namespace {
+
+// Reads one message from @p fd once readable, or reports a timeout
+IoTask readOnce(IoReactor& reactor, int fd, std::promise<std::string>& result) {
+    if (!co_await reactor.readable(fd, std::chrono::milliseconds(500))) {
+        result.set_value("timeout");
+        co_return;
+    }
+    char buffer[64];
+    const ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+    result.set_value(std::string(buffer, n > 0 ? static_cast<size_t>(n) : 0));
+}
+
+IoTask sleepThenSet(IoReactor& reactor, std::chrono::milliseconds duration, std::promise<bool>& result) {
+    const bool slept = co_await reactor.sleepFor(duration);
+    co_await reactor.schedule();
+    result.set_value(slept);
+}
+
+}  // namespace
+
+// Tasks resume when their descriptor is ready, time out, or end when cancelled or stopped
+TEST(IoReactorTest, ResumesTasksOnReadinessTimeoutsAndStop) {
+    IoReactor reactor(2);
+    ASSERT_TRUE(reactor.start());
+    int pair[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, pair), 0);
+    ::fcntl(pair[0], F_SETFL, O_NONBLOCK);
+
+    std::promise<std::string> received;
+    ASSERT_TRUE(reactor.spawn(readOnce(reactor, pair[0], received)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_EQ(::send(pair[1], "chirp", 5, 0), 5);
+    EXPECT_EQ(received.get_future().get(), "chirp");
+
+    std::promise<std::string> timedOut;
+    reactor.spawn(readOnce(reactor, pair[0], timedOut));
+    EXPECT_EQ(timedOut.get_future().get(), "timeout");
+
+    std::promise<bool> slept;
+    reactor.spawn(sleepThenSet(reactor, std::chrono::milliseconds(20), slept));
+    EXPECT_TRUE(slept.get_future().get());
+
+    // Cancelled before the owner closes the descriptor
+    std::promise<std::string> cancelled;
+    auto cancelledValue = cancelled.get_future();
+    reactor.spawn(readOnce(reactor, pair[0], cancelled));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    reactor.cancel(pair[0]);
+    EXPECT_EQ(cancelledValue.get(), "timeout");
+
+    // stop() ends the tasks still waiting
+    std::vector<std::promise<bool>> sleepers(8);
+    for (auto& sleeper : sleepers) reactor.spawn(sleepThenSet(reactor, std::chrono::hours(1), sleeper));
+    reactor.stop();
+    for (auto& sleeper : sleepers) EXPECT_FALSE(sleeper.get_future().get());
+    EXPECT_EQ(reactor.stats().live, 0u);
+    EXPECT_EQ(reactor.stats().timeouts, 1u);
+    std::promise<std::string> late;
+    EXPECT_FALSE(reactor.spawn(readOnce(reactor, pair[0], late)));
+    ::close(pair[0]);
+    ::close(pair[1]);
+}
+
+// On a reactor the server keeps no thread and answers several clients at once
+TEST(MetricsServerTest, ServesFromTheIoReactor) {
+    IoReactor reactor(2);
+    ASSERT_TRUE(reactor.start());
+    MetricsServer server([] { return std::string("birds_up 1\n"); }, 0, "127.0.0.1", &reactor);
+    ASSERT_TRUE(server.start());
+
+    // An idle client that never sends its request does not hold up the others
+    const int idle = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(server.port()));
+    ::inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    ASSERT_EQ(::connect(idle, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 3; ++i) {
+        const std::string ok = httpRequest(server.port(), "GET /metrics HTTP/1.1\r\n\r\n");
+        EXPECT_TRUE(contains(ok, "\r\n\r\nbirds_up 1\n")) << ok;
+    }
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+    const std::string missing = httpRequest(server.port(), "GET / HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(missing.rfind("HTTP/1.1 404", 0), 0u) << missing;
+    EXPECT_EQ(server.requestsServed(), 3u);
+
+    ::close(idle);
+    server.stop();
+    EXPECT_FALSE(server.isRunning());
+    reactor.stop();
+    EXPECT_EQ(reactor.stats().live, 0u);
+}
+#endif
@@ -1,12 +1,45 @@
 #include <gtest/gtest.h>
+#include <gtest/gtest-spi.h>
 #include "motion_processor.hpp"
+#include "allocation_counter.hpp"
+#include "block_motion_map.hpp"
+#include "cached_clahe.hpp"
+#include "contour_filter.hpp"
+#include "debug_artifact_writer.hpp"
+#include "edge_preserving_filter.hpp"
+#include "fixed_size_filters.hpp"
+#include "frame_ring.hpp"
 #include "logger.hpp"
+#include "log_rate_limiter.hpp"
+#include "morphology_chain.hpp"
+#include "packed_mask.hpp"
+#include "rle_mask.hpp"
+#include "motion_history.hpp"
+#include "motion_mask_kernel.hpp"
+#include "detection_evaluator.hpp"
+#include "parameter_tuner.hpp"
+#include "pipeline_config.hpp"
+#include "region_flow_propagator.hpp"
+#include "config_watcher.hpp"
+#include "simd_dispatch.hpp"
+#include "stack_blur.hpp"
+#include "stage_timings.hpp"
+#include "streaming_quantile.hpp"
+#include "thread_budget.hpp"
 #include "test_helpers.hpp"
+#include "tile_occupancy.hpp"
 #include <opencv2/opencv.hpp>
+#include <opencv2/core/ocl.hpp>
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cmath>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <filesystem>
+#include <sstream>
+#include <thread>
 
 void initLogger() {
     try {
@@ -309,7 +342,8 @@ TEST_F(MotionProcessorTest, StandaloneProcessingWithVisualization) {
     LOG_INFO("Frame 2 - Motion: {}, Regions: {}", result2.hasMotion, result2.detectedBounds.size());
     LOG_INFO("Visualizations saved to: {} and {}", outputPath1, outputPath2);
     
-    // Verify output files exist
+    // Verify output files exist (written in the background)
+    DebugArtifactWriter::shared().flush();
     EXPECT_TRUE(std::filesystem::exists(outputPath1)) << "Frame 1 visualization not created";
     EXPECT_TRUE(std::filesystem::exists(outputPath2)) << "Frame 2 visualization not created";
 }
@@ -346,6 +380,31 @@ TEST_F(MotionProcessorTest, IndividualProcessingSteps) {
     
     LOG_INFO("Individual processing steps completed successfully");
     LOG_INFO("Contours extracted: {}", contours.size());
+
+    // The stack blur stands in for the Gaussian: its fused BGR-to-luma output stays close to
+    // cvtColor + GaussianBlur (the kernels differ by a few percent at sharp edges), and the
+    // later steps still find motion
+    const std::string stackPath = outputDir + "/stack_blur_config.yaml";
+    {
+        std::ofstream out(stackPath);
+        out << "blur_type: \"stack\"\n";
+    }
+    MotionProcessor stackProcessor(configPath);
+    stackProcessor.reloadConfig(stackPath);
+    ASSERT_EQ(stackProcessor.getBlurType(), MotionProcessor::BlurType::STACK);
+    const cv::Mat stack1 = stackProcessor.preprocessFrame(frame1);
+    const cv::Mat stack2 = stackProcessor.preprocessFrame(frame2);
+    ASSERT_EQ(stack1.type(), processed1.type());
+    ASSERT_EQ(stack1.size(), processed1.size());
+    cv::Mat stackDiff;
+    cv::absdiff(stack1, processed1, stackDiff);
+    EXPECT_LT(cv::mean(stackDiff)[0], 1.5);
+    EXPECT_LE(cv::norm(stackDiff, cv::NORM_INF), 24.0);
+    stackProcessor.setPrevFrame(stack1);
+    stackProcessor.setFirstFrame(false);
+    cv::Mat stackFrameDiff, stackThresh;
+    stackProcessor.detectMotion(stack2, stackFrameDiff, stackThresh);
+    EXPECT_GT(stackProcessor.extractContours(stackProcessor.applyMorphologicalOps(stackThresh)).size(), 0u);
 }
 
 // Test configuration parameters
@@ -354,6 +413,10 @@ TEST_F(MotionProcessorTest, ConfigurationParameters) {
     EXPECT_GT(motionProcessor->getMaxThreshold(), 0) << "Max threshold should be positive";
     EXPECT_FALSE(motionProcessor->isBackgroundSubtractionEnabled()) << "Background subtraction should be disabled by default";
     
+    EXPECT_EQ(motionProcessor->getProcessingMode(), MotionProcessor::ProcessingMode::GRAYSCALE);
+    EXPECT_EQ(motionProcessor->getBlurType(), MotionProcessor::BlurType::GAUSSIAN);
+    EXPECT_EQ(motionProcessor->getContourMode(), MotionProcessor::ContourMode::ADAPTIVE);
+    
     LOG_INFO("Configuration parameters verified");
     LOG_INFO("Min contour area: {}", motionProcessor->getMinContourArea());
     LOG_INFO("Max threshold: {}", motionProcessor->getMaxThreshold());
@@ -431,6 +494,2230 @@ TEST_F(MotionProcessorTest, CompleteProcessingPipeline) {
     LOG_INFO("Complete pipeline results saved to: {}", outputDir);
 }
 
+// Test that buffer-reuse mode produces identical detections and keeps its buffers stable
+TEST_F(MotionProcessorTest, BufferReuseMatchesAllocatingPath) {
+    cv::Mat frame1 = cv::imread(testImage1Path);
+    cv::Mat frame2 = cv::imread(testImage2Path);
+    ASSERT_FALSE(frame1.empty()) << "Failed to load " << testImage1Path;
+    ASSERT_FALSE(frame2.empty()) << "Failed to load " << testImage2Path;
+
+    MotionProcessor reusingProcessor(configPath);
+    reusingProcessor.setBufferReuse(true);
+    EXPECT_TRUE(reusingProcessor.isBufferReuseEnabled());
+
+    motionProcessor->enableVisualization(false);
+    motionProcessor->processFrame(frame1);
+    MotionProcessor::ProcessingResult expected = motionProcessor->processFrame(frame2);
+
+    reusingProcessor.processFrame(frame1);
+    MotionProcessor::ProcessingResult actual = reusingProcessor.processFrame(frame2);
+    EXPECT_EQ(expected.detectedBounds, actual.detectedBounds);
+    EXPECT_EQ(expected.hasMotion, actual.hasMotion);
+    EXPECT_EQ(cv::norm(expected.morphological, actual.morphological, cv::NORM_INF), 0.0);
+
+    // Steady state: the same buffers are written again for the next frame
+    const uchar* threshData = actual.thresh.data;
+    const uchar* morphData = actual.morphological.data;
+    MotionProcessor::ProcessingResult next = reusingProcessor.processFrame(frame1);
+    EXPECT_EQ(threshData, next.thresh.data);
+    EXPECT_EQ(morphData, next.morphological.data);
+}
+
+// Test that unselected stages are dropped while detections are unchanged
+TEST_F(MotionProcessorTest, RetainedStagesSelection) {
+    cv::Mat frame1 = cv::imread(testImage1Path);
+    cv::Mat frame2 = cv::imread(testImage2Path);
+    ASSERT_FALSE(frame1.empty()) << "Failed to load " << testImage1Path;
+    ASSERT_FALSE(frame2.empty()) << "Failed to load " << testImage2Path;
+
+    motionProcessor->enableVisualization(false);
+    motionProcessor->processFrame(frame1);
+    MotionProcessor::ProcessingResult full = motionProcessor->processFrame(frame2);
+
+    MotionProcessor leanProcessor(configPath);
+    leanProcessor.setRetainedStages(MotionProcessor::STAGE_THRESH);
+    leanProcessor.processFrame(frame1);
+    MotionProcessor::ProcessingResult lean = leanProcessor.processFrame(frame2);
+
+    EXPECT_TRUE(lean.originalFrame.empty());
+    EXPECT_TRUE(lean.processedFrame.empty());
+    EXPECT_TRUE(lean.frameDiff.empty());
+    EXPECT_TRUE(lean.morphological.empty());
+    EXPECT_FALSE(lean.thresh.empty());
+    EXPECT_EQ(full.detectedBounds, lean.detectedBounds);
+    EXPECT_EQ(full.hasMotion, lean.hasMotion);
+}
+
+// Test that only the ROI crop is processed and excluded pixels never produce detections
+TEST_F(MotionProcessorTest, RegionOfInterestAndExclusionZones) {
+    // Three bright squares appear on a dark frame: one inside the ROI, one inside an
+    // exclusion zone within the ROI, and one outside the ROI
+    cv::Mat frame1(240, 400, CV_8UC3, cv::Scalar::all(20));
+    cv::Mat frame2 = frame1.clone();
+    const cv::Rect kept(20, 20, 60, 60);
+    const cv::Rect excluded(120, 20, 60, 60);
+    const cv::Rect outside(300, 100, 60, 60);
+    for (const auto& square : {kept, excluded, outside}) {
+        frame2(square).setTo(cv::Scalar::all(230));
+    }
+
+    const cv::Rect roi(0, 0, 200, 240);
+    const cv::Rect exclusion(100, 0, 100, 120);
+    auto polygonOf = [](const cv::Rect& r) {
+        const cv::Point last = r.br() - cv::Point(1, 1);  // Polygon vertices are inclusive
+        return std::vector<cv::Point>{r.tl(), cv::Point(last.x, r.y), last, cv::Point(r.x, last.y)};
+    };
+
+    motionProcessor->enableVisualization(false);
+    motionProcessor->setRegionsOfInterest({polygonOf(roi)});
+    motionProcessor->setExclusionZones({polygonOf(exclusion)});
+    motionProcessor->processFrame(frame1);
+    MotionProcessor::ProcessingResult result = motionProcessor->processFrame(frame2);
+
+    EXPECT_EQ(result.processedFrame.size(), roi.size()) << "Only the ROI crop should be processed";
+    EXPECT_EQ(result.originalFrame.size(), frame2.size());
+    ASSERT_FALSE(result.detectedBounds.empty()) << "Motion inside the ROI should be detected";
+    for (const auto& bounds : result.detectedBounds) {
+        EXPECT_EQ(bounds & roi, bounds) << "Detection outside the ROI";
+        EXPECT_TRUE((bounds & exclusion).empty()) << "Detection inside an exclusion zone";
+        EXPECT_FALSE((bounds & kept).empty());
+    }
+
+    // Without zones the same frames also report the other two squares
+    MotionProcessor fullFrameProcessor(configPath);
+    fullFrameProcessor.processFrame(frame1);
+    MotionProcessor::ProcessingResult full = fullFrameProcessor.processFrame(frame2);
+    EXPECT_TRUE(std::any_of(full.detectedBounds.begin(), full.detectedBounds.end(),
+                            [&](const cv::Rect& b) { return !(b & outside).empty(); }));
+}
+
+// Test that detecting on a downscaled frame reports boxes in full-resolution coordinates
+TEST_F(MotionProcessorTest, DetectionScaleRemapsBoxes) {
+    cv::Mat frame1(320, 480, CV_8UC3, cv::Scalar::all(20));
+    cv::Mat frame2 = frame1.clone();
+    const cv::Rect square(200, 120, 80, 80);
+    frame2(square).setTo(cv::Scalar::all(230));
+
+    motionProcessor->enableVisualization(false);
+    motionProcessor->processFrame(frame1);
+    MotionProcessor::ProcessingResult full = motionProcessor->processFrame(frame2);
+
+    MotionProcessor scaledProcessor(configPath);
+    scaledProcessor.setDetectionScale(0.5);
+    EXPECT_DOUBLE_EQ(scaledProcessor.getDetectionScale(), 0.5);
+    scaledProcessor.processFrame(frame1);
+    MotionProcessor::ProcessingResult scaled = scaledProcessor.processFrame(frame2);
+
+    EXPECT_EQ(scaled.processedFrame.size(), cv::Size(240, 160));
+    ASSERT_EQ(full.detectedBounds.size(), 1u);
+    ASSERT_EQ(scaled.detectedBounds.size(), 1u);
+
+    // Blur and morphology act twice as wide at half scale, so allow a few pixels of slack
+    const cv::Rect& expected = full.detectedBounds[0];
+    const cv::Rect& actual = scaled.detectedBounds[0];
+    EXPECT_NEAR(actual.x, expected.x, 12);
+    EXPECT_NEAR(actual.y, expected.y, 12);
+    EXPECT_NEAR(actual.br().x, expected.br().x, 12);
+    EXPECT_NEAR(actual.br().y, expected.br().y, 12);
+    EXPECT_EQ(actual & square, square) << "Remapped box should enclose the moving square";
+
+    // Out-of-range scales fall back to full resolution
+    scaledProcessor.setDetectionScale(0.0);
+    EXPECT_DOUBLE_EQ(scaledProcessor.getDetectionScale(), 1.0);
+}
+
+// Test that coarse-to-fine detection reports full-resolution boxes from a 1/4-scale mask
+TEST_F(MotionProcessorTest, DetectionRefinementRestoresFullResolutionBoxes) {
+    cv::Mat frame1(480, 640, CV_8UC3, cv::Scalar::all(20));
+    const cv::Rect bird(301, 203, 42, 30);
+    const cv::Rect otherBird(101, 351, 38, 26);
+    cv::Mat frame2 = frame1.clone();
+    frame2(bird).setTo(cv::Scalar::all(230));
+    frame2(otherBird).setTo(cv::Scalar::all(200));
+
+    MotionProcessor coarseProcessor(configPath);
+    coarseProcessor.setDetectionScale(0.25);
+    coarseProcessor.processFrame(frame1);
+    const MotionProcessor::ProcessingResult coarse = coarseProcessor.processFrame(frame2);
+
+    MotionProcessor refiningProcessor(configPath);
+    refiningProcessor.setDetectionScale(0.25);
+    refiningProcessor.setDetectionRefinement(true);
+    EXPECT_TRUE(refiningProcessor.isDetectionRefinementEnabled());
+    refiningProcessor.processFrame(frame1);
+    const MotionProcessor::ProcessingResult refined = refiningProcessor.processFrame(frame2);
+
+    ASSERT_EQ(coarse.detectedBounds.size(), 2u);
+    ASSERT_EQ(refined.detectedBounds.size(), 2u);
+    for (const cv::Rect& expected : {bird, otherBird}) {
+        const auto match = std::find_if(refined.detectedBounds.begin(), refined.detectedBounds.end(),
+                                        [&](const cv::Rect& box) { return !(box & expected).empty(); });
+        ASSERT_NE(match, refined.detectedBounds.end());
+        // The 3x3 blur of the full-resolution difference may add a pixel on each side
+        EXPECT_NEAR(match->x, expected.x, 1);
+        EXPECT_NEAR(match->y, expected.y, 1);
+        EXPECT_NEAR(match->br().x, expected.br().x, 1);
+        EXPECT_NEAR(match->br().y, expected.br().y, 1);
+    }
+    // The coarse boxes carry the downscaled blur and morphology around them
+    const cv::Rect coarseBird = coarse.detectedBounds[0].contains(bird.tl()) ? coarse.detectedBounds[0]
+                                                                             : coarse.detectedBounds[1];
+    EXPECT_GT(coarseBird.area(), bird.area());
+
+    // A frame decoded into the previous frame's buffer has no reference to refine against:
+    // the coarse boxes are kept and the processor copies its reference from then on
+    cv::Mat reused = frame2.clone();
+    refiningProcessor.processFrame(reused);
+    frame1.copyTo(reused);
+    EXPECT_FALSE(refiningProcessor.processFrame(reused).detectedBounds.empty());
+    frame2.copyTo(reused);
+    const MotionProcessor::ProcessingResult copied = refiningProcessor.processFrame(reused);
+    const auto copiedBird = std::find_if(copied.detectedBounds.begin(), copied.detectedBounds.end(),
+                                         [&](const cv::Rect& box) { return !(box & bird).empty(); });
+    ASSERT_NE(copiedBird, copied.detectedBounds.end());
+    EXPECT_NEAR(copiedBird->x, bird.x, 1);
+    EXPECT_NEAR(copiedBird->br().x, bird.br().x, 1);
+}
+
+// Test that reloading the config retunes the processor without restarting it
+TEST_F(MotionProcessorTest, ReloadConfigKeepsFrameState) {
+    cv::Mat frame1 = cv::imread(testImage1Path);
+    ASSERT_FALSE(frame1.empty()) << "Failed to load " << testImage1Path;
+
+    motionProcessor->enableVisualization(false);
+    motionProcessor->processFrame(frame1);
+    ASSERT_FALSE(motionProcessor->isFirstFrame());
+
+    const std::string reloadedPath = outputDir + "/reloaded_config.yaml";
+    {
+        std::ofstream out(reloadedPath);
+        out << "min_contour_area: 1234\n"
+            << "morph_kernel_size: 9\n"
+            << "contrast_enhancement: true\n";
+    }
+    motionProcessor->reloadConfig(reloadedPath);
+
+    EXPECT_EQ(motionProcessor->getMinContourArea(), 1234);
+    EXPECT_FALSE(motionProcessor->isFirstFrame()) << "Reload should keep the reference frame";
+
+    // The next frame is differenced against the kept reference with the new resources
+    MotionProcessor::ProcessingResult result = motionProcessor->processFrame(frame1);
+    EXPECT_FALSE(result.thresh.empty());
+}
+
+// resetState() starts a new scene: the next frame is a reference again, the config stays
+TEST_F(MotionProcessorTest, ResetStateForgetsFramesButKeepsConfig) {
+    cv::Mat frame1 = cv::imread(testImage1Path);
+    cv::Mat frame2 = cv::imread(testImage2Path);
+    ASSERT_FALSE(frame1.empty()) << "Failed to load " << testImage1Path;
+    ASSERT_FALSE(frame2.empty()) << "Failed to load " << testImage2Path;
+
+    motionProcessor->enableVisualization(false);
+    const auto config = motionProcessor->getConfig();
+    motionProcessor->processFrame(frame1);
+    ASSERT_FALSE(motionProcessor->isFirstFrame());
+
+    motionProcessor->resetState();
+    EXPECT_TRUE(motionProcessor->isFirstFrame());
+    EXPECT_EQ(motionProcessor->getConfig(), config) << "The config snapshot is not re-read";
+
+    // frame2 becomes the reference instead of being differenced against frame1
+    MotionProcessor::ProcessingResult result = motionProcessor->processFrame(frame2);
+    EXPECT_FALSE(result.hasMotion);
+    EXPECT_TRUE(result.detectedBounds.empty());
+    EXPECT_FALSE(motionProcessor->isFirstFrame());
+}
+
+// Test that processors built from one file share a single parsed snapshot and that a
+// reload publishes a new one only when it validates
+TEST_F(MotionProcessorTest, ProcessorsShareOneConfigSnapshot) {
+    MotionProcessor first(configPath);
+    MotionProcessor second(configPath);
+    ASSERT_NE(first.getConfig(), nullptr);
+    EXPECT_EQ(first.getConfig(), second.getConfig()) << "Same unchanged file should not be parsed twice";
+
+    const std::string livePath = outputDir + "/live_config.yaml";
+    {
+        std::ofstream out(livePath);
+        out << "min_contour_area: 321\n"
+            << "eps: 40\n";
+    }
+    SharedPipelineConfig shared(PipelineConfig::load(livePath));
+    MotionProcessor live(shared.current());
+    EXPECT_EQ(live.getMinContourArea(), 321);
+    EXPECT_DOUBLE_EQ(shared.current()->consolidation.eps, 40.0);
+
+    {
+        std::ofstream out(livePath, std::ios::trunc);
+        out << "min_contour_area: 654\n"
+            << "eps: -5\n";  // Rejected: the running snapshot stays
+    }
+    EXPECT_FALSE(shared.reload());
+    EXPECT_EQ(shared.version(), 0u);
+    {
+        std::ofstream out(livePath, std::ios::trunc);
+        out << "min_contour_area: 654\n";
+    }
+    ASSERT_TRUE(shared.reload());
+    EXPECT_EQ(shared.version(), 1u);
+    live.reloadConfig(shared.current());
+    EXPECT_EQ(live.getMinContourArea(), 654);
+    EXPECT_EQ(live.getConfig(), shared.current());
+}
+
+TEST(PipelineConfigTest, ValidationListsEveryProblem) {
+    try {
+        PipelineConfig::fromYaml("eps: 0\n"
+                                 "min_pts: \"many\"\n"
+                                 "tracker_min_iou: 1.5\n"
+                                 "gaussian_blur_size: 4\n"
+                                 "logging:\n"
+                                 "  log_level: \"loud\"\n"
+                                 "stage_graph:\n"
+                                 "  stages: [\"detect\", \"teleport\"]\n"
+                                 "threads:\n"
+                                 "  capture: {cpus: [3], nice: 40}\n"
+                                 "  gpu: {cpus: [0]}\n");
+        FAIL() << "Invalid config accepted";
+    } catch (const std::invalid_argument& e) {
+        const std::string message = e.what();
+        for (const char* key : {"eps", "min_pts", "tracker_min_iou", "gaussian_blur_size", "logging.log_level",
+                                "stage_graph.stages", "threads.capture.nice", "threads.gpu"}) {
+            EXPECT_NE(message.find(key), std::string::npos) << key << " missing from: " << message;
+        }
+    }
+    EXPECT_THROW(PipelineConfig::fromYaml("- not\n- a map\n"), std::invalid_argument);
+    EXPECT_THROW(PipelineConfig::load("does_not_exist.yaml"), std::invalid_argument);
+
+    // Missing keys keep the same defaults as the structs they fill
+    auto defaults = PipelineConfig::fromYaml("");
+    EXPECT_DOUBLE_EQ(defaults->consolidation.eps, ConsolidationConfig().eps);
+    EXPECT_DOUBLE_EQ(defaults->tracker.minIou, TrackerConfig().minIou);
+    EXPECT_EQ(defaults->logging.level, "info");
+    EXPECT_TRUE(defaults->trackerEnabled);
+    EXPECT_TRUE(defaults->stageGraph.stages.empty());
+    EXPECT_EQ(defaults->stageGraph.outputs, std::vector<std::string>({"regions"}));
+    EXPECT_TRUE(defaults->threads.roles.empty());
+
+    auto placed = PipelineConfig::fromYaml("threads:\n  capture: {cpus: [3], realtime_priority: 20}\n");
+    ASSERT_NE(placed->threads.find("capture"), nullptr);
+    EXPECT_EQ(placed->threads.find("capture")->cpus, std::vector<int>({3}));
+    EXPECT_EQ(placed->threads.find("capture")->realtimePriority, 20);
+    EXPECT_EQ(placed->threads.find("detect"), nullptr);
+}
+
+// Test the core split: set-aside partitions come off the end, one compute core always
+// stays, and OpenCV's pool only gets the compute cores the workers leave idle
+TEST(ThreadBudgetTest, PartitionsCoresBetweenRolesAndOpenCv) {
+    const std::vector<int> cpus = {0, 1, 2, 3, 4, 5, 6, 7};
+    ThreadBudgetSettings settings;
+    settings.classificationCores = 2;
+
+    ThreadBudget single = ThreadBudget::plan(settings, 1, cpus);
+    EXPECT_EQ(single.computeCpus, std::vector<int>({0, 1, 2, 3, 4}));
+    EXPECT_EQ(single.persistenceCpus, std::vector<int>({7}));
+    EXPECT_EQ(single.classificationCpus, std::vector<int>({5, 6}));
+    EXPECT_EQ(single.opencvThreads, 5);  // One worker: the whole compute partition
+    EXPECT_EQ(single.cores(), 8u);
+
+    // Three workers busy on five cores leave two for OpenCV, plus the calling worker
+    EXPECT_EQ(ThreadBudget::plan(settings, 3, cpus).opencvThreads, 3);
+    // As many workers as compute cores: OpenCV runs sequentially inside each
+    EXPECT_EQ(ThreadBudget::plan(settings, 8, cpus).opencvThreads, 1);
+
+    // Too few cores: the set-aside roles shrink, then share the compute core
+    settings.cores = 2;
+    ThreadBudget small = ThreadBudget::plan(settings, 1, cpus);
+    EXPECT_EQ(small.computeCpus, std::vector<int>({0}));
+    EXPECT_EQ(small.persistenceCpus, std::vector<int>({1}));
+    EXPECT_TRUE(small.classificationCpus.empty());
+    EXPECT_EQ(small.cpus(ThreadPartition::Classification), std::vector<int>({0}));
+
+    settings.opencvThreads = 0;
+    EXPECT_EQ(ThreadBudget::plan(settings, 1, cpus).opencvThreads, 0);
+
+    // Pinning fills in the roles the threads: section leaves unpinned, and only those
+    ThreadSettings configured;
+    configured.roles["detect"].cpus = {3};
+    configured.roles["persist"].nice = 5;
+    EXPECT_TRUE(single.placement(configured, {{"persist", ThreadPartition::Persistence}}).roles.at("persist")
+                    .cpus.empty());
+    single.pin = true;
+    const ThreadSettings placed = single.placement(
+        configured, {{"detect", ThreadPartition::Compute}, {"render", ThreadPartition::Compute},
+                     {"persist", ThreadPartition::Persistence}});
+    EXPECT_EQ(placed.find("detect")->cpus, std::vector<int>({3}));
+    EXPECT_EQ(placed.find("render")->cpus, single.computeCpus);
+    EXPECT_EQ(placed.find("persist")->cpus, std::vector<int>({7}));
+    EXPECT_EQ(placed.find("persist")->nice, 5);
+
+    auto config = PipelineConfig::fromYaml("thread_budget:\n  cores: 4\n  opencv_threads: 2\n  pin: true\n");
+    EXPECT_EQ(config->threadBudget.cores, 4);
+    EXPECT_EQ(config->threadBudget.opencvThreads, 2);
+    EXPECT_TRUE(config->threadBudget.pin);
+    EXPECT_THROW(PipelineConfig::fromYaml("thread_budget:\n  opencv_threads: -2\n"), std::invalid_argument);
+    EXPECT_FALSE(allowedCpus().empty());
+}
+
+// Test that the restart handoff section is typed and range-checked like the other sections
+TEST(PipelineConfigTest, ReadsHandoff) {
+    auto config = PipelineConfig::fromYaml("handoff:\n  enabled: true\n  socket_path: /tmp/h.sock\n"
+                                           "  state_timeout_ms: 500\n");
+    EXPECT_TRUE(config->handoff.enabled);
+    EXPECT_EQ(config->handoff.socketPath, "/tmp/h.sock");
+    EXPECT_EQ(config->handoff.stateTimeout, std::chrono::milliseconds(500));
+    EXPECT_EQ(config->handoff.releaseTimeout, HandoffConfig().releaseTimeout);
+    EXPECT_THROW(PipelineConfig::fromYaml("handoff:\n  state_timeout_ms: -1\n"), std::invalid_argument);
+    EXPECT_THROW(PipelineConfig::fromYaml("handoff:\n  release_timeout_ms: -5\n"), std::invalid_argument);
+    EXPECT_THROW(PipelineConfig::fromYaml("handoff:\n  socket_path: \"\"\n"), std::invalid_argument);
+}
+
+// Test that load_shedding keeps its recover ratio below the overload ratio
+TEST(PipelineConfigTest, ReadsLoadShedding) {
+    auto config = PipelineConfig::fromYaml("load_shedding:\n  enabled: true\n  max_stride: 6\n");
+    EXPECT_TRUE(config->loadShedding.enabled);
+    EXPECT_EQ(config->loadShedding.maxStride, 6);
+    EXPECT_DOUBLE_EQ(config->loadShedding.overloadRatio, LoadSheddingConfig().overloadRatio);
+    EXPECT_THROW(PipelineConfig::fromYaml("load_shedding:\n  recover_ratio: 0.95\n"), std::invalid_argument);
+    EXPECT_THROW(PipelineConfig::fromYaml("load_shedding:\n  max_stride: 0\n"), std::invalid_argument);
+    EXPECT_THROW(PipelineConfig::fromYaml("load_shedding:\n  min_scale_factor: 1.5\n"), std::invalid_argument);
+}
+
+// Test that adaptive_scale rejects ranges AdaptiveDetectionScale would otherwise clamp silently
+TEST(PipelineConfigTest, ReadsAdaptiveScale) {
+    auto config = PipelineConfig::fromYaml("adaptive_scale:\n  enabled: true\n  percentile: 0.1\n"
+                                           "  min_scale: 0.5\n");
+    EXPECT_TRUE(config->adaptiveScale.enabled);
+    EXPECT_DOUBLE_EQ(config->adaptiveScale.percentile, 0.1);
+    EXPECT_DOUBLE_EQ(config->adaptiveScale.minScale, 0.5);
+    EXPECT_DOUBLE_EQ(config->adaptiveScale.maxScale, AdaptiveScaleConfig().maxScale);
+    EXPECT_THROW(PipelineConfig::fromYaml("adaptive_scale:\n  percentile: 1.0\n"), std::invalid_argument);
+    EXPECT_THROW(PipelineConfig::fromYaml("adaptive_scale:\n  min_scale: 0.75\n  max_scale: 0.5\n"),
+                 std::invalid_argument);
+    EXPECT_THROW(PipelineConfig::fromYaml("adaptive_scale:\n  scale_step: 0\n"), std::invalid_argument);
+}
+
+// Test that wake_trigger reports an unknown source with the other config problems
+TEST(PipelineConfigTest, ReadsWakeTrigger) {
+    auto config = PipelineConfig::fromYaml("wake_trigger:\n  enabled: true\n  source: GPIO\n"
+                                           "  pre_roll_frames: 8\n");
+    EXPECT_TRUE(config->wakeTrigger.enabled);
+    EXPECT_EQ(config->wakeTrigger.source, WakeSource::Gpio);
+    EXPECT_EQ(config->wakeTrigger.preRollFrames, 8u);
+    EXPECT_THROW(PipelineConfig::fromYaml("wake_trigger:\n  source: pir\n"), std::invalid_argument);
+    EXPECT_THROW(PipelineConfig::fromYaml("wake_trigger:\n  sleep_fps: 0\n"), std::invalid_argument);
+    EXPECT_THROW(PipelineConfig::fromYaml("wake_trigger:\n  pre_roll_frames: -1\n"), std::invalid_argument);
+}
+
+// Test that the motion history measures a square's velocity from its trail, marks motion
+// that stays in place as jitter, and combines box motion into region motion
+TEST(MotionHistoryTest, MeasuresVelocityAndJitter) {
+    MotionHistoryConfig config;
+    config.enabled = true;
+    config.jitterMinAgeFrames = 6;
+    MotionHistory history(config);
+    cv::Mat mask(80, 120, CV_8UC1);
+    for (int frame = 1; frame <= 10; ++frame) {
+        mask.setTo(0);
+        mask(cv::Rect(10 + 2 * frame, 20 + frame, 10, 10)).setTo(255);
+        history.update(mask);
+    }
+    const RegionMotion moving = history.measure(cv::Rect(0, 0, 60, 50));
+    EXPECT_NEAR(moving.vx, 2.0f, 0.1f);
+    EXPECT_NEAR(moving.vy, 1.0f, 0.1f);
+    EXPECT_NEAR(moving.direction(), 26.6f, 1.0f);
+    EXPECT_EQ(moving.ageFrames, 9);
+    EXPECT_FALSE(moving.jitter);
+
+    // A blob flickering in place: long-lived, no net motion
+    cv::Mat leaves(80, 120, CV_8UC1, cv::Scalar(0));
+    for (int frame = 0; frame < 10; ++frame) {
+        leaves.setTo(0);
+        leaves(cv::Rect(80 + frame % 2, 50, 8, 8)).setTo(255);
+        history.update(leaves);
+    }
+    const RegionMotion jitter = history.measure(cv::Rect(70, 40, 30, 30));
+    EXPECT_LT(jitter.speed(), config.jitterMaxSpeed);
+    EXPECT_TRUE(jitter.jitter);
+    EXPECT_FALSE(history.measure(cv::Rect(0, 70, 10, 10)).measured());
+
+    // A region takes the moving-area weighted motion of its objects
+    TrackedObjectStore objects;
+    objects.add(1, cv::Rect(0, 0, 10, 10));
+    objects.add(2, cv::Rect(20, 0, 10, 10));
+    RegionMotion first;
+    first.vx = 4.0f;
+    first.coverage = 0.5f;
+    RegionMotion second = jitter;
+    second.coverage = 0.25f;
+    std::vector<ConsolidatedRegion> regions;
+    regions.emplace_back(cv::Rect(0, 0, 30, 10), RegionObjectIds{1, 2});
+    regions.emplace_back(cv::Rect(20, 0, 10, 10), RegionObjectIds{2});
+    MotionHistory::summarizeRegions(objects, {first, second}, regions);
+    EXPECT_NEAR(regions[0].motion.vx, (4.0f * 50.0f + jitter.vx * 25.0f) / 75.0f, 1e-4f);
+    EXPECT_FLOAT_EQ(regions[0].motion.coverage, 0.375f);
+    EXPECT_FALSE(regions[0].motion.jitter);  // One member really moves
+    EXPECT_TRUE(regions[1].motion.jitter);
+
+    auto parsed = PipelineConfig::fromYaml("motion_history:\n  enabled: true\n  duration_frames: 20\n");
+    EXPECT_TRUE(parsed->motionHistory.enabled);
+    EXPECT_EQ(parsed->motionHistory.durationFrames, 20);
+    EXPECT_THROW(PipelineConfig::fromYaml("motion_history:\n  duration_frames: 1\n"), std::invalid_argument);
+}
+
+// Test that the propagator follows a textured box between detection frames, asks for
+// detection every k-th frame, and reports a confidence drop once the texture is gone
+TEST(RegionFlowPropagatorTest, FollowsTexturedBoxUntilLost) {
+    cv::Mat texture(40, 40, CV_8UC3);
+    cv::RNG rng(7);
+    rng.fill(texture, cv::RNG::UNIFORM, 0, 255);
+    cv::GaussianBlur(texture, texture, cv::Size(3, 3), 0);
+    auto frameAt = [&texture](int x, int y) {
+        cv::Mat frame(240, 320, CV_8UC3, cv::Scalar(90, 90, 90));
+        texture.copyTo(frame(cv::Rect(x, y, texture.cols, texture.rows)));
+        return frame;
+    };
+
+    FlowPropagationConfig config;
+    config.enabled = true;
+    config.detectEveryFrames = 4;
+    RegionFlowPropagator propagator(config);
+    EXPECT_TRUE(propagator.detectionDue());
+    propagator.seed(frameAt(100, 80), {cv::Rect(100, 80, 40, 40)});
+    EXPECT_FALSE(propagator.detectionDue());
+
+    std::vector<cv::Rect> boxes;
+    for (int step = 1; step <= 3; ++step) {
+        ASSERT_TRUE(propagator.propagate(frameAt(100 + 3 * step, 80 + 2 * step), boxes));
+        ASSERT_EQ(boxes.size(), 1u);
+        EXPECT_NEAR(boxes[0].x, 100 + 3 * step, 1);
+        EXPECT_NEAR(boxes[0].y, 80 + 2 * step, 1);
+        EXPECT_EQ(propagator.shifts()[0], cv::Point(3, 2));
+        EXPECT_GE(propagator.confidences()[0], config.minTrackedFraction);
+    }
+    EXPECT_TRUE(propagator.detectionDue());  // Frame 4 of 4 since the seed
+
+    // Regions move with the mean shift of their objects; regions without one stay put
+    TrackedObjectStore objects;
+    objects.add(11, boxes[0]);
+    std::vector<ConsolidatedRegion> regions;
+    regions.emplace_back(cv::Rect(90, 70, 60, 60), RegionObjectIds{11});
+    regions.emplace_back(cv::Rect(10, 10, 20, 20), RegionObjectIds{42});
+    RegionFlowPropagator::moveRegions(objects, propagator.shifts(), regions);
+    EXPECT_EQ(regions[0].boundingBox, cv::Rect(93, 72, 60, 60));
+    EXPECT_EQ(regions[1].boundingBox, cv::Rect(10, 10, 20, 20));
+
+    // The bird vanishes: no point comes back, the caller must detect on this frame
+    propagator.seed(frameAt(100, 80), {cv::Rect(100, 80, 40, 40)});
+    EXPECT_FALSE(propagator.propagate(cv::Mat(240, 320, CV_8UC3, cv::Scalar(90, 90, 90)), boxes));
+    EXPECT_TRUE(propagator.detectionDue());
+    EXPECT_EQ(propagator.stats().detectionFrames, 2u);
+    EXPECT_EQ(propagator.stats().propagatedFrames, 3u);
+    EXPECT_EQ(propagator.stats().confidenceDrops, 1u);
+
+    auto parsed = PipelineConfig::fromYaml("flow_propagation:\n  enabled: true\n  detect_every_frames: 3\n");
+    EXPECT_TRUE(parsed->flowPropagation.enabled);
+    EXPECT_EQ(parsed->flowPropagation.detectEveryFrames, 3);
+    EXPECT_THROW(PipelineConfig::fromYaml("flow_propagation:\n  detect_every_frames: 0\n"), std::invalid_argument);
+}
+
+// Test that detections are matched one-to-one by IoU, and that the tuner keeps the base
+// config's values, ranks trials by CPU time under the floors and finds the cheapest feasible one
+TEST(ParameterTunerTest, ScoresDetectionsAndRanksTrials) {
+    const DetectionScore score = DetectionScore::match(
+        {cv::Rect(0, 0, 10, 10), cv::Rect(1, 1, 10, 10), cv::Rect(50, 50, 10, 10)},
+        {cv::Rect(0, 0, 10, 10), cv::Rect(100, 100, 10, 10)}, 0.3);
+    EXPECT_EQ(score.truePositives, 1u);   // The overlapping pair claims one true box only
+    EXPECT_EQ(score.falsePositives, 2u);
+    EXPECT_EQ(score.falseNegatives, 1u);
+    EXPECT_DOUBLE_EQ(score.recall(), 0.5);
+    EXPECT_DOUBLE_EQ(DetectionScore().precision(), 1.0);
+
+    ParameterTuner::Settings settings;
+    settings.minRecall = 0.9;
+    settings.minPrecision = 0.0;
+    const YAML::Node base = YAML::Load("morph_kernel_size: 6\nblur_type: gaussian\n");
+    const ParameterTuner tuner(ParameterTuner::parseSpace(YAML::Load(
+                                   "morph_kernel_size: [3, 5, 7, 9]\nblur_type: [none, gaussian]\n")),
+                               base, settings);
+    ASSERT_EQ(tuner.space().size(), 2u);
+    EXPECT_EQ(tuner.space()[0].values, (std::vector<std::string>{"3", "5", "6", "7", "9"}));
+    EXPECT_EQ(tuner.baseline(), (TuningAssignment{2, 1}));
+    EXPECT_EQ(tuner.describe(tuner.baseline()), "(base config)");
+
+    // Cost grows with the kernel; blur_type none or a kernel below 5 loses birds
+    auto evaluate = [&tuner](TuningTrial& trial) {
+        const YAML::Node document = tuner.apply(trial.assignment);
+        const int kernel = document["morph_kernel_size"].as<int>();
+        const bool blurred = document["blur_type"].as<std::string>() != "none";
+        trial.cpuMsPerFrame = kernel + (blurred ? 1.0 : 0.0);
+        trial.score.truePositives = blurred && kernel >= 5 ? 10 : 5;
+        trial.score.falseNegatives = blurred && kernel >= 5 ? 0 : 5;
+        if (kernel == 9 && !blurred) throw std::invalid_argument("rejected");
+    };
+    const std::vector<TuningTrial> trials = tuner.run(24, 3, evaluate);
+    ASSERT_EQ(trials.size(), 24u);
+    EXPECT_TRUE(tuner.feasible(trials.front()));
+    EXPECT_EQ(tuner.describe(trials.front().assignment), "morph_kernel_size=5");
+    EXPECT_DOUBLE_EQ(trials.front().cpuMsPerFrame, 6.0);
+    for (size_t i = 1; i < trials.size(); ++i) EXPECT_FALSE(tuner.better(trials[i], trials[i - 1]));
+    const auto rejected = std::find_if(trials.begin(), trials.end(), [](const TuningTrial& t) { return !t.valid; });
+    if (rejected != trials.end()) EXPECT_EQ(rejected->error, "rejected");
+    EXPECT_EQ(trials.back().valid, rejected == trials.end());
+}
+
+// Test that ground truth parses from the replay's detections format, and that the evaluator
+// matches boxes by IoU, scores unannotated regions by coverage and skips unannotated frames
+TEST(DetectionEvaluatorTest, ScoresBoxesAndRegionsAgainstGroundTruth) {
+    std::istringstream text(
+        "# hand-corrected replay output\n"
+        "{\"frame\": 0, \"boxes\": [[10, 10, 20, 20], [100, 100, 20, 20]]}\n"
+        "\n"
+        "{\"frame\": 1, \"boxes\": [[10, 10, 20, 20]], \"regions\": [[0, 0, 40, 40]]}\n"
+        "{\"frame\": 2, \"boxes\": []}\n");
+    const GroundTruth truth = GroundTruth::parse(text, "truth.jsonl");
+    ASSERT_EQ(truth.size(), 3u);
+    ASSERT_NE(truth.find(1), nullptr);
+    EXPECT_TRUE(truth.find(1)->regions.has_value());
+    EXPECT_FALSE(truth.find(0)->regions.has_value());
+    EXPECT_EQ(truth.find(3), nullptr);
+
+    DetectionEvaluator evaluator(truth, 0.5, 0.5);
+    // Frame 0: one exact box, one stray; a single region covers both birds
+    EXPECT_TRUE(evaluator.addFrame(0, {cv::Rect(10, 10, 20, 20), cv::Rect(300, 300, 10, 10)},
+                                   std::vector<cv::Rect>{cv::Rect(0, 0, 130, 130)}));
+    // Frame 1: the box is shifted to IoU 1/3, the region matches the annotated one
+    EXPECT_TRUE(evaluator.addFrame(1, {cv::Rect(20, 10, 20, 20)}, std::vector<cv::Rect>{cv::Rect(0, 0, 40, 40)}));
+    // Frame 2: no birds, one false region; frame 3 is not annotated
+    EXPECT_TRUE(evaluator.addFrame(2, {}, std::vector<cv::Rect>{cv::Rect(0, 0, 40, 40)}));
+    EXPECT_FALSE(evaluator.addFrame(3, {cv::Rect(0, 0, 5, 5)}, std::vector<cv::Rect>()));
+
+    const AccuracyReport& report = evaluator.report();
+    EXPECT_EQ(report.frames, 3u);
+    EXPECT_EQ(report.boxes.truePositives, 1u);
+    EXPECT_EQ(report.boxes.falseNegatives, 2u);
+    EXPECT_EQ(report.boxes.falsePositives, 2u);
+    EXPECT_DOUBLE_EQ(report.boxes.meanOverlap(), 1.0);
+    EXPECT_EQ(report.regions.truePositives, 3u);  // Two birds covered, one region matched
+    EXPECT_EQ(report.regions.matchedDetections, 2u);
+    EXPECT_EQ(report.regions.falsePositives, 1u);
+    EXPECT_DOUBLE_EQ(report.regions.recall(), 1.0);
+    EXPECT_NEAR(report.regions.precision(), 2.0 / 3.0, 1e-9);
+
+    std::istringstream broken("{\"frame\": 0, \"boxes\": [[1, 2, 3]]}\n");
+    EXPECT_THROW(GroundTruth::parse(broken, "broken.jsonl"), std::runtime_error);
+}
+
+// Test that the watcher publishes an edited file, rejects a broken one, and that the
+// processor adopts the new snapshot at a frame boundary without losing its reference frame
+TEST_F(MotionProcessorTest, ConfigWatcherReloadsEditedFile) {
+    const std::string watchedPath = outputDir + "/watched_config.yaml";
+    {
+        std::ofstream out(watchedPath);
+        out << "min_contour_area: 100\n";
+    }
+    SharedPipelineConfig shared(PipelineConfig::load(watchedPath));
+    MotionProcessor live(shared.current());
+    live.processFrame(cv::Mat(240, 320, CV_8UC3, cv::Scalar(20, 20, 20)));
+
+    ConfigWatchOptions options;
+    options.pollInterval = std::chrono::milliseconds(20);
+    options.settleTime = std::chrono::milliseconds(20);
+    ConfigWatcher watcher(shared, options);
+
+    auto waitFor = [](const std::function<bool()>& done) {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!done() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return done();
+    };
+
+    {
+        std::ofstream out(watchedPath, std::ios::trunc);
+        out << "min_contour_area: 250\n";
+    }
+    ASSERT_TRUE(waitFor([&] { return shared.version() == 1; })) << "Edited file was not reloaded";
+    live.reloadConfig(shared.current());
+    EXPECT_EQ(live.getMinContourArea(), 250);
+    EXPECT_FALSE(live.isFirstFrame());
+
+    {
+        std::ofstream out(watchedPath, std::ios::trunc);
+        out << "min_contour_area: 500\n"
+            << "gaussian_blur_size: 4\n";
+    }
+    ASSERT_TRUE(waitFor([&] { return watcher.rejected() >= 1; })) << "Broken file was not rejected";
+    EXPECT_EQ(shared.version(), 1u);
+    EXPECT_EQ(shared.current()->document()["min_contour_area"].as<int>(), 250);
+
+    // requestReload() (SIGHUP) re-reads the file even when nothing changed on disk
+    {
+        std::ofstream out(watchedPath, std::ios::trunc);
+        out << "min_contour_area: 500\n";
+    }
+    ASSERT_TRUE(waitFor([&] { return shared.version() == 2; }));
+    const uint64_t reloadsBefore = watcher.reloads();
+    watcher.requestReload();
+    EXPECT_TRUE(waitFor([&] { return watcher.reloads() > reloadsBefore; }));
+}
+
+// Test the single-channel color modes and raw NV12 / YUYV camera input
+TEST_F(MotionProcessorTest, ColorModesAndYuvInput) {
+    motionProcessor->enableVisualization(false);
+
+    // hsv keeps the value channel: the per-pixel maximum of B, G and R
+    cv::Mat color(120, 160, CV_8UC3, cv::Scalar(10, 200, 30));
+    const std::string hsvPath = outputDir + "/hsv_config.yaml";
+    {
+        std::ofstream out(hsvPath);
+        out << "processing_mode: \"hsv\"\n"
+            << "contrast_enhancement: false\n";
+    }
+    motionProcessor->reloadConfig(hsvPath);
+    ASSERT_EQ(motionProcessor->getProcessingMode(), MotionProcessor::ProcessingMode::HSV);
+    cv::Mat value = motionProcessor->preprocessFrame(color);
+    ASSERT_EQ(value.type(), CV_8UC1);
+    EXPECT_EQ(value.at<uchar>(60, 80), 200);
+
+    // Gray frames with a moving square, fed as BGR and as NV12 / YUYV camera buffers
+    cv::Mat gray1(240, 320, CV_8UC1, cv::Scalar(20));
+    cv::Mat gray2 = gray1.clone();
+    gray2(cv::Rect(100, 80, 60, 60)).setTo(cv::Scalar(230));
+    auto toBgr = [](const cv::Mat& gray) {
+        cv::Mat bgr;
+        cv::cvtColor(gray, bgr, cv::COLOR_GRAY2BGR);
+        return bgr;
+    };
+    auto toNv12 = [](const cv::Mat& gray) {
+        cv::Mat nv12;
+        cv::vconcat(gray, cv::Mat(gray.rows / 2, gray.cols, CV_8UC1, cv::Scalar(128)), nv12);
+        return nv12;
+    };
+    auto toYuyv = [](const cv::Mat& gray) {
+        cv::Mat yuyv;
+        cv::merge(std::vector<cv::Mat>{gray, cv::Mat(gray.size(), CV_8UC1, cv::Scalar(128))}, yuyv);
+        return yuyv;
+    };
+
+    MotionProcessor bgrProcessor(configPath);
+    bgrProcessor.processFrame(toBgr(gray1));
+    MotionProcessor::ProcessingResult expected = bgrProcessor.processFrame(toBgr(gray2));
+    ASSERT_FALSE(expected.detectedBounds.empty());
+
+    MotionProcessor nv12Processor(configPath);
+    nv12Processor.setInputFormat(MotionProcessor::InputFormat::NV12);
+    nv12Processor.processFrame(toNv12(gray1));
+    MotionProcessor::ProcessingResult nv12 = nv12Processor.processFrame(toNv12(gray2));
+    EXPECT_EQ(nv12.processedFrame.size(), gray1.size());
+    EXPECT_EQ(nv12.originalFrame.type(), CV_8UC3);
+    EXPECT_EQ(nv12.detectedBounds, expected.detectedBounds);
+
+    MotionProcessor yuyvProcessor(configPath);
+    yuyvProcessor.setInputFormat(MotionProcessor::InputFormat::YUYV);
+    yuyvProcessor.processFrame(toYuyv(gray1));
+    MotionProcessor::ProcessingResult yuyv = yuyvProcessor.processFrame(toYuyv(gray2));
+    EXPECT_EQ(yuyv.detectedBounds, expected.detectedBounds);
+
+    // rgb differences are reduced to one channel before thresholding
+    const std::string rgbPath = outputDir + "/rgb_config.yaml";
+    {
+        std::ofstream out(rgbPath);
+        out << "processing_mode: \"rgb\"\n";
+    }
+    MotionProcessor rgbProcessor(rgbPath);
+    rgbProcessor.processFrame(toBgr(gray1));
+    MotionProcessor::ProcessingResult rgb = rgbProcessor.processFrame(toBgr(gray2));
+    EXPECT_EQ(rgb.thresh.type(), CV_8UC1);
+    EXPECT_FALSE(rgb.detectedBounds.empty());
+}
+
+TEST(StreamingQuantileTest, TracksPercentilesOfLongStreams) {
+    // Exact below five samples: index count * fraction of the sorted samples
+    StreamingQuantile small(0.25);
+    for (double x : {9.0, 3.0, 7.0}) small.add(x);
+    EXPECT_DOUBLE_EQ(small.value(), 3.0);
+
+    cv::RNG rng(7);
+    std::vector<double> samples;
+    StreamingQuantile p10(0.1);
+    StreamingQuantile p90(0.9);
+    for (int i = 0; i < 20000; ++i) {
+        const double x = std::exp(rng.gaussian(1.0) + 5.0);  // Skewed, like contour areas
+        samples.push_back(x);
+        p10.add(x);
+        p90.add(x);
+    }
+    std::sort(samples.begin(), samples.end());
+    const double exact10 = samples[samples.size() / 10];
+    const double exact90 = samples[samples.size() * 9 / 10];
+    EXPECT_NEAR(p10.value(), exact10, 0.05 * exact10);
+    EXPECT_NEAR(p90.value(), exact90, 0.05 * exact90);
+    EXPECT_EQ(p10.count(), samples.size());
+
+    p10.reset();
+    EXPECT_EQ(p10.count(), 0u);
+    EXPECT_DOUBLE_EQ(p10.value(), 0.0);
+}
+
+// Test that the fused two-pass motion mask matches the absdiff/bitwise_or/Otsu chain
+TEST(MotionMaskKernelTest, FusedMaskMatchesOpenCvChain) {
+    cv::RNG rng(42);
+    // Odd widths exercise the scalar tail after the SIMD blocks
+    for (const cv::Size size : {cv::Size(64, 48), cv::Size(333, 97), cv::Size(7, 5)}) {
+        cv::Mat current(size, CV_8UC1);
+        cv::Mat previous(size, CV_8UC1);
+        cv::Mat background(size, CV_8UC1);
+        cv::Mat excluded(size, CV_8UC1);
+        rng.fill(current, cv::RNG::UNIFORM, 0, 256);
+        rng.fill(previous, cv::RNG::UNIFORM, 0, 256);
+        // MOG2 masks hold 0, 127 (shadow) and 255
+        rng.fill(background, cv::RNG::UNIFORM, 0, 3);
+        background *= 127;
+        background.setTo(255, background == 254);
+        rng.fill(excluded, cv::RNG::UNIFORM, 0, 5);
+        excluded = (excluded == 0);
+
+        for (bool withBackground : {false, true}) {
+            for (bool withExclusions : {false, true}) {
+                const cv::Mat bg = withBackground ? background : cv::Mat();
+                const cv::Mat ex = withExclusions ? excluded : cv::Mat();
+
+                cv::Mat expectedDiff, expectedMask, expectedThresh;
+                cv::absdiff(current, previous, expectedDiff);
+                expectedMask = withBackground ? (expectedDiff | bg) : expectedDiff.clone();
+                if (withExclusions) {
+                    expectedDiff.setTo(0, ex);
+                    expectedMask.setTo(0, ex);
+                }
+                const double expectedLevel = cv::threshold(
+                    expectedMask, expectedThresh, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+
+                cv::Mat diff, thresh;
+                MotionHistogram histogram;
+                absDiffHistogram(current, previous, bg, ex, diff, histogram);
+                const int level = otsuThreshold(histogram);
+                thresholdMotion(diff, bg, ex, level, 255, thresh);
+
+                EXPECT_EQ(level, static_cast<int>(expectedLevel));
+                EXPECT_EQ(cv::norm(diff, expectedDiff, cv::NORM_INF), 0.0);
+                EXPECT_EQ(cv::norm(thresh, expectedThresh, cv::NORM_INF), 0.0);
+            }
+        }
+    }
+}
+
+// The three-frame pass 1 keeps the smaller of both differences
+TEST(MotionMaskKernelTest, ThreeFrameDiffIsMinimumOfBothDiffs) {
+    cv::RNG rng(7);
+    for (const cv::Size size : {cv::Size(64, 48), cv::Size(333, 97)}) {
+        cv::Mat current(size, CV_8UC1);
+        cv::Mat previous(size, CV_8UC1);
+        cv::Mat older(size, CV_8UC1);
+        rng.fill(current, cv::RNG::UNIFORM, 0, 256);
+        rng.fill(previous, cv::RNG::UNIFORM, 0, 256);
+        rng.fill(older, cv::RNG::UNIFORM, 0, 256);
+
+        cv::Mat toPrevious, toOlder, expected;
+        cv::absdiff(current, previous, toPrevious);
+        cv::absdiff(current, older, toOlder);
+        cv::min(toPrevious, toOlder, expected);
+
+        cv::Mat diff;
+        MotionHistogram histogram;
+        absDiffHistogram(current, previous, older, cv::Mat(), cv::Mat(), diff, histogram);
+        EXPECT_EQ(cv::norm(diff, expected, cv::NORM_INF), 0.0);
+        EXPECT_EQ(otsuThreshold(histogram),
+                  static_cast<int>(cv::threshold(expected, expected, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU)));
+    }
+}
+
+// Every instruction set this machine runs produces the scalar kernels' output
+TEST(MotionMaskKernelTest, EverySimdLevelMatchesScalar) {
+    cv::RNG rng(11);
+    const cv::Size size(1283, 37);  // Past one histogram chunk, odd tail for every vector width
+    cv::Mat current(size, CV_8UC1), previous(size, CV_8UC1), older(size, CV_8UC1);
+    cv::Mat background(size, CV_8UC1), excluded(size, CV_8UC1);
+    rng.fill(current, cv::RNG::UNIFORM, 0, 256);
+    rng.fill(previous, cv::RNG::UNIFORM, 0, 256);
+    rng.fill(older, cv::RNG::UNIFORM, 0, 256);
+    rng.fill(background, cv::RNG::UNIFORM, 0, 2);
+    background *= 255;
+    rng.fill(excluded, cv::RNG::UNIFORM, 0, 5);
+    excluded = (excluded == 0);
+
+    const SimdLevel original = simdLevel();
+    ASSERT_TRUE(setSimdLevel(SimdLevel::Scalar));
+    cv::Mat expectedDiff, expectedThresh;
+    MotionHistogram expectedHistogram;
+    absDiffHistogram(current, previous, older, background, excluded, expectedDiff, expectedHistogram, 2);
+    thresholdMotion(expectedDiff, background, excluded, 40, 255, expectedThresh);
+
+    for (SimdLevel level : {SimdLevel::Universal128, SimdLevel::Neon, SimdLevel::Avx2, SimdLevel::Avx512}) {
+        if (!setSimdLevel(level)) continue;
+        cv::Mat diff, thresh;
+        MotionHistogram histogram;
+        absDiffHistogram(current, previous, older, background, excluded, diff, histogram, 2);
+        thresholdMotion(diff, background, excluded, 40, 255, thresh);
+        EXPECT_EQ(cv::norm(diff, expectedDiff, cv::NORM_INF), 0.0) << simdLevelName(level);
+        EXPECT_EQ(cv::norm(thresh, expectedThresh, cv::NORM_INF), 0.0) << simdLevelName(level);
+        EXPECT_EQ(histogram, expectedHistogram) << simdLevelName(level);
+    }
+    setSimdLevel(original);
+    EXPECT_TRUE(simdLevelSupported(bestSimdLevel()));
+}
+
+// Test that hysteresis keeps a weakly moving wing attached to the strongly moving body,
+// leaves isolated weak motion out, and matches labelling the weak mask by components
+TEST(MotionMaskKernelTest, HysteresisGrowsStrongComponentsOverWeakPixels) {
+    cv::Mat diff(60, 80, CV_8UC1, cv::Scalar(0));
+    diff(cv::Rect(20, 20, 10, 10)).setTo(200);  // Body
+    diff(cv::Rect(30, 22, 12, 4)).setTo(60);    // Wing, below the threshold but touching the body
+    diff(cv::Rect(60, 40, 6, 6)).setTo(60);     // Weak blob on its own
+    cv::Mat excluded(diff.size(), CV_8UC1, cv::Scalar(0));
+    excluded(cv::Rect(40, 0, 40, 60)).setTo(255);  // Cuts the wing's tip off
+
+    cv::Mat thresh;
+    std::vector<int> stack;
+    thresholdMotion(diff, cv::Mat(), excluded, 100, 255, thresh);
+    EXPECT_EQ(cv::countNonZero(thresh), 100);
+    EXPECT_EQ(growHysteresis(diff, cv::Mat(), excluded, 50, thresh, stack), 10 * 4);
+    EXPECT_EQ(cv::countNonZero(thresh(cv::Rect(30, 22, 10, 4))), 40);
+    EXPECT_EQ(cv::countNonZero(thresh(cv::Rect(40, 0, 40, 60))), 0);
+
+    // Random data against connected components of the weak mask that hold a strong pixel
+    cv::RNG rng(11);
+    rng.fill(diff, cv::RNG::UNIFORM, 0, 120);
+    cv::GaussianBlur(diff, diff, cv::Size(5, 5), 0);
+    cv::Mat background(diff.size(), CV_8UC1);
+    rng.fill(background, cv::RNG::UNIFORM, 0, 40);
+    background = (background == 0) / 255 * 127;
+    thresholdMotion(diff, background, cv::Mat(), 70, 255, thresh);
+    growHysteresis(diff, background, cv::Mat(), 45, thresh, stack);
+
+    cv::Mat weak, labels;
+    cv::bitwise_or(diff, background, weak);
+    const int count = cv::connectedComponents(weak > 45, labels, 8, CV_32S);
+    std::vector<bool> seeded(static_cast<size_t>(count), false);
+    cv::Mat strong = weak > 70;
+    for (int y = 0; y < labels.rows; ++y) {
+        for (int x = 0; x < labels.cols; ++x) {
+            if (strong.at<uchar>(y, x)) seeded[static_cast<size_t>(labels.at<int>(y, x))] = true;
+        }
+    }
+    cv::Mat expected(diff.size(), CV_8UC1, cv::Scalar(0));
+    for (int y = 0; y < labels.rows; ++y) {
+        for (int x = 0; x < labels.cols; ++x) {
+            const int label = labels.at<int>(y, x);
+            if (label > 0 && seeded[static_cast<size_t>(label)]) expected.at<uchar>(y, x) = 255;
+        }
+    }
+    EXPECT_EQ(cv::norm(thresh, expected, cv::NORM_INF), 0.0);
+}
+
+TEST(FrameRingTest, RecyclesTheOldestBuffer) {
+    FrameRing ring(2);
+    EXPECT_TRUE(ring.at(0).empty());
+
+    cv::Mat frame(4, 4, CV_8UC1, cv::Scalar(1));
+    const uchar* first = frame.data;
+    ring.push(frame);
+    frame = cv::Mat(4, 4, CV_8UC1, cv::Scalar(2));
+    ring.push(frame);
+    EXPECT_EQ(ring.size(), 2u);
+    EXPECT_EQ(ring.at(0).at<uchar>(0, 0), 2);
+    EXPECT_EQ(ring.at(1).at<uchar>(0, 0), 1);
+
+    // Full: the third push hands back the first frame's buffer
+    frame = cv::Mat(4, 4, CV_8UC1, cv::Scalar(3));
+    ring.push(frame);
+    EXPECT_EQ(frame.data, first);
+    EXPECT_EQ(ring.at(0).at<uchar>(0, 0), 3);
+    EXPECT_EQ(ring.at(1).at<uchar>(0, 0), 2);
+    EXPECT_TRUE(ring.at(2).empty());
+
+    ring.setCapacity(1);
+    EXPECT_EQ(ring.size(), 1u);
+    EXPECT_EQ(ring.at(0).at<uchar>(0, 0), 3);
+    ring.clear();
+    EXPECT_TRUE(ring.empty());
+    EXPECT_TRUE(ring.newest().empty());
+}
+
+TEST(LogRateLimiterTest, CapsLinesAndReportsSuppressed) {
+    LogRateLimiter limiter(5.0);
+    uint64_t suppressed = 99;
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_TRUE(limiter.allow(suppressed));
+        EXPECT_EQ(suppressed, 0u);
+    }
+    for (int i = 0; i < 7; ++i) EXPECT_FALSE(limiter.allow(suppressed));
+
+    // The next window's first line carries the count of the lines turned away
+    std::this_thread::sleep_for(std::chrono::milliseconds(1050));
+    EXPECT_TRUE(limiter.allow(suppressed));
+    EXPECT_EQ(suppressed, 7u);
+
+    LogRateLimiter unlimited(0.0);
+    for (int i = 0; i < 100; ++i) EXPECT_TRUE(unlimited.allow());
+}
+
+// Test the planned morphology chain against step-by-step OpenCV calls
+TEST(MorphologyChainTest, PlannedChainMatchesOpenCv) {
+    using Op = MorphologyChain::Operation;
+    cv::RNG rng(3);
+    // Sparse noise plus blobs; odd sizes leave partial van Herk/Gil-Werman blocks
+    cv::Mat mask(101, 157, CV_8UC1);
+    rng.fill(mask, cv::RNG::UNIFORM, 0, 20);
+    mask = (mask == 0);
+    cv::circle(mask, cv::Point(40, 50), 18, cv::Scalar(255), cv::FILLED);
+    cv::rectangle(mask, cv::Rect(90, 0, 60, 30), cv::Scalar(255), cv::FILLED);
+
+    // close + open + dilate: five steps, three passes after merging
+    const std::vector<Op> steps = {Op::DILATE, Op::ERODE, Op::ERODE, Op::DILATE, Op::DILATE};
+    for (int size : {3, 7, 15}) {
+        for (bool approximate : {false, true}) {
+            const cv::Mat kernel = cv::getStructuringElement(approximate ? cv::MORPH_RECT : cv::MORPH_ELLIPSE,
+                                                             cv::Size(size, size));
+            cv::Mat expected;
+            cv::morphologyEx(mask, expected, cv::MORPH_CLOSE, kernel);
+            cv::morphologyEx(expected, expected, cv::MORPH_OPEN, kernel);
+            cv::dilate(expected, expected, kernel);
+
+            MorphologyChain chain;
+            chain.plan(steps, cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(size, size)), approximate);
+            EXPECT_EQ(chain.passCount(), 3u);
+            EXPECT_EQ(chain.radius(), 5 * (size / 2));
+
+            MorphologyChain::Workspace workspace;
+            cv::Mat actual;
+            chain.apply(mask, actual, workspace);
+            EXPECT_EQ(cv::norm(actual, expected, cv::NORM_INF), 0.0)
+                << "size " << size << (approximate ? " approximate" : " exact");
+
+            // In place gives the same result
+            cv::Mat inPlace = mask.clone();
+            chain.apply(inPlace, inPlace, workspace);
+            EXPECT_EQ(cv::norm(inPlace, expected, cv::NORM_INF), 0.0);
+        }
+    }
+}
+
+// Test the packed (1 bit per pixel) threshold, morphology and labelling against the byte path
+TEST(PackedMaskTest, ThresholdMatchesThresholdMotion) {
+    cv::RNG rng(5);
+    // 150 columns: two whole words and a partial one per row
+    cv::Mat diff(37, 150, CV_8UC1), background(37, 150, CV_8UC1), excluded(37, 150, CV_8UC1);
+    rng.fill(diff, cv::RNG::UNIFORM, 0, 256);
+    rng.fill(background, cv::RNG::UNIFORM, 0, 256);
+    background.setTo(0, background < 200);
+    rng.fill(excluded, cv::RNG::UNIFORM, 0, 8);
+    excluded = (excluded == 0);
+
+    for (int level : {-1, 0, 40, 128, 254, 255}) {
+        cv::Mat expected;
+        thresholdMotion(diff, background, excluded, level, 255, expected);
+        PackedMask packed;
+        thresholdMotionPacked(diff, background, excluded, level, packed);
+        cv::Mat actual;
+        packed.unpack(actual);
+        EXPECT_EQ(cv::norm(actual, expected, cv::NORM_INF), 0.0) << "level " << level;
+        EXPECT_EQ(packed.count(), static_cast<size_t>(cv::countNonZero(expected))) << "level " << level;
+    }
+}
+
+TEST(PackedMaskTest, PackedChainMatchesApproximateChain) {
+    using Op = MorphologyChain::Operation;
+    cv::RNG rng(3);
+    cv::Mat mask(101, 157, CV_8UC1);
+    rng.fill(mask, cv::RNG::UNIFORM, 0, 20);
+    mask = (mask == 0);
+    cv::circle(mask, cv::Point(40, 50), 18, cv::Scalar(255), cv::FILLED);
+    cv::rectangle(mask, cv::Rect(90, 0, 67, 30), cv::Scalar(255), cv::FILLED);  // Touches the right edge
+
+    const std::vector<Op> steps = {Op::DILATE, Op::ERODE, Op::ERODE, Op::DILATE, Op::DILATE};
+    for (int size : {3, 7, 15, 41}) {
+        MorphologyChain chain;
+        chain.plan(steps, cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(size, size)), true);
+        MorphologyChain::Workspace workspace;
+        cv::Mat expected;
+        chain.apply(mask, expected, workspace);
+
+        PackedMask packed;
+        packed.pack(mask);
+        PackedMask::Scratch scratch;
+        chain.applyPacked(packed, packed, scratch);
+        cv::Mat actual;
+        packed.unpack(actual);
+        EXPECT_EQ(cv::norm(actual, expected, cv::NORM_INF), 0.0) << "size " << size;
+    }
+}
+
+TEST(PackedMaskTest, RunLabelerMatchesConnectedComponents) {
+    cv::RNG rng(9);
+    cv::Mat mask(90, 200, CV_8UC1);
+    rng.fill(mask, cv::RNG::UNIFORM, 0, 6);
+    mask = (mask == 0);
+    cv::circle(mask, cv::Point(60, 45), 20, cv::Scalar(255), 2);  // A ring: one component
+    cv::rectangle(mask, cv::Rect(120, 10, 70, 40), cv::Scalar(255), cv::FILLED);  // Across a word boundary
+
+    cv::Mat labels, stats, centroids;
+    const int labelCount = cv::connectedComponentsWithStats(mask, labels, stats, centroids, 8, CV_32S);
+    PackedMask packed;
+    packed.pack(mask);
+    RunLabeler labeler;
+    ASSERT_EQ(labeler.label(packed), labelCount - 1);
+
+    // Same order (first pixel in raster order), boxes and pixel counts
+    for (int label = 1; label < labelCount; ++label) {
+        const RunLabeler::Component& component = labeler.components()[label - 1];
+        EXPECT_EQ(component.bounds, cv::Rect(stats.at<int>(label, cv::CC_STAT_LEFT), stats.at<int>(label, cv::CC_STAT_TOP),
+                                             stats.at<int>(label, cv::CC_STAT_WIDTH),
+                                             stats.at<int>(label, cv::CC_STAT_HEIGHT)));
+        EXPECT_EQ(component.pixels, stats.at<int>(label, cv::CC_STAT_AREA));
+    }
+    const int square = labels.at<int>(30, 150) - 1;
+    EXPECT_NEAR(labeler.solidity(square), 1.0, 1e-9);
+}
+
+TEST(RleMaskTest, EncodesDecodesAndMeasuresTheRuns) {
+    cv::RNG rng(13);
+    cv::Mat mask(60, 150, CV_8UC1);
+    rng.fill(mask, cv::RNG::UNIFORM, 0, 8);
+    mask = (mask == 0);
+    cv::rectangle(mask, cv::Rect(100, 20, 50, 30), cv::Scalar(255), cv::FILLED);  // Runs through the row ends
+
+    RleMask rle;
+    rle.assign(mask);
+    RleMask fromPacked;
+    PackedMask packed;
+    packed.pack(mask);
+    fromPacked.assign(packed);
+    EXPECT_EQ(fromPacked.runs().size(), rle.runs().size());
+    EXPECT_EQ(fromPacked.encode(), rle.encode());
+
+    RleMask decoded;
+    ASSERT_TRUE(decoded.decode(mask.size(), rle.encode()));
+    cv::Mat unpacked;
+    decoded.unpack(unpacked);
+    EXPECT_EQ(cv::countNonZero(unpacked != mask), 0);
+
+    const RleMask::Stats stats = rle.stats();
+    const cv::Moments moments = cv::moments(mask, true);
+    EXPECT_EQ(stats.area, cv::countNonZero(mask));
+    EXPECT_EQ(stats.bounds, cv::boundingRect(mask));
+    EXPECT_NEAR(stats.centroid.x, moments.m10 / moments.m00 + 0.5, 1e-9);
+    EXPECT_NEAR(stats.centroid.y, moments.m01 / moments.m00 + 0.5, 1e-9);
+
+    // A half-resolution grid of a 300x120 crop at (20, 10)
+    rle.setFrameArea(cv::Rect(20, 10, 300, 120));
+    EXPECT_EQ(rle.toFrame(cv::Rect(100, 20, 50, 30)), cv::Rect(220, 50, 100, 60));
+
+    // An empty grid is one unset length; text that does not cover the grid is rejected
+    RleMask empty;
+    empty.assign(cv::Mat::zeros(48, 64, CV_8UC1));
+    EXPECT_EQ(empty.encode(), "PP3");
+    EXPECT_FALSE(decoded.decode(cv::Size(64, 47), "PP3"));
+    EXPECT_TRUE(decoded.empty());
+    EXPECT_FALSE(decoded.decode(cv::Size(64, 48), "PP"));
+}
+
+TEST(EdgePreservingFilterTest, SmoothsNoiseAndKeepsEdges) {
+    using Method = EdgePreservingFilter::Method;
+    // Noisy step edge: 60 left of column 60, 180 from it
+    cv::Mat image(120, 120, CV_8UC1, cv::Scalar(60));
+    image.colRange(60, 120).setTo(cv::Scalar(180));
+    cv::Mat noise(image.size(), CV_16SC1);
+    cv::RNG rng(11);
+    rng.fill(noise, cv::RNG::NORMAL, 0, 6);
+    cv::Mat noisy;
+    cv::add(image, noise, noisy, cv::noArray(), CV_8U);
+
+    cv::Scalar noiseMean, noiseStd;
+    cv::meanStdDev(noisy(cv::Rect(10, 10, 30, 100)), noiseMean, noiseStd);
+    for (const auto& [method, subsample] : {std::make_pair(Method::GUIDED, 1), std::make_pair(Method::GUIDED, 2),
+                                            std::make_pair(Method::DOMAIN_TRANSFORM, 1)}) {
+        const EdgePreservingFilter filter(method, 7, 20.0, subsample);
+        EdgePreservingFilter::Workspace workspace;
+        cv::Mat filtered;
+        filter.apply(noisy, filtered, workspace);
+        ASSERT_EQ(filtered.type(), CV_8UC1);
+        const std::string name = method == Method::GUIDED ? "guided/" + std::to_string(subsample) : "domain_transform";
+
+        cv::Scalar mean, stddev;
+        cv::meanStdDev(filtered(cv::Rect(10, 10, 30, 100)), mean, stddev);
+        EXPECT_LT(stddev[0], 0.7 * noiseStd[0]) << name;
+        // Two and three columns from the step the sides still hold their levels
+        EXPECT_LT(cv::mean(filtered.col(57))[0], 80.0) << name;
+        EXPECT_GT(cv::mean(filtered.col(62))[0], 160.0) << name;
+
+        // In place gives the same result
+        cv::Mat inPlace = noisy.clone();
+        filter.apply(inPlace, inPlace, workspace);
+        EXPECT_EQ(cv::norm(inPlace, filtered, cv::NORM_INF), 0.0) << name;
+    }
+}
+
+TEST(ContourFilterTest, RunsCheapTestsBeforeTheHull) {
+    // A speck, a long thin bar, a hollow U and a solid square
+    cv::Mat mask = cv::Mat::zeros(200, 300, CV_8UC1);
+    cv::rectangle(mask, cv::Rect(5, 5, 3, 3), cv::Scalar(255), cv::FILLED);
+    cv::rectangle(mask, cv::Rect(20, 180, 200, 6), cv::Scalar(255), cv::FILLED);
+    cv::rectangle(mask, cv::Rect(40, 40, 10, 60), cv::Scalar(255), cv::FILLED);
+    cv::rectangle(mask, cv::Rect(90, 40, 10, 60), cv::Scalar(255), cv::FILLED);
+    cv::rectangle(mask, cv::Rect(40, 90, 60, 10), cv::Scalar(255), cv::FILLED);
+    cv::rectangle(mask, cv::Rect(200, 40, 30, 30), cv::Scalar(255), cv::FILLED);
+    std::vector<std::vector<cv::Point>> contours;
+    cv::findContours(mask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+    ASSERT_EQ(contours.size(), 4u);
+
+    ContourFilter::Settings settings;
+    settings.approximation = true;
+    ContourFilter filter(settings);
+    for (int frame = 0; frame < 2; ++frame) {  // The second frame reuses the scratch vectors
+        filter.begin({50.0, 0.6, 5.0});
+        std::vector<cv::Rect> accepted;
+        ContourFilter::Candidate candidate;
+        for (const auto& contour : contours) {
+            if (filter.evaluate(contour, 1.0, candidate) == ContourFilter::Verdict::ACCEPTED) {
+                accepted.push_back(candidate.bounds);
+                EXPECT_NEAR(candidate.solidity, 1.0, 1e-9);
+            }
+        }
+        ASSERT_EQ(accepted.size(), 1u);
+        EXPECT_EQ(accepted[0], cv::Rect(200, 40, 30, 30));
+
+        // One rejection per filter, and only the U and the square needed a hull
+        const ContourFilter::Counts& counts = filter.counts();
+        EXPECT_EQ(counts.candidates, 4);
+        EXPECT_EQ(counts.rejectedArea, 1);
+        EXPECT_EQ(counts.rejectedAspectRatio, 1);
+        EXPECT_EQ(counts.rejectedSolidity, 1);
+        EXPECT_EQ(counts.accepted, 1);
+        EXPECT_EQ(counts.solidityChecks, 2);
+    }
+
+    // With the shape filters off only the area filter rejects, and the hull is still measured
+    settings.shapeFilters = false;
+    ContourFilter areaOnly(settings);
+    areaOnly.begin({50.0, 0.6, 5.0});
+    ContourFilter::Candidate candidate;
+    for (const auto& contour : contours) areaOnly.evaluate(contour, 1.0, candidate);
+    EXPECT_EQ(areaOnly.counts().accepted, 3);
+    EXPECT_EQ(areaOnly.counts().solidityChecks, 3);
+}
+
+TEST(CachedClaheTest, MatchesOpenCvAndRefitsWhenDue) {
+    cv::RNG rng(9);
+    for (const cv::Size& size : {cv::Size(128, 96), cv::Size(133, 101)}) {
+        // A gradient with noise: every tile has its own histogram
+        cv::Mat image(size, CV_8UC1);
+        for (int y = 0; y < size.height; ++y) {
+            for (int x = 0; x < size.width; ++x) image.at<uchar>(y, x) = cv::saturate_cast<uchar>(40 + x + y / 2);
+        }
+        cv::Mat noise(size, CV_8UC1);
+        rng.fill(noise, cv::RNG::UNIFORM, 0, 24);
+        image += noise;
+
+        cv::Mat expected;
+        cv::createCLAHE(2.0, cv::Size(8, 8))->apply(image, expected);
+        CachedClahe cached(2.0, 8, 1.0, 5, 8.0);
+        cv::Mat actual;
+        EXPECT_TRUE(cached.apply(image, actual));
+        EXPECT_LE(cv::norm(actual, expected, cv::NORM_INF), 1.0) << size;
+
+        // Refits every 5 frames, and as soon as the brightness drifts
+        int fits = 0;
+        for (int frame = 1; frame <= 10; ++frame) fits += cached.apply(image, actual) ? 1 : 0;
+        EXPECT_EQ(fits, 2);
+        cv::Mat brighter = image + cv::Scalar(20);
+        EXPECT_TRUE(cached.apply(brighter, actual));
+        EXPECT_FALSE(cached.apply(brighter, actual));
+        EXPECT_EQ(cached.fitCount(), 4u);
+    }
+}
+
+TEST_F(MotionProcessorTest, CachedClaheTracksFullClahe) {
+    cv::Mat gray = cv::imread(testImage1Path, cv::IMREAD_GRAYSCALE);
+    ASSERT_FALSE(gray.empty());
+    cv::Mat expected;
+    cv::createCLAHE(2.0, cv::Size(8, 8))->apply(gray, expected);
+    // Tables fitted at half resolution: close to the full pass, not identical
+    CachedClahe cached(2.0, 8, 0.5, 30, 8.0);
+    cv::Mat actual;
+    cached.apply(gray, actual);
+    cv::Mat difference;
+    cv::absdiff(actual, expected, difference);
+    std::cout << "Cached CLAHE mean difference: " << cv::mean(difference)[0] << std::endl;
+    EXPECT_LT(cv::mean(difference)[0], 8.0);
+}
+
+TEST(StackBlurTest, MatchesExactTriangleFilter) {
+    cv::RNG rng(5);
+    cv::Mat bgr(41, 67, CV_8UC3);
+    rng.fill(bgr, cv::RNG::UNIFORM, 0, 256);
+    cv::Mat gray;
+    cv::cvtColor(bgr, gray, cv::COLOR_BGR2GRAY);
+    EXPECT_EQ(StackBlur::radiusForGaussian(5), 2);
+    EXPECT_EQ(StackBlur::radiusForGaussian(11), 4);
+
+    for (int radius : {1, 2, 4, 9}) {
+        // Reference: the separable triangle in double precision, rounded once
+        cv::Mat triangle(1, 2 * radius + 1, CV_64F);
+        for (int k = -radius; k <= radius; ++k) triangle.at<double>(k + radius) = radius + 1 - std::abs(k);
+        triangle /= cv::sum(triangle)[0];
+        cv::Mat expected;
+        cv::sepFilter2D(gray, expected, CV_64F, triangle, triangle, cv::Point(-1, -1), 0, cv::BORDER_REFLECT_101);
+        expected.convertTo(expected, CV_8U);
+
+        const StackBlur blur(radius);
+        StackBlur::Workspace workspace;
+        cv::Mat actual;
+        blur.apply(gray, actual, workspace);
+        // Exact ties round up here and to even in the reference
+        EXPECT_LE(cv::norm(actual, expected, cv::NORM_INF), 1.0) << "radius " << radius;
+
+        // Fused luma, in place and a band with radius halo rows all give the same pixels
+        cv::Mat fused;
+        blur.apply(bgr, fused, workspace, true);
+        ASSERT_EQ(fused.type(), CV_8UC1);
+        EXPECT_EQ(cv::norm(fused, actual, cv::NORM_INF), 0.0) << "radius " << radius;
+        cv::Mat inPlace = gray.clone();
+        blur.apply(inPlace, inPlace, workspace);
+        EXPECT_EQ(cv::norm(inPlace, actual, cv::NORM_INF), 0.0) << "radius " << radius;
+        const cv::Range rows(15, 25);
+        cv::Mat band;
+        blur.apply(gray.rowRange(rows.start - radius, rows.end + radius), band, workspace);
+        EXPECT_EQ(cv::norm(band.rowRange(radius, radius + rows.size()), actual.rowRange(rows), cv::NORM_INF), 0.0);
+    }
+}
+
+// Test the size-specialized blur and morphology instances against the OpenCV filters
+TEST(FixedSizeFiltersTest, MatchOpenCvFilters) {
+    cv::RNG rng(9);
+    // 157 columns: whole 16-pixel steps and a scalar tail
+    cv::Mat gray(43, 157, CV_8UC1);
+    rng.fill(gray, cv::RNG::UNIFORM, 0, 256);
+
+    EXPECT_FALSE(FixedGaussianBlur().plan(13));
+    for (int size : {3, 5, 7, 9, 11}) {
+        FixedGaussianBlur blur;
+        ASSERT_TRUE(blur.plan(size));
+        cv::Mat expected;
+        cv::GaussianBlur(gray, expected, cv::Size(size, size), 0);
+        FixedGaussianBlur::Workspace workspace;
+        cv::Mat actual;
+        ASSERT_TRUE(blur.apply(gray, actual, workspace));
+        // Exact taps up to 7; 9 and 11 may round a tap differently
+        EXPECT_LE(cv::norm(actual, expected, cv::NORM_INF), size <= 7 ? 0.0 : 1.0) << "size " << size;
+
+        cv::Mat inPlace = gray.clone();
+        ASSERT_TRUE(blur.apply(inPlace, inPlace, workspace));
+        EXPECT_EQ(cv::norm(inPlace, actual, cv::NORM_INF), 0.0) << "size " << size;
+        // Too small for the reflected border: the caller's OpenCV fallback runs
+        EXPECT_FALSE(blur.apply(gray(cv::Rect(0, 0, size / 2, 8)).clone(), actual, workspace));
+    }
+
+    cv::Mat mask(43, 157, CV_8UC1);
+    rng.fill(mask, cv::RNG::UNIFORM, 0, 6);
+    mask = (mask != 0);
+    cv::circle(mask, cv::Point(100, 20), 9, cv::Scalar(0), cv::FILLED);
+    const cv::Mat inverted = ~mask;
+    for (int size : {3, 5, 7}) {
+        for (int shape : {cv::MORPH_RECT, cv::MORPH_CROSS, cv::MORPH_ELLIPSE}) {
+            const cv::Mat kernel = cv::getStructuringElement(shape, cv::Size(size, size));
+            FixedMorphology morphology;
+            ASSERT_TRUE(morphology.plan(kernel));
+            FixedMorphology::Workspace workspace;
+            for (bool dilate : {false, true}) {
+                cv::Mat expected;
+                if (dilate) {
+                    cv::dilate(inverted, expected, kernel, cv::Point(-1, -1), 2);
+                } else {
+                    cv::erode(mask, expected, kernel, cv::Point(-1, -1), 2);
+                }
+                cv::Mat actual = (dilate ? inverted : mask).clone();
+                morphology.apply(dilate, actual, actual, 2, workspace);
+                EXPECT_EQ(cv::norm(actual, expected, cv::NORM_INF), 0.0)
+                    << "size " << size << " shape " << shape << (dilate ? " dilate" : " erode");
+            }
+        }
+    }
+    // Rows that are not one centred run, and other sides, stay on OpenCV
+    EXPECT_FALSE(FixedMorphology().plan((cv::Mat_<uchar>(3, 3) << 1, 0, 1, 1, 1, 1, 1, 0, 1)));
+    EXPECT_FALSE(FixedMorphology().plan(cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(9, 9))));
+}
+
+// The fast blurs stand in for bilateral: on the test image their output must be closer
+// to the bilateral result than the unfiltered frame is
+TEST_F(MotionProcessorTest, FastEdgePreservingBlursTrackBilateral) {
+    cv::Mat frame = cv::imread(testImage1Path);
+    ASSERT_FALSE(frame.empty());
+    MotionProcessor processor(configPath);
+    const std::string blurPath = outputDir + "/blur_config.yaml";
+    auto preprocessWith = [&](const std::string& blurType) {
+        {
+            std::ofstream out(blurPath);
+            out << "blur_type: \"" << blurType << "\"\n";
+        }
+        processor.reloadConfig(blurPath);
+        return processor.preprocessFrame(frame);
+    };
+    const cv::Mat unfiltered = preprocessWith("none");
+    const cv::Mat bilateral = preprocessWith("bilateral");
+    ASSERT_EQ(processor.getBlurType(), MotionProcessor::BlurType::BILATERAL);
+    const double baseline = cv::PSNR(unfiltered, bilateral);
+
+    for (const std::string blurType : {"guided", "domain_transform"}) {
+        const cv::Mat blurred = preprocessWith(blurType);
+        ASSERT_EQ(blurred.size(), bilateral.size());
+        const double psnr = cv::PSNR(blurred, bilateral);
+        std::cout << blurType << " PSNR against bilateral: " << psnr << " dB (unfiltered " << baseline << " dB)"
+                  << std::endl;
+        EXPECT_GT(psnr, baseline) << blurType;
+    }
+}
+
+// Test that the cached threshold matches Otsu when refreshed and honours the floor
+TEST_F(MotionProcessorTest, CachedMotionThreshold) {
+    cv::Mat frame1 = cv::imread(testImage1Path);
+    cv::Mat frame2 = cv::imread(testImage2Path);
+    ASSERT_FALSE(frame1.empty()) << "Failed to load " << testImage1Path;
+    ASSERT_FALSE(frame2.empty()) << "Failed to load " << testImage2Path;
+
+    motionProcessor->enableVisualization(false);
+    motionProcessor->processFrame(frame1);
+    MotionProcessor::ProcessingResult expected = motionProcessor->processFrame(frame2);
+    const int otsuLevel = motionProcessor->getLastMotionThreshold();
+
+    const std::string cachedPath = outputDir + "/cached_threshold_config.yaml";
+    {
+        std::ofstream out(cachedPath);
+        out << "threshold_mode: \"cached\"\n"
+            << "otsu_update_interval: 100\n"
+            << "otsu_drift_limit: 2.0\n";  // Never refresh early
+    }
+    MotionProcessor cachedProcessor(configPath);
+    cachedProcessor.reloadConfig(cachedPath);
+    ASSERT_EQ(cachedProcessor.getThresholdMode(), MotionProcessor::ThresholdMode::CACHED);
+
+    // The first differenced frame computes Otsu's value exactly
+    cachedProcessor.processFrame(frame1);
+    MotionProcessor::ProcessingResult first = cachedProcessor.processFrame(frame2);
+    EXPECT_EQ(cachedProcessor.getLastMotionThreshold(), otsuLevel);
+    EXPECT_EQ(first.detectedBounds, expected.detectedBounds);
+
+    // Later frames reuse it even though their own Otsu value differs
+    cachedProcessor.processFrame(frame2);
+    EXPECT_EQ(cachedProcessor.getLastMotionThreshold(), otsuLevel);
+
+    // The floor keeps a still scene from thresholding at the noise level
+    const std::string floorPath = outputDir + "/min_threshold_config.yaml";
+    {
+        std::ofstream out(floorPath);
+        out << "min_motion_threshold: 255\n";
+    }
+    motionProcessor->reloadConfig(floorPath);
+    MotionProcessor::ProcessingResult still = motionProcessor->processFrame(frame2);
+    EXPECT_EQ(motionProcessor->getLastMotionThreshold(), 255);
+    EXPECT_EQ(cv::countNonZero(still.thresh), 0);
+    EXPECT_FALSE(still.hasMotion);
+}
+
+TEST_F(MotionProcessorTest, OpenClBackendMatchesCpu) {
+    cv::Mat frame1 = cv::imread(testImage1Path);
+    cv::Mat frame2 = cv::imread(testImage2Path);
+    ASSERT_FALSE(frame1.empty()) << "Failed to load " << testImage1Path;
+    ASSERT_FALSE(frame2.empty()) << "Failed to load " << testImage2Path;
+
+    const std::string cpuPath = outputDir + "/cpu_backend_config.yaml";
+    const std::string openclPath = outputDir + "/opencl_backend_config.yaml";
+    for (const auto& [path, backend] : {std::make_pair(cpuPath, "cpu"), std::make_pair(openclPath, "opencl")}) {
+        std::ofstream out(path);
+        out << "compute_backend: \"" << backend << "\"\n"
+            << "blur_type: \"gaussian\"\n"
+            << "background_subtraction: false\n"
+            << "morph_approximate: false\n";
+    }
+    MotionProcessor cpu(configPath);
+    MotionProcessor device(configPath);
+    cpu.reloadConfig(cpuPath);
+    device.reloadConfig(openclPath);
+    // Without an OpenCL device the processor falls back to the CPU path
+    const bool haveOpenCl = cv::ocl::haveOpenCL();
+    EXPECT_EQ(device.getComputeBackend(), haveOpenCl ? MotionProcessor::ComputeBackend::OPENCL
+                                                     : MotionProcessor::ComputeBackend::CPU);
+
+    for (const cv::Mat* frame : {&frame1, &frame2, &frame1}) {
+        MotionProcessor::ProcessingResult expected = cpu.processFrame(*frame);
+        MotionProcessor::ProcessingResult actual = device.processFrame(*frame);
+        EXPECT_EQ(actual.hasMotion, expected.hasMotion);
+        ASSERT_EQ(actual.morphological.empty(), expected.morphological.empty());
+        if (!expected.morphological.empty()) {
+            // OpenCL kernels may round blur edges differently; the masks must still agree
+            const double mismatch = cv::norm(actual.morphological, expected.morphological, cv::NORM_L1) /
+                                    (255.0 * expected.morphological.total());
+            EXPECT_LT(mismatch, 0.01);
+            EXPECT_NEAR(device.getLastMotionThreshold(), cpu.getLastMotionThreshold(), 2);
+        }
+    }
+}
+
+TEST_F(MotionProcessorTest, EveryBackgroundModelDetectsMotion) {
+    cv::Mat frame1 = cv::imread(testImage1Path);
+    cv::Mat frame2 = cv::imread(testImage2Path);
+    ASSERT_FALSE(frame1.empty()) << "Failed to load " << testImage1Path;
+    ASSERT_FALSE(frame2.empty()) << "Failed to load " << testImage2Path;
+
+    const std::vector<std::pair<std::string, MotionProcessor::BackgroundModel>> models = {
+        {"mog2", MotionProcessor::BackgroundModel::MOG2},
+        {"knn", MotionProcessor::BackgroundModel::KNN},
+        {"running_average", MotionProcessor::BackgroundModel::RUNNING_AVERAGE},
+        {"median", MotionProcessor::BackgroundModel::MEDIAN},
+    };
+    for (const auto& [name, model] : models) {
+        // Full-rate model, then one learning every other frame at half resolution
+        for (const std::string update : {"", "background_update_interval: 2\nbackground_update_scale: 0.5\n"}) {
+            SCOPED_TRACE(name + (update.empty() ? "" : " (reduced updates)"));
+            const std::string path = outputDir + "/background_model_config.yaml";
+            {
+                std::ofstream out(path);
+                out << "background_subtraction: true\n"
+                    << "background_model: \"" << name << "\"\n"
+                    << "background_snapshot_dir: \"\"\n"
+                    << update;
+            }
+            MotionProcessor processor(configPath);
+            processor.reloadConfig(path);
+            EXPECT_EQ(processor.getBackgroundModel(), model);
+
+            processor.processFrame(frame1);
+            MotionProcessor::ProcessingResult result = processor.processFrame(frame2);
+            EXPECT_TRUE(result.hasMotion);
+            EXPECT_FALSE(result.morphological.empty());
+        }
+    }
+}
+
+TEST_F(MotionProcessorTest, ThreeFrameDifferencingDropsGhosts) {
+    // A square jumping right by its own width: t-2 at x=40, t-1 at x=100, t at x=160
+    std::vector<cv::Mat> frames;
+    for (int x : {40, 100, 160}) {
+        cv::Mat frame(240, 320, CV_8UC3, cv::Scalar(100, 100, 100));
+        cv::rectangle(frame, cv::Rect(x, 105, 30, 30), cv::Scalar(250, 250, 250), cv::FILLED);
+        frames.push_back(frame);
+    }
+    const cv::Point ghost(115, 120);    // Where the square was at t-1
+    const cv::Point current(175, 120);  // Where it is at t
+
+    for (const std::string mode : {"two_frame", "three_frame"}) {
+        SCOPED_TRACE(mode);
+        const std::string path = outputDir + "/differencing_config.yaml";
+        {
+            std::ofstream out(path);
+            out << "frame_differencing: \"" << mode << "\"\n"
+                << "background_subtraction: false\n"
+                << "motion_gate: false\n";
+        }
+        for (const bool reuse : {false, true}) {
+            MotionProcessor processor(configPath);
+            processor.enableVisualization(false);
+            processor.reloadConfig(path);
+            processor.setBufferReuse(reuse);
+            MotionProcessor::ProcessingResult result;
+            for (const cv::Mat& frame : frames) result = processor.processFrame(frame);
+
+            ASSERT_FALSE(result.thresh.empty());
+            EXPECT_EQ(result.thresh.at<uchar>(current), 255);
+            EXPECT_EQ(result.thresh.at<uchar>(ghost), mode == "two_frame" ? 255 : 0);
+        }
+    }
+}
+
+TEST_F(MotionProcessorTest, TiledProcessingIsBitIdentical) {
+    cv::Mat frame1 = cv::imread(testImage1Path);
+    cv::Mat frame2 = cv::imread(testImage2Path);
+    ASSERT_FALSE(frame1.empty()) << "Failed to load " << testImage1Path;
+    ASSERT_FALSE(frame2.empty()) << "Failed to load " << testImage2Path;
+    // A row count that is not a multiple of the band alignment
+    const cv::Rect crop(0, 0, frame1.cols, frame1.rows - 3);
+    frame1 = frame1(crop).clone();
+    frame2 = frame2(crop).clone();
+
+    for (const std::string blur : {"gaussian", "median", "bilateral"}) {
+        for (const std::string mode : {"otsu", "cached"}) {
+            const std::string untiledPath = outputDir + "/untiled_config.yaml";
+            const std::string tiledPath = outputDir + "/tiled_config.yaml";
+            for (const auto& [path, bands] : {std::make_pair(untiledPath, 1), std::make_pair(tiledPath, 5)}) {
+                std::ofstream out(path);
+                out << "blur_type: \"" << blur << "\"\n"
+                    << "threshold_mode: \"" << mode << "\"\n"
+                    << "bilateral_d: 9\n"
+                    << "morph_approximate: " << (mode == "cached" ? "true" : "false") << "\n"
+                    << "tile_bands: " << bands << "\n";
+            }
+            MotionProcessor untiled(configPath);
+            MotionProcessor tiled(configPath);
+            untiled.reloadConfig(untiledPath);
+            tiled.reloadConfig(tiledPath);
+            ASSERT_EQ(tiled.getTileBands(), 5);
+
+            for (const cv::Mat* frame : {&frame1, &frame2, &frame1}) {
+                MotionProcessor::ProcessingResult expected = untiled.processFrame(*frame);
+                MotionProcessor::ProcessingResult actual = tiled.processFrame(*frame);
+                const std::string label = blur + "/" + mode;
+                EXPECT_EQ(cv::norm(actual.processedFrame, expected.processedFrame, cv::NORM_INF), 0) << label;
+                if (!expected.thresh.empty()) {
+                    EXPECT_EQ(cv::norm(actual.frameDiff, expected.frameDiff, cv::NORM_INF), 0) << label;
+                    EXPECT_EQ(cv::norm(actual.thresh, expected.thresh, cv::NORM_INF), 0) << label;
+                    EXPECT_EQ(cv::norm(actual.morphological, expected.morphological, cv::NORM_INF), 0) << label;
+                }
+                EXPECT_EQ(actual.detectedBounds, expected.detectedBounds) << label;
+                EXPECT_EQ(tiled.getLastMotionThreshold(), untiled.getLastMotionThreshold()) << label;
+            }
+        }
+    }
+}
+
+TEST(TileOccupancyTest, WindowsKeepRegionsTogether) {
+    cv::Mat mask = cv::Mat::zeros(100, 130, CV_8UC1);
+    mask.at<uchar>(5, 5) = 1;                                        // Tile (0, 0), any nonzero value
+    cv::rectangle(mask, cv::Rect(60, 60, 8, 8), cv::Scalar(255), cv::FILLED);  // Tiles (3..4, 3..4)
+    mask.at<uchar>(99, 129) = 255;                                   // Partial corner tile (8, 6)
+
+    TileOccupancy occupancy;
+    occupancy.scan(mask, 16);
+    ASSERT_EQ(occupancy.tileColumns(), 9);
+    ASSERT_EQ(occupancy.tileRows(), 7);
+    EXPECT_EQ(occupancy.occupiedCount(), 6);
+    EXPECT_TRUE(occupancy.occupied(0, 0));
+    EXPECT_TRUE(occupancy.occupied(4, 4));
+    EXPECT_TRUE(occupancy.occupied(8, 6));
+    EXPECT_FALSE(occupancy.occupied(2, 2));
+
+    // Without a halo the square's four tiles form one window
+    std::vector<cv::Rect> windows = occupancy.windows(0);
+    auto byPosition = [](const cv::Rect& a, const cv::Rect& b) { return a.x < b.x; };
+    std::sort(windows.begin(), windows.end(), byPosition);
+    ASSERT_EQ(windows.size(), 3u);
+    EXPECT_EQ(windows[0], cv::Rect(0, 0, 16, 16));
+    EXPECT_EQ(windows[1], cv::Rect(48, 48, 32, 32));
+    EXPECT_EQ(windows[2], cv::Rect(128, 96, 2, 4));
+    EXPECT_EQ(occupancy.windowArea(), 16 * 16 + 32 * 32 + 2 * 4);
+
+    // A halo that makes grown tiles touch merges them; windows stay clipped to the mask
+    windows = occupancy.windows(16);
+    std::sort(windows.begin(), windows.end(), byPosition);
+    ASSERT_EQ(windows.size(), 2u);
+    EXPECT_EQ(windows[0], cv::Rect(0, 0, 96, 96));
+    EXPECT_EQ(windows[1], cv::Rect(112, 80, 18, 20));
+
+    EXPECT_TRUE(anyNonZero(mask.ptr<uchar>(99), mask.cols));
+    EXPECT_FALSE(anyNonZero(mask.ptr<uchar>(98), mask.cols));
+}
+
+// Occupancy windows skip the empty mask, yet give the whole-mask morphology and boxes
+TEST_F(MotionProcessorTest, OccupancyTilesMatchWholeMask) {
+    cv::Mat frame1(480, 640, CV_8UC3, cv::Scalar::all(20));
+    cv::Mat frame2 = frame1.clone();
+    frame2(cv::Rect(301, 203, 42, 30)).setTo(cv::Scalar::all(230));
+    frame2(cv::Rect(101, 351, 38, 26)).setTo(cv::Scalar::all(200));
+    // Two wings a few pixels apart across a tile edge: morphology joins them
+    frame2(cv::Rect(500, 50, 28, 20)).setTo(cv::Scalar::all(220));
+    frame2(cv::Rect(531, 50, 28, 20)).setTo(cv::Scalar::all(220));
+    // Motion over most of the frame: too dense for windows
+    cv::Mat frame3(480, 640, CV_8UC3, cv::Scalar::all(20));
+    frame3(cv::Rect(0, 0, 600, 400)).setTo(cv::Scalar::all(220));
+
+    for (const std::string extraction : {"contours", "components"}) {
+        const std::string wholePath = outputDir + "/whole_mask_config.yaml";
+        const std::string occupancyPath = outputDir + "/occupancy_config.yaml";
+        for (const auto& [path, tileSize] : {std::make_pair(wholePath, 0), std::make_pair(occupancyPath, 32)}) {
+            std::ofstream out(path);
+            out << "contour_detection_mode: \"permissive\"\n"
+                << "contour_extraction: \"" << extraction << "\"\n"
+                << "occupancy_tile_size: " << tileSize << "\n";
+        }
+        MotionProcessor whole(configPath);
+        MotionProcessor occupied(configPath);
+        whole.reloadConfig(wholePath);
+        occupied.reloadConfig(occupancyPath);
+        ASSERT_EQ(occupied.getOccupancyTileSize(), 32);
+
+        for (const cv::Mat* frame : {&frame1, &frame2, &frame1, &frame3}) {
+            MotionProcessor::ProcessingResult expected = whole.processFrame(*frame);
+            MotionProcessor::ProcessingResult actual = occupied.processFrame(*frame);
+            if (expected.thresh.empty()) continue;
+            EXPECT_EQ(cv::norm(actual.morphological, expected.morphological, cv::NORM_INF), 0) << extraction;
+            auto byPosition = [](const cv::Rect& a, const cv::Rect& b) {
+                return std::tie(a.x, a.y) < std::tie(b.x, b.y);
+            };
+            std::sort(expected.detectedBounds.begin(), expected.detectedBounds.end(), byPosition);
+            std::sort(actual.detectedBounds.begin(), actual.detectedBounds.end(), byPosition);
+            EXPECT_EQ(actual.detectedBounds, expected.detectedBounds) << extraction;
+            EXPECT_EQ(actual.extraction.candidates, expected.extraction.candidates) << extraction;
+            if (frame == &frame3) {
+                EXPECT_DOUBLE_EQ(actual.extraction.maskCoverage, 1.0) << extraction;
+            } else {
+                EXPECT_LT(actual.extraction.maskCoverage, 0.3) << extraction;
+            }
+        }
+    }
+}
+
+TEST(BlockMotionMapTest, MeanDifferencePerBlock) {
+    BlockMotionMap blocks(16, 32);
+    EXPECT_EQ(blocks.shift(), 5);
+    cv::Mat background(40, 70, CV_8UC1, cv::Scalar(50));
+    EXPECT_FALSE(blocks.apply(background));  // Seeds the background
+    EXPECT_EQ(blocks.map().size(), cv::Size(5, 3));
+    EXPECT_EQ(cv::countNonZero(blocks.map()), 0);
+
+    cv::Mat frame = background.clone();
+    frame(cv::Rect(16, 0, 16, 16)).setTo(cv::Scalar(90));  // One whole block: mean 40
+    frame(cv::Rect(32, 16, 8, 16)).setTo(cv::Scalar(70));  // Half a block: mean 10
+    frame(cv::Rect(64, 32, 6, 8)).setTo(cv::Scalar(250));  // The whole partial corner block
+    ASSERT_TRUE(blocks.apply(frame));
+    const cv::Mat& map = blocks.map();
+    EXPECT_EQ(map.at<uchar>(0, 1), 40);
+    EXPECT_EQ(map.at<uchar>(1, 2), 10);
+    EXPECT_EQ(map.at<uchar>(2, 4), 200);
+    EXPECT_EQ(cv::countNonZero(map), 3);
+
+    // The background moved 1/32 of the way: 90 is now 40 - 40/32 = 38.75 levels away
+    ASSERT_TRUE(blocks.apply(frame));
+    EXPECT_EQ(blocks.map().at<uchar>(0, 1), 39);
+    cv::Mat learned;
+    blocks.backgroundImage(learned);
+    EXPECT_EQ(learned.at<uchar>(0, 20), 52);
+    EXPECT_EQ(learned.at<uchar>(0, 0), 50);
+}
+
+TEST_F(MotionProcessorTest, BlockDetectionFindsMovingBlocks) {
+    const std::string blockPath = outputDir + "/block_config.yaml";
+    {
+        std::ofstream out(blockPath);
+        out << "detection_method: \"block\"\n"
+            << "block_size: 16\n"
+            << "block_threshold: 12\n"
+            << "block_min_blocks: 2\n";
+    }
+    MotionProcessor processor(configPath);
+    processor.reloadConfig(blockPath);
+    ASSERT_EQ(processor.getDetectionMethod(), MotionProcessor::DetectionMethod::BLOCK);
+
+    cv::Mat still(480, 640, CV_8UC3, cv::Scalar::all(40));
+    processor.warmUp(still);
+    EXPECT_FALSE(processor.isFirstFrame());
+    EXPECT_FALSE(processor.processFrame(still).hasMotion);
+
+    // A bird straddling 3x3 blocks, and a speck that moves a single block
+    cv::Mat frame = still.clone();
+    frame(cv::Rect(200, 100, 40, 30)).setTo(cv::Scalar::all(220));
+    frame(cv::Rect(500, 400, 4, 4)).setTo(cv::Scalar::all(255));
+    MotionProcessor::ProcessingResult result = processor.processFrame(frame);
+    ASSERT_EQ(result.detectedBounds.size(), 1u);
+    // Blocks 12..14 x 6..8 cover the bird; block edges lie on multiples of 16
+    EXPECT_EQ(result.detectedBounds[0], cv::Rect(192, 96, 48, 48));
+    EXPECT_EQ(result.extraction.candidates, 2);
+    EXPECT_EQ(result.extraction.rejectedArea, 1);  // The speck, below block_min_blocks
+    if (!result.thresh.empty()) {
+        EXPECT_EQ(result.thresh.size(), cv::Size(40, 30));
+    }
+
+    // An exclusion zone over the bird drops its blocks
+    processor.setExclusionZones({{{190, 90}, {260, 90}, {260, 150}, {190, 150}}});
+    EXPECT_FALSE(processor.processFrame(frame).hasMotion);
+}
+
+TEST_F(MotionProcessorTest, FloodGuardSuppressesGlobalChanges) {
+    const std::string floodPath = outputDir + "/flood_guard_config.yaml";
+    {
+        std::ofstream out(floodPath);
+        out << "flood_guard: true\n"
+            << "flood_motion_fraction: 0.2\n"
+            << "flood_thumbnail_width: 160\n";
+    }
+    MotionProcessor processor(configPath);
+    processor.reloadConfig(floodPath);
+    ASSERT_TRUE(processor.isFloodGuardEnabled());
+
+    // Texture with features of a few pixels, so a camera shift changes most of the frame
+    cv::Mat noise(120, 160, CV_8UC3);
+    cv::randu(noise, cv::Scalar::all(0), cv::Scalar::all(200));
+    cv::Mat scene;
+    cv::resize(noise, scene, cv::Size(640, 480), 0, 0, cv::INTER_CUBIC);
+    processor.processFrame(scene);  // Reference
+
+    // A cloud: brightness rises by 40 to 80 across the frame, without moving anything
+    cv::Mat light(scene.size(), CV_8UC3);
+    for (int x = 0; x < light.cols; ++x) light.col(x).setTo(cv::Scalar::all(40 + 40 * x / light.cols));
+    cv::Mat lit = scene + light;
+    MotionProcessor::ProcessingResult result = processor.processFrame(lit);
+    EXPECT_EQ(result.flood, MotionProcessor::FloodKind::ILLUMINATION);
+    EXPECT_TRUE(result.detectedBounds.empty());
+    EXPECT_EQ(result.extraction.candidates, 0);  // Never reached region extraction
+    EXPECT_EQ(processor.getFloodFrameCount(), 1u);
+
+    // The mount shakes by (8, 4) pixels while a bird lands: the shift is compensated, so
+    // only the bird is detected (the lit frame is now the reference)
+    cv::Mat shaken;
+    const cv::Mat translation = (cv::Mat_<double>(2, 3) << 1, 0, 8, 0, 1, 4);
+    cv::warpAffine(lit, shaken, translation, lit.size(), cv::INTER_LINEAR, cv::BORDER_REFLECT);
+    const cv::Rect bird(300, 200, 40, 30);
+    shaken(bird).setTo(cv::Scalar::all(255));
+    result = processor.processFrame(shaken);
+    EXPECT_EQ(result.flood, MotionProcessor::FloodKind::NONE);
+    EXPECT_TRUE(result.shiftCompensated);
+    EXPECT_NEAR(result.globalShift.x, 8.0, 1.0);
+    EXPECT_NEAR(result.globalShift.y, 4.0, 1.0);
+    ASSERT_FALSE(result.detectedBounds.empty());
+    for (const cv::Rect& bounds : result.detectedBounds) {
+        EXPECT_GT((bounds & bird).area(), 0) << bounds;
+    }
+    EXPECT_EQ(processor.getFloodFrameCount(), 1u);
+    EXPECT_EQ(processor.getShiftCompensatedFrameCount(), 1u);
+}
+
+TEST_F(MotionProcessorTest, MotionGateSkipsStillFrames) {
+    const std::string gatePath = outputDir + "/motion_gate_config.yaml";
+    {
+        std::ofstream out(gatePath);
+        out << "motion_gate: true\n"
+            << "motion_gate_pixel_delta: 25\n"
+            << "motion_gate_min_pixels: 4\n";
+    }
+    motionProcessor->enableVisualization(false);
+    motionProcessor->reloadConfig(gatePath);
+
+    cv::Mat still(480, 640, CV_8UC3, cv::Scalar(40, 40, 40));
+    motionProcessor->processFrame(still);  // Reference frame is never gated
+    EXPECT_EQ(motionProcessor->getGatedFrameCount(), 0u);
+
+    // Identical frames stop at the gate before preprocessing
+    for (int i = 0; i < 3; ++i) {
+        MotionProcessor::ProcessingResult gated = motionProcessor->processFrame(still);
+        EXPECT_FALSE(gated.hasMotion);
+        EXPECT_TRUE(gated.processedFrame.empty());
+    }
+    EXPECT_EQ(motionProcessor->getGatedFrameCount(), 3u);
+
+    // A bright square covers enough sampled pixels to pass the gate
+    cv::Mat moved = still.clone();
+    cv::rectangle(moved, cv::Rect(200, 150, 96, 96), cv::Scalar(230, 230, 230), cv::FILLED);
+    MotionProcessor::ProcessingResult detected = motionProcessor->processFrame(moved);
+    EXPECT_EQ(motionProcessor->getGatedFrameCount(), 3u);
+    EXPECT_FALSE(detected.processedFrame.empty());
+    EXPECT_TRUE(detected.hasMotion);
+}
+
+TEST_F(MotionProcessorTest, RoiPredictionFollowsTheBirdAndRescansForNewMotion) {
+    const std::string predictionPath = outputDir + "/roi_prediction_config.yaml";
+    {
+        std::ofstream out(predictionPath);
+        out << "contour_detection_mode: \"permissive\"\n"
+            << "background_subtraction: false\n"
+            << "flood_guard: false\n"
+            << "roi_prediction: true\n"
+            << "roi_prediction_margin: 24\n"
+            << "roi_prediction_full_scan_interval: 100\n"
+            << "roi_prediction_trigger_samples: 8\n";
+    }
+    motionProcessor->enableVisualization(false);
+    motionProcessor->reloadConfig(predictionPath);
+    ASSERT_TRUE(motionProcessor->isRoiPredictionEnabled());
+
+    const cv::Mat empty(480, 640, CV_8UC3, cv::Scalar::all(30));
+    auto withBird = [&empty](int x) {
+        cv::Mat frame = empty.clone();
+        frame(cv::Rect(x, 200, 40, 30)).setTo(cv::Scalar::all(220));
+        return frame;
+    };
+    auto touches = [](const std::vector<cv::Rect>& boxes, const cv::Rect& target) {
+        return std::any_of(boxes.begin(), boxes.end(),
+                           [&target](const cv::Rect& box) { return !(box & target).empty(); });
+    };
+
+    motionProcessor->processFrame(empty);
+    ASSERT_TRUE(motionProcessor->processFrame(withBird(100)).hasMotion);  // No windows yet: full scan
+    EXPECT_EQ(motionProcessor->getPredictedFrameCount(), 0u);
+
+    // The bird moves 8 px per frame, inside the windows around its last box
+    for (int step = 1; step <= 4; ++step) {
+        const int x = 100 + 8 * step;
+        MotionProcessor::ProcessingResult result = motionProcessor->processFrame(withBird(x));
+        EXPECT_TRUE(touches(result.detectedBounds, cv::Rect(x, 200, 40, 30))) << "step " << step;
+        EXPECT_LT(result.extraction.maskCoverage, 0.2) << "step " << step;
+    }
+    EXPECT_EQ(motionProcessor->getPredictedFrameCount(), 4u);
+
+    // A second bird far from the windows changes enough samples to force a full scan
+    cv::Mat twoBirds = withBird(140);
+    twoBirds(cv::Rect(480, 60, 48, 40)).setTo(cv::Scalar::all(200));
+    MotionProcessor::ProcessingResult rescanned = motionProcessor->processFrame(twoBirds);
+    EXPECT_EQ(motionProcessor->getPredictedFrameCount(), 4u);
+    EXPECT_TRUE(touches(rescanned.detectedBounds, cv::Rect(480, 60, 48, 40)));
+    EXPECT_TRUE(touches(rescanned.detectedBounds, cv::Rect(140, 200, 40, 30)));
+
+    // Turning it off drops the windows: every frame is scanned whole again
+    motionProcessor->setRoiPrediction(false);
+    motionProcessor->processFrame(withBird(148));
+    EXPECT_EQ(motionProcessor->getPredictedFrameCount(), 4u);
+}
+
+TEST_F(MotionProcessorTest, DetectionsCarryTheRegionStatistics) {
+    // A 40x30 patch appears on a flat background: one region, fully solid
+    const cv::Mat empty(240, 320, CV_8UC3, cv::Scalar::all(40));
+    cv::Mat bird = empty.clone();
+    const cv::Rect patch(100, 80, 40, 30);
+    bird(patch).setTo(cv::Scalar::all(200));
+
+    for (const std::string mode : {"contours", "components", "packed"}) {
+        const std::string path = outputDir + "/detections_" + mode + "_config.yaml";
+        {
+            std::ofstream out(path);
+            out << "contour_detection_mode: \"permissive\"\n"
+                << "contour_extraction: \"" << (mode == "contours" ? "contours" : "components") << "\"\n"
+                << "background_subtraction: false\n"
+                << "morph_approximate: true\n"
+                << "flood_guard: false\n"
+                << "hysteresis_low_ratio: 0\n"
+                << "packed_masks: " << (mode == "packed" ? "true" : "false") << "\n";
+        }
+        MotionProcessor processor(configPath);
+        processor.reloadConfig(path);
+        processor.enableVisualization(false);
+        processor.setRetainedStages(MotionProcessor::STAGE_NONE);
+        processor.processFrame(empty);
+        MotionProcessor::ProcessingResult result = processor.processFrame(bird);
+
+        const Detections& detections = result.detections;
+        ASSERT_EQ(detections.size(), 1u) << mode;
+        EXPECT_EQ(detections.rects, result.detectedBounds) << mode;
+        // Morphology may round the corners or grow the patch by a few pixels
+        EXPECT_NEAR(detections.areas[0], patch.area(), 0.25 * patch.area()) << mode;
+        EXPECT_GT(detections.solidities[0], 0.9f) << mode;
+        EXPECT_NEAR(detections.centroids[0].x, 119.5f, 1.5f) << mode;
+        EXPECT_NEAR(detections.centroids[0].y, 94.5f, 1.5f) << mode;
+        // 160 gray levels inside the patch, less where the mask grew past it
+        EXPECT_GT(detections.meanDiffs[0], 100.0f) << mode;
+        EXPECT_LE(detections.meanDiffs[0], 160.5f) << mode;
+    }
+}
+
+TEST_F(MotionProcessorTest, PackedMasksMatchByteComponents) {
+    const std::string bytePath = outputDir + "/byte_components_config.yaml";
+    const std::string packedPath = outputDir + "/packed_components_config.yaml";
+    for (const std::string& path : {bytePath, packedPath}) {
+        std::ofstream out(path);
+        out << "contour_detection_mode: \"permissive\"\n"
+            << "contour_extraction: \"components\"\n"
+            << "morph_approximate: true\n"
+            << "flood_guard: false\n"
+            << "hysteresis_low_ratio: 0\n"
+            << "motion_mask_rle: true\n"
+            << "packed_masks: " << (path == packedPath ? "true" : "false") << "\n";
+    }
+
+    // A bird-sized patch moving between two noisy frames
+    cv::Mat frame1(240, 320, CV_8UC3, cv::Scalar(90, 100, 110));
+    cv::RNG rng(21);
+    cv::Mat noise(frame1.size(), CV_8UC3);
+    rng.fill(noise, cv::RNG::UNIFORM, 0, 12);
+    frame1 += noise;
+    cv::Mat frame2 = frame1.clone();
+    cv::rectangle(frame1, cv::Rect(60, 80, 40, 30), cv::Scalar(20, 40, 200), cv::FILLED);
+    cv::rectangle(frame2, cv::Rect(75, 86, 40, 30), cv::Scalar(20, 40, 200), cv::FILLED);
+
+    MotionProcessor byteProcessor(configPath);
+    byteProcessor.reloadConfig(bytePath);
+    MotionProcessor packedProcessor(configPath);
+    packedProcessor.reloadConfig(packedPath);
+    ASSERT_TRUE(packedProcessor.isPackedMasksEnabled());
+    for (MotionProcessor* processor : {&byteProcessor, &packedProcessor}) {
+        processor->enableVisualization(false);
+        processor->setRetainedStages(MotionProcessor::STAGE_NONE);
+        processor->processFrame(frame1);
+    }
+    const MotionProcessor::ProcessingResult expected = byteProcessor.processFrame(frame2);
+    const MotionProcessor::ProcessingResult actual = packedProcessor.processFrame(frame2);
+    ASSERT_TRUE(expected.hasMotion);
+    EXPECT_EQ(actual.detectedBounds, expected.detectedBounds);
+    EXPECT_EQ(packedProcessor.getLastExtractionStats().candidates,
+              byteProcessor.getLastExtractionStats().candidates);
+    // The labeler's runs are the byte mask's runs
+    ASSERT_FALSE(expected.motionMask.empty());
+    EXPECT_EQ(actual.motionMask.encode(), expected.motionMask.encode());
+    EXPECT_EQ(actual.motionMask.frameArea(), cv::Rect(cv::Point(), frame2.size()));
+}
+
+TEST_F(MotionProcessorTest, ComponentExtractionMatchesContours) {
+    const std::string permissivePath = outputDir + "/permissive_contours_config.yaml";
+    const std::string componentsPath = outputDir + "/components_config.yaml";
+    {
+        std::ofstream out(permissivePath);
+        out << "contour_detection_mode: \"permissive\"\n";
+    }
+    {
+        std::ofstream out(componentsPath);
+        out << "contour_detection_mode: \"permissive\"\n"
+            << "contour_extraction: \"components\"\n";
+    }
+
+    // Two solid blobs, one speck below the area floor and one thin ring
+    cv::Mat mask = cv::Mat::zeros(240, 320, CV_8UC1);
+    cv::rectangle(mask, cv::Rect(20, 30, 40, 30), cv::Scalar(255), cv::FILLED);
+    cv::rectangle(mask, cv::Rect(120, 100, 25, 50), cv::Scalar(255), cv::FILLED);
+    cv::rectangle(mask, cv::Rect(300, 10, 3, 3), cv::Scalar(255), cv::FILLED);
+    cv::circle(mask, cv::Point(240, 170), 50, cv::Scalar(255), 1);
+
+    motionProcessor->enableVisualization(false);
+    motionProcessor->reloadConfig(permissivePath);
+    ASSERT_EQ(motionProcessor->getExtractionMethod(), MotionProcessor::ExtractionMethod::CONTOURS);
+    std::vector<cv::Rect> contourBoxes = motionProcessor->extractContours(mask);
+
+    MotionProcessor componentProcessor(configPath);
+    componentProcessor.reloadConfig(componentsPath);
+    ASSERT_EQ(componentProcessor.getExtractionMethod(), MotionProcessor::ExtractionMethod::COMPONENTS);
+    std::vector<cv::Rect> componentBoxes = componentProcessor.extractContours(mask);
+
+    auto byPosition = [](const cv::Rect& a, const cv::Rect& b) { return a.x < b.x; };
+    std::sort(contourBoxes.begin(), contourBoxes.end(), byPosition);
+    std::sort(componentBoxes.begin(), componentBoxes.end(), byPosition);
+
+    // Solid blobs give identical boxes; the speck fails the area filter in both modes
+    ASSERT_EQ(componentBoxes.size(), 2u);
+    EXPECT_EQ(componentBoxes[0], cv::Rect(20, 30, 40, 30));
+    EXPECT_EQ(componentBoxes[1], cv::Rect(120, 100, 25, 50));
+
+    // An outer contour encloses the ring's hole, its pixels do not: only the
+    // contour path sees a solid disc
+    ASSERT_EQ(contourBoxes.size(), 3u);
+    EXPECT_EQ(contourBoxes[0], componentBoxes[0]);
+    EXPECT_EQ(contourBoxes[1], componentBoxes[1]);
+
+    // The structured filter statistics account for every candidate
+    const MotionProcessor::ExtractionStats& contourStats = motionProcessor->getLastExtractionStats();
+    EXPECT_EQ(contourStats.candidates, 4);
+    EXPECT_EQ(contourStats.rejectedArea, 1);
+    EXPECT_EQ(contourStats.accepted, 3);
+    const MotionProcessor::ExtractionStats& componentStats = componentProcessor.getLastExtractionStats();
+    EXPECT_EQ(componentStats.candidates, 4);
+    EXPECT_EQ(componentStats.rejectedArea, 1);
+    EXPECT_EQ(componentStats.rejectedSolidity + componentStats.rejectedAspectRatio, 1);
+    EXPECT_EQ(componentStats.accepted, 2);
+}
+
+TEST_F(MotionProcessorTest, ContourCapKeepsTheLargestCandidates) {
+    // 40 small blobs that pass every filter and three large ones
+    cv::Mat mask = cv::Mat::zeros(240, 320, CV_8UC1);
+    for (int i = 0; i < 10; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            cv::rectangle(mask, cv::Rect(10 + 30 * i, 150 + 22 * j, 10, 10), cv::Scalar(255), cv::FILLED);
+        }
+    }
+    const std::vector<cv::Rect> large = {cv::Rect(20, 20, 40, 30), cv::Rect(100, 20, 30, 30),
+                                         cv::Rect(200, 20, 25, 25)};
+    for (const cv::Rect& blob : large) cv::rectangle(mask, blob, cv::Scalar(255), cv::FILLED);
+
+    for (const char* method : {"contours", "components"}) {
+        SCOPED_TRACE(method);
+        const std::string path = outputDir + "/contour_cap_" + method + "_config.yaml";
+        {
+            std::ofstream out(path);
+            out << "contour_detection_mode: \"permissive\"\n"
+                << "contour_extraction: \"" << method << "\"\n";
+        }
+        MotionProcessor processor(configPath);
+        processor.reloadConfig(path);
+        ASSERT_EQ(processor.getMaxContoursPerFrame(), 0);
+        EXPECT_EQ(processor.extractContours(mask).size(), 43u);
+
+        processor.setMaxContoursPerFrame(3);
+        std::vector<cv::Rect> boxes = processor.extractContours(mask);
+        std::sort(boxes.begin(), boxes.end(), [](const cv::Rect& a, const cv::Rect& b) { return a.x < b.x; });
+        EXPECT_EQ(boxes, large);
+        const MotionProcessor::ExtractionStats& stats = processor.getLastExtractionStats();
+        EXPECT_EQ(stats.candidates, 43);
+        EXPECT_EQ(stats.droppedOverCap, 40);
+        EXPECT_EQ(stats.accepted, 3);
+    }
+}
+
+TEST_F(MotionProcessorTest, MultiCameraInstancesRunIndependently) {
+    // One processor per camera and thread; each must produce exactly what it produces
+    // alone. Build with -DENABLE_TSAN=ON to have ThreadSanitizer check for shared state.
+    constexpr int kCameras = 4;
+    constexpr int kFrames = 40;
+    auto cameraFrame = [](int camera, int frame) {
+        cv::Mat image(240, 320, CV_8UC3, cv::Scalar(30, 30, 30));
+        const int x = 10 + (frame * (3 + camera)) % 250;
+        cv::rectangle(image, cv::Rect(x, 40 + camera * 40, 40, 30), cv::Scalar(220, 220, 220), cv::FILLED);
+        return image;
+    };
+    auto runCamera = [&](int camera) {
+        MotionProcessor processor(configPath);
+        processor.enableVisualization(false);
+        std::vector<std::vector<cv::Rect>> boxes;
+        for (int f = 0; f < kFrames; ++f) {
+            boxes.push_back(processor.processFrame(cameraFrame(camera, f)).detectedBounds);
+        }
+        return boxes;
+    };
+
+    std::vector<std::vector<std::vector<cv::Rect>>> expected;
+    for (int c = 0; c < kCameras; ++c) expected.push_back(runCamera(c));
+
+    std::vector<std::vector<std::vector<cv::Rect>>> concurrent(kCameras);
+    std::vector<std::thread> threads;
+    for (int c = 0; c < kCameras; ++c) {
+        threads.emplace_back([&, c] { concurrent[c] = runCamera(c); });
+    }
+    for (auto& thread : threads) thread.join();
+
+    for (int c = 0; c < kCameras; ++c) {
+        EXPECT_EQ(concurrent[c], expected[c]) << "camera " << c;
+    }
+}
+
+TEST(StageLatencyHistogramTest, PercentilesWithinBucketResolution) {
+    StageLatencyHistogram histogram;
+    for (int us = 1; us <= 1000; ++us) histogram.record(std::chrono::microseconds(us));
+    EXPECT_EQ(histogram.count(), 1000u);
+    EXPECT_NEAR(histogram.meanMicros(), 500.5, 1e-9);
+    EXPECT_DOUBLE_EQ(histogram.maxMicros(), 1000.0);
+    // Percentiles are bucket upper bounds: never below, at most 1/8 above the true value
+    for (double fraction : {0.5, 0.95, 0.99}) {
+        const double exact = fraction * 1000.0;
+        EXPECT_GE(histogram.percentileMicros(fraction), exact) << fraction;
+        EXPECT_LE(histogram.percentileMicros(fraction), exact * 1.125 + 1.0) << fraction;
+    }
+    histogram.reset();
+    EXPECT_EQ(histogram.count(), 0u);
+    EXPECT_DOUBLE_EQ(histogram.percentileMicros(0.99), 0.0);
+}
+
+TEST_F(MotionProcessorTest, StageTimingsFollowBuildOption) {
+    MotionProcessor processor(configPath);
+    cv::Mat frame1 = cv::imread(testImage1Path);
+    cv::Mat frame2 = cv::imread(testImage2Path);
+    ASSERT_FALSE(frame1.empty());
+    ASSERT_FALSE(frame2.empty());
+    processor.processFrame(frame1);
+    processor.processFrame(frame2);
+
+    const StageTimings& timings = processor.getStageTimings();
+    const uint64_t expected = StageTimings::kEnabled ? 1u : 0u;
+    EXPECT_EQ(timings.summary(PipelineStage::MORPHOLOGY).count, expected);
+    EXPECT_EQ(timings.summary(PipelineStage::EXTRACTION).count, expected);
+    EXPECT_EQ(timings.summary(PipelineStage::PREPROCESS).count, 2 * expected);
+    EXPECT_EQ(timings.summary(PipelineStage::RENDER).count, 0u);
+    processor.resetStageTimings();
+    EXPECT_EQ(timings.summary(PipelineStage::PREPROCESS).count, 0u);
+}
+
+// Allocates behind a volatile pointer, so the compiler cannot elide the new/delete pair
+void allocateAndFree(size_t bytes) {
+    static char* volatile escaped = nullptr;
+    escaped = new char[bytes];
+    delete[] escaped;
+}
+
+TEST_F(MotionProcessorTest, AllocationCountingChargesTheInnermostStage) {
+    if (!AllocationCounter::kStageAttribution) GTEST_SKIP() << "built without ENABLE_ALLOCATION_COUNTING";
+    StageTimings timings;
+    const StageAllocations before = AllocationCounter::stages();
+    {
+        STAGE_TIMER(timings, PipelineStage::PREPROCESS);
+        allocateAndFree(100);
+        {
+            STAGE_TIMER(timings, PipelineStage::CLAHE);
+            allocateAndFree(40);
+            allocateAndFree(40);
+        }
+    }
+    const StageAllocations after = AllocationCounter::stages();
+    const auto delta = [&](PipelineStage stage) {
+        return after[static_cast<size_t>(stage)] - before[static_cast<size_t>(stage)];
+    };
+    EXPECT_EQ(delta(PipelineStage::PREPROCESS).allocations, 1u);
+    EXPECT_EQ(delta(PipelineStage::PREPROCESS).bytes, 100u);
+    EXPECT_EQ(delta(PipelineStage::CLAHE).allocations, 2u);
+    EXPECT_EQ(delta(PipelineStage::CLAHE).frees, 2u);
+    EXPECT_EQ(currentPipelineStage, PipelineStage::COUNT);
+    EXPECT_NE(AllocationCounter::describe(before, after).find("clahe: 2 allocations (80 bytes)"), std::string::npos);
+
+    // A warm histogram records without allocating; an allocating statement is reported
+    StageLatencyHistogram histogram;
+    histogram.record(std::chrono::microseconds(5));
+    EXPECT_NO_ALLOCATIONS(histogram.record(std::chrono::microseconds(7)));
+    EXPECT_NONFATAL_FAILURE(EXPECT_NO_ALLOCATIONS(allocateAndFree(16)), "allocated 16 bytes");
+}
+
+TEST_F(MotionProcessorTest, WarmUpSeedsTheFirstFrame) {
+    cv::Mat frame1 = cv::imread(testImage1Path);
+    cv::Mat frame2 = cv::imread(testImage2Path);
+    ASSERT_FALSE(frame1.empty());
+    ASSERT_FALSE(frame2.empty());
+
+    motionProcessor->enableVisualization(false);
+    motionProcessor->processFrame(frame1);
+    MotionProcessor::ProcessingResult expected = motionProcessor->processFrame(frame2);
+
+    MotionProcessor processor(configPath);
+    processor.setBufferReuse(true);
+    processor.warmUp(frame1);
+    EXPECT_FALSE(processor.isFirstFrame());
+    EXPECT_EQ(processor.getStageTimings().summary(PipelineStage::PREPROCESS).count, 0u);
+
+    // The first frame through processFrame is already differenced against the reference
+    MotionProcessor::ProcessingResult actual = processor.processFrame(frame2);
+    EXPECT_FALSE(actual.thresh.empty());
+    EXPECT_EQ(actual.hasMotion, expected.hasMotion);
+
+    // Later calls leave the stream state alone
+    processor.warmUp(frame2);
+    EXPECT_FALSE(processor.processFrame(frame1).thresh.empty());
+}
+
+TEST_F(MotionProcessorTest, BackgroundSnapshotWarmStart) {
+    const std::string snapshotDir = outputDir + "/background_snapshots";
+    std::filesystem::remove_all(snapshotDir);
+    const std::string snapshotConfig = outputDir + "/background_snapshot_config.yaml";
+    {
+        std::ofstream out(snapshotConfig);
+        out << "background_subtraction: true\n"
+            << "camera_id: \"feeder cam\"\n"
+            << "background_snapshot_dir: \"" << snapshotDir << "\"\n"
+            << "background_snapshot_max_diff: 20\n";
+    }
+
+    cv::Mat scene(240, 320, CV_8UC3, cv::Scalar(60, 60, 60));
+    cv::rectangle(scene, cv::Rect(20, 20, 80, 60), cv::Scalar(150, 150, 150), cv::FILLED);
+    {
+        MotionProcessor first(snapshotConfig);
+        EXPECT_FALSE(first.saveBackgroundSnapshot());  // No model yet
+        for (int i = 0; i < 5; ++i) first.processFrame(scene);
+        EXPECT_FALSE(first.isBackgroundRestored());
+        ASSERT_TRUE(first.saveBackgroundSnapshot());
+        EXPECT_EQ(first.getBackgroundSnapshotPath(), snapshotDir + "/background_feeder_cam.yml.gz");
+        EXPECT_TRUE(std::filesystem::exists(first.getBackgroundSnapshotPath()));
+    }
+
+    // The next process seeds its model from the snapshot
+    MotionProcessor restarted(snapshotConfig);
+    restarted.processFrame(scene);
+    restarted.processFrame(scene);
+    EXPECT_TRUE(restarted.isBackgroundRestored());
+
+    // A scene far from the snapshot (lights off) starts from scratch
+    MotionProcessor night(snapshotConfig);
+    cv::Mat dark(240, 320, CV_8UC3, cv::Scalar(5, 5, 5));
+    night.processFrame(dark);
+    night.processFrame(dark);
+    EXPECT_FALSE(night.isBackgroundRestored());
+}
+
 // Global test environment setup
 class MotionProcessorTestEnvironment : public ::testing::Environment {
 public:
@@ -2,12 +2,17 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <cmath>
 #include <filesystem>
 #include <opencv2/core.hpp>
 #include <opencv2/imgcodecs.hpp>
+#include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "frame_arena.hpp"
 #include "logger.hpp"
 #include "motion_processor.hpp"
 #include "test_helpers.hpp"
@@ -493,6 +498,798 @@ TEST_F(MotionRegionConsolidatorTest, ConsolidateRegionsMerging) {
     }
 }
 
+// Regions sum their objects' detection areas and average the measured contrast by area
+TEST_F(MotionRegionConsolidatorTest, SummarizeDetectionsWeightsByArea) {
+    TrackedObjectStore objects;
+    objects.add(7, cv::Rect(0, 0, 20, 20));
+    objects.add(9, cv::Rect(30, 0, 20, 20));
+    objects.add(4, cv::Rect(60, 0, 20, 20));
+    Detections detections;
+    detections.add(cv::Rect(0, 0, 20, 20), 300.0f, 0.9f, cv::Point2f(10, 10), 40.0f);
+    detections.add(cv::Rect(30, 0, 20, 20), 100.0f, 0.8f, cv::Point2f(40, 10), 80.0f);
+    detections.add(cv::Rect(60, 0, 20, 20), 200.0f, -1.0f, cv::Point2f(70, 10), -1.0f);  // Block path: no diff
+
+    std::vector<ConsolidatedRegion> regions;
+    regions.emplace_back(cv::Rect(0, 0, 50, 20), RegionObjectIds{7, 9});
+    regions.emplace_back(cv::Rect(60, 0, 20, 20), RegionObjectIds{4});
+    regions.emplace_back(cv::Rect(90, 0, 20, 20), RegionObjectIds{12});  // No row this frame
+    MotionRegionConsolidator::summarizeDetections(objects, detections, regions);
+
+    EXPECT_FLOAT_EQ(regions[0].motionArea, 400.0f);
+    EXPECT_FLOAT_EQ(regions[0].meanDiff, 50.0f);  // (300 * 40 + 100 * 80) / 400
+    EXPECT_FLOAT_EQ(regions[1].motionArea, 200.0f);
+    EXPECT_FLOAT_EQ(regions[1].meanDiff, 0.0f);
+    EXPECT_FLOAT_EQ(regions[2].motionArea, 0.0f);
+}
+
+// The grid index must not change the clustering: compare against a full pairwise scan
+TEST_F(MotionRegionConsolidatorTest, SpatialIndexMatchesFullScan) {
+    cv::RNG rng(1234);
+    std::vector<TrackedObject> objects;
+    for (int i = 0; i < 400; ++i) {
+        int w = rng.uniform(5, 80);
+        int h = rng.uniform(5, 80);
+        cv::Rect box(rng.uniform(0, 1920 - w), rng.uniform(0, 1080 - h), w, h);
+        objects.emplace_back(i, box, "uuid_" + std::to_string(i));
+    }
+
+    ConsolidationConfig indexedConfig = config;
+    indexedConfig.frameSize = cv::Size(1920, 1080);
+    indexedConfig.useSpatialIndex = true;
+    ConsolidationConfig scanConfig = indexedConfig;
+    scanConfig.useSpatialIndex = false;
+
+    MotionRegionConsolidator indexed(indexedConfig);
+    MotionRegionConsolidator scanned(scanConfig);
+    auto indexedRegions = indexed.consolidateRegions(objects);
+    auto scannedRegions = scanned.consolidateRegions(objects);
+
+    ASSERT_EQ(indexedRegions.size(), scannedRegions.size());
+    for (size_t i = 0; i < indexedRegions.size(); ++i) {
+        EXPECT_EQ(indexedRegions[i].boundingBox, scannedRegions[i].boundingBox);
+        EXPECT_EQ(indexedRegions[i].trackedObjectIds, scannedRegions[i].trackedObjectIds);
+    }
+}
+
+// Property test: the union-find clusters are the queue-based DBSCAN's, border points included
+TEST_F(MotionRegionConsolidatorTest, UnionFindClusteringMatchesQueueExpansion) {
+    cv::RNG rng(91);
+    for (int trial = 0; trial < 60; ++trial) {
+        // From sparse to crowded frames, so noise, border and core points all occur
+        const int count = rng.uniform(1, 250);
+        const int maxSize = rng.uniform(10, 120);
+        std::vector<TrackedObject> objects;
+        for (int i = 0; i < count; ++i) {
+            int w = rng.uniform(5, maxSize);
+            int h = rng.uniform(5, maxSize);
+            cv::Rect box(rng.uniform(0, 1920 - w), rng.uniform(0, 1080 - h), w, h);
+            objects.emplace_back(i, box, "uuid_" + std::to_string(i));
+        }
+        for (int minPts : {0, 1, 2, 3, 5}) {
+            SCOPED_TRACE("trial " + std::to_string(trial) + ", minPts " + std::to_string(minPts));
+            ConsolidationConfig queueConfig = config;
+            queueConfig.frameSize = cv::Size(1920, 1080);
+            queueConfig.minPts = minPts;
+            queueConfig.useSpatialIndex = trial % 2 == 0;
+            queueConfig.unionFindClustering = false;
+            ConsolidationConfig unionFindConfig = queueConfig;
+            unionFindConfig.unionFindClustering = true;
+
+            MotionRegionConsolidator queued(queueConfig);
+            MotionRegionConsolidator unionFind(unionFindConfig);
+            const auto queuedRegions = queued.consolidateRegions(objects);
+            const auto unionFindRegions = unionFind.consolidateRegions(objects);
+            ASSERT_EQ(queuedRegions.size(), unionFindRegions.size());
+            for (size_t i = 0; i < queuedRegions.size(); ++i) {
+                EXPECT_EQ(queuedRegions[i].boundingBox, unionFindRegions[i].boundingBox);
+                EXPECT_EQ(queuedRegions[i].trackedObjectIds, unionFindRegions[i].trackedObjectIds);
+            }
+        }
+    }
+}
+
+TEST_F(MotionRegionConsolidatorTest, ParallelClusteringMatchesSerial) {
+    // A flood frame: thousands of small boxes, many of them touching
+    cv::RNG rng(92);
+    std::vector<TrackedObject> objects;
+    for (int i = 0; i < 3000; ++i) {
+        int w = rng.uniform(4, 30);
+        int h = rng.uniform(4, 30);
+        cv::Rect box(rng.uniform(0, 1920 - w), rng.uniform(0, 1080 - h), w, h);
+        objects.emplace_back(i, box, "uuid_" + std::to_string(i));
+    }
+    for (bool useIndex : {true, false}) {
+        for (bool unionFind : {true, false}) {
+            SCOPED_TRACE(std::string(useIndex ? "grid" : "scan") + (unionFind ? ", union-find" : ", queue"));
+            ConsolidationConfig serialConfig = config;
+            serialConfig.frameSize = cv::Size(1920, 1080);
+            serialConfig.useSpatialIndex = useIndex;
+            serialConfig.unionFindClustering = unionFind;
+            serialConfig.parallelClusteringMinBoxes = 0;
+            ConsolidationConfig parallelConfig = serialConfig;
+            parallelConfig.parallelClusteringMinBoxes = 1000;
+
+            MotionRegionConsolidator serial(serialConfig);
+            MotionRegionConsolidator parallel(parallelConfig);
+            const auto serialRegions = serial.consolidateRegions(objects);
+            const auto parallelRegions = parallel.consolidateRegions(objects);
+            ASSERT_EQ(serialRegions.size(), parallelRegions.size());
+            for (size_t i = 0; i < serialRegions.size(); ++i) {
+                EXPECT_EQ(serialRegions[i].boundingBox, parallelRegions[i].boundingBox);
+                EXPECT_EQ(serialRegions[i].trackedObjectIds, parallelRegions[i].trackedObjectIds);
+            }
+        }
+    }
+}
+
+TEST_F(MotionRegionConsolidatorTest, IncrementalClusteringMatchesFullRebuild) {
+    cv::RNG rng(7);
+    std::vector<TrackedObject> objects;
+    int nextId = 0;
+    for (; nextId < 300; ++nextId) {
+        int w = rng.uniform(5, 60);
+        int h = rng.uniform(5, 60);
+        cv::Rect box(rng.uniform(0, 1920 - w), rng.uniform(0, 1080 - h), w, h);
+        objects.emplace_back(nextId, box, "uuid_" + std::to_string(nextId));
+    }
+
+    for (bool useIndex : {true, false}) {
+        ConsolidationConfig fullConfig = config;
+        fullConfig.useSpatialIndex = useIndex;
+        ConsolidationConfig incrementalConfig = fullConfig;
+        incrementalConfig.incrementalClustering = true;
+        MotionRegionConsolidator full(fullConfig);
+        MotionRegionConsolidator incremental(incrementalConfig);
+
+        std::vector<TrackedObject> frame = objects;
+        int frameId = nextId;
+        for (int f = 0; f < 8; ++f) {
+            // A few boxes move a few pixels, one disappears and one appears
+            for (auto& object : frame) {
+                if (rng.uniform(0, 10) == 0) {
+                    object.currentBounds.x += rng.uniform(-4, 5);
+                    object.currentBounds.y += rng.uniform(-4, 5);
+                }
+            }
+            frame.erase(frame.begin() + rng.uniform(0, static_cast<int>(frame.size())));
+            cv::Rect arrival(rng.uniform(0, 1800), rng.uniform(0, 1000), 30, 30);
+            frame.emplace_back(frameId, arrival, "uuid_" + std::to_string(frameId));
+            ++frameId;
+
+            auto fullRegions = full.consolidateRegions(frame);
+            auto incrementalRegions = incremental.consolidateRegions(frame);
+            ASSERT_EQ(fullRegions.size(), incrementalRegions.size()) << "frame " << f;
+            for (size_t i = 0; i < fullRegions.size(); ++i) {
+                EXPECT_EQ(fullRegions[i].boundingBox, incrementalRegions[i].boundingBox);
+                EXPECT_EQ(fullRegions[i].trackedObjectIds, incrementalRegions[i].trackedObjectIds);
+            }
+        }
+    }
+}
+
+TEST_F(MotionRegionConsolidatorTest, BatchDistanceKernelMatchesScalar) {
+    // Overlapping, touching, separated on one axis, diagonal and degenerate boxes
+    std::vector<cv::Rect> rects = {cv::Rect(0, 0, 50, 50),   cv::Rect(25, 25, 50, 50),
+                                   cv::Rect(50, 0, 20, 20),  cv::Rect(120, 10, 30, 30),
+                                   cv::Rect(200, 200, 5, 5), cv::Rect(10, 10, 0, 0)};
+    cv::RNG rng(42);
+    for (int i = 0; i < 97; ++i) {
+        rects.emplace_back(rng.uniform(0, 400), rng.uniform(0, 400), rng.uniform(0, 60),
+                           rng.uniform(0, 60));
+    }
+
+    const BoxArrays boxes(rects);
+    BoxDistanceParams params;
+    params.overlapWeight = config.overlapWeight;
+    params.edgeWeight = config.edgeWeight;
+    params.maxEdgeDistance = config.maxEdgeDistance;
+
+    std::vector<double> batch(rects.size());
+    for (size_t i = 0; i < rects.size(); ++i) {
+        // Odd-length ranges exercise the scalar tail
+        boxDistanceBatch(boxes, i, 1, rects.size(), params, batch.data());
+        for (size_t j = 1; j < rects.size(); ++j) {
+            EXPECT_DOUBLE_EQ(batch[j - 1], boxDistance(boxes, i, j, params)) << i << "," << j;
+        }
+    }
+
+    // Overlap ratio 1 and no gap: distance 0; disjoint with a 50 px gap: capped pieces add up
+    EXPECT_DOUBLE_EQ(boxDistance(boxes, 0, 0, params), 0.0);
+    EXPECT_DOUBLE_EQ(boxDistance(boxes, 0, 3, params),
+                     params.overlapWeight * params.maxEdgeDistance +
+                         params.edgeWeight * std::min(70.0, params.maxEdgeDistance));
+}
+
+TEST_F(MotionRegionConsolidatorTest, IntegerGeometryMatchesDoubleDistances) {
+    cv::RNG rng(99);
+    std::vector<TrackedObject> objects;
+    for (int i = 0; i < 300; ++i) {
+        int w = rng.uniform(1, 70);
+        int h = rng.uniform(1, 70);
+        cv::Rect box(rng.uniform(0, 1200 - w), rng.uniform(0, 800 - h), w, h);
+        objects.emplace_back(i, box, "uuid_" + std::to_string(i));
+    }
+    std::vector<cv::Rect> rects;
+    for (const auto& object : objects) rects.push_back(object.currentBounds);
+    const BoxArrays boxes(rects);
+
+    // eps 50: only overlaps qualify; eps 80: disjoint boxes within a 33 px gap too
+    for (double eps : {50.0, 80.0}) {
+        ConsolidationConfig doubleConfig = config;
+        doubleConfig.eps = eps;
+        BoxDistanceParams params;
+        params.overlapWeight = doubleConfig.overlapWeight;
+        params.edgeWeight = doubleConfig.edgeWeight;
+        params.maxEdgeDistance = doubleConfig.maxEdgeDistance;
+        const IntegerNeighborTest integerTest(params, eps);
+
+        for (size_t i = 0; i < rects.size(); ++i) {
+            for (size_t j = 0; j < rects.size(); ++j) {
+                const double distance = boxDistance(boxes, i, j, params);
+                if (std::abs(distance - eps) < 1e-6) continue;  // Rounding may differ on the boundary
+                EXPECT_EQ(integerTest(rects[i], rects[j]), distance <= eps) << i << "," << j;
+            }
+        }
+
+        // Clusters must match exactly when no overlap ratio can sit on the eps boundary
+        if (eps < params.overlapWeight * params.maxEdgeDistance) continue;
+        ConsolidationConfig integerConfig = doubleConfig;
+        integerConfig.integerGeometry = true;
+        for (bool useIndex : {true, false}) {
+            doubleConfig.useSpatialIndex = useIndex;
+            integerConfig.useSpatialIndex = useIndex;
+            auto expected = MotionRegionConsolidator(doubleConfig).consolidateRegions(objects);
+            auto actual = MotionRegionConsolidator(integerConfig).consolidateRegions(objects);
+            ASSERT_EQ(actual.size(), expected.size());
+            for (size_t r = 0; r < expected.size(); ++r) {
+                EXPECT_EQ(actual[r].trackedObjectIds, expected[r].trackedObjectIds);
+                // Fixed-point expansion may round one pixel differently
+                EXPECT_LE(std::abs(actual[r].boundingBox.width - expected[r].boundingBox.width), 2);
+            }
+        }
+    }
+}
+
+TEST_F(MotionRegionConsolidatorTest, DistancePoliciesBatchAndIndexMatchFullScan) {
+    cv::RNG rng(17);
+    std::vector<TrackedObject> objects;
+    std::vector<cv::Rect> rects;
+    for (int i = 0; i < 201; ++i) {
+        const int w = rng.uniform(1, 60);
+        const int h = rng.uniform(1, 60);
+        objects.emplace_back(i, cv::Rect(rng.uniform(0, 900 - w), rng.uniform(0, 600 - h), w, h),
+                             "uuid_" + std::to_string(i));
+        rects.push_back(objects.back().currentBounds);
+    }
+    const BoxArrays boxes(rects);
+    BoxDistanceParams params;
+    params.maxEdgeDistance = 100.0;
+
+    auto checkBatch = [&](auto policy, const char* name) {
+        using Distance = decltype(policy);
+        std::vector<double> batch(rects.size());
+        for (size_t i = 0; i < rects.size(); i += 7) {
+            Distance::batch(boxes, i, 1, rects.size(), params, batch.data());
+            for (size_t j = 1; j < rects.size(); ++j) {
+                EXPECT_DOUBLE_EQ(batch[j - 1], Distance::distance(boxes, i, j, params)) << name << " " << i << "," << j;
+            }
+        }
+    };
+    checkBatch(EdgeGapDistance(), "edge_gap");
+    checkBatch(CenterChebyshevDistance(), "center_linf");
+    checkBatch(IouDistance(), "iou");
+
+    // Two 40 px squares, 20 px apart horizontally and offset 10 px vertically
+    const BoxArrays pair(std::vector<cv::Rect>{cv::Rect(0, 0, 40, 40), cv::Rect(60, 10, 40, 40)});
+    EXPECT_DOUBLE_EQ(EdgeGapDistance::distance(pair, 0, 1, params), 20.0);
+    EXPECT_DOUBLE_EQ(CenterChebyshevDistance::distance(pair, 0, 1, params), 60.0);
+    EXPECT_DOUBLE_EQ(IouDistance::distance(pair, 0, 1, params), 100.0);
+    EXPECT_EQ(parseDistanceMetric("center_linf"), DistanceMetric::CenterChebyshev);
+    EXPECT_THROW(parseDistanceMetric("manhattan"), std::invalid_argument);
+
+    // The grid index (queried at each policy's reach) finds the same clusters as a full scan
+    const std::pair<DistanceMetric, double> metrics[] = {
+        {DistanceMetric::EdgeGap, 15.0}, {DistanceMetric::CenterChebyshev, 45.0}, {DistanceMetric::Iou, 60.0}};
+    for (const auto& [metric, eps] : metrics) {
+        ConsolidationConfig metricConfig = config;
+        metricConfig.distanceMetric = metric;
+        metricConfig.eps = eps;
+        metricConfig.maxEdgeDistance = params.maxEdgeDistance;
+        metricConfig.useSpatialIndex = true;
+        ConsolidationConfig scanConfig = metricConfig;
+        scanConfig.useSpatialIndex = false;
+        auto expected = MotionRegionConsolidator(scanConfig).consolidateRegions(objects);
+        auto actual = MotionRegionConsolidator(metricConfig).consolidateRegions(objects);
+        ASSERT_EQ(actual.size(), expected.size()) << distanceMetricName(metric);
+        for (size_t r = 0; r < expected.size(); ++r) {
+            EXPECT_EQ(actual[r].trackedObjectIds, expected[r].trackedObjectIds) << distanceMetricName(metric);
+            EXPECT_EQ(actual[r].boundingBox, expected[r].boundingBox) << distanceMetricName(metric);
+        }
+    }
+}
+
+// ============================================================================
+// REGION FILTERS
+// ============================================================================
+
+TEST_F(MotionRegionConsolidatorTest, AreaAndObjectCountFiltersRejectRegions) {
+    std::vector<TrackedObject> objects;
+    objects.emplace_back(0, cv::Rect(10, 10, 5, 5), "uuid0");  // Tiny pair
+    objects.emplace_back(1, cv::Rect(12, 12, 5, 5), "uuid1");
+    objects.emplace_back(2, cv::Rect(500, 500, 60, 60), "uuid2");  // Bird-sized triple
+    objects.emplace_back(3, cv::Rect(520, 520, 60, 60), "uuid3");
+    objects.emplace_back(4, cv::Rect(510, 530, 60, 60), "uuid4");
+
+    ConsolidationConfig filtered = config;
+    filtered.minPts = 1;
+    ASSERT_EQ(MotionRegionConsolidator(filtered).consolidateRegions(objects).size(), 2u);
+
+    filtered.minRegionArea = 1000.0;
+    auto regions = MotionRegionConsolidator(filtered).consolidateRegions(objects);
+    ASSERT_EQ(regions.size(), 1u);
+    EXPECT_EQ(regions[0].trackedObjectIds.size(), 3u);
+
+    filtered.minRegionArea = 0.0;
+    filtered.maxRegionArea = 1000.0;
+    regions = MotionRegionConsolidator(filtered).consolidateRegions(objects);
+    ASSERT_EQ(regions.size(), 1u);
+    EXPECT_EQ(regions[0].trackedObjectIds.size(), 2u);
+
+    filtered.maxRegionArea = 0.0;
+    filtered.minObjectsPerRegion = 3;
+    regions = MotionRegionConsolidator(filtered).consolidateRegions(objects);
+    ASSERT_EQ(regions.size(), 1u);
+    EXPECT_EQ(regions[0].trackedObjectIds.size(), 3u);
+}
+
+TEST_F(MotionRegionConsolidatorTest, GridCellSizeKeepsTheClusters) {
+    cv::RNG rng(99);
+    std::vector<TrackedObject> objects;
+    for (int i = 0; i < 300; ++i) {
+        int w = rng.uniform(5, 80);
+        int h = rng.uniform(5, 80);
+        cv::Rect box(rng.uniform(0, 1920 - w), rng.uniform(0, 1080 - h), w, h);
+        objects.emplace_back(i, box, "uuid_" + std::to_string(i));
+    }
+
+    ConsolidationConfig autoCell = config;
+    ConsolidationConfig configuredCell = config;
+    configuredCell.gridCellSize = 0.05;  // About 110 px on a 1080p diagonal
+    auto expected = MotionRegionConsolidator(autoCell).consolidateRegions(objects);
+    auto actual = MotionRegionConsolidator(configuredCell).consolidateRegions(objects);
+
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); ++i) {
+        EXPECT_EQ(actual[i].boundingBox, expected[i].boundingBox);
+        EXPECT_EQ(actual[i].trackedObjectIds, expected[i].trackedObjectIds);
+    }
+}
+
+TEST_F(MotionRegionConsolidatorTest, MaxDistanceThresholdSeparatesFarApartBoxes) {
+    // Two long boxes that touch at their ends: close by edge distance, far apart by center
+    std::vector<TrackedObject> objects;
+    objects.emplace_back(0, cv::Rect(0, 500, 1000, 10), "uuid0");
+    objects.emplace_back(1, cv::Rect(990, 500, 1000, 10), "uuid1");
+
+    ConsolidationConfig reach = config;
+    reach.minPts = 1;
+    reach.eps = 80.0;
+    reach.frameSize = cv::Size(2000, 1080);
+    ASSERT_EQ(MotionRegionConsolidator(reach).consolidateRegions(objects).size(), 1u);
+
+    reach.maxDistanceThreshold = 0.3;  // About 680 px; the centers are 990 px apart
+    for (bool integerGeometry : {false, true}) {
+        reach.integerGeometry = integerGeometry;
+        EXPECT_TRUE(MotionRegionConsolidator(reach).consolidateRegions(objects).empty());
+    }
+}
+
+TEST_F(MotionRegionConsolidatorTest, ClusteringTraceRecordsDecisionsAndDumpsOnRequest) {
+    std::vector<TrackedObject> objects;
+    objects.emplace_back(3, cv::Rect(100, 100, 50, 50), "uuid3");
+    objects.emplace_back(7, cv::Rect(120, 100, 50, 50), "uuid7");  // 60% overlap
+    objects.emplace_back(9, cv::Rect(900, 700, 50, 50), "uuid9");
+
+    ConsolidationConfig traced = config;
+    traced.clusteringTraceCapacity = 4;
+    traced.useSpatialIndex = false;  // Every pair reaches the distance test
+    for (bool integerGeometry : {false, true}) {
+        traced.integerGeometry = integerGeometry;
+        MotionRegionConsolidator consolidator(traced);
+        consolidator.consolidateRegions(objects);
+
+        const std::vector<ClusteringTraceRecord> records = consolidator.clusteringTrace().records();
+        ASSERT_EQ(records.size(), 3u);  // (3, 7), (3, 9), (7, 9)
+        EXPECT_EQ(records[0].idA, 3);
+        EXPECT_EQ(records[0].idB, 7);
+        EXPECT_EQ(records[0].neighbor, 1);
+        EXPECT_EQ(records[1].neighbor, 0);
+        EXPECT_EQ(records[2].neighbor, 0);
+        EXPECT_EQ(std::isnan(records[0].distance), integerGeometry);
+
+        // The ring keeps the newest decisions; a requested dump is written by the next frame
+        consolidator.consolidateRegions(objects);
+        EXPECT_EQ(consolidator.clusteringTrace().recorded(), 6u);
+        EXPECT_EQ(consolidator.clusteringTrace().records().size(), 4u);
+        EXPECT_EQ(consolidator.clusteringTrace().records().back().frame, 2u);
+
+        const std::string dumpPath = "test_results/motion_region_consolidator/clustering_trace.bin";
+        std::filesystem::remove(dumpPath);
+        consolidator.clusteringTrace().requestDump(dumpPath);
+        consolidator.consolidateRegions(objects);
+        ASSERT_TRUE(std::filesystem::exists(dumpPath));
+        EXPECT_EQ(std::filesystem::file_size(dumpPath), 16u + 4u * sizeof(ClusteringTraceRecord));
+        EXPECT_TRUE(consolidator.clusteringTrace().takeDumpRequest().empty()) << "One dump per request";
+    }
+}
+
+TEST_F(MotionRegionConsolidatorTest, OverlapThresholdKeepsBarelyTouchingRegionsApart) {
+    ConsolidationConfig merging = config;
+    merging.minPts = 1;
+    merging.regionExpansionFactor = 1.0;
+    const std::vector<TrackedObject> first = {TrackedObject(0, cv::Rect(100, 100, 100, 100), "uuid0"),
+                                              TrackedObject(1, cv::Rect(120, 120, 100, 100), "uuid1")};
+    // A later group overlapping the first region by a 10 px strip
+    const std::vector<TrackedObject> second = {TrackedObject(2, cv::Rect(210, 100, 100, 100), "uuid2"),
+                                               TrackedObject(3, cv::Rect(230, 120, 100, 100), "uuid3")};
+
+    MotionRegionConsolidator anyOverlap(merging);
+    anyOverlap.consolidateRegions(first);
+    EXPECT_EQ(anyOverlap.consolidateRegions(second).size(), 1u);
+
+    merging.overlapThreshold = 0.3;
+    MotionRegionConsolidator strict(merging);
+    strict.consolidateRegions(first);
+    EXPECT_EQ(strict.consolidateRegions(second).size(), 2u);
+}
+
+TEST_F(MotionRegionConsolidatorTest, RelativeParametersClusterEveryResolutionAlike) {
+    cv::RNG rng(2024);
+    std::vector<TrackedObject> hd;
+    std::vector<TrackedObject> uhd;  // The same scene at twice the resolution
+    for (int i = 0; i < 200; ++i) {
+        int w = rng.uniform(5, 80);
+        int h = rng.uniform(5, 80);
+        cv::Rect box(rng.uniform(0, 1920 - w), rng.uniform(0, 1080 - h), w, h);
+        hd.emplace_back(i, box, "uuid_" + std::to_string(i));
+        uhd.emplace_back(i, cv::Rect(box.x * 2, box.y * 2, box.width * 2, box.height * 2),
+                         "uuid_" + std::to_string(i));
+    }
+
+    ConsolidationConfig relative = config;
+    relative.epsFraction = 50.0 / std::hypot(1920.0, 1080.0);
+    relative.maxEdgeDistanceFraction = 100.0 / std::hypot(1920.0, 1080.0);
+    relative.regionExpansionFactor = 1.0;  // Keeps the region boxes exactly twice as large
+    MotionRegionConsolidator consolidator(relative);
+    EXPECT_NEAR(consolidator.getConfig().eps, 50.0, 1e-9);
+
+    auto hdRegions = consolidator.consolidateRegions(hd);
+    consolidator.setFrameSize(cv::Size(3840, 2160));
+    EXPECT_NEAR(consolidator.getConfig().eps, 100.0, 1e-9);
+    EXPECT_NEAR(consolidator.getConfig().maxEdgeDistance, 200.0, 1e-9);
+    EXPECT_TRUE(consolidator.getCurrentRegions().empty()) << "regions of the old resolution are dropped";
+    auto uhdRegions = consolidator.consolidateRegions(uhd);
+
+    ASSERT_EQ(uhdRegions.size(), hdRegions.size());
+    for (size_t i = 0; i < hdRegions.size(); ++i) {
+        EXPECT_EQ(uhdRegions[i].trackedObjectIds, hdRegions[i].trackedObjectIds);
+    }
+}
+
+TEST_F(MotionRegionConsolidatorTest, MergeClosesOverRegionsBridgedByANewOne) {
+    ConsolidationConfig merging = config;
+    merging.minPts = 1;
+    merging.regionExpansionFactor = 1.0;
+    MotionRegionConsolidator consolidator(merging);
+
+    // Two separate regions, then a new cluster overlapping both of them
+    const std::vector<TrackedObject> first = {TrackedObject(0, cv::Rect(100, 100, 100, 100), "uuid0"),
+                                              TrackedObject(1, cv::Rect(120, 120, 100, 100), "uuid1"),
+                                              TrackedObject(2, cv::Rect(400, 100, 100, 100), "uuid2"),
+                                              TrackedObject(3, cv::Rect(420, 120, 100, 100), "uuid3")};
+    ASSERT_EQ(consolidator.consolidateRegions(first).size(), 2u);
+    const std::vector<TrackedObject> bridge = {TrackedObject(4, cv::Rect(210, 150, 200, 40), "uuid4"),
+                                               TrackedObject(5, cv::Rect(215, 155, 200, 40), "uuid5")};
+    const auto regions = consolidator.consolidateRegions(bridge);
+
+    ASSERT_EQ(regions.size(), 1u) << "no pair of returned regions may overlap";
+    std::vector<int> ids(regions[0].trackedObjectIds.begin(), regions[0].trackedObjectIds.end());
+    std::sort(ids.begin(), ids.end());
+    EXPECT_EQ(ids, (std::vector<int>{0, 1, 2, 3, 4, 5}));
+    EXPECT_EQ(regions[0].boundingBox, cv::Rect(100, 100, 420, 120));
+}
+
+TEST_F(MotionRegionConsolidatorTest, MergedRegionsListEachObjectOnce) {
+    ConsolidationConfig merging = config;
+    merging.minPts = 1;
+    MotionRegionConsolidator consolidator(merging);
+    std::vector<TrackedObject> objects = {TrackedObject(0, cv::Rect(100, 100, 60, 60), "uuid0"),
+                                          TrackedObject(1, cv::Rect(120, 110, 60, 60), "uuid1"),
+                                          TrackedObject(2, cv::Rect(110, 130, 60, 60), "uuid2")};
+    consolidator.consolidateRegions(objects);
+    for (auto& object : objects) object.currentBounds.x += 5;  // The same birds, one frame on
+    const auto regions = consolidator.consolidateRegions(objects);
+
+    ASSERT_EQ(regions.size(), 1u);
+    std::vector<int> ids(regions[0].trackedObjectIds.begin(), regions[0].trackedObjectIds.end());
+    std::sort(ids.begin(), ids.end());
+    EXPECT_EQ(ids, (std::vector<int>{0, 1, 2}));
+}
+
+TEST_F(MotionRegionConsolidatorTest, ConsolidateRegionsIntoMatchesTheReturningApi) {
+    ConsolidationConfig merging = config;
+    merging.minPts = 1;
+    MotionRegionConsolidator returning(merging);
+    MotionRegionConsolidator into(merging);
+    std::vector<TrackedObject> objects = {TrackedObject(0, cv::Rect(100, 100, 60, 60), "uuid0"),
+                                          TrackedObject(1, cv::Rect(120, 110, 60, 60), "uuid1"),
+                                          TrackedObject(2, cv::Rect(500, 300, 60, 60), "uuid2")};
+    std::vector<ConsolidatedRegion> out;
+    for (int frame = 0; frame < 3; ++frame) {
+        const auto expected = returning.consolidateRegions(objects);
+        into.consolidateRegionsInto(objects, out);
+        ASSERT_EQ(out.size(), expected.size()) << "frame " << frame;
+        for (size_t i = 0; i < out.size(); ++i) {
+            EXPECT_EQ(out[i].boundingBox, expected[i].boundingBox);
+            EXPECT_EQ(out[i].trackedObjectIds, expected[i].trackedObjectIds);
+        }
+        for (auto& object : objects) object.currentBounds.x += 5;
+    }
+
+    // Steady state: the output keeps its storage
+    const ConsolidatedRegion* storage = out.data();
+    into.consolidateRegionsInto(objects, out);
+    EXPECT_EQ(out.data(), storage);
+}
+
+TEST(RegionObjectIdsTest, SpillsToTheHeapAndKeepsItsElements) {
+    RegionObjectIds ids = {1, 2, 3};
+    EXPECT_TRUE(ids.isInline());
+    for (int id = 4; id <= 20; ++id) ids.push_back(id);
+    EXPECT_FALSE(ids.isInline());
+    ASSERT_EQ(ids.size(), 20u);
+    for (int i = 0; i < 20; ++i) EXPECT_EQ(ids[i], i + 1);
+
+    const RegionObjectIds copy = ids;
+    RegionObjectIds moved = std::move(ids);
+    EXPECT_EQ(moved, copy);
+    EXPECT_TRUE(ids.empty());
+    EXPECT_TRUE(ids.isInline());
+
+    RegionObjectIds small = {7};
+    moved = small;  // Copy assignment keeps the heap buffer
+    EXPECT_FALSE(moved.isInline());
+    EXPECT_EQ(moved, small);
+    EXPECT_TRUE(moved.contains(7));
+    EXPECT_FALSE(moved.contains(8));
+}
+
+TEST_F(MotionRegionConsolidatorTest, FrameArenaScratchGivesTheSameRegions) {
+    ConsolidationConfig merging = config;
+    merging.minPts = 1;
+    MotionRegionConsolidator heap(merging);
+    MotionRegionConsolidator arena(merging);
+    FrameArena scratch(1024);  // Small enough to overflow on the first frame
+    std::vector<TrackedObject> objects;
+    for (int i = 0; i < 40; ++i) {
+        objects.emplace_back(i, cv::Rect(20 + (i % 10) * 70, 20 + (i / 10) * 90, 60, 60),
+                             "uuid" + std::to_string(i));
+    }
+    std::vector<ConsolidatedRegion> expected;
+    std::vector<ConsolidatedRegion> actual;
+    for (int frame = 0; frame < 3; ++frame) {
+        heap.consolidateRegionsInto(objects, expected);
+        arena.consolidateRegionsInto(objects, actual, &scratch);
+        scratch.reset();
+        ASSERT_EQ(actual.size(), expected.size()) << "frame " << frame;
+        for (size_t i = 0; i < actual.size(); ++i) {
+            EXPECT_EQ(actual[i].boundingBox, expected[i].boundingBox);
+            EXPECT_EQ(actual[i].trackedObjectIds, expected[i].trackedObjectIds);
+        }
+        for (auto& object : objects) object.currentBounds.y += 3;
+    }
+
+    // The buffer grew to the demand of the first frame; later frames fit
+    const FrameArenaStats& stats = scratch.getStats();
+    EXPECT_EQ(stats.frames, 3u);
+    EXPECT_EQ(stats.overflowFrames, 1u);
+    EXPECT_GE(scratch.capacity(), stats.peakBytes);
+    EXPECT_EQ(scratch.bytesUsed(), 0u);
+}
+
+TEST_F(MotionRegionConsolidatorTest, KeyframesAttachBoxesToRegionsBetweenDbscanRuns) {
+    ConsolidationConfig keyframed = config;
+    keyframed.minPts = 1;
+    keyframed.keyframeInterval = 5;
+    MotionRegionConsolidator consolidator(keyframed);
+    // Two flocks; IDs change every frame, as they do without the tracker
+    auto flocks = [](int frame, int dx) {
+        std::vector<TrackedObject> objects;
+        const int first = frame * 10;
+        objects.emplace_back(first, cv::Rect(100 + dx, 100, 60, 60), "a");
+        objects.emplace_back(first + 1, cv::Rect(130 + dx, 120, 60, 60), "b");
+        objects.emplace_back(first + 2, cv::Rect(900 + dx, 500, 60, 60), "c");
+        objects.emplace_back(first + 3, cv::Rect(930 + dx, 520, 60, 60), "d");
+        return objects;
+    };
+
+    const auto keyframe = consolidator.consolidateRegions(flocks(0, 0));
+    ASSERT_EQ(keyframe.size(), 2u);
+    for (int frame = 1; frame < 5; ++frame) {
+        const auto regions = consolidator.consolidateRegions(flocks(frame, 4 * frame));
+        ASSERT_EQ(regions.size(), 2u) << "frame " << frame;
+        for (const auto& region : regions) {
+            EXPECT_EQ(region.trackedObjectIds.size(), 2u);
+            EXPECT_EQ(region.framesSinceLastUpdate, 0);
+            for (int id : region.trackedObjectIds) EXPECT_GE(id, frame * 10);  // This frame's boxes
+        }
+        EXPECT_EQ(regions[0].boundingBox.x, keyframe[0].boundingBox.x + 4 * frame);
+    }
+    EXPECT_EQ(consolidator.getKeyframeStats().keyframes, 1u);
+    EXPECT_EQ(consolidator.getKeyframeStats().attachedFrames, 4u);
+
+    // The interval is up
+    consolidator.consolidateRegions(flocks(5, 20));
+    EXPECT_EQ(consolidator.getKeyframeStats().keyframes, 2u);
+
+    // Twice the boxes forces DBSCAN early
+    std::vector<TrackedObject> grown = flocks(6, 20);
+    const std::vector<TrackedObject> more = flocks(7, 400);
+    grown.insert(grown.end(), more.begin(), more.end());
+    EXPECT_EQ(consolidator.consolidateRegions(grown).size(), 4u);
+    EXPECT_EQ(consolidator.getKeyframeStats().countTriggered, 1u);
+    EXPECT_EQ(consolidator.getKeyframeStats().keyframes, 3u);
+
+    // Same count, but half the boxes moved away from every region: reclustered, not attached
+    std::vector<TrackedObject> moved = flocks(8, 20);
+    const std::vector<TrackedObject> away = flocks(9, 700);
+    moved.insert(moved.end(), away.begin(), away.end());
+    const auto reclustered = consolidator.consolidateRegions(moved);
+    EXPECT_EQ(consolidator.getKeyframeStats().unassignedTriggered, 1u);
+    EXPECT_EQ(consolidator.getKeyframeStats().keyframes, 4u);
+    const bool farFlockFound = std::any_of(reclustered.begin(), reclustered.end(), [](const auto& region) {
+        return region.framesSinceLastUpdate == 0 && region.boundingBox.x > 1500;
+    });
+    EXPECT_TRUE(farFlockFound);
+}
+
+TEST_F(MotionRegionConsolidatorTest, MemoizedUnchangedFramesMatchFullConsolidation) {
+    cv::RNG rng(11);
+    std::vector<TrackedObject> all;
+    for (int id = 0; id < 300; ++id) {
+        int w = rng.uniform(2, 15) * 4;
+        int h = rng.uniform(2, 15) * 4;
+        cv::Rect box(rng.uniform(0, (1920 - w) / 4) * 4, rng.uniform(0, (1080 - h) / 4) * 4, w, h);
+        all.emplace_back(id, box, "uuid_" + std::to_string(id));
+    }
+    // A third of the birds leave: their regions age out over the repeated frames
+    const std::vector<TrackedObject> stayed(all.begin() + 100, all.end());
+    std::vector<const std::vector<TrackedObject>*> frames;
+    for (int f = 0; f < 3; ++f) frames.push_back(&all);
+    for (int f = 0; f < 6; ++f) frames.push_back(&stayed);
+    const std::vector<TrackedObject> none;
+    frames.push_back(&none);
+    for (int f = 0; f < 2; ++f) frames.push_back(&stayed);
+    for (int f = 0; f < 2; ++f) frames.push_back(&all);
+
+    ConsolidationConfig memoConfig = config;
+    memoConfig.memoizeUnchangedFrames = true;
+    MotionRegionConsolidator full(config);
+    MotionRegionConsolidator memoized(memoConfig);
+    for (size_t f = 0; f < frames.size(); ++f) {
+        const auto fullRegions = full.consolidateRegions(*frames[f]);
+        const auto memoRegions = memoized.consolidateRegions(*frames[f]);
+        ASSERT_EQ(fullRegions.size(), memoRegions.size()) << "frame " << f;
+        for (size_t i = 0; i < fullRegions.size(); ++i) {
+            EXPECT_EQ(fullRegions[i].boundingBox, memoRegions[i].boundingBox) << "frame " << f;
+            EXPECT_EQ(fullRegions[i].trackedObjectIds, memoRegions[i].trackedObjectIds) << "frame " << f;
+            EXPECT_EQ(fullRegions[i].framesSinceLastUpdate, memoRegions[i].framesSinceLastUpdate) << "frame " << f;
+        }
+    }
+    const KeyframeStats& stats = memoized.getKeyframeStats();
+    EXPECT_EQ(stats.keyframes, 13u);
+    EXPECT_EQ(stats.memoizedFrames, 10u);  // Every repeat, including the ones after the empty frame
+    EXPECT_GT(stats.settledFrames, 0u);
+    EXPECT_LT(stats.settledFrames, stats.memoizedFrames);
+    EXPECT_EQ(full.getKeyframeStats().memoizedFrames, 0u);
+
+    // Coarser quantization: boxes jittering by a pixel count as unchanged
+    memoConfig.memoizeQuantization = 4;
+    MotionRegionConsolidator jittered(memoConfig);
+    for (int f = 0; f < 4; ++f) {
+        std::vector<TrackedObject> frame = all;
+        for (auto& object : frame) object.currentBounds.x += f % 2;
+        jittered.consolidateRegions(frame);
+    }
+    EXPECT_EQ(jittered.getKeyframeStats().memoizedFrames, 3u);
+
+    // A config update drops the memo
+    jittered.updateConfig(memoConfig);
+    jittered.consolidateRegions(all);
+    EXPECT_EQ(jittered.getKeyframeStats().memoizedFrames, 3u);
+}
+
+TEST(SingleLinkageTreeTest, CutsReplayTheMergesUpToTheDistance) {
+    // 0-1 close, 2-3 close, the pairs farther apart, 4 alone
+    std::vector<SingleLinkageTree::Edge> edges = {{2, 3, 2.0}, {1, 2, 6.0}, {0, 1, 1.0}, {0, 3, 9.0}};
+    SingleLinkageTree tree;
+    tree.build(5, edges);
+    ASSERT_EQ(tree.merges().size(), 3u);  // 0-3 closes a cycle
+    EXPECT_EQ(tree.merges()[0].distance, 1.0);
+    EXPECT_EQ(tree.merges()[2].distance, 6.0);
+    EXPECT_EQ(tree.merges()[2].size, 4);
+    EXPECT_EQ(tree.merges()[2].left, 5);  // Nodes of the first two merges
+    EXPECT_EQ(tree.merges()[2].right, 6);
+
+    std::vector<int> labels;
+    EXPECT_EQ(tree.cut(0.5, labels), 5);
+    EXPECT_EQ(labels, (std::vector<int>{0, 1, 2, 3, 4}));
+    EXPECT_EQ(tree.cut(2.0, labels), 3);
+    EXPECT_EQ(labels, (std::vector<int>{0, 0, 1, 1, 2}));
+    EXPECT_EQ(tree.cut(100.0, labels), 2);
+    EXPECT_EQ(labels, (std::vector<int>{0, 0, 0, 0, 1}));
+}
+
+TEST_F(MotionRegionConsolidatorTest, HierarchyLevelsComeFromOneMergeTree) {
+    ConsolidationConfig levels = config;
+    levels.distanceMetric = DistanceMetric::CenterChebyshev;
+    levels.eps = 20.0;
+    levels.minPts = 1;
+    levels.regionExpansionFactor = 1.0;
+    levels.minRegionArea = 0.0;
+    levels.hierarchyLevels = {1.0, 5.0};  // Birds within 20 px, flocks within 100 px
+
+    std::vector<TrackedObject> objects;
+    objects.emplace_back(0, cv::Rect(100, 100, 10, 10), "uuid0");  // Bird of two boxes
+    objects.emplace_back(1, cv::Rect(110, 100, 10, 10), "uuid1");
+    objects.emplace_back(2, cv::Rect(160, 100, 10, 10), "uuid2");  // Its neighbor, 50 px on
+    objects.emplace_back(3, cv::Rect(170, 100, 10, 10), "uuid3");
+    objects.emplace_back(4, cv::Rect(600, 600, 10, 10), "uuid4");  // Alone
+    MotionRegionConsolidator consolidator(levels);
+    consolidator.consolidateRegions(objects);
+
+    const auto& regionLevels = consolidator.getRegionLevels();
+    ASSERT_EQ(regionLevels.size(), 2u);
+    ASSERT_EQ(regionLevels[0].size(), 3u);
+    EXPECT_EQ(regionLevels[0][0].boundingBox, cv::Rect(100, 100, 20, 10));
+    EXPECT_EQ(regionLevels[0][1].boundingBox, cv::Rect(160, 100, 20, 10));
+    EXPECT_EQ(regionLevels[0][2].trackedObjectIds.size(), 1u);
+    ASSERT_EQ(regionLevels[1].size(), 2u);
+    EXPECT_EQ(regionLevels[1][0].boundingBox, cv::Rect(100, 100, 80, 10));
+    EXPECT_EQ(regionLevels[1][0].trackedObjectIds.size(), 4u);
+    EXPECT_EQ(consolidator.getMergeTree().merges().size(), 3u);  // Nothing within 100 px of 4
+
+    // The eps cut clusters like DBSCAN with minPts 1 (which leaves the singletons out)
+    cv::RNG rng(5);
+    std::vector<TrackedObject> random;
+    TrackedObjectStore randomStore;
+    for (int i = 0; i < 300; ++i) {
+        const int w = rng.uniform(5, 60);
+        const int h = rng.uniform(5, 60);
+        const cv::Rect box(rng.uniform(0, 1920 - w), rng.uniform(0, 1080 - h), w, h);
+        random.emplace_back(i, box, "uuid_" + std::to_string(i));
+        randomStore.add(i, box);
+    }
+    for (DistanceMetric metric : {DistanceMetric::OverlapEdge, DistanceMetric::EdgeGap}) {
+        ConsolidationConfig randomLevels = config;
+        randomLevels.distanceMetric = metric;
+        randomLevels.minPts = 1;
+        randomLevels.hierarchyLevels = {1.0, 2.0};
+        MotionRegionConsolidator tree(randomLevels);
+        tree.consolidateRegions(random);
+        std::vector<int> labels;
+        const int count = tree.getMergeTree().cut(tree.getConfig().eps, labels);
+        std::vector<std::vector<int>> fromTree(count);
+        for (int i = 0; i < static_cast<int>(labels.size()); ++i) fromTree[labels[i]].push_back(i);
+        fromTree.erase(std::remove_if(fromTree.begin(), fromTree.end(),
+                                      [](const std::vector<int>& cluster) { return cluster.size() < 2; }),
+                       fromTree.end());
+        EXPECT_EQ(fromTree, MotionRegionConsolidator(randomLevels).clusterObjects(randomStore));
+        // A coarser cut only joins clusters
+        EXPECT_LE(tree.getRegionLevels()[1].size(), tree.getRegionLevels()[0].size());
+    }
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     ::testing::AddGlobalTestEnvironment(new MotionRegionConsolidatorTestEnvironment());
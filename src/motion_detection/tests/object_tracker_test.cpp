@@ -0,0 +1,202 @@
+#include "object_tracker.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "logger.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("debug", "object_tracker_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class ObjectTrackerTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const objectTrackerEnv =
+    ::testing::AddGlobalTestEnvironment(new ObjectTrackerTestEnvironment());
+
+// ============================================================================
+// STORAGE
+// ============================================================================
+
+TEST(TrackedObjectStoreTest, RingBufferKeepsNewestValues) {
+    FixedRingBuffer<int, 4> ring;
+    for (int i = 0; i < 6; ++i) ring.push(i);
+    ASSERT_EQ(ring.size(), 4u);
+    EXPECT_EQ(ring.front(), 2);
+    EXPECT_EQ(ring.back(), 5);
+
+    ring.truncateFront(2);
+    ASSERT_EQ(ring.size(), 2u);
+    EXPECT_EQ(ring[0], 4);
+    EXPECT_EQ(ring[1], 5);
+}
+
+TEST(TrackedObjectStoreTest, RemoveRowsKeepsOrderAndDropsColdData) {
+    TrackedObjectStore store;
+    store.add(10, cv::Rect(0, 0, 10, 10));
+    store.add(11, cv::Rect(20, 0, 10, 10));
+    store.add(12, cv::Rect(40, 0, 10, 10));
+    store.cold(11).classLabel = "sparrow";
+    store.cold(12).classLabel = "finch";
+
+    store.removeRows({0, 1, 0});
+    ASSERT_EQ(store.size(), 2u);
+    EXPECT_EQ(store.ids(), (std::vector<int>{10, 12}));
+    EXPECT_EQ(store.bounds(1), cv::Rect(40, 0, 10, 10));
+    EXPECT_EQ(store.findCold(11), nullptr);
+
+    TrackedObject object = store.toTrackedObject(1);
+    EXPECT_EQ(object.id, 12);
+    EXPECT_EQ(object.uuid, "uuid_12");
+    EXPECT_EQ(object.classLabel, "finch");
+    EXPECT_EQ(object.trajectory.size(), 1u);
+}
+
+// ============================================================================
+// ASSOCIATION
+// ============================================================================
+
+TEST(ObjectTrackerTest, KeepsIdsForMovingBoxes) {
+    ObjectTracker tracker;
+
+    auto first = tracker.update({cv::Rect(100, 100, 40, 40), cv::Rect(500, 300, 60, 30)});
+    ASSERT_EQ(first.size(), 2u);
+    EXPECT_NE(first[0].id, first[1].id);
+
+    // Both boxes drift a few pixels and arrive in the opposite order
+    auto second = tracker.update({cv::Rect(505, 302, 60, 30), cv::Rect(104, 98, 40, 40)});
+    ASSERT_EQ(second.size(), 2u);
+    EXPECT_EQ(second[0].id, first[1].id);
+    EXPECT_EQ(second[1].id, first[0].id);
+    EXPECT_EQ(second[1].currentBounds, cv::Rect(104, 98, 40, 40));
+    EXPECT_EQ(second[1].trajectory.size(), 2u);
+    EXPECT_EQ(tracker.trackCount(), 2u);
+}
+
+TEST(ObjectTrackerTest, NewBoxesGetNewIds) {
+    ObjectTracker tracker;
+    auto first = tracker.update({cv::Rect(100, 100, 40, 40)});
+    auto second = tracker.update({cv::Rect(102, 100, 40, 40), cv::Rect(800, 600, 40, 40)});
+
+    ASSERT_EQ(second.size(), 2u);
+    EXPECT_EQ(second[0].id, first[0].id);
+    EXPECT_GT(second[1].id, first[0].id);
+}
+
+TEST(ObjectTrackerTest, EachDetectionMatchesOneTrack) {
+    ObjectTracker tracker;
+    tracker.update({cv::Rect(100, 100, 40, 40), cv::Rect(110, 100, 40, 40)});
+
+    // One detection overlapping both tracks takes the better one; the other track coasts
+    auto merged = tracker.update({cv::Rect(112, 100, 40, 40)});
+    ASSERT_EQ(merged.size(), 1u);
+    EXPECT_EQ(merged[0].framesWithoutDetection, 0);
+    EXPECT_EQ(tracker.trackCount(), 2u);
+}
+
+TEST(ObjectTrackerTest, DropsTracksAfterMissedFrames) {
+    TrackerConfig config;
+    config.maxFramesWithoutDetection = 2;
+    ObjectTracker tracker(config);
+
+    auto first = tracker.update({cv::Rect(100, 100, 40, 40)});
+    tracker.update({});
+    tracker.update({});
+    EXPECT_EQ(tracker.trackCount(), 1u);  // Coasting track survives maxFramesWithoutDetection
+
+    tracker.update({});
+    EXPECT_EQ(tracker.trackCount(), 0u);
+
+    auto reappeared = tracker.update({cv::Rect(100, 100, 40, 40)});
+    ASSERT_EQ(reappeared.size(), 1u);
+    EXPECT_NE(reappeared[0].id, first[0].id);
+}
+
+TEST(ObjectTrackerTest, KalmanPredictionFollowsFastBoxes) {
+    TrackerConfig config;
+    config.useKalman = true;
+    ObjectTracker kalmanTracker(config);
+    config.useKalman = false;
+    ObjectTracker plainTracker(config);
+
+    // A 40 px box accelerating from 10 to 30 px per frame: from 22 px per frame on,
+    // consecutive boxes overlap by less than the default minIou
+    int x = 100;
+    int speed = 10;
+    int kalmanId = -1;
+    int plainId = -1;
+    int kalmanIdChanges = 0;
+    int plainIdChanges = 0;
+    for (int f = 0; f < 20; ++f) {
+        const cv::Rect box(x, 200, 40, 40);
+        const int k = kalmanTracker.update({box})[0].id;
+        const int p = plainTracker.update({box})[0].id;
+        if (f > 0) {
+            kalmanIdChanges += k != kalmanId;
+            plainIdChanges += p != plainId;
+        }
+        kalmanId = k;
+        plainId = p;
+        x += speed;
+        speed = std::min(30, speed + 2);
+    }
+
+    EXPECT_GT(plainIdChanges, 0);
+    EXPECT_EQ(kalmanIdChanges, 0);
+}
+
+TEST(ObjectTrackerTest, PredictNextLeadsMovingBoxesWithoutAdvancingThem) {
+    TrackerConfig config;
+    config.useKalman = true;
+    ObjectTracker tracker(config);
+    for (int f = 0; f < 15; ++f) tracker.update({cv::Rect(100 + 12 * f, 200, 40, 40)});
+
+    // Last box at x = 268, moving 12 px per frame
+    std::vector<cv::Rect> next;
+    tracker.predictNext(next);
+    ASSERT_EQ(next.size(), 1u);
+    EXPECT_NEAR(next[0].x, 280, 3);
+    EXPECT_EQ(next[0].size(), cv::Size(40, 40));
+    std::vector<cv::Rect> again;
+    tracker.predictNext(again);
+    EXPECT_EQ(again, next);
+
+    config.useKalman = false;
+    ObjectTracker plain(config);
+    plain.update({cv::Rect(10, 10, 20, 20)});
+    plain.predictNext(next);
+    EXPECT_EQ(next, std::vector<cv::Rect>{cv::Rect(10, 10, 20, 20)});
+}
+
+TEST(ObjectTrackerTest, DetectionsMoveTracksAtTheirCentroids) {
+    ObjectTracker tracker;
+    TrackedObjectStore detected;
+    // A box whose mass sits in its lower left corner (a bird with a wing raised)
+    Detections detections;
+    detections.add(cv::Rect(100, 100, 40, 40), 600.0f, 0.7f, cv::Point2f(110.4f, 129.6f), 50.0f);
+    tracker.update(detections, detected);
+    ASSERT_EQ(detected.size(), 1u);
+    EXPECT_EQ(detected.smoothedCenter(0), cv::Point(110, 130));
+    EXPECT_EQ(detected.trajectory(0).back(), cv::Point(110, 130));
+
+    // Same track; the EMA moves halfway to the new centroid
+    detections.clear();
+    detections.add(cv::Rect(104, 100, 40, 40), 600.0f, 0.7f, cv::Point2f(120.0f, 130.0f), 50.0f);
+    const int id = detected.id(0);
+    tracker.update(detections, detected);
+    ASSERT_EQ(detected.size(), 1u);
+    EXPECT_EQ(detected.id(0), id);
+    EXPECT_EQ(detected.smoothedCenter(0), cv::Point(115, 130));
+}
@@ -0,0 +1,221 @@
+#include "offline_batch.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+#include <string>
+#include <vector>
+
+#include "logger.hpp"
+#include "motion_pipeline.hpp"
+#include "test_helpers.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("info", "offline_batch_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class OfflineBatchTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const offlineBatchEnv =
+    ::testing::AddGlobalTestEnvironment(new OfflineBatchTestEnvironment());
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// A bright box moving across a dark frame
+cv::Mat movingBoxFrame(int frame) {
+    cv::Mat image(120, 160, CV_8UC3, cv::Scalar(30, 30, 30));
+    cv::rectangle(image, cv::Rect(5 + (frame * 4) % 110, 40, 40, 30), cv::Scalar(220, 220, 220),
+                  cv::FILLED);
+    return image;
+}
+
+// OpenCV's built-in MJPEG writer, so the test does not depend on FFmpeg
+void writeTestVideo(const std::string& path, int frames, double fps) {
+    cv::VideoWriter writer(path, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), fps,
+                           cv::Size(160, 120));
+    ASSERT_TRUE(writer.isOpened());
+    for (int i = 0; i < frames; ++i) writer.write(movingBoxFrame(i));
+}
+
+}  // namespace
+
+TEST(OfflineBatchTest, SegmentsStartOnKeyframesWithWarmupBefore) {
+    // GOP of 30 frames, 100-frame segments with 40 frames of warm-up
+    std::vector<int64_t> keyframes;
+    for (int64_t frame = 0; frame < 400; frame += 30) keyframes.push_back(frame);
+    const std::vector<VideoSegment> segments =
+        OfflineBatchProcessor::planSegments(keyframes, 400, 100, 40);
+
+    ASSERT_EQ(segments.size(), 4u);
+    EXPECT_EQ(segments[0].warmupBegin, 0);
+    EXPECT_EQ(segments[0].begin, 0);
+    EXPECT_EQ(segments[0].end, 120);         // First keyframe at or after 100
+    EXPECT_EQ(segments[1].warmupBegin, 60);  // Last keyframe at or before 120 - 40
+    EXPECT_EQ(segments[1].begin, 120);
+    EXPECT_EQ(segments[1].end, 240);
+    EXPECT_EQ(segments[2].warmupBegin, 180);
+    EXPECT_EQ(segments[2].end, 360);
+    EXPECT_EQ(segments[3].begin, 360);
+    EXPECT_EQ(segments[3].end, 400);  // No keyframe left: runs to the end
+
+    // Without keyframes the cuts fall exactly every segmentFrames
+    const std::vector<VideoSegment> even = OfflineBatchProcessor::planSegments({}, 250, 100, 40);
+    ASSERT_EQ(even.size(), 3u);
+    EXPECT_EQ(even[1].warmupBegin, 60);
+    EXPECT_EQ(even[1].begin, 100);
+    EXPECT_EQ(even[2].begin, 200);
+    EXPECT_EQ(even[2].end, 250);
+
+    EXPECT_TRUE(OfflineBatchProcessor::planSegments(keyframes, 0, 100, 40).empty());
+}
+
+TEST(OfflineBatchTest, InputsExpandDirectoriesAndGlobs) {
+    const fs::path dir = fs::temp_directory_path() / "birds_offline_batch_inputs";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    for (const char* name : {"b.mp4", "a.AVI", "notes.txt"}) std::ofstream(dir / name) << "x";
+
+    const std::vector<std::string> fromDirectory =
+        OfflineBatchProcessor::expandInputs({dir.string()});
+    ASSERT_EQ(fromDirectory.size(), 2u);  // Video files only, sorted
+    EXPECT_EQ(fs::path(fromDirectory[0]).filename().string(), "a.AVI");
+    EXPECT_EQ(fs::path(fromDirectory[1]).filename().string(), "b.mp4");
+
+    const std::vector<std::string> fromGlob = OfflineBatchProcessor::expandInputs(
+        {(dir / "*.mp4").string(), (dir / "notes.txt").string()});
+    ASSERT_EQ(fromGlob.size(), 2u);  // A named file is taken as it is
+    EXPECT_EQ(fs::path(fromGlob[0]).filename().string(), "b.mp4");
+    EXPECT_EQ(fs::path(fromGlob[1]).filename().string(), "notes.txt");
+
+    EXPECT_THROW(OfflineBatchProcessor::expandInputs({(dir / "*.mkv").string()}),
+                 std::invalid_argument);
+    fs::remove_all(dir);
+}
+
+// Segments finish in any order; the sink still sees every frame once, in order, and motion
+// is found right after each cut (the warm-up hides the segment start)
+TEST(OfflineBatchTest, StitchesParallelSegmentsInFrameOrder) {
+    const fs::path dir = fs::temp_directory_path() / "birds_offline_batch_video";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    const std::string video = (dir / "clip.avi").string();
+    writeTestVideo(video, 60, 10.0);
+
+    OfflineBatchConfig batch;
+    batch.segmentSeconds = 2.0;  // 20 frames
+    batch.warmupSeconds = 1.0;   // 10 frames
+    batch.workers = 3;
+    OfflineBatchProcessor processor(PipelineConfig::load(findTestResourceDir() + "/config.yaml"),
+                                    batch);
+
+    std::mutex mutex;
+    std::vector<OfflineFrameDetections> frames;
+    size_t filesDone = 0;
+    const std::vector<OfflineFileSummary> summaries = processor.run(
+        {video},
+        [&](size_t file, const OfflineFrameDetections& frame) {
+            std::lock_guard<std::mutex> lock(mutex);
+            EXPECT_EQ(file, 0u);
+            frames.push_back(frame);
+        },
+        [&](const OfflineFileSummary&) { filesDone++; });
+
+    ASSERT_EQ(summaries.size(), 1u);
+    const OfflineFileSummary& summary = summaries[0];
+    EXPECT_TRUE(summary.error.empty()) << summary.error;
+    EXPECT_EQ(filesDone, 1u);
+    EXPECT_EQ(summary.segments, 3u);
+    EXPECT_EQ(summary.frames, 60);
+    EXPECT_EQ(summary.decodedFrames, 60 + 2 * 10);  // Two segments decode a warm-up
+
+    ASSERT_EQ(frames.size(), 60u);
+    for (size_t i = 0; i < frames.size(); ++i) {
+        EXPECT_EQ(frames[i].frame, static_cast<int64_t>(i));
+        EXPECT_DOUBLE_EQ(frames[i].seconds, static_cast<double>(i) / 10.0);
+    }
+    for (int begin : {20, 40}) {
+        int motionFrames = 0;
+        for (int i = begin; i < begin + 20; ++i) {
+            if (!frames[i].boxes.empty()) motionFrames++;
+            for (const cv::Rect& box : frames[i].boxes) {
+                EXPECT_LT(box.area(), 160 * 120 / 2) << "frame " << i;  // No cut artefact
+            }
+        }
+        EXPECT_GT(motionFrames, 10) << "segment at " << begin;
+    }
+    fs::remove_all(dir);
+}
+
+// Each sequence of a box batch gives what its own consolidator gives frame by frame,
+// whichever worker runs it; frames without boxes get no regions
+TEST(OfflineBatchTest, BoxBatchMatchesOneConsolidatorPerSequence) {
+    ConsolidationConfig config;
+    config.frameSize = cv::Size(640, 480);
+
+    // Three sequences of 10 frames: two flocks drifting right, every fourth frame empty
+    std::vector<cv::Rect> boxes;
+    std::vector<size_t> frameOffsets{0};
+    for (int sequence = 0; sequence < 3; ++sequence) {
+        for (int frame = 0; frame < 10; ++frame) {
+            if (frame % 4 != 3) {
+                for (int bird = 0; bird < 3 + sequence; ++bird) {
+                    boxes.emplace_back(40 + 8 * frame + 25 * bird, 60 + 10 * sequence, 20, 15);
+                    boxes.emplace_back(400 - 5 * frame + 22 * bird, 300, 18, 18);
+                }
+            }
+            frameOffsets.push_back(boxes.size());
+        }
+    }
+    const std::vector<size_t> starts{0, 10, 20};
+
+    const ConsolidatedBoxBatch batch = consolidateBoxBatch(boxes, frameOffsets, starts, config, 3);
+    ASSERT_EQ(batch.regionOffsets.size(), frameOffsets.size());
+    EXPECT_EQ(batch.regionOffsets.back(), batch.regions.size());
+
+    for (size_t s = 0; s < starts.size(); ++s) {
+        MotionRegionConsolidator consolidator(config);
+        for (size_t f = starts[s]; f < starts[s] + 10; ++f) {
+            const size_t begin = batch.regionOffsets[f];
+            const size_t end = batch.regionOffsets[f + 1];
+            if (frameOffsets[f] == frameOffsets[f + 1]) {
+                EXPECT_EQ(begin, end) << "frame " << f;
+                continue;
+            }
+            const std::vector<cv::Rect> frameBoxes(boxes.begin() + frameOffsets[f],
+                                                   boxes.begin() + frameOffsets[f + 1]);
+            const std::vector<ConsolidatedRegion> expected =
+                consolidator.consolidateRegions(makeTrackedObjects(frameBoxes));
+            ASSERT_EQ(end - begin, expected.size()) << "frame " << f;
+            EXPECT_GT(expected.size(), 0u);
+            for (size_t r = 0; r < expected.size(); ++r) {
+                const ConsolidatedRegion& region = batch.regions[begin + r];
+                EXPECT_EQ(region.boundingBox, expected[r].boundingBox) << "frame " << f;
+                EXPECT_EQ(region.framesSinceLastUpdate, expected[r].framesSinceLastUpdate);
+                ASSERT_EQ(region.trackedObjectIds.size(), expected[r].trackedObjectIds.size());
+                for (size_t i = 0; i < expected[r].trackedObjectIds.size(); ++i) {
+                    EXPECT_EQ(region.trackedObjectIds[i], expected[r].trackedObjectIds[i]);
+                }
+            }
+        }
+    }
+
+    EXPECT_THROW(consolidateBoxBatch(boxes, {0, 4}, {}, config), std::invalid_argument);
+    EXPECT_THROW(consolidateBoxBatch(boxes, frameOffsets, {0, 20, 10}, config), std::invalid_argument);
+    EXPECT_THROW(consolidateBoxBatch(boxes, frameOffsets, {5}, config), std::invalid_argument);
+}
@@ -0,0 +1,95 @@
+#include "passthrough_recorder.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include "encoded_packet_ring.hpp"
+#include "logger.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("debug", "passthrough_recorder_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class PassthroughRecorderTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const passthroughRecorderEnv =
+    ::testing::AddGlobalTestEnvironment(new PassthroughRecorderTestEnvironment());
+
+namespace {
+
+EncodedPacket makePacket(bool keyFrame, std::chrono::steady_clock::time_point arrival) {
+    EncodedPacket packet;
+    packet.data.assign(100, 0x42);
+    packet.keyFrame = keyFrame;
+    packet.arrival = arrival;
+    return packet;
+}
+
+}  // namespace
+
+TEST(EncodedPacketRingTest, StartsOnAKeyframe) {
+    EncodedPacketRing ring;
+    const auto t0 = std::chrono::steady_clock::now();
+    EXPECT_FALSE(ring.push(makePacket(false, t0)));
+    EXPECT_TRUE(ring.empty());
+    EXPECT_TRUE(ring.push(makePacket(true, t0)));
+    EXPECT_TRUE(ring.push(makePacket(false, t0)));
+    EXPECT_EQ(ring.size(), 2u);
+    EXPECT_EQ(ring.bytes(), 200u);
+}
+
+TEST(EncodedPacketRingTest, TrimsWholeGopsAndKeepsThePreRoll) {
+    EncodedPacketRing ring;
+    const auto t0 = std::chrono::steady_clock::now();
+    const auto at = [t0](int seconds) { return t0 + std::chrono::seconds(seconds); };
+    // GOPs starting at 0 s, 2 s and 4 s, one packet per second
+    for (int s = 0; s < 6; ++s) ring.push(makePacket(s % 2 == 0, at(s)));
+
+    // The GOP from 2 s has to stay to cover a cutoff at 3 s
+    ring.trim(at(3));
+    EXPECT_EQ(ring.size(), 4u);
+    EXPECT_TRUE(ring.front().keyFrame);
+    EXPECT_EQ(ring.front().arrival, at(2));
+
+    // Everything up to the last keyframe can go; the last GOP is always kept
+    ring.trim(at(10));
+    EXPECT_EQ(ring.size(), 2u);
+    EXPECT_EQ(ring.front().arrival, at(4));
+    EXPECT_EQ(ring.bytes(), 200u);
+
+    const auto packets = ring.takeAll();
+    EXPECT_EQ(packets.size(), 2u);
+    EXPECT_TRUE(ring.empty());
+    EXPECT_EQ(ring.bytes(), 0u);
+}
+
+TEST(PassthroughRecorderTest, FormatsWebVttTimestamps) {
+    EXPECT_EQ(PassthroughRecorder::webVttTimestamp(0.0), "00:00:00.000");
+    EXPECT_EQ(PassthroughRecorder::webVttTimestamp(61.2345), "00:01:01.235");
+    EXPECT_EQ(PassthroughRecorder::webVttTimestamp(3723.5), "01:02:03.500");
+    EXPECT_EQ(PassthroughRecorder::webVttTimestamp(-1.0), "00:00:00.000");
+}
+
+TEST(PassthroughRecorderTest, DoesNotStartWithoutASource) {
+    PassthroughConfig disabled;
+    PassthroughRecorder idle(disabled);
+    EXPECT_FALSE(idle.start());
+
+    PassthroughConfig noSource;
+    noSource.enabled = true;
+    PassthroughRecorder recorder(noSource);
+    EXPECT_FALSE(recorder.start());
+    recorder.addOverlay(std::chrono::steady_clock::now(), cv::Size(640, 480), {cv::Rect(1, 2, 3, 4)});
+    EXPECT_FALSE(recorder.getStats().recording);
+}
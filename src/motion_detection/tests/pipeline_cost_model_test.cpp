@@ -0,0 +1,140 @@
+#include "pipeline_cost_model.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "logger.hpp"
+#include "test_helpers.hpp"
+
+namespace fs = std::filesystem;
+
+void initLogger() {
+    try {
+        Logger::init("warn", "pipeline_cost_model_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class PipelineCostModelTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const pipelineCostModelEnv =
+    ::testing::AddGlobalTestEnvironment(new PipelineCostModelTestEnvironment());
+
+namespace {
+
+// 1 ms + 10 ms/MP for a quiet frame, twice that with motion, 0.05 ms per box to consolidate
+PipelineCostModel knownModel() {
+    PipelineCostModel model;
+    model.setStage(CostStage::QuietFrame, {1.0, 10.0});
+    model.setStage(CostStage::ActiveFrame, {2.0, 20.0});
+    model.setStage(CostStage::Consolidation, {0.0, 0.05});
+    model.setStage(CostStage::Encode, {0.0, 5.0});
+    model.setStage(CostStage::Preprocess, {0.0, 3.0});
+    model.setStage(CostStage::Detect, {0.0, 2.0});
+    model.setStage(CostStage::Morphology, {0.0, 1.0});
+    model.setStage(CostStage::Extraction, {0.0, 2.0});
+    return model;
+}
+
+}  // namespace
+
+TEST(PipelineCostModelTest, FitsALineThroughTheCalibrationPoints) {
+    const StageCostFit line = StageCostFit::fit({1.0, 2.0, 8.0}, {3.0, 5.0, 17.0});
+    EXPECT_NEAR(line.fixedMs, 1.0, 1e-9);
+    EXPECT_NEAR(line.perUnitMs, 2.0, 1e-9);
+    EXPECT_NEAR(line.at(4.0), 9.0, 1e-9);
+
+    // A negative intercept is not a free small stream
+    const StageCostFit steep = StageCostFit::fit({1.0, 2.0}, {1.0, 4.0});
+    EXPECT_EQ(steep.fixedMs, 0.0);
+    EXPECT_GT(steep.perUnitMs, 0.0);
+
+    const StageCostFit single = StageCostFit::fit({2.0}, {6.0});
+    EXPECT_EQ(single.fixedMs, 0.0);
+    EXPECT_DOUBLE_EQ(single.perUnitMs, 3.0);
+    EXPECT_EQ(StageCostFit::fit({}, {}).at(5.0), 0.0);
+}
+
+TEST(PipelineCostModelTest, EstimatesCoresAndStreamsPerNode) {
+    PipelineCostModel model = knownModel();
+    StreamWorkload workload;
+    workload.resolution = cv::Size(1000, 1000);  // 1 MP
+    workload.fps = 10.0;
+    workload.activity = 0.5;
+    workload.boxesPerActiveFrame = 20.0;
+    workload.savedFramesPerSecond = 2.0;
+
+    // 0.5 x 11 + 0.5 x (22 + 1) ms per frame, plus two 5 ms encodes per second
+    StreamCostEstimate cost = model.estimate(workload);
+    EXPECT_NEAR(cost.cpuMsPerFrame, 17.0, 1e-9);
+    EXPECT_NEAR(cost.encodeMsPerSecond, 10.0, 1e-9);
+    EXPECT_NEAR(cost.cpuCores, 0.18, 1e-9);
+    EXPECT_EQ(cost.gpuShare, 0.0);
+    EXPECT_EQ(model.maxStreamsPerNode(workload, 4, 0.75), 16u);
+
+    // On the device, preprocessing through morphology (6 of the steps' 8 ms) leave the CPU
+    model.setDeviceStages(true);
+    cost = model.estimate(workload);
+    EXPECT_NEAR(cost.gpuMsPerFrame, 16.5 * 0.75, 1e-9);
+    EXPECT_NEAR(cost.cpuMsPerFrame, 17.0 - 16.5 * 0.75, 1e-9);
+    EXPECT_NEAR(cost.gpuShare, 0.12375, 1e-9);
+    EXPECT_EQ(model.maxStreamsPerNode(workload, 4, 0.75, 1), 6u);  // The one device is the limit
+    EXPECT_EQ(model.maxStreamsPerNode(workload, 4, 0.75, 2), 12u);
+
+    EXPECT_EQ(PipelineCostModel().maxStreamsPerNode(workload, 4, 0.75), 0u);  // Not calibrated
+}
+
+TEST(PipelineCostModelTest, SavesAndLoadsACalibration) {
+    const std::string path = (fs::temp_directory_path() / ("cost_model_" + std::to_string(::getpid()) + ".yaml")).string();
+    PipelineCostModel model = knownModel();
+    model.setDeviceStages(true);
+    model.save(path);
+
+    const PipelineCostModel loaded = PipelineCostModel::load(path);
+    EXPECT_TRUE(loaded.deviceStages());
+    for (size_t i = 0; i < static_cast<size_t>(CostStage::Count); ++i) {
+        const CostStage stage = static_cast<CostStage>(i);
+        EXPECT_DOUBLE_EQ(loaded.stage(stage).fixedMs, model.stage(stage).fixedMs) << costStageName(stage);
+        EXPECT_DOUBLE_EQ(loaded.stage(stage).perUnitMs, model.stage(stage).perUnitMs) << costStageName(stage);
+    }
+
+    std::ofstream(path, std::ios::trunc) << "detection_scale: 0.5\n";
+    EXPECT_THROW(PipelineCostModel::load(path), std::runtime_error);
+    fs::remove(path);
+    EXPECT_THROW(PipelineCostModel::load(path), std::runtime_error);
+}
+
+// A short calibration on small frames gives a usable, growing model
+TEST(PipelineCostModelTest, CalibratesOnThisHost) {
+    CalibrationSettings settings;
+    settings.resolutions = {{320, 240}, {640, 480}};
+    settings.boxCounts = {8, 32};
+    settings.frames = 3;
+    const PipelineCostModel model =
+        PipelineCostModel::calibrate(PipelineConfig::load(findTestResourceDir() + "/config.yaml"), settings);
+
+    for (size_t i = 0; i < static_cast<size_t>(CostStage::Count); ++i) {
+        const StageCostFit& fit = model.stage(static_cast<CostStage>(i));
+        EXPECT_GE(fit.fixedMs, 0.0) << costStageName(static_cast<CostStage>(i));
+        EXPECT_GE(fit.perUnitMs, 0.0) << costStageName(static_cast<CostStage>(i));
+    }
+    StreamWorkload small;
+    small.resolution = cv::Size(320, 240);
+    StreamWorkload large = small;
+    large.resolution = cv::Size(640, 480);
+    EXPECT_GT(model.estimate(small).cpuCores, 0.0);
+    EXPECT_GE(model.estimate(large).cpuCores, model.estimate(small).cpuCores);
+    EXPECT_GE(model.maxStreamsPerNode(small, 4, 0.75), model.maxStreamsPerNode(large, 4, 0.75));
+}
@@ -0,0 +1,153 @@
+#include "preview_server.hpp"
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <opencv2/imgproc.hpp>
+#include <string>
+#include <thread>
+
+#include "logger.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("debug", "preview_server_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class PreviewServerTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const previewServerEnv =
+    ::testing::AddGlobalTestEnvironment(new PreviewServerTestEnvironment());
+
+namespace {
+
+// Connects to 127.0.0.1:port and sends a GET for @p path; -1 on failure
+int openRequest(int port, const std::string& path) {
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    ::inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    timeval timeout{};
+    timeout.tv_sec = 2;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    const std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    ::send(fd, request.data(), request.size(), 0);
+    return fd;
+}
+
+// Reads from @p fd until @p needle has been received (or the timeout / end of stream)
+std::string readUntil(int fd, const std::string& needle) {
+    std::string received;
+    char buffer[4096];
+    while (received.find(needle) == std::string::npos) {
+        const ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) break;
+        received.append(buffer, static_cast<size_t>(n));
+    }
+    return received;
+}
+
+template <typename Predicate>
+bool waitFor(Predicate predicate) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+    while (!predicate()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+PreviewConfig testConfig() {
+    PreviewConfig config;
+    config.port = 0;
+    config.width = 320;
+    config.fps = 2.0;
+    return config;
+}
+
+}  // namespace
+
+TEST(PreviewServerTest, EncodesNothingWithoutViewers) {
+    PreviewServer server(testConfig());
+    ASSERT_TRUE(server.start());
+    EXPECT_FALSE(server.wantsFrame());
+
+    // The page and unknown paths do not count as viewers
+    const int page = openRequest(server.port(), "/");
+    const std::string response = readUntil(page, "</html>");
+    ::close(page);
+    EXPECT_NE(response.find("HTTP/1.1 200 OK"), std::string::npos);
+    EXPECT_NE(response.find("<img src=\"/stream\""), std::string::npos);
+    const int missing = openRequest(server.port(), "/metrics");
+    EXPECT_NE(readUntil(missing, "\r\n\r\n").find("404 Not Found"), std::string::npos);
+    ::close(missing);
+
+    EXPECT_EQ(server.viewers(), 0);
+    EXPECT_FALSE(server.wantsFrame());
+    server.offer(cv::Mat(480, 640, CV_8UC3, cv::Scalar(10, 20, 30)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    EXPECT_EQ(server.framesEncoded(), 0u);
+    server.stop();
+}
+
+TEST(PreviewServerTest, StreamsScaledOverlaidFramesAtTheConfiguredRate) {
+    PreviewServer server(testConfig());
+    ASSERT_TRUE(server.start());
+
+    const int viewer = openRequest(server.port(), "/stream");
+    ASSERT_GE(viewer, 0);
+    const std::string headers = readUntil(viewer, "\r\n\r\n");
+    EXPECT_NE(headers.find("multipart/x-mixed-replace; boundary="), std::string::npos);
+    ASSERT_TRUE(waitFor([&] { return server.viewers() == 1; }));
+    EXPECT_TRUE(server.wantsFrame());
+
+    std::atomic<double> overlayScale{0.0};
+    std::atomic<int> overlayWidth{0};
+    server.offer(cv::Mat(480, 640, CV_8UC1, cv::Scalar(128)), [&](cv::Mat& preview, double scale) {
+        cv::rectangle(preview, cv::Rect(10, 10, 20, 20), cv::Scalar(0, 0, 255), 2);
+        overlayWidth = preview.cols;
+        overlayScale = scale;
+    });
+    // The next frame is not due for another 1 / fps
+    EXPECT_FALSE(server.wantsFrame());
+
+    const std::string part = readUntil(viewer, "\xFF\xD8\xFF");
+    EXPECT_NE(part.find("Content-Type: image/jpeg"), std::string::npos);
+    EXPECT_NE(part.find("\xFF\xD8\xFF"), std::string::npos);
+    EXPECT_EQ(overlayWidth.load(), 320);
+    EXPECT_DOUBLE_EQ(overlayScale.load(), 0.5);
+    EXPECT_EQ(server.framesEncoded(), 1u);
+    ASSERT_TRUE(waitFor([&] { return server.wantsFrame(); }));
+
+    // A viewer that hung up is dropped on the next frame
+    ::close(viewer);
+    server.offer(cv::Mat(480, 640, CV_8UC3, cv::Scalar(10, 20, 30)));
+    ASSERT_TRUE(waitFor([&] {
+        if (server.viewers() == 0) return true;
+        if (server.wantsFrame()) server.offer(cv::Mat(480, 640, CV_8UC3, cv::Scalar(10, 20, 30)));
+        return false;
+    }));
+    EXPECT_FALSE(server.wantsFrame());
+    server.stop();
+    EXPECT_FALSE(server.isRunning());
+}
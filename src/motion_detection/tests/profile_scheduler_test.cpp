@@ -0,0 +1,143 @@
+#include "profile_scheduler.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <stdexcept>
+
+namespace {
+
+using Clock = ProfileScheduler::Clock;
+
+// Local wall clock time of today at hh:mm
+std::time_t todayAt(int hour, int minute) {
+    std::time_t now = std::time(nullptr);
+    std::tm local{};
+    localtime_r(&now, &local);
+    local.tm_hour = hour;
+    local.tm_min = minute;
+    local.tm_sec = 0;
+    local.tm_isdst = -1;
+    return std::mktime(&local);
+}
+
+ProfileScheduleConfig nightConfig() {
+    return ProfileScheduleConfig::parse(YAML::Load(R"(
+enabled: true
+check_interval_s: 0
+profiles:
+  quiet:
+    max_fps: 2
+    inference: false
+    overrides:
+      detection_method: block
+  active: {}
+schedule:
+  - profile: quiet
+    from: "22:00"
+    to: "06:00"
+activity:
+  profile: active
+  min_frames: 3
+  window_s: 10
+  hold_s: 60
+)"));
+}
+
+}  // namespace
+
+TEST(DayTimeTest, ParsesClockAndSunAnchors) {
+    DayTime clock = DayTime::parse("06:30");
+    EXPECT_EQ(clock.anchor, DayTime::Anchor::CLOCK);
+    EXPECT_EQ(clock.minutes, 390);
+
+    DayTime sunset = DayTime::parse("sunset+30");
+    EXPECT_EQ(sunset.anchor, DayTime::Anchor::SUNSET);
+    EXPECT_EQ(sunset.minutes, 30);
+
+    DayTime sunrise = DayTime::parse("Sunrise - 45");
+    EXPECT_EQ(sunrise.anchor, DayTime::Anchor::SUNRISE);
+    EXPECT_EQ(sunrise.minutes, -45);
+
+    EXPECT_THROW(DayTime::parse("25:00"), std::invalid_argument);
+    EXPECT_THROW(DayTime::parse("noon"), std::invalid_argument);
+    EXPECT_THROW(DayTime::parse("sunset+x"), std::invalid_argument);
+}
+
+TEST(ProfileScheduleConfigTest, RejectsUnknownProfiles) {
+    EXPECT_THROW(ProfileScheduleConfig::parse(YAML::Load(R"(
+profiles: {quiet: {}}
+schedule: [{profile: night, from: "22:00", to: "06:00"}]
+)")),
+                 std::invalid_argument);
+    EXPECT_THROW(ProfileScheduleConfig::parse(YAML::Load("profiles: {quiet: {}}\ndefault_profile: day")),
+                 std::invalid_argument);
+    EXPECT_THROW(ProfileScheduleConfig::parse(YAML::Load("profiles: {quiet: {max_fps: -1}}")),
+                 std::invalid_argument);
+}
+
+TEST(SunEventTest, EquinoxAtTheEquatorIsNearSixAndEighteen) {
+    // Day 80 (around March 21) at 0/0, UTC
+    const double sunrise = sunEventMinutes(80, 0.0, 0.0, true, 0);
+    const double sunset = sunEventMinutes(80, 0.0, 0.0, false, 0);
+    EXPECT_NEAR(sunrise, 6 * 60, 15);
+    EXPECT_NEAR(sunset, 18 * 60 + 10, 15);
+    // Longitude shifts UTC times by 4 minutes a degree; the local offset shifts them back
+    EXPECT_NEAR(sunEventMinutes(80, 0.0, 15.0, true, 60), sunrise, 1.0);
+}
+
+TEST(SunEventTest, PolarNightHasNoSunrise) {
+    EXPECT_LT(sunEventMinutes(355, 80.0, 0.0, true, 0), 0.0);  // Late December, 80 degrees north
+    EXPECT_GT(sunEventMinutes(172, 51.5, 0.0, true, 0), 0.0);  // London, June
+}
+
+TEST(ProfileSchedulerTest, FollowsTheClockScheduleAcrossMidnight) {
+    ProfileScheduler scheduler(nightConfig());
+    const Clock::time_point start = Clock::now();
+
+    EXPECT_TRUE(scheduler.update(todayAt(23, 0), start));
+    ASSERT_NE(scheduler.current(), nullptr);
+    EXPECT_EQ(scheduler.currentName(), "quiet");
+    EXPECT_FALSE(scheduler.current()->inference);
+
+    EXPECT_FALSE(scheduler.update(todayAt(3, 0), start + std::chrono::seconds(1)));  // Still quiet
+    EXPECT_TRUE(scheduler.update(todayAt(12, 0), start + std::chrono::seconds(2)));
+    EXPECT_EQ(scheduler.current(), nullptr);  // No default profile: the file's settings
+    EXPECT_EQ(scheduler.switches(), 2u);
+}
+
+TEST(ProfileSchedulerTest, ActivityOverridesTheScheduleUntilTheHoldExpires) {
+    ProfileScheduler scheduler(nightConfig());
+    const Clock::time_point start = Clock::now();
+    const std::time_t night = todayAt(23, 0);
+    scheduler.update(night, start);
+    ASSERT_EQ(scheduler.currentName(), "quiet");
+
+    // Two active frames are not yet activity
+    scheduler.recordActivity(true, start + std::chrono::seconds(1));
+    scheduler.recordActivity(true, start + std::chrono::seconds(2));
+    EXPECT_FALSE(scheduler.update(night, start + std::chrono::seconds(2)));
+    scheduler.recordActivity(true, start + std::chrono::seconds(3));
+    EXPECT_TRUE(scheduler.update(night, start + std::chrono::seconds(3)));
+    EXPECT_EQ(scheduler.currentName(), "active");
+
+    EXPECT_FALSE(scheduler.update(night, start + std::chrono::seconds(50)));
+    EXPECT_TRUE(scheduler.update(night, start + std::chrono::seconds(64)));
+    EXPECT_EQ(scheduler.currentName(), "quiet");
+}
+
+TEST(ProfileSchedulerTest, AdmitCapsTheProcessingRate) {
+    ProfileScheduler scheduler(nightConfig());
+    const Clock::time_point start = Clock::now();
+    EXPECT_TRUE(scheduler.admit(start));  // No profile yet: every frame
+    scheduler.update(todayAt(23, 0), start);
+
+    // 30 fps capture for two seconds at max_fps 2
+    int admitted = 0;
+    for (int i = 0; i < 60; ++i) {
+        if (scheduler.admit(start + std::chrono::milliseconds(i * 1000 / 30))) admitted++;
+    }
+    EXPECT_EQ(admitted, 4);
+}
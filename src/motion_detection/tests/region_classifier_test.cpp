@@ -0,0 +1,279 @@
+#include "region_classifier.hpp"
+
+#include <gtest/gtest.h>
+
+#include <opencv2/opencv.hpp>
+
+#include "logger.hpp"
+#include "region_mosaic_packer.hpp"
+#include "region_tensor_builder.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("debug", "region_classifier_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class RegionClassifierTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const regionClassifierEnv =
+    ::testing::AddGlobalTestEnvironment(new RegionClassifierTestEnvironment());
+
+namespace {
+
+// YOLO-style output [batch, 4 + classes, anchors], all scores zero
+cv::Mat makeOutput(int batch, int classes, int anchors) {
+    const int sizes[] = {batch, 4 + classes, anchors};
+    return cv::Mat(3, sizes, CV_32F, cv::Scalar(0));
+}
+
+void setScore(cv::Mat& output, int item, int classId, int anchor, float score) {
+    output.at<float>(item, 4 + classId, anchor) = score;
+}
+
+}  // namespace
+
+TEST(RegionClassifierTest, PicksTheBestClassOfEachItem) {
+    cv::Mat output = makeOutput(2, 3, 10);
+    setScore(output, 0, 1, 4, 0.9f);
+    setScore(output, 0, 2, 7, 0.6f);
+    setScore(output, 1, 0, 2, 0.3f);
+    setScore(output, 1, 2, 9, 0.8f);
+    const std::vector<std::string> names = {"sparrow", "finch", "robin"};
+
+    const RegionClassification first = RegionClassifier::bestDetection(output, 0, names, 0.5f);
+    EXPECT_EQ(first.classId, 1);
+    EXPECT_EQ(first.label, "finch");
+    EXPECT_FLOAT_EQ(first.confidence, 0.9f);
+
+    const RegionClassification second = RegionClassifier::bestDetection(output, 1, names, 0.5f);
+    EXPECT_EQ(second.classId, 2);
+    EXPECT_EQ(second.label, "robin");
+}
+
+TEST(RegionClassifierTest, BelowThresholdStaysUnknown) {
+    cv::Mat output = makeOutput(1, 3, 10);
+    setScore(output, 0, 0, 0, 0.4f);
+
+    const RegionClassification result = RegionClassifier::bestDetection(output, 0, {"a", "b", "c"}, 0.5f);
+    EXPECT_EQ(result.classId, -1);
+    EXPECT_EQ(result.label, "unknown");
+    EXPECT_FLOAT_EQ(result.confidence, 0.0f);
+}
+
+TEST(RegionClassifierTest, AcceptsTransposedOutput) {
+    // [1, anchors, 4 + classes] with more anchors than rows
+    const int sizes[] = {1, 20, 6};
+    cv::Mat output(3, sizes, CV_32F, cv::Scalar(0));
+    output.at<float>(0, 13, 4 + 1) = 0.7f;
+
+    const RegionClassification result = RegionClassifier::bestDetection(output, 0, {"a"}, 0.5f);
+    EXPECT_EQ(result.classId, 1);
+    EXPECT_EQ(result.label, "class_1");  // No name for this ID
+}
+
+TEST(RegionClassifierTest, LetterboxKeepsAspectRatio) {
+    const cv::Mat crop(50, 100, CV_8UC3, cv::Scalar(0, 0, 255));
+    cv::Mat canvas;
+    RegionClassifier::letterbox(crop, 64, canvas);
+
+    ASSERT_EQ(canvas.size(), cv::Size(64, 64));
+    ASSERT_EQ(canvas.type(), CV_8UC3);
+    EXPECT_EQ(canvas.at<cv::Vec3b>(32, 32), cv::Vec3b(0, 0, 255));       // Crop, centered
+    EXPECT_EQ(canvas.at<cv::Vec3b>(2, 32), cv::Vec3b(114, 114, 114));    // Padding above
+    EXPECT_EQ(canvas.at<cv::Vec3b>(61, 32), cv::Vec3b(114, 114, 114));   // and below
+
+    const cv::Mat gray(30, 30, CV_8UC1, cv::Scalar(200));
+    RegionClassifier::letterbox(gray, 64, canvas);
+    EXPECT_EQ(canvas.at<cv::Vec3b>(32, 32), cv::Vec3b(200, 200, 200));
+}
+
+TEST(RegionClassifierTest, MissingModelLeavesTheClassifierDisabled) {
+    RegionClassifierConfig config;
+    config.enabled = true;
+    config.modelPath = "does/not/exist.onnx";
+    RegionClassifier classifier(config);
+    EXPECT_FALSE(classifier.isEnabled());
+
+    const cv::Mat frame(100, 100, CV_8UC3, cv::Scalar::all(0));
+    const auto results = classifier.classify(frame, {cv::Rect(10, 10, 20, 20)});
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_EQ(results[0].label, "unknown");
+
+    std::vector<ConsolidatedRegion> regions = {ConsolidatedRegion(cv::Rect(10, 10, 20, 20), {1})};
+    TrackedObjectStore objects;
+    EXPECT_EQ(classifier.classifyRegions(frame, regions, objects), 0u);
+    EXPECT_EQ(regions[0].classId, -1);
+}
+
+TEST(RegionClassifierTest, CocoNamesIncludeBird) {
+    const auto& names = RegionClassifier::cocoClassNames();
+    ASSERT_EQ(names.size(), 80u);
+    EXPECT_EQ(names[14], "bird");
+}
+
+TEST(RegionClassifierTest, AreaLimitsTheDetectionToAnchorsCenteredInIt) {
+    cv::Mat output = makeOutput(1, 2, 8);
+    // Anchor 0 at (50, 50) scores higher than anchor 1 at (400, 300)
+    const float boxes[2][4] = {{50, 50, 20, 10}, {400, 300, 40, 30}};
+    for (int anchor = 0; anchor < 2; ++anchor) {
+        for (int row = 0; row < 4; ++row) output.at<float>(0, row, anchor) = boxes[anchor][row];
+    }
+    setScore(output, 0, 0, 0, 0.9f);
+    setScore(output, 0, 1, 1, 0.7f);
+
+    const RegionClassification all = RegionClassifier::bestDetection(output, 0, {"a", "b"}, 0.5f);
+    EXPECT_EQ(all.classId, 0);
+    EXPECT_EQ(all.box, cv::Rect2f(40, 45, 20, 10));
+
+    const RegionClassification inArea =
+        RegionClassifier::bestDetection(output, 0, {"a", "b"}, 0.5f, cv::Rect(300, 200, 200, 200));
+    EXPECT_EQ(inArea.classId, 1);
+    EXPECT_EQ(inArea.box, cv::Rect2f(380, 285, 40, 30));
+}
+
+// ============================================================================
+// MOSAIC
+// ============================================================================
+
+namespace {
+
+bool placementsOverlap(const MosaicTile& tile) {
+    for (size_t i = 0; i < tile.placements.size(); ++i) {
+        for (size_t j = i + 1; j < tile.placements.size(); ++j) {
+            if ((tile.placements[i].target & tile.placements[j].target).area() > 0) return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+TEST(RegionMosaicPackerTest, SmallRegionsShareATileAndLargeOnesGetTheirOwn) {
+    RegionMosaicConfig config;
+    config.enabled = true;
+    const RegionMosaicPacker packer(config);
+    const std::vector<cv::Size> sizes = {cv::Size(100, 80), cv::Size(60, 60), cv::Size(500, 300),
+                                         cv::Size(120, 40), cv::Size()};
+
+    const std::vector<MosaicTile> tiles = packer.pack(sizes);
+    ASSERT_EQ(tiles.size(), 2u);
+    ASSERT_EQ(tiles[0].placements.size(), 1u);  // 500 px is within 30% of 640
+    EXPECT_EQ(tiles[0].placements[0].item, 2u);
+    EXPECT_DOUBLE_EQ(tiles[0].placements[0].scale, 640.0 / 500.0);
+
+    ASSERT_EQ(tiles[1].placements.size(), 3u);
+    EXPECT_FALSE(placementsOverlap(tiles[1]));
+    for (const MosaicPlacement& placement : tiles[1].placements) {
+        EXPECT_DOUBLE_EQ(placement.scale, 1.0);  // Small regions keep their resolution
+        EXPECT_EQ(placement.target.size(), sizes[placement.item]);
+        EXPECT_EQ(placement.target & cv::Rect(0, 0, 640, 640), placement.target);
+    }
+}
+
+TEST(RegionMosaicPackerTest, OverflowingRegionsOpenMoreTiles) {
+    RegionMosaicConfig config;
+    config.enabled = true;
+    const RegionMosaicPacker packer(config);
+    const std::vector<cv::Size> sizes(20, cv::Size(200, 200));
+
+    // Three shelves of three per 640 tile (with 4 px spacing): 9 + 9 + 2
+    const std::vector<MosaicTile> tiles = packer.pack(sizes);
+    ASSERT_EQ(tiles.size(), 3u);
+    EXPECT_EQ(tiles[0].placements.size(), 9u);
+    EXPECT_EQ(tiles[2].placements.size(), 2u);
+    for (const MosaicTile& tile : tiles) EXPECT_FALSE(placementsOverlap(tile));
+}
+
+TEST(RegionMosaicPackerTest, MapsTileBoxesBackToTheCrop) {
+    const RegionMosaicPacker packer(RegionMosaicConfig{});
+    const std::vector<MosaicTile> tiles = packer.pack({cv::Size(1280, 720)});
+    ASSERT_EQ(tiles.size(), 1u);
+    const MosaicPlacement& placement = tiles[0].placements[0];
+    EXPECT_EQ(placement.target, cv::Rect(0, 140, 640, 360));  // Letterboxed at half scale
+
+    const cv::Rect2f source = RegionMosaicPacker::toSource(placement, cv::Rect2f(100, 200, 50, 40));
+    EXPECT_EQ(source, cv::Rect2f(200, 120, 100, 80));
+}
+
+TEST(RegionMosaicPackerTest, RendersEveryCropAtItsPlacement) {
+    RegionMosaicConfig config;
+    config.enabled = true;
+    config.tileSize = 128;
+    const RegionMosaicPacker packer(config);
+    const std::vector<cv::Mat> crops = {cv::Mat(30, 40, CV_8UC3, cv::Scalar(0, 0, 255)),
+                                        cv::Mat(20, 20, CV_8UC1, cv::Scalar(200))};
+    const std::vector<MosaicTile> tiles = packer.pack({crops[0].size(), crops[1].size()});
+    ASSERT_EQ(tiles.size(), 1u);
+
+    cv::Mat canvas;
+    packer.render(crops, tiles[0], canvas);
+    ASSERT_EQ(canvas.size(), cv::Size(128, 128));
+    for (const MosaicPlacement& placement : tiles[0].placements) {
+        const cv::Point center = (placement.target.tl() + placement.target.br()) / 2;
+        const cv::Vec3b expected = placement.item == 0 ? cv::Vec3b(0, 0, 255) : cv::Vec3b(200, 200, 200);
+        EXPECT_EQ(canvas.at<cv::Vec3b>(center), expected);
+    }
+    EXPECT_EQ(canvas.at<cv::Vec3b>(127, 127), cv::Vec3b(114, 114, 114));
+}
+
+TEST(RegionTensorBuilderTest, DeviceTensorMatchesTheRenderedTiles) {
+    RegionMosaicConfig config;
+    config.enabled = true;
+    config.tileSize = 128;
+    const RegionMosaicPacker packer(config);
+    cv::Mat frame(240, 320, CV_8UC3);
+    for (int y = 0; y < frame.rows; ++y) {
+        for (int x = 0; x < frame.cols; ++x) frame.at<cv::Vec3b>(y, x) = cv::Vec3b(x % 256, y % 256, (x + y) % 256);
+    }
+    // Two small crops share a tile, the large one is letterboxed (downscaled) into its own
+    const std::vector<cv::Rect> rects = {cv::Rect(10, 20, 40, 30), cv::Rect(200, 100, 24, 24),
+                                         cv::Rect(0, 0, 300, 200)};
+    std::vector<cv::Mat> crops;
+    std::vector<cv::Size> sizes;
+    for (const cv::Rect& rect : rects) {
+        crops.push_back(frame(rect));
+        sizes.push_back(rect.size());
+    }
+    const std::vector<MosaicTile> tiles = packer.pack(sizes);
+    ASSERT_EQ(tiles.size(), 2u);
+
+    RegionTensorBuilder builder(4, 128);
+    std::vector<TensorPlacement> placements;
+    for (size_t item = 0; item < tiles.size(); ++item) {
+        for (const MosaicPlacement& placement : tiles[item].placements) {
+            placements.push_back({static_cast<int>(item), rects[placement.item], placement.target});
+        }
+    }
+    const bool built = builder.build(frame, placements, static_cast<int>(tiles.size()));
+    // Without an OpenCL device the classifier keeps the host path
+    EXPECT_EQ(builder.onDevice(), cv::ocl::haveOpenCL());
+    EXPECT_EQ(built, builder.onDevice());
+    if (!built) return;
+
+    const cv::UMat deviceTensor = builder.tensor(static_cast<int>(tiles.size()));
+    const cv::Mat tensor = deviceTensor.getMat(cv::ACCESS_READ);
+    ASSERT_EQ(tensor.size[0], 2);
+    cv::Mat canvas;
+    for (size_t item = 0; item < tiles.size(); ++item) {
+        packer.render(crops, tiles[item], canvas);
+        std::vector<cv::Mat> bgr;
+        cv::split(canvas, bgr);
+        for (int plane = 0; plane < 3; ++plane) {
+            const cv::Mat actual(128, 128, CV_32F,
+                                 const_cast<float*>(tensor.ptr<float>(static_cast<int>(item), plane)));
+            cv::Mat expected;
+            bgr[2 - plane].convertTo(expected, CV_32F, 1.0 / 255.0);  // RGB planes
+            // cv::resize rounds in fixed point; the kernel interpolates in float
+            EXPECT_LE(cv::norm(actual, expected, cv::NORM_INF), 2.0 / 255.0) << "item " << item << " plane " << plane;
+        }
+    }
+}
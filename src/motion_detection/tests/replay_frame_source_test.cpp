@@ -0,0 +1,139 @@
+#include "replay_frame_source.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <opencv2/opencv.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "logger.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("debug", "replay_frame_source_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class ReplayFrameSourceTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const replayFrameSourceEnv =
+    ::testing::AddGlobalTestEnvironment(new ReplayFrameSourceTestEnvironment());
+
+namespace {
+
+std::vector<cv::Mat> syntheticFrames(int count, int type) {
+    std::vector<cv::Mat> frames;
+    for (int i = 0; i < count; ++i) {
+        cv::Mat frame(48, 64, type, cv::Scalar::all(20));
+        cv::rectangle(frame, cv::Rect(4 + 6 * i, 10, 12, 8), cv::Scalar::all(200), cv::FILLED);
+        frames.push_back(frame);
+    }
+    return frames;
+}
+
+}  // namespace
+
+TEST(ReplayFrameSourceTest, RawDumpRoundTripsThroughMapping) {
+    const std::string path = (std::filesystem::temp_directory_path() / "replay_frame_source_test.raw").string();
+    const std::vector<cv::Mat> frames = syntheticFrames(5, CV_8UC3);
+    ReplayFrameSource::writeRawDump(path, frames);
+
+    ReplayFrameSource source = ReplayFrameSource::fromRawDump(path, cv::Size(64, 48), CV_8UC3);
+    EXPECT_TRUE(source.isMapped());
+    ASSERT_EQ(source.size(), frames.size());
+    EXPECT_EQ(source.byteSize(), frames.size() * 64 * 48 * 3);
+    for (size_t i = 0; i < frames.size(); ++i) {
+        EXPECT_EQ(cv::norm(source.frame(i), frames[i], cv::NORM_INF), 0.0) << "frame " << i;
+    }
+
+    // Moving keeps the mapping valid and leaves the source empty
+    ReplayFrameSource moved = std::move(source);
+    EXPECT_TRUE(source.empty());
+    EXPECT_EQ(cv::norm(moved.frame(4), frames[4], cv::NORM_INF), 0.0);
+    std::filesystem::remove(path);
+}
+
+TEST(ReplayFrameSourceTest, RejectsPartialFramesAndMissingFiles) {
+    const std::string path = (std::filesystem::temp_directory_path() / "replay_frame_source_partial.raw").string();
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << std::string(64 * 48 + 7, '\0');
+    }
+    EXPECT_THROW(ReplayFrameSource::fromRawDump(path, cv::Size(64, 48), CV_8UC1), std::runtime_error);
+    std::filesystem::remove(path);
+
+    EXPECT_THROW(ReplayFrameSource::fromRawDump("/nonexistent/dump.raw", cv::Size(64, 48), CV_8UC1),
+                 std::runtime_error);
+    EXPECT_THROW(ReplayFrameSource::fromVideo("/nonexistent/video.mp4"), std::runtime_error);
+}
+
+TEST(ReplayFrameSourceTest, FrameCacheMapsPageAlignedFramesWithoutBeingToldTheirSize) {
+    const std::string path = (std::filesystem::temp_directory_path() / "replay_frame_source_test.bofc").string();
+    for (int type : {CV_8UC3, CV_8UC1}) {
+        const std::vector<cv::Mat> frames = syntheticFrames(4, type);
+        ReplayFrameSource::writeFrameCache(path, frames);
+        EXPECT_TRUE(ReplayFrameSource::isFrameCache(path));
+
+        ReplayFrameSource source = ReplayFrameSource::fromFrameCache(path);
+        EXPECT_TRUE(source.isMapped());
+        ASSERT_EQ(source.size(), frames.size());
+        EXPECT_EQ(source.frameSize(), cv::Size(64, 48));
+        EXPECT_EQ(source.frameType(), type);
+        EXPECT_EQ(source.byteSize(), (1 + frames.size()) * frame_cache_layout::kPageBytes);
+        for (size_t i = 0; i < frames.size(); ++i) {
+            const cv::Mat frame = source.frame(i);
+            EXPECT_EQ(reinterpret_cast<uintptr_t>(frame.data) % frame_cache_layout::kPageBytes, 0u);
+            EXPECT_EQ(cv::norm(frame, frames[i], cv::NORM_INF), 0.0) << "frame " << i;
+        }
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(ReplayFrameSourceTest, RejectsTruncatedFrameCachesAndRawDumps) {
+    const auto dir = std::filesystem::temp_directory_path();
+    const std::string cachePath = (dir / "replay_frame_source_truncated.bofc").string();
+    ReplayFrameSource::writeFrameCache(cachePath, syntheticFrames(3, CV_8UC3));
+    std::filesystem::resize_file(cachePath, std::filesystem::file_size(cachePath) - 4096 - 1);
+    EXPECT_THROW(ReplayFrameSource::fromFrameCache(cachePath), std::runtime_error);
+
+    const std::string rawPath = (dir / "replay_frame_source_not_cache.raw").string();
+    ReplayFrameSource::writeRawDump(rawPath, syntheticFrames(2, CV_8UC3));
+    EXPECT_FALSE(ReplayFrameSource::isFrameCache(rawPath));
+    EXPECT_THROW(ReplayFrameSource::fromFrameCache(rawPath), std::runtime_error);
+    EXPECT_FALSE(ReplayFrameSource::isFrameCache("/nonexistent/cache.bofc"));
+    std::filesystem::remove(cachePath);
+    std::filesystem::remove(rawPath);
+}
+
+TEST(ReplayFrameSourceTest, ImageSetsDecodeInOrder) {
+    const auto dir = std::filesystem::temp_directory_path() / "replay_frame_source_images";
+    std::filesystem::create_directories(dir);
+    const std::vector<cv::Mat> frames = syntheticFrames(3, CV_8UC3);
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        paths.push_back((dir / ("frame" + std::to_string(i) + ".png")).string());
+        ASSERT_TRUE(cv::imwrite(paths.back(), frames[i]));
+    }
+
+    ReplayFrameSource source = ReplayFrameSource::fromImages(paths);
+    EXPECT_FALSE(source.isMapped());
+    ASSERT_EQ(source.size(), 3u);
+    EXPECT_EQ(cv::norm(source.frame(2), frames[2], cv::NORM_INF), 0.0);  // PNG is lossless
+
+    cv::imwrite((dir / "small.png").string(), cv::Mat(8, 8, CV_8UC3, cv::Scalar::all(0)));
+    paths.push_back((dir / "small.png").string());
+    EXPECT_THROW(ReplayFrameSource::fromImages(paths), std::runtime_error);
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,119 @@
+#include "save_deduplicator.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "logger.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("debug", "save_deduplicator_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class SaveDeduplicatorTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const saveDeduplicatorEnv =
+    ::testing::AddGlobalTestEnvironment(new SaveDeduplicatorTestEnvironment());
+
+namespace {
+
+// Scene with a textured "bird" whose pattern depends on the seed
+cv::Mat makeScene(int seed) {
+    cv::Mat frame(240, 320, CV_8UC3, cv::Scalar(40, 90, 40));
+    cv::RNG rng(seed);
+    for (int i = 0; i < 12; ++i) {
+        cv::Point center(rng.uniform(110, 210), rng.uniform(70, 170));
+        cv::circle(frame, center, rng.uniform(5, 20),
+                   cv::Scalar(rng.uniform(0, 255), rng.uniform(0, 255), rng.uniform(0, 255)), -1);
+    }
+    return frame;
+}
+
+SaveDedupConfig enabledConfig() {
+    SaveDedupConfig config;
+    config.enabled = true;
+    config.maxInterval = std::chrono::seconds(30);
+    return config;
+}
+
+}  // namespace
+
+TEST(SaveDeduplicatorTest, HashIsStableAndSensitiveToContent) {
+    const cv::Mat scene = makeScene(1);
+    const uint64_t hash = SaveDeduplicator::differenceHash(scene);
+    EXPECT_EQ(SaveDeduplicator::differenceHash(scene.clone()), hash);
+
+    cv::Mat noisy = scene.clone();
+    cv::add(noisy, cv::Scalar(3, 3, 3), noisy);  // Uniform brightness change keeps the gradients
+    EXPECT_LE(SaveDeduplicator::hammingDistance(SaveDeduplicator::differenceHash(noisy), hash), 2);
+
+    EXPECT_GT(SaveDeduplicator::hammingDistance(SaveDeduplicator::differenceHash(makeScene(2)), hash),
+              6);
+    EXPECT_EQ(SaveDeduplicator::hammingDistance(0, ~0ULL), 64);
+}
+
+TEST(SaveDeduplicatorTest, SkipsUnchangedRegionsUntilMaxInterval) {
+    SaveDeduplicator dedup(enabledConfig());
+    const cv::Mat scene = makeScene(1);
+    const std::vector<ConsolidatedRegion> regions = {
+        ConsolidatedRegion(cv::Rect(100, 60, 120, 120), {7})};
+    const auto start = std::chrono::steady_clock::now();
+
+    EXPECT_TRUE(dedup.shouldSave(scene, regions, start));
+    EXPECT_FALSE(dedup.shouldSave(scene, regions, start + std::chrono::seconds(1)));
+    EXPECT_FALSE(dedup.shouldSave(scene, regions, start + std::chrono::seconds(29)));
+    EXPECT_EQ(dedup.skipped(), 2u);
+
+    // The reference is the last save, so the interval counts from there
+    EXPECT_TRUE(dedup.shouldSave(scene, regions, start + std::chrono::seconds(31)));
+    EXPECT_FALSE(dedup.shouldSave(scene, regions, start + std::chrono::seconds(32)));
+}
+
+TEST(SaveDeduplicatorTest, SavesOnChangedContentMovedBoxOrNewRegion) {
+    SaveDeduplicator dedup(enabledConfig());
+    const cv::Mat scene = makeScene(1);
+    const cv::Rect box(100, 60, 120, 120);
+    const auto now = std::chrono::steady_clock::now();
+    ASSERT_TRUE(dedup.shouldSave(scene, {ConsolidatedRegion(box, {7})}, now));
+
+    // Different content inside the same box
+    EXPECT_TRUE(dedup.shouldSave(makeScene(2), {ConsolidatedRegion(box, {7})}, now));
+
+    // Same track, but moved well away from the saved box
+    const cv::Mat changed = makeScene(2);
+    EXPECT_TRUE(dedup.shouldSave(changed, {ConsolidatedRegion(box + cv::Point(80, 40), {7})}, now));
+
+    // An additional region appears next to the unchanged one
+    const std::vector<ConsolidatedRegion> twoRegions = {
+        ConsolidatedRegion(box + cv::Point(80, 40), {7}),
+        ConsolidatedRegion(cv::Rect(0, 0, 60, 60), {9})};
+    EXPECT_TRUE(dedup.shouldSave(changed, twoRegions, now));
+    EXPECT_FALSE(dedup.shouldSave(changed, twoRegions, now));
+}
+
+TEST(SaveDeduplicatorTest, DisabledOrEmptyAlwaysSaves) {
+    SaveDeduplicator disabled;
+    const cv::Mat scene = makeScene(1);
+    const std::vector<ConsolidatedRegion> regions = {
+        ConsolidatedRegion(cv::Rect(100, 60, 120, 120), {1})};
+    const auto now = std::chrono::steady_clock::now();
+    EXPECT_TRUE(disabled.shouldSave(scene, regions, now));
+    EXPECT_TRUE(disabled.shouldSave(scene, regions, now));
+
+    SaveDeduplicator dedup(enabledConfig());
+    EXPECT_TRUE(dedup.shouldSave(scene, {}, now));
+    EXPECT_TRUE(dedup.shouldSave(scene, {}, now));
+    EXPECT_EQ(dedup.skipped(), 0u);
+}
@@ -0,0 +1,115 @@
+#include "shared_frame_ring.hpp"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+#include "logger.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("debug", "shared_frame_ring_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class SharedFrameRingTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const sharedFrameRingEnv =
+    ::testing::AddGlobalTestEnvironment(new SharedFrameRingTestEnvironment());
+
+namespace {
+
+SharedFrameRingConfig testConfig() {
+    SharedFrameRingConfig config;
+    config.name = "/birds_of_play_ring_test_" + std::to_string(getpid());
+    config.slotCount = 3;
+    config.maxWidth = 64;
+    config.maxHeight = 48;
+    return config;
+}
+
+cv::Mat makeFrame(int value) {
+    cv::Mat frame(48, 64, CV_8UC3);
+    for (int row = 0; row < frame.rows; ++row) {
+        for (int col = 0; col < frame.cols; ++col) {
+            frame.at<cv::Vec3b>(row, col) = cv::Vec3b(value, row, col);
+        }
+    }
+    return frame;
+}
+
+}  // namespace
+
+// A reader in the same process (standing in for another one) sees each published frame
+TEST(SharedFrameRingTest, PublishesFramesAndRegions) {
+    SharedFrameRing ring(testConfig());
+    ASSERT_TRUE(ring.isOpen());
+    SharedFrameRingReader reader(ring.config().name);
+    ASSERT_TRUE(reader.isOpen());
+
+    SharedFrameRingReader::Frame frame;
+    EXPECT_FALSE(reader.latest(frame));  // Nothing published yet
+
+    const std::vector<cv::Rect> regions = {{1, 2, 10, 12}, {20, 5, 8, 8}};
+    ASSERT_TRUE(ring.publish(makeFrame(7), 42, 1700000000123456, regions, 5));
+    ASSERT_TRUE(reader.latest(frame));
+    EXPECT_EQ(frame.frameNumber, 0u);
+    EXPECT_EQ(frame.frameIndex, 42);
+    EXPECT_EQ(frame.timestampUs, 1700000000123456);
+    EXPECT_EQ(frame.regions, regions);
+    EXPECT_EQ(frame.motionBoxCount, 5u);
+    EXPECT_EQ(cv::norm(frame.image, makeFrame(7), cv::NORM_INF), 0.0);
+
+    // Non-continuous input (a region of a larger frame) is copied row by row
+    cv::Mat large(100, 100, CV_8UC3, cv::Scalar(9, 9, 9));
+    makeFrame(8).copyTo(large(cv::Rect(10, 10, 64, 48)));
+    ASSERT_TRUE(ring.publish(large(cv::Rect(10, 10, 64, 48)), 43, 0, {}, 0));
+    ASSERT_TRUE(reader.latest(frame));
+    EXPECT_EQ(frame.frameIndex, 43);
+    EXPECT_TRUE(frame.regions.empty());
+    EXPECT_EQ(cv::norm(frame.image, makeFrame(8), cv::NORM_INF), 0.0);
+
+    // Frames larger than a slot are refused
+    EXPECT_FALSE(ring.publish(large, 44, 0, {}, 0));
+    EXPECT_EQ(ring.published(), 2u);
+}
+
+// Slots are reused after slotCount frames; overwritten frames can no longer be read
+TEST(SharedFrameRingTest, OverwrittenFramesAreRejected) {
+    SharedFrameRing ring(testConfig());
+    ASSERT_TRUE(ring.isOpen());
+    SharedFrameRingReader reader(ring.config().name);
+    ASSERT_TRUE(reader.isOpen());
+
+    for (int i = 0; i < 5; ++i) ASSERT_TRUE(ring.publish(makeFrame(i), i, 0, {}, 0));
+    EXPECT_EQ(reader.published(), 5u);
+
+    SharedFrameRingReader::Frame frame;
+    EXPECT_FALSE(reader.read(0, frame));
+    EXPECT_FALSE(reader.read(1, frame));
+    for (uint64_t number = 2; number < 5; ++number) {
+        ASSERT_TRUE(reader.read(number, frame)) << number;
+        EXPECT_EQ(frame.frameIndex, static_cast<int64_t>(number));
+        EXPECT_EQ(cv::norm(frame.image, makeFrame(static_cast<int>(number)), cv::NORM_INF), 0.0);
+    }
+    EXPECT_FALSE(reader.read(5, frame));  // Not published yet
+}
+
+// The segment disappears with the writer
+TEST(SharedFrameRingTest, SegmentIsRemovedWithTheWriter) {
+    const SharedFrameRingConfig config = testConfig();
+    { SharedFrameRing ring(config); }
+    SharedFrameRingReader reader(config.name);
+    EXPECT_FALSE(reader.isOpen());
+}
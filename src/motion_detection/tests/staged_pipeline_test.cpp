@@ -0,0 +1,469 @@
+#include "staged_pipeline.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.hpp"
+#include "latest_value_mailbox.hpp"
+#include "latency_histogram.hpp"
+#include "lockfree_queue.hpp"
+#include "logger.hpp"
+#include "stage_graph.hpp"
+#include "work_stealing_pool.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("debug", "staged_pipeline_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class StagedPipelineTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const stagedPipelineEnv =
+    ::testing::AddGlobalTestEnvironment(new StagedPipelineTestEnvironment());
+
+TEST(BoundedQueueTest, DropOldestKeepsNewestItems) {
+    BoundedQueue<int> queue(2, BackpressurePolicy::DropOldest);
+    EXPECT_TRUE(queue.push(1));
+    EXPECT_TRUE(queue.push(2));
+    EXPECT_TRUE(queue.push(3));
+
+    EXPECT_EQ(queue.size(), 2u);
+    EXPECT_EQ(queue.droppedCount(), 1u);
+    EXPECT_EQ(queue.pop().value(), 2);
+    EXPECT_EQ(queue.pop().value(), 3);
+}
+
+TEST(BoundedQueueTest, DropNewestRejectsIncomingItem) {
+    BoundedQueue<int> queue(1, BackpressurePolicy::DropNewest);
+    EXPECT_TRUE(queue.push(1));
+    EXPECT_FALSE(queue.push(2));
+
+    EXPECT_EQ(queue.droppedCount(), 1u);
+    EXPECT_EQ(queue.pop().value(), 1);
+}
+
+TEST(BoundedQueueTest, CloseWakesBlockedProducerAndDrains) {
+    BoundedQueue<int> queue(1, BackpressurePolicy::Block);
+    ASSERT_TRUE(queue.push(1));
+
+    std::atomic<bool> pushResult{true};
+    std::thread producer([&] { pushResult = queue.push(2); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    queue.close();
+    producer.join();
+
+    EXPECT_FALSE(pushResult);
+    EXPECT_EQ(queue.pop().value(), 1);
+    EXPECT_FALSE(queue.pop().has_value());
+    EXPECT_TRUE(queue.isDrained());
+}
+
+TEST(BoundedQueueTest, ParsesPolicyNames) {
+    EXPECT_EQ(parseBackpressurePolicy("block"), BackpressurePolicy::Block);
+    EXPECT_EQ(parseBackpressurePolicy("Drop_Oldest"), BackpressurePolicy::DropOldest);
+    EXPECT_EQ(parseBackpressurePolicy("drop_newest"), BackpressurePolicy::DropNewest);
+    EXPECT_THROW(parseBackpressurePolicy("sometimes"), std::invalid_argument);
+}
+
+TEST(SpscRingTest, RoundsCapacityAndPopsInBatches) {
+    SpscRing<int> ring(3);
+    ASSERT_EQ(ring.capacity(), 4u);
+    for (int i = 0; i < 4; ++i) EXPECT_TRUE(ring.tryPush(int(i)));
+    int rejected = 4;
+    EXPECT_FALSE(ring.tryPush(std::move(rejected)));
+
+    std::vector<int> items;
+    EXPECT_EQ(ring.popBatch(items, 3), 3u);
+    EXPECT_EQ(items, (std::vector<int>{0, 1, 2}));
+    EXPECT_TRUE(ring.tryPush(int(4)));
+    EXPECT_EQ(ring.popBatch(items, 10), 2u);
+    EXPECT_EQ(items, (std::vector<int>{0, 1, 2, 3, 4}));
+
+    const QueueOccupancy occupancy = ring.occupancy();
+    EXPECT_EQ(occupancy.depth, 0u);
+    EXPECT_EQ(occupancy.pushed, 5u);
+    EXPECT_EQ(occupancy.popped, 5u);
+    EXPECT_EQ(occupancy.highWatermark, 4u);
+}
+
+// Items cross between two threads in order, through many laps of a small ring
+TEST(SpscRingTest, PreservesOrderAcrossThreads) {
+    constexpr int kItems = 100000;
+    SpscRing<int> ring(8);
+    std::thread producer([&] {
+        for (int i = 0; i < kItems; ++i) {
+            int item = i;
+            while (!ring.tryPush(std::move(item))) std::this_thread::yield();
+        }
+    });
+
+    std::vector<int> batch;
+    int expected = 0;
+    bool ordered = true;
+    while (expected < kItems) {
+        batch.clear();
+        if (ring.popBatch(batch, 5) == 0) std::this_thread::yield();
+        for (int item : batch) ordered = ordered && item == expected++;
+    }
+    producer.join();
+    EXPECT_TRUE(ordered);
+    EXPECT_TRUE(ring.empty());
+}
+
+// Every item from several producers reaches exactly one of several consumers
+TEST(MpmcRingTest, DeliversEveryItemOnce) {
+    constexpr int kProducers = 3;
+    constexpr int kConsumers = 3;
+    constexpr int kItemsPerProducer = 20000;
+    MpmcRing<int> ring(16);
+    std::vector<std::atomic<int>> seen(kProducers * kItemsPerProducer);
+    std::atomic<int> consumed{0};
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < kProducers; ++p) {
+        threads.emplace_back([&, p] {
+            for (int i = 0; i < kItemsPerProducer; ++i) {
+                int item = p * kItemsPerProducer + i;
+                while (!ring.tryPush(std::move(item))) std::this_thread::yield();
+            }
+        });
+    }
+    for (int c = 0; c < kConsumers; ++c) {
+        threads.emplace_back([&] {
+            std::vector<int> batch;
+            while (consumed.load() < kProducers * kItemsPerProducer) {
+                batch.clear();
+                if (ring.popBatch(batch, 4) == 0) std::this_thread::yield();
+                for (int item : batch) seen[item]++;
+                consumed += static_cast<int>(batch.size());
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    int duplicatesOrMissing = 0;
+    for (const auto& count : seen) duplicatesOrMissing += count.load() != 1;
+    EXPECT_EQ(duplicatesOrMissing, 0);
+    EXPECT_LE(ring.occupancy().highWatermark, ring.capacity());
+}
+
+TEST(LockFreeQueueTest, DropOldestKeepsNewestItems) {
+    // DropOldest evicts from the producer, so even a fixed link gets the MPMC ring
+    LockFreeQueue<int> queue(2, BackpressurePolicy::DropOldest, QueueLink::Fixed);
+    EXPECT_TRUE(queue.push(1));
+    EXPECT_TRUE(queue.push(2));
+    EXPECT_TRUE(queue.push(3));
+
+    EXPECT_EQ(queue.size(), 2u);
+    EXPECT_EQ(queue.droppedCount(), 1u);
+    EXPECT_EQ(queue.pop().value(), 2);
+    EXPECT_EQ(queue.pop().value(), 3);
+    EXPECT_FALSE(queue.popFor(std::chrono::milliseconds(5)).has_value());
+}
+
+TEST(LockFreeQueueTest, CloseWakesBlockedProducerAndDrains) {
+    LockFreeQueue<int> queue(1, BackpressurePolicy::Block, QueueLink::Fixed);
+    ASSERT_TRUE(queue.push(1));
+
+    std::atomic<bool> pushResult{true};
+    std::thread producer([&] { pushResult = queue.push(2); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    queue.close();
+    producer.join();
+
+    EXPECT_FALSE(pushResult);
+    EXPECT_EQ(queue.pop().value(), 1);
+    EXPECT_FALSE(queue.pop().has_value());
+    EXPECT_TRUE(queue.isDrained());
+}
+
+// A consumer parked on an empty queue wakes for the next item and for close()
+TEST(LockFreeQueueTest, ParkedConsumerWakesUp) {
+    LockFreeQueue<int> queue(4, BackpressurePolicy::Block, QueueLink::Fixed);
+    std::vector<int> received;
+    std::thread consumer([&] {
+        while (auto item = queue.pop()) received.push_back(*item);
+    });
+    for (int i = 0; i < 3; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ASSERT_TRUE(queue.push(int(i)));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    queue.close();
+    consumer.join();
+
+    EXPECT_EQ(received, (std::vector<int>{0, 1, 2}));
+    EXPECT_EQ(queue.highWatermark(), 1u);
+}
+
+TEST(LatestValueMailboxTest, KeepsOnlyTheNewestValueAndCountsSkips) {
+    LatestValueMailbox<std::vector<int>> mailbox;
+    EXPECT_FALSE(mailbox.take());
+    mailbox.publish({1});
+    mailbox.publish({2});
+    mailbox.publish({3, 3});
+    auto value = mailbox.take();
+    ASSERT_TRUE(value);
+    EXPECT_EQ(*value, (std::vector<int>{3, 3}));
+    EXPECT_FALSE(mailbox.take());  // Taken values are not delivered twice
+    EXPECT_EQ(mailbox.overwrittenCount(), 2u);
+
+    mailbox.publish({4});
+    EXPECT_EQ(mailbox.take(), (std::vector<int>{4}));
+    EXPECT_EQ(mailbox.publishedCount(), 4u);
+    EXPECT_EQ(mailbox.takenCount(), 2u);
+    EXPECT_EQ(mailbox.overwrittenCount(), 2u);
+    EXPECT_FALSE(mailbox.waitFor(std::chrono::milliseconds(5)));
+}
+
+TEST(LatestValueMailboxTest, SlowReaderSeesIncreasingValuesUntilClose) {
+    LatestValueMailbox<int> mailbox;
+    constexpr int kValues = 20000;
+    std::thread writer([&] {
+        for (int i = 1; i <= kValues; ++i) mailbox.publish(i);
+        mailbox.close();
+    });
+    std::vector<int> received;
+    while (auto value = mailbox.wait()) {
+        received.push_back(*value);
+        if (received.size() % 16 == 0) std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    writer.join();
+
+    ASSERT_FALSE(received.empty());
+    EXPECT_TRUE(std::is_sorted(received.begin(), received.end()));
+    EXPECT_EQ(std::adjacent_find(received.begin(), received.end()), received.end());
+    EXPECT_EQ(received.back(), kValues);  // The last value survives close()
+    EXPECT_EQ(mailbox.takenCount() + mailbox.overwrittenCount(), static_cast<uint64_t>(kValues));
+}
+
+TEST(StagedPipelineTest, InputSourceFeedsTheFirstStage) {
+    LatestValueMailbox<int> mailbox;
+    StagedPipeline<int> pipeline(2, BackpressurePolicy::Block);
+    pipeline.setInputSource([&mailbox] { return mailbox.wait(); });
+    pipeline.addStage("negate", [](int& value) {
+        value = -value;
+        return true;
+    });
+    pipeline.start();
+    EXPECT_FALSE(pipeline.submit(1));  // The source is the only input
+
+    mailbox.publish(7);
+    auto value = pipeline.popOutputFor(std::chrono::seconds(5));
+    ASSERT_TRUE(value);
+    EXPECT_EQ(*value, -7);
+    mailbox.close();
+    while (!pipeline.isFinished()) pipeline.popOutputFor(std::chrono::milliseconds(10));
+    EXPECT_THROW(pipeline.setInputSource(nullptr), std::logic_error);
+}
+
+TEST(StagedPipelineTest, BlockingPipelinePreservesOrderAndFilters) {
+    StagedPipeline<int> pipeline(2, BackpressurePolicy::Block);
+    pipeline.addStage("double", [](int& value) {
+        value *= 2;
+        return true;
+    });
+    pipeline.addStage("drop_multiples_of_four", [](int& value) { return value % 4 != 0; });
+    pipeline.start();
+
+    std::thread producer([&] {
+        for (int i = 1; i <= 10; ++i) pipeline.submit(i);
+        pipeline.closeInput();
+    });
+
+    std::vector<int> output;
+    while (!pipeline.isFinished()) {
+        if (auto value = pipeline.popOutputFor(std::chrono::milliseconds(10))) {
+            output.push_back(*value);
+        }
+    }
+    producer.join();
+
+    EXPECT_EQ(output, (std::vector<int>{2, 6, 10, 14, 18}));
+    auto stats = pipeline.getStats();
+    ASSERT_EQ(stats.size(), 3u);
+    EXPECT_EQ(stats[0].name, "double");
+    EXPECT_EQ(stats[0].processed, 10u);
+    EXPECT_EQ(stats[1].filtered, 5u);
+    EXPECT_EQ(stats[0].dropped, 0u);
+}
+
+TEST(StagedPipelineTest, StageExceptionDropsPacketOnly) {
+    StagedPipeline<int> pipeline(4, BackpressurePolicy::Block);
+    pipeline.addStage("throw_on_two", [](int& value) {
+        if (value == 2) throw std::runtime_error("bad packet");
+        return true;
+    });
+    pipeline.start();
+    for (int i = 1; i <= 3; ++i) pipeline.submit(i);
+    pipeline.closeInput();
+
+    std::vector<int> output;
+    while (!pipeline.isFinished()) {
+        if (auto value = pipeline.popOutputFor(std::chrono::milliseconds(10))) {
+            output.push_back(*value);
+        }
+    }
+    EXPECT_EQ(output, (std::vector<int>{1, 3}));
+}
+
+TEST(StagedPipelineTest, DrainRunsEveryQueuedPacketWithoutOutput) {
+    std::atomic<int> sum{0};
+    StagedPipeline<int> pipeline(8, BackpressurePolicy::Block);
+    pipeline.addStage("accumulate", [&sum](int& value) {
+        sum += value;
+        return true;
+    });
+    pipeline.start(false);
+    for (int i = 1; i <= 5; ++i) pipeline.submit(i);
+    pipeline.drain();
+
+    EXPECT_EQ(sum.load(), 15);
+    EXPECT_TRUE(pipeline.isFinished());
+}
+
+#ifdef __linux__
+TEST(StagedPipelineTest, StageThreadsAreNamedAndHooked) {
+    std::vector<std::string> names;
+    std::vector<std::string> hooked;
+    std::mutex mutex;
+    StagedPipeline<int> pipeline(4, BackpressurePolicy::Block);
+    pipeline.setThreadStartHook([&](const std::string& stage) {
+        std::lock_guard<std::mutex> lock(mutex);
+        hooked.push_back(stage);
+    });
+    pipeline.addStage("detect", [&](int&) {
+        char name[16] = {};
+        pthread_getname_np(pthread_self(), name, sizeof(name));
+        std::lock_guard<std::mutex> lock(mutex);
+        names.push_back(name);
+        return true;
+    });
+    pipeline.start(false);
+    pipeline.submit(1);
+    pipeline.drain();
+
+    EXPECT_EQ(names, std::vector<std::string>({"bop-detect"}));
+    EXPECT_EQ(hooked, std::vector<std::string>({"detect"}));
+    EXPECT_THROW(pipeline.setThreadStartHook(nullptr), std::logic_error);
+}
+#endif
+
+TEST(StageGraphTest, SkipsUnconsumedStagesAndOrdersLevels) {
+    int frame = 0;
+    int boxes = 0;
+    int crops = 0;
+    int count = 0;
+    int debugRuns = 0;
+    StageGraph graph;
+    graph.addSource("frame");
+    // Added out of order: the levels come from the slots, not the insertion order
+    graph.addStage("crops", {"frame", "boxes"}, {"crops"}, [&] { crops = frame + boxes; });
+    graph.addStage("detect", {"frame"}, {"boxes"}, [&] { boxes = frame * 2; });
+    graph.addStage("count", {"boxes"}, {"count"}, [&] { count = boxes + 1; });
+    graph.addStage("debug", {"boxes"}, {"debug"}, [&] { ++debugRuns; });
+    graph.requestOutputs({"crops", "count"});
+    graph.compile();
+
+    ASSERT_EQ(graph.levels().size(), 2u);
+    EXPECT_EQ(graph.levels()[0], std::vector<size_t>({1}));
+    EXPECT_EQ(graph.levels()[1], std::vector<size_t>({0, 2}));
+    EXPECT_FALSE(graph.isActive("debug"));
+    EXPECT_TRUE(graph.isConsumed("boxes"));
+    EXPECT_FALSE(graph.isConsumed("debug"));
+
+    frame = 5;
+    graph.run();
+    EXPECT_EQ(boxes, 10);
+    EXPECT_EQ(crops, 15);
+    EXPECT_EQ(count, 11);
+    EXPECT_EQ(debugRuns, 0);
+
+    // A sink runs although nothing reads it
+    graph.addStage("log", {"count"}, {}, [&] { ++debugRuns; }, true);
+    graph.run();
+    EXPECT_EQ(debugRuns, 1);
+
+    StageGraph missing;
+    missing.addStage("consolidate", {"objects"}, {"regions"}, [] {});
+    EXPECT_THROW(missing.compile(), std::invalid_argument);
+    StageGraph cycle;
+    cycle.addStage("a", {"y"}, {"x"}, [] {});
+    cycle.addStage("b", {"x"}, {"y"}, [] {});
+    EXPECT_THROW(cycle.compile(), std::invalid_argument);
+    StageGraph twice;
+    twice.addSource("frame");
+    twice.addStage("a", {}, {"frame"}, [] {});
+    EXPECT_THROW(twice.compile(), std::invalid_argument);
+}
+
+TEST(StageGraphTest, RunsALevelConcurrentlyOnThePool) {
+    constexpr int kBranches = 4;
+    WorkStealingPool pool(kBranches - 1);  // The calling thread takes the fourth branch
+    std::atomic<int> started{0};
+    std::atomic<int> overlapping{0};
+    int merged = 0;
+    StageGraph graph;
+    graph.addSource("frame");
+    std::vector<std::string> branches;
+    for (int i = 0; i < kBranches; ++i) {
+        branches.push_back("branch" + std::to_string(i));
+        graph.addStage(branches.back(), {"frame"}, {branches.back()}, [&] {
+            // Every branch waits until all have started: only possible when they overlap
+            ++started;
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (started.load() < kBranches && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::yield();
+            }
+            if (started.load() == kBranches) ++overlapping;
+        });
+    }
+    graph.addStage("merge", branches, {"merged"}, [&] { merged = overlapping.load(); });
+    graph.requestOutputs({"merged"});
+    graph.run(&pool);
+    EXPECT_EQ(merged, kBranches);
+
+    // A failing stage fails run() once its level is done, and later levels are skipped
+    StageGraph failing;
+    failing.addSource("frame");
+    failing.addStage("ok", {"frame"}, {"a"}, [] {});
+    failing.addStage("bad", {"frame"}, {"b"}, [] { throw std::runtime_error("bad stage"); });
+    failing.addStage("after", {"a", "b"}, {"c"}, [&] { merged = -1; });
+    failing.requestOutputs({"c"});
+    EXPECT_THROW(failing.run(&pool), std::runtime_error);
+    EXPECT_EQ(merged, kBranches);
+}
+
+TEST(LatencyHistogramTest, BucketsAndSummaryStatistics) {
+    LatencyHistogram histogram;
+    for (int i = 0; i < 9; ++i) histogram.record(0.5);  // <= 1 ms
+    histogram.record(std::chrono::milliseconds(40));    // <= 50 ms
+
+    EXPECT_EQ(histogram.count(), 10u);
+    EXPECT_EQ(histogram.bucketCount(0), 9u);
+    EXPECT_EQ(histogram.bucketCount(5), 1u);
+    EXPECT_DOUBLE_EQ(histogram.percentileMs(0.5), 1.0);
+    EXPECT_DOUBLE_EQ(histogram.percentileMs(0.95), 50.0);
+    EXPECT_NEAR(histogram.meanMs(), 4.45, 1e-6);
+    EXPECT_NEAR(histogram.maxMs(), 40.0, 1e-6);
+
+    histogram.record(5000.0);  // Overflow bucket
+    EXPECT_EQ(histogram.bucketCount(LatencyHistogram::kBucketCount - 1), 1u);
+}
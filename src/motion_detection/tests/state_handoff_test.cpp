@@ -0,0 +1,128 @@
+#include "state_handoff.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "logger.hpp"
+
+namespace fs = std::filesystem;
+
+void initLogger() {
+    try {
+        Logger::init("debug", "state_handoff_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class StateHandoffTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const stateHandoffEnv =
+    ::testing::AddGlobalTestEnvironment(new StateHandoffTestEnvironment());
+
+namespace {
+
+// Short enough for sun_path on every platform
+std::string socketPath(const std::string& name) {
+    return (fs::temp_directory_path() / ("bop_" + name + "_" + std::to_string(::getpid()) + ".sock")).string();
+}
+
+bool waitFor(const HandoffListener& listener) {
+    for (int i = 0; i < 100 && !listener.requested(); ++i) std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    return listener.requested();
+}
+
+}  // namespace
+
+// The running instance hands its state over, then confirms its queue is saved; the
+// successor takes over the socket for the next restart
+TEST(StateHandoffTest, HandsStateToASuccessorOfTheSameCamera) {
+    const std::string path = socketPath("handoff");
+    HandoffClient nobody;
+    EXPECT_FALSE(nobody.connect(path, "garden"));  // Cold start: nothing listens
+
+    HandoffListener running(path, "garden");
+    ASSERT_TRUE(running.start());
+    EXPECT_FALSE(running.requested());
+
+    HandoffClient successor;
+    ASSERT_TRUE(successor.connect(path, "garden"));
+    ASSERT_TRUE(waitFor(running));
+
+    const std::vector<unsigned char> state = {1, 2, 3, 4, 5};
+    ASSERT_TRUE(running.sendState(state));
+    std::vector<unsigned char> received;
+    ASSERT_TRUE(successor.receiveState(received, std::chrono::milliseconds(2000)));
+    EXPECT_EQ(received, state);
+
+    std::thread saving([&running] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));  // Draining its queue
+        running.sendReleased();
+    });
+    EXPECT_TRUE(successor.waitReleased(std::chrono::milliseconds(2000)));
+    saving.join();
+
+    // The successor listens on the same path while the old listener is still around
+    HandoffListener next(path, "garden");
+    ASSERT_TRUE(next.start());
+    running.stop();
+    EXPECT_TRUE(fs::exists(path));  // Not unlinked by the instance that handed over
+    next.stop();
+    EXPECT_FALSE(fs::exists(path));
+}
+
+// A successor for another camera is refused and the running instance keeps going
+TEST(StateHandoffTest, RefusesAnotherCamera) {
+    const std::string path = socketPath("refuse");
+    HandoffListener running(path, "garden");
+    ASSERT_TRUE(running.start());
+
+    HandoffClient other;
+    ASSERT_TRUE(other.connect(path, "feeder"));
+    std::vector<unsigned char> received;
+    EXPECT_FALSE(other.receiveState(received, std::chrono::milliseconds(2000)));
+    EXPECT_FALSE(other.isConnected());
+    EXPECT_FALSE(running.requested());
+
+    // Still listening for the right one
+    HandoffClient successor;
+    ASSERT_TRUE(successor.connect(path, "garden"));
+    EXPECT_TRUE(waitFor(running));
+}
+
+// A socket file left by a crashed instance is replaced; a live listener is not
+TEST(StateHandoffTest, ReplacesAStaleSocketOnly) {
+    const std::string path = socketPath("stale");
+    {
+        HandoffListener crashed(path, "garden");
+        ASSERT_TRUE(crashed.start());
+        HandoffClient successor;
+        ASSERT_TRUE(successor.connect(path, "garden"));
+        ASSERT_TRUE(waitFor(crashed));  // Stops listening, keeps the file
+    }
+    ASSERT_TRUE(fs::exists(path));
+
+    HandoffListener fresh(path, "garden");
+    ASSERT_TRUE(fresh.start());
+    HandoffListener second(path, "garden");
+    EXPECT_FALSE(second.start());
+
+    // Without an answer the successor gives up and starts cold
+    HandoffClient successor;
+    ASSERT_TRUE(successor.connect(path, "garden"));
+    std::vector<unsigned char> received;
+    EXPECT_FALSE(successor.receiveState(received, std::chrono::milliseconds(100)));
+    EXPECT_FALSE(successor.waitReleased(std::chrono::milliseconds(100)));
+}
@@ -0,0 +1,759 @@
+#include "stream_manager.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "classification_batcher.hpp"
+#include "logger.hpp"
+#include "region_classifier.hpp"
+#include "stream_state.hpp"
+#include "test_helpers.hpp"
+#include "work_stealing_pool.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("info", "stream_manager_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class StreamManagerTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const streamManagerEnv =
+    ::testing::AddGlobalTestEnvironment(new StreamManagerTestEnvironment());
+
+namespace {
+
+// A bright box moving across a dark frame, at a different speed and row per camera
+cv::Mat cameraFrame(int camera, int frame) {
+    cv::Mat image(240, 320, CV_8UC3, cv::Scalar(30, 30, 30));
+    const int x = 10 + (frame * (3 + camera)) % 250;
+    cv::rectangle(image, cv::Rect(x, 20 + camera * 35, 40, 30), cv::Scalar(220, 220, 220),
+                  cv::FILLED);
+    return image;
+}
+
+std::string configPath() { return findTestResourceDir() + "/config.yaml"; }
+
+}  // namespace
+
+// ============================================================================
+// POOL
+// ============================================================================
+
+TEST(WorkStealingPoolTest, RunsNestedTasksBeforeIdle) {
+    WorkStealingPool pool(4);
+    std::atomic<int> count{0};
+    for (int i = 0; i < 200; ++i) {
+        pool.submit([&] {
+            count++;
+            pool.submit([&] { count++; });  // Lands on this worker's deque
+        });
+    }
+    pool.waitIdle();
+    EXPECT_EQ(count.load(), 400);
+}
+
+TEST(WorkStealingPoolTest, IdleWorkersStealFromBusyOnes) {
+    WorkStealingPool pool(4);
+    std::mutex mutex;
+    std::vector<std::thread::id> workers;
+    // One task fans out 16 sleeping tasks onto its own deque; the others must steal them
+    pool.submit([&] {
+        for (int i = 0; i < 16; ++i) {
+            pool.submit([&] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                std::lock_guard<std::mutex> lock(mutex);
+                workers.push_back(std::this_thread::get_id());
+            });
+        }
+    });
+    pool.waitIdle();
+
+    ASSERT_EQ(workers.size(), 16u);
+    std::sort(workers.begin(), workers.end());
+    EXPECT_GT(std::unique(workers.begin(), workers.end()) - workers.begin(), 1);
+}
+
+// ============================================================================
+// STREAMS
+// ============================================================================
+
+TEST(StreamManagerTest, KeepsPerStreamOrderAndMatchesSequentialRuns) {
+    constexpr int kCameras = 3;
+    constexpr int kFrames = 30;
+
+    // Reference: each camera alone on the calling thread
+    std::vector<std::vector<std::vector<cv::Rect>>> expected(kCameras);
+    for (int c = 0; c < kCameras; ++c) {
+        MotionProcessor processor(configPath());
+        for (int f = 0; f < kFrames; ++f) {
+            expected[c].push_back(processor.processFrame(cameraFrame(c, f)).detectedBounds);
+        }
+    }
+
+    StreamManager manager(4, kFrames, BackpressurePolicy::Block);
+    for (int c = 0; c < kCameras; ++c) {
+        manager.addStream(std::make_unique<MotionProcessor>(configPath()),
+                          std::make_unique<MotionRegionConsolidator>());
+    }
+
+    std::mutex mutex;
+    std::vector<std::vector<uint64_t>> sequences(kCameras);
+    std::vector<std::vector<std::vector<cv::Rect>>> actual(kCameras);
+    manager.setResultCallback([&](StreamManager::StreamResult& output) {
+        std::lock_guard<std::mutex> lock(mutex);
+        sequences[output.stream].push_back(output.sequence);
+        actual[output.stream].push_back(output.result.detectedBounds);
+    });
+
+    for (int f = 0; f < kFrames; ++f) {
+        for (int c = 0; c < kCameras; ++c) EXPECT_TRUE(manager.submit(c, cameraFrame(c, f)));
+    }
+    manager.drain();
+
+    for (int c = 0; c < kCameras; ++c) {
+        ASSERT_EQ(sequences[c].size(), static_cast<size_t>(kFrames));
+        for (int f = 0; f < kFrames; ++f) EXPECT_EQ(sequences[c][f], static_cast<uint64_t>(f));
+        EXPECT_EQ(actual[c], expected[c]) << "camera " << c;
+        EXPECT_EQ(manager.getStats(c).processed, static_cast<uint64_t>(kFrames));
+        EXPECT_EQ(manager.getStats(c).dropped, 0u);
+    }
+}
+
+TEST(StreamManagerTest, DropNewestShedsFramesOfASlowStream) {
+    StreamManager manager(1, 2, BackpressurePolicy::DropNewest);
+    manager.addStream(std::make_unique<MotionProcessor>(configPath()));
+
+    std::atomic<bool> release{false};
+    std::atomic<int> delivered{0};
+    manager.setResultCallback([&](StreamManager::StreamResult&) {
+        while (!release) std::this_thread::yield();
+        delivered++;
+    });
+
+    // The first frame holds the only worker; two more fill the queue, the rest are shed
+    int accepted = 0;
+    for (int f = 0; f < 10; ++f) accepted += manager.submit(0, cameraFrame(0, f));
+    release = true;
+    manager.drain();
+
+    const StreamManager::StreamStats stats = manager.getStats(0);
+    EXPECT_EQ(stats.processed + stats.dropped, 10u);
+    EXPECT_EQ(static_cast<uint64_t>(accepted), stats.processed);
+    EXPECT_EQ(delivered.load(), accepted);
+    EXPECT_GT(stats.dropped, 0u);
+}
+
+// Streams join and leave while others run; a detached stream takes no more frames
+TEST(StreamManagerTest, AddsAndDetachesStreamsWhileRunning) {
+    StreamManager manager(2, 8, BackpressurePolicy::Block);
+    const size_t first = manager.addStream(std::make_unique<MotionProcessor>(configPath()));
+    for (int f = 0; f < 5; ++f) EXPECT_TRUE(manager.submit(first, cameraFrame(0, f)));
+    const size_t second = manager.addStream(std::make_unique<MotionProcessor>(configPath()));
+    for (int f = 0; f < 5; ++f) EXPECT_TRUE(manager.submit(second, cameraFrame(1, f)));
+    manager.drain();
+    EXPECT_EQ(manager.streamCount(), 2u);
+    EXPECT_EQ(manager.getStats(first).processed, 5u);
+    EXPECT_EQ(manager.getStats(second).processed, 5u);
+
+    const StreamManager::DetachedStream detached = manager.detachStream(first);
+    ASSERT_TRUE(detached.processor);
+    EXPECT_FALSE(detached.consolidator);
+    EXPECT_FALSE(manager.submit(first, cameraFrame(0, 5)));
+    EXPECT_TRUE(manager.getStats(first).detached);
+    EXPECT_EQ(manager.getStats(first).processed, 5u);
+    EXPECT_THROW(manager.detachStream(first), std::logic_error);
+    EXPECT_THROW(manager.checkpointStream(first), std::logic_error);
+    EXPECT_THROW(manager.submit(2, cameraFrame(0, 0)), std::out_of_range);
+    EXPECT_TRUE(manager.submit(second, cameraFrame(1, 5)));
+    manager.drain();
+    EXPECT_EQ(manager.getStats(second).processed, 6u);
+
+    // Only the attached stream is on the node's metrics page
+    PrometheusTextWriter writer;
+    manager.writeMetrics(writer);
+    const std::string& page = writer.text();
+    EXPECT_NE(page.find("birds_stream_workers 2\n"), std::string::npos);
+    EXPECT_NE(page.find("birds_stream_frames_processed_total{stream=\"default\"} 6\n"), std::string::npos);
+    EXPECT_EQ(page.find("birds_stream_frames_processed_total{stream=\"default\"} 5\n"), std::string::npos);
+}
+
+// A stream checkpointed between frames continues on another manager from its state
+TEST(StreamManagerTest, MovesAStreamWithItsState) {
+    StreamManager source(1, 16, BackpressurePolicy::Block);
+    const size_t stream = source.addStream(std::make_unique<MotionProcessor>(configPath()),
+                                           std::make_unique<MotionRegionConsolidator>());
+    for (int f = 0; f < 12; ++f) EXPECT_TRUE(source.submit(stream, cameraFrame(0, f)));
+    const std::vector<unsigned char> checkpoint = source.checkpointStream(stream);  // Waits for a frame boundary
+    source.drain();
+    const std::vector<unsigned char> last = source.checkpointStream(stream);
+    const StreamManager::DetachedStream detached = source.detachStream(stream);
+    ASSERT_TRUE(detached.consolidator);
+
+    StreamState state;
+    ASSERT_TRUE(decodeStreamState(checkpoint, state));
+    ASSERT_TRUE(decodeStreamState(last, state));
+    EXPECT_EQ(state.cameraId, detached.processor->getCameraId());
+    EXPECT_TRUE(state.background.empty());  // background_subtraction is off in the test config
+    ASSERT_TRUE(state.hasConsolidator);
+    EXPECT_EQ(state.frameSize, cv::Size(320, 240));
+    const std::vector<ConsolidatedRegion>& regions = detached.consolidator->getCurrentRegions();
+    ASSERT_EQ(state.regions.size(), regions.size());
+    for (size_t i = 0; i < regions.size(); ++i) {
+        EXPECT_EQ(state.regions[i].boundingBox, regions[i].boundingBox);
+        EXPECT_EQ(state.regions[i].trackedObjectIds, regions[i].trackedObjectIds);
+        EXPECT_EQ(state.regions[i].framesSinceLastUpdate, regions[i].framesSinceLastUpdate);
+    }
+    EXPECT_EQ(encodeStreamState(state), last);
+
+    // Everything the format carries comes back, and a cut-off blob is refused
+    StreamState full = state;
+    full.background = cv::Mat(24, 32, CV_8UC3, cv::Scalar(10, 20, 30));
+    ConsolidatedRegion region(cv::Rect(5, 6, 70, 80), {3, 9});
+    region.framesSinceLastUpdate = 2;
+    region.classId = 4;
+    region.classLabel = "robin";
+    region.classConfidence = 0.875f;
+    full.regions.push_back(region);
+    full.adaptiveMinArea = 120.5;
+    full.adaptiveMaxAspectRatio = 6.25;
+    ObjectTracker tracker;
+    tracker.update(std::vector<cv::Rect>{cv::Rect(10, 10, 20, 20), cv::Rect(100, 50, 30, 30)});
+    tracker.update(std::vector<cv::Rect>{cv::Rect(14, 12, 20, 20)});
+    const StreamState tracked = captureStreamState(*detached.processor, nullptr, &tracker);
+    full.hasTracker = true;
+    full.nextTrackId = tracked.nextTrackId;
+    full.tracks = tracked.tracks;
+    std::vector<unsigned char> bytes = encodeStreamState(full);
+    StreamState decoded;
+    ASSERT_TRUE(decodeStreamState(bytes, decoded));
+    EXPECT_EQ(cv::norm(decoded.background, full.background, cv::NORM_INF), 0.0);
+    const ConsolidatedRegion& back = decoded.regions.back();
+    EXPECT_EQ(back.boundingBox, region.boundingBox);
+    EXPECT_EQ(back.trackedObjectIds, region.trackedObjectIds);
+    EXPECT_EQ(back.classId, 4);
+    EXPECT_EQ(back.classLabel, "robin");
+    EXPECT_EQ(back.classConfidence, 0.875f);
+    ASSERT_TRUE(decoded.hasAdaptive);
+    EXPECT_EQ(decoded.adaptiveMinArea, 120.5);
+    EXPECT_EQ(decoded.adaptiveMaxAspectRatio, 6.25);
+    ASSERT_EQ(decoded.tracks.size(), 2u);
+    EXPECT_EQ(decoded.tracks.ids(), tracker.tracks().ids());
+    EXPECT_EQ(decoded.tracks.bounds(), tracker.tracks().bounds());
+    EXPECT_EQ(decoded.tracks.framesWithoutDetection(1), 1);
+    EXPECT_EQ(decoded.tracks.trajectory(0).size(), 2u);
+
+    // A restarted tracker keeps the IDs and hands out new ones after them
+    ObjectTracker restarted;
+    auto restoredProcessor = std::make_unique<MotionProcessor>(configPath());
+    restoreStreamState(decoded, *restoredProcessor, nullptr, &restarted);
+    EXPECT_EQ(restoredProcessor->getAdaptiveMinArea(), 120.5);
+    const std::vector<TrackedObject> continued = restarted.update(std::vector<cv::Rect>{cv::Rect(18, 14, 20, 20)});
+    ASSERT_EQ(continued.size(), 1u);
+    EXPECT_EQ(continued[0].id, tracker.tracks().id(0));
+    EXPECT_EQ(restarted.nextId(), tracker.nextId());
+    bytes.pop_back();
+    EXPECT_FALSE(decodeStreamState(bytes, decoded));
+
+    // The other node continues with the regions (a manager that is already running)
+    StreamManager target(1, 16, BackpressurePolicy::Block);
+    const size_t other = target.addStream(std::make_unique<MotionProcessor>(configPath()));
+    EXPECT_TRUE(target.submit(other, cameraFrame(1, 0)));
+    auto processor = std::make_unique<MotionProcessor>(configPath());
+    auto consolidator = std::make_unique<MotionRegionConsolidator>();
+    restoreStreamState(state, *processor, consolidator.get());
+    EXPECT_EQ(consolidator->getCurrentRegions().size(), regions.size());
+    const size_t moved = target.addStream(std::move(processor), std::move(consolidator));
+    for (int f = 12; f < 15; ++f) EXPECT_TRUE(target.submit(moved, cameraFrame(0, f)));
+    target.drain();
+    EXPECT_EQ(target.getStats(moved).processed, 3u);
+}
+
+// ============================================================================
+// CLASSIFICATION BATCHING
+// ============================================================================
+
+namespace {
+
+// Without a model the classifier answers "unknown", which is enough to test the batching
+std::unique_ptr<RegionClassifier> disabledClassifier() {
+    return std::make_unique<RegionClassifier>(RegionClassifierConfig{});
+}
+
+}  // namespace
+
+TEST(ClassificationBatcherTest, GathersRequestsIntoOneBatchAndKeepsOrder) {
+    ClassificationBatcher batcher(disabledClassifier(), 8, std::chrono::seconds(10));
+    const cv::Mat frame = cameraFrame(0, 0);
+
+    std::vector<size_t> sizes;  // Callbacks run on the batcher thread, one after another
+    for (size_t count : {2u, 0u, 3u}) {
+        std::vector<cv::Mat> crops(count, frame(cv::Rect(0, 0, 16, 16)));
+        batcher.submit(std::move(crops), [&sizes](std::vector<RegionClassification>& labels) {
+            for (const RegionClassification& label : labels) EXPECT_EQ(label.classId, -1);
+            sizes.push_back(labels.size());
+        });
+    }
+    batcher.flush();  // Well before the 10 s deadline
+
+    EXPECT_EQ(sizes, (std::vector<size_t>{2, 0, 3}));
+    const ClassificationBatcherStats stats = batcher.getStats();
+    EXPECT_EQ(stats.requests, 3u);
+    EXPECT_EQ(stats.crops, 5u);
+    EXPECT_EQ(stats.batches, 1u);
+    EXPECT_EQ(stats.queuedCrops, 0u);
+}
+
+TEST(ClassificationBatcherTest, FullBatchDoesNotWaitForTheDeadline) {
+    ClassificationBatcher batcher(disabledClassifier(), 4, std::chrono::seconds(10));
+    std::atomic<int> delivered{0};
+    for (int i = 0; i < 2; ++i) {
+        batcher.submit(std::vector<cv::Mat>(2), [&](std::vector<RegionClassification>&) { delivered++; });
+    }
+    for (int i = 0; i < 1000 && delivered < 2; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(delivered.load(), 2);
+}
+
+TEST(StreamManagerTest, SharedClassifierLabelsRegionsInStreamOrder) {
+    constexpr int kCameras = 3;
+    constexpr int kFrames = 20;
+
+    StreamManager manager(4, kFrames, BackpressurePolicy::Block);
+    for (int c = 0; c < kCameras; ++c) {
+        manager.addStream(std::make_unique<MotionProcessor>(configPath()),
+                          std::make_unique<MotionRegionConsolidator>());
+    }
+    manager.setRegionClassifier(disabledClassifier(), std::chrono::milliseconds(2));
+
+    std::mutex mutex;
+    std::vector<std::vector<uint64_t>> sequences(kCameras);
+    size_t regions = 0;
+    manager.setResultCallback([&](StreamManager::StreamResult& output) {
+        std::lock_guard<std::mutex> lock(mutex);
+        sequences[output.stream].push_back(output.sequence);
+        for (const ConsolidatedRegion& region : output.regions) EXPECT_EQ(region.classLabel, "unknown");
+        regions += output.regions.size();
+    });
+
+    for (int f = 0; f < kFrames; ++f) {
+        for (int c = 0; c < kCameras; ++c) EXPECT_TRUE(manager.submit(c, cameraFrame(c, f)));
+    }
+    manager.drain();  // Also waits for the batcher
+
+    for (int c = 0; c < kCameras; ++c) {
+        ASSERT_EQ(sequences[c].size(), static_cast<size_t>(kFrames)) << "camera " << c;
+        for (int f = 0; f < kFrames; ++f) EXPECT_EQ(sequences[c][f], static_cast<uint64_t>(f));
+    }
+    const ClassificationBatcherStats stats = manager.getClassificationStats();
+    EXPECT_EQ(stats.requests, static_cast<uint64_t>(kCameras * kFrames));
+    EXPECT_EQ(stats.crops, regions);
+    EXPECT_GT(regions, 0u);
+    EXPECT_THROW(manager.setRegionClassifier(disabledClassifier()), std::logic_error);
+}
+
+// ============================================================================
+// CROSS-CAMERA DEDUPLICATION
+// ============================================================================
+
+namespace {
+
+// A textured patch at @p box; blurred, it stands for the same bird out of focus
+cv::Mat birdView(const cv::Rect& box, bool blurred) {
+    cv::Mat image(240, 320, CV_8UC3, cv::Scalar(30, 30, 30));
+    cv::Mat patch(box.size(), CV_8UC3);
+    cv::randu(patch, cv::Scalar::all(0), cv::Scalar::all(255));
+    if (blurred) cv::GaussianBlur(patch, patch, cv::Size(9, 9), 3.0);
+    patch.copyTo(image(box));
+    return image;
+}
+
+std::vector<ConsolidatedRegion> regionsAt(const std::vector<cv::Rect>& boxes) {
+    std::vector<ConsolidatedRegion> regions(boxes.size());
+    for (size_t i = 0; i < boxes.size(); ++i) regions[i].boundingBox = boxes[i];
+    return regions;
+}
+
+struct Released {
+    size_t stream;
+    uint64_t sequence;
+    std::vector<CrossCameraLinks> links;
+};
+
+}  // namespace
+
+// Camera 1 sees camera 0's scene shifted 100 px right; the sharp view wins, the other refers to it
+TEST(CrossCameraDeduplicatorTest, LinksSimultaneousViewsAndKeepsTheSharpest) {
+    CrossCameraConfig config;
+    config.pairs.push_back({0, 1, cv::Matx33d(1, 0, 100, 0, 1, 0, 0, 0, 1)});
+    std::vector<Released> released;
+    CrossCameraDeduplicator dedup(config, [&](size_t stream, uint64_t sequence, cv::Mat&,
+                                              std::vector<ConsolidatedRegion>& regions,
+                                              std::vector<CrossCameraLinks>& links) {
+        EXPECT_EQ(links.size(), regions.size());
+        released.push_back({stream, sequence, links});
+    });
+    EXPECT_TRUE(dedup.covers(0));
+    EXPECT_TRUE(dedup.covers(1));
+    EXPECT_FALSE(dedup.covers(2));
+
+    const auto t0 = CrossCameraDeduplicator::Clock::now();
+    const cv::Rect bird(20, 40, 60, 50);
+    const cv::Rect shifted = bird + cv::Point(100, 0);
+    const cv::Rect elsewhere(20, 150, 40, 40);  // Only camera 0 sees this one
+    dedup.offer(0, 0, t0, birdView(bird, true), regionsAt({bird, elsewhere}));
+    dedup.offer(1, 0, t0 + std::chrono::milliseconds(5), birdView(shifted, false), regionsAt({shifted}));
+    EXPECT_TRUE(released.empty());  // Both wait for the other camera's next frame
+
+    // Streams outside every pair pass straight through
+    dedup.offer(2, 0, t0, birdView(bird, false), regionsAt({bird}));
+    ASSERT_EQ(released.size(), 1u);
+    EXPECT_EQ(released[0].stream, 2u);
+    EXPECT_FALSE(released[0].links[0].isDuplicate());
+
+    dedup.offer(0, 1, t0 + std::chrono::milliseconds(100), birdView(bird, true), {});
+    ASSERT_EQ(released.size(), 2u);  // Camera 1 frame 0: camera 0 is past it
+    dedup.offer(1, 1, t0 + std::chrono::milliseconds(100), birdView(shifted, false), {});
+    ASSERT_EQ(released.size(), 3u);
+
+    const Released& sharp = released[1];
+    const Released& blurred = released[2];
+    ASSERT_EQ(sharp.stream, 1u);
+    ASSERT_EQ(blurred.stream, 0u);
+    EXPECT_FALSE(sharp.links[0].isDuplicate());
+    ASSERT_EQ(sharp.links[0].otherViews.size(), 1u);
+    EXPECT_EQ(sharp.links[0].otherViews[0].stream, 0u);
+    EXPECT_EQ(sharp.links[0].otherViews[0].region, 0u);
+    ASSERT_TRUE(blurred.links[0].isDuplicate());
+    EXPECT_EQ(blurred.links[0].bestView->stream, 1u);
+    EXPECT_EQ(blurred.links[0].bestView->sequence, 0u);
+    EXPECT_GT(sharp.links[0].viewScore, blurred.links[0].viewScore);
+    EXPECT_FALSE(blurred.links[1].isDuplicate());
+    EXPECT_TRUE(blurred.links[1].otherViews.empty());
+
+    dedup.flush();
+    ASSERT_EQ(released.size(), 5u);
+    const CrossCameraStats stats = dedup.getStats();
+    EXPECT_EQ(stats.results, 5u);
+    EXPECT_EQ(stats.linkedRegions, 2u);
+    EXPECT_EQ(stats.duplicates, 1u);
+    EXPECT_EQ(stats.timedOut, 0u);
+}
+
+// Frames too far apart are different moments; a silent peer holds results for maxWait only
+TEST(CrossCameraDeduplicatorTest, TimeWindowAndMaxWait) {
+    CrossCameraConfig config;
+    config.pairs.push_back(CameraPairCalibration::fromPlane(0, cv::Matx33d::eye(), 1, cv::Matx33d::eye()));
+    std::vector<Released> released;
+    const auto record = [&](size_t stream, uint64_t sequence, cv::Mat&, std::vector<ConsolidatedRegion>&,
+                            std::vector<CrossCameraLinks>& links) { released.push_back({stream, sequence, links}); };
+    const cv::Rect bird(20, 40, 60, 50);
+    const auto t0 = CrossCameraDeduplicator::Clock::now();
+    {
+        CrossCameraDeduplicator dedup(config, record);
+        dedup.offer(0, 0, t0, birdView(bird, false), regionsAt({bird}));
+        dedup.offer(1, 0, t0 + std::chrono::milliseconds(500), birdView(bird, false), regionsAt({bird}));
+        ASSERT_EQ(released.size(), 1u);  // Camera 0's frame: camera 1 is past it
+        dedup.flush();
+        ASSERT_EQ(released.size(), 2u);
+        for (const Released& result : released) {
+            EXPECT_FALSE(result.links[0].isDuplicate());
+            EXPECT_TRUE(result.links[0].otherViews.empty());
+        }
+        EXPECT_EQ(dedup.getStats().linkedRegions, 0u);
+        EXPECT_EQ(dedup.getStats().timedOut, 0u);
+    }
+
+    released.clear();
+    config.maxWait = std::chrono::milliseconds(0);
+    CrossCameraDeduplicator dedup(config, record);
+    dedup.offer(0, 0, t0, birdView(bird, false), regionsAt({bird}));
+    ASSERT_EQ(released.size(), 1u);  // Camera 1 has not delivered anything
+    EXPECT_EQ(dedup.getStats().timedOut, 1u);
+}
+
+// Two cameras with the same view: only camera 0's regions are classified, in stream order
+TEST(StreamManagerTest, CrossCameraDedupClassifiesOnlyTheBestView) {
+    constexpr int kFrames = 20;
+    StreamManager manager(4, kFrames, BackpressurePolicy::Block);
+    for (int c = 0; c < 2; ++c) {
+        manager.addStream(std::make_unique<MotionProcessor>(configPath()),
+                          std::make_unique<MotionRegionConsolidator>());
+    }
+    manager.setRegionClassifier(disabledClassifier(), std::chrono::milliseconds(2));
+    CrossCameraConfig config;
+    config.pairs.push_back({0, 1, cv::Matx33d::eye()});
+    manager.setCrossCameraDedup(config);
+
+    std::mutex mutex;
+    std::vector<std::vector<uint64_t>> sequences(2);
+    std::vector<size_t> regions(2, 0);
+    size_t duplicates = 0;
+    manager.setResultCallback([&](StreamManager::StreamResult& output) {
+        std::lock_guard<std::mutex> lock(mutex);
+        sequences[output.stream].push_back(output.sequence);
+        ASSERT_EQ(output.crossCamera.size(), output.regions.size());
+        regions[output.stream] += output.regions.size();
+        for (const CrossCameraLinks& links : output.crossCamera) {
+            // Equal scores: the lower stream is the best view
+            EXPECT_EQ(links.isDuplicate(), output.stream == 1);
+            if (links.isDuplicate()) {
+                EXPECT_EQ(links.bestView->stream, 0u);
+                EXPECT_EQ(links.bestView->sequence, output.sequence);
+                duplicates++;
+            }
+        }
+    });
+
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int f = 0; f < kFrames; ++f) {
+        const auto captured = t0 + std::chrono::milliseconds(100 * f);
+        for (int c = 0; c < 2; ++c) EXPECT_TRUE(manager.submit(c, cameraFrame(0, f), captured));
+    }
+    manager.drain();  // Also releases the last frames, which wait for a later peer frame
+
+    for (int c = 0; c < 2; ++c) {
+        ASSERT_EQ(sequences[c].size(), static_cast<size_t>(kFrames)) << "camera " << c;
+        for (int f = 0; f < kFrames; ++f) EXPECT_EQ(sequences[c][f], static_cast<uint64_t>(f));
+    }
+    EXPECT_GT(regions[0], 0u);
+    EXPECT_EQ(regions[1], regions[0]);
+    EXPECT_EQ(duplicates, regions[1]);
+    EXPECT_EQ(manager.getClassificationStats().crops, regions[0]);
+    const CrossCameraStats stats = manager.getCrossCameraStats();
+    EXPECT_EQ(stats.results, static_cast<uint64_t>(2 * kFrames));
+    EXPECT_EQ(stats.duplicates, duplicates);
+}
+
+// ============================================================================
+// LOAD SHEDDING
+// ============================================================================
+
+namespace {
+
+LoadSheddingConfig sheddingConfig() {
+    LoadSheddingConfig config;
+    config.enabled = true;
+    config.frameIntervalMs = 10.0;
+    config.maxStride = 3;
+    config.minScaleFactor = 0.5;
+    config.activeHoldFrames = 5;
+    config.adjustIntervalFrames = 1;
+    config.smoothing = 1.0;  // Latest time only, so each step is easy to predict
+    return config;
+}
+
+}  // namespace
+
+// Overload walks the quiet stream down the ladder; the busy one keeps full rate
+TEST(LoadShedderTest, ShedsQuietStreamsFirstAndRecovers) {
+    LoadShedder shedder(sheddingConfig());
+    const size_t quiet = shedder.addStream();
+    const size_t busy = shedder.addStream();
+
+    // 8 ms + 8 ms per 10 ms interval: 160% of the budget
+    for (int i = 0; i < 4; ++i) {
+        shedder.recordProcessed(busy, 8.0, true);
+        shedder.recordProcessed(quiet, 8.0, false);
+    }
+    EXPECT_EQ(shedder.rate(busy).stride, 1);
+    EXPECT_DOUBLE_EQ(shedder.rate(busy).scaleFactor, 1.0);
+    EXPECT_EQ(shedder.rate(quiet).stride, 3);
+    EXPECT_DOUBLE_EQ(shedder.rate(quiet).scaleFactor, 0.5);
+    EXPECT_TRUE(shedder.rate(busy).active);
+
+    // Stride 3: two of every three frames are skipped
+    int processed = 0;
+    for (int i = 0; i < 9; ++i) processed += shedder.shouldProcess(quiet);
+    EXPECT_EQ(processed, 3);
+    EXPECT_EQ(shedder.rate(quiet).skipped, 6u);
+
+    // Cheap frames: steps come back one at a time, as long as they fit
+    shedder.recordProcessed(busy, 0.5, true);
+    EXPECT_EQ(shedder.rate(quiet).stride, 3);
+    EXPECT_DOUBLE_EQ(shedder.rate(quiet).scaleFactor, 1.0);
+    shedder.recordProcessed(busy, 0.5, true);
+    EXPECT_EQ(shedder.rate(quiet).stride, 2);
+    shedder.recordProcessed(busy, 0.5, true);
+    EXPECT_EQ(shedder.rate(quiet).stride, 1);
+}
+
+// Regions on a reduced stream put it back to full rate at once
+TEST(LoadShedderTest, ActivityRestoresFullRate) {
+    LoadShedder shedder(sheddingConfig());
+    const size_t stream = shedder.addStream();
+    shedder.recordProcessed(stream, 20.0, false);
+    shedder.recordProcessed(stream, 20.0, false);
+    ASSERT_EQ(shedder.rate(stream).stride, 3);
+
+    shedder.recordProcessed(stream, 20.0, true);
+    EXPECT_EQ(shedder.rate(stream).stride, 1);
+    // Still overloaded, but active streams are not shed
+    for (int i = 0; i < 3; ++i) shedder.recordProcessed(stream, 20.0, false);
+    EXPECT_EQ(shedder.rate(stream).stride, 1);
+    EXPECT_GT(shedder.utilization(), 1.0);
+}
+
+// Frames a decoder already left out count towards the stride and as shed
+TEST(LoadShedderTest, FramesSkippedUpstreamCountTowardsTheStride) {
+    LoadShedder shedder(sheddingConfig());
+    const size_t stream = shedder.addStream();
+    shedder.recordProcessed(stream, 20.0, false);
+    shedder.recordProcessed(stream, 20.0, false);
+    ASSERT_EQ(shedder.rate(stream).stride, 3);
+
+    // The decoder delivers every 3rd frame: each one is processed, never shed twice
+    for (int i = 0; i < 4; ++i) EXPECT_TRUE(shedder.shouldProcess(stream, 3));
+    EXPECT_EQ(shedder.rate(stream).skipped, 8u);
+    // A decoder still at stride 2 (its lookahead) leaves the rest to the shedder
+    EXPECT_FALSE(shedder.shouldProcess(stream, 2));
+    EXPECT_TRUE(shedder.shouldProcess(stream, 2));
+    EXPECT_EQ(shedder.rate(stream).skipped, 8u + 2u + 1u);
+}
+
+// Disabled, nothing is shed but the rates are still tracked
+TEST(LoadShedderTest, DisabledOnlyMeasures) {
+    LoadSheddingConfig config = sheddingConfig();
+    config.enabled = false;
+    LoadShedder shedder(config);
+    const size_t stream = shedder.addStream();
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i <= 30; ++i) {
+        shedder.recordProcessed(stream, 50.0, false, start + std::chrono::milliseconds(i * 40));
+    }
+    for (int i = 0; i < 10; ++i) EXPECT_TRUE(shedder.shouldProcess(stream));
+    EXPECT_EQ(shedder.rate(stream).stride, 1);
+    EXPECT_NEAR(shedder.rate(stream).processingFps, 25.0, 1.0);
+}
+
+// An overloaded pool skips frames of a still camera, not of the one with a moving bird
+// Coarsest scale that keeps the 5th-percentile bird 12 px across; coarser only with margin
+TEST(AdaptiveDetectionScaleTest, FollowsBirdSizesWithHysteresis) {
+    AdaptiveScaleConfig config;
+    config.enabled = true;
+    config.minObjectPixels = 12.0;
+    config.evaluateIntervalFrames = 10;
+    config.minSamples = 20;
+    AdaptiveDetectionScale adaptive(config, 1.0);
+    // Ten frames of three birds of @p side px; true if the scale changed on the last one
+    const auto feed = [&](int side) {
+        bool changed = false;
+        for (int frame = 0; frame < 10; ++frame) {
+            changed = adaptive.observe({cv::Rect(0, 0, side, side + 5), cv::Rect(50, 0, side + 5, side),
+                                        cv::Rect(0, 50, side, side)}) || changed;
+        }
+        return changed;
+    };
+
+    EXPECT_TRUE(feed(80));  // Close camera: down to min_scale
+    EXPECT_DOUBLE_EQ(adaptive.scale(), 0.25);
+    EXPECT_DOUBLE_EQ(adaptive.sizeQuantile(), 80.0);
+    EXPECT_TRUE(feed(40));  // 12 / 40 = 0.3, up to the next step at once
+    EXPECT_DOUBLE_EQ(adaptive.scale(), 0.375);
+    EXPECT_FALSE(feed(50));  // 0.25 would do, but not with the 25% margin
+    EXPECT_DOUBLE_EQ(adaptive.scale(), 0.375);
+    EXPECT_TRUE(feed(60));
+    EXPECT_DOUBLE_EQ(adaptive.scale(), 0.25);
+    EXPECT_EQ(adaptive.changes(), 3u);
+
+    // Frames without birds do not evaluate; their samples keep collecting
+    for (int frame = 0; frame < 30; ++frame) EXPECT_FALSE(adaptive.observe({}));
+    EXPECT_TRUE(adaptive.observe(std::vector<cv::Rect>(20, cv::Rect(0, 0, 10, 10))));
+    EXPECT_DOUBLE_EQ(adaptive.scale(), 1.0);  // 12 / 10 clamps to max_scale
+
+    config.enabled = false;
+    AdaptiveDetectionScale disabled(config, 0.5);
+    for (int frame = 0; frame < 20; ++frame) EXPECT_FALSE(disabled.observe({cv::Rect(0, 0, 80, 80)}));
+    EXPECT_DOUBLE_EQ(disabled.scale(), 0.5);
+}
+
+TEST(StreamManagerTest, LoadSheddingSkipsQuietStreams) {
+    StreamManager manager(1, 4, BackpressurePolicy::Block);
+    const size_t still = manager.addStream(std::make_unique<MotionProcessor>(configPath()),
+                                           std::make_unique<MotionRegionConsolidator>());
+    const size_t moving = manager.addStream(std::make_unique<MotionProcessor>(configPath()),
+                                            std::make_unique<MotionRegionConsolidator>());
+    LoadSheddingConfig config;
+    config.enabled = true;
+    config.frameIntervalMs = 1.0;  // No frame is processed this fast: always overloaded
+    config.adjustIntervalFrames = 2;
+    manager.setLoadShedding(config);
+
+    const cv::Mat stillFrame = cameraFrame(0, 0);
+    for (int f = 0; f < 60; ++f) {
+        manager.submit(still, stillFrame.clone());
+        manager.submit(moving, cameraFrame(1, f));
+        manager.drain();
+    }
+
+    const StreamManager::StreamStats stillStats = manager.getStats(still);
+    const StreamManager::StreamStats movingStats = manager.getStats(moving);
+    EXPECT_GT(stillStats.skipped, 0u);
+    EXPECT_GT(stillStats.frameStride, 1);
+    EXPECT_EQ(stillStats.processed + stillStats.skipped, 60u);
+    EXPECT_EQ(movingStats.frameStride, 1);
+    EXPECT_GT(movingStats.processed, stillStats.processed);
+    EXPECT_GT(movingStats.processingMs, 0.0);
+}
+
+// A critical stream queued behind a flood of background frames runs first, and only it
+// misses its (impossible) deadline
+TEST(StreamManagerTest, DeadlineSchedulingRunsTheMostUrgentStreamFirst) {
+    StreamManager manager(1, 16, BackpressurePolicy::Block);
+    const size_t flood = manager.addStream(std::make_unique<MotionProcessor>(configPath()),
+                                           std::make_unique<MotionRegionConsolidator>());
+    const size_t critical = manager.addStream(std::make_unique<MotionProcessor>(configPath()),
+                                              std::make_unique<MotionRegionConsolidator>());
+    manager.setDeadlineScheduling(true);
+    EXPECT_TRUE(manager.isDeadlineScheduling());
+    manager.setStreamSlo(flood, {std::chrono::hours(1), StreamManager::Priority::Background});
+    manager.setStreamSlo(critical, {std::chrono::milliseconds(0), StreamManager::Priority::Critical});
+
+    std::atomic<bool> holding{false};
+    std::atomic<bool> release{false};
+    std::mutex mutex;
+    std::vector<size_t> order;
+    manager.setResultCallback([&](StreamManager::StreamResult& output) {
+        holding = true;
+        while (!release) std::this_thread::yield();
+        std::lock_guard<std::mutex> lock(mutex);
+        order.push_back(output.stream);
+    });
+
+    // The first flood frame holds the only worker while both queues fill
+    EXPECT_TRUE(manager.submit(flood, cameraFrame(0, 0)));
+    while (!holding) std::this_thread::yield();
+    for (int f = 1; f < 10; ++f) EXPECT_TRUE(manager.submit(flood, cameraFrame(0, f)));
+    for (int f = 0; f < 3; ++f) EXPECT_TRUE(manager.submit(critical, cameraFrame(1, f)));
+    release = true;
+    manager.drain();
+
+    ASSERT_EQ(order.size(), 13u);
+    EXPECT_EQ(order[0], flood);
+    for (size_t i = 1; i <= 3; ++i) EXPECT_EQ(order[i], critical) << "result " << i;
+    EXPECT_THROW(manager.setDeadlineScheduling(false), std::logic_error);
+
+    EXPECT_EQ(manager.getStats(flood).deadlineMisses, 0u);
+    EXPECT_EQ(manager.getStats(critical).deadlineMisses, 3u);
+    PrometheusTextWriter writer;
+    manager.writeMetrics(writer);
+    EXPECT_NE(writer.text().find("birds_stream_deadline_misses_total{stream=\"default\"} 3\n"), std::string::npos);
+    EXPECT_NE(writer.text().find("# TYPE birds_stream_yields_total counter\n"), std::string::npos);
+}
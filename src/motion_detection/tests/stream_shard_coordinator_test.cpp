@@ -0,0 +1,209 @@
+#include "stream_shard_coordinator.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "logger.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("debug", "stream_shard_coordinator_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class StreamShardCoordinatorTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const streamShardCoordinatorEnv =
+    ::testing::AddGlobalTestEnvironment(new StreamShardCoordinatorTestEnvironment());
+
+namespace {
+
+using Clock = StreamShardCoordinator::Clock;
+
+// What a node running @p streams at @p processingMs per frame and 25 fps reports
+NodeLoadReport nodeReport(const std::string& node, size_t workers, const std::vector<std::string>& streams,
+                          double processingMs = 20.0) {
+    NodeLoadReport report;
+    report.node = node;
+    report.workers = workers;
+    for (const std::string& stream : streams) report.streams.push_back({stream, processingMs, 25.0, 1});
+    return report;
+}
+
+std::map<std::string, size_t> streamsPerNode(const StreamShardCoordinator& coordinator) {
+    std::map<std::string, size_t> counts;
+    for (const auto& node : coordinator.nodes()) counts[node.node] = node.streams.size();
+    return counts;
+}
+
+}  // namespace
+
+// New streams fill the nodes by their worker counts; a coordinator restart adopts what runs
+TEST(StreamShardCoordinatorTest, PlacesNewStreamsByCapacity) {
+    StreamShardCoordinator coordinator;
+    const Clock::time_point now = Clock::now();
+    coordinator.report(nodeReport("a", 4, {}), now);
+    coordinator.report(nodeReport("b", 2, {}), now);
+    for (int i = 0; i < 6; ++i) coordinator.addStream("cam" + std::to_string(i));
+
+    const std::vector<StreamMove> moves = coordinator.plan(now);
+    ASSERT_EQ(moves.size(), 6u);
+    for (const StreamMove& move : moves) {
+        EXPECT_EQ(move.reason, StreamMove::Reason::Unassigned);
+        EXPECT_TRUE(move.from.empty());
+        EXPECT_EQ(coordinator.nodeOf(move.stream), move.to);
+    }
+    EXPECT_EQ(streamsPerNode(coordinator), (std::map<std::string, size_t>{{"a", 4}, {"b", 2}}));
+    EXPECT_TRUE(coordinator.plan(now).empty());
+
+    StreamShardCoordinator restarted;
+    restarted.addStream("cam0");
+    restarted.report(nodeReport("b", 2, {"cam0"}), now);
+    EXPECT_TRUE(restarted.plan(now).empty());
+    EXPECT_EQ(restarted.nodeOf("cam0"), "b");
+}
+
+// Before any node reports a stream's load, it is placed at the cost model's estimate
+TEST(StreamShardCoordinatorTest, PlacesUnreportedStreamsAtTheirEstimate) {
+    StreamShardCoordinator coordinator;
+    const Clock::time_point now = Clock::now();
+    coordinator.report(nodeReport("a", 4, {}), now);
+    coordinator.report(nodeReport("b", 4, {}), now);
+    coordinator.addStream("uhd", 2.0);
+    for (int i = 0; i < 4; ++i) coordinator.addStream("hd" + std::to_string(i), 0.5);
+
+    EXPECT_EQ(coordinator.plan(now).size(), 5u);
+    EXPECT_EQ(coordinator.nodeOf("uhd"), "a");
+    EXPECT_EQ(streamsPerNode(coordinator), (std::map<std::string, size_t>{{"a", 1}, {"b", 4}}));
+    for (const auto& node : coordinator.nodes()) EXPECT_DOUBLE_EQ(node.utilization, 0.5);
+
+    // The first real report replaces the estimate
+    coordinator.report(nodeReport("a", 4, {"uhd"}, 40.0), now);
+    const auto nodes = coordinator.nodes();
+    const auto a = std::find_if(nodes.begin(), nodes.end(), [](const auto& node) { return node.node == "a"; });
+    ASSERT_NE(a, nodes.end());
+    EXPECT_DOUBLE_EQ(a->utilization, 0.25);
+}
+
+// A node that stops reporting loses its streams to the live ones, with their last checkpoints
+TEST(StreamShardCoordinatorTest, MovesStreamsOfAFailedNode) {
+    ShardingConfig config;
+    config.nodeTimeout = std::chrono::seconds(5);
+    StreamShardCoordinator coordinator(config);
+    Clock::time_point now = Clock::now();
+    coordinator.report(nodeReport("a", 4, {}), now);
+    coordinator.report(nodeReport("b", 4, {}), now);
+    for (int i = 0; i < 4; ++i) coordinator.addStream("cam" + std::to_string(i));
+    coordinator.plan(now);
+    std::vector<std::string> onB;
+    for (const auto& node : coordinator.nodes()) {
+        if (node.node == "b") onB = node.streams;
+    }
+    ASSERT_EQ(onB.size(), 2u);
+    coordinator.storeCheckpoint(onB[0], {1, 2, 3});
+
+    now += std::chrono::seconds(4);
+    coordinator.report(nodeReport("a", 4, {}), now);
+    EXPECT_TRUE(coordinator.plan(now).empty());  // b is late, not failed yet
+
+    now += std::chrono::seconds(2);
+    coordinator.report(nodeReport("a", 4, {}), now);
+    const std::vector<StreamMove> moves = coordinator.plan(now);
+    ASSERT_EQ(moves.size(), 2u);
+    for (const StreamMove& move : moves) {
+        EXPECT_EQ(move.reason, StreamMove::Reason::NodeFailed);
+        EXPECT_EQ(move.from, "b");
+        EXPECT_EQ(move.to, "a");
+    }
+    EXPECT_EQ(coordinator.checkpoint(onB[0]), (std::vector<unsigned char>{1, 2, 3}));
+    EXPECT_TRUE(coordinator.checkpoint(onB[1]).empty());
+    for (const auto& node : coordinator.nodes()) EXPECT_EQ(node.live, node.node == "a");
+}
+
+// An overloaded node sheds onto a node that joins, then the two are evened out; a third
+// node takes its share from the streams outside their cooldown
+TEST(StreamShardCoordinatorTest, SpreadsLoadOntoJoiningNodes) {
+    ShardingConfig config;
+    config.moveCooldown = std::chrono::seconds(30);
+    StreamShardCoordinator coordinator(config);
+    Clock::time_point now = Clock::now();
+    const std::vector<std::string> cameras = {"cam0", "cam1", "cam2", "cam3"};
+    for (const std::string& camera : cameras) coordinator.addStream(camera);
+    coordinator.report(nodeReport("a", 2, {}), now);
+    coordinator.plan(now);
+    // 20 ms x 25 fps = half a worker each: two workers' worth on a node with two
+    coordinator.report(nodeReport("a", 2, cameras), now);
+    EXPECT_TRUE(coordinator.plan(now).empty());  // Nowhere to go
+    EXPECT_DOUBLE_EQ(coordinator.nodes()[0].utilization, 1.0);
+
+    now += std::chrono::seconds(31);  // Past the cooldown of the initial placement
+    coordinator.report(nodeReport("a", 2, cameras), now);
+    coordinator.report(nodeReport("b", 2, {}), now);
+    const std::vector<StreamMove> moves = coordinator.plan(now);
+    ASSERT_EQ(moves.size(), 2u);
+    EXPECT_EQ(moves[0].reason, StreamMove::Reason::Overload);
+    EXPECT_EQ(moves[1].reason, StreamMove::Reason::Rebalance);
+    for (const StreamMove& move : moves) {
+        EXPECT_EQ(move.from, "a");
+        EXPECT_EQ(move.to, "b");
+    }
+    for (const auto& node : coordinator.nodes()) EXPECT_DOUBLE_EQ(node.utilization, 0.5);
+
+    // A third node: 0.5 against 0 is beyond the imbalance; only a's streams may move yet
+    now += std::chrono::seconds(1);
+    coordinator.report(nodeReport("c", 2, {}), now);
+    const std::vector<StreamMove> third = coordinator.plan(now);
+    ASSERT_EQ(third.size(), 1u);
+    EXPECT_EQ(third[0].from, "a");
+    EXPECT_EQ(third[0].to, "c");
+    EXPECT_TRUE(coordinator.plan(now).empty());  // 0.5 / 0.25 / 0.25: within imbalance
+}
+
+// The families StreamManager::writeMetrics() exports, among others on the page
+TEST(StreamShardCoordinatorTest, ParsesTheNodeMetricsPage) {
+    const std::string page =
+        "# HELP birds_frames_processed_total Frames that completed detection and consolidation\n"
+        "# TYPE birds_frames_processed_total counter\n"
+        "birds_frames_processed_total 1200\n"
+        "# TYPE birds_stream_workers gauge\n"
+        "birds_stream_workers 8\n"
+        "# TYPE birds_stream_processing_seconds gauge\n"
+        "birds_stream_processing_seconds{stream=\"garden\"} 0.012\n"
+        "birds_stream_processing_seconds{stream=\"pond \\\"north\\\"\"} 0.03\n"
+        "# TYPE birds_stream_processing_fps gauge\n"
+        "birds_stream_processing_fps{stream=\"garden\"} 25\n"
+        "birds_stream_processing_fps{stream=\"pond \\\"north\\\"\"} 15\n"
+        "# TYPE birds_stream_frame_stride gauge\n"
+        "birds_stream_frame_stride{stream=\"garden\"} 1\n"
+        "birds_stream_frame_stride{stream=\"pond \\\"north\\\"\"} 2\n"
+        "birds_stream_frames_processed_total{stream=\"garden\"} 900\n";
+    NodeLoadReport report;
+    report.node = "node-1";
+    ASSERT_TRUE(parseNodeLoadReport(page, report));
+    EXPECT_EQ(report.node, "node-1");
+    EXPECT_EQ(report.workers, 8u);
+    ASSERT_EQ(report.streams.size(), 2u);
+    EXPECT_EQ(report.streams[0].stream, "garden");
+    EXPECT_DOUBLE_EQ(report.streams[0].processingMs, 12.0);
+    EXPECT_DOUBLE_EQ(report.streams[0].processingFps, 25.0);
+    EXPECT_EQ(report.streams[0].frameStride, 1);
+    EXPECT_EQ(report.streams[1].stream, "pond \"north\"");
+    EXPECT_DOUBLE_EQ(report.streams[1].processingMs, 30.0);
+    EXPECT_EQ(report.streams[1].frameStride, 2);
+
+    NodeLoadReport other;
+    EXPECT_FALSE(parseNodeLoadReport("birds_frames_processed_total 1\n", other));
+}
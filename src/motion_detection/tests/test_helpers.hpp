@@ -6,6 +6,10 @@
 #include <unistd.h>
 #include <limits.h>
 
+#include <gtest/gtest.h>
+
+#include "allocation_counter.hpp"
+
 /**
  * Find the test resource directory relative to the executable location.
  * This allows tests to find test images regardless of where the executable is run from.
@@ -35,4 +39,29 @@ inline std::string findTestResourceDir() {
     return ".";
 }
 
+/**
+ * Expect @p statement to make no heap allocation (operator new or cv::Mat buffer) on any
+ * thread, e.g. EXPECT_NO_ALLOCATIONS(processor.processFrame(frame)) once the buffers are
+ * warm. A failure lists the allocations by pipeline stage. Only checks in
+ * ENABLE_ALLOCATION_COUNTING builds (the Debug default); elsewhere the statement just runs.
+ */
+#if BIRDS_ALLOCATION_COUNTING
+#define EXPECT_NO_ALLOCATIONS(statement)                                                          \
+    do {                                                                                          \
+        AllocationCounter::countMatAllocations();                                                 \
+        const StageAllocations stagesBefore_ = AllocationCounter::stages();                       \
+        const AllocationCounts countsBefore_ = AllocationCounter::snapshot();                     \
+        statement;                                                                                \
+        const AllocationCounts allocated_ = AllocationCounter::snapshot() - countsBefore_;        \
+        EXPECT_EQ(allocated_.allocations, 0u)                                                     \
+            << #statement << " allocated " << allocated_.bytes << " bytes; "                      \
+            << AllocationCounter::describe(stagesBefore_, AllocationCounter::stages());           \
+    } while (0)
+#else
+#define EXPECT_NO_ALLOCATIONS(statement) \
+    do {                                 \
+        statement;                       \
+    } while (0)
+#endif
+
 #endif // TEST_HELPERS_HPP
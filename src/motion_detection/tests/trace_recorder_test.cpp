@@ -0,0 +1,160 @@
+#include "trace_recorder.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "logger.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("debug", "trace_recorder_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class TraceRecorderTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const traceRecorderEnv =
+    ::testing::AddGlobalTestEnvironment(new TraceRecorderTestEnvironment());
+
+namespace fs = std::filesystem;
+using namespace std::chrono_literals;
+
+namespace {
+
+// Frame captured at @p captured: each stage queues 1 ms and runs 2 ms, output 1 ms later
+FrameTrace makeTrace(FrameTrace::Clock::time_point captured) {
+    FrameTrace trace;
+    trace.captured = captured;
+    trace.captureUnixUs = 1700000000000000;
+    trace.sourceTimestampMs = 40.0;
+    FrameTrace::Clock::time_point at = captured;
+    for (size_t stage = 0; stage < FrameTrace::kStageCount; ++stage) {
+        trace.entered[stage] = at += 1ms;
+        trace.exited[stage] = at += 2ms;
+    }
+    trace.delivered = at + 1ms;
+    return trace;
+}
+
+size_t countOf(const std::string& text, const std::string& pattern) {
+    size_t count = 0;
+    for (size_t at = text.find(pattern); at != std::string::npos; at = text.find(pattern, at + 1)) {
+        ++count;
+    }
+    return count;
+}
+
+std::string tracePath(const char* name) {
+    return (fs::temp_directory_path() / (std::string("birds_") + name) / "trace.json").string();
+}
+
+}  // namespace
+
+TEST(FrameTraceTest, SplitsLatencyIntoQueuedAndRunningTime) {
+    const FrameTrace trace = makeTrace(FrameTrace::Clock::now());
+    EXPECT_DOUBLE_EQ(trace.waitMs(TraceStage::DETECT), 1.0);
+    EXPECT_DOUBLE_EQ(trace.runMs(TraceStage::CONSOLIDATE), 2.0);
+    EXPECT_DOUBLE_EQ(trace.waitMs(TraceStage::RENDER), 1.0);
+    EXPECT_DOUBLE_EQ(trace.sinceCaptureMs(trace.delivered), 10.0);
+    EXPECT_TRUE(trace.reached(TraceStage::RENDER));
+
+    FrameTrace captured;
+    captured.captured = FrameTrace::Clock::now();
+    EXPECT_FALSE(captured.reached(TraceStage::DETECT));
+    EXPECT_DOUBLE_EQ(captured.runMs(TraceStage::DETECT), 0.0);
+    {
+        FrameTrace::Scope scope(captured, TraceStage::DETECT);
+    }
+    EXPECT_TRUE(captured.reached(TraceStage::DETECT));
+    EXPECT_GE(captured.waitMs(TraceStage::DETECT), 0.0);
+}
+
+TEST(TraceRecorderTest, WritesStageEventsOfEveryFrame) {
+    TraceRecorderConfig config;
+    config.enabled = true;
+    config.startAfterSeconds = 0.0;
+    TraceRecorder recorder(config);
+    const auto start = FrameTrace::Clock::now();
+    recorder.record(1, makeTrace(start));
+    recorder.record(2, makeTrace(start + 33ms));
+    ASSERT_EQ(recorder.size(), 2u);
+
+    std::ostringstream out;
+    recorder.writeJson(out);
+    const std::string json = out.str();
+    EXPECT_EQ(json.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0), 0u);
+    EXPECT_EQ(json.substr(json.size() - 4), "\n]}\n");
+    EXPECT_EQ(countOf(json, "\"ph\":\"X\""), 2 * FrameTrace::kStageCount);
+    EXPECT_EQ(countOf(json, "\"name\":\"frame\""), 4u);  // Begin and end of both frames
+    EXPECT_EQ(countOf(json, "\"name\":\"queued: consolidate\""), 4u);
+    EXPECT_EQ(countOf(json, "\"name\":\"thread_name\""), FrameTrace::kStageCount);
+    // Second frame's detect stage: 33 ms + 1 ms queued after the first capture, 2 ms long
+    EXPECT_NE(json.find("\"name\":\"detect\",\"cat\":\"stage\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+                        "\"ts\":34000.000,\"dur\":2000.000,\"args\":{\"frame\":2}"),
+              std::string::npos);
+    EXPECT_NE(json.find("\"capture_unix_us\":1700000000000000,\"source_timestamp_ms\":40.000"),
+              std::string::npos);
+    EXPECT_EQ(countOf(json, "{"), countOf(json, "}"));
+}
+
+// Frames before the window are ignored; the first frame past it writes the file
+TEST(TraceRecorderTest, WritesTheConfiguredWindowOnce) {
+    TraceRecorderConfig config;
+    config.enabled = true;
+    config.path = tracePath("trace_recorder_window");
+    config.startAfterSeconds = 1.0;
+    config.durationSeconds = 0.5;
+    fs::remove_all(fs::path(config.path).parent_path());
+    TraceRecorder recorder(config);
+
+    const auto start = FrameTrace::Clock::now();
+    for (int frame = 0; frame < 60; ++frame) {
+        recorder.record(frame, makeTrace(start + frame * 33ms));
+        if (recorder.isDone()) break;
+    }
+    EXPECT_TRUE(recorder.isDone());
+    EXPECT_FALSE(recorder.finish());
+    ASSERT_TRUE(fs::exists(config.path));
+    std::ifstream file(config.path);
+    const std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    // Captures at 1023..1485 ms fall in [1000, 1500) ms
+    EXPECT_EQ(countOf(json, "\"ph\":\"X\""), 15 * FrameTrace::kStageCount);
+    EXPECT_NE(json.find("\"frame\":31"), std::string::npos);
+    EXPECT_EQ(json.find("\"frame\":30}"), std::string::npos);
+    fs::remove_all(fs::path(config.path).parent_path());
+}
+
+TEST(TraceRecorderTest, FinishWritesAnOpenWindow) {
+    TraceRecorderConfig config;
+    config.enabled = true;
+    config.path = tracePath("trace_recorder_finish");
+    config.startAfterSeconds = 0.0;
+    config.durationSeconds = 60.0;
+    fs::remove_all(fs::path(config.path).parent_path());
+
+    TraceRecorder disabled(TraceRecorderConfig{});
+    disabled.record(1, makeTrace(FrameTrace::Clock::now()));
+    EXPECT_FALSE(disabled.finish());
+
+    TraceRecorder recorder(config);
+    EXPECT_FALSE(recorder.finish());  // Nothing recorded yet
+    recorder.record(1, makeTrace(FrameTrace::Clock::now()));
+    EXPECT_FALSE(recorder.isDone());
+    EXPECT_TRUE(recorder.finish());
+    EXPECT_TRUE(recorder.isDone());
+    EXPECT_TRUE(fs::exists(config.path));
+    fs::remove_all(fs::path(config.path).parent_path());
+}
@@ -0,0 +1,330 @@
+#include "uplink_ingest.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "logger.hpp"
+#include "uplink_backend.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("debug", "uplink_ingest_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class UplinkIngestTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const uplinkIngestEnv =
+    ::testing::AddGlobalTestEnvironment(new UplinkIngestTestEnvironment());
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Backend that keeps what it is given; refuses the first refuseBatches frame batches
+class CapturingBackend : public PersistenceBackend {
+   public:
+    const char* name() const override { return "capturing"; }
+
+    bool connect() override { return true; }
+
+    std::vector<std::string> insertRecords(const std::vector<StoredFrameRecord>& records) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (refuseBatches > 0) {
+            --refuseBatches;
+            return {};
+        }
+        std::vector<std::string> uuids;
+        for (const StoredFrameRecord& record : records) {
+            frames.push_back(record);
+            uuids.push_back(record.uuid);
+        }
+        return uuids;
+    }
+
+    bool upsertMotionSummaries(const std::vector<MotionMinuteSummary>& values) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        summaries.insert(summaries.end(), values.begin(), values.end());
+        return true;
+    }
+
+    std::mutex mutex;
+    int refuseBatches = 0;
+    std::vector<StoredFrameRecord> frames;
+    std::vector<MotionMinuteSummary> summaries;
+};
+
+bool waitFor(const std::function<bool()>& condition) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+StoredFrameRecord sampleRecord() {
+    StoredFrameRecord record;
+    record.uuid = "frame-1";
+    record.originalThumbnailPath = "thumbs/frame-1.jpg";
+    record.processedSegment = {"segment_000001.seg", 4096, 1234};
+    record.originalThumbnailBytes = 2048;
+    record.processedBytes = 1234;
+    record.originalSize = cv::Size(1920, 1080);
+    record.processedSize = cv::Size(960, 540);
+    record.processedChannels = 1;
+    record.regionCrops.push_back({"crops/frame-1_0.jpg", cv::Rect(10, 20, 30, 40), cv::Rect(5, 15, 40, 50), 512});
+    record.plate = {"plate-1", "plates/plate-1.jpg", cv::Size(640, 360)};
+    FrameMetadata& metadata = record.metadata;
+    metadata.source = "garden \"east\"";
+    metadata.frameCount = 812;
+    metadata.timestamp = 1760000000;
+    metadata.motionDetected = true;
+    metadata.motionRegions = 3;
+    metadata.confidence = 0.75;
+    RegionMetadata region;
+    region.box = cv::Rect(10, 20, 30, 40);
+    region.objectCount = 2;
+    region.speed = 4.5f;
+    region.direction = 270.0f;
+    metadata.consolidatedRegions.push_back(region);
+    metadata.includeMotionBoxes = true;
+    metadata.motionBoxes = {cv::Rect(1, 2, 3, 4)};
+    metadata.captureTimeUs = 1760000000123000;
+    metadata.sourceTimestampMs = 99.5;
+    metadata.latency.detectMs = 3.25;
+    metadata.latency.totalMs = 12.5;
+    metadata.motionMask.size = cv::Size(480, 270);
+    metadata.motionMask.frameArea = cv::Rect(0, 0, 960, 540);
+    metadata.motionMask.pixels = 1200;
+    metadata.motionMask.bounds = cv::Rect(10, 20, 30, 40);
+    metadata.motionMask.centroid = cv::Point2d(24.5, 40.25);
+    metadata.motionMask.counts = "P`5Q0O1";
+    metadata.isVisit = true;
+    metadata.visit.startUs = 1759999990250000;
+    metadata.visit.endUs = 1760000000125000;
+    metadata.visit.frames = 240;
+    metadata.visit.trackIds = {4, 9};
+    metadata.visit.path = {{cv::Point(25, 40), 0}, {cv::Point(31, 38), 4500}};
+    metadata.visit.cropScores = {812.5};
+    return record;
+}
+
+}  // namespace
+
+// parseFrameDocument() / parseMotionSummary() read back what the backends write
+TEST(UplinkIngestTest, ParsesTheDocumentsBackendsWrite) {
+    const StoredFrameRecord original = sampleRecord();
+    StoredFrameRecord parsed;
+    ASSERT_TRUE(parseFrameDocument(frameDocumentJson(original, 1760000001000), parsed));
+    EXPECT_EQ(parsed.uuid, original.uuid);
+    EXPECT_EQ(parsed.originalPath, "");
+    EXPECT_EQ(parsed.originalThumbnailPath, original.originalThumbnailPath);
+    EXPECT_EQ(parsed.processedSegment.file, original.processedSegment.file);
+    EXPECT_EQ(parsed.processedSegment.offset, 4096u);
+    EXPECT_EQ(parsed.processedSegment.length, 1234u);
+    EXPECT_TRUE(parsed.originalSegment.empty());
+    EXPECT_EQ(parsed.originalSize, original.originalSize);
+    EXPECT_EQ(parsed.processedSize, original.processedSize);
+    EXPECT_EQ(parsed.processedChannels, 1);
+    ASSERT_EQ(parsed.regionCrops.size(), 1u);
+    EXPECT_EQ(parsed.regionCrops[0].path, original.regionCrops[0].path);
+    EXPECT_EQ(parsed.regionCrops[0].region, original.regionCrops[0].region);
+    EXPECT_EQ(parsed.regionCrops[0].crop, original.regionCrops[0].crop);
+    EXPECT_EQ(parsed.regionCrops[0].bytes, 512u);
+    EXPECT_EQ(parsed.originalThumbnailBytes, 2048u);
+    EXPECT_EQ(parsed.processedBytes, 1234u);
+    EXPECT_EQ(parsed.originalBytes, 0u);
+    EXPECT_EQ(parsed.plate.id, "plate-1");
+    EXPECT_EQ(parsed.plate.path, original.plate.path);
+    EXPECT_EQ(parsed.plate.size, original.plate.size);
+    ASSERT_TRUE(parsed.metadata.isVisit);
+    EXPECT_EQ(parsed.metadata.visit.endUs, original.metadata.visit.endUs);
+    EXPECT_EQ(parsed.metadata.visit.trackIds, original.metadata.visit.trackIds);
+    EXPECT_EQ(parsed.metadata.motionMask.size, original.metadata.motionMask.size);
+    EXPECT_EQ(parsed.metadata.motionMask.counts, original.metadata.motionMask.counts);
+    // Re-serialized, the document is the same: every field came back
+    EXPECT_EQ(frameDocumentJson(parsed, 1760000001000), frameDocumentJson(original, 1760000001000));
+    // The viewer's image links: stable URLs by frame and kind, only for stored images
+    const std::string document = frameDocumentJson(original, 1760000001000);
+    EXPECT_NE(document.find(R"("images":{"processed":{"url":"/api/frames/frame-1/image/processed","bytes":1234},)"
+                            R"("original_thumbnail":{"url":"/api/frames/frame-1/image/original_thumbnail",)"
+                            R"("bytes":2048}})"),
+              std::string::npos);
+    EXPECT_NE(document.find(R"("url":"/api/frames/frame-1/crops/0","bytes":512})"), std::string::npos);
+
+    MotionMinuteSummary summary;
+    summary.source = "cam";
+    summary.minuteStart = 1760000040;
+    summary.frames = 1800;
+    summary.motionFrames = 40;
+    summary.motionBoxes = 95;
+    summary.regions = 41;
+    summary.maxRegions = 3;
+    summary.latencyP50Ms = 8.5;
+    summary.latencyP99Ms = 31.0;
+    summary.latencyMaxMs = 44.0;
+    MotionMinuteSummary parsedSummary;
+    ASSERT_TRUE(parseMotionSummary(motionSummaryJson(summary, 0), parsedSummary));
+    EXPECT_EQ(motionSummaryJson(parsedSummary, 0), motionSummaryJson(summary, 0));
+
+    StoredFrameRecord escaped = original;
+    escaped.metadata.source = "cam\t\x01";
+    ASSERT_TRUE(parseFrameDocument(frameDocumentJson(escaped, 0), parsed));
+    EXPECT_EQ(parsed.metadata.source, "cam\t\x01");
+    ASSERT_TRUE(parseFrameDocument(R"({"_id": "x", "metadata": {"source": "caf\u00e9 \ud83d\udc26"}})", parsed));
+    EXPECT_EQ(parsed.metadata.source, "caf\xc3\xa9 \xf0\x9f\x90\xa6");
+
+    EXPECT_FALSE(parseFrameDocument("{\"_id\": \"x\"", parsed));
+    // The id names crop files: one that would leave cropPath is refused, not rewritten
+    for (const char* id : {"../../x", "a/b", "..", ""}) {
+        EXPECT_FALSE(parseFrameDocument(R"({"_id": ")" + std::string(id) + R"(", "metadata": {}})", parsed)) << id;
+    }
+    // The same goes for the background plate's id, and its extension must be an image codec's
+    const std::pair<std::string, std::string> badPlates[] = {
+        {"../p", "plates/p.jpg"}, {"p/q", "plates/p.jpg"}, {"p", "plates/p.sh"}, {"p", "plates/p"}};
+    for (const auto& [id, path] : badPlates) {
+        const std::string json =
+            R"({"_id": "x", "metadata": {}, "background_plate": {"id": ")" + id + R"(", "path": ")" + path + R"("}})";
+        EXPECT_FALSE(parseFrameDocument(json, parsed)) << json;
+    }
+    ASSERT_TRUE(parseFrameDocument(
+        R"({"_id": "x", "metadata": {}, "background_plate": {"id": "p", "path": "plates/p.webp"}})", parsed));
+    EXPECT_EQ(parsed.plate.id, "p");
+    EXPECT_FALSE(parseMotionSummary("{\"source\": \"cam\"}", parsedSummary));
+}
+
+// Messages come out whole however the stream is split; malformed streams are refused
+TEST(UplinkIngestTest, DecodesStreamsInAnyChunking) {
+    std::vector<unsigned char> stream = {0x42, 0x4f, 0x50, 0x55, 1, 0, 6, 0};  // Hello, site "../a b"
+    for (const char c : std::string("../a b")) stream.push_back(static_cast<unsigned char>(c));
+    const std::string document = "{\"source\":\"cam\"}";
+    for (int i = 0; i < 2; ++i) {
+        const std::vector<unsigned char> header = {0x42, 0x4f, 0x50, 0x4d, 1, 0, 1, 0,
+                                                   static_cast<unsigned char>(document.size()), 0, 0, 0};
+        stream.insert(stream.end(), header.begin(), header.end());
+        stream.insert(stream.end(), document.begin(), document.end());
+        stream.insert(stream.end(), {3, 0, 0, 0, 7, 8, static_cast<unsigned char>(i)});  // One 3-byte image
+    }
+
+    for (const size_t chunk : {size_t(1), size_t(5), stream.size()}) {
+        UplinkStreamDecoder decoder(1024);
+        std::vector<UplinkStreamDecoder::Message> messages;
+        for (size_t offset = 0; offset < stream.size(); offset += chunk) {
+            ASSERT_TRUE(decoder.feed(stream.data() + offset, std::min(chunk, stream.size() - offset), messages));
+        }
+        ASSERT_TRUE(decoder.hasHello());
+        EXPECT_EQ(decoder.site(), ".._a_b");
+        ASSERT_EQ(messages.size(), 2u);
+        EXPECT_EQ(messages[1].kind, uplink_wire::kFrameMessage);
+        EXPECT_EQ(messages[1].document, document);
+        EXPECT_EQ(messages[1].images, (std::vector<std::vector<unsigned char>>{{7, 8, 1}}));
+    }
+
+    std::vector<UplinkStreamDecoder::Message> messages;
+    UplinkStreamDecoder tooSmall(20);
+    EXPECT_FALSE(tooSmall.feed(stream.data(), stream.size(), messages));
+    EXPECT_FALSE(tooSmall.error().empty());
+    UplinkStreamDecoder notUplink(1024);
+    const std::string http = "GET / HTTP/1.1\r\n";
+    EXPECT_FALSE(notUplink.feed(reinterpret_cast<const unsigned char*>(http.data()), http.size(), messages));
+    EXPECT_TRUE(messages.empty());
+}
+
+// An edge's uplink backend against the server: stored under its site, acknowledged, and
+// resent after the backend refused a batch
+TEST(UplinkIngestTest, StoresEdgeUploadsAndResendsRefusedOnes) {
+    const fs::path directory = fs::temp_directory_path() / "uplink_ingest_test";
+    fs::remove_all(directory);
+    fs::create_directories(directory);
+    const fs::path crop = directory / "edge_crop.jpg";
+    const std::string cropBytes = "not really a jpeg";
+    std::ofstream(crop, std::ios::binary) << cropBytes;
+    const fs::path plate = directory / "edge_plate.jpg";
+    const std::string plateBytes = "background plate";
+    std::ofstream(plate, std::ios::binary) << plateBytes;
+
+    auto capturing = std::make_unique<CapturingBackend>();
+    CapturingBackend& backend = *capturing;
+    backend.refuseBatches = 1;
+    UplinkIngestConfig config;
+    config.listenAddress = "127.0.0.1";
+    config.port = 0;
+    config.cropPath = (directory / "central").string();
+    config.decodeThreads = 2;
+    config.batchWindow = std::chrono::milliseconds(5);
+    UplinkIngestServer server(config, std::move(capturing));
+    ASSERT_TRUE(server.start());
+    ASSERT_GT(server.port(), 0);
+
+    PersistenceBackendConfig edgeConfig;
+    edgeConfig.name = "uplink";
+    edgeConfig.uplinkEndpoint = "127.0.0.1:" + std::to_string(server.port());
+    edgeConfig.uplinkSite = "north";
+    edgeConfig.uplinkSpoolPath = (directory / "spool").string();
+    UplinkPersistenceBackend edge(edgeConfig);
+    ASSERT_TRUE(edge.connect());
+    ASSERT_TRUE(waitFor([&] { return edge.stats().connected; }));
+
+    StoredFrameRecord record = sampleRecord();
+    record.regionCrops[0].path = crop.string();
+    record.plate.path = plate.string();
+    EXPECT_EQ(edge.insertRecords({record}), (std::vector<std::string>{"frame-1"}));
+    MotionMinuteSummary summary;
+    summary.source = "cam";
+    summary.minuteStart = 1760000040;
+    summary.frames = 10;
+    EXPECT_TRUE(edge.upsertMotionSummaries({summary}));
+
+    // The refused frame dropped the connection; the edge reconnects and sends it again
+    ASSERT_TRUE(waitFor([&] { return edge.stats().acknowledged >= 2 && edge.stats().spoolDepth == 0; }));
+    const UplinkIngestStats stats = server.stats();
+    EXPECT_EQ(stats.failed, 1u);
+    EXPECT_GE(stats.connections, 2u);
+    EXPECT_EQ(stats.rejected, 0u);
+
+    // The background plate went with the first document naming it; the next one only names it
+    StoredFrameRecord samePlate = record;
+    samePlate.uuid = "frame-2";
+    fs::remove(plate);
+    EXPECT_EQ(edge.insertRecords({samePlate}), (std::vector<std::string>{"frame-2"}));
+    ASSERT_TRUE(waitFor([&] { return edge.stats().acknowledged >= 3; }));
+
+    std::lock_guard<std::mutex> lock(backend.mutex);
+    ASSERT_EQ(backend.frames.size(), 2u);
+    const StoredFrameRecord& stored = backend.frames[0];
+    EXPECT_EQ(stored.metadata.source, "north/garden \"east\"");
+    ASSERT_EQ(stored.regionCrops.size(), 1u);
+    EXPECT_EQ(stored.regionCrops[0].path, (directory / "central" / "north" / "frame-1_0.jpg").string());
+    std::ifstream in(stored.regionCrops[0].path, std::ios::binary);
+    EXPECT_EQ(std::string(std::istreambuf_iterator<char>(in), {}), cropBytes);
+    const std::string centralPlate = (directory / "central" / "north" / "plates" / "plate-1.jpg").string();
+    EXPECT_EQ(stored.plate.path, centralPlate);
+    EXPECT_EQ(backend.frames[1].plate.path, centralPlate);
+    std::ifstream plateIn(centralPlate, std::ios::binary);
+    EXPECT_EQ(std::string(std::istreambuf_iterator<char>(plateIn), {}), plateBytes);
+    ASSERT_FALSE(backend.summaries.empty());
+    EXPECT_EQ(backend.summaries[0].source, "north/cam");
+    EXPECT_EQ(backend.summaries[0].frames, 10u);
+
+    fs::remove_all(directory);
+}
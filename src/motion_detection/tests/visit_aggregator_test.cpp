@@ -0,0 +1,174 @@
+#include "visit_aggregator.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "logger.hpp"
+
+void initLogger() {
+    try {
+        Logger::init("debug", "visit_aggregator_test_log.txt", false);
+    } catch (const std::exception& e) {
+        // Logger already initialized, ignore
+    }
+}
+
+// Global test environment setup
+class VisitAggregatorTestEnvironment : public ::testing::Environment {
+   public:
+    void SetUp() override { initLogger(); }
+
+    void TearDown() override { spdlog::shutdown(); }
+};
+
+::testing::Environment* const visitAggregatorEnv =
+    ::testing::AddGlobalTestEnvironment(new VisitAggregatorTestEnvironment());
+
+namespace {
+
+using Clock = VisitAggregator::Clock;
+
+VisitConfig enabledConfig() {
+    VisitConfig config;
+    config.enabled = true;
+    config.endAfter = std::chrono::seconds(5);
+    config.sampleInterval = std::chrono::milliseconds(0);
+    return config;
+}
+
+// Flat background with a checkerboard "bird" at @p box; blurred when @p sharp is false
+cv::Mat makeFrame(const cv::Rect& box, bool sharp) {
+    cv::Mat frame(240, 320, CV_8UC3, cv::Scalar(40, 90, 40));
+    for (int y = box.y; y < box.y + box.height; y += 4) {
+        for (int x = box.x; x < box.x + box.width; x += 4) {
+            if (((x + y) / 4) % 2 == 0) cv::rectangle(frame, cv::Rect(x, y, 4, 4), cv::Scalar(255, 255, 255), -1);
+        }
+    }
+    if (!sharp) cv::GaussianBlur(frame, frame, cv::Size(9, 9), 3.0);
+    return frame;
+}
+
+int64_t unixUs(std::chrono::milliseconds offset) { return 1700000000000000 + offset.count() * 1000; }
+
+}  // namespace
+
+// A bird tracked through many frames is one visit with its best crops, path and times
+TEST(VisitAggregatorTest, CollapsesATrackedVisitIntoOneDocument) {
+    VisitConfig config = enabledConfig();
+    config.bestCrops = 2;
+    VisitAggregator aggregator(config);
+    const Clock::time_point start = Clock::now();
+
+    for (int i = 0; i < 20; ++i) {
+        const cv::Rect box(40 + i * 5, 60, 64, 64);
+        ConsolidatedRegion region(box, {7});
+        if (i == 12) {
+            region.classLabel = "robin";
+            region.classConfidence = 0.9f;
+            region.classId = 3;
+        }
+        const std::chrono::milliseconds offset(i * 100);
+        aggregator.observe(makeFrame(box, i == 5 || i == 15), {region}, i, start + offset, unixUs(offset));
+        EXPECT_TRUE(aggregator.takeEnded(start + offset).empty());
+    }
+    EXPECT_EQ(aggregator.openVisits(), 1u);
+    EXPECT_EQ(aggregator.framesWithRegions(), 20u);
+
+    const std::vector<Visit> visits = aggregator.takeEnded(start + std::chrono::milliseconds(1900 + 5000));
+    ASSERT_EQ(visits.size(), 1u);
+    const Visit& visit = visits[0];
+    EXPECT_EQ(visit.summary.frames, 20);
+    EXPECT_EQ(visit.summary.startUs, unixUs(std::chrono::milliseconds(0)));
+    EXPECT_EQ(visit.summary.endUs, unixUs(std::chrono::milliseconds(1900)));
+    EXPECT_EQ(visit.summary.trackIds, std::vector<int>{7});
+    ASSERT_EQ(visit.summary.path.size(), 20u);
+    EXPECT_EQ(visit.summary.path.back().offsetMs, 1900);
+    EXPECT_EQ(visit.summary.path.back().center.x, 40 + 19 * 5 + 32);
+
+    // The two sharp frames win over the blurred ones
+    ASSERT_EQ(visit.crops.size(), 2u);
+    EXPECT_TRUE(visit.crops[0].frameIndex == 5 || visit.crops[0].frameIndex == 15);
+    EXPECT_TRUE(visit.crops[1].frameIndex == 5 || visit.crops[1].frameIndex == 15);
+    EXPECT_GE(visit.crops[0].score, visit.crops[1].score);
+    EXPECT_EQ(visit.crops[0].image.size(), cv::Size(64, 64));
+    EXPECT_EQ(visit.summary.cropScores.size(), 2u);
+    EXPECT_EQ(visit.context.cols, 320);
+    EXPECT_EQ(visit.classLabel, "robin");
+    EXPECT_EQ(visit.classId, 3);
+    EXPECT_EQ(aggregator.openVisits(), 0u);
+}
+
+// Without shared tracks regions match by overlap; a distant region is a visit of its own
+TEST(VisitAggregatorTest, SeparatesVisitsByOverlapAndTime) {
+    VisitConfig config = enabledConfig();
+    config.matchTrackIds = false;
+    VisitAggregator aggregator(config);
+    const Clock::time_point start = Clock::now();
+    const cv::Rect feeder(40, 40, 60, 60);
+    const cv::Rect bath(220, 150, 60, 60);
+    const cv::Mat frame = makeFrame(feeder, true);
+
+    aggregator.observe(frame, {ConsolidatedRegion(feeder, {1}), ConsolidatedRegion(bath, {1})}, 0, start,
+                       unixUs(std::chrono::milliseconds(0)));
+    EXPECT_EQ(aggregator.openVisits(), 2u);
+
+    // The feeder bird stays, the bath empties
+    for (int i = 1; i <= 6; ++i) {
+        const std::chrono::seconds offset(i);
+        aggregator.observe(frame, {ConsolidatedRegion(feeder + cv::Point(i, 0), {i})}, i, start + offset,
+                           unixUs(offset));
+    }
+    std::vector<Visit> ended = aggregator.takeEnded(start + std::chrono::seconds(6));
+    ASSERT_EQ(ended.size(), 1u);
+    EXPECT_EQ(ended[0].summary.frames, 1);
+    EXPECT_EQ(ended[0].summary.path[0].center, cv::Point(250, 180));
+
+    // A region where the last visit ended long ago starts a new one
+    aggregator.observe(frame, {ConsolidatedRegion(bath, {})}, 7, start + std::chrono::seconds(7),
+                       unixUs(std::chrono::seconds(7)));
+    EXPECT_EQ(aggregator.openVisits(), 2u);
+    const std::vector<Visit> rest = aggregator.takeAll();
+    ASSERT_EQ(rest.size(), 2u);
+    EXPECT_EQ(rest[0].summary.frames, 7);
+    EXPECT_EQ(rest[1].summary.frames, 1);
+}
+
+// Long visits are split at maxDuration and long paths thinned to maxPathPoints
+TEST(VisitAggregatorTest, BoundsLongVisits) {
+    VisitConfig config = enabledConfig();
+    config.maxDuration = std::chrono::seconds(60);
+    config.maxPathPoints = 8;
+    config.sampleInterval = std::chrono::seconds(10);
+    VisitAggregator aggregator(config);
+    const Clock::time_point start = Clock::now();
+    const cv::Rect box(100, 80, 50, 50);
+    const cv::Mat frame = makeFrame(box, true);
+
+    size_t visits = 0;
+    for (int i = 0; i < 90; ++i) {
+        const std::chrono::seconds offset(i);
+        for (const Visit& visit : aggregator.takeEnded(start + offset)) {
+            ++visits;
+            EXPECT_EQ(visit.summary.frames, 60);
+            EXPECT_LE(visit.summary.path.size(), 8u);
+            EXPECT_GE(visit.summary.path.size(), 4u);
+            EXPECT_EQ(visit.crops.size(), 3u);  // One scored frame in ten
+        }
+        aggregator.observe(frame, {ConsolidatedRegion(box, {4})}, i, start + offset, unixUs(offset));
+    }
+    EXPECT_EQ(visits, 1u);
+    EXPECT_EQ(aggregator.takeAll().front().summary.frames, 30);
+}
+
+TEST(VisitAggregatorTest, DisabledAggregatorKeepsNothing) {
+    VisitAggregator aggregator;
+    const cv::Rect box(10, 10, 40, 40);
+    aggregator.observe(makeFrame(box, true), {ConsolidatedRegion(box, {1})}, 0, Clock::now(), 0);
+    EXPECT_EQ(aggregator.openVisits(), 0u);
+    EXPECT_EQ(aggregator.framesWithRegions(), 0u);
+    EXPECT_GT(VisitAggregator::sharpness(makeFrame(box, true)(box)),
+              VisitAggregator::sharpness(makeFrame(box, false)(box)));
+}
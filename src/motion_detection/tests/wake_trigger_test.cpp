@@ -0,0 +1,122 @@
+#include "wake_trigger.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+WakeTriggerConfig gateConfig() {
+    WakeTriggerConfig config;
+    config.enabled = true;
+    config.source = WakeSource::Gate;
+    config.awakeHoldSeconds = 10.0;
+    config.gateBlockSize = 16;
+    config.gateThreshold = 12;
+    config.gateMinBlocks = 2;
+    return config;
+}
+
+cv::Mat still() { return cv::Mat(128, 128, CV_8UC1, cv::Scalar(80)); }
+
+// A bird-sized bright patch covering a few gate blocks
+cv::Mat withBird() {
+    cv::Mat frame = still();
+    cv::rectangle(frame, cv::Rect(32, 32, 40, 32), cv::Scalar(220), cv::FILLED);
+    return frame;
+}
+
+// Value file of a fake GPIO line
+class FakeGpio {
+   public:
+    FakeGpio()
+        : path_(std::filesystem::temp_directory_path() /
+                ("wake_trigger_test_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed()) + "_value")) {
+        set(false);
+    }
+    ~FakeGpio() { std::filesystem::remove(path_); }
+
+    void set(bool high) { std::ofstream(path_, std::ios::trunc) << (high ? "1\n" : "0\n"); }
+    std::string path() const { return path_.string(); }
+
+   private:
+    std::filesystem::path path_;
+};
+
+}  // namespace
+
+TEST(WakeSourceTest, ParsesNames) {
+    EXPECT_EQ(parseWakeSource("gpio"), WakeSource::Gpio);
+    EXPECT_EQ(parseWakeSource("Gate"), WakeSource::Gate);
+    EXPECT_EQ(parseWakeSource("BOTH"), WakeSource::Both);
+    EXPECT_STREQ(wakeSourceName(WakeSource::Both), "both");
+    EXPECT_THROW(parseWakeSource("pir"), std::invalid_argument);
+}
+
+TEST(WakeControllerTest, SleepsAfterTheHoldAndWakesOnGateMotion) {
+    WakeController controller(gateConfig());
+    const Clock::time_point start = Clock::now();
+    EXPECT_TRUE(controller.isAwake());
+    EXPECT_EQ(controller.onFrame(still(), start), WakeController::Transition::None);
+
+    // No activity for the hold: asleep, and a still scene keeps it asleep
+    EXPECT_EQ(controller.onFrame(still(), start + std::chrono::seconds(11)), WakeController::Transition::Slept);
+    EXPECT_FALSE(controller.isAwake());
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(controller.onFrame(still(), start + std::chrono::seconds(12 + i)), WakeController::Transition::None);
+    }
+
+    EXPECT_EQ(controller.onFrame(withBird(), start + std::chrono::seconds(15)), WakeController::Transition::Woke);
+    EXPECT_TRUE(controller.isAwake());
+    EXPECT_EQ(controller.wakeCount(), 1u);
+    EXPECT_EQ(controller.sleepFrames(), 4u);
+}
+
+TEST(WakeControllerTest, RecordedActivityKeepsItAwake) {
+    WakeController controller(gateConfig());
+    const Clock::time_point start = Clock::now();
+    controller.recordActivity(start + std::chrono::seconds(8));
+    EXPECT_EQ(controller.onFrame(still(), start + std::chrono::seconds(15)), WakeController::Transition::None);
+    EXPECT_EQ(controller.onFrame(still(), start + std::chrono::seconds(19)), WakeController::Transition::Slept);
+}
+
+TEST(WakeControllerTest, GpioLineWakesItAndHoldsItAwake) {
+    FakeGpio line;
+    WakeTriggerConfig config = gateConfig();
+    config.source = WakeSource::Gpio;
+    config.gpioPath = line.path();
+    WakeController controller(config);
+    const Clock::time_point start = Clock::now();
+
+    ASSERT_EQ(controller.onFrame(cv::Mat(), start + std::chrono::seconds(11)), WakeController::Transition::Slept);
+    // The gate is off: motion alone does not wake it
+    EXPECT_EQ(controller.onFrame(withBird(), start + std::chrono::seconds(12)), WakeController::Transition::None);
+
+    line.set(true);
+    EXPECT_EQ(controller.onFrame(cv::Mat(), start + std::chrono::seconds(13)), WakeController::Transition::Woke);
+    // Still high 20 s later: the line keeps extending the hold
+    EXPECT_EQ(controller.onFrame(cv::Mat(), start + std::chrono::seconds(33)), WakeController::Transition::None);
+    line.set(false);
+    EXPECT_EQ(controller.onFrame(cv::Mat(), start + std::chrono::seconds(40)), WakeController::Transition::None);
+    EXPECT_EQ(controller.onFrame(cv::Mat(), start + std::chrono::seconds(44)), WakeController::Transition::Slept);
+}
+
+TEST(GpioLineTest, ActiveLowInvertsTheLevelAndMissingFilesNeverTrigger) {
+    FakeGpio line;
+    GpioLine inverted(line.path(), true);
+    ASSERT_TRUE(inverted.isOpen());
+    EXPECT_TRUE(inverted.isActive());
+    line.set(true);
+    EXPECT_FALSE(inverted.isActive());
+
+    GpioLine missing("/nonexistent/gpio/value", false);
+    EXPECT_FALSE(missing.isOpen());
+    EXPECT_FALSE(missing.wait(std::chrono::milliseconds(1)));
+}
@@ -1,5 +1,6 @@
 // Global variables
 let currentPage = 1;
+let pageCursors = [null];  // pageCursors[n - 1]: the ?after= cursor that loads page n
 let currentSort = 'timestamp-desc';
 let searchQuery = '';
 let allFrames = [];
@@ -28,11 +29,18 @@ const modalTimestamp = document.getElementById('modalTimestamp');
 const modalSource = document.getElementById('modalSource');
 const modalAutoSaved = document.getElementById('modalAutoSaved');
 const closeModal = document.querySelector('.close');
+const clipsSection = document.getElementById('clipsSection');
+const clipsList = document.getElementById('clipsList');
+const clipVideo = document.getElementById('clipVideo');
+const clipOverlayTrack = document.getElementById('clipOverlayTrack');
+const clipOverlay = document.getElementById('clipOverlay');
 
 // Initialize the application
 document.addEventListener('DOMContentLoaded', function() {
     loadFrames();
+    loadClips();
     setupEventListeners();
+    setupClipOverlay();
     updateLastUpdate();
 });
 
@@ -64,8 +72,10 @@ function setupEventListeners() {
     });
     
     nextPage.addEventListener('click', function() {
-        currentPage++;
-        loadFrames();
+        if (pageCursors[currentPage]) {
+            currentPage++;
+            loadFrames();
+        }
     });
     
     // Modal events
@@ -90,13 +100,16 @@ async function loadFrames() {
     hideError();
     
     try {
-        const response = await fetch(`/api/frames?page=${currentPage}&limit=20`);
+        const after = pageCursors[currentPage - 1];
+        const query = after ? `&after=${encodeURIComponent(after)}` : '';
+        const response = await fetch(`/api/frames?limit=20${query}`);
         const data = await response.json();
         
         if (response.ok) {
+            pageCursors[currentPage] = data.pagination.next;
             allFrames = data.frames;
             displayFrames(allFrames);
-            updatePagination(data.pagination);
+            updatePagination({ ...data.pagination, page: currentPage });
             updateStats(data.pagination.total);
         } else {
             throw new Error(data.error || 'Failed to load frames');
@@ -124,8 +137,8 @@ function displayFrames(frames) {
         return;
     }
     
-    // Check if any frames have image data
-    const hasImageData = frames.some(frame => frame.image_data && frame.image_data.length > 0);
+    // Check if any frames have a stored image
+    const hasImageData = frames.some(frame => frame.thumbnail_url || frame.thumbnail_atlas);
     
     if (!hasImageData) {
         infoBanner.style.display = 'flex';
@@ -136,6 +149,20 @@ function displayFrames(frames) {
     framesContainer.innerHTML = frames.map(frame => createFrameCard(frame)).join('');
 }
 
+// One cell of a thumbnail atlas sheet, scaled to the element: percentage sizes and offsets
+// keep just that cell in view whatever size the card gives it
+function createAtlasImage(atlas, title) {
+    const [sheetWidth, sheetHeight] = atlas.sheet_size;
+    const offset = (start, cell, sheet) => (sheet > cell ? (start / (sheet - cell)) * 100 : 0);
+    const style = [
+        `background-image: url('${atlas.url}')`,
+        `background-size: ${(sheetWidth / atlas.width) * 100}% ${(sheetHeight / atlas.height) * 100}%`,
+        `background-position: ${offset(atlas.x, atlas.width, sheetWidth)}% ${offset(atlas.y, atlas.height, sheetHeight)}%`,
+        `aspect-ratio: ${atlas.width} / ${atlas.height}`
+    ].join('; ');
+    return `<div class="frame-image atlas-thumbnail" role="img" aria-label="${title}" style="${style}"></div>`;
+}
+
 // Create a frame card element
 function createFrameCard(frame) {
     const timestamp = frame.metadata.timestamp ? new Date(frame.metadata.timestamp).toLocaleString() : 'Unknown';
@@ -147,15 +174,19 @@ function createFrameCard(frame) {
     const motionRegions = frame.metadata.motion_regions || 0;
     const confidence = frame.metadata.confidence || 0;
     
-    // Check if image data exists
-    const hasImageData = frame.image_data && frame.image_data.length > 0;
-    const imageSrc = hasImageData ? `data:image/jpeg;base64,${frame.image_data}` : '/images/placeholder.svg';
+    // Images load by URL (cached by the browser), the card from the thumbnail: a cell of a
+    // sealed atlas sheet, shared with the other frames of the hour, or its own file
+    const hasImageData = Boolean(frame.thumbnail_url || frame.thumbnail_atlas);
+    const imageSrc = hasImageData ? frame.thumbnail_url : '/images/placeholder.svg';
+    const image = frame.thumbnail_atlas
+        ? createAtlasImage(frame.thumbnail_atlas, filename)
+        : `<img src="${imageSrc}" alt="${filename}" class="frame-image" loading="lazy"
+                     onerror="this.src='/images/placeholder.svg'">`;
     
     return `
         <div class="frame-card" onclick="openImageModal('${uuid}')">
             <div class="frame-image-container">
-                <img src="${imageSrc}" alt="${filename}" class="frame-image" 
-                     onerror="this.src='/images/placeholder.svg'">
+                ${image}
                 ${!hasImageData ? '<div class="no-image-overlay"><i class="fas fa-image"></i><span>No Image Data</span></div>' : ''}
             </div>
             <div class="frame-info">
@@ -221,16 +252,18 @@ function handleSearch() {
 
 // Update pagination controls
 function updatePagination(paginationData) {
-    if (paginationData.pages <= 1) {
+    const hasNext = Boolean(paginationData.next);
+    if (paginationData.page <= 1 && !hasNext) {
         pagination.style.display = 'none';
         return;
     }
     
+    // The total is an estimate, so only the page number is exact
     pagination.style.display = 'flex';
-    pageInfo.textContent = `Page ${paginationData.page} of ${paginationData.pages}`;
+    pageInfo.textContent = `Page ${paginationData.page} of ~${Math.max(paginationData.pages, paginationData.page)}`;
     
     prevPage.disabled = paginationData.page <= 1;
-    nextPage.disabled = paginationData.page >= paginationData.pages;
+    nextPage.disabled = !hasNext;
     
     prevPage.style.opacity = prevPage.disabled ? '0.5' : '1';
     nextPage.style.opacity = nextPage.disabled ? '0.5' : '1';
@@ -247,6 +280,83 @@ function updateLastUpdate() {
     lastUpdate.textContent = now.toLocaleTimeString();
 }
 
+function loadImage(src) {
+    return new Promise((resolve, reject) => {
+        const image = new Image();
+        image.onload = () => resolve(image);
+        image.onerror = reject;
+        image.src = src;
+    });
+}
+
+// Rebuild a plate-and-patch frame: the background plate scaled to the frame, with every
+// region crop drawn at its crop rectangle ([x, y, width, height])
+async function renderPlateFrame(frame) {
+    const [height, width] = frame.original_frame_shape;
+    const canvas = document.createElement('canvas');
+    canvas.width = width;
+    canvas.height = height;
+    const context = canvas.getContext('2d');
+    context.drawImage(await loadImage(`/api/frames/${frame._id}/plate`), 0, 0, width, height);
+    const crops = await Promise.all((frame.region_crops || []).map(
+        (crop, index) => loadImage(`/api/frames/${frame._id}/crops/${index}`).catch(() => null)));
+    crops.forEach((image, index) => {
+        if (!image) return;
+        const [x, y, cropWidth, cropHeight] = frame.region_crops[index].crop;
+        context.drawImage(image, x, y, cropWidth, cropHeight);
+    });
+    return canvas.toDataURL('image/jpeg', 0.9);
+}
+
+// Lengths of a motion_mask's "counts": alternating unset and set pixel runs over the mask
+// grid in row-major order, written with the string codec of COCO's compressed RLE
+function decodeMaskCounts(text) {
+    const counts = [];
+    for (let p = 0; p < text.length;) {
+        let value = 0;
+        for (let group = 0, more = true; more; ++group) {
+            const code = text.charCodeAt(p++) - 48;
+            value |= (code & 0x1f) << (5 * group);
+            more = code & 0x20;
+            if (!more && (code & 0x10)) value |= -1 << (5 * (group + 1));  // Negative
+        }
+        if (counts.length > 2) value += counts[counts.length - 2];
+        counts.push(value);
+    }
+    return counts;
+}
+
+// Tint the motion mask over the frame image. The mask grid covers mask.roi of the frame,
+// at detection resolution; the image may be stored at another size than the frame
+async function renderMotionMask(imageSrc, mask, frameShape) {
+    const image = await loadImage(imageSrc);
+    const [frameHeight, frameWidth] = frameShape || [image.naturalHeight, image.naturalWidth];
+    const grid = document.createElement('canvas');
+    grid.width = mask.width;
+    grid.height = mask.height;
+    const gridContext = grid.getContext('2d');
+    const pixels = gridContext.createImageData(mask.width, mask.height);
+    let position = 0;
+    decodeMaskCounts(mask.counts).forEach((count, index) => {
+        if (index % 2) {
+            for (let i = position; i < position + count; ++i) pixels.data.set([72, 187, 120, 140], i * 4);
+        }
+        position += count;
+    });
+    gridContext.putImageData(pixels, 0, 0);
+
+    const canvas = document.createElement('canvas');
+    canvas.width = image.naturalWidth;
+    canvas.height = image.naturalHeight;
+    const context = canvas.getContext('2d');
+    context.drawImage(image, 0, 0);
+    const sx = image.naturalWidth / frameWidth;
+    const sy = image.naturalHeight / frameHeight;
+    context.imageSmoothingEnabled = false;
+    context.drawImage(grid, mask.roi.x * sx, mask.roi.y * sy, mask.roi.width * sx, mask.roi.height * sy);
+    return canvas.toDataURL('image/jpeg', 0.9);
+}
+
 // Open image modal
 async function openImageModal(uuid) {
     try {
@@ -254,8 +364,16 @@ async function openImageModal(uuid) {
         const frame = await response.json();
         
         if (response.ok) {
-            const hasImageData = frame.image_data && frame.image_data.length > 0;
-            const imageSrc = hasImageData ? `data:image/jpeg;base64,${frame.image_data}` : '/images/placeholder.svg';
+            const hasImageData = Boolean(frame.image_url);
+            let imageSrc = hasImageData ? frame.image_url : '/images/placeholder.svg';
+            if (!hasImageData && frame.background_plate) {
+                imageSrc = await renderPlateFrame(frame).catch(() => imageSrc);
+            }
+            const motionMask = frame.metadata.motion_mask;
+            if (imageSrc !== '/images/placeholder.svg' && motionMask && motionMask.counts) {
+                imageSrc = await renderMotionMask(imageSrc, motionMask, frame.original_frame_shape)
+                    .catch(() => imageSrc);
+            }
             
             modalImage.src = imageSrc;
             modalTitle.textContent = frame.metadata.original_filename || 'Frame Details';
@@ -338,6 +456,83 @@ function hideError() {
     framesContainer.style.display = 'grid';
 }
 
+// Load the pass-through event clips
+async function loadClips() {
+    try {
+        const response = await fetch('/api/clips?limit=20');
+        const data = await response.json();
+        if (!response.ok || data.clips.length === 0) {
+            clipsSection.style.display = 'none';
+            return;
+        }
+
+        clipsSection.style.display = 'block';
+        clipsList.innerHTML = data.clips.map(clip => `
+            <li class="clip-item" data-url="${clip.url}" data-overlay="${clip.overlay_url || ''}">
+                <i class="fas fa-play-circle"></i>
+                <span>${clip.name}</span>
+                <span class="meta-value">${(clip.size / 1048576).toFixed(1)} MB</span>
+            </li>
+        `).join('');
+        clipsList.querySelectorAll('.clip-item').forEach(item => {
+            item.addEventListener('click', () => playClip(item.dataset.url, item.dataset.overlay));
+        });
+    } catch (err) {
+        console.error('Failed to load clips:', err);
+    }
+}
+
+function playClip(url, overlayUrl) {
+    clipOverlayTrack.src = overlayUrl || '';
+    clipOverlayTrack.track.mode = 'hidden';  // Cues fire events but are not rendered as text
+    clipVideo.src = url;
+    clipVideo.play().catch(() => {});
+    drawClipOverlay([]);
+}
+
+// The .vtt sidecar carries one JSON cue per analyzed frame:
+// {"frame_size":[w,h],"regions":[[x,y,w,h],...]}, drawn here instead of burned into the video
+function setupClipOverlay() {
+    clipOverlayTrack.track.mode = 'hidden';
+    clipOverlayTrack.track.addEventListener('cuechange', function() {
+        const cues = Array.from(this.activeCues || []);
+        drawClipOverlay(cues.map(cue => {
+            try {
+                return JSON.parse(cue.text);
+            } catch (err) {
+                return null;
+            }
+        }).filter(Boolean));
+    });
+    clipVideo.addEventListener('emptied', () => drawClipOverlay([]));
+}
+
+function drawClipOverlay(overlays) {
+    clipOverlay.width = clipVideo.clientWidth;
+    clipOverlay.height = clipVideo.clientHeight;
+    const ctx = clipOverlay.getContext('2d');
+    ctx.clearRect(0, 0, clipOverlay.width, clipOverlay.height);
+    if (!clipVideo.videoWidth) return;
+
+    // Letterboxing: the video keeps its aspect ratio inside the element
+    const scale = Math.min(clipOverlay.width / clipVideo.videoWidth,
+                           clipOverlay.height / clipVideo.videoHeight);
+    const offsetX = (clipOverlay.width - clipVideo.videoWidth * scale) / 2;
+    const offsetY = (clipOverlay.height - clipVideo.videoHeight * scale) / 2;
+
+    ctx.strokeStyle = '#48bb78';
+    ctx.lineWidth = 2;
+    overlays.forEach(overlay => {
+        // Regions are in analyzed-frame pixels, which may be a substream of another size
+        const sx = clipVideo.videoWidth / overlay.frame_size[0];
+        const sy = clipVideo.videoHeight / overlay.frame_size[1];
+        overlay.regions.forEach(([x, y, w, h]) => {
+            ctx.strokeRect(offsetX + x * sx * scale, offsetY + y * sy * scale,
+                           w * sx * scale, h * sy * scale);
+        });
+    });
+}
+
 // Keyboard shortcuts
 document.addEventListener('keydown', function(e) {
     if (e.key === 'Escape') {
@@ -1,6 +1,8 @@
 const express = require('express');
 const { MongoClient } = require('mongodb');
 const path = require('path');
+const fs = require('fs');
+const crypto = require('crypto');
 const cors = require('cors');
 
 const app = express();
@@ -10,6 +12,18 @@ const PORT = process.env.PORT || 3000;
 const MONGODB_URI = 'mongodb://localhost:27017';
 const DB_NAME = 'birds_of_play';
 const COLLECTION_NAME = 'captured_frames';
+// One document per stream-minute, upserted by the detector (MotionStatsAggregator)
+const MOTION_STATS_COLLECTION = 'motion_stats';
+
+// Pass-through event recordings (event_*.mp4 + .vtt overlay track) written by the detector
+const CLIPS_DIR = process.env.CLIPS_DIR || path.join(__dirname, '..', '..', 'data', 'clips');
+
+// Stored image paths (and segment files) are relative to the project root
+const PROJECT_ROOT = path.join(__dirname, '..', '..');
+
+// Per-hour sprite sheets of the gallery thumbnails (thumbnail_atlas), each written once when
+// the detector seals it and never rewritten
+const ATLAS_DIR = process.env.ATLAS_DIR || path.join(PROJECT_ROOT, 'data', 'frames', 'atlases');
 
 let db;
 
@@ -17,6 +31,8 @@ let db;
 app.use(cors());
 app.use(express.json());
 app.use(express.static(path.join(__dirname, 'public')));
+app.use('/clips', express.static(CLIPS_DIR));
+app.use('/atlases', express.static(ATLAS_DIR, { maxAge: '1y', immutable: true }));
 
 // Set EJS as templating engine
 app.set('view engine', 'ejs');
@@ -34,11 +50,122 @@ async function connectToMongoDB() {
     }
 }
 
+// Viewer order, served by the (metadata.timestamp, _id) index FrameDatabaseV2 creates
+const FRAME_ORDER = { 'metadata.timestamp': -1, _id: -1 };
+const MAX_PAGE_SIZE = 100;
+
+// Opaque keyset cursor: the (metadata.timestamp, _id) of the last frame on a page
+function encodeCursor(frame) {
+    const timestamp = frame.metadata && frame.metadata.timestamp;
+    const value = timestamp instanceof Date ? timestamp.getTime() : null;
+    return Buffer.from(JSON.stringify([value, frame._id])).toString('base64url');
+}
+
+function decodeCursor(cursor) {
+    try {
+        const [millis, id] = JSON.parse(Buffer.from(String(cursor), 'base64url').toString());
+        if (typeof millis !== 'number' || id === undefined) return null;
+        return { timestamp: new Date(millis), id };
+    } catch (error) {
+        return null;
+    }
+}
+
+// Frames that sort after the cursor in FRAME_ORDER
+function afterCursor({ timestamp, id }) {
+    return {
+        $or: [
+            { 'metadata.timestamp': { $lt: timestamp } },
+            { 'metadata.timestamp': timestamp, _id: { $lt: id } }
+        ]
+    };
+}
+
+// Image kinds served by /api/frames/:id/image/:kind
+const IMAGE_FIELDS = {
+    original: 'original_image',
+    processed: 'processed_image',
+    original_thumbnail: 'original_thumbnail',
+    processed_thumbnail: 'processed_thumbnail'
+};
+
+// Legacy inline image present (migrated documents keep an empty string)
+const HAS_FRAME_DATA = { $and: [{ $gt: ['$frame_data', null] }, { $ne: ['$frame_data', ''] }] };
+
+// What the frame list shows. Image data never leaves the database: frames carry the
+// {url, bytes} links the C++ writer records (images), or the small path / extent fields
+// older documents have, and has_frame_data stands in for legacy inline base64 images.
+const FRAME_LIST_PROJECTION = {
+    'metadata.timestamp': 1,
+    'metadata.source': 1,
+    'metadata.original_filename': 1,
+    'metadata.auto_saved': 1,
+    'metadata.motion_detected': 1,
+    'metadata.motion_regions': 1,
+    'metadata.confidence': 1,
+    images: 1,
+    background_plate: 1,
+    thumbnail_atlas: 1,
+    ...Object.fromEntries(Object.values(IMAGE_FIELDS).flatMap(field => [
+        [`${field}_path`, 1],
+        [`${field}_segment`, 1]
+    ])),
+    has_frame_data: HAS_FRAME_DATA
+};
+
+// Frames of a page without their image data, in FRAME_ORDER
+function listFrames(collection, filter, limit) {
+    return collection.aggregate([
+        { $match: filter },
+        { $sort: FRAME_ORDER },
+        { $limit: limit },
+        { $project: FRAME_LIST_PROJECTION }
+    ]).toArray();
+}
+
+function frameImageUrl(frame, kind) {
+    if (frame.images && frame.images[kind]) return frame.images[kind].url;
+    const field = IMAGE_FIELDS[kind];
+    if (frame[`${field}_path`] || frame[`${field}_segment`]) {
+        return `/api/frames/${encodeURIComponent(frame._id)}/image/${kind}`;
+    }
+    return null;
+}
+
+// Sheets known to be on disk. A document names its sheet as soon as its thumbnail is placed,
+// but the sheet is only written when sealed; until then the frame keeps its own thumbnail.
+const sealedSheets = new Set();
+const MAX_SEALED_SHEETS = 10000;
+
+// The frame's cell in a sealed atlas sheet, or null
+function atlasThumbnail(frame) {
+    const atlas = frame.thumbnail_atlas;
+    if (!atlas || !atlas.sheet) return null;
+    if (!sealedSheets.has(atlas.sheet)) {
+        if (!fs.existsSync(path.join(ATLAS_DIR, atlas.sheet))) return null;
+        if (sealedSheets.size >= MAX_SEALED_SHEETS) sealedSheets.clear();
+        sealedSheets.add(atlas.sheet);
+    }
+    const [x, y, width, height] = atlas.rect;
+    return { url: `/atlases/${atlas.sheet}`, sheet_size: atlas.sheet_size, x, y, width, height };
+}
+
+// The image URLs the viewer loads instead of inline data: full frame and card thumbnail,
+// plus the thumbnail's atlas cell, which lets a page share a few sheet requests
+function withImageUrls(frame) {
+    const inline = frame.has_frame_data ? `/api/frames/${encodeURIComponent(frame._id)}/image/inline` : null;
+    const image = frameImageUrl(frame, 'processed') || frameImageUrl(frame, 'original') || inline;
+    const thumbnail = frameImageUrl(frame, 'processed_thumbnail') || frameImageUrl(frame, 'original_thumbnail');
+    const atlas = atlasThumbnail(frame);
+    const { has_frame_data, thumbnail_atlas, ...rest } = frame;
+    return { ...rest, image_url: image, thumbnail_url: thumbnail || image, thumbnail_atlas: atlas };
+}
+
 // Routes
 app.get('/', async (req, res) => {
     try {
         const collection = db.collection(COLLECTION_NAME);
-        const frames = await collection.find({}).sort({ 'metadata.timestamp': -1 }).limit(50).toArray();
+        const frames = await listFrames(collection, {}, 50);
         
         res.render('index', { 
             frames: frames,
@@ -51,34 +178,38 @@ app.get('/', async (req, res) => {
 });
 
 // API Routes
+// Keyset pagination: pass the previous response's pagination.next as ?after= to get the
+// next page. Each page is an index range scan, so its cost does not grow with the page
+// number the way skip() does, and the total is the collection's estimated count instead of
+// a full countDocuments() on every request.
 app.get('/api/frames', async (req, res) => {
     try {
         const collection = db.collection(COLLECTION_NAME);
-        const page = parseInt(req.query.page) || 1;
-        const limit = parseInt(req.query.limit) || 20;
-        const skip = (page - 1) * limit;
-        
-        const frames = await collection.find({})
-            .sort({ 'metadata.timestamp': -1 })
-            .skip(skip)
-            .limit(limit)
-            .toArray();
-            
-        const total = await collection.countDocuments();
-        
-        // Transform frames to match frontend expectations
-        const transformedFrames = frames.map(frame => ({
-            ...frame,
-            image_data: frame.frame_data || null  // Map frame_data to image_data
-        }));
+        const limit = Math.min(Math.max(parseInt(req.query.limit) || 20, 1), MAX_PAGE_SIZE);
+
+        let filter = {};
+        if (req.query.after) {
+            const cursor = decodeCursor(req.query.after);
+            if (!cursor) {
+                return res.status(400).json({ error: 'Invalid cursor' });
+            }
+            filter = afterCursor(cursor);
+        }
+
+        // One extra frame tells whether there is a next page
+        const frames = await listFrames(collection, filter, limit + 1);
+        const hasMore = frames.length > limit;
+        if (hasMore) frames.pop();
+
+        const total = await collection.estimatedDocumentCount();
         
         res.json({
-            frames: transformedFrames,
+            frames: frames.map(withImageUrls),
             pagination: {
-                page: page,
                 limit: limit,
                 total: total,
-                pages: Math.ceil(total / limit)
+                pages: Math.ceil(total / limit),
+                next: hasMore ? encodeCursor(frames[frames.length - 1]) : null
             }
         });
     } catch (error) {
@@ -89,19 +220,133 @@ app.get('/api/frames', async (req, res) => {
 app.get('/api/frames/:id', async (req, res) => {
     try {
         const collection = db.collection(COLLECTION_NAME);
-        const frame = await collection.findOne({ _id: req.params.id });
+        const [frame] = await collection.aggregate([
+            { $match: { _id: req.params.id } },
+            { $addFields: { has_frame_data: HAS_FRAME_DATA } },
+            { $project: { frame_data: 0 } }
+        ]).toArray();
         
         if (!frame) {
             return res.status(404).json({ error: 'Frame not found' });
         }
         
-        // Transform frame to match frontend expectations
-        const transformedFrame = {
-            ...frame,
-            image_data: frame.frame_data || null  // Map frame_data to image_data
-        };
-        
-        res.json(transformedFrame);
+        res.json(withImageUrls(frame));
+    } catch (error) {
+        res.status(500).json({ error: error.message });
+    }
+});
+
+// Stored images are never rewritten once a frame is saved, so browsers may keep them for good
+const IMMUTABLE_CACHE = 'public, max-age=31536000, immutable';
+const IMMUTABLE_FILE = { maxAge: '1y', immutable: true };
+
+// Sets a strong ETag and the immutable Cache-Control; true when the request's validators
+// already match, in which case a 304 has been sent
+function notModified(req, res, tag) {
+    res.set('ETag', `"${tag}"`);
+    res.set('Cache-Control', IMMUTABLE_CACHE);
+    if (!req.fresh) return false;
+    res.status(304).end();
+    return true;
+}
+
+// Sends one stored image of a frame document: its own file (<field>_path) or a byte range
+// of a segment file (<field>_segment: {file, offset, length}) written by FrameSegmentStore
+function sendStoredImage(req, res, frame, field) {
+    const segment = frame[`${field}_segment`];
+    if (segment) {
+        const start = Number(segment.offset);
+        const length = Number(segment.length);
+        // Segments are append-only, so an extent never changes and names its bytes
+        if (notModified(req, res, `${path.basename(segment.file)}-${start}-${length}`)) return;
+        // Set for codecs other than JPEG (storage_encoding)
+        res.type(segment.content_type || 'image/jpeg');
+        res.set('Content-Length', String(length));
+        fs.createReadStream(path.resolve(PROJECT_ROOT, segment.file), { start, end: start + length - 1 })
+            .on('error', () => {
+                if (res.headersSent) res.destroy();
+                else res.status(404).end();
+            })
+            .pipe(res);
+        return;
+    }
+    const imagePath = frame[`${field}_path`];
+    if (!imagePath) {
+        return res.status(404).json({ error: 'No stored image' });
+    }
+    // send answers conditional requests from the file's own ETag and Last-Modified
+    res.sendFile(path.resolve(PROJECT_ROOT, imagePath), IMMUTABLE_FILE);
+}
+
+// Legacy documents hold the frame itself as base64 (or binary) frame_data
+function sendInlineImage(req, res, frame) {
+    const data = frame.frame_data;
+    const bytes = typeof data === 'string' ? Buffer.from(data, 'base64') : data && Buffer.from(data.buffer);
+    if (!bytes || bytes.length === 0) {
+        return res.status(404).json({ error: 'No stored image' });
+    }
+    if (notModified(req, res, crypto.createHash('sha1').update(bytes).digest('hex'))) return;
+    res.type('image/jpeg').send(bytes);
+}
+
+app.get('/api/frames/:id/image/:kind', async (req, res) => {
+    try {
+        if (req.params.kind === 'inline') {
+            const frame = await db.collection(COLLECTION_NAME).findOne(
+                { _id: req.params.id },
+                { projection: { frame_data: 1 } }
+            );
+            if (!frame) {
+                return res.status(404).json({ error: 'Frame not found' });
+            }
+            return sendInlineImage(req, res, frame);
+        }
+        const field = IMAGE_FIELDS[req.params.kind];
+        if (!field) {
+            return res.status(400).json({ error: `Unknown image kind: ${req.params.kind}` });
+        }
+        const frame = await db.collection(COLLECTION_NAME).findOne(
+            { _id: req.params.id },
+            { projection: { [`${field}_path`]: 1, [`${field}_segment`]: 1 } }
+        );
+        if (!frame) {
+            return res.status(404).json({ error: 'Frame not found' });
+        }
+        sendStoredImage(req, res, frame, field);
+    } catch (error) {
+        res.status(500).json({ error: error.message });
+    }
+});
+
+// Images of a plate-and-patch document (persistence_mode plate_patches): its background
+// plate and region crops, which the viewer pastes together at the crops' rectangles
+app.get('/api/frames/:id/plate', async (req, res) => {
+    try {
+        const frame = await db.collection(COLLECTION_NAME).findOne(
+            { _id: req.params.id },
+            { projection: { background_plate: 1 } }
+        );
+        if (!frame || !frame.background_plate) {
+            return res.status(404).json({ error: 'No background plate' });
+        }
+        // Plates are shared by many frames and never rewritten
+        res.sendFile(path.resolve(PROJECT_ROOT, frame.background_plate.path), IMMUTABLE_FILE);
+    } catch (error) {
+        res.status(500).json({ error: error.message });
+    }
+});
+
+app.get('/api/frames/:id/crops/:index', async (req, res) => {
+    try {
+        const frame = await db.collection(COLLECTION_NAME).findOne(
+            { _id: req.params.id },
+            { projection: { region_crops: 1 } }
+        );
+        const crop = frame && frame.region_crops && frame.region_crops[Number(req.params.index)];
+        if (!crop) {
+            return res.status(404).json({ error: 'No such region crop' });
+        }
+        res.sendFile(path.resolve(PROJECT_ROOT, crop.path), IMMUTABLE_FILE);
     } catch (error) {
         res.status(500).json({ error: error.message });
     }
@@ -110,20 +355,86 @@ app.get('/api/frames/:id', async (req, res) => {
 app.get('/api/stats', async (req, res) => {
     try {
         const collection = db.collection(COLLECTION_NAME);
-        const totalFrames = await collection.countDocuments();
+        const totalFrames = await collection.estimatedDocumentCount();
         const latestFrame = await collection.findOne({}, { sort: { 'metadata.timestamp': -1 } });
         const oldestFrame = await collection.findOne({}, { sort: { 'metadata.timestamp': 1 } });
+
+        // Last 24 hours of detector activity from the per-minute summaries
+        const since = new Date(Date.now() - 24 * 60 * 60 * 1000);
+        const [motion] = await db.collection(MOTION_STATS_COLLECTION).aggregate([
+            { $match: { minute: { $gte: since } } },
+            { $group: {
+                _id: null,
+                frames: { $sum: '$frames' },
+                motionFrames: { $sum: '$motion_frames' },
+                motionBoxes: { $sum: '$motion_boxes' },
+                regions: { $sum: '$regions' }
+            } }
+        ]).toArray();
         
         res.json({
             totalFrames: totalFrames,
             latestFrame: latestFrame?.metadata?.timestamp,
-            oldestFrame: oldestFrame?.metadata?.timestamp
+            oldestFrame: oldestFrame?.metadata?.timestamp,
+            last24h: {
+                framesProcessed: motion?.frames || 0,
+                motionFrames: motion?.motionFrames || 0,
+                regions: motion?.regions || 0,
+                meanBoxesPerFrame: motion?.frames ? motion.motionBoxes / motion.frames : 0
+            }
         });
     } catch (error) {
         res.status(500).json({ error: error.message });
     }
 });
 
+// Per-minute motion summaries, oldest first: ?minutes= (default 60, at most a week) and an
+// optional ?source= stream filter
+app.get('/api/stats/motion', async (req, res) => {
+    try {
+        const minutes = Math.min(Math.max(parseInt(req.query.minutes) || 60, 1), 7 * 24 * 60);
+        const filter = { minute: { $gte: new Date(Date.now() - minutes * 60 * 1000) } };
+        if (req.query.source) filter.source = String(req.query.source);
+
+        const summaries = await db.collection(MOTION_STATS_COLLECTION)
+            .find(filter, { projection: { updated_at: 0 } })
+            .sort({ minute: 1 })
+            .toArray();
+        res.json({ minutes: minutes, summaries: summaries });
+    } catch (error) {
+        res.status(500).json({ error: error.message });
+    }
+});
+
+app.get('/api/clips', async (req, res) => {
+    try {
+        let files = [];
+        try {
+            files = await fs.promises.readdir(CLIPS_DIR);
+        } catch (error) {
+            if (error.code !== 'ENOENT') throw error;  // No clips recorded yet
+        }
+        const fileSet = new Set(files);
+        const clips = await Promise.all(files
+            .filter(name => name.endsWith('.mp4'))
+            .map(async name => {
+                const stat = await fs.promises.stat(path.join(CLIPS_DIR, name));
+                const overlay = name.replace(/\.mp4$/, '.vtt');
+                return {
+                    name: name,
+                    url: `/clips/${encodeURIComponent(name)}`,
+                    overlay_url: fileSet.has(overlay) ? `/clips/${encodeURIComponent(overlay)}` : null,
+                    size: stat.size,
+                    modified: stat.mtime
+                };
+            }));
+        clips.sort((a, b) => b.modified - a.modified);
+        res.json({ clips: clips.slice(0, parseInt(req.query.limit) || 20) });
+    } catch (error) {
+        res.status(500).json({ error: error.message });
+    }
+});
+
 // Start server
 async function startServer() {
     await connectToMongoDB();
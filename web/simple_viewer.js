@@ -268,6 +268,20 @@ app.get('/api/frames', async (req, res) => {
     }
 });
 
+// Streams an image appended to a segment file ({file, offset, length}, see FrameSegmentStore)
+function sendSegmentImage(res, segment) {
+    const start = Number(segment.offset);
+    const length = Number(segment.length);
+    res.type('image/jpeg');
+    res.set('Content-Length', String(length));
+    fs.createReadStream(path.resolve(__dirname, '..', segment.file), { start, end: start + length - 1 })
+        .on('error', () => {
+            if (res.headersSent) res.destroy();
+            else res.status(404).send('Segment not found');
+        })
+        .pipe(res);
+}
+
 // API endpoint to serve images
 app.get('/api/image/:frameId', async (req, res) => {
     try {
@@ -279,6 +293,12 @@ app.get('/api/image/:frameId', async (req, res) => {
             return res.status(404).send('Frame not found');
         }
         
+        // Frames saved to segment files have an extent instead of a path
+        const segment = frame.processed_image_segment || frame.original_image_segment;
+        if (segment) {
+            return sendSegmentImage(res, segment);
+        }
+        
         // Try processed image first, then original
         const imagePath = frame.processed_image_path || frame.original_image_path;
         if (!imagePath) {
@@ -313,6 +333,10 @@ app.get('/api/original/:frameId', async (req, res) => {
             return res.status(404).send('Frame not found');
         }
         
+        if (frame.original_image_segment) {
+            return sendSegmentImage(res, frame.original_image_segment);
+        }
+        
         // Use original image path (without motion detection overlays)
         const imagePath = frame.original_image_path;
         if (!imagePath) {